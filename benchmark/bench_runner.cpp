@@ -0,0 +1,372 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// A single runner for a set of representative benchmarks.
+// Each benchmark is executed a number of times (after a number
+// of warmup runs), and the statistics of the measurements are
+// written in JSON format. Optionally, the results can be compared
+// to the results of a previous run, flagging as regressions the
+// benchmarks whose median increased more than a given threshold.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "perf_events.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// A benchmark case. The run function performs a
+// single measurement and returns the measured value
+// (in the unit indicated for the case).
+struct bench_case {
+    std::string name;
+    std::string unit;
+    std::function<double()> run;
+};
+
+double elapsed_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The ODE systems used in the benchmarks.
+auto two_body_sys()
+{
+    return make_nbody_sys(2, kw::masses = {1., 0.});
+}
+
+const std::vector<double> two_body_ic{0., 0., 0., 0., 0., 0., 1., 0., 0., 0., 1., 0.};
+
+auto outer_ss_sys()
+{
+    const auto G = 0.01720209895 * 0.01720209895 * 365 * 365;
+
+    return make_nbody_sys(
+        6, kw::masses = {1.00000597682, 1 / 1047.355, 1 / 3501.6, 1 / 22869., 1 / 19314., 7.4074074e-09},
+        kw::Gconst = G);
+}
+
+// Time needed to construct an integrator.
+// NOTE: the in-memory cache is cleared before each
+// measurement, otherwise the object code of the first
+// construction would be re-used.
+template <typename F>
+double construction_time(const F &make_ta)
+{
+    llvm_state::clear_memcache();
+
+    const auto start = std::chrono::steady_clock::now();
+    make_ta();
+
+    return elapsed_since(start);
+}
+
+// Time per step for n_steps steps of an integrator
+// (excluding the construction time).
+template <typename Ta>
+double step_time(Ta &ta, std::size_t n_steps)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < n_steps; ++i) {
+        ta.step();
+    }
+
+    return elapsed_since(start) / static_cast<double>(n_steps);
+}
+
+std::vector<bench_case> make_bench_cases()
+{
+    std::vector<bench_case> retval;
+
+    // Construction time.
+    for (auto cm : {false, true}) {
+        retval.push_back({std::string("construction/outer_ss") + (cm ? "/compact" : ""), "s", [cm]() {
+                              return construction_time([cm]() {
+                                  taylor_adaptive<double> ta{outer_ss_sys(), std::vector<double>(36, 1.),
+                                                             kw::compact_mode = cm};
+                              });
+                          }});
+    }
+
+    // Compilation time per optimisation level.
+    for (auto ol : {0u, 1u, 2u, 3u}) {
+        retval.push_back({"construction/outer_ss/opt_level_" + std::to_string(ol), "s", [ol]() {
+                              return construction_time([ol]() {
+                                  taylor_adaptive<double> ta{outer_ss_sys(), std::vector<double>(36, 1.),
+                                                             kw::compact_mode = true, kw::opt_level = ol};
+                              });
+                          }});
+    }
+
+    // Step throughput.
+    for (auto cm : {false, true}) {
+        retval.push_back({std::string("step/two_body") + (cm ? "/compact" : ""), "s/step", [cm]() {
+                              // NOTE: the integrator is created once and
+                              // re-used in all the measurements.
+                              static taylor_adaptive<double> ta_def{two_body_sys(), two_body_ic};
+                              static taylor_adaptive<double> ta_cm{two_body_sys(), two_body_ic,
+                                                                   kw::compact_mode = true};
+
+                              return step_time(cm ? ta_cm : ta_def, 10000);
+                          }});
+    }
+
+    // Event overhead.
+    retval.push_back({"step/two_body/nt_event", "s/step", []() {
+                          static taylor_adaptive<double> ta{
+                              two_body_sys(), two_body_ic, kw::compact_mode = true,
+                              kw::nt_events
+                              = {nt_event<double>("x_1"_var - 1000., [](taylor_adaptive<double> &, double, int) {})}};
+
+                          return step_time(ta, 10000);
+                      }});
+    retval.push_back({"step/pendulum/t_event", "s/step", []() {
+                          auto [x, v] = make_vars("x", "v");
+
+                          static taylor_adaptive<double> ta{
+                              {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                              {0.05, 0.025},
+                              kw::t_events = {t_event<double>(
+                                  v, kw::callback = [](taylor_adaptive<double> &, bool, int) { return true; })}};
+
+                          return step_time(ta, 10000);
+                      }});
+
+    // Batch scaling: time per step and per batch element.
+    for (std::uint32_t bs = 1; bs <= recommended_batch_size<double>() * 2u; bs *= 2u) {
+        retval.push_back({"step/two_body/batch_" + std::to_string(bs), "s/step/element", [bs]() {
+                              static std::map<std::uint32_t, taylor_adaptive_batch<double>> tas;
+
+                              auto it = tas.find(bs);
+                              if (it == tas.end()) {
+                                  std::vector<double> ic;
+                                  for (auto val : two_body_ic) {
+                                      ic.insert(ic.end(), bs, val);
+                                  }
+
+                                  it = tas.emplace(bs, taylor_adaptive_batch<double>{two_body_sys(), std::move(ic), bs})
+                                           .first;
+                              }
+
+                              return step_time(it->second, 10000) / bs;
+                          }});
+    }
+
+    return retval;
+}
+
+// Minimal parser for the JSON reports written by this runner,
+// i.e., an array of flat JSON objects. Returns the median of
+// each benchmark, indexed by name.
+std::map<std::string, double> parse_medians(const std::string &filename)
+{
+    std::ifstream ifs(filename);
+    if (!ifs) {
+        throw std::runtime_error("Cannot open the baseline file '" + filename + "'");
+    }
+
+    const std::string content{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+
+    std::map<std::string, double> retval;
+
+    // Helper to fetch the value associated to the key
+    // in the object spanning the range [begin, end).
+    auto fetch = [&content](const std::string &key, std::size_t begin, std::size_t end) -> std::string {
+        const auto k_pos = content.find("\"" + key + "\":", begin);
+        if (k_pos == std::string::npos || k_pos >= end) {
+            return {};
+        }
+
+        auto v_begin = content.find_first_not_of(" ", k_pos + key.size() + 3u);
+        auto v_end = content.find_first_of(",\n}", v_begin);
+        if (content[v_begin] == '"') {
+            ++v_begin;
+            v_end = content.find('"', v_begin);
+        }
+
+        return content.substr(v_begin, v_end - v_begin);
+    };
+
+    for (auto begin = content.find('{'); begin != std::string::npos; begin = content.find('{', begin + 1u)) {
+        const auto end = content.find('}', begin);
+        if (end == std::string::npos) {
+            throw std::runtime_error("Invalid JSON data in the baseline file '" + filename + "'");
+        }
+
+        const auto name = fetch("name", begin, end);
+        const auto median = fetch("median", begin, end);
+        if (!name.empty() && !median.empty()) {
+            retval[name] = std::stod(median);
+        }
+    }
+
+    return retval;
+}
+
+// Compute the p-th percentile (with p in [0, 1]) of the
+// sorted vector v via linear interpolation.
+double percentile(const std::vector<double> &v, double p)
+{
+    const auto pos = p * static_cast<double>(v.size() - 1u);
+    const auto lo = static_cast<std::size_t>(std::floor(pos));
+    const auto hi = std::min(lo + 1u, v.size() - 1u);
+
+    return v[lo] + (pos - static_cast<double>(lo)) * (v[hi] - v[lo]);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    unsigned n_reps = 0, n_warmup = 0;
+    std::string filter, json_file, baseline_file;
+    double threshold = 0;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")("list", "list the available benchmarks")(
+        "reps", po::value<unsigned>(&n_reps)->default_value(11u), "number of measurements per benchmark")(
+        "warmup", po::value<unsigned>(&n_warmup)->default_value(2u), "number of warmup runs per benchmark")(
+        "filter", po::value<std::string>(&filter)->default_value(""),
+        "run only the benchmarks whose name contains this string")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, the report is printed to screen)")(
+        "baseline", po::value<std::string>(&baseline_file)->default_value(""),
+        "JSON report of a previous run to compare against")(
+        "threshold", po::value<double>(&threshold)->default_value(0.1),
+        "relative increase of the median with respect to the baseline flagged as a regression");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (n_reps == 0u) {
+        throw std::invalid_argument("The number of repetitions must be at least 1");
+    }
+
+    if (!std::isfinite(threshold) || threshold < 0) {
+        throw std::invalid_argument("The regression threshold must be finite and non-negative");
+    }
+
+    const auto cases = make_bench_cases();
+
+    if (vm.count("list")) {
+        for (const auto &bc : cases) {
+            std::cout << bc.name << " [" << bc.unit << "]\n";
+        }
+        return 0;
+    }
+
+    const auto baseline = baseline_file.empty() ? std::map<std::string, double>{} : parse_medians(baseline_file);
+
+    std::string report = "[\n";
+    bool first = true, regression = false;
+
+    for (const auto &bc : cases) {
+        if (bc.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        std::cerr << "Running '" << bc.name << "'...";
+        std::cerr.flush();
+
+        for (auto i = 0u; i < n_warmup; ++i) {
+            bc.run();
+        }
+
+        std::vector<double> meas;
+        for (auto i = 0u; i < n_reps; ++i) {
+            meas.push_back(bc.run());
+        }
+        std::sort(meas.begin(), meas.end());
+
+        const auto median = percentile(meas, .5);
+
+        bench_report rep(bc.name);
+        rep.add("unit", bc.unit);
+        rep.add("reps", n_reps);
+        rep.add("min", meas.front());
+        rep.add("p10", percentile(meas, .1));
+        rep.add("median", median);
+        rep.add("p90", percentile(meas, .9));
+        rep.add("max", meas.back());
+
+        std::cerr << " median: " << median << bc.unit;
+
+        if (const auto it = baseline.find(bc.name); it != baseline.end()) {
+            const auto rel_change = (median - it->second) / it->second;
+            const auto is_reg = rel_change > threshold;
+
+            rep.add("baseline_median", it->second);
+            rep.add("rel_change", rel_change);
+            rep.add("regression", is_reg);
+
+            std::cerr << " (" << (rel_change >= 0 ? "+" : "") << rel_change * 100 << "%"
+                      << (is_reg ? ", REGRESSION" : "") << ")";
+
+            regression = regression || is_reg;
+        }
+
+        std::cerr << '\n';
+
+        report += (first ? "" : ",\n") + rep.to_json();
+        // NOTE: remove the trailing newline from
+        // the object, so that the separator is placed
+        // right after the closing brace.
+        report.pop_back();
+        first = false;
+    }
+
+    report += "\n]\n";
+
+    if (json_file.empty()) {
+        std::cout << report;
+    } else {
+        std::ofstream of(json_file, std::ios_base::out | std::ios_base::trunc);
+        if (!of) {
+            throw std::runtime_error("Cannot open the file '" + json_file + "' for writing the benchmark report");
+        }
+        of << report;
+    }
+
+    // NOTE: signal the regressions via the exit code,
+    // so that the runner can be used in scripts.
+    return regression ? 1 : 0;
+}
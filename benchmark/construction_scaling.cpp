@@ -0,0 +1,261 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Construction time benchmark for the adaptive integrators. For each combination of
+// system (N-body or mascon), system size, compact mode, optimisation level and batch size,
+// an integrator is constructed and the construction time is split into the Taylor decomposition,
+// the generation of the LLVM IR, the optimisation and the codegen (i.e., the compilation to
+// machine code). The phases are measured via the trace spans of heyoka (see tracing.hpp).
+// The results are printed as a table, and optionally written in JSON format.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/tracing.hpp>
+
+#include "perf_events.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// Total duration (in seconds) of the trace spans, grouped by name.
+// NOTE: the trace JSON contains one span per line.
+std::map<std::string, double> span_durations()
+{
+    std::map<std::string, double> retval;
+
+    std::istringstream iss(get_trace_json());
+    std::string line;
+    while (std::getline(iss, line)) {
+        const auto name_pos = line.find("\"name\":\"");
+        const auto dur_pos = line.find("\"dur\":");
+        if (name_pos == std::string::npos || dur_pos == std::string::npos) {
+            continue;
+        }
+
+        const auto name_begin = name_pos + 8u;
+        const auto name = line.substr(name_begin, line.find('"', name_begin) - name_begin);
+
+        retval[name] += std::stod(line.substr(dur_pos + 6u)) / 1E6;
+    }
+
+    return retval;
+}
+
+// Construct a system with n bodies (N-body) or
+// n mascons (mascon), and the corresponding
+// initial conditions for a single batch element.
+std::pair<std::vector<std::pair<expression, expression>>, std::vector<double>> make_sys(const std::string &kind,
+                                                                                         std::uint32_t n)
+{
+    if (kind == "nbody") {
+        std::vector<double> masses(n, 1E-6);
+        masses[0] = 1;
+
+        std::vector<double> ic(static_cast<std::size_t>(n) * 6u);
+        for (std::uint32_t i = 1; i < n; ++i) {
+            ic[i * 6u] = i;
+            ic[i * 6u + 4u] = 1 / std::sqrt(static_cast<double>(i));
+        }
+
+        return {make_nbody_sys(n, kw::masses = masses), std::move(ic)};
+    } else {
+        // Random mascons within the unit cube.
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> dist(-.5, .5);
+
+        std::vector<std::vector<double>> points;
+        for (std::uint32_t i = 0; i < n; ++i) {
+            points.push_back({dist(rng), dist(rng), dist(rng)});
+        }
+
+        return {make_mascon_system(kw::Gconst = 1., kw::points = points,
+                                   kw::masses = std::vector<double>(n, 1. / n), kw::omega = std::vector{0., 0., .1}),
+                {2., 0., 0., 0., .7, 0.}};
+    }
+}
+
+// Replicate the initial conditions for batch mode.
+std::vector<double> batch_ic(const std::vector<double> &ic, std::uint32_t bs)
+{
+    std::vector<double> retval;
+
+    for (const auto &val : ic) {
+        for (std::uint32_t j = 0; j < bs; ++j) {
+            retval.push_back(val);
+        }
+    }
+
+    return retval;
+}
+
+struct result {
+    double decomposition, ir, optimisation, codegen, total;
+};
+
+result run_config(const std::string &kind, std::uint32_t n, bool cm, std::uint32_t ol, std::uint32_t bs)
+{
+    auto [sys, ic] = make_sys(kind, n);
+
+    // NOTE: clear the in-memory cache in order
+    // to measure the actual compilation time.
+    llvm_state::clear_memcache();
+    clear_trace();
+
+    if (bs == 1u) {
+        taylor_adaptive<double> ta{std::move(sys), std::move(ic), kw::compact_mode = cm, kw::opt_level = ol};
+    } else {
+        taylor_adaptive_batch<double> ta{std::move(sys), batch_ic(ic, bs), bs, kw::compact_mode = cm,
+                                         kw::opt_level = ol};
+    }
+
+    auto durs = span_durations();
+
+    result res{};
+    res.decomposition = durs["taylor_decompose"];
+    // NOTE: the decomposition is performed within
+    // taylor_add_adaptive_step().
+    res.ir = durs["taylor_add_adaptive_step"] - res.decomposition;
+    res.optimisation = durs["llvm_state::optimise"];
+    res.codegen = durs["llvm_state::compile"];
+    res.total = durs[bs == 1u ? "taylor_adaptive::ctor" : "taylor_adaptive_batch::ctor"];
+
+    return res;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string kinds_str, sizes_str, compact_str, opt_levels_str, batch_sizes_str, json_file;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "systems", po::value<std::string>(&kinds_str)->default_value("nbody,mascon"),
+        "comma-separated list of systems (nbody or mascon)")(
+        "sizes", po::value<std::string>(&sizes_str)->default_value("2,4,8,16"),
+        "comma-separated list of system sizes (number of bodies or mascons)")(
+        "compact_mode", po::value<std::string>(&compact_str)->default_value("both"), "compact mode (0, 1 or both)")(
+        "opt_levels", po::value<std::string>(&opt_levels_str)->default_value("0,3"),
+        "comma-separated list of optimisation levels")(
+        "batch_sizes", po::value<std::string>(&batch_sizes_str)->default_value("1,4"),
+        "comma-separated list of batch sizes (1 means the scalar integrator)")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, only the table is printed)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    const auto kinds = parse_list<std::string>(kinds_str, "systems");
+    const auto sizes = parse_list<std::uint32_t>(sizes_str, "sizes");
+    const auto compact_modes = parse_bool_axis(compact_str, "compact_mode");
+    const auto opt_levels = parse_list<std::uint32_t>(opt_levels_str, "opt_levels");
+    const auto batch_sizes = parse_list<std::uint32_t>(batch_sizes_str, "batch_sizes");
+
+    for (const auto &k : kinds) {
+        if (k != "nbody" && k != "mascon") {
+            throw std::invalid_argument("Invalid system '" + k + "' (it must be either 'nbody' or 'mascon')");
+        }
+    }
+    for (const auto &k : kinds) {
+        for (auto n : sizes) {
+            if (n < (k == "nbody" ? 2u : 1u)) {
+                throw std::invalid_argument("Invalid size " + std::to_string(n) + " for the system '" + k + "'");
+            }
+        }
+    }
+    for (auto bs : batch_sizes) {
+        if (bs == 0u) {
+            throw std::invalid_argument("The batch size cannot be zero");
+        }
+    }
+
+    set_tracing_enabled(true);
+
+    std::cout << std::left << std::setw(8) << "system" << std::right << std::setw(6) << "size" << std::setw(4) << "cm"
+              << std::setw(4) << "ol" << std::setw(4) << "bs" << std::setw(12) << "decomp[s]" << std::setw(12)
+              << "ir[s]" << std::setw(12) << "opt[s]" << std::setw(12) << "codegen[s]" << std::setw(12) << "total[s]"
+              << '\n';
+
+    std::string report = "[\n";
+    bool first = true;
+
+    for (const auto &k : kinds) {
+        for (auto n : sizes) {
+            for (auto cm : compact_modes) {
+                for (auto ol : opt_levels) {
+                    for (auto bs : batch_sizes) {
+                        const auto res = run_config(k, n, cm, ol, bs);
+
+                        std::cout << std::left << std::setw(8) << k << std::right << std::setw(6) << n
+                                  << std::setw(4) << cm << std::setw(4) << ol << std::setw(4) << bs << std::fixed
+                                  << std::setprecision(4) << std::setw(12) << res.decomposition << std::setw(12)
+                                  << res.ir << std::setw(12) << res.optimisation << std::setw(12) << res.codegen
+                                  << std::setw(12) << res.total << std::endl;
+
+                        bench_report rep("construction_scaling");
+                        rep.add("system", k);
+                        rep.add("size", n);
+                        rep.add("compact_mode", cm);
+                        rep.add("opt_level", ol);
+                        rep.add("batch_size", bs);
+                        rep.add("decomposition_time", res.decomposition);
+                        rep.add("ir_time", res.ir);
+                        rep.add("optimisation_time", res.optimisation);
+                        rep.add("codegen_time", res.codegen);
+                        rep.add("total_time", res.total);
+
+                        report += (first ? "" : ",\n") + rep.to_json();
+                        report.pop_back();
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+
+    report += "\n]\n";
+
+    if (!json_file.empty()) {
+        std::ofstream of(json_file, std::ios_base::out | std::ios_base::trunc);
+        if (!of) {
+            throw std::runtime_error("Cannot open the file '" + json_file + "' for writing the benchmark report");
+        }
+        of << report;
+    }
+}
@@ -0,0 +1,289 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Thread scaling benchmark for ensemble workloads. Many perturbed copies of a
+// two-body or outer Solar System integrator are propagated with an increasing
+// number of threads, optionally with event detection. In the "shared" mode, the
+// tasks are copies of a single integrator (via ensemble_propagate_until()), in the
+// "independent" mode each task constructs its own integrator (thus exercising the
+// in-memory cache of compiled code). Both strong scaling (fixed total number of tasks)
+// and weak scaling (fixed number of tasks per thread) are reported, so that
+// contention points become visible as a loss of parallel efficiency.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "perf_events.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// The benchmarked systems.
+struct bench_sys {
+    std::vector<std::pair<expression, expression>> sys;
+    std::vector<double> ic;
+    double t_final;
+};
+
+bench_sys make_bench_sys(const std::string &name)
+{
+    if (name == "two_body") {
+        return {make_nbody_sys(2, kw::masses = {1., 0.}), {0., 0., 0., 0., 0., 0., 1., 0., 0., 0., 1., 0.}, 1000.};
+    }
+
+    // Outer Solar System, as in the outer_ss_long_term benchmark.
+    const auto masses = std::vector{1.00000597682, 1 / 1047.355, 1 / 3501.6, 1 / 22869., 1 / 19314., 7.4074074e-09};
+    const auto G = 0.01720209895 * 0.01720209895 * 365 * 365;
+
+    auto ic = std::vector{// Sun.
+                          -4.06428567034226e-3, -6.08813756435987e-3, -1.66162304225834e-6, +6.69048890636161e-6 * 365,
+                          -6.33922479583593e-6 * 365, -3.13202145590767e-9 * 365,
+                          // Jupiter.
+                          +3.40546614227466e+0, +3.62978190075864e+0, +3.42386261766577e-2, -5.59797969310664e-3 * 365,
+                          +5.51815399480116e-3 * 365, -2.66711392865591e-6 * 365,
+                          // Saturn.
+                          +6.60801554403466e+0, +6.38084674585064e+0, -1.36145963724542e-1, -4.17354020307064e-3 * 365,
+                          +3.99723751748116e-3 * 365, +1.67206320571441e-5 * 365,
+                          // Uranus.
+                          +1.11636331405597e+1, +1.60373479057256e+1, +3.61783279369958e-1, -3.25884806151064e-3 * 365,
+                          +2.06438412905916e-3 * 365, -2.17699042180559e-5 * 365,
+                          // Neptune.
+                          -3.01777243405203e+1, +1.91155314998064e+0, -1.53887595621042e-1, -2.17471785045538e-4 * 365,
+                          -3.11361111025884e-3 * 365, +3.58344705491441e-5 * 365,
+                          // Pluto.
+                          -2.13858977531573e+1, +3.20719104739886e+1, +2.49245689556096e+0, -1.76936577252484e-3 * 365,
+                          -2.06720938381724e-3 * 365, +6.58091931493844e-4 * 365};
+
+    return {make_nbody_sys(6, kw::masses = masses, kw::Gconst = G), std::move(ic), 1000.};
+}
+
+// Construct an integrator for the system bs, optionally
+// with a non-terminal event (the crossing of the x = 0 plane
+// by the second body).
+taylor_adaptive<double> make_ta(const bench_sys &bs, bool events)
+{
+    std::vector<taylor_adaptive<double>::nt_event_t> ntes;
+    if (events) {
+        ntes.emplace_back("x_1"_var, [](taylor_adaptive<double> &, double, int) {});
+    }
+
+    return taylor_adaptive<double>{bs.sys, bs.ic, kw::high_accuracy = true, kw::nt_events = std::move(ntes)};
+}
+
+// Perturb the initial conditions of the integrator
+// for the i-th task.
+void perturb(taylor_adaptive<double> &ta, std::size_t i)
+{
+    ta.get_state_data()[1] *= 1 + static_cast<double>(i) * 1E-9;
+}
+
+// Propagate n_tasks tasks with n_threads threads,
+// and return the wall-clock time.
+double run_tasks(const bench_sys &bs, bool events, bool shared, std::size_t n_tasks, unsigned n_threads)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    if (shared) {
+        const auto ta = make_ta(bs, events);
+
+        ensemble_propagate_until<double>(ta, bs.t_final, n_tasks, perturb, kw::n_threads = n_threads);
+    } else {
+        std::atomic<std::size_t> next_task{0};
+
+        auto worker = [&]() {
+            while (true) {
+                const auto i = next_task.fetch_add(1);
+                if (i >= n_tasks) {
+                    break;
+                }
+
+                auto ta = make_ta(bs, events);
+                perturb(ta, i);
+                ta.propagate_until(bs.t_final);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < n_threads; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+
+        for (auto &t : threads) {
+            t.join();
+        }
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string systems_str, threads_str, modes_str, events_str, json_file;
+    std::size_t n_tasks = 0, tasks_per_thread = 0;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "systems", po::value<std::string>(&systems_str)->default_value("two_body,outer_ss"),
+        "comma-separated list of systems (two_body or outer_ss)")(
+        "threads", po::value<std::string>(&threads_str)->default_value(""),
+        "comma-separated list of thread counts (defaults to the powers of 2 up to the number of hardware threads)")(
+        "modes", po::value<std::string>(&modes_str)->default_value("shared,independent"),
+        "comma-separated list of modes (shared or independent)")(
+        "events", po::value<std::string>(&events_str)->default_value("0,1"),
+        "comma-separated list of event detection flags (0 or 1)")(
+        "n_tasks", po::value<std::size_t>(&n_tasks)->default_value(256), "total number of tasks for strong scaling")(
+        "tasks_per_thread", po::value<std::size_t>(&tasks_per_thread)->default_value(16),
+        "number of tasks per thread for weak scaling")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, only the table is printed)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    const auto systems = parse_list<std::string>(systems_str, "systems");
+    const auto modes = parse_list<std::string>(modes_str, "modes");
+    const auto events = parse_list<unsigned>(events_str, "events");
+
+    std::vector<unsigned> threads;
+    if (threads_str.empty()) {
+        const auto hw = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned n = 1; n < hw; n *= 2u) {
+            threads.push_back(n);
+        }
+        threads.push_back(hw);
+    } else {
+        threads = parse_list<unsigned>(threads_str, "threads");
+    }
+
+    for (const auto &s : systems) {
+        if (s != "two_body" && s != "outer_ss") {
+            throw std::invalid_argument("Invalid system '" + s + "' (it must be either 'two_body' or 'outer_ss')");
+        }
+    }
+    for (const auto &m : modes) {
+        if (m != "shared" && m != "independent") {
+            throw std::invalid_argument("Invalid mode '" + m + "' (it must be either 'shared' or 'independent')");
+        }
+    }
+    for (auto e : events) {
+        if (e > 1u) {
+            throw std::invalid_argument("The event detection flags must be either 0 or 1");
+        }
+    }
+    for (auto n : threads) {
+        if (n == 0u) {
+            throw std::invalid_argument("The number of threads cannot be zero");
+        }
+    }
+    if (n_tasks == 0u || tasks_per_thread == 0u) {
+        throw std::invalid_argument("The numbers of tasks cannot be zero");
+    }
+
+    std::cout << std::left << std::setw(10) << "system" << std::setw(13) << "mode" << std::right << std::setw(7)
+              << "events" << std::setw(9) << "threads" << std::setw(12) << "strong[s]" << std::setw(10) << "speedup"
+              << std::setw(10) << "eff" << std::setw(12) << "weak[s]" << std::setw(10) << "weak eff" << '\n';
+
+    std::string report = "[\n";
+    bool first = true;
+
+    for (const auto &s : systems) {
+        const auto bs = make_bench_sys(s);
+
+        for (const auto &m : modes) {
+            for (auto e : events) {
+                // NOTE: run a single task first, in order
+                // to warm up the caches.
+                run_tasks(bs, e != 0u, m == "shared", 1, 1);
+
+                double strong_t1 = 0, weak_t1 = 0;
+
+                for (auto n : threads) {
+                    const auto strong_t = run_tasks(bs, e != 0u, m == "shared", n_tasks, n);
+                    const auto weak_t = run_tasks(bs, e != 0u, m == "shared", tasks_per_thread * n, n);
+
+                    if (n == threads[0]) {
+                        // NOTE: the efficiencies are normalised
+                        // with respect to the first thread count.
+                        strong_t1 = strong_t * threads[0];
+                        weak_t1 = weak_t;
+                    }
+
+                    const auto speedup = strong_t1 / strong_t;
+                    const auto eff = speedup / n;
+                    const auto weak_eff = weak_t1 / weak_t;
+
+                    std::cout << std::left << std::setw(10) << s << std::setw(13) << m << std::right << std::setw(7)
+                              << e << std::setw(9) << n << std::fixed << std::setprecision(4) << std::setw(12)
+                              << strong_t << std::setw(10) << speedup << std::setw(10) << eff << std::setw(12)
+                              << weak_t << std::setw(10) << weak_eff << std::endl;
+
+                    bench_report rep("ensemble_scaling");
+                    rep.add("system", s);
+                    rep.add("mode", m);
+                    rep.add("events", e != 0u);
+                    rep.add("n_threads", n);
+                    rep.add("n_tasks", n_tasks);
+                    rep.add("strong_time", strong_t);
+                    rep.add("strong_speedup", speedup);
+                    rep.add("strong_efficiency", eff);
+                    rep.add("tasks_per_thread", tasks_per_thread);
+                    rep.add("weak_time", weak_t);
+                    rep.add("weak_efficiency", weak_eff);
+
+                    report += (first ? "" : ",\n") + rep.to_json();
+                    report.pop_back();
+                    first = false;
+                }
+            }
+        }
+    }
+
+    report += "\n]\n";
+
+    if (!json_file.empty()) {
+        std::ofstream of(json_file, std::ios_base::out | std::ios_base::trunc);
+        if (!of) {
+            throw std::runtime_error("Cannot open the file '" + json_file + "' for writing the benchmark report");
+        }
+        of << report;
+    }
+}
@@ -0,0 +1,270 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Scaling benchmark for event detection. A harmonic oscillator is integrated
+// with an increasing number of terminal or non-terminal events of the form x - a.
+// The events with |a| < 1 have roots (twice per period), the others never trigger,
+// so that the fraction of events with roots (and thus the fraction of steps with roots)
+// can be controlled. For each combination of event kind, number of events, tolerance
+// (i.e., Taylor order) and root fraction, the time per step is split into the
+// time spent in the stepper (measured on an integrator without events), in the
+// callbacks (measured within the callbacks) and in event detection (the remainder).
+// The results are written in JSON format.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "perf_events.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// The offsets of the events: the first n_roots offsets are
+// spread within (-1, 1), the others are outside the range of x.
+std::vector<double> make_offsets(std::uint32_t n_ev, double root_fraction)
+{
+    const auto n_roots = static_cast<std::uint32_t>(std::llround(root_fraction * n_ev));
+
+    std::vector<double> retval;
+    for (std::uint32_t i = 0; i < n_ev; ++i) {
+        if (i < n_roots) {
+            retval.push_back(-.9 + 1.8 * (i + .5) / n_roots);
+        } else {
+            retval.push_back(2. + i);
+        }
+    }
+
+    return retval;
+}
+
+// Step the integrator ta for (at least) the requested duration.
+// pre_step is invoked before each step. Returns the number
+// of steps and the elapsed time.
+template <typename F>
+std::pair<std::uint64_t, double> step_for(taylor_adaptive<double> &ta, double duration, const F &pre_step)
+{
+    std::uint64_t n_steps = 0;
+    double elapsed = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    while (elapsed < duration) {
+        for (auto i = 0; i < 100; ++i) {
+            pre_step();
+            ta.step();
+        }
+        n_steps += 100u;
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return std::pair{n_steps, elapsed};
+}
+
+// Run a single configuration of the benchmark,
+// and return its JSON report.
+std::string run_config(bool terminal, std::uint32_t n_ev, double tol, double root_fraction, bool cm, double duration)
+{
+    std::cerr << (terminal ? "terminal" : "non-terminal") << " events=" << n_ev << ", tol=" << tol
+              << ", root fraction=" << root_fraction << ": ";
+    std::cerr.flush();
+
+    auto [x, v] = make_vars("x", "v");
+    const auto sys = std::vector{prime(x) = v, prime(v) = -x};
+    const auto ic = std::vector{0., 1.};
+
+    // Time spent in the callbacks, and flag signalling
+    // that a callback was invoked in the current step.
+    double cb_time = 0;
+    bool root_found = false;
+
+    // NOTE: the callbacks are timed from within,
+    // the overhead of the timing is small compared to
+    // the other costs of a root.
+    auto record = [&cb_time, &root_found](std::chrono::steady_clock::time_point t0) {
+        cb_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        root_found = true;
+    };
+
+    std::vector<taylor_adaptive<double>::t_event_t> tes;
+    std::vector<taylor_adaptive<double>::nt_event_t> ntes;
+
+    for (const auto a : make_offsets(n_ev, root_fraction)) {
+        if (terminal) {
+            tes.emplace_back(
+                x - a, kw::callback = [&record](taylor_adaptive<double> &, bool, int) {
+                    record(std::chrono::steady_clock::now());
+                    return true;
+                });
+        } else {
+            ntes.emplace_back(x - a, [&record](taylor_adaptive<double> &, double, int) {
+                record(std::chrono::steady_clock::now());
+            });
+        }
+    }
+
+    taylor_adaptive<double> ta{sys, ic, kw::tol = tol, kw::compact_mode = cm};
+    taylor_adaptive<double> ta_ev{sys,
+                                  ic,
+                                  kw::tol = tol,
+                                  kw::compact_mode = cm,
+                                  kw::t_events = std::move(tes),
+                                  kw::nt_events = std::move(ntes)};
+
+    // NOTE: propagate for a while then reset,
+    // in order to prepare the caches.
+    ta_ev.propagate_until(10.);
+    ta_ev.set_time(0.);
+    std::copy(ic.begin(), ic.end(), ta_ev.get_state_data());
+    cb_time = 0;
+
+    const auto res = step_for(ta, duration, []() {});
+
+    std::uint64_t n_root_steps = 0;
+    const auto res_ev = step_for(ta_ev, duration, [&]() {
+        n_root_steps += static_cast<std::uint64_t>(root_found);
+        root_found = false;
+    });
+    n_root_steps += static_cast<std::uint64_t>(root_found);
+
+    const auto step_time = res.second / static_cast<double>(res.first);
+    const auto ev_step_time = res_ev.second / static_cast<double>(res_ev.first);
+    const auto cb_step_time = cb_time / static_cast<double>(res_ev.first);
+    const auto det_step_time = ev_step_time - step_time - cb_step_time;
+    const auto root_steps = static_cast<double>(n_root_steps) / static_cast<double>(res_ev.first);
+
+    std::cerr << "order=" << ta_ev.get_order() << ", stepper=" << step_time * 1E9
+              << "ns, detection=" << det_step_time * 1E9 << "ns, callbacks=" << cb_step_time * 1E9
+              << "ns, steps with roots=" << root_steps << '\n';
+
+    bench_report rep("event_scaling");
+    rep.add("terminal", terminal);
+    rep.add("n_events", n_ev);
+    rep.add("tol", tol);
+    rep.add("order", ta_ev.get_order());
+    rep.add("compact_mode", cm);
+    rep.add("root_fraction", root_fraction);
+    rep.add("steps_with_roots", root_steps);
+    rep.add("n_steps", res_ev.first);
+    rep.add("time_per_step", ev_step_time);
+    rep.add("stepper_time_per_step", step_time);
+    rep.add("detection_time_per_step", det_step_time);
+    rep.add("callback_time_per_step", cb_step_time);
+
+    return rep.to_json();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string n_events_str, tols_str, root_fractions_str, kinds_str, json_file;
+    double duration = 0;
+    bool compact_mode = false;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_events", po::value<std::string>(&n_events_str)->default_value("1,10,100,1000,10000"),
+        "comma-separated list of the numbers of events")(
+        "tols", po::value<std::string>(&tols_str)->default_value("1e-6,1e-10,2.2e-16"),
+        "comma-separated list of tolerances (which determine the Taylor order)")(
+        "root_fractions", po::value<std::string>(&root_fractions_str)->default_value("0,0.01,0.1,1"),
+        "comma-separated list of the fractions of events with roots")(
+        "kinds", po::value<std::string>(&kinds_str)->default_value("nt,t"),
+        "comma-separated list of event kinds (nt for non-terminal, t for terminal)")(
+        "compact_mode", po::value<bool>(&compact_mode)->default_value(true), "compact mode")(
+        "duration", po::value<double>(&duration)->default_value(0.5),
+        "wall-clock time (in seconds) spent stepping each configuration")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, the report is printed to screen)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (!std::isfinite(duration) || duration <= 0) {
+        throw std::invalid_argument("The duration must be finite and positive");
+    }
+
+    const auto n_events = parse_list<std::uint32_t>(n_events_str, "n_events");
+    const auto tols = parse_list<double>(tols_str, "tols");
+    const auto root_fractions = parse_list<double>(root_fractions_str, "root_fractions");
+    const auto kinds = parse_list<std::string>(kinds_str, "kinds");
+
+    for (auto n : n_events) {
+        if (n == 0u) {
+            throw std::invalid_argument("The number of events cannot be zero");
+        }
+    }
+    for (auto tol : tols) {
+        if (!std::isfinite(tol) || tol <= 0) {
+            throw std::invalid_argument("The tolerances must be finite and positive");
+        }
+    }
+    for (auto rf : root_fractions) {
+        if (!(rf >= 0 && rf <= 1)) {
+            throw std::invalid_argument("The root fractions must be in the [0, 1] range");
+        }
+    }
+    for (const auto &k : kinds) {
+        if (k != "nt" && k != "t") {
+            throw std::invalid_argument("Invalid event kind '" + k + "' (it must be either 'nt' or 't')");
+        }
+    }
+
+    std::string report = "[\n";
+    bool first = true;
+
+    for (const auto &k : kinds) {
+        for (auto n : n_events) {
+            for (auto tol : tols) {
+                for (auto rf : root_fractions) {
+                    report += (first ? "" : ",\n") + run_config(k == "t", n, tol, rf, compact_mode, duration);
+                    report.pop_back();
+                    first = false;
+                }
+            }
+        }
+    }
+
+    report += "\n]\n";
+
+    if (json_file.empty()) {
+        std::cout << report;
+    } else {
+        std::ofstream of(json_file, std::ios_base::out | std::ios_base::trunc);
+        if (!of) {
+            throw std::runtime_error("Cannot open the file '" + json_file + "' for writing the benchmark report");
+        }
+        of << report;
+    }
+}
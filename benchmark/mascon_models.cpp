@@ -129,7 +129,7 @@ struct mascon_dynamics {
 
 template <typename P, typename M>
 taylor_adaptive<double> taylor_factory(const P &mascon_points, const M &mascon_masses, double wz, double r0 = 2.,
-                                       double incl = 45., double G = 1.)
+                                       double incl = 45., double G = 1., bool fused = false)
 {
     // Initial conditions
     auto v0y = std::cos(incl / 360 * 6.28) * std::sqrt(1. / r0) - wz * r0;
@@ -137,7 +137,7 @@ taylor_adaptive<double> taylor_factory(const P &mascon_points, const M &mascon_m
     std::vector<double> ic = {r0, 0., 0., 0., v0y, v0z};
     // Constructing the integrator.
     auto eom = make_mascon_system(kw::points = mascon_points, kw::masses = mascon_masses,
-                                  kw::omega = std::vector<double>{0., 0., wz}, kw::Gconst = G);
+                                  kw::omega = std::vector<double>{0., 0., wz}, kw::Gconst = G, kw::fused = fused);
     auto start = high_resolution_clock::now();
     taylor_adaptive<double> taylor{eom, ic, kw::compact_mode = true, kw::tol = 1e-14};
     auto stop = high_resolution_clock::now();
@@ -255,7 +255,8 @@ int main(int argc, char *argv[])
     auto T_bennu = 3842.6367987779804;
     auto wz_bennu = 1.5633255034258877;
     fmt::print("\nBennu, {} mascons:\n", std::size(mascon_masses_bennu));
-    auto taylor_bennu = taylor_factory(mascon_points_bennu, mascon_masses_bennu, wz_bennu, distance, inclination, 1.);
+    auto taylor_bennu
+        = taylor_factory(mascon_points_bennu, mascon_masses_bennu, wz_bennu, distance, inclination, 1., true);
     // compare_taylor_vs_rkf(mascon_points_bennu, mascon_masses_bennu, taylor_bennu, wz_bennu,
     // integration_time / T_bennu);
     // plot_data(mascon_points_bennu, mascon_masses_bennu, taylor_bennu, wz_bennu, integration_time / T_bennu * 7,
@@ -12,6 +12,7 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <initializer_list>
 #include <ios>
@@ -43,9 +44,11 @@
 #include <heyoka/taylor.hpp>
 
 #include "benchmark_utils.hpp"
+#include "perf_events.hpp"
 
 template <typename T>
-void run_integration(const std::string &filename, T t_final, double perturb, bool compact_mode, T tol)
+void run_integration(const std::string &filename, T t_final, double perturb, bool compact_mode, T tol,
+                     const std::string &fp_type, const std::string &json_file, std::uint64_t raw_vec_event)
 {
     using std::abs;
     using std::log10;
@@ -219,7 +222,13 @@ void run_integration(const std::string &filename, T t_final, double perturb, boo
     }
     auto it = save_times.begin();
 
+    // NOTE: if the simulation data is being saved, the
+    // hardware counters will include the file output.
+    perf_events pe(raw_vec_event);
+    std::uint64_t n_steps = 0;
+
     start = std::chrono::high_resolution_clock::now();
+    pe.start();
 
     while (ta.get_time() < pow(T(10), final_time)) {
         if (of && it != save_times.end() && ta.get_time() >= *it) {
@@ -263,23 +272,36 @@ void run_integration(const std::string &filename, T t_final, double perturb, boo
         if (res != taylor_outcome::success) {
             throw std::runtime_error("Error status detected: " + std::to_string(static_cast<int>(res)));
         }
+        ++n_steps;
     }
 
+    pe.stop();
     elapsed = static_cast<double>(
         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start)
             .count());
 
     std::cout << "Integration time: " << elapsed << "ms\n";
     std::cout << "Final energy error: " << abs((init_energy - get_energy()) / init_energy) << '\n';
+
+    if (!json_file.empty()) {
+        bench_report rep("outer_ss_long_term");
+        rep.add("fp_type", fp_type);
+        rep.add("compact_mode", compact_mode);
+        rep.add("perturb", perturb);
+        rep.add("integration_time_ms", elapsed);
+        rep.add(pe.read(), n_steps);
+        rep.write(json_file);
+    }
 }
 
 int main(int argc, char *argv[])
 {
     namespace po = boost::program_options;
 
-    std::string fp_type, filename;
+    std::string fp_type, filename, json_file;
     double final_time, perturb, tol;
     bool compact_mode = false;
+    std::uint64_t raw_vec_event = 0;
 
     po::options_description desc("Options");
 
@@ -290,7 +312,11 @@ int main(int argc, char *argv[])
         "final_time", po::value<double>(&final_time)->default_value(1E6), "simulation end time (in years)")(
         "perturb", po::value<double>(&perturb)->default_value(0.),
         "magnitude of the perturbation on the initial state")("compact_mode", "compact mode")(
-        "tol", po::value<double>(&tol)->default_value(0.), "tolerance (if 0, it will be automatically deduced)");
+        "tol", po::value<double>(&tol)->default_value(0.), "tolerance (if 0, it will be automatically deduced)")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, no report is written)")(
+        "raw_vec_event", po::value<std::uint64_t>(&raw_vec_event)->default_value(0),
+        "raw perf event code for counting vector instructions (if 0, vector instructions are not counted)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -317,12 +343,14 @@ int main(int argc, char *argv[])
     }
 
     if (fp_type == "double") {
-        run_integration<double>(filename, final_time, perturb, compact_mode, tol);
+        run_integration<double>(filename, final_time, perturb, compact_mode, tol, fp_type, json_file, raw_vec_event);
     } else if (fp_type == "long double") {
-        run_integration<long double>(filename, final_time, perturb, compact_mode, tol);
+        run_integration<long double>(filename, final_time, perturb, compact_mode, tol, fp_type, json_file,
+                                     raw_vec_event);
 #if defined(HEYOKA_HAVE_REAL128)
     } else if (fp_type == "real128") {
-        run_integration<mppp::real128>(filename, mppp::real128{final_time}, perturb, compact_mode, mppp::real128{tol});
+        run_integration<mppp::real128>(filename, mppp::real128{final_time}, perturb, compact_mode, mppp::real128{tol},
+                                       fp_type, json_file, raw_vec_event);
 #endif
     } else {
         throw std::invalid_argument("Invalid floating-point type: '" + fp_type + "'");
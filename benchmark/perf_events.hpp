@@ -0,0 +1,339 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_BENCHMARK_PERF_EVENTS_HPP
+#define HEYOKA_BENCHMARK_PERF_EVENTS_HPP
+
+#include <heyoka/config.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+namespace heyoka_benchmark
+{
+
+// The hardware counters recorded by perf_events.
+// NOTE: an empty optional means that the corresponding
+// event is not available on the current machine (or that
+// the current user does not have the necessary permissions).
+struct hw_counts {
+    std::optional<std::uint64_t> cycles;
+    std::optional<std::uint64_t> instructions;
+    std::optional<std::uint64_t> cache_misses;
+    std::optional<std::uint64_t> vec_instructions;
+};
+
+// Minimal wrapper around the Linux perf_event_open() interface.
+// On other platforms, or if perf events are not available,
+// all the counts will be empty.
+// NOTE: there is no portable perf event for the number of
+// vector instructions, thus the counting of vector instructions
+// needs a raw (model-specific) event code, e.g., 0x1fc7 for
+// FP_ARITH_INST_RETIRED on recent Intel CPUs. If the code is zero,
+// vector instructions are not counted.
+class perf_events
+{
+    std::array<int, 4> m_fds{-1, -1, -1, -1};
+
+#if defined(__linux__)
+
+    static int open_event(std::uint32_t type, std::uint64_t config)
+    {
+        ::perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+
+        attr.type = type;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // NOTE: measure the calling thread on any CPU.
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+#endif
+
+    template <typename F>
+    void for_each_fd(const F &f) const
+    {
+        for (auto fd : m_fds) {
+            if (fd >= 0) {
+                f(fd);
+            }
+        }
+    }
+
+public:
+    explicit perf_events([[maybe_unused]] std::uint64_t raw_vec_event = 0)
+    {
+#if defined(__linux__)
+        m_fds[0] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        m_fds[1] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        m_fds[2] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        if (raw_vec_event != 0u) {
+            m_fds[3] = open_event(PERF_TYPE_RAW, raw_vec_event);
+        }
+#endif
+    }
+    perf_events(const perf_events &) = delete;
+    perf_events &operator=(const perf_events &) = delete;
+    ~perf_events()
+    {
+#if defined(__linux__)
+        for_each_fd([](int fd) { ::close(fd); });
+#endif
+    }
+
+    // Check if at least one event is available.
+    bool available() const
+    {
+        bool retval = false;
+        for_each_fd([&retval](int) { retval = true; });
+
+        return retval;
+    }
+
+    // Reset and start the counters.
+    void start()
+    {
+#if defined(__linux__)
+        for_each_fd([](int fd) {
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        });
+#endif
+    }
+    // Stop the counters.
+    void stop()
+    {
+#if defined(__linux__)
+        for_each_fd([](int fd) { ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); });
+#endif
+    }
+
+    // Read the counters.
+    hw_counts read() const
+    {
+        hw_counts retval;
+
+#if defined(__linux__)
+        auto read_fd = [](int fd) -> std::optional<std::uint64_t> {
+            if (fd < 0) {
+                return {};
+            }
+
+            std::uint64_t val = 0;
+            if (::read(fd, &val, sizeof(val)) != static_cast<::ssize_t>(sizeof(val))) {
+                return {};
+            }
+
+            return val;
+        };
+
+        retval.cycles = read_fd(m_fds[0]);
+        retval.instructions = read_fd(m_fds[1]);
+        retval.cache_misses = read_fd(m_fds[2]);
+        retval.vec_instructions = read_fd(m_fds[3]);
+#endif
+
+        return retval;
+    }
+};
+
+// Machine-readable report of a benchmark, written in JSON format.
+// The report is a flat JSON object containing the name of the
+// benchmark, the heyoka version and an arbitrary number
+// of user-defined entries.
+class bench_report
+{
+    // The JSON-encoded entries of the report.
+    std::vector<std::pair<std::string, std::string>> m_entries;
+
+    static std::string json_str(const std::string &s)
+    {
+        std::string retval = "\"";
+
+        for (auto c : s) {
+            switch (c) {
+                case '"':
+                    retval += "\\\"";
+                    break;
+                case '\\':
+                    retval += "\\\\";
+                    break;
+                case '\n':
+                    retval += "\\n";
+                    break;
+                case '\t':
+                    retval += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20u) {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                        retval += buf;
+                    } else {
+                        retval += c;
+                    }
+            }
+        }
+
+        retval += '"';
+
+        return retval;
+    }
+
+public:
+    explicit bench_report(const std::string &name)
+    {
+        add("name", name);
+        add("heyoka_version", std::string(HEYOKA_VERSION_STRING));
+    }
+
+    void add(const std::string &key, const std::string &value)
+    {
+        m_entries.emplace_back(key, json_str(value));
+    }
+    void add(const std::string &key, const char *value)
+    {
+        add(key, std::string(value));
+    }
+    void add(const std::string &key, bool value)
+    {
+        m_entries.emplace_back(key, value ? "true" : "false");
+    }
+    template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+    void add(const std::string &key, T value)
+    {
+        std::ostringstream oss;
+        oss.precision(17);
+        oss << value;
+
+        m_entries.emplace_back(key, oss.str());
+    }
+
+    // Add the hardware counters, both in absolute terms and
+    // normalised by the number of steps. The unavailable
+    // counters are recorded as null.
+    void add(const hw_counts &hc, std::uint64_t n_steps)
+    {
+        auto add_count = [&](const char *key, const std::optional<std::uint64_t> &c) {
+            if (c) {
+                add(key, *c);
+                if (n_steps != 0u) {
+                    add(std::string(key) + "_per_step", static_cast<double>(*c) / static_cast<double>(n_steps));
+                }
+            } else {
+                m_entries.emplace_back(key, "null");
+            }
+        };
+
+        add("n_steps", n_steps);
+        add_count("cycles", hc.cycles);
+        add_count("instructions", hc.instructions);
+        add_count("cache_misses", hc.cache_misses);
+        add_count("vec_instructions", hc.vec_instructions);
+    }
+
+    std::string to_json() const
+    {
+        std::string retval = "{\n";
+
+        for (decltype(m_entries.size()) i = 0; i < m_entries.size(); ++i) {
+            retval += "  " + json_str(m_entries[i].first) + ": " + m_entries[i].second;
+            retval += i + 1u == m_entries.size() ? "\n" : ",\n";
+        }
+
+        retval += "}\n";
+
+        return retval;
+    }
+
+    // Write the report to a file. If the file name
+    // is empty, the report is printed to screen.
+    void write(const std::string &filename) const
+    {
+        if (filename.empty()) {
+            std::cout << to_json();
+        } else {
+            std::ofstream of(filename, std::ios_base::out | std::ios_base::trunc);
+            if (!of) {
+                throw std::runtime_error("Cannot open the file '" + filename + "' for writing the benchmark report");
+            }
+
+            of << to_json();
+        }
+    }
+};
+
+// Parse a comma-separated list of values.
+template <typename T>
+std::vector<T> parse_list(const std::string &s, const char *opt_name)
+{
+    std::vector<T> retval;
+
+    std::istringstream iss(s);
+    std::string tok;
+    while (std::getline(iss, tok, ',')) {
+        std::istringstream tss(tok);
+        T val{};
+        if (!(tss >> val) || !tss.eof()) {
+            throw std::invalid_argument("Invalid value '" + tok + "' in the list passed to the '" + opt_name
+                                        + "' option");
+        }
+        retval.push_back(val);
+    }
+
+    if (retval.empty()) {
+        throw std::invalid_argument(std::string("An empty list was passed to the '") + opt_name + "' option");
+    }
+
+    return retval;
+}
+
+// Parse the values of a boolean axis ("0", "1" or "both").
+inline std::vector<bool> parse_bool_axis(const std::string &s, const char *opt_name)
+{
+    if (s == "0") {
+        return {false};
+    } else if (s == "1") {
+        return {true};
+    } else if (s == "both") {
+        return {false, true};
+    }
+
+    throw std::invalid_argument(std::string("The '") + opt_name + "' option must be one of '0', '1' or 'both'");
+}
+
+} // namespace heyoka_benchmark
+
+#endif
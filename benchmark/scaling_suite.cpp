@@ -0,0 +1,249 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Scaling suite for the adaptive integrators. For each combination of
+// batch size, number of bodies, compact mode, parallel mode, optimisation
+// level and fast math flag, an N-body integrator is constructed and stepped
+// for a fixed amount of time. The compilation time and the throughput
+// (in steps per second per batch element) are written in JSON format.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "perf_events.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+// Initial conditions for an N-body system in batch
+// mode: bodies in circular orbits around a central
+// mass, plus a small random perturbation.
+std::vector<double> make_ic(std::uint32_t n_bodies, std::uint32_t batch_size)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> pert(-1E-3, 1E-3);
+
+    std::vector<double> retval(static_cast<std::size_t>(n_bodies) * 6u * batch_size);
+
+    for (std::uint32_t i = 1; i < n_bodies; ++i) {
+        const auto r = static_cast<double>(i);
+        const auto v = 1 / std::sqrt(r);
+
+        for (std::uint32_t j = 0; j < batch_size; ++j) {
+            // x and vy.
+            retval[(i * 6u) * batch_size + j] = r + pert(rng);
+            retval[(i * 6u + 4u) * batch_size + j] = v + pert(rng);
+        }
+    }
+
+    return retval;
+}
+
+// Step the integrator ta for (at least) the requested
+// duration. Returns the number of steps and the elapsed time.
+template <typename Ta>
+std::pair<std::uint64_t, double> step_for(Ta &ta, double duration)
+{
+    std::uint64_t n_steps = 0;
+    double elapsed = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    while (elapsed < duration) {
+        for (auto i = 0; i < 100; ++i) {
+            ta.step();
+        }
+        n_steps += 100u;
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return std::pair{n_steps, elapsed};
+}
+
+// Run a single configuration of the suite, and
+// return its JSON report.
+std::string run_config(const std::vector<std::pair<expression, expression>> &sys, std::uint32_t n, std::uint32_t bs,
+                       bool cm, bool pm, std::uint32_t ol, bool fm, double duration)
+{
+    std::cerr << "N=" << n << ", batch size=" << bs << ", compact mode=" << cm << ", parallel mode=" << pm
+              << ", opt level=" << ol << ", fast math=" << fm << ": ";
+    std::cerr.flush();
+
+    // NOTE: clear the in-memory cache in order
+    // to measure the actual compilation time.
+    llvm_state::clear_memcache();
+
+    auto ic = make_ic(n, bs);
+
+    const auto c_start = std::chrono::steady_clock::now();
+
+    std::pair<std::uint64_t, double> res;
+    double compile_time = 0;
+
+    if (bs == 1u) {
+        taylor_adaptive<double> ta{sys,
+                                   std::move(ic),
+                                   kw::compact_mode = cm,
+                                   kw::parallel_mode = pm,
+                                   kw::opt_level = ol,
+                                   kw::fast_math = fm};
+        compile_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - c_start).count();
+
+        res = step_for(ta, duration);
+    } else {
+        taylor_adaptive_batch<double> ta{sys,
+                                         std::move(ic),
+                                         bs,
+                                         kw::compact_mode = cm,
+                                         kw::parallel_mode = pm,
+                                         kw::opt_level = ol,
+                                         kw::fast_math = fm};
+        compile_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - c_start).count();
+
+        res = step_for(ta, duration);
+    }
+
+    // NOTE: in batch mode, a step advances
+    // bs integrations at once.
+    const auto steps_per_s = static_cast<double>(res.first) * static_cast<double>(bs) / res.second;
+
+    std::cerr << "compile time=" << compile_time << "s, steps/s=" << steps_per_s << '\n';
+
+    bench_report rep("scaling");
+    rep.add("n_bodies", n);
+    rep.add("batch_size", bs);
+    rep.add("compact_mode", cm);
+    rep.add("parallel_mode", pm);
+    rep.add("opt_level", ol);
+    rep.add("fast_math", fm);
+    rep.add("compile_time", compile_time);
+    rep.add("steps_per_s", steps_per_s);
+
+    return rep.to_json();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string batch_sizes_str, n_bodies_str, opt_levels_str, compact_str, parallel_str, fast_math_str,
+        json_file;
+    double duration = 0;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "batch_sizes", po::value<std::string>(&batch_sizes_str)->default_value("1,2,4,8"),
+        "comma-separated list of batch sizes (1 means the scalar integrator)")(
+        "n_bodies", po::value<std::string>(&n_bodies_str)->default_value("2,4,8"),
+        "comma-separated list of the numbers of bodies")(
+        "opt_levels", po::value<std::string>(&opt_levels_str)->default_value("3"),
+        "comma-separated list of optimisation levels")(
+        "compact_mode", po::value<std::string>(&compact_str)->default_value("both"), "compact mode (0, 1 or both)")(
+        "parallel_mode", po::value<std::string>(&parallel_str)->default_value("0"),
+        "parallel mode (0, 1 or both), effective only in compact mode")(
+        "fast_math", po::value<std::string>(&fast_math_str)->default_value("0"), "fast math flag (0, 1 or both)")(
+        "duration", po::value<double>(&duration)->default_value(0.5),
+        "wall-clock time (in seconds) spent stepping each configuration")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, the report is printed to screen)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (!std::isfinite(duration) || duration <= 0) {
+        throw std::invalid_argument("The duration must be finite and positive");
+    }
+
+    const auto batch_sizes = parse_list<std::uint32_t>(batch_sizes_str, "batch_sizes");
+    const auto n_bodies = parse_list<std::uint32_t>(n_bodies_str, "n_bodies");
+    const auto opt_levels = parse_list<std::uint32_t>(opt_levels_str, "opt_levels");
+    const auto compact_modes = parse_bool_axis(compact_str, "compact_mode");
+    const auto parallel_modes = parse_bool_axis(parallel_str, "parallel_mode");
+    const auto fast_maths = parse_bool_axis(fast_math_str, "fast_math");
+
+    for (auto bs : batch_sizes) {
+        if (bs == 0u) {
+            throw std::invalid_argument("The batch size cannot be zero");
+        }
+    }
+    for (auto n : n_bodies) {
+        if (n < 2u) {
+            throw std::invalid_argument("The number of bodies must be at least 2");
+        }
+    }
+
+    std::string report = "[\n";
+    bool first = true;
+
+    for (auto n : n_bodies) {
+        // NOTE: small masses for the orbiting bodies, so
+        // that the orbits stay close to circular.
+        std::vector<double> masses(n, 1E-6);
+        masses[0] = 1;
+        const auto sys = make_nbody_sys(n, kw::masses = masses);
+
+        for (auto bs : batch_sizes) {
+            for (auto cm : compact_modes) {
+                for (auto pm : parallel_modes) {
+                    if (pm && !cm) {
+                        // NOTE: parallel mode is available only in compact mode.
+                        continue;
+                    }
+
+                    for (auto ol : opt_levels) {
+                        for (auto fm : fast_maths) {
+                            report += (first ? "" : ",\n") + run_config(sys, n, bs, cm, pm, ol, fm, duration);
+                            report.pop_back();
+                            first = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    report += "\n]\n";
+
+    if (json_file.empty()) {
+        std::cout << report;
+    } else {
+        std::ofstream of(json_file, std::ios_base::out | std::ios_base::trunc);
+        if (!of) {
+            throw std::runtime_error("Cannot open the file '" + json_file + "' for writing the benchmark report");
+        }
+        of << report;
+    }
+}
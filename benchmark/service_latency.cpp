@@ -0,0 +1,232 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// End-to-end latency benchmark for the service pattern, i.e., the
+// processing of a request consisting of the construction of an integrator
+// for a known model, a short propagation and the destruction of the integrator.
+// The latency of a request is measured in the following scenarios:
+//
+// - first: the first request processed by the process (a single measurement),
+// - cold: the in-memory cache is cleared before each request, so that
+//   the object code must be generated from scratch (or fetched from the
+//   on-disk cache, if enabled via the HEYOKA_CACHE_DIR environment variable),
+// - warm: the object code is fetched from the in-memory cache,
+// - copy: the integrator is copied from a template integrator constructed
+//   once before the measurements, and the initial conditions are reset.
+//
+// For each scenario, the p50 and p99 latencies are printed and optionally
+// written in JSON format.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "perf_events.hpp"
+
+using namespace heyoka;
+using namespace heyoka_benchmark;
+
+namespace
+{
+
+double elapsed_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Compute the p-th percentile (with p in [0, 1]) of the
+// sorted vector v via linear interpolation.
+double percentile(const std::vector<double> &v, double p)
+{
+    const auto pos = p * static_cast<double>(v.size() - 1u);
+    const auto lo = static_cast<std::size_t>(std::floor(pos));
+    const auto hi = std::min(lo + 1u, v.size() - 1u);
+
+    return v[lo] + (pos - static_cast<double>(lo)) * (v[hi] - v[lo]);
+}
+
+// The model: an N-body system with a central body
+// and n - 1 light bodies on circular orbits.
+std::vector<double> make_ic(std::uint32_t n)
+{
+    std::vector<double> ic(static_cast<std::size_t>(n) * 6u);
+    for (std::uint32_t i = 1; i < n; ++i) {
+        ic[i * 6u] = i;
+        ic[i * 6u + 4u] = 1 / std::sqrt(static_cast<double>(i));
+    }
+
+    return ic;
+}
+
+auto make_sys(std::uint32_t n)
+{
+    std::vector<double> masses(n, 1E-6);
+    masses[0] = 1;
+
+    return make_nbody_sys(n, kw::masses = masses);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::uint32_t n_bodies = 0, jit_pool_size = 0;
+    unsigned n_reps = 0;
+    double t_final = 0;
+    bool compact_mode = false;
+    std::string json_file;
+
+    po::options_description desc("Options");
+
+    desc.add_options()("help", "produce help message")(
+        "n_bodies", po::value<std::uint32_t>(&n_bodies)->default_value(4u), "number of bodies in the model")(
+        "reps", po::value<unsigned>(&n_reps)->default_value(100u), "number of requests per scenario")(
+        "t_final", po::value<double>(&t_final)->default_value(1.), "duration of the propagation")(
+        "compact_mode", po::value<bool>(&compact_mode)->default_value(false), "compact mode")(
+        "jit_pool", po::value<std::uint32_t>(&jit_pool_size)->default_value(0u),
+        "size of the pool of pre-initialised jit instances")(
+        "json", po::value<std::string>(&json_file)->default_value(""),
+        "file for the JSON report (if empty, only the table is printed)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if (n_bodies < 2u) {
+        throw std::invalid_argument("The number of bodies must be at least 2");
+    }
+
+    if (n_reps == 0u) {
+        throw std::invalid_argument("The number of requests must be at least 1");
+    }
+
+    if (!std::isfinite(t_final) || t_final < 0) {
+        throw std::invalid_argument("The duration of the propagation must be finite and non-negative");
+    }
+
+    llvm_state::set_jit_pool_size(jit_pool_size);
+
+    const auto ic = make_ic(n_bodies);
+
+    // A single request: construction, propagation and destruction.
+    auto request = [&]() {
+        const auto start = std::chrono::steady_clock::now();
+
+        {
+            taylor_adaptive<double> ta{make_sys(n_bodies), ic, kw::compact_mode = compact_mode};
+            ta.propagate_until(t_final);
+        }
+
+        return elapsed_since(start);
+    };
+
+    // The scenarios: name and request function.
+    std::vector<std::pair<std::string, std::function<double()>>> scenarios;
+
+    // NOTE: the first request is measured before
+    // anything else is done in the process.
+    const auto first_lat = request();
+
+    scenarios.emplace_back("cold", [&]() {
+        llvm_state::clear_memcache();
+
+        return request();
+    });
+    scenarios.emplace_back("warm", request);
+
+    // NOTE: the construction of the template
+    // integrator is not part of the measurements.
+    const taylor_adaptive<double> ta_tpl{make_sys(n_bodies), ic, kw::compact_mode = compact_mode};
+    scenarios.emplace_back("copy", [&]() {
+        const auto start = std::chrono::steady_clock::now();
+
+        {
+            auto ta = ta_tpl;
+            std::copy(ic.begin(), ic.end(), ta.get_state_data());
+            ta.set_time(0);
+            ta.propagate_until(t_final);
+        }
+
+        return elapsed_since(start);
+    });
+
+    std::cout << std::left << std::setw(8) << "scenario" << std::right << std::setw(8) << "reps" << std::setw(14)
+              << "p50[s]" << std::setw(14) << "p99[s]" << std::setw(14) << "max[s]" << '\n';
+
+    std::string report = "[\n";
+
+    auto add_result = [&](const std::string &name, std::vector<double> meas) {
+        std::sort(meas.begin(), meas.end());
+
+        const auto p50 = percentile(meas, .5), p99 = percentile(meas, .99);
+
+        std::cout << std::left << std::setw(8) << name << std::right << std::setw(8) << meas.size()
+                  << std::scientific << std::setprecision(4) << std::setw(14) << p50 << std::setw(14) << p99
+                  << std::setw(14) << meas.back() << std::endl;
+
+        bench_report rep("service_latency");
+        rep.add("scenario", name);
+        rep.add("n_bodies", n_bodies);
+        rep.add("compact_mode", compact_mode);
+        rep.add("jit_pool_size", jit_pool_size);
+        rep.add("t_final", t_final);
+        rep.add("reps", meas.size());
+        rep.add("min", meas.front());
+        rep.add("p50", p50);
+        rep.add("p99", p99);
+        rep.add("max", meas.back());
+
+        report += (report.size() == 2u ? "" : ",\n") + rep.to_json();
+        report.pop_back();
+    };
+
+    add_result("first", {first_lat});
+
+    for (const auto &[name, f] : scenarios) {
+        std::vector<double> meas;
+        for (auto i = 0u; i < n_reps; ++i) {
+            meas.push_back(f());
+        }
+
+        add_result(name, std::move(meas));
+    }
+
+    report += "\n]\n";
+
+    if (!json_file.empty()) {
+        std::ofstream of(json_file, std::ios_base::out | std::ios_base::trunc);
+        if (!of) {
+            throw std::runtime_error("Cannot open the file '" + json_file + "' for writing the benchmark report");
+        }
+        of << report;
+    }
+}
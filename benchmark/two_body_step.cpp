@@ -9,10 +9,12 @@
 #include <heyoka/config.hpp>
 
 #include <chrono>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -28,12 +30,14 @@
 #include <heyoka/taylor.hpp>
 
 #include "benchmark_utils.hpp"
+#include "perf_events.hpp"
 
 using namespace heyoka;
 using namespace heyoka_benchmark;
 
 template <typename T>
-void run_bench(T tol, bool high_accuracy, bool compact_mode, bool fast_math)
+void run_bench(T tol, bool high_accuracy, bool compact_mode, bool fast_math, const std::string &fp_type,
+               const std::string &json_file, std::uint64_t raw_vec_event)
 {
     warmup();
 
@@ -53,15 +57,32 @@ void run_bench(T tol, bool high_accuracy, bool compact_mode, bool fast_math)
 
     std::cout << "Construction time: " << elapsed << "ms\n";
 
+    bench_report rep("two_body_step");
+    rep.add("fp_type", fp_type);
+    rep.add("high_accuracy", high_accuracy);
+    rep.add("compact_mode", compact_mode);
+    rep.add("fast_math", fast_math);
+    rep.add("construction_time_ms", elapsed);
+
+    perf_events pe(raw_vec_event);
+
     start = std::chrono::high_resolution_clock::now();
+    pe.start();
 
-    tad.propagate_until(T(10000));
+    const auto n_steps = std::get<3>(tad.propagate_until(T(10000)));
 
+    pe.stop();
     elapsed = static_cast<double>(
         std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start)
             .count());
 
     std::cout << "Integration time: " << elapsed << "μs\n";
+
+    if (!json_file.empty()) {
+        rep.add("integration_time_us", elapsed);
+        rep.add(pe.read(), static_cast<std::uint64_t>(n_steps));
+        rep.write(json_file);
+    }
 }
 
 int main(int argc, char *argv[])
@@ -73,14 +94,19 @@ int main(int argc, char *argv[])
     double tol;
     bool compact_mode = false;
     bool fast_math = false;
+    std::string json_file;
+    std::uint64_t raw_vec_event = 0;
 
     po::options_description desc("Options");
 
     desc.add_options()("help", "produce help message")(
         "fp_type", po::value<std::string>(&fp_type)->default_value("double"), "floating-point type")(
         "tol", po::value<double>(&tol)->default_value(0.), "tolerance (if 0, it will be the type's epsilon)")(
-        "high_accuracy", "enable high-accuracy mode")("compact_mode", "enable compact mode")("fast_math",
-                                                                                             "enable fast math flags");
+        "high_accuracy", "enable high-accuracy mode")("compact_mode", "enable compact mode")(
+        "fast_math", "enable fast math flags")("json", po::value<std::string>(&json_file)->default_value(""),
+                                               "file for the JSON report (if empty, no report is written)")(
+        "raw_vec_event", po::value<std::uint64_t>(&raw_vec_event)->default_value(0),
+        "raw perf event code for counting vector instructions (if 0, vector instructions are not counted)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -104,12 +130,13 @@ int main(int argc, char *argv[])
     }
 
     if (fp_type == "double") {
-        run_bench<double>(tol, high_accuracy, compact_mode, fast_math);
+        run_bench<double>(tol, high_accuracy, compact_mode, fast_math, fp_type, json_file, raw_vec_event);
     } else if (fp_type == "long double") {
-        run_bench<long double>(tol, high_accuracy, compact_mode, fast_math);
+        run_bench<long double>(tol, high_accuracy, compact_mode, fast_math, fp_type, json_file, raw_vec_event);
 #if defined(HEYOKA_HAVE_REAL128)
     } else if (fp_type == "real128") {
-        run_bench<mppp::real128>(mppp::real128(tol), high_accuracy, compact_mode, fast_math);
+        run_bench<mppp::real128>(mppp::real128(tol), high_accuracy, compact_mode, fast_math, fp_type, json_file,
+                                 raw_vec_event);
 #endif
     } else {
         throw std::invalid_argument("Invalid floating-point type: '" + fp_type + "'");
@@ -0,0 +1,115 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_BATCH_ENV_HPP
+#define HEYOKA_BATCH_ENV_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// A vectorised environment (in the sense of reinforcement learning)
+// built on top of an adaptive integrator in batch mode. Each batch
+// element is an environment. The control inputs are runtime parameters
+// of the system, selected via their indices. Each invocation of step()
+// sets the control inputs of all the environments and advances them
+// by a fixed time interval dt. The observations (i.e., the state vectors
+// at the end of the interval) are stored in a contiguous buffer with shape
+// (dim, batch_size), as the state of the integrator.
+// An environment terminates if its propagation over the interval does not
+// end with taylor_outcome::time_limit (e.g., because of a stopping terminal
+// event or of a non-finite state). The terminated environments are reset
+// automatically at the end of step(): the state and the time are reset to the
+// values at the construction of the object, and then the optional reset callback
+// is invoked with the integrator and the index of the batch element (e.g., for
+// the randomisation of the initial conditions). The observations at the
+// termination are available via get_terminal_obs().
+template <typename T>
+class HEYOKA_DLL_PUBLIC batch_env
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+public:
+    using reset_cb_t = std::function<void(taylor_adaptive_batch<T> &, std::uint32_t)>;
+
+private:
+    taylor_adaptive_batch<T> m_ta;
+    T m_dt;
+    std::vector<std::uint32_t> m_ctrl_idx;
+    reset_cb_t m_reset_cb;
+    // The state vectors and the times used
+    // for the reset of the environments.
+    std::vector<T> m_init_state;
+    std::vector<T> m_init_time;
+    // The buffers for the outputs of step().
+    std::vector<T> m_obs;
+    std::vector<T> m_terminal_obs;
+    std::vector<int> m_done;
+    std::vector<taylor_outcome> m_outcomes;
+    // Temporary buffer for the time intervals.
+    std::vector<T> m_dts;
+
+    HEYOKA_DLL_LOCAL void reset_impl(std::uint32_t);
+
+public:
+    explicit batch_env(taylor_adaptive_batch<T>, T, std::vector<std::uint32_t>, reset_cb_t = {});
+
+    batch_env(const batch_env &);
+    batch_env(batch_env &&) noexcept;
+
+    batch_env &operator=(const batch_env &);
+    batch_env &operator=(batch_env &&) noexcept;
+
+    ~batch_env();
+
+    // Set the control inputs and advance all the environments by dt.
+    // The control inputs are read from a buffer with shape (n_ctrl, batch_size),
+    // where n_ctrl is the number of control parameters. The return value
+    // is the buffer of the observations.
+    const std::vector<T> &step(const std::vector<T> &);
+    const std::vector<T> &step(const T *);
+
+    // Reset all the environments, or a single environment.
+    const std::vector<T> &reset();
+    void reset(std::uint32_t);
+
+    const taylor_adaptive_batch<T> &get_ta() const;
+    taylor_adaptive_batch<T> &get_ta();
+    T get_dt() const;
+    const std::vector<std::uint32_t> &get_ctrl_idx() const;
+
+    const std::vector<T> &get_obs() const;
+    // The observations at the termination of the environments that
+    // terminated in the last invocation of step() (the values for
+    // the other environments are unspecified).
+    const std::vector<T> &get_terminal_obs() const;
+    // Flags signalling the environments that terminated
+    // (and that were reset) in the last invocation of step().
+    const std::vector<int> &get_done() const;
+    // The outcomes of the propagations in the last invocation of step().
+    const std::vector<taylor_outcome> &get_outcomes() const;
+};
+
+} // namespace heyoka
+
+#endif
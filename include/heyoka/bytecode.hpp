@@ -0,0 +1,81 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_BYTECODE_HPP
+#define HEYOKA_BYTECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+// A flattened (postfix) representation of an expression, for the evaluation
+// in double precision over batches of points via a stack-based interpreter.
+// This is meant as a middle ground between eval_batch_dbl() and a compiled
+// function (see cfunc), for expressions which need to be evaluated only a few
+// times (so that the cost of the JIT compilation does not pay off).
+// The variables are resolved once and for all to indices in the input array,
+// and the instructions are executed on blocks of points, so that
+// the inner loops of the interpreter can be vectorised by the compiler.
+// The input and output arrays have the same layout as in cfunc,
+// i.e., row-major with shapes (n_vars, n_points) and (1, n_points).
+class HEYOKA_DLL_PUBLIC bytecode
+{
+public:
+    enum class opcode : std::uint8_t { num, var, par, add, sub, mul, div, neg, square, sqrt, exp, log, sin, cos, func };
+
+    // An instruction of the bytecode. The meaning of idx depends on op:
+    // - num: index in the list of constants,
+    // - var: index of the input variable,
+    // - par: index of the runtime parameter,
+    // - func: index in the list of functions,
+    // - otherwise: unused.
+    struct instruction {
+        opcode op;
+        std::uint32_t idx;
+    };
+
+private:
+    std::vector<instruction> m_code;
+    std::vector<double> m_nums;
+    // NOTE: these are the functions for which there
+    // is no dedicated opcode. They are evaluated via
+    // eval_num_dbl(), one point at a time.
+    std::vector<func> m_funcs;
+    std::vector<std::string> m_vars;
+    std::uint32_t m_n_pars = 0;
+    // Maximum depth of the evaluation stack.
+    std::size_t m_stack_size = 0;
+
+public:
+    explicit bytecode(const expression &, std::vector<std::string> = {});
+
+    const std::vector<instruction> &get_code() const;
+    const std::vector<std::string> &get_vars() const;
+    std::uint32_t get_n_pars() const;
+    std::size_t get_stack_size() const;
+
+    void operator()(double *, const double *, std::size_t, const double * = nullptr) const;
+    std::vector<double> operator()(const std::vector<double> &, std::size_t, const std::vector<double> & = {}) const;
+
+    friend HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const bytecode &);
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const bytecode &);
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,243 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_CFUNC_HPP
+#define HEYOKA_CFUNC_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/llvm_state.hpp>
+
+namespace heyoka
+{
+
+// Add to the llvm_state a compiled function for the evaluation
+// of the expressions in the input vector. The signature of the function is
+//
+// void (T *out, const T *in, const T *pars, std::uint64_t stride)
+//
+// The function evaluates the expressions for batch_size points at once.
+// The value of the i-th input variable for the j-th point is read from in[i * stride + j],
+// and the value of the i-th expression for the j-th point is written to
+// out[i * stride + j]. The values of the runtime parameters are read from pars,
+// and they are shared by all points. The order of the input variables
+// is given by the last argument: if empty, the variables are deduced from the
+// expressions and sorted alphabetically. The list of input variables
+// is returned.
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_dbl(llvm_state &, const std::string &,
+                                                        const std::vector<expression> &, std::uint32_t,
+                                                        std::vector<expression> = {});
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_ldbl(llvm_state &, const std::string &,
+                                                         const std::vector<expression> &, std::uint32_t,
+                                                         std::vector<expression> = {});
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_f128(llvm_state &, const std::string &,
+                                                         const std::vector<expression> &, std::uint32_t,
+                                                         std::vector<expression> = {});
+
+#endif
+
+template <typename T>
+inline std::vector<expression> add_cfunc(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                         std::uint32_t batch_size, std::vector<expression> vars = {})
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return add_cfunc_dbl(s, name, fn, batch_size, std::move(vars));
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return add_cfunc_ldbl(s, name, fn, batch_size, std::move(vars));
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return add_cfunc_f128(s, name, fn, batch_size, std::move(vars));
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Add to the llvm_state a compiled function for the evaluation of the expression ex
+// and of its gradient with respect to the input variables and the runtime parameters.
+// The signature and the layout of the input/output arrays are the same as in add_cfunc().
+// The row 0 of the output array contains the value of ex, the next n_vars rows contain the
+// partial derivatives with respect to the input variables, and the last rows
+// contain the partial derivatives with respect to the runtime parameters
+// (starting from par[0] up to the largest parameter index appearing in ex).
+// The gradient is computed in a single sweep via reverse-mode automatic differentiation.
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_grad_dbl(llvm_state &, const std::string &, const expression &,
+                                                             std::uint32_t, std::vector<expression> = {});
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_grad_ldbl(llvm_state &, const std::string &, const expression &,
+                                                              std::uint32_t, std::vector<expression> = {});
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC std::vector<expression> add_cfunc_grad_f128(llvm_state &, const std::string &, const expression &,
+                                                              std::uint32_t, std::vector<expression> = {});
+
+#endif
+
+template <typename T>
+inline std::vector<expression> add_cfunc_grad(llvm_state &s, const std::string &name, const expression &ex,
+                                              std::uint32_t batch_size, std::vector<expression> vars = {})
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return add_cfunc_grad_dbl(s, name, ex, batch_size, std::move(vars));
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return add_cfunc_grad_ldbl(s, name, ex, batch_size, std::move(vars));
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return add_cfunc_grad_f128(s, name, ex, batch_size, std::move(vars));
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(vars);
+IGOR_MAKE_NAMED_ARGUMENT(batch_size);
+IGOR_MAKE_NAMED_ARGUMENT(gradient);
+
+} // namespace kw
+
+namespace detail
+{
+
+// Implementation of add_cfunc(). If optimise is false, the optimisation passes
+// are not run, so that several functions can be added to the same llvm_state
+// before a single optimisation round on the whole module.
+template <typename T>
+std::vector<expression> add_cfunc_impl(llvm_state &, const std::string &, const std::vector<expression> &,
+                                       std::uint32_t, std::vector<expression>, bool);
+
+// A compiled function for the evaluation of a vector of expressions
+// over arrays of points. The input and output arrays are stored in
+// row-major order, with shapes (n_vars, n_points) and (n_out, n_points)
+// respectively. The points are processed in batches via SIMD instructions,
+// and the batches are optionally distributed among multiple threads.
+// If the gradient option is active, a single expression must be provided,
+// and the output contains the value of the expression followed by its
+// gradient (see add_cfunc_grad()). Otherwise, n_out is the number of expressions.
+template <typename T>
+class HEYOKA_DLL_PUBLIC cfunc_impl
+{
+public:
+    using cfunc_t = void (*)(T *, const T *, const T *, std::uint64_t);
+
+private:
+    llvm_state m_llvm;
+    std::vector<expression> m_fn;
+    std::vector<expression> m_vars;
+    std::uint32_t m_batch_size = 0;
+    std::uint32_t m_n_pars = 0;
+    std::size_t m_n_out = 0;
+    bool m_gradient = false;
+    // Function pointers to the batch-mode
+    // and scalar compiled functions.
+    cfunc_t m_f_batch = nullptr;
+    cfunc_t m_f_scalar = nullptr;
+
+    void finalise_ctor_impl(std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+    template <typename... KwArgs>
+    void finalise_ctor(std::vector<expression> fn, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a compiled function contain "
+                          "unnamed arguments.");
+        } else {
+            // List of input variables (defaults to empty,
+            // meaning that the variables are deduced from fn).
+            auto vars = [&p]() -> std::vector<expression> {
+                if constexpr (p.has(kw::vars)) {
+                    return std::forward<decltype(p(kw::vars))>(p(kw::vars));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Batch size (defaults to zero, meaning that the batch
+            // size will be chosen depending on the host machine).
+            auto batch_size = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::batch_size)) {
+                    return std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+                } else {
+                    return 0;
+                }
+            }();
+
+            // Gradient computation (defaults to false).
+            auto gradient = [&p]() -> bool {
+                if constexpr (p.has(kw::gradient)) {
+                    return std::forward<decltype(p(kw::gradient))>(p(kw::gradient));
+                } else {
+                    return false;
+                }
+            }();
+
+            finalise_ctor_impl(std::move(fn), std::move(vars), batch_size, gradient);
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit cfunc_impl(std::vector<expression> fn, KwArgs &&...kw_args) : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor(std::move(fn), std::forward<KwArgs>(kw_args)...);
+    }
+
+    cfunc_impl(const cfunc_impl &);
+    cfunc_impl(cfunc_impl &&) noexcept;
+
+    cfunc_impl &operator=(const cfunc_impl &);
+    cfunc_impl &operator=(cfunc_impl &&) noexcept;
+
+    ~cfunc_impl();
+
+    const llvm_state &get_llvm_state() const;
+    const std::vector<expression> &get_fn() const;
+    const std::vector<expression> &get_vars() const;
+    std::uint32_t get_batch_size() const;
+    std::uint32_t get_n_pars() const;
+    std::size_t get_n_out() const;
+    bool get_gradient() const;
+
+    void operator()(T *, const T *, std::size_t, const T *, unsigned = 1) const;
+    std::vector<T> operator()(const std::vector<T> &, std::size_t, const std::vector<T> & = {}, unsigned = 1) const;
+};
+
+} // namespace detail
+
+template <typename T>
+using cfunc = detail::cfunc_impl<T>;
+
+} // namespace heyoka
+
+#endif
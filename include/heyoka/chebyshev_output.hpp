@@ -0,0 +1,167 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_CHEBYSHEV_OUTPUT_HPP
+#define HEYOKA_CHEBYSHEV_OUTPUT_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(cheb_degree);
+
+}
+
+// Compressed representation of the trajectory recorded in a continuous output.
+// The time range covered by the continuous output is split into segments, over which
+// the state of the system is approximated by Chebyshev expansions of fixed degree.
+// The segments are chosen adaptively so that, within each segment, the approximation error
+// is not greater than tol * max(1, |x|_inf), where x is the state of the system. Because
+// a Chebyshev segment typically spans many integration steps, the storage is much smaller
+// than the Taylor coefficients of the continuous output, and the evaluation consists of a
+// binary search over the segments followed by a Clenshaw sum of fixed size.
+// The coefficients of each segment are stored with shape (degree + 1, dim) in row-major format,
+// so that the Clenshaw recurrence runs over contiguous blocks of dim values.
+// The following optional kwargs can be passed to the constructor:
+// - 'tol', the tolerance of the approximation (defaults to 100 times the machine epsilon),
+// - 'cheb_degree', the degree of the Chebyshev expansions (defaults to 16).
+template <typename T>
+class HEYOKA_DLL_PUBLIC chebyshev_output
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_degree = 0;
+    // The boundaries of the segments (in ascending order).
+    std::vector<T> m_seg_bounds;
+    // The Chebyshev coefficients of the segments.
+    std::vector<T> m_coeffs;
+    // The output vector.
+    std::vector<T> m_output;
+    // Temporary buffer for the Clenshaw recurrence.
+    std::vector<T> m_tmp;
+
+    void finalise_ctor_impl(continuous_output<T> &, T, std::uint32_t);
+    template <typename... KwArgs>
+    void finalise_ctor(continuous_output<T> &co, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a Chebyshev output contain "
+                          "unnamed arguments.");
+        } else {
+            // Tolerance (defaults to 100 * eps).
+            auto tol = [&p]() -> T {
+                if constexpr (p.has(kw::tol)) {
+                    return std::forward<decltype(p(kw::tol))>(p(kw::tol));
+                } else {
+                    return std::numeric_limits<T>::epsilon() * 100;
+                }
+            }();
+
+            // Degree of the expansions (defaults to 16).
+            auto degree = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::cheb_degree)) {
+                    return std::forward<decltype(p(kw::cheb_degree))>(p(kw::cheb_degree));
+                } else {
+                    return 16;
+                }
+            }();
+
+            finalise_ctor_impl(co, tol, degree);
+        }
+    }
+
+    HEYOKA_DLL_LOCAL std::size_t find_segment(const T &) const;
+    HEYOKA_DLL_LOCAL void eval_impl(T *, const T &, T *) const;
+
+public:
+    chebyshev_output();
+
+    // NOTE: the continuous output is non-const because
+    // its output buffer is used to sample the trajectory.
+    template <typename... KwArgs>
+    explicit chebyshev_output(continuous_output<T> &co, KwArgs &&...kw_args)
+    {
+        finalise_ctor(co, std::forward<KwArgs>(kw_args)...);
+    }
+
+    chebyshev_output(const chebyshev_output &);
+    chebyshev_output(chebyshev_output &&) noexcept;
+
+    chebyshev_output &operator=(const chebyshev_output &);
+    chebyshev_output &operator=(chebyshev_output &&) noexcept;
+
+    ~chebyshev_output();
+
+    std::uint32_t get_dim() const;
+    std::uint32_t get_degree() const;
+    std::size_t get_n_segments() const;
+
+    const std::vector<T> &get_seg_bounds() const
+    {
+        return m_seg_bounds;
+    }
+    const std::vector<T> &get_coeffs() const
+    {
+        return m_coeffs;
+    }
+
+    // The time range covered by the segments.
+    std::pair<T, T> get_bounds() const;
+
+    // Compute the state of the system at the input time. For times
+    // outside the bounds, the expansions of the first/last
+    // segment are used.
+    const std::vector<T> &operator()(T);
+    const std::vector<T> &get_output() const
+    {
+        return m_output;
+    }
+
+    // Compute the state of the system at multiple times. The return
+    // value contains the state vectors in row-major format.
+    std::vector<T> eval_grid(const std::vector<T> &) const;
+
+    // Save/load the segments into/from a binary file. The file
+    // consists of a fixed-size header (containing the floating-point format, the
+    // dimension of the system, the degree and the number of segments) followed by the
+    // boundaries of the segments and by the Chebyshev coefficients. The data is stored
+    // in the native byte order, thus the files can be shared only among
+    // machines with the same byte order.
+    void save(const std::string &) const;
+    static chebyshev_output load(const std::string &);
+};
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,111 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_COLLISION_HPP
+#define HEYOKA_COLLISION_HPP
+
+#include <heyoka/config.hpp>
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/aligned_buffer.hpp>
+#include <heyoka/detail/ed_data.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Detection of the collisions between spherical bodies
+// during the last step of an adaptive integrator.
+// The collision detection runs in two phases:
+// - in the broad phase, the motion of each body over the
+//   timestep is bounded by an axis-aligned bounding box (AABB),
+//   computed from the Taylor coefficients of the positions,
+//   and the pairs of bodies whose AABBs overlap are found
+//   via sweep-and-prune;
+// - in the narrow phase, the polynomial root isolation
+//   of the event detection machinery is run on the squared
+//   distance of the candidate pairs.
+// This avoids the quadratic number of terminal events
+// (and the quadratic growth of the Taylor decomposition)
+// resulting from modelling collisions as events.
+// NOTE: detect() must be invoked after a step()
+// with write_tc = true.
+template <typename T>
+class HEYOKA_DLL_PUBLIC collision_detector
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+public:
+    // A detected collision: the indices of the two bodies
+    // (in increasing order) and the time of the collision
+    // relative to the beginning of the timestep.
+    using collision_t = std::tuple<std::uint32_t, std::uint32_t, T>;
+
+private:
+    // The indices of the Cartesian coordinates
+    // of the bodies in the state vector.
+    std::vector<std::array<std::uint32_t, 3>> m_pos_idx;
+    std::vector<T> m_radii;
+    // The AABBs of the bodies (lower and upper
+    // bounds for each coordinate).
+    std::vector<std::array<T, 6>> m_aabb;
+    // The indices of the bodies sorted by the
+    // lower bound of their AABB along the x axis.
+    std::vector<std::uint32_t> m_sorted;
+    // The list of the active bodies in the sweep.
+    std::vector<std::uint32_t> m_active;
+    // The candidate pairs found in the broad phase.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_cand;
+    // The data for the narrow phase: the (dummy) events corresponding
+    // to the candidate pairs, the Taylor polynomials of their
+    // squared distances and the event detection data.
+    std::vector<nt_event<T>> m_evs;
+    detail::aligned_vector<T> m_ev_jet;
+    std::vector<std::tuple<std::uint32_t, T, bool, int>> m_d_tes;
+    std::vector<std::tuple<std::uint32_t, T, int>> m_d_ntes;
+    detail::ed_data<T> m_ed;
+    // The detected collisions.
+    std::vector<collision_t> m_coll;
+
+public:
+    explicit collision_detector(std::vector<std::array<std::uint32_t, 3>>, std::vector<T>);
+
+    collision_detector(const collision_detector &);
+    collision_detector(collision_detector &&) noexcept;
+
+    collision_detector &operator=(const collision_detector &);
+    collision_detector &operator=(collision_detector &&) noexcept;
+
+    ~collision_detector();
+
+    const std::vector<std::array<std::uint32_t, 3>> &get_pos_idx() const;
+    const std::vector<T> &get_radii() const;
+
+    const std::vector<collision_t> &detect(const taylor_adaptive<T> &);
+
+    // Number of candidate pairs found in the broad
+    // phase of the last invocation of detect().
+    std::uint32_t get_n_candidates() const;
+};
+
+} // namespace heyoka
+
+#endif
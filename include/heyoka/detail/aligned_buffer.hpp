@@ -0,0 +1,76 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_ALIGNED_BUFFER_HPP
+#define HEYOKA_DETAIL_ALIGNED_BUFFER_HPP
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka::detail
+{
+
+// The alignment of the buffers used in the integrators (a cache line,
+// which is also the size of an AVX-512 register).
+inline constexpr std::size_t buffer_alignment = 64;
+
+// Allocation/deallocation of aligned buffers. The size is in bytes.
+// NOTE: large buffers are aligned to the size of a huge page and,
+// where supported, they are marked as eligible for the backing
+// by transparent huge pages.
+HEYOKA_DLL_PUBLIC void *aligned_buffer_alloc(std::size_t);
+HEYOKA_DLL_PUBLIC void aligned_buffer_free(void *, std::size_t) noexcept;
+
+// Minimal allocator for the aligned buffers.
+template <typename T>
+struct aligned_allocator {
+    using value_type = T;
+
+    aligned_allocator() = default;
+    template <typename U>
+    constexpr aligned_allocator(const aligned_allocator<U> &) noexcept
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length(); // LCOV_EXCL_LINE
+        }
+
+        return static_cast<T *>(aligned_buffer_alloc(n * sizeof(T)));
+    }
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        aligned_buffer_free(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const aligned_allocator<T> &, const aligned_allocator<U> &) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const aligned_allocator<T> &, const aligned_allocator<U> &) noexcept
+{
+    return false;
+}
+
+// Vector whose storage is aligned to buffer_alignment bytes.
+template <typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+} // namespace heyoka::detail
+
+#endif
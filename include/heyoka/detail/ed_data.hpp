@@ -0,0 +1,87 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_ED_DATA_HPP
+#define HEYOKA_DETAIL_ED_DATA_HPP
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace heyoka::detail
+{
+
+// The scratch memory used in event detection.
+// NOTE: each integrator owns an instance, which is set up
+// by the first invocation of the event detection functions (and
+// again whenever the order changes). The polynomials used in the
+// root isolation algorithm are taken from a preallocated arena,
+// so that in steady state event detection performs no
+// heap allocations and it does not depend on thread-local state.
+// NOTE: the integrators do not copy nor serialise
+// the scratch memory, which is set up again on first use.
+template <typename T>
+struct ed_data {
+    // The types of the JIT-compiled functions used in
+    // the root isolation algorithm (polynomial translation by 1
+    // and reverse + translate + sign changes count).
+    using pt_t = void (*)(T *, const T *);
+    using rtscc_t = void (*)(T *, T *, std::uint32_t *, const T *);
+
+    // The order of the polynomials. Zero
+    // if the data has not been set up yet.
+    std::uint32_t order = 0;
+    // The arena of polynomials, each with order + 1 coefficients,
+    // and the stack of the indices of the free polynomials.
+    std::vector<T> polys;
+    std::vector<std::uint32_t> free_polys;
+    // The working list and the list of isolating
+    // intervals of the root isolation algorithm. The
+    // polynomials in the working list are indices into the arena.
+    std::vector<std::tuple<T, T, std::uint32_t>> wlist;
+    std::vector<std::tuple<T, T>> isol;
+    // The buffers used in the pre-screening phase:
+    // - the event polynomials of a single batch element
+    //   (used only in the batch implementation),
+    // - the rescaled event polynomials in SIMD layout,
+    // - two temporary polynomials used by the rtscc function,
+    // - the number of sign changes for each SIMD lane,
+    // - the flags signalling which events were ruled out by the
+    //   pre-screening.
+    std::vector<T> lane_poly, r_poly, t_poly1, t_poly2;
+    std::vector<std::uint32_t> n_sc;
+    std::vector<char> skip;
+    // The JIT-compiled functions for the root isolation
+    // algorithm and the batch-mode rtscc function
+    // for the pre-screening (if available).
+    pt_t pt = nullptr;
+    rtscc_t rtscc = nullptr;
+    rtscc_t ps_rtscc = nullptr;
+    // The JIT-compiled functions for the root isolation
+    // algorithm for the events with a reduced detection order.
+    // NOTE: these do not depend on the order of the integrator,
+    // and thus they are kept when ed is set up again.
+    std::vector<std::tuple<std::uint32_t, pt_t, rtscc_t>> r_fns;
+    // The counters for the polynomials fetched
+    // from the arena, and for the growths of the arena.
+    std::uint64_t n_hits = 0;
+    std::uint64_t n_misses = 0;
+    // The flag signalling whether the root isolation phase
+    // can be run in parallel, and the data for the parallel
+    // implementation: the events are split in blocks, each of which
+    // has its own scratch memory, skip flags and detected events.
+    bool parallel = false;
+    std::vector<ed_data> blocks;
+    std::vector<std::vector<char>> b_skip;
+    std::vector<std::vector<std::tuple<std::uint32_t, T, bool, int>>> b_d_tes;
+    std::vector<std::vector<std::tuple<std::uint32_t, T, int>>> b_d_ntes;
+};
+
+} // namespace heyoka::detail
+
+#endif
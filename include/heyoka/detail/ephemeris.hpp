@@ -0,0 +1,35 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_EPHEMERIS_HPP
+#define HEYOKA_DETAIL_EPHEMERIS_HPP
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka::detail
+{
+
+// Write an ephemeris file (see continuous_output_impl::save_ephemeris()) to path.
+// The arrays of the initial times (hi and lo parts) and of the sizes of the steps
+// must contain n_steps values each, while the Taylor coefficients of the steps
+// are written by write_tcs() into the stream passed as argument (dim * (order + 1)
+// values per step, in the order of the steps). The data is first written
+// into a temporary file which is then renamed to path.
+template <typename T>
+HEYOKA_DLL_PUBLIC void write_ephemeris_file(const std::string &, std::uint32_t, std::uint32_t, std::uint64_t,
+                                            const T *, const T *, const T *,
+                                            const std::function<void(std::ostream &)> &);
+
+} // namespace heyoka::detail
+
+#endif
@@ -23,12 +23,33 @@
 
 #endif
 
+#include <heyoka/detail/aligned_buffer.hpp>
+#include <heyoka/detail/ed_data.hpp>
 #include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
 
 namespace heyoka::detail
 {
 
+// Counters for the event polynomials pruned
+// in the pre-screening phase of event detection.
+// NOTE: the counters are global (i.e., they are
+// shared by all threads and integrators).
+struct ed_prune_stats {
+    // Total number of event polynomials examined.
+    std::uint64_t n_tot = 0;
+    // Number of event polynomials pruned via
+    // the bound on the polynomial's range.
+    std::uint64_t n_bound = 0;
+    // Number of event polynomials pruned via
+    // the sign change count on the whole timestep.
+    std::uint64_t n_sc = 0;
+};
+
+HEYOKA_DLL_PUBLIC ed_prune_stats get_ed_prune_stats();
+HEYOKA_DLL_PUBLIC void reset_ed_prune_stats();
+
 template <typename T>
 inline T taylor_deduce_cooldown(T)
 {
@@ -51,9 +72,9 @@ mppp::real128 taylor_deduce_cooldown(mppp::real128);
 template <typename T>
 void taylor_detect_events(std::vector<std::tuple<std::uint32_t, T, bool, int>> &,
                           std::vector<std::tuple<std::uint32_t, T, int>> &,
-                          const std::vector<detail::t_event_impl<T>> &, const std::vector<detail::nt_event_impl<T>> &,
-                          const std::vector<std::optional<std::pair<T, T>>> &, T, const std::vector<T> &, std::uint32_t,
-                          std::uint32_t)
+                          const std::vector<t_event_impl<T, false>> &, const std::vector<nt_event_impl<T, false>> &,
+                          const std::vector<std::optional<std::pair<T, T>>> &, T, const aligned_vector<T> &,
+                          std::uint32_t, std::uint32_t, ed_data<T> &)
 {
     static_assert(always_false_v<T>, "Unhandled type");
 }
@@ -61,28 +82,71 @@ void taylor_detect_events(std::vector<std::tuple<std::uint32_t, T, bool, int>> &
 template <>
 void taylor_detect_events(std::vector<std::tuple<std::uint32_t, double, bool, int>> &,
                           std::vector<std::tuple<std::uint32_t, double, int>> &,
-                          const std::vector<detail::t_event_impl<double>> &,
-                          const std::vector<detail::nt_event_impl<double>> &,
+                          const std::vector<t_event_impl<double, false>> &,
+                          const std::vector<nt_event_impl<double, false>> &,
                           const std::vector<std::optional<std::pair<double, double>>> &, double,
-                          const std::vector<double> &, std::uint32_t, std::uint32_t);
+                          const aligned_vector<double> &, std::uint32_t, std::uint32_t, ed_data<double> &);
 
 template <>
 void taylor_detect_events(std::vector<std::tuple<std::uint32_t, long double, bool, int>> &,
                           std::vector<std::tuple<std::uint32_t, long double, int>> &,
-                          const std::vector<detail::t_event_impl<long double>> &,
-                          const std::vector<detail::nt_event_impl<long double>> &,
+                          const std::vector<t_event_impl<long double, false>> &,
+                          const std::vector<nt_event_impl<long double, false>> &,
                           const std::vector<std::optional<std::pair<long double, long double>>> &, long double,
-                          const std::vector<long double> &, std::uint32_t, std::uint32_t);
+                          const aligned_vector<long double> &, std::uint32_t, std::uint32_t, ed_data<long double> &);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template <>
 void taylor_detect_events(std::vector<std::tuple<std::uint32_t, mppp::real128, bool, int>> &,
                           std::vector<std::tuple<std::uint32_t, mppp::real128, int>> &,
-                          const std::vector<detail::t_event_impl<mppp::real128>> &,
-                          const std::vector<detail::nt_event_impl<mppp::real128>> &,
+                          const std::vector<t_event_impl<mppp::real128, false>> &,
+                          const std::vector<nt_event_impl<mppp::real128, false>> &,
                           const std::vector<std::optional<std::pair<mppp::real128, mppp::real128>>> &, mppp::real128,
-                          const std::vector<mppp::real128> &, std::uint32_t, std::uint32_t);
+                          const aligned_vector<mppp::real128> &, std::uint32_t, std::uint32_t,
+                          ed_data<mppp::real128> &);
+
+#endif
+
+template <typename T>
+void taylor_detect_events_batch(std::vector<std::vector<std::tuple<std::uint32_t, T, bool, int>>> &,
+                                std::vector<std::vector<std::tuple<std::uint32_t, T, int>>> &,
+                                const std::vector<t_event_impl<T, true>> &, const std::vector<nt_event_impl<T, true>> &,
+                                const std::vector<std::vector<std::optional<std::pair<T, T>>>> &,
+                                const std::vector<T> &, const aligned_vector<T> &, std::uint32_t, std::uint32_t,
+                                std::uint32_t, ed_data<T> &)
+{
+    static_assert(always_false_v<T>, "Unhandled type");
+}
+
+template <>
+void taylor_detect_events_batch(std::vector<std::vector<std::tuple<std::uint32_t, double, bool, int>>> &,
+                                std::vector<std::vector<std::tuple<std::uint32_t, double, int>>> &,
+                                const std::vector<t_event_impl<double, true>> &,
+                                const std::vector<nt_event_impl<double, true>> &,
+                                const std::vector<std::vector<std::optional<std::pair<double, double>>>> &,
+                                const std::vector<double> &, const aligned_vector<double> &, std::uint32_t,
+                                std::uint32_t, std::uint32_t, ed_data<double> &);
+
+template <>
+void taylor_detect_events_batch(std::vector<std::vector<std::tuple<std::uint32_t, long double, bool, int>>> &,
+                                std::vector<std::vector<std::tuple<std::uint32_t, long double, int>>> &,
+                                const std::vector<t_event_impl<long double, true>> &,
+                                const std::vector<nt_event_impl<long double, true>> &,
+                                const std::vector<std::vector<std::optional<std::pair<long double, long double>>>> &,
+                                const std::vector<long double> &, const aligned_vector<long double> &, std::uint32_t,
+                                std::uint32_t, std::uint32_t, ed_data<long double> &);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template <>
+void taylor_detect_events_batch(
+    std::vector<std::vector<std::tuple<std::uint32_t, mppp::real128, bool, int>>> &,
+    std::vector<std::vector<std::tuple<std::uint32_t, mppp::real128, int>>> &,
+    const std::vector<t_event_impl<mppp::real128, true>> &, const std::vector<nt_event_impl<mppp::real128, true>> &,
+    const std::vector<std::vector<std::optional<std::pair<mppp::real128, mppp::real128>>>> &,
+    const std::vector<mppp::real128> &, const aligned_vector<mppp::real128> &, std::uint32_t, std::uint32_t,
+    std::uint32_t, ed_data<mppp::real128> &);
 
 #endif
 
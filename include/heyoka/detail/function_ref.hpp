@@ -0,0 +1,92 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_FUNCTION_REF_HPP
+#define HEYOKA_DETAIL_FUNCTION_REF_HPP
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <heyoka/detail/type_traits.hpp>
+
+namespace heyoka::detail
+{
+
+template <typename>
+class function_ref;
+
+// Minimal non-owning reference to a callable, in the spirit
+// of the function_ref proposal (P0792). Unlike std::function,
+// it never allocates and it does not copy the referenced callable,
+// which must thus outlive the function_ref. A function_ref can
+// be empty, either if default-constructed or if constructed
+// from an empty callable (e.g., an empty std::function or a null
+// function pointer).
+template <typename R, typename... Args>
+class function_ref<R(Args...)>
+{
+    // NOTE: callables are referenced via a pointer to the object,
+    // functions via a function pointer (which cannot be portably
+    // converted to void *), hence the union.
+    union storage_t {
+        void *obj;
+        void (*fptr)();
+    };
+
+    storage_t m_storage{nullptr};
+    R (*m_invoker)(storage_t, Args...) = nullptr;
+
+public:
+    function_ref() noexcept = default;
+    template <typename F, std::enable_if_t<std::conjunction_v<std::negation<std::is_same<function_ref, uncvref_t<F>>>,
+                                                              std::is_invocable_r<R, F &, Args...>>,
+                                           int> = 0>
+    // NOLINTNEXTLINE(google-explicit-constructor, hicpp-explicit-conversions)
+    function_ref(F &&f) noexcept
+    {
+        using f_t = std::remove_reference_t<F>;
+
+        if constexpr (std::is_function_v<f_t>) {
+            m_storage.fptr = reinterpret_cast<void (*)()>(&f);
+            m_invoker = [](storage_t st, Args... args) -> R {
+                return reinterpret_cast<f_t *>(st.fptr)(std::forward<Args>(args)...);
+            };
+        } else {
+            if constexpr (std::is_constructible_v<bool, const f_t &>) {
+                // NOTE: empty std::functions and null function
+                // pointers result in an empty function_ref.
+                if (!static_cast<bool>(f)) {
+                    return;
+                }
+            }
+
+            // NOTE: the const_cast is needed in order to store
+            // pointers to const callables. The constness is restored
+            // in the invoker.
+            m_storage.obj = const_cast<void *>(static_cast<const volatile void *>(std::addressof(f)));
+            m_invoker = [](storage_t st, Args... args) -> R {
+                return (*static_cast<f_t *>(st.obj))(std::forward<Args>(args)...);
+            };
+        }
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_invoker != nullptr;
+    }
+
+    R operator()(Args... args) const
+    {
+        return m_invoker(m_storage, std::forward<Args>(args)...);
+    }
+};
+
+} // namespace heyoka::detail
+
+#endif
@@ -18,6 +18,7 @@ class Module;
 class LLVMContext;
 class Type;
 class ArrayType;
+class MemoryBuffer;
 
 // NOTE: IRBuilder is a template with default
 // parameters, hence we declare the default parameters
@@ -25,6 +25,35 @@ namespace heyoka::detail
 
 spdlog::logger *get_logger();
 
+// Aggregation of the warnings emitted in hot paths (e.g., once per
+// integration step). While a warn_aggregation_scope is alive in the current
+// thread, only the first occurrence of each hot-path warning (identified by
+// its format string) is logged, and the further occurrences are just
+// counted. When the outermost scope exits, the counts are logged
+// and reset. Outside the scopes, hot-path warnings are logged
+// as usual.
+bool hot_warn_first(const char *) noexcept;
+
+class warn_aggregation_scope
+{
+public:
+    warn_aggregation_scope() noexcept;
+    warn_aggregation_scope(const warn_aggregation_scope &) = delete;
+    warn_aggregation_scope(warn_aggregation_scope &&) = delete;
+    warn_aggregation_scope &operator=(const warn_aggregation_scope &) = delete;
+    warn_aggregation_scope &operator=(warn_aggregation_scope &&) = delete;
+    ~warn_aggregation_scope();
+};
+
+// NOTE: fmt_str must be a string literal.
+template <typename... Args>
+void hot_warn(const char *fmt_str, const Args &...args)
+{
+    if (hot_warn_first(fmt_str)) {
+        get_logger()->warn(fmt_str, args...);
+    }
+}
+
 } // namespace heyoka::detail
 
 #endif
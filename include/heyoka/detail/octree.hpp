@@ -0,0 +1,59 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_OCTREE_HPP
+#define HEYOKA_DETAIL_OCTREE_HPP
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace heyoka::detail
+{
+
+// A node of an octree.
+struct octree_node {
+    // Edge length of the cell.
+    double size = 0;
+    // Total mass and centre of mass
+    // of the points in the cell.
+    double mass = 0;
+    std::array<double, 3> com{};
+    // The points in the cell are perm[begin], ..., perm[end - 1],
+    // where perm is the permutation of the point indices
+    // stored in the octree.
+    std::size_t begin = 0, end = 0;
+    // Indices of the children in the
+    // vector of nodes (empty for leaves).
+    std::vector<std::size_t> children;
+};
+
+// A simple octree for the hierarchical clustering of a set of
+// massive points, used in the Barnes-Hut approximations
+// of the N-body and mascon systems.
+// NOTE: the masses must be positive and finite.
+struct octree {
+    // The nodes of the tree. The root is
+    // the first node.
+    std::vector<octree_node> nodes;
+    // The permutation of the point indices
+    // induced by the tree.
+    std::vector<std::size_t> perm;
+};
+
+octree build_octree(const std::vector<std::array<double, 3>> &, const std::vector<double> &);
+
+// Depth-first visit of an octree: vis is invoked on each
+// visited node, and the children of the node are visited
+// only if vis returns true.
+void octree_walk(const octree &, const std::function<bool(const octree_node &)> &);
+
+} // namespace heyoka::detail
+
+#endif
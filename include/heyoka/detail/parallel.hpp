@@ -0,0 +1,50 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_PARALLEL_HPP
+#define HEYOKA_DETAIL_PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka::detail
+{
+
+// Number of worker threads that will be used by parallel_for()
+// to process n work items, if n_threads threads are requested.
+// A value of zero for n_threads means to use the value
+// returned by get_num_threads().
+HEYOKA_DLL_PUBLIC unsigned parallel_n_workers(std::size_t, unsigned);
+
+// Invoke f(b, e, idx) on the chunks [b, e) of the range [0, n). The chunks
+// are handed out dynamically to the worker threads, so that threads finishing
+// early pick up the remaining work. idx is the index of the worker thread
+// (in the [0, parallel_n_workers(n, n_threads)) range), and it can be used to
+// access per-thread data. If f throws, the remaining chunks are skipped and
+// the first exception is re-thrown in the calling thread.
+// If pin is true, each worker thread is pinned to a distinct CPU (among the
+// CPUs the calling thread can run on) before processing any chunk, so that the
+// memory first touched by a worker stays local to its NUMA node. The affinity
+// of the calling thread is restored on exit. Pinning is currently implemented
+// only on Linux, and it is silently skipped on failure.
+HEYOKA_DLL_PUBLIC void parallel_for(std::size_t, unsigned,
+                                    const std::function<void(std::size_t, std::size_t, unsigned)> &, bool = false);
+
+// Invoke f(b, e) on the chunks [b, e) of the range [0, n), using a pool of
+// persistent worker threads (together with the calling thread). This is meant
+// for fine-grained parallelism, where the overhead of thread creation in parallel_for()
+// would be excessive. f must not throw. If the pool is already busy (e.g., in
+// case of nested or concurrent invocations), the whole range is processed
+// serially in the calling thread.
+HEYOKA_DLL_PUBLIC void pool_parallel_for(std::size_t, const std::function<void(std::size_t, std::size_t)> &) noexcept;
+
+} // namespace heyoka::detail
+
+#endif
@@ -0,0 +1,128 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_S11N_HPP
+#define HEYOKA_DETAIL_S11N_HPP
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/visibility.hpp>
+
+// NOTE: the binary serialisation format implemented here
+// is a plain dump of the native memory representation of the
+// objects. It is meant to be used for checkpointing and for
+// moving objects between identical machines, thus it is not
+// portable across architectures (the compiled code stored in
+// the serialised llvm_state objects isn't either).
+
+namespace heyoka::detail
+{
+
+// Helpers to check the state of a stream
+// after a binary read/write operation.
+HEYOKA_DLL_PUBLIC void s11n_check_read(const std::istream &);
+HEYOKA_DLL_PUBLIC void s11n_check_write(const std::ostream &);
+
+// Save/load trivially copyable objects.
+template <typename T>
+inline void s11n_save(std::ostream &os, const T &x)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be serialised.");
+
+    os.write(reinterpret_cast<const char *>(&x), static_cast<std::streamsize>(sizeof(T)));
+    s11n_check_write(os);
+}
+
+template <typename T>
+inline void s11n_load(std::istream &is, T &x)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be deserialised.");
+
+    is.read(reinterpret_cast<char *>(&x), static_cast<std::streamsize>(sizeof(T)));
+    s11n_check_read(is);
+}
+
+// Save/load the size of a container.
+template <typename S>
+inline void s11n_save_size(std::ostream &os, S size)
+{
+    static_assert(std::is_unsigned_v<S>, "The size of a container must be an unsigned integral.");
+
+    s11n_save(os, static_cast<std::uint64_t>(size));
+}
+
+template <typename S>
+inline S s11n_load_size(std::istream &is)
+{
+    std::uint64_t size = 0;
+    s11n_load(is, size);
+
+    if (size > std::numeric_limits<S>::max()) {
+        throw std::overflow_error("An overflow was detected while deserialising the size of a container");
+    }
+
+    return static_cast<S>(size);
+}
+
+// Save/load strings.
+HEYOKA_DLL_PUBLIC void s11n_save(std::ostream &, const std::string &);
+HEYOKA_DLL_PUBLIC void s11n_load(std::istream &, std::string &);
+
+// Save/load vectors of trivially copyable objects.
+template <typename T, typename A>
+inline void s11n_save(std::ostream &os, const std::vector<T, A> &v)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of trivially copyable objects can be serialised.");
+
+    s11n_save_size(os, v.size());
+
+    // NOTE: the static cast is safe because the size of the vector
+    // is bounded by the max value representable by std::streamsize.
+    os.write(reinterpret_cast<const char *>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+    s11n_check_write(os);
+}
+
+template <typename T, typename A>
+inline void s11n_load(std::istream &is, std::vector<T, A> &v)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of trivially copyable objects can be deserialised.");
+
+    const auto size = s11n_load_size<typename std::vector<T, A>::size_type>(is);
+
+    if (size > std::numeric_limits<typename std::vector<T, A>::size_type>::max() / sizeof(T)) {
+        throw std::overflow_error("An overflow was detected while deserialising a vector");
+    }
+
+    v.resize(size);
+
+    is.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(size * sizeof(T)));
+    s11n_check_read(is);
+}
+
+// Save/load the magic header of a serialised object.
+HEYOKA_DLL_PUBLIC void s11n_save_header(std::ostream &, const std::string &, std::uint32_t);
+HEYOKA_DLL_PUBLIC void s11n_load_header(std::istream &, const std::string &, std::uint32_t);
+
+// Save/load expressions and Taylor decompositions.
+HEYOKA_DLL_PUBLIC void s11n_save(std::ostream &, const expression &);
+HEYOKA_DLL_PUBLIC void s11n_load(std::istream &, expression &);
+
+HEYOKA_DLL_PUBLIC void s11n_save(std::ostream &, const taylor_dc_t &);
+HEYOKA_DLL_PUBLIC void s11n_load(std::istream &, taylor_dc_t &);
+
+} // namespace heyoka::detail
+
+#endif
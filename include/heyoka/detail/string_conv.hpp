@@ -12,6 +12,7 @@
 #include <cstdint>
 #include <string>
 
+#include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/visibility.hpp>
 
 namespace heyoka::detail
@@ -22,6 +23,11 @@ namespace heyoka::detail
 // will return 123.
 HEYOKA_DLL_PUBLIC std::uint32_t uname_to_index(const std::string &);
 
+// Same as above, but the index is fetched from the
+// symbol table of the variable names (where it is
+// computed when the name is first interned).
+HEYOKA_DLL_PUBLIC std::uint32_t uname_to_index(const variable &);
+
 } // namespace heyoka::detail
 
 #endif
@@ -0,0 +1,39 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_TAYLOR_C_DIFF_LIB_HPP
+#define HEYOKA_DETAIL_TAYLOR_C_DIFF_LIB_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka::detail
+{
+
+// Fetch the function for the computation of the Taylor derivatives
+// of f in compact mode from the library of precompiled derivative functions.
+// If the function is not in the library, it is generated and optimised
+// in a separate llvm_state and added to the library. The function
+// is then linked into the module of s.
+template <typename T>
+HEYOKA_DLL_PUBLIC llvm::Function *taylor_c_diff_lib_fetch(llvm_state &, const func &, std::uint32_t, std::uint32_t);
+
+} // namespace heyoka::detail
+
+#endif
@@ -0,0 +1,38 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_DETAIL_TRACING_HPP
+#define HEYOKA_DETAIL_TRACING_HPP
+
+#include <chrono>
+
+namespace heyoka::detail
+{
+
+// Scoped trace span: if tracing is enabled upon construction,
+// the span is recorded upon destruction.
+// NOTE: name and cat must be string literals (they are stored
+// as pointers and they are not escaped in the JSON output).
+class trace_span
+{
+    const char *m_name = nullptr;
+    const char *m_cat = nullptr;
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+    explicit trace_span(const char *, const char *) noexcept;
+    trace_span(const trace_span &) = delete;
+    trace_span(trace_span &&) = delete;
+    trace_span &operator=(const trace_span &) = delete;
+    trace_span &operator=(trace_span &&) = delete;
+    ~trace_span();
+};
+
+} // namespace heyoka::detail
+
+#endif
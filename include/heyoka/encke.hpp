@@ -0,0 +1,55 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_ENCKE_HPP
+#define HEYOKA_ENCKE_HPP
+
+#include <heyoka/config.hpp>
+
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+namespace heyoka
+{
+
+// Encke formulation of a perturbed two-body problem. The state is expressed
+// as the deviation from a reference Keplerian orbit (the osculating orbit at the
+// epoch t0), which is given by the elliptic orbital elements
+// elems = [a, e, i, Omega, omega, M0], where M0 is the mean anomaly at t0, and by
+// the gravitational parameter mu. The reference orbit is computed analytically
+// via kepE(), thus the integrator needs to resolve only the (small) deviation
+// induced by the perturbing acceleration pert, and it can take much larger
+// timesteps than with the formulation in Cartesian coordinates.
+// The perturbing acceleration pert (if not empty) must contain three expressions
+// which can depend on the Cartesian state variables x, y, z, vx, vy, vz, on the
+// time and on the runtime parameters. The returned system has the state variables
+// dx, dy, dz, dvx, dvy, dvz, the Cartesian state at the time t being the sum of
+// the deviation and of the state of the reference orbit (see encke_ref_state()).
+// NOTE: the differences of the Keplerian accelerations are computed via Battin's
+// f(q) function, which avoids the cancellation errors for small deviations.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_encke_sys(const std::vector<T> &, T, T, const std::vector<expression> & = {});
+
+// The Cartesian state [x, y, z, vx, vy, vz] at the time t on the reference
+// orbit of the Encke formulation (see make_encke_sys()).
+template <typename T>
+HEYOKA_DLL_PUBLIC std::vector<T> encke_ref_state(const std::vector<T> &, T, T, T);
+
+} // namespace heyoka
+
+#endif
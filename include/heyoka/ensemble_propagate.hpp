@@ -0,0 +1,283 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_ENSEMBLE_PROPAGATE_HPP
+#define HEYOKA_ENSEMBLE_PROPAGATE_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// The results of an ensemble propagation.
+// NOTE: the data is stored in iteration order. The state vectors
+// are stored in a contiguous row-major buffer: for propagate_until()
+// and propagate_for(), the shape is (n_iter, dim), for propagate_grid()
+// the shape is (n_iter, grid size, dim). If an iteration in
+// propagate_grid() stops early, the state vectors of the grid points
+// that were not reached are filled with NaNs.
+template <typename T>
+struct ensemble_res {
+    std::vector<T> states;
+    std::vector<T> times;
+    std::vector<taylor_outcome> outcomes;
+    std::vector<T> min_hs;
+    std::vector<T> max_hs;
+    std::vector<std::size_t> n_steps;
+};
+
+// The generator used to set up the integrator before each
+// iteration of an ensemble propagation. The generator is invoked
+// with an integrator whose state vector, time and parameters have
+// been reset to those of the template integrator and with the iteration
+// index, and it can modify the integrator's state vector, time and parameters.
+// NOTE: the generator will be invoked concurrently from multiple threads,
+// thus it must be thread-safe.
+template <typename T>
+using ensemble_gen_t = std::function<void(taylor_adaptive<T> &, std::size_t)>;
+
+// The generator used in the batch mode ensemble propagations.
+// The generator is invoked with a state vector, a parameter vector and
+// a time which have been set to the values of the first batch element of
+// the template integrator, and with the iteration index, and it can modify
+// the state vector, the parameter vector and the time (but not the sizes
+// of the vectors).
+// NOTE: the generator will be invoked concurrently from multiple threads,
+// thus it must be thread-safe.
+template <typename T>
+using ensemble_batch_gen_t = std::function<void(std::vector<T> &, std::vector<T> &, T &, std::size_t)>;
+
+namespace detail
+{
+
+// Implementations of the ensemble_propagate_*() functions.
+HEYOKA_DLL_PUBLIC ensemble_res<double>
+ensemble_propagate_until_impl(const taylor_adaptive<double> &, double, std::size_t,
+                              const ensemble_gen_t<double> &, unsigned, std::size_t, double,
+                              const std::function<bool(taylor_adaptive<double> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<double>
+ensemble_propagate_for_impl(const taylor_adaptive<double> &, double, std::size_t,
+                            const ensemble_gen_t<double> &, unsigned, std::size_t, double,
+                            const std::function<bool(taylor_adaptive<double> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<double>
+ensemble_propagate_grid_impl(const taylor_adaptive<double> &, const std::vector<double> &, std::size_t,
+                             const ensemble_gen_t<double> &, unsigned, std::size_t, double,
+                             const std::function<bool(taylor_adaptive<double> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<double>
+ensemble_propagate_until_batch_impl(const taylor_adaptive_batch<double> &, double, std::size_t,
+                                    const ensemble_batch_gen_t<double> &, unsigned, std::size_t, double, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<double>
+ensemble_propagate_for_batch_impl(const taylor_adaptive_batch<double> &, double, std::size_t,
+                                  const ensemble_batch_gen_t<double> &, unsigned, std::size_t, double, bool);
+
+HEYOKA_DLL_PUBLIC ensemble_res<long double>
+ensemble_propagate_until_impl(const taylor_adaptive<long double> &, long double, std::size_t,
+                              const ensemble_gen_t<long double> &, unsigned, std::size_t, long double,
+                              const std::function<bool(taylor_adaptive<long double> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<long double>
+ensemble_propagate_for_impl(const taylor_adaptive<long double> &, long double, std::size_t,
+                            const ensemble_gen_t<long double> &, unsigned, std::size_t, long double,
+                            const std::function<bool(taylor_adaptive<long double> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<long double>
+ensemble_propagate_grid_impl(const taylor_adaptive<long double> &, const std::vector<long double> &, std::size_t,
+                             const ensemble_gen_t<long double> &, unsigned, std::size_t, long double,
+                             const std::function<bool(taylor_adaptive<long double> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<long double>
+ensemble_propagate_until_batch_impl(const taylor_adaptive_batch<long double> &, long double, std::size_t,
+                                    const ensemble_batch_gen_t<long double> &, unsigned, std::size_t, long double,
+                                    bool);
+HEYOKA_DLL_PUBLIC ensemble_res<long double>
+ensemble_propagate_for_batch_impl(const taylor_adaptive_batch<long double> &, long double, std::size_t,
+                                  const ensemble_batch_gen_t<long double> &, unsigned, std::size_t, long double,
+                                  bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC ensemble_res<mppp::real128>
+ensemble_propagate_until_impl(const taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t,
+                              const ensemble_gen_t<mppp::real128> &, unsigned, std::size_t, mppp::real128,
+                              const std::function<bool(taylor_adaptive<mppp::real128> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<mppp::real128>
+ensemble_propagate_for_impl(const taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t,
+                            const ensemble_gen_t<mppp::real128> &, unsigned, std::size_t, mppp::real128,
+                            const std::function<bool(taylor_adaptive<mppp::real128> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<mppp::real128>
+ensemble_propagate_grid_impl(const taylor_adaptive<mppp::real128> &, const std::vector<mppp::real128> &, std::size_t,
+                             const ensemble_gen_t<mppp::real128> &, unsigned, std::size_t, mppp::real128,
+                             const std::function<bool(taylor_adaptive<mppp::real128> &)> &, bool);
+HEYOKA_DLL_PUBLIC ensemble_res<mppp::real128>
+ensemble_propagate_until_batch_impl(const taylor_adaptive_batch<mppp::real128> &, mppp::real128, std::size_t,
+                                    const ensemble_batch_gen_t<mppp::real128> &, unsigned, std::size_t, mppp::real128,
+                                    bool);
+HEYOKA_DLL_PUBLIC ensemble_res<mppp::real128>
+ensemble_propagate_for_batch_impl(const taylor_adaptive_batch<mppp::real128> &, mppp::real128, std::size_t,
+                                  const ensemble_batch_gen_t<mppp::real128> &, unsigned, std::size_t, mppp::real128,
+                                  bool);
+
+#endif
+
+// Parser for the common kwargs options for the ensemble_propagate_*() functions.
+// NOTE: the batch mode functions do not support callbacks.
+template <typename T, bool Batch, typename... KwArgs>
+inline auto ensemble_propagate_common_ops(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(always_false_v<KwArgs...>, "The variadic arguments to an ensemble_propagate_*() function "
+                                                 "contain unnamed arguments.");
+        throw;
+    } else if constexpr (Batch && p.has(kw::callback)) {
+        static_assert(always_false_v<KwArgs...>,
+                      "Callbacks are not supported by the ensemble_propagate_*_batch() functions.");
+        throw;
+    } else {
+        // Number of threads (defaults to zero, which means
+        // using all the available hardware threads).
+        auto n_threads = [&p]() -> unsigned {
+            if constexpr (p.has(kw::n_threads)) {
+                return std::forward<decltype(p(kw::n_threads))>(p(kw::n_threads));
+            } else {
+                return 0;
+            }
+        }();
+
+        // Max number of steps (defaults to zero).
+        auto max_steps = [&p]() -> std::size_t {
+            if constexpr (p.has(kw::max_steps)) {
+                return std::forward<decltype(p(kw::max_steps))>(p(kw::max_steps));
+            } else {
+                return 0;
+            }
+        }();
+
+        // Max delta_t (defaults to positive infinity).
+        auto max_delta_t = [&p]() -> T {
+            if constexpr (p.has(kw::max_delta_t)) {
+                return std::forward<decltype(p(kw::max_delta_t))>(p(kw::max_delta_t));
+            } else {
+                return std::numeric_limits<T>::infinity();
+            }
+        }();
+
+        // Callback (defaults to empty).
+        // NOTE: like the generator, the callback will be
+        // invoked concurrently from multiple threads.
+        auto cb = [&p]() -> std::function<bool(taylor_adaptive<T> &)> {
+            if constexpr (p.has(kw::callback)) {
+                return std::forward<decltype(p(kw::callback))>(p(kw::callback));
+            } else {
+                return {};
+            }
+        }();
+
+        // Pin the worker threads (defaults to true).
+        auto pin_threads = [&p]() -> bool {
+            if constexpr (p.has(kw::pin_threads)) {
+                return std::forward<decltype(p(kw::pin_threads))>(p(kw::pin_threads));
+            } else {
+                return true;
+            }
+        }();
+
+        return std::tuple{n_threads, max_steps, max_delta_t, std::move(cb), pin_threads};
+    }
+}
+
+} // namespace detail
+
+// Propagate n_iter copies of the integrator ta up to the time t in parallel.
+// Before each iteration, gen is invoked to set up the initial conditions.
+// NOTE: the type T must be specified explicitly, e.g.,
+// ensemble_propagate_until<double>(ta, 10., 100, gen).
+template <typename T, typename... KwArgs>
+inline ensemble_res<T> ensemble_propagate_until(const taylor_adaptive<T> &ta, T t, std::size_t n_iter,
+                                                const ensemble_gen_t<T> &gen, KwArgs &&...kw_args)
+{
+    auto [n_threads, max_steps, max_delta_t, cb, pin_threads]
+        = detail::ensemble_propagate_common_ops<T, false>(std::forward<KwArgs>(kw_args)...);
+
+    return detail::ensemble_propagate_until_impl(ta, t, n_iter, gen, n_threads, max_steps, max_delta_t, cb,
+                                                 pin_threads);
+}
+
+template <typename T, typename... KwArgs>
+inline ensemble_res<T> ensemble_propagate_for(const taylor_adaptive<T> &ta, T delta_t, std::size_t n_iter,
+                                              const ensemble_gen_t<T> &gen, KwArgs &&...kw_args)
+{
+    auto [n_threads, max_steps, max_delta_t, cb, pin_threads]
+        = detail::ensemble_propagate_common_ops<T, false>(std::forward<KwArgs>(kw_args)...);
+
+    return detail::ensemble_propagate_for_impl(ta, delta_t, n_iter, gen, n_threads, max_steps, max_delta_t, cb,
+                                               pin_threads);
+}
+
+template <typename T, typename... KwArgs>
+inline ensemble_res<T> ensemble_propagate_grid(const taylor_adaptive<T> &ta, const std::vector<T> &grid,
+                                               std::size_t n_iter, const ensemble_gen_t<T> &gen, KwArgs &&...kw_args)
+{
+    auto [n_threads, max_steps, max_delta_t, cb, pin_threads]
+        = detail::ensemble_propagate_common_ops<T, false>(std::forward<KwArgs>(kw_args)...);
+
+    return detail::ensemble_propagate_grid_impl(ta, grid, n_iter, gen, n_threads, max_steps, max_delta_t, cb,
+                                                pin_threads);
+}
+
+// Propagate n_iter state vectors up to the time t in parallel, using
+// copies of the batch integrator ta. Each thread packs the iterations
+// into the batch elements of its integrator, and as soon as the
+// propagation of a batch element is finished (e.g., because it reached
+// the final time or the step limit) the batch element is refilled with
+// the next iteration, so that the SIMD lanes are kept busy even if the
+// iterations have very different lengths.
+// NOTE: the type T must be specified explicitly, e.g.,
+// ensemble_propagate_until_batch<double>(ta, 10., 100, gen).
+template <typename T, typename... KwArgs>
+inline ensemble_res<T> ensemble_propagate_until_batch(const taylor_adaptive_batch<T> &ta, T t, std::size_t n_iter,
+                                                      const ensemble_batch_gen_t<T> &gen, KwArgs &&...kw_args)
+{
+    auto [n_threads, max_steps, max_delta_t, _, pin_threads]
+        = detail::ensemble_propagate_common_ops<T, true>(std::forward<KwArgs>(kw_args)...);
+
+    return detail::ensemble_propagate_until_batch_impl(ta, t, n_iter, gen, n_threads, max_steps, max_delta_t,
+                                                       pin_threads);
+}
+
+template <typename T, typename... KwArgs>
+inline ensemble_res<T> ensemble_propagate_for_batch(const taylor_adaptive_batch<T> &ta, T delta_t, std::size_t n_iter,
+                                                    const ensemble_batch_gen_t<T> &gen, KwArgs &&...kw_args)
+{
+    auto [n_threads, max_steps, max_delta_t, _, pin_threads]
+        = detail::ensemble_propagate_common_ops<T, true>(std::forward<KwArgs>(kw_args)...);
+
+    return detail::ensemble_propagate_for_batch_impl(ta, delta_t, n_iter, gen, n_threads, max_steps, max_delta_t,
+                                                     pin_threads);
+}
+
+} // namespace heyoka
+
+#endif
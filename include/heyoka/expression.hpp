@@ -246,11 +246,42 @@ HEYOKA_DLL_PUBLIC expression &operator/=(expression &, mppp::real128);
 HEYOKA_DLL_PUBLIC bool operator==(const expression &, const expression &);
 HEYOKA_DLL_PUBLIC bool operator!=(const expression &, const expression &);
 
+// Substitution of variables with expressions. The subexpressions shared
+// within the input expression(s) are processed only once, and the
+// subexpressions which do not depend on the substituted variables
+// share their storage with the input.
 HEYOKA_DLL_PUBLIC expression subs(const expression &, const std::unordered_map<std::string, expression> &);
+HEYOKA_DLL_PUBLIC std::vector<expression> subs(const std::vector<expression> &,
+                                               const std::unordered_map<std::string, expression> &);
+
+// Return a copy of the input expression(s) in which equal subexpressions
+// share the same storage. This reduces the memory footprint of large
+// expressions with many repeated subexpressions, and it
+// speeds up their comparison.
+HEYOKA_DLL_PUBLIC expression intern(const expression &);
+HEYOKA_DLL_PUBLIC std::vector<expression> intern(const std::vector<expression> &);
+
+// Algebraic simplification of the input expression(s). The simplifications
+// implemented are the collection of the terms in sums which differ only by a
+// numerical coefficient (e.g., 2*x + y - x -> x + y) and the merging of the
+// factors with equal bases in products (e.g., x*x*x -> x**3, sqrt(x)**3 -> x**1.5).
+// This is meant to reduce the size of the Taylor decomposition of
+// machine-generated expressions.
+HEYOKA_DLL_PUBLIC expression simplify(const expression &);
+HEYOKA_DLL_PUBLIC std::vector<expression> simplify(const std::vector<expression> &);
 
 HEYOKA_DLL_PUBLIC expression diff(const expression &, const std::string &);
 HEYOKA_DLL_PUBLIC expression diff(const expression &, const expression &);
 
+// Batched differentiation of one or more expressions with respect to multiple variables.
+// The derivatives are computed in a single traversal of the expression(s),
+// reusing the derivatives of subexpressions shared in the input and the
+// partial derivatives of each function with respect to its arguments.
+// The first overload returns the gradient of the input expression, the second
+// overload returns the Jacobian of the input expressions in row-major order.
+HEYOKA_DLL_PUBLIC std::vector<expression> diff(const expression &, const std::vector<expression> &);
+HEYOKA_DLL_PUBLIC std::vector<expression> diff(const std::vector<expression> &, const std::vector<expression> &);
+
 HEYOKA_DLL_PUBLIC expression pairwise_sum(std::vector<expression>);
 HEYOKA_DLL_PUBLIC expression pairwise_prod(std::vector<expression>);
 
@@ -305,6 +336,47 @@ HEYOKA_DLL_PUBLIC void update_grad_dbl(std::unordered_map<std::string, double> &
                                        const std::unordered_map<std::string, double> &, const std::vector<double> &,
                                        const std::vector<std::vector<std::size_t>> &, std::size_t &, double = 1.);
 
+// Batched versions of compute_node_values_dbl() and compute_grad_dbl(), operating on
+// multiple samples at once. The node values are stored in a node-major buffer
+// with shape (n_nodes, n_samples).
+HEYOKA_DLL_PUBLIC std::vector<double>
+compute_node_values_batch_dbl(const expression &, const std::unordered_map<std::string, std::vector<double>> &,
+                              const std::vector<std::vector<std::size_t>> &);
+HEYOKA_DLL_PUBLIC std::unordered_map<std::string, std::vector<double>>
+compute_grad_batch_dbl(const expression &, const std::unordered_map<std::string, std::vector<double>> &,
+                       const std::vector<std::vector<std::size_t>> &);
+HEYOKA_DLL_PUBLIC void update_grad_batch_dbl(std::unordered_map<std::string, std::vector<double>> &,
+                                             const expression &, const std::vector<double> &,
+                                             const std::vector<std::vector<std::size_t>> &);
+
+// Compressed sparse row (CSR) layout of the node connections of an expression, using
+// the same node numbering as compute_connections(). The indices of the children of the
+// node k are stored in indices[offsets[k]], ..., indices[offsets[k + 1] - 1], thus the
+// connectivity of the whole expression requires only two allocations.
+struct connections_csr {
+    std::vector<std::size_t> offsets;
+    std::vector<std::size_t> indices;
+};
+
+HEYOKA_DLL_PUBLIC connections_csr compute_connections_csr(const expression &);
+
+// Overloads of the node values/gradient functions operating on the CSR layout. The node values
+// and the gradients are computed via non-recursive sweeps over the nodes.
+HEYOKA_DLL_PUBLIC std::vector<double> compute_node_values_dbl(const expression &,
+                                                              const std::unordered_map<std::string, double> &,
+                                                              const connections_csr &);
+HEYOKA_DLL_PUBLIC std::unordered_map<std::string, double>
+compute_grad_dbl(const expression &, const std::unordered_map<std::string, double> &, const connections_csr &);
+HEYOKA_DLL_PUBLIC std::vector<double>
+compute_node_values_batch_dbl(const expression &, const std::unordered_map<std::string, std::vector<double>> &,
+                              const connections_csr &);
+HEYOKA_DLL_PUBLIC std::unordered_map<std::string, std::vector<double>>
+compute_grad_batch_dbl(const expression &, const std::unordered_map<std::string, std::vector<double>> &,
+                       const connections_csr &);
+HEYOKA_DLL_PUBLIC void update_grad_batch_dbl(std::unordered_map<std::string, std::vector<double>> &,
+                                             const expression &, const std::vector<double> &,
+                                             const connections_csr &);
+
 HEYOKA_DLL_PUBLIC taylor_dc_t::size_type taylor_decompose_in_place(expression &&, taylor_dc_t &);
 
 template <typename... Args>
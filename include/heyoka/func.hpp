@@ -11,6 +11,7 @@
 
 #include <heyoka/config.hpp>
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -63,6 +64,12 @@ namespace detail
 {
 
 struct HEYOKA_DLL_PUBLIC func_inner_base {
+    // Cached hash value of the function (zero if not computed yet).
+    // NOTE: the cache is stored in the inner base, so that it is
+    // shared among all the copies of the function. It is atomic so that
+    // the hash can be computed concurrently from multiple threads.
+    mutable std::atomic<std::size_t> m_hash{0};
+
     virtual ~func_inner_base();
     virtual std::unique_ptr<func_inner_base> clone() const = 0;
 
@@ -565,7 +572,14 @@ class HEYOKA_DLL_PUBLIC func
     friend HEYOKA_DLL_PUBLIC bool operator==(const func &, const func &);
 
     // Pointer to the inner base.
-    std::unique_ptr<detail::func_inner_base> m_ptr;
+    // NOTE: the inner base is shared among copies of the function
+    // (so that copies are O(1) and equal subexpressions can share storage)
+    // and it is treated as immutable while shared. Mutable access
+    // to the inner base triggers a (shallow) clone
+    // if the inner base is shared (copy-on-write).
+    // NOTE: the cached hash value stored in the inner base is reset
+    // whenever mutable access to the inner base is requested.
+    std::shared_ptr<detail::func_inner_base> m_ptr;
 
     // Just two small helpers to make sure that whenever we require
     // access to the pointer it actually points to something.
@@ -580,7 +594,7 @@ class HEYOKA_DLL_PUBLIC func
 
 public:
     template <typename T, generic_ctor_enabler<T &&> = 0>
-    explicit func(T &&x) : m_ptr(std::make_unique<detail::func_inner<detail::uncvref_t<T>>>(std::forward<T>(x)))
+    explicit func(T &&x) : m_ptr(std::make_shared<detail::func_inner<detail::uncvref_t<T>>>(std::forward<T>(x)))
     {
     }
 
@@ -606,8 +620,10 @@ public:
         auto p = dynamic_cast<const detail::func_inner<T> *>(ptr());
         return p == nullptr ? nullptr : &(p->m_value);
     }
+    // NOTE: this may trigger a copy-on-write clone
+    // of the inner base, hence it is not noexcept.
     template <typename T>
-    T *extract() noexcept
+    T *extract()
     {
         auto p = dynamic_cast<detail::func_inner<T> *>(ptr());
         return p == nullptr ? nullptr : &(p->m_value);
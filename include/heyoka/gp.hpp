@@ -10,12 +10,24 @@
 #define HEYOKA_GP_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
 #include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/llvm_state.hpp>
 #include <heyoka/splitmix64.hpp>
 
 namespace heyoka
@@ -37,6 +49,10 @@ private:
 public:
     explicit expression_generator(const std::vector<std::string> &, splitmix64 &);
     expression operator()(unsigned, unsigned, unsigned = 0u) const;
+    // NOTE: this overload uses the provided engine rather than
+    // the internal one, thus it can be invoked concurrently
+    // from multiple threads (each with its own engine).
+    expression operator()(splitmix64 &, unsigned, unsigned, unsigned = 0u) const;
 
     // getters
     const std::vector<expression (*)(expression)> &get_u_funcs() const;
@@ -65,6 +81,324 @@ HEYOKA_DLL_PUBLIC void mutate(expression &, std::size_t, const expression_genera
 HEYOKA_DLL_PUBLIC void crossover(expression &, expression &, splitmix64 &);
 HEYOKA_DLL_PUBLIC void crossover(expression &, expression &, std::size_t, std::size_t);
 
+namespace detail
+{
+
+struct gp_index_buffer;
+
+} // namespace detail
+
+// An expression (e.g., an individual in genetic programming) together with
+// a cached index of its nodes, in the depth-first pre-order numbering used by
+// count_nodes() and fetch_from_node_id(). The index gives constant-time access
+// to the nodes and to the sizes of their subtrees, and it is updated incrementally
+// by mutate() and crossover(), so that repeated mutations and crossovers
+// do not need to walk the whole tree.
+class HEYOKA_DLL_PUBLIC gp_individual
+{
+    expression m_ex;
+    // Pointers to the nodes, sizes of the subtrees rooted
+    // at the nodes and indices of the parents of the nodes.
+    // NOTE: the root node is always m_ex, its pointer
+    // in m_nodes is not used.
+    std::vector<expression *> m_nodes;
+    std::vector<std::size_t> m_sizes;
+    std::vector<std::size_t> m_parents;
+
+    HEYOKA_DLL_LOCAL expression &node(std::size_t);
+    HEYOKA_DLL_LOCAL void build_index();
+    HEYOKA_DLL_LOCAL void unshare_ancestors(std::size_t);
+    HEYOKA_DLL_LOCAL void splice(std::size_t, const detail::gp_index_buffer &);
+    HEYOKA_DLL_LOCAL void check_node_id(std::size_t) const;
+
+public:
+    explicit gp_individual(expression);
+
+    gp_individual(const gp_individual &);
+    gp_individual(gp_individual &&) noexcept;
+
+    gp_individual &operator=(const gp_individual &);
+    gp_individual &operator=(gp_individual &&) noexcept;
+
+    ~gp_individual();
+
+    const expression &get_expression() const;
+    std::size_t size() const;
+    const expression &get_node(std::size_t) const;
+    std::size_t get_subtree_size(std::size_t) const;
+
+    void replace_node(std::size_t, expression);
+
+    friend HEYOKA_DLL_PUBLIC void crossover(gp_individual &, gp_individual &, std::size_t, std::size_t);
+};
+
+HEYOKA_DLL_PUBLIC void mutate(gp_individual &, std::size_t, const expression_generator &, unsigned, unsigned);
+HEYOKA_DLL_PUBLIC void mutate(gp_individual &, std::size_t, const expression_generator &, splitmix64 &, unsigned,
+                              unsigned);
+HEYOKA_DLL_PUBLIC void mutate(gp_individual &, const expression_generator &, splitmix64 &, unsigned, unsigned);
+HEYOKA_DLL_PUBLIC void crossover(gp_individual &, gp_individual &, std::size_t, std::size_t);
+HEYOKA_DLL_PUBLIC void crossover(gp_individual &, gp_individual &, splitmix64 &);
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(seed);
+IGOR_MAKE_NAMED_ARGUMENT(tournament_size);
+IGOR_MAKE_NAMED_ARGUMENT(crossover_prob);
+IGOR_MAKE_NAMED_ARGUMENT(n_elites);
+IGOR_MAKE_NAMED_ARGUMENT(mut_min_depth);
+IGOR_MAKE_NAMED_ARGUMENT(mut_max_depth);
+IGOR_MAKE_NAMED_ARGUMENT(fitness_cache);
+
+} // namespace kw
+
+// The fitness function used in gp_evolve(). Lower values
+// of the fitness are better, NaN values are the worst.
+// NOTE: the fitness function will be invoked concurrently
+// from multiple threads, thus it must be thread-safe.
+using gp_fitness_t = std::function<double(const expression &)>;
+
+// The results of gp_evolve(): the final population
+// and the fitness values of its individuals.
+struct gp_evolve_res {
+    std::vector<expression> pop;
+    std::vector<double> fitness;
+};
+
+// Bounded cache of fitness values, keyed on the structure of the expressions
+// (i.e., via std::hash and operator==). Mutations and crossovers often
+// produce individuals which are structurally identical to already-evaluated
+// ones: with a cache, the fitness of such individuals costs a hash lookup
+// rather than an evaluation over the whole dataset. When the cache is full,
+// the oldest entries are evicted first. All the member functions can
+// be invoked concurrently from multiple threads.
+class HEYOKA_DLL_PUBLIC gp_fitness_cache
+{
+    std::size_t m_max_size;
+    std::unordered_map<expression, double> m_map;
+    // The keys of m_map in insertion order.
+    // NOTE: the pointers to the elements of an unordered_map
+    // are not invalidated by rehashing.
+    std::deque<const expression *> m_order;
+    std::uint64_t m_n_hits = 0;
+    std::uint64_t m_n_misses = 0;
+    mutable std::mutex m_mutex;
+
+public:
+    explicit gp_fitness_cache(std::size_t);
+
+    gp_fitness_cache(const gp_fitness_cache &) = delete;
+    gp_fitness_cache(gp_fitness_cache &&) = delete;
+
+    gp_fitness_cache &operator=(const gp_fitness_cache &) = delete;
+    gp_fitness_cache &operator=(gp_fitness_cache &&) = delete;
+
+    ~gp_fitness_cache();
+
+    std::optional<double> lookup(const expression &);
+    void insert(const expression &, double);
+    double operator()(const expression &, const gp_fitness_t &);
+
+    std::size_t size() const;
+    std::size_t get_max_size() const;
+    std::uint64_t get_n_hits() const;
+    std::uint64_t get_n_misses() const;
+
+    void clear();
+};
+
+namespace detail
+{
+
+HEYOKA_DLL_PUBLIC gp_evolve_res gp_evolve_impl(std::vector<expression>, const expression_generator &,
+                                               const gp_fitness_t &, unsigned, std::uint64_t, std::size_t, double,
+                                               std::size_t, unsigned, unsigned, unsigned, gp_fitness_cache *);
+
+} // namespace detail
+
+// Evolve the population pop for n_gen generations via tournament selection,
+// subtree crossover and subtree mutation (the new subtrees are created by
+// the generator gen). The offspring are generated and evaluated in parallel.
+// Each offspring draws its random numbers from its own splitmix64 stream,
+// jumped ahead from the seed according to the generation and to the index
+// of the offspring, so that the results are reproducible and do not
+// depend on the number of threads. An optional fitness cache can be passed
+// via kw::fitness_cache (as a pointer to a gp_fitness_cache): the cache can
+// be shared by multiple invocations of gp_evolve().
+template <typename... KwArgs>
+inline gp_evolve_res gp_evolve(std::vector<expression> pop, const expression_generator &gen,
+                               const gp_fitness_t &fitness, unsigned n_gen, KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments to gp_evolve() contain unnamed arguments.");
+        throw;
+    } else {
+        // The seed of the random streams (defaults to zero).
+        auto seed = [&p]() -> std::uint64_t {
+            if constexpr (p.has(kw::seed)) {
+                return std::forward<decltype(p(kw::seed))>(p(kw::seed));
+            } else {
+                return 0;
+            }
+        }();
+
+        // Tournament size (defaults to 3).
+        auto tournament_size = [&p]() -> std::size_t {
+            if constexpr (p.has(kw::tournament_size)) {
+                return std::forward<decltype(p(kw::tournament_size))>(p(kw::tournament_size));
+            } else {
+                return 3;
+            }
+        }();
+
+        // Probability of generating an offspring via
+        // crossover rather than mutation (defaults to 0.5).
+        auto crossover_prob = [&p]() -> double {
+            if constexpr (p.has(kw::crossover_prob)) {
+                return std::forward<decltype(p(kw::crossover_prob))>(p(kw::crossover_prob));
+            } else {
+                return 0.5;
+            }
+        }();
+
+        // Number of best individuals copied unchanged
+        // into the next generation (defaults to 1).
+        auto n_elites = [&p]() -> std::size_t {
+            if constexpr (p.has(kw::n_elites)) {
+                return std::forward<decltype(p(kw::n_elites))>(p(kw::n_elites));
+            } else {
+                return 1;
+            }
+        }();
+
+        // Depth bounds for the subtrees generated
+        // during mutation (default to 0 and 3).
+        auto mut_min_depth = [&p]() -> unsigned {
+            if constexpr (p.has(kw::mut_min_depth)) {
+                return std::forward<decltype(p(kw::mut_min_depth))>(p(kw::mut_min_depth));
+            } else {
+                return 0;
+            }
+        }();
+        auto mut_max_depth = [&p]() -> unsigned {
+            if constexpr (p.has(kw::mut_max_depth)) {
+                return std::forward<decltype(p(kw::mut_max_depth))>(p(kw::mut_max_depth));
+            } else {
+                return 3;
+            }
+        }();
+
+        // Number of threads (defaults to zero, which means
+        // using all the available hardware threads).
+        auto n_threads = [&p]() -> unsigned {
+            if constexpr (p.has(kw::n_threads)) {
+                return std::forward<decltype(p(kw::n_threads))>(p(kw::n_threads));
+            } else {
+                return 0;
+            }
+        }();
+
+        // Fitness cache (defaults to null, that is, no cache).
+        auto fitness_cache = [&p]() -> gp_fitness_cache * {
+            if constexpr (p.has(kw::fitness_cache)) {
+                return std::forward<decltype(p(kw::fitness_cache))>(p(kw::fitness_cache));
+            } else {
+                return nullptr;
+            }
+        }();
+
+        return detail::gp_evolve_impl(std::move(pop), gen, fitness, n_gen, seed, tournament_size, crossover_prob,
+                                      n_elites, mut_min_depth, mut_max_depth, n_threads, fitness_cache);
+    }
+}
+
+// Compiled evaluator for a population of expressions (e.g., a generation
+// of candidates in symbolic regression). All the individuals are compiled
+// into a single LLVM module (one function per individual), so that the JIT
+// cost is paid once for the whole population. The individuals are evaluated
+// over a shared dataset stored in row-major order with shape (n_vars, n_points),
+// and the output is stored in row-major order with shape (n_individuals, n_points).
+// Structurally identical individuals are compiled and evaluated only once.
+// The points are processed in batches via SIMD instructions. The batch size
+// can be set via kw::batch_size (if zero or not provided, it will be chosen
+// depending on the host machine), the other keyword arguments are forwarded
+// to the llvm_state.
+class HEYOKA_DLL_PUBLIC population_evaluator
+{
+public:
+    using cfunc_t = void (*)(double *, const double *, const double *, std::uint64_t);
+
+private:
+    llvm_state m_llvm;
+    std::vector<expression> m_pop;
+    std::vector<std::string> m_vars;
+    std::uint32_t m_batch_size = 0;
+    std::uint32_t m_n_pars = 0;
+    // Index of the first occurrence of each
+    // individual in the population.
+    std::vector<std::size_t> m_rep;
+    // Function pointers to the batch-mode
+    // and scalar compiled functions of the individuals.
+    std::vector<cfunc_t> m_f_batch;
+    std::vector<cfunc_t> m_f_scalar;
+
+    HEYOKA_DLL_LOCAL void fetch_fptrs();
+    void finalise_ctor_impl(std::vector<expression>, std::vector<std::string>, std::uint32_t);
+    template <typename... KwArgs>
+    void finalise_ctor(std::vector<expression> pop, std::vector<std::string> vars, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a population evaluator contain "
+                          "unnamed arguments.");
+        } else {
+            // Batch size (defaults to zero, meaning that the batch
+            // size will be chosen depending on the host machine).
+            auto batch_size = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::batch_size)) {
+                    return std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+                } else {
+                    return 0;
+                }
+            }();
+
+            finalise_ctor_impl(std::move(pop), std::move(vars), batch_size);
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit population_evaluator(std::vector<expression> pop, std::vector<std::string> vars, KwArgs &&...kw_args)
+        : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor(std::move(pop), std::move(vars), std::forward<KwArgs>(kw_args)...);
+    }
+
+    population_evaluator(const population_evaluator &);
+    population_evaluator(population_evaluator &&) noexcept;
+
+    population_evaluator &operator=(const population_evaluator &);
+    population_evaluator &operator=(population_evaluator &&) noexcept;
+
+    ~population_evaluator();
+
+    const llvm_state &get_llvm_state() const;
+    const std::vector<expression> &get_population() const;
+    const std::vector<std::string> &get_vars() const;
+    std::uint32_t get_batch_size() const;
+    std::uint32_t get_n_pars() const;
+    std::size_t get_n_unique() const;
+
+    void operator()(double *, const double *, std::size_t, const double * = nullptr, unsigned = 1) const;
+    std::vector<double> operator()(const std::vector<double> &, std::size_t, const std::vector<double> & = {},
+                                   unsigned = 1) const;
+};
+
 } // namespace heyoka
 
 #endif
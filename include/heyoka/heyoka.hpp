@@ -9,19 +9,41 @@
 #ifndef HEYOKA_HEYOKA_HPP
 #define HEYOKA_HEYOKA_HPP
 
+#include <heyoka/batch_env.hpp>
+#include <heyoka/bytecode.hpp>
+#include <heyoka/cfunc.hpp>
+#include <heyoka/chebyshev_output.hpp>
+#include <heyoka/collision.hpp>
+#include <heyoka/encke.hpp>
+#include <heyoka/ensemble_propagate.hpp>
 #include <heyoka/exceptions.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/gp.hpp>
+#include <heyoka/kepE_solver.hpp>
+#include <heyoka/kepler_propagator.hpp>
 #include <heyoka/kw.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/mascon.hpp>
 #include <heyoka/math.hpp>
+#include <heyoka/mpi_ensemble.hpp>
+#include <heyoka/multirate.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/output_sink.hpp>
 #include <heyoka/param.hpp>
+#include <heyoka/parareal.hpp>
+#include <heyoka/resumable_propagation.hpp>
 #include <heyoka/splitmix64.hpp>
+#include <heyoka/sundman.hpp>
 #include <heyoka/taylor.hpp>
+#include <heyoka/taylor_export.hpp>
+#include <heyoka/taylor_jet.hpp>
+#include <heyoka/taylor_pool.hpp>
+#include <heyoka/thread_pool.hpp>
+#include <heyoka/tracing.hpp>
 #include <heyoka/variable.hpp>
+#include <heyoka/variational.hpp>
+#include <heyoka/warmup.hpp>
 
 #endif
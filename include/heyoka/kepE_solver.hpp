@@ -0,0 +1,117 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_KEPE_SOLVER_HPP
+#define HEYOKA_KEPE_SOLVER_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/llvm_state.hpp>
+
+namespace heyoka
+{
+
+// Bulk solver for Kepler's equation, i.e., for the computation of the eccentric
+// anomaly E from the eccentricity e and the mean anomaly M (see kepE()), over arrays
+// of (e, M) pairs. The eccentricities and the mean anomalies are read from separate
+// arrays. The solver is compiled once at construction, and the pairs are processed
+// in batches via SIMD instructions. The batches are optionally distributed among
+// multiple threads. The optional kwarg kw::batch_size selects the batch size
+// (defaults to zero, meaning that the batch size is chosen depending on the host machine).
+template <typename T>
+class HEYOKA_DLL_PUBLIC kepE_solver
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+public:
+    using kepE_f_t = void (*)(T *, const T *, const T *, std::uint64_t);
+
+private:
+    llvm_state m_llvm;
+    std::uint32_t m_batch_size = 0;
+    // Function pointers to the batch-mode
+    // and scalar compiled functions.
+    kepE_f_t m_f_batch = nullptr;
+    kepE_f_t m_f_scalar = nullptr;
+
+    void finalise_ctor_impl(std::uint32_t);
+    template <typename... KwArgs>
+    void finalise_ctor(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a Kepler solver contain "
+                          "unnamed arguments.");
+        } else {
+            // Batch size (defaults to zero, meaning that the batch
+            // size will be chosen depending on the host machine).
+            auto batch_size = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::batch_size)) {
+                    return std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+                } else {
+                    return 0;
+                }
+            }();
+
+            finalise_ctor_impl(batch_size);
+        }
+    }
+
+public:
+    kepE_solver();
+    // NOTE: enable the kwargs ctor only if:
+    // - there is at least 1 argument (i.e., cannot act as a def ctor),
+    // - if there is only 1 argument, it cannot be of type kepE_solver
+    //   (so that it does not interfere with copy/move ctors).
+    template <typename... KwArgs,
+              std::enable_if_t<(sizeof...(KwArgs) > 0u)
+                                   && (sizeof...(KwArgs) > 1u
+                                       || std::conjunction_v<
+                                           std::negation<std::is_same<detail::uncvref_t<KwArgs>, kepE_solver>>...>),
+                               int> = 0>
+    explicit kepE_solver(KwArgs &&...kw_args) : m_llvm{kw_args...}
+    {
+        finalise_ctor(std::forward<KwArgs>(kw_args)...);
+    }
+
+    kepE_solver(const kepE_solver &);
+    kepE_solver(kepE_solver &&) noexcept;
+
+    kepE_solver &operator=(const kepE_solver &);
+    kepE_solver &operator=(kepE_solver &&) noexcept;
+
+    ~kepE_solver();
+
+    const llvm_state &get_llvm_state() const;
+    std::uint32_t get_batch_size() const;
+
+    void operator()(T *, const T *, const T *, std::size_t, unsigned = 1) const;
+    std::vector<T> operator()(const std::vector<T> &, const std::vector<T> &, unsigned = 1) const;
+};
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,255 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_KEPLER_PROPAGATOR_HPP
+#define HEYOKA_KEPLER_PROPAGATOR_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Analytic propagator for the two-body problem, with the same interface
+// as taylor_adaptive. The state vector is the Cartesian state
+// [x, y, z, vx, vy, vz] relative to the central body, whose gravitational
+// parameter is mu. The propagation is performed by solving Kepler's equation
+// in universal variables, thus elliptic, parabolic and hyperbolic orbits are
+// all supported, and the cost of a propagation does not depend on its duration.
+// Optional kwargs: kw::time (the initial time, defaults to zero).
+template <typename T>
+class HEYOKA_DLL_PUBLIC kepler_propagator
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    std::vector<T> m_state;
+    T m_mu;
+    detail::dfloat<T> m_time;
+    std::vector<T> m_d_output;
+
+    struct private_ctor_t {
+    };
+    explicit kepler_propagator(private_ctor_t, std::vector<T>, T, T);
+
+    HEYOKA_DLL_LOCAL taylor_outcome propagate_until_impl(const detail::dfloat<T> &);
+
+    template <typename... KwArgs>
+    static T parse_time(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a Keplerian propagator contain "
+                          "unnamed arguments.");
+            throw;
+        } else {
+            // Initial time (defaults to zero).
+            if constexpr (p.has(kw::time)) {
+                return std::forward<decltype(p(kw::time))>(p(kw::time));
+            } else {
+                return T(0);
+            }
+        }
+    }
+
+public:
+    kepler_propagator();
+
+    template <typename... KwArgs>
+    explicit kepler_propagator(std::vector<T> state, T mu, KwArgs &&...kw_args)
+        : kepler_propagator(private_ctor_t{}, std::move(state), mu, parse_time(std::forward<KwArgs>(kw_args)...))
+    {
+    }
+
+    kepler_propagator(const kepler_propagator &);
+    kepler_propagator(kepler_propagator &&) noexcept;
+
+    kepler_propagator &operator=(const kepler_propagator &);
+    kepler_propagator &operator=(kepler_propagator &&) noexcept;
+
+    ~kepler_propagator();
+
+    T get_mu() const;
+    std::uint32_t get_dim() const;
+
+    T get_time() const
+    {
+        return static_cast<T>(m_time);
+    }
+    void set_time(T t)
+    {
+        m_time = detail::dfloat<T>(t);
+    }
+
+    const std::vector<T> &get_state() const
+    {
+        return m_state;
+    }
+    const T *get_state_data() const
+    {
+        return m_state.data();
+    }
+    T *get_state_data()
+    {
+        return m_state.data();
+    }
+
+    // The return value is taylor_outcome::time_limit, or
+    // taylor_outcome::err_nf_state if the propagation
+    // produced a non-finite state (in which case the state
+    // and time of the propagator are not altered).
+    taylor_outcome propagate_until(T);
+    taylor_outcome propagate_for(T);
+    // NOTE: as in taylor_adaptive, the state is propagated
+    // up to the last grid point, and the return value contains
+    // the state vectors at the grid points in row-major format.
+    std::tuple<taylor_outcome, std::vector<T>> propagate_grid(std::vector<T>);
+
+    // Dense output: compute the state at the time t
+    // (or at the time get_time() + t if rel_time is true),
+    // without altering the state of the propagator.
+    const std::vector<T> &get_d_output() const
+    {
+        return m_d_output;
+    }
+    const std::vector<T> &update_d_output(T, bool = false);
+};
+
+// Batch version of kepler_propagator. The states are stored in the same
+// layout as in taylor_adaptive_batch (i.e., the state vector
+// [x, y, z, vx, vy, vz] is stored in row-major format with shape
+// (6, batch_size)), and mu is shared by all the batch elements.
+// NOTE: the batch elements are propagated independently.
+template <typename T>
+class HEYOKA_DLL_PUBLIC kepler_propagator_batch
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    std::uint32_t m_batch_size;
+    std::vector<T> m_state;
+    T m_mu;
+    std::vector<T> m_time_hi, m_time_lo;
+    std::vector<T> m_d_output;
+    std::vector<taylor_outcome> m_prop_res;
+
+    struct private_ctor_t {
+    };
+    explicit kepler_propagator_batch(private_ctor_t, std::vector<T>, T, std::uint32_t, std::vector<T>);
+
+    HEYOKA_DLL_LOCAL void propagate_until_impl(const std::vector<detail::dfloat<T>> &);
+    HEYOKA_DLL_LOCAL detail::dfloat<T> get_dtime(std::uint32_t) const;
+
+    template <typename... KwArgs>
+    static std::vector<T> parse_time(std::uint32_t batch_size, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a Keplerian propagator in batch mode "
+                          "contain unnamed arguments.");
+            throw;
+        } else {
+            // Initial times (defaults to zeroes).
+            if constexpr (p.has(kw::time)) {
+                return std::forward<decltype(p(kw::time))>(p(kw::time));
+            } else {
+                return std::vector<T>(static_cast<typename std::vector<T>::size_type>(batch_size), T(0));
+            }
+        }
+    }
+
+public:
+    kepler_propagator_batch();
+
+    template <typename... KwArgs>
+    explicit kepler_propagator_batch(std::vector<T> state, T mu, std::uint32_t batch_size, KwArgs &&...kw_args)
+        : kepler_propagator_batch(private_ctor_t{}, std::move(state), mu, batch_size,
+                                  parse_time(batch_size, std::forward<KwArgs>(kw_args)...))
+    {
+    }
+
+    kepler_propagator_batch(const kepler_propagator_batch &);
+    kepler_propagator_batch(kepler_propagator_batch &&) noexcept;
+
+    kepler_propagator_batch &operator=(const kepler_propagator_batch &);
+    kepler_propagator_batch &operator=(kepler_propagator_batch &&) noexcept;
+
+    ~kepler_propagator_batch();
+
+    std::uint32_t get_batch_size() const;
+    T get_mu() const;
+    std::uint32_t get_dim() const;
+
+    const std::vector<T> &get_time() const
+    {
+        return m_time_hi;
+    }
+    const T *get_time_data() const
+    {
+        return m_time_hi.data();
+    }
+    void set_time(const std::vector<T> &);
+    void set_time(std::uint32_t, T);
+
+    const std::vector<T> &get_state() const
+    {
+        return m_state;
+    }
+    const T *get_state_data() const
+    {
+        return m_state.data();
+    }
+    T *get_state_data()
+    {
+        return m_state.data();
+    }
+
+    // NOTE: the outcomes of the propagations of the batch
+    // elements are stored in get_propagate_res() (see kepler_propagator).
+    void propagate_until(const std::vector<T> &);
+    void propagate_until(T);
+    void propagate_for(const std::vector<T> &);
+    void propagate_for(T);
+    // NOTE: the grid layout is the same as in taylor_adaptive_batch,
+    // i.e., the grid points are stored in row-major format with
+    // shape (n_points, batch_size). The return value has
+    // shape (n_points, 6, batch_size).
+    std::vector<T> propagate_grid(std::vector<T>);
+    const std::vector<taylor_outcome> &get_propagate_res() const
+    {
+        return m_prop_res;
+    }
+
+    const std::vector<T> &get_d_output() const
+    {
+        return m_d_output;
+    }
+    const std::vector<T> &update_d_output(const std::vector<T> &, bool = false);
+};
+
+} // namespace heyoka
+
+#endif
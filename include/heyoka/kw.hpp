@@ -22,6 +22,12 @@ IGOR_MAKE_NAMED_ARGUMENT(points);
 IGOR_MAKE_NAMED_ARGUMENT(omega);
 IGOR_MAKE_NAMED_ARGUMENT(state);
 IGOR_MAKE_NAMED_ARGUMENT(Gconst);
+IGOR_MAKE_NAMED_ARGUMENT(n_threads);
+IGOR_MAKE_NAMED_ARGUMENT(fused);
+IGOR_MAKE_NAMED_ARGUMENT(theta);
+IGOR_MAKE_NAMED_ARGUMENT(min_distance);
+IGOR_MAKE_NAMED_ARGUMENT(max_iter);
+IGOR_MAKE_NAMED_ARGUMENT(pin_threads);
 
 } // namespace kw
 
@@ -9,9 +9,12 @@
 #ifndef HEYOKA_LLVM_STATE_HPP
 #define HEYOKA_LLVM_STATE_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <initializer_list>
+#include <istream>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <tuple>
@@ -40,12 +43,43 @@ struct target_features {
     bool avx512f = false;
 };
 
-// NOTE: no need to make this DLL-public as long
-// as this is used only in library code.
-const target_features &get_target_features();
+HEYOKA_DLL_PUBLIC const target_features &get_target_features();
+
+// Recommended SIMD vector width for the floating-point
+// type T, depending on the features of the host machine.
+template <typename T>
+inline std::uint32_t recommended_simd_size()
+{
+    if constexpr (std::is_same_v<T, double>) {
+        const auto &tf = get_target_features();
+
+        if (tf.avx512f) {
+            return 8;
+        }
+
+        if (tf.avx) {
+            return 4;
+        }
+
+        if (tf.sse2) {
+            return 2;
+        }
+    }
+
+    return 1;
+}
 
 } // namespace detail
 
+// Recommended batch size for the batch mode integrators and
+// compiled functions with floating-point type T, depending
+// on the SIMD instruction sets available on the host machine.
+template <typename T>
+inline std::uint32_t recommended_batch_size()
+{
+    return detail::recommended_simd_size<T>();
+}
+
 namespace kw
 {
 
@@ -53,30 +87,111 @@ IGOR_MAKE_NAMED_ARGUMENT(mname);
 IGOR_MAKE_NAMED_ARGUMENT(opt_level);
 IGOR_MAKE_NAMED_ARGUMENT(fast_math);
 IGOR_MAKE_NAMED_ARGUMENT(inline_functions);
+IGOR_MAKE_NAMED_ARGUMENT(cache_dir);
+IGOR_MAKE_NAMED_ARGUMENT(target_cpu);
+IGOR_MAKE_NAMED_ARGUMENT(slp_vectorize);
+IGOR_MAKE_NAMED_ARGUMENT(loop_vectorize);
+IGOR_MAKE_NAMED_ARGUMENT(compile_threads);
 
 } // namespace kw
 
 HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state &);
 
+// Timings (in seconds) of the optimisation
+// and code generation phases of an llvm_state.
+struct llvm_state_timings {
+    // Time spent in the function passes.
+    double opt_function_passes = 0;
+    // Time spent in the module passes.
+    double opt_module_passes = 0;
+    // Time spent in the generation of the object code.
+    // NOTE: this will be zero if the object code
+    // was fetched from a cache.
+    double codegen = 0;
+};
+
+// Memory usage (in bytes) of an llvm_state.
+struct llvm_state_memory_usage {
+    // Size of the bitcode snapshot of the module.
+    std::size_t bc_snapshot = 0;
+    // Size of the object code.
+    std::size_t object_code = 0;
+    // Estimate of the memory allocated by the jit
+    // for the code and data sections of the object code.
+    std::size_t jit = 0;
+};
+
+// Optimisation remark emitted by the vectorisation and
+// inlining passes during llvm_state::optimise().
+struct llvm_opt_remark {
+    // The kind of remark ("passed", "missed" or "analysis").
+    std::string kind;
+    // The name of the pass (e.g., "slp-vectorizer",
+    // "loop-vectorize" or "inline").
+    std::string pass;
+    // The identifier of the remark within the pass.
+    std::string name;
+    // The name of the function the remark refers to.
+    std::string function;
+    // The message of the remark.
+    std::string message;
+};
+
 class HEYOKA_DLL_PUBLIC llvm_state
 {
     friend HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const llvm_state &);
 
     struct jit;
+    struct jit_pool;
 
     std::unique_ptr<jit> m_jitter;
     std::unique_ptr<llvm::Module> m_module;
     std::unique_ptr<ir_builder> m_builder;
     unsigned m_opt_level;
-    std::string m_ir_snapshot;
+    // Bitcode snapshot of the module, created
+    // upon compilation.
+    std::string m_bc_snapshot;
     bool m_fast_math;
     std::string m_module_name;
     bool m_inline_functions;
+    // Directory of the persistent object code cache
+    // (empty if the cache is disabled).
+    std::string m_cache_dir;
+    // The CPU the object code is generated
+    // for (empty for the host CPU).
+    std::string m_target_cpu;
+    // Flags to enable the SLP and loop
+    // vectorisation passes.
+    bool m_slp_vectorize;
+    bool m_loop_vectorize;
+    // Number of threads used for the parallel
+    // compilation of the module.
+    unsigned m_compile_threads;
+    // Key of the module in the persistent cache (empty
+    // if no key has been computed or if the object code
+    // does not need to be stored).
+    std::string m_cache_key;
+    // Key of the module in the in-memory cache (empty
+    // if the object code does not need to be stored).
+    std::string m_mem_cache_key;
+    // Object code fetched from the persistent
+    // or in-memory cache.
+    std::optional<std::string> m_cached_obj;
+    // Timings of the optimisation and code generation.
+    // NOTE: the timings are neither copied nor serialised.
+    llvm_state_timings m_timings;
+    // Optimisation remarks collected in optimise().
+    // NOTE: the remarks are neither copied nor serialised.
+    std::vector<llvm_opt_remark> m_opt_remarks;
 
     // Check functions.
     HEYOKA_DLL_LOCAL void check_uncompiled(const char *) const;
     HEYOKA_DLL_LOCAL void check_compiled(const char *) const;
 
+    // Helpers for the persistent cache.
+    HEYOKA_DLL_LOCAL std::string cache_compute_key(const std::string &, const char *) const;
+    HEYOKA_DLL_LOCAL void cache_try_store();
+
     // Implementation details for the variadic constructor.
     template <typename... KwArgs>
     static auto kw_args_ctor_impl(KwArgs &&...kw_args)
@@ -124,10 +239,71 @@ class HEYOKA_DLL_PUBLIC llvm_state
                 }
             }();
 
-            return std::tuple{std::move(mod_name), opt_level, fmath, i_func};
+            // Directory for the persistent object code cache
+            // (defaults to empty string). If empty, the directory
+            // will be read from the HEYOKA_CACHE_DIR environment
+            // variable (if set).
+            auto c_dir = [&p]() -> std::string {
+                if constexpr (p.has(kw::cache_dir)) {
+                    return std::forward<decltype(p(kw::cache_dir))>(p(kw::cache_dir));
+                } else {
+                    return "";
+                }
+            }();
+
+            // Target CPU (defaults to empty string, i.e., the host CPU).
+            // NOTE: this can be used to generate object code for a less
+            // capable CPU than the host (e.g., "x86-64" or "haswell"), so
+            // that the object code can be later deserialised and run
+            // on other machines.
+            auto t_cpu = [&p]() -> std::string {
+                if constexpr (p.has(kw::target_cpu)) {
+                    return std::forward<decltype(p(kw::target_cpu))>(p(kw::target_cpu));
+                } else {
+                    return "";
+                }
+            }();
+
+            // SLP vectorisation (defaults to false).
+            // NOTE: the code generated by heyoka is explicitly
+            // vectorised in batch mode, thus automatic vectorisation
+            // is off by default in order to reduce the compilation time.
+            auto slp_vec = [&p]() -> bool {
+                if constexpr (p.has(kw::slp_vectorize)) {
+                    return std::forward<decltype(p(kw::slp_vectorize))>(p(kw::slp_vectorize));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Loop vectorisation (defaults to false).
+            auto loop_vec = [&p]() -> bool {
+                if constexpr (p.has(kw::loop_vectorize)) {
+                    return std::forward<decltype(p(kw::loop_vectorize))>(p(kw::loop_vectorize));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Number of compilation threads (defaults to 1).
+            // NOTE: if different from 1, the module is split into
+            // multiple parts (up to one per function) which are compiled
+            // concurrently. A value of 0 means to use all the hardware
+            // threads available on the machine.
+            auto c_threads = [&p]() -> unsigned {
+                if constexpr (p.has(kw::compile_threads)) {
+                    return std::forward<decltype(p(kw::compile_threads))>(p(kw::compile_threads));
+                } else {
+                    return 1;
+                }
+            }();
+
+            return std::tuple{std::move(mod_name), opt_level, fmath,    i_func,   std::move(c_dir),
+                              std::move(t_cpu),    slp_vec,   loop_vec, c_threads};
         }
     }
-    explicit llvm_state(std::tuple<std::string, unsigned, bool, bool> &&);
+    explicit llvm_state(
+        std::tuple<std::string, unsigned, bool, bool, std::string, std::string, bool, bool, unsigned> &&);
 
     // Small shared helper to setup the math flags in the builder at the
     // end of a constructor.
@@ -160,19 +336,34 @@ public:
     unsigned &opt_level();
     bool &fast_math();
     bool &inline_functions();
+    bool &slp_vectorize();
+    bool &loop_vectorize();
+    unsigned &compile_threads();
 
     const std::string &module_name() const;
+    const std::string &cache_dir() const;
+    const std::string &target_cpu() const;
     const llvm::Module &module() const;
     const ir_builder &builder() const;
     const llvm::LLVMContext &context() const;
     const unsigned &opt_level() const;
     const bool &fast_math() const;
     const bool &inline_functions() const;
+    const bool &slp_vectorize() const;
+    const bool &loop_vectorize() const;
+    const unsigned &compile_threads() const;
 
     std::string get_ir() const;
+    std::string get_bc() const;
     void dump_object_code(const std::string &) const;
     const std::string &get_object_code() const;
 
+#if defined(HEYOKA_WITH_NVPTX)
+
+    std::string get_ptx(const std::string & = "sm_60", const std::string & = "") const;
+
+#endif
+
     void verify_function(const std::string &);
     void verify_function(llvm::Function *);
 
@@ -183,6 +374,41 @@ public:
     void compile();
 
     std::uintptr_t jit_lookup(const std::string &);
+
+    const llvm_state_timings &get_timings() const;
+    const std::vector<llvm_opt_remark> &get_opt_remarks() const;
+    llvm_state_memory_usage get_memory_usage() const;
+
+    // Binary serialisation.
+    void save(std::ostream &) const;
+    void load(std::istream &);
+
+    // In-memory cache management.
+    static std::size_t get_memcache_size();
+    static std::size_t get_memcache_limit();
+    static void set_memcache_limit(std::size_t);
+    static void clear_memcache();
+
+    // Pool of pre-initialised jit instances. If the size
+    // of the pool is nonzero, the jit instances for the host CPU
+    // are created ahead of time by a background thread, which
+    // reduces the construction cost of an llvm_state.
+    static std::size_t get_jit_pool_size();
+    static void set_jit_pool_size(std::size_t);
+
+    // Collection of the optimisation remarks. If enabled, the remarks
+    // of the vectorisation and inlining passes are recorded during
+    // optimise() and they can be fetched via get_opt_remarks().
+    // NOTE: the collection is disabled by default, as it
+    // increases the optimisation time.
+    static bool get_opt_remarks_enabled();
+    static void set_opt_remarks_enabled(bool);
+
+    // Registration of external symbols. A registered symbol can be
+    // invoked by name from the compiled code of any llvm_state, and it takes
+    // the precedence over the symbols of the current process with the same name.
+    // NOTE: a symbol cannot be re-registered with a different address.
+    static void add_symbol(const std::string &, void *);
 };
 
 } // namespace heyoka
@@ -23,7 +23,7 @@ namespace detail
 
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
     make_mascon_system_impl(expression, std::vector<std::vector<expression>>, std::vector<expression>, expression,
-                            expression, expression);
+                            expression, expression, bool = false, double = 0., double = 0.);
 
 HEYOKA_DLL_PUBLIC expression energy_mascon_system_impl(expression, std::vector<expression>,
                                                        std::vector<std::vector<expression>>, std::vector<expression>,
@@ -36,6 +36,16 @@ HEYOKA_DLL_PUBLIC expression energy_mascon_system_impl(expression, std::vector<e
 // pd, qd, rd -> angular velocity of the asteroid in the frame used for the mascon model (units rad/T)
 //
 // GConst kwarg -> Cavendish constant (units L^3/T^2/M)
+// fused kwarg -> if true, the gravitational acceleration is expressed via the fused mascon_acc() function,
+// which loops over the mascon points at runtime (the positions and masses must be numerical constants).
+// This keeps the size of the Taylor decomposition, and thus the compilation time, independent of
+// the number of mascon points. Defaults to false.
+// theta kwarg -> if nonzero, the mascon model is replaced by its Barnes-Hut approximation: the points are clustered
+// in an octree, and the cells whose size is less than theta times a lower bound on their distance from the orbiting
+// point are replaced by a single point at their centre of mass. Defaults to zero (no approximation).
+// min_distance kwarg -> the minimum distance of the orbit from the origin of the mascon frame (units L), used to
+// bound the distance between the cells and the orbiting point. Must be provided if theta is nonzero. The
+// approximation is accurate only as long as the orbiting point does not get closer than min_distance to the origin.
 // Note, units must be consistent. Choosing L and M is done via the mascon model, T is derived by the value of G. The
 // angular velocity must be consequent (equivalently one can choose the units for w and induce them on the value of G).
 template <typename... KwArgs>
@@ -95,8 +105,36 @@ inline std::vector<std::pair<expression, expression>> make_mascon_system(KwArgs
             static_assert(detail::always_false_v<KwArgs...>, "omega is missing from the kwarg list!");
         };
 
+        // fused (defaults to false).
+        auto fused = [&p]() -> bool {
+            if constexpr (p.has(kw::fused)) {
+                return std::forward<decltype(p(kw::fused))>(p(kw::fused));
+            } else {
+                return false;
+            }
+        }();
+
+        // theta (defaults to zero).
+        auto theta = [&p]() -> double {
+            if constexpr (p.has(kw::theta)) {
+                return std::forward<decltype(p(kw::theta))>(p(kw::theta));
+            } else {
+                return 0.;
+            }
+        }();
+
+        // min_distance (defaults to zero).
+        auto min_distance = [&p]() -> double {
+            if constexpr (p.has(kw::min_distance)) {
+                return std::forward<decltype(p(kw::min_distance))>(p(kw::min_distance));
+            } else {
+                return 0.;
+            }
+        }();
+
         return detail::make_mascon_system_impl(std::move(Gconst), std::move(mascon_points), std::move(mascon_masses),
-                                               std::move(pe), std::move(qe), std::move(re));
+                                               std::move(pe), std::move(qe), std::move(re), fused, theta,
+                                               min_distance);
     }
 }
 
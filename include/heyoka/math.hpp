@@ -20,18 +20,24 @@
 #include <heyoka/math/cosh.hpp>
 #include <heyoka/math/erf.hpp>
 #include <heyoka/math/exp.hpp>
+#include <heyoka/math/ext_func.hpp>
 #include <heyoka/math/kepE.hpp>
 #include <heyoka/math/log.hpp>
+#include <heyoka/math/mascon_acc.hpp>
+#include <heyoka/math/nbody_acc.hpp>
 #include <heyoka/math/neg.hpp>
+#include <heyoka/math/poly.hpp>
 #include <heyoka/math/pow.hpp>
 #include <heyoka/math/sigmoid.hpp>
 #include <heyoka/math/sin.hpp>
 #include <heyoka/math/sinh.hpp>
 #include <heyoka/math/sqrt.hpp>
 #include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
 #include <heyoka/math/tan.hpp>
 #include <heyoka/math/tanh.hpp>
 #include <heyoka/math/time.hpp>
 #include <heyoka/math/tpoly.hpp>
+#include <heyoka/math/tpwpoly.hpp>
 
 #endif
@@ -0,0 +1,103 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_EXT_FUNC_HPP
+#define HEYOKA_MATH_EXT_FUNC_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+// The signature of the kernels computing the Taylor derivatives of an external function:
+//
+// void kernel(T *out, std::uint32_t order, const T *a, const T *f, std::uint32_t batch_size);
+//
+// The kernel must write into out the batch_size values of the normalised derivative
+// of order 'order' of the function. a contains the normalised derivatives of orders
+// [0, order] of the n arguments, with the derivative of order o of the argument j
+// for the batch element b at index (o * n + j) * batch_size + b. f contains the
+// normalised derivatives of orders [0, order) of the function itself, with the
+// derivative of order o for the batch element b at index o * batch_size + b.
+// The kernel must not throw.
+template <typename T>
+using ext_kernel_t = void (*)(T *, std::uint32_t, const T *, const T *, std::uint32_t);
+
+namespace detail
+{
+
+// External function, whose Taylor derivatives are computed by a user-supplied kernel.
+// The kernel is invoked from the compiled code via the symbol name + "_dbl" (or "_ldbl",
+// "_f128", depending on the floating-point type).
+class HEYOKA_DLL_PUBLIC ext_func_impl : public func_base
+{
+    std::string m_kernel;
+
+public:
+    ext_func_impl();
+    explicit ext_func_impl(std::string, std::vector<expression>);
+
+    const std::string &get_kernel() const;
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+} // namespace detail
+
+// Create an external function of the arguments args, whose Taylor derivatives are computed
+// by the kernel(s) registered under the name 'kernel' via register_ext_kernel(). The kernel name
+// must be a valid C identifier. Instead of registering the kernels, it is also possible to export
+// them from the current process as C functions called kernel + "_dbl", kernel + "_ldbl", etc.
+// NOTE: the external functions are opaque, that is, they cannot be evaluated
+// or differentiated symbolically.
+HEYOKA_DLL_PUBLIC expression ext_func(std::string, std::vector<expression>);
+
+// Register the kernels (one for each floating-point type) of the external functions called 'kernel'.
+HEYOKA_DLL_PUBLIC void register_ext_kernel(const std::string &, ext_kernel_t<double>);
+HEYOKA_DLL_PUBLIC void register_ext_kernel(const std::string &, ext_kernel_t<long double>);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC void register_ext_kernel(const std::string &, ext_kernel_t<mppp::real128>);
+
+#endif
+
+} // namespace heyoka
+
+#endif
@@ -38,6 +38,12 @@ public:
     kepE_impl();
     explicit kepE_impl(expression, expression);
 
+    llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+    llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *codegen_f128(llvm_state &, const std::vector<llvm::Value *> &) const;
+#endif
+
     expression diff(const std::string &) const;
 
     taylor_dc_t::size_type taylor_decompose(taylor_dc_t &) &&;
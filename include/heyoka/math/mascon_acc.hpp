@@ -0,0 +1,105 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_MASCON_ACC_HPP
+#define HEYOKA_MATH_MASCON_ACC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/config.hpp>
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/number.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// One Cartesian component of the acceleration generated by a mascon model
+// on a point of coordinates (x, y, z),
+// sum_j m_j * (x_j - x) / r_j**3.
+// Here x_j and m_j are the coordinate and the mass of the j-th mascon point,
+// and r_j is the distance between the mascon point and (x, y, z).
+// The arguments of the function are x, y and z. The positions
+// and masses of the mascon points are not stored as arguments,
+// rather they are codegenned as a global constant array which is
+// looped over at runtime. Thus, the size of the mascon model affects
+// neither the size of the Taylor decomposition nor the compilation time.
+// The positions of the points are stored in row-major format
+// with shape (n_points, 3).
+class HEYOKA_DLL_PUBLIC mascon_acc_impl : public func_base
+{
+    std::uint32_t m_comp;
+    std::vector<number> m_points;
+    std::vector<number> m_masses;
+
+public:
+    mascon_acc_impl();
+    explicit mascon_acc_impl(std::uint32_t, expression, expression, expression, std::vector<number>,
+                             std::vector<number>);
+
+    std::uint32_t get_comp() const;
+    const std::vector<number> &get_points() const;
+    const std::vector<number> &get_masses() const;
+
+    bool extra_equal_to(const func &) const;
+
+    std::size_t extra_hash() const;
+
+    llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+    llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *codegen_f128(llvm_state &, const std::vector<llvm::Value *> &) const;
+#endif
+
+    expression diff(const std::string &) const;
+
+    double eval_dbl(const std::unordered_map<std::string, double> &, const std::vector<double> &) const;
+    long double eval_ldbl(const std::unordered_map<std::string, long double> &, const std::vector<long double> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    mppp::real128 eval_f128(const std::unordered_map<std::string, mppp::real128> &,
+                            const std::vector<mppp::real128> &) const;
+#endif
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+} // namespace detail
+
+// The three Cartesian components of the acceleration generated on
+// the point (x, y, z) by the mascon model with the given points
+// (flattened (n_points, 3) array in row-major format) and masses.
+HEYOKA_DLL_PUBLIC std::vector<expression> mascon_acc(expression, expression, expression, std::vector<number>,
+                                                     std::vector<number>);
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,127 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_NBODY_ACC_HPP
+#define HEYOKA_MATH_NBODY_ACC_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/config.hpp>
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// The squared distance between two bodies,
+// (x1 - x0)**2 + (y1 - y0)**2 + (z1 - z0)**2.
+// The arguments are stored in the order
+// x0, y0, z0, x1, y1, z1.
+class HEYOKA_DLL_PUBLIC nbody_r2_impl : public func_base
+{
+public:
+    nbody_r2_impl();
+    explicit nbody_r2_impl(expression, expression, expression, expression, expression, expression);
+
+    llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+    llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *codegen_f128(llvm_state &, const std::vector<llvm::Value *> &) const;
+#endif
+
+    expression diff(const std::string &) const;
+
+    double eval_dbl(const std::unordered_map<std::string, double> &, const std::vector<double> &) const;
+    long double eval_ldbl(const std::unordered_map<std::string, long double> &, const std::vector<long double> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    mppp::real128 eval_f128(const std::unordered_map<std::string, mppp::real128> &,
+                            const std::vector<mppp::real128> &) const;
+#endif
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+// One Cartesian component of the total acceleration acting on a body,
+// sum_j c_j * (x_j - x) * r_m3_j.
+// Here x is the coordinate of the body, x_j the coordinate
+// of the j-th attracting body, c_j the corresponding coefficient
+// (e.g., G * m_j) and r_m3_j the inverse of the cube of the distance between
+// the two bodies. The arguments are stored in the order
+// x, c_0, x_0, r_m3_0, c_1, x_1, r_m3_1, etc.
+class HEYOKA_DLL_PUBLIC nbody_acc_impl : public func_base
+{
+public:
+    nbody_acc_impl();
+    explicit nbody_acc_impl(expression, std::vector<expression>, std::vector<expression>, std::vector<expression>);
+
+    llvm::Value *codegen_dbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+    llvm::Value *codegen_ldbl(llvm_state &, const std::vector<llvm::Value *> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *codegen_f128(llvm_state &, const std::vector<llvm::Value *> &) const;
+#endif
+
+    expression diff(const std::string &) const;
+
+    double eval_dbl(const std::unordered_map<std::string, double> &, const std::vector<double> &) const;
+    long double eval_ldbl(const std::unordered_map<std::string, long double> &, const std::vector<long double> &) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    mppp::real128 eval_f128(const std::unordered_map<std::string, mppp::real128> &,
+                            const std::vector<mppp::real128> &) const;
+#endif
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+} // namespace detail
+
+HEYOKA_DLL_PUBLIC expression nbody_r2(expression, expression, expression, expression, expression, expression);
+
+HEYOKA_DLL_PUBLIC expression nbody_acc(expression, std::vector<expression>, std::vector<expression>,
+                                       std::vector<expression>);
+
+} // namespace heyoka
+
+#endif
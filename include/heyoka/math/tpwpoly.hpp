@@ -0,0 +1,88 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MATH_TPWPOLY_HPP
+#define HEYOKA_MATH_TPWPOLY_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <heyoka/config.hpp>
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/func.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// Piecewise polynomial of time, tabulated in the array of parameters.
+// The arguments are the params marking the begin of the knots, the begin
+// of the coefficients and the end of the coefficients (see tpwpoly()).
+class HEYOKA_DLL_PUBLIC tpwpoly_impl : public func_base
+{
+public:
+    // NOTE: we will cache the indices
+    // for convenience.
+    std::uint32_t m_b_idx, m_c_idx, m_e_idx;
+
+    tpwpoly_impl();
+    explicit tpwpoly_impl(expression, expression, expression);
+
+    void to_stream(std::ostream &) const;
+
+    std::uint32_t get_n_segments() const;
+    std::uint32_t get_degree() const;
+
+    llvm::Value *taylor_diff_dbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                 llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                 std::uint32_t) const;
+    llvm::Value *taylor_diff_ldbl(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Value *taylor_diff_f128(llvm_state &, const std::vector<std::uint32_t> &, const std::vector<llvm::Value *> &,
+                                  llvm::Value *, llvm::Value *, std::uint32_t, std::uint32_t, std::uint32_t,
+                                  std::uint32_t) const;
+#endif
+
+    llvm::Function *taylor_c_diff_func_dbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+    llvm::Function *taylor_c_diff_func_ldbl(llvm_state &, std::uint32_t, std::uint32_t) const;
+#if defined(HEYOKA_HAVE_REAL128)
+    llvm::Function *taylor_c_diff_func_f128(llvm_state &, std::uint32_t, std::uint32_t) const;
+#endif
+};
+
+HEYOKA_DLL_PUBLIC bool is_tpwpoly(const expression &);
+
+// The knots of the piecewise polynomials of time in a Taylor decomposition,
+// represented as a list of (index of the first knot in the array of parameters,
+// number of knots) pairs.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<std::uint32_t, std::uint32_t>> tpwpoly_knots(const taylor_dc_t &);
+
+} // namespace detail
+
+// Piecewise polynomial of time, whose knots and coefficients are read at runtime
+// from the array of parameters. The first argument is the param containing the first
+// knot, followed by the number of segments n and the degree d of the polynomials. The array
+// of parameters must contain, starting from the first knot:
+// - the n + 1 knots t_0 < t_1 < ... < t_n,
+// - for each segment k, the d + 1 coefficients a_{k,0}, ..., a_{k,d} of the polynomial
+//   sum_i a_{k,i} * (t - t_k)**i, which is used for t_k <= t < t_{k+1}.
+// Before t_0 and after t_n, the polynomials of the first and last segments are used.
+// The adaptive integrators limit the timesteps so that they do not cross the knots.
+HEYOKA_DLL_PUBLIC expression tpwpoly(expression, std::uint32_t, std::uint32_t);
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,115 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MPI_ENSEMBLE_HPP
+#define HEYOKA_MPI_ENSEMBLE_HPP
+
+#include <heyoka/config.hpp>
+
+#if defined(HEYOKA_WITH_MPI)
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <mpi.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+// Implementations of the MPI functions.
+HEYOKA_DLL_PUBLIC taylor_adaptive<double> mpi_bcast_integrator_impl(MPI_Comm, int, const taylor_adaptive<double> *,
+                                                                    std::vector<t_event<double>>,
+                                                                    std::vector<nt_event<double>>);
+HEYOKA_DLL_PUBLIC ensemble_res<double>
+mpi_ensemble_propagate_until_impl(MPI_Comm, int, const taylor_adaptive<double> *, double, const std::vector<double> &,
+                                  unsigned, std::size_t, double,
+                                  const std::function<bool(taylor_adaptive<double> &)> &, bool);
+
+HEYOKA_DLL_PUBLIC taylor_adaptive<long double>
+mpi_bcast_integrator_impl(MPI_Comm, int, const taylor_adaptive<long double> *, std::vector<t_event<long double>>,
+                          std::vector<nt_event<long double>>);
+HEYOKA_DLL_PUBLIC ensemble_res<long double>
+mpi_ensemble_propagate_until_impl(MPI_Comm, int, const taylor_adaptive<long double> *, long double,
+                                  const std::vector<long double> &, unsigned, std::size_t, long double,
+                                  const std::function<bool(taylor_adaptive<long double> &)> &, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC taylor_adaptive<mppp::real128>
+mpi_bcast_integrator_impl(MPI_Comm, int, const taylor_adaptive<mppp::real128> *, std::vector<t_event<mppp::real128>>,
+                          std::vector<nt_event<mppp::real128>>);
+HEYOKA_DLL_PUBLIC ensemble_res<mppp::real128>
+mpi_ensemble_propagate_until_impl(MPI_Comm, int, const taylor_adaptive<mppp::real128> *, mppp::real128,
+                                  const std::vector<mppp::real128> &, unsigned, std::size_t, mppp::real128,
+                                  const std::function<bool(taylor_adaptive<mppp::real128> &)> &, bool);
+
+#endif
+
+} // namespace detail
+
+// Broadcast the integrator ta from the rank root to all the
+// ranks in the communicator comm. The integrator is serialised
+// together with its compiled code, so that the other ranks
+// do not need to JIT-compile the system again. ta is used only on
+// the root rank (where it can be a null pointer on the other ranks).
+// NOTE: the callbacks of the events cannot be serialised, thus the
+// events must be passed to this function on all the ranks but the root
+// (see taylor_adaptive::load()).
+// NOTE: this is a collective operation, it must be invoked on all the ranks.
+// The integrator is transmitted in binary form, thus all the ranks must
+// run on the same architecture.
+template <typename T>
+inline taylor_adaptive<T> mpi_bcast_integrator(MPI_Comm comm, int root, const taylor_adaptive<T> *ta,
+                                               std::vector<t_event<T>> tes = {}, std::vector<nt_event<T>> ntes = {})
+{
+    return detail::mpi_bcast_integrator_impl(comm, root, ta, std::move(tes), std::move(ntes));
+}
+
+// Ensemble propagation distributed over the ranks of the communicator comm.
+// The integrator ta and the initial conditions ics (a row-major buffer of shape
+// (n_iter, dim)) are read only on the rank root. The integrator is broadcast
+// once via mpi_bcast_integrator(), the initial conditions are scattered in
+// contiguous blocks across the ranks, and each rank propagates its block up to
+// the time t via ensemble_propagate_until(). The results are gathered in iteration
+// order into the return value on the root rank, while an empty ensemble_res is
+// returned on the other ranks. The kwargs are the same as
+// in ensemble_propagate_until(), and they apply to the propagations on each rank.
+// NOTE: this is a collective operation, it must be invoked on all the ranks
+// with the same kwargs. Integrators with events are not supported.
+// If an error occurs on any rank, an exception is raised on all the ranks.
+template <typename T, typename... KwArgs>
+inline ensemble_res<T> mpi_ensemble_propagate_until(MPI_Comm comm, int root, const taylor_adaptive<T> *ta, T t,
+                                                    const std::vector<T> &ics, KwArgs &&...kw_args)
+{
+    auto [n_threads, max_steps, max_delta_t, cb, pin_threads]
+        = detail::ensemble_propagate_common_ops<T, false>(std::forward<KwArgs>(kw_args)...);
+
+    return detail::mpi_ensemble_propagate_until_impl(comm, root, ta, t, ics, n_threads, max_steps, max_delta_t, cb,
+                                                     pin_threads);
+}
+
+} // namespace heyoka
+
+#endif
+
+#endif
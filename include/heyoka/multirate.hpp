@@ -0,0 +1,186 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_MULTIRATE_HPP
+#define HEYOKA_MULTIRATE_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Multirate integrator for ODE systems with widely separated timescales.
+// The state variables are partitioned into a fast and a slow subsystem,
+// which are integrated by two separate adaptive integrators. In each
+// (macro) step, the slow subsystem takes an adaptive timestep with the
+// fast variables frozen at their values at the beginning of the step. The
+// fast subsystem is then propagated over the same time interval with its own
+// (smaller) timesteps, in which the slow variables are replaced by the Taylor
+// polynomials of the slow timestep (i.e., the dense output of the slow
+// integrator). This way, the right-hand sides of the slow equations are not
+// evaluated at the timesteps of the fast subsystem.
+// NOTE: the coupling of the fast variables into the slow subsystem is first-order
+// accurate in the slow timestep, thus the scheme is suitable for systems in
+// which the slow variables depend weakly on the fast ones (e.g., a hierarchical
+// N-body system in which the fast bodies are light or close to each other).
+// Optional kwargs: kw::time (defaults to zero), kw::tol (defaults to the
+// epsilon of T), kw::high_accuracy, kw::compact_mode (both default to false)
+// and kw::pars (defaults to zeroes).
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_multirate
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    // The indices of the slow and fast state variables
+    // in the state vector of the original system.
+    std::vector<std::uint32_t> m_slow_idx;
+    std::vector<std::uint32_t> m_fast_idx;
+    // The number of runtime parameters
+    // of the original system.
+    std::uint32_t m_n_pars;
+    // The state vector of the original system.
+    std::vector<T> m_state;
+    // The slow and fast integrators.
+    // NOTE: these are constructed after the other
+    // data members, which are needed to set them up.
+    taylor_adaptive<T> m_slow;
+    taylor_adaptive<T> m_fast;
+
+    struct private_ctor_t {
+    };
+    // NOTE: the tuple contains the time, the tolerance, the
+    // high accuracy and compact mode flags and the runtime parameters.
+    explicit taylor_multirate(private_ctor_t, std::vector<std::pair<expression, expression>>, std::vector<T>,
+                              const std::vector<expression> &, std::tuple<T, T, bool, bool, std::vector<T>>);
+
+    template <typename... KwArgs>
+    static auto parse_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments to the constructor of a multirate integrator contain "
+                          "unnamed arguments.");
+            throw;
+        } else {
+            // Initial time (defaults to zero).
+            auto time = [&p]() -> T {
+                if constexpr (p.has(kw::time)) {
+                    return std::forward<decltype(p(kw::time))>(p(kw::time));
+                } else {
+                    return T(0);
+                }
+            }();
+
+            // Tolerance (defaults to eps).
+            auto tol = [&p]() -> T {
+                if constexpr (p.has(kw::tol)) {
+                    return std::forward<decltype(p(kw::tol))>(p(kw::tol));
+                } else {
+                    return std::numeric_limits<T>::epsilon();
+                }
+            }();
+
+            // High accuracy mode (defaults to false).
+            auto high_accuracy = [&p]() -> bool {
+                if constexpr (p.has(kw::high_accuracy)) {
+                    return std::forward<decltype(p(kw::high_accuracy))>(p(kw::high_accuracy));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Compact mode (defaults to false).
+            auto compact_mode = [&p]() -> bool {
+                if constexpr (p.has(kw::compact_mode)) {
+                    return std::forward<decltype(p(kw::compact_mode))>(p(kw::compact_mode));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Runtime parameters (defaults to empty).
+            auto pars = [&p]() -> std::vector<T> {
+                if constexpr (p.has(kw::pars)) {
+                    return std::forward<decltype(p(kw::pars))>(p(kw::pars));
+                } else {
+                    return {};
+                }
+            }();
+
+            return std::tuple<T, T, bool, bool, std::vector<T>>{time, tol, high_accuracy, compact_mode,
+                                                                std::move(pars)};
+        }
+    }
+
+    HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T, std::size_t> step_impl(T);
+
+public:
+    // NOTE: fast_vars is the list of the state
+    // variables belonging to the fast subsystem.
+    template <typename... KwArgs>
+    explicit taylor_multirate(std::vector<std::pair<expression, expression>> sys, std::vector<T> state,
+                              const std::vector<expression> &fast_vars, KwArgs &&...kw_args)
+        : taylor_multirate(private_ctor_t{}, std::move(sys), std::move(state), fast_vars, parse_ops(kw_args...))
+    {
+    }
+
+    taylor_multirate(const taylor_multirate &);
+    taylor_multirate(taylor_multirate &&) noexcept;
+
+    taylor_multirate &operator=(const taylor_multirate &);
+    taylor_multirate &operator=(taylor_multirate &&) noexcept;
+
+    ~taylor_multirate();
+
+    const taylor_adaptive<T> &get_slow_ta() const;
+    const taylor_adaptive<T> &get_fast_ta() const;
+    const std::vector<std::uint32_t> &get_slow_idx() const;
+    const std::vector<std::uint32_t> &get_fast_idx() const;
+
+    T get_time() const;
+    const std::vector<T> &get_state() const;
+    void set_state(const std::vector<T> &);
+    void set_time(T);
+
+    // Perform a single macro step. The return value contains the
+    // outcome of the step, the size of the slow timestep and the
+    // number of timesteps of the fast subsystem.
+    std::tuple<taylor_outcome, T, std::size_t> step();
+    std::tuple<taylor_outcome, T, std::size_t> step(T);
+    // Propagate up to the time t. The return value contains the
+    // outcome of the propagation (as in taylor_adaptive::propagate_until())
+    // and the numbers of timesteps of the slow and fast subsystems.
+    // NOTE: a max_steps of zero means no limit on the number of macro steps.
+    std::tuple<taylor_outcome, std::size_t, std::size_t> propagate_until(T, std::size_t = 0);
+};
+
+} // namespace heyoka
+
+#endif
@@ -34,8 +34,14 @@ namespace detail
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::uint32_t, number,
                                                                                              std::vector<number>);
 
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_fused(std::uint32_t, number,
+                                                                                      std::vector<number>);
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_nbody_sys_tree(std::uint32_t, number, std::vector<number>, double, std::vector<double>, bool);
+
 HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::uint32_t, number,
-                                                                                           std::uint32_t);
+                                                                                           std::uint32_t, bool);
 
 } // namespace detail
 
@@ -44,11 +50,31 @@ HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>> make_nbody_sys_
 // can be passed:
 //
 // - 'masses', which contains the numerical values of the masses,
-// - 'Gconst', which contains the numerical value of the gravitational constant.
+// - 'Gconst', which contains the numerical value of the gravitational constant,
+// - 'fused', a boolean flag which, if true, signals that the accelerations
+//   are to be expressed via the fused N-body functions nbody_r2() and nbody_acc(),
+// - 'theta', the opening angle of the Barnes-Hut tree approximation,
+// - 'state', the reference state used to build the tree approximation.
 //
 // 'Gconst' defaults to a value of 1 if not specified.
 // If 'masses' is not specified, all masses have a
-// constant numerical value of 1.
+// constant numerical value of 1. 'fused' defaults to false.
+// 'theta' defaults to zero, meaning that the accelerations are computed exactly.
+// If 'theta' is nonzero, the massive bodies are clustered in an octree
+// built from their positions in 'state' (which must have the same layout
+// as the state vector of the system), and groups of bodies far enough
+// from a body are replaced by their centre of mass in the computation
+// of the acceleration on that body. Smaller values of 'theta' result in
+// a higher accuracy and in a larger number of interactions. Because the interaction
+// lists are fixed at construction time, the accuracy of the approximation degrades
+// if the configuration of the bodies departs substantially from 'state',
+// in which case the system should be re-created.
+// In the fused formulation, each pair of bodies contributes only two
+// u variables to the Taylor decomposition, and each component of the
+// acceleration on a body is computed by a single u variable. This greatly
+// reduces the size of the decomposition (and thus the compilation time
+// and the memory usage of the integrator) for large numbers of bodies,
+// especially in compact mode.
 //
 // The returned system consists of the differential equations for the state of each body,
 // in the following order:
@@ -95,7 +121,42 @@ inline std::vector<std::pair<expression, expression>> make_nbody_sys(std::uint32
             masses_vec.resize(static_cast<decltype(masses_vec.size())>(n), number{1.});
         }
 
-        return detail::make_nbody_sys_fixed_masses(n, std::move(G_const), std::move(masses_vec));
+        // Fused formulation (defaults to false).
+        auto fused = [&p]() -> bool {
+            if constexpr (p.has(kw::fused)) {
+                return std::forward<decltype(p(kw::fused))>(p(kw::fused));
+            } else {
+                return false;
+            }
+        }();
+
+        // Opening angle of the tree approximation (defaults to zero).
+        auto theta = [&p]() -> double {
+            if constexpr (p.has(kw::theta)) {
+                return std::forward<decltype(p(kw::theta))>(p(kw::theta));
+            } else {
+                return 0.;
+            }
+        }();
+
+        if (theta != 0) {
+            // Reference state for the tree approximation (no default).
+            std::vector<double> ref_state;
+            if constexpr (p.has(kw::state)) {
+                for (const auto &val : p(kw::state)) {
+                    ref_state.emplace_back(val);
+                }
+            }
+
+            return detail::make_nbody_sys_tree(n, std::move(G_const), std::move(masses_vec), theta,
+                                               std::move(ref_state), fused);
+        }
+
+        if (fused) {
+            return detail::make_nbody_sys_fused(n, std::move(G_const), std::move(masses_vec));
+        } else {
+            return detail::make_nbody_sys_fixed_masses(n, std::move(G_const), std::move(masses_vec));
+        }
     }
 }
 
@@ -103,9 +164,22 @@ namespace kw
 {
 
 IGOR_MAKE_NAMED_ARGUMENT(n_massive);
-
-}
-
+IGOR_MAKE_NAMED_ARGUMENT(par_interactions);
+
+} // namespace kw
+
+// Create an ODE system representing a Newtonian N-body problem in which the masses
+// are runtime parameters. The first n_massive bodies (n_massive defaults to n) are massive,
+// and the mass of the i-th massive body is par[i]. The remaining bodies are massless.
+// If the 'par_interactions' boolean kwarg is true (it defaults to false), the interaction
+// topology is also stored in the runtime parameters: the acceleration exerted by the
+// massive body j on the body i is multiplied by the switch parameter
+// par[n_massive + i * n_massive + j] (the switches with i == j are unused). Setting a switch
+// to 1 (resp. 0) activates (resp. deactivates) the corresponding interaction, so that
+// a change of topology (e.g., the activation of a perturber) is a change in the runtime
+// parameters, which does not require the construction of a new integrator.
+// NOTE: the runtime parameters of the integrators default to zero, thus the switches
+// need to be set explicitly.
 template <typename... KwArgs>
 inline std::vector<std::pair<expression, expression>> make_nbody_par_sys(std::uint32_t n, KwArgs &&...kw_args)
 {
@@ -129,16 +203,25 @@ inline std::vector<std::pair<expression, expression>> make_nbody_par_sys(std::ui
             }
         }();
 
+        // Parameters for the interaction topology (defaults to false).
+        const auto par_inter = [&p]() -> bool {
+            if constexpr (p.has(kw::par_interactions)) {
+                return std::forward<decltype(p(kw::par_interactions))>(p(kw::par_interactions));
+            } else {
+                return false;
+            }
+        }();
+
         if constexpr (p.has(kw::n_massive)) {
             if constexpr (std::is_integral_v<detail::uncvref_t<decltype(p(kw::n_massive))>>) {
-                return detail::make_nbody_sys_par_masses(n, std::move(G_const),
-                                                         boost::numeric_cast<std::uint32_t>(p(kw::n_massive)));
+                return detail::make_nbody_sys_par_masses(
+                    n, std::move(G_const), boost::numeric_cast<std::uint32_t>(p(kw::n_massive)), par_inter);
             } else {
                 static_assert(detail::always_false_v<KwArgs...>,
                               "The n_massive keyword argument must be of integral type.");
             }
         } else {
-            return detail::make_nbody_sys_par_masses(n, std::move(G_const), n);
+            return detail::make_nbody_sys_par_masses(n, std::move(G_const), n, par_inter);
         }
     }
 }
@@ -0,0 +1,224 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_OUTPUT_SINK_HPP
+#define HEYOKA_OUTPUT_SINK_HPP
+
+#include <heyoka/config.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Format of the file written by an output sink.
+enum class sink_format {
+    // Sequence of fixed-size records (see below).
+    raw,
+    // Ephemeris file (see continuous_output::save_ephemeris()).
+    ephemeris
+};
+
+// Behaviour of an output sink when the ring buffer is full.
+enum class sink_policy {
+    // Wait for the writer to free a slot.
+    block,
+    // Discard the snapshot.
+    drop
+};
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(sink_format);
+IGOR_MAKE_NAMED_ARGUMENT(sink_capacity);
+IGOR_MAKE_NAMED_ARGUMENT(sink_policy);
+
+} // namespace kw
+
+// An output sink for long propagations. The snapshots of the integrator
+// pushed via push() (typically from a step callback) are copied into
+// a lock-free single-producer single-consumer ring buffer, which is
+// consumed by a background thread writing the snapshots to a file.
+// In this way, the I/O overlaps with the propagation.
+// In raw format, each snapshot is stored as a record consisting of the
+// time (hi and lo parts), of the size of the last step, of the state vector
+// and, if kw::write_tc is true, of the Taylor coefficients of the last step
+// (in the same layout as get_tc()), in native binary format.
+// In ephemeris format, each snapshot represents a step of the continuous
+// output and the Taylor coefficients are always stored. The Taylor coefficients
+// are streamed to a temporary file, and the ephemeris file is assembled in close().
+// In this format, snapshots of steps of zero size are ignored.
+// Optional kwargs: kw::sink_format (defaults to sink_format::raw), kw::sink_capacity
+// (the number of slots in the ring buffer, defaults to 1024), kw::sink_policy
+// (defaults to sink_policy::block) and kw::write_tc (defaults to false).
+// NOTE: push() must always be invoked from the same thread. The errors
+// raised by the writer are re-thrown by push(), drain() and close().
+template <typename T>
+class HEYOKA_DLL_PUBLIC output_sink
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    std::string m_path;
+    sink_format m_format;
+    sink_policy m_policy;
+    bool m_wtc;
+    std::uint32_t m_dim;
+    std::uint32_t m_order;
+    // The number of slots in the ring buffer
+    // and the size of a slot.
+    std::size_t m_capacity;
+    std::size_t m_rec_size;
+    // The ring buffer.
+    std::vector<T> m_buffer;
+    // Number of snapshots pushed by the producer
+    // and consumed by the writer, respectively.
+    // NOTE: the slot of the n-th snapshot is n % m_capacity.
+    // The counters are kept on separate cache lines in order
+    // to avoid false sharing between the producer and the writer.
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    alignas(64) std::atomic<bool> m_stop{false};
+    // Error flag and exception raised by the writer.
+    // NOTE: m_exc is set before m_error is raised.
+    std::atomic<bool> m_error{false};
+    std::exception_ptr m_exc;
+    // Number of dropped snapshots.
+    std::size_t m_n_dropped = 0;
+    // The output stream (in ephemeris format,
+    // the temporary file of the Taylor coefficients).
+    std::ofstream m_ofs;
+    std::string m_tcs_path;
+    // In ephemeris format, the initial times (hi and lo
+    // parts) and the sizes of the steps.
+    std::vector<T> m_times_hi, m_times_lo, m_hs;
+    bool m_closed = false;
+    std::thread m_writer;
+
+    template <typename... KwArgs>
+    static auto parse_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments to the constructor of an output sink contain "
+                          "unnamed arguments.");
+            throw;
+        } else {
+            // Format (defaults to raw).
+            auto format = [&p]() -> sink_format {
+                if constexpr (p.has(kw::sink_format)) {
+                    return std::forward<decltype(p(kw::sink_format))>(p(kw::sink_format));
+                } else {
+                    return sink_format::raw;
+                }
+            }();
+
+            // Capacity (defaults to 1024).
+            auto capacity = [&p]() -> std::size_t {
+                if constexpr (p.has(kw::sink_capacity)) {
+                    return std::forward<decltype(p(kw::sink_capacity))>(p(kw::sink_capacity));
+                } else {
+                    return 1024;
+                }
+            }();
+
+            // Policy (defaults to block).
+            auto policy = [&p]() -> sink_policy {
+                if constexpr (p.has(kw::sink_policy)) {
+                    return std::forward<decltype(p(kw::sink_policy))>(p(kw::sink_policy));
+                } else {
+                    return sink_policy::block;
+                }
+            }();
+
+            // Write the Taylor coefficients (defaults to false).
+            auto write_tc = [&p]() -> bool {
+                if constexpr (p.has(kw::write_tc)) {
+                    return std::forward<decltype(p(kw::write_tc))>(p(kw::write_tc));
+                } else {
+                    return false;
+                }
+            }();
+
+            return std::tuple{format, capacity, policy, write_tc};
+        }
+    }
+
+    struct private_ctor_t {
+    };
+    explicit output_sink(private_ctor_t, const taylor_adaptive<T> &, std::string,
+                         std::tuple<sink_format, std::size_t, sink_policy, bool>);
+
+    HEYOKA_DLL_LOCAL void writer_loop();
+    HEYOKA_DLL_LOCAL void write_record(const T *);
+    HEYOKA_DLL_LOCAL void check_error() const;
+
+public:
+    template <typename... KwArgs>
+    explicit output_sink(const taylor_adaptive<T> &ta, std::string path, KwArgs &&...kw_args)
+        : output_sink(private_ctor_t{}, ta, std::move(path), parse_ops(kw_args...))
+    {
+    }
+
+    output_sink(const output_sink &) = delete;
+    output_sink(output_sink &&) = delete;
+    output_sink &operator=(const output_sink &) = delete;
+    output_sink &operator=(output_sink &&) = delete;
+
+    // NOTE: the destructor invokes close(),
+    // ignoring any error.
+    ~output_sink();
+
+    // Push a snapshot of the integrator. The return value
+    // is false if the snapshot was dropped.
+    bool push(const taylor_adaptive<T> &);
+    // Wait until the writer has consumed all
+    // the snapshots pushed so far.
+    void drain();
+    // Wait for the writer to process all the snapshots,
+    // stop it and finalise the output file. After close(),
+    // no snapshot can be pushed anymore.
+    void close();
+
+    const std::string &get_path() const;
+    sink_format get_format() const;
+    sink_policy get_policy() const;
+    std::size_t get_capacity() const;
+    bool get_write_tc() const;
+    bool is_closed() const;
+    std::size_t get_n_pushed() const;
+    std::size_t get_n_written() const;
+    std::size_t get_n_dropped() const;
+};
+
+} // namespace heyoka
+
+#endif
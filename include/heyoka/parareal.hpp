@@ -0,0 +1,150 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_PARAREAL_HPP
+#define HEYOKA_PARAREAL_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// The results of a parareal propagation.
+// NOTE: the state vectors at the boundaries of the time
+// slices (including the initial and final times) are stored
+// in a contiguous row-major buffer with shape (n_slices + 1, dim).
+template <typename T>
+struct parareal_res {
+    std::vector<T> states;
+    // The boundaries of the time slices.
+    std::vector<T> times;
+    // Number of iterations performed.
+    std::uint32_t n_iter = 0;
+    // The largest correction of the state vectors
+    // (relative to the magnitude of the components) in the
+    // last iteration.
+    T err = 0;
+    // Convergence flag.
+    bool converged = false;
+};
+
+namespace detail
+{
+
+// Implementations of parareal_propagate_until().
+HEYOKA_DLL_PUBLIC parareal_res<double> parareal_propagate_until_impl(const taylor_adaptive<double> &,
+                                                                     const taylor_adaptive<double> &, double,
+                                                                     std::uint32_t, unsigned, std::uint32_t,
+                                                                     std::size_t, double);
+
+HEYOKA_DLL_PUBLIC parareal_res<long double>
+parareal_propagate_until_impl(const taylor_adaptive<long double> &, const taylor_adaptive<long double> &, long double,
+                              std::uint32_t, unsigned, std::uint32_t, std::size_t, long double);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC parareal_res<mppp::real128>
+parareal_propagate_until_impl(const taylor_adaptive<mppp::real128> &, const taylor_adaptive<mppp::real128> &,
+                              mppp::real128, std::uint32_t, unsigned, std::uint32_t, std::size_t, mppp::real128);
+
+#endif
+
+} // namespace detail
+
+// Propagate the state of the integrator fine up to the time t using
+// the parareal algorithm. The time interval is split into n_slices slices
+// of equal length. In each iteration, the slices are propagated in parallel
+// with copies of fine, and the predictions at the boundaries of the slices
+// are corrected sequentially with the (cheap) integrator coarse, e.g., an
+// integrator for the same system with a lower order or a looser tolerance.
+// The iterations stop when the corrections are smaller than kw::tol
+// (defaults to 100 times the epsilon of T), or after kw::max_iter
+// iterations (defaults to n_slices, after which the algorithm
+// reproduces exactly the sequential propagation with fine).
+// kw::n_threads is the number of threads (defaults to zero, which means
+// using all the available hardware threads) and kw::max_steps the
+// max number of steps for the propagation of each slice
+// (defaults to zero, i.e., no limit).
+// NOTE: the initial conditions and the parameters are taken from fine.
+// Integrators with events are not supported, as the callbacks
+// would be invoked multiple times and concurrently.
+// NOTE: the type T must be specified explicitly, e.g.,
+// parareal_propagate_until<double>(fine, coarse, 10., 16).
+template <typename T, typename... KwArgs>
+inline parareal_res<T> parareal_propagate_until(const taylor_adaptive<T> &fine, const taylor_adaptive<T> &coarse, T t,
+                                                std::uint32_t n_slices, KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments to parareal_propagate_until() contain unnamed arguments.");
+        throw;
+    } else {
+        // Number of threads (defaults to zero).
+        auto n_threads = [&p]() -> unsigned {
+            if constexpr (p.has(kw::n_threads)) {
+                return std::forward<decltype(p(kw::n_threads))>(p(kw::n_threads));
+            } else {
+                return 0;
+            }
+        }();
+
+        // Max number of iterations (defaults to n_slices).
+        auto max_iter = [&p, n_slices]() -> std::uint32_t {
+            if constexpr (p.has(kw::max_iter)) {
+                return std::forward<decltype(p(kw::max_iter))>(p(kw::max_iter));
+            } else {
+                return n_slices;
+            }
+        }();
+
+        // Max number of steps per slice (defaults to zero).
+        auto max_steps = [&p]() -> std::size_t {
+            if constexpr (p.has(kw::max_steps)) {
+                return std::forward<decltype(p(kw::max_steps))>(p(kw::max_steps));
+            } else {
+                return 0;
+            }
+        }();
+
+        // Convergence tolerance (defaults to 100 epsilons).
+        auto tol = [&p]() -> T {
+            if constexpr (p.has(kw::tol)) {
+                return std::forward<decltype(p(kw::tol))>(p(kw::tol));
+            } else {
+                return std::numeric_limits<T>::epsilon() * 100;
+            }
+        }();
+
+        return detail::parareal_propagate_until_impl(fine, coarse, t, n_slices, n_threads, max_iter, max_steps, tol);
+    }
+}
+
+} // namespace heyoka
+
+#endif
@@ -0,0 +1,171 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_RESUMABLE_PROPAGATION_HPP
+#define HEYOKA_RESUMABLE_PROPAGATION_HPP
+
+#include <heyoka/config.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// A propagation of an adaptive integrator which can be
+// suspended and resumed, so that a scheduler can time-slice
+// many integrators on a small number of threads. The propagation
+// is either up to a final time (as in propagate_until()) or over a
+// time grid (as in propagate_grid()), and it advances only
+// when resume() is invoked. Each invocation of resume() performs at
+// least one step, and it returns after max_steps steps or after the
+// wall-clock time budget has elapsed (whichever comes first). The
+// state of the propagation (counters, min/max timesteps, position
+// in the time grid, etc.) is kept across the invocations of resume().
+// Optional kwargs: kw::max_delta_t (defaults to infinity) and,
+// for the propagation up to a final time, kw::write_tc (defaults
+// to false).
+// NOTE: the object references the integrator, which must
+// outlive it. The integrator must not be modified between the
+// invocations of resume().
+template <typename T>
+class HEYOKA_DLL_PUBLIC resumable_propagation
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    taylor_adaptive<T> *m_ta;
+    // The time grid. In the propagation
+    // up to a final time, this contains
+    // only the final time.
+    std::vector<T> m_grid;
+    bool m_grid_mode;
+    T m_max_delta_t;
+    bool m_wtc;
+    // In grid mode, the flag signalling
+    // that the first grid point was reached,
+    // the index of the next grid point to be
+    // processed and the remaining time.
+    bool m_grid_started = false;
+    std::size_t m_grid_idx = 0;
+    detail::dfloat<T> m_rem_time;
+    // The step counter and the min/max abs of the
+    // integration timesteps, as in propagate_until().
+    std::size_t m_step_counter = 0;
+    T m_min_h = std::numeric_limits<T>::infinity();
+    T m_max_h = 0;
+    // The outcome of the last invocation of
+    // resume(), and the completion flag.
+    taylor_outcome m_outcome = taylor_outcome::step_limit;
+    bool m_done = false;
+    // The output of the propagation over a time grid.
+    std::vector<T> m_output;
+
+    struct private_ctor_t {
+    };
+    explicit resumable_propagation(private_ctor_t, taylor_adaptive<T> &, std::vector<T>, bool, T, bool);
+
+    template <typename... KwArgs>
+    static auto parse_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments to the constructor of a resumable propagation contain "
+                          "unnamed arguments.");
+            throw;
+        } else {
+            // Max delta_t (defaults to positive infinity).
+            auto max_delta_t = [&p]() -> T {
+                if constexpr (p.has(kw::max_delta_t)) {
+                    return std::forward<decltype(p(kw::max_delta_t))>(p(kw::max_delta_t));
+                } else {
+                    return std::numeric_limits<T>::infinity();
+                }
+            }();
+
+            // Write the Taylor coefficients (defaults to false).
+            auto write_tc = [&p]() -> bool {
+                if constexpr (p.has(kw::write_tc)) {
+                    return std::forward<decltype(p(kw::write_tc))>(p(kw::write_tc));
+                } else {
+                    return false;
+                }
+            }();
+
+            return std::pair{max_delta_t, write_tc};
+        }
+    }
+
+    HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T> take_step(const detail::dfloat<T> &, bool);
+    HEYOKA_DLL_LOCAL bool step_until();
+    HEYOKA_DLL_LOCAL bool step_grid();
+    HEYOKA_DLL_LOCAL void finish(taylor_outcome);
+
+public:
+    // Propagation up to the final time t.
+    template <typename... KwArgs>
+    explicit resumable_propagation(taylor_adaptive<T> &ta, T t, KwArgs &&...kw_args)
+        : resumable_propagation(private_ctor_t{}, ta, std::vector<T>{t}, false, parse_ops(kw_args...).first,
+                                parse_ops(kw_args...).second)
+    {
+    }
+    // Propagation over the time grid grid.
+    template <typename... KwArgs>
+    explicit resumable_propagation(taylor_adaptive<T> &ta, std::vector<T> grid, KwArgs &&...kw_args)
+        : resumable_propagation(private_ctor_t{}, ta, std::move(grid), true, parse_ops(kw_args...).first, false)
+    {
+    }
+
+    resumable_propagation(const resumable_propagation &);
+    resumable_propagation(resumable_propagation &&) noexcept;
+
+    resumable_propagation &operator=(const resumable_propagation &);
+    resumable_propagation &operator=(resumable_propagation &&) noexcept;
+
+    ~resumable_propagation();
+
+    // Resume the propagation. A max_steps of zero or
+    // a zero budget mean no limit. The return value is
+    // taylor_outcome::step_limit if the propagation was suspended,
+    // otherwise the final outcome of the propagation (as in
+    // propagate_until()/propagate_grid()).
+    taylor_outcome resume(std::size_t = 0, std::chrono::nanoseconds = std::chrono::nanoseconds{0});
+
+    bool is_done() const;
+    taylor_outcome get_outcome() const;
+    std::size_t get_step_counter() const;
+    T get_min_h() const;
+    T get_max_h() const;
+    // Index of the next grid point to be processed.
+    std::size_t get_grid_idx() const;
+    // The state vectors at the grid points processed
+    // so far, in row-major format.
+    const std::vector<T> &get_output() const;
+};
+
+} // namespace heyoka
+
+#endif
@@ -33,6 +33,17 @@ struct splitmix64 {
         return z ^ (z >> 31);
     }
 
+    // Advance the state as if next() had been invoked n times.
+    // This can be used to derive independent streams from
+    // the same seed (e.g., one stream per thread), by
+    // jumping ahead by multiples of a large number.
+    constexpr void jump(const std::uint64_t &n)
+    {
+        // NOTE: unsigned arithmetic wraps around, which
+        // matches the repeated additions in next().
+        m_state += n * 0x9e3779b97f4a7c15;
+    }
+
     // Provide also an interface compatible with the UniformRandomBitGenerator concept:
     // https://en.cppreference.com/w/cpp/named_req/UniformRandomBitGenerator
     using result_type = std::uint64_t;
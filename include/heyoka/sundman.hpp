@@ -0,0 +1,72 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_SUNDMAN_HPP
+#define HEYOKA_SUNDMAN_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// Sundman time transformation of the autonomous ODE system sys. The physical
+// time t is replaced as independent variable by the fictitious time s,
+// defined by dt = g ds, where g is a positive function of the state
+// variables (and, optionally, of the runtime parameters). The returned system
+// consists of the equations dx/ds = g * f(x) for the state variables of sys,
+// followed by the equation dt/ds = g for the physical time, which becomes the
+// last state variable (named t_name). If g is small at close encounters
+// (e.g., see make_nbody_sundman_g()), the transformation slows down the motion
+// during the encounters, and an adaptive integrator for the transformed system
+// takes timesteps which are much more uniform along the trajectory.
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+sundman_transform(const std::vector<std::pair<expression, expression>> &, const expression &,
+                  const std::string & = "t");
+
+// Time transformation function g = (sum_p 1 / r_p**alpha)**-1 for the N-body systems
+// created by make_nbody_sys(), where r_p is the distance between the bodies in the pair p.
+// The sum runs over the pairs of bodies in pairs (if empty, all the pairs of bodies are
+// considered), which should include the pairs expected to undergo close encounters.
+// The default value of alpha (1.5) makes the fictitious time proportional to the
+// eccentric anomaly in a close Keplerian encounter.
+HEYOKA_DLL_PUBLIC expression make_nbody_sundman_g(std::uint32_t,
+                                                  const std::vector<std::pair<std::uint32_t, std::uint32_t>> & = {},
+                                                  double = 1.5);
+
+// Propagate the integrator ta for a system created by sundman_transform() (in which the physical
+// time is the last state variable) up to the physical time t. When the physical time t is crossed
+// during a timestep, the corresponding fictitious time is located via the Taylor polynomial of the
+// physical time, and the state and the time of the integrator are set, via the dense output,
+// to the values at the physical time t. The return value contains the outcome of the propagation
+// (time_limit if the physical time t was reached, step_limit if max_steps was reached, or the
+// outcome of the timestep which stopped the propagation) and the number of steps taken.
+// NOTE: if max_steps is zero, the number of steps is not limited.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, std::size_t> sundman_propagate_until(taylor_adaptive<T> &, T,
+                                                                                  std::size_t = 0);
+
+} // namespace heyoka
+
+#endif
@@ -11,10 +11,14 @@
 
 #include <heyoka/config.hpp>
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <future>
+#include <istream>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -31,8 +35,11 @@
 
 #endif
 
+#include <heyoka/detail/aligned_buffer.hpp>
 #include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/ed_data.hpp>
 #include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/function_ref.hpp>
 #include <heyoka/detail/igor.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/type_traits.hpp>
@@ -122,6 +129,40 @@ HEYOKA_DLL_PUBLIC std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_deco
 HEYOKA_DLL_PUBLIC std::pair<taylor_dc_t, std::vector<std::uint32_t>>
     taylor_decompose(std::vector<std::pair<expression, expression>>, std::vector<expression>);
 
+HEYOKA_DLL_PUBLIC std::vector<std::uint32_t> taylor_one_way_states(const taylor_dc_t &, std::uint32_t);
+HEYOKA_DLL_PUBLIC std::vector<std::uint32_t> taylor_par_dep_uvars(const taylor_dc_t &, std::uint32_t);
+
+// A precomputed Taylor decomposition of an ODE system, which can be
+// passed to the constructors of the adaptive integrators in place of
+// the ODE system in order to skip the decomposition. Together with
+// its binary serialisation, it allows to restart large simulations
+// without decomposing the system again.
+// NOTE: if the integrator has events, the equations of the terminal
+// events followed by the equations of the non-terminal events must
+// be passed as sv_funcs when decomposing the system.
+class HEYOKA_DLL_PUBLIC taylor_precomputed_dc
+{
+    std::uint32_t m_n_eq = 0;
+    taylor_dc_t m_dc;
+    std::vector<std::uint32_t> m_sv_funcs_dc;
+
+public:
+    taylor_precomputed_dc();
+    explicit taylor_precomputed_dc(std::vector<expression>, std::vector<expression> = {});
+    explicit taylor_precomputed_dc(std::vector<std::pair<expression, expression>>, std::vector<expression> = {});
+
+    std::uint32_t get_n_eq() const;
+    const taylor_dc_t &get_decomposition() const;
+    const std::vector<std::uint32_t> &get_sv_funcs_dc() const;
+
+    // Binary serialisation.
+    // NOTE: the structure of a deserialised decomposition
+    // is validated, but its equivalence with the original
+    // ODE system cannot be checked.
+    void save(std::ostream &) const;
+    static taylor_precomputed_dc load(std::istream &);
+};
+
 HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_jet_dbl(llvm_state &, const std::string &, std::vector<expression>,
                                                  std::uint32_t, std::uint32_t, bool, bool, std::vector<expression>);
 HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_jet_ldbl(llvm_state &, const std::string &, std::vector<expression>,
@@ -191,22 +232,210 @@ taylor_dc_t taylor_add_jet(llvm_state &s, const std::string &name, std::vector<s
     }
 }
 
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_par_jet_dbl(llvm_state &, const std::string &,
+                                                     std::vector<std::pair<expression, expression>>, std::uint32_t,
+                                                     std::uint32_t);
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_par_jet_ldbl(llvm_state &, const std::string &,
+                                                      std::vector<std::pair<expression, expression>>, std::uint32_t,
+                                                      std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_par_jet_f128(llvm_state &, const std::string &,
+                                                      std::vector<std::pair<expression, expression>>, std::uint32_t,
+                                                      std::uint32_t);
+
+#endif
+
+// Add to s two functions for the computation of the jet of Taylor derivatives
+// of all the u variables of the decomposition of sys, with signature
+// void(T *jet, const T *pars, const T *time). The jet array has size
+// (order + 1) * n_uvars * batch_size, and the derivative of order o of the
+// u variable i is stored starting at index (o * n_uvars + i) * batch_size.
+// On input, the first n_eq * batch_size elements must contain the state.
+// The function called name computes the whole jet, while the function
+// called name + "_par" expects a jet previously computed for the same
+// state and time and recomputes only the derivatives of the u variables
+// which depend on the parameters (see taylor_par_dep_uvars()). This is
+// useful when the parameters change frequently but the state does not.
+template <typename T>
+taylor_dc_t taylor_add_par_jet(llvm_state &s, const std::string &name,
+                               std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                               std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return taylor_add_par_jet_dbl(s, name, std::move(sys), order, batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return taylor_add_par_jet_ldbl(s, name, std::move(sys), order, batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return taylor_add_par_jet_f128(s, name, std::move(sys), order, batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+#if defined(HEYOKA_WITH_NVPTX)
+
+// Add to s a GPU kernel called name which performs a single adaptive timestep
+// for multiple trajectories of the ODE system sys with tolerance tol, one
+// trajectory per GPU thread. The PTX code of the kernel can then be
+// generated via llvm_state::get_ptx(). See the implementation for the
+// description of the kernel arguments.
+// NOTE: s must not be compiled, as the kernel
+// cannot be lowered for the host machine.
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_nvptx_step(llvm_state &, const std::string &, std::vector<expression>, double,
+                                                    bool, bool);
+HEYOKA_DLL_PUBLIC taylor_dc_t taylor_add_nvptx_step(llvm_state &, const std::string &,
+                                                    std::vector<std::pair<expression, expression>>, double, bool, bool);
+
+#endif
+
+HEYOKA_DLL_PUBLIC void taylor_ed_warmup_dbl(std::uint32_t, std::uint32_t);
+HEYOKA_DLL_PUBLIC void taylor_ed_warmup_ldbl(std::uint32_t, std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_DLL_PUBLIC void taylor_ed_warmup_f128(std::uint32_t, std::uint32_t);
+
+#endif
+
+// Management of the library of precompiled Taylor derivative functions
+// used in compact mode. The library is shared by all threads, and it
+// is filled on demand when compiling Taylor integrators and jets.
+HEYOKA_DLL_PUBLIC std::size_t taylor_c_diff_lib_size();
+HEYOKA_DLL_PUBLIC void taylor_c_diff_lib_clear();
+
+// Pre-compile the kernels used in event detection by the integrators
+// with the given order and batch size. The kernels are compiled
+// once per process and shared among all threads, thus calling this
+// function at startup avoids the compilation cost at the first
+// event detection.
+template <typename T>
+void taylor_ed_warmup(std::uint32_t order, std::uint32_t batch_size = 1)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        taylor_ed_warmup_dbl(order, batch_size);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        taylor_ed_warmup_ldbl(order, batch_size);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        taylor_ed_warmup_f128(order, batch_size);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
 // Enum to represent the outcome of a stepping/propagate function.
 enum class taylor_outcome : std::int64_t {
     // NOTE: we make these enums start at -2**32 - 1,
     // so that we have 2**32 values in the [-2**32, -1]
     // range to use for signalling stopping terminal events.
-    success = -4294967296ll - 1,      // Integration step was successful, no time/step limits were reached.
-    step_limit = -4294967296ll - 2,   // Maximum number of steps reached.
-    time_limit = -4294967296ll - 3,   // Time limit reached.
-    err_nf_state = -4294967296ll - 4, // Non-finite state detected at the end of the timestep.
-    cb_stop = -4294967296ll - 5       // Propagation stopped by callback.
+    success = -4294967296ll - 1,       // Integration step was successful, no time/step limits were reached.
+    step_limit = -4294967296ll - 2,    // Maximum number of steps reached.
+    time_limit = -4294967296ll - 3,    // Time limit reached.
+    err_nf_state = -4294967296ll - 4,  // Non-finite state detected at the end of the timestep.
+    cb_stop = -4294967296ll - 5,       // Propagation stopped by callback.
+    err_h_collapse = -4294967296ll - 6 // Step-size collapse detected (see set_h_collapse()).
 };
 
+// The outcome codes of the raw stepper (see get_raw_step()).
+inline constexpr std::int32_t taylor_raw_step_success = 0;
+inline constexpr std::int32_t taylor_raw_step_time_limit = 1;
+inline constexpr std::int32_t taylor_raw_step_err_nf_state = 2;
+
 HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, taylor_outcome);
 
 HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, event_direction);
 
+// Performance counters for an adaptive Taylor integrator.
+// NOTE: the timings are measured in seconds.
+struct taylor_perf_counters {
+    // Number of timesteps taken.
+    std::uint64_t n_steps = 0;
+    // Number of timesteps clamped by a time limit.
+    std::uint64_t n_limited_steps = 0;
+    // Number of timesteps which produced a non-finite state.
+    std::uint64_t n_nf_steps = 0;
+    // Number of terminal events which triggered.
+    std::uint64_t n_t_events = 0;
+    // Number of non-terminal events which triggered.
+    std::uint64_t n_nt_events = 0;
+    // Hits/misses of the polynomial arena during event detection
+    // (a miss means that the arena had to be enlarged).
+    std::uint64_t n_poly_cache_hits = 0;
+    std::uint64_t n_poly_cache_misses = 0;
+    // Time spent in the stepper.
+    double stepper_time = 0;
+    // Time spent in event detection.
+    double ed_time = 0;
+    // Time spent in the user-supplied callbacks
+    // (both of the events and of the propagate_*() functions).
+    double cb_time = 0;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_perf_counters &);
+
+// Timings (in seconds) of the phases of the
+// construction of an adaptive Taylor integrator.
+struct taylor_ctor_timings {
+    // Taylor decomposition, CSE and sorting.
+    double decomposition = 0;
+    double cse = 0;
+    double sorting = 0;
+    // Generation of the LLVM IR.
+    double ir_gen = 0;
+    // Optimisation passes.
+    double opt_function_passes = 0;
+    double opt_module_passes = 0;
+    // Generation of the object code.
+    double codegen = 0;
+    // Total construction time.
+    double total = 0;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_ctor_timings &);
+
+// Memory usage (in bytes) of an adaptive Taylor integrator.
+// NOTE: the sizes of the buffers are computed from their
+// capacities. The size of the decomposition and the jit memory
+// are estimates. The sizes of the LLVM machinery include
+// the specialised and fixed-step steppers (if any), and they
+// are shared with the integrators created via shared_copy(),
+// while the decomposition is shared among all the copies.
+struct taylor_memory_usage {
+    // State, parameters, Taylor coefficients and dense output.
+    std::size_t state = 0;
+    std::size_t pars = 0;
+    std::size_t tc = 0;
+    std::size_t d_out = 0;
+    // Event detection: jet of derivatives, detected
+    // events, cooldowns and scratch memory.
+    std::size_t events = 0;
+    // Other internal buffers.
+    std::size_t other = 0;
+    // Taylor decomposition.
+    std::size_t decomposition = 0;
+    // LLVM machinery (see llvm_state_memory_usage).
+    std::size_t bc_snapshot = 0;
+    std::size_t object_code = 0;
+    std::size_t jit = 0;
+    // Total.
+    std::size_t total = 0;
+};
+
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const taylor_memory_usage &);
+
+// The executor of an asynchronous propagation. It is passed the
+// task running the propagation, which it must invoke exactly once
+// (e.g., by submitting it to a thread pool).
+using taylor_executor_t = std::function<void(std::function<void()>)>;
+
+// The flag for the cancellation of an asynchronous propagation.
+using taylor_cancel_flag_t = std::shared_ptr<std::atomic<bool>>;
+
 namespace kw
 {
 
@@ -214,26 +443,97 @@ IGOR_MAKE_NAMED_ARGUMENT(time);
 IGOR_MAKE_NAMED_ARGUMENT(tol);
 IGOR_MAKE_NAMED_ARGUMENT(high_accuracy);
 IGOR_MAKE_NAMED_ARGUMENT(compact_mode);
+IGOR_MAKE_NAMED_ARGUMENT(parallel_mode);
+IGOR_MAKE_NAMED_ARGUMENT(unroll_threshold);
+IGOR_MAKE_NAMED_ARGUMENT(contiguous_jets);
 IGOR_MAKE_NAMED_ARGUMENT(pars);
 IGOR_MAKE_NAMED_ARGUMENT(t_events);
 IGOR_MAKE_NAMED_ARGUMENT(nt_events);
+IGOR_MAKE_NAMED_ARGUMENT(tune_batch_size);
+IGOR_MAKE_NAMED_ARGUMENT(lazy_compile);
+IGOR_MAKE_NAMED_ARGUMENT(fused_step);
+IGOR_MAKE_NAMED_ARGUMENT(separate_ev_jet);
+IGOR_MAKE_NAMED_ARGUMENT(dl_order);
+IGOR_MAKE_NAMED_ARGUMENT(skip_one_way);
+IGOR_MAKE_NAMED_ARGUMENT(h_vars);
+IGOR_MAKE_NAMED_ARGUMENT(ha_vars);
+IGOR_MAKE_NAMED_ARGUMENT(auto_compact_mode);
+IGOR_MAKE_NAMED_ARGUMENT(cm_budget);
+IGOR_MAKE_NAMED_ARGUMENT(order);
+IGOR_MAKE_NAMED_ARGUMENT(tune_order);
+IGOR_MAKE_NAMED_ARGUMENT(lane_tols);
+IGOR_MAKE_NAMED_ARGUMENT(lane_max_steps);
 
 // NOTE: these are used for constructing events.
 IGOR_MAKE_NAMED_ARGUMENT(callback);
 IGOR_MAKE_NAMED_ARGUMENT(cooldown);
 IGOR_MAKE_NAMED_ARGUMENT(direction);
+IGOR_MAKE_NAMED_ARGUMENT(detection_order);
 
 // NOTE: these are used in the
 // propagate_*() functions.
 IGOR_MAKE_NAMED_ARGUMENT(max_steps);
 IGOR_MAKE_NAMED_ARGUMENT(max_delta_t);
 IGOR_MAKE_NAMED_ARGUMENT(write_tc);
+IGOR_MAKE_NAMED_ARGUMENT(nt_buffer);
+
+// NOTE: these are used in the asynchronous
+// propagate_*() functions.
+IGOR_MAKE_NAMED_ARGUMENT(executor);
+IGOR_MAKE_NAMED_ARGUMENT(cancel);
+
+// NOTE: these are used in propagate_grid().
+IGOR_MAKE_NAMED_ARGUMENT(components);
+IGOR_MAKE_NAMED_ARGUMENT(stride);
+IGOR_MAKE_NAMED_ARGUMENT(refill);
+
+// kwargs for the continuous output.
+IGOR_MAKE_NAMED_ARGUMENT(c_output);
+IGOR_MAKE_NAMED_ARGUMENT(chunk_size);
+IGOR_MAKE_NAMED_ARGUMENT(compress_tcs);
 
 } // namespace kw
 
 namespace detail
 {
 
+// Helper for parsing the output options of propagate_grid().
+// The return values are the list of the state components to output
+// (an empty list meaning all components) and the stride of the output
+// buffer (zero meaning that the output buffer is contiguous).
+template <typename... KwArgs>
+inline auto propagate_grid_out_ops(KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    // State components to output (defaults to empty).
+    auto comps = [&p]() -> std::vector<std::uint32_t> {
+        if constexpr (p.has(kw::components)) {
+            return std::forward<decltype(p(kw::components))>(p(kw::components));
+        } else {
+            return {};
+        }
+    }();
+
+    // Stride of the output buffer (defaults to zero).
+    auto stride = [&p]() -> std::size_t {
+        if constexpr (p.has(kw::stride)) {
+            return std::forward<decltype(p(kw::stride))>(p(kw::stride));
+        } else {
+            return 0;
+        }
+    }();
+
+    return std::tuple{std::move(comps), stride};
+}
+
+// The floating-point types which can be used for the output
+// of the propagate_grid() functions in an integrator with
+// floating-point type T.
+template <typename T, typename U>
+inline constexpr bool is_grid_out_fp_v
+    = std::is_same_v<U, T> || std::is_same_v<U, float> || std::is_same_v<U, double>;
+
 // Helper for parsing common options for the Taylor integrators.
 template <typename T, typename... KwArgs>
 inline auto taylor_adaptive_common_ops(KwArgs &&...kw_args)
@@ -283,19 +583,178 @@ inline auto taylor_adaptive_common_ops(KwArgs &&...kw_args)
         }
     }();
 
-    return std::tuple{high_accuracy, tol, compact_mode, std::move(pars)};
+    // Parallel mode (defaults to false).
+    // NOTE: parallel mode has an effect only in compact mode.
+    auto parallel_mode = [&p]() -> bool {
+        if constexpr (p.has(kw::parallel_mode)) {
+            return std::forward<decltype(p(kw::parallel_mode))>(p(kw::parallel_mode));
+        } else {
+            return false;
+        }
+    }();
+
+    // Unroll threshold (defaults to zero).
+    // NOTE: in compact mode, the blocks of calls
+    // to the same derivative function whose size is not greater
+    // than the threshold are fully unrolled, rather than
+    // being executed in a loop. This has no effect
+    // outside compact mode and in parallel mode.
+    auto unroll_threshold = [&p]() -> std::uint32_t {
+        if constexpr (p.has(kw::unroll_threshold)) {
+            return std::forward<decltype(p(kw::unroll_threshold))>(p(kw::unroll_threshold));
+        } else {
+            return 0;
+        }
+    }();
+
+    // Contiguous storage of the jets of derivatives (defaults to false).
+    // NOTE: in compact mode, this stores the derivatives
+    // of each u variable contiguously, rather than order by order.
+    // This has no effect outside compact mode.
+    auto contiguous_jets = [&p]() -> bool {
+        if constexpr (p.has(kw::contiguous_jets)) {
+            return std::forward<decltype(p(kw::contiguous_jets))>(p(kw::contiguous_jets));
+        } else {
+            return false;
+        }
+    }();
+
+    // Mixed-precision state update (defaults to 0, i.e., disabled).
+    // NOTE: in the stepper without events, the Taylor coefficients of
+    // order less than dl_order are accumulated in double-length arithmetic
+    // during the evaluation of the Taylor polynomials, while the higher orders
+    // are accumulated in the working precision.
+    auto dl_order = [&p]() -> std::uint32_t {
+        if constexpr (p.has(kw::dl_order)) {
+            return std::forward<decltype(p(kw::dl_order))>(p(kw::dl_order));
+        } else {
+            return 0;
+        }
+    }();
+
+    // Exclusion of the one-way coupled state variables from the
+    // computation of the timestep (defaults to false).
+    // NOTE: the one-way coupled state variables (e.g., the variational
+    // equations) are those which do not influence the dynamics of the
+    // state variables they depend on (see taylor_one_way_states()).
+    auto skip_one_way = [&p]() -> bool {
+        if constexpr (p.has(kw::skip_one_way)) {
+            return std::forward<decltype(p(kw::skip_one_way))>(p(kw::skip_one_way));
+        } else {
+            return false;
+        }
+    }();
+
+    // List of state variables participating in the timestep
+    // control (defaults to empty, meaning all state variables).
+    auto h_vars = [&p]() -> std::vector<expression> {
+        if constexpr (p.has(kw::h_vars)) {
+            return std::forward<decltype(p(kw::h_vars))>(p(kw::h_vars));
+        } else {
+            return {};
+        }
+    }();
+
+    // List of state variables updated with compensated summation
+    // (defaults to empty, meaning that the choice is made by high_accuracy).
+    // NOTE: if not empty, the stepper without events updates the listed
+    // state variables via compensated summation and the others via the
+    // Horner scheme, regardless of high_accuracy. The dense output and
+    // the state update in the stepper with events are still governed
+    // by high_accuracy.
+    auto ha_vars = [&p]() -> std::vector<expression> {
+        if constexpr (p.has(kw::ha_vars)) {
+            return std::forward<decltype(p(kw::ha_vars))>(p(kw::ha_vars));
+        } else {
+            return {};
+        }
+    }();
+
+    // Taylor order (defaults to 0, i.e., deduced from the tolerance).
+    // NOTE: if nonzero, the order is used in place of the one deduced
+    // from the tolerance, and the timestep is adjusted so that the
+    // tolerance is still satisfied.
+    auto order = [&p]() -> std::uint32_t {
+        if constexpr (p.has(kw::order)) {
+            return std::forward<decltype(p(kw::order))>(p(kw::order));
+        } else {
+            return 0;
+        }
+    }();
+
+    // Auto-tuning of the Taylor order (defaults to false).
+    // NOTE: if enabled, a short benchmark of the stepper is run
+    // at construction time for a few orders around the one deduced
+    // from the tolerance, and the order with the lowest cost
+    // per unit of integration time is selected. Incompatible with
+    // an explicit order.
+    auto tune_order = [&p]() -> bool {
+        if constexpr (p.has(kw::tune_order)) {
+            return std::forward<decltype(p(kw::tune_order))>(p(kw::tune_order));
+        } else {
+            return false;
+        }
+    }();
+
+    return std::tuple{high_accuracy, tol, compact_mode, std::move(pars), parallel_mode, unroll_threshold,
+                      contiguous_jets, dl_order, skip_one_way, std::move(h_vars), std::move(ha_vars), order,
+                      tune_order};
+}
+
+// Heuristic selection of compact mode and function inlining
+// (see kw::auto_compact_mode). The return value contains the
+// compact mode flag and the inline functions flag.
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<bool, bool> taylor_auto_compact_mode(const taylor_dc_t &, std::uint32_t, T, std::uint32_t,
+                                                                 std::uint32_t);
+
+template <typename T, typename U>
+inline std::pair<bool, bool> taylor_auto_compact_mode(const U &sys, T tol, std::uint32_t order,
+                                                      std::uint32_t batch_size)
+{
+    if constexpr (std::is_same_v<U, taylor_precomputed_dc>) {
+        return taylor_auto_compact_mode(sys.get_decomposition(), sys.get_n_eq(), tol, order, batch_size);
+    } else {
+        return taylor_auto_compact_mode(taylor_decompose(sys, {}).first, static_cast<std::uint32_t>(sys.size()), tol,
+                                        order, batch_size);
+    }
 }
 
+// Check whether the estimated size of the non-compact code (see
+// taylor_auto_compact_mode()) exceeds the budget (see kw::cm_budget).
+// If it does, a warning is logged.
 template <typename T>
+HEYOKA_DLL_PUBLIC bool taylor_cm_budget_exceeded(const taylor_dc_t &, std::uint32_t, T, std::uint32_t, std::uint32_t,
+                                                 double);
+
+template <typename T, typename U>
+inline bool taylor_cm_budget_exceeded(const U &sys, T tol, std::uint32_t order, std::uint32_t batch_size,
+                                      double budget)
+{
+    if constexpr (std::is_same_v<U, taylor_precomputed_dc>) {
+        return taylor_cm_budget_exceeded(sys.get_decomposition(), sys.get_n_eq(), tol, order, batch_size, budget);
+    } else {
+        return taylor_cm_budget_exceeded(taylor_decompose(sys, {}).first, static_cast<std::uint32_t>(sys.size()),
+                                         tol, order, batch_size, budget);
+    }
+}
+
+// NOTE: the B flag signals whether the event is meant
+// to be used in a batch integrator or in a scalar one.
+// In batch mode, the callbacks are passed the index of the
+// batch element in which the event triggered as last argument.
+template <typename T, bool B>
 class HEYOKA_DLL_PUBLIC nt_event_impl
 {
     static_assert(is_supported_fp_v<T>, "Unhandled type.");
 
 public:
-    using callback_t = std::function<void(taylor_adaptive_impl<T> &, T, int)>;
+    using callback_t
+        = std::conditional_t<B, std::function<void(taylor_adaptive_batch_impl<T> &, T, int, std::uint32_t)>,
+                             std::function<void(taylor_adaptive_impl<T> &, T, int)>>;
 
 private:
-    void finalise_ctor(event_direction);
+    void finalise_ctor(event_direction, std::uint32_t);
 
 public:
     template <typename... KwArgs>
@@ -318,7 +777,17 @@ public:
                 }
             }();
 
-            finalise_ctor(d);
+            // Detection order (defaults to 0, i.e.,
+            // the order of the integrator).
+            auto d_order = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::detection_order)) {
+                    return std::forward<decltype(p(kw::detection_order))>(p(kw::detection_order));
+                } else {
+                    return 0;
+                }
+            }();
+
+            finalise_ctor(d, d_order);
         }
     }
 
@@ -333,15 +802,17 @@ public:
     const expression &get_expression() const;
     const callback_t &get_callback() const;
     event_direction get_direction() const;
+    std::uint32_t get_detection_order() const;
 
 private:
     expression eq;
     callback_t callback;
     event_direction dir;
+    std::uint32_t d_order;
 };
 
-template <typename T>
-inline std::ostream &operator<<(std::ostream &os, const nt_event_impl<T> &)
+template <typename T, bool B>
+inline std::ostream &operator<<(std::ostream &os, const nt_event_impl<T, B> &)
 {
     static_assert(always_false_v<T>, "Unhandled type.");
 
@@ -349,28 +820,39 @@ inline std::ostream &operator<<(std::ostream &os, const nt_event_impl<T> &)
 }
 
 template <>
-HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<double> &);
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<double, false> &);
+
+template <>
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<double, true> &);
 
 template <>
-HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<long double> &);
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<long double, false> &);
+
+template <>
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<long double, true> &);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template <>
-HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<mppp::real128> &);
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<mppp::real128, false> &);
+
+template <>
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const nt_event_impl<mppp::real128, true> &);
 
 #endif
 
-template <typename T>
+template <typename T, bool B>
 class HEYOKA_DLL_PUBLIC t_event_impl
 {
     static_assert(is_supported_fp_v<T>, "Unhandled type.");
 
 public:
-    using callback_t = std::function<bool(taylor_adaptive_impl<T> &, bool, int)>;
+    using callback_t
+        = std::conditional_t<B, std::function<bool(taylor_adaptive_batch_impl<T> &, bool, int, std::uint32_t)>,
+                             std::function<bool(taylor_adaptive_impl<T> &, bool, int)>>;
 
 private:
-    void finalise_ctor(callback_t, T, event_direction);
+    void finalise_ctor(callback_t, T, event_direction, std::uint32_t);
 
 public:
     template <typename... KwArgs>
@@ -411,7 +893,17 @@ public:
                 }
             }();
 
-            finalise_ctor(std::move(cb), cd, d);
+            // Detection order (defaults to 0, i.e.,
+            // the order of the integrator).
+            auto d_order = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::detection_order)) {
+                    return std::forward<decltype(p(kw::detection_order))>(p(kw::detection_order));
+                } else {
+                    return 0;
+                }
+            }();
+
+            finalise_ctor(std::move(cb), cd, d, d_order);
         }
     }
 
@@ -427,16 +919,18 @@ public:
     const callback_t &get_callback() const;
     event_direction get_direction() const;
     T get_cooldown() const;
+    std::uint32_t get_detection_order() const;
 
 private:
     expression eq;
     callback_t callback;
     T cooldown;
     event_direction dir;
+    std::uint32_t d_order;
 };
 
-template <typename T>
-inline std::ostream &operator<<(std::ostream &os, const t_event_impl<T> &)
+template <typename T, bool B>
+inline std::ostream &operator<<(std::ostream &os, const t_event_impl<T, B> &)
 {
     static_assert(always_false_v<T>, "Unhandled type.");
 
@@ -444,158 +938,729 @@ inline std::ostream &operator<<(std::ostream &os, const t_event_impl<T> &)
 }
 
 template <>
-HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<double> &);
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<double, false> &);
+
+template <>
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<double, true> &);
+
+template <>
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<long double, false> &);
 
 template <>
-HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<long double> &);
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<long double, true> &);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template <>
-HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<mppp::real128> &);
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<mppp::real128, false> &);
+
+template <>
+HEYOKA_DLL_PUBLIC std::ostream &operator<<(std::ostream &, const t_event_impl<mppp::real128, true> &);
 
 #endif
 
 } // namespace detail
 
 template <typename T>
-using nt_event = detail::nt_event_impl<T>;
+using nt_event = detail::nt_event_impl<T, false>;
+
+template <typename T>
+using t_event = detail::t_event_impl<T, false>;
+
+template <typename T>
+using nt_event_batch = detail::nt_event_impl<T, true>;
 
 template <typename T>
-using t_event = detail::t_event_impl<T>;
+using t_event_batch = detail::t_event_impl<T, true>;
+
+template <typename>
+class resumable_propagation;
+
+template <typename>
+class output_sink;
 
 namespace detail
 {
 
+// Continuous output for a scalar adaptive integrator.
+// The Taylor coefficients of each step taken by the integrator are appended
+// to a chunked buffer together with the initial time and the size of the step.
+// The state of the system at an arbitrary time can then be computed via a binary
+// search over the recorded steps followed by the evaluation of the Taylor series via
+// a JIT-compiled function. The continuous output is filled by passing it to the
+// propagate_until()/propagate_for() functions of the integrator via the 'c_output' kwarg.
+// The following optional kwargs can be passed to the constructor:
+// - 'chunk_size', the number of steps per chunk of the coefficients buffer (defaults to 1024),
+// - 'compress_tcs', if true the Taylor coefficients are stored in single
+//   precision (defaults to false),
+// - 'high_accuracy', enables the compensated summation in the evaluation
+//   of the Taylor series (defaults to false),
+// - the kwargs accepted by the constructor of llvm_state.
 template <typename T>
-class HEYOKA_DLL_PUBLIC taylor_adaptive_impl
+class HEYOKA_DLL_PUBLIC continuous_output_impl
 {
     static_assert(is_supported_fp_v<T>, "Unhandled type.");
 
-public:
-    using nt_event_t = nt_event<T>;
-    using t_event_t = t_event<T>;
+    friend class taylor_adaptive_impl<T>;
 
-private:
-    // State vector.
-    std::vector<T> m_state;
-    // Time.
-    dfloat<T> m_time;
-    // The LLVM machinery.
-    llvm_state m_llvm;
-    // Dimension of the system.
-    std::uint32_t m_dim;
-    // Taylor decomposition.
-    taylor_dc_t m_dc;
-    // Taylor order.
-    std::uint32_t m_order;
-    // The steppers.
-    using step_f_t = void (*)(T *, const T *, const T *, T *, T *);
-    using step_f_e_t = void (*)(T *, const T *, const T *, const T *, T *);
-    std::variant<step_f_t, step_f_e_t> m_step_f;
-    // The vector of parameters.
-    std::vector<T> m_pars;
-    // The vector for the Taylor coefficients.
-    std::vector<T> m_tc;
-    // Size of the last timestep taken.
-    T m_last_h = T(0);
-    // The function for computing the dense output.
     using d_out_f_t = void (*)(T *, const T *, const T *);
-    d_out_f_t m_d_out_f;
-    // The vector for the dense output.
-    std::vector<T> m_d_out;
-    // The vector of terminal events.
-    std::vector<t_event_t> m_tes;
-    // The vector of non-terminal events.
-    std::vector<nt_event_t> m_ntes;
-    // The jet of derivatives for the state variables
-    // and the events. This is used only if there
-    // are events, otherwise it stays empty.
-    std::vector<T> m_ev_jet;
-    // Vector of detected terminal events.
-    std::vector<std::tuple<std::uint32_t, T, bool, int>> m_d_tes;
-    // The vector of cooldowns for the terminal events.
-    // If an event is on cooldown, the corresponding optional
-    // in this vector will contain the total time elapsed
-    // since the cooldown started and the absolute value
-    // of the cooldown duration.
-    std::vector<std::optional<std::pair<T, T>>> m_te_cooldowns;
-    // Vector of detected non-terminal events.
-    std::vector<std::tuple<std::uint32_t, T, int>> m_d_ntes;
-
-    HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T> step_impl(T, bool);
 
-    // Private implementation-detail constructor machinery.
-    // NOTE: apparently on Windows we need to re-iterate
-    // here that this is going to be dll-exported.
-    template <typename U>
-    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, T, T, bool, bool, std::vector<T>,
-                                              std::vector<t_event_t>, std::vector<nt_event_t>);
-    template <typename U, typename... KwArgs>
-    void finalise_ctor(U sys, std::vector<T> state, KwArgs &&...kw_args)
+    llvm_state m_llvm;
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    std::size_t m_chunk_size = 0;
+    bool m_compress = false;
+    // Number of recorded steps.
+    std::size_t m_n_steps = 0;
+    // The chunks of Taylor coefficients. Only one of
+    // these is used, depending on m_compress.
+    std::vector<std::vector<T>> m_tcs;
+    std::vector<std::vector<float>> m_tcs_f32;
+    // Initial times (in double-length format)
+    // and sizes of the recorded steps.
+    std::vector<T> m_times_hi, m_times_lo, m_hs;
+    // Temporary buffer for the decompressed
+    // Taylor coefficients.
+    std::vector<T> m_tc_tmp;
+    // The output vector.
+    std::vector<T> m_output;
+    // The function for the evaluation of the Taylor series.
+    d_out_f_t m_d_out_f = nullptr;
+
+    void finalise_ctor_impl(const taylor_adaptive_impl<T> &, std::size_t, bool, bool);
+    template <typename... KwArgs>
+    void finalise_ctor(const taylor_adaptive_impl<T> &ta, KwArgs &&...kw_args)
     {
         igor::parser p{kw_args...};
 
         if constexpr (p.has_unnamed_arguments()) {
             static_assert(detail::always_false_v<KwArgs...>,
-                          "The variadic arguments in the construction of an adaptive Taylor integrator contain "
+                          "The variadic arguments in the construction of a continuous output contain "
                           "unnamed arguments.");
         } else {
-            // Initial time (defaults to zero).
-            const auto time = [&p]() -> T {
-                if constexpr (p.has(kw::time)) {
-                    return std::forward<decltype(p(kw::time))>(p(kw::time));
+            // Number of steps per chunk (defaults to 1024).
+            auto chunk_size = [&p]() -> std::size_t {
+                if constexpr (p.has(kw::chunk_size)) {
+                    return std::forward<decltype(p(kw::chunk_size))>(p(kw::chunk_size));
                 } else {
-                    return T(0);
+                    return 1024;
                 }
             }();
 
-            auto [high_accuracy, tol, compact_mode, pars]
-                = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
-
-            // NOTE: perhaps the handling of the events kwargs can end up in
-            // taylor_adaptive_common_ops()
-            // once we implement event detection in the batch integrator too.
-
-            // Extract the terminal events, if any.
-            auto tes = [&p]() -> std::vector<t_event_t> {
-                if constexpr (p.has(kw::t_events)) {
-                    return std::forward<decltype(p(kw::t_events))>(p(kw::t_events));
+            // Compression of the Taylor coefficients (defaults to false).
+            auto compress = [&p]() -> bool {
+                if constexpr (p.has(kw::compress_tcs)) {
+                    return std::forward<decltype(p(kw::compress_tcs))>(p(kw::compress_tcs));
                 } else {
-                    return {};
+                    return false;
                 }
             }();
 
-            // Extract the non-terminal events, if any.
-            auto ntes = [&p]() -> std::vector<nt_event_t> {
-                if constexpr (p.has(kw::nt_events)) {
-                    return std::forward<decltype(p(kw::nt_events))>(p(kw::nt_events));
+            // High accuracy (defaults to false).
+            auto high_accuracy = [&p]() -> bool {
+                if constexpr (p.has(kw::high_accuracy)) {
+                    return std::forward<decltype(p(kw::high_accuracy))>(p(kw::high_accuracy));
                 } else {
-                    return {};
+                    return false;
                 }
             }();
 
-            finalise_ctor_impl(std::move(sys), std::move(state), time, tol, high_accuracy, compact_mode,
-                               std::move(pars), std::move(tes), std::move(ntes));
+            finalise_ctor_impl(ta, chunk_size, compress, high_accuracy);
         }
     }
 
+    HEYOKA_DLL_LOCAL void add_step(const taylor_adaptive_impl<T> &);
+    HEYOKA_DLL_LOCAL void check_compat(const taylor_adaptive_impl<T> &) const;
+
 public:
     template <typename... KwArgs>
-    explicit taylor_adaptive_impl(std::vector<expression> sys, std::vector<T> state, KwArgs &&...kw_args)
-        : m_llvm{std::forward<KwArgs>(kw_args)...}
-    {
-        finalise_ctor(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
-    }
-    template <typename... KwArgs>
-    explicit taylor_adaptive_impl(std::vector<std::pair<expression, expression>> sys, std::vector<T> state,
-                                  KwArgs &&...kw_args)
+    explicit continuous_output_impl(const taylor_adaptive_impl<T> &ta, KwArgs &&...kw_args)
         : m_llvm{std::forward<KwArgs>(kw_args)...}
     {
-        finalise_ctor(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+        finalise_ctor(ta, std::forward<KwArgs>(kw_args)...);
     }
 
-    taylor_adaptive_impl(const taylor_adaptive_impl &);
+    continuous_output_impl(const continuous_output_impl &);
+    continuous_output_impl(continuous_output_impl &&) noexcept;
+
+    continuous_output_impl &operator=(const continuous_output_impl &);
+    continuous_output_impl &operator=(continuous_output_impl &&) noexcept;
+
+    ~continuous_output_impl();
+
+    const llvm_state &get_llvm_state() const;
+    std::uint32_t get_dim() const;
+    std::uint32_t get_order() const;
+    std::size_t get_chunk_size() const;
+    bool get_compress_tcs() const;
+    std::size_t get_n_steps() const;
+
+    // The time range covered by the recorded steps.
+    std::pair<T, T> get_bounds() const;
+
+    // Compute the state of the system at the input time. For times
+    // outside the bounds, the Taylor series of the first/last
+    // step are used.
+    const std::vector<T> &operator()(T);
+    const std::vector<T> &get_output() const
+    {
+        return m_output;
+    }
+
+    // Adaptive sampling of the recorded steps. The sampling times are chosen
+    // by bisecting each step until the linear interpolation between consecutive
+    // samples approximates the Taylor series of the step within the input absolute
+    // tolerance (checked at the quarter points of each interval). The bounds of the
+    // steps are always included. The return values are the sampling times and the
+    // states (in row-major format, one row per sampling time).
+    std::pair<std::vector<T>, std::vector<T>> sample(T);
+
+    // Remove all the recorded steps.
+    void clear();
+
+    // Save the recorded steps into an ephemeris file (see ephemeris_impl).
+    void save_ephemeris(const std::string &) const;
+};
+
+// Read-only view on an ephemeris file, i.e., a file containing the recorded
+// steps of a continuous output. The file consists of a fixed-size header
+// (containing the floating-point format, the dimension and the order of the system, the number
+// of steps and the offsets of the data arrays), followed by the arrays of the initial times
+// (in double-length format) and sizes of the steps and by the contiguous blocks of Taylor
+// coefficients of each step. The file is memory-mapped, and the state of the system is
+// computed without deserialisation by evaluating the Taylor coefficients
+// directly on the mapped pages via a JIT-compiled function. The data is stored
+// in the native byte order, thus ephemeris files can be shared only among
+// machines with the same byte order.
+// The following optional kwargs can be passed to the constructor:
+// - 'high_accuracy', enables the compensated summation in the evaluation
+//   of the Taylor series (defaults to false),
+// - the kwargs accepted by the constructor of llvm_state.
+template <typename T>
+class HEYOKA_DLL_PUBLIC ephemeris_impl
+{
+    static_assert(is_supported_fp_v<T>, "Unhandled type.");
+
+    using d_out_f_t = void (*)(T *, const T *, const T *);
+
+    llvm_state m_llvm;
+    std::string m_path;
+    // The mapped file.
+    std::shared_ptr<const llvm::MemoryBuffer> m_buffer;
+    std::uint32_t m_dim = 0;
+    std::uint32_t m_order = 0;
+    std::size_t m_n_steps = 0;
+    // Pointers to the data arrays in the mapped file.
+    const T *m_times_hi = nullptr;
+    const T *m_times_lo = nullptr;
+    const T *m_hs = nullptr;
+    const T *m_tcs = nullptr;
+    // The output vector.
+    std::vector<T> m_output;
+    // The function for the evaluation of the Taylor series.
+    d_out_f_t m_d_out_f = nullptr;
+
+    void finalise_ctor_impl(std::string, bool);
+    template <typename... KwArgs>
+    void finalise_ctor(std::string path, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of an ephemeris contain "
+                          "unnamed arguments.");
+        } else {
+            // High accuracy (defaults to false).
+            auto high_accuracy = [&p]() -> bool {
+                if constexpr (p.has(kw::high_accuracy)) {
+                    return std::forward<decltype(p(kw::high_accuracy))>(p(kw::high_accuracy));
+                } else {
+                    return false;
+                }
+            }();
+
+            finalise_ctor_impl(std::move(path), high_accuracy);
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit ephemeris_impl(std::string path, KwArgs &&...kw_args) : m_llvm{std::forward<KwArgs>(kw_args)...}
+    {
+        finalise_ctor(std::move(path), std::forward<KwArgs>(kw_args)...);
+    }
+
+    ephemeris_impl(const ephemeris_impl &);
+    ephemeris_impl(ephemeris_impl &&) noexcept;
+
+    ephemeris_impl &operator=(const ephemeris_impl &);
+    ephemeris_impl &operator=(ephemeris_impl &&) noexcept;
+
+    ~ephemeris_impl();
+
+    const llvm_state &get_llvm_state() const;
+    const std::string &get_path() const;
+    std::uint32_t get_dim() const;
+    std::uint32_t get_order() const;
+    std::size_t get_n_steps() const;
+
+    // The time range covered by the steps.
+    std::pair<T, T> get_bounds() const;
+
+    // Compute the state of the system at the input time. For times
+    // outside the bounds, the Taylor series of the first/last
+    // step are used.
+    const std::vector<T> &operator()(T);
+    const std::vector<T> &get_output() const
+    {
+        return m_output;
+    }
+};
+
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_adaptive_impl
+{
+    static_assert(is_supported_fp_v<T>, "Unhandled type.");
+
+    friend class continuous_output_impl<T>;
+    friend class heyoka::resumable_propagation<T>;
+    friend class heyoka::output_sink<T>;
+
+public:
+    using nt_event_t = nt_event<T>;
+    using t_event_t = t_event<T>;
+    // A list of triggered non-terminal events, as tuples containing
+    // the event index, the trigger time and the sign of the derivative
+    // of the event equation at the trigger time.
+    using nt_buffer_t = std::vector<std::tuple<std::uint32_t, T, int>>;
+    // The type of the batched callback for the non-terminal
+    // events. It is passed the list of the non-terminal events
+    // triggered in a timestep.
+    using nt_batch_cb_t = std::function<void(taylor_adaptive_impl &, const nt_buffer_t &)>;
+    // Read-only view on the non-terminal events triggered in the
+    // last timestep, in structure-of-arrays layout (see get_last_nt_events()).
+    // The arrays have all the same size and they are sorted by time.
+    struct nt_events_view {
+        const std::uint32_t *idx = nullptr;
+        const T *time = nullptr;
+        const int *d_sgn = nullptr;
+        std::size_t size = 0;
+    };
+
+private:
+    // State vector.
+    std::vector<T> m_state;
+    // Time.
+    dfloat<T> m_time;
+    // The LLVM machinery.
+    // NOTE: the LLVM state is shared among the
+    // integrators created via shared_copy(). It is
+    // never modified after the construction of
+    // the integrator.
+    std::shared_ptr<llvm_state> m_llvm = std::make_shared<llvm_state>();
+    // Dimension of the system.
+    std::uint32_t m_dim;
+    // Taylor decomposition.
+    // NOTE: the decomposition is never modified after the
+    // construction of the integrator, and it is shared among
+    // the copies of the integrator.
+    std::shared_ptr<const taylor_dc_t> m_dc;
+    // Taylor order.
+    std::uint32_t m_order;
+    // The steppers.
+    // NOTE: the fused stepper (available only without events) also
+    // updates the time in double-length arithmetic and checks the
+    // finiteness of the new state and time, writing a nonzero flag
+    // if non-finite values are detected.
+    using step_f_t = void (*)(T *, const T *, const T *, T *, T *);
+    using step_f_e_t = void (*)(T *, const T *, const T *, const T *, T *);
+    using step_f_f_t = void (*)(T *, const T *, T *, T *, T *, T *, std::int32_t *);
+    std::variant<step_f_t, step_f_e_t, step_f_f_t> m_step_f;
+    // Flag signalling the use of the fused stepper.
+    bool m_fused_step = false;
+    // The multi-step driver, available only together
+    // with the fused stepper (null otherwise). It is used
+    // in propagate_until() if there are no callbacks and
+    // no continuous output, so that the whole propagation
+    // runs in compiled code.
+    using step_n_f_t = std::int32_t (*)(T *, const T *, T *, T *, T *, const T *, std::uint64_t, T *, std::uint64_t *);
+    step_n_f_t m_step_n_f = nullptr;
+    // The vector of parameters.
+    std::vector<T> m_pars;
+    // The knots of the piecewise polynomials of time in
+    // the decomposition (see detail::tpwpoly_knots()). The
+    // timesteps are limited so that they do not cross the knots.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_tpw_knots;
+    // The vector for the Taylor coefficients.
+    // NOTE: with events, the Taylor coefficients of the
+    // state variables are computed in m_ev_jet, and they
+    // are copied into m_tc only when needed (see sync_tc()).
+    // m_tc_pending signals that the copy is due. These are
+    // mutable because the copy may be triggered by const
+    // member functions.
+    mutable std::vector<T> m_tc;
+    mutable bool m_tc_pending = false;
+    // Size of the last timestep taken.
+    T m_last_h = T(0);
+    // The function for computing the dense output.
+    using d_out_f_t = void (*)(T *, const T *, const T *);
+    d_out_f_t m_d_out_f;
+    // The vector for the dense output.
+    std::vector<T> m_d_out;
+    // The function for computing the enclosure of the state
+    // over the last timestep, and the vector for the enclosure.
+    // NOTE: the function is fetched from a process-wide cache
+    // on first use (see get_step_enclosure()).
+    d_out_f_t m_tc_enc_f = nullptr;
+    std::vector<T> m_tc_enc;
+    // The function for computing the dense output
+    // at multiple time coordinates at once, and the
+    // number of time coordinates it processes. If the
+    // number is not greater than 1, the function is not available.
+    d_out_f_t m_d_out_multi_f = nullptr;
+    std::uint32_t m_d_out_multi_size = 0;
+    // The vector of terminal events.
+    std::vector<t_event_t> m_tes;
+    // The vector of non-terminal events.
+    std::vector<nt_event_t> m_ntes;
+    // The batched callback for the non-terminal events. If
+    // set, it is invoked instead of the callbacks of the
+    // individual non-terminal events.
+    // NOTE: this is not serialised.
+    nt_batch_cb_t m_nt_batch_cb;
+    // The user-provided buffer into which the non-terminal
+    // events are accumulated (instead of invoking the callbacks).
+    // NOTE: this is set only for the duration of a propagate_*()
+    // call (see nt_buffer_guard), and it is neither copied
+    // nor serialised.
+    nt_buffer_t *m_nt_buf = nullptr;
+    // The jet of derivatives for the state variables
+    // and the events. This is used only if there
+    // are events, otherwise it stays empty.
+    detail::aligned_vector<T> m_ev_jet;
+    // The flag signalling whether the jet of derivatives
+    // is stored in a per-thread scratch buffer instead of
+    // m_ev_jet (see set_thread_scratch()).
+    // NOTE: this is not serialised.
+    bool m_thread_scratch = false;
+    // Vector of detected terminal events.
+    std::vector<std::tuple<std::uint32_t, T, bool, int>> m_d_tes;
+    // The vector of cooldowns for the terminal events.
+    // If an event is on cooldown, the corresponding optional
+    // in this vector will contain the total time elapsed
+    // since the cooldown started and the absolute value
+    // of the cooldown duration.
+    std::vector<std::optional<std::pair<T, T>>> m_te_cooldowns;
+    // Vector of detected non-terminal events.
+    std::vector<std::tuple<std::uint32_t, T, int>> m_d_ntes;
+    // The non-terminal events triggered in the last timestep,
+    // sorted by time, in structure-of-arrays layout: event indices,
+    // absolute trigger times and signs of the derivatives.
+    // NOTE: these are not copied.
+    std::vector<std::uint32_t> m_d_ntes_idx;
+    std::vector<T> m_d_ntes_time;
+    std::vector<int> m_d_ntes_sgn;
+    // Scratch buffers for the index sort of the detected
+    // non-terminal events: the sort keys and the permutation.
+    std::vector<T> m_d_ntes_key;
+    std::vector<std::uint32_t> m_d_ntes_perm;
+    // The scratch memory for event detection.
+    // NOTE: this is not copied, it will be
+    // set up by the first event detection.
+    detail::ed_data<T> m_ed_data;
+    // The optimised LLVM state being compiled in the background,
+    // if lazy compilation was requested. When it becomes available,
+    // it replaces m_llvm and the function pointers.
+    std::shared_future<llvm_state> m_bg_llvm;
+    // The performance counters, and the flag signalling
+    // whether or not they are being collected.
+    // NOTE: the performance counters are not serialised.
+    taylor_perf_counters m_perf;
+    bool m_perf_enabled = false;
+    // The flag signalling whether the root isolation phase
+    // of event detection can run in parallel.
+    // NOTE: this is not serialised.
+    bool m_par_ed = false;
+    // The timings of the construction.
+    // NOTE: these are not serialised.
+    taylor_ctor_timings m_ctor_timings;
+    // The ODE system in explicit form and the options
+    // passed to the constructor, used in update_equations().
+    // NOTE: this is empty if the integrator was constructed from
+    // a precomputed decomposition or deserialised.
+    struct upd_data_t {
+        std::vector<std::pair<expression, expression>> sys;
+        T tol;
+        bool high_accuracy;
+        bool compact_mode;
+        bool parallel_mode;
+        bool lazy_compile;
+        std::uint32_t unroll_threshold;
+        bool contiguous_jets;
+        bool fused_step;
+        std::uint32_t dl_order;
+        bool skip_one_way;
+        std::vector<expression> h_vars;
+        std::vector<expression> ha_vars;
+        std::uint32_t order;
+    };
+    std::optional<upd_data_t> m_upd_data;
+    // The stepper specialised on the parameter
+    // values in m_spec_pars (see specialise_pars()).
+    std::shared_ptr<llvm_state> m_spec_llvm;
+    std::variant<step_f_t, step_f_e_t, step_f_f_t> m_spec_step_f;
+    step_n_f_t m_spec_step_n_f = nullptr;
+    std::vector<T> m_spec_pars;
+    // The fixed-step stepper (see step_fixed()). m_fixed_order
+    // is zero if the fixed-step stepper has not been compiled yet.
+    std::shared_ptr<llvm_state> m_fixed_llvm;
+    step_f_t m_fixed_step_f = nullptr;
+    std::uint32_t m_fixed_order = 0;
+    // The variable-order steppers (see enable_var_order()), with
+    // their orders in ascending order. m_vo_cost and m_vo_last_h contain,
+    // for each order (including the order of the integrator as last
+    // element), the measured cost of a timestep and the last timestep
+    // taken with that order. m_vo_tc is a temporary buffer for the Taylor
+    // coefficients of the lower orders, and m_vo_idx is the index of the
+    // order of the last timestep.
+    // NOTE: these are not serialised.
+    std::shared_ptr<llvm_state> m_vo_llvm;
+    std::vector<step_f_t> m_vo_step_f;
+    std::vector<std::uint32_t> m_vo_orders;
+    std::vector<double> m_vo_cost;
+    std::vector<T> m_vo_last_h;
+    std::vector<T> m_vo_tc;
+    std::size_t m_vo_idx = 0;
+    std::size_t m_vo_counter = 0;
+    // The compiled function for the evaluation of the
+    // sv_funcs (see set_sv_funcs()), and the buffer
+    // for their values.
+    // NOTE: these are not serialised.
+    using sv_funcs_f_t = void (*)(T *, const T *, const T *, std::uint64_t);
+    std::shared_ptr<llvm_state> m_svf_llvm;
+    sv_funcs_f_t m_svf_f = nullptr;
+    std::vector<expression> m_sv_funcs;
+    mutable std::vector<T> m_sv_values;
+    // For each sv_func, the index of the row in the jet of
+    // the stepper containing the Taylor coefficients of an identical
+    // event equation, or the max value of std::uint32_t if no
+    // such event equation exists.
+    std::vector<std::uint32_t> m_sv_ev_rows;
+    // The flag signalling whether the jet of the event equations
+    // is computed by a function compiled separately from the
+    // stepper (see kw::separate_ev_jet), and the LLVM state
+    // containing such function.
+    using ev_jet_f_t = void (*)(T *, const T *, const T *);
+    bool m_sep_ev_jet = false;
+    std::shared_ptr<llvm_state> m_ev_llvm;
+    ev_jet_f_t m_ev_jet_f = nullptr;
+    // The settings of the step-size collapse
+    // detector (see set_h_collapse()).
+    // NOTE: these are not serialised.
+    T m_hc_rel = 0;
+    std::size_t m_hc_n = 0;
+    // The invariants monitor (see set_invariants()): the compiled function
+    // for the evaluation of the invariants in the LLVM state m_inv_llvm,
+    // the invariants, the evaluation period, the thresholds, the reference
+    // values, the last drifts, the ring buffer of the history (with capacity
+    // m_inv_hist_cap records and the oldest record at m_inv_hist_pos once full),
+    // the counter of the timesteps since the last evaluation and a buffer
+    // for the values of the invariants.
+    // NOTE: these are not serialised.
+    std::shared_ptr<llvm_state> m_inv_llvm;
+    sv_funcs_f_t m_inv_f = nullptr;
+    std::vector<expression> m_invs;
+    std::size_t m_inv_every = 0;
+    std::vector<T> m_inv_thr, m_inv_ref, m_inv_drift, m_inv_hist;
+    std::size_t m_inv_hist_cap = 0, m_inv_hist_pos = 0, m_inv_counter = 0;
+    std::vector<T> m_inv_out;
+
+    HEYOKA_DLL_LOCAL bool h_collapse_check(taylor_outcome, T, T, std::size_t &) const;
+    HEYOKA_DLL_LOCAL bool eval_invariants();
+    HEYOKA_DLL_LOCAL void swap_bg_llvm();
+    HEYOKA_DLL_LOCAL const llvm_state &final_llvm_state() const;
+    HEYOKA_DLL_LOCAL taylor_adaptive_impl rebuild(std::vector<std::pair<expression, expression>>, std::vector<T>,
+                                                  bool) const;
+
+    HEYOKA_DLL_LOCAL std::tuple<taylor_outcome, T> step_impl(T, bool);
+    HEYOKA_DLL_LOCAL std::size_t vo_select();
+    HEYOKA_DLL_LOCAL void sync_tc() const;
+    HEYOKA_DLL_LOCAL std::size_t ev_jet_size() const;
+    HEYOKA_DLL_LOCAL void eval_sv_funcs(const std::vector<T> &) const;
+    // The type of the callback of the propagate_*() functions.
+    // NOTE: this is a non-owning reference to the callback
+    // passed by the user, so that no memory allocation or
+    // copy takes place when invoking a propagate_*() function.
+    using propagate_cb_t = function_ref<bool(taylor_adaptive_impl &)>;
+
+    HEYOKA_DLL_LOCAL bool invoke_propagate_cb(const propagate_cb_t &);
+
+    // Constructor used in the deserialisation machinery.
+    HEYOKA_DLL_LOCAL taylor_adaptive_impl();
+    HEYOKA_DLL_LOCAL taylor_adaptive_impl(const taylor_adaptive_impl &, bool);
+
+    // Private implementation-detail constructor machinery.
+    // NOTE: apparently on Windows we need to re-iterate
+    // here that this is going to be dll-exported.
+    template <typename U>
+    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, T, T, bool, bool, bool, std::vector<T>,
+                                              std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t,
+                                              bool, bool, std::uint32_t, bool, std::vector<expression>,
+                                              std::vector<expression>, std::uint32_t, bool);
+    template <typename U, typename... KwArgs>
+    void finalise_ctor(U sys, std::vector<T> state, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of an adaptive Taylor integrator contain "
+                          "unnamed arguments.");
+        } else {
+            // Initial time (defaults to zero).
+            const auto time = [&p]() -> T {
+                if constexpr (p.has(kw::time)) {
+                    return std::forward<decltype(p(kw::time))>(p(kw::time));
+                } else {
+                    return T(0);
+                }
+            }();
+
+            auto [high_accuracy, tol, compact_mode, pars, parallel_mode, unroll_threshold, contiguous_jets, dl_order,
+                  skip_one_way, h_vars, ha_vars, order, tune_order]
+                = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
+
+            // Extract the terminal events, if any.
+            auto tes = [&p]() -> std::vector<t_event_t> {
+                if constexpr (p.has(kw::t_events)) {
+                    return std::forward<decltype(p(kw::t_events))>(p(kw::t_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Extract the non-terminal events, if any.
+            auto ntes = [&p]() -> std::vector<nt_event_t> {
+                if constexpr (p.has(kw::nt_events)) {
+                    return std::forward<decltype(p(kw::nt_events))>(p(kw::nt_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Lazy compilation (defaults to false).
+            // NOTE: if enabled, the integrator is first compiled
+            // without optimisations, and the optimised code is compiled
+            // in a background thread. The optimised code is switched
+            // in at the beginning of the first timestep after
+            // the background compilation has completed.
+            const auto lazy_compile = [&p]() -> bool {
+                if constexpr (p.has(kw::lazy_compile)) {
+                    return std::forward<decltype(p(kw::lazy_compile))>(p(kw::lazy_compile));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Fused stepper (defaults to false).
+            // NOTE: if enabled, the time update and the check for
+            // non-finite values at the end of a timestep are performed
+            // in the compiled stepper. Ignored if events are present.
+            const auto fused_step = [&p]() -> bool {
+                if constexpr (p.has(kw::fused_step)) {
+                    return std::forward<decltype(p(kw::fused_step))>(p(kw::fused_step));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Separate compilation of the jet of the event
+            // equations (defaults to false).
+            // NOTE: if enabled, the stepper computes only the jet of
+            // the dynamics, and the jet of the event equations is computed
+            // from it by a function compiled in a separate LLVM state. The
+            // stepper then does not depend on the events, and it can be fetched
+            // from the compiled code caches when only the events change.
+            // NOTE: this is stored in the integrator before
+            // finalise_ctor_impl(), which reads it.
+            m_sep_ev_jet = [&p]() -> bool {
+                if constexpr (p.has(kw::separate_ev_jet)) {
+                    return std::forward<decltype(p(kw::separate_ev_jet))>(p(kw::separate_ev_jet));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Automatic selection of compact mode and function inlining
+            // (defaults to false). If enabled, compact mode is selected
+            // from the size of the decomposition and of the Taylor order,
+            // overriding kw::compact_mode. Function inlining is selected
+            // as well, unless kw::inline_functions was explicitly provided.
+            const auto auto_cm = [&p]() -> bool {
+                if constexpr (p.has(kw::auto_compact_mode)) {
+                    return std::forward<decltype(p(kw::auto_compact_mode))>(p(kw::auto_compact_mode));
+                } else {
+                    return false;
+                }
+            }();
+            if (auto_cm) {
+                const auto [a_cm, a_inline] = taylor_auto_compact_mode(sys, tol, order, 1);
+                compact_mode = a_cm;
+                if constexpr (!p.has(kw::inline_functions)) {
+                    m_llvm->inline_functions() = a_inline;
+                }
+            }
+
+            // Budget on the estimated size of the non-compact code
+            // (defaults to zero, i.e., no budget). If the budget is exceeded
+            // in non-compact mode, compact mode is selected in order to cap the
+            // compilation time, and function inlining is disabled, unless
+            // kw::inline_functions was explicitly provided.
+            const auto cm_budget = [&p]() -> double {
+                if constexpr (p.has(kw::cm_budget)) {
+                    return std::forward<decltype(p(kw::cm_budget))>(p(kw::cm_budget));
+                } else {
+                    return 0;
+                }
+            }();
+            if (!compact_mode && cm_budget > 0 && taylor_cm_budget_exceeded(sys, tol, order, 1, cm_budget)) {
+                compact_mode = true;
+                if constexpr (!p.has(kw::inline_functions)) {
+                    m_llvm->inline_functions() = false;
+                }
+            }
+
+            finalise_ctor_impl(std::move(sys), std::move(state), time, tol, high_accuracy, compact_mode,
+                               parallel_mode, std::move(pars), std::move(tes), std::move(ntes), lazy_compile,
+                               unroll_threshold, contiguous_jets, fused_step, dl_order, skip_one_way,
+                               std::move(h_vars), std::move(ha_vars), order, tune_order);
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit taylor_adaptive_impl(std::vector<expression> sys, std::vector<T> state, KwArgs &&...kw_args)
+        : m_llvm{std::make_shared<llvm_state>(std::forward<KwArgs>(kw_args)...)}
+    {
+        finalise_ctor(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
+    template <typename... KwArgs>
+    explicit taylor_adaptive_impl(std::vector<std::pair<expression, expression>> sys, std::vector<T> state,
+                                  KwArgs &&...kw_args)
+        : m_llvm{std::make_shared<llvm_state>(std::forward<KwArgs>(kw_args)...)}
+    {
+        finalise_ctor(std::move(sys), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
+    // Constructor from a precomputed Taylor decomposition.
+    template <typename... KwArgs>
+    explicit taylor_adaptive_impl(taylor_precomputed_dc dc, std::vector<T> state, KwArgs &&...kw_args)
+        : m_llvm{std::make_shared<llvm_state>(std::forward<KwArgs>(kw_args)...)}
+    {
+        finalise_ctor(std::move(dc), std::move(state), std::forward<KwArgs>(kw_args)...);
+    }
+
+    taylor_adaptive_impl(const taylor_adaptive_impl &);
     taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept;
 
     taylor_adaptive_impl &operator=(const taylor_adaptive_impl &);
@@ -603,6 +1668,35 @@ public:
 
     ~taylor_adaptive_impl();
 
+    // Create a copy of the integrator which shares the compiled
+    // code with this. Contrary to the copy constructor, no new LLVM
+    // state is created, and only the buffers (state, parameters, Taylor
+    // coefficients, etc.) are copied. The integrators sharing the compiled
+    // code can be used concurrently from different threads.
+    taylor_adaptive_impl shared_copy() const;
+    // Create n shared copies of the integrator, e.g., for the setup
+    // of a pool of integrators. The copies are constructed in place
+    // in the returned vector, whose storage is allocated at once.
+    std::vector<taylor_adaptive_impl> shared_copies(std::size_t) const;
+
+    // Replace a subset of the equations of the ODE system. The input
+    // is a list of (index, rhs) pairs. The state, time, parameters and
+    // events are preserved, while the Taylor coefficients are reset.
+    // In compact mode, the derivative functions shared with the previous
+    // system are fetched from the library of precompiled derivative
+    // functions, so that only the new ones are generated and optimised.
+    void update_equations(std::vector<std::pair<std::uint32_t, expression>>);
+    // Compile a variant of the stepper in which the parameters
+    // are replaced by their current values, so that they can
+    // be constant-folded. The specialised stepper is used as long as
+    // the values of the parameters do not change, otherwise the integrator
+    // falls back to the generic stepper. The specialised stepper
+    // is not serialised. get_pars_specialised() returns true if the
+    // specialised stepper is available and the values of the
+    // parameters are unchanged.
+    void specialise_pars();
+    bool get_pars_specialised() const;
+
     const llvm_state &get_llvm_state() const;
 
     const taylor_dc_t &get_decomposition() const;
@@ -644,11 +1738,17 @@ public:
     {
         return m_pars.data();
     }
-
-    const std::vector<T> &get_tc() const
-    {
-        return m_tc;
-    }
+    // Set the state vector (or the runtime parameters) from a strided
+    // view of an external buffer: the i-th value is read from src[i * stride].
+    void set_state(const T *, std::size_t = 1);
+    void set_pars(const T *, std::size_t = 1);
+
+    const std::vector<T> &get_tc() const;
+    // Enclosure of the Taylor polynomials of the state variables over the last
+    // timestep: the first dim values are the lower bounds, the last dim values
+    // the upper bounds. This requires the Taylor coefficients to be up to date
+    // (i.e., the last step must have been taken with write_tc = true).
+    const std::vector<T> &get_step_enclosure();
 
     T get_last_h() const
     {
@@ -660,6 +1760,7 @@ public:
         return m_d_out;
     }
     const std::vector<T> &update_d_output(T, bool = false);
+    void update_d_output(const T *, std::size_t, T *, bool = false) const;
 
     void reset_cooldowns();
     const std::vector<t_event_t> &get_t_events() const
@@ -670,11 +1771,199 @@ public:
     {
         return m_ntes;
     }
+    const nt_batch_cb_t &get_nt_batch_callback() const
+    {
+        return m_nt_batch_cb;
+    }
+    void set_nt_batch_callback(nt_batch_cb_t cb)
+    {
+        m_nt_batch_cb = std::move(cb);
+    }
+    // NOTE: the view is invalidated by the next timestep.
+    nt_events_view get_last_nt_events() const
+    {
+        return nt_events_view{m_d_ntes_idx.data(), m_d_ntes_time.data(), m_d_ntes_sgn.data(), m_d_ntes_idx.size()};
+    }
+
+    bool get_fused_step() const
+    {
+        return m_fused_step;
+    }
+    // The raw stepper, i.e., the compiled fused stepper, for building custom
+    // drivers without the overhead of step(). The arguments are the pointers to
+    // the state vector, the runtime parameters, the hi and lo parts of the time,
+    // the timestep (read as max_delta_t and overwritten with the timestep taken),
+    // the output buffer of the Taylor coefficients (may be null) and the outcome
+    // code (one of the taylor_raw_step_* constants). The time is updated and the
+    // finiteness of the new state and time is checked by the compiled code.
+    // NOTE: the raw stepper requires the fused stepper (kw::fused_step). It does
+    // not update the internal state of the integrator, it ignores the specialisation
+    // of the parameters and it does not limit the timestep at the knots of the
+    // piecewise polynomials of time. The pointer is valid as long as the integrator
+    // is alive and not assigned to.
+    using raw_step_f_t = step_f_f_t;
+    raw_step_f_t get_raw_step();
+
+    const taylor_ctor_timings &get_ctor_timings() const
+    {
+        return m_ctor_timings;
+    }
+
+    taylor_memory_usage get_memory_usage() const;
+
+    // Performance counters.
+    // NOTE: the collection of the performance counters
+    // is disabled by default, as the timings introduce
+    // a small overhead in each timestep.
+    bool get_perf_counters_enabled() const
+    {
+        return m_perf_enabled;
+    }
+    void set_perf_counters_enabled(bool flag)
+    {
+        m_perf_enabled = flag;
+    }
+    const taylor_perf_counters &get_perf_counters() const
+    {
+        return m_perf;
+    }
+    void reset_perf_counters()
+    {
+        m_perf = taylor_perf_counters{};
+    }
+    void log_perf_counters() const;
+
+    // Parallel event detection.
+    // NOTE: if enabled, the root isolation phase of event detection
+    // is run in parallel when the number of events not ruled out by the
+    // pre-screening is large enough. This is disabled by default,
+    // and it is worth it only with a large number of events.
+    // The results are bitwise identical to the serial event detection,
+    // regardless of the number of threads.
+    bool get_parallel_event_detection() const
+    {
+        return m_par_ed;
+    }
+    void set_parallel_event_detection(bool flag)
+    {
+        m_par_ed = flag;
+    }
+
+    // Per-thread scratch memory for the steps with events.
+    // NOTE: if enabled, the jet of derivatives computed in the
+    // steps with events is stored in a buffer shared by all the
+    // integrators stepping in the same thread (instead of a buffer
+    // owned by the integrator), and the Taylor coefficients are
+    // copied out at the end of each step. This reduces the resident
+    // memory of large pools of integrators with events. This is
+    // disabled by default, and it is not serialised.
+    bool get_thread_scratch() const
+    {
+        return m_thread_scratch;
+    }
+    void set_thread_scratch(bool);
+    bool get_separate_ev_jet() const
+    {
+        return m_sep_ev_jet;
+    }
 
     std::tuple<taylor_outcome, T> step(bool = false);
     std::tuple<taylor_outcome, T> step_backward(bool = false);
     std::tuple<taylor_outcome, T> step(T, bool = false);
 
+    // Fixed-step integration. prepare_fixed_step() compiles a stepper
+    // without step-size control, with the given order (zero means the
+    // order of the integrator). step_fixed() takes a single timestep of the
+    // given size, compiling the fixed-step stepper first if needed. The
+    // Taylor coefficients can be written only if the order of the
+    // fixed-step stepper is the order of the integrator. The fixed-step
+    // mode is not available in the presence of events.
+    void prepare_fixed_step(std::uint32_t = 0);
+    std::uint32_t get_fixed_step_order() const;
+    std::tuple<taylor_outcome, T> step_fixed(T, bool = false);
+
+    // Variable-order mode. enable_var_order() compiles adaptive steppers for
+    // the given orders (which must be at least 2 and less than the order of the
+    // integrator), sharing the same decomposition. If no orders are passed, the orders
+    // m_order - 4 and m_order - 8 are used (if valid). In variable-order mode, each timestep
+    // is taken with the order minimising the cost per unit of integration time, estimated from
+    // the cost of a timestep (measured once in enable_var_order()) and from the last timestep
+    // size determined for each order. The timesteps of the lower orders are determined so that the
+    // tolerance is still satisfied, and their Taylor coefficients are padded with zeroes up to the
+    // order of the integrator. The variable-order mode is not available in the presence of events
+    // or with the fused stepper.
+    void enable_var_order(std::vector<std::uint32_t> = {});
+    void disable_var_order();
+    const std::vector<std::uint32_t> &get_var_orders() const
+    {
+        return m_vo_orders;
+    }
+    // The order of the last timestep taken in variable-order mode.
+    std::uint32_t get_last_order() const;
+
+    // Functions of the state (e.g., energy, orbital elements) compiled alongside
+    // the integrator. The sv_funcs may depend on the state variables and on the
+    // runtime parameters, but not on time. get_sv_values() evaluates them for the
+    // current state, and, in the propagate_grid() functions, the output components
+    // dim, dim + 1, ... select the sv_funcs. Passing an empty list removes the sv_funcs.
+    // NOTE: an sv_func identical to the equation of an event shares the decomposition
+    // of the stepper, and in propagate_grid() its values at the grid points are computed
+    // from the Taylor coefficients of the event equation, without evaluating the sv_funcs.
+    // NOTE: the sv_funcs are not serialised.
+    void set_sv_funcs(std::vector<expression>);
+    const std::vector<expression> &get_sv_funcs() const
+    {
+        return m_sv_funcs;
+    }
+    const std::vector<T> &get_sv_values() const;
+
+    // Step-size collapse detector for the propagate_*() functions. If enabled, a
+    // propagation stops with the taylor_outcome::err_h_collapse outcome after n_steps
+    // consecutive timesteps with an absolute size smaller than rel_h times the time
+    // span of the propagation (e.g., because the trajectory has become stiff), instead
+    // of grinding through a large number of tiny timesteps. A rel_h of zero disables
+    // the detector (which is the default).
+    // NOTE: the settings are not serialised.
+    void set_h_collapse(T, std::size_t);
+    std::pair<T, std::size_t> get_h_collapse() const
+    {
+        return {m_hc_rel, m_hc_n};
+    }
+
+    // Invariants monitor for the propagate_until() and propagate_for() functions
+    // (e.g., for the energy of a conservative system). The invariants are functions of the
+    // state variables and of the runtime parameters, compiled at the time of the call of
+    // set_invariants(), and they are evaluated every n_steps timesteps. The evaluations are
+    // recorded in a history of at most hist_size records (the older records are discarded),
+    // each consisting of the time followed by the values of the invariants. The drift of
+    // an invariant is abs(v - v0), where v0 is its value at the time of the call of
+    // set_invariants(), divided by abs(v0) if v0 is nonzero. If thresholds is not empty,
+    // it must contain one positive value per invariant (an infinite value meaning no
+    // threshold), and the propagation stops with the taylor_outcome::cb_stop outcome
+    // as soon as the drift of an invariant exceeds its threshold. Passing an empty
+    // list of invariants removes the monitor.
+    // NOTE: the monitor is not serialised.
+    void set_invariants(std::vector<expression>, std::size_t = 1, std::vector<T> = {}, std::size_t = 1000);
+    const std::vector<expression> &get_invariants() const
+    {
+        return m_invs;
+    }
+    const std::vector<T> &get_invariants_ref() const
+    {
+        return m_inv_ref;
+    }
+    const std::vector<T> &get_invariants_drift() const
+    {
+        return m_inv_drift;
+    }
+    // The history of the evaluations of the invariants, from the oldest
+    // to the newest, with shape (n_records, n_invariants + 1).
+    std::vector<T> get_invariants_history() const;
+
+    // Binary serialisation.
+    void save(std::ostream &) const;
+    static taylor_adaptive_impl load(std::istream &, std::vector<t_event_t> = {}, std::vector<nt_event_t> = {});
+
 private:
     // Parser for the common kwargs options for the propagate_*() functions.
     template <typename... KwArgs>
@@ -706,9 +1995,11 @@ private:
             }();
 
             // Callback (defaults to empty).
-            auto cb = [&p]() -> std::function<bool(taylor_adaptive_impl &)> {
+            auto cb = [&p]() -> propagate_cb_t {
                 if constexpr (p.has(kw::callback)) {
-                    return std::forward<decltype(p(kw::callback))>(p(kw::callback));
+                    // NOTE: the callback is referenced, not copied: it is
+                    // guaranteed to outlive the propagate_*() function call.
+                    return p(kw::callback);
                 } else {
                     return {};
                 }
@@ -728,11 +2019,125 @@ private:
         }
     }
 
+    // Parser for the continuous output option of
+    // the propagate_until()/propagate_for() functions.
+    template <typename... KwArgs>
+    static continuous_output_impl<T> *propagate_c_output_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has(kw::c_output)) {
+            return &static_cast<continuous_output_impl<T> &>(p(kw::c_output));
+        } else {
+            return nullptr;
+        }
+    }
+
+    // Parser for the buffer of the non-terminal events
+    // option of the propagate_*() functions.
+    template <typename... KwArgs>
+    static nt_buffer_t *propagate_nt_buffer_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has(kw::nt_buffer)) {
+            return &static_cast<nt_buffer_t &>(p(kw::nt_buffer));
+        } else {
+            return nullptr;
+        }
+    }
+
+    // RAII helper to set the buffer of the non-terminal
+    // events for the duration of a propagate_*() call. The
+    // buffer is cleared on entry (preserving its capacity),
+    // and the previous buffer is restored on exit.
+    class nt_buffer_guard
+    {
+        taylor_adaptive_impl &m_ta;
+        nt_buffer_t *const m_prev;
+
+    public:
+        explicit nt_buffer_guard(taylor_adaptive_impl &ta, nt_buffer_t *buf) : m_ta(ta), m_prev(ta.m_nt_buf)
+        {
+            if (buf != nullptr) {
+                buf->clear();
+                m_ta.m_nt_buf = buf;
+            }
+        }
+        nt_buffer_guard(const nt_buffer_guard &) = delete;
+        nt_buffer_guard(nt_buffer_guard &&) = delete;
+        nt_buffer_guard &operator=(const nt_buffer_guard &) = delete;
+        nt_buffer_guard &operator=(nt_buffer_guard &&) = delete;
+        ~nt_buffer_guard()
+        {
+            m_ta.m_nt_buf = m_prev;
+        }
+    };
+
+    // The type of the callback of the asynchronous propagate_*() functions.
+    using async_cb_t = std::function<bool(taylor_adaptive_impl &)>;
+
+    // Parser for the options of the asynchronous propagate_*() functions.
+    // NOTE: unlike in the synchronous functions, the callback is copied, as
+    // it must outlive the function call.
+    template <typename... KwArgs>
+    static auto propagate_async_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has(kw::c_output) || p.has(kw::nt_buffer)) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The 'c_output' and 'nt_buffer' keyword arguments are not supported "
+                          "in the asynchronous propagate_*() functions.");
+            throw;
+        } else {
+            // Callback (defaults to empty).
+            auto cb = [&p]() -> async_cb_t {
+                if constexpr (p.has(kw::callback)) {
+                    return std::forward<decltype(p(kw::callback))>(p(kw::callback));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Executor (defaults to empty, i.e., a new thread).
+            auto ex = [&p]() -> taylor_executor_t {
+                if constexpr (p.has(kw::executor)) {
+                    return std::forward<decltype(p(kw::executor))>(p(kw::executor));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Cancellation flag (defaults to null).
+            auto cancel = [&p]() -> taylor_cancel_flag_t {
+                if constexpr (p.has(kw::cancel)) {
+                    return std::forward<decltype(p(kw::cancel))>(p(kw::cancel));
+                } else {
+                    return {};
+                }
+            }();
+
+            return std::tuple{std::move(cb), std::move(ex), std::move(cancel)};
+        }
+    }
+
     // Implementations of the propagate_*() functions.
     std::tuple<taylor_outcome, T, T, std::size_t>
-    propagate_until_impl(const dfloat<T> &, std::size_t, T, std::function<bool(taylor_adaptive_impl &)>, bool);
-    std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>>
-    propagate_grid_impl(const std::vector<T> &, std::size_t, T, std::function<bool(taylor_adaptive_impl &)>);
+    propagate_until_impl(const dfloat<T> &, std::size_t, T, propagate_cb_t, bool, continuous_output_impl<T> *);
+    template <typename U>
+    std::tuple<taylor_outcome, T, T, std::size_t, std::vector<U>>
+    propagate_grid_impl(const std::vector<T> &, std::size_t, T, propagate_cb_t, const std::vector<std::uint32_t> &);
+    template <typename U>
+    std::tuple<taylor_outcome, T, T, std::size_t, std::size_t>
+    propagate_grid_impl(const std::vector<T> &, std::size_t, T, propagate_cb_t, U *, const std::vector<std::uint32_t> &,
+                        std::size_t);
+    std::future<std::tuple<taylor_outcome, T, T, std::size_t>>
+    propagate_until_async_impl(const dfloat<T> &, std::size_t, T, async_cb_t, bool, const taylor_executor_t &,
+                               taylor_cancel_flag_t);
+    std::future<std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>>>
+    propagate_grid_async_impl(std::vector<T>, std::size_t, T, async_cb_t, std::vector<std::uint32_t>,
+                              const taylor_executor_t &, taylor_cancel_flag_t);
 
 public:
     // NOTE: return values:
@@ -741,30 +2146,109 @@ public:
     // - max abs(timestep),
     // - total number of nonzero steps
     //   successfully undertaken,
-    // - grid of state vectors (only for propagate_grid()).
+    // - grid of state vectors (only for propagate_grid()), or
+    //   number of grid points written into the output
+    //   buffer (only for the propagate_grid() overload
+    //   accepting an output buffer).
     // NOTE: the min/max timesteps are well-defined
     // only if at least 1-2 steps were taken successfully.
+    // NOTE: in the propagate_until()/propagate_for() functions, a continuous_output
+    // object can be passed via the 'c_output' kwarg: the steps taken by the integrator
+    // will be appended to it.
+    // NOTE: in all the propagate_*() functions, a buffer of type nt_buffer_t can be passed
+    // via the 'nt_buffer' kwarg: the buffer is cleared and the non-terminal events triggered
+    // during the propagation are appended to it, instead of invoking the event callbacks.
     template <typename... KwArgs>
     std::tuple<taylor_outcome, T, T, std::size_t> propagate_until(T t, KwArgs &&...kw_args)
     {
-        auto [max_steps, max_delta_t, cb, write_tc] = propagate_common_ops(std::forward<KwArgs>(kw_args)...);
+        auto [max_steps, max_delta_t, cb, write_tc] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
 
-        return propagate_until_impl(dfloat<T>(t), max_steps, max_delta_t, std::move(cb), write_tc);
+        return propagate_until_impl(dfloat<T>(t), max_steps, max_delta_t, std::move(cb), write_tc,
+                                    propagate_c_output_ops(std::forward<KwArgs>(kw_args)...));
     }
     template <typename... KwArgs>
     std::tuple<taylor_outcome, T, T, std::size_t> propagate_for(T delta_t, KwArgs &&...kw_args)
     {
-        auto [max_steps, max_delta_t, cb, write_tc] = propagate_common_ops(std::forward<KwArgs>(kw_args)...);
+        auto [max_steps, max_delta_t, cb, write_tc] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
 
-        return propagate_until_impl(m_time + delta_t, max_steps, max_delta_t, std::move(cb), write_tc);
+        return propagate_until_impl(m_time + delta_t, max_steps, max_delta_t, std::move(cb), write_tc,
+                                    propagate_c_output_ops(std::forward<KwArgs>(kw_args)...));
     }
-    template <typename... KwArgs>
-    std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>> propagate_grid(const std::vector<T> &grid,
+    // NOTE: in the propagate_grid() functions, the 'components' kwarg
+    // can be used to select the state components to output (defaults to all).
+    // NOTE: if the first grid point lies ahead of the current time in the
+    // direction of the grid, all the grid points are computed via dense output,
+    // and only the last timestep is truncated (so that the integration
+    // ends at the last grid point).
+    // NOTE: the floating-point type U of the output defaults to T, and it can
+    // also be float or double (e.g., ta.propagate_grid<float>(grid)). The integration
+    // is always performed in the precision of T, and the values are converted when
+    // they are written into the output.
+    template <typename U = T, typename... KwArgs>
+    std::tuple<taylor_outcome, T, T, std::size_t, std::vector<U>> propagate_grid(const std::vector<T> &grid,
                                                                                  KwArgs &&...kw_args)
     {
-        auto [max_steps, max_delta_t, cb, _] = propagate_common_ops(std::forward<KwArgs>(kw_args)...);
+        static_assert(is_grid_out_fp_v<T, U>, "Invalid output type for propagate_grid().");
+
+        auto [max_steps, max_delta_t, cb, _] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
+        const auto comps = std::get<0>(propagate_grid_out_ops(std::forward<KwArgs>(kw_args)...));
 
-        return propagate_grid_impl(grid, max_steps, max_delta_t, std::move(cb));
+        return propagate_grid_impl<U>(grid, max_steps, max_delta_t, std::move(cb), comps);
+    }
+    // Overload writing the output into the buffer out: the output components
+    // for the i-th grid point are written starting from out + i * stride. The
+    // stride can be specified via the 'stride' kwarg, and it defaults to the number
+    // of output components. The values in the output buffer corresponding to grid points
+    // which are not reached (e.g., because of a stopping terminal event) are not modified.
+    template <typename U, typename... KwArgs, std::enable_if_t<is_grid_out_fp_v<T, U>, int> = 0>
+    std::tuple<taylor_outcome, T, T, std::size_t, std::size_t> propagate_grid(const std::vector<T> &grid, U *out,
+                                                                              KwArgs &&...kw_args)
+    {
+        auto [max_steps, max_delta_t, cb, _] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
+        auto [comps, stride] = propagate_grid_out_ops(std::forward<KwArgs>(kw_args)...);
+
+        return propagate_grid_impl<U>(grid, max_steps, max_delta_t, std::move(cb), out, comps, stride);
+    }
+
+    // Asynchronous versions of propagate_until(), propagate_for() and propagate_grid().
+    // The propagation is run by the executor passed via the 'executor' kwarg (defaults
+    // to a new thread), and its result is delivered via the returned future. The propagation
+    // can be cancelled by setting the flag passed via the 'cancel' kwarg: the flag is checked
+    // after each step, and a cancelled propagation stops with the taylor_outcome::cb_stop outcome.
+    // NOTE: the integrator must not be used (nor destroyed) until the future is ready. With
+    // the default executor, the destructor of the future waits for the end of the propagation.
+    template <typename... KwArgs>
+    std::future<std::tuple<taylor_outcome, T, T, std::size_t>> propagate_until_async(T t, KwArgs &&...kw_args)
+    {
+        auto [max_steps, max_delta_t, _, write_tc] = propagate_common_ops(kw_args...);
+        auto [cb, ex, cancel] = propagate_async_ops(std::forward<KwArgs>(kw_args)...);
+
+        return propagate_until_async_impl(dfloat<T>(t), max_steps, max_delta_t, std::move(cb), write_tc, ex,
+                                          std::move(cancel));
+    }
+    template <typename... KwArgs>
+    std::future<std::tuple<taylor_outcome, T, T, std::size_t>> propagate_for_async(T delta_t, KwArgs &&...kw_args)
+    {
+        auto [max_steps, max_delta_t, _, write_tc] = propagate_common_ops(kw_args...);
+        auto [cb, ex, cancel] = propagate_async_ops(std::forward<KwArgs>(kw_args)...);
+
+        return propagate_until_async_impl(m_time + delta_t, max_steps, max_delta_t, std::move(cb), write_tc, ex,
+                                          std::move(cancel));
+    }
+    template <typename... KwArgs>
+    std::future<std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>>>
+    propagate_grid_async(std::vector<T> grid, KwArgs &&...kw_args)
+    {
+        const auto c_ops = propagate_common_ops(kw_args...);
+        auto comps = std::get<0>(propagate_grid_out_ops(kw_args...));
+        auto [cb, ex, cancel] = propagate_async_ops(std::forward<KwArgs>(kw_args)...);
+
+        return propagate_grid_async_impl(std::move(grid), std::get<0>(c_ops), std::get<1>(c_ops), std::move(cb),
+                                         std::move(comps), ex, std::move(cancel));
     }
 };
 
@@ -773,14 +2257,61 @@ public:
 template <typename T>
 using taylor_adaptive = detail::taylor_adaptive_impl<T>;
 
+template <typename T>
+using continuous_output = detail::continuous_output_impl<T>;
+
+template <typename T>
+using ephemeris = detail::ephemeris_impl<T>;
+
 namespace detail
 {
 
+// View of the data of an adaptive batch integrator, passed to the callbacks
+// of the propagate_*() functions with signature bool(const taylor_batch_view<T> &)
+// after each timestep. The state and the parameters are stored in the
+// structure-of-arrays layout of the batch integrator, so that the values
+// of the j-th state variable (or parameter) for all the batch elements are
+// contiguous in memory (see state_row() and pars_row()). step_res
+// points to the outcomes of the last timestep, one per batch element.
+template <typename T>
+struct taylor_batch_view_impl {
+    const T *state = nullptr;
+    const T *time = nullptr;
+    const T *pars = nullptr;
+    std::uint32_t dim = 0;
+    std::uint32_t n_pars = 0;
+    std::uint32_t batch_size = 0;
+    const std::tuple<taylor_outcome, T> *step_res = nullptr;
+
+    const T *state_row(std::uint32_t j) const
+    {
+        return state + static_cast<std::size_t>(j) * batch_size;
+    }
+    const T *pars_row(std::uint32_t j) const
+    {
+        return pars + static_cast<std::size_t>(j) * batch_size;
+    }
+};
+
 template <typename T>
 class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
 {
     static_assert(is_supported_fp_v<T>, "Unhandled type.");
 
+public:
+    using nt_event_t = nt_event_batch<T>;
+    using t_event_t = t_event_batch<T>;
+    // The type of the batched callback for the non-terminal events
+    // (see the scalar integrator). It is invoked separately for each
+    // batch element, whose index is passed as last argument.
+    using nt_batch_cb_t = std::function<void(taylor_adaptive_batch_impl &,
+                                             const std::vector<std::tuple<std::uint32_t, T, int>> &, std::uint32_t)>;
+    // The buffer for the non-terminal events triggered
+    // in a propagation: one list per batch element (see
+    // the scalar integrator).
+    using nt_buffer_t = std::vector<std::vector<std::tuple<std::uint32_t, T, int>>>;
+
+private:
     // The batch size.
     std::uint32_t m_batch_size;
     // State vectors.
@@ -788,20 +2319,43 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
     // Times.
     std::vector<T> m_time_hi, m_time_lo;
     // The LLVM machinery.
-    llvm_state m_llvm;
+    // NOTE: the LLVM state is shared among the
+    // integrators created via shared_copy(). It is
+    // never modified after the construction of
+    // the integrator.
+    std::shared_ptr<llvm_state> m_llvm = std::make_shared<llvm_state>();
     // Dimension of the system.
     std::uint32_t m_dim;
     // Taylor decomposition.
-    taylor_dc_t m_dc;
+    // NOTE: the decomposition is never modified after the
+    // construction of the integrator, and it is shared among
+    // the copies of the integrator.
+    std::shared_ptr<const taylor_dc_t> m_dc;
     // Taylor order.
     std::uint32_t m_order;
-    // The stepper.
+    // The steppers.
+    // NOTE: see the scalar integrator for
+    // an explanation of the fused stepper.
     using step_f_t = void (*)(T *, const T *, const T *, T *, T *);
-    step_f_t m_step_f;
+    using step_f_e_t = void (*)(T *, const T *, const T *, const T *, T *);
+    using step_f_f_t = void (*)(T *, const T *, T *, T *, T *, T *, std::int32_t *);
+    std::variant<step_f_t, step_f_e_t, step_f_f_t> m_step_f;
+    // Flag signalling the use of the fused stepper.
+    bool m_fused_step = false;
     // The vector of parameters.
     std::vector<T> m_pars;
+    // The tolerances of the batch elements.
+    std::vector<T> m_lane_tols;
+    // The knots of the piecewise polynomials of time
+    // (see the scalar integrator), and the buffer for the
+    // max timesteps limited at the knots.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_tpw_knots;
+    std::vector<T> m_tpw_max_delta_ts;
     // The vector for the Taylor coefficients.
-    std::vector<T> m_tc;
+    // NOTE: see the scalar integrator for an
+    // explanation of the lazy copy from m_ev_jet.
+    mutable std::vector<T> m_tc;
+    mutable bool m_tc_pending = false;
     // The sizes of the last timesteps taken.
     std::vector<T> m_last_h;
     // The function for computing the dense output.
@@ -809,32 +2363,120 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
     d_out_f_t m_d_out_f;
     // The vector for the dense output.
     std::vector<T> m_d_out;
+    // The function for computing the enclosure of the state
+    // over the last timesteps, and the vector for the enclosure.
+    // NOTE: see the scalar integrator.
+    d_out_f_t m_tc_enc_f = nullptr;
+    std::vector<T> m_tc_enc;
+    // The vector of terminal events.
+    std::vector<t_event_t> m_tes;
+    // The vector of non-terminal events.
+    std::vector<nt_event_t> m_ntes;
+    // The batched callback for the non-terminal events.
+    // NOTE: this is not serialised.
+    nt_batch_cb_t m_nt_batch_cb;
+    // The user-provided buffer for the non-terminal
+    // events (see the scalar integrator).
+    nt_buffer_t *m_nt_buf = nullptr;
+    // The jet of derivatives for the state variables
+    // and the events. This is used only if there
+    // are events, otherwise it stays empty.
+    detail::aligned_vector<T> m_ev_jet;
+    // The flag signalling whether the jet of derivatives
+    // is stored in a per-thread scratch buffer instead of
+    // m_ev_jet (see set_thread_scratch()).
+    // NOTE: this is not serialised.
+    bool m_thread_scratch = false;
+    // The vectors of detected terminal events,
+    // one per batch element.
+    std::vector<std::vector<std::tuple<std::uint32_t, T, bool, int>>> m_d_tes;
+    // The vectors of cooldowns for the terminal events,
+    // one per batch element. See the scalar
+    // integrator for an explanation.
+    std::vector<std::vector<std::optional<std::pair<T, T>>>> m_te_cooldowns;
+    // The vectors of detected non-terminal events,
+    // one per batch element.
+    std::vector<std::vector<std::tuple<std::uint32_t, T, int>>> m_d_ntes;
+    // The scratch memory for event detection.
+    // NOTE: this is not copied, it will be
+    // set up by the first event detection.
+    detail::ed_data<T> m_ed_data;
     // Temporary vectors for use
     // in the timestepping functions.
     // These two are used as default values,
     // they must never be modified.
     std::vector<T> m_pinf, m_minf;
-    // This is used as temporary storage in step_impl().
+    // These are used as temporary storage in step_impl().
     std::vector<T> m_delta_ts;
+    std::vector<std::int32_t> m_step_flags;
     // The vectors used to store the results of the step
     // and propagate functions.
     std::vector<std::tuple<taylor_outcome, T>> m_step_res;
     std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> m_prop_res;
+    // The mask of the active batch elements
+    // (see set_lane_active()).
+    // NOTE: this is not serialised.
+    std::vector<int> m_active;
     // Temporary vectors used in the propagate_*() implementations.
     std::vector<std::size_t> m_ts_count;
     std::vector<T> m_min_abs_h, m_max_abs_h;
     std::vector<T> m_cur_max_delta_ts;
     std::vector<dfloat<T>> m_pfor_ts;
     std::vector<int> m_t_dir;
+    // The mask of the batch elements advanced by step_impl()
+    // in the propagate_*() implementations.
+    std::vector<int> m_step_active;
     std::vector<dfloat<T>> m_rem_time;
     // Temporary vector used in the dense output implementation.
     std::vector<T> m_d_out_time;
-
-    HEYOKA_DLL_LOCAL void step_impl(const std::vector<T> &, bool);
+    // Temporary vector used to store the timesteps
+    // used during event detection.
+    std::vector<T> m_ev_orig_h;
+    // The compiled function for the evaluation of the sv_funcs
+    // (see the scalar integrator), the buffer for their values
+    // and the buffers for the state, the parameters and the values
+    // of a single batch element.
+    // NOTE: these are not serialised.
+    using sv_funcs_f_t = void (*)(T *, const T *, const T *, std::uint64_t);
+    std::shared_ptr<llvm_state> m_svf_llvm;
+    sv_funcs_f_t m_svf_f = nullptr;
+    std::vector<expression> m_sv_funcs;
+    mutable std::vector<T> m_sv_values;
+    mutable std::vector<T> m_sv_state, m_sv_pars, m_sv_out;
+    // The compiled function for the evaluation of the stop
+    // condition (see set_stop_cond()), the buffers for the state
+    // and the parameters of a single batch element and the flags
+    // signalling the batch elements stopped in a propagation (1 for
+    // the stop condition, 2 for the exhaustion of the per-lane step budget).
+    // NOTE: these are not serialised.
+    std::shared_ptr<llvm_state> m_stop_llvm;
+    sv_funcs_f_t m_stop_f = nullptr;
+    std::optional<expression> m_stop_cond;
+    mutable std::vector<T> m_stop_state, m_stop_pars;
+    std::vector<int> m_stop_flags;
+    // The timings of the construction.
+    // NOTE: these are not serialised.
+    taylor_ctor_timings m_ctor_timings;
+
+    HEYOKA_DLL_LOCAL void step_impl(const std::vector<T> &, bool, const std::vector<int> &);
+    HEYOKA_DLL_LOCAL void sync_tc() const;
+    HEYOKA_DLL_LOCAL std::size_t ev_jet_size() const;
+    HEYOKA_DLL_LOCAL void eval_sv_funcs(const std::vector<T> &, std::uint32_t) const;
+    HEYOKA_DLL_LOCAL bool eval_stop_cond(std::uint32_t) const;
+
+    // Helper to setup the temporary vectors.
+    HEYOKA_DLL_LOCAL void setup_tmp_vectors();
+
+    // Constructor used in the deserialisation machinery.
+    HEYOKA_DLL_LOCAL taylor_adaptive_batch_impl();
+    HEYOKA_DLL_LOCAL taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &, bool);
 
     // Private implementation-detail constructor machinery.
     template <typename U>
-    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, std::uint32_t, std::vector<T>, T, bool, bool,
+    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::vector<T>, std::uint32_t, std::vector<T>, T, bool, bool, bool,
+                                              std::vector<T>, std::vector<t_event_t>, std::vector<nt_event_t>, bool,
+                                              std::uint32_t, bool, bool, std::uint32_t, bool,
+                                              std::vector<expression>, std::vector<expression>, std::uint32_t, bool,
                                               std::vector<T>);
     template <typename U, typename... KwArgs>
     void finalise_ctor(U sys, std::vector<T> state, std::uint32_t batch_size, KwArgs &&...kw_args)
@@ -847,37 +2489,143 @@ class HEYOKA_DLL_PUBLIC taylor_adaptive_batch_impl
                           "unnamed arguments.");
         } else {
             // Initial times (defaults to a vector of zeroes).
+            // NOTE: in automatic batch size mode, the initial
+            // time refers to a single batch element.
             auto time = [&p, batch_size]() -> std::vector<T> {
                 if constexpr (p.has(kw::time)) {
                     return std::forward<decltype(p(kw::time))>(p(kw::time));
                 } else {
-                    return std::vector<T>(static_cast<typename std::vector<T>::size_type>(batch_size), T(0));
+                    return std::vector<T>(
+                        static_cast<typename std::vector<T>::size_type>(batch_size == 0u ? 1u : batch_size), T(0));
                 }
             }();
 
-            auto [high_accuracy, tol, compact_mode, pars]
+            auto [high_accuracy, tol, compact_mode, pars, parallel_mode, unroll_threshold, contiguous_jets, dl_order,
+                  skip_one_way, h_vars, ha_vars, order, tune_order]
                 = taylor_adaptive_common_ops<T>(std::forward<KwArgs>(kw_args)...);
 
+            // Extract the terminal events, if any.
+            auto tes = [&p]() -> std::vector<t_event_t> {
+                if constexpr (p.has(kw::t_events)) {
+                    return std::forward<decltype(p(kw::t_events))>(p(kw::t_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Extract the non-terminal events, if any.
+            auto ntes = [&p]() -> std::vector<nt_event_t> {
+                if constexpr (p.has(kw::nt_events)) {
+                    return std::forward<decltype(p(kw::nt_events))>(p(kw::nt_events));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Tuning of the batch size in automatic
+            // batch size mode (defaults to false).
+            auto tune_bs = [&p]() -> bool {
+                if constexpr (p.has(kw::tune_batch_size)) {
+                    return std::forward<decltype(p(kw::tune_batch_size))>(p(kw::tune_batch_size));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Fused stepper (defaults to false).
+            const auto fused_step = [&p]() -> bool {
+                if constexpr (p.has(kw::fused_step)) {
+                    return std::forward<decltype(p(kw::fused_step))>(p(kw::fused_step));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Per-batch-element tolerances (defaults to empty,
+            // meaning that tol is used for all batch elements).
+            // NOTE: if provided, the Taylor order is deduced from
+            // the tightest tolerance, and tol is ignored.
+            auto lane_tols = [&p]() -> std::vector<T> {
+                if constexpr (p.has(kw::lane_tols)) {
+                    return std::forward<decltype(p(kw::lane_tols))>(p(kw::lane_tols));
+                } else {
+                    return {};
+                }
+            }();
+
+            // Automatic selection of compact mode and function inlining
+            // (defaults to false). If enabled, compact mode is selected
+            // from the size of the decomposition and of the Taylor order,
+            // overriding kw::compact_mode. Function inlining is selected
+            // as well, unless kw::inline_functions was explicitly provided.
+            const auto auto_cm = [&p]() -> bool {
+                if constexpr (p.has(kw::auto_compact_mode)) {
+                    return std::forward<decltype(p(kw::auto_compact_mode))>(p(kw::auto_compact_mode));
+                } else {
+                    return false;
+                }
+            }();
+            if (auto_cm) {
+                const auto [a_cm, a_inline] = taylor_auto_compact_mode(sys, tol, order, batch_size);
+                compact_mode = a_cm;
+                if constexpr (!p.has(kw::inline_functions)) {
+                    m_llvm->inline_functions() = a_inline;
+                }
+            }
+
+            // Budget on the estimated size of the non-compact code
+            // (defaults to zero, i.e., no budget). If the budget is exceeded
+            // in non-compact mode, compact mode is selected in order to cap the
+            // compilation time, and function inlining is disabled, unless
+            // kw::inline_functions was explicitly provided.
+            const auto cm_budget = [&p]() -> double {
+                if constexpr (p.has(kw::cm_budget)) {
+                    return std::forward<decltype(p(kw::cm_budget))>(p(kw::cm_budget));
+                } else {
+                    return 0;
+                }
+            }();
+            if (!compact_mode && cm_budget > 0 && taylor_cm_budget_exceeded(sys, tol, order, batch_size, cm_budget)) {
+                compact_mode = true;
+                if constexpr (!p.has(kw::inline_functions)) {
+                    m_llvm->inline_functions() = false;
+                }
+            }
+
             finalise_ctor_impl(std::move(sys), std::move(state), batch_size, std::move(time), tol, high_accuracy,
-                               compact_mode, std::move(pars));
+                               compact_mode, parallel_mode, std::move(pars), std::move(tes), std::move(ntes),
+                               tune_bs, unroll_threshold, contiguous_jets, fused_step, dl_order, skip_one_way,
+                               std::move(h_vars), std::move(ha_vars), order, tune_order, std::move(lane_tols));
         }
     }
 
 public:
+    // NOTE: if batch_size is zero, the batch size is selected automatically
+    // (see the finalise_ctor_impl() implementation). In such case, the state,
+    // the initial time and the parameters refer to a single batch element,
+    // and they are replicated for all the elements of the batch.
     template <typename... KwArgs>
     explicit taylor_adaptive_batch_impl(std::vector<expression> sys, std::vector<T> state, std::uint32_t batch_size,
                                         KwArgs &&...kw_args)
-        : m_llvm{std::forward<KwArgs>(kw_args)...}
+        : m_llvm{std::make_shared<llvm_state>(std::forward<KwArgs>(kw_args)...)}
     {
         finalise_ctor(std::move(sys), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
     }
     template <typename... KwArgs>
     explicit taylor_adaptive_batch_impl(std::vector<std::pair<expression, expression>> sys, std::vector<T> state,
                                         std::uint32_t batch_size, KwArgs &&...kw_args)
-        : m_llvm{std::forward<KwArgs>(kw_args)...}
+        : m_llvm{std::make_shared<llvm_state>(std::forward<KwArgs>(kw_args)...)}
     {
         finalise_ctor(std::move(sys), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
     }
+    // Constructor from a precomputed Taylor decomposition.
+    template <typename... KwArgs>
+    explicit taylor_adaptive_batch_impl(taylor_precomputed_dc dc, std::vector<T> state, std::uint32_t batch_size,
+                                        KwArgs &&...kw_args)
+        : m_llvm{std::make_shared<llvm_state>(std::forward<KwArgs>(kw_args)...)}
+    {
+        finalise_ctor(std::move(dc), std::move(state), batch_size, std::forward<KwArgs>(kw_args)...);
+    }
 
     taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &);
     taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept;
@@ -887,6 +2635,11 @@ public:
 
     ~taylor_adaptive_batch_impl();
 
+    // Create a copy of the integrator which shares
+    // the compiled code with this (see the scalar integrator).
+    taylor_adaptive_batch_impl shared_copy() const;
+    std::vector<taylor_adaptive_batch_impl> shared_copies(std::size_t) const;
+
     const llvm_state &get_llvm_state() const;
 
     const taylor_dc_t &get_decomposition() const;
@@ -894,6 +2647,10 @@ public:
     std::uint32_t get_batch_size() const;
     std::uint32_t get_order() const;
     std::uint32_t get_dim() const;
+    const std::vector<T> &get_lane_tols() const
+    {
+        return m_lane_tols;
+    }
 
     const std::vector<T> &get_time() const
     {
@@ -904,6 +2661,12 @@ public:
         return m_time_hi.data();
     }
     void set_time(const std::vector<T> &);
+    void set_time(std::uint32_t, T);
+    // Reset the batch element at index idx to new values of the state
+    // and of the time (and of the parameters, if a non-empty vector of
+    // parameters is passed), without affecting the other batch elements.
+    // The cooldowns of the batch element are reset as well.
+    void reset_lane(std::uint32_t, const std::vector<T> &, T, const std::vector<T> & = {});
 
     const std::vector<T> &get_state() const
     {
@@ -930,11 +2693,22 @@ public:
     {
         return m_pars.data();
     }
-
-    const std::vector<T> &get_tc() const
-    {
-        return m_tc;
-    }
+    // Set the state vectors (or the runtime parameters) from a strided
+    // view of an external buffer: the value of the i-th state variable
+    // (or parameter) for the j-th batch element is read from
+    // src[i * var_stride + j * lane_stride]. This allows to read the values
+    // both from the structure-of-arrays layout (e.g., var_stride equal to
+    // the number of columns of a 2D array and lane_stride equal to 1) and from
+    // the array-of-structures layout (var_stride equal to 1 and lane_stride
+    // equal to the number of state variables), without transposing them first.
+    void set_state(const T *, std::size_t, std::size_t);
+    void set_pars(const T *, std::size_t, std::size_t);
+
+    const std::vector<T> &get_tc() const;
+    // Enclosure of the Taylor polynomials of the state variables over the last
+    // timesteps, in row-major format with shape (2, dim, batch_size): first
+    // the lower bounds, then the upper bounds. See the scalar integrator.
+    const std::vector<T> &get_step_enclosure();
 
     const std::vector<T> &get_last_h() const
     {
@@ -946,16 +2720,159 @@ public:
         return m_d_out;
     }
     const std::vector<T> &update_d_output(const std::vector<T> &, bool = false);
+    void update_d_output(const T *, std::size_t, T *, bool = false) const;
+    std::vector<T> update_d_output_lanes(const std::vector<T> &, bool = false) const;
+
+    void reset_cooldowns();
+    void reset_cooldowns(std::uint32_t);
+
+    // Active batch elements. The inactive batch elements take zero-length
+    // timesteps (with outcome time_limit) and skip the post-step work (time
+    // update, non-finite checks, event detection and callbacks). They are not
+    // propagated by the propagate_*() functions, which report for them the
+    // time_limit outcome with zero steps, and they do not write any output.
+    // All the batch elements are initially active.
+    // NOTE: the mask is not serialised, all the batch
+    // elements are active in a deserialised integrator.
+    void set_lane_active(std::uint32_t, bool);
+    bool get_lane_active(std::uint32_t) const;
+    std::uint32_t get_n_active_lanes() const;
+    const std::vector<t_event_t> &get_t_events() const
+    {
+        return m_tes;
+    }
+    const std::vector<nt_event_t> &get_nt_events() const
+    {
+        return m_ntes;
+    }
+    const nt_batch_cb_t &get_nt_batch_callback() const
+    {
+        return m_nt_batch_cb;
+    }
+    void set_nt_batch_callback(nt_batch_cb_t cb)
+    {
+        m_nt_batch_cb = std::move(cb);
+    }
+
+    bool get_fused_step() const
+    {
+        return m_fused_step;
+    }
+
+    // Functions of the state (see the scalar integrator). get_sv_values()
+    // returns the values of the sv_funcs for the current state,
+    // in the same layout as the state vector.
+    void set_sv_funcs(std::vector<expression>);
+    const std::vector<expression> &get_sv_funcs() const
+    {
+        return m_sv_funcs;
+    }
+    const std::vector<T> &get_sv_values() const;
+
+    // Stop condition: a function of the state variables and of
+    // the runtime parameters, compiled at the time of the call of
+    // set_stop_cond(). In propagate_until() and propagate_for(), the
+    // stop condition is evaluated for each batch element after each
+    // timestep, and the propagation of the batch elements for which
+    // it is positive is stopped with outcome cb_stop, while the other
+    // batch elements continue to be propagated. The stop condition
+    // is thus also evaluated in the initial propagation up to the first
+    // grid point in propagate_grid(), but not in the rest of the
+    // propagate_grid*() functions. clear_stop_cond() removes
+    // the stop condition.
+    void set_stop_cond(expression);
+    void clear_stop_cond();
+    const std::optional<expression> &get_stop_cond() const
+    {
+        return m_stop_cond;
+    }
+
+    const taylor_ctor_timings &get_ctor_timings() const
+    {
+        return m_ctor_timings;
+    }
+
+    taylor_memory_usage get_memory_usage() const;
+
+    // Per-thread scratch memory for the steps
+    // with events (see the scalar integrator).
+    bool get_thread_scratch() const
+    {
+        return m_thread_scratch;
+    }
+    void set_thread_scratch(bool);
 
     void step(bool = false);
     void step_backward(bool = false);
     void step(const std::vector<T> &, bool = false);
+
+    // Binary serialisation.
+    void save(std::ostream &) const;
+    static taylor_adaptive_batch_impl load(std::istream &, std::vector<t_event_t> = {}, std::vector<nt_event_t> = {});
     const std::vector<std::tuple<taylor_outcome, T>> &get_step_res() const
     {
         return m_step_res;
     }
 
 private:
+    // The type of the callback of the propagate_*() functions
+    // (see the scalar integrator).
+    using propagate_cb_t = function_ref<bool(taylor_adaptive_batch_impl &)>;
+    // Adapter for the callbacks of the propagate_*() functions, which
+    // can be invoked either with the integrator or with a view of
+    // its data (see taylor_batch_view_impl).
+    // NOTE: the adapter references the callback, and it is in turn
+    // referenced by the propagate_cb_t passed to the implementation
+    // functions (which is thus valid for the whole propagate_*() call).
+    class propagate_cb_adapter
+    {
+        propagate_cb_t m_cb;
+        function_ref<bool(const taylor_batch_view_impl<T> &)> m_view_cb;
+
+    public:
+        propagate_cb_adapter() noexcept = default;
+        template <typename F, std::enable_if_t<!std::is_same_v<uncvref_t<F>, propagate_cb_adapter>, int> = 0>
+        explicit propagate_cb_adapter(F &&f) noexcept
+        {
+            using f_t = std::remove_reference_t<F>;
+
+            if constexpr (std::is_invocable_r_v<bool, f_t &, taylor_adaptive_batch_impl &>) {
+                m_cb = propagate_cb_t(f);
+            } else {
+                static_assert(std::is_invocable_r_v<bool, f_t &, const taylor_batch_view_impl<T> &>,
+                              "The callback of a propagate_*() function in an adaptive Taylor integrator in batch "
+                              "mode must be invocable either with the integrator or with a view of its data.");
+
+                m_view_cb = function_ref<bool(const taylor_batch_view_impl<T> &)>(f);
+            }
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(m_cb) || static_cast<bool>(m_view_cb);
+        }
+
+        bool operator()(taylor_adaptive_batch_impl &ta) const
+        {
+            if (m_cb) {
+                return m_cb(ta);
+            }
+
+            const auto view = taylor_batch_view_impl<T>{ta.m_state.data(),
+                                                        ta.m_time_hi.data(),
+                                                        ta.m_pars.data(),
+                                                        ta.m_dim,
+                                                        static_cast<std::uint32_t>(ta.m_pars.size() / ta.m_batch_size),
+                                                        ta.m_batch_size,
+                                                        ta.m_step_res.data()};
+
+            return m_view_cb(view);
+        }
+    };
+    // The type of the refill callback of propagate_grid_lanes().
+    using refill_cb_t
+        = function_ref<bool(taylor_adaptive_batch_impl &, std::uint32_t, std::vector<T> &, std::vector<T> &)>;
+
     // Parser for the common kwargs options for the propagate_*() functions.
     template <typename... KwArgs>
     auto propagate_common_ops(KwArgs &&...kw_args) const
@@ -992,9 +2909,13 @@ private:
             }();
 
             // Callback (defaults to empty).
-            auto cb = [&p]() -> std::function<bool(taylor_adaptive_batch_impl &)> {
+            // NOTE: the callback can be invoked either with the
+            // integrator or with a view of its data (see propagate_cb_adapter).
+            auto cb = [&p]() -> propagate_cb_adapter {
                 if constexpr (p.has(kw::callback)) {
-                    return std::forward<decltype(p(kw::callback))>(p(kw::callback));
+                    // NOTE: the callback is referenced, not copied: it is
+                    // guaranteed to outlive the propagate_*() function call.
+                    return propagate_cb_adapter(p(kw::callback));
                 } else {
                     return {};
                 }
@@ -1016,37 +2937,168 @@ private:
         }
     }
 
+    // Parser for the buffer of the non-terminal events
+    // option of the propagate_*() functions.
+    template <typename... KwArgs>
+    static nt_buffer_t *propagate_nt_buffer_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has(kw::nt_buffer)) {
+            return &static_cast<nt_buffer_t &>(p(kw::nt_buffer));
+        } else {
+            return nullptr;
+        }
+    }
+
+    // RAII helper to set the buffer of the non-terminal
+    // events for the duration of a propagate_*() call. The
+    // buffer is resized to the batch size and its lists are
+    // cleared on entry, and the previous buffer is restored on exit.
+    class nt_buffer_guard
+    {
+        taylor_adaptive_batch_impl &m_ta;
+        nt_buffer_t *const m_prev;
+
+    public:
+        explicit nt_buffer_guard(taylor_adaptive_batch_impl &ta, nt_buffer_t *buf) : m_ta(ta), m_prev(ta.m_nt_buf)
+        {
+            if (buf != nullptr) {
+                buf->resize(m_ta.m_batch_size);
+                for (auto &l : *buf) {
+                    l.clear();
+                }
+                m_ta.m_nt_buf = buf;
+            }
+        }
+        nt_buffer_guard(const nt_buffer_guard &) = delete;
+        nt_buffer_guard(nt_buffer_guard &&) = delete;
+        nt_buffer_guard &operator=(const nt_buffer_guard &) = delete;
+        nt_buffer_guard &operator=(nt_buffer_guard &&) = delete;
+        ~nt_buffer_guard()
+        {
+            m_ta.m_nt_buf = m_prev;
+        }
+    };
+
+    // Parser for the per-lane step budgets option of the
+    // propagate_until()/propagate_for() functions (defaults
+    // to empty, i.e., no per-lane budgets).
+    template <typename... KwArgs>
+    static std::vector<std::size_t> propagate_lane_max_steps_ops(KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has(kw::lane_max_steps)) {
+            return std::forward<decltype(p(kw::lane_max_steps))>(p(kw::lane_max_steps));
+        } else {
+            return {};
+        }
+    }
+
     // Implementations of the propagate_*() functions.
     HEYOKA_DLL_LOCAL void propagate_until_impl(const std::vector<dfloat<T>> &, std::size_t, const std::vector<T> &,
-                                               std::function<bool(taylor_adaptive_batch_impl &)>, bool);
-    void propagate_until_impl(const std::vector<T> &, std::size_t, const std::vector<T> &,
-                              std::function<bool(taylor_adaptive_batch_impl &)>, bool);
-    void propagate_for_impl(const std::vector<T> &, std::size_t, const std::vector<T> &,
-                            std::function<bool(taylor_adaptive_batch_impl &)>, bool);
-    std::vector<T> propagate_grid_impl(const std::vector<T> &, std::size_t, const std::vector<T> &,
-                                       std::function<bool(taylor_adaptive_batch_impl &)>);
+                                               propagate_cb_t, bool, const std::vector<std::size_t> &);
+    void propagate_until_impl(const std::vector<T> &, std::size_t, const std::vector<T> &, propagate_cb_t, bool,
+                              const std::vector<std::size_t> &);
+    void propagate_for_impl(const std::vector<T> &, std::size_t, const std::vector<T> &, propagate_cb_t, bool,
+                            const std::vector<std::size_t> &);
+    std::vector<T> propagate_grid_impl(const std::vector<T> &, std::size_t, const std::vector<T> &, propagate_cb_t,
+                                       const std::vector<std::uint32_t> &);
+    void propagate_grid_impl(const std::vector<T> &, std::size_t, const std::vector<T> &, propagate_cb_t, T *,
+                             const std::vector<std::uint32_t> &, std::size_t);
+    std::vector<std::vector<T>> propagate_grid_lanes_impl(std::vector<std::vector<T>>, std::size_t,
+                                                          const std::vector<T> &, propagate_cb_t, refill_cb_t,
+                                                          const std::vector<std::uint32_t> &);
 
 public:
+    // NOTE: in the propagate_until()/propagate_for() functions, the 'lane_max_steps' kwarg
+    // sets a budget on the number of timesteps of each batch element (a value of zero means
+    // no budget). A batch element exhausting its budget before reaching the final time
+    // stops with the taylor_outcome::step_limit outcome, and it takes zero-length timesteps
+    // while the other batch elements are being propagated.
     template <typename... KwArgs>
     void propagate_until(const std::vector<T> &ts, KwArgs &&...kw_args)
     {
-        auto [max_steps, max_delta_ts, cb, write_tc] = propagate_common_ops(std::forward<KwArgs>(kw_args)...);
+        auto [max_steps, max_delta_ts, cb, write_tc] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
 
-        propagate_until_impl(ts, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb), write_tc);
+        propagate_until_impl(ts, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb), write_tc,
+                             propagate_lane_max_steps_ops(kw_args...));
     }
     template <typename... KwArgs>
     void propagate_for(const std::vector<T> &ts, KwArgs &&...kw_args)
     {
-        auto [max_steps, max_delta_ts, cb, write_tc] = propagate_common_ops(std::forward<KwArgs>(kw_args)...);
+        auto [max_steps, max_delta_ts, cb, write_tc] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
 
-        propagate_for_impl(ts, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb), write_tc);
+        propagate_for_impl(ts, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb), write_tc,
+                           propagate_lane_max_steps_ops(kw_args...));
     }
+    // NOTE: in the propagate_grid() functions, the 'components' kwarg
+    // can be used to select the state components to output (defaults to all).
     template <typename... KwArgs>
     std::vector<T> propagate_grid(const std::vector<T> &grid, KwArgs &&...kw_args)
     {
-        auto [max_steps, max_delta_ts, cb, _] = propagate_common_ops(std::forward<KwArgs>(kw_args)...);
+        auto [max_steps, max_delta_ts, cb, _] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
+        const auto comps = std::get<0>(propagate_grid_out_ops(std::forward<KwArgs>(kw_args)...));
+
+        return propagate_grid_impl(grid, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb),
+                                   comps);
+    }
+    // Overload writing the output into the buffer out: the output components
+    // for the i-th batch of grid points are written starting from out + i * stride,
+    // with the same layout as the state vector. The stride can be specified via
+    // the 'stride' kwarg, and it defaults to the number of output components times
+    // the batch size. The values in the output buffer corresponding to grid points
+    // which are not reached (e.g., because of a stopping terminal event) are not modified.
+    template <typename... KwArgs>
+    void propagate_grid(const std::vector<T> &grid, T *out, KwArgs &&...kw_args)
+    {
+        auto [max_steps, max_delta_ts, cb, _] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
+        auto [comps, stride] = propagate_grid_out_ops(std::forward<KwArgs>(kw_args)...);
+
+        propagate_grid_impl(grid, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb), out, comps,
+                            stride);
+    }
+    // Propagation over per-lane grids: grids contains a separate time grid
+    // for each batch element, and the grids may have different sizes (an empty grid
+    // leaves the batch element idle). Each grid must be strictly monotonic, in the
+    // same direction as the first grid point with respect to the current time of
+    // the batch element. The return value contains, for each batch element, the
+    // selected components of the state vector at the grid points (one grid
+    // point after the other). The 'max_steps' limit applies to each batch element
+    // separately. Batch elements reaching the end of their grid (or stopping
+    // early, e.g., because of a terminal event) take zero-length steps while the
+    // others are still being propagated, unless they are refilled via the 'refill'
+    // kwarg. The refill callback is invoked as refill(ta, i, grid, out) when the batch
+    // element i completes its task: at that point, get_propagate_res()[i] contains the
+    // outcome of the task and out its output (which can be moved from). In order to start
+    // a new task, the callback must set up the state and time of the batch element
+    // (e.g., via get_state_data() and set_time(i, t)), assign the new time grid to grid
+    // and return true. When the callback returns false, the batch element is left idle.
+    template <typename... KwArgs>
+    std::vector<std::vector<T>> propagate_grid_lanes(std::vector<std::vector<T>> grids, KwArgs &&...kw_args)
+    {
+        auto [max_steps, max_delta_ts, cb, _] = propagate_common_ops(kw_args...);
+        const nt_buffer_guard nbg(*this, propagate_nt_buffer_ops(kw_args...));
+        const auto comps = std::get<0>(propagate_grid_out_ops(kw_args...));
+
+        // Refill callback (defaults to empty).
+        auto refill = [&]() -> refill_cb_t {
+            igor::parser p{kw_args...};
+
+            if constexpr (p.has(kw::refill)) {
+                return p(kw::refill);
+            } else {
+                return {};
+            }
+        }();
 
-        return propagate_grid_impl(grid, max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts, std::move(cb));
+        return propagate_grid_lanes_impl(std::move(grids), max_steps, max_delta_ts.empty() ? m_pinf : max_delta_ts,
+                                         std::move(cb), std::move(refill), comps);
     }
     const std::vector<std::tuple<taylor_outcome, T, T, std::size_t>> &get_propagate_res() const
     {
@@ -1059,6 +3111,48 @@ public:
 template <typename T>
 using taylor_adaptive_batch = detail::taylor_adaptive_batch_impl<T>;
 
+template <typename T>
+using taylor_batch_view = detail::taylor_batch_view_impl<T>;
+
+// Helpers to convert between the interleaved layout used in batch mode
+// (structure of arrays, in which the n values of each batch element
+// are stored with a stride equal to the batch size) and the layout
+// in which the values of each batch element are contiguous (array of
+// structures). The input and output ranges must not overlap.
+template <typename T>
+inline void batch_soa_to_aos(const T *soa, T *aos, std::size_t n, std::uint32_t batch_size)
+{
+    // NOTE: process the batch elements in blocks, so that
+    // the reads from soa are contiguous within each block.
+    constexpr std::uint32_t block_size = 8;
+
+    for (std::uint32_t i0 = 0; i0 < batch_size; i0 += block_size) {
+        const auto i1 = batch_size - i0 < block_size ? batch_size : i0 + block_size;
+
+        for (std::size_t j = 0; j < n; ++j) {
+            for (auto i = i0; i < i1; ++i) {
+                aos[i * n + j] = soa[j * batch_size + i];
+            }
+        }
+    }
+}
+
+template <typename T>
+inline void batch_aos_to_soa(const T *aos, T *soa, std::size_t n, std::uint32_t batch_size)
+{
+    constexpr std::uint32_t block_size = 8;
+
+    for (std::uint32_t i0 = 0; i0 < batch_size; i0 += block_size) {
+        const auto i1 = batch_size - i0 < block_size ? batch_size : i0 + block_size;
+
+        for (std::size_t j = 0; j < n; ++j) {
+            for (auto i = i0; i < i1; ++i) {
+                soa[j * batch_size + i] = aos[i * n + j];
+            }
+        }
+    }
+}
+
 namespace detail
 {
 
@@ -0,0 +1,53 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TAYLOR_EXPORT_HPP
+#define HEYOKA_TAYLOR_EXPORT_HPP
+
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+namespace heyoka
+{
+
+// Export of the Taylor stepper of an ODE system as self-contained C++ source code. The
+// returned string is a header (with no dependencies other than the standard library)
+// which defines, in a namespace with the given name:
+//
+// - the constants n_eq, n_pars, order and n_uvars,
+// - template <typename T> void jet(T *u, const T *pars, T time), which computes the
+//   Taylor derivatives up to the order 'order' of all the u variables of the Taylor
+//   decomposition. u must have size (order + 1) * n_uvars, with the values of the state
+//   variables in the first n_eq elements on input. The normalised derivative of order o
+//   of the i-th u variable is written in u[o * n_uvars + i] (the first n_eq u variables
+//   are the state variables),
+// - template <typename T> T step(T *state, const T *pars, T time, T max_h), which
+//   performs an adaptive timestep of size at most abs(max_h) in the direction
+//   of max_h (the timestep is deduced with the same formula used by the adaptive
+//   integrators for the tolerance tol), updates the state in place and returns
+//   the timestep.
+//
+// The functions are meant to be fully inlined in the user's code, for the propagation of
+// small systems in contexts in which the JIT compilation is not an option (e.g., embedded
+// deployments). The derivatives are computed with the same recurrences as the adaptive
+// integrators, but only a subset of the functions of the expression system is supported
+// (the arithmetic operations, neg(), square(), sqrt(), exp(), log(), sin(), cos(), pow()
+// with numerical exponent and time). The numbers are exported in double precision.
+HEYOKA_DLL_PUBLIC std::string taylor_export_cpp(std::vector<std::pair<expression, expression>>, const std::string &,
+                                                double = std::numeric_limits<double>::epsilon());
+HEYOKA_DLL_PUBLIC std::string taylor_export_cpp(std::vector<expression>, const std::string &,
+                                                double = std::numeric_limits<double>::epsilon());
+
+} // namespace heyoka
+
+#endif
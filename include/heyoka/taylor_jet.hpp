@@ -0,0 +1,204 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TAYLOR_JET_HPP
+#define HEYOKA_TAYLOR_JET_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/fwd_decl.hpp>
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(sv_funcs);
+
+} // namespace kw
+
+namespace detail
+{
+
+// Bulk evaluator of the jet of Taylor derivatives of an ODE system (see taylor_add_jet())
+// over arrays of points. Each point consists of the values of the state variables,
+// of the runtime parameters and of the time. The input arrays are stored in
+// row-major order, with shapes (n_eq, n_points) for the state variables and
+// (n_pars, n_points) for the runtime parameters, while the time array has size n_points.
+// NOTE: contrary to the compiled functions, the runtime parameters are not shared by the
+// points, so that jets for different values of the parameters can be computed in a single call.
+// The output array has shape (order + 1, n_eq + n_sv_funcs, n_points), that is, the
+// derivative of order o of the i-th state variable (or sv_func) for the j-th point is
+// written to out[(o * (n_eq + n_sv_funcs) + i) * n_points + j]. The points are processed
+// in batches via the SIMD jet function, and the batches are optionally distributed among
+// multiple threads.
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_jet_impl
+{
+public:
+    using jet_f_t = void (*)(T *, const T *, const T *);
+
+private:
+    // NOTE: the batch-mode and scalar jets are
+    // kept in separate states (see the notes in
+    // taylor_add_jet_impl()).
+    llvm_state m_llvm;
+    llvm_state m_llvm_scalar;
+    taylor_dc_t m_dc;
+    std::uint32_t m_order = 0;
+    std::uint32_t m_batch_size = 0;
+    std::uint32_t m_n_eq = 0;
+    std::uint32_t m_n_sv_funcs = 0;
+    std::uint32_t m_n_pars = 0;
+    bool m_has_time = false;
+    // Function pointers to the batch-mode
+    // and scalar jet functions.
+    jet_f_t m_f_batch = nullptr;
+    jet_f_t m_f_scalar = nullptr;
+
+    template <typename U>
+    HEYOKA_DLL_PUBLIC void finalise_ctor_impl(U, std::uint32_t, std::uint32_t, bool, bool, std::vector<expression>);
+    template <typename U, typename... KwArgs>
+    void finalise_ctor(U sys, std::uint32_t order, KwArgs &&...kw_args)
+    {
+        igor::parser p{kw_args...};
+
+        if constexpr (p.has_unnamed_arguments()) {
+            static_assert(detail::always_false_v<KwArgs...>,
+                          "The variadic arguments in the construction of a Taylor jet evaluator contain "
+                          "unnamed arguments.");
+        } else {
+            // Batch size (defaults to zero, meaning that the batch
+            // size will be chosen depending on the host machine).
+            auto batch_size = [&p]() -> std::uint32_t {
+                if constexpr (p.has(kw::batch_size)) {
+                    return std::forward<decltype(p(kw::batch_size))>(p(kw::batch_size));
+                } else {
+                    return 0;
+                }
+            }();
+
+            // High accuracy mode (defaults to false).
+            auto high_accuracy = [&p]() -> bool {
+                if constexpr (p.has(kw::high_accuracy)) {
+                    return std::forward<decltype(p(kw::high_accuracy))>(p(kw::high_accuracy));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Compact mode (defaults to false).
+            auto compact_mode = [&p]() -> bool {
+                if constexpr (p.has(kw::compact_mode)) {
+                    return std::forward<decltype(p(kw::compact_mode))>(p(kw::compact_mode));
+                } else {
+                    return false;
+                }
+            }();
+
+            // Functions of the state variables (defaults to empty).
+            auto sv_funcs = [&p]() -> std::vector<expression> {
+                if constexpr (p.has(kw::sv_funcs)) {
+                    return std::forward<decltype(p(kw::sv_funcs))>(p(kw::sv_funcs));
+                } else {
+                    return {};
+                }
+            }();
+
+            finalise_ctor_impl(std::move(sys), order, batch_size, high_accuracy, compact_mode, std::move(sv_funcs));
+        }
+    }
+
+public:
+    template <typename... KwArgs>
+    explicit taylor_jet_impl(std::vector<expression> sys, std::uint32_t order, KwArgs &&...kw_args)
+        : m_llvm{kw_args...}, m_llvm_scalar{kw_args...}
+    {
+        finalise_ctor(std::move(sys), order, std::forward<KwArgs>(kw_args)...);
+    }
+    template <typename... KwArgs>
+    explicit taylor_jet_impl(std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                             KwArgs &&...kw_args)
+        : m_llvm{kw_args...}, m_llvm_scalar{kw_args...}
+    {
+        finalise_ctor(std::move(sys), order, std::forward<KwArgs>(kw_args)...);
+    }
+
+    taylor_jet_impl(const taylor_jet_impl &);
+    taylor_jet_impl(taylor_jet_impl &&) noexcept;
+
+    taylor_jet_impl &operator=(const taylor_jet_impl &);
+    taylor_jet_impl &operator=(taylor_jet_impl &&) noexcept;
+
+    ~taylor_jet_impl();
+
+    const llvm_state &get_llvm_state() const;
+    const taylor_dc_t &get_decomposition() const;
+    std::uint32_t get_order() const;
+    std::uint32_t get_batch_size() const;
+    std::uint32_t get_n_eq() const;
+    std::uint32_t get_n_sv_funcs() const;
+    std::uint32_t get_n_pars() const;
+
+    void operator()(T *, const T *, std::size_t, const T * = nullptr, const T * = nullptr, unsigned = 1) const;
+    std::vector<T> operator()(const std::vector<T> &, std::size_t, const std::vector<T> & = {},
+                              const std::vector<T> & = {}, unsigned = 1) const;
+};
+
+} // namespace detail
+
+template <typename T>
+using taylor_jet = detail::taylor_jet_impl<T>;
+
+// Memoised version of taylor_add_jet(). The jet function for the ODE system sys
+// with the given order, batch size, high accuracy and compact mode flags and sv_funcs
+// is looked up in a process-wide cache, and it is added to a new llvm_state (with the
+// default options) and compiled only in case of a miss. The return value contains
+// the pointer to the compiled jet function (with the same signature as the function
+// added by taylor_add_jet()) and the llvm_state owning the compiled code. The state
+// is kept alive by the cache until the cache is cleared via taylor_clear_jet_cache(),
+// and by the return value afterwards.
+template <typename T>
+using taylor_jet_f_t = void (*)(T *, const T *, const T *);
+
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<taylor_jet_f_t<T>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet(std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool, std::vector<expression> = {});
+
+template <typename T>
+HEYOKA_DLL_PUBLIC std::pair<taylor_jet_f_t<T>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet(std::vector<std::pair<expression, expression>>, std::uint32_t, std::uint32_t, bool, bool,
+                  std::vector<expression> = {});
+
+// Number of entries in the cache of taylor_cached_jet().
+HEYOKA_DLL_PUBLIC std::size_t taylor_jet_cache_size();
+HEYOKA_DLL_PUBLIC void taylor_clear_jet_cache();
+
+} // namespace heyoka
+
+#endif
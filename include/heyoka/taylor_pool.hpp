@@ -0,0 +1,118 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TAYLOR_POOL_HPP
+#define HEYOKA_TAYLOR_POOL_HPP
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+// A thread-safe pool of adaptive Taylor integrators, meant for request-driven
+// workloads in which constructing or copying an integrator per request would be
+// too expensive. The pool is constructed from a prototype integrator, of which
+// n copies are created upfront. The integrators are checked out via handles, and
+// they are returned to the pool when the handle is destroyed. Upon return, the state,
+// time and runtime parameters of the integrator are reset to the values of the prototype
+// (and the cooldowns of the terminal events are cleared), so that every checked out
+// integrator is indistinguishable from a fresh copy of the prototype.
+// If the pool is empty upon checkout, a new copy of the prototype is created, and it
+// will be added to the pool upon return.
+// NOTE: the handles keep the pool data alive, thus they
+// can safely outlive the pool object.
+template <typename T>
+class HEYOKA_DLL_PUBLIC taylor_pool
+{
+    static_assert(detail::is_supported_fp_v<T>, "Unhandled type.");
+
+    struct impl;
+
+    std::shared_ptr<impl> m_impl;
+
+public:
+    class HEYOKA_DLL_PUBLIC handle
+    {
+        friend class taylor_pool;
+
+        std::shared_ptr<impl> m_impl;
+        std::unique_ptr<taylor_adaptive<T>> m_ta;
+
+        HEYOKA_DLL_LOCAL explicit handle(std::shared_ptr<impl>, std::unique_ptr<taylor_adaptive<T>>);
+
+    public:
+        handle() noexcept;
+        handle(const handle &) = delete;
+        handle(handle &&) noexcept;
+        handle &operator=(const handle &) = delete;
+        handle &operator=(handle &&) noexcept;
+        ~handle();
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(m_ta);
+        }
+
+        taylor_adaptive<T> &operator*() const noexcept
+        {
+            return *m_ta;
+        }
+        taylor_adaptive<T> *operator->() const noexcept
+        {
+            return m_ta.get();
+        }
+        taylor_adaptive<T> *get() const noexcept
+        {
+            return m_ta.get();
+        }
+
+        // Return the integrator to the pool
+        // before the destruction of the handle.
+        void release() noexcept;
+    };
+
+    explicit taylor_pool(const taylor_adaptive<T> &, std::size_t);
+
+    taylor_pool(const taylor_pool &) = delete;
+    taylor_pool(taylor_pool &&) noexcept;
+    taylor_pool &operator=(const taylor_pool &) = delete;
+    taylor_pool &operator=(taylor_pool &&) noexcept;
+    ~taylor_pool();
+
+    const taylor_adaptive<T> &get_prototype() const;
+
+    // Check out an integrator, creating a new one
+    // if the pool is empty.
+    handle checkout();
+    // Check out an integrator only if the pool is not empty.
+    std::optional<handle> try_checkout();
+
+    // The number of integrators currently available
+    // in the pool, and the total number of integrators
+    // created by the pool.
+    std::size_t get_n_available() const;
+    std::size_t get_size() const;
+};
+
+} // namespace heyoka
+
+#endif
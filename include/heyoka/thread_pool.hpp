@@ -0,0 +1,50 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_THREAD_POOL_HPP
+#define HEYOKA_THREAD_POOL_HPP
+
+#include <functional>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// Library-wide configuration of the threads used by the parallel
+// features of heyoka (ensemble propagations, parallel compilation,
+// parallel mode in the Taylor integrators, parallel event detection, etc.).
+
+// The maximum number of threads used by the parallel features when the number of
+// threads is not explicitly specified (e.g., via the 'n_threads' kwarg). This includes
+// the calling thread, and it defaults to the number of hardware threads available
+// on the machine. Setting it to zero restores the default value.
+HEYOKA_DLL_PUBLIC unsigned get_num_threads();
+HEYOKA_DLL_PUBLIC void set_num_threads(unsigned);
+
+// An executor is a function which, given an integer n and a function
+// task, invokes task(i) for each i in the [0, n) range, possibly concurrently,
+// and returns when all the invocations have completed. The invocations
+// of task never throw, and they do not depend on each other, hence
+// they can also be executed serially.
+// If an executor is set, it is used by the parallel features in place
+// of the threads created by heyoka. This allows heyoka to run on top
+// of an external thread pool (e.g., a TBB arena or an OpenMP runtime),
+// rather than oversubscribing the cores. Setting an empty executor restores
+// the threads created by heyoka.
+// NOTE: the executor used in the fine-grained parallel features (e.g., the parallel mode
+// of the Taylor integrators) must not throw. Thread pinning (see the
+// 'pin_threads' kwarg) is disabled when an executor is set.
+using executor_t = std::function<void(unsigned, const std::function<void(unsigned)> &)>;
+
+HEYOKA_DLL_PUBLIC executor_t get_executor();
+HEYOKA_DLL_PUBLIC void set_executor(executor_t);
+
+} // namespace heyoka
+
+#endif
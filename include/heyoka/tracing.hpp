@@ -0,0 +1,42 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_TRACING_HPP
+#define HEYOKA_TRACING_HPP
+
+#include <cstddef>
+#include <string>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// Structured tracing of the main phases in the lifecycle of the
+// integrators (construction, decomposition, code generation, optimisation,
+// compilation, propagation, event detection). When tracing is enabled,
+// each phase is recorded as a span (name, start time, duration and thread ID)
+// into a process-wide buffer, which can be exported in the Chrome trace
+// JSON format (which can be visualised with chrome://tracing or
+// with Perfetto). Tracing is disabled by default, in which case
+// the cost of a span is a single atomic load.
+HEYOKA_DLL_PUBLIC bool get_tracing_enabled();
+HEYOKA_DLL_PUBLIC void set_tracing_enabled(bool);
+
+// Number of spans currently in the buffer.
+HEYOKA_DLL_PUBLIC std::size_t get_trace_size();
+HEYOKA_DLL_PUBLIC void clear_trace();
+
+// Export the buffer as Chrome trace JSON, either as a string
+// or into a file.
+HEYOKA_DLL_PUBLIC std::string get_trace_json();
+HEYOKA_DLL_PUBLIC void save_trace(const std::string &);
+
+} // namespace heyoka
+
+#endif
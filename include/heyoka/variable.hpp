@@ -21,9 +21,21 @@
 namespace heyoka
 {
 
+namespace detail
+{
+
+struct var_entry;
+
+} // namespace detail
+
+// NOTE: the names of the variables are interned in a process-wide
+// symbol table, and a variable stores a pointer to the entry
+// of its name in the table. Thus, copying, comparing and hashing
+// variables do not involve string operations. The entries
+// of the symbol table are never removed.
 class HEYOKA_DLL_PUBLIC variable
 {
-    std::string m_name;
+    const detail::var_entry *m_ptr;
 
 public:
     explicit variable(std::string);
@@ -34,8 +46,9 @@ public:
     variable &operator=(const variable &);
     variable &operator=(variable &&) noexcept;
 
-    std::string &name();
     const std::string &name() const;
+    // The entry of the name in the symbol table.
+    const detail::var_entry *get_entry() const;
 };
 
 HEYOKA_DLL_PUBLIC void swap(variable &, variable &) noexcept;
@@ -0,0 +1,164 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_VARIATIONAL_HPP
+#define HEYOKA_VARIATIONAL_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/igor.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/detail/visibility.hpp>
+#include <heyoka/expression.hpp>
+
+namespace heyoka
+{
+
+namespace kw
+{
+
+IGOR_MAKE_NAMED_ARGUMENT(var_order);
+IGOR_MAKE_NAMED_ARGUMENT(var_params);
+IGOR_MAKE_NAMED_ARGUMENT(var_sparse);
+
+} // namespace kw
+
+namespace detail
+{
+
+HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_variational_sys_impl(std::vector<std::pair<expression, expression>>, std::uint32_t, std::vector<expression>,
+                          bool);
+
+HEYOKA_DLL_PUBLIC std::vector<double>::size_type variational_sys_size(std::vector<double>::size_type, std::uint32_t,
+                                                                      std::vector<double>::size_type);
+
+HEYOKA_DLL_PUBLIC std::vector<std::vector<double>::size_type>
+variational_ic_ones(const std::vector<std::pair<expression, expression>> &, std::vector<double>::size_type);
+
+} // namespace detail
+
+// Augment the input ODE system with its variational equations,
+// i.e., the differential equations for the partial derivatives of
+// the state with respect to the initial conditions.
+// The following optional kwargs can be passed:
+//
+// - 'var_order', the order of the variational equations (either 1 or 2,
+//   defaults to 1),
+// - 'var_params', a list of runtime parameters (e.g., {par[0], par[3]}) with respect
+//   to which the (first-order) sensitivities of the state are computed (defaults to empty),
+// - 'var_sparse', a boolean flag (defaults to false) to enable the sparse mode, in which
+//   the equations for the entries of the state transition matrix and of the sensitivities
+//   which are structurally zero (as determined symbolically from the sparsity pattern
+//   of the Jacobian) are omitted. The sparse mode is available only for order 1.
+//
+// The returned system consists of the equations of the original system,
+// followed by the first-order variational equations for the state
+// transition matrix phi_i_j = d x_i / d x_j(0), in row-major order.
+// If the order is 2, the first-order variational equations are followed by the
+// second-order variational equations for phi_i_j_k = d^2 x_i / (d x_j(0) d x_k(0)),
+// for each i and for each k >= j (as the second-order derivatives are symmetric
+// in j and k). The last equations are the ones for the sensitivities
+// phi_i_pk = d x_i / d par[k] with respect to the parameters in 'var_params', in row-major
+// order (i.e., for each i, in the order in which the parameters appear in 'var_params').
+// Here x_i is the i-th state variable, in the order in which it appears in the input
+// system. The Jacobian (and the Hessian) of the dynamics are computed via the batched
+// diff(), and the equations are interned, so that the subexpressions shared
+// between the dynamics and the variational equations are deduplicated in the
+// Taylor decomposition.
+// In sparse mode, the equations which are kept are in the same order as in the
+// dense mode, and the initial conditions can be created via the overload
+// of make_variational_ic() accepting the variational system.
+template <typename... KwArgs>
+inline std::vector<std::pair<expression, expression>>
+make_variational_sys(std::vector<std::pair<expression, expression>> sys, KwArgs &&...kw_args)
+{
+    igor::parser p{kw_args...};
+
+    if constexpr (p.has_unnamed_arguments()) {
+        static_assert(detail::always_false_v<KwArgs...>,
+                      "The variadic arguments in the construction of a variational ODE system contain "
+                      "unnamed arguments.");
+    } else {
+        // Order of the variational equations (defaults to 1).
+        auto order = [&p]() -> std::uint32_t {
+            if constexpr (p.has(kw::var_order)) {
+                return std::forward<decltype(p(kw::var_order))>(p(kw::var_order));
+            } else {
+                return 1;
+            }
+        }();
+
+        // Parameters for the sensitivities (defaults to empty).
+        auto pars = [&p]() -> std::vector<expression> {
+            if constexpr (p.has(kw::var_params)) {
+                return std::forward<decltype(p(kw::var_params))>(p(kw::var_params));
+            } else {
+                return {};
+            }
+        }();
+
+        // Sparse mode (defaults to false).
+        auto sparse = [&p]() -> bool {
+            if constexpr (p.has(kw::var_sparse)) {
+                return std::forward<decltype(p(kw::var_sparse))>(p(kw::var_sparse));
+            } else {
+                return false;
+            }
+        }();
+
+        return detail::make_variational_sys_impl(std::move(sys), order, std::move(pars), sparse);
+    }
+}
+
+// Create the initial conditions for a variational ODE system of the given order
+// with n_pars parameter sensitivities from the initial conditions of the original system:
+// the state transition matrix is initialised to the identity, while the second-order
+// derivatives and the parameter sensitivities are initialised to zero.
+template <typename T>
+inline std::vector<T> make_variational_ic(std::vector<T> state, std::uint32_t order = 1,
+                                          typename std::vector<T>::size_type n_pars = 0)
+{
+    const auto n = state.size();
+
+    // NOTE: this will also check the order.
+    state.resize(detail::variational_sys_size(n, order, n_pars));
+
+    for (decltype(state.size()) i = 0; i < n; ++i) {
+        for (decltype(state.size()) j = 0; j < n; ++j) {
+            state[n + i * n + j] = (i == j) ? T(1) : T(0);
+        }
+    }
+
+    return state;
+}
+
+// Create the initial conditions for the variational ODE system var_sys
+// (as returned by make_variational_sys()) from the initial conditions of the
+// original system. Contrary to the other overload, this works for the sparse mode too.
+template <typename T>
+inline std::vector<T> make_variational_ic(std::vector<T> state,
+                                          const std::vector<std::pair<expression, expression>> &var_sys)
+{
+    // NOTE: this will also check the sizes.
+    const auto ones = detail::variational_ic_ones(var_sys, state.size());
+
+    state.resize(var_sys.size());
+
+    for (auto idx : ones) {
+        state[idx] = T(1);
+    }
+
+    return state;
+}
+
+} // namespace heyoka
+
+#endif
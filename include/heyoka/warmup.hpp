@@ -0,0 +1,42 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef HEYOKA_WARMUP_HPP
+#define HEYOKA_WARMUP_HPP
+
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include <heyoka/detail/visibility.hpp>
+
+namespace heyoka
+{
+
+// Perform the process-wide initialisation steps which are otherwise
+// paid for by the first integrator created in the process: the
+// initialisation of LLVM's native target, the detection of the
+// features of the host machine, the construction of the tables
+// of SIMD mathematical functions and the compilation of the
+// (double-precision) event detection kernels for the given Taylor
+// orders and batch sizes. If no orders are provided, the order
+// used by the integrators with the default tolerance is assumed. If
+// no batch sizes are provided, the scalar integrators and the batch
+// integrators with the recommended SIMD size are assumed.
+HEYOKA_DLL_PUBLIC void warmup(const std::vector<std::uint32_t> & = {}, const std::vector<std::uint32_t> & = {});
+
+// Run warmup() on a background thread.
+// NOTE: the destructor of the returned future waits for
+// the completion of the warmup, thus the future
+// must be kept alive while the warmup is running.
+[[nodiscard]] HEYOKA_DLL_PUBLIC std::future<void> warmup_async(std::vector<std::uint32_t> = {},
+                                                               std::vector<std::uint32_t> = {});
+
+} // namespace heyoka
+
+#endif
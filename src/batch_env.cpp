@@ -0,0 +1,250 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/batch_env.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+template <typename T>
+batch_env<T>::batch_env(taylor_adaptive_batch<T> ta, T dt, std::vector<std::uint32_t> ctrl_idx, reset_cb_t reset_cb)
+    : m_ta(std::move(ta)), m_dt(dt), m_ctrl_idx(std::move(ctrl_idx)), m_reset_cb(std::move(reset_cb))
+{
+    using std::isfinite;
+    using namespace fmt::literals;
+
+    if (!isfinite(m_dt) || m_dt == 0) {
+        throw std::invalid_argument("The time interval of a vectorised environment must be finite and nonzero, but "
+                                    "it is {} instead"_format(m_dt));
+    }
+
+    const auto bs = m_ta.get_batch_size();
+    const auto n_pars = m_ta.get_pars().size() / bs;
+
+    for (auto idx : m_ctrl_idx) {
+        if (idx >= n_pars) {
+            throw std::invalid_argument(
+                "Invalid index {} for a control parameter in a vectorised environment: the number of runtime "
+                "parameters in the system is only {}"_format(idx, n_pars));
+        }
+    }
+
+    m_init_state = m_ta.get_state();
+    m_init_time = m_ta.get_time();
+
+    m_obs = m_ta.get_state();
+    m_terminal_obs.resize(m_obs.size());
+    m_done.resize(bs);
+    m_outcomes.resize(bs, taylor_outcome::time_limit);
+    m_dts.resize(bs, m_dt);
+}
+
+template <typename T>
+batch_env<T>::batch_env(const batch_env &) = default;
+
+template <typename T>
+batch_env<T>::batch_env(batch_env &&) noexcept = default;
+
+template <typename T>
+batch_env<T> &batch_env<T>::operator=(const batch_env &other)
+{
+    if (this != &other) {
+        *this = batch_env(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+batch_env<T> &batch_env<T>::operator=(batch_env &&) noexcept = default;
+
+template <typename T>
+batch_env<T>::~batch_env() = default;
+
+// Reset the environment at index idx.
+template <typename T>
+void batch_env<T>::reset_impl(std::uint32_t idx)
+{
+    const auto bs = m_ta.get_batch_size();
+    const auto dim = m_ta.get_dim();
+
+    std::vector<T> state(dim);
+    for (std::uint32_t j = 0; j < dim; ++j) {
+        state[j] = m_init_state[static_cast<std::size_t>(j) * bs + idx];
+    }
+
+    // NOTE: this also resets the cooldowns.
+    m_ta.reset_lane(idx, state, m_init_time[idx]);
+
+    if (m_reset_cb) {
+        m_reset_cb(m_ta, idx);
+    }
+
+    for (std::uint32_t j = 0; j < dim; ++j) {
+        const auto i = static_cast<std::size_t>(j) * bs + idx;
+        m_obs[i] = m_ta.get_state()[i];
+    }
+}
+
+template <typename T>
+const std::vector<T> &batch_env<T>::step(const std::vector<T> &ctrl)
+{
+    using namespace fmt::literals;
+
+    if (ctrl.size() != m_ctrl_idx.size() * m_ta.get_batch_size()) {
+        throw std::invalid_argument(
+            "Invalid size of the control inputs passed to the step() function of a vectorised environment: the "
+            "expected size is {}, but the size is {} instead"_format(m_ctrl_idx.size() * m_ta.get_batch_size(),
+                                                                     ctrl.size()));
+    }
+
+    return step(ctrl.data());
+}
+
+template <typename T>
+const std::vector<T> &batch_env<T>::step(const T *ctrl)
+{
+    const auto bs = static_cast<std::size_t>(m_ta.get_batch_size());
+
+    if (ctrl == nullptr && !m_ctrl_idx.empty()) {
+        throw std::invalid_argument("A null pointer was passed to the step() function of a vectorised environment");
+    }
+
+    // Set the control inputs.
+    auto *pars = m_ta.get_pars_data();
+    for (decltype(m_ctrl_idx.size()) k = 0; k < m_ctrl_idx.size(); ++k) {
+        std::copy(ctrl + k * bs, ctrl + (k + 1u) * bs, pars + m_ctrl_idx[k] * bs);
+    }
+
+    // Advance all the environments.
+    m_ta.propagate_for(m_dts);
+
+    m_obs = m_ta.get_state();
+
+    // Detect and reset the terminated environments.
+    const auto &res = m_ta.get_propagate_res();
+    for (std::uint32_t i = 0; i < bs; ++i) {
+        m_outcomes[i] = std::get<0>(res[i]);
+        m_done[i] = static_cast<int>(m_outcomes[i] != taylor_outcome::time_limit);
+
+        if (m_done[i] != 0) {
+            for (std::size_t j = 0; j < m_ta.get_dim(); ++j) {
+                m_terminal_obs[j * bs + i] = m_obs[j * bs + i];
+            }
+
+            reset_impl(i);
+        }
+    }
+
+    return m_obs;
+}
+
+template <typename T>
+const std::vector<T> &batch_env<T>::reset()
+{
+    for (std::uint32_t i = 0; i < m_ta.get_batch_size(); ++i) {
+        reset_impl(i);
+    }
+
+    std::fill(m_done.begin(), m_done.end(), 0);
+    std::fill(m_outcomes.begin(), m_outcomes.end(), taylor_outcome::time_limit);
+
+    return m_obs;
+}
+
+template <typename T>
+void batch_env<T>::reset(std::uint32_t idx)
+{
+    using namespace fmt::literals;
+
+    if (idx >= m_ta.get_batch_size()) {
+        throw std::invalid_argument("Cannot reset the environment at index {} in a vectorised environment: the "
+                                    "batch size is only {}"_format(idx, m_ta.get_batch_size()));
+    }
+
+    reset_impl(idx);
+}
+
+template <typename T>
+const taylor_adaptive_batch<T> &batch_env<T>::get_ta() const
+{
+    return m_ta;
+}
+
+template <typename T>
+taylor_adaptive_batch<T> &batch_env<T>::get_ta()
+{
+    return m_ta;
+}
+
+template <typename T>
+T batch_env<T>::get_dt() const
+{
+    return m_dt;
+}
+
+template <typename T>
+const std::vector<std::uint32_t> &batch_env<T>::get_ctrl_idx() const
+{
+    return m_ctrl_idx;
+}
+
+template <typename T>
+const std::vector<T> &batch_env<T>::get_obs() const
+{
+    return m_obs;
+}
+
+template <typename T>
+const std::vector<T> &batch_env<T>::get_terminal_obs() const
+{
+    return m_terminal_obs;
+}
+
+template <typename T>
+const std::vector<int> &batch_env<T>::get_done() const
+{
+    return m_done;
+}
+
+template <typename T>
+const std::vector<taylor_outcome> &batch_env<T>::get_outcomes() const
+{
+    return m_outcomes;
+}
+
+template class batch_env<double>;
+template class batch_env<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class batch_env<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,484 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#include <heyoka/bytecode.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math/binary_op.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/log.hpp>
+#include <heyoka/math/neg.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Number of points processed at once by the interpreter.
+// NOTE: the stack of the interpreter contains
+// bytecode_block_size values per slot.
+constexpr std::size_t bytecode_block_size = 64;
+
+// The state of the translation of an expression into bytecode.
+struct bytecode_builder {
+    std::vector<bytecode::instruction> code;
+    std::vector<double> nums;
+    std::vector<func> funcs;
+    const std::unordered_map<std::string, std::uint32_t> *vars_idx = nullptr;
+    std::uint32_t n_pars = 0;
+    // Current and maximum depth of the stack.
+    std::size_t depth = 0, max_depth = 0;
+
+    void push(bytecode::opcode op, std::uint32_t idx = 0)
+    {
+        code.push_back(bytecode::instruction{op, idx});
+    }
+    // Update the depth of the stack after the execution of an instruction
+    // which pops n_in values and pushes one value.
+    void update_depth(std::size_t n_in)
+    {
+        assert(depth >= n_in);
+
+        depth = depth - n_in + 1u;
+        max_depth = std::max(max_depth, depth);
+    }
+
+    // Fetch the dedicated opcode for the function f, if any.
+    static bool fetch_opcode(const func &f, bytecode::opcode &op)
+    {
+        if (const auto *bop = f.extract<binary_op>()) {
+            switch (bop->op()) {
+                case binary_op::type::add:
+                    op = bytecode::opcode::add;
+                    break;
+                case binary_op::type::sub:
+                    op = bytecode::opcode::sub;
+                    break;
+                case binary_op::type::mul:
+                    op = bytecode::opcode::mul;
+                    break;
+                default:
+                    assert(bop->op() == binary_op::type::div);
+                    op = bytecode::opcode::div;
+            }
+        } else if (f.extract<neg_impl>() != nullptr) {
+            op = bytecode::opcode::neg;
+        } else if (f.extract<square_impl>() != nullptr) {
+            op = bytecode::opcode::square;
+        } else if (f.extract<sqrt_impl>() != nullptr) {
+            op = bytecode::opcode::sqrt;
+        } else if (f.extract<exp_impl>() != nullptr) {
+            op = bytecode::opcode::exp;
+        } else if (f.extract<log_impl>() != nullptr) {
+            op = bytecode::opcode::log;
+        } else if (f.extract<sin_impl>() != nullptr) {
+            op = bytecode::opcode::sin;
+        } else if (f.extract<cos_impl>() != nullptr) {
+            op = bytecode::opcode::cos;
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    // Translate the expression ex (in postfix order:
+    // first the arguments, then the operation).
+    void build(const expression &ex)
+    {
+        std::visit(
+            [this](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, number>) {
+                    push(bytecode::opcode::num, boost::numeric_cast<std::uint32_t>(nums.size()));
+                    nums.push_back(std::visit([](const auto &x) { return static_cast<double>(x); }, v.value()));
+                    update_depth(0);
+                } else if constexpr (std::is_same_v<type, param>) {
+                    // LCOV_EXCL_START
+                    if (v.idx() == std::numeric_limits<std::uint32_t>::max()) {
+                        throw std::overflow_error("Overflow detected in the number of parameters of a bytecode");
+                    }
+                    // LCOV_EXCL_STOP
+
+                    push(bytecode::opcode::par, v.idx());
+                    n_pars = std::max(n_pars, v.idx() + 1u);
+                    update_depth(0);
+                } else if constexpr (std::is_same_v<type, variable>) {
+                    const auto it = vars_idx->find(v.name());
+                    if (it == vars_idx->end()) {
+                        throw std::invalid_argument("The variable '{}' appears in the expression of a bytecode, "
+                                                    "but it is not in the list of input variables"_format(v.name()));
+                    }
+
+                    push(bytecode::opcode::var, it->second);
+                    update_depth(0);
+                } else {
+                    for (const auto &arg : v.args()) {
+                        build(arg);
+                    }
+
+                    bytecode::opcode op{};
+                    if (fetch_opcode(v, op)) {
+                        push(op);
+                    } else {
+                        push(bytecode::opcode::func, boost::numeric_cast<std::uint32_t>(funcs.size()));
+                        funcs.push_back(v);
+                    }
+
+                    update_depth(v.args().size());
+                }
+            },
+            ex.value());
+    }
+};
+
+} // namespace
+
+} // namespace detail
+
+// NOTE: if vars is empty, the input variables are deduced
+// from ex and sorted alphabetically.
+bytecode::bytecode(const expression &ex, std::vector<std::string> vars)
+{
+    if (vars.empty()) {
+        vars = get_variables(ex);
+    }
+
+    std::unordered_map<std::string, std::uint32_t> vars_idx;
+    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
+        if (!vars_idx.emplace(vars[i], boost::numeric_cast<std::uint32_t>(i)).second) {
+            throw std::invalid_argument(
+                "The list of input variables of a bytecode contains the duplicate variable '{}'"_format(vars[i]));
+        }
+    }
+
+    detail::bytecode_builder b;
+    b.vars_idx = &vars_idx;
+    b.build(ex);
+    assert(b.depth == 1u);
+
+    m_code = std::move(b.code);
+    m_nums = std::move(b.nums);
+    m_funcs = std::move(b.funcs);
+    m_vars = std::move(vars);
+    m_n_pars = b.n_pars;
+    m_stack_size = b.max_depth;
+}
+
+const std::vector<bytecode::instruction> &bytecode::get_code() const
+{
+    return m_code;
+}
+
+const std::vector<std::string> &bytecode::get_vars() const
+{
+    return m_vars;
+}
+
+std::uint32_t bytecode::get_n_pars() const
+{
+    return m_n_pars;
+}
+
+std::size_t bytecode::get_stack_size() const
+{
+    return m_stack_size;
+}
+
+// Evaluate the bytecode on n_points points. in is an array in row-major order
+// with shape (n_vars, n_points), out is an array of size n_points.
+// pars is the array of runtime parameters, shared by all points.
+void bytecode::operator()(double *out, const double *in, std::size_t n_points, const double *pars) const
+{
+    if (n_points == 0u) {
+        return;
+    }
+
+    if (out == nullptr) {
+        throw std::invalid_argument("A null output array was passed to a bytecode");
+    }
+
+    if (in == nullptr && !m_vars.empty()) {
+        throw std::invalid_argument("A null input array was passed to a bytecode");
+    }
+
+    if (pars == nullptr && m_n_pars > 0u) {
+        throw std::invalid_argument(
+            "A null array of parameters was passed to a bytecode which requires {} parameter(s)"_format(m_n_pars));
+    }
+
+    constexpr auto bs = detail::bytecode_block_size;
+
+    // The evaluation stack, made of m_stack_size slots
+    // of block size values each.
+    std::vector<double> stack(m_stack_size * bs);
+    // Buffer for the arguments of the functions
+    // without dedicated opcodes.
+    std::vector<double> args_buf;
+
+    for (std::size_t b0 = 0; b0 < n_points; b0 += bs) {
+        const auto n = std::min(bs, n_points - b0);
+
+        // NOTE: sp is the pointer to the first free slot.
+        auto *sp = stack.data();
+
+        for (const auto &ins : m_code) {
+            switch (ins.op) {
+                case opcode::num:
+                    std::fill(sp, sp + n, m_nums[ins.idx]);
+                    sp += bs;
+                    break;
+                case opcode::var:
+                    std::copy(in + ins.idx * n_points + b0, in + ins.idx * n_points + b0 + n, sp);
+                    sp += bs;
+                    break;
+                case opcode::par:
+                    std::fill(sp, sp + n, pars[ins.idx]);
+                    sp += bs;
+                    break;
+                case opcode::add: {
+                    auto *a = sp - 2u * bs;
+                    const auto *c = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] += c[i];
+                    }
+                    sp -= bs;
+                    break;
+                }
+                case opcode::sub: {
+                    auto *a = sp - 2u * bs;
+                    const auto *c = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] -= c[i];
+                    }
+                    sp -= bs;
+                    break;
+                }
+                case opcode::mul: {
+                    auto *a = sp - 2u * bs;
+                    const auto *c = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] *= c[i];
+                    }
+                    sp -= bs;
+                    break;
+                }
+                case opcode::div: {
+                    auto *a = sp - 2u * bs;
+                    const auto *c = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] /= c[i];
+                    }
+                    sp -= bs;
+                    break;
+                }
+                case opcode::neg: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] = -a[i];
+                    }
+                    break;
+                }
+                case opcode::square: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] *= a[i];
+                    }
+                    break;
+                }
+                case opcode::sqrt: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] = std::sqrt(a[i]);
+                    }
+                    break;
+                }
+                case opcode::exp: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] = std::exp(a[i]);
+                    }
+                    break;
+                }
+                case opcode::log: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] = std::log(a[i]);
+                    }
+                    break;
+                }
+                case opcode::sin: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] = std::sin(a[i]);
+                    }
+                    break;
+                }
+                case opcode::cos: {
+                    auto *a = sp - bs;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        a[i] = std::cos(a[i]);
+                    }
+                    break;
+                }
+                default: {
+                    assert(ins.op == opcode::func);
+
+                    const auto &f = m_funcs[ins.idx];
+                    const auto n_args = f.args().size();
+
+                    // NOTE: the arguments are in the last n_args slots,
+                    // and the result is written in the first of them.
+                    auto *a = sp - n_args * bs;
+                    args_buf.resize(n_args);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        for (decltype(args_buf.size()) j = 0; j < n_args; ++j) {
+                            args_buf[j] = a[j * bs + i];
+                        }
+
+                        a[i] = f.eval_num_dbl(args_buf);
+                    }
+                    sp = a + bs;
+                }
+            }
+        }
+
+        assert(sp == stack.data() + bs);
+
+        std::copy(stack.data(), stack.data() + n, out + b0);
+    }
+}
+
+std::vector<double> bytecode::operator()(const std::vector<double> &in, std::size_t n_points,
+                                         const std::vector<double> &pars) const
+{
+    // LCOV_EXCL_START
+    if (!m_vars.empty() && n_points > std::numeric_limits<std::size_t>::max() / m_vars.size()) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the input array of a bytecode");
+    }
+    // LCOV_EXCL_STOP
+
+    if (in.size() != m_vars.size() * n_points) {
+        throw std::invalid_argument("The size of the input array of a bytecode ({}) is inconsistent with "
+                                    "the number of input variables ({}) and the number of points ({})"_format(
+                                        in.size(), m_vars.size(), n_points));
+    }
+
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("The bytecode requires {} parameter(s), but only {} "
+                                    "parameter value(s) were passed"_format(m_n_pars, pars.size()));
+    }
+
+    std::vector<double> out;
+    out.resize(n_points);
+
+    (*this)(out.data(), in.empty() ? nullptr : in.data(), n_points, pars.empty() ? nullptr : pars.data());
+
+    return out;
+}
+
+std::ostream &operator<<(std::ostream &os, const bytecode &bc)
+{
+    for (const auto &ins : bc.m_code) {
+        switch (ins.op) {
+            case bytecode::opcode::num:
+                os << "num " << bc.m_nums[ins.idx] << '\n';
+                break;
+            case bytecode::opcode::var:
+                os << "var " << bc.m_vars[ins.idx] << '\n';
+                break;
+            case bytecode::opcode::par:
+                os << "par " << ins.idx << '\n';
+                break;
+            case bytecode::opcode::add:
+                os << "add\n";
+                break;
+            case bytecode::opcode::sub:
+                os << "sub\n";
+                break;
+            case bytecode::opcode::mul:
+                os << "mul\n";
+                break;
+            case bytecode::opcode::div:
+                os << "div\n";
+                break;
+            case bytecode::opcode::neg:
+                os << "neg\n";
+                break;
+            case bytecode::opcode::square:
+                os << "square\n";
+                break;
+            case bytecode::opcode::sqrt:
+                os << "sqrt\n";
+                break;
+            case bytecode::opcode::exp:
+                os << "exp\n";
+                break;
+            case bytecode::opcode::log:
+                os << "log\n";
+                break;
+            case bytecode::opcode::sin:
+                os << "sin\n";
+                break;
+            case bytecode::opcode::cos:
+                os << "cos\n";
+                break;
+            default:
+                assert(ins.op == bytecode::opcode::func);
+                os << "func " << bc.m_funcs[ins.idx].get_name() << '\n';
+        }
+    }
+
+    return os;
+}
+
+} // namespace heyoka
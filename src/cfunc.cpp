@@ -0,0 +1,830 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/binary_op.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Codegen of the node ex for the compiled functions in batch
+// mode, given the values args_v of its arguments (if ex is a function).
+// vars_map maps the names of the input variables to the
+// values loaded from the input array.
+template <typename T>
+llvm::Value *cfunc_codegen_node(llvm_state &s, const expression &ex, const std::vector<llvm::Value *> &args_v,
+                                const std::unordered_map<std::string, llvm::Value *> &vars_map, llvm::Value *par_ptr,
+                                std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    return std::visit(
+        [&](const auto &v) -> llvm::Value * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                return vector_splat(builder, codegen<T>(s, v), batch_size);
+            } else if constexpr (std::is_same_v<type, param>) {
+                // NOTE: the runtime parameters are shared by
+                // all the points in a batch.
+                auto *ptr = builder.CreateInBoundsGEP(par_ptr, {builder.getInt32(v.idx())});
+
+                return vector_splat(builder, builder.CreateLoad(ptr), batch_size);
+            } else if constexpr (std::is_same_v<type, variable>) {
+                const auto it = vars_map.find(v.name());
+                assert(it != vars_map.end());
+
+                return it->second;
+            } else if constexpr (std::is_same_v<type, func>) {
+                assert(args_v.size() == v.args().size());
+
+                // NOTE: the binary operators do not have a codegen
+                // implementation, handle them here.
+                if (const auto *bop = v.template extract<binary_op>()) {
+                    assert(args_v.size() == 2u);
+
+                    switch (bop->op()) {
+                        case binary_op::type::add:
+                            return builder.CreateFAdd(args_v[0], args_v[1]);
+                        case binary_op::type::sub:
+                            return builder.CreateFSub(args_v[0], args_v[1]);
+                        case binary_op::type::mul:
+                            return builder.CreateFMul(args_v[0], args_v[1]);
+                        default:
+                            assert(bop->op() == binary_op::type::div);
+                            return builder.CreateFDiv(args_v[0], args_v[1]);
+                    }
+                }
+
+                return codegen_from_values<T>(s, v, args_v);
+            } else {
+                static_assert(always_false_v<T>, "Unhandled type.");
+            }
+        },
+        ex.value());
+}
+
+// Recursive codegen of the expression ex for the compiled functions
+// in batch mode. cache stores the values of the subexpressions already
+// evaluated (so that common subexpressions are evaluated only once).
+template <typename T>
+llvm::Value *cfunc_codegen(llvm_state &s, const expression &ex,
+                           const std::unordered_map<std::string, llvm::Value *> &vars_map, llvm::Value *par_ptr,
+                           std::uint32_t batch_size, std::unordered_map<expression, llvm::Value *> &cache)
+{
+    if (const auto it = cache.find(ex); it != cache.end()) {
+        return it->second;
+    }
+
+    // Codegen the arguments, if any.
+    std::vector<llvm::Value *> args_v;
+    if (const auto *f_ptr = std::get_if<func>(&ex.value())) {
+        for (const auto &arg : f_ptr->args()) {
+            args_v.push_back(cfunc_codegen<T>(s, arg, vars_map, par_ptr, batch_size, cache));
+        }
+    }
+
+    auto *retval = cfunc_codegen_node<T>(s, ex, args_v, vars_map, par_ptr, batch_size);
+
+    cache.emplace(ex, retval);
+
+    return retval;
+}
+
+// Helper to check the list of input variables vars of a compiled
+// function for the expressions in fn. If vars is empty, the input
+// variables will be deduced from fn and sorted alphabetically.
+std::vector<expression> cfunc_check_vars(const std::vector<expression> &fn, std::vector<expression> vars)
+{
+    // Determine the variables in the expressions.
+    std::set<std::string> fn_vars;
+    for (const auto &ex : fn) {
+        for (const auto &var : get_variables(ex)) {
+            fn_vars.emplace(var);
+        }
+    }
+
+    if (vars.empty()) {
+        // Deduce the input variables, in alphabetical order.
+        for (const auto &var : fn_vars) {
+            vars.emplace_back(variable{var});
+        }
+    } else {
+        // Check the user-provided list of input variables.
+        std::unordered_set<std::string> vars_set;
+        for (const auto &ex : vars) {
+            const auto *var_ptr = std::get_if<variable>(&ex.value());
+
+            if (var_ptr == nullptr) {
+                throw std::invalid_argument(
+                    "The list of input variables of a compiled function can contain only variables, "
+                    "but the expression '{}' was detected"_format(ex));
+            }
+
+            if (!vars_set.insert(var_ptr->name()).second) {
+                throw std::invalid_argument(
+                    "The list of input variables of a compiled function contains the duplicate variable '{}'"_format(
+                        var_ptr->name()));
+            }
+        }
+
+        for (const auto &var : fn_vars) {
+            if (vars_set.find(var) == vars_set.end()) {
+                throw std::invalid_argument("The variable '{}' appears in the expressions of a compiled function, "
+                                            "but it is not in the list of input variables"_format(var));
+            }
+        }
+    }
+
+    return vars;
+}
+
+// Helper to create the prototype of a compiled function with name 'name'
+// and to load the input variables vars. The return values are the
+// function, the pointers to the output array and to the parameters,
+// the stride and the map from the names of the input variables
+// to their values.
+template <typename T>
+auto cfunc_begin(llvm_state &s, const std::string &name, const std::vector<expression> &vars,
+                 std::uint32_t batch_size)
+{
+    if (s.module().getFunction(name) != nullptr) {
+        throw std::invalid_argument(
+            "Cannot add a compiled function with name '{}': a function with the same name already exists"_format(
+                name));
+    }
+
+    auto &builder = s.builder();
+
+    // Prepare the function prototype. The first argument is a float pointer to the output array,
+    // the second argument a const float pointer to the input array, the third argument
+    // a const float pointer to the pars, the fourth argument the stride. The arrays cannot overlap.
+    auto *fp_ptr_t = llvm::PointerType::getUnqual(to_llvm_type<T>(s.context()));
+    const std::vector<llvm::Type *> fargs{fp_ptr_t, fp_ptr_t, fp_ptr_t, builder.getInt64Ty()};
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    // LCOV_EXCL_START
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create a compiled function with name '{}'"_format(name));
+    }
+    // LCOV_EXCL_STOP
+
+    // Set the names/attributes of the function arguments.
+    auto *out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
+
+    auto *in_ptr = out_ptr + 1;
+    in_ptr->setName("in_ptr");
+    in_ptr->addAttr(llvm::Attribute::NoCapture);
+    in_ptr->addAttr(llvm::Attribute::NoAlias);
+    in_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *par_ptr = in_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *stride = par_ptr + 1;
+    stride->setName("stride");
+
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // Load the input variables.
+    // NOTE: the input and output indices are computed
+    // as uint64, thus we just need to be able
+    // to represent the number of inputs/outputs.
+    std::unordered_map<std::string, llvm::Value *> vars_map;
+    for (std::uint64_t i = 0; i < boost::numeric_cast<std::uint64_t>(vars.size()); ++i) {
+        auto *ptr = builder.CreateInBoundsGEP(in_ptr, {builder.CreateMul(builder.getInt64(i), stride)});
+
+        vars_map.emplace(std::get<variable>(vars[i].value()).name(),
+                         load_vector_from_memory(builder, ptr, batch_size));
+    }
+
+    return std::tuple{f, static_cast<llvm::Value *>(out_ptr), static_cast<llvm::Value *>(par_ptr),
+                      static_cast<llvm::Value *>(stride), std::move(vars_map)};
+}
+
+// Helper to store the value val into the row idx of the output array of a compiled function.
+void cfunc_store_output(ir_builder &builder, llvm::Value *out_ptr, llvm::Value *stride, std::uint64_t idx,
+                        llvm::Value *val)
+{
+    auto *ptr = builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(builder.getInt64(idx), stride)});
+    store_vector_to_memory(builder, ptr, val);
+}
+
+// Helper to finish off a compiled function.
+void cfunc_end(llvm_state &s, llvm::Function *f, bool optimise = true)
+{
+    s.builder().CreateRetVoid();
+
+    // Verify it.
+    s.verify_function(f);
+
+    // Run the optimisation pass.
+    if (optimise) {
+        s.optimise();
+    }
+}
+
+// Common checks for the arguments of add_cfunc() and add_cfunc_grad().
+void cfunc_check_args(const llvm_state &s, std::uint32_t batch_size)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A compiled function cannot be added to an llvm_state after compilation");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a compiled function cannot be zero");
+    }
+}
+
+
+// Helper to flatten the expression ex into a list of nodes,
+// in the same (depth-first, pre-order) ordering used
+// by compute_connections().
+void cfunc_flatten(std::vector<const expression *> &nodes, const expression &ex)
+{
+    nodes.push_back(&ex);
+
+    if (const auto *f_ptr = std::get_if<func>(&ex.value())) {
+        for (const auto &arg : f_ptr->args()) {
+            cfunc_flatten(nodes, arg);
+        }
+    }
+}
+
+// Codegen of the partial derivative of the function f with respect to its
+// i-th argument, given the values args_v of the arguments and the value f_val of the function.
+template <typename T>
+llvm::Value *cfunc_partial(llvm_state &s, const func &f, std::size_t i, const std::vector<llvm::Value *> &args_v,
+                           llvm::Value *f_val, llvm::Value *par_ptr, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    assert(i < args_v.size());
+
+    // NOTE: handle the binary operators directly, since
+    // their partial derivatives are trivial.
+    if (const auto *bop = f.extract<binary_op>()) {
+        assert(args_v.size() == 2u);
+
+        switch (bop->op()) {
+            case binary_op::type::add:
+                return vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+            case binary_op::type::sub:
+                return vector_splat(builder, codegen<T>(s, number{i == 0u ? 1. : -1.}), batch_size);
+            case binary_op::type::mul:
+                return args_v[1u - i];
+            default:
+                assert(bop->op() == binary_op::type::div);
+
+                // NOTE: d(a/b)/da = 1/b, d(a/b)/db = -(a/b)/b.
+                return i == 0u ? builder.CreateFDiv(vector_splat(builder, codegen<T>(s, number{1.}), batch_size),
+                                                    args_v[1])
+                               : builder.CreateFNeg(builder.CreateFDiv(f_val, args_v[1]));
+        }
+    }
+
+    // In the general case, replace the arguments of f with placeholder variables,
+    // differentiate symbolically with respect to the i-th placeholder and codegen
+    // the result with the placeholders bound to the values of the arguments.
+    auto g = f;
+
+    std::unordered_map<std::string, llvm::Value *> args_map;
+    std::size_t j = 0;
+    for (auto r = g.get_mutable_args_it(); r.first != r.second; ++r.first, ++j) {
+        auto arg_name = "__cfunc_arg_{}"_format(j);
+
+        *r.first = expression{variable{arg_name}};
+        args_map.emplace(std::move(arg_name), args_v[j]);
+    }
+
+    const auto dg = diff(expression{std::move(g)}, "__cfunc_arg_{}"_format(i));
+
+    std::unordered_map<expression, llvm::Value *> cache;
+    return cfunc_codegen<T>(s, dg, args_map, par_ptr, batch_size, cache);
+}
+
+template <typename T>
+std::vector<expression> add_cfunc_grad_impl(llvm_state &s, const std::string &name, const expression &ex,
+                                            std::uint32_t batch_size, std::vector<expression> vars)
+{
+    cfunc_check_args(s, batch_size);
+
+    vars = cfunc_check_vars({ex}, std::move(vars));
+
+    // Map the names of the input variables
+    // to their indices.
+    std::unordered_map<std::string, std::size_t> vars_idx;
+    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
+        vars_idx.emplace(std::get<variable>(vars[i].value()).name(), i);
+    }
+
+    const auto n_pars = get_param_size(ex);
+
+    // Build the list of nodes and their connections. The connections
+    // of a node are the indices of its arguments. In the pre-order
+    // numbering, the indices of the arguments are greater than the index
+    // of the node.
+    std::vector<const expression *> nodes;
+    cfunc_flatten(nodes, ex);
+    const auto conns = compute_connections(ex);
+    assert(conns.size() == nodes.size());
+    const auto n_nodes = nodes.size();
+
+    // NOTE: don't use structured bindings due to the
+    // usual issues with lambdas.
+    const auto c_res = cfunc_begin<T>(s, name, vars, batch_size);
+    auto *f = std::get<0>(c_res);
+    auto *out_ptr = std::get<1>(c_res);
+    auto *par_ptr = std::get<2>(c_res);
+    auto *stride = std::get<3>(c_res);
+    const auto &vars_map = std::get<4>(c_res);
+    auto &builder = s.builder();
+
+    // Helper to fetch the values of the arguments
+    // of the node k.
+    std::vector<llvm::Value *> vals(n_nodes);
+    auto fetch_args = [&](std::size_t k) {
+        std::vector<llvm::Value *> args_v;
+        for (auto c : conns[k]) {
+            assert(c > k && c < n_nodes);
+            args_v.push_back(vals[c]);
+        }
+
+        return args_v;
+    };
+
+    // Forward sweep: compute the values of all nodes, starting from the leaves.
+    // At the same time, determine which nodes depend on the input variables
+    // or on the runtime parameters. The adjoints will be propagated only
+    // to these nodes.
+    std::vector<char> active(n_nodes);
+    for (auto k = n_nodes; k-- > 0u;) {
+        vals[k] = cfunc_codegen_node<T>(s, *nodes[k], fetch_args(k), vars_map, par_ptr, batch_size);
+
+        const auto &val = nodes[k]->value();
+        active[k] = std::holds_alternative<variable>(val) || std::holds_alternative<param>(val)
+                    || std::any_of(conns[k].begin(), conns[k].end(), [&active](auto c) { return active[c] != 0; });
+    }
+
+    // Reverse sweep: propagate the adjoints from the root
+    // to the leaves, accumulating the gradient.
+    std::vector<llvm::Value *> adj(n_nodes), grad_vars(vars.size()), grad_pars(n_pars);
+    adj[0] = vector_splat(builder, codegen<T>(s, number{1.}), batch_size);
+
+    auto accumulate
+        = [&builder](llvm::Value *&acc, llvm::Value *v) { acc = (acc == nullptr) ? v : builder.CreateFAdd(acc, v); };
+
+    for (decltype(adj.size()) k = 0; k < n_nodes; ++k) {
+        if (active[k] == 0) {
+            continue;
+        }
+
+        assert(adj[k] != nullptr);
+
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    accumulate(grad_vars[vars_idx.at(v.name())], adj[k]);
+                } else if constexpr (std::is_same_v<type, param>) {
+                    assert(v.idx() < grad_pars.size());
+                    accumulate(grad_pars[v.idx()], adj[k]);
+                } else if constexpr (std::is_same_v<type, func>) {
+                    const auto args_v = fetch_args(k);
+
+                    for (decltype(conns[k].size()) i = 0; i < conns[k].size(); ++i) {
+                        const auto c = conns[k][i];
+
+                        if (active[c] == 0) {
+                            continue;
+                        }
+
+                        // NOTE: in an expression tree, each node
+                        // has a single parent.
+                        assert(adj[c] == nullptr);
+                        adj[c] = builder.CreateFMul(
+                            adj[k], cfunc_partial<T>(s, v, i, args_v, vals[k], par_ptr, batch_size));
+                    }
+                }
+            },
+            nodes[k]->value());
+    }
+
+    // Write the outputs: first the value, then the gradient
+    // with respect to the variables and the parameters.
+    auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    std::uint64_t out_idx = 0;
+
+    cfunc_store_output(builder, out_ptr, stride, out_idx++, vals[0]);
+
+    for (auto *g : grad_vars) {
+        cfunc_store_output(builder, out_ptr, stride, out_idx++, g == nullptr ? zero : g);
+    }
+
+    for (auto *g : grad_pars) {
+        cfunc_store_output(builder, out_ptr, stride, out_idx++, g == nullptr ? zero : g);
+    }
+
+    cfunc_end(s, f);
+
+    return vars;
+}
+
+// Helper to offset a pointer which might be null
+// (e.g., the input array of a compiled function
+// with no input variables).
+template <typename T>
+const T *cfunc_offset_ptr(const T *ptr, std::size_t n)
+{
+    return ptr == nullptr ? ptr : ptr + n;
+}
+
+} // namespace
+
+template <typename T>
+std::vector<expression> add_cfunc_impl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                       std::uint32_t batch_size, std::vector<expression> vars, bool optimise)
+{
+    cfunc_check_args(s, batch_size);
+
+    if (fn.empty()) {
+        throw std::invalid_argument("Cannot create a compiled function with no outputs");
+    }
+
+    vars = cfunc_check_vars(fn, std::move(vars));
+
+    auto [f, out_ptr, par_ptr, stride, vars_map] = cfunc_begin<T>(s, name, vars, batch_size);
+
+    // Evaluate the expressions and write the results.
+    std::unordered_map<expression, llvm::Value *> cache;
+    for (std::uint64_t i = 0; i < boost::numeric_cast<std::uint64_t>(fn.size()); ++i) {
+        cfunc_store_output(s.builder(), out_ptr, stride, i,
+                           cfunc_codegen<T>(s, fn[i], vars_map, par_ptr, batch_size, cache));
+    }
+
+    cfunc_end(s, f, optimise);
+
+    return vars;
+}
+
+// Explicit instantiations.
+template std::vector<expression> add_cfunc_impl<double>(llvm_state &, const std::string &,
+                                                        const std::vector<expression> &, std::uint32_t,
+                                                        std::vector<expression>, bool);
+template std::vector<expression> add_cfunc_impl<long double>(llvm_state &, const std::string &,
+                                                             const std::vector<expression> &, std::uint32_t,
+                                                             std::vector<expression>, bool);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template std::vector<expression> add_cfunc_impl<mppp::real128>(llvm_state &, const std::string &,
+                                                               const std::vector<expression> &, std::uint32_t,
+                                                               std::vector<expression>, bool);
+
+#endif
+
+} // namespace detail
+
+std::vector<expression> add_cfunc_dbl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                      std::uint32_t batch_size, std::vector<expression> vars)
+{
+    return detail::add_cfunc_impl<double>(s, name, fn, batch_size, std::move(vars), true);
+}
+
+std::vector<expression> add_cfunc_ldbl(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                       std::uint32_t batch_size, std::vector<expression> vars)
+{
+    return detail::add_cfunc_impl<long double>(s, name, fn, batch_size, std::move(vars), true);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<expression> add_cfunc_f128(llvm_state &s, const std::string &name, const std::vector<expression> &fn,
+                                       std::uint32_t batch_size, std::vector<expression> vars)
+{
+    return detail::add_cfunc_impl<mppp::real128>(s, name, fn, batch_size, std::move(vars), true);
+}
+
+#endif
+
+std::vector<expression> add_cfunc_grad_dbl(llvm_state &s, const std::string &name, const expression &ex,
+                                           std::uint32_t batch_size, std::vector<expression> vars)
+{
+    return detail::add_cfunc_grad_impl<double>(s, name, ex, batch_size, std::move(vars));
+}
+
+std::vector<expression> add_cfunc_grad_ldbl(llvm_state &s, const std::string &name, const expression &ex,
+                                            std::uint32_t batch_size, std::vector<expression> vars)
+{
+    return detail::add_cfunc_grad_impl<long double>(s, name, ex, batch_size, std::move(vars));
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+std::vector<expression> add_cfunc_grad_f128(llvm_state &s, const std::string &name, const expression &ex,
+                                            std::uint32_t batch_size, std::vector<expression> vars)
+{
+    return detail::add_cfunc_grad_impl<mppp::real128>(s, name, ex, batch_size, std::move(vars));
+}
+
+#endif
+
+namespace detail
+{
+
+template <typename T>
+void cfunc_impl<T>::finalise_ctor_impl(std::vector<expression> fn, std::vector<expression> vars,
+                                       std::uint32_t batch_size, bool gradient)
+{
+    if (gradient && fn.size() != 1u) {
+        throw std::invalid_argument("The computation of the gradient in a compiled function requires a single "
+                                    "expression, but {} expressions were provided instead"_format(fn.size()));
+    }
+
+    if (batch_size == 0u) {
+        batch_size = recommended_simd_size<T>();
+    }
+
+    // Compute the number of runtime parameters.
+    std::uint32_t n_pars = 0;
+    for (const auto &ex : fn) {
+        n_pars = std::max(n_pars, get_param_size(ex));
+    }
+
+    // Add the batch-mode function and, if needed,
+    // the scalar function for the remainder points.
+    auto add_f = [&](const std::string &name, std::uint32_t bs, std::vector<expression> v) {
+        return gradient ? add_cfunc_grad<T>(m_llvm, name, fn[0], bs, std::move(v))
+                        : add_cfunc<T>(m_llvm, name, fn, bs, std::move(v));
+    };
+
+    m_vars = add_f("cfunc", batch_size, std::move(vars));
+    if (batch_size > 1u) {
+        add_f("cfunc_scalar", 1, m_vars);
+    }
+
+    m_llvm.compile();
+
+    m_f_batch = reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("cfunc"));
+    m_f_scalar = batch_size > 1u ? reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("cfunc_scalar")) : m_f_batch;
+
+    m_n_out = gradient ? 1u + m_vars.size() + n_pars : fn.size();
+    m_fn = std::move(fn);
+    m_batch_size = batch_size;
+    m_n_pars = n_pars;
+    m_gradient = gradient;
+}
+
+template <typename T>
+cfunc_impl<T>::cfunc_impl(const cfunc_impl &other)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_llvm(other.m_llvm), m_fn(other.m_fn), m_vars(other.m_vars), m_batch_size(other.m_batch_size),
+      m_n_pars(other.m_n_pars), m_n_out(other.m_n_out), m_gradient(other.m_gradient)
+{
+    m_f_batch = reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("cfunc"));
+    m_f_scalar = m_batch_size > 1u ? reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("cfunc_scalar")) : m_f_batch;
+}
+
+template <typename T>
+cfunc_impl<T>::cfunc_impl(cfunc_impl &&) noexcept = default;
+
+template <typename T>
+cfunc_impl<T> &cfunc_impl<T>::operator=(const cfunc_impl &other)
+{
+    if (this != &other) {
+        *this = cfunc_impl(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+cfunc_impl<T> &cfunc_impl<T>::operator=(cfunc_impl &&) noexcept = default;
+
+template <typename T>
+cfunc_impl<T>::~cfunc_impl() = default;
+
+template <typename T>
+const llvm_state &cfunc_impl<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+const std::vector<expression> &cfunc_impl<T>::get_fn() const
+{
+    return m_fn;
+}
+
+template <typename T>
+const std::vector<expression> &cfunc_impl<T>::get_vars() const
+{
+    return m_vars;
+}
+
+template <typename T>
+std::uint32_t cfunc_impl<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+template <typename T>
+std::uint32_t cfunc_impl<T>::get_n_pars() const
+{
+    return m_n_pars;
+}
+
+template <typename T>
+std::size_t cfunc_impl<T>::get_n_out() const
+{
+    return m_n_out;
+}
+
+template <typename T>
+bool cfunc_impl<T>::get_gradient() const
+{
+    return m_gradient;
+}
+
+// Evaluate the compiled function on n_points points. in and out are arrays
+// in row-major order with shapes (n_vars, n_points) and (n_out, n_points) respectively.
+// pars is the array of runtime parameters, shared by all points. The batches of points
+// are distributed among n_threads threads (a value of zero means to use all the
+// hardware threads available on the machine).
+template <typename T>
+void cfunc_impl<T>::operator()(T *out, const T *in, std::size_t n_points, const T *pars, unsigned n_threads) const
+{
+    if (n_points == 0u) {
+        return;
+    }
+
+    if (out == nullptr) {
+        throw std::invalid_argument("A null output array was passed to a compiled function");
+    }
+
+    if (in == nullptr && !m_vars.empty()) {
+        throw std::invalid_argument("A null input array was passed to a compiled function");
+    }
+
+    if (pars == nullptr && m_n_pars > 0u) {
+        throw std::invalid_argument("A null array of parameters was passed to a compiled function "
+                                    "which requires {} parameter(s)"_format(m_n_pars));
+    }
+
+    // LCOV_EXCL_START
+    if (n_points > std::numeric_limits<std::uint64_t>::max()) {
+        throw std::overflow_error("Overflow detected in the computation of the stride of a compiled function");
+    }
+    // LCOV_EXCL_STOP
+
+    const auto stride = static_cast<std::uint64_t>(n_points);
+    const auto n_batches = n_points / m_batch_size;
+
+    // Process the full batches.
+    parallel_for(n_batches, n_threads, [&](std::size_t b, std::size_t e, unsigned) {
+        for (auto i = b; i < e; ++i) {
+            const auto offset = i * m_batch_size;
+
+            m_f_batch(out + offset, cfunc_offset_ptr(in, offset), pars, stride);
+        }
+    });
+
+    // Process the remaining points one by one.
+    for (auto offset = n_batches * m_batch_size; offset < n_points; ++offset) {
+        m_f_scalar(out + offset, cfunc_offset_ptr(in, offset), pars, stride);
+    }
+}
+
+template <typename T>
+std::vector<T> cfunc_impl<T>::operator()(const std::vector<T> &in, std::size_t n_points, const std::vector<T> &pars,
+                                         unsigned n_threads) const
+{
+    // LCOV_EXCL_START
+    if (!m_vars.empty() && n_points > std::numeric_limits<std::size_t>::max() / m_vars.size()) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the input "
+                                  "array of a compiled function");
+    }
+
+    if (n_points > std::numeric_limits<std::size_t>::max() / m_n_out) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the output "
+                                  "array of a compiled function");
+    }
+    // LCOV_EXCL_STOP
+
+    if (in.size() != m_vars.size() * n_points) {
+        throw std::invalid_argument("The size of the input array of a compiled function ({}) is inconsistent with "
+                                    "the number of input variables ({}) and the number of points ({})"_format(
+                                        in.size(), m_vars.size(), n_points));
+    }
+
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("The compiled function requires {} parameter(s), but only {} "
+                                    "parameter value(s) were passed"_format(m_n_pars, pars.size()));
+    }
+
+    std::vector<T> out;
+    out.resize(m_n_out * n_points);
+
+    (*this)(out.data(), in.empty() ? nullptr : in.data(), n_points, pars.empty() ? nullptr : pars.data(),
+            n_threads);
+
+    return out;
+}
+
+// Explicit instantiation of the compiled function class.
+template class cfunc_impl<double>;
+template class cfunc_impl<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class cfunc_impl<mppp::real128>;
+
+#endif
+
+} // namespace detail
+
+} // namespace heyoka
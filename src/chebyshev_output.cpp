@@ -0,0 +1,541 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <ios>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/chebyshev_output.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The header of the Chebyshev output files.
+struct cheb_header {
+    char magic[8];
+    std::uint32_t version;
+    // Marker to detect a mismatched byte order.
+    std::uint32_t endian_tag;
+    // Floating-point format of the data.
+    std::uint32_t fp_tag;
+    std::uint32_t fp_size;
+    std::uint32_t dim;
+    std::uint32_t degree;
+    std::uint64_t n_segs;
+};
+
+constexpr char cheb_magic[8] = {'h', 'e', 'y', 'o', 'k', 'a', 'c', 'b'};
+constexpr std::uint32_t cheb_version = 1;
+constexpr std::uint32_t cheb_endian_tag = 0x01020304;
+
+template <typename T>
+constexpr std::uint32_t cheb_fp_tag()
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return 0;
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return 1;
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return 2;
+#endif
+    } else {
+        static_assert(always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Size of the coefficients of a segment.
+std::size_t cheb_seg_size(std::uint32_t dim, std::uint32_t degree)
+{
+    // LCOV_EXCL_START
+    if (degree == std::numeric_limits<std::uint32_t>::max()
+        || dim > std::numeric_limits<std::size_t>::max() / (degree + 1u)) {
+        throw std::overflow_error("Overflow detected in the computation of the size of a Chebyshev segment");
+    }
+    // LCOV_EXCL_STOP
+
+    return static_cast<std::size_t>(dim) * (degree + 1u);
+}
+
+// Evaluate via the Clenshaw recurrence the Chebyshev expansions with coefficients c
+// (stored with shape (degree + 1, dim)) at the coordinate x in [-1, 1], writing the result into out.
+// tmp must have a size of at least dim, and it must not overlap with out.
+// NOTE: the recurrence is run on the state vector as a whole, so that
+// the inner loops operate on contiguous data.
+template <typename T>
+void cheb_clenshaw(T *out, const T *c, std::uint32_t dim, std::uint32_t degree, const T &x, T *tmp)
+{
+    // NOTE: out and tmp hold b_{k+1} and b_{k+2}, respectively.
+    std::fill(out, out + dim, T(0));
+    std::fill(tmp, tmp + dim, T(0));
+
+    const auto x2 = 2 * x;
+
+    for (auto j = degree; j > 0u; --j) {
+        const auto *cj = c + static_cast<std::size_t>(j) * dim;
+
+        for (std::uint32_t i = 0; i < dim; ++i) {
+            const auto b = x2 * out[i] - tmp[i] + cj[i];
+            tmp[i] = out[i];
+            out[i] = b;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < dim; ++i) {
+        out[i] = x * out[i] - tmp[i] + c[i];
+    }
+}
+
+// Compute via the discrete cosine transform the coefficients c of the Chebyshev expansions
+// interpolating the samples at the Chebyshev nodes (both stored with shape (degree + 1, dim)).
+template <typename T>
+void cheb_dct(T *c, const T *samples, std::uint32_t dim, std::uint32_t degree, const T &pi)
+{
+    using std::cos;
+
+    const auto n_nodes = degree + 1u;
+
+    for (std::uint32_t j = 0; j < n_nodes; ++j) {
+        auto *cj = c + static_cast<std::size_t>(j) * dim;
+        std::fill(cj, cj + dim, T(0));
+
+        for (std::uint32_t k = 0; k < n_nodes; ++k) {
+            const auto w = cos(pi * j * (k + T(1) / 2) / n_nodes);
+            const auto *sk = samples + static_cast<std::size_t>(k) * dim;
+
+            for (std::uint32_t i = 0; i < dim; ++i) {
+                cj[i] += w * sk[i];
+            }
+        }
+
+        const auto fac = (j == 0u) ? T(1) / n_nodes : T(2) / n_nodes;
+        for (std::uint32_t i = 0; i < dim; ++i) {
+            cj[i] *= fac;
+        }
+    }
+}
+
+// Compute the coefficients d of the derivatives of the Chebyshev expansions with coefficients c.
+// NOTE: the coefficient of degree 'degree' of d is zero.
+template <typename T>
+void cheb_deriv(T *d, const T *c, std::uint32_t dim, std::uint32_t degree)
+{
+    auto row = [dim](auto *ptr, std::uint32_t j) { return ptr + static_cast<std::size_t>(j) * dim; };
+
+    std::fill(row(d, degree), row(d, degree) + dim, T(0));
+
+    for (auto j = degree; j > 0u; --j) {
+        for (std::uint32_t i = 0; i < dim; ++i) {
+            row(d, j - 1u)[i] = ((j + 1u <= degree) ? row(d, j + 1u)[i] : T(0)) + 2 * j * row(c, j)[i];
+        }
+    }
+
+    for (std::uint32_t i = 0; i < dim; ++i) {
+        d[i] /= 2;
+    }
+}
+
+// Fit the Chebyshev expansions of the given degree to the trajectory of co over [a, b],
+// writing the coefficients into c. The return value is true if the approximation error
+// does not exceed the tolerance. samples and buf must have the same size as c, tmp
+// must have a size of at least dim.
+template <typename T>
+bool cheb_fit_segment(T *c, continuous_output<T> &co, const T &a, const T &b, const T &tol, std::uint32_t degree,
+                      std::vector<T> &samples, std::vector<T> &buf, std::vector<T> &tmp)
+{
+    using std::abs;
+    using std::atan;
+    using std::cos;
+    using std::isfinite;
+
+    const auto dim = co.get_dim();
+    const auto n_nodes = degree + 1u;
+    const auto pi = 4 * atan(T(1));
+
+    const auto mid = (a + b) / 2;
+    const auto half = (b - a) / 2;
+
+    // The mapping from the time coordinate to [-1, 1],
+    // as computed in the evaluation of the expansions.
+    auto to_x = [&a, &b](const T &t) { return (2 * t - (a + b)) / (b - a); };
+
+    // Sample the trajectory at the Chebyshev nodes.
+    T scale(1);
+    for (std::uint32_t k = 0; k < n_nodes; ++k) {
+        const auto &st = co(mid + half * cos(pi * (k + T(1) / 2) / n_nodes));
+
+        for (std::uint32_t i = 0; i < dim; ++i) {
+            if (!isfinite(st[i])) {
+                throw std::invalid_argument(
+                    "Cannot construct a Chebyshev output from a continuous output with a non-finite state");
+            }
+
+            scale = std::max(scale, abs(st[i]));
+        }
+
+        std::copy(st.begin(), st.end(), samples.begin() + static_cast<std::size_t>(k) * dim);
+    }
+
+    cheb_dct(c, samples.data(), dim, degree, pi);
+
+    // NOTE: because of the rounding in the computation of the sampling times, the samples
+    // are not located exactly at the Chebyshev nodes. For short segments and large times, the resulting
+    // error can exceed by far the tolerance. Thus, correct the samples to first order via
+    // the derivatives of the expansions, and compute again the coefficients.
+    cheb_deriv(buf.data(), c, dim, degree);
+    for (std::uint32_t k = 0; k < n_nodes; ++k) {
+        const auto x = cos(pi * (k + T(1) / 2) / n_nodes);
+        const auto dx = x - to_x(mid + half * x);
+
+        cheb_clenshaw(tmp.data() + dim, buf.data(), dim, degree, x, tmp.data());
+
+        auto *sk = samples.data() + static_cast<std::size_t>(k) * dim;
+        for (std::uint32_t i = 0; i < dim; ++i) {
+            sk[i] += tmp[dim + i] * dx;
+        }
+    }
+
+    cheb_dct(c, samples.data(), dim, degree, pi);
+
+    // Check the error at the endpoints and in between the nodes (i.e., at the
+    // extrema of the Chebyshev polynomial of degree n_nodes), where the interpolation
+    // error is largest.
+    for (std::uint32_t k = 0; k <= n_nodes; ++k) {
+        const auto t = (k == 0u) ? b : ((k == n_nodes) ? a : mid + half * cos(pi * k / n_nodes));
+
+        const auto &st = co(t);
+        cheb_clenshaw(buf.data(), c, dim, degree, to_x(t), tmp.data());
+
+        for (std::uint32_t i = 0; i < dim; ++i) {
+            if (!(abs(buf[i] - st[i]) <= tol * scale)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+chebyshev_output<T>::chebyshev_output() = default;
+
+template <typename T>
+void chebyshev_output<T>::finalise_ctor_impl(continuous_output<T> &co, T tol, std::uint32_t degree)
+{
+    using namespace fmt::literals;
+    using std::isfinite;
+
+    if (!isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance of a Chebyshev output must be finite and positive, but it is {} instead"_format(tol));
+    }
+
+    if (degree == 0u) {
+        throw std::invalid_argument("The degree of a Chebyshev output cannot be zero");
+    }
+
+    // NOTE: this throws if co is empty.
+    const auto [t0, t1] = co.get_bounds();
+    const auto lo = std::min(t0, t1), hi = std::max(t0, t1);
+
+    const auto dim = co.get_dim();
+    const auto seg_size = detail::cheb_seg_size(dim, degree);
+
+    // Buffers for the fit.
+    std::vector<T> samples(seg_size), buf(seg_size), tmp(2u * static_cast<std::size_t>(dim)), c(seg_size);
+
+    std::vector<T> seg_bounds{lo}, coeffs;
+
+    // Split adaptively the time range into segments: the length of the current segment
+    // is halved until the fit succeeds, and the next segment starts with twice the length
+    // of the current one.
+    auto a = lo, len = hi - lo;
+    while (a < hi) {
+        const auto b = (len >= hi - a) ? hi : a + len;
+
+        if (!(b > a)) {
+            throw std::invalid_argument(
+                "Unable to construct a Chebyshev output with degree {} at the tolerance {}: the length of the "
+                "segments is too small"_format(degree, tol));
+        }
+
+        if (detail::cheb_fit_segment(c.data(), co, a, b, tol, degree, samples, buf, tmp)) {
+            coeffs.insert(coeffs.end(), c.begin(), c.end());
+            seg_bounds.push_back(b);
+
+            len = (b - a) * 2;
+            a = b;
+        } else {
+            len = (b - a) / 2;
+        }
+    }
+
+    m_dim = dim;
+    m_degree = degree;
+    m_seg_bounds = std::move(seg_bounds);
+    m_coeffs = std::move(coeffs);
+    m_output.resize(boost::numeric_cast<decltype(m_output.size())>(m_dim));
+    m_tmp.resize(boost::numeric_cast<decltype(m_tmp.size())>(m_dim));
+}
+
+template <typename T>
+chebyshev_output<T>::chebyshev_output(const chebyshev_output &) = default;
+
+template <typename T>
+chebyshev_output<T>::chebyshev_output(chebyshev_output &&) noexcept = default;
+
+template <typename T>
+chebyshev_output<T> &chebyshev_output<T>::operator=(const chebyshev_output &) = default;
+
+template <typename T>
+chebyshev_output<T> &chebyshev_output<T>::operator=(chebyshev_output &&) noexcept = default;
+
+template <typename T>
+chebyshev_output<T>::~chebyshev_output() = default;
+
+template <typename T>
+std::uint32_t chebyshev_output<T>::get_dim() const
+{
+    return m_dim;
+}
+
+template <typename T>
+std::uint32_t chebyshev_output<T>::get_degree() const
+{
+    return m_degree;
+}
+
+template <typename T>
+std::size_t chebyshev_output<T>::get_n_segments() const
+{
+    return m_seg_bounds.empty() ? 0 : m_seg_bounds.size() - 1u;
+}
+
+template <typename T>
+std::pair<T, T> chebyshev_output<T>::get_bounds() const
+{
+    if (m_seg_bounds.empty()) {
+        throw std::invalid_argument("Cannot compute the time bounds of an empty Chebyshev output");
+    }
+
+    return {m_seg_bounds.front(), m_seg_bounds.back()};
+}
+
+// Locate the segment containing the time t.
+template <typename T>
+std::size_t chebyshev_output<T>::find_segment(const T &t) const
+{
+    assert(m_seg_bounds.size() >= 2u);
+
+    // NOTE: the search excludes the first and last boundaries,
+    // thus the times outside the bounds are mapped to the first/last segment.
+    const auto it = std::upper_bound(m_seg_bounds.begin() + 1, m_seg_bounds.end() - 1, t);
+
+    return static_cast<std::size_t>(it - (m_seg_bounds.begin() + 1));
+}
+
+template <typename T>
+void chebyshev_output<T>::eval_impl(T *out, const T &t, T *tmp) const
+{
+    using std::isfinite;
+
+    if (m_seg_bounds.empty()) {
+        throw std::invalid_argument("Cannot compute the state of the system from an empty Chebyshev output");
+    }
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("Cannot compute a Chebyshev output at a non-finite time");
+    }
+
+    const auto idx = find_segment(t);
+
+    const auto &a = m_seg_bounds[idx];
+    const auto &b = m_seg_bounds[idx + 1u];
+    const auto x = (2 * t - (a + b)) / (b - a);
+
+    detail::cheb_clenshaw(out, m_coeffs.data() + idx * detail::cheb_seg_size(m_dim, m_degree), m_dim, m_degree, x,
+                          tmp);
+}
+
+template <typename T>
+const std::vector<T> &chebyshev_output<T>::operator()(T t)
+{
+    eval_impl(m_output.data(), t, m_tmp.data());
+
+    return m_output;
+}
+
+template <typename T>
+std::vector<T> chebyshev_output<T>::eval_grid(const std::vector<T> &ts) const
+{
+    // LCOV_EXCL_START
+    if (m_dim != 0u && ts.size() > std::numeric_limits<decltype(ts.size())>::max() / m_dim) {
+        throw std::overflow_error("Overflow detected in the evaluation of a Chebyshev output over a grid");
+    }
+    // LCOV_EXCL_STOP
+
+    std::vector<T> retval(ts.size() * m_dim), tmp(m_dim);
+
+    for (decltype(ts.size()) i = 0; i < ts.size(); ++i) {
+        eval_impl(retval.data() + i * m_dim, ts[i], tmp.data());
+    }
+
+    return retval;
+}
+
+template <typename T>
+void chebyshev_output<T>::save(const std::string &path) const
+{
+    using namespace fmt::literals;
+
+    if (m_seg_bounds.empty()) {
+        throw std::invalid_argument("Cannot save an empty Chebyshev output");
+    }
+
+    // Setup the header.
+    detail::cheb_header h{};
+    std::copy(std::begin(detail::cheb_magic), std::end(detail::cheb_magic), h.magic);
+    h.version = detail::cheb_version;
+    h.endian_tag = detail::cheb_endian_tag;
+    h.fp_tag = detail::cheb_fp_tag<T>();
+    h.fp_size = static_cast<std::uint32_t>(sizeof(T));
+    h.dim = m_dim;
+    h.degree = m_degree;
+    h.n_segs = boost::numeric_cast<std::uint64_t>(get_n_segments());
+
+    std::ofstream ofs(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!ofs) {
+        throw std::invalid_argument("Unable to open the file '{}' for writing a Chebyshev output"_format(path));
+    }
+
+    ofs.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    ofs.write(reinterpret_cast<const char *>(m_seg_bounds.data()),
+              boost::numeric_cast<std::streamsize>(m_seg_bounds.size() * sizeof(T)));
+    ofs.write(reinterpret_cast<const char *>(m_coeffs.data()),
+              boost::numeric_cast<std::streamsize>(m_coeffs.size() * sizeof(T)));
+
+    ofs.close();
+
+    if (!ofs) {
+        throw std::invalid_argument("Error writing the Chebyshev output file '{}'"_format(path));
+    }
+}
+
+template <typename T>
+chebyshev_output<T> chebyshev_output<T>::load(const std::string &path)
+{
+    using namespace fmt::literals;
+    using std::isfinite;
+
+    std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+    if (!ifs) {
+        throw std::invalid_argument("Unable to open the Chebyshev output file '{}'"_format(path));
+    }
+
+    // Read and validate the header.
+    detail::cheb_header h{};
+    if (!ifs.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+        throw std::invalid_argument("The file '{}' is too small to be a Chebyshev output file"_format(path));
+    }
+
+    if (!std::equal(std::begin(detail::cheb_magic), std::end(detail::cheb_magic), h.magic)) {
+        throw std::invalid_argument("The file '{}' is not a Chebyshev output file"_format(path));
+    }
+    if (h.endian_tag != detail::cheb_endian_tag) {
+        throw std::invalid_argument(
+            "The Chebyshev output file '{}' was written on a machine with a different byte order"_format(path));
+    }
+    if (h.version != detail::cheb_version) {
+        throw std::invalid_argument(
+            "The Chebyshev output file '{}' has version {}, but only version {} is supported"_format(
+                path, h.version, detail::cheb_version));
+    }
+    if (h.fp_tag != detail::cheb_fp_tag<T>() || h.fp_size != sizeof(T)) {
+        throw std::invalid_argument("The Chebyshev output file '{}' contains data in a floating-point format "
+                                    "different from the requested one"_format(path));
+    }
+    if (h.dim == 0u || h.degree == 0u || h.n_segs == 0u
+        || h.n_segs >= std::numeric_limits<std::size_t>::max() / detail::cheb_seg_size(h.dim, h.degree)) {
+        throw std::invalid_argument("The Chebyshev output file '{}' has an invalid header"_format(path));
+    }
+
+    const auto n_segs = static_cast<std::size_t>(h.n_segs);
+
+    chebyshev_output retval;
+    retval.m_dim = h.dim;
+    retval.m_degree = h.degree;
+    retval.m_seg_bounds.resize(n_segs + 1u);
+    retval.m_coeffs.resize(n_segs * detail::cheb_seg_size(h.dim, h.degree));
+
+    if (!ifs.read(reinterpret_cast<char *>(retval.m_seg_bounds.data()),
+                  boost::numeric_cast<std::streamsize>(retval.m_seg_bounds.size() * sizeof(T)))
+        || !ifs.read(reinterpret_cast<char *>(retval.m_coeffs.data()),
+                     boost::numeric_cast<std::streamsize>(retval.m_coeffs.size() * sizeof(T)))) {
+        throw std::invalid_argument("The Chebyshev output file '{}' is truncated"_format(path));
+    }
+
+    // NOTE: the binary search in the evaluation requires
+    // finite boundaries in strictly ascending order.
+    if (!std::all_of(retval.m_seg_bounds.begin(), retval.m_seg_bounds.end(), [](const T &x) { return isfinite(x); })
+        || std::adjacent_find(retval.m_seg_bounds.begin(), retval.m_seg_bounds.end(), std::greater_equal<T>{})
+               != retval.m_seg_bounds.end()) {
+        throw std::invalid_argument("The Chebyshev output file '{}' contains invalid segment boundaries"_format(path));
+    }
+
+    retval.m_output.resize(boost::numeric_cast<decltype(retval.m_output.size())>(retval.m_dim));
+    retval.m_tmp.resize(boost::numeric_cast<decltype(retval.m_tmp.size())>(retval.m_dim));
+
+    return retval;
+}
+
+template class chebyshev_output<double>;
+template class chebyshev_output<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class chebyshev_output<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,283 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/collision.hpp>
+#include <heyoka/detail/event_detection.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+template <typename T>
+collision_detector<T>::collision_detector(std::vector<std::array<std::uint32_t, 3>> pos_idx, std::vector<T> radii)
+    : m_pos_idx(std::move(pos_idx)), m_radii(std::move(radii))
+{
+    using std::isfinite;
+
+    if (m_pos_idx.size() != m_radii.size()) {
+        throw std::invalid_argument("The number of bodies ({}) is inconsistent with the number of radii ({}) in the "
+                                    "construction of a collision detector"_format(m_pos_idx.size(), m_radii.size()));
+    }
+
+    // NOTE: make sure we can represent the body
+    // indices and the number of pairs in 32 bits.
+    if (m_pos_idx.size() > std::numeric_limits<std::uint16_t>::max()) {
+        throw std::invalid_argument(
+            "Too many bodies ({}) in the construction of a collision detector"_format(m_pos_idx.size()));
+    }
+
+    for (const auto &r : m_radii) {
+        if (!isfinite(r) || r < 0) {
+            throw std::invalid_argument(
+                "The radii of the bodies in a collision detector must be finite and non-negative, "
+                "but the value {} was provided instead"_format(r));
+        }
+    }
+
+    m_aabb.resize(m_pos_idx.size());
+    m_sorted.resize(m_pos_idx.size());
+    std::iota(m_sorted.begin(), m_sorted.end(), std::uint32_t(0));
+}
+
+template <typename T>
+collision_detector<T>::collision_detector(const collision_detector &) = default;
+
+template <typename T>
+collision_detector<T>::collision_detector(collision_detector &&) noexcept = default;
+
+template <typename T>
+collision_detector<T> &collision_detector<T>::operator=(const collision_detector &) = default;
+
+template <typename T>
+collision_detector<T> &collision_detector<T>::operator=(collision_detector &&) noexcept = default;
+
+template <typename T>
+collision_detector<T>::~collision_detector() = default;
+
+template <typename T>
+const std::vector<std::array<std::uint32_t, 3>> &collision_detector<T>::get_pos_idx() const
+{
+    return m_pos_idx;
+}
+
+template <typename T>
+const std::vector<T> &collision_detector<T>::get_radii() const
+{
+    return m_radii;
+}
+
+template <typename T>
+std::uint32_t collision_detector<T>::get_n_candidates() const
+{
+    return static_cast<std::uint32_t>(m_cand.size());
+}
+
+template <typename T>
+const std::vector<typename collision_detector<T>::collision_t> &
+collision_detector<T>::detect(const taylor_adaptive<T> &ta)
+{
+    using std::abs;
+    using std::isfinite;
+
+    const auto order = ta.get_order();
+    const auto op1 = order + 1u;
+    const auto dim = ta.get_dim();
+    const auto h = ta.get_last_h();
+    const auto &tc = ta.get_tc();
+
+    m_coll.clear();
+    m_cand.clear();
+
+    for (const auto &idx : m_pos_idx) {
+        for (auto i : idx) {
+            if (i >= dim) {
+                throw std::invalid_argument("Invalid index {} detected in a collision detector for an integrator "
+                                            "with {} state variables"_format(i, dim));
+            }
+        }
+    }
+
+    if (!isfinite(h) || h == 0) {
+        return m_coll;
+    }
+
+    const auto n_bodies = static_cast<std::uint32_t>(m_pos_idx.size());
+
+    // Compute the AABBs. Over the timestep, the value of the
+    // coordinate with coefficients c_0, c_1, ... is within
+    // c_0 +- sum_{o >= 1} |c_o| |h|**o.
+    // NOTE: the AABBs are enlarged by the radii of the bodies
+    // and by a small relative amount in order to account for
+    // the rounding errors. With non-finite values, the AABBs
+    // end up containing NaNs and the comparisons in the sweep below
+    // evaluate to false, that is, the body is never a candidate.
+    const auto abs_h = abs(h);
+    for (std::uint32_t b = 0; b < n_bodies; ++b) {
+        for (auto k = 0u; k < 3u; ++k) {
+            const auto ptr = tc.data() + static_cast<decltype(tc.size())>(m_pos_idx[b][k]) * op1;
+
+            T cur_f(1), rest(0);
+            for (std::uint32_t o = 1; o <= order; ++o) {
+                cur_f *= abs_h;
+                rest += abs(ptr[o]) * cur_f;
+            }
+
+            rest = rest * (1 + T(2) * T(op1) * std::numeric_limits<T>::epsilon()) + m_radii[b];
+
+            m_aabb[b][2u * k] = ptr[0] - rest;
+            m_aabb[b][2u * k + 1u] = ptr[0] + rest;
+        }
+    }
+
+    // Sort the bodies by the lower bound of the AABB along the x axis.
+    // NOTE: the ordering from the previous invocation is used as a starting
+    // point and refined via insertion sort, which is nearly linear if
+    // the ordering changes little from one timestep to the next.
+    for (std::uint32_t i = 1; i < n_bodies; ++i) {
+        const auto cur = m_sorted[i];
+        auto j = i;
+        for (; j > 0u && m_aabb[cur][0] < m_aabb[m_sorted[j - 1u]][0]; --j) {
+            m_sorted[j] = m_sorted[j - 1u];
+        }
+        m_sorted[j] = cur;
+    }
+
+    // The sweep.
+    m_active.clear();
+    for (const auto b : m_sorted) {
+        const auto &bb = m_aabb[b];
+
+        // Remove from the active list the bodies
+        // whose AABB ends before the beginning of bb.
+        m_active.erase(std::remove_if(m_active.begin(), m_active.end(),
+                                      [&bb, this](std::uint32_t a) { return !(m_aabb[a][1] >= bb[0]); }),
+                       m_active.end());
+
+        for (const auto a : m_active) {
+            const auto &ab = m_aabb[a];
+
+            if (ab[2] <= bb[3] && bb[2] <= ab[3] && ab[4] <= bb[5] && bb[4] <= ab[5]) {
+                m_cand.emplace_back(std::min(a, b), std::max(a, b));
+            }
+        }
+
+        m_active.push_back(b);
+    }
+
+    if (m_cand.empty()) {
+        return m_coll;
+    }
+
+    // Set up the dummy events for the narrow phase.
+    // NOTE: the expressions and the callbacks of
+    // the events are never used.
+    const auto n_cand = m_cand.size();
+    if (m_evs.size() > n_cand) {
+        m_evs.erase(m_evs.begin() + static_cast<decltype(m_evs.size())>(n_cand), m_evs.end());
+    }
+    while (m_evs.size() < n_cand) {
+        m_evs.emplace_back(
+            expression{number{0.}}, [](taylor_adaptive<T> &, T, int) {});
+    }
+
+    // Compute the Taylor polynomials of the squared distances.
+    // NOTE: the products of the polynomials are truncated at the order
+    // of the integrator, consistently with the computation of the
+    // Taylor coefficients of the event equations in the integrator.
+    m_ev_jet.resize(n_cand * op1);
+    for (decltype(m_cand.size()) c = 0; c < n_cand; ++c) {
+        const auto [a, b] = m_cand[c];
+        const auto out = m_ev_jet.data() + c * op1;
+
+        std::fill(out, out + op1, T(0));
+
+        for (auto k = 0u; k < 3u; ++k) {
+            const auto pa = tc.data() + static_cast<decltype(tc.size())>(m_pos_idx[a][k]) * op1;
+            const auto pb = tc.data() + static_cast<decltype(tc.size())>(m_pos_idx[b][k]) * op1;
+
+            for (std::uint32_t o = 0; o <= order; ++o) {
+                for (std::uint32_t m = 0; m <= o; ++m) {
+                    out[o] += (pa[m] - pb[m]) * (pa[o - m] - pb[o - m]);
+                }
+            }
+        }
+
+        const auto r_sum = m_radii[a] + m_radii[b];
+        out[0] -= r_sum * r_sum;
+    }
+
+    // Run the narrow phase.
+    static const std::vector<t_event<T>> no_tes;
+    static const std::vector<std::optional<std::pair<T, T>>> no_cooldowns;
+    detail::taylor_detect_events(m_d_tes, m_d_ntes, no_tes, m_evs, no_cooldowns, h, m_ev_jet, order, 0, m_ed);
+
+    // NOTE: a collision happens when the squared distance minus
+    // the squared sum of the radii crosses zero from above, that is,
+    // with a negative derivative in forward integration and
+    // a positive derivative in backward integration.
+    const auto coll_sgn = h > 0 ? -1 : 1;
+    for (const auto &ev : m_d_ntes) {
+        if (std::get<2>(ev) == coll_sgn) {
+            const auto &[a, b] = m_cand[std::get<0>(ev)];
+            m_coll.emplace_back(a, b, std::get<1>(ev));
+        }
+    }
+
+    // Sort the collisions by time.
+    std::sort(m_coll.begin(), m_coll.end(),
+              [](const auto &c1, const auto &c2) { return abs(std::get<2>(c1)) < abs(std::get<2>(c2)); });
+
+    return m_coll;
+}
+
+template class collision_detector<double>;
+template class collision_detector<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class collision_detector<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
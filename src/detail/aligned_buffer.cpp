@@ -0,0 +1,58 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <new>
+
+#if defined(__linux__)
+
+#include <sys/mman.h>
+
+#endif
+
+#include <heyoka/detail/aligned_buffer.hpp>
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// Buffers larger than this (in bytes) are aligned
+// to (and, where supported, backed by) huge pages.
+constexpr std::size_t huge_page_size = 2u * 1024u * 1024u;
+
+std::size_t aligned_buffer_alignment(std::size_t size)
+{
+    return size >= huge_page_size ? huge_page_size : buffer_alignment;
+}
+
+} // namespace
+
+void *aligned_buffer_alloc(std::size_t size)
+{
+    auto *ret = ::operator new(size, std::align_val_t{aligned_buffer_alignment(size)});
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+
+    if (size >= huge_page_size) {
+        // NOTE: this is only a hint, ignore failures.
+        ::madvise(ret, size, MADV_HUGEPAGE);
+    }
+
+#endif
+
+    return ret;
+}
+
+void aligned_buffer_free(void *ptr, std::size_t size) noexcept
+{
+    ::operator delete(ptr, std::align_val_t{aligned_buffer_alignment(size)});
+}
+
+} // namespace heyoka::detail
@@ -9,15 +9,21 @@
 #include <heyoka/config.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <exception>
 #include <initializer_list>
 #include <iterator>
 #include <limits>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
@@ -53,6 +59,8 @@
 #include <heyoka/detail/fwd_decl.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
 #include <heyoka/detail/logging_impl.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/detail/tracing.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
@@ -76,75 +84,6 @@ namespace heyoka::detail
 namespace
 {
 
-// The polynomial cache type.
-template <typename T>
-using poly_cache_t = std::vector<std::vector<std::vector<T>>>;
-
-// Helper to fetch the per-thread poly cache.
-template <typename T>
-poly_cache_t<T> &get_poly_cache()
-{
-    thread_local poly_cache_t<T> ret;
-
-    return ret;
-}
-
-// Extract a poly of order n from the cache (or create a new one).
-template <typename T>
-auto get_poly_from_cache(poly_cache_t<T> &cache, std::uint32_t n)
-{
-    // Look if we have inited the cache for order n.
-    if (n >= cache.size()) {
-        // The cache was never used for polynomials of order
-        // n, add the necessary entries.
-
-        // NOTE: no overflow check needed here, cause the order
-        // is always overflow checked in the integrator machinery.
-        cache.resize(boost::numeric_cast<decltype(cache.size())>(n + 1u));
-    }
-
-    auto &pcache = cache[n];
-
-    if (pcache.empty()) {
-        // No polynomials are available, create a new one.
-        return std::vector<T>(boost::numeric_cast<typename std::vector<T>::size_type>(n + 1u));
-    } else {
-        // Extract an existing polynomial from the cache.
-        auto retval = std::move(pcache.back());
-        pcache.pop_back();
-
-        return retval;
-    }
-}
-
-// Insert a poly into the cache.
-template <typename T>
-void put_poly_in_cache(poly_cache_t<T> &cache, std::vector<T> &&v)
-{
-    // Fetch the order of the polynomial.
-    // NOTE: the order is the size - 1.
-    assert(!v.empty());
-    const auto n = v.size() - 1u;
-
-    // Look if we have inited the cache for order n.
-    if (n >= cache.size()) {
-        // NOTE: this is currently never reached
-        // because we always look in the cache
-        // before the first invocation of this function.
-        // LCOV_EXCL_START
-        // The cache was never used for polynomials of order
-        // n, add the necessary entries.
-        if (n == std::numeric_limits<decltype(cache.size())>::max()) {
-            throw std::overflow_error("An overflow was detected in the polynomial cache");
-        }
-        cache.resize(n + 1u);
-        // LCOV_EXCL_STOP
-    }
-
-    // Move v in.
-    cache[n].push_back(std::move(v));
-}
-
 // Given an input polynomial a(x), substitute
 // x with x_1 * h and write to ret the resulting
 // polynomial in the new variable x_1. Requires
@@ -215,44 +154,127 @@ auto poly_eval(InputIt a, T x, std::uint32_t n)
     return ret;
 }
 
-// A RAII helper to extract polys from the cache and
-// return them to the cache upon destruction.
+// Evaluate a polynomial and its first derivative.
+// Requires random-access iterator.
+template <typename InputIt, typename T>
+auto poly_eval_01(InputIt a, T x, std::uint32_t n)
+{
+    auto ret = a[n];
+    auto ret1 = decltype(ret)(0);
+
+    for (std::uint32_t i = 1; i <= n; ++i) {
+        ret1 = ret + ret1 * x;
+        ret = a[n - i] + ret * x;
+    }
+
+    return std::pair{ret, ret1};
+}
+
+// Maximum size of the working list in the root isolation
+// algorithm. If the working list grows larger, the algorithm
+// is considered to have failed.
+// NOTE: this is based on heuristic observation of the algorithm's
+// behaviour in pathological cases.
+constexpr std::uint32_t ed_max_wlist_size = 250;
+
+// Initial number of polynomials in the arena.
+constexpr std::uint32_t ed_arena_init_size = 32;
+
+// Fetch a polynomial from the arena of ed, doubling
+// the size of the arena if no polynomial is available.
+template <typename T>
+std::uint32_t ed_get_poly(ed_data<T> &ed)
+{
+    assert(ed.order > 0u);
+
+    if (ed.free_polys.empty()) {
+        ++ed.n_misses;
+
+        const auto op1 = static_cast<decltype(ed.polys.size())>(ed.order) + 1u;
+        const auto n_polys = ed.polys.size() / op1;
+
+        // LCOV_EXCL_START
+        if (n_polys > std::numeric_limits<std::uint32_t>::max() / 2u) {
+            throw std::overflow_error("An overflow was detected in the polynomial arena");
+        }
+        // LCOV_EXCL_STOP
+
+        ed.polys.resize(n_polys * 2u * op1);
+
+        // NOTE: reserve enough space for all the polynomials,
+        // so that returning a polynomial to the arena never allocates.
+        ed.free_polys.reserve(n_polys * 2u);
+        for (auto i = n_polys * 2u; i > n_polys; --i) {
+            ed.free_polys.push_back(static_cast<std::uint32_t>(i - 1u));
+        }
+    } else {
+        ++ed.n_hits;
+    }
+
+    const auto retval = ed.free_polys.back();
+    ed.free_polys.pop_back();
+
+    return retval;
+}
+
+// Clear the working list of ed, returning
+// its polynomials to the arena.
+template <typename T>
+void ed_clear_wlist(ed_data<T> &ed)
+{
+    for (const auto &t : ed.wlist) {
+        ed.free_polys.push_back(std::get<2>(t));
+    }
+
+    ed.wlist.clear();
+}
+
+// A RAII helper to fetch polys from the arena and
+// return them to the arena upon destruction.
 template <typename T>
 class pwrap
 {
-    void back_to_cache()
+    static constexpr auto invalid_idx = std::numeric_limits<std::uint32_t>::max();
+
+    void back_to_arena() noexcept
     {
-        // NOTE: the cache does not allow empty vectors.
-        if (!v.empty()) {
-            put_poly_in_cache(pc, std::move(v));
+        if (idx != invalid_idx) {
+            ed->free_polys.push_back(idx);
         }
     }
 
 public:
-    explicit pwrap(poly_cache_t<T> &cache, std::uint32_t n) : pc(cache), v(get_poly_from_cache<T>(pc, n)) {}
+    // Fetch a new polynomial from the arena.
+    explicit pwrap(ed_data<T> &e) : ed(&e), idx(ed_get_poly(e)) {}
+    // Take ownership of the polynomial with index i
+    // (e.g., a polynomial extracted from the working list).
+    explicit pwrap(ed_data<T> &e, std::uint32_t i) : ed(&e), idx(i) {}
 
-    pwrap(pwrap &&other) noexcept : pc(other.pc), v(std::move(other.v))
+    pwrap(pwrap &&other) noexcept : ed(other.ed), idx(other.idx)
     {
         // Make sure we moved from a valid pwrap.
-        assert(!v.empty());
+        assert(idx != invalid_idx);
+
+        other.idx = invalid_idx;
     }
     pwrap &operator=(pwrap &&other) noexcept
     {
         // Disallow self move.
         assert(this != &other);
 
-        // Make sure the polyomial caches match.
-        assert(&pc == &other.pc);
+        // Make sure the arenas match.
+        assert(ed == other.ed);
 
         // Make sure we are not moving from an
         // invalid pwrap.
-        assert(!other.v.empty());
+        assert(other.idx != invalid_idx);
 
-        // Put the current v in the cache.
-        back_to_cache();
+        // Put the current polynomial back in the arena.
+        back_to_arena();
 
         // Do the move-assignment.
-        v = std::move(other.v);
+        idx = other.idx;
+        other.idx = invalid_idx;
 
         return *this;
     }
@@ -263,12 +285,40 @@ public:
 
     ~pwrap()
     {
-        // Put the current v in the cache.
-        back_to_cache();
+        // Put the current polynomial back in the arena.
+        back_to_arena();
     }
 
-    poly_cache_t<T> &pc;
-    std::vector<T> v;
+    bool valid() const
+    {
+        return idx != invalid_idx;
+    }
+
+    // Release the ownership of the polynomial,
+    // returning its index.
+    std::uint32_t release()
+    {
+        assert(valid());
+
+        const auto retval = idx;
+        idx = invalid_idx;
+
+        return retval;
+    }
+
+    // Pointer to the coefficients of the polynomial.
+    // NOTE: the pointer is invalidated if the arena grows,
+    // thus it must not be stored across fetches from the arena.
+    T *data() const
+    {
+        assert(valid());
+
+        return ed->polys.data() + static_cast<decltype(ed->polys.size())>(idx) * (ed->order + 1u);
+    }
+
+private:
+    ed_data<T> *ed;
+    std::uint32_t idx;
 };
 
 // Find the only existing root for the polynomial poly of the given order
@@ -276,6 +326,56 @@ public:
 template <typename T>
 std::tuple<T, int> bracketed_root_find(const pwrap<T> &poly, std::uint32_t order, T lb, T ub)
 {
+    using std::abs;
+    using std::isfinite;
+
+    const auto d = poly.data();
+
+    // Try first a safeguarded Newton iteration: the bracket [lb, ub]
+    // is shrunk at each iteration, and the Newton steps landing
+    // outside the bracket are replaced by bisection steps.
+    // NOTE: in the typical case the root is simple and
+    // the iteration converges in a handful of steps.
+    constexpr std::uint32_t newton_iter_limit = 12;
+
+    const auto f_lb = poly_eval(d, lb, order);
+    if (f_lb == 0) {
+        return std::tuple{lb, 0};
+    }
+    const auto s_lb = sgn(f_lb);
+
+    auto x = (lb + ub) / 2;
+    for (std::uint32_t i = 0; i < newton_iter_limit; ++i) {
+        const auto [f, df] = poly_eval_01(d, x, order);
+
+        if (f == 0) {
+            return std::tuple{x, 0};
+        }
+
+        // Update the bracket.
+        if (sgn(f) == s_lb) {
+            lb = x;
+        } else {
+            ub = x;
+        }
+
+        auto x_new = x - f / df;
+        if (!isfinite(x_new) || !(x_new > lb && x_new < ub)) {
+            x_new = (lb + ub) / 2;
+        }
+
+        if (abs(x_new - x) <= 2 * std::numeric_limits<T>::epsilon() * abs(x_new)) {
+            SPDLOG_LOGGER_DEBUG(get_logger(), "Newton root finding iterations: {}", i + 1u);
+
+            return std::tuple{x_new, 0};
+        }
+
+        x = x_new;
+    }
+
+    // The Newton iteration did not converge, fall back
+    // to TOMS748 on the shrunk bracket.
+
     // NOTE: perhaps this should depend on T?
     constexpr boost::uintmax_t iter_limit = 100;
     boost::uintmax_t max_iter = iter_limit;
@@ -297,8 +397,8 @@ std::tuple<T, int> bracketed_root_find(const pwrap<T> &poly, std::uint32_t order
     errno = 0;
 
     // Run the root finder.
-    const auto p = boost::math::tools::toms748_solve([d = poly.v.data(), order](T x) { return poly_eval(d, x, order); },
-                                                     lb, ub, boost::math::tools::eps_tolerance<T>(), max_iter, pol{});
+    const auto p = boost::math::tools::toms748_solve([d, order](T x) { return poly_eval(d, x, order); }, lb, ub,
+                                                     boost::math::tools::eps_tolerance<T>(), max_iter, pol{});
     const auto ret = (p.first + p.second) / 2;
 
     SPDLOG_LOGGER_DEBUG(get_logger(), "root finding iterations: {}", max_iter);
@@ -323,39 +423,31 @@ std::tuple<T, int> bracketed_root_find(const pwrap<T> &poly, std::uint32_t order
     }
 }
 
-// Helper to fetch the per-thread working list used in
-// poly root finding.
-template <typename T>
-auto &get_wlist()
-{
-    thread_local std::vector<std::tuple<T, T, pwrap<T>>> w_list;
-
-    return w_list;
-}
-
-// Helper to fetch the per-thread list of isolating intervals.
-template <typename T>
-auto &get_isol()
-{
-    thread_local std::vector<std::tuple<T, T>> isol;
-
-    return isol;
-}
-
 // Helper to detect events of terminal type.
 template <typename>
 struct is_terminal_event : std::false_type {
 };
 
-template <typename T>
-struct is_terminal_event<t_event<T>> : std::true_type {
+template <typename T, bool B>
+struct is_terminal_event<t_event_impl<T, B>> : std::true_type {
 };
 
 template <typename T>
 constexpr bool is_terminal_event_v = is_terminal_event<T>::value;
 
+// Minimum polynomial order for which the translation
+// is performed via the Horner-like Taylor shift algorithm
+// (see add_poly_translator_1()).
+constexpr std::uint32_t pt_shift_min_order = 20;
+
 // Helper to add a polynomial translation function
 // to the state 's'.
+// NOTE: for low orders, the translated coefficients are computed
+// via the binomial formula, using the precomputed binomial coefficients.
+// For high orders, the Taylor shift algorithm is used instead: the translation
+// is performed in place via repeated synthetic division, which requires
+// order * (order + 1) / 2 additions and neither multiplications nor
+// loads from the binomial coefficients array.
 template <typename T>
 llvm::Function *add_poly_translator_1(llvm_state &s, std::uint32_t order, std::uint32_t batch_size)
 {
@@ -376,7 +468,9 @@ llvm::Function *add_poly_translator_1(llvm_state &s, std::uint32_t order, std::u
     // Helper to fetch the (i, j) binomial coefficient from
     // a precomputed global array. The returned value is already
     // splatted.
-    auto get_bc = [&, bc_ptr = llvm_add_bc_array<T>(s, order)](llvm::Value *i, llvm::Value *j) {
+    // NOTE: the array is not needed by the Taylor shift algorithm.
+    auto get_bc = [&, bc_ptr = order >= pt_shift_min_order ? nullptr : llvm_add_bc_array<T>(s, order)](
+                      llvm::Value *i, llvm::Value *j) {
         auto idx = builder.CreateMul(i, builder.getInt32(order + 1u));
         idx = builder.CreateAdd(idx, j);
 
@@ -421,26 +515,55 @@ llvm::Function *add_poly_translator_1(llvm_state &s, std::uint32_t order, std::u
     assert(bb != nullptr);
     builder.SetInsertPoint(bb);
 
-    // Init the return values as zeroes.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order + 1u), [&](llvm::Value *i) {
-        auto ptr = builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(i, builder.getInt32(batch_size))});
-        store_vector_to_memory(builder, ptr, vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
-    });
+    if (order >= pt_shift_min_order) {
+        // Copy the coefficients into the return values.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order + 1u), [&](llvm::Value *i) {
+            auto idx = builder.CreateMul(i, builder.getInt32(batch_size));
+            auto ai = load_vector_from_memory(builder, builder.CreateInBoundsGEP(cf_ptr, {idx}), batch_size);
+            store_vector_to_memory(builder, builder.CreateInBoundsGEP(out_ptr, {idx}), ai);
+        });
 
-    // Do the translation.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order + 1u), [&](llvm::Value *i) {
-        auto ai = load_vector_from_memory(
-            builder, builder.CreateInBoundsGEP(cf_ptr, {builder.CreateMul(i, builder.getInt32(batch_size))}),
-            batch_size);
+        // Do the translation. The algorithm is:
+        // for i in [0, order):
+        //     for j in [order - 1, i]:
+        //         a[j] += a[j + 1]
+        // NOTE: the inner loop is run forward over the
+        // index k = order - 1 - j, in the range [0, order - i).
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order), [&](llvm::Value *i) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.CreateSub(builder.getInt32(order), i), [&](llvm::Value *k) {
+                auto *j = builder.CreateSub(builder.getInt32(order - 1u), k);
+
+                auto *idx = builder.CreateMul(j, builder.getInt32(batch_size));
+                auto *ptr = builder.CreateInBoundsGEP(out_ptr, {idx});
+                auto *ptr1 = builder.CreateInBoundsGEP(out_ptr, {builder.CreateAdd(idx, builder.getInt32(batch_size))});
+
+                auto *new_val = builder.CreateFAdd(load_vector_from_memory(builder, ptr, batch_size),
+                                                   load_vector_from_memory(builder, ptr1, batch_size));
+                store_vector_to_memory(builder, ptr, new_val);
+            });
+        });
+    } else {
+        // Init the return values as zeroes.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order + 1u), [&](llvm::Value *i) {
+            auto ptr = builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(i, builder.getInt32(batch_size))});
+            store_vector_to_memory(builder, ptr, vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+        });
 
-        llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(i, builder.getInt32(1)), [&](llvm::Value *k) {
-            auto tmp = builder.CreateFMul(ai, get_bc(i, k));
+        // Do the translation.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order + 1u), [&](llvm::Value *i) {
+            auto ai = load_vector_from_memory(
+                builder, builder.CreateInBoundsGEP(cf_ptr, {builder.CreateMul(i, builder.getInt32(batch_size))}),
+                batch_size);
 
-            auto ptr = builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(k, builder.getInt32(batch_size))});
-            auto new_val = builder.CreateFAdd(load_vector_from_memory(builder, ptr, batch_size), tmp);
-            store_vector_to_memory(builder, ptr, new_val);
+            llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(i, builder.getInt32(1)), [&](llvm::Value *k) {
+                auto tmp = builder.CreateFMul(ai, get_bc(i, k));
+
+                auto ptr = builder.CreateInBoundsGEP(out_ptr, {builder.CreateMul(k, builder.getInt32(batch_size))});
+                auto new_val = builder.CreateFAdd(load_vector_from_memory(builder, ptr, batch_size), tmp);
+                store_vector_to_memory(builder, ptr, new_val);
+            });
         });
-    });
+    }
 
     // Create the return value.
     builder.CreateRetVoid();
@@ -567,56 +690,190 @@ llvm::Function *add_poly_rtscc(llvm_state &s, std::uint32_t n, std::uint32_t bat
     return f;
 }
 
+// Polynomial translation function type.
+template <typename T>
+using ed_pt_t = void (*)(T *, const T *);
+
+// rtscc function type.
+template <typename T>
+using ed_rtscc_t = void (*)(T *, T *, std::uint32_t *, const T *);
+
+// The process-wide cache of the JITted functions used
+// in the event detection implementation.
+// NOTE: the key is built from the order (in the high bits)
+// and the batch size (in the low bits). The LLVM states
+// are kept alive for the lifetime of the program, so that
+// the function pointers remain valid.
+template <typename T>
+struct ed_jit_cache {
+    std::shared_mutex mutex;
+    std::unordered_map<std::uint64_t, std::pair<llvm_state, std::pair<ed_pt_t<T>, ed_rtscc_t<T>>>> map;
+};
+
+template <typename T>
+ed_jit_cache<T> &get_ed_jit_cache()
+{
+    static ed_jit_cache<T> ret;
+
+    return ret;
+}
+
 // Fetch the JITted functions used in the event detection implementation.
+// NOTE: the batch size is 1 in the root isolation algorithm. In the pre-screening
+// phase, it is ed_simd_size in the scalar implementation and the batch size
+// of the integrator in the batch implementation.
+// NOTE: the functions are compiled once per process and shared
+// among all threads. The integrators fetch them once and store
+// them in their event detection data (see ed_data_setup()).
 template <typename T>
-auto get_ed_jit_functions(std::uint32_t order)
+std::pair<ed_pt_t<T>, ed_rtscc_t<T>> get_ed_jit_functions(std::uint32_t order, std::uint32_t batch_size = 1)
 {
-    // Polynomial translation function type.
-    using pt_t = void (*)(T *, const T *);
-    // rtscc function type.
-    using rtscc_t = void (*)(T *, T *, std::uint32_t *, const T *);
+    const auto key = (static_cast<std::uint64_t>(order) << 32) + batch_size;
 
-    thread_local std::unordered_map<std::uint32_t, std::pair<llvm_state, std::pair<pt_t, rtscc_t>>> tf_map;
+    auto &cache = get_ed_jit_cache<T>();
 
-    auto it = tf_map.find(order);
+    // Look into the process-wide cache.
+    {
+        std::shared_lock lock(cache.mutex);
 
-    if (it == tf_map.end()) {
-        // Cache miss, we need to create
-        // a new LLVM state and functions.
-        llvm_state s;
+        if (const auto it = cache.map.find(key); it != cache.map.end()) {
+            return it->second.second;
+        }
+    }
 
-        // Add the rtscc function. This will also indirectly
-        // add the translator function.
-        add_poly_rtscc<T>(s, order, 1);
+    // Cache miss, we need to create
+    // a new LLVM state and functions.
+    // NOTE: the compilation is run without holding
+    // the lock, so that threads fetching other
+    // functions are not blocked.
+    llvm_state s;
 
-        // Run the optimisation pass.
-        s.optimise();
+    // Add the rtscc function. This will also indirectly
+    // add the translator function.
+    add_poly_rtscc<T>(s, order, batch_size);
 
-        // Compile.
-        s.compile();
+    // Run the optimisation pass.
+    s.optimise();
 
-        // Fetch the functions.
-        auto pt = reinterpret_cast<pt_t>(s.jit_lookup("poly_translate_1"));
-        auto rtscc = reinterpret_cast<rtscc_t>(s.jit_lookup("poly_rtscc"));
+    // Compile.
+    s.compile();
 
-        // Insert state and functions into the cache.
-        [[maybe_unused]] const auto ret = tf_map.try_emplace(order, std::pair{std::move(s), std::pair{pt, rtscc}});
-        assert(ret.second);
+    // Fetch the functions.
+    auto pt = reinterpret_cast<ed_pt_t<T>>(s.jit_lookup("poly_translate_1"));
+    auto rtscc = reinterpret_cast<ed_rtscc_t<T>>(s.jit_lookup("poly_rtscc"));
 
-        return std::pair{pt, rtscc};
-    } else {
-        // Cache hit, return the function.
-        return it->second.second;
+    // Insert state and functions into the cache.
+    // NOTE: if another thread inserted the same functions
+    // in the meantime, its functions will be used and ours
+    // will be discarded.
+    std::pair<ed_pt_t<T>, ed_rtscc_t<T>> retval;
+    {
+        std::unique_lock lock(cache.mutex);
+
+        const auto ret = cache.map.try_emplace(key, std::pair{std::move(s), std::pair{pt, rtscc}});
+        retval = ret.first->second.second;
+    }
+
+    return retval;
+}
+
+// Set up ed for the event detection with polynomials of the given order.
+// ps_size is the number of polynomials processed simultaneously
+// in the pre-screening phase.
+// NOTE: this is a no-op if ed was already set up for the given order.
+template <typename T>
+void ed_data_setup(ed_data<T> &ed, std::uint32_t order, std::uint32_t ps_size)
+{
+    assert(order >= 2u);
+
+    if (ed.order == order) {
+        return;
     }
+
+    // NOTE: reset the order first, so that ed is in
+    // a consistent state if an exception is thrown below.
+    ed.order = 0;
+
+    // Fetch the JITted functions.
+    const auto [pt, rtscc] = get_ed_jit_functions<T>(order);
+    const auto ps_rtscc = ps_size > 1u ? get_ed_jit_functions<T>(order, ps_size).second : rtscc;
+
+    // Set up the arena.
+    // NOTE: no overflow check needed here, cause the order
+    // is always overflow checked in the integrator machinery.
+    const auto op1 = static_cast<decltype(ed.polys.size())>(order) + 1u;
+    ed.polys.assign(op1 * ed_arena_init_size, T(0));
+    ed.free_polys.clear();
+    ed.free_polys.reserve(ed_arena_init_size);
+    for (auto i = ed_arena_init_size; i > 0u; --i) {
+        ed.free_polys.push_back(i - 1u);
+    }
+
+    // NOTE: the working list can exceed its maximum size
+    // by one element before the algorithm bails out, and the
+    // number of isolating intervals can exceed the order by one.
+    ed.wlist.clear();
+    ed.wlist.reserve(ed_max_wlist_size + 1u);
+    ed.isol.clear();
+    ed.isol.reserve(op1 + 1u);
+
+    ed.pt = pt;
+    ed.rtscc = rtscc;
+    ed.ps_rtscc = ps_rtscc;
+    ed.order = order;
 }
 
-// Implementation of event detection.
+// Fetch the JITted functions of the root isolation algorithm
+// for polynomials of order ev_order (which cannot be greater
+// than the order ed was set up for).
+// NOTE: the functions for the reduced detection orders
+// are fetched from the process-wide cache on first use
+// and then stored in ed.
 template <typename T>
+std::pair<ed_pt_t<T>, ed_rtscc_t<T>> ed_get_jit_functions(ed_data<T> &ed, std::uint32_t ev_order)
+{
+    assert(ev_order >= 2u && ev_order <= ed.order);
+
+    if (ev_order == ed.order) {
+        return {ed.pt, ed.rtscc};
+    }
+
+    for (const auto &[o, pt, rtscc] : ed.r_fns) {
+        if (o == ev_order) {
+            return {pt, rtscc};
+        }
+    }
+
+    const auto retval = get_ed_jit_functions<T>(ev_order);
+    ed.r_fns.emplace_back(ev_order, retval.first, retval.second);
+
+    return retval;
+}
+
+// Determine the order of the polynomial used in the detection
+// of the event at index idx (first the terminal events, then the
+// non-terminal ones). The order of the integrator is used if the
+// event has no detection order or if its detection order
+// is not less than the order of the integrator.
+template <typename TEs, typename NTEs>
+std::uint32_t ed_event_order(const TEs &tes, const NTEs &ntes, std::size_t idx, std::uint32_t order)
+{
+    const auto d_order
+        = idx < tes.size() ? tes[idx].get_detection_order() : ntes[idx - tes.size()].get_detection_order();
+
+    return (d_order == 0u || d_order >= order) ? order : d_order;
+}
+
+// Implementation of event detection. ev_ptr points to the Taylor polynomials
+// of the event equations (first the terminal events, then the non-terminal ones),
+// stored contiguously. If skip is not null, it points to an array of flags
+// (one per event, with the same ordering as ev_ptr) signalling which events
+// were already ruled out by the pre-screening.
+template <typename T, typename TEs, typename NTEs>
 void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, int>> &d_tes,
-                               std::vector<std::tuple<std::uint32_t, T, int>> &d_ntes,
-                               const std::vector<t_event<T>> &tes, const std::vector<nt_event<T>> &ntes,
-                               const std::vector<std::optional<std::pair<T, T>>> &cooldowns, T h,
-                               const std::vector<T> &ev_jet, std::uint32_t order, std::uint32_t dim)
+                               std::vector<std::tuple<std::uint32_t, T, int>> &d_ntes, const TEs &tes,
+                               const NTEs &ntes, const std::vector<std::optional<std::pair<T, T>>> &cooldowns, T h,
+                               const T *ev_ptr, std::uint32_t order, const char *skip, ed_data<T> &ed)
 {
     using std::isfinite;
 
@@ -628,7 +885,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
 
     if (!isfinite(h)) {
         // LCOV_EXCL_START
-        get_logger()->warn("event detection skipped due to an invalid timestep value of {}", h);
+        hot_warn("event detection skipped due to an invalid timestep value of {}", h);
         return;
         // LCOV_EXCL_STOP
     }
@@ -639,30 +896,18 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
     }
 
     assert(order >= 2u);
+    assert(ed.order == order);
 
-    // NOTE: trigger the creation of the poly cache
-    // *before* triggering the creation of the other
-    // thread-local variables. This is important because
-    // the working list contains pwrap objects, which in turn
-    // interact with the poly cache. If we don't do this,
-    // the poly cache will be destroyed before the working
-    // list, and the destructors in the working list will
-    // interact with invalid memory.
-    auto &pc = get_poly_cache<T>();
-
-    // Fetch a reference to the list of isolating intervals.
-    auto &isol = get_isol<T>();
-
-    // Fetch a reference to the wlist.
-    auto &wl = get_wlist<T>();
-
-    // Fetch the JITted functions.
-    auto j_funcs = get_ed_jit_functions<T>(order);
-    auto pt = j_funcs.first;
-    auto rtscc = j_funcs.second;
+    // Fetch references to the list of isolating
+    // intervals and to the working list.
+    auto &isol = ed.isol;
+    auto &wl = ed.wlist;
 
     // Temporary polynomials used in the bisection loop.
-    pwrap<T> tmp1(pc, order), tmp2(pc, order), tmp(pc, order);
+    // NOTE: the polynomials in the arena have order + 1 coefficients,
+    // the events with a reduced detection order use only the
+    // first ev_order + 1 coefficients.
+    pwrap<T> tmp1(ed), tmp2(ed), tmp(ed);
 
     // Helper to run event detection on a vector of events
     // (terminal or not). 'out' is the vector of detected
@@ -672,16 +917,30 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
         using ev_type = typename uncvref_t<decltype(ev_vec)>::value_type;
 
         for (std::uint32_t i = 0; i < ev_vec.size(); ++i) {
+            // The index of the current event in ev_ptr/skip.
+            const auto ev_idx = i + (is_terminal_event_v<ev_type> ? 0u : tes.size());
+
+            if (skip != nullptr && skip[ev_idx]) {
+                // The event was ruled out by the pre-screening.
+                continue;
+            }
+
+            // Fetch the detection order of the current event
+            // and the corresponding JITted functions.
+            const auto ev_order = ed_event_order(tes, ntes, ev_idx, order);
+            const auto fns = ed_get_jit_functions(ed, ev_order);
+            const auto pt = fns.first;
+            const auto rtscc = fns.second;
+
             // Clear out the list of isolating intervals.
             isol.clear();
 
             // Reset the working list.
-            wl.clear();
+            ed_clear_wlist(ed);
 
             // Extract the pointer to the Taylor polynomial for the
             // current event.
-            const auto ptr
-                = ev_jet.data() + (i + dim + (is_terminal_event_v<ev_type> ? 0u : tes.size())) * (order + 1u);
+            const auto ptr = ev_ptr + ev_idx * (order + 1u);
 
             // Helper to add a detected event to out.
             // NOTE: the root here is expected to be already rescaled
@@ -692,8 +951,8 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                 // sorting the events by time is safe.
                 if (!isfinite(root)) {
                     // LCOV_EXCL_START
-                    get_logger()->warn("polynomial root finding produced a non-finite root of {} - skipping the event",
-                                       root);
+                    hot_warn("polynomial root finding produced a non-finite root of {} - skipping the event",
+                             root);
                     return;
                     // LCOV_EXCL_STOP
                 }
@@ -717,8 +976,8 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                         }
 
                         // Evaluate the polynomial at the cooldown boundaries.
-                        const auto e1 = poly_eval(ptr, root + cd, order);
-                        const auto e2 = poly_eval(ptr, root - cd, order);
+                        const auto e1 = poly_eval(ptr, root + cd, ev_order);
+                        const auto e2 = poly_eval(ptr, root - cd, ev_order);
 
                         // We detect multiple roots within the cooldown
                         // if the signs of e1 and e2 are equal.
@@ -729,12 +988,12 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                 }();
 
                 // Evaluate the derivative.
-                const auto der = poly_eval_1(ptr, root, order);
+                const auto der = poly_eval_1(ptr, root, ev_order);
 
                 // Check it before proceeding.
                 if (!isfinite(der)) {
                     // LCOV_EXCL_START
-                    get_logger()->warn(
+                    hot_warn(
                         "polynomial root finding produced a root of {} with nonfinite derivative - skipping the event",
                         root);
                     return;
@@ -811,18 +1070,17 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
             // it invalid) but it will immediately be revived at the
             // first iteration of the do/while loop. Thus, when we get
             // here again, tmp will be again in a well-formed state.
-            assert(!tmp.v.empty());
-            assert(tmp.v.size() - 1u == order);
-            poly_rescale(tmp.v.data(), ptr, h, order);
+            assert(tmp.valid());
+            poly_rescale(tmp.data(), ptr, h, ev_order);
 
             // Determine the polynomial degree.
-            auto degree = order;
+            auto degree = ev_order;
             // NOTE: use < rather than <= in order to avoid
             // wrapping degree around. I.e., degree will
             // always be at least 0, even if the order 0
             // coefficient is zero.
-            for (std::uint32_t o = 0; o < order; ++o) {
-                if (tmp.v[order - o] != 0) {
+            for (std::uint32_t o = 0; o < ev_order; ++o) {
+                if (tmp.data()[ev_order - o] != 0) {
                     break;
                 }
                 --degree;
@@ -833,7 +1091,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
             switch (degree) {
                 case 1u: {
                     // Linear case.
-                    const auto root = -tmp.v[0] / tmp.v[1];
+                    const auto root = -tmp.data()[0] / tmp.data()[1];
 
                     // Add the root only if it falls outside
                     // the cooldown range and within the [0, 1)
@@ -848,7 +1106,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                     // Quadratic case.
                     using std::sqrt;
 
-                    const auto a = tmp.v[2], b = tmp.v[1], c = tmp.v[0];
+                    const auto a = tmp.data()[2], b = tmp.data()[1], c = tmp.data()[0];
                     const auto delta = b * b - 4 * a * c;
 
                     if (delta < 0) {
@@ -876,7 +1134,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
             }
 
             // Place the first element in the working list.
-            wl.emplace_back(0, 1, std::move(tmp));
+            wl.emplace_back(0, 1, tmp.release());
 
 #if !defined(NDEBUG)
             auto max_wl_size = wl.size();
@@ -897,7 +1155,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                 auto ub = std::get<1>(wl.back());
                 // NOTE: this will either revive an invalid tmp (first iteration),
                 // or it will replace it with one of the bisecting polynomials.
-                tmp = std::move(std::get<2>(wl.back()));
+                tmp = pwrap<T>(ed, std::get<2>(wl.back()));
                 wl.pop_back();
 
                 // Check for an event at the lower bound, which occurs
@@ -907,8 +1165,8 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                 // When we do proper root finding below, the
                 // algorithm should be able to detect non-finite
                 // polynomials.
-                if (tmp.v[0] == T(0) // LCOV_EXCL_LINE
-                    && std::all_of(tmp.v.data() + 1, tmp.v.data() + 1 + order,
+                if (tmp.data()[0] == T(0) // LCOV_EXCL_LINE
+                    && std::all_of(tmp.data() + 1, tmp.data() + 1 + ev_order,
                                    [](const auto &x) { return isfinite(x); })) {
                     // NOTE: we will have to skip the event if we are dealing
                     // with a terminal event on cooldown and the lower bound
@@ -935,7 +1193,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                 // Reverse tmp into tmp1, translate tmp1 by 1 with output
                 // in tmp2, and count the sign changes in tmp2.
                 std::uint32_t n_sc;
-                rtscc(tmp1.v.data(), tmp2.v.data(), &n_sc, tmp.v.data());
+                rtscc(tmp1.data(), tmp2.data(), &n_sc, tmp.data());
 
                 if (n_sc == 1u) {
                     // Found isolating interval, add it to isol.
@@ -945,19 +1203,19 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
 
                     // First we transform q into 2**n * q(x/2) and store the result
                     // into tmp1.
-                    poly_rescale_p2(tmp1.v.data(), tmp.v.data(), order);
+                    poly_rescale_p2(tmp1.data(), tmp.data(), ev_order);
                     // Then we take tmp1 and translate it to produce 2**n * q((x+1)/2).
-                    pt(tmp2.v.data(), tmp1.v.data());
+                    pt(tmp2.data(), tmp1.data());
 
                     // Finally we add tmp1 and tmp2 to the working list.
                     const auto mid = (lb + ub) / 2;
                     // NOTE: don't add the lower range if it falls
                     // entirely within the cooldown range.
                     if (lb_offset < mid) {
-                        wl.emplace_back(lb, mid, std::move(tmp1));
+                        wl.emplace_back(lb, mid, tmp1.release());
 
                         // Revive tmp1.
-                        tmp1 = pwrap<T>(pc, order);
+                        tmp1 = pwrap<T>(ed);
                     } else {
                         // LCOV_EXCL_START
                         SPDLOG_LOGGER_DEBUG(
@@ -965,10 +1223,10 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                             "ignoring lower interval in a bisection that would fall entirely in the cooldown period");
                         // LCOV_EXCL_STOP
                     }
-                    wl.emplace_back(mid, ub, std::move(tmp2));
+                    wl.emplace_back(mid, ub, tmp2.release());
 
                     // Revive tmp2.
-                    tmp2 = pwrap<T>(pc, order);
+                    tmp2 = pwrap<T>(ed);
                 }
 
 #if !defined(NDEBUG)
@@ -977,15 +1235,13 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
 #endif
 
                 // We want to put limits in order to avoid an endless loop when the algorithm fails.
-                // The first check is on the working list size and it is based
-                // on heuristic observation of the algorithm's behaviour in pathological
-                // cases. The second check is that we cannot possibly find more isolating
+                // The first check is on the working list size (see ed_max_wlist_size).
+                // The second check is that we cannot possibly find more isolating
                 // intervals than the degree of the polynomial.
-                if (wl.size() > 250u || isol.size() > order) {
-                    get_logger()->warn(
-                        "the polynomial root isolation algorithm failed during event detection: the working "
-                        "list size is {} and the number of isolating intervals is {}",
-                        wl.size(), isol.size());
+                if (wl.size() > ed_max_wlist_size || isol.size() > ev_order) {
+                    hot_warn("the polynomial root isolation algorithm failed during event detection: the working "
+                             "list size is {} and the number of isolating intervals is {}",
+                             wl.size(), isol.size());
 
                     loop_failed = true;
 
@@ -1012,7 +1268,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
             // isolating intervals are also rescaled to [0, 1).
             // NOTE: tmp1 was either created with the correct size outside this
             // function, or it was re-created in the bisection above.
-            poly_rescale(tmp1.v.data(), ptr, h, order);
+            poly_rescale(tmp1.data(), ptr, h, ev_order);
 
             // Run the root finding in the isolating intervals.
             for (auto &[lb, ub] : isol) {
@@ -1030,8 +1286,8 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                         assert(lb < ub);
 
                         // Check if the interval still contains a zero.
-                        const auto f_lb = poly_eval(tmp1.v.data(), lb, order);
-                        const auto f_ub = poly_eval(tmp1.v.data(), ub, order);
+                        const auto f_lb = poly_eval(tmp1.data(), lb, ev_order);
+                        const auto f_ub = poly_eval(tmp1.data(), ub, ev_order);
 
                         if (!(f_lb * f_ub < 0)) {
                             SPDLOG_LOGGER_DEBUG(get_logger(), "terminal event {} is subject to cooldown, ignoring", i);
@@ -1041,7 +1297,7 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                 }
 
                 // Run the root finding.
-                const auto [root, cflag] = bracketed_root_find(tmp1, order, lb, ub);
+                const auto [root, cflag] = bracketed_root_find(tmp1, ev_order, lb, ub);
 
                 if (cflag == 0) {
                     // Root finding finished successfully, record the event.
@@ -1052,11 +1308,10 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
                     // event and log the issue.
                     if (cflag == -1) {
                         // LCOV_EXCL_START
-                        get_logger()->warn(
-                            "polynomial root finding during event detection failed due to too many iterations");
+                        hot_warn("polynomial root finding during event detection failed due to too many iterations");
                         // LCOV_EXCL_STOP
                     } else {
-                        get_logger()->warn(
+                        hot_warn(
                             "polynomial root finding during event detection returned a nonzero errno with message '{}'",
                             std::strerror(cflag));
                     }
@@ -1067,6 +1322,339 @@ void taylor_detect_events_impl(std::vector<std::tuple<std::uint32_t, T, bool, in
 
     run_detection(d_tes, tes);
     run_detection(d_ntes, ntes);
+
+    // Return the polynomials left in the
+    // working list (if any) to the arena.
+    ed_clear_wlist(ed);
+}
+
+// Minimum number of candidate events (i.e., events not ruled out by the
+// pre-screening) in each block of the parallel event detection.
+// NOTE: this is based on heuristic observation: below this
+// size, the overhead of the parallelisation is not worth it.
+constexpr std::uint64_t ed_par_min_block_size = 16;
+
+// Parallel implementation of the root isolation phase of event detection.
+// The n_cand candidate events (i.e., the events for which ed.skip is zero)
+// are split in blocks with approximately the same number of candidates,
+// which are processed in parallel by taylor_detect_events_impl(), each with
+// its own scratch memory. The detected events are then concatenated
+// in d_tes/d_ntes (they are sorted by time in the integrator).
+template <typename T, typename TEs, typename NTEs>
+void taylor_detect_events_par(std::vector<std::tuple<std::uint32_t, T, bool, int>> &d_tes,
+                              std::vector<std::tuple<std::uint32_t, T, int>> &d_ntes, const TEs &tes,
+                              const NTEs &ntes, const std::vector<std::optional<std::pair<T, T>>> &cooldowns, T h,
+                              const T *ev_ptr, std::uint32_t order, std::uint64_t n_cand, ed_data<T> &ed)
+{
+    const auto &skip = ed.skip;
+    const auto n_ev = skip.size();
+
+    const auto n_blocks = parallel_n_workers(static_cast<std::size_t>(n_cand / ed_par_min_block_size), 0);
+    assert(n_blocks > 0u);
+
+    ed.blocks.resize(n_blocks);
+    ed.b_skip.resize(n_blocks);
+    ed.b_d_tes.resize(n_blocks);
+    ed.b_d_ntes.resize(n_blocks);
+
+    // Assign the candidate events to the blocks.
+    for (auto &bs : ed.b_skip) {
+        bs.assign(n_ev, 1);
+    }
+    std::uint64_t cur_cand = 0;
+    for (decltype(skip.size()) k = 0; k < n_ev; ++k) {
+        if (skip[k] == 0) {
+            ed.b_skip[static_cast<decltype(ed.b_skip.size())>(cur_cand * n_blocks / n_cand)][k] = 0;
+            ++cur_cand;
+        }
+    }
+    assert(cur_cand == n_cand);
+
+    // Record the arena counters of the blocks.
+    std::uint64_t n_hits_start = 0, n_misses_start = 0;
+    for (const auto &b_ed : ed.blocks) {
+        n_hits_start += b_ed.n_hits;
+        n_misses_start += b_ed.n_misses;
+    }
+
+    // NOTE: pool_parallel_for() requires a non-throwing function,
+    // thus the first exception thrown in a block is stored and
+    // re-thrown after all the blocks have been processed.
+    std::exception_ptr eptr;
+    std::mutex eptr_mutex;
+
+    pool_parallel_for(n_blocks, [&](std::size_t b, std::size_t e) {
+        for (auto i = b; i < e; ++i) {
+            try {
+                ed_data_setup(ed.blocks[i], order, 1);
+
+                taylor_detect_events_impl(ed.b_d_tes[i], ed.b_d_ntes[i], tes, ntes, cooldowns, h, ev_ptr, order,
+                                          ed.b_skip[i].data(), ed.blocks[i]);
+                // LCOV_EXCL_START
+            } catch (...) {
+                std::lock_guard lock(eptr_mutex);
+
+                if (!eptr) {
+                    eptr = std::current_exception();
+                }
+            }
+            // LCOV_EXCL_STOP
+        }
+    });
+
+    // LCOV_EXCL_START
+    if (eptr) {
+        std::rethrow_exception(eptr);
+    }
+    // LCOV_EXCL_STOP
+
+    // Merge the detected events and update the arena counters.
+    d_tes.clear();
+    d_ntes.clear();
+    for (decltype(ed.blocks.size()) i = 0; i < n_blocks; ++i) {
+        d_tes.insert(d_tes.end(), ed.b_d_tes[i].begin(), ed.b_d_tes[i].end());
+        d_ntes.insert(d_ntes.end(), ed.b_d_ntes[i].begin(), ed.b_d_ntes[i].end());
+
+        ed.n_hits += ed.blocks[i].n_hits;
+        ed.n_misses += ed.blocks[i].n_misses;
+    }
+    ed.n_hits -= n_hits_start;
+    ed.n_misses -= n_misses_start;
+}
+
+// Helper to determine if, after the invocation of the batch-mode
+// rtscc function on the rescaled polynomials r_poly (in SIMD layout),
+// the polynomial in the SIMD lane j can be ruled out.
+// NOTE: a polynomial can be ruled out if the scalar implementation
+// would run the root isolation algorithm on it (i.e., the degree
+// is not 1 or 2), there is no root at the beginning of the timestep and
+// there are no sign changes. In this case, the scalar
+// implementation would not detect any event either.
+template <typename T>
+bool ed_prescreen_lane(const T *r_poly, const std::uint32_t *n_sc, std::uint32_t j, std::uint32_t order,
+                       std::uint32_t simd_size)
+{
+    // Determine the polynomial degree.
+    auto degree = order;
+    for (std::uint32_t o = 0; o < order; ++o) {
+        if (r_poly[(order - o) * simd_size + j] != 0) {
+            break;
+        }
+        --degree;
+    }
+
+    return degree != 1u && degree != 2u && r_poly[j] != 0 && n_sc[j] == 0u;
+}
+
+// Helper to determine if the event polynomial with coefficients
+// ptr[0], ptr[stride], ..., ptr[order * stride] can be ruled out
+// on the timestep [0, h) via a cheap bound on its range.
+// After rescaling the polynomial so that [0, h) becomes [0, 1),
+// we have |p(x)| >= |r_0| - sum_{o >= 1} |r_o| for x in [0, 1),
+// and thus there cannot be any root in the timestep if
+// |r_0| > sum_{o >= 1} |r_o|.
+// NOTE: the sum is inflated by a small factor in order to account
+// for the rounding errors in the computation of the rescaled coefficients
+// and of the sum itself. In case of non-finite values, the comparison
+// evaluates to false and the polynomial will not be ruled out.
+template <typename T>
+bool ed_bound_prune(const T *ptr, T h, std::uint32_t order, std::uint32_t stride)
+{
+    using std::abs;
+
+    T cur_f(1), rest(0);
+
+    for (std::uint32_t o = 1; o <= order; ++o) {
+        cur_f *= h;
+        rest += abs(cur_f * ptr[o * stride]);
+    }
+
+    return abs(ptr[0]) > rest * (1 + T(2) * T(order + 1u) * std::numeric_limits<T>::epsilon());
+}
+
+// Global counters for the pre-screening statistics.
+std::atomic<std::uint64_t> ed_n_tot = 0;
+std::atomic<std::uint64_t> ed_n_bound = 0;
+std::atomic<std::uint64_t> ed_n_sc = 0;
+
+// Helper to update the global pre-screening counters.
+// NOTE: the counters are updated once per event detection
+// invocation in order to limit the contention between threads.
+void ed_update_prune_stats(std::uint64_t n_tot, std::uint64_t n_bound, std::uint64_t n_sc)
+{
+    if (n_tot != 0u) {
+        ed_n_tot.fetch_add(n_tot, std::memory_order_relaxed);
+    }
+    if (n_bound != 0u) {
+        ed_n_bound.fetch_add(n_bound, std::memory_order_relaxed);
+    }
+    if (n_sc != 0u) {
+        ed_n_sc.fetch_add(n_sc, std::memory_order_relaxed);
+    }
+}
+
+// Number of event polynomials processed simultaneously
+// during the sign change pre-screening phase of the scalar implementation.
+// A value of 1 disables the sign change pre-screening.
+// NOTE: long double and real128 have no SIMD support, so
+// we would not gain anything from the sign change pre-screening.
+template <typename T>
+inline constexpr std::uint32_t ed_simd_size = 1;
+
+template <>
+inline constexpr std::uint32_t ed_simd_size<double> = 4;
+
+// Pre-compile the JITted functions used in the event detection
+// for integrators with the given order and batch size.
+template <typename T>
+void taylor_ed_warmup_impl(std::uint32_t order, std::uint32_t batch_size)
+{
+    if (order < 2u) {
+        throw std::invalid_argument(
+            "The order passed to taylor_ed_warmup() must be at least 2, but the value {} was provided instead"_format(
+                order));
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size passed to taylor_ed_warmup() cannot be zero");
+    }
+
+    // The functions used in the root isolation algorithm.
+    get_ed_jit_functions<T>(order);
+
+    // The functions used in the pre-screening phase.
+    const auto ps_size = batch_size == 1u ? ed_simd_size<T> : batch_size;
+    if (ps_size > 1u) {
+        get_ed_jit_functions<T>(order, ps_size);
+    }
+}
+
+// Scalar implementation of event detection, with pre-screening.
+// The event polynomials are first checked via the cheap range bound
+// implemented in ed_bound_prune(). The events which survive are then
+// processed in groups of ed_simd_size<T>, packed in SIMD layout (i.e.,
+// the values for all the events in the group are stored contiguously
+// for each Taylor coefficient). For each group, the first iteration
+// of the root isolation algorithm (i.e., the Descartes sign change count
+// on the whole timestep) is run simultaneously on all the events via the
+// batch-mode rtscc function. The events ruled out by the pre-screening are
+// skipped in taylor_detect_events_impl().
+template <typename T, typename TEs, typename NTEs>
+void taylor_detect_events_scalar_impl(std::vector<std::tuple<std::uint32_t, T, bool, int>> &d_tes,
+                                      std::vector<std::tuple<std::uint32_t, T, int>> &d_ntes, const TEs &tes,
+                                      const NTEs &ntes, const std::vector<std::optional<std::pair<T, T>>> &cooldowns,
+                                      T h, const aligned_vector<T> &ev_jet, std::uint32_t order, std::uint32_t dim,
+                                      ed_data<T> &ed)
+{
+    using std::isfinite;
+
+    trace_span span("event_detection", "events");
+
+    constexpr auto simd_size = ed_simd_size<T>;
+
+    ed_data_setup(ed, order, simd_size);
+
+    // NOTE: the integrator checks that all the sizes
+    // below can be computed without overflow.
+    const auto n_ev = tes.size() + ntes.size();
+    const auto op1 = order + 1u;
+
+    // Pointer to the beginning of the event polynomials.
+    const auto ev_begin = ev_jet.data() + static_cast<decltype(ev_jet.size())>(dim) * op1;
+
+    // NOTE: with no events, or with an invalid or zero timestep
+    // (which are handled in taylor_detect_events_impl()), there is
+    // nothing to pre-screen.
+    if (n_ev == 0u || !isfinite(h) || h == 0) {
+        taylor_detect_events_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_begin, order, nullptr, ed);
+
+        return;
+    }
+
+    auto &r_poly = ed.r_poly, &t_poly1 = ed.t_poly1, &t_poly2 = ed.t_poly2;
+    auto &n_sc = ed.n_sc;
+    auto &skip = ed.skip;
+    skip.resize(n_ev);
+
+    // Run the bound-based pre-screening.
+    std::uint64_t n_bound = 0, n_sc_pruned = 0;
+    for (decltype(ev_jet.size()) k = 0; k < n_ev; ++k) {
+        skip[k] = ed_bound_prune(ev_begin + k * op1, h, ed_event_order(tes, ntes, k, order), 1);
+        n_bound += static_cast<std::uint64_t>(skip[k] != 0);
+    }
+
+    // NOTE: the sign change pre-screening is worth it only
+    // if we can process at least two events simultaneously.
+    if (simd_size > 1u && n_ev - n_bound >= 2u) {
+        r_poly.resize(op1 * simd_size);
+        t_poly1.resize(op1 * simd_size);
+        t_poly2.resize(op1 * simd_size);
+        n_sc.resize(simd_size);
+
+        // Fetch the batch-mode rtscc function.
+        const auto rtscc = ed.ps_rtscc;
+
+        // Indices of the events in the current group.
+        std::array<decltype(ev_jet.size()), simd_size> g_idx{};
+
+        for (decltype(ev_jet.size()) k = 0; k < n_ev;) {
+            // Gather the next group of events which were
+            // not ruled out by the bound-based pre-screening.
+            std::uint32_t n_group = 0;
+            for (; k < n_ev && n_group < simd_size; ++k) {
+                if (skip[k] == 0) {
+                    g_idx[n_group++] = k;
+                }
+            }
+
+            if (n_group == 0u) {
+                break;
+            }
+
+            // Pack and rescale the event polynomials so that the range [0, h)
+            // becomes [0, 1). This is the same computation
+            // performed by poly_rescale() in taylor_detect_events_impl().
+            // NOTE: the coefficients beyond the detection order of an event
+            // are set to zero. The zero-padded polynomial has the same roots
+            // in [0, 1) as the polynomial used in taylor_detect_events_impl(),
+            // while the number of sign changes after the reversion and translation
+            // can only be smaller: thus, the pre-screening remains correct.
+            for (std::uint32_t j = 0; j < simd_size; ++j) {
+                if (j < n_group) {
+                    const auto ptr = ev_begin + g_idx[j] * op1;
+                    const auto ev_order = ed_event_order(tes, ntes, g_idx[j], order);
+
+                    T cur_f(1);
+
+                    for (std::uint32_t o = 0; o <= order; ++o) {
+                        r_poly[o * simd_size + j] = o <= ev_order ? cur_f * ptr[o] : T(0);
+                        cur_f *= h;
+                    }
+                } else {
+                    // Pad the last group with zero polynomials.
+                    for (std::uint32_t o = 0; o <= order; ++o) {
+                        r_poly[o * simd_size + j] = 0;
+                    }
+                }
+            }
+
+            rtscc(t_poly1.data(), t_poly2.data(), n_sc.data(), r_poly.data());
+
+            for (std::uint32_t j = 0; j < n_group; ++j) {
+                skip[g_idx[j]] = ed_prescreen_lane(r_poly.data(), n_sc.data(), j, order, simd_size);
+                n_sc_pruned += static_cast<std::uint64_t>(skip[g_idx[j]] != 0);
+            }
+        }
+    }
+
+    ed_update_prune_stats(static_cast<std::uint64_t>(n_ev), n_bound, n_sc_pruned);
+
+    const auto n_cand = n_ev - n_bound - n_sc_pruned;
+    if (ed.parallel && n_cand >= 2u * ed_par_min_block_size) {
+        taylor_detect_events_par(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_begin, order, n_cand, ed);
+    } else {
+        taylor_detect_events_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_begin, order, skip.data(), ed);
+    }
 }
 
 } // namespace
@@ -1076,9 +1664,10 @@ void taylor_detect_events(std::vector<std::tuple<std::uint32_t, double, bool, in
                           std::vector<std::tuple<std::uint32_t, double, int>> &d_ntes,
                           const std::vector<t_event<double>> &tes, const std::vector<nt_event<double>> &ntes,
                           const std::vector<std::optional<std::pair<double, double>>> &cooldowns, double h,
-                          const std::vector<double> &ev_jet, std::uint32_t order, std::uint32_t dim)
+                          const aligned_vector<double> &ev_jet, std::uint32_t order, std::uint32_t dim,
+                          ed_data<double> &ed)
 {
-    taylor_detect_events_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_jet, order, dim);
+    taylor_detect_events_scalar_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_jet, order, dim, ed);
 }
 
 template <>
@@ -1086,9 +1675,10 @@ void taylor_detect_events(std::vector<std::tuple<std::uint32_t, long double, boo
                           std::vector<std::tuple<std::uint32_t, long double, int>> &d_ntes,
                           const std::vector<t_event<long double>> &tes, const std::vector<nt_event<long double>> &ntes,
                           const std::vector<std::optional<std::pair<long double, long double>>> &cooldowns,
-                          long double h, const std::vector<long double> &ev_jet, std::uint32_t order, std::uint32_t dim)
+                          long double h, const aligned_vector<long double> &ev_jet, std::uint32_t order,
+                          std::uint32_t dim, ed_data<long double> &ed)
 {
-    taylor_detect_events_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_jet, order, dim);
+    taylor_detect_events_scalar_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_jet, order, dim, ed);
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
@@ -1099,10 +1689,10 @@ void taylor_detect_events(std::vector<std::tuple<std::uint32_t, mppp::real128, b
                           const std::vector<t_event<mppp::real128>> &tes,
                           const std::vector<nt_event<mppp::real128>> &ntes,
                           const std::vector<std::optional<std::pair<mppp::real128, mppp::real128>>> &cooldowns,
-                          mppp::real128 h, const std::vector<mppp::real128> &ev_jet, std::uint32_t order,
-                          std::uint32_t dim)
+                          mppp::real128 h, const aligned_vector<mppp::real128> &ev_jet, std::uint32_t order,
+                          std::uint32_t dim, ed_data<mppp::real128> &ed)
 {
-    taylor_detect_events_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_jet, order, dim);
+    taylor_detect_events_scalar_impl(d_tes, d_ntes, tes, ntes, cooldowns, h, ev_jet, order, dim, ed);
 }
 
 #endif
@@ -1110,6 +1700,191 @@ void taylor_detect_events(std::vector<std::tuple<std::uint32_t, mppp::real128, b
 namespace
 {
 
+// Batch implementation of event detection. The jet of derivatives ev_jet
+// is stored in the batch layout (i.e., the values for all the batch elements
+// are stored contiguously for each Taylor coefficient).
+template <typename T>
+void taylor_detect_events_batch_impl(std::vector<std::vector<std::tuple<std::uint32_t, T, bool, int>>> &d_tes,
+                                     std::vector<std::vector<std::tuple<std::uint32_t, T, int>>> &d_ntes,
+                                     const std::vector<t_event_impl<T, true>> &tes,
+                                     const std::vector<nt_event_impl<T, true>> &ntes,
+                                     const std::vector<std::vector<std::optional<std::pair<T, T>>>> &cooldowns,
+                                     const std::vector<T> &hs, const aligned_vector<T> &ev_jet, std::uint32_t order,
+                                     std::uint32_t dim, std::uint32_t batch_size, ed_data<T> &ed)
+{
+    using std::isfinite;
+
+    trace_span span("event_detection_batch", "events");
+
+    assert(d_tes.size() == batch_size);
+    assert(d_ntes.size() == batch_size);
+    assert(cooldowns.size() == batch_size);
+    assert(hs.size() == batch_size);
+    assert(order >= 2u);
+
+    // NOTE: the integrator checks that all the sizes
+    // below can be computed without overflow.
+    const auto n_ev = tes.size() + ntes.size();
+    const auto op1 = order + 1u;
+
+    ed_data_setup(ed, order, batch_size);
+
+    auto &lane_poly = ed.lane_poly, &r_poly = ed.r_poly, &t_poly1 = ed.t_poly1, &t_poly2 = ed.t_poly2;
+    auto &n_sc = ed.n_sc;
+    auto &skip = ed.skip;
+    lane_poly.resize(n_ev * op1);
+    r_poly.resize(op1 * batch_size);
+    t_poly1.resize(op1 * batch_size);
+    t_poly2.resize(op1 * batch_size);
+    n_sc.resize(batch_size);
+    skip.resize(n_ev * batch_size);
+
+    // Fetch the batch-mode rtscc function.
+    const auto rtscc = ed.ps_rtscc;
+
+    // Pointer to the beginning of the event polynomials.
+    const auto ev_begin = ev_jet.data() + static_cast<decltype(ev_jet.size())>(dim) * op1 * batch_size;
+
+    // Pre-screening: for each event, first check the bound on the range
+    // of the event polynomials. Then, if at least one batch element was not ruled out
+    // by the bound, run simultaneously on all batch elements
+    // the first iteration of the root isolation algorithm (i.e., the Descartes
+    // sign change count on the whole timestep), so that the events
+    // that have no roots can be skipped in the per-batch element
+    // implementation below.
+    std::uint64_t n_tot = 0, n_bound = 0, n_sc_pruned = 0;
+    for (decltype(ev_jet.size()) k = 0; k < n_ev; ++k) {
+        const auto ptr = ev_begin + k * op1 * batch_size;
+        const auto ev_order = ed_event_order(tes, ntes, k, order);
+
+        bool run_sc = false;
+        for (std::uint32_t j = 0; j < batch_size; ++j) {
+            const auto valid_h = isfinite(hs[j]) && hs[j] != 0;
+
+            // NOTE: the zero-length timesteps (e.g., those of the inactive
+            // batch elements) cannot contain any event, skip them.
+            skip[j * n_ev + k] = hs[j] == 0 || (valid_h && ed_bound_prune(ptr + j, hs[j], ev_order, batch_size));
+
+            n_tot += static_cast<std::uint64_t>(valid_h);
+            n_bound += static_cast<std::uint64_t>(valid_h && skip[j * n_ev + k] != 0);
+            run_sc = run_sc || (valid_h && skip[j * n_ev + k] == 0);
+        }
+
+        if (!run_sc) {
+            continue;
+        }
+
+        // Rescale the event polynomials so that the range [0, h)
+        // becomes [0, 1). This is the same computation
+        // performed by poly_rescale() in the scalar implementation.
+        // NOTE: as in the scalar implementation, the coefficients beyond
+        // the detection order of the event are set to zero.
+        for (std::uint32_t j = 0; j < batch_size; ++j) {
+            T cur_f(1);
+
+            for (std::uint32_t o = 0; o <= order; ++o) {
+                r_poly[o * batch_size + j] = o <= ev_order ? cur_f * ptr[o * batch_size + j] : T(0);
+                cur_f *= hs[j];
+            }
+        }
+
+        rtscc(t_poly1.data(), t_poly2.data(), n_sc.data(), r_poly.data());
+
+        for (std::uint32_t j = 0; j < batch_size; ++j) {
+            if (skip[j * n_ev + k] == 0 && isfinite(hs[j]) && hs[j] != 0
+                && ed_prescreen_lane(r_poly.data(), n_sc.data(), j, order, batch_size)) {
+                skip[j * n_ev + k] = 1;
+                ++n_sc_pruned;
+            }
+        }
+    }
+
+    ed_update_prune_stats(n_tot, n_bound, n_sc_pruned);
+
+    // Run the event detection on the single batch elements.
+    for (std::uint32_t j = 0; j < batch_size; ++j) {
+        const auto skip_ptr = skip.data() + j * n_ev;
+
+        if (std::all_of(skip_ptr, skip_ptr + n_ev, [](char f) { return f != 0; })) {
+            // All events were ruled out by the pre-screening.
+            d_tes[j].clear();
+            d_ntes[j].clear();
+
+            continue;
+        }
+
+        // Copy the event polynomials of the current
+        // batch element into lane_poly.
+        for (decltype(ev_jet.size()) k = 0; k < n_ev; ++k) {
+            for (std::uint32_t o = 0; o <= order; ++o) {
+                lane_poly[k * op1 + o] = ev_begin[(k * op1 + o) * batch_size + j];
+            }
+        }
+
+        taylor_detect_events_impl(d_tes[j], d_ntes[j], tes, ntes, cooldowns[j], hs[j], lane_poly.data(), order,
+                                  skip_ptr, ed);
+    }
+}
+
+} // namespace
+
+template <>
+void taylor_detect_events_batch(std::vector<std::vector<std::tuple<std::uint32_t, double, bool, int>>> &d_tes,
+                                std::vector<std::vector<std::tuple<std::uint32_t, double, int>>> &d_ntes,
+                                const std::vector<t_event_impl<double, true>> &tes,
+                                const std::vector<nt_event_impl<double, true>> &ntes,
+                                const std::vector<std::vector<std::optional<std::pair<double, double>>>> &cooldowns,
+                                const std::vector<double> &hs, const aligned_vector<double> &ev_jet,
+                                std::uint32_t order, std::uint32_t dim, std::uint32_t batch_size, ed_data<double> &ed)
+{
+    taylor_detect_events_batch_impl(d_tes, d_ntes, tes, ntes, cooldowns, hs, ev_jet, order, dim, batch_size, ed);
+}
+
+template <>
+void taylor_detect_events_batch(
+    std::vector<std::vector<std::tuple<std::uint32_t, long double, bool, int>>> &d_tes,
+    std::vector<std::vector<std::tuple<std::uint32_t, long double, int>>> &d_ntes,
+    const std::vector<t_event_impl<long double, true>> &tes, const std::vector<nt_event_impl<long double, true>> &ntes,
+    const std::vector<std::vector<std::optional<std::pair<long double, long double>>>> &cooldowns,
+    const std::vector<long double> &hs, const aligned_vector<long double> &ev_jet, std::uint32_t order,
+    std::uint32_t dim, std::uint32_t batch_size, ed_data<long double> &ed)
+{
+    taylor_detect_events_batch_impl(d_tes, d_ntes, tes, ntes, cooldowns, hs, ev_jet, order, dim, batch_size, ed);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template <>
+void taylor_detect_events_batch(
+    std::vector<std::vector<std::tuple<std::uint32_t, mppp::real128, bool, int>>> &d_tes,
+    std::vector<std::vector<std::tuple<std::uint32_t, mppp::real128, int>>> &d_ntes,
+    const std::vector<t_event_impl<mppp::real128, true>> &tes,
+    const std::vector<nt_event_impl<mppp::real128, true>> &ntes,
+    const std::vector<std::vector<std::optional<std::pair<mppp::real128, mppp::real128>>>> &cooldowns,
+    const std::vector<mppp::real128> &hs, const aligned_vector<mppp::real128> &ev_jet, std::uint32_t order,
+    std::uint32_t dim, std::uint32_t batch_size, ed_data<mppp::real128> &ed)
+{
+    taylor_detect_events_batch_impl(d_tes, d_ntes, tes, ntes, cooldowns, hs, ev_jet, order, dim, batch_size, ed);
+}
+
+#endif
+
+ed_prune_stats get_ed_prune_stats()
+{
+    return ed_prune_stats{ed_n_tot.load(std::memory_order_relaxed), ed_n_bound.load(std::memory_order_relaxed),
+                          ed_n_sc.load(std::memory_order_relaxed)};
+}
+
+void reset_ed_prune_stats()
+{
+    ed_n_tot.store(0, std::memory_order_relaxed);
+    ed_n_bound.store(0, std::memory_order_relaxed);
+    ed_n_sc.store(0, std::memory_order_relaxed);
+}
+
+namespace
+{
+
 // Helper to automatically deduce the cooldown
 // for a terminal event which was detected within
 // a timestep of size h.
@@ -1156,3 +1931,27 @@ mppp::real128 taylor_deduce_cooldown(mppp::real128 h)
 #endif
 
 } // namespace heyoka::detail
+
+namespace heyoka
+{
+
+void taylor_ed_warmup_dbl(std::uint32_t order, std::uint32_t batch_size)
+{
+    detail::taylor_ed_warmup_impl<double>(order, batch_size);
+}
+
+void taylor_ed_warmup_ldbl(std::uint32_t order, std::uint32_t batch_size)
+{
+    detail::taylor_ed_warmup_impl<long double>(order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+void taylor_ed_warmup_f128(std::uint32_t order, std::uint32_t batch_size)
+{
+    detail::taylor_ed_warmup_impl<mppp::real128>(order, batch_size);
+}
+
+#endif
+
+} // namespace heyoka
@@ -385,6 +385,45 @@ llvm::Value *llvm_invoke_intrinsic(llvm_state &s, const std::string &name, const
     return r;
 }
 
+// Compute a * b + c, fusing the multiplication and the addition
+// if the target supports fast FMA instructions.
+// NOTE: the llvm.fmuladd intrinsic is contracted independently
+// of the fast math flags, and it falls back to a separate
+// multiplication and addition (rather than to a slow
+// software fma() call) on targets without hardware FMA.
+llvm::Value *llvm_fmuladd(llvm_state &s, llvm::Value *a, llvm::Value *b, llvm::Value *c)
+{
+    assert(a != nullptr);
+    assert(a->getType() == b->getType());
+    assert(a->getType() == c->getType());
+
+    return llvm_invoke_intrinsic(s, "llvm.fmuladd", {a->getType()}, {a, b, c});
+}
+
+// Pairwise dot product of the vectors of LLVM values a and b.
+// The products are first combined in pairs via fused
+// multiply-adds, then the partial results are summed pairwise.
+llvm::Value *pairwise_dot(llvm_state &s, const std::vector<llvm::Value *> &a, const std::vector<llvm::Value *> &b)
+{
+    assert(!a.empty());
+    assert(a.size() == b.size());
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> sum;
+    for (decltype(a.size()) i = 0; i < a.size(); i += 2u) {
+        auto *tmp = builder.CreateFMul(a[i], b[i]);
+
+        if (i + 1u < a.size()) {
+            tmp = llvm_fmuladd(s, a[i + 1u], b[i + 1u], tmp);
+        }
+
+        sum.push_back(tmp);
+    }
+
+    return pairwise_sum(builder, sum);
+}
+
 // Helper to invoke an external function called 'name' with arguments args and return type ret_type.
 llvm::Value *llvm_invoke_external(llvm_state &s, const std::string &name, llvm::Type *ret_type,
                                   const std::vector<llvm::Value *> &args, const std::vector<int> &attrs)
@@ -1075,6 +1114,69 @@ llvm::Value *llvm_sgn(llvm_state &s, llvm::Value *val)
     return builder.CreateSub(icmp0, icmp1);
 }
 
+// Add the double-length values (x_hi, x_lo) and (y_hi, y_lo),
+// using the same algorithm as the dfloat class.
+// NOTE: the fast math flags must be cleared in the builder
+// before invoking this function.
+std::pair<llvm::Value *, llvm::Value *> llvm_dl_add(llvm_state &s, llvm::Value *x_hi, llvm::Value *x_lo,
+                                                    llvm::Value *y_hi, llvm::Value *y_lo)
+{
+    auto &builder = s.builder();
+
+    assert(!builder.getFastMathFlags().any());
+
+    auto *S = builder.CreateFAdd(x_hi, y_hi);
+    auto *T = builder.CreateFAdd(x_lo, y_lo);
+    auto *e = builder.CreateFSub(S, x_hi);
+    auto *f = builder.CreateFSub(T, x_lo);
+
+    auto *t1 = builder.CreateFSub(S, e);
+    t1 = builder.CreateFSub(x_hi, t1);
+    auto *s_ = builder.CreateFSub(y_hi, e);
+    s_ = builder.CreateFAdd(s_, t1);
+
+    t1 = builder.CreateFSub(T, f);
+    t1 = builder.CreateFSub(x_lo, t1);
+    auto *t = builder.CreateFSub(y_lo, f);
+    t = builder.CreateFAdd(t, t1);
+
+    s_ = builder.CreateFAdd(s_, T);
+    auto *H = builder.CreateFAdd(S, s_);
+    auto *h = builder.CreateFSub(S, H);
+    h = builder.CreateFAdd(h, s_);
+
+    h = builder.CreateFAdd(h, t);
+    e = builder.CreateFAdd(H, h);
+    f = builder.CreateFSub(H, e);
+    f = builder.CreateFAdd(f, h);
+
+    return {e, f};
+}
+
+// Multiply the double-length values (x_hi, x_lo) and (y_hi, y_lo).
+// NOTE: the fast math flags must be cleared in the builder
+// before invoking this function.
+// NOTE: the error-free product of the high parts is computed via fma, the cross
+// terms are then added to the error term and the result is normalised.
+std::pair<llvm::Value *, llvm::Value *> llvm_dl_mul(llvm_state &s, llvm::Value *x_hi, llvm::Value *x_lo,
+                                                    llvm::Value *y_hi, llvm::Value *y_lo)
+{
+    auto &builder = s.builder();
+
+    assert(!builder.getFastMathFlags().any());
+
+    auto *p = builder.CreateFMul(x_hi, y_hi);
+    auto *e = llvm_invoke_intrinsic(s, "llvm.fma", {p->getType()}, {x_hi, y_hi, builder.CreateFNeg(p)});
+
+    auto *cross = builder.CreateFAdd(builder.CreateFMul(x_hi, y_lo), builder.CreateFMul(x_lo, y_hi));
+    e = builder.CreateFAdd(e, cross);
+
+    auto *hi = builder.CreateFAdd(p, e);
+    auto *lo = builder.CreateFAdd(builder.CreateFSub(p, hi), e);
+
+    return {hi, lo};
+}
+
 namespace
 {
 
@@ -1368,6 +1470,20 @@ llvm::Function *llvm_add_inv_kep_E_impl(llvm_state &s, std::uint32_t batch_size)
         auto ig2 = builder.CreateFMul(tmp3, tmp4);
         auto ig = builder.CreateFAdd(ig1, ig2);
 
+        // For high eccentricities the series is a poor starter, and we switch
+        // to Danby's initial guess:
+        // E = M + 0.85*e*sign(pi - M).
+        // NOTE: M is in the [0, 2*pi) range here, thus sign(sin(M)) == sign(pi - M).
+        // NOTE: the choice is made lane by lane via a select, so that in batch mode
+        // no branching is needed.
+        auto pi_c = vector_splat(builder, codegen<T>(s, number{inv_kep_E_pi<T>}), batch_size);
+        auto c_085 = vector_splat(builder, codegen<T>(s, number{T(85) / 100}), batch_size);
+        auto danby_ig = builder.CreateFMul(c_085, ecc);
+        danby_ig = builder.CreateSelect(builder.CreateFCmpOLT(M, pi_c), builder.CreateFAdd(M, danby_ig),
+                                        builder.CreateFSub(M, danby_ig));
+        auto high_e = builder.CreateFCmpOGE(ecc, vector_splat(builder, codegen<T>(s, number{T(8) / 10}), batch_size));
+        ig = builder.CreateSelect(high_e, danby_ig, ig);
+
         // Make extra sure the initial guess is in the [0, 2*pi) range.
         auto lb = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
         auto ub = vector_splat(builder, codegen<T>(s, number{nextafter(2 * inv_kep_E_pi<T>, T(0))}), batch_size);
@@ -1404,10 +1520,9 @@ llvm::Function *llvm_add_inv_kep_E_impl(llvm_state &s, std::uint32_t batch_size)
         // Define the stopping condition functor.
         // NOTE: hard-code this for the time being.
         auto max_iter = builder.getInt32(50);
-        auto loop_cond = [&,
-                          // NOTE: tolerance is 4 * eps.
-                          tol = vector_splat(builder, codegen<T>(s, number{std::numeric_limits<T>::epsilon() * 4}),
-                                             batch_size)]() -> llvm::Value * {
+        // NOTE: tolerance is 4 * eps.
+        auto tol = vector_splat(builder, codegen<T>(s, number{std::numeric_limits<T>::epsilon() * 4}), batch_size);
+        auto loop_cond = [&]() -> llvm::Value * {
             auto c_cond = builder.CreateICmpULT(builder.CreateLoad(counter), max_iter);
 
             // Keep on iterating as long as abs(f(E)) > tol.
@@ -1420,12 +1535,22 @@ llvm::Function *llvm_add_inv_kep_E_impl(llvm_state &s, std::uint32_t batch_size)
         };
 
         // Run the loop.
-        llvm_while_loop(s, loop_cond, [&, one_c = vector_splat(builder, codegen<T>(s, number{1.}), batch_size)]() {
-            // Compute the new value.
+        llvm_while_loop(s, loop_cond, [&, one_c = vector_splat(builder, codegen<T>(s, number{1.}), batch_size),
+                                       zero_c = vector_splat(builder, codegen<T>(s, number{0.}), batch_size)]() {
+            // Compute the new value via Halley's method:
+            // E_new = E - f(E) / (f'(E) - f(E)*f''(E)/(2*f'(E))),
+            // with f'(E) = 1 - e*cos(E) and f''(E) = e*sin(E).
             auto old_val = builder.CreateLoad(retval);
-            auto new_val = builder.CreateFDiv(
-                builder.CreateLoad(fE), builder.CreateFSub(one_c, builder.CreateFMul(ecc, builder.CreateLoad(cos_E))));
-            new_val = builder.CreateFSub(old_val, new_val);
+            auto cur_fE = builder.CreateLoad(fE);
+            auto fpE = builder.CreateFSub(one_c, builder.CreateFMul(ecc, builder.CreateLoad(cos_E)));
+            auto fppE = builder.CreateFMul(ecc, builder.CreateLoad(sin_E));
+            auto h_den = builder.CreateFSub(
+                fpE, builder.CreateFDiv(builder.CreateFMul(cur_fE, fppE), builder.CreateFAdd(fpE, fpE)));
+            // NOTE: far from the root the Halley correction could produce a non-positive
+            // denominator. In such case, fall back to a Newton step (f'(E) is always
+            // positive for e < 1).
+            h_den = builder.CreateSelect(builder.CreateFCmpOGT(h_den, zero_c), h_den, fpE);
+            auto new_val = builder.CreateFSub(old_val, builder.CreateFDiv(cur_fE, h_den));
 
             // Bisect if new_val > ub.
             // NOTE: '>' is fine here, ub is the maximum allowed value.
@@ -1444,6 +1569,13 @@ llvm::Function *llvm_add_inv_kep_E_impl(llvm_state &s, std::uint32_t batch_size)
                                    builder.CreateFAdd(old_val, lb)),
                 new_val);
 
+            // In batch mode, freeze the lanes which have already converged, so
+            // that the batch result does not depend on the other lanes and it is
+            // thus identical to the scalar result.
+            if (batch_size > 1u) {
+                new_val = builder.CreateSelect(builder.CreateFCmpOGT(llvm_abs(s, cur_fE), tol), new_val, old_val);
+            }
+
             // Store the new value.
             builder.CreateStore(new_val, retval);
 
@@ -1583,5 +1715,5 @@ llvm::Value *llvm_add_bc_array_f128(llvm_state &s, std::uint32_t n)
 // is exceeded.
 extern "C" HEYOKA_DLL_PUBLIC void heyoka_inv_kep_E_max_iter() noexcept
 {
-    heyoka::detail::get_logger()->warn("iteration limit exceeded while solving the elliptic inverse Kepler equation");
+    heyoka::detail::hot_warn("iteration limit exceeded while solving the elliptic inverse Kepler equation");
 }
@@ -10,6 +10,9 @@
 // SPDLOG_ACTIVE_LEVEL definition.
 #include <heyoka/detail/logging_impl.hpp>
 
+#include <cstddef>
+#include <vector>
+
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 namespace heyoka::detail
@@ -37,4 +40,77 @@ spdlog::logger *get_logger()
     return ret.get();
 }
 
+namespace
+{
+
+// A hot-path warning, with its number of occurrences.
+struct hot_warn_entry {
+    const char *fmt_str;
+    std::size_t count;
+};
+
+// The nesting level of the warn_aggregation_scope
+// objects in the current thread.
+thread_local unsigned hot_warn_depth = 0;
+
+// The hot-path warnings emitted in the current
+// thread within the current scope.
+// NOTE: the number of distinct hot-path warnings
+// is small, hence a vector with linear search.
+thread_local std::vector<hot_warn_entry> hot_warn_entries;
+
+} // namespace
+
+// Returns true if the warning must be logged.
+bool hot_warn_first(const char *fmt_str) noexcept
+{
+    if (hot_warn_depth == 0u) {
+        return true;
+    }
+
+    for (auto &e : hot_warn_entries) {
+        if (e.fmt_str == fmt_str) {
+            ++e.count;
+
+            return false;
+        }
+    }
+
+    // LCOV_EXCL_START
+    try {
+        hot_warn_entries.push_back({fmt_str, 1});
+    } catch (...) {
+        // NOTE: if we cannot track the warning,
+        // it will just be logged again.
+    }
+    // LCOV_EXCL_STOP
+
+    return true;
+}
+
+warn_aggregation_scope::warn_aggregation_scope() noexcept
+{
+    ++hot_warn_depth;
+}
+
+warn_aggregation_scope::~warn_aggregation_scope()
+{
+    if (--hot_warn_depth != 0u) {
+        return;
+    }
+
+    for (const auto &e : hot_warn_entries) {
+        if (e.count > 1u) {
+            // LCOV_EXCL_START
+            try {
+                get_logger()->warn("the warning \"{}\" was emitted {} more time(s)", e.fmt_str, e.count - 1u);
+            } catch (...) {
+            }
+            // LCOV_EXCL_STOP
+        }
+    }
+
+    hot_warn_entries.clear();
+}
+
 } // namespace heyoka::detail
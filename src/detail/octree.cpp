@@ -0,0 +1,170 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <heyoka/detail/octree.hpp>
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// Maximum depth of the octree.
+// NOTE: this guarantees termination in case
+// of coincident points.
+constexpr unsigned octree_max_depth = 64;
+
+// Recursive construction of the node n_idx, whose cell has
+// lower corner lb and edge length size.
+void octree_build_node(octree &t, const std::vector<std::array<double, 3>> &pos, const std::vector<double> &masses,
+                       std::size_t n_idx, const std::array<double, 3> &lb, double size, unsigned depth)
+{
+    const auto begin = t.nodes[n_idx].begin, end = t.nodes[n_idx].end;
+    assert(begin < end);
+
+    // Compute the total mass and the centre of mass.
+    double mass = 0;
+    std::array<double, 3> com{};
+    for (auto i = begin; i < end; ++i) {
+        const auto idx = t.perm[i];
+
+        mass += masses[idx];
+        for (std::size_t c = 0; c < 3u; ++c) {
+            com[c] += masses[idx] * pos[idx][c];
+        }
+    }
+    for (auto &c : com) {
+        c /= mass;
+    }
+
+    t.nodes[n_idx].size = size;
+    t.nodes[n_idx].mass = mass;
+    t.nodes[n_idx].com = com;
+
+    if (end - begin == 1u || depth == octree_max_depth || !(size > 0)) {
+        // Leaf node.
+        return;
+    }
+
+    // Compute the octant of each point and sort the points in the cell accordingly.
+    const auto half = size / 2;
+    auto octant = [&](std::size_t idx) {
+        unsigned retval = 0;
+        for (std::size_t c = 0; c < 3u; ++c) {
+            if (pos[idx][c] >= lb[c] + half) {
+                retval += 1u << c;
+            }
+        }
+
+        return retval;
+    };
+
+    std::stable_sort(t.perm.begin() + static_cast<std::ptrdiff_t>(begin),
+                     t.perm.begin() + static_cast<std::ptrdiff_t>(end),
+                     [&](std::size_t a, std::size_t b) { return octant(a) < octant(b); });
+
+    // Create the children.
+    for (auto i = begin; i < end;) {
+        const auto oct = octant(t.perm[i]);
+
+        auto j = i + 1u;
+        while (j < end && octant(t.perm[j]) == oct) {
+            ++j;
+        }
+
+        std::array<double, 3> c_lb{};
+        for (std::size_t c = 0; c < 3u; ++c) {
+            c_lb[c] = lb[c] + ((oct >> c) & 1u ? half : 0.);
+        }
+
+        // NOTE: add the node and record its index before recursing,
+        // as the recursion will invalidate references into t.nodes.
+        const auto c_idx = t.nodes.size();
+        t.nodes.emplace_back();
+        t.nodes.back().begin = i;
+        t.nodes.back().end = j;
+        t.nodes[n_idx].children.push_back(c_idx);
+
+        octree_build_node(t, pos, masses, c_idx, c_lb, half, depth + 1u);
+
+        i = j;
+    }
+}
+
+void octree_walk_impl(const octree &t, std::size_t n_idx, const std::function<bool(const octree_node &)> &vis)
+{
+    const auto &nd = t.nodes[n_idx];
+
+    if (vis(nd)) {
+        for (auto c_idx : nd.children) {
+            octree_walk_impl(t, c_idx, vis);
+        }
+    }
+}
+
+} // namespace
+
+octree build_octree(const std::vector<std::array<double, 3>> &pos, const std::vector<double> &masses)
+{
+    assert(pos.size() == masses.size());
+    assert(!pos.empty());
+    assert(std::all_of(masses.begin(), masses.end(), [](double m) { return m > 0 && std::isfinite(m); }));
+
+    octree retval;
+    retval.perm.resize(pos.size());
+    std::iota(retval.perm.begin(), retval.perm.end(), std::size_t(0));
+
+    // Determine the bounding cube.
+    std::array<double, 3> lb{}, ub{};
+    for (std::size_t c = 0; c < 3u; ++c) {
+        lb[c] = std::numeric_limits<double>::infinity();
+        ub[c] = -std::numeric_limits<double>::infinity();
+
+        for (const auto &p : pos) {
+            lb[c] = std::min(lb[c], p[c]);
+            ub[c] = std::max(ub[c], p[c]);
+        }
+    }
+
+    double size = 0;
+    for (std::size_t c = 0; c < 3u; ++c) {
+        size = std::max(size, ub[c] - lb[c]);
+    }
+
+    // NOTE: enlarge slightly the cube so that
+    // all points are strictly inside.
+    size *= 1 + 1E-12;
+
+    retval.nodes.emplace_back();
+    retval.nodes.back().begin = 0;
+    retval.nodes.back().end = pos.size();
+
+    octree_build_node(retval, pos, masses, 0, lb, size, 0);
+
+    return retval;
+}
+
+void octree_walk(const octree &t, const std::function<bool(const octree_node &)> &vis)
+{
+    assert(!t.nodes.empty());
+
+    octree_walk_impl(t, 0, vis);
+}
+
+} // namespace heyoka::detail
@@ -0,0 +1,488 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <sched.h>
+
+#endif
+
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/thread_pool.hpp>
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// The number of threads set via set_num_threads()
+// (zero for the default value).
+std::atomic<unsigned> global_n_threads{0};
+
+// The executor set via set_executor()
+// (null if no executor is set).
+// NOTE: the executor is stored in a shared pointer
+// so that it can be fetched cheaply in parallel_for()
+// and replaced while in use by other threads.
+std::mutex global_executor_mutex;
+std::shared_ptr<const executor_t> global_executor;
+
+std::shared_ptr<const executor_t> fetch_executor()
+{
+    std::lock_guard lock(global_executor_mutex);
+
+    return global_executor;
+}
+
+#if defined(__linux__)
+
+// Helper to pin a worker thread of parallel_for() to a CPU.
+// The CPUs are chosen in order among those in which the calling
+// thread of parallel_for() is allowed to run.
+class thread_pinner
+{
+    bool m_active = false;
+    cpu_set_t m_orig{};
+    std::vector<int> m_cpus;
+
+public:
+    explicit thread_pinner(bool pin)
+    {
+        if (!pin || pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &m_orig) != 0) {
+            return;
+        }
+
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &m_orig)) {
+                m_cpus.push_back(c);
+            }
+        }
+
+        m_active = !m_cpus.empty();
+    }
+
+    // Pin the calling thread to the
+    // CPU assigned to the worker idx.
+    void pin(unsigned idx) const
+    {
+        if (!m_active) {
+            return;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(m_cpus[idx % m_cpus.size()], &set);
+
+        // NOTE: pinning is an optimisation,
+        // ignore the failures.
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+    }
+
+    // Restore the original affinity of the calling thread.
+    void restore() const
+    {
+        if (m_active) {
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &m_orig);
+        }
+    }
+};
+
+#else
+
+class thread_pinner
+{
+public:
+    explicit thread_pinner(bool) {}
+
+    void pin(unsigned) const {}
+    void restore() const {}
+};
+
+#endif
+
+} // namespace
+
+unsigned parallel_n_workers(std::size_t n, unsigned n_threads)
+{
+    if (n_threads == 0u) {
+        n_threads = get_num_threads();
+    }
+
+    return static_cast<unsigned>(std::min(static_cast<std::size_t>(n_threads), n));
+}
+
+void parallel_for(std::size_t n, unsigned n_threads, const std::function<void(std::size_t, std::size_t, unsigned)> &f,
+                  bool pin)
+{
+    const auto n_workers = parallel_n_workers(n, n_threads);
+
+    if (n_workers == 0u) {
+        // Nothing to do.
+        return;
+    }
+
+    // NOTE: split the range in chunks small enough
+    // to balance the workload among the threads,
+    // but large enough to keep the contention on
+    // the atomic counter low.
+    const auto chunk_size = std::max(n / (static_cast<std::size_t>(n_workers) * 8u), std::size_t(1));
+
+    std::atomic<std::size_t> next_begin(0);
+    std::atomic<bool> failed(false);
+
+    std::exception_ptr eptr;
+    std::mutex eptr_mutex;
+
+    // NOTE: the threads of an external executor
+    // are not pinned.
+    const auto ex = fetch_executor();
+    const thread_pinner pinner(pin && n_workers > 1u && !ex);
+
+    auto worker = [&](unsigned idx) {
+        pinner.pin(idx);
+
+        try {
+            while (!failed.load(std::memory_order_relaxed)) {
+                const auto b = next_begin.fetch_add(chunk_size, std::memory_order_relaxed);
+                if (b >= n) {
+                    break;
+                }
+
+                f(b, (n - b < chunk_size) ? n : b + chunk_size, idx);
+            }
+        } catch (...) {
+            std::lock_guard lock(eptr_mutex);
+
+            if (!eptr) {
+                eptr = std::current_exception();
+            }
+
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    if (n_workers == 1u) {
+        // Run in the calling thread.
+        worker(0);
+    } else if (ex) {
+        // NOTE: the workers do not throw, thus if the executor
+        // throws no worker is running anymore.
+        (*ex)(n_workers, worker);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(n_workers - 1u);
+
+        try {
+            for (unsigned i = 1; i < n_workers; ++i) {
+                threads.emplace_back(worker, i);
+            }
+        } catch (...) {
+            // LCOV_EXCL_START
+            // Thread creation failed, stop the threads
+            // already created before re-throwing.
+            failed.store(true, std::memory_order_relaxed);
+
+            for (auto &t : threads) {
+                t.join();
+            }
+
+            throw;
+            // LCOV_EXCL_STOP
+        }
+
+        // The calling thread acts as the first worker.
+        worker(0);
+        pinner.restore();
+
+        for (auto &t : threads) {
+            t.join();
+        }
+    }
+
+    if (eptr) {
+        std::rethrow_exception(eptr);
+    }
+}
+
+namespace
+{
+
+// A pool of persistent worker threads, used in pool_parallel_for().
+// The workers wait for new work items by spinning for a short time
+// before going to sleep on a condition variable. In this way, the latency
+// of back-to-back invocations (e.g., during the computation of
+// a jet of Taylor derivatives) is kept low. The number of workers
+// follows the value returned by get_num_threads().
+class worker_pool
+{
+    // Number of iterations of the spin-waiting loop.
+    static constexpr unsigned n_spin = 1000;
+
+    std::vector<std::thread> m_threads;
+    // Mutex/condvar used to wake up the sleeping workers.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // Mutex used to serialise the invocations.
+    std::mutex m_busy_mutex;
+    // The generation counter, incremented
+    // at each invocation.
+    std::atomic<std::uint64_t> m_gen{0};
+    // Stop flag (protected by m_mutex).
+    bool m_stop = false;
+
+    // The current work item.
+    const std::function<void(std::size_t, std::size_t)> *m_f = nullptr;
+    std::size_t m_n = 0, m_chunk_size = 0;
+    std::atomic<std::size_t> m_next_begin{0};
+    // Number of workers which have not yet completed
+    // the current work item.
+    std::atomic<unsigned> m_n_active{0};
+
+    void run_chunks()
+    {
+        while (true) {
+            const auto b = m_next_begin.fetch_add(m_chunk_size, std::memory_order_relaxed);
+            if (b >= m_n) {
+                break;
+            }
+
+            (*m_f)(b, (m_n - b < m_chunk_size) ? m_n : b + m_chunk_size);
+        }
+    }
+
+    // NOTE: last_gen is the value of the generation
+    // counter upon the creation of the worker.
+    void worker_loop(std::uint64_t last_gen)
+    {
+        while (true) {
+            // Spin-wait for a new work item.
+            auto new_gen = m_gen.load(std::memory_order_acquire);
+            for (unsigned i = 0; i < n_spin && new_gen == last_gen; ++i) {
+                std::this_thread::yield();
+                new_gen = m_gen.load(std::memory_order_acquire);
+            }
+
+            if (new_gen == last_gen) {
+                // No new work item, go to sleep.
+                std::unique_lock lock(m_mutex);
+                m_cv.wait(lock, [this, last_gen]() {
+                    return m_stop || m_gen.load(std::memory_order_acquire) != last_gen;
+                });
+
+                if (m_stop) {
+                    return;
+                }
+
+                new_gen = m_gen.load(std::memory_order_acquire);
+            }
+
+            last_gen = new_gen;
+
+            run_chunks();
+
+            m_n_active.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // Stop and join the workers.
+    void stop_workers() noexcept
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+
+        for (auto &t : m_threads) {
+            t.join();
+        }
+
+        m_threads.clear();
+        m_stop = false;
+    }
+
+    // Replace the workers with n_threads new workers.
+    // NOTE: this must be invoked while no work item is running.
+    void resize(unsigned n_threads) noexcept
+    {
+        stop_workers();
+
+        const auto cur_gen = m_gen.load(std::memory_order_relaxed);
+
+        // LCOV_EXCL_START
+        try {
+            for (unsigned i = 0; i < n_threads; ++i) {
+                m_threads.emplace_back([this, cur_gen]() { worker_loop(cur_gen); });
+            }
+        } catch (...) {
+            // NOTE: if thread creation fails, just
+            // proceed with the threads already created.
+        }
+        // LCOV_EXCL_STOP
+
+        m_n_requested = n_threads;
+    }
+
+    // Run the work item via an external executor.
+    static void run_executor(const executor_t &ex, std::size_t n,
+                             const std::function<void(std::size_t, std::size_t)> &f) noexcept
+    {
+        const auto n_workers = get_num_threads();
+        const auto chunk_size = std::max(n / (static_cast<std::size_t>(n_workers) * 4u), std::size_t(1));
+        std::atomic<std::size_t> next_begin{0};
+
+        ex(n_workers, [&](unsigned) {
+            while (true) {
+                const auto b = next_begin.fetch_add(chunk_size, std::memory_order_relaxed);
+                if (b >= n) {
+                    break;
+                }
+
+                f(b, (n - b < chunk_size) ? n : b + chunk_size);
+            }
+        });
+    }
+
+    // The number of workers requested in the last resize.
+    unsigned m_n_requested = 0;
+
+public:
+    worker_pool()
+    {
+        // NOTE: the calling thread participates in the
+        // computation, hence the -1.
+        resize(get_num_threads() - 1u);
+    }
+    ~worker_pool()
+    {
+        stop_workers();
+    }
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool(worker_pool &&) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+    worker_pool &operator=(worker_pool &&) = delete;
+
+    void run(std::size_t n, const std::function<void(std::size_t, std::size_t)> &f) noexcept
+    {
+        std::unique_lock busy_lock(m_busy_mutex, std::try_to_lock);
+
+        if (n >= 2u && busy_lock.owns_lock()) {
+            if (const auto ex = fetch_executor()) {
+                run_executor(*ex, n, f);
+
+                return;
+            }
+
+            // Adapt the number of workers, if needed.
+            if (const auto n_threads = get_num_threads() - 1u; n_threads != m_n_requested) {
+                resize(n_threads);
+            }
+        }
+
+        if (m_threads.empty() || n < 2u || !busy_lock.owns_lock()) {
+            // No workers available, or not enough work
+            // to justify the parallelisation: run serially.
+            if (n > 0u) {
+                f(0, n);
+            }
+
+            return;
+        }
+
+        const auto n_workers = static_cast<std::size_t>(m_threads.size()) + 1u;
+
+        // Setup the work item.
+        // NOTE: see parallel_for() for the choice of the chunk size.
+        m_f = &f;
+        m_n = n;
+        m_chunk_size = std::max(n / (n_workers * 4u), std::size_t(1));
+        m_next_begin.store(0, std::memory_order_relaxed);
+        m_n_active.store(static_cast<unsigned>(m_threads.size()), std::memory_order_relaxed);
+
+        // Signal the new work item to the workers.
+        {
+            // NOTE: the generation counter is incremented while holding the mutex
+            // in order to avoid lost wakeups for the sleeping workers.
+            std::lock_guard lock(m_mutex);
+            m_gen.fetch_add(1, std::memory_order_release);
+        }
+        m_cv.notify_all();
+
+        // Participate in the computation.
+        run_chunks();
+
+        // Wait for the workers to finish.
+        // NOTE: this is necessary as f is about
+        // to go out of scope.
+        while (m_n_active.load(std::memory_order_acquire) != 0u) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+} // namespace
+
+void pool_parallel_for(std::size_t n, const std::function<void(std::size_t, std::size_t)> &f) noexcept
+{
+    // NOTE: the pool is created on first use.
+    static worker_pool pool;
+
+    pool.run(n, f);
+}
+
+} // namespace heyoka::detail
+
+namespace heyoka
+{
+
+unsigned get_num_threads()
+{
+    const auto n_threads = detail::global_n_threads.load(std::memory_order_relaxed);
+
+    // NOTE: hardware_concurrency() may return zero
+    // if the value is not computable.
+    return n_threads == 0u ? std::max(std::thread::hardware_concurrency(), 1u) : n_threads;
+}
+
+void set_num_threads(unsigned n_threads)
+{
+    detail::global_n_threads.store(n_threads, std::memory_order_relaxed);
+}
+
+executor_t get_executor()
+{
+    const auto ex = detail::fetch_executor();
+
+    return ex ? *ex : executor_t{};
+}
+
+void set_executor(executor_t ex)
+{
+    auto new_ex = ex ? std::make_shared<const executor_t>(std::move(ex)) : nullptr;
+
+    std::lock_guard lock(detail::global_executor_mutex);
+
+    detail::global_executor = std::move(new_ex);
+}
+
+} // namespace heyoka
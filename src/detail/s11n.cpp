@@ -0,0 +1,388 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/detail/s11n.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka::detail
+{
+
+void s11n_check_read(const std::istream &is)
+{
+    if (!is) {
+        throw std::invalid_argument("Error reading from the input stream during deserialisation");
+    }
+}
+
+void s11n_check_write(const std::ostream &os)
+{
+    // LCOV_EXCL_START
+    if (!os) {
+        throw std::invalid_argument("Error writing to the output stream during serialisation");
+    }
+    // LCOV_EXCL_STOP
+}
+
+void s11n_save(std::ostream &os, const std::string &s)
+{
+    s11n_save_size(os, s.size());
+
+    os.write(s.data(), static_cast<std::streamsize>(s.size()));
+    s11n_check_write(os);
+}
+
+void s11n_load(std::istream &is, std::string &s)
+{
+    s.resize(s11n_load_size<std::string::size_type>(is));
+
+    is.read(s.data(), static_cast<std::streamsize>(s.size()));
+    s11n_check_read(is);
+}
+
+// The header consists of a name identifying the type
+// of the serialised object and of a version number.
+void s11n_save_header(std::ostream &os, const std::string &name, std::uint32_t version)
+{
+    s11n_save(os, name);
+    s11n_save(os, version);
+}
+
+void s11n_load_header(std::istream &is, const std::string &name, std::uint32_t version)
+{
+    std::string cur_name;
+    s11n_load(is, cur_name);
+
+    if (cur_name != name) {
+        throw std::invalid_argument(
+            "Invalid header detected during deserialisation: the expected object type is '{}', "
+            "but the type '{}' was found instead"_format(name, cur_name));
+    }
+
+    std::uint32_t cur_version = 0;
+    s11n_load(is, cur_version);
+
+    if (cur_version != version) {
+        throw std::invalid_argument(
+            "Invalid header detected during deserialisation: the expected version of the object '{}' is {}, "
+            "but the version {} was found instead"_format(name, version, cur_version));
+    }
+}
+
+namespace
+{
+
+// NOTE: these are the tags used to identify the alternatives
+// in the variants of expression and number. They are written
+// out explicitly in order to keep the serialised format stable
+// if the order of the alternatives in the variants changes.
+enum class expr_tag : std::uint8_t { num, var, func, par };
+enum class num_tag : std::uint8_t { dbl, ldbl, f128 };
+
+void s11n_save_number(std::ostream &os, const number &n)
+{
+    std::visit(
+        [&os](const auto &v) {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, double>) {
+                s11n_save(os, num_tag::dbl);
+                s11n_save(os, v);
+            } else if constexpr (std::is_same_v<type, long double>) {
+                s11n_save(os, num_tag::ldbl);
+                s11n_save(os, v);
+#if defined(HEYOKA_HAVE_REAL128)
+            } else if constexpr (std::is_same_v<type, mppp::real128>) {
+                s11n_save(os, num_tag::f128);
+                s11n_save(os, v.m_value);
+#endif
+            } else {
+                static_assert(always_false_v<type>, "Unhandled type.");
+            }
+        },
+        n.value());
+}
+
+number s11n_load_number(std::istream &is)
+{
+    num_tag tag{};
+    s11n_load(is, tag);
+
+    switch (tag) {
+        case num_tag::dbl: {
+            double x = 0;
+            s11n_load(is, x);
+            return number{x};
+        }
+        case num_tag::ldbl: {
+            long double x = 0;
+            s11n_load(is, x);
+            return number{x};
+        }
+#if defined(HEYOKA_HAVE_REAL128)
+        case num_tag::f128: {
+            mppp::real128 x;
+            s11n_load(is, x.m_value);
+            return number{x};
+        }
+#endif
+        default:
+            throw std::invalid_argument(
+                "Invalid number type tag {} detected during deserialisation"_format(static_cast<unsigned>(tag)));
+    }
+}
+
+// Factories for the functions that can be deserialised, keyed on the function name.
+// NOTE: binary_op is handled separately, as it needs to store the operator type.
+using func_factory_t = func (*)(std::vector<expression> &&);
+
+template <typename F, std::size_t NArgs>
+func s11n_make_func(std::vector<expression> &&args)
+{
+    if (args.size() != NArgs) {
+        throw std::invalid_argument("Invalid number of arguments detected during the deserialisation of a function: "
+                                    "{} argument(s) were expected, but {} were found"_format(NArgs, args.size()));
+    }
+
+    if constexpr (NArgs == 0u) {
+        return func{F{}};
+    } else if constexpr (NArgs == 1u) {
+        return func{F{std::move(args[0])}};
+    } else if constexpr (NArgs == 2u) {
+        return func{F{std::move(args[0]), std::move(args[1])}};
+    } else {
+        static_assert(NArgs == 3u);
+        return func{F{std::move(args[0]), std::move(args[1]), std::move(args[2])}};
+    }
+}
+
+// NOTE: the N-ary sum accepts any number of arguments.
+func s11n_make_sum(std::vector<expression> &&args)
+{
+    return func{sum_impl{std::move(args)}};
+}
+
+// NOTE: the polynomial accepts the argument followed
+// by any number (>= 3) of coefficients.
+func s11n_make_poly(std::vector<expression> &&args)
+{
+    if (args.empty()) {
+        throw std::invalid_argument(
+            "Invalid number of arguments detected during the deserialisation of a polynomial function: "
+            "at least 1 argument was expected, but 0 were found");
+    }
+
+    auto x = std::move(args[0]);
+    args.erase(args.begin());
+
+    return func{poly_impl{std::move(x), std::move(args)}};
+}
+
+const std::unordered_map<std::string, func_factory_t> &get_func_factories()
+{
+    static const std::unordered_map<std::string, func_factory_t> retval
+        = {{"acos", &s11n_make_func<acos_impl, 1>},   {"acosh", &s11n_make_func<acosh_impl, 1>},
+           {"asin", &s11n_make_func<asin_impl, 1>},   {"asinh", &s11n_make_func<asinh_impl, 1>},
+           {"atan", &s11n_make_func<atan_impl, 1>},   {"atanh", &s11n_make_func<atanh_impl, 1>},
+           {"cos", &s11n_make_func<cos_impl, 1>},     {"cosh", &s11n_make_func<cosh_impl, 1>},
+           {"erf", &s11n_make_func<erf_impl, 1>},     {"exp", &s11n_make_func<exp_impl, 1>},
+           {"kepE", &s11n_make_func<kepE_impl, 2>},   {"log", &s11n_make_func<log_impl, 1>},
+           {"neg", &s11n_make_func<neg_impl, 1>},     {"poly", &s11n_make_poly},
+           {"pow", &s11n_make_func<pow_impl, 2>},
+           {"sigmoid", &s11n_make_func<sigmoid_impl, 1>}, {"sin", &s11n_make_func<sin_impl, 1>},
+           {"sinh", &s11n_make_func<sinh_impl, 1>},   {"sqrt", &s11n_make_func<sqrt_impl, 1>},
+           {"square", &s11n_make_func<square_impl, 1>}, {"sum", &s11n_make_sum},
+           {"tan", &s11n_make_func<tan_impl, 1>},
+           {"tanh", &s11n_make_func<tanh_impl, 1>},   {"time", &s11n_make_func<time_impl, 0>},
+           {"tpoly", &s11n_make_func<tpoly_impl, 2>}, {"tpwpoly", &s11n_make_func<tpwpoly_impl, 3>}};
+
+    return retval;
+}
+
+void s11n_save_func(std::ostream &os, const func &f)
+{
+    const auto &name = f.get_name();
+
+    s11n_save(os, name);
+
+    if (const auto *bo = f.extract<binary_op>()) {
+        s11n_save(os, static_cast<std::uint8_t>(bo->op()));
+    } else if (f.extract<ext_func_impl>() == nullptr && get_func_factories().count(name) == 0u) {
+        throw std::invalid_argument("The function '{}' does not support serialisation"_format(name));
+    }
+
+    s11n_save_size(os, f.args().size());
+    for (const auto &arg : f.args()) {
+        s11n_save(os, arg);
+    }
+}
+
+func s11n_load_func(std::istream &is)
+{
+    std::string name;
+    s11n_load(is, name);
+
+    // Fetch the operator type, if needed.
+    std::uint8_t bo_type = 0;
+    if (name == "binary_op") {
+        s11n_load(is, bo_type);
+
+        if (bo_type > static_cast<std::uint8_t>(binary_op::type::div)) {
+            throw std::invalid_argument(
+                "Invalid binary operator type {} detected during deserialisation"_format(static_cast<unsigned>(bo_type)));
+        }
+    }
+
+    // Load the arguments.
+    std::vector<expression> args;
+    args.resize(s11n_load_size<decltype(args.size())>(is));
+    for (auto &arg : args) {
+        s11n_load(is, arg);
+    }
+
+    if (name == "binary_op") {
+        if (args.size() != 2u) {
+            throw std::invalid_argument("Invalid number of arguments detected during the deserialisation of a binary "
+                                        "operator: 2 arguments were expected, but {} were found"_format(args.size()));
+        }
+
+        return func{binary_op(static_cast<binary_op::type>(bo_type), std::move(args[0]), std::move(args[1]))};
+    }
+
+    // NOTE: the external functions are identified by the "ext:"
+    // prefix followed by the kernel name.
+    if (name.rfind("ext:", 0) == 0u) {
+        return func{ext_func_impl{name.substr(4), std::move(args)}};
+    }
+
+    const auto &ff = get_func_factories();
+    const auto it = ff.find(name);
+    if (it == ff.end()) {
+        throw std::invalid_argument("The function '{}' does not support deserialisation"_format(name));
+    }
+
+    return it->second(std::move(args));
+}
+
+} // namespace
+
+void s11n_save(std::ostream &os, const expression &e)
+{
+    std::visit(
+        [&os](const auto &v) {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, number>) {
+                s11n_save(os, expr_tag::num);
+                s11n_save_number(os, v);
+            } else if constexpr (std::is_same_v<type, variable>) {
+                s11n_save(os, expr_tag::var);
+                s11n_save(os, v.name());
+            } else if constexpr (std::is_same_v<type, func>) {
+                s11n_save(os, expr_tag::func);
+                s11n_save_func(os, v);
+            } else if constexpr (std::is_same_v<type, param>) {
+                s11n_save(os, expr_tag::par);
+                s11n_save(os, v.idx());
+            } else {
+                static_assert(always_false_v<type>, "Unhandled type.");
+            }
+        },
+        e.value());
+}
+
+void s11n_load(std::istream &is, expression &e)
+{
+    expr_tag tag{};
+    s11n_load(is, tag);
+
+    switch (tag) {
+        case expr_tag::num:
+            e = expression{s11n_load_number(is)};
+            break;
+        case expr_tag::var: {
+            std::string name;
+            s11n_load(is, name);
+            e = expression{variable{std::move(name)}};
+            break;
+        }
+        case expr_tag::func:
+            e = expression{s11n_load_func(is)};
+            break;
+        case expr_tag::par: {
+            std::uint32_t idx = 0;
+            s11n_load(is, idx);
+            e = expression{param{idx}};
+            break;
+        }
+        default:
+            throw std::invalid_argument(
+                "Invalid expression type tag {} detected during deserialisation"_format(static_cast<unsigned>(tag)));
+    }
+}
+
+void s11n_save(std::ostream &os, const taylor_dc_t &dc)
+{
+    s11n_save_size(os, dc.size());
+
+    for (const auto &[ex, deps] : dc) {
+        s11n_save(os, ex);
+        s11n_save(os, deps);
+    }
+}
+
+void s11n_load(std::istream &is, taylor_dc_t &dc)
+{
+    dc.resize(s11n_load_size<taylor_dc_t::size_type>(is));
+
+    for (auto &[ex, deps] : dc) {
+        s11n_load(is, ex);
+        s11n_load(is, deps);
+    }
+}
+
+} // namespace heyoka::detail
@@ -341,20 +341,105 @@ HEYOKA_DLL_PUBLIC double sleef_dummy_f(double x)
 #else
 
 #include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
 #include <string>
 
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Type.h>
 
+#if defined(__linux__) && defined(__x86_64__)
+
+#include <llvm/Support/DynamicLibrary.h>
+
+#endif
+
 #include <heyoka/detail/sleef.hpp>
+#include <heyoka/llvm_state.hpp>
 
 namespace heyoka::detail
 {
 
-// If heyoka is not configured with sleef support, sleef_function_name() will always return
-// an empty string.
-std::string sleef_function_name(llvm::LLVMContext &, const std::string &, llvm::Type *, std::uint32_t)
+namespace
+{
+
+#if defined(__linux__) && defined(__x86_64__)
+
+// Helper to check if the vector functions of glibc's libmvec
+// can be used as a replacement for sleef. libmvec can be disabled
+// at runtime by setting the HEYOKA_VECLIB environment variable
+// to "none".
+bool libmvec_available()
+{
+    static const bool retval = []() {
+        if (const auto *env_vl = std::getenv("HEYOKA_VECLIB"); env_vl != nullptr && std::string(env_vl) == "none") {
+            return false;
+        }
+
+        // NOTE: libmvec is not linked to heyoka, thus we need to load
+        // it in order for its symbols to be visible to the JIT.
+        return !llvm::sys::DynamicLibrary::LoadLibraryPermanently("libmvec.so.1");
+    }();
+
+    return retval;
+}
+
+// Fetch the name of the libmvec function implementing f for a SIMD vector
+// of s elements, if available. The names are mangled according to the x86
+// vector function ABI, where the ISA letter is 'b' for SSE, 'c' for AVX,
+// 'd' for AVX2 and 'e' for AVX-512, and each (vector) parameter
+// is encoded as 'v'. In single precision, the vector widths
+// are twice the double-precision ones.
+// NOTE: only the functions available since the first release of libmvec
+// (glibc 2.22) are used.
+std::string libmvec_function_name(const std::string &f, std::uint32_t s, bool single)
+{
+    const auto &features = get_target_features();
+
+    const auto lf = single ? 2u : 1u;
+
+    char isa = 0;
+    if (s == 8u * lf && features.avx512f) {
+        isa = 'e';
+    } else if (s == 4u * lf && features.avx2) {
+        isa = 'd';
+    } else if (s == 4u * lf && features.avx) {
+        isa = 'c';
+    } else if (s == 2u * lf && features.sse2) {
+        isa = 'b';
+    } else {
+        return "";
+    }
+
+    for (const auto *name : {"sin", "cos", "log", "exp", "pow"}) {
+        if (f == name) {
+            return std::string("_ZGV") + isa + "N" + std::to_string(s) + (f == "pow" ? "vv_" : "v_") + f
+                   + (single ? "f" : "");
+        }
+    }
+
+    return "";
+}
+
+#endif
+
+} // namespace
+
+// If heyoka is not configured with sleef support, sleef_function_name() will return
+// the name of a vector function from glibc's libmvec (if available), or an empty string.
+std::string sleef_function_name([[maybe_unused]] llvm::LLVMContext &c, [[maybe_unused]] const std::string &f,
+                                [[maybe_unused]] llvm::Type *t, [[maybe_unused]] std::uint32_t s)
 {
+#if defined(__linux__) && defined(__x86_64__)
+    if (libmvec_available()) {
+        if (t == llvm::Type::getDoubleTy(c)) {
+            return libmvec_function_name(f, s, false);
+        } else if (t == llvm::Type::getFloatTy(c)) {
+            return libmvec_function_name(f, s, true);
+        }
+    }
+#endif
+
     return "";
 }
 
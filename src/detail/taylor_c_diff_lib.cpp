@@ -0,0 +1,345 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+
+#include <boost/container_hash/hash.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalValue.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <heyoka/detail/logging_impl.hpp>
+#include <heyoka/detail/taylor_c_diff_lib.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// The key of a derivative function in the library. A derivative
+// function depends on:
+// - the floating-point type and the batch size,
+// - the number of u variables (which determines the layout of the diff array),
+// - the function, up to the indices of the u variables appearing
+//   as arguments (which are passed to the derivative function at runtime),
+// - the options of the llvm_state which influence the codegen and
+//   the optimisation.
+struct c_diff_lib_key {
+    std::type_index type;
+    std::uint32_t n_uvars;
+    std::uint32_t batch_size;
+    unsigned opt_level;
+    bool fast_math;
+    bool inline_functions;
+    bool slp_vectorize;
+    bool loop_vectorize;
+    std::string target_cpu;
+    func f;
+};
+
+bool operator==(const c_diff_lib_key &a, const c_diff_lib_key &b)
+{
+    return a.type == b.type && a.n_uvars == b.n_uvars && a.batch_size == b.batch_size && a.opt_level == b.opt_level
+           && a.fast_math == b.fast_math && a.inline_functions == b.inline_functions
+           && a.slp_vectorize == b.slp_vectorize && a.loop_vectorize == b.loop_vectorize
+           && a.target_cpu == b.target_cpu && a.f == b.f;
+}
+
+struct c_diff_lib_key_hasher {
+    std::size_t operator()(const c_diff_lib_key &k) const
+    {
+        auto seed = std::hash<std::type_index>{}(k.type);
+
+        boost::hash_combine(seed, k.n_uvars);
+        boost::hash_combine(seed, k.batch_size);
+        boost::hash_combine(seed, k.opt_level);
+        boost::hash_combine(seed, k.fast_math);
+        boost::hash_combine(seed, k.inline_functions);
+        boost::hash_combine(seed, k.slp_vectorize);
+        boost::hash_combine(seed, k.loop_vectorize);
+        boost::hash_combine(seed, k.target_cpu);
+        boost::hash_combine(seed, hash(k.f));
+
+        return seed;
+    }
+};
+
+// An entry in the library: the name of the derivative
+// function and the bitcode of the (optimised) module
+// containing it.
+struct c_diff_lib_entry {
+    std::string fname;
+    std::string bc;
+};
+
+// The library of derivative functions.
+// NOTE: the library is shared by all threads. Its total
+// size is capped, after which new functions are not added
+// anymore (but they are still generated on the fly).
+struct c_diff_lib {
+    std::shared_mutex mutex;
+    std::unordered_map<c_diff_lib_key, c_diff_lib_entry, c_diff_lib_key_hasher> map;
+    std::size_t size = 0;
+};
+
+constexpr std::size_t c_diff_lib_max_size = 64ull * 1024u * 1024u;
+
+c_diff_lib &get_c_diff_lib()
+{
+    static c_diff_lib ret;
+
+    return ret;
+}
+
+// Build the function stored in the key. This is a copy of f
+// in which the variables are replaced by u_0. If f has function
+// arguments (which never appear in a Taylor decomposition),
+// an empty optional is returned.
+std::optional<func> c_diff_lib_canonical_func(const func &f)
+{
+    auto retval = f;
+
+    for (auto [b, e] = retval.get_mutable_args_it(); b != e; ++b) {
+        if (std::holds_alternative<variable>(b->value())) {
+            *b = expression{variable{"u_0"}};
+        } else if (std::holds_alternative<func>(b->value())) {
+            return {};
+        }
+    }
+
+    return retval;
+}
+
+// Link the function fname from the bitcode bc into the module of s.
+llvm::Function *c_diff_lib_link(llvm_state &s, const std::string &fname, const std::string &bc)
+{
+    auto ret = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bc, fname), s.context());
+    // LCOV_EXCL_START
+    if (!ret) {
+        throw std::invalid_argument("Error parsing the bitcode of the Taylor derivative function '{}'. The full error "
+                                    "message:\n{}"_format(fname, llvm::toString(ret.takeError())));
+    }
+    // LCOV_EXCL_STOP
+
+    // NOTE: the derivative function has external linkage in the library
+    // module (so that it is not removed by the optimiser and not renamed
+    // by the linker), other functions and global variables in the library
+    // module which clash with the ones already in s are renamed by the linker.
+    // LCOV_EXCL_START
+    if (llvm::Linker::linkModules(s.module(), std::move(*ret))) {
+        throw std::invalid_argument("Error linking the Taylor derivative function '{}'"_format(fname));
+    }
+    // LCOV_EXCL_STOP
+
+    auto *f = s.module().getFunction(fname);
+    assert(f != nullptr);
+
+    // Restore the internal linkage.
+    f->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+    return f;
+}
+
+} // namespace
+
+template <typename T>
+llvm::Function *taylor_c_diff_lib_fetch(llvm_state &s, const func &f, std::uint32_t n_uvars, std::uint32_t batch_size)
+{
+    auto cf = c_diff_lib_canonical_func(f);
+    // LCOV_EXCL_START
+    if (!cf) {
+        return taylor_c_diff_func<T>(s, f, n_uvars, batch_size);
+    }
+    // LCOV_EXCL_STOP
+
+    c_diff_lib_key key{typeid(T),
+                       n_uvars,
+                       batch_size,
+                       s.opt_level(),
+                       s.fast_math(),
+                       s.inline_functions(),
+                       s.slp_vectorize(),
+                       s.loop_vectorize(),
+                       s.target_cpu(),
+                       std::move(*cf)};
+
+    auto &lib = get_c_diff_lib();
+
+    // Look into the library.
+    std::optional<c_diff_lib_entry> entry;
+    bool lib_full = false;
+    {
+        std::shared_lock lock(lib.mutex);
+
+        if (const auto it = lib.map.find(key); it != lib.map.end()) {
+            // NOTE: the function may have been linked into s already.
+            if (auto *retval = s.module().getFunction(it->second.fname)) {
+                return retval;
+            }
+
+            entry = it->second;
+        }
+
+        lib_full = lib.size >= c_diff_lib_max_size;
+    }
+
+    if (entry) {
+        return c_diff_lib_link(s, entry->fname, entry->bc);
+    }
+
+    if (lib_full) {
+        // NOTE: if the library is full, generate the
+        // function directly in s.
+        return taylor_c_diff_func<T>(s, f, n_uvars, batch_size);
+    }
+
+    // Library miss, generate the function in a separate
+    // llvm_state with the same options as s and optimise it.
+    // NOTE: this runs without holding the lock, so that other
+    // threads are not blocked.
+    llvm_state tmp{kw::mname = "heyoka_c_diff_lib",
+                   kw::opt_level = s.opt_level(),
+                   kw::fast_math = s.fast_math(),
+                   kw::inline_functions = s.inline_functions(),
+                   kw::target_cpu = s.target_cpu(),
+                   kw::slp_vectorize = s.slp_vectorize(),
+                   kw::loop_vectorize = s.loop_vectorize()};
+
+    // NOTE: the generators of the derivative functions restore
+    // the original insertion block of the builder when they are done,
+    // thus we need to set up one in a temporary function.
+    auto &builder = tmp.builder();
+    auto *dummy_f = llvm::Function::Create(llvm::FunctionType::get(builder.getVoidTy(), false),
+                                           llvm::Function::InternalLinkage, "heyoka_c_diff_lib_dummy", &tmp.module());
+    builder.SetInsertPoint(llvm::BasicBlock::Create(tmp.context(), "entry", dummy_f));
+
+    auto *tmp_f = taylor_c_diff_func<T>(tmp, key.f, n_uvars, batch_size);
+    std::string fname = tmp_f->getName().str();
+
+    builder.ClearInsertionPoint();
+    dummy_f->eraseFromParent();
+
+    // NOTE: with external linkage, the optimiser will neither remove
+    // the function nor alter its signature.
+    tmp_f->setLinkage(llvm::GlobalValue::ExternalLinkage);
+
+    tmp.optimise();
+
+    entry.emplace(c_diff_lib_entry{std::move(fname), tmp.get_bc()});
+
+    // Insert the function into the library.
+    // NOTE: if another thread inserted the same function
+    // in the meantime, the insertion does nothing.
+    {
+        std::unique_lock lock(lib.mutex);
+
+        if (lib.size + entry->bc.size() <= c_diff_lib_max_size) {
+            if (lib.map.try_emplace(std::move(key), *entry).second) {
+                lib.size += entry->bc.size();
+            }
+        } else {
+            get_logger()->debug("The library of Taylor derivative functions is full, the function '{}' is not added",
+                                entry->fname);
+        }
+    }
+
+    // NOTE: the function may be in s already if it was
+    // generated before the library was cleared.
+    if (auto *retval = s.module().getFunction(entry->fname)) {
+        return retval;
+    }
+
+    return c_diff_lib_link(s, entry->fname, entry->bc);
+}
+
+template HEYOKA_DLL_PUBLIC llvm::Function *taylor_c_diff_lib_fetch<double>(llvm_state &, const func &, std::uint32_t,
+                                                                           std::uint32_t);
+template HEYOKA_DLL_PUBLIC llvm::Function *taylor_c_diff_lib_fetch<long double>(llvm_state &, const func &,
+                                                                                std::uint32_t, std::uint32_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC llvm::Function *taylor_c_diff_lib_fetch<mppp::real128>(llvm_state &, const func &,
+                                                                                  std::uint32_t, std::uint32_t);
+
+#endif
+
+} // namespace heyoka::detail
+
+namespace heyoka
+{
+
+std::size_t taylor_c_diff_lib_size()
+{
+    auto &lib = detail::get_c_diff_lib();
+
+    std::shared_lock lock(lib.mutex);
+
+    return lib.map.size();
+}
+
+void taylor_c_diff_lib_clear()
+{
+    auto &lib = detail::get_c_diff_lib();
+
+    std::unique_lock lock(lib.mutex);
+
+    lib.map.clear();
+    lib.size = 0;
+}
+
+} // namespace heyoka
@@ -0,0 +1,282 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/encke.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/kepE.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Validate the orbital elements and mu for the Encke formulation.
+template <typename T>
+void encke_check_elems(const std::vector<T> &elems, T mu, T t0)
+{
+    using std::isfinite;
+
+    if (elems.size() != 6u) {
+        throw std::invalid_argument("The reference orbit of the Encke formulation must be described by 6 orbital "
+                                    "elements, but {} were provided instead"_format(elems.size()));
+    }
+
+    for (const auto &x : elems) {
+        if (!isfinite(x)) {
+            throw std::invalid_argument(
+                "A non-finite orbital element was passed to the Encke formulation of a two-body problem");
+        }
+    }
+
+    if (!(elems[0] > 0)) {
+        throw std::invalid_argument("The semi-major axis of the reference orbit of the Encke formulation must be "
+                                    "positive");
+    }
+
+    if (!(elems[1] >= 0) || !(elems[1] < 1)) {
+        throw std::invalid_argument("The eccentricity of the reference orbit of the Encke formulation must be in "
+                                    "the [0, 1) range");
+    }
+
+    if (!isfinite(mu) || !(mu > 0)) {
+        throw std::invalid_argument("The gravitational parameter of the Encke formulation must be finite and "
+                                    "positive");
+    }
+
+    if (!isfinite(t0)) {
+        throw std::invalid_argument("The reference epoch of the Encke formulation must be finite");
+    }
+}
+
+// The unit vectors P and Q of the perifocal frame
+// (pointing to the pericentre and 90 degrees ahead
+// in the orbital plane) in the reference frame.
+template <typename T>
+std::pair<std::array<T, 3>, std::array<T, 3>> encke_pq(const std::vector<T> &elems)
+{
+    using std::cos;
+    using std::sin;
+
+    const auto ci = cos(elems[2]), si = sin(elems[2]);
+    const auto cO = cos(elems[3]), sO = sin(elems[3]);
+    const auto co = cos(elems[4]), so = sin(elems[4]);
+
+    return {std::array<T, 3>{cO * co - sO * so * ci, sO * co + cO * so * ci, so * si},
+            std::array<T, 3>{-cO * so - sO * co * ci, -sO * so + cO * co * ci, co * si}};
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+std::vector<std::pair<expression, expression>> make_encke_sys(const std::vector<T> &elems, T mu, T t0,
+                                                              const std::vector<expression> &pert)
+{
+    using std::sqrt;
+
+    detail::encke_check_elems(elems, mu, t0);
+
+    if (!pert.empty() && pert.size() != 3u) {
+        throw std::invalid_argument("The perturbing acceleration of the Encke formulation must consist of 3 "
+                                    "components, but {} were provided instead"_format(pert.size()));
+    }
+
+    const auto names = std::vector<std::string>{"x", "y", "z", "vx", "vy", "vz"};
+    for (const auto &ex : pert) {
+        for (const auto &name : get_variables(ex)) {
+            if (std::find(names.begin(), names.end(), name) == names.end()) {
+                throw std::invalid_argument("The perturbing acceleration of the Encke formulation can depend only on "
+                                            "the Cartesian state variables, but the variable '{}' was "
+                                            "detected"_format(name));
+            }
+        }
+    }
+
+    const auto a = elems[0], e = elems[1];
+    const auto b = a * sqrt(1 - e * e);
+    const auto n = sqrt(mu / (a * a * a));
+    const auto [P, Q] = detail::encke_pq(elems);
+
+    // The reference orbit.
+    const auto E = kepE(e, elems[5] + n * (heyoka::time - t0));
+    const auto cE = cos(E), sE = sin(E);
+    // NOTE: the radius of the reference orbit is
+    // computed from the eccentric anomaly.
+    const auto rho_r = a * (1_dbl - e * cE);
+    const auto E_dot = n * pow(1_dbl - e * cE, T(-1));
+    const auto xp = a * (cE - e), yp = b * sE;
+    const auto vxp = -a * (E_dot * sE), vyp = b * (E_dot * cE);
+
+    std::array<expression, 3> rho, rho_v;
+    for (auto j = 0u; j < 3u; ++j) {
+        rho[j] = P[j] * xp + Q[j] * yp;
+        rho_v[j] = P[j] * vxp + Q[j] * vyp;
+    }
+
+    // The state variables.
+    auto [dx, dy, dz, dvx, dvy, dvz] = make_vars("dx", "dy", "dz", "dvx", "dvy", "dvz");
+    const auto delta = std::array{dx, dy, dz};
+
+    // The Cartesian position.
+    std::array<expression, 3> r;
+    for (auto j = 0u; j < 3u; ++j) {
+        r[j] = rho[j] + delta[j];
+    }
+
+    // Battin's f(q) = (1 + q)**(3/2) - 1, with
+    // q = delta.(delta - 2 r) / r**2.
+    const auto q = sum({dx * (dx - 2_dbl * r[0]), dy * (dy - 2_dbl * r[1]), dz * (dz - 2_dbl * r[2])})
+                   / sum({square(r[0]), square(r[1]), square(r[2])});
+    const auto fq = q * (3_dbl + 3_dbl * q + square(q)) / (1_dbl + pow(1_dbl + q, T(3) / 2));
+
+    // -mu / rho**3.
+    const auto mmu_rho3 = -mu * pow(rho_r, T(-3));
+
+    // The perturbing acceleration.
+    std::array<expression, 3> acc;
+    if (!pert.empty()) {
+        std::unordered_map<std::string, expression> smap;
+        for (auto j = 0u; j < 3u; ++j) {
+            smap.emplace(names[j], r[j]);
+        }
+        smap.emplace("vx", rho_v[0] + dvx);
+        smap.emplace("vy", rho_v[1] + dvy);
+        smap.emplace("vz", rho_v[2] + dvz);
+
+        for (auto j = 0u; j < 3u; ++j) {
+            acc[j] = subs(pert[j], smap);
+        }
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+    retval.push_back(prime(dx) = dvx);
+    retval.push_back(prime(dy) = dvy);
+    retval.push_back(prime(dz) = dvz);
+
+    const auto dv = std::array{dvx, dvy, dvz};
+    for (auto j = 0u; j < 3u; ++j) {
+        auto rhs = mmu_rho3 * (delta[j] + fq * r[j]);
+        if (!pert.empty()) {
+            rhs = std::move(rhs) + acc[j];
+        }
+
+        retval.push_back(prime(dv[j]) = std::move(rhs));
+    }
+
+    return retval;
+}
+
+template <typename T>
+std::vector<T> encke_ref_state(const std::vector<T> &elems, T mu, T t0, T t)
+{
+    using std::abs;
+    using std::cos;
+    using std::isfinite;
+    using std::sin;
+    using std::sqrt;
+
+    detail::encke_check_elems(elems, mu, t0);
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to encke_ref_state()");
+    }
+
+    const auto a = elems[0], e = elems[1];
+    const auto n = sqrt(mu / (a * a * a));
+    const auto M = elems[5] + n * (t - t0);
+
+    // Solve Kepler's equation via Newton iterations.
+    auto E = M + (sin(M) >= 0 ? e : -e) * T(85) / 100;
+    for (auto i = 0; i < 100; ++i) {
+        const auto dE = (E - e * sin(E) - M) / (1 - e * cos(E));
+        E -= dE;
+
+        if (!(abs(dE) > std::numeric_limits<T>::epsilon() * (1 + abs(E)))) {
+            break;
+        }
+    }
+
+    const auto cE = cos(E), sE = sin(E);
+    const auto b = a * sqrt(1 - e * e);
+    const auto E_dot = n / (1 - e * cE);
+    const auto xp = a * (cE - e), yp = b * sE;
+    const auto vxp = -a * E_dot * sE, vyp = b * E_dot * cE;
+
+    const auto [P, Q] = detail::encke_pq(elems);
+
+    return {P[0] * xp + Q[0] * yp,   P[1] * xp + Q[1] * yp,   P[2] * xp + Q[2] * yp,
+            P[0] * vxp + Q[0] * vyp, P[1] * vxp + Q[1] * vyp, P[2] * vxp + Q[2] * vyp};
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_encke_sys(const std::vector<double> &, double, double, const std::vector<expression> &);
+
+template HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_encke_sys(const std::vector<long double> &, long double, long double, const std::vector<expression> &);
+
+template HEYOKA_DLL_PUBLIC std::vector<double> encke_ref_state(const std::vector<double> &, double, double, double);
+
+template HEYOKA_DLL_PUBLIC std::vector<long double> encke_ref_state(const std::vector<long double> &, long double,
+                                                                    long double, long double);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::vector<std::pair<expression, expression>>
+make_encke_sys(const std::vector<mppp::real128> &, mppp::real128, mppp::real128, const std::vector<expression> &);
+
+template HEYOKA_DLL_PUBLIC std::vector<mppp::real128> encke_ref_state(const std::vector<mppp::real128> &,
+                                                                      mppp::real128, mppp::real128, mppp::real128);
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,465 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// Generic implementation of the ensemble propagation. n_out is the number of
+// state vectors that will be written in the output for each iteration, and
+// prop(ta, i, res) is the function that propagates the integrator ta for
+// the iteration i, writing the results into res.
+template <typename T, typename F>
+ensemble_res<T> ensemble_propagate_generic(const taylor_adaptive<T> &ta, std::size_t n_iter,
+                                           const ensemble_gen_t<T> &gen, unsigned n_threads, std::size_t n_out,
+                                           const F &prop, bool pin_threads)
+{
+    if (!gen) {
+        throw std::invalid_argument("Cannot run an ensemble propagation with an empty generator");
+    }
+
+    const auto dim = ta.get_dim();
+
+    // Overflow check for the size of the output state buffer.
+    // LCOV_EXCL_START
+    if (n_out != 0u && n_iter > std::numeric_limits<std::size_t>::max() / n_out / dim) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the output buffer "
+                                  "of an ensemble propagation");
+    }
+    // LCOV_EXCL_STOP
+
+    // Prepare the output buffers. Each iteration writes into its
+    // own slice, thus no synchronisation is needed.
+    ensemble_res<T> res;
+    res.states.resize(n_iter * n_out * dim, std::numeric_limits<T>::quiet_NaN());
+    res.times.resize(n_iter);
+    res.outcomes.resize(n_iter);
+    res.min_hs.resize(n_iter);
+    res.max_hs.resize(n_iter);
+    res.n_steps.resize(n_iter);
+
+    // The per-thread integrators. They are created lazily
+    // by the worker threads from the template integrator, so that the
+    // copies (which involve adding the compiled code to a new JIT
+    // instance) are performed in parallel. Each integrator is then
+    // re-used for all the iterations processed by its thread.
+    // NOTE: if the worker threads are pinned, the memory of each
+    // integrator is first touched on the NUMA node of its thread.
+    std::vector<std::optional<taylor_adaptive<T>>> tas(parallel_n_workers(n_iter, n_threads));
+
+    parallel_for(
+        n_iter, n_threads,
+        [&](std::size_t b, std::size_t e, unsigned idx) {
+            auto &opt_ta = tas[idx];
+            if (!opt_ta) {
+                opt_ta.emplace(ta);
+            }
+            auto &cur_ta = *opt_ta;
+
+            for (auto i = b; i < e; ++i) {
+                // Reset the integrator to the template.
+                std::copy(ta.get_state().begin(), ta.get_state().end(), cur_ta.get_state_data());
+                std::copy(ta.get_pars().begin(), ta.get_pars().end(), cur_ta.get_pars_data());
+                cur_ta.set_time(ta.get_time());
+                cur_ta.reset_cooldowns();
+
+                // Set up the initial conditions for the current iteration.
+                gen(cur_ta, i);
+
+                // Run the propagation.
+                prop(cur_ta, i, res);
+
+                res.times[i] = cur_ta.get_time();
+            }
+        },
+        pin_threads);
+
+    return res;
+}
+
+template <typename T>
+ensemble_res<T> ensemble_propagate_until_generic(const taylor_adaptive<T> &ta, T t, std::size_t n_iter,
+                                                 const ensemble_gen_t<T> &gen, unsigned n_threads,
+                                                 std::size_t max_steps, T max_delta_t,
+                                                 const std::function<bool(taylor_adaptive<T> &)> &cb, bool pin_threads)
+{
+    const auto dim = ta.get_dim();
+
+    return ensemble_propagate_generic(
+        ta, n_iter, gen, n_threads, 1, [&](taylor_adaptive<T> &cur_ta, std::size_t i, ensemble_res<T> &res) {
+            std::tie(res.outcomes[i], res.min_hs[i], res.max_hs[i], res.n_steps[i])
+                = cur_ta.propagate_until(t, kw::max_steps = max_steps, kw::max_delta_t = max_delta_t,
+                                         kw::callback = cb);
+
+            std::copy(cur_ta.get_state().begin(), cur_ta.get_state().end(), res.states.data() + i * dim);
+        },
+        pin_threads);
+}
+
+template <typename T>
+ensemble_res<T> ensemble_propagate_for_generic(const taylor_adaptive<T> &ta, T delta_t, std::size_t n_iter,
+                                               const ensemble_gen_t<T> &gen, unsigned n_threads,
+                                               std::size_t max_steps, T max_delta_t,
+                                               const std::function<bool(taylor_adaptive<T> &)> &cb, bool pin_threads)
+{
+    const auto dim = ta.get_dim();
+
+    return ensemble_propagate_generic(
+        ta, n_iter, gen, n_threads, 1, [&](taylor_adaptive<T> &cur_ta, std::size_t i, ensemble_res<T> &res) {
+            std::tie(res.outcomes[i], res.min_hs[i], res.max_hs[i], res.n_steps[i])
+                = cur_ta.propagate_for(delta_t, kw::max_steps = max_steps, kw::max_delta_t = max_delta_t,
+                                       kw::callback = cb);
+
+            std::copy(cur_ta.get_state().begin(), cur_ta.get_state().end(), res.states.data() + i * dim);
+        },
+        pin_threads);
+}
+
+template <typename T>
+ensemble_res<T> ensemble_propagate_grid_generic(const taylor_adaptive<T> &ta, const std::vector<T> &grid,
+                                                std::size_t n_iter, const ensemble_gen_t<T> &gen, unsigned n_threads,
+                                                std::size_t max_steps, T max_delta_t,
+                                                const std::function<bool(taylor_adaptive<T> &)> &cb, bool pin_threads)
+{
+    const auto dim = ta.get_dim();
+    const auto n_out = grid.size();
+
+    return ensemble_propagate_generic(
+        ta, n_iter, gen, n_threads, n_out, [&](taylor_adaptive<T> &cur_ta, std::size_t i, ensemble_res<T> &res) {
+            // NOTE: write the output directly into the result buffer. If the propagation
+            // stopped early, the values for the grid points which were not reached stay NaN.
+            auto [oc, min_h, max_h, n_steps, _]
+                = cur_ta.propagate_grid(grid, res.states.data() + i * n_out * dim, kw::max_steps = max_steps,
+                                        kw::max_delta_t = max_delta_t, kw::callback = cb);
+
+            res.outcomes[i] = oc;
+            res.min_hs[i] = min_h;
+            res.max_hs[i] = max_h;
+            res.n_steps[i] = n_steps;
+        },
+        pin_threads);
+}
+
+// Implementation of the batch mode ensemble propagation. ts are the final
+// times (absolute times if absolute is true, time intervals otherwise).
+template <typename T>
+ensemble_res<T> ensemble_propagate_batch_generic(const taylor_adaptive_batch<T> &ta, T ts, bool absolute,
+                                                 std::size_t n_iter, const ensemble_batch_gen_t<T> &gen,
+                                                 unsigned n_threads, std::size_t max_steps, T max_delta_t,
+                                                 bool pin_threads)
+{
+    using std::abs;
+    using std::isfinite;
+    using std::isnan;
+
+    if (!gen) {
+        throw std::invalid_argument("Cannot run an ensemble propagation with an empty generator");
+    }
+
+    if (!isfinite(ts)) {
+        throw std::invalid_argument("A non-finite time was passed to an ensemble propagation in batch mode");
+    }
+
+    if (isnan(max_delta_t)) {
+        throw std::invalid_argument("A nan max_delta_t was passed to an ensemble propagation in batch mode");
+    }
+
+    if (max_delta_t <= 0) {
+        throw std::invalid_argument("A non-positive max_delta_t was passed to an ensemble propagation in batch mode");
+    }
+
+    const auto dim = ta.get_dim();
+    const auto batch_size = ta.get_batch_size();
+    const auto n_pars = ta.get_pars().size() / batch_size;
+
+    // Overflow check for the size of the output state buffer.
+    // LCOV_EXCL_START
+    if (n_iter > std::numeric_limits<std::size_t>::max() / dim) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the output buffer "
+                                  "of an ensemble propagation");
+    }
+    // LCOV_EXCL_STOP
+
+    ensemble_res<T> res;
+    res.states.resize(n_iter * dim);
+    res.times.resize(n_iter);
+    res.outcomes.resize(n_iter);
+    res.min_hs.resize(n_iter);
+    res.max_hs.resize(n_iter);
+    res.n_steps.resize(n_iter);
+
+    // The initial state, parameters and time of the iterations
+    // are taken from the first batch element of the template.
+    std::vector<T> init_state(dim), init_pars(n_pars);
+    for (std::uint32_t j = 0; j < dim; ++j) {
+        init_state[j] = ta.get_state()[j * batch_size];
+    }
+    for (decltype(init_pars.size()) j = 0; j < n_pars; ++j) {
+        init_pars[j] = ta.get_pars()[j * batch_size];
+    }
+    const auto init_time = ta.get_time()[0];
+
+    // The index of the next iteration to be processed. The
+    // iterations are handed out one at a time to the batch
+    // elements of the per-thread integrators as soon as they
+    // become available.
+    std::atomic<std::size_t> next_iter(0);
+
+    // NOTE: the number of workers is computed on the number of
+    // batch-sized groups of iterations, so that we don't end up
+    // spawning threads with nothing to do.
+    const auto n_groups = n_iter / batch_size + static_cast<std::size_t>(n_iter % batch_size != 0u);
+    const auto n_workers = parallel_n_workers(n_groups, n_threads);
+
+    // NOTE: each work item of parallel_for() runs the propagation
+    // loop until there are no iterations left.
+    // NOTE: the integrators are copied in the worker threads, thus if the
+    // threads are pinned their memory is first touched on the NUMA node
+    // of the thread.
+    const auto worker = [&](std::size_t, std::size_t, unsigned) {
+        try {
+            auto cur_ta = ta;
+
+            // Per-batch element data: the index of the iteration being processed (or n_iter
+            // if the batch element is idle), the final time, the current time
+            // and the remaining time (both in double-length format, mirroring
+            // the time-keeping in the integrator) and the step counters.
+            std::vector<std::size_t> cur_iter(batch_size, n_iter), n_iters(batch_size);
+            std::vector<dfloat<T>> final_t(batch_size), cur_t(batch_size), rem_t(batch_size);
+            std::vector<T> max_dts(batch_size);
+
+            // Temporary buffers for the generator.
+            std::vector<T> st, pars;
+
+            // Helper to load the next iteration (if any) into the batch element i.
+            auto refill = [&](std::uint32_t i) {
+                const auto it = next_iter.fetch_add(1);
+
+                if (it >= n_iter) {
+                    // No more iterations. Keep the batch element idle.
+                    cur_iter[i] = n_iter;
+                    return;
+                }
+
+                st = init_state;
+                pars = init_pars;
+                auto t0 = init_time;
+
+                gen(st, pars, t0, it);
+
+                if (st.size() != dim || pars.size() != n_pars) {
+                    throw std::invalid_argument("The generator of an ensemble propagation in batch mode "
+                                                "changed the size of the state and/or parameter vectors");
+                }
+
+                if (!isfinite(t0)) {
+                    throw std::invalid_argument(
+                        "The generator of an ensemble propagation in batch mode produced a non-finite time");
+                }
+
+                // Copy the data into the batch element.
+                for (std::uint32_t j = 0; j < dim; ++j) {
+                    cur_ta.get_state_data()[j * batch_size + i] = st[j];
+                }
+                for (decltype(pars.size()) j = 0; j < n_pars; ++j) {
+                    cur_ta.get_pars_data()[j * batch_size + i] = pars[j];
+                }
+                cur_ta.set_time(i, t0);
+
+                cur_iter[i] = it;
+                n_iters[i] = 0;
+                res.n_steps[it] = 0;
+                res.min_hs[it] = std::numeric_limits<T>::infinity();
+                res.max_hs[it] = 0;
+
+                cur_t[i] = dfloat<T>(t0);
+                final_t[i] = absolute ? dfloat<T>(ts) : cur_t[i] + ts;
+                rem_t[i] = final_t[i] - cur_t[i];
+
+                if (!isfinite(final_t[i]) || !isfinite(rem_t[i])) {
+                    throw std::invalid_argument("The final time of an ensemble propagation in batch mode "
+                                                "results in an overflow condition");
+                }
+            };
+
+            // Helper to store the result of the iteration in the batch
+            // element i and to replace it with the next iteration.
+            auto finish = [&](std::uint32_t i, taylor_outcome oc) {
+                const auto it = cur_iter[i];
+
+                for (std::uint32_t j = 0; j < dim; ++j) {
+                    res.states[it * dim + j] = cur_ta.get_state()[j * batch_size + i];
+                }
+                res.times[it] = static_cast<T>(cur_t[i]);
+                res.outcomes[it] = oc;
+
+                refill(i);
+            };
+
+            for (std::uint32_t i = 0; i < batch_size; ++i) {
+                refill(i);
+            }
+
+            while (std::any_of(cur_iter.begin(), cur_iter.end(), [n_iter](auto it) { return it != n_iter; })) {
+                // Compute the max timesteps. Idle batch
+                // elements are integrated with a zero timestep.
+                for (std::uint32_t i = 0; i < batch_size; ++i) {
+                    if (cur_iter[i] == n_iter) {
+                        max_dts[i] = 0;
+                    } else {
+                        const auto dt_limit = rem_t[i] >= T(0) ? std::min(dfloat<T>(max_delta_t), rem_t[i])
+                                                               : std::max(dfloat<T>(-max_delta_t), rem_t[i]);
+                        max_dts[i] = static_cast<T>(dt_limit);
+                    }
+                }
+
+                cur_ta.step(max_dts);
+
+                for (std::uint32_t i = 0; i < batch_size; ++i) {
+                    const auto it = cur_iter[i];
+
+                    if (it == n_iter) {
+                        continue;
+                    }
+
+                    const auto [oc, h] = cur_ta.get_step_res()[i];
+
+                    // Update the time in double-length arithmetic,
+                    // exactly as done in the integrator.
+                    cur_t[i] = cur_t[i] + h;
+
+                    if (oc != taylor_outcome::success && oc != taylor_outcome::time_limit) {
+                        // Error condition.
+                        finish(i, oc);
+                        continue;
+                    }
+
+                    ++n_iters[i];
+
+                    // Update the step counter and min_h/max_h (see the
+                    // implementation of propagate_until() in the batch integrator).
+                    res.n_steps[it] += static_cast<std::size_t>(h != 0);
+                    if (oc == taylor_outcome::success) {
+                        const auto abs_h = abs(h);
+                        res.min_hs[it] = std::min(res.min_hs[it], abs_h);
+                        res.max_hs[it] = std::max(res.max_hs[it], abs_h);
+                    }
+
+                    if (h == static_cast<T>(rem_t[i])) {
+                        // Final time reached.
+                        finish(i, taylor_outcome::time_limit);
+                    } else if (n_iters[i] == max_steps) {
+                        // Step limit reached.
+                        finish(i, taylor_outcome::step_limit);
+                    } else {
+                        rem_t[i] = final_t[i] - cur_t[i];
+                    }
+                }
+            }
+        } catch (...) {
+            // Stop the other workers from picking up new iterations.
+            next_iter.store(n_iter);
+
+            throw;
+        }
+    };
+
+    parallel_for(n_workers, n_workers, worker, pin_threads);
+
+    return res;
+}
+
+} // namespace
+
+#define HEYOKA_ENSEMBLE_PROPAGATE_IMPL(T)                                                                              \
+    ensemble_res<T> ensemble_propagate_until_impl(const taylor_adaptive<T> &ta, T t, std::size_t n_iter,               \
+                                                  const ensemble_gen_t<T> &gen, unsigned n_threads,                    \
+                                                  std::size_t max_steps, T max_delta_t,                                \
+                                                  const std::function<bool(taylor_adaptive<T> &)> &cb,                 \
+                                                  bool pin_threads)                                                    \
+    {                                                                                                                  \
+        return ensemble_propagate_until_generic(ta, t, n_iter, gen, n_threads, max_steps, max_delta_t, cb,             \
+                                                pin_threads);                                                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    ensemble_res<T> ensemble_propagate_for_impl(const taylor_adaptive<T> &ta, T delta_t, std::size_t n_iter,           \
+                                                const ensemble_gen_t<T> &gen, unsigned n_threads,                      \
+                                                std::size_t max_steps, T max_delta_t,                                  \
+                                                const std::function<bool(taylor_adaptive<T> &)> &cb,                   \
+                                                bool pin_threads)                                                      \
+    {                                                                                                                  \
+        return ensemble_propagate_for_generic(ta, delta_t, n_iter, gen, n_threads, max_steps, max_delta_t, cb,         \
+                                              pin_threads);                                                            \
+    }                                                                                                                  \
+                                                                                                                       \
+    ensemble_res<T> ensemble_propagate_grid_impl(const taylor_adaptive<T> &ta, const std::vector<T> &grid,             \
+                                                 std::size_t n_iter, const ensemble_gen_t<T> &gen, unsigned n_threads, \
+                                                 std::size_t max_steps, T max_delta_t,                                 \
+                                                 const std::function<bool(taylor_adaptive<T> &)> &cb,                  \
+                                                 bool pin_threads)                                                     \
+    {                                                                                                                  \
+        return ensemble_propagate_grid_generic(ta, grid, n_iter, gen, n_threads, max_steps, max_delta_t, cb,           \
+                                               pin_threads);                                                           \
+    }                                                                                                                  \
+                                                                                                                       \
+    ensemble_res<T> ensemble_propagate_until_batch_impl(const taylor_adaptive_batch<T> &ta, T t, std::size_t n_iter,   \
+                                                        const ensemble_batch_gen_t<T> &gen, unsigned n_threads,        \
+                                                        std::size_t max_steps, T max_delta_t, bool pin_threads)        \
+    {                                                                                                                  \
+        return ensemble_propagate_batch_generic(ta, t, true, n_iter, gen, n_threads, max_steps, max_delta_t,           \
+                                                pin_threads);                                                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    ensemble_res<T> ensemble_propagate_for_batch_impl(const taylor_adaptive_batch<T> &ta, T delta_t,                   \
+                                                      std::size_t n_iter, const ensemble_batch_gen_t<T> &gen,          \
+                                                      unsigned n_threads, std::size_t max_steps, T max_delta_t,        \
+                                                      bool pin_threads)                                                \
+    {                                                                                                                  \
+        return ensemble_propagate_batch_generic(ta, delta_t, false, n_iter, gen, n_threads, max_steps, max_delta_t,    \
+                                                pin_threads);                                                          \
+    }
+
+HEYOKA_ENSEMBLE_PROPAGATE_IMPL(double)
+HEYOKA_ENSEMBLE_PROPAGATE_IMPL(long double)
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_ENSEMBLE_PROPAGATE_IMPL(mppp::real128)
+
+#endif
+
+#undef HEYOKA_ENSEMBLE_PROPAGATE_IMPL
+
+} // namespace heyoka::detail
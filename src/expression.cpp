@@ -8,15 +8,19 @@
 
 #include <heyoka/config.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <ostream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -34,16 +38,25 @@
 #endif
 
 #include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/logging_impl.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/exceptions.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/binary_op.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/log.hpp>
 #include <heyoka/math/neg.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sqrt.hpp>
 #include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
 #include <heyoka/math/time.hpp>
 #include <heyoka/math/tpoly.hpp>
+#include <heyoka/math/tpwpoly.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/param.hpp>
 #include <heyoka/variable.hpp>
@@ -150,7 +163,7 @@ detail::prime_wrapper prime(expression e)
     return std::visit(
         [&e](auto &v) -> detail::prime_wrapper {
             if constexpr (std::is_same_v<variable, detail::uncvref_t<decltype(v)>>) {
-                return detail::prime_wrapper{std::move(v.name())};
+                return detail::prime_wrapper{v.name()};
             } else {
                 using namespace fmt::literals;
 
@@ -745,9 +758,715 @@ expression diff(const expression &e, const expression &x)
         x.value());
 }
 
+namespace detail
+{
+
+namespace
+{
+
+// Implementation of the batched differentiation. vars_map maps the names of the
+// variables to their indices in the list of differentiation variables ('n_vars' in total), while
+// cache maps the functions already visited to their derivatives.
+std::vector<expression> diff_batch_impl(std::unordered_map<const void *, std::vector<expression>> &cache,
+                                        const std::unordered_map<std::string, std::vector<std::size_t>> &vars_map,
+                                        std::size_t n_vars, const expression &ex)
+{
+    return std::visit(
+        [&](const auto &v) -> std::vector<expression> {
+            using type = uncvref_t<decltype(v)>;
+
+            // NOTE: init the return value with zeroes.
+            std::vector<expression> retval(n_vars, expression{0.});
+
+            if constexpr (std::is_same_v<type, variable>) {
+                if (auto it = vars_map.find(v.name()); it != vars_map.end()) {
+                    for (auto idx : it->second) {
+                        retval[idx] = expression{1.};
+                    }
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                const auto *f_id = v.get_ptr();
+
+                if (auto it = cache.find(f_id); it != cache.end()) {
+                    return it->second;
+                }
+
+                using namespace fmt::literals;
+
+                const auto n_args = v.args().size();
+
+                // Compute the derivatives of the arguments, and determine
+                // which arguments depend on the differentiation variables.
+                std::vector<std::vector<expression>> d_args;
+                d_args.reserve(n_args);
+                std::vector<std::size_t> active;
+                for (decltype(v.args().size()) i = 0; i < n_args; ++i) {
+                    d_args.push_back(diff_batch_impl(cache, vars_map, n_vars, v.args()[i]));
+
+                    if (std::any_of(d_args.back().begin(), d_args.back().end(), [](const expression &d) {
+                            const auto *nptr = std::get_if<number>(&d.value());
+                            return nptr == nullptr || !is_zero(*nptr);
+                        })) {
+                        active.push_back(i);
+                    }
+                }
+
+                if (!active.empty()) {
+                    // Replace the active arguments with placeholder variables,
+                    // so that the partial derivatives of the function with respect
+                    // to its arguments can be computed via the function's own diff().
+                    // NOTE: the inactive function arguments are replaced as well,
+                    // in order to avoid traversing them in the function's diff().
+                    auto f_ph = v;
+                    std::unordered_map<std::string, expression> smap;
+                    {
+                        auto a_idx = active.begin();
+                        auto args_it = f_ph.get_mutable_args_it().first;
+                        for (decltype(v.args().size()) i = 0; i < n_args; ++i, ++args_it) {
+                            const auto is_active = a_idx != active.end() && *a_idx == i;
+                            if (is_active) {
+                                ++a_idx;
+                            }
+
+                            if (is_active || std::holds_alternative<func>(args_it->value())) {
+                                auto ph_name = "__heyoka_diff_arg_{}"_format(i);
+                                smap.emplace(ph_name, std::move(*args_it));
+                                *args_it = expression{variable{std::move(ph_name)}};
+                            }
+                        }
+                    }
+
+                    // Apply the chain rule.
+                    std::vector<std::vector<expression>> terms(n_vars);
+                    for (auto idx : active) {
+                        // Compute the partial derivative with respect to the current argument.
+                        const auto pd = subs(f_ph.diff("__heyoka_diff_arg_{}"_format(idx)), smap);
+
+                        for (std::size_t j = 0; j < n_vars; ++j) {
+                            const auto *nptr = std::get_if<number>(&d_args[idx][j].value());
+
+                            if (nptr == nullptr || !is_zero(*nptr)) {
+                                terms[j].push_back(pd * d_args[idx][j]);
+                            }
+                        }
+                    }
+
+                    for (std::size_t j = 0; j < n_vars; ++j) {
+                        retval[j] = pairwise_sum(std::move(terms[j]));
+                    }
+                }
+
+                [[maybe_unused]] const auto eres = cache.emplace(f_id, retval);
+                assert(eres.second);
+            }
+
+            return retval;
+        },
+        ex.value());
+}
+
+// Helper to build the map from variable names to indices
+// for the batched differentiation.
+std::unordered_map<std::string, std::vector<std::size_t>> diff_batch_vars_map(const std::vector<expression> &vars)
+{
+    std::unordered_map<std::string, std::vector<std::size_t>> retval;
+
+    for (decltype(vars.size()) i = 0; i < vars.size(); ++i) {
+        if (const auto *var_ptr = std::get_if<variable>(&vars[i].value())) {
+            retval[var_ptr->name()].push_back(i);
+        } else {
+            using namespace fmt::literals;
+
+            throw std::invalid_argument(
+                "Cannot differentiate an expression with respect to the non-variable expression '{}'"_format(
+                    vars[i]));
+        }
+    }
+
+    return retval;
+}
+
+} // namespace
+
+} // namespace detail
+
+std::vector<expression> diff(const expression &e, const std::vector<expression> &vars)
+{
+    const auto vars_map = detail::diff_batch_vars_map(vars);
+
+    std::unordered_map<const void *, std::vector<expression>> cache;
+
+    return detail::diff_batch_impl(cache, vars_map, vars.size(), e);
+}
+
+std::vector<expression> diff(const std::vector<expression> &v_ex, const std::vector<expression> &vars)
+{
+    const auto vars_map = detail::diff_batch_vars_map(vars);
+
+    std::unordered_map<const void *, std::vector<expression>> cache;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size() * vars.size());
+
+    for (const auto &ex : v_ex) {
+        auto grad = detail::diff_batch_impl(cache, vars_map, vars.size(), ex);
+        retval.insert(retval.end(), std::make_move_iterator(grad.begin()), std::make_move_iterator(grad.end()));
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Check if a and b share the same storage (for functions)
+// or are equal (for the other expression types).
+bool subs_same_node(const expression &a, const expression &b)
+{
+    const auto *fa = std::get_if<func>(&a.value());
+    const auto *fb = std::get_if<func>(&b.value());
+
+    if (fa != nullptr && fb != nullptr) {
+        return fa->get_ptr() == fb->get_ptr();
+    }
+
+    return fa == nullptr && fb == nullptr && a == b;
+}
+
+// Implementation of subs().
+// NOTE: func_map maps the functions already visited in the
+// input expression(s) to the results of the substitution, so that
+// subexpressions shared in the input are processed only once
+// (and they remain shared in the output). The functions which
+// do not depend on the substituted variables are returned
+// as they are, without copying their storage.
+expression subs_impl(std::unordered_map<const void *, expression> &func_map, const expression &ex,
+                     const std::unordered_map<std::string, expression> &smap)
+{
+    return std::visit(
+        [&](const auto &v) -> expression {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, func>) {
+                const auto *f_id = v.get_ptr();
+
+                if (auto it = func_map.find(f_id); it != func_map.end()) {
+                    return it->second;
+                }
+
+                // Run the substitution on the arguments.
+                std::vector<expression> new_args;
+                new_args.reserve(v.args().size());
+                bool changed = false;
+                for (const auto &arg : v.args()) {
+                    new_args.push_back(subs_impl(func_map, arg, smap));
+                    changed = changed || !subs_same_node(arg, new_args.back());
+                }
+
+                auto ret = ex;
+                if (changed) {
+                    // NOTE: the mutable access to the
+                    // arguments detaches the copy.
+                    auto f_copy = v;
+                    auto nb = new_args.begin();
+                    for (auto [b, e] = f_copy.get_mutable_args_it(); b != e; ++b, ++nb) {
+                        *b = std::move(*nb);
+                    }
+
+                    ret = expression{std::move(f_copy)};
+                }
+
+                [[maybe_unused]] const auto eres = func_map.emplace(f_id, ret);
+                assert(eres.second);
+
+                return ret;
+            } else if constexpr (std::is_same_v<type, variable>) {
+                if (auto it = smap.find(v.name()); it != smap.end()) {
+                    return it->second;
+                } else {
+                    return ex;
+                }
+            } else {
+                return ex;
+            }
+        },
+        ex.value());
+}
+
+} // namespace
+
+} // namespace detail
+
 expression subs(const expression &e, const std::unordered_map<std::string, expression> &smap)
 {
-    return std::visit([&smap](const auto &arg) { return subs(arg, smap); }, e.value());
+    std::unordered_map<const void *, expression> func_map;
+
+    return detail::subs_impl(func_map, e, smap);
+}
+
+std::vector<expression> subs(const std::vector<expression> &v_ex,
+                             const std::unordered_map<std::string, expression> &smap)
+{
+    std::unordered_map<const void *, expression> func_map;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size());
+
+    for (const auto &ex : v_ex) {
+        retval.push_back(detail::subs_impl(func_map, ex, smap));
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Implementation of intern().
+// NOTE: func_map maps the functions already visited in the
+// input expression(s) to their interned counterparts (so that subexpressions
+// shared in the input are processed only once), while ex_set contains
+// the interned functions.
+expression intern_impl(std::unordered_map<const void *, expression> &func_map,
+                       std::unordered_set<expression> &ex_set, const expression &ex)
+{
+    return std::visit(
+        [&](const auto &v) -> expression {
+            if constexpr (std::is_same_v<uncvref_t<decltype(v)>, func>) {
+                const auto *f_id = v.get_ptr();
+
+                if (auto it = func_map.find(f_id); it != func_map.end()) {
+                    return it->second;
+                }
+
+                // Intern the arguments.
+                auto f_copy = v;
+                for (auto [b, e] = f_copy.get_mutable_args_it(); b != e; ++b) {
+                    *b = intern_impl(func_map, ex_set, *b);
+                }
+
+                // Intern the function.
+                const auto &ret = *ex_set.insert(expression{std::move(f_copy)}).first;
+
+                [[maybe_unused]] const auto eres = func_map.emplace(f_id, ret);
+                assert(eres.second);
+
+                return ret;
+            } else {
+                return ex;
+            }
+        },
+        ex.value());
+}
+
+} // namespace
+
+} // namespace detail
+
+expression intern(const expression &ex)
+{
+    std::unordered_map<const void *, expression> func_map;
+    std::unordered_set<expression> ex_set;
+
+    return detail::intern_impl(func_map, ex_set, ex);
+}
+
+std::vector<expression> intern(const std::vector<expression> &v_ex)
+{
+    std::unordered_map<const void *, expression> func_map;
+    std::unordered_set<expression> ex_set;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size());
+
+    for (const auto &ex : v_ex) {
+        retval.push_back(detail::intern_impl(func_map, ex_set, ex));
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+bool simpl_is_negative(const number &n)
+{
+    return std::visit([](const auto &x) { return x < 0; }, n.value());
+}
+
+// NOTE: n is assumed to be integral.
+bool simpl_is_odd(const number &n)
+{
+    return std::visit(
+        [](const auto &x) {
+            using std::fmod;
+
+            return fmod(x, 2) != 0;
+        },
+        n.value());
+}
+
+// The state of the simplification pass. The results are cached
+// by the address of the function, so that subexpressions shared in
+// the input are simplified only once.
+struct simpl_state {
+    std::unordered_map<const void *, expression> func_map;
+};
+
+expression simplify_impl(simpl_state &, const expression &);
+
+// Helper to flatten the product ex**k into a list of factors, each
+// represented as a base raised to an exponent. The numerical factors
+// are multiplied into coeff.
+// NOTE: products are expanded ((x*y)**k -> x**k * y**k) and powers
+// are merged ((x**a)**k -> x**(a*k)) only if k is integral, which
+// is correct for any real x.
+void simpl_flatten_prod(std::vector<std::pair<expression, number>> &factors, number &coeff, const expression &ex,
+                        const number &k)
+{
+    if (const auto *num_ptr = std::get_if<number>(&ex.value())) {
+        if (is_one(k)) {
+            coeff = coeff * *num_ptr;
+            return;
+        }
+
+        if (is_negative_one(k) && !is_zero(*num_ptr)) {
+            coeff = coeff / *num_ptr;
+            return;
+        }
+    }
+
+    if (const auto *f_ptr = std::get_if<func>(&ex.value()); f_ptr != nullptr && is_integral(expression{k})) {
+        const auto &args = f_ptr->args();
+
+        if (const auto *bop = f_ptr->extract<binary_op>();
+            bop != nullptr && (bop->op() == binary_op::type::mul || bop->op() == binary_op::type::div)) {
+            simpl_flatten_prod(factors, coeff, args[0], k);
+            simpl_flatten_prod(factors, coeff, args[1], bop->op() == binary_op::type::mul ? k : -k);
+            return;
+        }
+
+        if (f_ptr->extract<neg_impl>() != nullptr) {
+            if (simpl_is_odd(k)) {
+                coeff = -coeff;
+            }
+            simpl_flatten_prod(factors, coeff, args[0], k);
+            return;
+        }
+
+        if (f_ptr->extract<square_impl>() != nullptr) {
+            simpl_flatten_prod(factors, coeff, args[0], k * number{2.});
+            return;
+        }
+
+        if (f_ptr->extract<sqrt_impl>() != nullptr) {
+            simpl_flatten_prod(factors, coeff, args[0], k * number{.5});
+            return;
+        }
+
+        if (f_ptr->extract<pow_impl>() != nullptr && std::holds_alternative<number>(args[1].value())) {
+            simpl_flatten_prod(factors, coeff, args[0], k * std::get<number>(args[1].value()));
+            return;
+        }
+    }
+
+    factors.emplace_back(ex, k);
+}
+
+// Helper to flatten the sum c*ex into a list of terms, each represented
+// as an expression multiplied by a numerical coefficient. The numerical
+// terms are added into cst. has_sum is set to true if ex contains
+// n-ary sums.
+// NOTE: products by numerical coefficients are not distributed
+// over the sums, as this would increase the number of operations.
+void simpl_flatten_sum(std::vector<std::pair<expression, number>> &terms, number &cst, bool &has_sum,
+                       const expression &ex, const number &c)
+{
+    if (const auto *num_ptr = std::get_if<number>(&ex.value())) {
+        cst = cst + c * *num_ptr;
+        return;
+    }
+
+    if (const auto *f_ptr = std::get_if<func>(&ex.value())) {
+        const auto &args = f_ptr->args();
+
+        if (const auto *bop = f_ptr->extract<binary_op>();
+            bop != nullptr && (bop->op() == binary_op::type::add || bop->op() == binary_op::type::sub)) {
+            simpl_flatten_sum(terms, cst, has_sum, args[0], c);
+            simpl_flatten_sum(terms, cst, has_sum, args[1], bop->op() == binary_op::type::add ? c : -c);
+            return;
+        }
+
+        if (f_ptr->extract<neg_impl>() != nullptr) {
+            simpl_flatten_sum(terms, cst, has_sum, args[0], -c);
+            return;
+        }
+
+        if (f_ptr->extract<sum_impl>() != nullptr) {
+            has_sum = true;
+            for (const auto &arg : args) {
+                simpl_flatten_sum(terms, cst, has_sum, arg, c);
+            }
+            return;
+        }
+    }
+
+    terms.emplace_back(ex, c);
+}
+
+bool simpl_is_prod(const func &f)
+{
+    if (const auto *bop = f.extract<binary_op>()) {
+        return bop->op() == binary_op::type::mul || bop->op() == binary_op::type::div;
+    }
+
+    return f.extract<square_impl>() != nullptr || f.extract<sqrt_impl>() != nullptr
+           || (f.extract<pow_impl>() != nullptr && std::holds_alternative<number>(f.args()[1].value()));
+}
+
+bool simpl_is_sum(const func &f)
+{
+    if (const auto *bop = f.extract<binary_op>()) {
+        return bop->op() == binary_op::type::add || bop->op() == binary_op::type::sub;
+    }
+
+    return f.extract<neg_impl>() != nullptr || f.extract<sum_impl>() != nullptr;
+}
+
+// Simplify a product: the factors with equal bases are merged.
+expression simplify_prod(simpl_state &st, const expression &ex)
+{
+    std::vector<std::pair<expression, number>> raw_factors;
+    number coeff{1.};
+    simpl_flatten_prod(raw_factors, coeff, ex, number{1.});
+
+    // Simplify the bases and merge the exponents.
+    // NOTE: the factors are kept in the order
+    // in which they first appear.
+    std::vector<std::pair<expression, number>> factors;
+    std::unordered_map<expression, decltype(factors.size())> f_idx;
+    for (auto &[b, k] : raw_factors) {
+        auto sb = simplify_impl(st, b);
+
+        if (const auto *num_ptr = std::get_if<number>(&sb.value())) {
+            if (is_one(k)) {
+                coeff = coeff * *num_ptr;
+                continue;
+            }
+
+            if (is_negative_one(k) && !is_zero(*num_ptr)) {
+                coeff = coeff / *num_ptr;
+                continue;
+            }
+        }
+
+        if (const auto it = f_idx.find(sb); it != f_idx.end()) {
+            factors[it->second].second = factors[it->second].second + k;
+        } else {
+            f_idx.emplace(sb, factors.size());
+            factors.emplace_back(std::move(sb), k);
+        }
+    }
+
+    if (is_zero(coeff)) {
+        return 0_dbl;
+    }
+
+    // Build the numerator and the denominator.
+    std::vector<expression> num, den;
+    for (auto &[b, k] : factors) {
+        if (is_zero(k)) {
+            continue;
+        }
+
+        if (simpl_is_negative(k)) {
+            den.push_back(pow(std::move(b), expression{-k}));
+        } else {
+            num.push_back(pow(std::move(b), expression{k}));
+        }
+    }
+
+    auto ret = num.empty() ? expression{coeff}
+                           : (is_negative_one(coeff) ? -pairwise_prod(std::move(num))
+                                                      : expression{coeff} * pairwise_prod(std::move(num)));
+
+    if (!den.empty()) {
+        ret = std::move(ret) / pairwise_prod(std::move(den));
+    }
+
+    return ret;
+}
+
+// Simplify a sum: the terms which differ only by
+// a numerical coefficient are collected.
+expression simplify_sum(simpl_state &st, const expression &ex)
+{
+    std::vector<std::pair<expression, number>> raw_terms;
+    number cst{0.};
+    bool has_sum = false;
+    simpl_flatten_sum(raw_terms, cst, has_sum, ex, number{1.});
+
+    // Simplify the terms, split them into a numerical
+    // coefficient and a symbolic part and collect
+    // the symbolic parts.
+    std::vector<std::pair<expression, number>> terms;
+    std::unordered_map<expression, decltype(terms.size())> t_idx;
+    for (auto &[t, c] : raw_terms) {
+        auto st_ex = simplify_impl(st, t);
+        auto cur_c = c;
+
+        if (const auto *num_ptr = std::get_if<number>(&st_ex.value())) {
+            cst = cst + cur_c * *num_ptr;
+            continue;
+        }
+
+        // NOTE: the symbolic part is copied before being assigned
+        // to st_ex, as it is stored within st_ex.
+        if (const auto *f_ptr = std::get_if<func>(&st_ex.value())) {
+            const auto *bop = f_ptr->extract<binary_op>();
+
+            if (bop != nullptr && bop->op() == binary_op::type::mul
+                && std::holds_alternative<number>(bop->lhs().value())) {
+                cur_c = cur_c * std::get<number>(bop->lhs().value());
+                auto tmp = bop->rhs();
+                st_ex = std::move(tmp);
+            } else if (f_ptr->extract<neg_impl>() != nullptr) {
+                cur_c = -cur_c;
+                auto tmp = f_ptr->args()[0];
+                st_ex = std::move(tmp);
+            }
+        }
+
+        if (const auto it = t_idx.find(st_ex); it != t_idx.end()) {
+            terms[it->second].second = terms[it->second].second + cur_c;
+        } else {
+            t_idx.emplace(st_ex, terms.size());
+            terms.emplace_back(std::move(st_ex), cur_c);
+        }
+    }
+
+    std::vector<expression> ret;
+    for (auto &[t, c] : terms) {
+        if (is_zero(c)) {
+            continue;
+        }
+
+        if (is_one(c)) {
+            ret.push_back(std::move(t));
+        } else if (is_negative_one(c)) {
+            ret.push_back(-std::move(t));
+        } else {
+            ret.push_back(expression{c} * std::move(t));
+        }
+    }
+
+    if (!is_zero(cst)) {
+        ret.emplace_back(cst);
+    }
+
+    if (ret.empty()) {
+        return 0_dbl;
+    }
+
+    // NOTE: if the input contained n-ary sums, build an n-ary sum,
+    // otherwise the number of operations would increase.
+    return has_sum ? sum(std::move(ret)) : pairwise_sum(std::move(ret));
+}
+
+expression simplify_impl(simpl_state &st, const expression &ex)
+{
+    const auto *f_ptr = std::get_if<func>(&ex.value());
+
+    if (f_ptr == nullptr) {
+        return ex;
+    }
+
+    const auto *f_id = f_ptr->get_ptr();
+
+    if (const auto it = st.func_map.find(f_id); it != st.func_map.end()) {
+        return it->second;
+    }
+
+    expression ret;
+    if (simpl_is_prod(*f_ptr)) {
+        ret = simplify_prod(st, ex);
+    } else if (simpl_is_sum(*f_ptr)) {
+        ret = simplify_sum(st, ex);
+    } else {
+        // Simplify the arguments.
+        auto f_copy = *f_ptr;
+        for (auto [b, e] = f_copy.get_mutable_args_it(); b != e; ++b) {
+            *b = simplify_impl(st, *b);
+        }
+
+        ret = expression{std::move(f_copy)};
+    }
+
+    [[maybe_unused]] const auto eres = st.func_map.emplace(f_id, ret);
+    assert(eres.second);
+
+    return ret;
+}
+
+// Count the number of distinct function nodes in v_ex. This
+// is an estimate of the number of u variables in the Taylor decomposition.
+std::size_t simpl_count_funcs(const std::vector<expression> &v_ex)
+{
+    std::unordered_set<expression> funcs;
+
+    auto impl = [&funcs](const auto &self, const expression &ex) -> void {
+        if (const auto *f_ptr = std::get_if<func>(&ex.value())) {
+            if (funcs.insert(ex).second) {
+                for (const auto &arg : f_ptr->args()) {
+                    self(self, arg);
+                }
+            }
+        }
+    };
+
+    for (const auto &ex : v_ex) {
+        impl(impl, ex);
+    }
+
+    return funcs.size();
+}
+
+} // namespace
+
+} // namespace detail
+
+expression simplify(const expression &ex)
+{
+    return simplify(std::vector<expression>{ex})[0];
+}
+
+std::vector<expression> simplify(const std::vector<expression> &v_ex)
+{
+    detail::simpl_state st;
+
+    std::vector<expression> retval;
+    retval.reserve(v_ex.size());
+
+    for (const auto &ex : v_ex) {
+        retval.push_back(detail::simplify_impl(st, ex));
+    }
+
+    auto *logger = detail::get_logger();
+    if (logger->should_log(spdlog::level::debug)) {
+        logger->debug("expression simplification - number of distinct functions before: {}, after: {}",
+                      detail::simpl_count_funcs(v_ex), detail::simpl_count_funcs(retval));
+    }
+
+    return retval;
 }
 
 namespace detail
@@ -898,6 +1617,526 @@ void update_grad_dbl(std::unordered_map<std::string, double> &grad, const expres
         e.value());
 }
 
+namespace detail
+{
+
+namespace
+{
+
+// Flatten the expression ex into a list of nodes, in the
+// same (depth-first, pre-order) numbering used by compute_connections().
+void batch_flatten(std::vector<const expression *> &nodes, const expression &ex)
+{
+    nodes.push_back(&ex);
+
+    if (const auto *f_ptr = std::get_if<func>(&ex.value())) {
+        for (const auto &arg : f_ptr->args()) {
+            batch_flatten(nodes, arg);
+        }
+    }
+}
+
+// View on the children of a node in the CSR layout.
+struct csr_row {
+    const std::size_t *ptr;
+    std::size_t n;
+
+    std::size_t size() const
+    {
+        return n;
+    }
+    std::size_t operator[](std::size_t j) const
+    {
+        return ptr[j];
+    }
+};
+
+// Helpers to fetch the children of the node k
+// from the node connections.
+const std::vector<std::size_t> &conn_row(const std::vector<std::vector<std::size_t>> &node_connections,
+                                         std::size_t k)
+{
+    return node_connections[k];
+}
+
+csr_row conn_row(const connections_csr &csr, std::size_t k)
+{
+    return csr_row{csr.indices.data() + csr.offsets[k], csr.offsets[k + 1u] - csr.offsets[k]};
+}
+
+// Helpers to fetch the number of nodes
+// from the node connections.
+std::size_t conn_n_nodes(const std::vector<std::vector<std::size_t>> &node_connections)
+{
+    return node_connections.size();
+}
+
+std::size_t conn_n_nodes(const connections_csr &csr)
+{
+    if (csr.offsets.empty() || csr.offsets.front() != 0u || csr.offsets.back() != csr.indices.size()
+        || !std::is_sorted(csr.offsets.begin(), csr.offsets.end())) {
+        throw std::invalid_argument("Invalid CSR node connections detected: the offsets are inconsistent with the "
+                                    "indices");
+    }
+
+    return csr.offsets.size() - 1u;
+}
+
+// Helper to flatten ex and to check the consistency
+// of the flattened tree with the connections.
+template <typename C>
+std::vector<const expression *> batch_flatten_check(const expression &ex, const C &node_connections)
+{
+    using namespace fmt::literals;
+
+    std::vector<const expression *> nodes;
+    batch_flatten(nodes, ex);
+
+    const auto n_nodes = conn_n_nodes(node_connections);
+    if (nodes.size() != n_nodes) {
+        throw std::invalid_argument(
+            "Inconsistent node connections detected in a batch evaluation: the expression has {} node(s), "
+            "but the connections refer to {} node(s)"_format(nodes.size(), n_nodes));
+    }
+
+    return nodes;
+}
+
+// Helpers to fetch the pointer to the values of
+// the variable name from an evaluation map.
+const double *batch_var_ptr(const std::unordered_map<std::string, std::vector<double>> &map, const std::string &name)
+{
+    const auto it = map.find(name);
+    if (it == map.end()) {
+        throw std::invalid_argument("Cannot update the node output for the variable '" + name
+                                    + "' because it is missing from the evaluation map");
+    }
+
+    return it->second.data();
+}
+
+const double *batch_var_ptr(const std::unordered_map<std::string, double> &map, const std::string &name)
+{
+    const auto it = map.find(name);
+    if (it == map.end()) {
+        throw std::invalid_argument("Cannot update the node output for the variable '" + name
+                                    + "' because it is missing from the evaluation map");
+    }
+
+    return &it->second;
+}
+
+// Deduce the number of samples from the evaluation map of a batch evaluation.
+std::size_t batch_n_samples(const std::unordered_map<std::string, std::vector<double>> &map)
+{
+    using namespace fmt::literals;
+
+    if (map.empty()) {
+        throw std::invalid_argument("Cannot deduce the number of samples of a batch evaluation from an empty map");
+    }
+
+    const auto n_samples = map.begin()->second.size();
+
+    for (const auto &[name, values] : map) {
+        if (values.size() != n_samples) {
+            throw std::invalid_argument("Inconsistent number of samples detected in a batch evaluation: the variable "
+                                        "'{}' has {} sample(s), but {} sample(s) were expected"_format(
+                                            name, values.size(), n_samples));
+        }
+    }
+
+    return n_samples;
+}
+
+// Sweep over the nodes (from the leaves to the root) for the
+// computation of the node values of a batch evaluation.
+// NOTE: the node values are stored in node-major order, i.e.,
+// the value of the node k for the sample i is at index k * n_samples + i.
+template <typename Map, typename C>
+void batch_values_sweep(std::vector<double> &vals, const std::vector<const expression *> &nodes, const Map &map,
+                        const C &node_connections, std::size_t n_samples)
+{
+    const auto n_nodes = nodes.size();
+
+    std::vector<double> args_buf;
+
+    for (auto k = n_nodes; k-- > 0u;) {
+        auto *out = vals.data() + k * n_samples;
+
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, number>) {
+                    std::fill(out, out + n_samples, std::visit([](const auto &x) { return static_cast<double>(x); },
+                                                               v.value()));
+                } else if constexpr (std::is_same_v<type, variable>) {
+                    const auto *src = batch_var_ptr(map, v.name());
+                    std::copy(src, src + n_samples, out);
+                } else if constexpr (std::is_same_v<type, param>) {
+                    throw not_implemented_error("Batch evaluation of the node values not implemented for param");
+                } else {
+                    const auto &conns = conn_row(node_connections, k);
+                    assert(conns.size() == v.args().size());
+
+                    auto arg = [&](std::size_t j) -> const double * { return vals.data() + conns[j] * n_samples; };
+
+                    auto unary = [&](auto op) {
+                        const auto *a = arg(0);
+                        for (std::size_t i = 0; i < n_samples; ++i) {
+                            out[i] = op(a[i]);
+                        }
+                    };
+
+                    if (const auto *bop = v.template extract<binary_op>()) {
+                        const auto *a = arg(0), *b = arg(1);
+
+                        switch (bop->op()) {
+                            case binary_op::type::add:
+                                for (std::size_t i = 0; i < n_samples; ++i) {
+                                    out[i] = a[i] + b[i];
+                                }
+                                break;
+                            case binary_op::type::sub:
+                                for (std::size_t i = 0; i < n_samples; ++i) {
+                                    out[i] = a[i] - b[i];
+                                }
+                                break;
+                            case binary_op::type::mul:
+                                for (std::size_t i = 0; i < n_samples; ++i) {
+                                    out[i] = a[i] * b[i];
+                                }
+                                break;
+                            default:
+                                assert(bop->op() == binary_op::type::div);
+                                for (std::size_t i = 0; i < n_samples; ++i) {
+                                    out[i] = a[i] / b[i];
+                                }
+                        }
+                    } else if (v.template extract<neg_impl>() != nullptr) {
+                        unary([](double x) { return -x; });
+                    } else if (v.template extract<square_impl>() != nullptr) {
+                        unary([](double x) { return x * x; });
+                    } else if (v.template extract<sqrt_impl>() != nullptr) {
+                        unary([](double x) { return std::sqrt(x); });
+                    } else if (v.template extract<exp_impl>() != nullptr) {
+                        unary([](double x) { return std::exp(x); });
+                    } else if (v.template extract<log_impl>() != nullptr) {
+                        unary([](double x) { return std::log(x); });
+                    } else if (v.template extract<sin_impl>() != nullptr) {
+                        unary([](double x) { return std::sin(x); });
+                    } else if (v.template extract<cos_impl>() != nullptr) {
+                        unary([](double x) { return std::cos(x); });
+                    } else {
+                        // Generic case: evaluate the function
+                        // one sample at a time.
+                        args_buf.resize(conns.size());
+                        for (std::size_t i = 0; i < n_samples; ++i) {
+                            for (decltype(conns.size()) j = 0; j < conns.size(); ++j) {
+                                args_buf[j] = arg(j)[i];
+                            }
+                            out[i] = eval_num_dbl(v, args_buf);
+                        }
+                    }
+                }
+            },
+            nodes[k]->value());
+    }
+}
+
+// Helpers to fetch the pointer to the gradient of the
+// variable name in grad, creating it if needed.
+double *batch_grad_ptr(std::unordered_map<std::string, std::vector<double>> &grad, const std::string &name,
+                       std::size_t n_samples)
+{
+    using namespace fmt::literals;
+
+    auto &g = grad[name];
+    if (g.empty()) {
+        g.resize(n_samples);
+    } else if (g.size() != n_samples) {
+        throw std::invalid_argument("Inconsistent number of samples detected in the gradient of the variable '{}': "
+                                    "{} sample(s) were expected, but {} were found"_format(name, n_samples, g.size()));
+    }
+
+    return g.data();
+}
+
+double *batch_grad_ptr(std::unordered_map<std::string, double> &grad, const std::string &name,
+                       [[maybe_unused]] std::size_t n_samples)
+{
+    assert(n_samples == 1u);
+
+    return &grad[name];
+}
+
+// Sweep over the nodes (from the root to the leaves) for the
+// computation of the gradient of a batch evaluation, given the
+// node values computed by batch_values_sweep().
+template <typename G, typename C>
+void batch_grad_sweep(G &grad, const std::vector<const expression *> &nodes, const std::vector<double> &node_values,
+                      const C &node_connections, std::size_t n_samples)
+{
+    const auto n_nodes = nodes.size();
+
+    // The adjoints of the nodes, in node-major order.
+    std::vector<double> adj(node_values.size());
+    std::fill(adj.begin(), adj.begin() + static_cast<std::ptrdiff_t>(n_samples), 1.);
+
+    std::vector<double> args_buf;
+
+    // NOTE: in the pre-order numbering the parents come
+    // before their children, thus the adjoint of a node is complete
+    // by the time the node is visited.
+    for (decltype(nodes.size()) k = 0; k < n_nodes; ++k) {
+        const auto *a_k = adj.data() + k * n_samples;
+
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    auto *g = batch_grad_ptr(grad, v.name(), n_samples);
+
+                    for (std::size_t i = 0; i < n_samples; ++i) {
+                        g[i] += a_k[i];
+                    }
+                } else if constexpr (std::is_same_v<type, param>) {
+                    throw not_implemented_error("Batch evaluation of the gradient not implemented for param");
+                } else if constexpr (std::is_same_v<type, func>) {
+                    const auto &conns = conn_row(node_connections, k);
+                    assert(conns.size() == v.args().size());
+
+                    const auto *val_k = node_values.data() + k * n_samples;
+                    auto arg = [&](std::size_t j) -> const double * {
+                        return node_values.data() + conns[j] * n_samples;
+                    };
+                    auto arg_adj = [&](std::size_t j) { return adj.data() + conns[j] * n_samples; };
+
+                    // Propagate the adjoint to the argument j, given a function
+                    // computing the partial derivative for the sample i.
+                    auto propagate = [&](std::size_t j, auto partial) {
+                        auto *a_c = arg_adj(j);
+                        for (std::size_t i = 0; i < n_samples; ++i) {
+                            a_c[i] += a_k[i] * partial(i);
+                        }
+                    };
+
+                    if (const auto *bop = v.template extract<detail::binary_op>()) {
+                        const auto *a = arg(0), *b = arg(1);
+
+                        switch (bop->op()) {
+                            case detail::binary_op::type::add:
+                                propagate(0, [](std::size_t) { return 1.; });
+                                propagate(1, [](std::size_t) { return 1.; });
+                                break;
+                            case detail::binary_op::type::sub:
+                                propagate(0, [](std::size_t) { return 1.; });
+                                propagate(1, [](std::size_t) { return -1.; });
+                                break;
+                            case detail::binary_op::type::mul:
+                                propagate(0, [b](std::size_t i) { return b[i]; });
+                                propagate(1, [a](std::size_t i) { return a[i]; });
+                                break;
+                            default:
+                                assert(bop->op() == detail::binary_op::type::div);
+                                // NOTE: d(a/b)/da = 1/b, d(a/b)/db = -(a/b)/b.
+                                propagate(0, [b](std::size_t i) { return 1. / b[i]; });
+                                propagate(1, [b, val_k](std::size_t i) { return -val_k[i] / b[i]; });
+                        }
+                    } else if (v.template extract<detail::neg_impl>() != nullptr) {
+                        propagate(0, [](std::size_t) { return -1.; });
+                    } else if (v.template extract<detail::square_impl>() != nullptr) {
+                        const auto *a = arg(0);
+                        propagate(0, [a](std::size_t i) { return 2. * a[i]; });
+                    } else if (v.template extract<detail::sqrt_impl>() != nullptr) {
+                        propagate(0, [val_k](std::size_t i) { return .5 / val_k[i]; });
+                    } else if (v.template extract<detail::exp_impl>() != nullptr) {
+                        propagate(0, [val_k](std::size_t i) { return val_k[i]; });
+                    } else if (v.template extract<detail::log_impl>() != nullptr) {
+                        const auto *a = arg(0);
+                        propagate(0, [a](std::size_t i) { return 1. / a[i]; });
+                    } else if (v.template extract<detail::sin_impl>() != nullptr) {
+                        const auto *a = arg(0);
+                        propagate(0, [a](std::size_t i) { return std::cos(a[i]); });
+                    } else if (v.template extract<detail::cos_impl>() != nullptr) {
+                        const auto *a = arg(0);
+                        propagate(0, [a](std::size_t i) { return -std::sin(a[i]); });
+                    } else {
+                        // Generic case: compute the partial derivatives
+                        // one sample at a time.
+                        args_buf.resize(conns.size());
+                        for (decltype(conns.size()) j = 0; j < conns.size(); ++j) {
+                            propagate(j, [&](std::size_t i) {
+                                for (decltype(conns.size()) l = 0; l < conns.size(); ++l) {
+                                    args_buf[l] = arg(l)[i];
+                                }
+
+                                return deval_num_dbl(v, args_buf, j);
+                            });
+                        }
+                    }
+                }
+            },
+            nodes[k]->value());
+    }
+}
+
+// Implementation of compute_node_values_batch_dbl() and of
+// the CSR overload of compute_node_values_dbl().
+template <typename Map, typename C>
+std::vector<double> batch_node_values_impl(const expression &e, const Map &map, const C &node_connections,
+                                           std::size_t n_samples)
+{
+    const auto nodes = batch_flatten_check(e, node_connections);
+
+    // LCOV_EXCL_START
+    if (n_samples > 0u && nodes.size() > std::numeric_limits<std::size_t>::max() / n_samples) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the buffer of node values");
+    }
+    // LCOV_EXCL_STOP
+
+    std::vector<double> node_values(nodes.size() * n_samples);
+    batch_values_sweep(node_values, nodes, map, node_connections, n_samples);
+
+    return node_values;
+}
+
+// Implementation of update_grad_batch_dbl().
+template <typename C>
+void batch_update_grad_impl(std::unordered_map<std::string, std::vector<double>> &grad, const expression &e,
+                            const std::vector<double> &node_values, const C &node_connections)
+{
+    using namespace fmt::literals;
+
+    const auto nodes = batch_flatten_check(e, node_connections);
+    const auto n_nodes = nodes.size();
+
+    if (node_values.size() % n_nodes != 0u) {
+        throw std::invalid_argument("The size of the buffer of node values ({}) is not a multiple of the "
+                                    "number of nodes ({})"_format(node_values.size(), n_nodes));
+    }
+
+    batch_grad_sweep(grad, nodes, node_values, node_connections, node_values.size() / n_nodes);
+}
+
+} // namespace
+
+} // namespace detail
+
+// Batched counterpart of compute_node_values_dbl(). The values of the input variables
+// are read from map (all the variables must have the same number of samples), and the
+// node values are returned in a node-major buffer with shape (n_nodes, n_samples).
+std::vector<double> compute_node_values_batch_dbl(const expression &e,
+                                                  const std::unordered_map<std::string, std::vector<double>> &map,
+                                                  const std::vector<std::vector<std::size_t>> &node_connections)
+{
+    return detail::batch_node_values_impl(e, map, node_connections, detail::batch_n_samples(map));
+}
+
+// Batched counterpart of compute_grad_dbl(). The gradient for each sample is
+// returned as a map from the names of the variables to the vectors of partial derivatives.
+std::unordered_map<std::string, std::vector<double>>
+compute_grad_batch_dbl(const expression &e, const std::unordered_map<std::string, std::vector<double>> &map,
+                       const std::vector<std::vector<std::size_t>> &node_connections)
+{
+    std::unordered_map<std::string, std::vector<double>> grad;
+    const auto node_values = compute_node_values_batch_dbl(e, map, node_connections);
+    update_grad_batch_dbl(grad, e, node_values, node_connections);
+
+    return grad;
+}
+
+// Accumulate into grad the gradient of e, given the node values
+// computed by compute_node_values_batch_dbl(). The gradient is
+// computed via a single reverse sweep over the nodes.
+void update_grad_batch_dbl(std::unordered_map<std::string, std::vector<double>> &grad, const expression &e,
+                           const std::vector<double> &node_values,
+                           const std::vector<std::vector<std::size_t>> &node_connections)
+{
+    detail::batch_update_grad_impl(grad, e, node_values, node_connections);
+}
+
+// Build the CSR layout of the node connections of e. The offsets are computed
+// in a forward sweep over the flattened nodes, while the indices of the children
+// are computed in a backward sweep from the sizes of the subtrees (in the pre-order
+// numbering, the first child of the node k is k + 1, and each subsequent
+// child follows the subtree of the previous one).
+connections_csr compute_connections_csr(const expression &e)
+{
+    std::vector<const expression *> nodes;
+    detail::batch_flatten(nodes, e);
+    const auto n_nodes = nodes.size();
+
+    auto n_args = [&nodes](std::size_t k) -> std::size_t {
+        const auto *f_ptr = std::get_if<func>(&nodes[k]->value());
+        return f_ptr == nullptr ? 0 : f_ptr->args().size();
+    };
+
+    connections_csr retval;
+    retval.offsets.resize(n_nodes + 1u);
+    for (std::size_t k = 0; k < n_nodes; ++k) {
+        retval.offsets[k + 1u] = retval.offsets[k] + n_args(k);
+    }
+    retval.indices.resize(retval.offsets.back());
+
+    std::vector<std::size_t> sizes(n_nodes);
+    for (auto k = n_nodes; k-- > 0u;) {
+        auto child = k + 1u;
+        for (auto j = retval.offsets[k]; j < retval.offsets[k + 1u]; ++j) {
+            retval.indices[j] = child;
+            child += sizes[child];
+        }
+        sizes[k] = child - k;
+    }
+
+    return retval;
+}
+
+std::vector<double> compute_node_values_dbl(const expression &e, const std::unordered_map<std::string, double> &map,
+                                            const connections_csr &csr)
+{
+    return detail::batch_node_values_impl(e, map, csr, 1);
+}
+
+std::unordered_map<std::string, double>
+compute_grad_dbl(const expression &e, const std::unordered_map<std::string, double> &map, const connections_csr &csr)
+{
+    const auto nodes = detail::batch_flatten_check(e, csr);
+
+    std::vector<double> node_values(nodes.size());
+    detail::batch_values_sweep(node_values, nodes, map, csr, 1);
+
+    std::unordered_map<std::string, double> grad;
+    detail::batch_grad_sweep(grad, nodes, node_values, csr, 1);
+
+    return grad;
+}
+
+std::vector<double> compute_node_values_batch_dbl(const expression &e,
+                                                  const std::unordered_map<std::string, std::vector<double>> &map,
+                                                  const connections_csr &csr)
+{
+    return detail::batch_node_values_impl(e, map, csr, detail::batch_n_samples(map));
+}
+
+std::unordered_map<std::string, std::vector<double>>
+compute_grad_batch_dbl(const expression &e, const std::unordered_map<std::string, std::vector<double>> &map,
+                       const connections_csr &csr)
+{
+    std::unordered_map<std::string, std::vector<double>> grad;
+    const auto node_values = compute_node_values_batch_dbl(e, map, csr);
+    update_grad_batch_dbl(grad, e, node_values, csr);
+
+    return grad;
+}
+
+void update_grad_batch_dbl(std::unordered_map<std::string, std::vector<double>> &grad, const expression &e,
+                           const std::vector<double> &node_values, const connections_csr &csr)
+{
+    detail::batch_update_grad_impl(grad, e, node_values, csr);
+}
+
 // Transform in-place ex by decomposition, appending the
 // result of the decomposition to u_vars_defs.
 // The return value is the index, in u_vars_defs,
@@ -1113,9 +2352,9 @@ std::uint32_t get_param_size(const expression &ex)
 // Determine if an expression is time-dependent.
 bool has_time(const expression &ex)
 {
-    // If the expression itself is a time function or a tpoly,
-    // return true.
-    if (detail::is_time(ex) || detail::is_tpoly(ex)) {
+    // If the expression itself is a time function, a tpoly
+    // or a tpwpoly, return true.
+    if (detail::is_time(ex) || detail::is_tpoly(ex) || detail::is_tpwpoly(ex)) {
         return true;
     }
 
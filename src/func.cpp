@@ -9,12 +9,14 @@
 #include <heyoka/config.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
 #include <ostream>
 #include <stdexcept>
 #include <string>
@@ -145,18 +147,15 @@ func_inner_base::~func_inner_base() = default;
 
 } // namespace detail
 
-func::func(const func &f) : m_ptr(f.ptr()->clone()) {}
+// NOTE: the copy constructor shares the inner base.
+func::func(const func &f) : m_ptr(f.m_ptr)
+{
+    assert(m_ptr);
+}
 
 func::func(func &&) noexcept = default;
 
-func &func::operator=(const func &f)
-{
-    if (this != &f) {
-        *this = func(f);
-    }
-
-    return *this;
-}
+func &func::operator=(const func &) = default;
 
 func &func::operator=(func &&) noexcept = default;
 
@@ -173,6 +172,27 @@ const detail::func_inner_base *func::ptr() const
 detail::func_inner_base *func::ptr()
 {
     assert(m_ptr.get() != nullptr);
+
+    if (m_ptr.use_count() == 1) {
+        // NOTE: we are the sole owner of the inner base. The fence
+        // ensures that the accesses to the inner base performed by
+        // former owners (possibly in other threads) happen before
+        // the mutable access.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } else {
+        // The inner base is shared, clone it before
+        // granting mutable access.
+        // NOTE: the clone is shallow, in the sense that the
+        // arguments of the clone share their inner bases with
+        // the arguments of the original function.
+        // NOTE: the clone starts with an empty hash cache.
+        m_ptr = m_ptr->clone();
+    }
+
+    // NOTE: mutable access to the inner base
+    // may alter the function, reset the cached hash.
+    m_ptr->m_hash.store(0, std::memory_order_relaxed);
+
     return m_ptr.get();
 }
 
@@ -577,6 +597,11 @@ std::ostream &operator<<(std::ostream &os, const func &f)
 
 std::size_t hash(const func &f)
 {
+    // Check if the hash value was computed already.
+    if (const auto h = f.ptr()->m_hash.load(std::memory_order_relaxed); h != 0u) {
+        return h;
+    }
+
     // NOTE: the initial hash value is computed by combining the hash values of:
     // - the function name,
     // - the function inner type index,
@@ -592,11 +617,32 @@ std::size_t hash(const func &f)
     // Combine with the extra hash value too.
     boost::hash_combine(seed, f.ptr()->extra_hash());
 
+    // Cache the hash value.
+    // NOTE: if seed is zero, the hash value will be
+    // recomputed at every invocation.
+    f.ptr()->m_hash.store(seed, std::memory_order_relaxed);
+
     return seed;
 }
 
 bool operator==(const func &a, const func &b)
 {
+    // Functions sharing the same inner base are equal.
+    if (a.m_ptr == b.m_ptr) {
+        return true;
+    }
+
+    // If the hash values of both functions have been
+    // computed already and they differ, the functions
+    // cannot be equal.
+    // NOTE: this helps avoiding the recursive comparison
+    // of large expressions in hash maps.
+    if (const auto ha = a.ptr()->m_hash.load(std::memory_order_relaxed),
+                   hb = b.ptr()->m_hash.load(std::memory_order_relaxed);
+        ha != 0u && hb != 0u && ha != hb) {
+        return false;
+    }
+
     // NOTE: the initial comparison considers:
     // - the function name,
     // - the function inner type index,
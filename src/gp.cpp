@@ -6,25 +6,53 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include <fmt/format.h>
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/parallel.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/gp.hpp>
+#include <heyoka/llvm_state.hpp>
 #include <heyoka/math.hpp>
 #include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
 #include <heyoka/variable.hpp>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
 namespace heyoka
 {
 
@@ -95,6 +123,12 @@ expression_generator::expression_generator(const std::vector<std::string> &vars,
 };
 
 expression expression_generator::operator()(unsigned min_depth, unsigned max_depth, unsigned depth) const
+{
+    return (*this)(m_e, min_depth, max_depth, depth);
+}
+
+expression expression_generator::operator()(splitmix64 &engine, unsigned min_depth, unsigned max_depth,
+                                            unsigned depth) const
 {
     std::uniform_real_distribution<double> rng01(0.0, 1.0);
     std::uniform_real_distribution<double> rngm11(-1.0, 1.0);
@@ -106,7 +140,7 @@ expression expression_generator::operator()(unsigned min_depth, unsigned max_dep
         double n_u_fun = static_cast<double>(m_u_funcs.size());
         double n_b_fun = static_cast<double>(m_b_funcs.size());
         std::discrete_distribution<> dis({0, n_u_fun * m_weights[1], n_b_fun * m_weights[2]});
-        switch (dis(m_e)) {
+        switch (dis(engine)) {
             case 0:
                 type = node_type::bo;
                 break;
@@ -121,7 +155,7 @@ expression expression_generator::operator()(unsigned min_depth, unsigned max_dep
         // If the node depth is above the maximum desired, we force leaves (num or var) to be selected
         double n_var = static_cast<double>(m_vars.size());
         std::discrete_distribution<> dis({n_var * m_weights[3], m_weights[4]});
-        switch (dis(m_e)) {
+        switch (dis(engine)) {
             case 0:
                 type = node_type::var;
                 break;
@@ -136,7 +170,7 @@ expression expression_generator::operator()(unsigned min_depth, unsigned max_dep
         double n_var = static_cast<double>(m_vars.size());
         std::discrete_distribution<> dis(
             {0, n_u_fun * m_weights[1], n_b_fun * m_weights[2], n_var * m_weights[3], m_weights[4]});
-        switch (dis(m_e)) {
+        switch (dis(engine)) {
             case 0:
                 type = node_type::bo;
                 break;
@@ -158,27 +192,27 @@ expression expression_generator::operator()(unsigned min_depth, unsigned max_dep
     switch (type) {
         case node_type::num: {
             // We return a random number in -m_range_dbl, m_range_dbl
-            auto value = rngm11(m_e) * m_range_dbl;
+            auto value = rngm11(engine) * m_range_dbl;
             return expression{number{value}};
             break;
         }
         case node_type::var: {
             // We return one of the variables in m_vars
-            auto symbol = *detail::random_element(m_vars.begin(), m_vars.end(), m_e);
+            auto symbol = *detail::random_element(m_vars.begin(), m_vars.end(), engine);
             return expression{variable{symbol}};
             break;
         }
         case node_type::u_fun: {
             // We return one of the unary functions in m_u_funcs with randomly constructed argument
-            auto u_f = *detail::random_element(m_u_funcs.begin(), m_u_funcs.end(), m_e);
-            return u_f(this->operator()(min_depth, max_depth, depth + 1));
+            auto u_f = *detail::random_element(m_u_funcs.begin(), m_u_funcs.end(), engine);
+            return u_f(this->operator()(engine, min_depth, max_depth, depth + 1));
             break;
         }
         case node_type::b_fun: {
             // We return one of the binary functions in m_b_funcs with randomly constructed arguments
-            auto b_f = *detail::random_element(m_b_funcs.begin(), m_b_funcs.end(), m_e);
-            return b_f(this->operator()(min_depth, max_depth, depth + 1),
-                       this->operator()(min_depth, max_depth, depth + 1));
+            auto b_f = *detail::random_element(m_b_funcs.begin(), m_b_funcs.end(), engine);
+            return b_f(this->operator()(engine, min_depth, max_depth, depth + 1),
+                       this->operator()(engine, min_depth, max_depth, depth + 1));
             break;
         }
         default:
@@ -346,4 +380,778 @@ void crossover(expression &e1, expression &e2, std::size_t node_id1, std::size_t
     swap(*e2_sub_ptr, *e1_sub_ptr);
 }
 
+namespace detail
+{
+
+// Buffer for (a portion of) the index of a gp_individual.
+// NOTE: the parent indices are relative to the first node.
+struct gp_index_buffer {
+    std::vector<expression *> nodes;
+    std::vector<std::size_t> sizes;
+    std::vector<std::size_t> parents;
+
+    void clear()
+    {
+        nodes.clear();
+        sizes.clear();
+        parents.clear();
+    }
+};
+
+namespace
+{
+
+// Sentinel value for the parent of a root node.
+constexpr auto gp_no_parent = std::numeric_limits<std::size_t>::max();
+
+// Append to buf the index of the subtree rooted at ex, whose
+// parent is parent. Returns the size of the subtree.
+// NOTE: the tree is traversed via mutable access, so that
+// the nodes end up being uniquely owned by ex (the inner bases
+// of shared functions are cloned). This guarantees that the
+// pointers in the index remain valid until the tree is modified.
+std::size_t gp_index_subtree(gp_index_buffer &buf, expression &ex, std::size_t parent)
+{
+    const auto idx = buf.nodes.size();
+
+    buf.nodes.push_back(&ex);
+    buf.sizes.push_back(1);
+    buf.parents.push_back(parent);
+
+    if (auto *f_ptr = std::get_if<func>(&ex.value())) {
+        for (auto [b, e] = f_ptr->get_mutable_args_it(); b != e; ++b) {
+            const auto sz = gp_index_subtree(buf, *b, idx);
+            buf.sizes[idx] += sz;
+        }
+    }
+
+    return buf.sizes[idx];
+}
+
+// Copy into buf the index of the subtree rooted at node k of the index (nodes, sizes, parents).
+void gp_copy_subtree_index(gp_index_buffer &buf, const std::vector<expression *> &nodes,
+                           const std::vector<std::size_t> &sizes, const std::vector<std::size_t> &parents,
+                           std::size_t k)
+{
+    buf.clear();
+
+    const auto n = static_cast<std::ptrdiff_t>(sizes[k]);
+    const auto ik = static_cast<std::ptrdiff_t>(k);
+
+    buf.nodes.insert(buf.nodes.end(), nodes.begin() + ik, nodes.begin() + ik + n);
+    buf.sizes.insert(buf.sizes.end(), sizes.begin() + ik, sizes.begin() + ik + n);
+    buf.parents.push_back(gp_no_parent);
+    for (auto i = ik + 1; i < ik + n; ++i) {
+        buf.parents.push_back(parents[static_cast<std::size_t>(i)] - k);
+    }
+}
+
+// Scratch buffers, reused across mutations and crossovers
+// in order to avoid memory allocations.
+thread_local gp_index_buffer gp_buf_0, gp_buf_1;
+thread_local std::vector<std::size_t> gp_path;
+
+} // namespace
+
+} // namespace detail
+
+gp_individual::gp_individual(expression ex) : m_ex(std::move(ex))
+{
+    build_index();
+}
+
+gp_individual::gp_individual(const gp_individual &other) : m_ex(other.m_ex)
+{
+    // NOTE: the index is rebuilt, as this also
+    // makes the copy of the tree uniquely owned.
+    build_index();
+}
+
+// NOTE: moving the root node does not alter the
+// addresses of the other nodes.
+gp_individual::gp_individual(gp_individual &&) noexcept = default;
+
+gp_individual &gp_individual::operator=(const gp_individual &other)
+{
+    if (this != &other) {
+        *this = gp_individual(other);
+    }
+
+    return *this;
+}
+
+gp_individual &gp_individual::operator=(gp_individual &&) noexcept = default;
+
+gp_individual::~gp_individual() = default;
+
+expression &gp_individual::node(std::size_t k)
+{
+    assert(k < m_nodes.size());
+
+    return k == 0u ? m_ex : *m_nodes[k];
+}
+
+void gp_individual::build_index()
+{
+    auto &buf = detail::gp_buf_0;
+
+    buf.clear();
+    detail::gp_index_subtree(buf, m_ex, detail::gp_no_parent);
+
+    m_nodes = buf.nodes;
+    m_sizes = buf.sizes;
+    m_parents = buf.parents;
+}
+
+// Ensure mutable access to the ancestors of the node k, from the root down.
+// This resets the cached hashes of the ancestors, and it clones
+// their inner bases if they are shared (e.g., because the expression was copied
+// via get_expression()). In the latter case, the index is rebuilt.
+void gp_individual::unshare_ancestors(std::size_t k)
+{
+    auto &path = detail::gp_path;
+
+    path.clear();
+    for (auto p = m_parents[k]; p != detail::gp_no_parent; p = m_parents[p]) {
+        path.push_back(p);
+    }
+
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        // NOTE: an ancestor is a function with at least one
+        // argument, whose first argument is the node *it + 1.
+        auto &f = std::get<func>(node(*it).value());
+
+        if (&*f.get_mutable_args_it().first != m_nodes[*it + 1u]) {
+            // The inner base was cloned, the cached pointers are not valid any more.
+            build_index();
+
+            return;
+        }
+    }
+}
+
+// Replace the index of the subtree rooted at node k
+// with the index in buf.
+void gp_individual::splice(std::size_t k, const detail::gp_index_buffer &buf)
+{
+    const auto n_old = m_sizes[k], n_new = buf.nodes.size();
+    const auto parent = m_parents[k];
+    auto *slot = m_nodes[k];
+
+    assert(n_new > 0u);
+
+    // Update the sizes of the ancestors.
+    for (auto p = parent; p != detail::gp_no_parent; p = m_parents[p]) {
+        m_sizes[p] = m_sizes[p] - n_old + n_new;
+    }
+
+    // Update the parents of the nodes after the subtree.
+    for (auto i = k + n_old; i < m_parents.size(); ++i) {
+        if (m_parents[i] != detail::gp_no_parent && m_parents[i] >= k + n_old) {
+            m_parents[i] = m_parents[i] - n_old + n_new;
+        }
+    }
+
+    auto replace = [b = static_cast<std::ptrdiff_t>(k), e = static_cast<std::ptrdiff_t>(k + n_old)](auto &v,
+                                                                                                   const auto &nv) {
+        v.erase(v.begin() + b, v.begin() + e);
+        v.insert(v.begin() + b, nv.begin(), nv.end());
+    };
+
+    replace(m_nodes, buf.nodes);
+    replace(m_sizes, buf.sizes);
+    replace(m_parents, buf.parents);
+
+    // Fix up the root and the parents of the new subtree.
+    m_nodes[k] = slot;
+    m_parents[k] = parent;
+    for (auto i = k + 1u; i < k + n_new; ++i) {
+        m_parents[i] += k;
+    }
+}
+
+void gp_individual::check_node_id(std::size_t k) const
+{
+    if (k >= m_nodes.size()) {
+        throw std::invalid_argument("The node id requested: " + std::to_string(k)
+                                    + " was not found in an expression with " + std::to_string(m_nodes.size())
+                                    + " node(s)");
+    }
+}
+
+const expression &gp_individual::get_expression() const
+{
+    return m_ex;
+}
+
+std::size_t gp_individual::size() const
+{
+    return m_nodes.size();
+}
+
+const expression &gp_individual::get_node(std::size_t k) const
+{
+    check_node_id(k);
+
+    return k == 0u ? m_ex : *m_nodes[k];
+}
+
+std::size_t gp_individual::get_subtree_size(std::size_t k) const
+{
+    check_node_id(k);
+
+    return m_sizes[k];
+}
+
+// Replace the subtree rooted at the node k with ex.
+void gp_individual::replace_node(std::size_t k, expression ex)
+{
+    check_node_id(k);
+    unshare_ancestors(k);
+
+    auto &slot = node(k);
+    slot = std::move(ex);
+
+    // Index the new subtree.
+    auto &buf = detail::gp_buf_0;
+    buf.clear();
+    detail::gp_index_subtree(buf, slot, detail::gp_no_parent);
+
+    splice(k, buf);
+}
+
+// Version targeting a node.
+void mutate(gp_individual &ind, std::size_t node_id, const expression_generator &generator, unsigned min_depth,
+            unsigned max_depth)
+{
+    // NOTE: check the node id before generating the new subtree.
+    static_cast<void>(ind.get_subtree_size(node_id));
+
+    ind.replace_node(node_id, generator(min_depth, max_depth));
+}
+
+// Version targeting a node, using the provided engine
+// for the generation of the new subtree.
+void mutate(gp_individual &ind, std::size_t node_id, const expression_generator &generator, splitmix64 &engine,
+            unsigned min_depth, unsigned max_depth)
+{
+    static_cast<void>(ind.get_subtree_size(node_id));
+
+    ind.replace_node(node_id, generator(engine, min_depth, max_depth));
+}
+
+// Version targeting a random node.
+// NOTE: the new subtree is generated via the provided
+// engine as well, thus this function can be invoked concurrently
+// on different individuals with different engines.
+void mutate(gp_individual &ind, const expression_generator &generator, splitmix64 &engine, unsigned min_depth,
+            unsigned max_depth)
+{
+    std::uniform_int_distribution<std::size_t> t(0, ind.size() - 1u);
+
+    mutate(ind, t(engine), generator, engine, min_depth, max_depth);
+}
+
+// Crossover targeting specific node_ids.
+void crossover(gp_individual &ind1, gp_individual &ind2, std::size_t node_id1, std::size_t node_id2)
+{
+    if (&ind1 == &ind2) {
+        throw std::invalid_argument("A crossover cannot be performed between an individual and itself");
+    }
+
+    ind1.check_node_id(node_id1);
+    ind2.check_node_id(node_id2);
+
+    ind1.unshare_ancestors(node_id1);
+    ind2.unshare_ancestors(node_id2);
+
+    // Save the indices of the subtrees.
+    // NOTE: swapping the roots of the subtrees does not alter the addresses
+    // of the other nodes, thus the indices of the subtrees can be exchanged
+    // without traversing them.
+    auto &buf1 = detail::gp_buf_0, &buf2 = detail::gp_buf_1;
+    detail::gp_copy_subtree_index(buf1, ind1.m_nodes, ind1.m_sizes, ind1.m_parents, node_id1);
+    detail::gp_copy_subtree_index(buf2, ind2.m_nodes, ind2.m_sizes, ind2.m_parents, node_id2);
+
+    swap(ind1.node(node_id1), ind2.node(node_id2));
+
+    ind1.splice(node_id1, buf2);
+    ind2.splice(node_id2, buf1);
+}
+
+// Crossover targeting random nodes.
+void crossover(gp_individual &ind1, gp_individual &ind2, splitmix64 &engine)
+{
+    std::uniform_int_distribution<std::size_t> t1(0, ind1.size() - 1u);
+    std::uniform_int_distribution<std::size_t> t2(0, ind2.size() - 1u);
+
+    const auto node_id1 = t1(engine);
+    const auto node_id2 = t2(engine);
+
+    crossover(ind1, ind2, node_id1, node_id2);
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Spacing between the random streams used in gp_evolve().
+// NOTE: each offspring consumes far fewer
+// than 2**32 random numbers.
+constexpr std::uint64_t gp_stream_spacing = 1ull << 32;
+
+} // namespace
+
+gp_evolve_res gp_evolve_impl(std::vector<expression> pop, const expression_generator &gen,
+                             const gp_fitness_t &fitness, unsigned n_gen, std::uint64_t seed,
+                             std::size_t tournament_size, double crossover_prob, std::size_t n_elites,
+                             unsigned mut_min_depth, unsigned mut_max_depth, unsigned n_threads,
+                             gp_fitness_cache *cache)
+{
+    if (pop.empty()) {
+        throw std::invalid_argument("Cannot evolve an empty population");
+    }
+
+    if (!fitness) {
+        throw std::invalid_argument("Cannot evolve a population with an empty fitness function");
+    }
+
+    if (tournament_size == 0u) {
+        throw std::invalid_argument("The tournament size in gp_evolve() cannot be zero");
+    }
+
+    if (!(crossover_prob >= 0 && crossover_prob <= 1)) {
+        throw std::invalid_argument(
+            "The crossover probability in gp_evolve() must be in the [0, 1] range, but it is {} instead"_format(
+                crossover_prob));
+    }
+
+    if (n_elites > pop.size()) {
+        throw std::invalid_argument("The number of elites in gp_evolve() ({}) cannot be larger than the "
+                                    "size of the population ({})"_format(n_elites, pop.size()));
+    }
+
+    if (mut_min_depth > mut_max_depth) {
+        throw std::invalid_argument("The minimum depth for the mutations in gp_evolve() ({}) cannot be larger than "
+                                    "the maximum depth ({})"_format(mut_min_depth, mut_max_depth));
+    }
+
+    const auto n_ind = pop.size();
+
+    // Evaluation of the fitness, via the cache if available.
+    auto eval_fit
+        = [&fitness, cache](const expression &ex) { return cache == nullptr ? fitness(ex) : (*cache)(ex, fitness); };
+
+    // Comparison between fitness values
+    // (NaNs are the worst values).
+    auto better = [](double a, double b) { return !std::isnan(a) && (std::isnan(b) || a < b); };
+
+    // Evaluate the initial population.
+    std::vector<double> fit(n_ind);
+    parallel_for(n_ind, n_threads, [&](std::size_t b, std::size_t e, unsigned) {
+        for (auto i = b; i < e; ++i) {
+            fit[i] = eval_fit(pop[i]);
+        }
+    });
+
+    std::vector<expression> new_pop(n_ind);
+    std::vector<double> new_fit(n_ind);
+    std::vector<std::size_t> order(n_ind);
+
+    for (unsigned g = 0; g < n_gen; ++g) {
+        // Copy the elites.
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b) { return better(fit[a], fit[b]); });
+        for (std::size_t i = 0; i < n_elites; ++i) {
+            new_pop[i] = pop[order[i]];
+            new_fit[i] = fit[order[i]];
+        }
+
+        // Generate and evaluate the offspring.
+        parallel_for(n_ind - n_elites, n_threads, [&](std::size_t b, std::size_t e, unsigned) {
+            std::uniform_int_distribution<std::size_t> idx_dist(0, n_ind - 1u);
+            std::uniform_real_distribution<double> rng01(0., 1.);
+
+            for (auto i = b + n_elites; i < e + n_elites; ++i) {
+                // NOTE: the stream of the offspring depends only
+                // on the generation and on the index of the offspring.
+                splitmix64 engine(seed);
+                engine.jump((static_cast<std::uint64_t>(g) * n_ind + i) * gp_stream_spacing);
+
+                auto tournament = [&]() {
+                    auto best = idx_dist(engine);
+                    for (std::size_t k = 1; k < tournament_size; ++k) {
+                        const auto cand = idx_dist(engine);
+                        if (better(fit[cand], fit[best])) {
+                            best = cand;
+                        }
+                    }
+
+                    return best;
+                };
+
+                gp_individual child(pop[tournament()]);
+                if (rng01(engine) < crossover_prob) {
+                    gp_individual other(pop[tournament()]);
+                    crossover(child, other, engine);
+                } else {
+                    mutate(child, gen, engine, mut_min_depth, mut_max_depth);
+                }
+
+                new_pop[i] = child.get_expression();
+                new_fit[i] = eval_fit(new_pop[i]);
+            }
+        });
+
+        pop.swap(new_pop);
+        fit.swap(new_fit);
+    }
+
+    return gp_evolve_res{std::move(pop), std::move(fit)};
+}
+
+} // namespace detail
+
+gp_fitness_cache::gp_fitness_cache(std::size_t max_size) : m_max_size(max_size)
+{
+    if (max_size == 0u) {
+        throw std::invalid_argument("The maximum size of a fitness cache cannot be zero");
+    }
+}
+
+gp_fitness_cache::~gp_fitness_cache() = default;
+
+// Fetch the cached fitness of ex, if present.
+std::optional<double> gp_fitness_cache::lookup(const expression &ex)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (const auto it = m_map.find(ex); it != m_map.end()) {
+        ++m_n_hits;
+        return it->second;
+    } else {
+        ++m_n_misses;
+        return {};
+    }
+}
+
+// Add the fitness of ex to the cache, evicting the oldest entry
+// if the cache is full. If ex is already in the cache,
+// this function has no effects.
+void gp_fitness_cache::insert(const expression &ex, double fit)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (m_map.find(ex) != m_map.end()) {
+        return;
+    }
+
+    if (m_map.size() == m_max_size) {
+        assert(!m_order.empty());
+
+        m_map.erase(m_map.find(*m_order.front()));
+        m_order.pop_front();
+    }
+
+    const auto it = m_map.emplace(ex, fit).first;
+    m_order.push_back(&it->first);
+}
+
+// Fetch the fitness of ex from the cache, or compute it via
+// fitness (and add it to the cache) if it is not present.
+// NOTE: the fitness is computed without holding the lock,
+// so that cache misses in different threads do not serialise.
+double gp_fitness_cache::operator()(const expression &ex, const gp_fitness_t &fitness)
+{
+    if (const auto cached = lookup(ex)) {
+        return *cached;
+    }
+
+    const auto retval = fitness(ex);
+    insert(ex, retval);
+
+    return retval;
+}
+
+std::size_t gp_fitness_cache::size() const
+{
+    std::lock_guard lock(m_mutex);
+
+    return m_map.size();
+}
+
+std::size_t gp_fitness_cache::get_max_size() const
+{
+    return m_max_size;
+}
+
+std::uint64_t gp_fitness_cache::get_n_hits() const
+{
+    std::lock_guard lock(m_mutex);
+
+    return m_n_hits;
+}
+
+std::uint64_t gp_fitness_cache::get_n_misses() const
+{
+    std::lock_guard lock(m_mutex);
+
+    return m_n_misses;
+}
+
+void gp_fitness_cache::clear()
+{
+    std::lock_guard lock(m_mutex);
+
+    m_map.clear();
+    m_order.clear();
+    m_n_hits = 0;
+    m_n_misses = 0;
+}
+
+void population_evaluator::finalise_ctor_impl(std::vector<expression> pop, std::vector<std::string> vars,
+                                              std::uint32_t batch_size)
+{
+    if (pop.empty()) {
+        throw std::invalid_argument("Cannot create a population evaluator with an empty population");
+    }
+
+    if (batch_size == 0u) {
+        batch_size = detail::recommended_simd_size<double>();
+    }
+
+    // NOTE: the input variables are the same for all individuals,
+    // so that they can be evaluated over the same dataset.
+    std::vector<expression> vars_ex;
+    for (const auto &var : vars) {
+        vars_ex.emplace_back(variable{var});
+    }
+
+    // Detect the structurally identical individuals.
+    std::vector<std::size_t> rep;
+    std::unordered_map<expression, std::size_t> first_occ;
+    for (decltype(pop.size()) i = 0; i < pop.size(); ++i) {
+        rep.push_back(first_occ.emplace(pop[i], i).first->second);
+    }
+
+    // Add the functions for all the unique individuals.
+    // NOTE: the optimisation passes are run only once, on the
+    // whole module, after all the functions have been added.
+    std::uint32_t n_pars = 0;
+    for (decltype(pop.size()) i = 0; i < pop.size(); ++i) {
+        if (rep[i] != i) {
+            continue;
+        }
+
+        n_pars = std::max(n_pars, get_param_size(pop[i]));
+
+        detail::add_cfunc_impl<double>(m_llvm, "gp_ind_{}"_format(i), {pop[i]}, batch_size, vars_ex, false);
+        if (batch_size > 1u) {
+            detail::add_cfunc_impl<double>(m_llvm, "gp_ind_scalar_{}"_format(i), {pop[i]}, 1, vars_ex, false);
+        }
+    }
+
+    m_llvm.optimise();
+
+    m_llvm.compile();
+
+    m_pop = std::move(pop);
+    m_vars = std::move(vars);
+    m_batch_size = batch_size;
+    m_n_pars = n_pars;
+    m_rep = std::move(rep);
+
+    fetch_fptrs();
+}
+
+// Helper to fetch the function pointers of the compiled
+// functions of the individuals.
+// NOTE: the duplicate individuals share the
+// function pointers of their first occurrences.
+void population_evaluator::fetch_fptrs()
+{
+    m_f_batch.clear();
+    m_f_scalar.clear();
+
+    for (decltype(m_pop.size()) i = 0; i < m_pop.size(); ++i) {
+        if (m_rep[i] != i) {
+            m_f_batch.push_back(m_f_batch[m_rep[i]]);
+            m_f_scalar.push_back(m_f_scalar[m_rep[i]]);
+            continue;
+        }
+
+        m_f_batch.push_back(reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("gp_ind_{}"_format(i))));
+        m_f_scalar.push_back(m_batch_size > 1u
+                                 ? reinterpret_cast<cfunc_t>(m_llvm.jit_lookup("gp_ind_scalar_{}"_format(i)))
+                                 : m_f_batch.back());
+    }
+}
+
+population_evaluator::population_evaluator(const population_evaluator &other)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_llvm(other.m_llvm), m_pop(other.m_pop), m_vars(other.m_vars), m_batch_size(other.m_batch_size),
+      m_n_pars(other.m_n_pars), m_rep(other.m_rep)
+{
+    fetch_fptrs();
+}
+
+population_evaluator::population_evaluator(population_evaluator &&) noexcept = default;
+
+population_evaluator &population_evaluator::operator=(const population_evaluator &other)
+{
+    if (this != &other) {
+        *this = population_evaluator(other);
+    }
+
+    return *this;
+}
+
+population_evaluator &population_evaluator::operator=(population_evaluator &&) noexcept = default;
+
+population_evaluator::~population_evaluator() = default;
+
+const llvm_state &population_evaluator::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+const std::vector<expression> &population_evaluator::get_population() const
+{
+    return m_pop;
+}
+
+const std::vector<std::string> &population_evaluator::get_vars() const
+{
+    return m_vars;
+}
+
+std::uint32_t population_evaluator::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+std::uint32_t population_evaluator::get_n_pars() const
+{
+    return m_n_pars;
+}
+
+// Number of structurally distinct individuals
+// in the population.
+std::size_t population_evaluator::get_n_unique() const
+{
+    std::size_t retval = 0;
+    for (decltype(m_rep.size()) i = 0; i < m_rep.size(); ++i) {
+        retval += static_cast<std::size_t>(m_rep[i] == i);
+    }
+
+    return retval;
+}
+
+// Evaluate the population on n_points points. in and out are arrays
+// in row-major order with shapes (n_vars, n_points) and (n_individuals, n_points)
+// respectively. pars is the array of runtime parameters, shared by all points
+// and individuals. The batches of points are distributed among n_threads threads
+// (a value of zero means to use all the hardware threads available on the machine).
+void population_evaluator::operator()(double *out, const double *in, std::size_t n_points, const double *pars,
+                                      unsigned n_threads) const
+{
+    if (n_points == 0u) {
+        return;
+    }
+
+    if (out == nullptr) {
+        throw std::invalid_argument("A null output array was passed to a population evaluator");
+    }
+
+    if (in == nullptr && !m_vars.empty()) {
+        throw std::invalid_argument("A null input array was passed to a population evaluator");
+    }
+
+    if (pars == nullptr && m_n_pars > 0u) {
+        throw std::invalid_argument("A null array of parameters was passed to a population evaluator "
+                                    "which requires {} parameter(s)"_format(m_n_pars));
+    }
+
+    // LCOV_EXCL_START
+    if (n_points > std::numeric_limits<std::uint64_t>::max()) {
+        throw std::overflow_error("Overflow detected in the computation of the stride of a population evaluator");
+    }
+    // LCOV_EXCL_STOP
+
+    const auto stride = static_cast<std::uint64_t>(n_points);
+    const auto n_batches = n_points / m_batch_size;
+    const auto n_ind = m_pop.size();
+
+    auto in_offset = [in](std::size_t n) { return in == nullptr ? in : in + n; };
+
+    // Process the full batches.
+    // NOTE: the loop over the individuals is the innermost one, so that
+    // the input data of a batch is loaded in cache only once for the
+    // whole population.
+    detail::parallel_for(n_batches, n_threads, [&](std::size_t b, std::size_t e, unsigned) {
+        for (auto i = b; i < e; ++i) {
+            const auto offset = i * m_batch_size;
+
+            for (decltype(m_pop.size()) j = 0; j < n_ind; ++j) {
+                if (m_rep[j] == j) {
+                    m_f_batch[j](out + j * n_points + offset, in_offset(offset), pars, stride);
+                }
+            }
+        }
+    });
+
+    // Process the remaining points one by one.
+    for (auto offset = n_batches * m_batch_size; offset < n_points; ++offset) {
+        for (decltype(m_pop.size()) j = 0; j < n_ind; ++j) {
+            if (m_rep[j] == j) {
+                m_f_scalar[j](out + j * n_points + offset, in_offset(offset), pars, stride);
+            }
+        }
+    }
+
+    // Copy the outputs of the duplicate individuals.
+    for (decltype(m_pop.size()) j = 0; j < n_ind; ++j) {
+        if (m_rep[j] != j) {
+            std::copy(out + m_rep[j] * n_points, out + (m_rep[j] + 1u) * n_points, out + j * n_points);
+        }
+    }
+}
+
+std::vector<double> population_evaluator::operator()(const std::vector<double> &in, std::size_t n_points,
+                                                     const std::vector<double> &pars, unsigned n_threads) const
+{
+    // LCOV_EXCL_START
+    if (!m_vars.empty() && n_points > std::numeric_limits<std::size_t>::max() / m_vars.size()) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the input "
+                                  "array of a population evaluator");
+    }
+
+    if (n_points > std::numeric_limits<std::size_t>::max() / m_pop.size()) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the output "
+                                  "array of a population evaluator");
+    }
+    // LCOV_EXCL_STOP
+
+    if (in.size() != m_vars.size() * n_points) {
+        throw std::invalid_argument("The size of the input array of a population evaluator ({}) is inconsistent with "
+                                    "the number of input variables ({}) and the number of points ({})"_format(
+                                        in.size(), m_vars.size(), n_points));
+    }
+
+    if (pars.size() < m_n_pars) {
+        throw std::invalid_argument("The population evaluator requires {} parameter(s), but only {} "
+                                    "parameter value(s) were passed"_format(m_n_pars, pars.size()));
+    }
+
+    std::vector<double> out;
+    out.resize(m_pop.size() * n_points);
+
+    (*this)(out.data(), in.empty() ? nullptr : in.data(), n_points, pars.empty() ? nullptr : pars.data(), n_threads);
+
+    return out;
+}
+
 } // namespace heyoka
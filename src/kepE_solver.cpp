@@ -0,0 +1,185 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kepE_solver.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/kepE.hpp>
+
+namespace heyoka
+{
+
+template <typename T>
+void kepE_solver<T>::finalise_ctor_impl(std::uint32_t batch_size)
+{
+    if (batch_size == 0u) {
+        batch_size = detail::recommended_simd_size<T>();
+    }
+
+    auto [e, M] = make_vars("e", "M");
+
+    // Add the batch-mode function and, if needed,
+    // the scalar function for the remainder pairs.
+    add_cfunc<T>(m_llvm, "kepE", {kepE(e, M)}, batch_size, {e, M});
+    if (batch_size > 1u) {
+        add_cfunc<T>(m_llvm, "kepE_scalar", {kepE(e, M)}, 1, {e, M});
+    }
+
+    m_llvm.compile();
+
+    m_f_batch = reinterpret_cast<kepE_f_t>(m_llvm.jit_lookup("kepE"));
+    m_f_scalar = batch_size > 1u ? reinterpret_cast<kepE_f_t>(m_llvm.jit_lookup("kepE_scalar")) : m_f_batch;
+
+    m_batch_size = batch_size;
+}
+
+template <typename T>
+kepE_solver<T>::kepE_solver()
+{
+    finalise_ctor_impl(0);
+}
+
+template <typename T>
+kepE_solver<T>::kepE_solver(const kepE_solver &other)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_llvm(other.m_llvm), m_batch_size(other.m_batch_size)
+{
+    m_f_batch = reinterpret_cast<kepE_f_t>(m_llvm.jit_lookup("kepE"));
+    m_f_scalar = m_batch_size > 1u ? reinterpret_cast<kepE_f_t>(m_llvm.jit_lookup("kepE_scalar")) : m_f_batch;
+}
+
+template <typename T>
+kepE_solver<T>::kepE_solver(kepE_solver &&) noexcept = default;
+
+template <typename T>
+kepE_solver<T> &kepE_solver<T>::operator=(const kepE_solver &other)
+{
+    if (this != &other) {
+        *this = kepE_solver(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+kepE_solver<T> &kepE_solver<T>::operator=(kepE_solver &&) noexcept = default;
+
+template <typename T>
+kepE_solver<T>::~kepE_solver() = default;
+
+template <typename T>
+const llvm_state &kepE_solver<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+std::uint32_t kepE_solver<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+// Compute the eccentric anomalies for the n pairs (ecc[i], M[i]),
+// writing the results into out. The batches of pairs are distributed among
+// n_threads threads (a value of zero means to use all the hardware
+// threads available on the machine).
+template <typename T>
+void kepE_solver<T>::operator()(T *out, const T *ecc, const T *M, std::size_t n, unsigned n_threads) const
+{
+    if (n == 0u) {
+        return;
+    }
+
+    if (out == nullptr || ecc == nullptr || M == nullptr) {
+        throw std::invalid_argument("A null pointer was passed to a Kepler solver");
+    }
+
+    const auto n_batches = n / m_batch_size;
+
+    // NOTE: the compiled functions read the eccentricities and the
+    // mean anomalies from a single array with shape (2, bs), thus the
+    // input of each batch is gathered into a temporary buffer. The output
+    // consists of a single row, which is written directly into out.
+    auto eval_batch = [&](kepE_f_t f, std::uint32_t bs, std::size_t offset, T *buf) {
+        std::copy(ecc + offset, ecc + offset + bs, buf);
+        std::copy(M + offset, M + offset + bs, buf + bs);
+
+        f(out + offset, buf, nullptr, bs);
+    };
+
+    // Process the full batches.
+    // NOTE: the per-thread storage is set up by
+    // the worker threads the first time they are invoked.
+    std::vector<std::vector<T>> bufs(detail::parallel_n_workers(n_batches, n_threads));
+    detail::parallel_for(n_batches, n_threads, [&](std::size_t b, std::size_t e, unsigned idx) {
+        auto &buf = bufs[idx];
+        if (buf.empty()) {
+            buf.resize(2u * static_cast<std::size_t>(m_batch_size));
+        }
+
+        for (auto i = b; i < e; ++i) {
+            eval_batch(m_f_batch, m_batch_size, i * m_batch_size, buf.data());
+        }
+    });
+
+    // Process the remaining pairs one by one.
+    T buf[2];
+    for (auto offset = n_batches * m_batch_size; offset < n; ++offset) {
+        eval_batch(m_f_scalar, 1, offset, buf);
+    }
+}
+
+template <typename T>
+std::vector<T> kepE_solver<T>::operator()(const std::vector<T> &ecc, const std::vector<T> &M,
+                                          unsigned n_threads) const
+{
+    using namespace fmt::literals;
+
+    if (ecc.size() != M.size()) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected in a Kepler solver: the number of eccentricities is {}, while the number "
+            "of mean anomalies is {}"_format(ecc.size(), M.size()));
+    }
+
+    std::vector<T> out;
+    out.resize(ecc.size());
+
+    (*this)(out.data(), ecc.data(), M.data(), ecc.size(), n_threads);
+
+    return out;
+}
+
+// Explicit instantiations.
+template class kepE_solver<double>;
+template class kepE_solver<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class kepE_solver<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
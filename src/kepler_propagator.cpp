@@ -0,0 +1,643 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/kepler_propagator.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The Stumpff functions c2(z) and c3(z).
+template <typename T>
+std::pair<T, T> kep_stumpff(const T &z)
+{
+    using std::abs;
+    using std::cos;
+    using std::cosh;
+    using std::sin;
+    using std::sinh;
+    using std::sqrt;
+
+    if (abs(z) <= 1) {
+        // NOTE: for small |z|, use the series expansions
+        // in order to avoid the catastrophic cancellation
+        // in the closed forms. With |z| <= 1, 20 terms are more
+        // than enough for all the supported floating-point types.
+        T c2(0), c3(0), t2 = T(1) / 2, t3 = T(1) / 6;
+        for (unsigned k = 0; k < 20u; ++k) {
+            c2 += t2;
+            c3 += t3;
+            t2 *= -z / T((2u * k + 3u) * (2u * k + 4u));
+            t3 *= -z / T((2u * k + 4u) * (2u * k + 5u));
+        }
+
+        return {c2, c3};
+    }
+
+    if (z > 0) {
+        const auto sz = sqrt(z);
+        return {(1 - cos(sz)) / z, (sz - sin(sz)) / (z * sz)};
+    } else {
+        const auto sz = sqrt(-z);
+        return {(cosh(sz) - 1) / -z, (sinh(sz) - sz) / (-z * sz)};
+    }
+}
+
+// Propagate by the time interval dt the Cartesian state of the two-body
+// problem with gravitational parameter mu. The input state is read from in,
+// the output state is written into out, and the components of the states
+// are separated by stride elements (i.e., stride is the batch size).
+// The return value is false if the output state is not finite.
+// NOTE: the propagation is performed by solving Kepler's equation in universal
+// variables via the Laguerre-Conway method, which converges for all conic
+// sections. See Vallado, "Fundamentals of Astrodynamics and Applications", and
+// Conway, "An improved algorithm due to Laguerre for the solution of Kepler's equation".
+template <typename T>
+bool kep_propagate(T *out, const T *in, std::uint32_t stride, const T &mu, T dt)
+{
+    using std::abs;
+    using std::atan;
+    using std::isfinite;
+    using std::log;
+    using std::sqrt;
+    using std::trunc;
+
+    const std::array<T, 3> r0{in[0], in[stride], in[2u * stride]};
+    const std::array<T, 3> v0{in[3u * stride], in[4u * stride], in[5u * stride]};
+
+    const auto r0n = sqrt(r0[0] * r0[0] + r0[1] * r0[1] + r0[2] * r0[2]);
+    const auto v0sq = v0[0] * v0[0] + v0[1] * v0[1] + v0[2] * v0[2];
+    const auto rv = r0[0] * v0[0] + r0[1] * v0[1] + r0[2] * v0[2];
+
+    const auto sqrt_mu = sqrt(mu);
+    const auto sigma0 = rv / sqrt_mu;
+    // NOTE: alpha is the inverse of the semi-major axis.
+    const auto alpha = 2 / r0n - v0sq / mu;
+
+    if (dt == 0) {
+        for (std::uint32_t i = 0; i < 6u; ++i) {
+            out[i * stride] = in[i * stride];
+        }
+
+        return isfinite(r0n) && isfinite(v0sq);
+    }
+
+    // Initial guess for the universal anomaly chi.
+    T chi;
+    if (alpha > 0) {
+        // Elliptic orbit: reduce dt to less than one period.
+        const auto period = 8 * atan(T(1)) / (sqrt_mu * alpha * sqrt(alpha));
+        dt -= period * trunc(dt / period);
+
+        chi = sqrt_mu * dt * alpha;
+    } else {
+        // Parabolic or hyperbolic orbit.
+        chi = sqrt_mu * dt / r0n;
+
+        if (alpha < 0) {
+            const auto sgn = dt > 0 ? T(1) : T(-1);
+            const auto a = 1 / alpha;
+            const auto arg = (-2 * mu * alpha * dt) / (rv + sgn * sqrt(-mu * a) * (1 - r0n * alpha));
+
+            if (isfinite(arg) && arg > 0) {
+                chi = sgn * sqrt(-a) * log(arg);
+            }
+        }
+    }
+
+    // Iterate until the correction falls below a few ulps.
+    constexpr unsigned max_iter = 100;
+    const auto tol = 16 * std::numeric_limits<T>::epsilon();
+
+    T c2, c3;
+    for (unsigned i = 0; i < max_iter; ++i) {
+        const auto z = alpha * chi * chi;
+        std::tie(c2, c3) = kep_stumpff(z);
+
+        const auto u0 = 1 - z * c2;
+        const auto u1 = chi * (1 - z * c3);
+        const auto u2 = chi * chi * c2;
+        const auto u3 = chi * chi * chi * c3;
+
+        // Kepler's equation and its first two derivatives.
+        const auto F = r0n * u1 + sigma0 * u2 + u3 - sqrt_mu * dt;
+        const auto dF = r0n * u0 + sigma0 * u1 + u2;
+        const auto ddF = sigma0 * u0 + (1 - alpha * r0n) * u1;
+
+        // NOTE: Laguerre's method with n = 5.
+        const auto disc = sqrt(abs(16 * dF * dF - 20 * F * ddF));
+        const auto delta = 5 * F / (dF >= 0 ? dF + disc : dF - disc);
+
+        chi -= delta;
+
+        if (!isfinite(chi) || abs(delta) <= tol * abs(chi)) {
+            break;
+        }
+    }
+
+    // Compute the Lagrange coefficients.
+    const auto z = alpha * chi * chi;
+    std::tie(c2, c3) = kep_stumpff(z);
+
+    const auto u0 = 1 - z * c2;
+    const auto u1 = chi * (1 - z * c3);
+    const auto u2 = chi * chi * c2;
+
+    const auto r = r0n * u0 + sigma0 * u1 + u2;
+
+    const auto f = 1 - u2 / r0n;
+    const auto g = (r0n * u1 + sigma0 * u2) / sqrt_mu;
+    const auto fdot = -sqrt_mu * u1 / (r * r0n);
+    const auto gdot = 1 - u2 / r;
+
+    auto finite = true;
+    for (std::uint32_t i = 0; i < 3u; ++i) {
+        out[i * stride] = f * r0[i] + g * v0[i];
+        out[(i + 3u) * stride] = fdot * r0[i] + gdot * v0[i];
+
+        finite = finite && isfinite(out[i * stride]) && isfinite(out[(i + 3u) * stride]);
+    }
+
+    return finite;
+}
+
+template <typename T>
+void kep_check_mu(const T &mu, const char *cls)
+{
+    using std::isfinite;
+    using namespace fmt::literals;
+
+    if (!isfinite(mu) || mu <= 0) {
+        throw std::invalid_argument("The gravitational parameter of a Keplerian propagator{} must be finite and "
+                                    "positive, but it is {} instead"_format(cls, mu));
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+kepler_propagator<T>::kepler_propagator(private_ctor_t, std::vector<T> state, T mu, T time)
+    : m_state(std::move(state)), m_mu(mu), m_time(time), m_d_output(6)
+{
+    using namespace fmt::literals;
+
+    if (m_state.size() != 6u) {
+        throw std::invalid_argument("Invalid state vector passed to the constructor of a Keplerian propagator: the "
+                                    "expected size is 6, but the actual size is {}"_format(m_state.size()));
+    }
+
+    detail::kep_check_mu(m_mu, "");
+}
+
+// NOTE: the default propagator is a circular orbit
+// with unitary radius and gravitational parameter.
+template <typename T>
+kepler_propagator<T>::kepler_propagator()
+    : kepler_propagator(private_ctor_t{}, std::vector<T>{T(1), T(0), T(0), T(0), T(1), T(0)}, T(1), T(0))
+{
+}
+
+template <typename T>
+kepler_propagator<T>::kepler_propagator(const kepler_propagator &) = default;
+
+template <typename T>
+kepler_propagator<T>::kepler_propagator(kepler_propagator &&) noexcept = default;
+
+template <typename T>
+kepler_propagator<T> &kepler_propagator<T>::operator=(const kepler_propagator &) = default;
+
+template <typename T>
+kepler_propagator<T> &kepler_propagator<T>::operator=(kepler_propagator &&) noexcept = default;
+
+template <typename T>
+kepler_propagator<T>::~kepler_propagator() = default;
+
+template <typename T>
+T kepler_propagator<T>::get_mu() const
+{
+    return m_mu;
+}
+
+template <typename T>
+std::uint32_t kepler_propagator<T>::get_dim() const
+{
+    return 6;
+}
+
+template <typename T>
+taylor_outcome kepler_propagator<T>::propagate_until_impl(const detail::dfloat<T> &t)
+{
+    using std::isfinite;
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of a Keplerian "
+                                    "propagator");
+    }
+
+    std::array<T, 6> new_state{};
+    if (!detail::kep_propagate(new_state.data(), m_state.data(), 1, m_mu, static_cast<T>(t - m_time))) {
+        return taylor_outcome::err_nf_state;
+    }
+
+    std::copy(new_state.begin(), new_state.end(), m_state.begin());
+    m_time = t;
+
+    return taylor_outcome::time_limit;
+}
+
+template <typename T>
+taylor_outcome kepler_propagator<T>::propagate_until(T t)
+{
+    return propagate_until_impl(detail::dfloat<T>(t));
+}
+
+template <typename T>
+taylor_outcome kepler_propagator<T>::propagate_for(T delta_t)
+{
+    return propagate_until_impl(m_time + delta_t);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, std::vector<T>> kepler_propagator<T>::propagate_grid(std::vector<T> grid)
+{
+    using std::isfinite;
+
+    if (grid.empty()) {
+        throw std::invalid_argument("Cannot invoke propagate_grid() in a Keplerian propagator if the time grid is "
+                                    "empty");
+    }
+
+    if (std::any_of(grid.begin(), grid.end(), [](const T &t) { return !isfinite(t); })) {
+        throw std::invalid_argument("A non-finite time value was passed to propagate_grid() in a Keplerian "
+                                    "propagator");
+    }
+
+    // NOTE: each grid point is computed from the current state,
+    // so that the errors do not accumulate along the grid.
+    std::vector<T> retval;
+    retval.resize(boost::numeric_cast<decltype(retval.size())>(grid.size() * 6u));
+
+    for (decltype(grid.size()) i = 0; i < grid.size(); ++i) {
+        if (!detail::kep_propagate(retval.data() + i * 6u, m_state.data(), 1, m_mu,
+                                   static_cast<T>(grid[i] - m_time))) {
+            // NOTE: in case of failure, the state is updated
+            // to the last valid grid point, if any.
+            retval.resize(i * 6u);
+            if (i > 0u) {
+                std::copy(retval.end() - 6, retval.end(), m_state.begin());
+                m_time = detail::dfloat<T>(grid[i - 1u]);
+            }
+
+            return std::tuple{taylor_outcome::err_nf_state, std::move(retval)};
+        }
+    }
+
+    std::copy(retval.end() - 6, retval.end(), m_state.begin());
+    m_time = detail::dfloat<T>(grid.back());
+
+    return std::tuple{taylor_outcome::time_limit, std::move(retval)};
+}
+
+template <typename T>
+const std::vector<T> &kepler_propagator<T>::update_d_output(T t, bool rel_time)
+{
+    using std::isfinite;
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("Cannot compute the dense output of a Keplerian propagator at a non-finite time");
+    }
+
+    detail::kep_propagate(m_d_output.data(), m_state.data(), 1, m_mu, rel_time ? t : static_cast<T>(t - m_time));
+
+    return m_d_output;
+}
+
+template class kepler_propagator<double>;
+template class kepler_propagator<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class kepler_propagator<mppp::real128>;
+
+#endif
+
+template <typename T>
+kepler_propagator_batch<T>::kepler_propagator_batch(private_ctor_t, std::vector<T> state, T mu,
+                                                    std::uint32_t batch_size, std::vector<T> time)
+    : m_batch_size(batch_size), m_state(std::move(state)), m_mu(mu), m_time_hi(std::move(time)),
+      m_time_lo(m_time_hi.size()), m_d_output(m_state.size()),
+      m_prop_res(m_time_hi.size(), taylor_outcome::time_limit)
+{
+    using namespace fmt::literals;
+
+    if (m_batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a Keplerian propagator cannot be zero");
+    }
+
+    if (m_state.size() != 6u * static_cast<decltype(m_state.size())>(m_batch_size)) {
+        throw std::invalid_argument(
+            "Invalid state vector passed to the constructor of a Keplerian propagator in batch mode: the expected "
+            "size is {}, but the actual size is {}"_format(6u * static_cast<decltype(m_state.size())>(m_batch_size),
+                                                           m_state.size()));
+    }
+
+    if (m_time_hi.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid vector of initial times passed to the constructor of a Keplerian "
+                                    "propagator in batch mode: the expected size is {}, but the actual size is "
+                                    "{}"_format(m_batch_size, m_time_hi.size()));
+    }
+
+    detail::kep_check_mu(m_mu, " in batch mode");
+}
+
+template <typename T>
+kepler_propagator_batch<T>::kepler_propagator_batch()
+    : kepler_propagator_batch(private_ctor_t{}, std::vector<T>{T(1), T(0), T(0), T(0), T(1), T(0)}, T(1), 1,
+                              std::vector<T>{T(0)})
+{
+}
+
+template <typename T>
+kepler_propagator_batch<T>::kepler_propagator_batch(const kepler_propagator_batch &) = default;
+
+template <typename T>
+kepler_propagator_batch<T>::kepler_propagator_batch(kepler_propagator_batch &&) noexcept = default;
+
+template <typename T>
+kepler_propagator_batch<T> &kepler_propagator_batch<T>::operator=(const kepler_propagator_batch &) = default;
+
+template <typename T>
+kepler_propagator_batch<T> &kepler_propagator_batch<T>::operator=(kepler_propagator_batch &&) noexcept = default;
+
+template <typename T>
+kepler_propagator_batch<T>::~kepler_propagator_batch() = default;
+
+template <typename T>
+std::uint32_t kepler_propagator_batch<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+template <typename T>
+T kepler_propagator_batch<T>::get_mu() const
+{
+    return m_mu;
+}
+
+template <typename T>
+std::uint32_t kepler_propagator_batch<T>::get_dim() const
+{
+    return 6;
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::set_time(const std::vector<T> &new_time)
+{
+    using namespace fmt::literals;
+
+    if (new_time.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid number of new times specified in a Keplerian propagator in batch mode: "
+                                    "the new time vector has a size of {}, but the batch size is "
+                                    "{}"_format(new_time.size(), m_batch_size));
+    }
+
+    std::copy(new_time.begin(), new_time.end(), m_time_hi.begin());
+    std::fill(m_time_lo.begin(), m_time_lo.end(), T(0));
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::set_time(std::uint32_t idx, T new_time)
+{
+    using namespace fmt::literals;
+
+    if (idx >= m_batch_size) {
+        throw std::invalid_argument("Cannot set the time of the batch element at index {} in a Keplerian propagator "
+                                    "in batch mode: the batch size is only {}"_format(idx, m_batch_size));
+    }
+
+    m_time_hi[idx] = new_time;
+    m_time_lo[idx] = 0;
+}
+
+template <typename T>
+detail::dfloat<T> kepler_propagator_batch<T>::get_dtime(std::uint32_t i) const
+{
+    return detail::dfloat<T>(m_time_hi[i], m_time_lo[i]);
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::propagate_until_impl(const std::vector<detail::dfloat<T>> &ts)
+{
+    using std::isfinite;
+
+    assert(ts.size() == m_batch_size);
+
+    if (std::any_of(ts.begin(), ts.end(), [](const auto &t) { return !isfinite(t); })) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of a Keplerian "
+                                    "propagator in batch mode");
+    }
+
+    std::array<T, 6> new_state{};
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        if (!detail::kep_propagate(new_state.data(), m_state.data() + i, m_batch_size, m_mu,
+                                   static_cast<T>(ts[i] - get_dtime(i)))) {
+            m_prop_res[i] = taylor_outcome::err_nf_state;
+            continue;
+        }
+
+        for (std::uint32_t j = 0; j < 6u; ++j) {
+            m_state[j * m_batch_size + i] = new_state[j];
+        }
+        m_time_hi[i] = ts[i].hi;
+        m_time_lo[i] = ts[i].lo;
+        m_prop_res[i] = taylor_outcome::time_limit;
+    }
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::propagate_until(const std::vector<T> &ts)
+{
+    using namespace fmt::literals;
+
+    if (ts.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid number of time limits specified in a Keplerian propagator in batch mode: "
+                                    "the batch size is {}, but the number of specified time limits is "
+                                    "{}"_format(m_batch_size, ts.size()));
+    }
+
+    std::vector<detail::dfloat<T>> dts;
+    for (const auto &t : ts) {
+        dts.emplace_back(t);
+    }
+
+    propagate_until_impl(dts);
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::propagate_until(T t)
+{
+    propagate_until(std::vector<T>(static_cast<typename std::vector<T>::size_type>(m_batch_size), t));
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::propagate_for(const std::vector<T> &delta_ts)
+{
+    using namespace fmt::literals;
+
+    if (delta_ts.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid number of time intervals specified in a Keplerian propagator in batch "
+                                    "mode: the batch size is {}, but the number of specified time intervals is "
+                                    "{}"_format(m_batch_size, delta_ts.size()));
+    }
+
+    std::vector<detail::dfloat<T>> dts;
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        dts.push_back(get_dtime(i) + delta_ts[i]);
+    }
+
+    propagate_until_impl(dts);
+}
+
+template <typename T>
+void kepler_propagator_batch<T>::propagate_for(T delta_t)
+{
+    propagate_for(std::vector<T>(static_cast<typename std::vector<T>::size_type>(m_batch_size), delta_t));
+}
+
+template <typename T>
+std::vector<T> kepler_propagator_batch<T>::propagate_grid(std::vector<T> grid)
+{
+    using std::isfinite;
+    using namespace fmt::literals;
+
+    if (grid.empty()) {
+        throw std::invalid_argument("Cannot invoke propagate_grid() in a Keplerian propagator in batch mode if the "
+                                    "time grid is empty");
+    }
+
+    if (grid.size() % m_batch_size != 0u) {
+        throw std::invalid_argument(
+            "Invalid grid size detected in propagate_grid() for a Keplerian propagator in batch mode: the grid has a "
+            "size of {}, which is not a multiple of the batch size ({})"_format(grid.size(), m_batch_size));
+    }
+
+    if (std::any_of(grid.begin(), grid.end(), [](const T &t) { return !isfinite(t); })) {
+        throw std::invalid_argument("A non-finite time value was passed to propagate_grid() in a Keplerian "
+                                    "propagator in batch mode");
+    }
+
+    const auto n_points = grid.size() / m_batch_size;
+
+    std::vector<T> retval;
+    retval.resize(boost::numeric_cast<decltype(retval.size())>(grid.size() * 6u));
+
+    // NOTE: as in the scalar propagator, each grid point
+    // is computed from the current state.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_prop_res[i] = taylor_outcome::time_limit;
+
+        for (decltype(grid.size()) j = 0; j < n_points; ++j) {
+            auto *out = retval.data() + j * 6u * m_batch_size + i;
+
+            if (!detail::kep_propagate(out, m_state.data() + i, m_batch_size, m_mu,
+                                       static_cast<T>(grid[j * m_batch_size + i] - get_dtime(i)))) {
+                m_prop_res[i] = taylor_outcome::err_nf_state;
+
+                // NOTE: the remaining outputs of the
+                // batch element are set to NaN.
+                for (auto k = j; k < n_points; ++k) {
+                    for (std::uint32_t l = 0; l < 6u; ++l) {
+                        retval[k * 6u * m_batch_size + l * m_batch_size + i] = std::numeric_limits<T>::quiet_NaN();
+                    }
+                }
+
+                break;
+            }
+        }
+
+        // Update the state and time of the batch element
+        // if all the grid points were computed successfully.
+        if (m_prop_res[i] == taylor_outcome::time_limit) {
+            for (std::uint32_t l = 0; l < 6u; ++l) {
+                m_state[l * m_batch_size + i] = retval[(n_points - 1u) * 6u * m_batch_size + l * m_batch_size + i];
+            }
+            m_time_hi[i] = grid[(n_points - 1u) * m_batch_size + i];
+            m_time_lo[i] = 0;
+        }
+    }
+
+    return retval;
+}
+
+template <typename T>
+const std::vector<T> &kepler_propagator_batch<T>::update_d_output(const std::vector<T> &ts, bool rel_time)
+{
+    using std::isfinite;
+    using namespace fmt::literals;
+
+    if (ts.size() != m_batch_size) {
+        throw std::invalid_argument("Invalid number of time coordinates specified for the dense output in a "
+                                    "Keplerian propagator in batch mode: the batch size is {}, but the number of "
+                                    "time coordinates is {}"_format(m_batch_size, ts.size()));
+    }
+
+    if (std::any_of(ts.begin(), ts.end(), [](const T &t) { return !isfinite(t); })) {
+        throw std::invalid_argument("Cannot compute the dense output of a Keplerian propagator in batch mode at a "
+                                    "non-finite time");
+    }
+
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        detail::kep_propagate(m_d_output.data() + i, m_state.data() + i, m_batch_size, m_mu,
+                              rel_time ? ts[i] : static_cast<T>(ts[i] - get_dtime(i)));
+    }
+
+    return m_d_output;
+}
+
+template class kepler_propagator_batch<double>;
+template class kepler_propagator_batch<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class kepler_propagator_batch<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -6,21 +6,34 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <initializer_list>
 #include <ios>
 #include <iostream>
+#include <iterator>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <ostream>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -32,11 +45,16 @@
 
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringRef.h>
 #include <llvm/ADT/Triple.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/CodeGen/TargetPassConfig.h>
 #include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/JITEventListener.h>
 #include <llvm/ExecutionEngine/JITSymbol.h>
 #include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/Core.h>
@@ -44,8 +62,13 @@
 #include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
 #include <llvm/ExecutionEngine/Orc/ObjectTransformLayer.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/RuntimeDyld.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <llvm/IR/Attributes.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstrTypes.h>
@@ -55,17 +78,24 @@
 #include <llvm/IR/Operator.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Verifier.h>
-#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
 #include <llvm/Pass.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Support/Error.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SHA1.h>
 #include <llvm/Support/SmallVectorMemoryBuffer.h>
-#include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 #include <llvm/Transforms/Vectorize.h>
 
 #if LLVM_VERSION_MAJOR == 10
@@ -74,7 +104,18 @@
 
 #endif
 
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#endif
+
+#include <heyoka/config.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
+#include <heyoka/detail/logging_impl.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/detail/s11n.hpp>
+#include <heyoka/detail/tracing.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/variable.hpp>
@@ -147,11 +188,637 @@ const target_features &get_target_features()
     return retval;
 }
 
+// Helper to create a target machine builder for the host system,
+// optionally targeting the CPU cpu instead of the host CPU.
+// If features is not empty, the features of the target CPU
+// will be replaced by features.
+llvm::orc::JITTargetMachineBuilder make_jtmb(const std::string &cpu, const std::string &features = "")
+{
+    // NOTE: the detection of the host CPU and of its features
+    // is relatively expensive, thus it is done only once
+    // and the result is copied.
+    static const auto host_jtmb = []() {
+        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+        // LCOV_EXCL_START
+        if (!jtmb) {
+            throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
+        }
+        // LCOV_EXCL_STOP
+
+        return std::move(*jtmb);
+    }();
+
+    auto jtmb = host_jtmb;
+
+    if (!cpu.empty()) {
+        // NOTE: reset the features detected on the host, so that
+        // they are inferred from the target CPU instead.
+        jtmb.setCPU(cpu);
+        jtmb.getFeatures() = llvm::SubtargetFeatures(features);
+    }
+
+    return jtmb;
+}
+
+// Check whether the object code generated for the given
+// target CPU and features can run on the host machine.
+// NOTE: the comparison is made on the full feature bitsets,
+// which may contain also tuning flags. Thus, this check may
+// be overly conservative when the target CPU differs from
+// the host CPU.
+bool target_host_compatible(const std::string &cpu, const std::string &features)
+{
+    // NOTE: the properties of the host target
+    // machine are computed only once.
+    static const auto host_data = []() {
+        auto host_tm = make_jtmb("").createTargetMachine();
+        // LCOV_EXCL_START
+        if (!host_tm) {
+            throw std::invalid_argument("Error creating the target machine");
+        }
+        // LCOV_EXCL_STOP
+
+        return std::tuple{(*host_tm)->getTargetCPU().str(), (*host_tm)->getTargetFeatureString().str(),
+                          (*host_tm)->getMCSubtargetInfo()->getFeatureBits()};
+    }();
+
+    const auto &[host_cpu, host_features, host_bits] = host_data;
+
+    // Fast path: the object code was generated for the host CPU.
+    if (cpu == host_cpu && features == host_features) {
+        return true;
+    }
+
+    auto tm = make_jtmb(cpu, features).createTargetMachine();
+    // LCOV_EXCL_START
+    if (!tm) {
+        throw std::invalid_argument("Error creating the target machine");
+    }
+    // LCOV_EXCL_STOP
+
+    const auto &bits = (*tm)->getMCSubtargetInfo()->getFeatureBits();
+
+    return (bits & ~host_bits).none();
+}
+
+// Prefix identifying the object code of a module
+// which was split into multiple parts during compilation.
+constexpr char multi_obj_prefix[] = "heyoka multi-object code\n";
+
+bool is_multi_object_code(const std::string &oc)
+{
+    return boost::starts_with(oc, multi_obj_prefix);
+}
+
+// Pack the object files in objs into a single string.
+std::string pack_object_code(const std::vector<std::string> &objs)
+{
+    std::ostringstream oss;
+    oss.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+    oss << multi_obj_prefix;
+    s11n_save_size(oss, objs.size());
+    for (const auto &obj : objs) {
+        s11n_save(oss, obj);
+    }
+
+    return oss.str();
+}
+
+// Unpack the object files from the string oc.
+std::vector<std::string> unpack_object_code(const std::string &oc)
+{
+    assert(is_multi_object_code(oc));
+
+    std::istringstream iss(oc.substr(sizeof(multi_obj_prefix) - 1u));
+    iss.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+    std::vector<std::string> retval;
+    retval.resize(s11n_load_size<decltype(retval.size())>(iss));
+    for (auto &obj : retval) {
+        s11n_load(iss, obj);
+    }
+
+    return retval;
+}
+
+// Estimate the memory allocated by the jit for the object code oc.
+// This is the total size of the code and data
+// sections of the object files in oc.
+std::size_t object_code_jit_size(const std::string &oc)
+{
+    auto obj_size = [](const std::string &obj) -> std::size_t {
+        auto ret = llvm::object::ObjectFile::createObjectFile(llvm::MemoryBufferRef(obj, "heyoka_object_code"));
+        // LCOV_EXCL_START
+        if (!ret) {
+            llvm::consumeError(ret.takeError());
+
+            return 0;
+        }
+        // LCOV_EXCL_STOP
+
+        std::size_t retval = 0;
+        for (const auto &sec : (*ret)->sections()) {
+            if (sec.isText() || sec.isData() || sec.isBSS()) {
+                retval += static_cast<std::size_t>(sec.getSize());
+            }
+        }
+
+        return retval;
+    };
+
+    if (is_multi_object_code(oc)) {
+        std::size_t retval = 0;
+        for (const auto &obj : unpack_object_code(oc)) {
+            retval += obj_size(obj);
+        }
+
+        return retval;
+    } else {
+        return obj_size(oc);
+    }
+}
+
+// Serialise the module m as bitcode.
+std::string module_to_bc(const llvm::Module &m)
+{
+    std::string bc;
+    llvm::raw_string_ostream ostr(bc);
+    llvm::WriteBitcodeToFile(m, ostr);
+    ostr.flush();
+
+    return bc;
+}
+
+// Parse the bitcode bc into a new module called name in the context ctx.
+// err_prefix is the beginning of the error message in case of failure.
+std::unique_ptr<llvm::Module> bc_to_module(const std::string &bc, const std::string &name, llvm::LLVMContext &ctx,
+                                           const char *err_prefix)
+{
+    using namespace fmt::literals;
+
+    // NOTE: the name of the buffer becomes the name of the module.
+    auto ret = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bc, name), ctx);
+    // LCOV_EXCL_START
+    if (!ret) {
+        throw std::invalid_argument(
+            "{}. The full error message:\n{}"_format(err_prefix, llvm::toString(ret.takeError())));
+    }
+    // LCOV_EXCL_STOP
+
+    return std::move(*ret);
+}
+
+// Generate the object code for the module m in parallel. m is split
+// into n_parts modules, which are compiled concurrently for the target CPU
+// target_cpu. The object code is returned in packed form.
+std::string parallel_codegen(std::unique_ptr<llvm::Module> m, unsigned n_parts, const std::string &target_cpu)
+{
+    using namespace fmt::literals;
+
+    assert(n_parts > 1u);
+
+    // Split the module and serialise the parts as bitcode.
+    // NOTE: the parts share the LLVM context of m, which cannot
+    // be used concurrently from multiple threads. Thus, each part
+    // is later parsed in a separate context.
+    std::vector<std::string> bcs;
+    auto split_cb = [&bcs](std::unique_ptr<llvm::Module> part) { bcs.push_back(module_to_bc(*part)); };
+
+#if LLVM_VERSION_MAJOR >= 13
+    llvm::SplitModule(*m, n_parts, split_cb);
+#else
+    llvm::SplitModule(std::move(m), n_parts, split_cb);
+#endif
+
+    std::vector<std::string> objs(bcs.size());
+
+    parallel_for(bcs.size(), n_parts, [&bcs, &objs, &target_cpu](std::size_t b, std::size_t e, unsigned) {
+        for (auto i = b; i < e; ++i) {
+            llvm::LLVMContext ctx;
+
+            auto part = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bcs[i], "part"), ctx);
+            // LCOV_EXCL_START
+            if (!part) {
+                throw std::invalid_argument(
+                    "Error parsing the bitcode of a module part during parallel compilation. The full error "
+                    "message:\n{}"_format(llvm::toString(part.takeError())));
+            }
+            // LCOV_EXCL_STOP
+
+            auto jtmb = make_jtmb(target_cpu);
+            jtmb.setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+
+            auto tm = jtmb.createTargetMachine();
+            // LCOV_EXCL_START
+            if (!tm) {
+                throw std::invalid_argument("Error creating the target machine");
+            }
+            // LCOV_EXCL_STOP
+
+            llvm::SmallVector<char, 0> buffer;
+            llvm::raw_svector_ostream ostr(buffer);
+
+            llvm::legacy::PassManager pm;
+            // LCOV_EXCL_START
+            if ((*tm)->addPassesToEmitFile(pm, ostr, nullptr, llvm::CGFT_ObjectFile)) {
+                throw std::invalid_argument("The target machine cannot emit object code");
+            }
+            // LCOV_EXCL_STOP
+
+            pm.run(**part);
+
+            objs[i].assign(buffer.begin(), buffer.end());
+        }
+    });
+
+    return pack_object_code(objs);
+}
+
 namespace
 {
 
 std::once_flag nt_inited;
 
+// Helper to construct the path of the file
+// associated to key in the cache directory dir.
+std::string disk_cache_path(const std::string &dir, const std::string &key)
+{
+    return dir + "/" + key + ".o";
+}
+
+// Fetch from the persistent cache in the directory dir the object
+// code associated to key. If the object code is not in the cache,
+// or if it cannot be read, an empty optional will be returned.
+std::optional<std::string> disk_cache_load(const std::string &dir, const std::string &key)
+{
+    std::ifstream ifs(disk_cache_path(dir, key), std::ios_base::in | std::ios_base::binary);
+    if (!ifs) {
+        return {};
+    }
+
+    std::string retval{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    // LCOV_EXCL_START
+    if (ifs.bad() || retval.empty()) {
+        get_logger()->warn("could not read the object file '{}' from the persistent cache",
+                           disk_cache_path(dir, key));
+        return {};
+    }
+    // LCOV_EXCL_STOP
+
+    return retval;
+}
+
+// Store the object code oc associated to key in the
+// persistent cache in the directory dir.
+// NOTE: failures are logged but otherwise ignored,
+// as the cache is only an optimisation.
+void disk_cache_store(const std::string &dir, const std::string &key, const std::string &oc)
+{
+    using namespace fmt::literals;
+
+    const auto path = disk_cache_path(dir, key);
+
+    // NOTE: write first to a temporary file and then rename it,
+    // so that concurrent readers (possibly in other processes)
+    // never see a partially-written object file.
+    const auto tmp_path = "{}.tmp{}"_format(path, std::random_device{}());
+
+    {
+        std::ofstream ofs(tmp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        ofs.write(oc.data(), boost::numeric_cast<std::streamsize>(oc.size()));
+        ofs.close();
+
+        if (!ofs) {
+            get_logger()->warn("could not write the object file '{}' to the persistent cache", path);
+            std::remove(tmp_path.c_str());
+            return;
+        }
+    }
+
+    // NOTE: on some platforms the renaming fails if the
+    // destination exists, e.g., if another process already
+    // stored the same object file in the meantime.
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str()); // LCOV_EXCL_LINE
+    }
+}
+
+// The in-memory cache of object code.
+struct mem_cache_t {
+    std::mutex mutex;
+    // List of (key, object code) pairs, ordered
+    // from the most recently used to the least
+    // recently used.
+    std::list<std::pair<std::string, std::string>> lru_list;
+    // Map from the keys to the elements of lru_list.
+    std::unordered_map<std::string, decltype(lru_list)::iterator> lru_map;
+    // Total size (in bytes) of the object code
+    // in the cache.
+    std::size_t size = 0;
+    // Size limit (defaults to 2GiB).
+    std::size_t limit = 2ull * 1024u * 1024u * 1024u;
+    // Hit/miss counters.
+    unsigned long long n_hits = 0, n_misses = 0;
+
+    // Remove the least recently used entries
+    // until the size limit is respected.
+    // NOTE: this must be invoked with the mutex locked.
+    void trim()
+    {
+        while (size > limit) {
+            assert(!lru_list.empty());
+
+            const auto &back = lru_list.back();
+            size -= back.second.size();
+            lru_map.erase(back.first);
+            lru_list.pop_back();
+        }
+    }
+};
+
+mem_cache_t &get_mem_cache()
+{
+    static mem_cache_t mc;
+
+    return mc;
+}
+
+// Look up in the in-memory cache the object code associated to key.
+std::optional<std::string> mem_cache_lookup(const std::string &key)
+{
+    auto &mc = get_mem_cache();
+
+    std::optional<std::string> retval;
+    unsigned long long n_hits = 0, n_misses = 0;
+
+    {
+        std::lock_guard lock(mc.mutex);
+
+        if (const auto it = mc.lru_map.find(key); it != mc.lru_map.end()) {
+            // Move the entry to the front of the list.
+            mc.lru_list.splice(mc.lru_list.begin(), mc.lru_list, it->second);
+            retval.emplace(it->second->second);
+            ++mc.n_hits;
+        } else {
+            ++mc.n_misses;
+        }
+
+        n_hits = mc.n_hits;
+        n_misses = mc.n_misses;
+    }
+
+    SPDLOG_LOGGER_DEBUG(get_logger(), "in-memory cache {} (hits: {}, misses: {})", retval ? "hit" : "miss", n_hits,
+                        n_misses);
+
+    return retval;
+}
+
+// Insert into the in-memory cache the object code oc associated to key.
+void mem_cache_insert(std::string key, const std::string &oc)
+{
+    auto &mc = get_mem_cache();
+
+    std::lock_guard lock(mc.mutex);
+
+    // NOTE: another thread may have inserted
+    // the same key in the meantime. Also, don't
+    // insert object code exceeding the size limit.
+    if (mc.lru_map.count(key) != 0u || oc.size() > mc.limit) {
+        return;
+    }
+
+    mc.lru_list.emplace_front(std::move(key), oc);
+    try {
+        mc.lru_map.emplace(mc.lru_list.front().first, mc.lru_list.begin());
+    } catch (...) {
+        // LCOV_EXCL_START
+        mc.lru_list.pop_front();
+        throw;
+        // LCOV_EXCL_STOP
+    }
+    mc.size += oc.size();
+
+    mc.trim();
+}
+
+} // namespace
+
+} // namespace detail
+
+namespace detail
+{
+
+namespace
+{
+
+#if defined(__linux__)
+
+// JIT event listener writing the addresses of the jitted functions
+// into the perf map file /tmp/perf-<pid>.map, which is read by perf
+// in order to symbolize the JIT code.
+class perf_map_listener final : public llvm::JITEventListener
+{
+    std::mutex m_mutex;
+    std::ofstream m_ofs;
+
+public:
+    perf_map_listener()
+    {
+        using namespace fmt::literals;
+
+        const auto path = "/tmp/perf-{}.map"_format(::getpid());
+
+        m_ofs.open(path, std::ios_base::out | std::ios_base::app);
+        // LCOV_EXCL_START
+        if (!m_ofs) {
+            throw std::invalid_argument("Unable to open the perf map file '{}'"_format(path));
+        }
+        // LCOV_EXCL_STOP
+    }
+
+    void notifyObjectLoaded(ObjectKey, const llvm::object::ObjectFile &obj,
+                            const llvm::RuntimeDyld::LoadedObjectInfo &info) override
+    {
+        // NOTE: in the debug object, the addresses of
+        // the symbols are the load addresses.
+        const auto dbg_obj = info.getObjectForDebug(obj);
+        // LCOV_EXCL_START
+        if (dbg_obj.getBinary() == nullptr) {
+            return;
+        }
+        // LCOV_EXCL_STOP
+
+        std::lock_guard lock(m_mutex);
+
+        for (const auto &[sym, size] : llvm::object::computeSymbolSizes(*dbg_obj.getBinary())) {
+            auto type = sym.getType();
+            if (!type) {
+                llvm::consumeError(type.takeError()); // LCOV_EXCL_LINE
+                continue;                             // LCOV_EXCL_LINE
+            }
+            if (*type != llvm::object::SymbolRef::ST_Function) {
+                continue;
+            }
+
+            auto name = sym.getName();
+            if (!name) {
+                llvm::consumeError(name.takeError()); // LCOV_EXCL_LINE
+                continue;                             // LCOV_EXCL_LINE
+            }
+
+            auto addr = sym.getAddress();
+            if (!addr) {
+                llvm::consumeError(addr.takeError()); // LCOV_EXCL_LINE
+                continue;                             // LCOV_EXCL_LINE
+            }
+
+            // NOTE: the format of each line is "START SIZE NAME",
+            // with the start address and the size in hexadecimal.
+            m_ofs << std::hex << *addr << ' ' << size << std::dec << ' ' << name->str() << '\n';
+        }
+
+        m_ofs.flush();
+    }
+};
+
+#endif
+
+// Fetch the JIT event listeners requested via the HEYOKA_JIT_LISTENERS
+// environment variable, which contains a comma-separated list of:
+// - 'gdb', for the registration of the JIT code with GDB,
+// - 'perf', for the perf map file (Linux only),
+// - 'jitdump', for perf's jitdump files (requires LLVM to be built with perf support),
+// - 'intel', for Intel VTune (requires LLVM to be built with Intel JIT events support).
+// Listeners which are not available are ignored with a warning.
+// NOTE: the environment variable is read upon the creation of each jit, while
+// the listeners are created once and shared by all the jits.
+std::vector<llvm::JITEventListener *> get_jit_listeners()
+{
+    using namespace fmt::literals;
+
+    std::vector<llvm::JITEventListener *> retval;
+
+    const auto *env = std::getenv("HEYOKA_JIT_LISTENERS");
+    if (env == nullptr) {
+        return retval;
+    }
+
+    llvm::SmallVector<llvm::StringRef, 4> names;
+    llvm::StringRef(env).split(names, ',', -1, false);
+
+    for (auto name : names) {
+        name = name.trim();
+
+        llvm::JITEventListener *l = nullptr;
+
+        if (name == "gdb") {
+            static auto *const gdb_l = llvm::JITEventListener::createGDBRegistrationListener();
+            l = gdb_l;
+        } else if (name == "perf") {
+#if defined(__linux__)
+            static perf_map_listener perf_l;
+            l = &perf_l;
+#endif
+        } else if (name == "jitdump") {
+            static auto *const jitdump_l = llvm::JITEventListener::createPerfJITEventListener();
+            l = jitdump_l;
+        } else if (name == "intel") {
+            static auto *const intel_l = llvm::JITEventListener::createIntelJITEventListener();
+            l = intel_l;
+        } else {
+            throw std::invalid_argument(
+                "Invalid JIT event listener '{}' specified in the HEYOKA_JIT_LISTENERS environment variable: the "
+                "valid values are 'gdb', 'perf', 'jitdump' and 'intel'"_format(name.str()));
+        }
+
+        if (l == nullptr) {
+            // LCOV_EXCL_START
+            get_logger()->warn("The JIT event listener '{}' is not available on this platform or in this LLVM "
+                               "build, it will be ignored",
+                               name.str());
+            // LCOV_EXCL_STOP
+        } else if (std::find(retval.begin(), retval.end(), l) == retval.end()) {
+            retval.push_back(l);
+        }
+    }
+
+    return retval;
+}
+
+// Flag to enable the collection of the optimisation remarks.
+std::atomic<bool> opt_remarks_enabled{false};
+
+// The registry of the external symbols added via llvm_state::add_symbol(),
+// mapping the symbol names to their addresses.
+struct ext_symbols_t {
+    std::mutex mutex;
+    std::unordered_map<std::string, void *> map;
+};
+
+ext_symbols_t &get_ext_symbols()
+{
+    static ext_symbols_t es;
+
+    return es;
+}
+
+// Diagnostic handler collecting the optimisation
+// remarks of the vectorisation and inlining passes.
+struct opt_remark_handler final : llvm::DiagnosticHandler {
+    std::vector<llvm_opt_remark> &m_remarks;
+
+    explicit opt_remark_handler(std::vector<llvm_opt_remark> &remarks) : m_remarks(remarks) {}
+
+    static bool is_tracked_pass(llvm::StringRef name)
+    {
+        return name == "slp-vectorizer" || name == "loop-vectorize" || name == "inline";
+    }
+
+    bool isAnalysisRemarkEnabled(llvm::StringRef name) const override
+    {
+        return is_tracked_pass(name);
+    }
+    bool isMissedOptRemarkEnabled(llvm::StringRef name) const override
+    {
+        return is_tracked_pass(name);
+    }
+    bool isPassedOptRemarkEnabled(llvm::StringRef name) const override
+    {
+        return is_tracked_pass(name);
+    }
+    bool isAnyRemarkEnabled() const override
+    {
+        return true;
+    }
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &di) override
+    {
+        const auto *rem = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&di);
+        if (rem == nullptr) {
+            // Not a remark, use the default handling.
+            return false;
+        }
+
+        // NOTE: the remarks of the passes which are not
+        // tracked are discarded.
+        if (rem->isEnabled()) {
+            const auto *kind = rem->isPassed() ? "passed" : (rem->isMissed() ? "missed" : "analysis");
+
+            // NOTE: all the functions in the module are generated by heyoka,
+            // thus the remarks do not need to be filtered further.
+            const auto *loc_rem = llvm::dyn_cast<llvm::DiagnosticInfoWithLocationBase>(rem);
+
+            m_remarks.push_back(llvm_opt_remark{kind, rem->getPassName().str(), rem->getRemarkName().str(),
+                                                loc_rem == nullptr ? std::string{}
+                                                                   : loc_rem->getFunction().getName().str(),
+                                                rem->getMsg()});
+        }
+
+        return true;
+    }
+};
+
 } // namespace
 
 } // namespace detail
@@ -165,8 +832,11 @@ struct llvm_state::jit {
     std::unique_ptr<llvm::Triple> m_triple;
 #endif
     std::optional<std::string> m_object_file;
+    // The names of the external symbols
+    // defined in the jit.
+    std::unordered_set<std::string> m_ext_symbols;
 
-    jit()
+    explicit jit(const std::string &target_cpu)
     {
         // NOTE: the native target initialization needs to be done only once
         std::call_once(detail::nt_inited, []() {
@@ -176,21 +846,42 @@ struct llvm_state::jit {
         });
 
         // Create the target machine builder.
-        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
-        // LCOV_EXCL_START
-        if (!jtmb) {
-            throw std::invalid_argument("Error creating a JITTargetMachineBuilder for the host system");
-        }
-        // LCOV_EXCL_STOP
+        auto jtmb = detail::make_jtmb(target_cpu);
         // Set the codegen optimisation level to aggressive.
-        jtmb->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+        jtmb.setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
 
         // Create the jit builder.
         llvm::orc::LLJITBuilder lljit_builder;
         // NOTE: other settable properties may
         // be of interest:
         // https://www.llvm.org/doxygen/classllvm_1_1orc_1_1LLJITBuilder.html
-        lljit_builder.setJITTargetMachineBuilder(*jtmb);
+        lljit_builder.setJITTargetMachineBuilder(jtmb);
+
+        // Register the JIT event listeners, if requested. In order to do so,
+        // we need to create the object linking layer ourselves.
+        // NOTE: this always uses the RuntimeDyld-based linking layer,
+        // which is the default one on the platforms we support.
+        if (auto listeners = detail::get_jit_listeners(); !listeners.empty()) {
+            lljit_builder.setObjectLinkingLayerCreator(
+                [listeners = std::move(listeners)](llvm::orc::ExecutionSession &es,
+                                                   const llvm::Triple &tt) -> std::unique_ptr<llvm::orc::ObjectLayer> {
+                    auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+                        es, []() { return std::make_unique<llvm::SectionMemoryManager>(); });
+
+                    // NOTE: these settings are taken from the
+                    // default object linking layer of LLJIT.
+                    if (tt.isOSBinFormatCOFF()) {
+                        layer->setOverrideObjectFlagsWithResponsibilityFlags(true);
+                        layer->setAutoClaimResponsibilityForObjectSymbols(true);
+                    }
+
+                    for (auto *l : listeners) {
+                        layer->registerJITEventListener(*l);
+                    }
+
+                    return layer;
+                });
+        }
 
         // Create the jit.
         auto lljit = lljit_builder.create();
@@ -205,10 +896,13 @@ struct llvm_state::jit {
         // when it is lazily generated.
         m_lljit->getObjTransformLayer().setTransform([this](std::unique_ptr<llvm::MemoryBuffer> obj_buffer) {
             assert(obj_buffer);
-            assert(!m_object_file);
 
             // Copy obj_buffer to the local m_object_file member.
-            m_object_file.emplace(obj_buffer->getBufferStart(), obj_buffer->getBufferEnd());
+            // NOTE: the object code has already been recorded
+            // if it was added via add_object_code().
+            if (!m_object_file) {
+                m_object_file.emplace(obj_buffer->getBufferStart(), obj_buffer->getBufferEnd());
+            }
 
             return llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>(std::move(obj_buffer));
         });
@@ -224,8 +918,8 @@ struct llvm_state::jit {
         m_lljit->getMainJITDylib().addGenerator(std::move(*dlsg));
 
         // Keep a target machine around to fetch various
-        // properties of the host CPU.
-        auto tm = jtmb->createTargetMachine();
+        // properties of the target CPU.
+        auto tm = jtmb.createTargetMachine();
         // LCOV_EXCL_START
         if (!tm) {
             throw std::invalid_argument("Error creating the target machine");
@@ -233,13 +927,20 @@ struct llvm_state::jit {
         // LCOV_EXCL_STOP
         m_tm = std::move(*tm);
 
+        if (!target_cpu.empty() && !m_tm->getMCSubtargetInfo()->isCPUStringValid(target_cpu)) {
+            using namespace fmt::literals;
+
+            throw std::invalid_argument("The target CPU '{}' is not valid for the target triple '{}'"_format(
+                target_cpu, m_tm->getTargetTriple().str()));
+        }
+
         // Create the context.
         m_ctx = std::make_unique<llvm::orc::ThreadSafeContext>(std::make_unique<llvm::LLVMContext>());
 
 #if LLVM_VERSION_MAJOR == 10
         // NOTE: on LLVM 10, we cannot fetch the target triple
         // from the lljit class. Thus, we get it from the jtmb instead.
-        m_triple = std::make_unique<llvm::Triple>(jtmb->getTargetTriple());
+        m_triple = std::make_unique<llvm::Triple>(jtmb.getTargetTriple());
 #endif
 
         // NOTE: by default, errors in the execution session are printed
@@ -286,8 +987,57 @@ struct llvm_state::jit {
 #endif
     }
 
+    // Define in the jit the external symbols which have been
+    // registered via llvm_state::add_symbol() and which have not
+    // been defined yet.
+    // NOTE: this is done before adding code to the jit (rather than
+    // upon the creation of the jit), so that the symbols registered
+    // after the creation of an llvm_state (or of the jit instances
+    // in the pool) are available as well.
+    void define_ext_symbols()
+    {
+        llvm::orc::SymbolMap smap;
+
+        {
+            auto &es = detail::get_ext_symbols();
+
+            std::lock_guard lock(es.mutex);
+
+            for (const auto &[name, addr] : es.map) {
+                if (m_ext_symbols.insert(name).second) {
+                    smap[m_lljit->mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(
+                        llvm::pointerToJITTargetAddress(addr),
+                        llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+                }
+            }
+        }
+
+        if (smap.empty()) {
+            return;
+        }
+
+        auto err = m_lljit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(smap)));
+
+        // LCOV_EXCL_START
+        if (err) {
+            using namespace fmt::literals;
+
+            std::string err_report;
+            llvm::raw_string_ostream ostr(err_report);
+
+            ostr << err;
+
+            throw std::invalid_argument(
+                "The definition of the external symbols in the jit failed. The full error message:\n{}"_format(
+                    ostr.str()));
+        }
+        // LCOV_EXCL_STOP
+    }
+
     void add_module(std::unique_ptr<llvm::Module> &&m)
     {
+        define_ext_symbols();
+
         auto err = m_lljit->addIRModule(llvm::orc::ThreadSafeModule(std::move(m), *m_ctx));
 
         // LCOV_EXCL_START
@@ -305,6 +1055,48 @@ struct llvm_state::jit {
         // LCOV_EXCL_STOP
     }
 
+    // Add compiled object code to the jit. The object code
+    // may contain multiple object files in packed form.
+    // err_prefix is the beginning of the error message
+    // in case of failure.
+    void add_object_code(const std::string &oc, const char *err_prefix)
+    {
+        define_ext_symbols();
+
+        auto add_obj = [this, err_prefix](const std::string &obj) {
+            llvm::SmallVector<char, 0> buffer(obj.begin(), obj.end());
+            auto err = m_lljit->addObjectFile(std::make_unique<llvm::SmallVectorMemoryBuffer>(std::move(buffer)));
+
+            // LCOV_EXCL_START
+            if (err) {
+                using namespace fmt::literals;
+
+                std::string err_report;
+                llvm::raw_string_ostream ostr(err_report);
+
+                ostr << err;
+
+                throw std::invalid_argument("{}. The full error message:\n{}"_format(err_prefix, ostr.str()));
+            }
+            // LCOV_EXCL_STOP
+        };
+
+        if (detail::is_multi_object_code(oc)) {
+            for (const auto &obj : detail::unpack_object_code(oc)) {
+                add_obj(obj);
+            }
+        } else {
+            add_obj(oc);
+        }
+
+        // NOTE: record the object code here, as the object
+        // transform layer may not intercept object files added
+        // directly to the jit, or it might intercept only some
+        // of them (as they are materialised lazily).
+        assert(!m_object_file);
+        m_object_file.emplace(oc);
+    }
+
     // Symbol lookup.
     llvm::Expected<llvm::JITEvaluatedSymbol> lookup(const std::string &name)
     {
@@ -312,6 +1104,108 @@ struct llvm_state::jit {
     }
 };
 
+// Pool of pre-initialised jit instances for the host CPU.
+// The pool is refilled by a background thread, so that
+// the construction of an llvm_state does not have to pay
+// for the creation of the jit. A jit is never returned
+// to the pool after use, as it contains the compiled code
+// of its llvm_state.
+// NOTE: the pool is disabled (i.e., its size is zero) by default.
+struct llvm_state::jit_pool {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::unique_ptr<jit>> jits;
+    // The target size of the pool.
+    std::size_t size = 0;
+    bool stop = false;
+    std::thread refill_thread;
+
+    jit_pool() = default;
+    jit_pool(const jit_pool &) = delete;
+    jit_pool(jit_pool &&) = delete;
+    jit_pool &operator=(const jit_pool &) = delete;
+    jit_pool &operator=(jit_pool &&) = delete;
+
+    ~jit_pool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+
+        if (refill_thread.joinable()) {
+            refill_thread.join();
+        }
+    }
+
+    void refill_loop()
+    {
+        while (true) {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this]() { return stop || jits.size() < size; });
+
+            if (stop) {
+                return;
+            }
+
+            // NOTE: create the jit without holding the lock.
+            lock.unlock();
+
+            std::unique_ptr<jit> new_jit;
+            try {
+                new_jit = std::make_unique<jit>("");
+                // LCOV_EXCL_START
+            } catch (const std::exception &e) {
+                // NOTE: if the creation of a jit fails, disable the pool
+                // and let llvm_state create the jit instances instead.
+                detail::get_logger()->warn("The creation of a jit for the pool failed, the pool will be disabled. "
+                                           "The full error message is: {}",
+                                           e.what());
+
+                lock.lock();
+                size = 0;
+                jits.clear();
+                continue;
+            }
+            // LCOV_EXCL_STOP
+
+            lock.lock();
+            if (jits.size() < size) {
+                jits.push_back(std::move(new_jit));
+            }
+        }
+    }
+
+    // Fetch a jit for the target CPU cpu, either from
+    // the pool (if possible) or by creating a new one.
+    std::unique_ptr<jit> fetch(const std::string &cpu)
+    {
+        if (cpu.empty()) {
+            std::unique_lock lock(mutex);
+
+            if (!jits.empty()) {
+                auto retval = std::move(jits.back());
+                jits.pop_back();
+
+                lock.unlock();
+                cv.notify_one();
+
+                return retval;
+            }
+        }
+
+        return std::make_unique<jit>(cpu);
+    }
+
+    static jit_pool &get()
+    {
+        static jit_pool pool;
+
+        return pool;
+    }
+};
+
 // Small shared helper to setup the math flags in the builder at the
 // end of a constructor.
 void llvm_state::ctor_setup_math_flags()
@@ -336,10 +1230,21 @@ void llvm_state::ctor_setup_math_flags()
     m_builder->setFastMathFlags(fmf);
 }
 
-llvm_state::llvm_state(std::tuple<std::string, unsigned, bool, bool> &&tup)
-    : m_jitter(std::make_unique<jit>()), m_opt_level(std::get<1>(tup)), m_fast_math(std::get<2>(tup)),
-      m_module_name(std::move(std::get<0>(tup))), m_inline_functions(std::get<3>(tup))
+llvm_state::llvm_state(
+    std::tuple<std::string, unsigned, bool, bool, std::string, std::string, bool, bool, unsigned> &&tup)
+    : m_jitter(jit_pool::get().fetch(std::get<5>(tup))), m_opt_level(std::get<1>(tup)), m_fast_math(std::get<2>(tup)),
+      m_module_name(std::move(std::get<0>(tup))), m_inline_functions(std::get<3>(tup)),
+      m_cache_dir(std::move(std::get<4>(tup))), m_target_cpu(std::move(std::get<5>(tup))),
+      m_slp_vectorize(std::get<6>(tup)), m_loop_vectorize(std::get<7>(tup)), m_compile_threads(std::get<8>(tup))
 {
+    // If no cache directory was explicitly provided,
+    // try reading it from the environment.
+    if (m_cache_dir.empty()) {
+        if (const auto *env_dir = std::getenv("HEYOKA_CACHE_DIR")) {
+            m_cache_dir = env_dir;
+        }
+    }
+
     // Create the module.
     m_module = std::make_unique<llvm::Module>(m_module_name, context());
     // Setup the data layout and the target triple.
@@ -361,60 +1266,31 @@ llvm_state::llvm_state(const llvm_state &other)
     // NOTE: start off by:
     // - creating a new jit,
     // - copying over the options from other.
-    : m_jitter(std::make_unique<jit>()), m_opt_level(other.m_opt_level), m_fast_math(other.m_fast_math),
-      m_module_name(other.m_module_name), m_inline_functions(other.m_inline_functions)
+    : m_jitter(jit_pool::get().fetch(other.m_target_cpu)), m_opt_level(other.m_opt_level),
+      m_fast_math(other.m_fast_math), m_module_name(other.m_module_name),
+      m_inline_functions(other.m_inline_functions), m_cache_dir(other.m_cache_dir), m_target_cpu(other.m_target_cpu),
+      m_slp_vectorize(other.m_slp_vectorize), m_loop_vectorize(other.m_loop_vectorize),
+      m_compile_threads(other.m_compile_threads)
 {
     using namespace fmt::literals;
 
     if (other.is_compiled() && other.m_jitter->m_object_file) {
         // 'other' was compiled and code was generated.
         // We leave module and builder empty, copy over the
-        // IR snapshot and add the cached compiled module
+        // bitcode snapshot and add the cached compiled module
         // to the jit.
-        m_ir_snapshot = other.m_ir_snapshot;
-
-        llvm::SmallVector<char, 0> buffer(other.m_jitter->m_object_file->begin(), other.m_jitter->m_object_file->end());
-        auto err = m_jitter->m_lljit->addObjectFile(std::make_unique<llvm::SmallVectorMemoryBuffer>(std::move(buffer)));
+        m_bc_snapshot = other.m_bc_snapshot;
 
-        // LCOV_EXCL_START
-        if (err) {
-            std::string err_report;
-            llvm::raw_string_ostream ostr(err_report);
-
-            ostr << err;
-
-            throw std::invalid_argument("The function for adding a compiled module to the jit during the deep copy of "
-                                        "an llvm_state failed. The full error message:\n{}"_format(ostr.str()));
-        }
-        // LCOV_EXCL_STOP
+        m_jitter->add_object_code(*other.m_jitter->m_object_file, "The function for adding a compiled module to the "
+                                                                  "jit during the deep copy of an llvm_state failed");
     } else {
         // 'other' has not been compiled yet, or
         // it has been compiled but no code has been
         // lazily generated yet.
-        // We will fetch its IR and reconstruct
+        // We will fetch its bitcode and reconstruct
         // module and builder.
-
-        // Get the IR of other.
-        auto other_ir = other.get_ir();
-
-        // Create the corresponding memory buffer.
-        auto mb = llvm::MemoryBuffer::getMemBuffer(std::move(other_ir));
-
-        // Construct a new module from the parsed IR.
-        llvm::SMDiagnostic err;
-        m_module = llvm::parseIR(*mb, err, context());
-        // LCOV_EXCL_START
-        if (!m_module) {
-            std::string err_report;
-            llvm::raw_string_ostream ostr(err_report);
-
-            err.print("", ostr);
-
-            throw std::invalid_argument(
-                "Error parsing the IR while deep-copying an llvm_state. The full error message:\n{}"_format(
-                    ostr.str()));
-        }
-        // LCOV_EXCL_STOP
+        m_module = detail::bc_to_module(other.get_bc(), m_module_name, context(),
+                                        "Error parsing the bitcode while deep-copying an llvm_state");
 
         // Create a new builder for the module.
         m_builder = std::make_unique<ir_builder>(context());
@@ -463,17 +1339,32 @@ llvm::LLVMContext &llvm_state::context()
 
 unsigned &llvm_state::opt_level()
 {
-    return m_opt_level;
+    return m_opt_level;
+}
+
+bool &llvm_state::fast_math()
+{
+    return m_fast_math;
+}
+
+bool &llvm_state::inline_functions()
+{
+    return m_inline_functions;
+}
+
+bool &llvm_state::slp_vectorize()
+{
+    return m_slp_vectorize;
 }
 
-bool &llvm_state::fast_math()
+bool &llvm_state::loop_vectorize()
 {
-    return m_fast_math;
+    return m_loop_vectorize;
 }
 
-bool &llvm_state::inline_functions()
+unsigned &llvm_state::compile_threads()
 {
-    return m_inline_functions;
+    return m_compile_threads;
 }
 
 const llvm::Module &llvm_state::module() const
@@ -508,6 +1399,21 @@ const bool &llvm_state::inline_functions() const
     return m_inline_functions;
 }
 
+const bool &llvm_state::slp_vectorize() const
+{
+    return m_slp_vectorize;
+}
+
+const bool &llvm_state::loop_vectorize() const
+{
+    return m_loop_vectorize;
+}
+
+const unsigned &llvm_state::compile_threads() const
+{
+    return m_compile_threads;
+}
+
 void llvm_state::check_uncompiled(const char *f) const
 {
     if (!m_module) {
@@ -566,10 +1472,72 @@ void llvm_state::verify_function(const std::string &name)
     verify_function(f);
 }
 
+// Compute the key of the persistent cache for the IR ir.
+// stage is a string signalling whether the key is being
+// computed before the optimisation or the compilation.
+std::string llvm_state::cache_compute_key(const std::string &bc, const char *stage) const
+{
+    using namespace fmt::literals;
+
+    // NOTE: the key must encode all the information
+    // that can alter the generated object code.
+    auto kdata = "heyoka {}|LLVM {}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{}\n"_format(
+        HEYOKA_VERSION_STRING, LLVM_VERSION_STRING, stage, m_opt_level, m_fast_math, m_inline_functions,
+        m_slp_vectorize, m_loop_vectorize, m_compile_threads, m_jitter->get_target_triple().str(),
+        m_jitter->get_target_cpu(), m_jitter->get_target_features());
+    kdata += bc;
+
+    return llvm::toHex(llvm::SHA1::hash(llvm::arrayRefFromStringRef(kdata)), true);
+}
+
+// Store the generated object code in the persistent cache, if needed.
+void llvm_state::cache_try_store()
+{
+    // NOTE: the object code is generated lazily, thus we
+    // can store it only after the first symbol lookup.
+    if (!m_cache_key.empty() && m_jitter->m_object_file) {
+        detail::disk_cache_store(m_cache_dir, m_cache_key, *m_jitter->m_object_file);
+        m_cache_key.clear();
+    }
+
+    if (!m_mem_cache_key.empty() && m_jitter->m_object_file) {
+        detail::mem_cache_insert(std::move(m_mem_cache_key), *m_jitter->m_object_file);
+        m_mem_cache_key.clear();
+    }
+}
+
 void llvm_state::optimise()
 {
+    detail::trace_span span("llvm_state::optimise", "llvm");
+
     check_uncompiled(__func__);
 
+    if (!m_cache_dir.empty() && m_opt_level > 0u) {
+        // Look up the unoptimised module in the persistent cache.
+        auto bc = detail::module_to_bc(*m_module);
+        m_cache_key = cache_compute_key(bc, "optimise");
+        m_cached_obj = detail::disk_cache_load(m_cache_dir, m_cache_key);
+
+        if (m_cached_obj) {
+            SPDLOG_LOGGER_DEBUG(detail::get_logger(), "persistent cache hit for the module '{}' (key {})",
+                                m_module_name, m_cache_key);
+
+            // NOTE: the cached object code was generated from the
+            // optimised version of the current module, thus we can
+            // skip the optimisation altogether. We record the bitcode
+            // so that compile() can detect if the module is modified
+            // before compilation.
+            m_bc_snapshot = std::move(bc);
+
+            return;
+        }
+
+        SPDLOG_LOGGER_DEBUG(detail::get_logger(), "persistent cache miss for the module '{}' (key {})",
+                            m_module_name, m_cache_key);
+    }
+
+    m_opt_remarks.clear();
+
     if (m_opt_level > 0u) {
         // NOTE: the logic here largely mimics (with a lot of simplifications)
         // the implementation of the 'opt' tool. See:
@@ -657,11 +1625,12 @@ void llvm_state::optimise()
         llvm::PassManagerBuilder pm_builder;
         // See here for the defaults:
         // https://llvm.org/doxygen/PassManagerBuilder_8cpp_source.html
-        // NOTE: we used to have the SLP vectorizer on here, but
-        // we don't activate it any more in favour of explicit vectorization.
-        // NOTE: perhaps in the future we can make the autovectorizer an
-        // option like the fast math flag.
+        // NOTE: the SLP and loop vectorizers are off by default
+        // in favour of explicit vectorization, as they mostly
+        // increase the compilation time of large modules.
         pm_builder.OptLevel = m_opt_level;
+        pm_builder.SLPVectorize = m_slp_vectorize;
+        pm_builder.LoopVectorize = m_loop_vectorize;
         if (m_inline_functions) {
             // Enable function inlining if the inlining flag is enabled.
             pm_builder.Inliner = llvm::createFunctionInliningPass(m_opt_level, 0, false);
@@ -673,7 +1642,17 @@ void llvm_state::optimise()
         pm_builder.populateFunctionPassManager(*f_pm);
         pm_builder.populateModulePassManager(*module_pm);
 
+        // Install the diagnostic handler for the collection
+        // of the optimisation remarks, if requested.
+        const auto collect_remarks = detail::opt_remarks_enabled.load();
+        std::unique_ptr<llvm::DiagnosticHandler> orig_dh;
+        if (collect_remarks) {
+            orig_dh = context().getDiagnosticHandler();
+            context().setDiagnosticHandler(std::make_unique<detail::opt_remark_handler>(m_opt_remarks));
+        }
+
         // Run the function pass manager on all functions in the module.
+        const auto t0 = std::chrono::steady_clock::now();
         f_pm->doInitialization();
         for (auto &f : *m_module) {
             f_pm->run(f);
@@ -681,12 +1660,45 @@ void llvm_state::optimise()
         f_pm->doFinalization();
 
         // Run the module passes.
+        const auto t1 = std::chrono::steady_clock::now();
         module_pm->run(*m_module);
+        const auto t2 = std::chrono::steady_clock::now();
+
+        m_timings.opt_function_passes = std::chrono::duration<double>(t1 - t0).count();
+        m_timings.opt_module_passes = std::chrono::duration<double>(t2 - t1).count();
+
+        if (collect_remarks) {
+            // Restore the original diagnostic handler.
+            context().setDiagnosticHandler(std::move(orig_dh));
+
+            SPDLOG_LOGGER_DEBUG(detail::get_logger(),
+                                "optimisation remarks for the module '{}': {} passed, {} missed, {} analysis",
+                                m_module_name,
+                                std::count_if(m_opt_remarks.begin(), m_opt_remarks.end(),
+                                              [](const auto &r) { return r.kind == "passed"; }),
+                                std::count_if(m_opt_remarks.begin(), m_opt_remarks.end(),
+                                              [](const auto &r) { return r.kind == "missed"; }),
+                                std::count_if(m_opt_remarks.begin(), m_opt_remarks.end(),
+                                              [](const auto &r) { return r.kind == "analysis"; }));
+        }
+
+        SPDLOG_LOGGER_DEBUG(
+            detail::get_logger(), "optimisation of the module '{}' - function passes: {}ms, module passes: {}ms",
+            m_module_name, std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count());
+    }
+
+    if (!m_cache_key.empty()) {
+        // Record the optimised bitcode, so that compile() can detect
+        // if the module is modified before compilation.
+        m_bc_snapshot = detail::module_to_bc(*m_module);
     }
 }
 
 void llvm_state::compile()
 {
+    detail::trace_span span("llvm_state::compile", "llvm");
+
     check_uncompiled(__func__);
 
     // Run a verification on the module before compiling.
@@ -702,10 +1714,67 @@ void llvm_state::compile()
         }
     }
 
-    // Store a snapshot of the IR before compiling.
-    m_ir_snapshot = get_ir();
+    // Store a snapshot of the module before compiling.
+    // NOTE: the snapshot is stored as bitcode, which is faster
+    // to generate and more compact than the textual IR. The
+    // textual IR is generated from the snapshot only on demand
+    // (see get_ir()).
+    auto bc = detail::module_to_bc(*m_module);
+
+    if (!m_cache_dir.empty() && (m_cache_key.empty() || bc != m_bc_snapshot)) {
+        // optimise() was not invoked, or the module was modified
+        // after optimise(): look up the module as-is in the
+        // persistent cache.
+        m_cache_key = cache_compute_key(bc, "compile");
+        m_cached_obj = detail::disk_cache_load(m_cache_dir, m_cache_key);
+
+        SPDLOG_LOGGER_DEBUG(detail::get_logger(), "persistent cache {} for the module '{}' (key {})",
+                            m_cached_obj ? "hit" : "miss", m_module_name, m_cache_key);
+    }
+
+    // NOTE: if the object code was fetched during optimise(), the
+    // snapshot will contain the unoptimised module.
+    m_bc_snapshot = std::move(bc);
+
+    if (!m_cached_obj) {
+        // Look up the final module in the in-memory cache.
+        m_mem_cache_key = cache_compute_key(m_bc_snapshot, "memory");
+        m_cached_obj = detail::mem_cache_lookup(m_mem_cache_key);
+    }
+
+    if (m_cached_obj) {
+        // Add the cached object code to the jit, and discard the module.
+        m_jitter->add_object_code(*m_cached_obj, "The function for adding a cached compiled module to the jit failed");
+        m_cached_obj.reset();
+
+        m_module.reset();
 
-    m_jitter->add_module(std::move(m_module));
+        // No need to store the object code.
+        m_cache_key.clear();
+        m_mem_cache_key.clear();
+    } else {
+        // Determine the number of parts the module will be split into
+        // for parallel compilation.
+        const auto n_defs = static_cast<std::size_t>(
+            std::count_if(m_module->begin(), m_module->end(), [](const auto &f) { return !f.isDeclaration(); }));
+        const auto n_parts = detail::parallel_n_workers(n_defs, m_compile_threads);
+
+        if (m_compile_threads != 1u && n_parts > 1u) {
+            const auto t0 = std::chrono::steady_clock::now();
+
+            auto oc = detail::parallel_codegen(std::move(m_module), n_parts, m_target_cpu);
+
+            m_timings.codegen = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            SPDLOG_LOGGER_DEBUG(
+                detail::get_logger(), "parallel codegen of the module '{}' in {} parts: {}ms", m_module_name, n_parts,
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+
+            m_jitter->add_object_code(oc, "The function for adding a module compiled in parallel to the jit failed");
+        } else {
+            m_jitter->add_module(std::move(m_module));
+        }
+    }
 }
 
 bool llvm_state::is_compiled() const
@@ -720,16 +1789,58 @@ std::uintptr_t llvm_state::jit_lookup(const std::string &name)
 {
     check_compiled(__func__);
 
+    // NOTE: the object code is generated
+    // lazily upon the first lookup.
+    const auto with_oc = static_cast<bool>(m_jitter->m_object_file);
+    const auto t0 = std::chrono::steady_clock::now();
+
     auto sym = m_jitter->lookup(name);
+
+    if (!with_oc && m_jitter->m_object_file) {
+        m_timings.codegen = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        SPDLOG_LOGGER_DEBUG(
+            detail::get_logger(), "codegen of the module '{}': {}ms", m_module_name,
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+    }
     if (!sym) {
         using namespace fmt::literals;
 
         throw std::invalid_argument("Could not find the symbol '{}' in the compiled module"_format(name));
     }
 
+    // Store the object code in the persistent cache, if needed.
+    cache_try_store();
+
     return static_cast<std::uintptr_t>((*sym).getAddress());
 }
 
+const llvm_state_timings &llvm_state::get_timings() const
+{
+    return m_timings;
+}
+
+const std::vector<llvm_opt_remark> &llvm_state::get_opt_remarks() const
+{
+    return m_opt_remarks;
+}
+
+// NOTE: the memory used by the module and by
+// the internal data structures of LLVM is not accounted for.
+llvm_state_memory_usage llvm_state::get_memory_usage() const
+{
+    llvm_state_memory_usage retval;
+
+    retval.bc_snapshot = m_bc_snapshot.size();
+
+    if (is_compiled() && m_jitter->m_object_file) {
+        retval.object_code = m_jitter->m_object_file->size();
+        retval.jit = detail::object_code_jit_size(*m_jitter->m_object_file);
+    }
+
+    return retval;
+}
+
 std::string llvm_state::get_ir() const
 {
     if (m_module) {
@@ -741,9 +1852,30 @@ std::string llvm_state::get_ir() const
         return ostr.str();
     } else {
         // The module has been compiled.
-        // Return the IR snapshot that
+        // Reconstruct the IR from the bitcode
+        // snapshot that was created before the compilation.
+        llvm::LLVMContext ctx;
+        const auto m = detail::bc_to_module(m_bc_snapshot, m_module_name, ctx,
+                                            "Error parsing the bitcode snapshot of an llvm_state");
+
+        std::string out;
+        llvm::raw_string_ostream ostr(out);
+        m->print(ostr, nullptr);
+        return ostr.str();
+    }
+}
+
+std::string llvm_state::get_bc() const
+{
+    if (m_module) {
+        // The module has not been compiled yet,
+        // get the bitcode from it.
+        return detail::module_to_bc(*m_module);
+    } else {
+        // The module has been compiled.
+        // Return the bitcode snapshot that
         // was created before the compilation.
-        return m_ir_snapshot;
+        return m_bc_snapshot;
     }
 }
 
@@ -779,11 +1911,437 @@ const std::string &llvm_state::get_object_code() const
     return *m_jitter->m_object_file;
 }
 
+#if defined(HEYOKA_WITH_NVPTX)
+
+namespace detail
+{
+
+namespace
+{
+
+std::once_flag nvptx_inited;
+
+// The triple of the NVPTX target.
+constexpr char nvptx_triple[] = "nvptx64-nvidia-cuda";
+
+// Replace the calls to the math functions in md, which cannot be lowered
+// by the NVPTX backend, with calls to their libdevice counterparts.
+// This covers both the LLVM intrinsics (e.g., llvm.sin.f64) and the
+// external libm functions (e.g., atan2). The return value is
+// the number of functions which were replaced.
+std::size_t nvptx_map_math_functions(llvm::Module &md)
+{
+    using namespace fmt::literals;
+
+    // NOTE: the math intrinsics not listed here (e.g., sqrt, fabs, fma)
+    // are natively supported by the NVPTX backend.
+    static const std::unordered_set<std::string> intr_names
+        = {"sin", "cos", "exp", "exp2", "log", "log2", "log10", "pow"};
+
+    static const std::unordered_set<std::string> libm_names
+        = {"sin",   "cos",   "tan",   "asin", "acos",  "atan", "atan2", "sinh", "cosh", "tanh",
+           "asinh", "acosh", "atanh", "exp",  "expm1", "log",  "log1p", "pow",  "erf",  "cbrt"};
+
+    // NOTE: collect the functions first, as they
+    // will be erased from the module.
+    std::vector<std::pair<llvm::Function *, std::string>> repl;
+    for (auto &f : md) {
+        if (!f.isDeclaration()) {
+            continue;
+        }
+
+        const auto name = f.getName().str();
+
+        if (f.isIntrinsic()) {
+            // NOTE: the name of an intrinsic is in the form
+            // llvm.<name>.<type suffix>.
+            const auto dot_pos = name.find('.', 5);
+            if (dot_pos == std::string::npos) {
+                continue;
+            }
+            auto base = name.substr(5, dot_pos - 5);
+
+            if (intr_names.count(base) == 0u) {
+                continue;
+            }
+
+            if (name.substr(dot_pos + 1u) != "f64") {
+                // NOTE: vector or non-double variants of
+                // the math intrinsics have no libdevice counterpart.
+                throw std::invalid_argument(
+                    "The intrinsic '{}' cannot be lowered by the NVPTX backend: only scalar double-precision "
+                    "math functions are supported in the generation of PTX code"_format(name));
+            }
+
+            repl.emplace_back(&f, std::move(base));
+        } else if (libm_names.count(name) != 0u) {
+            repl.emplace_back(&f, name);
+        }
+    }
+
+    for (auto &[f, fname] : repl) {
+        auto *nf = llvm::cast<llvm::Function>(
+            md.getOrInsertFunction("__nv_" + fname, f->getFunctionType()).getCallee()->stripPointerCasts());
+
+        f->replaceAllUsesWith(nf);
+        f->eraseFromParent();
+    }
+
+    return repl.size();
+}
+
+} // namespace
+
+} // namespace detail
+
+// Generate the PTX code for the module of this llvm_state, for the
+// NVIDIA GPU architecture sm (e.g., "sm_60"). The calls to
+// the math functions are redirected to NVIDIA's libdevice library,
+// whose bitcode must then be provided via the path libdevice.
+// NOTE: the module is not altered, and it is retargeted
+// to NVPTX in a separate context.
+std::string llvm_state::get_ptx(const std::string &sm, const std::string &libdevice) const
+{
+    using namespace fmt::literals;
+
+    std::call_once(detail::nvptx_inited, []() {
+        LLVMInitializeNVPTXTargetInfo();
+        LLVMInitializeNVPTXTarget();
+        LLVMInitializeNVPTXTargetMC();
+        LLVMInitializeNVPTXAsmPrinter();
+    });
+
+    std::string err;
+    const auto *target = llvm::TargetRegistry::lookupTarget(detail::nvptx_triple, err);
+    // LCOV_EXCL_START
+    if (target == nullptr) {
+        throw std::invalid_argument("Error looking up the NVPTX target: {}"_format(err));
+    }
+    // LCOV_EXCL_STOP
+
+    std::unique_ptr<llvm::TargetMachine> tm(target->createTargetMachine(
+        detail::nvptx_triple, sm, "", llvm::TargetOptions{}, {}, {}, llvm::CodeGenOpt::Aggressive));
+    // LCOV_EXCL_START
+    if (!tm) {
+        throw std::invalid_argument("Error creating the NVPTX target machine");
+    }
+    // LCOV_EXCL_STOP
+
+    if (!tm->getMCSubtargetInfo()->isCPUStringValid(sm)) {
+        throw std::invalid_argument("Invalid GPU architecture '{}' specified for the NVPTX target"_format(sm));
+    }
+
+    llvm::LLVMContext ctx;
+    auto md = detail::bc_to_module(get_bc(), m_module_name, ctx,
+                                   "Error parsing the bitcode of an llvm_state during the generation of PTX code");
+
+    md->setTargetTriple(detail::nvptx_triple);
+    md->setDataLayout(tm->createDataLayout());
+
+    // Remove the host-specific attributes set up
+    // during the optimisation.
+    for (auto &f : *md) {
+        f.removeFnAttr("target-cpu");
+        f.removeFnAttr("target-features");
+    }
+
+    if (detail::nvptx_map_math_functions(*md) > 0u) {
+        if (libdevice.empty()) {
+            throw std::invalid_argument("The generation of PTX code for a module invoking math functions requires the "
+                                        "path to the libdevice bitcode file");
+        }
+
+        auto buf = llvm::MemoryBuffer::getFile(libdevice);
+        if (!buf) {
+            throw std::invalid_argument(
+                "Error reading the libdevice file '{}': {}"_format(libdevice, buf.getError().message()));
+        }
+
+        auto ld = llvm::parseBitcodeFile(**buf, ctx);
+        if (!ld) {
+            throw std::invalid_argument("Error parsing the libdevice file '{}'. The full error message:\n{}"_format(
+                libdevice, llvm::toString(ld.takeError())));
+        }
+
+        (*ld)->setTargetTriple(detail::nvptx_triple);
+        (*ld)->setDataLayout(md->getDataLayout());
+
+        // NOTE: link only the functions which are actually used.
+        // linkModules() returns true on error.
+        // LCOV_EXCL_START
+        if (llvm::Linker::linkModules(*md, std::move(*ld), llvm::Linker::Flags::LinkOnlyNeeded)) {
+            throw std::invalid_argument("Error linking libdevice during the generation of PTX code");
+        }
+        // LCOV_EXCL_STOP
+    }
+
+    // NOTE: the NVPTX code generation pipeline also runs the
+    // NVVMReflect pass, which resolves the architecture
+    // queries in the libdevice functions.
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream ostr(buffer);
+
+    llvm::legacy::PassManager pm;
+    // LCOV_EXCL_START
+    if (tm->addPassesToEmitFile(pm, ostr, nullptr, llvm::CGFT_AssemblyFile)) {
+        throw std::invalid_argument("The NVPTX target machine cannot emit assembly code");
+    }
+    // LCOV_EXCL_STOP
+
+    pm.run(*md);
+
+    return std::string(buffer.begin(), buffer.end());
+}
+
+#endif
+
 const std::string &llvm_state::module_name() const
 {
     return m_module_name;
 }
 
+const std::string &llvm_state::cache_dir() const
+{
+    return m_cache_dir;
+}
+
+const std::string &llvm_state::target_cpu() const
+{
+    return m_target_cpu;
+}
+
+// NOTE: the serialised state contains the options,
+// the bitcode and, if available, the object code together with
+// the CPU and features it was generated for. The cache
+// directory is not serialised, as it is a property of
+// the host machine.
+void llvm_state::save(std::ostream &os) const
+{
+    detail::s11n_save_header(os, "llvm_state", 3);
+
+    detail::s11n_save(os, m_module_name);
+    detail::s11n_save(os, m_opt_level);
+    detail::s11n_save(os, m_fast_math);
+    detail::s11n_save(os, m_inline_functions);
+    detail::s11n_save(os, m_target_cpu);
+    detail::s11n_save(os, m_slp_vectorize);
+    detail::s11n_save(os, m_loop_vectorize);
+    detail::s11n_save(os, m_compile_threads);
+
+    const auto cmp = is_compiled();
+    detail::s11n_save(os, cmp);
+
+    detail::s11n_save(os, get_bc());
+
+    // NOTE: the object code can be saved only if it was
+    // already generated. Otherwise, it will be re-generated
+    // from the bitcode snapshot upon loading.
+    const auto with_oc = cmp && static_cast<bool>(m_jitter->m_object_file);
+    detail::s11n_save(os, with_oc);
+    if (with_oc) {
+        detail::s11n_save(os, *m_jitter->m_object_file);
+        detail::s11n_save(os, m_jitter->get_target_cpu());
+        detail::s11n_save(os, m_jitter->get_target_features());
+    }
+}
+
+void llvm_state::load(std::istream &is)
+{
+    using namespace fmt::literals;
+
+    detail::s11n_load_header(is, "llvm_state", 3);
+
+    std::string mname;
+    detail::s11n_load(is, mname);
+
+    unsigned opt_level = 0;
+    detail::s11n_load(is, opt_level);
+
+    bool fmath = false, i_func = false, cmp = false, with_oc = false;
+    detail::s11n_load(is, fmath);
+    detail::s11n_load(is, i_func);
+
+    std::string tcpu;
+    detail::s11n_load(is, tcpu);
+
+    bool slp_vec = false, loop_vec = false;
+    detail::s11n_load(is, slp_vec);
+    detail::s11n_load(is, loop_vec);
+
+    unsigned c_threads = 0;
+    detail::s11n_load(is, c_threads);
+
+    detail::s11n_load(is, cmp);
+
+    std::string bc;
+    detail::s11n_load(is, bc);
+
+    detail::s11n_load(is, with_oc);
+    std::string oc, oc_cpu, oc_features;
+    if (with_oc) {
+        detail::s11n_load(is, oc);
+        detail::s11n_load(is, oc_cpu);
+        detail::s11n_load(is, oc_features);
+    }
+
+    // NOTE: if the object code was generated for a CPU whose features
+    // are not available on the host (e.g., if the state was serialised
+    // on a machine with a more recent instruction set), discard it
+    // and re-generate the object code for the host CPU from the IR.
+    const auto redispatch = with_oc && !detail::target_host_compatible(oc_cpu, oc_features);
+    if (redispatch) {
+        SPDLOG_LOGGER_DEBUG(detail::get_logger(),
+                            "the object code of the module '{}' was generated for the CPU '{}', which is not "
+                            "compatible with the host: the object code will be re-generated for the host CPU",
+                            mname, oc_cpu);
+
+        with_oc = false;
+        tcpu.clear();
+    }
+
+    // Build the new state in a temporary, so that *this
+    // is left untouched in case of errors.
+    llvm_state tmp(std::tuple{std::move(mname), opt_level, fmath, i_func, m_cache_dir, std::move(tcpu), slp_vec,
+                              loop_vec, c_threads});
+
+    if (with_oc) {
+        // The object code is available: discard the module
+        // and add the object code to the jit.
+        // NOTE: no parsing or code generation takes
+        // place, the bitcode is stored as-is.
+        tmp.m_module.reset();
+        tmp.m_bc_snapshot = std::move(bc);
+
+        tmp.m_jitter->add_object_code(oc, "The function for adding a compiled module to the jit during the "
+                                          "deserialisation of an llvm_state failed");
+    } else {
+        // Reconstruct the module from the bitcode.
+        tmp.m_module = detail::bc_to_module(bc, tmp.m_module_name, tmp.context(),
+                                            "Error parsing the bitcode while deserialising an llvm_state");
+
+        if (redispatch) {
+            // Remove the CPU-specific attributes
+            // set up during the optimisation.
+            for (auto &f : *tmp.m_module) {
+                f.removeFnAttr("target-cpu");
+                f.removeFnAttr("target-features");
+            }
+        }
+
+        // Compile if needed.
+        if (cmp) {
+            tmp.compile();
+        }
+    }
+
+    *this = std::move(tmp);
+}
+
+std::size_t llvm_state::get_memcache_size()
+{
+    auto &mc = detail::get_mem_cache();
+
+    std::lock_guard lock(mc.mutex);
+
+    return mc.size;
+}
+
+std::size_t llvm_state::get_memcache_limit()
+{
+    auto &mc = detail::get_mem_cache();
+
+    std::lock_guard lock(mc.mutex);
+
+    return mc.limit;
+}
+
+void llvm_state::set_memcache_limit(std::size_t limit)
+{
+    auto &mc = detail::get_mem_cache();
+
+    std::lock_guard lock(mc.mutex);
+
+    mc.limit = limit;
+    mc.trim();
+}
+
+std::size_t llvm_state::get_jit_pool_size()
+{
+    auto &pool = jit_pool::get();
+
+    std::lock_guard lock(pool.mutex);
+
+    return pool.size;
+}
+
+void llvm_state::set_jit_pool_size(std::size_t size)
+{
+    auto &pool = jit_pool::get();
+
+    {
+        std::lock_guard lock(pool.mutex);
+
+        pool.size = size;
+
+        // Discard the extra jit instances.
+        if (pool.jits.size() > size) {
+            pool.jits.resize(size);
+        }
+
+        // Start the refill thread, if needed.
+        if (size > 0u && !pool.refill_thread.joinable()) {
+            pool.refill_thread = std::thread([&pool]() { pool.refill_loop(); });
+        }
+    }
+
+    pool.cv.notify_one();
+}
+
+bool llvm_state::get_opt_remarks_enabled()
+{
+    return detail::opt_remarks_enabled.load();
+}
+
+void llvm_state::set_opt_remarks_enabled(bool flag)
+{
+    detail::opt_remarks_enabled.store(flag);
+}
+
+void llvm_state::add_symbol(const std::string &name, void *addr)
+{
+    using namespace fmt::literals;
+
+    if (name.empty()) {
+        throw std::invalid_argument("The name of an external symbol cannot be empty");
+    }
+
+    if (addr == nullptr) {
+        throw std::invalid_argument("Cannot register the external symbol '{}' with a null address"_format(name));
+    }
+
+    auto &es = detail::get_ext_symbols();
+
+    std::lock_guard lock(es.mutex);
+
+    if (const auto it = es.map.find(name); it != es.map.end() && it->second != addr) {
+        throw std::invalid_argument(
+            "The external symbol '{}' has already been registered with a different address"_format(name));
+    }
+
+    es.map.emplace(name, addr);
+}
+
+void llvm_state::clear_memcache()
+{
+    auto &mc = detail::get_mem_cache();
+
+    std::lock_guard lock(mc.mutex);
+
+    mc.lru_map.clear();
+    mc.lru_list.clear();
+    mc.size = 0;
+}
+
 std::ostream &operator<<(std::ostream &os, const llvm_state &s)
 {
     std::ostringstream oss;
@@ -794,6 +2352,11 @@ std::ostream &operator<<(std::ostream &os, const llvm_state &s)
     oss << "Fast math          : " << s.m_fast_math << '\n';
     oss << "Optimisation level : " << s.m_opt_level << '\n';
     oss << "Inline functions   : " << s.m_inline_functions << '\n';
+    oss << "SLP vectorisation  : " << s.m_slp_vectorize << '\n';
+    oss << "Loop vectorisation : " << s.m_loop_vectorize << '\n';
+    oss << "Compile threads    : " << s.m_compile_threads << '\n';
+    oss << "Cache directory    : " << s.m_cache_dir << '\n';
+    oss << "Requested CPU      : " << (s.m_target_cpu.empty() ? "host" : s.m_target_cpu) << '\n';
     oss << "Target triple      : " << s.m_jitter->get_target_triple().str() << '\n';
     oss << "Target CPU         : " << s.m_jitter->get_target_cpu() << '\n';
     oss << "Target features    : " << s.m_jitter->get_target_features() << '\n';
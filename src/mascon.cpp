@@ -6,11 +6,33 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#include <fmt/format.h>
+
+#include <heyoka/detail/octree.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/mascon.hpp>
 #include <heyoka/math.hpp>
+#include <heyoka/number.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
 
 namespace heyoka
 {
@@ -19,10 +41,117 @@ namespace detail
 
 {
 
+namespace
+{
+
+// Helper to extract the numerical value of a component of the mascon data.
+number mascon_fetch_number(const expression &e, const char *desc)
+{
+    if (const auto *num_ptr = std::get_if<number>(&e.value())) {
+        return *num_ptr;
+    }
+
+    throw std::invalid_argument("The positions and masses of the mascon points must be numerical constants in order "
+                                "to construct {} mascon system"_format(desc));
+}
+
+double mascon_fetch_dbl(const expression &e)
+{
+    return std::visit([](const auto &v) { return static_cast<double>(v); },
+                      mascon_fetch_number(e, "an approximate").value());
+}
+
+// Helper to replace the mascon model with its Barnes-Hut approximation.
+// NOTE: the mascon points are clustered in an octree, and each cell whose size is less
+// than theta times a lower bound on its distance from the orbiting point is replaced by a single
+// mascon point with the total mass of the cell, placed at the cell's centre of mass. The lower bound
+// is min_distance - |com|, where min_distance is the minimum distance of the orbiting point from
+// the origin of the reference frame and com the centre of mass of the cell. Because the mascon model
+// is fixed in its reference frame, the approximation is built only once, and it is valid along the
+// whole trajectory as long as the distance of the orbiting point from the origin does not fall
+// below min_distance. The approximated model is computed in double precision.
+void mascon_tree_approx(std::vector<std::vector<expression>> &mascon_points, std::vector<expression> &mascon_masses,
+                        double theta, double min_distance)
+{
+    if (!std::isfinite(theta) || !(theta > 0)) {
+        throw std::invalid_argument("The opening angle of the tree approximation of a mascon system must be positive "
+                                    "and finite, but a value of {} was provided instead"_format(theta));
+    }
+
+    if (!std::isfinite(min_distance) || !(min_distance > 0)) {
+        throw std::invalid_argument(
+            "The minimum distance for the tree approximation of a mascon system must be positive "
+            "and finite, but a value of {} was provided instead"_format(min_distance));
+    }
+
+    // Fetch the numerical values of the points with a nonzero mass.
+    std::vector<std::array<double, 3>> pos;
+    std::vector<double> masses;
+    for (decltype(mascon_masses.size()) i = 0; i < mascon_masses.size(); ++i) {
+        const auto m = mascon_fetch_dbl(mascon_masses[i]);
+
+        if (!std::isfinite(m) || m < 0) {
+            throw std::invalid_argument("The masses in the tree approximation of a mascon system must be "
+                                        "non-negative and finite, but a value of {} was provided instead"_format(m));
+        }
+
+        if (m > 0) {
+            pos.push_back({mascon_fetch_dbl(mascon_points[i][0]), mascon_fetch_dbl(mascon_points[i][1]),
+                           mascon_fetch_dbl(mascon_points[i][2])});
+            masses.push_back(m);
+        }
+    }
+
+    mascon_points.clear();
+    mascon_masses.clear();
+
+    if (masses.empty()) {
+        return;
+    }
+
+    const auto tree = build_octree(pos, masses);
+
+    octree_walk(tree, [&](const octree_node &nd) {
+        const auto com_norm = std::sqrt(nd.com[0] * nd.com[0] + nd.com[1] * nd.com[1] + nd.com[2] * nd.com[2]);
+
+        if (nd.end - nd.begin == 1u) {
+            // Single point, add it as-is.
+            const auto &p = pos[tree.perm[nd.begin]];
+
+            mascon_points.push_back({expression{p[0]}, expression{p[1]}, expression{p[2]}});
+            mascon_masses.emplace_back(masses[tree.perm[nd.begin]]);
+
+            return false;
+        }
+
+        if (nd.children.empty() || nd.size < theta * (min_distance - com_norm)) {
+            mascon_points.push_back({expression{nd.com[0]}, expression{nd.com[1]}, expression{nd.com[2]}});
+            mascon_masses.emplace_back(nd.mass);
+
+            return false;
+        }
+
+        return true;
+    });
+}
+
+} // namespace
+
 std::vector<std::pair<expression, expression>>
 make_mascon_system_impl(expression Gconst, std::vector<std::vector<expression>> mascon_points,
-                        std::vector<expression> mascon_masses, expression pe, expression qe, expression re)
+                        std::vector<expression> mascon_masses, expression pe, expression qe, expression re, bool fused,
+                        double theta, double min_distance)
 {
+    if (mascon_points.size() != mascon_masses.size()) {
+        throw std::invalid_argument("Inconsistent sizes detected while creating a mascon system: the number of points "
+                                    "is {}, while the number of masses is {}"_format(mascon_points.size(),
+                                                                                     mascon_masses.size()));
+    }
+
+    if (theta != 0) {
+        mascon_tree_approx(mascon_points, mascon_masses, theta, min_distance);
+    }
+
     // 3 - Create the return value.
     std::vector<std::pair<expression, expression>> retval;
     // 4 - Main code
@@ -32,19 +161,36 @@ make_mascon_system_impl(expression Gconst, std::vector<std::vector<expression>>
     std::vector<expression> x_acc, y_acc, z_acc;
     // Assembling the r.h.s.
     // FIRST: the acceleration due to the mascon points
-    for (decltype(dim) i = 0; i < dim; ++i) {
-        auto x_masc = mascon_points[i][0];
-        auto y_masc = mascon_points[i][1];
-        auto z_masc = mascon_points[i][2];
-        auto m_masc = mascon_masses[i];
-        auto xdiff = (x - x_masc);
-        auto ydiff = (y - y_masc);
-        auto zdiff = (z - z_masc);
-        auto r2 = square(xdiff) + square(ydiff) + square(zdiff);
-        auto common_factor = -Gconst * m_masc * pow(r2, expression{-3. / 2.});
-        x_acc.push_back(common_factor * xdiff);
-        y_acc.push_back(common_factor * ydiff);
-        z_acc.push_back(common_factor * zdiff);
+    if (fused) {
+        // NOTE: in the fused case, the mascon points are looped over
+        // at runtime by a single function per component.
+        std::vector<number> points, masses;
+        for (decltype(dim) i = 0; i < dim; ++i) {
+            for (const auto &c : mascon_points[i]) {
+                points.push_back(mascon_fetch_number(c, "a fused"));
+            }
+            masses.push_back(mascon_fetch_number(mascon_masses[i], "a fused"));
+        }
+
+        auto acc = mascon_acc(x, y, z, std::move(points), std::move(masses));
+        x_acc.push_back(Gconst * acc[0]);
+        y_acc.push_back(Gconst * acc[1]);
+        z_acc.push_back(Gconst * acc[2]);
+    } else {
+        for (decltype(dim) i = 0; i < dim; ++i) {
+            auto x_masc = mascon_points[i][0];
+            auto y_masc = mascon_points[i][1];
+            auto z_masc = mascon_points[i][2];
+            auto m_masc = mascon_masses[i];
+            auto xdiff = (x - x_masc);
+            auto ydiff = (y - y_masc);
+            auto zdiff = (z - z_masc);
+            auto r2 = square(xdiff) + square(ydiff) + square(zdiff);
+            auto common_factor = -Gconst * m_masc * pow(r2, expression{-3. / 2.});
+            x_acc.push_back(common_factor * xdiff);
+            y_acc.push_back(common_factor * ydiff);
+            z_acc.push_back(common_factor * zdiff);
+        }
     }
     // SECOND: centripetal and Coriolis
     // w x w x r
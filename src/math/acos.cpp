@@ -216,7 +216,7 @@ llvm::Value *taylor_diff_acos_impl(llvm_state &s, const acos_impl &f, const std:
     auto &builder = s.builder();
 
     // Fetch the index of the variable argument.
-    const auto b_idx = uname_to_index(var.name());
+    const auto b_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, b_idx, 0, n_uvars)});
@@ -260,7 +260,7 @@ llvm::Value *bo_taylor_diff_addsub_impl(llvm_state &s, const U &num, const varia
 {
     auto &builder = s.builder();
 
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
 
     if (order == 0u) {
         auto n = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
@@ -283,7 +283,7 @@ llvm::Value *bo_taylor_diff_addsub_impl(llvm_state &s, const variable &var, cons
                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
                                         std::uint32_t batch_size)
 {
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
 
     if (order == 0u) {
         auto &builder = s.builder();
@@ -302,8 +302,8 @@ llvm::Value *bo_taylor_diff_addsub_impl(llvm_state &s, const variable &var0, con
                                         const std::vector<llvm::Value *> &arr, llvm::Value *, std::uint32_t n_uvars,
                                         std::uint32_t order, std::uint32_t, std::uint32_t)
 {
-    auto v0 = taylor_fetch_diff(arr, uname_to_index(var0.name()), order, n_uvars);
-    auto v1 = taylor_fetch_diff(arr, uname_to_index(var1.name()), order, n_uvars);
+    auto v0 = taylor_fetch_diff(arr, uname_to_index(var0), order, n_uvars);
+    auto v1 = taylor_fetch_diff(arr, uname_to_index(var1), order, n_uvars);
 
     if constexpr (AddOrSub) {
         return s.builder().CreateFAdd(v0, v1);
@@ -371,7 +371,7 @@ llvm::Value *bo_taylor_diff_mul_impl(llvm_state &s, const variable &var, const U
 {
     auto &builder = s.builder();
 
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
     auto mul = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
 
     return builder.CreateFMul(mul, ret);
@@ -393,22 +393,18 @@ llvm::Value *bo_taylor_diff_mul_impl(llvm_state &s, const variable &var0, const
                                      std::uint32_t order, std::uint32_t, std::uint32_t)
 {
     // Fetch the indices of the u variables.
-    const auto u_idx0 = uname_to_index(var0.name());
-    const auto u_idx1 = uname_to_index(var1.name());
+    const auto u_idx0 = uname_to_index(var0);
+    const auto u_idx1 = uname_to_index(var1);
 
     // NOTE: iteration in the [0, order] range
     // (i.e., order inclusive).
-    std::vector<llvm::Value *> sum;
-    auto &builder = s.builder();
+    std::vector<llvm::Value *> v0s, v1s;
     for (std::uint32_t j = 0; j <= order; ++j) {
-        auto v0 = taylor_fetch_diff(arr, u_idx0, order - j, n_uvars);
-        auto v1 = taylor_fetch_diff(arr, u_idx1, j, n_uvars);
-
-        // Add v0*v1 to the sum.
-        sum.push_back(builder.CreateFMul(v0, v1));
+        v0s.push_back(taylor_fetch_diff(arr, u_idx0, order - j, n_uvars));
+        v1s.push_back(taylor_fetch_diff(arr, u_idx1, j, n_uvars));
     }
 
-    return pairwise_sum(builder, sum);
+    return pairwise_dot(s, v0s, v1s);
 }
 
 // All the other cases.
@@ -462,7 +458,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
     auto &builder = s.builder();
 
     // Fetch the index of var1.
-    const auto u_idx1 = uname_to_index(var1.name());
+    const auto u_idx1 = uname_to_index(var1);
 
     if (order == 0u) {
         // Special casing for zero order.
@@ -470,7 +466,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
             if constexpr (std::is_same_v<U, number> || std::is_same_v<U, param>) {
                 return taylor_codegen_numparam<T>(s, nv, par_ptr, batch_size);
             } else {
-                return taylor_fetch_diff(arr, uname_to_index(nv.name()), 0, n_uvars);
+                return taylor_fetch_diff(arr, uname_to_index(nv), 0, n_uvars);
             }
         }();
 
@@ -479,17 +475,14 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
 
     // NOTE: iteration in the [1, order] range
     // (i.e., order inclusive).
-    std::vector<llvm::Value *> sum;
+    std::vector<llvm::Value *> v0s, v1s;
     for (std::uint32_t j = 1; j <= order; ++j) {
-        auto v0 = taylor_fetch_diff(arr, idx, order - j, n_uvars);
-        auto v1 = taylor_fetch_diff(arr, u_idx1, j, n_uvars);
-
-        // Add v0*v1 to the sum.
-        sum.push_back(builder.CreateFMul(v0, v1));
+        v0s.push_back(taylor_fetch_diff(arr, idx, order - j, n_uvars));
+        v1s.push_back(taylor_fetch_diff(arr, u_idx1, j, n_uvars));
     }
 
     // Init the return value as the result of the sum.
-    auto ret_acc = pairwise_sum(builder, sum);
+    auto ret_acc = pairwise_dot(s, v0s, v1s);
 
     // Load the divisor for the quotient formula.
     // This is the zero-th order derivative of var1.
@@ -502,7 +495,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const U &nv, const variable
     } else {
         // nv is a variable. We need to fetch its
         // derivative of order 'order' from the array of derivatives.
-        auto diff_nv_v = taylor_fetch_diff(arr, uname_to_index(nv.name()), order, n_uvars);
+        auto diff_nv_v = taylor_fetch_diff(arr, uname_to_index(nv), order, n_uvars);
 
         // Produce the result: (diff_nv_v - ret_acc) / div.
         return builder.CreateFDiv(builder.CreateFSub(diff_nv_v, ret_acc), div);
@@ -517,7 +510,7 @@ llvm::Value *bo_taylor_diff_div_impl(llvm_state &s, const variable &var, const U
 {
     auto &builder = s.builder();
 
-    auto ret = taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars);
+    auto ret = taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars);
     auto div = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
 
     return builder.CreateFDiv(ret, div);
@@ -1282,7 +1275,7 @@ llvm::Function *bo_taylor_c_diff_func_mul_impl(llvm_state &s, const binary_op &,
         llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *j) {
             auto b_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), idx0);
             auto cj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, idx1);
-            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(b_nj, cj)), acc);
+            builder.CreateStore(llvm_fmuladd(s, b_nj, cj, builder.CreateLoad(acc)), acc);
         });
 
         // Create the return value.
@@ -1508,7 +1501,7 @@ llvm::Function *bo_taylor_c_diff_func_div_impl(llvm_state &s, const binary_op &,
                 llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *j) {
                     auto cj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx);
                     auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), u_idx);
-                    builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(cj, a_nj)), acc);
+                    builder.CreateStore(llvm_fmuladd(s, cj, a_nj, builder.CreateLoad(acc)), acc);
                 });
 
                 // Negate the loop summation.
@@ -1606,7 +1599,7 @@ llvm::Function *bo_taylor_c_diff_func_div_impl(llvm_state &s, const binary_op &,
         llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *j) {
             auto cj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx1);
             auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), u_idx);
-            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(cj, a_nj)), acc);
+            builder.CreateStore(llvm_fmuladd(s, cj, a_nj, builder.CreateLoad(acc)), acc);
         });
 
         auto ret = builder.CreateFSub(taylor_c_load_diff(s, diff_ptr, n_uvars, ord, var_idx0), builder.CreateLoad(acc));
@@ -101,10 +101,8 @@ llvm::Value *cos_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
 
 llvm::Value *cos_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
 {
-    assert(args.size() == 1u);
-    assert(args[0] != nullptr);
-
-    return llvm_invoke_intrinsic(s, "llvm.cos", {args[0]->getType()}, args);
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
@@ -243,7 +241,7 @@ llvm::Value *taylor_diff_cos_impl(llvm_state &s, const cos_impl &f, const std::v
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
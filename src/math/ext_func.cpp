@@ -0,0 +1,470 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/ext_func.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Check that the kernel name is a valid C identifier.
+void ext_func_check_kernel(const std::string &kernel)
+{
+    const auto is_alpha = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+    const auto is_alnum = [&is_alpha](char c) { return is_alpha(c) || (c >= '0' && c <= '9'); };
+
+    if (kernel.empty() || !is_alpha(kernel[0]) || !std::all_of(kernel.begin(), kernel.end(), is_alnum)) {
+        throw std::invalid_argument("The name '{}' is not a valid name for the kernel of an external function: the "
+                                    "name must be a valid C identifier"_format(kernel));
+    }
+}
+
+// The name of the kernel symbol for the floating-point type T.
+template <typename T>
+std::string ext_kernel_symbol(const std::string &kernel)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return kernel + "_dbl";
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return kernel + "_ldbl";
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return kernel + "_f128";
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+} // namespace
+
+ext_func_impl::ext_func_impl() : ext_func_impl("null", {0_dbl}) {}
+
+ext_func_impl::ext_func_impl(std::string kernel, std::vector<expression> args)
+    : func_base("ext:" + kernel, std::move(args)), m_kernel(std::move(kernel))
+{
+    ext_func_check_kernel(m_kernel);
+
+    if (this->args().empty()) {
+        throw std::invalid_argument("An external function must have at least one argument");
+    }
+
+    // NOTE: make sure the size of the array of argument
+    // derivatives for order 0 fits in a 32-bit unsigned integer
+    // for every batch size we might reasonably use.
+    boost::numeric_cast<std::uint32_t>(this->args().size());
+}
+
+const std::string &ext_func_impl::get_kernel() const
+{
+    return m_kernel;
+}
+
+namespace
+{
+
+// Create an array of n values of type tp on the stack,
+// and return a pointer to its first element.
+// NOTE: the array is created in the entry block of the
+// current function, so that it is allocated only once
+// even if the current insertion point is within a loop.
+llvm::Value *ext_func_alloca(llvm_state &s, llvm::Type *tp, std::uint32_t n)
+{
+    auto &builder = s.builder();
+
+    auto *f = builder.GetInsertBlock()->getParent();
+    assert(f != nullptr);
+
+    llvm::IRBuilder<> entry_builder(&f->getEntryBlock(), f->getEntryBlock().begin());
+    auto *arr = entry_builder.CreateAlloca(llvm::ArrayType::get(tp, n));
+
+    return builder.CreateInBoundsGEP(arr, {builder.getInt32(0), builder.getInt32(0)});
+}
+
+// Invoke the kernel of fn and load the result.
+template <typename T>
+llvm::Value *ext_func_invoke_kernel(llvm_state &s, const ext_func_impl &fn, llvm::Value *out_ptr, llvm::Value *ord,
+                                    llvm::Value *a_ptr, llvm::Value *f_ptr, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    llvm_invoke_external(s, ext_kernel_symbol<T>(fn.get_kernel()), builder.getVoidTy(),
+                         {out_ptr, ord, a_ptr, f_ptr, builder.getInt32(batch_size)},
+                         // NOTE: the kernels are not allowed to throw.
+                         {llvm::Attribute::NoUnwind});
+
+    return load_vector_from_memory(builder, out_ptr, batch_size);
+}
+
+template <typename T>
+llvm::Value *taylor_diff_ext_func(llvm_state &s, const ext_func_impl &fn, const std::vector<std::uint32_t> &deps,
+                                  const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                                  std::uint32_t order, std::uint32_t idx, std::uint32_t batch_size)
+{
+    if (!deps.empty()) {
+        throw std::invalid_argument("An empty hidden dependency vector is expected in order to compute the Taylor "
+                                    "derivative of an external function, but a vector of size {} was passed "
+                                    "instead"_format(deps.size()));
+    }
+
+    auto &builder = s.builder();
+
+    const auto &args = fn.args();
+    const auto nargs = static_cast<std::uint32_t>(args.size());
+
+    auto *fp_t = to_llvm_type<T>(s.context());
+    auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+    // Setup the arrays of derivatives passed to the kernel.
+    auto *out_ptr = ext_func_alloca(s, fp_t, batch_size);
+    auto *a_ptr = ext_func_alloca(s, fp_t, boost::numeric_cast<std::uint32_t>((static_cast<std::uint64_t>(order) + 1u)
+                                                                              * nargs * batch_size));
+    auto *f_ptr = ext_func_alloca(s, fp_t, std::max(order, std::uint32_t(1)) * batch_size);
+
+    for (std::uint32_t o = 0; o <= order; ++o) {
+        for (std::uint32_t j = 0; j < nargs; ++j) {
+            auto *val = std::visit(
+                [&](const auto &v) -> llvm::Value * {
+                    using type = detail::uncvref_t<decltype(v)>;
+
+                    if constexpr (std::is_same_v<type, variable>) {
+                        return taylor_fetch_diff(arr, uname_to_index(v), o, n_uvars);
+                    } else if constexpr (is_num_param_v<type>) {
+                        return o == 0u ? taylor_codegen_numparam<T>(s, v, par_ptr, batch_size) : zero;
+                    } else {
+                        throw std::invalid_argument(
+                            "An invalid argument type was encountered while trying to build the Taylor "
+                            "derivative of an external function");
+                    }
+                },
+                args[j].value());
+
+            store_vector_to_memory(
+                builder, builder.CreateInBoundsGEP(a_ptr, {builder.getInt32((o * nargs + j) * batch_size)}), val);
+        }
+    }
+
+    for (std::uint32_t o = 0; o < order; ++o) {
+        store_vector_to_memory(builder, builder.CreateInBoundsGEP(f_ptr, {builder.getInt32(o * batch_size)}),
+                               taylor_fetch_diff(arr, idx, o, n_uvars));
+    }
+
+    return ext_func_invoke_kernel<T>(s, fn, out_ptr, builder.getInt32(order), a_ptr, f_ptr, batch_size);
+}
+
+} // namespace
+
+llvm::Value *ext_func_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                            const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                            std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
+                                            std::uint32_t batch_size) const
+{
+    return taylor_diff_ext_func<double>(s, *this, deps, arr, par_ptr, n_uvars, order, idx, batch_size);
+}
+
+llvm::Value *ext_func_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                             const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                             std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
+                                             std::uint32_t batch_size) const
+{
+    return taylor_diff_ext_func<long double>(s, *this, deps, arr, par_ptr, n_uvars, order, idx, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *ext_func_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                             const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                             std::uint32_t n_uvars, std::uint32_t order, std::uint32_t idx,
+                                             std::uint32_t batch_size) const
+{
+    return taylor_diff_ext_func<mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, idx, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_ext_func(llvm_state &s, const ext_func_impl &fn, std::uint32_t n_uvars,
+                                            std::uint32_t batch_size)
+{
+    const auto &args = fn.args();
+    const auto nargs = static_cast<std::uint32_t>(args.size());
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point types.
+    auto *fp_t = to_llvm_type<T>(context);
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - for each argument, the idx of the u variable or
+    //   the number/par idx argument.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t), llvm::PointerType::getUnqual(fp_t),
+                                    llvm::PointerType::getUnqual(fp_t)};
+
+    std::string mangle;
+    for (const auto &arg : args) {
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    fargs.push_back(llvm::Type::getInt32Ty(context));
+                    mangle += 'v';
+                } else if constexpr (is_num_param_v<type>) {
+                    fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                    mangle += std::is_same_v<type, number> ? 'n' : 'p';
+                } else {
+                    throw std::invalid_argument(
+                        "An invalid argument type was encountered while trying to build the Taylor "
+                        "derivative of an external function in compact mode");
+                }
+            },
+            arg.value());
+    }
+
+    // Get the function name.
+    const auto fname = "heyoka_taylor_diff_ext_{}_{}_{}_n_uvars_{}"_format(fn.get_kernel(), mangle,
+                                                                           taylor_mangle_suffix(val_t), n_uvars);
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto u_idx = f->args().begin() + 1;
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Setup the arrays of derivatives passed to the kernel.
+        // NOTE: the sizes of the arrays depend on the diff order,
+        // and thus they are allocated dynamically.
+        auto *ord_p1 = builder.CreateAdd(ord, builder.getInt32(1));
+        auto *out_ptr = ext_func_alloca(s, fp_t, batch_size);
+        auto *a_ptr = builder.CreateAlloca(fp_t, builder.CreateMul(ord_p1, builder.getInt32(nargs * batch_size)));
+        auto *f_ptr = builder.CreateAlloca(fp_t, builder.CreateMul(ord_p1, builder.getInt32(batch_size)));
+
+        auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+        llvm_loop_u32(s, builder.getInt32(0), ord_p1, [&](llvm::Value *o) {
+            for (std::uint32_t j = 0; j < nargs; ++j) {
+                auto *cur_arg = f->args().begin() + 5 + j;
+
+                auto *val = std::visit(
+                    [&](const auto &v) -> llvm::Value * {
+                        using type = detail::uncvref_t<decltype(v)>;
+
+                        if constexpr (std::is_same_v<type, variable>) {
+                            return taylor_c_load_diff(s, diff_ptr, n_uvars, o, cur_arg);
+                        } else if constexpr (is_num_param_v<type>) {
+                            // NOTE: the numbers/params contribute only
+                            // to the derivative of order zero.
+                            return builder.CreateSelect(builder.CreateICmpEQ(o, builder.getInt32(0)),
+                                                        taylor_c_diff_numparam_codegen(s, v, cur_arg, par_ptr,
+                                                                                       batch_size),
+                                                        zero);
+                        } else {
+                            // LCOV_EXCL_START
+                            assert(false);
+                            return nullptr;
+                            // LCOV_EXCL_STOP
+                        }
+                    },
+                    args[j].value());
+
+                auto *offset = builder.CreateMul(builder.CreateAdd(builder.CreateMul(o, builder.getInt32(nargs)),
+                                                                   builder.getInt32(j)),
+                                                 builder.getInt32(batch_size));
+                store_vector_to_memory(builder, builder.CreateInBoundsGEP(a_ptr, {offset}), val);
+            }
+        });
+
+        llvm_loop_u32(s, builder.getInt32(0), ord, [&](llvm::Value *o) {
+            auto *ptr = builder.CreateInBoundsGEP(f_ptr, {builder.CreateMul(o, builder.getInt32(batch_size))});
+            store_vector_to_memory(builder, ptr, taylor_c_load_diff(s, diff_ptr, n_uvars, o, u_idx));
+        });
+
+        // Return the result.
+        builder.CreateRet(ext_func_invoke_kernel<T>(s, fn, out_ptr, ord, a_ptr, f_ptr, batch_size));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of an external "
+                                        "function in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *ext_func_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars,
+                                                      std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_ext_func<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *ext_func_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                       std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_ext_func<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *ext_func_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                       std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_ext_func<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+expression ext_func(std::string kernel, std::vector<expression> args)
+{
+    return expression{func{detail::ext_func_impl{std::move(kernel), std::move(args)}}};
+}
+
+namespace detail
+{
+
+namespace
+{
+
+template <typename T>
+void register_ext_kernel_impl(const std::string &kernel, ext_kernel_t<T> k)
+{
+    ext_func_check_kernel(kernel);
+
+    if (k == nullptr) {
+        throw std::invalid_argument("Cannot register a null kernel for the external function '{}'"_format(kernel));
+    }
+
+    llvm_state::add_symbol(ext_kernel_symbol<T>(kernel), reinterpret_cast<void *>(k));
+}
+
+} // namespace
+
+} // namespace detail
+
+void register_ext_kernel(const std::string &kernel, ext_kernel_t<double> k)
+{
+    detail::register_ext_kernel_impl<double>(kernel, k);
+}
+
+void register_ext_kernel(const std::string &kernel, ext_kernel_t<long double> k)
+{
+    detail::register_ext_kernel_impl<long double>(kernel, k);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+void register_ext_kernel(const std::string &kernel, ext_kernel_t<mppp::real128> k)
+{
+    detail::register_ext_kernel_impl<mppp::real128>(kernel, k);
+}
+
+#endif
+
+} // namespace heyoka
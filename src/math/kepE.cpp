@@ -72,6 +72,50 @@ kepE_impl::kepE_impl() : kepE_impl(0_dbl, 0_dbl) {}
 
 kepE_impl::kepE_impl(expression e, expression M) : func_base("kepE", std::vector{std::move(e), std::move(M)}) {}
 
+namespace
+{
+
+template <typename T>
+llvm::Value *kepE_codegen_impl(llvm_state &s, const std::vector<llvm::Value *> &args)
+{
+    assert(args.size() == 2u);
+    assert(args[0] != nullptr);
+    assert(args[1] != nullptr);
+
+    // Determine the batch size from the type of the arguments.
+    std::uint32_t batch_size = 1;
+    if (auto vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType())) {
+        batch_size = boost::numeric_cast<std::uint32_t>(vec_t->getNumElements());
+    }
+
+    // Create/fetch the Kepler solver.
+    auto fkep = llvm_add_inv_kep_E<T>(s, batch_size);
+
+    // Invoke and return.
+    return s.builder().CreateCall(fkep, {args[0], args[1]});
+}
+
+} // namespace
+
+llvm::Value *kepE_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return kepE_codegen_impl<double>(s, args);
+}
+
+llvm::Value *kepE_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return kepE_codegen_impl<long double>(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *kepE_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return kepE_codegen_impl<mppp::real128>(s, args);
+}
+
+#endif
+
 expression kepE_impl::diff(const std::string &s) const
 {
     assert(args().size() == 2u);
@@ -166,7 +210,7 @@ llvm::Value *taylor_diff_kepE_impl(llvm_state &s, const std::vector<std::uint32_
     auto &builder = s.builder();
 
     // Fetch the index of the e variable argument.
-    const auto e_idx = uname_to_index(var.name());
+    const auto e_idx = uname_to_index(var);
 
     // Do the codegen for the M number argument.
     auto M = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
@@ -232,7 +276,7 @@ llvm::Value *taylor_diff_kepE_impl(llvm_state &s, const std::vector<std::uint32_
     auto &builder = s.builder();
 
     // Fetch the index of the M variable argument.
-    const auto M_idx = uname_to_index(var.name());
+    const auto M_idx = uname_to_index(var);
 
     // Do the codegen for the e number argument.
     auto e = taylor_codegen_numparam<T>(s, num, par_ptr, batch_size);
@@ -292,8 +336,8 @@ llvm::Value *taylor_diff_kepE_impl(llvm_state &s, const std::vector<std::uint32_
     auto &builder = s.builder();
 
     // Fetch the index of the e/M variable arguments.
-    const auto e_idx = uname_to_index(var0.name());
-    const auto M_idx = uname_to_index(var1.name());
+    const auto e_idx = uname_to_index(var0);
+    const auto M_idx = uname_to_index(var1);
 
     if (order == 0u) {
         // Create/fetch the Kepler solver.
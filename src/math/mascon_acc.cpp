@@ -0,0 +1,807 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/version.hpp>
+
+// NOTE: the header for hash_combine changed in version 1.67.
+#if (BOOST_VERSION / 100000 > 1) || (BOOST_VERSION / 100000 == 1 && BOOST_VERSION / 100 % 1000 >= 67)
+
+#include <boost/container_hash/hash.hpp>
+
+#else
+
+#include <boost/functional/hash.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constant.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+#include <llvm/Support/Casting.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/mascon_acc.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to fetch the name of the function
+// from the index of the acceleration component.
+std::string mascon_acc_name(std::uint32_t comp)
+{
+    switch (comp) {
+        case 0:
+            return "mascon_acc_x";
+        case 1:
+            return "mascon_acc_y";
+        case 2:
+            return "mascon_acc_z";
+        default:
+            throw std::invalid_argument(
+                "Invalid component index {} specified while creating a mascon acceleration: the index "
+                "must be 0, 1 or 2"_format(comp));
+    }
+}
+
+} // namespace
+
+mascon_acc_impl::mascon_acc_impl(std::uint32_t comp, expression x, expression y, expression z,
+                                 std::vector<number> points, std::vector<number> masses)
+    : func_base(mascon_acc_name(comp), std::vector{std::move(x), std::move(y), std::move(z)}), m_comp(comp),
+      m_points(std::move(points)), m_masses(std::move(masses))
+{
+    if (m_masses.empty()) {
+        throw std::invalid_argument("At least one mascon point is needed to create a mascon acceleration");
+    }
+
+    if (m_points.size() / 3u != m_masses.size() || m_points.size() % 3u != 0u) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected while creating a mascon acceleration: the number of point coordinates is {}, "
+            "but the number of masses is {} (the number of coordinates must be three times the number of "
+            "masses)"_format(m_points.size(), m_masses.size()));
+    }
+
+    // NOTE: the mascon points are indexed via 32-bit integers
+    // in the generated code.
+    if (m_masses.size() > std::numeric_limits<std::uint32_t>::max() / 4u) {
+        throw std::overflow_error("Overflow detected while creating a mascon acceleration: the number of mascon "
+                                  "points ({}) is too large"_format(m_masses.size()));
+    }
+}
+
+mascon_acc_impl::mascon_acc_impl()
+    : mascon_acc_impl(0, 0_dbl, 0_dbl, 0_dbl, {number{0.}, number{0.}, number{0.}}, {number{0.}})
+{
+}
+
+std::uint32_t mascon_acc_impl::get_comp() const
+{
+    return m_comp;
+}
+
+const std::vector<number> &mascon_acc_impl::get_points() const
+{
+    return m_points;
+}
+
+const std::vector<number> &mascon_acc_impl::get_masses() const
+{
+    return m_masses;
+}
+
+bool mascon_acc_impl::extra_equal_to(const func &f) const
+{
+    // NOTE: this should be ensured by the
+    // implementation of func's equality operator.
+    assert(f.extract<mascon_acc_impl>() == f.get_ptr());
+
+    const auto *other = static_cast<const mascon_acc_impl *>(f.get_ptr());
+
+    return other->m_comp == m_comp && other->m_points == m_points && other->m_masses == m_masses;
+}
+
+std::size_t mascon_acc_impl::extra_hash() const
+{
+    auto seed = std::hash<std::uint32_t>{}(m_comp);
+
+    for (const auto &n : m_points) {
+        boost::hash_combine(seed, hash(n));
+    }
+
+    for (const auto &n : m_masses) {
+        boost::hash_combine(seed, hash(n));
+    }
+
+    return seed;
+}
+
+namespace
+{
+
+// Helper to fetch the index of the u variable
+// of an argument of a mascon acceleration.
+std::uint32_t mascon_arg_uidx(const expression &e)
+{
+    if (const auto *var_ptr = std::get_if<variable>(&e.value())) {
+        return uname_to_index(*var_ptr);
+    }
+
+    throw std::invalid_argument(
+        "An invalid argument type was encountered while trying to build the Taylor derivative of a mascon "
+        "acceleration: the arguments must all be variables");
+}
+
+// Helper to codegen the square root of x.
+template <typename T>
+llvm::Value *mascon_sqrt(llvm_state &s, llvm::Value *x)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return sqrt_impl{}.codegen_dbl(s, {x});
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return sqrt_impl{}.codegen_ldbl(s, {x});
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return sqrt_impl{}.codegen_f128(s, {x});
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Helper to fetch the global constant array storing the data
+// of a mascon model in the floating-point type T. The array has
+// size 4 * n_points and it contains, in order, the x, y and z coordinates
+// of all the points followed by the masses. That is, the data is stored
+// in struct-of-arrays format, so that the data of consecutive points
+// can be loaded directly into SIMD vectors. If an array with the same
+// content already exists in the module, it will be re-used.
+template <typename T>
+llvm::GlobalVariable *mascon_global_data(llvm_state &s, const mascon_acc_impl &fn)
+{
+    auto &md = s.module();
+    auto &context = s.context();
+
+    const auto &points = fn.get_points();
+    const auto &masses = fn.get_masses();
+    const auto n_points = masses.size();
+
+    std::vector<llvm::Constant *> data;
+    for (decltype(points.size()) c = 0; c < 3u; ++c) {
+        for (decltype(points.size()) i = 0; i < n_points; ++i) {
+            data.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, points[i * 3u + c])));
+        }
+    }
+    for (const auto &m : masses) {
+        data.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, m)));
+    }
+
+    auto *arr_type = llvm::ArrayType::get(to_llvm_type<T>(context), boost::numeric_cast<std::uint64_t>(data.size()));
+    auto *data_arr = llvm::ConstantArray::get(arr_type, data);
+
+    // NOTE: constants are uniqued in LLVM, thus an existing array
+    // with the same content will have the very same initializer.
+    for (auto &gv : md.globals()) {
+        if (gv.isConstant() && gv.hasInitializer() && gv.getInitializer() == data_arr) {
+            return &gv;
+        }
+    }
+
+    return new llvm::GlobalVariable(md, data_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, data_arr,
+                                    "heyoka_mascon_data");
+}
+
+// Emit the code for the computation of the derivative of order ord
+// (an i32 LLVM value) of the mascon acceleration fn. The derivative of order i
+// of the c-th coordinate of the point (c = 0, 1, 2) is returned by load_coord(c, i),
+// where i is an i32 LLVM value in the [0, ord] range. The coordinates and the return value
+// are vectors of size batch_size.
+//
+// NOTE: the contribution of the j-th mascon point to the derivative of order n
+// of the x component of the acceleration is
+// -m_j * sum_{k=0}^n d_j^[k] * u_j^[n-k],
+// where d_j = x - x_j and u_j = (r_j**2)**(-3/2). The derivatives of r_j**2 are
+// (r_j**2)^[0] = sum_c d_{j,c}**2 and, for n > 0,
+// (r_j**2)^[n] = sum_c (2 * d_{j,c} * x_c^[n] + sum_{k=1}^{n-1} x_c^[k] * x_c^[n-k]),
+// where the inner sums do not depend on the mascon point and they are thus computed
+// only once. The derivatives of u_j are computed via the recurrence of the power function,
+// u_j^[n] = 1 / (2 * n * (r_j**2)^[0]) * sum_{k=0}^{n-1} (k - 3 * n) * (r_j**2)^[n-k] * u_j^[k].
+// There is no storage across orders for the derivatives of these intermediate
+// quantities, thus they are re-computed at each order (the cost is linear
+// in the number of mascon points). When the batch size is 1, the loop over the
+// mascon points is vectorised with SIMD instructions.
+template <typename T>
+llvm::Value *mascon_acc_emit(llvm_state &s, const mascon_acc_impl &fn,
+                             const std::function<llvm::Value *(std::uint32_t, llvm::Value *)> &load_coord,
+                             llvm::Value *ord, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    const auto comp = fn.get_comp();
+    const auto n_points = boost::numeric_cast<std::uint32_t>(fn.get_masses().size());
+
+    assert(comp < 3u);
+
+    // Fetch a pointer to the beginning of the mascon data.
+    auto *data_ptr
+        = builder.CreateInBoundsGEP(mascon_global_data<T>(s, fn), {builder.getInt32(0), builder.getInt32(0)});
+
+    auto *scal_t = to_llvm_type<T>(context);
+    auto *val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The number of derivatives to be computed for the intermediate quantities.
+    auto *n_ord = builder.CreateAdd(ord, builder.getInt32(1));
+
+    // Compute the point-independent sums
+    // sum_c sum_{k=1}^{n-1} x_c^[k] * x_c^[n-k] for n in [0, ord].
+    auto *shared_sums = builder.CreateAlloca(val_t, n_ord);
+    auto *shared_acc = builder.CreateAlloca(val_t);
+    llvm_loop_u32(s, builder.getInt32(0), n_ord, [&](llvm::Value *n) {
+        builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), shared_acc);
+
+        llvm_loop_u32(s, builder.getInt32(1), n, [&](llvm::Value *k) {
+            auto *n_k = builder.CreateSub(n, k);
+
+            for (std::uint32_t c = 0; c < 3u; ++c) {
+                auto *tmp = builder.CreateFMul(load_coord(c, k), load_coord(c, n_k));
+                builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(shared_acc), tmp), shared_acc);
+            }
+        });
+
+        builder.CreateStore(builder.CreateLoad(shared_acc), builder.CreateInBoundsGEP(shared_sums, {n}));
+    });
+
+    // The return value.
+    auto *ret_acc = builder.CreateAlloca(val_t);
+    builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), ret_acc);
+
+    // Helper to accumulate into ret_acc the contributions of the mascon
+    // points in the [begin, end) range, processing w points at a time.
+    auto process_points = [&](std::uint32_t w, std::uint32_t begin, std::uint32_t end) {
+        assert(w == 1u || batch_size == 1u);
+        assert((end - begin) % w == 0u);
+
+        // The vector width of the computation.
+        const auto vw = w * batch_size;
+
+        // Helpers to splat scalar constants and the derivatives
+        // of the coordinates to the vector width of the computation.
+        auto splat_const = [&](auto x) { return vector_splat(builder, codegen<T>(s, number{x}), vw); };
+        auto fetch_coord = [&](std::uint32_t c, llvm::Value *i) { return vector_splat(builder, load_coord(c, i), w); };
+
+        // Helper to load the data of the w mascon points starting from p.
+        auto load_data = [&](std::uint32_t c, llvm::Value *p) {
+            auto *ptr = builder.CreateInBoundsGEP(data_ptr, {builder.CreateAdd(builder.getInt32(c * n_points), p)});
+
+            return w == 1u ? vector_splat(builder, builder.CreateLoad(ptr), batch_size)
+                           : load_vector_from_memory(builder, ptr, w);
+        };
+
+        // Storage for the derivatives of the intermediate quantities.
+        auto *vec_t = to_llvm_vector_type<T>(context, vw);
+        auto *r2_arr = builder.CreateAlloca(vec_t, n_ord);
+        auto *u_arr = builder.CreateAlloca(vec_t, n_ord);
+        auto *tmp_acc = builder.CreateAlloca(vec_t);
+
+        // The accumulator for the contributions of the mascon points.
+        auto *pt_acc = builder.CreateAlloca(vec_t);
+        builder.CreateStore(splat_const(0.), pt_acc);
+
+        llvm_loop_u32(
+            s, builder.getInt32(begin), builder.getInt32(end),
+            [&](llvm::Value *p) {
+                // Load the mass and compute the differences
+                // between the coordinates and the mascon points.
+                auto *m = load_data(3, p);
+
+                std::array<llvm::Value *, 3> d{};
+                for (std::uint32_t c = 0; c < 3u; ++c) {
+                    d[c] = builder.CreateFSub(fetch_coord(c, builder.getInt32(0)), load_data(c, p));
+                }
+
+                // The derivatives of r2.
+                auto *r2_0 = builder.CreateFAdd(
+                    builder.CreateFAdd(builder.CreateFMul(d[0], d[0]), builder.CreateFMul(d[1], d[1])),
+                    builder.CreateFMul(d[2], d[2]));
+                builder.CreateStore(r2_0, r2_arr);
+
+                llvm_loop_u32(s, builder.getInt32(1), n_ord, [&](llvm::Value *n) {
+                    auto *dot = builder.CreateFAdd(
+                        builder.CreateFAdd(builder.CreateFMul(d[0], fetch_coord(0, n)),
+                                           builder.CreateFMul(d[1], fetch_coord(1, n))),
+                        builder.CreateFMul(d[2], fetch_coord(2, n)));
+
+                    auto *shared
+                        = vector_splat(builder, builder.CreateLoad(builder.CreateInBoundsGEP(shared_sums, {n})), w);
+
+                    builder.CreateStore(builder.CreateFAdd(shared, builder.CreateFMul(splat_const(2.), dot)),
+                                        builder.CreateInBoundsGEP(r2_arr, {n}));
+                });
+
+                // The derivatives of u.
+                auto *r3_0 = builder.CreateFMul(r2_0, mascon_sqrt<T>(s, r2_0));
+                builder.CreateStore(builder.CreateFDiv(splat_const(1.), r3_0), u_arr);
+
+                auto *two_r2_0 = builder.CreateFMul(splat_const(2.), r2_0);
+
+                llvm_loop_u32(s, builder.getInt32(1), n_ord, [&](llvm::Value *n) {
+                    auto *n_fp = vector_splat(builder, builder.CreateUIToFP(n, scal_t), vw);
+                    auto *three_n = builder.CreateFMul(splat_const(3.), n_fp);
+
+                    builder.CreateStore(splat_const(0.), tmp_acc);
+
+                    llvm_loop_u32(s, builder.getInt32(0), n, [&](llvm::Value *k) {
+                        auto *k_fp = vector_splat(builder, builder.CreateUIToFP(k, scal_t), vw);
+                        auto *coeff = builder.CreateFSub(k_fp, three_n);
+
+                        auto *r2_nk = builder.CreateLoad(builder.CreateInBoundsGEP(r2_arr, {builder.CreateSub(n, k)}));
+                        auto *u_k = builder.CreateLoad(builder.CreateInBoundsGEP(u_arr, {k}));
+
+                        auto *tmp = builder.CreateFMul(coeff, builder.CreateFMul(r2_nk, u_k));
+                        builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(tmp_acc), tmp), tmp_acc);
+                    });
+
+                    builder.CreateStore(
+                        builder.CreateFDiv(builder.CreateLoad(tmp_acc), builder.CreateFMul(two_r2_0, n_fp)),
+                        builder.CreateInBoundsGEP(u_arr, {n}));
+                });
+
+                // The derivative of the product d_comp * u.
+                builder.CreateStore(
+                    builder.CreateFMul(d[comp], builder.CreateLoad(builder.CreateInBoundsGEP(u_arr, {ord}))), tmp_acc);
+
+                llvm_loop_u32(s, builder.getInt32(1), n_ord, [&](llvm::Value *k) {
+                    auto *u_nk = builder.CreateLoad(builder.CreateInBoundsGEP(u_arr, {builder.CreateSub(ord, k)}));
+
+                    auto *tmp = builder.CreateFMul(fetch_coord(comp, k), u_nk);
+                    builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(tmp_acc), tmp), tmp_acc);
+                });
+
+                // Accumulate the contribution of the points.
+                builder.CreateStore(builder.CreateFSub(builder.CreateLoad(pt_acc),
+                                                       builder.CreateFMul(m, builder.CreateLoad(tmp_acc))),
+                                    pt_acc);
+            },
+            [&](llvm::Value *cur) { return builder.CreateAdd(cur, builder.getInt32(w)); });
+
+        // Reduce the contributions of the points, if needed,
+        // and add them to the return value.
+        auto *res = builder.CreateLoad(pt_acc);
+        if (w > 1u) {
+            auto scalars = vector_to_scalars(builder, res);
+            res = pairwise_sum(builder, scalars);
+        }
+
+        builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(ret_acc), res), ret_acc);
+    };
+
+    // NOTE: in scalar mode, the mascon points are processed
+    // in chunks of SIMD vectors, and the remainder is processed
+    // one point at a time.
+    const auto simd_size = batch_size == 1u ? recommended_simd_size<T>() : 1u;
+    const auto n_vec = n_points - n_points % simd_size;
+
+    if (n_vec > 0u) {
+        process_points(simd_size, 0, n_vec);
+    }
+
+    if (n_vec < n_points) {
+        process_points(1, n_vec, n_points);
+    }
+
+    return builder.CreateLoad(ret_acc);
+}
+
+// Helper to codegen the mascon acceleration
+// from the values of the coordinates.
+template <typename T>
+llvm::Value *mascon_acc_codegen(llvm_state &s, const mascon_acc_impl &fn, const std::vector<llvm::Value *> &args)
+{
+    assert(args.size() == 3u);
+
+    // Fetch the batch size from the type of the arguments.
+    std::uint32_t batch_size = 1;
+    if (auto *vec_t = llvm::dyn_cast<llvm::VectorType>(args[0]->getType())) {
+        batch_size = boost::numeric_cast<std::uint32_t>(vec_t->getNumElements());
+    }
+
+    // NOTE: the value of the acceleration is the derivative of order 0.
+    return mascon_acc_emit<T>(
+        s, fn, [&args](std::uint32_t c, llvm::Value *) { return args[c]; }, s.builder().getInt32(0), batch_size);
+}
+
+} // namespace
+
+llvm::Value *mascon_acc_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return mascon_acc_codegen<double>(s, *this, args);
+}
+
+llvm::Value *mascon_acc_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return mascon_acc_codegen<long double>(s, *this, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *mascon_acc_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    return mascon_acc_codegen<mppp::real128>(s, *this, args);
+}
+
+#endif
+
+namespace
+{
+
+// Helper to convert a number to the floating-point type T.
+template <typename T>
+T mascon_num_cast(const number &n)
+{
+    return std::visit([](const auto &v) { return static_cast<T>(v); }, n.value());
+}
+
+template <typename T>
+T mascon_acc_eval(const mascon_acc_impl &f, const std::unordered_map<std::string, T> &map, const std::vector<T> &pars)
+{
+    using std::sqrt;
+
+    const auto &args = f.args();
+    const auto &points = f.get_points();
+    const auto &masses = f.get_masses();
+
+    std::array<T, 3> x{};
+    for (std::size_t c = 0; c < 3u; ++c) {
+        if constexpr (std::is_same_v<T, double>) {
+            x[c] = heyoka::eval_dbl(args[c], map, pars);
+        } else if constexpr (std::is_same_v<T, long double>) {
+            x[c] = heyoka::eval_ldbl(args[c], map, pars);
+#if defined(HEYOKA_HAVE_REAL128)
+        } else if constexpr (std::is_same_v<T, mppp::real128>) {
+            x[c] = heyoka::eval_f128(args[c], map, pars);
+#endif
+        } else {
+            static_assert(detail::always_false_v<T>, "Unhandled type.");
+        }
+    }
+
+    T retval(0);
+    for (decltype(masses.size()) j = 0; j < masses.size(); ++j) {
+        std::array<T, 3> d{};
+        for (std::size_t c = 0; c < 3u; ++c) {
+            d[c] = mascon_num_cast<T>(points[j * 3u + c]) - x[c];
+        }
+
+        const auto r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+        retval += mascon_num_cast<T>(masses[j]) * d[f.get_comp()] / (r2 * sqrt(r2));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+double mascon_acc_impl::eval_dbl(const std::unordered_map<std::string, double> &map,
+                                 const std::vector<double> &pars) const
+{
+    return mascon_acc_eval(*this, map, pars);
+}
+
+long double mascon_acc_impl::eval_ldbl(const std::unordered_map<std::string, long double> &map,
+                                       const std::vector<long double> &pars) const
+{
+    return mascon_acc_eval(*this, map, pars);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+mppp::real128 mascon_acc_impl::eval_f128(const std::unordered_map<std::string, mppp::real128> &map,
+                                         const std::vector<mppp::real128> &pars) const
+{
+    return mascon_acc_eval(*this, map, pars);
+}
+
+#endif
+
+expression mascon_acc_impl::diff(const std::string &s) const
+{
+    // NOTE: the derivative is computed by differentiating
+    // the explicit sum of the contributions of the mascon points.
+    const auto &a = args();
+
+    std::vector<expression> terms;
+    for (decltype(m_masses.size()) j = 0; j < m_masses.size(); ++j) {
+        auto xdiff = expression{m_points[j * 3u]} - a[0];
+        auto ydiff = expression{m_points[j * 3u + 1u]} - a[1];
+        auto zdiff = expression{m_points[j * 3u + 2u]} - a[2];
+
+        auto r2 = square(xdiff) + square(ydiff) + square(zdiff);
+        auto &cdiff = m_comp == 0u ? xdiff : (m_comp == 1u ? ydiff : zdiff);
+
+        terms.push_back(expression{m_masses[j]} * cdiff * pow(std::move(r2), expression{-3. / 2.}));
+    }
+
+    return heyoka::diff(pairwise_sum(std::move(terms)), s);
+}
+
+namespace
+{
+
+template <typename T>
+llvm::Value *taylor_diff_mascon_acc(llvm_state &s, const mascon_acc_impl &f, const std::vector<std::uint32_t> &deps,
+                                    const std::vector<llvm::Value *> &arr, std::uint32_t n_uvars,
+                                    std::uint32_t order, std::uint32_t batch_size)
+{
+    const auto &args = f.args();
+
+    assert(args.size() == 3u);
+
+    if (!deps.empty()) {
+        throw std::invalid_argument("An empty hidden dependency vector is expected in order to compute the Taylor "
+                                    "derivative of a mascon acceleration, but a vector of size {} was passed "
+                                    "instead"_format(deps.size()));
+    }
+
+    // LCOV_EXCL_START
+    if (order > std::numeric_limits<std::uint32_t>::max() / 3u - 1u) {
+        throw std::overflow_error("Overflow detected while computing the Taylor derivative of a mascon acceleration");
+    }
+    // LCOV_EXCL_STOP
+
+    auto &builder = s.builder();
+
+    auto *val_t = to_llvm_vector_type<T>(s.context(), batch_size);
+
+    // Copy the derivatives of the coordinates into a local
+    // array, so that they can be indexed at runtime.
+    auto *coord_arr = builder.CreateInBoundsGEP(builder.CreateAlloca(llvm::ArrayType::get(val_t, 3u * (order + 1u))),
+                                                {builder.getInt32(0), builder.getInt32(0)});
+    for (std::uint32_t c = 0; c < 3u; ++c) {
+        const auto u_idx = mascon_arg_uidx(args[c]);
+
+        for (std::uint32_t k = 0; k <= order; ++k) {
+            builder.CreateStore(taylor_fetch_diff(arr, u_idx, k, n_uvars),
+                                builder.CreateInBoundsGEP(coord_arr, {builder.getInt32(c * (order + 1u) + k)}));
+        }
+    }
+
+    return mascon_acc_emit<T>(
+        s, f,
+        [&](std::uint32_t c, llvm::Value *i) {
+            return builder.CreateLoad(
+                builder.CreateInBoundsGEP(coord_arr, {builder.CreateAdd(builder.getInt32(c * (order + 1u)), i)}));
+        },
+        builder.getInt32(order), batch_size);
+}
+
+} // namespace
+
+llvm::Value *mascon_acc_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                              const std::vector<llvm::Value *> &arr, llvm::Value *, llvm::Value *,
+                                              std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                              std::uint32_t batch_size) const
+{
+    return taylor_diff_mascon_acc<double>(s, *this, deps, arr, n_uvars, order, batch_size);
+}
+
+llvm::Value *mascon_acc_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                               const std::vector<llvm::Value *> &arr, llvm::Value *, llvm::Value *,
+                                               std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                               std::uint32_t batch_size) const
+{
+    return taylor_diff_mascon_acc<long double>(s, *this, deps, arr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *mascon_acc_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                               const std::vector<llvm::Value *> &arr, llvm::Value *, llvm::Value *,
+                                               std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                               std::uint32_t batch_size) const
+{
+    return taylor_diff_mascon_acc<mppp::real128>(s, *this, deps, arr, n_uvars, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_mascon_acc(llvm_state &s, const mascon_acc_impl &fn, std::uint32_t n_uvars,
+                                              std::uint32_t batch_size)
+{
+    const auto &args = fn.args();
+
+    assert(args.size() == 3u);
+
+    // NOTE: check that the arguments are variables.
+    for (const auto &arg : args) {
+        mascon_arg_uidx(arg);
+    }
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - idx of the x, y and z coordinates.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context),
+                                    llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::Type::getInt32Ty(context),
+                                    llvm::Type::getInt32Ty(context),
+                                    llvm::Type::getInt32Ty(context)};
+
+    // Get the function name.
+    // NOTE: the name of the global array containing the mascon data
+    // is used to distinguish between different mascon models.
+    const auto fname = "heyoka_taylor_diff_{}_{}_{}_n_uvars_{}"_format(
+        fn.get_name(), mascon_global_data<T>(s, fn)->getName().str(), taylor_mangle_suffix(val_t), n_uvars);
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto coord_idx = f->args().begin() + 5;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Compute and return the result.
+        builder.CreateRet(mascon_acc_emit<T>(
+            s, fn,
+            [&](std::uint32_t c, llvm::Value *i) {
+                return taylor_c_load_diff(s, diff_ptr, n_uvars, i, coord_idx + c);
+            },
+            ord, batch_size));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of a mascon "
+                                        "acceleration in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *mascon_acc_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars,
+                                                        std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_mascon_acc<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *mascon_acc_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                         std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_mascon_acc<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *mascon_acc_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                         std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_mascon_acc<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+std::vector<expression> mascon_acc(expression x, expression y, expression z, std::vector<number> points,
+                                   std::vector<number> masses)
+{
+    std::vector<expression> retval;
+    for (std::uint32_t c = 0; c < 3u; ++c) {
+        retval.emplace_back(func{detail::mascon_acc_impl(c, x, y, z, points, masses)});
+    }
+
+    return retval;
+}
+
+} // namespace heyoka
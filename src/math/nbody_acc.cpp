@@ -0,0 +1,816 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/nbody_acc.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to evaluate an expression in the floating-point type T.
+template <typename T>
+T nbody_eval_arg(const expression &e, const std::unordered_map<std::string, T> &map, const std::vector<T> &pars)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return heyoka::eval_dbl(e, map, pars);
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return heyoka::eval_ldbl(e, map, pars);
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return heyoka::eval_f128(e, map, pars);
+#endif
+    } else {
+        static_assert(detail::always_false_v<T>, "Unhandled type.");
+    }
+}
+
+// Helper to fetch the index of the u variable
+// of an argument of an N-body function.
+std::uint32_t nbody_arg_uidx(const expression &e, const char *desc)
+{
+    if (const auto *var_ptr = std::get_if<variable>(&e.value())) {
+        return uname_to_index(*var_ptr);
+    }
+
+    throw std::invalid_argument(
+        "An invalid argument type was encountered while trying to build the Taylor derivative of {}"_format(desc));
+}
+
+// Helper to create the common initial arguments
+// of the Taylor derivative functions in compact mode:
+// - diff order,
+// - idx of the u variable whose diff is being computed,
+// - diff array,
+// - par ptr,
+// - time ptr.
+template <typename T>
+std::vector<llvm::Type *> nbody_c_diff_init_fargs(llvm_state &s, llvm::Type *val_t)
+{
+    auto &context = s.context();
+
+    return {llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context), llvm::PointerType::getUnqual(val_t),
+            llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+            llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+}
+
+} // namespace
+
+nbody_r2_impl::nbody_r2_impl(expression x0, expression y0, expression z0, expression x1, expression y1, expression z1)
+    : func_base("nbody_r2", std::vector{std::move(x0), std::move(y0), std::move(z0), std::move(x1), std::move(y1),
+                                        std::move(z1)})
+{
+}
+
+nbody_r2_impl::nbody_r2_impl() : nbody_r2_impl(0_dbl, 0_dbl, 0_dbl, 0_dbl, 0_dbl, 0_dbl) {}
+
+llvm::Value *nbody_r2_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(args.size() == 6u);
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> terms;
+    for (auto i = 0u; i < 3u; ++i) {
+        auto *diff = builder.CreateFSub(args[i + 3u], args[i]);
+        terms.push_back(builder.CreateFMul(diff, diff));
+    }
+
+    return pairwise_sum(builder, terms);
+}
+
+llvm::Value *nbody_r2_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *nbody_r2_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+T nbody_r2_eval(const nbody_r2_impl &f, const std::unordered_map<std::string, T> &map, const std::vector<T> &pars)
+{
+    assert(f.args().size() == 6u);
+
+    T retval(0);
+    for (auto i = 0u; i < 3u; ++i) {
+        const auto diff = nbody_eval_arg(f.args()[i + 3u], map, pars) - nbody_eval_arg(f.args()[i], map, pars);
+        retval += diff * diff;
+    }
+
+    return retval;
+}
+
+} // namespace
+
+double nbody_r2_impl::eval_dbl(const std::unordered_map<std::string, double> &map,
+                               const std::vector<double> &pars) const
+{
+    return nbody_r2_eval(*this, map, pars);
+}
+
+long double nbody_r2_impl::eval_ldbl(const std::unordered_map<std::string, long double> &map,
+                                     const std::vector<long double> &pars) const
+{
+    return nbody_r2_eval(*this, map, pars);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+mppp::real128 nbody_r2_impl::eval_f128(const std::unordered_map<std::string, mppp::real128> &map,
+                                       const std::vector<mppp::real128> &pars) const
+{
+    return nbody_r2_eval(*this, map, pars);
+}
+
+#endif
+
+expression nbody_r2_impl::diff(const std::string &s) const
+{
+    assert(args().size() == 6u);
+
+    std::vector<expression> terms;
+    for (auto i = 0u; i < 3u; ++i) {
+        terms.push_back((args()[i + 3u] - args()[i]) * (heyoka::diff(args()[i + 3u], s) - heyoka::diff(args()[i], s)));
+    }
+
+    return 2_dbl * pairwise_sum(std::move(terms));
+}
+
+namespace
+{
+
+// NOTE: the derivative of order n of the squared distance is
+// sum_c sum_{k=0}^n d_c^[k] * d_c^[n-k],
+// where d_c^[k] = x1_c^[k] - x0_c^[k] is the normalised derivative of order k of the
+// difference between the coordinates of the two bodies. The differences
+// are computed on the fly, so that they do not need to be stored in the decomposition.
+template <typename T>
+llvm::Value *taylor_diff_nbody_r2(llvm_state &s, const nbody_r2_impl &f, const std::vector<std::uint32_t> &deps,
+                                  const std::vector<llvm::Value *> &arr, std::uint32_t n_uvars, std::uint32_t order)
+{
+    assert(f.args().size() == 6u);
+
+    if (!deps.empty()) {
+        throw std::invalid_argument("An empty hidden dependency vector is expected in order to compute the Taylor "
+                                    "derivative of the N-body squared distance, but a vector of size {} was passed "
+                                    "instead"_format(deps.size()));
+    }
+
+    auto &builder = s.builder();
+
+    std::vector<std::uint32_t> u_idx;
+    for (const auto &arg : f.args()) {
+        u_idx.push_back(nbody_arg_uidx(arg, "the N-body squared distance"));
+    }
+
+    std::vector<llvm::Value *> sum;
+    for (std::uint32_t k = 0; k <= order; ++k) {
+        for (auto i = 0u; i < 3u; ++i) {
+            auto *d_k = builder.CreateFSub(taylor_fetch_diff(arr, u_idx[i + 3u], k, n_uvars),
+                                           taylor_fetch_diff(arr, u_idx[i], k, n_uvars));
+            auto *d_nk = builder.CreateFSub(taylor_fetch_diff(arr, u_idx[i + 3u], order - k, n_uvars),
+                                            taylor_fetch_diff(arr, u_idx[i], order - k, n_uvars));
+
+            sum.push_back(builder.CreateFMul(d_k, d_nk));
+        }
+    }
+
+    return pairwise_sum(builder, sum);
+}
+
+} // namespace
+
+llvm::Value *nbody_r2_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                            const std::vector<llvm::Value *> &arr, llvm::Value *, llvm::Value *,
+                                            std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                            std::uint32_t) const
+{
+    return taylor_diff_nbody_r2<double>(s, *this, deps, arr, n_uvars, order);
+}
+
+llvm::Value *nbody_r2_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                             const std::vector<llvm::Value *> &arr, llvm::Value *, llvm::Value *,
+                                             std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                             std::uint32_t) const
+{
+    return taylor_diff_nbody_r2<long double>(s, *this, deps, arr, n_uvars, order);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *nbody_r2_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                             const std::vector<llvm::Value *> &arr, llvm::Value *, llvm::Value *,
+                                             std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                             std::uint32_t) const
+{
+    return taylor_diff_nbody_r2<mppp::real128>(s, *this, deps, arr, n_uvars, order);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_nbody_r2(llvm_state &s, const nbody_r2_impl &fn, std::uint32_t n_uvars,
+                                            std::uint32_t batch_size)
+{
+    assert(fn.args().size() == 6u);
+
+    // NOTE: all the arguments must be variables.
+    for (const auto &arg : fn.args()) {
+        nbody_arg_uidx(arg, "the N-body squared distance in compact mode");
+    }
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Get the function name.
+    const auto fname = "heyoka_taylor_diff_nbody_r2_{}_n_uvars_{}"_format(taylor_mangle_suffix(val_t), n_uvars);
+
+    // The function arguments:
+    // - the common initial arguments,
+    // - the idx of the 6 coordinates.
+    auto fargs = nbody_c_diff_init_fargs<T>(s, val_t);
+    fargs.insert(fargs.end(), 6, llvm::Type::getInt32Ty(context));
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto coord_idx = f->args().begin() + 5;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Create and init the accumulator.
+        auto acc = builder.CreateAlloca(val_t);
+        builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), acc);
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *k) {
+            auto *n_k = builder.CreateSub(ord, k);
+
+            for (auto i = 0u; i < 3u; ++i) {
+                auto *x0 = coord_idx + i;
+                auto *x1 = coord_idx + (i + 3u);
+
+                auto *d_k = builder.CreateFSub(taylor_c_load_diff(s, diff_ptr, n_uvars, k, x1),
+                                               taylor_c_load_diff(s, diff_ptr, n_uvars, k, x0));
+                auto *d_nk = builder.CreateFSub(taylor_c_load_diff(s, diff_ptr, n_uvars, n_k, x1),
+                                                taylor_c_load_diff(s, diff_ptr, n_uvars, n_k, x0));
+
+                builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(d_k, d_nk)), acc);
+            }
+        });
+
+        // Return the result.
+        builder.CreateRet(builder.CreateLoad(acc));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of the N-body "
+                                        "squared distance in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *nbody_r2_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars,
+                                                      std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_nbody_r2<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *nbody_r2_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                       std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_nbody_r2<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *nbody_r2_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                       std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_nbody_r2<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+// Helper to assemble the arguments of nbody_acc_impl.
+std::vector<expression> nbody_acc_make_args(expression x, std::vector<expression> cs, std::vector<expression> xs,
+                                            std::vector<expression> r_m3s)
+{
+    if (cs.size() != xs.size() || cs.size() != r_m3s.size()) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected while creating an N-body acceleration: the number of coefficients is {}, "
+            "the number of coordinates is {} and the number of inverse cubed distances is {}"_format(
+                cs.size(), xs.size(), r_m3s.size()));
+    }
+
+    if (cs.empty()) {
+        throw std::invalid_argument("At least one attracting body is needed to create an N-body acceleration");
+    }
+
+    std::vector<expression> retval{std::move(x)};
+    for (decltype(cs.size()) i = 0; i < cs.size(); ++i) {
+        retval.push_back(std::move(cs[i]));
+        retval.push_back(std::move(xs[i]));
+        retval.push_back(std::move(r_m3s[i]));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+nbody_acc_impl::nbody_acc_impl(expression x, std::vector<expression> cs, std::vector<expression> xs,
+                               std::vector<expression> r_m3s)
+    : func_base("nbody_acc", nbody_acc_make_args(std::move(x), std::move(cs), std::move(xs), std::move(r_m3s)))
+{
+}
+
+nbody_acc_impl::nbody_acc_impl() : nbody_acc_impl(0_dbl, {0_dbl}, {0_dbl}, {0_dbl}) {}
+
+llvm::Value *nbody_acc_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(args.size() >= 4u);
+    assert(args.size() % 3u == 1u);
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> terms;
+    for (decltype(args.size()) i = 1; i < args.size(); i += 3u) {
+        terms.push_back(
+            builder.CreateFMul(args[i], builder.CreateFMul(builder.CreateFSub(args[i + 1u], args[0]), args[i + 2u])));
+    }
+
+    return pairwise_sum(builder, terms);
+}
+
+llvm::Value *nbody_acc_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *nbody_acc_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+T nbody_acc_eval(const nbody_acc_impl &f, const std::unordered_map<std::string, T> &map, const std::vector<T> &pars)
+{
+    const auto &args = f.args();
+
+    const auto x = nbody_eval_arg(args[0], map, pars);
+
+    T retval(0);
+    for (decltype(args.size()) i = 1; i < args.size(); i += 3u) {
+        retval += nbody_eval_arg(args[i], map, pars) * (nbody_eval_arg(args[i + 1u], map, pars) - x)
+                  * nbody_eval_arg(args[i + 2u], map, pars);
+    }
+
+    return retval;
+}
+
+} // namespace
+
+double nbody_acc_impl::eval_dbl(const std::unordered_map<std::string, double> &map,
+                                const std::vector<double> &pars) const
+{
+    return nbody_acc_eval(*this, map, pars);
+}
+
+long double nbody_acc_impl::eval_ldbl(const std::unordered_map<std::string, long double> &map,
+                                      const std::vector<long double> &pars) const
+{
+    return nbody_acc_eval(*this, map, pars);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+mppp::real128 nbody_acc_impl::eval_f128(const std::unordered_map<std::string, mppp::real128> &map,
+                                        const std::vector<mppp::real128> &pars) const
+{
+    return nbody_acc_eval(*this, map, pars);
+}
+
+#endif
+
+expression nbody_acc_impl::diff(const std::string &s) const
+{
+    const auto &a = args();
+
+    const auto dx = heyoka::diff(a[0], s);
+
+    std::vector<expression> terms;
+    for (decltype(a.size()) i = 1; i < a.size(); i += 3u) {
+        const auto &c = a[i];
+        const auto &xj = a[i + 1u];
+        const auto &r_m3 = a[i + 2u];
+
+        terms.push_back(heyoka::diff(c, s) * (xj - a[0]) * r_m3
+                        + c * ((heyoka::diff(xj, s) - dx) * r_m3 + (xj - a[0]) * heyoka::diff(r_m3, s)));
+    }
+
+    return pairwise_sum(std::move(terms));
+}
+
+namespace
+{
+
+// NOTE: the derivative of order n of the acceleration is
+// sum_j c_j * sum_{k=0}^n (x_j^[k] - x^[k]) * r_m3_j^[n-k],
+// where the c_j are numbers or parameters. The whole sum is
+// computed in a single function, so that the products and the
+// partial sums do not need to be stored in the decomposition.
+template <typename T>
+llvm::Value *taylor_diff_nbody_acc(llvm_state &s, const nbody_acc_impl &f, const std::vector<std::uint32_t> &deps,
+                                   const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                                   std::uint32_t order, std::uint32_t batch_size)
+{
+    const auto &args = f.args();
+
+    assert(args.size() >= 4u);
+    assert(args.size() % 3u == 1u);
+
+    if (!deps.empty()) {
+        throw std::invalid_argument("An empty hidden dependency vector is expected in order to compute the Taylor "
+                                    "derivative of the N-body acceleration, but a vector of size {} was passed "
+                                    "instead"_format(deps.size()));
+    }
+
+    auto &builder = s.builder();
+
+    const auto x_idx = nbody_arg_uidx(args[0], "the N-body acceleration");
+
+    // Codegen the coefficients and fetch the indices of the other arguments.
+    std::vector<llvm::Value *> cs;
+    std::vector<std::uint32_t> xs_idx, r_m3s_idx;
+    for (decltype(args.size()) i = 1; i < args.size(); i += 3u) {
+        cs.push_back(std::visit(
+            [&](const auto &v) -> llvm::Value * {
+                if constexpr (is_num_param_v<detail::uncvref_t<decltype(v)>>) {
+                    return taylor_codegen_numparam<T>(s, v, par_ptr, batch_size);
+                } else {
+                    throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                                "Taylor derivative of the N-body acceleration");
+                }
+            },
+            args[i].value()));
+
+        xs_idx.push_back(nbody_arg_uidx(args[i + 1u], "the N-body acceleration"));
+        r_m3s_idx.push_back(nbody_arg_uidx(args[i + 2u], "the N-body acceleration"));
+    }
+
+    std::vector<llvm::Value *> sum;
+    for (decltype(cs.size()) j = 0; j < cs.size(); ++j) {
+        std::vector<llvm::Value *> tmp;
+        for (std::uint32_t k = 0; k <= order; ++k) {
+            auto *diff = builder.CreateFSub(taylor_fetch_diff(arr, xs_idx[j], k, n_uvars),
+                                            taylor_fetch_diff(arr, x_idx, k, n_uvars));
+
+            tmp.push_back(builder.CreateFMul(diff, taylor_fetch_diff(arr, r_m3s_idx[j], order - k, n_uvars)));
+        }
+
+        sum.push_back(builder.CreateFMul(cs[j], pairwise_sum(builder, tmp)));
+    }
+
+    return pairwise_sum(builder, sum);
+}
+
+} // namespace
+
+llvm::Value *nbody_acc_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                             const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                             llvm::Value *, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                             std::uint32_t batch_size) const
+{
+    return taylor_diff_nbody_acc<double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+llvm::Value *nbody_acc_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                              const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                              llvm::Value *, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                              std::uint32_t batch_size) const
+{
+    return taylor_diff_nbody_acc<long double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *nbody_acc_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                              const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr,
+                                              llvm::Value *, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                              std::uint32_t batch_size) const
+{
+    return taylor_diff_nbody_acc<mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_nbody_acc(llvm_state &s, const nbody_acc_impl &fn, std::uint32_t n_uvars,
+                                             std::uint32_t batch_size)
+{
+    const auto &args = fn.args();
+
+    assert(args.size() >= 4u);
+    assert(args.size() % 3u == 1u);
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments:
+    // - the common initial arguments,
+    // - the idx of the coordinate of the body,
+    // - for each attracting body, the coefficient (number or par idx),
+    //   the idx of the coordinate and the idx of the inverse cubed distance.
+    // NOTE: the mangled name encodes the type of each coefficient,
+    // which also determines the number of attracting bodies.
+    auto fargs = nbody_c_diff_init_fargs<T>(s, val_t);
+    fargs.push_back(llvm::Type::getInt32Ty(context));
+
+    nbody_arg_uidx(args[0], "the N-body acceleration in compact mode");
+
+    std::string c_mangle;
+    for (decltype(args.size()) i = 1; i < args.size(); i += 3u) {
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (is_num_param_v<type>) {
+                    fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                    c_mangle += std::is_same_v<type, number> ? 'n' : 'p';
+                } else {
+                    throw std::invalid_argument("An invalid argument type was encountered while trying to build the "
+                                                "Taylor derivative of the N-body acceleration in compact mode");
+                }
+            },
+            args[i].value());
+
+        nbody_arg_uidx(args[i + 1u], "the N-body acceleration in compact mode");
+        nbody_arg_uidx(args[i + 2u], "the N-body acceleration in compact mode");
+
+        fargs.push_back(llvm::Type::getInt32Ty(context));
+        fargs.push_back(llvm::Type::getInt32Ty(context));
+    }
+
+    // Get the function name.
+    const auto fname
+        = "heyoka_taylor_diff_nbody_acc_{}_{}_n_uvars_{}"_format(c_mangle, taylor_mangle_suffix(val_t), n_uvars);
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+        auto x_idx = f->args().begin() + 5;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Codegen the coefficients.
+        std::vector<llvm::Value *> cs;
+        for (decltype(args.size()) i = 1; i < args.size(); i += 3u) {
+            cs.push_back(std::visit(
+                [&](const auto &v) -> llvm::Value * {
+                    if constexpr (is_num_param_v<detail::uncvref_t<decltype(v)>>) {
+                        return taylor_c_diff_numparam_codegen(s, v, f->args().begin() + 5 + i, par_ptr, batch_size);
+                    } else {
+                        // LCOV_EXCL_START
+                        assert(false);
+                        return nullptr;
+                        // LCOV_EXCL_STOP
+                    }
+                },
+                args[i].value()));
+        }
+
+        // Create and init the accumulators, one per attracting body.
+        // NOTE: the coefficients are applied at the end.
+        std::vector<llvm::Value *> accs;
+        for (decltype(cs.size()) j = 0; j < cs.size(); ++j) {
+            accs.push_back(builder.CreateAlloca(val_t));
+            builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), accs.back());
+        }
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(ord, builder.getInt32(1)), [&](llvm::Value *k) {
+            auto *n_k = builder.CreateSub(ord, k);
+
+            auto *x_k = taylor_c_load_diff(s, diff_ptr, n_uvars, k, x_idx);
+
+            for (decltype(cs.size()) j = 0; j < cs.size(); ++j) {
+                auto *xj_idx = f->args().begin() + 5 + (1 + 3 * j + 1);
+                auto *r_m3_idx = f->args().begin() + 5 + (1 + 3 * j + 2);
+
+                auto *diff = builder.CreateFSub(taylor_c_load_diff(s, diff_ptr, n_uvars, k, xj_idx), x_k);
+                auto *tmp = builder.CreateFMul(diff, taylor_c_load_diff(s, diff_ptr, n_uvars, n_k, r_m3_idx));
+
+                builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(accs[j]), tmp), accs[j]);
+            }
+        });
+
+        // Apply the coefficients and sum.
+        std::vector<llvm::Value *> sum;
+        for (decltype(cs.size()) j = 0; j < cs.size(); ++j) {
+            sum.push_back(builder.CreateFMul(cs[j], builder.CreateLoad(accs[j])));
+        }
+
+        // Return the result.
+        builder.CreateRet(pairwise_sum(builder, sum));
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument("Inconsistent function signature for the Taylor derivative of the N-body "
+                                        "acceleration in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *nbody_acc_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars,
+                                                       std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_nbody_acc<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *nbody_acc_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars,
+                                                        std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_nbody_acc<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *nbody_acc_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                        std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_nbody_acc<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+expression nbody_r2(expression x0, expression y0, expression z0, expression x1, expression y1, expression z1)
+{
+    return expression{func{detail::nbody_r2_impl(std::move(x0), std::move(y0), std::move(z0), std::move(x1),
+                                                 std::move(y1), std::move(z1))}};
+}
+
+expression nbody_acc(expression x, std::vector<expression> cs, std::vector<expression> xs,
+                     std::vector<expression> r_m3s)
+{
+    return expression{func{detail::nbody_acc_impl(std::move(x), std::move(cs), std::move(xs), std::move(r_m3s))}};
+}
+
+} // namespace heyoka
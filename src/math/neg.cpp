@@ -140,7 +140,7 @@ llvm::Value *taylor_diff_neg_impl(llvm_state &s, const neg_impl &, const variabl
                                   const std::vector<llvm::Value *> &arr, llvm::Value *, std::uint32_t n_uvars,
                                   std::uint32_t order, std::uint32_t, std::uint32_t)
 {
-    return s.builder().CreateFNeg(taylor_fetch_diff(arr, uname_to_index(var.name()), order, n_uvars));
+    return s.builder().CreateFNeg(taylor_fetch_diff(arr, uname_to_index(var), order, n_uvars));
 }
 
 // All the other cases.
@@ -0,0 +1,651 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/poly.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Build the arguments of a polynomial, checking
+// that the coefficients are numbers and that the degree
+// is at least 2.
+std::vector<expression> poly_make_args(expression x, std::vector<expression> cfs)
+{
+    if (cfs.size() < 3u) {
+        throw std::invalid_argument("A polynomial function must have at least 3 coefficients, but {} coefficient(s) "
+                                    "were provided instead"_format(cfs.size()));
+    }
+
+    for (const auto &c : cfs) {
+        if (!std::holds_alternative<number>(c.value())) {
+            throw std::invalid_argument("The coefficients of a polynomial function must be numbers");
+        }
+    }
+
+    std::vector<expression> retval{std::move(x)};
+    retval.insert(retval.end(), std::make_move_iterator(cfs.begin()), std::make_move_iterator(cfs.end()));
+
+    return retval;
+}
+
+// Fetch the coefficient of degree i.
+const number &poly_cf(const poly_impl &f, std::vector<expression>::size_type i)
+{
+    assert(i + 1u < f.args().size());
+    assert(std::holds_alternative<number>(f.args()[i + 1u].value()));
+
+    return std::get<number>(f.args()[i + 1u].value());
+}
+
+// The coefficients of the derivative of f.
+std::vector<expression> poly_dcfs(const poly_impl &f)
+{
+    std::vector<expression> retval;
+    for (decltype(f.args().size()) i = 2; i < f.args().size(); ++i) {
+        retval.emplace_back(number{static_cast<double>(i - 1u)} * poly_cf(f, i - 1u));
+    }
+
+    return retval;
+}
+
+// NOTE: Estrin's scheme shortens the dependency chain of the
+// evaluation from d to ~2*log2(d) operations at the price of
+// ~log2(d) extra multiplications. Use it only for high degrees.
+constexpr std::size_t poly_estrin_min_ncfs = 10;
+
+// Evaluate the polynomial with coefficients cfs at x.
+llvm::Value *poly_eval(llvm_state &s, llvm::Value *x, std::vector<llvm::Value *> cfs)
+{
+    assert(cfs.size() >= 2u);
+
+    if (cfs.size() < poly_estrin_min_ncfs) {
+        // Horner's scheme.
+        auto *ret = cfs.back();
+        for (auto i = cfs.size() - 1u; i > 0u; --i) {
+            ret = llvm_fmuladd(s, ret, x, cfs[i - 1u]);
+        }
+
+        return ret;
+    }
+
+    // Estrin's scheme: at each iteration, combine the coefficients
+    // pairwise with the current power of x and square the power.
+    auto *xp = x;
+    while (cfs.size() > 1u) {
+        std::vector<llvm::Value *> next;
+        for (decltype(cfs.size()) i = 0; i + 1u < cfs.size(); i += 2u) {
+            next.push_back(llvm_fmuladd(s, cfs[i + 1u], xp, cfs[i]));
+        }
+        if (cfs.size() % 2u == 1u) {
+            next.push_back(cfs.back());
+        }
+
+        cfs = std::move(next);
+
+        if (cfs.size() > 1u) {
+            xp = s.builder().CreateFMul(xp, xp);
+        }
+    }
+
+    return cfs[0];
+}
+
+} // namespace
+
+poly_impl::poly_impl(expression x, std::vector<expression> cfs)
+    : func_base("poly", poly_make_args(std::move(x), std::move(cfs)))
+{
+}
+
+poly_impl::poly_impl() : poly_impl(0_dbl, {0_dbl, 0_dbl, 1_dbl}) {}
+
+llvm::Value *poly_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(args.size() >= 4u);
+
+    return poly_eval(s, args[0], std::vector<llvm::Value *>(args.begin() + 1, args.end()));
+}
+
+llvm::Value *poly_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *poly_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+expression poly_impl::diff(const std::string &s) const
+{
+    assert(args().size() >= 4u);
+
+    return poly(args()[0], poly_dcfs(*this)) * heyoka::diff(args()[0], s);
+}
+
+namespace
+{
+
+template <typename T>
+T poly_eval_impl(const poly_impl &f, const std::unordered_map<std::string, T> &map, const std::vector<T> &pars)
+{
+    auto eval = [&map, &pars](const expression &e) {
+        if constexpr (std::is_same_v<T, double>) {
+            return heyoka::eval_dbl(e, map, pars);
+        } else if constexpr (std::is_same_v<T, long double>) {
+            return heyoka::eval_ldbl(e, map, pars);
+#if defined(HEYOKA_HAVE_REAL128)
+        } else if constexpr (std::is_same_v<T, mppp::real128>) {
+            return heyoka::eval_f128(e, map, pars);
+#endif
+        } else {
+            static_assert(always_false_v<T>, "Unhandled type.");
+        }
+    };
+
+    const auto x = eval(f.args()[0]);
+
+    T retval = eval(f.args().back());
+    for (auto i = f.args().size() - 2u; i > 0u; --i) {
+        retval = retval * x + eval(f.args()[i]);
+    }
+
+    return retval;
+}
+
+} // namespace
+
+double poly_impl::eval_dbl(const std::unordered_map<std::string, double> &map, const std::vector<double> &pars) const
+{
+    return poly_eval_impl(*this, map, pars);
+}
+
+long double poly_impl::eval_ldbl(const std::unordered_map<std::string, long double> &map,
+                                 const std::vector<long double> &pars) const
+{
+    return poly_eval_impl(*this, map, pars);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+mppp::real128 poly_impl::eval_f128(const std::unordered_map<std::string, mppp::real128> &map,
+                                   const std::vector<mppp::real128> &pars) const
+{
+    return poly_eval_impl(*this, map, pars);
+}
+
+#endif
+
+taylor_dc_t::size_type poly_impl::taylor_decompose(taylor_dc_t &u_vars_defs) &&
+{
+    assert(args().size() >= 4u);
+
+    // Decompose the argument.
+    auto &arg = *get_mutable_args_it().first;
+    if (const auto dres = taylor_decompose_in_place(std::move(arg), u_vars_defs)) {
+        arg = expression{variable{"u_{}"_format(dres)}};
+    }
+
+    // NOTE: the derivative of the polynomial is needed as a hidden
+    // dependency only if the argument is a variable and the degree is
+    // greater than 2. For degree 2, the derivative is linear in the
+    // argument and it is computed on the fly.
+    std::vector<std::uint32_t> deps;
+    if (std::holds_alternative<variable>(arg.value()) && args().size() > 4u) {
+        // NOTE: the derivative is a polynomial of degree at least 2,
+        // whose decomposition will in turn append the derivatives of
+        // lower degree.
+        auto dp = poly(arg, poly_dcfs(*this));
+        assert(std::holds_alternative<func>(dp.value()));
+
+        const auto dres = taylor_decompose_in_place(std::move(dp), u_vars_defs);
+        assert(dres > 0u);
+
+        deps.push_back(boost::numeric_cast<std::uint32_t>(dres));
+    }
+
+    // Append the polynomial decomposition.
+    u_vars_defs.emplace_back(func{std::move(*this)}, std::move(deps));
+
+    return u_vars_defs.size() - 1u;
+}
+
+namespace
+{
+
+// NOTE: if w(t) is the derivative of the polynomial evaluated at x(t),
+// then the derivative of order n > 0 of p(x(t)) is
+// 1/n * sum_{j=1}^n j * x^[j] * w^[n-j].
+template <typename T>
+llvm::Value *taylor_diff_poly(llvm_state &s, const poly_impl &f, const std::vector<std::uint32_t> &deps,
+                              const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                              std::uint32_t order, std::uint32_t batch_size)
+{
+    assert(f.args().size() >= 4u);
+
+    auto &builder = s.builder();
+
+    // Codegen the coefficients.
+    std::vector<llvm::Value *> cfs;
+    for (decltype(f.args().size()) i = 0; i + 1u < f.args().size(); ++i) {
+        cfs.push_back(vector_splat(builder, codegen<T>(s, poly_cf(f, i)), batch_size));
+    }
+
+    return std::visit(
+        [&](const auto &v) -> llvm::Value * {
+            using type = detail::uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, variable>) {
+                const auto n_deps = cfs.size() > 3u ? 1u : 0u;
+                if (deps.size() != n_deps) {
+                    throw std::invalid_argument(
+                        "A hidden dependency vector of size {} is expected in order to compute the Taylor "
+                        "derivative of the polynomial, but a vector of size {} was passed "
+                        "instead"_format(n_deps, deps.size()));
+                }
+
+                // Fetch the index of the variable.
+                const auto u_idx = uname_to_index(v);
+
+                if (order == 0u) {
+                    return poly_eval(s, taylor_fetch_diff(arr, u_idx, 0, n_uvars), cfs);
+                }
+
+                // Helper to fetch the derivative of order m of w.
+                auto fetch_w = [&](std::uint32_t m) -> llvm::Value * {
+                    if (!deps.empty()) {
+                        return taylor_fetch_diff(arr, deps[0], m, n_uvars);
+                    }
+
+                    // Degree 2: w = c1 + 2 * c2 * x.
+                    auto *ret = builder.CreateFMul(builder.CreateFAdd(cfs[2], cfs[2]),
+                                                   taylor_fetch_diff(arr, u_idx, m, n_uvars));
+
+                    return m == 0u ? builder.CreateFAdd(cfs[1], ret) : ret;
+                };
+
+                // NOTE: iteration in the [1, order] range
+                // (i.e., order included).
+                std::vector<llvm::Value *> sum;
+                for (std::uint32_t j = 1; j <= order; ++j) {
+                    auto *fac = vector_splat(builder, codegen<T>(s, number(static_cast<T>(j))), batch_size);
+
+                    sum.push_back(builder.CreateFMul(
+                        fac, builder.CreateFMul(taylor_fetch_diff(arr, u_idx, j, n_uvars), fetch_w(order - j))));
+                }
+
+                auto *div = vector_splat(builder, codegen<T>(s, number(static_cast<T>(order))), batch_size);
+
+                return builder.CreateFDiv(pairwise_sum(builder, sum), div);
+            } else if constexpr (is_num_param_v<type>) {
+                if (!deps.empty()) {
+                    throw std::invalid_argument(
+                        "An empty hidden dependency vector is expected in order to compute the Taylor "
+                        "derivative of the polynomial, but a vector of size {} was passed "
+                        "instead"_format(deps.size()));
+                }
+
+                if (order == 0u) {
+                    return poly_eval(s, taylor_codegen_numparam<T>(s, v, par_ptr, batch_size), cfs);
+                } else {
+                    return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+                }
+            } else {
+                throw std::invalid_argument(
+                    "An invalid argument type was encountered while trying to build the Taylor "
+                    "derivative of the polynomial");
+            }
+        },
+        f.args()[0].value());
+}
+
+} // namespace
+
+llvm::Value *poly_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_poly<double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+llvm::Value *poly_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                         const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                         std::uint32_t batch_size) const
+{
+    return taylor_diff_poly<long double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *poly_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                         const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                         std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                         std::uint32_t batch_size) const
+{
+    return taylor_diff_poly<mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_poly(llvm_state &s, const poly_impl &fn, std::uint32_t n_uvars,
+                                        std::uint32_t batch_size)
+{
+    const auto &args = fn.args();
+    assert(args.size() >= 4u);
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Number of coefficients.
+    const auto ncfs = args.size() - 1u;
+
+    // Is there a hidden dependency?
+    const auto has_dep = std::holds_alternative<variable>(args[0].value()) && ncfs > 3u;
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - idx of the var argument or number/par idx argument,
+    // - the coefficients,
+    // - if the argument is a variable and the degree is greater than 2,
+    //   idx of the uvar whose definition is the derivative of the polynomial.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+
+    const auto x_mangle = std::visit(
+        [&](const auto &v) -> std::string {
+            using type = detail::uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, variable>) {
+                fargs.push_back(llvm::Type::getInt32Ty(context));
+                return "var";
+            } else if constexpr (is_num_param_v<type>) {
+                fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                return taylor_c_diff_numparam_mangle(v);
+            } else {
+                throw std::invalid_argument(
+                    "An invalid argument type was encountered while trying to build the Taylor "
+                    "derivative of the polynomial in compact mode");
+            }
+        },
+        args[0].value());
+
+    for (decltype(args.size()) i = 0; i < ncfs; ++i) {
+        fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, poly_cf(fn, i)));
+    }
+
+    if (has_dep) {
+        fargs.push_back(llvm::Type::getInt32Ty(context));
+    }
+
+    // Get the function name.
+    // NOTE: the type of the argument and the degree determine the signature.
+    const auto fname = "heyoka_taylor_diff_poly_{}_deg_{}_{}_n_uvars_{}"_format(x_mangle, ncfs - 1u,
+                                                                                taylor_mangle_suffix(val_t), n_uvars);
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+        auto x_arg = f->args().begin() + 5;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Codegen the coefficients.
+        std::vector<llvm::Value *> cfs;
+        for (decltype(args.size()) i = 0; i < ncfs; ++i) {
+            cfs.push_back(
+                taylor_c_diff_numparam_codegen(s, poly_cf(fn, i), f->args().begin() + 6 + i, par_ptr, batch_size));
+        }
+
+        auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    // Create the return value.
+                    auto retval = builder.CreateAlloca(val_t);
+
+                    // Create the accumulator.
+                    auto acc = builder.CreateAlloca(val_t);
+
+                    llvm_if_then_else(
+                        s, builder.CreateICmpEQ(ord, builder.getInt32(0)),
+                        [&]() {
+                            // For order 0, evaluate the polynomial on the order 0 of x_arg.
+                            builder.CreateStore(
+                                poly_eval(s, taylor_c_load_diff(s, diff_ptr, n_uvars, builder.getInt32(0), x_arg),
+                                          cfs),
+                                retval);
+                        },
+                        [&]() {
+                            // Init the accumlator.
+                            builder.CreateStore(zero, acc);
+
+                            // Run the loop.
+                            llvm_loop_u32(
+                                s, builder.getInt32(1), builder.CreateAdd(ord, builder.getInt32(1)),
+                                [&](llvm::Value *j) {
+                                    auto *m = builder.CreateSub(ord, j);
+
+                                    llvm::Value *w_m = nullptr;
+                                    if (has_dep) {
+                                        w_m = taylor_c_load_diff(s, diff_ptr, n_uvars, m,
+                                                                 f->args().begin() + 6 + ncfs);
+                                    } else {
+                                        // Degree 2: w = c1 + 2 * c2 * x.
+                                        w_m = builder.CreateFMul(builder.CreateFAdd(cfs[2], cfs[2]),
+                                                                 taylor_c_load_diff(s, diff_ptr, n_uvars, m, x_arg));
+                                        w_m = builder.CreateSelect(builder.CreateICmpEQ(m, builder.getInt32(0)),
+                                                                   builder.CreateFAdd(cfs[1], w_m), w_m);
+                                    }
+
+                                    auto *x_j = taylor_c_load_diff(s, diff_ptr, n_uvars, j, x_arg);
+
+                                    auto *j_v = vector_splat(builder, builder.CreateUIToFP(j, to_llvm_type<T>(context)),
+                                                             batch_size);
+
+                                    builder.CreateStore(
+                                        builder.CreateFAdd(builder.CreateLoad(acc),
+                                                           builder.CreateFMul(j_v, builder.CreateFMul(x_j, w_m))),
+                                        acc);
+                                });
+
+                            // Divide by the order to produce the return value.
+                            auto ord_v = vector_splat(builder, builder.CreateUIToFP(ord, to_llvm_type<T>(context)),
+                                                      batch_size);
+                            builder.CreateStore(builder.CreateFDiv(builder.CreateLoad(acc), ord_v), retval);
+                        });
+
+                    // Return the result.
+                    builder.CreateRet(builder.CreateLoad(retval));
+                } else if constexpr (is_num_param_v<type>) {
+                    // NOTE: the derivatives of order n > 0 of a polynomial
+                    // of a number/param are zero.
+                    auto *p = poly_eval(s, taylor_c_diff_numparam_codegen(s, v, x_arg, par_ptr, batch_size), cfs);
+
+                    builder.CreateRet(builder.CreateSelect(builder.CreateICmpEQ(ord, builder.getInt32(0)), p, zero));
+                } else {
+                    // LCOV_EXCL_START
+                    assert(false);
+                    // LCOV_EXCL_STOP
+                }
+            },
+            args[0].value());
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument(
+                "Inconsistent function signature for the Taylor derivative of the polynomial in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *poly_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_poly<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *poly_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_poly<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *poly_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars,
+                                                   std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_poly<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+expression poly(expression x, std::vector<expression> cfs)
+{
+    if (cfs.empty()) {
+        throw std::invalid_argument("Cannot create a polynomial function without coefficients");
+    }
+
+    for (const auto &c : cfs) {
+        if (!std::holds_alternative<number>(c.value())) {
+            throw std::invalid_argument("The coefficients of a polynomial function must be numbers");
+        }
+    }
+
+    // Discard the trailing zero coefficients.
+    while (cfs.size() > 1u && is_zero(std::get<number>(cfs.back().value()))) {
+        cfs.pop_back();
+    }
+
+    switch (cfs.size()) {
+        case 1u:
+            return std::move(cfs[0]);
+        case 2u:
+            return std::move(cfs[0]) + std::move(cfs[1]) * std::move(x);
+        default:
+            return expression{func{detail::poly_impl(std::move(x), std::move(cfs))}};
+    }
+}
+
+} // namespace heyoka
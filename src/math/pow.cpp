@@ -12,6 +12,7 @@
 #include <cmath>
 #include <cstdint>
 #include <initializer_list>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -26,6 +27,7 @@
 
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
@@ -93,6 +95,98 @@ bool pow_allow_approx(const pow_impl &pi)
     return is_integral(pi.args()[1]) || is_odd_integral_half(pi.args()[1]);
 }
 
+// Maximum absolute value of the exponent for which
+// pow() is expanded into multiplications and sqrt().
+constexpr std::int64_t pow_max_expand_exp = 8;
+
+// If the exponent of pi is an integral or half-integral number
+// whose absolute value is not greater than pow_max_expand_exp,
+// return twice the exponent. Otherwise, return an empty optional.
+std::optional<std::int64_t> pow_expand_exp2(const pow_impl &pi)
+{
+    if (!pow_allow_approx(pi)) {
+        return {};
+    }
+
+    return std::visit(
+        [](const auto &x) -> std::optional<std::int64_t> {
+            using std::abs;
+
+            if (abs(x) > pow_max_expand_exp) {
+                return {};
+            }
+
+            return static_cast<std::int64_t>(2 * x);
+        },
+        std::get<number>(pi.args()[1].value()).value());
+}
+
+// Expand pow(x, n2 / 2) into a sequence of multiplications,
+// possibly followed by a square root and a reciprocal. This
+// is cheaper than the general-purpose implementation of pow()
+// for the powers commonly encountered in gravitational
+// models, e.g., x**(-3/2).
+template <typename T>
+llvm::Value *pow_expand(llvm_state &s, llvm::Value *x, std::int64_t n2)
+{
+    auto &builder = s.builder();
+
+    // NOTE: the result of the multiplications, if any.
+    llvm::Value *ret = nullptr;
+
+    // https://en.wikipedia.org/wiki/Exponentiation_by_squaring
+    auto base = x;
+    for (auto n = (n2 < 0 ? -n2 : n2) / 2; n > 0; n /= 2) {
+        if (n % 2 == 1) {
+            ret = ret == nullptr ? base : builder.CreateFMul(ret, base);
+        }
+
+        if (n > 1) {
+            base = builder.CreateFMul(base, base);
+        }
+    }
+
+    if (n2 % 2 != 0) {
+        // Half-integral exponent.
+        llvm::Value *sq = nullptr;
+        if constexpr (std::is_same_v<T, double>) {
+            sq = sqrt_impl{}.codegen_dbl(s, {x});
+        } else if constexpr (std::is_same_v<T, long double>) {
+            sq = sqrt_impl{}.codegen_ldbl(s, {x});
+#if defined(HEYOKA_HAVE_REAL128)
+        } else if constexpr (std::is_same_v<T, mppp::real128>) {
+            sq = sqrt_impl{}.codegen_f128(s, {x});
+#endif
+        } else {
+            static_assert(always_false_v<T>, "Unhandled type.");
+        }
+
+        ret = ret == nullptr ? sq : builder.CreateFMul(ret, sq);
+    }
+
+    auto *one = llvm::ConstantFP::get(x->getType(), 1.);
+
+    if (ret == nullptr) {
+        // Zero exponent.
+        return one;
+    }
+
+    return n2 < 0 ? builder.CreateFDiv(one, ret) : ret;
+}
+
+// Mangling of the exponent of pi for the Taylor derivatives
+// in compact mode. If pow() is expanded, the exponent
+// is hard-coded in the implementation and thus it must be
+// encoded in the function name.
+std::string pow_expand_mangle(const pow_impl &pi)
+{
+    if (const auto n2 = pow_expand_exp2(pi)) {
+        return "_exp2_{}{}"_format(*n2 < 0 ? 'm' : 'p', *n2 < 0 ? -*n2 : *n2);
+    }
+
+    return "";
+}
+
 } // namespace
 
 llvm::Value *pow_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
@@ -101,6 +195,10 @@ llvm::Value *pow_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
     assert(args[0] != nullptr);
     assert(args[1] != nullptr);
 
+    if (const auto n2 = pow_expand_exp2(*this)) {
+        return pow_expand<double>(s, args[0], *n2);
+    }
+
     const auto allow_approx = pow_allow_approx(*this);
 
     // NOTE: we want to try the SLEEF route only if we are *not* approximating
@@ -131,19 +229,8 @@ llvm::Value *pow_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value
 
 llvm::Value *pow_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
 {
-    assert(args.size() == 2u);
-    assert(args[0] != nullptr);
-    assert(args[1] != nullptr);
-
-    const auto allow_approx = pow_allow_approx(*this);
-
-    auto ret = llvm_invoke_intrinsic(s, "llvm.pow", {args[0]->getType()}, args);
-
-    if (allow_approx) {
-        llvm::cast<llvm::CallInst>(ret)->setHasApproxFunc(true);
-    }
-
-    return ret;
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
 }
 
 #if defined(HEYOKA_HAVE_REAL128)
@@ -154,6 +241,10 @@ llvm::Value *pow_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value
     assert(args[0] != nullptr);
     assert(args[1] != nullptr);
 
+    if (const auto n2 = pow_expand_exp2(*this)) {
+        return pow_expand<mppp::real128>(s, args[0], *n2);
+    }
+
     auto &builder = s.builder();
 
     // Decompose the arguments into scalars.
@@ -267,7 +358,7 @@ llvm::Value *taylor_diff_pow_impl(llvm_state &s, const pow_impl &f, const variab
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(
@@ -276,7 +367,7 @@ llvm::Value *taylor_diff_pow_impl(llvm_state &s, const pow_impl &f, const variab
 
     // NOTE: iteration in the [0, order) range
     // (i.e., order *not* included).
-    std::vector<llvm::Value *> sum;
+    std::vector<llvm::Value *> v0s, v1s;
     for (std::uint32_t j = 0; j < order; ++j) {
         auto v0 = taylor_fetch_diff(arr, u_idx, order - j, n_uvars);
         auto v1 = taylor_fetch_diff(arr, idx, j, n_uvars);
@@ -302,11 +393,12 @@ llvm::Value *taylor_diff_pow_impl(llvm_state &s, const pow_impl &f, const variab
         }();
 
         // Add scal_f*v0*v1 to the sum.
-        sum.push_back(builder.CreateFMul(scal_f, builder.CreateFMul(v0, v1)));
+        v0s.push_back(builder.CreateFMul(scal_f, v0));
+        v1s.push_back(v1);
     }
 
     // Init the return value as the result of the sum.
-    auto ret_acc = pairwise_sum(builder, sum);
+    auto ret_acc = pairwise_dot(s, v0s, v1s);
 
     // Compute the final divisor: order * (zero-th derivative of u_idx).
     auto ord_f = vector_splat(builder, codegen<T>(s, number(static_cast<T>(order))), batch_size);
@@ -395,8 +487,9 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
     auto val_t = to_llvm_vector_type<T>(context, batch_size);
 
     // Get the function name.
-    const auto fname = "heyoka_taylor_diff_pow_{}_{}_{}"_format(
-        taylor_c_diff_numparam_mangle(n0), taylor_c_diff_numparam_mangle(n1), taylor_mangle_suffix(val_t));
+    const auto fname = "heyoka_taylor_diff_pow_{}_{}{}_{}"_format(taylor_c_diff_numparam_mangle(n0),
+                                                                  taylor_c_diff_numparam_mangle(n1),
+                                                                  pow_expand_mangle(fn), taylor_mangle_suffix(val_t));
 
     // The function arguments:
     // - diff order,
@@ -491,8 +584,8 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
     auto val_t = to_llvm_vector_type<T>(context, batch_size);
 
     // Get the function name.
-    const auto fname = "heyoka_taylor_diff_pow_var_{}_{}_n_uvars_{}"_format(taylor_c_diff_numparam_mangle(n),
-                                                                            taylor_mangle_suffix(val_t), n_uvars);
+    const auto fname = "heyoka_taylor_diff_pow_var_{}{}_{}_n_uvars_{}"_format(
+        taylor_c_diff_numparam_mangle(n), pow_expand_mangle(fn), taylor_mangle_suffix(val_t), n_uvars);
 
     // The function arguments:
     // - diff order,
@@ -557,6 +650,11 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
                 auto alpha_v = taylor_c_diff_numparam_codegen(s, n, exponent, par_ptr, batch_size);
                 auto ord_v = vector_splat(builder, builder.CreateUIToFP(ord, to_llvm_type<T>(context)), batch_size);
 
+                // Pre-compute the loop-invariant parts of the factor n*alpha-j*(alpha+1).
+                auto ord_alpha = builder.CreateFMul(ord_v, alpha_v);
+                auto alpha_p1
+                    = builder.CreateFAdd(alpha_v, vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
+
                 // Init the accumulator.
                 builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), acc);
 
@@ -567,14 +665,9 @@ llvm::Function *taylor_c_diff_func_pow_impl(llvm_state &s, const pow_impl &fn, c
 
                     // Compute the factor n*alpha-j*(alpha+1).
                     auto j_v = vector_splat(builder, builder.CreateUIToFP(j, to_llvm_type<T>(context)), batch_size);
-                    auto fac = builder.CreateFSub(
-                        builder.CreateFMul(ord_v, alpha_v),
-                        builder.CreateFMul(
-                            j_v,
-                            builder.CreateFAdd(alpha_v, vector_splat(builder, codegen<T>(s, number{1.}), batch_size))));
-
-                    builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(acc),
-                                                           builder.CreateFMul(fac, builder.CreateFMul(b_nj, aj))),
+                    auto fac = builder.CreateFSub(ord_alpha, builder.CreateFMul(j_v, alpha_p1));
+
+                    builder.CreateStore(llvm_fmuladd(s, fac, builder.CreateFMul(b_nj, aj), builder.CreateLoad(acc)),
                                         acc);
                 });
 
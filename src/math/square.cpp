@@ -139,39 +139,34 @@ llvm::Value *taylor_diff_square_impl(llvm_state &s, const square_impl &f, const
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
     }
 
     // Compute the sum.
-    std::vector<llvm::Value *> sum;
+    std::vector<llvm::Value *> v0s, v1s;
     if (order % 2u == 1u) {
         // Odd order.
         for (std::uint32_t j = 0; j <= (order - 1u) / 2u; ++j) {
-            auto v0 = taylor_fetch_diff(arr, u_idx, order - j, n_uvars);
-            auto v1 = taylor_fetch_diff(arr, u_idx, j, n_uvars);
-
-            sum.push_back(builder.CreateFMul(v0, v1));
+            v0s.push_back(taylor_fetch_diff(arr, u_idx, order - j, n_uvars));
+            v1s.push_back(taylor_fetch_diff(arr, u_idx, j, n_uvars));
         }
 
-        auto ret = pairwise_sum(builder, sum);
+        auto ret = pairwise_dot(s, v0s, v1s);
         return builder.CreateFAdd(ret, ret);
     } else {
         // Even order.
         auto ak2 = taylor_fetch_diff(arr, u_idx, order / 2u, n_uvars);
-        auto sq_ak2 = builder.CreateFMul(ak2, ak2);
 
         for (std::uint32_t j = 0; j <= (order - 2u) / 2u; ++j) {
-            auto v0 = taylor_fetch_diff(arr, u_idx, order - j, n_uvars);
-            auto v1 = taylor_fetch_diff(arr, u_idx, j, n_uvars);
-
-            sum.push_back(builder.CreateFMul(v0, v1));
+            v0s.push_back(taylor_fetch_diff(arr, u_idx, order - j, n_uvars));
+            v1s.push_back(taylor_fetch_diff(arr, u_idx, j, n_uvars));
         }
 
-        auto ret = pairwise_sum(builder, sum);
-        return builder.CreateFAdd(builder.CreateFAdd(ret, ret), sq_ak2);
+        auto ret = pairwise_dot(s, v0s, v1s);
+        return llvm_fmuladd(s, ak2, ak2, builder.CreateFAdd(ret, ret));
     }
 }
 
@@ -332,8 +327,7 @@ llvm::Function *taylor_c_diff_func_square_impl(llvm_state &s, const square_impl
                             auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), var_idx);
                             auto aj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx);
 
-                            builder.CreateStore(
-                                builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(a_nj, aj)), acc);
+                            builder.CreateStore(llvm_fmuladd(s, a_nj, aj, builder.CreateLoad(acc)), acc);
                         });
 
                         // Return 2 * acc.
@@ -346,7 +340,6 @@ llvm::Function *taylor_c_diff_func_square_impl(llvm_state &s, const square_impl
                         // Pre-compute the final term.
                         auto ak2 = taylor_c_load_diff(s, diff_ptr, n_uvars,
                                                       builder.CreateUDiv(ord, builder.getInt32(2)), var_idx);
-                        auto sq_ak2 = builder.CreateFMul(ak2, ak2);
 
                         auto loop_end = builder.CreateAdd(
                             builder.CreateUDiv(builder.CreateSub(ord, builder.getInt32(2)), builder.getInt32(2)),
@@ -355,13 +348,12 @@ llvm::Function *taylor_c_diff_func_square_impl(llvm_state &s, const square_impl
                             auto a_nj = taylor_c_load_diff(s, diff_ptr, n_uvars, builder.CreateSub(ord, j), var_idx);
                             auto aj = taylor_c_load_diff(s, diff_ptr, n_uvars, j, var_idx);
 
-                            builder.CreateStore(
-                                builder.CreateFAdd(builder.CreateLoad(acc), builder.CreateFMul(a_nj, aj)), acc);
+                            builder.CreateStore(llvm_fmuladd(s, a_nj, aj, builder.CreateLoad(acc)), acc);
                         });
 
                         // Return 2 * acc + ak2 * ak2.
                         auto acc_load = builder.CreateLoad(acc);
-                        builder.CreateStore(builder.CreateFAdd(builder.CreateFAdd(acc_load, acc_load), sq_ak2), retval);
+                        builder.CreateStore(llvm_fmuladd(s, ak2, ak2, builder.CreateFAdd(acc_load, acc_load)), retval);
                     });
             });
 
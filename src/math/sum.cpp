@@ -0,0 +1,420 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+sum_impl::sum_impl(std::vector<expression> args) : func_base("sum", std::move(args)) {}
+
+sum_impl::sum_impl() : sum_impl({0_dbl}) {}
+
+void sum_impl::to_stream(std::ostream &os) const
+{
+    assert(!args().empty());
+
+    os << '(';
+
+    for (decltype(args().size()) i = 0; i < args().size(); ++i) {
+        os << args()[i];
+
+        if (i + 1u != args().size()) {
+            os << " + ";
+        }
+    }
+
+    os << ')';
+}
+
+llvm::Value *sum_impl::codegen_dbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    assert(!args.empty());
+
+    auto tmp = args;
+
+    return pairwise_sum(s.builder(), tmp);
+}
+
+llvm::Value *sum_impl::codegen_ldbl(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *sum_impl::codegen_f128(llvm_state &s, const std::vector<llvm::Value *> &args) const
+{
+    // NOTE: codegen is identical as in dbl.
+    return codegen_dbl(s, args);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+T sum_eval(const sum_impl &f, const std::unordered_map<std::string, T> &map, const std::vector<T> &pars)
+{
+    T retval(0);
+
+    for (const auto &arg : f.args()) {
+        if constexpr (std::is_same_v<T, double>) {
+            retval += heyoka::eval_dbl(arg, map, pars);
+        } else if constexpr (std::is_same_v<T, long double>) {
+            retval += heyoka::eval_ldbl(arg, map, pars);
+#if defined(HEYOKA_HAVE_REAL128)
+        } else if constexpr (std::is_same_v<T, mppp::real128>) {
+            retval += heyoka::eval_f128(arg, map, pars);
+#endif
+        } else {
+            static_assert(always_false_v<T>, "Unhandled type.");
+        }
+    }
+
+    return retval;
+}
+
+} // namespace
+
+double sum_impl::eval_dbl(const std::unordered_map<std::string, double> &map, const std::vector<double> &pars) const
+{
+    return sum_eval(*this, map, pars);
+}
+
+long double sum_impl::eval_ldbl(const std::unordered_map<std::string, long double> &map,
+                                const std::vector<long double> &pars) const
+{
+    return sum_eval(*this, map, pars);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+mppp::real128 sum_impl::eval_f128(const std::unordered_map<std::string, mppp::real128> &map,
+                                  const std::vector<mppp::real128> &pars) const
+{
+    return sum_eval(*this, map, pars);
+}
+
+#endif
+
+expression sum_impl::diff(const std::string &s) const
+{
+    std::vector<expression> terms;
+    for (const auto &arg : args()) {
+        terms.push_back(heyoka::diff(arg, s));
+    }
+
+    return heyoka::sum(std::move(terms));
+}
+
+namespace
+{
+
+// NOTE: the derivative of order n of a sum is the sum
+// of the derivatives of order n of the terms. The derivatives
+// of order n > 0 of numbers and parameters are zero.
+template <typename T>
+llvm::Value *taylor_diff_sum(llvm_state &s, const sum_impl &f, const std::vector<std::uint32_t> &deps,
+                             const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, std::uint32_t n_uvars,
+                             std::uint32_t order, std::uint32_t batch_size)
+{
+    if (!deps.empty()) {
+        throw std::invalid_argument("An empty hidden dependency vector is expected in order to compute the Taylor "
+                                    "derivative of the sum, but a vector of size {} was passed "
+                                    "instead"_format(deps.size()));
+    }
+
+    std::vector<llvm::Value *> terms;
+    for (const auto &arg : f.args()) {
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    terms.push_back(taylor_fetch_diff(arr, uname_to_index(v), order, n_uvars));
+                } else if constexpr (is_num_param_v<type>) {
+                    if (order == 0u) {
+                        terms.push_back(taylor_codegen_numparam<T>(s, v, par_ptr, batch_size));
+                    }
+                } else {
+                    throw std::invalid_argument(
+                        "An invalid argument type was encountered while trying to build the Taylor "
+                        "derivative of the sum");
+                }
+            },
+            arg.value());
+    }
+
+    if (terms.empty()) {
+        return vector_splat(s.builder(), codegen<T>(s, number{0.}), batch_size);
+    }
+
+    return pairwise_sum(s.builder(), terms);
+}
+
+} // namespace
+
+llvm::Value *sum_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                       const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                       std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                       std::uint32_t batch_size) const
+{
+    return taylor_diff_sum<double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+llvm::Value *sum_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_sum<long double>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *sum_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &deps,
+                                        const std::vector<llvm::Value *> &arr, llvm::Value *par_ptr, llvm::Value *,
+                                        std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                                        std::uint32_t batch_size) const
+{
+    return taylor_diff_sum<mppp::real128>(s, *this, deps, arr, par_ptr, n_uvars, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_func_sum(llvm_state &s, const sum_impl &fn, std::uint32_t n_uvars,
+                                       std::uint32_t batch_size)
+{
+    const auto &args = fn.args();
+
+    auto &module = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - for each term, the idx of the u variable or
+    //   the number/par idx argument.
+    // NOTE: the mangled name encodes the type of each term,
+    // which also determines the number of terms.
+    std::vector<llvm::Type *> fargs{llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context))};
+
+    std::string mangle;
+    for (const auto &arg : args) {
+        std::visit(
+            [&](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    fargs.push_back(llvm::Type::getInt32Ty(context));
+                    mangle += 'v';
+                } else if constexpr (is_num_param_v<type>) {
+                    fargs.push_back(taylor_c_diff_numparam_argtype<T>(s, v));
+                    mangle += std::is_same_v<type, number> ? 'n' : 'p';
+                } else {
+                    throw std::invalid_argument(
+                        "An invalid argument type was encountered while trying to build the Taylor "
+                        "derivative of the sum in compact mode");
+                }
+            },
+            arg.value());
+    }
+
+    // Get the function name.
+    const auto fname = "heyoka_taylor_diff_sum_{}_{}_n_uvars_{}"_format(mangle, taylor_mangle_suffix(val_t), n_uvars);
+
+    // Try to see if we already created the function.
+    auto f = module.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &module);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto diff_ptr = f->args().begin() + 2;
+        auto par_ptr = f->args().begin() + 3;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Load the derivatives of the variables and
+        // codegen the numbers/params.
+        std::vector<llvm::Value *> var_terms, np_terms;
+        for (decltype(args.size()) i = 0; i < args.size(); ++i) {
+            auto *cur_arg = f->args().begin() + 5 + i;
+
+            std::visit(
+                [&](const auto &v) {
+                    using type = detail::uncvref_t<decltype(v)>;
+
+                    if constexpr (std::is_same_v<type, variable>) {
+                        var_terms.push_back(taylor_c_load_diff(s, diff_ptr, n_uvars, ord, cur_arg));
+                    } else if constexpr (is_num_param_v<type>) {
+                        np_terms.push_back(taylor_c_diff_numparam_codegen(s, v, cur_arg, par_ptr, batch_size));
+                    } else {
+                        // LCOV_EXCL_START
+                        assert(false);
+                        // LCOV_EXCL_STOP
+                    }
+                },
+                args[i].value());
+        }
+
+        auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+        auto *ret = var_terms.empty() ? zero : pairwise_sum(builder, var_terms);
+
+        if (!np_terms.empty()) {
+            // NOTE: the numbers/params contribute only
+            // to the derivative of order zero.
+            auto *np_sum = builder.CreateSelect(builder.CreateICmpEQ(ord, builder.getInt32(0)),
+                                                pairwise_sum(builder, np_terms), zero);
+
+            ret = var_terms.empty() ? np_sum : builder.CreateFAdd(ret, np_sum);
+        }
+
+        // Return the result.
+        builder.CreateRet(ret);
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument(
+                "Inconsistent function signature for the Taylor derivative of the sum in compact mode detected");
+        }
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *sum_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum<double>(s, *this, n_uvars, batch_size);
+}
+
+llvm::Function *sum_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum<long double>(s, *this, n_uvars, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *sum_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t n_uvars, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_func_sum<mppp::real128>(s, *this, n_uvars, batch_size);
+}
+
+#endif
+
+} // namespace detail
+
+expression sum(std::vector<expression> args)
+{
+    if (args.empty()) {
+        return 0_dbl;
+    }
+
+    if (args.size() == 1u) {
+        return std::move(args[0]);
+    }
+
+    return expression{func{detail::sum_impl(std::move(args))}};
+}
+
+} // namespace heyoka
@@ -231,7 +231,7 @@ llvm::Value *taylor_diff_tan_impl(llvm_state &s, const tan_impl &f, const std::v
     auto &builder = s.builder();
 
     // Fetch the index of the variable.
-    const auto u_idx = uname_to_index(var.name());
+    const auto u_idx = uname_to_index(var);
 
     if (order == 0u) {
         return codegen_from_values<T>(s, f, {taylor_fetch_diff(arr, u_idx, 0, n_uvars)});
@@ -0,0 +1,415 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/math/special_functions/binomial.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/tpwpoly.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+tpwpoly_impl::tpwpoly_impl() : tpwpoly_impl(par[0], par[2], par[3]) {}
+
+tpwpoly_impl::tpwpoly_impl(expression b, expression c, expression e)
+    : func_base("tpwpoly", std::vector<expression>{std::move(b), std::move(c), std::move(e)})
+{
+    for (const auto &arg : args()) {
+        if (!std::holds_alternative<param>(arg.value())) {
+            throw std::invalid_argument("Cannot construct a piecewise polynomial of time from a non-param argument");
+        }
+    }
+
+    m_b_idx = std::get<param>(args()[0].value()).idx();
+    m_c_idx = std::get<param>(args()[1].value()).idx();
+    m_e_idx = std::get<param>(args()[2].value()).idx();
+
+    // NOTE: at least 2 knots and at least 1 coefficient per segment.
+    if (m_c_idx <= m_b_idx || m_c_idx - m_b_idx < 2u || m_e_idx <= m_c_idx
+        || (m_e_idx - m_c_idx) % (m_c_idx - m_b_idx - 1u) != 0u) {
+        throw std::invalid_argument("Cannot construct a piecewise polynomial of time from the param indices {}, {} and "
+                                    "{}: the indices are inconsistent"_format(m_b_idx, m_c_idx, m_e_idx));
+    }
+}
+
+void tpwpoly_impl::to_stream(std::ostream &os) const
+{
+    os << "tpwpoly({}, {}, {})"_format(m_b_idx, get_n_segments(), get_degree());
+}
+
+std::uint32_t tpwpoly_impl::get_n_segments() const
+{
+    return m_c_idx - m_b_idx - 1u;
+}
+
+std::uint32_t tpwpoly_impl::get_degree() const
+{
+    return (m_e_idx - m_c_idx) / get_n_segments() - 1u;
+}
+
+namespace
+{
+
+// Compute the derivative of order ord of a piecewise polynomial of time.
+// The knots and the coefficients are read from par_ptr starting from the indices
+// b_idx and c_idx respectively. get_bc(i) must return the (i, ord) binomial coefficient
+// as a scalar (its value is irrelevant if i < ord).
+// NOTE: the segments are located independently for each batch element via a
+// branchless binary search over the knots, whose number of iterations is fixed
+// by the number of segments. The Horner evaluation runs over all the coefficients,
+// and the terms of degree less than ord are masked out, so that the derivatives
+// of order greater than the degree are zero.
+template <typename T>
+llvm::Value *taylor_diff_tpwpoly_impl(llvm_state &s, const tpwpoly_impl &tp, llvm::Value *par_ptr,
+                                      llvm::Value *time_ptr, llvm::Value *ord, llvm::Value *b_idx, llvm::Value *c_idx,
+                                      const std::function<llvm::Value *(std::uint32_t)> &get_bc,
+                                      std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    const auto n_seg = tp.get_n_segments();
+    const auto deg = tp.get_degree();
+
+    // Helper to load the element at index idx of the par array
+    // for the batch element lane.
+    auto load_par = [&](llvm::Value *idx, std::uint32_t lane) -> llvm::Value * {
+        auto *ptr = builder.CreateInBoundsGEP(
+            par_ptr, {builder.CreateAdd(builder.CreateMul(idx, builder.getInt32(batch_size)), builder.getInt32(lane))});
+
+        return builder.CreateLoad(ptr);
+    };
+
+    std::vector<llvm::Value *> lanes;
+    for (std::uint32_t lane = 0; lane < batch_size; ++lane) {
+        // Load the time value.
+        llvm::Value *t = builder.CreateLoad(builder.CreateInBoundsGEP(time_ptr, {builder.getInt32(lane)}));
+
+        // Locate the segment: the largest k in [0, n_seg) such that the
+        // k-th knot is not greater than t (0 if no such k exists).
+        llvm::Value *seg = builder.getInt32(0);
+        for (auto len = n_seg; len > 1u; len -= len / 2u) {
+            auto *mid = builder.CreateAdd(seg, builder.getInt32(len / 2u));
+            auto *knot = load_par(builder.CreateAdd(b_idx, mid), lane);
+
+            seg = builder.CreateSelect(builder.CreateFCmpOGE(t, knot), mid, seg);
+        }
+
+        // Compute the time relative to the beginning of the segment.
+        auto *tau = builder.CreateFSub(t, load_par(builder.CreateAdd(b_idx, seg), lane));
+
+        // Index of the first coefficient of the segment.
+        auto *cf_idx = builder.CreateAdd(c_idx, builder.CreateMul(seg, builder.getInt32(deg + 1u)));
+
+        // Horner evaluation of the polynomial derivative.
+        llvm::Value *acc = codegen<T>(s, number{0.});
+        for (auto i = deg + 1u; i > 0u; --i) {
+            auto *cf = builder.CreateFMul(get_bc(i - 1u),
+                                          load_par(builder.CreateAdd(cf_idx, builder.getInt32(i - 1u)), lane));
+            auto *new_acc = builder.CreateFAdd(cf, builder.CreateFMul(acc, tau));
+
+            acc = builder.CreateSelect(builder.CreateICmpULE(ord, builder.getInt32(i - 1u)), new_acc, acc);
+        }
+
+        lanes.push_back(acc);
+    }
+
+    return scalars_to_vector(builder, lanes);
+}
+
+template <typename T>
+llvm::Value *taylor_diff_tpwpoly(llvm_state &s, const tpwpoly_impl &tp, llvm::Value *par_ptr, llvm::Value *time_ptr,
+                                 std::uint32_t order, std::uint32_t batch_size)
+{
+    auto &builder = s.builder();
+
+    // Null retval if the diff order is larger than the
+    // polynomial degree.
+    if (order > tp.get_degree()) {
+        return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+    }
+
+    return taylor_diff_tpwpoly_impl<T>(
+        s, tp, par_ptr, time_ptr, builder.getInt32(order), builder.getInt32(tp.m_b_idx), builder.getInt32(tp.m_c_idx),
+        [&](std::uint32_t i) -> llvm::Value * {
+            const auto bc = i < order ? T(0)
+                                      : boost::math::binomial_coefficient<T>(boost::numeric_cast<unsigned>(i),
+                                                                             boost::numeric_cast<unsigned>(order));
+
+            return codegen<T>(s, number{bc});
+        },
+        batch_size);
+}
+
+} // namespace
+
+llvm::Value *tpwpoly_impl::taylor_diff_dbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                           const std::vector<llvm::Value *> &, llvm::Value *par_ptr,
+                                           llvm::Value *time_ptr, std::uint32_t, std::uint32_t order, std::uint32_t,
+                                           std::uint32_t batch_size) const
+{
+    return taylor_diff_tpwpoly<double>(s, *this, par_ptr, time_ptr, order, batch_size);
+}
+
+llvm::Value *tpwpoly_impl::taylor_diff_ldbl(llvm_state &s, const std::vector<std::uint32_t> &,
+                                            const std::vector<llvm::Value *> &, llvm::Value *par_ptr,
+                                            llvm::Value *time_ptr, std::uint32_t, std::uint32_t order, std::uint32_t,
+                                            std::uint32_t batch_size) const
+{
+    return taylor_diff_tpwpoly<long double>(s, *this, par_ptr, time_ptr, order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Value *tpwpoly_impl::taylor_diff_f128(llvm_state &s, const std::vector<std::uint32_t> &,
+                                            const std::vector<llvm::Value *> &, llvm::Value *par_ptr,
+                                            llvm::Value *time_ptr, std::uint32_t, std::uint32_t order, std::uint32_t,
+                                            std::uint32_t batch_size) const
+{
+    return taylor_diff_tpwpoly<mppp::real128>(s, *this, par_ptr, time_ptr, order, batch_size);
+}
+
+#endif
+
+namespace
+{
+
+template <typename T>
+llvm::Function *taylor_c_diff_tpwpoly(llvm_state &s, const tpwpoly_impl &tp, std::uint32_t batch_size)
+{
+    // Make the number of segments and the degree compile-time (JIT) constants.
+    const auto n_seg = tp.get_n_segments();
+    const auto deg = tp.get_degree();
+
+    auto &md = s.module();
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Fetch the floating-point type.
+    auto val_t = to_llvm_vector_type<T>(context, batch_size);
+
+    // Compose the function name.
+    // NOTE: we mangle on the number of segments and on the degree as well,
+    // so that we will be generating a different function for each table layout.
+    const auto fname = "heyoka_taylor_diff_tpwpoly_{}_nseg_{}_deg_{}"_format(taylor_mangle_suffix(val_t), n_seg, deg);
+
+    // The function arguments:
+    // - diff order,
+    // - idx of the u variable whose diff is being computed,
+    // - diff array,
+    // - par ptr,
+    // - time ptr,
+    // - indices of the first knot and of the first
+    //   coefficient in the par array.
+    std::vector<llvm::Type *> fargs{builder.getInt32Ty(),
+                                    builder.getInt32Ty(),
+                                    llvm::PointerType::getUnqual(val_t),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    llvm::PointerType::getUnqual(to_llvm_type<T>(context)),
+                                    builder.getInt32Ty(),
+                                    builder.getInt32Ty()};
+
+    // Try to see if we already created the function.
+    auto f = md.getFunction(fname);
+
+    if (f == nullptr) {
+        // The function was not created before, do it now.
+
+        // Fetch the current insertion block.
+        auto orig_bb = builder.GetInsertBlock();
+
+        // The return type is val_t.
+        auto *ft = llvm::FunctionType::get(val_t, fargs, false);
+        // Create the function
+        f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, fname, &md);
+        assert(f != nullptr);
+
+        // Fetch the necessary function arguments.
+        auto ord = f->args().begin();
+        auto par_ptr = f->args().begin() + 3;
+        auto t_ptr = f->args().begin() + 4;
+        auto b_idx = f->args().begin() + 5;
+        auto c_idx = f->args().begin() + 6;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // NOTE: clamp the order used to index into the array of binomial
+        // coefficients, so that the loads stay in bounds for orders greater
+        // than the degree (the corresponding terms are masked out anyway).
+        auto deg_v = builder.getInt32(deg);
+        auto bc_ord = builder.CreateSelect(builder.CreateICmpUGT(ord, deg_v), deg_v, ord);
+        auto bc_ptr = llvm_add_bc_array<T>(s, deg);
+
+        auto ret = taylor_diff_tpwpoly_impl<T>(
+            s, tp, par_ptr, t_ptr, ord, b_idx, c_idx,
+            [&](std::uint32_t i) -> llvm::Value * {
+                auto idx = builder.CreateAdd(builder.getInt32(i * (deg + 1u)), bc_ord);
+
+                return builder.CreateLoad(builder.CreateInBoundsGEP(bc_ptr, {idx}));
+            },
+            batch_size);
+
+        // Return the result.
+        builder.CreateRet(ret);
+
+        // Verify.
+        s.verify_function(f);
+
+        // Restore the original insertion block.
+        builder.SetInsertPoint(orig_bb);
+    } else {
+        // LCOV_EXCL_START
+        // The function was created before. Check if the signatures match.
+        // NOTE: there could be a mismatch if the derivative function was created
+        // and then optimised - optimisation might remove arguments which are compile-time
+        // constants.
+        if (!compare_function_signature(f, val_t, fargs)) {
+            throw std::invalid_argument(
+                "Inconsistent function signature for the Taylor derivative of tpwpoly() in compact mode detected");
+        }
+        // LCOV_EXCL_STOP
+    }
+
+    return f;
+}
+
+} // namespace
+
+llvm::Function *tpwpoly_impl::taylor_c_diff_func_dbl(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_tpwpoly<double>(s, *this, batch_size);
+}
+
+llvm::Function *tpwpoly_impl::taylor_c_diff_func_ldbl(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_tpwpoly<long double>(s, *this, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+llvm::Function *tpwpoly_impl::taylor_c_diff_func_f128(llvm_state &s, std::uint32_t, std::uint32_t batch_size) const
+{
+    return taylor_c_diff_tpwpoly<mppp::real128>(s, *this, batch_size);
+}
+
+#endif
+
+// Small helper to detect if an expression
+// is a tpwpoly function.
+bool is_tpwpoly(const expression &ex)
+{
+    if (auto func_ptr = std::get_if<func>(&ex.value());
+        func_ptr != nullptr && func_ptr->extract<tpwpoly_impl>() != nullptr) {
+        return true;
+    } else {
+        return false;
+    }
+}
+
+std::vector<std::pair<std::uint32_t, std::uint32_t>> tpwpoly_knots(const taylor_dc_t &dc)
+{
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> retval;
+
+    for (const auto &p : dc) {
+        if (const auto *func_ptr = std::get_if<func>(&p.first.value())) {
+            if (const auto *tp = func_ptr->extract<tpwpoly_impl>()) {
+                std::pair<std::uint32_t, std::uint32_t> k{tp->m_b_idx, tp->get_n_segments() + 1u};
+
+                // NOTE: the CSE in the decomposition already removes
+                // duplicate tpwpoly functions, but different functions
+                // may share the same knots.
+                if (std::find(retval.begin(), retval.end(), k) == retval.end()) {
+                    retval.push_back(k);
+                }
+            }
+        }
+    }
+
+    return retval;
+}
+
+} // namespace detail
+
+expression tpwpoly(expression b, std::uint32_t n_seg, std::uint32_t deg)
+{
+    if (!std::holds_alternative<param>(b.value())) {
+        throw std::invalid_argument("Cannot construct a piecewise polynomial of time from a non-param argument");
+    }
+
+    if (n_seg == 0u) {
+        throw std::invalid_argument("Cannot construct a piecewise polynomial of time with zero segments");
+    }
+
+    const auto b_idx = std::get<param>(b.value()).idx();
+
+    // Overflow check.
+    constexpr auto max = std::numeric_limits<std::uint32_t>::max();
+    if (deg == max || n_seg == max || b_idx > max - (n_seg + 1u) || (deg + 1u) > (max - (b_idx + n_seg + 1u)) / n_seg) {
+        throw std::overflow_error("Overflow detected in the construction of a piecewise polynomial of time");
+    }
+
+    const auto c_idx = b_idx + n_seg + 1u;
+    const auto e_idx = c_idx + n_seg * (deg + 1u);
+
+    return expression{func{detail::tpwpoly_impl{std::move(b), par[c_idx], par[e_idx]}}};
+}
+
+} // namespace heyoka
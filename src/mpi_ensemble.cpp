@@ -0,0 +1,347 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mpi.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/mpi_ensemble.hpp>
+#include <heyoka/taylor.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// Check the return value of the MPI function name.
+void mpi_check(int ret, const char *name)
+{
+    // LCOV_EXCL_START
+    if (ret != MPI_SUCCESS) {
+        throw std::runtime_error("The MPI function {}() returned the error code {}"_format(name, ret));
+    }
+    // LCOV_EXCL_STOP
+}
+
+int mpi_rank(MPI_Comm comm)
+{
+    int rank = 0;
+    mpi_check(MPI_Comm_rank(comm, &rank), "MPI_Comm_rank");
+
+    return rank;
+}
+
+int mpi_size(MPI_Comm comm)
+{
+    int size = 0;
+    mpi_check(MPI_Comm_size(comm, &size), "MPI_Comm_size");
+
+    return size;
+}
+
+// Propagate an error across the ranks. eptr is the exception
+// raised on the current rank (if any). If an error occurred on any
+// rank, an exception is thrown on all the ranks: the original exception
+// on the ranks where the error occurred, a std::runtime_error
+// on the other ranks.
+// NOTE: this must be invoked on all the ranks.
+void mpi_propagate_error(MPI_Comm comm, const std::exception_ptr &eptr, const char *fname)
+{
+    int l_fail = eptr ? 1 : 0, g_fail = 0;
+    mpi_check(MPI_Allreduce(&l_fail, &g_fail, 1, MPI_INT, MPI_MAX, comm), "MPI_Allreduce");
+
+    if (eptr) {
+        std::rethrow_exception(eptr);
+    }
+
+    if (g_fail != 0) {
+        throw std::runtime_error("An error occurred on another rank during the execution of {}()"_format(fname));
+    }
+}
+
+// Broadcast a buffer of bytes, in chunks whose size fits in an int.
+void mpi_bcast_bytes(MPI_Comm comm, int root, void *buf, std::size_t size)
+{
+    constexpr auto max_chunk = static_cast<std::size_t>(std::numeric_limits<int>::max());
+
+    auto *ptr = static_cast<char *>(buf);
+    for (std::size_t i = 0; i < size;) {
+        const auto n = std::min(max_chunk, size - i);
+        mpi_check(MPI_Bcast(ptr + i, static_cast<int>(n), MPI_BYTE, root, comm), "MPI_Bcast");
+        i += n;
+    }
+}
+
+// Compute the counts and displacements (in bytes) for the scatter/gather
+// of n_rows rows of row_size bytes each, split in contiguous blocks across
+// the ranks. The first n_rows % n_ranks ranks get an extra row.
+std::pair<std::vector<int>, std::vector<int>> mpi_block_counts(std::uint64_t n_rows, std::size_t row_size,
+                                                               int n_ranks)
+{
+    const auto n_r = static_cast<std::uint64_t>(n_ranks);
+
+    std::vector<int> counts, displs;
+    std::uint64_t offset = 0;
+    for (std::uint64_t r = 0; r < n_r; ++r) {
+        const auto cur_rows = n_rows / n_r + static_cast<std::uint64_t>(r < n_rows % n_r);
+
+        // NOTE: MPI uses ints for counts and displacements.
+        if (row_size != 0u
+            && (cur_rows > static_cast<std::uint64_t>(std::numeric_limits<int>::max()) / row_size
+                || offset > static_cast<std::uint64_t>(std::numeric_limits<int>::max()) / row_size)) {
+            throw std::overflow_error("Overflow detected in the computation of the counts and displacements of an "
+                                      "MPI ensemble propagation: the number of iterations is too large");
+        }
+
+        counts.push_back(static_cast<int>(cur_rows * row_size));
+        displs.push_back(static_cast<int>(offset * row_size));
+
+        offset += cur_rows;
+    }
+
+    return std::pair{std::move(counts), std::move(displs)};
+}
+
+// Gather the local buffer src of the current rank into the buffer dst on the
+// root rank. n_rows is the total number of rows, row_size the size in bytes of a row.
+void mpi_gather_rows(MPI_Comm comm, int root, const void *src, void *dst, std::uint64_t n_rows, std::size_t row_size)
+{
+    const auto rank = mpi_rank(comm);
+    const auto [counts, displs] = mpi_block_counts(n_rows, row_size, mpi_size(comm));
+
+    mpi_check(MPI_Gatherv(src, counts[static_cast<decltype(counts.size())>(rank)], MPI_BYTE, dst, counts.data(),
+                          displs.data(), MPI_BYTE, root, comm),
+              "MPI_Gatherv");
+}
+
+// Broadcast the integrator from the root rank. The return value
+// is empty on the root rank.
+template <typename T>
+std::optional<taylor_adaptive<T>> mpi_bcast_integrator_opt(MPI_Comm comm, int root, const taylor_adaptive<T> *ta,
+                                                           std::vector<t_event<T>> tes, std::vector<nt_event<T>> ntes)
+{
+    const auto rank = mpi_rank(comm);
+
+    // Serialise the integrator on the root rank.
+    std::string buf;
+    std::exception_ptr eptr;
+    if (rank == root) {
+        try {
+            if (ta == nullptr) {
+                throw std::invalid_argument("A null integrator was passed to mpi_bcast_integrator() on the root rank");
+            }
+
+            std::ostringstream oss;
+            ta->save(oss);
+            buf = oss.str();
+        } catch (...) {
+            eptr = std::current_exception();
+        }
+    }
+    mpi_propagate_error(comm, eptr, "mpi_bcast_integrator");
+
+    // Broadcast the size of the buffer, and then its content.
+    auto buf_size = static_cast<std::uint64_t>(buf.size());
+    mpi_check(MPI_Bcast(&buf_size, 1, MPI_UINT64_T, root, comm), "MPI_Bcast");
+
+    if (rank != root) {
+        buf.resize(static_cast<std::size_t>(buf_size));
+    }
+    mpi_bcast_bytes(comm, root, buf.data(), buf.size());
+
+    // Deserialise the integrator on the other ranks.
+    // NOTE: the compiled code is added to the JIT
+    // without compiling the system again.
+    std::optional<taylor_adaptive<T>> retval;
+    if (rank != root) {
+        try {
+            std::istringstream iss(std::move(buf));
+            retval.emplace(taylor_adaptive<T>::load(iss, std::move(tes), std::move(ntes)));
+        } catch (...) {
+            eptr = std::current_exception();
+        }
+    }
+    // NOTE: the root rank participates as well, so that
+    // a failed deserialisation is reported on all the ranks.
+    mpi_propagate_error(comm, eptr, "mpi_bcast_integrator");
+
+    return retval;
+}
+
+template <typename T>
+taylor_adaptive<T> mpi_bcast_integrator_generic(MPI_Comm comm, int root, const taylor_adaptive<T> *ta,
+                                                std::vector<t_event<T>> tes, std::vector<nt_event<T>> ntes)
+{
+    auto ret = mpi_bcast_integrator_opt(comm, root, ta, std::move(tes), std::move(ntes));
+
+    if (ret) {
+        return std::move(*ret);
+    } else {
+        return *ta;
+    }
+}
+
+template <typename T>
+ensemble_res<T> mpi_ensemble_propagate_until_generic(MPI_Comm comm, int root, const taylor_adaptive<T> *ta, T t,
+                                                     const std::vector<T> &ics, unsigned n_threads,
+                                                     std::size_t max_steps, T max_delta_t,
+                                                     const std::function<bool(taylor_adaptive<T> &)> &cb,
+                                                     bool pin_threads)
+{
+    const auto rank = mpi_rank(comm);
+    const auto size = mpi_size(comm);
+
+    // Validate the arguments on the root rank.
+    std::uint64_t n_iter = 0;
+    std::exception_ptr eptr;
+    if (rank == root) {
+        try {
+            if (ta == nullptr) {
+                throw std::invalid_argument(
+                    "A null integrator was passed to mpi_ensemble_propagate_until() on the root rank");
+            }
+
+            if (!ta->get_t_events().empty() || !ta->get_nt_events().empty()) {
+                throw std::invalid_argument("Integrators with events are not supported in an MPI ensemble "
+                                            "propagation");
+            }
+
+            if (ics.size() % ta->get_dim() != 0u) {
+                throw std::invalid_argument(
+                    "The size of the buffer of the initial conditions in an MPI ensemble propagation ({}) is not a "
+                    "multiple of the dimension of the system ({})"_format(ics.size(), ta->get_dim()));
+            }
+
+            n_iter = static_cast<std::uint64_t>(ics.size() / ta->get_dim());
+        } catch (...) {
+            eptr = std::current_exception();
+        }
+    }
+    mpi_propagate_error(comm, eptr, "mpi_ensemble_propagate_until");
+
+    // Broadcast the number of iterations, the final time and the integrator.
+    mpi_check(MPI_Bcast(&n_iter, 1, MPI_UINT64_T, root, comm), "MPI_Bcast");
+    mpi_bcast_bytes(comm, root, &t, sizeof(T));
+
+    const auto opt_ta = mpi_bcast_integrator_opt<T>(comm, root, ta, {}, {});
+    const auto &l_ta = (rank == root) ? *ta : *opt_ta;
+    const auto dim = l_ta.get_dim();
+
+    // Scatter the initial conditions.
+    const auto [counts, displs] = mpi_block_counts(n_iter, dim * sizeof(T), size);
+    const auto l_bytes = counts[static_cast<decltype(counts.size())>(rank)];
+    const auto n_local = static_cast<std::size_t>(l_bytes) / (dim * sizeof(T));
+
+    std::vector<T> l_ics(n_local * dim);
+    mpi_check(MPI_Scatterv(rank == root ? ics.data() : nullptr, counts.data(), displs.data(), MPI_BYTE,
+                           l_ics.data(), l_bytes, MPI_BYTE, root, comm),
+              "MPI_Scatterv");
+
+    // Run the local ensemble propagation.
+    ensemble_res<T> l_res;
+    try {
+        if (n_local > 0u) {
+            l_res = ensemble_propagate_until_impl(
+                l_ta, t, n_local,
+                [&l_ics, dim](taylor_adaptive<T> &cur_ta, std::size_t i) {
+                    std::copy(l_ics.data() + i * dim, l_ics.data() + (i + 1u) * dim, cur_ta.get_state_data());
+                },
+                n_threads, max_steps, max_delta_t, cb, pin_threads);
+        }
+    } catch (...) {
+        eptr = std::current_exception();
+    }
+    mpi_propagate_error(comm, eptr, "mpi_ensemble_propagate_until");
+
+    // Gather the results on the root rank.
+    ensemble_res<T> res;
+    if (rank == root) {
+        res.states.resize(static_cast<std::size_t>(n_iter) * dim);
+        res.times.resize(static_cast<std::size_t>(n_iter));
+        res.outcomes.resize(static_cast<std::size_t>(n_iter));
+        res.min_hs.resize(static_cast<std::size_t>(n_iter));
+        res.max_hs.resize(static_cast<std::size_t>(n_iter));
+        res.n_steps.resize(static_cast<std::size_t>(n_iter));
+    }
+
+    mpi_gather_rows(comm, root, l_res.states.data(), res.states.data(), n_iter, dim * sizeof(T));
+    mpi_gather_rows(comm, root, l_res.times.data(), res.times.data(), n_iter, sizeof(T));
+    mpi_gather_rows(comm, root, l_res.outcomes.data(), res.outcomes.data(), n_iter, sizeof(taylor_outcome));
+    mpi_gather_rows(comm, root, l_res.min_hs.data(), res.min_hs.data(), n_iter, sizeof(T));
+    mpi_gather_rows(comm, root, l_res.max_hs.data(), res.max_hs.data(), n_iter, sizeof(T));
+    mpi_gather_rows(comm, root, l_res.n_steps.data(), res.n_steps.data(), n_iter, sizeof(std::size_t));
+
+    return res;
+}
+
+} // namespace
+
+#define HEYOKA_MPI_ENSEMBLE_IMPL(T)                                                                                    \
+    taylor_adaptive<T> mpi_bcast_integrator_impl(MPI_Comm comm, int root, const taylor_adaptive<T> *ta,                \
+                                                 std::vector<t_event<T>> tes, std::vector<nt_event<T>> ntes)           \
+    {                                                                                                                  \
+        return mpi_bcast_integrator_generic(comm, root, ta, std::move(tes), std::move(ntes));                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    ensemble_res<T> mpi_ensemble_propagate_until_impl(MPI_Comm comm, int root, const taylor_adaptive<T> *ta, T t,      \
+                                                      const std::vector<T> &ics, unsigned n_threads,                   \
+                                                      std::size_t max_steps, T max_delta_t,                            \
+                                                      const std::function<bool(taylor_adaptive<T> &)> &cb,             \
+                                                      bool pin_threads)                                                \
+    {                                                                                                                  \
+        return mpi_ensemble_propagate_until_generic(comm, root, ta, t, ics, n_threads, max_steps, max_delta_t, cb,     \
+                                                    pin_threads);                                                      \
+    }
+
+HEYOKA_MPI_ENSEMBLE_IMPL(double)
+HEYOKA_MPI_ENSEMBLE_IMPL(long double)
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_MPI_ENSEMBLE_IMPL(mppp::real128)
+
+#endif
+
+#undef HEYOKA_MPI_ENSEMBLE_IMPL
+
+} // namespace heyoka::detail
@@ -0,0 +1,430 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/multirate.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Partition the state variables of sys into the slow and fast subsystems
+// (the fast state variables are those listed in fast_vars). The return value
+// contains the indices of the slow (if slow is true) or fast state variables.
+std::vector<std::uint32_t> mr_partition(const std::vector<std::pair<expression, expression>> &sys,
+                                        const std::vector<expression> &fast_vars, bool slow)
+{
+    std::unordered_map<std::string, std::uint32_t> sv_idx;
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        const auto &lhs = sys[i].first;
+
+        if (!std::holds_alternative<variable>(lhs.value())) {
+            throw std::invalid_argument("Invalid ODE system passed to the constructor of a multirate integrator: "
+                                        "the left-hand side of an equation must be a variable");
+        }
+
+        if (!sv_idx.emplace(std::get<variable>(lhs.value()).name(), boost::numeric_cast<std::uint32_t>(i)).second) {
+            throw std::invalid_argument("Invalid ODE system passed to the constructor of a multirate integrator: "
+                                        "the state variable '{}' appears in multiple equations"_format(
+                                            std::get<variable>(lhs.value()).name()));
+        }
+    }
+
+    std::vector<bool> is_fast(sys.size());
+    for (const auto &ex : fast_vars) {
+        if (!std::holds_alternative<variable>(ex.value())) {
+            throw std::invalid_argument("The list of fast variables passed to the constructor of a multirate "
+                                        "integrator can contain only variables");
+        }
+
+        const auto &name = std::get<variable>(ex.value()).name();
+        const auto it = sv_idx.find(name);
+        if (it == sv_idx.end()) {
+            throw std::invalid_argument("The fast variable '{}' passed to the constructor of a multirate integrator "
+                                        "is not a state variable"_format(name));
+        }
+
+        if (is_fast[it->second]) {
+            throw std::invalid_argument("The fast variable '{}' appears multiple times in the list of fast variables "
+                                        "passed to the constructor of a multirate integrator"_format(name));
+        }
+
+        is_fast[it->second] = true;
+    }
+
+    if (fast_vars.empty() || fast_vars.size() == sys.size()) {
+        throw std::invalid_argument("Both the fast and slow subsystems of a multirate integrator must contain at "
+                                    "least one state variable");
+    }
+
+    std::vector<std::uint32_t> retval;
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        if (is_fast[i] != slow) {
+            retval.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    return retval;
+}
+
+// Number of runtime parameters in the original system
+// (the parameters of the slow and fast subsystems are
+// appended after these).
+template <typename T>
+std::uint32_t mr_n_pars(const std::vector<std::pair<expression, expression>> &sys, const std::vector<T> &pars)
+{
+    auto retval = boost::numeric_cast<std::uint32_t>(pars.size());
+
+    for (const auto &[_, rhs] : sys) {
+        retval = std::max(retval, get_param_size(rhs));
+    }
+
+    return retval;
+}
+
+// Construct the integrator of the slow subsystem. In the slow subsystem,
+// the fast state variable fast_idx[i] is replaced by the runtime
+// parameter par[n_pars + i].
+template <typename T>
+taylor_adaptive<T> mr_make_slow(const std::vector<std::pair<expression, expression>> &sys,
+                                const std::vector<std::uint32_t> &slow_idx, const std::vector<std::uint32_t> &fast_idx,
+                                std::uint32_t n_pars, const std::vector<T> &state,
+                                const std::tuple<T, T, bool, bool, std::vector<T>> &tup)
+{
+    if (state.size() != sys.size()) {
+        throw std::invalid_argument("Inconsistent sizes detected in the constructor of a multirate integrator: the "
+                                    "state vector has a size of {}, while the number of equations is {}"_format(
+                                        state.size(), sys.size()));
+    }
+
+    std::unordered_map<std::string, expression> smap;
+    for (decltype(fast_idx.size()) i = 0; i < fast_idx.size(); ++i) {
+        smap.emplace(std::get<variable>(sys[fast_idx[i]].first.value()).name(),
+                     expression{param{n_pars + static_cast<std::uint32_t>(i)}});
+    }
+
+    std::vector<std::pair<expression, expression>> ssys;
+    std::vector<T> sstate;
+    for (auto idx : slow_idx) {
+        ssys.emplace_back(sys[idx].first, subs(sys[idx].second, smap));
+        sstate.push_back(state[idx]);
+    }
+
+    auto pars = std::get<4>(tup);
+    pars.resize(boost::numeric_cast<decltype(pars.size())>(n_pars));
+    for (auto idx : fast_idx) {
+        pars.push_back(state[idx]);
+    }
+
+    return taylor_adaptive<T>{std::move(ssys),
+                              std::move(sstate),
+                              kw::time = std::get<0>(tup),
+                              kw::tol = std::get<1>(tup),
+                              kw::high_accuracy = std::get<2>(tup),
+                              kw::compact_mode = std::get<3>(tup),
+                              kw::pars = std::move(pars)};
+}
+
+// Construct the integrator of the fast subsystem. In the fast subsystem,
+// the slow state variable slow_idx[k] is replaced by the Taylor polynomial
+// of the current timestep of the slow integrator,
+// sum_o par[n_pars + 1 + k * (order + 1) + o] * (t - par[n_pars])**o,
+// where par[n_pars] is the time at the beginning of the slow timestep.
+template <typename T>
+taylor_adaptive<T> mr_make_fast(const std::vector<std::pair<expression, expression>> &sys,
+                                const std::vector<std::uint32_t> &slow_idx, const std::vector<std::uint32_t> &fast_idx,
+                                std::uint32_t n_pars, const std::vector<T> &state, const taylor_adaptive<T> &slow,
+                                const std::tuple<T, T, bool, bool, std::vector<T>> &tup)
+{
+    const auto order = slow.get_order();
+    const auto dt = heyoka::time - expression{param{n_pars}};
+
+    std::unordered_map<std::string, expression> smap;
+    for (decltype(slow_idx.size()) k = 0; k < slow_idx.size(); ++k) {
+        const auto base = n_pars + 1u + static_cast<std::uint32_t>(k) * (order + 1u);
+
+        // Horner's scheme.
+        auto poly = expression{param{base + order}};
+        for (auto o = order; o > 0u; --o) {
+            poly = expression{param{base + o - 1u}} + dt * poly;
+        }
+
+        smap.emplace(std::get<variable>(sys[slow_idx[k]].first.value()).name(), std::move(poly));
+    }
+
+    std::vector<std::pair<expression, expression>> fsys;
+    std::vector<T> fstate;
+    for (auto idx : fast_idx) {
+        fsys.emplace_back(sys[idx].first, subs(sys[idx].second, smap));
+        fstate.push_back(state[idx]);
+    }
+
+    // NOTE: the polynomials are initially constant and
+    // equal to the current values of the slow variables.
+    auto pars = std::get<4>(tup);
+    pars.resize(boost::numeric_cast<decltype(pars.size())>(n_pars));
+    pars.push_back(std::get<0>(tup));
+    for (auto idx : slow_idx) {
+        pars.push_back(state[idx]);
+        pars.resize(pars.size() + order, T(0));
+    }
+
+    return taylor_adaptive<T>{std::move(fsys),
+                              std::move(fstate),
+                              kw::time = std::get<0>(tup),
+                              kw::tol = std::get<1>(tup),
+                              kw::high_accuracy = std::get<2>(tup),
+                              kw::compact_mode = std::get<3>(tup),
+                              kw::pars = std::move(pars)};
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+taylor_multirate<T>::taylor_multirate(private_ctor_t, std::vector<std::pair<expression, expression>> sys,
+                                      std::vector<T> state, const std::vector<expression> &fast_vars,
+                                      std::tuple<T, T, bool, bool, std::vector<T>> tup)
+    : m_slow_idx(detail::mr_partition(sys, fast_vars, true)), m_fast_idx(detail::mr_partition(sys, fast_vars, false)),
+      m_n_pars(detail::mr_n_pars(sys, std::get<4>(tup))), m_state(std::move(state)),
+      m_slow(detail::mr_make_slow(sys, m_slow_idx, m_fast_idx, m_n_pars, m_state, tup)),
+      m_fast(detail::mr_make_fast(sys, m_slow_idx, m_fast_idx, m_n_pars, m_state, m_slow, tup))
+{
+}
+
+template <typename T>
+taylor_multirate<T>::taylor_multirate(const taylor_multirate &) = default;
+
+template <typename T>
+taylor_multirate<T>::taylor_multirate(taylor_multirate &&) noexcept = default;
+
+template <typename T>
+taylor_multirate<T> &taylor_multirate<T>::operator=(const taylor_multirate &) = default;
+
+template <typename T>
+taylor_multirate<T> &taylor_multirate<T>::operator=(taylor_multirate &&) noexcept = default;
+
+template <typename T>
+taylor_multirate<T>::~taylor_multirate() = default;
+
+template <typename T>
+const taylor_adaptive<T> &taylor_multirate<T>::get_slow_ta() const
+{
+    return m_slow;
+}
+
+template <typename T>
+const taylor_adaptive<T> &taylor_multirate<T>::get_fast_ta() const
+{
+    return m_fast;
+}
+
+template <typename T>
+const std::vector<std::uint32_t> &taylor_multirate<T>::get_slow_idx() const
+{
+    return m_slow_idx;
+}
+
+template <typename T>
+const std::vector<std::uint32_t> &taylor_multirate<T>::get_fast_idx() const
+{
+    return m_fast_idx;
+}
+
+template <typename T>
+T taylor_multirate<T>::get_time() const
+{
+    return m_slow.get_time();
+}
+
+template <typename T>
+const std::vector<T> &taylor_multirate<T>::get_state() const
+{
+    return m_state;
+}
+
+template <typename T>
+void taylor_multirate<T>::set_state(const std::vector<T> &state)
+{
+    if (state.size() != m_state.size()) {
+        throw std::invalid_argument("The state vector passed to a multirate integrator has a size of {}, but the "
+                                    "number of equations is {}"_format(state.size(), m_state.size()));
+    }
+
+    m_state = state;
+
+    for (decltype(m_slow_idx.size()) i = 0; i < m_slow_idx.size(); ++i) {
+        m_slow.get_state_data()[i] = m_state[m_slow_idx[i]];
+    }
+    for (decltype(m_fast_idx.size()) i = 0; i < m_fast_idx.size(); ++i) {
+        m_fast.get_state_data()[i] = m_state[m_fast_idx[i]];
+    }
+}
+
+template <typename T>
+void taylor_multirate<T>::set_time(T t)
+{
+    m_slow.set_time(t);
+    m_fast.set_time(t);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, std::size_t> taylor_multirate<T>::step_impl(T max_delta_t)
+{
+    const auto t0 = m_slow.get_time();
+
+    // Freeze the fast variables in the slow subsystem.
+    auto *s_pars = m_slow.get_pars_data();
+    for (decltype(m_fast_idx.size()) i = 0; i < m_fast_idx.size(); ++i) {
+        s_pars[m_n_pars + i] = m_state[m_fast_idx[i]];
+    }
+
+    // Slow timestep.
+    // NOTE: write the Taylor coefficients, which
+    // are needed by the fast subsystem.
+    const auto [oc, h] = m_slow.step(max_delta_t, true);
+    if (oc != taylor_outcome::success && oc != taylor_outcome::time_limit) {
+        return std::tuple{oc, h, std::size_t(0)};
+    }
+
+    // Pass the Taylor polynomials of the slow timestep
+    // to the fast subsystem.
+    const auto &tc = m_slow.get_tc();
+    auto *f_pars = m_fast.get_pars_data();
+    f_pars[m_n_pars] = t0;
+    std::copy(tc.begin(), tc.end(), f_pars + m_n_pars + 1u);
+
+    // Propagate the fast subsystem over the slow timestep.
+    const auto f_res = m_fast.propagate_until(m_slow.get_time());
+    const auto n_fast = std::get<3>(f_res);
+    if (std::get<0>(f_res) != taylor_outcome::time_limit) {
+        return std::tuple{std::get<0>(f_res), h, n_fast};
+    }
+
+    // Update the state vector.
+    for (decltype(m_slow_idx.size()) i = 0; i < m_slow_idx.size(); ++i) {
+        m_state[m_slow_idx[i]] = m_slow.get_state()[i];
+    }
+    for (decltype(m_fast_idx.size()) i = 0; i < m_fast_idx.size(); ++i) {
+        m_state[m_fast_idx[i]] = m_fast.get_state()[i];
+    }
+
+    return std::tuple{oc, h, n_fast};
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, std::size_t> taylor_multirate<T>::step()
+{
+    return step_impl(std::numeric_limits<T>::infinity());
+}
+
+template <typename T>
+std::tuple<taylor_outcome, T, std::size_t> taylor_multirate<T>::step(T max_delta_t)
+{
+    using std::isnan;
+
+    if (isnan(max_delta_t)) {
+        throw std::invalid_argument("A NaN max_delta_t was passed to the step() function of a multirate integrator");
+    }
+
+    return step_impl(max_delta_t);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, std::size_t, std::size_t> taylor_multirate<T>::propagate_until(T t, std::size_t max_steps)
+{
+    using std::isfinite;
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite time was passed to the propagate_until() function of a multirate "
+                                    "integrator");
+    }
+
+    std::size_t n_slow = 0, n_fast = 0;
+
+    while (true) {
+        const auto rem_time = t - get_time();
+        if (rem_time == 0) {
+            return std::tuple{taylor_outcome::time_limit, n_slow, n_fast};
+        }
+
+        if (max_steps != 0u && n_slow == max_steps) {
+            return std::tuple{taylor_outcome::step_limit, n_slow, n_fast};
+        }
+
+        const auto [oc, h, nf] = step_impl(rem_time);
+        ++n_slow;
+        n_fast += nf;
+
+        if (oc == taylor_outcome::time_limit) {
+            return std::tuple{taylor_outcome::time_limit, n_slow, n_fast};
+        }
+
+        if (oc != taylor_outcome::success) {
+            return std::tuple{oc, n_slow, n_fast};
+        }
+    }
+}
+
+template class taylor_multirate<double>;
+template class taylor_multirate<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class taylor_multirate<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
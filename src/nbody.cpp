@@ -7,19 +7,27 @@
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <initializer_list>
+#include <limits>
+#include <map>
 #include <stdexcept>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include <boost/numeric/conversion/cast.hpp>
 
 #include <fmt/format.h>
 
+#include <heyoka/detail/octree.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/math.hpp>
+#include <heyoka/math/nbody_acc.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/variable.hpp>
@@ -228,8 +236,339 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_fixed_masses(std::
     return retval;
 }
 
+// NOTE: this is a variant of make_nbody_sys_fixed_masses() in which the accelerations
+// are expressed via the fused N-body functions nbody_r2() and nbody_acc(). Each pair
+// of interacting bodies contributes only two u variables to the Taylor decomposition (the squared
+// distance and its power -3/2), and each component of the acceleration on a body is
+// computed by a single u variable, rather than by a tree of binary operations.
+std::vector<std::pair<expression, expression>> make_nbody_sys_fused(std::uint32_t n, number Gconst,
+                                                                    std::vector<number> masses)
+{
+    assert(n >= 2u);
+
+    if (masses.size() != n) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected while creating an N-body system: the vector of masses has a size of "
+            "{}, while the number of bodies is {}"_format(masses.size(), n));
+    }
+
+    // Create the state variables.
+    std::vector<expression> x_vars, y_vars, z_vars, vx_vars, vy_vars, vz_vars;
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        x_vars.emplace_back(variable("x_{}"_format(i)));
+        y_vars.emplace_back(variable("y_{}"_format(i)));
+        z_vars.emplace_back(variable("z_{}"_format(i)));
+
+        vx_vars.emplace_back(variable("vx_{}"_format(i)));
+        vy_vars.emplace_back(variable("vy_{}"_format(i)));
+        vz_vars.emplace_back(variable("vz_{}"_format(i)));
+    }
+
+    // The inverse cubed distances between the bodies. The element
+    // r_m3[i][j - i - 1] corresponds to the pair (i, j), with j > i.
+    // NOTE: the distance is computed only if at least one
+    // of the bodies in the pair is massive.
+    std::vector<std::vector<expression>> r_m3;
+    r_m3.resize(boost::numeric_cast<decltype(r_m3.size())>(n));
+    for (std::uint32_t i = 0; i < n; ++i) {
+        for (std::uint32_t j = i + 1u; j < n; ++j) {
+            if (is_zero(masses[i]) && is_zero(masses[j])) {
+                r_m3[i].emplace_back();
+            } else {
+                r_m3[i].push_back(pow(nbody_r2(x_vars[i], y_vars[i], z_vars[i], x_vars[j], y_vars[j], z_vars[j]),
+                                      expression{-3. / 2}));
+            }
+        }
+    }
+
+    // Create the return value.
+    std::vector<std::pair<expression, expression>> retval;
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        // r' = v.
+        retval.push_back(prime(x_vars[i]) = vx_vars[i]);
+        retval.push_back(prime(y_vars[i]) = vy_vars[i]);
+        retval.push_back(prime(z_vars[i]) = vz_vars[i]);
+
+        // Collect the coefficients, the coordinates and the inverse
+        // cubed distances of the massive bodies attracting body i.
+        std::vector<expression> cs, xs, ys, zs, rs;
+        for (std::uint32_t j = 0; j < n; ++j) {
+            if (j == i || is_zero(masses[j])) {
+                continue;
+            }
+
+            cs.emplace_back(Gconst * masses[j]);
+            xs.push_back(x_vars[j]);
+            ys.push_back(y_vars[j]);
+            zs.push_back(z_vars[j]);
+            rs.push_back(j > i ? r_m3[i][j - i - 1u] : r_m3[j][i - j - 1u]);
+        }
+
+        if (cs.empty()) {
+            // No massive body is attracting body i.
+            retval.push_back(prime(vx_vars[i]) = expression{0.});
+            retval.push_back(prime(vy_vars[i]) = expression{0.});
+            retval.push_back(prime(vz_vars[i]) = expression{0.});
+        } else {
+            retval.push_back(prime(vx_vars[i]) = nbody_acc(x_vars[i], cs, xs, rs));
+            retval.push_back(prime(vy_vars[i]) = nbody_acc(y_vars[i], cs, ys, rs));
+            retval.push_back(prime(vz_vars[i]) = nbody_acc(z_vars[i], std::move(cs), std::move(zs), std::move(rs)));
+        }
+    }
+
+    return retval;
+}
+
+namespace
+{
+
+// Helper to convert a number to double.
+double nbody_num_to_dbl(const number &n)
+{
+    return std::visit([](const auto &v) { return static_cast<double>(v); }, n.value());
+}
+
+} // namespace
+
+// NOTE: in the tree formulation, the massive bodies are clustered in an octree
+// built from their positions in the reference state. For each body i, the octree is walked from
+// the root, and a cell not containing i is treated as a single body placed at the cell's centre
+// of mass if its size is less than theta times its distance from i (this is the classical
+// Barnes-Hut opening criterion). The centre of mass of a cell is a (linear) function of the
+// state variables, thus the resulting ODE system is smooth and it can be integrated with the Taylor
+// method. The interaction lists are however fixed at construction time, hence the system needs to
+// be re-created if the configuration of the bodies changes substantially with respect
+// to the reference state. The total number of interactions scales as O(n log n) for fixed theta.
+std::vector<std::pair<expression, expression>> make_nbody_sys_tree(std::uint32_t n, number Gconst,
+                                                                   std::vector<number> masses, double theta,
+                                                                   std::vector<double> ref_state, bool fused)
+{
+    assert(n >= 2u);
+
+    if (masses.size() != n) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected while creating an N-body system: the vector of masses has a size of "
+            "{}, while the number of bodies is {}"_format(masses.size(), n));
+    }
+
+    if (!std::isfinite(theta) || !(theta > 0)) {
+        throw std::invalid_argument("The opening angle of the tree approximation of an N-body system must be positive "
+                                    "and finite, but a value of {} was provided instead"_format(theta));
+    }
+
+    if (ref_state.size() / 6u != n || ref_state.size() % 6u != 0u) {
+        throw std::invalid_argument(
+            "The reference state for the tree approximation of an N-body system has a size of {}, but a size of {} "
+            "(i.e., 6 times the number of bodies) is required"_format(ref_state.size(), 6ull * n));
+    }
+
+    if (!std::all_of(ref_state.begin(), ref_state.end(), [](double x) { return std::isfinite(x); })) {
+        throw std::invalid_argument(
+            "The reference state for the tree approximation of an N-body system must contain only finite values");
+    }
+
+    // Create the state variables.
+    std::vector<expression> x_vars, y_vars, z_vars, vx_vars, vy_vars, vz_vars;
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        x_vars.emplace_back(variable("x_{}"_format(i)));
+        y_vars.emplace_back(variable("y_{}"_format(i)));
+        z_vars.emplace_back(variable("z_{}"_format(i)));
+
+        vx_vars.emplace_back(variable("vx_{}"_format(i)));
+        vy_vars.emplace_back(variable("vy_{}"_format(i)));
+        vz_vars.emplace_back(variable("vz_{}"_format(i)));
+    }
+
+    // Collect the massive bodies and their reference positions.
+    std::vector<std::uint32_t> src_idx;
+    std::vector<std::array<double, 3>> src_pos;
+    std::vector<double> src_masses;
+    // NOTE: the position of body i in the permutation of
+    // the octree (only meaningful for massive bodies).
+    std::vector<std::size_t> perm_pos(n, 0);
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const auto m = nbody_num_to_dbl(masses[i]);
+
+        if (!std::isfinite(m) || m < 0) {
+            throw std::invalid_argument("The masses in the tree approximation of an N-body system must be "
+                                        "non-negative and finite, but a value of {} was provided instead"_format(m));
+        }
+
+        if (m > 0) {
+            src_idx.push_back(i);
+            src_pos.push_back({ref_state[6u * i], ref_state[6u * i + 1u], ref_state[6u * i + 2u]});
+            src_masses.push_back(m);
+        }
+    }
+
+    // Create the return value.
+    std::vector<std::pair<expression, expression>> retval;
+
+    if (src_idx.empty()) {
+        // No massive bodies.
+        for (std::uint32_t i = 0; i < n; ++i) {
+            retval.push_back(prime(x_vars[i]) = vx_vars[i]);
+            retval.push_back(prime(y_vars[i]) = vy_vars[i]);
+            retval.push_back(prime(z_vars[i]) = vz_vars[i]);
+            retval.push_back(prime(vx_vars[i]) = expression{0.});
+            retval.push_back(prime(vy_vars[i]) = expression{0.});
+            retval.push_back(prime(vz_vars[i]) = expression{0.});
+        }
+
+        return retval;
+    }
+
+    const auto tree = build_octree(src_pos, src_masses);
+
+    std::vector<bool> is_src(n, false);
+    for (decltype(tree.perm.size()) k = 0; k < tree.perm.size(); ++k) {
+        is_src[src_idx[tree.perm[k]]] = true;
+        perm_pos[src_idx[tree.perm[k]]] = k;
+    }
+
+    // The symbolic centres of mass of the cells,
+    // computed on demand and indexed by the
+    // position of the cell in the permutation.
+    std::map<std::pair<std::size_t, std::size_t>, std::array<expression, 3>> com_cache;
+    auto cell_com = [&](const octree_node &nd) -> const std::array<expression, 3> & {
+        auto it = com_cache.find({nd.begin, nd.end});
+
+        if (it == com_cache.end()) {
+            std::array<std::vector<expression>, 3> terms;
+            for (auto k = nd.begin; k < nd.end; ++k) {
+                const auto j = src_idx[tree.perm[k]];
+                const auto w = expression{number{src_masses[tree.perm[k]] / nd.mass}};
+
+                terms[0].push_back(w * x_vars[j]);
+                terms[1].push_back(w * y_vars[j]);
+                terms[2].push_back(w * z_vars[j]);
+            }
+
+            it = com_cache
+                     .emplace(std::pair{nd.begin, nd.end},
+                              std::array<expression, 3>{pairwise_sum(std::move(terms[0])),
+                                                        pairwise_sum(std::move(terms[1])),
+                                                        pairwise_sum(std::move(terms[2]))})
+                     .first;
+        }
+
+        return it->second;
+    };
+
+    // Helper to compute the inverse cubed distance
+    // between the points a and b.
+    auto make_r_m3 = [fused](const std::array<expression, 3> &a, const std::array<expression, 3> &b) {
+        if (fused) {
+            return pow(nbody_r2(a[0], a[1], a[2], b[0], b[1], b[2]), expression{-3. / 2});
+        } else {
+            return pow(square(b[0] - a[0]) + square(b[1] - a[1]) + square(b[2] - a[2]), expression{-3. / 2});
+        }
+    };
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        // r' = v.
+        retval.push_back(prime(x_vars[i]) = vx_vars[i]);
+        retval.push_back(prime(y_vars[i]) = vy_vars[i]);
+        retval.push_back(prime(z_vars[i]) = vz_vars[i]);
+
+        const std::array<expression, 3> pos_i{x_vars[i], y_vars[i], z_vars[i]};
+        const std::array<double, 3> ref_i{ref_state[6u * i], ref_state[6u * i + 1u], ref_state[6u * i + 2u]};
+
+        // Collect the coefficients, the coordinates and the inverse
+        // cubed distances of the bodies and cells attracting body i.
+        std::vector<expression> cs, rs;
+        std::array<std::vector<expression>, 3> srcs;
+
+        auto add_body = [&](std::uint32_t j) {
+            const std::array<expression, 3> pos_j{x_vars[j], y_vars[j], z_vars[j]};
+
+            cs.emplace_back(Gconst * masses[j]);
+            for (std::size_t c = 0; c < 3u; ++c) {
+                srcs[c].push_back(pos_j[c]);
+            }
+            // NOTE: use a canonical ordering for the pair,
+            // so that the distance is shared with body j.
+            rs.push_back(j > i ? make_r_m3(pos_i, pos_j) : make_r_m3(pos_j, pos_i));
+        };
+
+        octree_walk(tree, [&](const octree_node &nd) {
+            const auto contains_i = is_src[i] && perm_pos[i] >= nd.begin && perm_pos[i] < nd.end;
+
+            if (!contains_i) {
+                if (nd.end - nd.begin == 1u) {
+                    // Single body.
+                    add_body(src_idx[tree.perm[nd.begin]]);
+
+                    return false;
+                }
+
+                const auto dist = std::sqrt((nd.com[0] - ref_i[0]) * (nd.com[0] - ref_i[0])
+                                            + (nd.com[1] - ref_i[1]) * (nd.com[1] - ref_i[1])
+                                            + (nd.com[2] - ref_i[2]) * (nd.com[2] - ref_i[2]));
+
+                if (nd.size < theta * dist) {
+                    // The cell is far enough, use its centre of mass.
+                    const auto &com = cell_com(nd);
+
+                    cs.emplace_back(Gconst * number{nd.mass});
+                    for (std::size_t c = 0; c < 3u; ++c) {
+                        srcs[c].push_back(com[c]);
+                    }
+                    rs.push_back(make_r_m3(pos_i, com));
+
+                    return false;
+                }
+            }
+
+            if (nd.children.empty()) {
+                // Leaf which cannot be approximated,
+                // add the bodies one by one.
+                for (auto k = nd.begin; k < nd.end; ++k) {
+                    const auto j = src_idx[tree.perm[k]];
+
+                    if (j != i) {
+                        add_body(j);
+                    }
+                }
+
+                return false;
+            }
+
+            return true;
+        });
+
+        if (cs.empty()) {
+            // No massive body is attracting body i.
+            retval.push_back(prime(vx_vars[i]) = expression{0.});
+            retval.push_back(prime(vy_vars[i]) = expression{0.});
+            retval.push_back(prime(vz_vars[i]) = expression{0.});
+        } else if (fused) {
+            for (std::size_t c = 0; c < 3u; ++c) {
+                retval.push_back(prime(c == 0u ? vx_vars[i] : (c == 1u ? vy_vars[i] : vz_vars[i]))
+                                 = nbody_acc(pos_i[c], cs, srcs[c], rs));
+            }
+        } else {
+            for (std::size_t c = 0; c < 3u; ++c) {
+                std::vector<expression> terms;
+                for (decltype(cs.size()) k = 0; k < cs.size(); ++k) {
+                    terms.push_back(cs[k] * (srcs[c][k] - pos_i[c]) * rs[k]);
+                }
+
+                retval.push_back(prime(c == 0u ? vx_vars[i] : (c == 1u ? vy_vars[i] : vz_vars[i]))
+                                 = pairwise_sum(std::move(terms)));
+            }
+        }
+    }
+
+    return retval;
+}
+
 std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::uint32_t n, number Gconst,
-                                                                         std::uint32_t n_massive)
+                                                                         std::uint32_t n_massive, bool par_inter)
 {
     assert(n >= 2u);
 
@@ -264,6 +603,18 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::ui
     auto y_acc = x_acc;
     auto z_acc = x_acc;
 
+    // Overflow check for the indices of the switch parameters.
+    // LCOV_EXCL_START
+    if (par_inter
+        && n > (std::numeric_limits<std::uint32_t>::max() - n_massive) / std::max(n_massive, std::uint32_t(1))) {
+        throw std::overflow_error("Overflow detected in the number of parameters of an N-body system");
+    }
+    // LCOV_EXCL_STOP
+
+    // Helper to fetch the switch parameter for
+    // the acceleration exerted by j on i.
+    auto sw = [n_massive](std::uint32_t i, std::uint32_t j) { return par[n_massive + i * n_massive + j]; };
+
     // Compute the accelerations exerted by the massive particles
     // on all particles.
     for (std::uint32_t i = 0; i < n_massive; ++i) {
@@ -283,7 +634,26 @@ std::vector<std::pair<expression, expression>> make_nbody_sys_par_masses(std::ui
             auto diff_z = z_vars[j] - z_vars[i];
 
             auto r_m3 = pow(square(diff_x) + square(diff_y) + square(diff_z), expression{-3. / 2});
-            if (j < n_massive) {
+            if (par_inter) {
+                // NOTE: with the switch parameters, the accelerations
+                // exerted by i on j and by j on i are not proportional
+                // in general, hence we cannot re-use c_ij below.
+                auto fac = expression{Gconst} * r_m3;
+
+                if (j < n_massive) {
+                    // Acceleration exerted by j on i.
+                    auto fac_j = fac * (par[j] * sw(i, j));
+                    x_acc[i].push_back(diff_x * fac_j);
+                    y_acc[i].push_back(diff_y * fac_j);
+                    z_acc[i].push_back(diff_z * fac_j);
+                }
+
+                // Acceleration exerted by i on j.
+                auto fac_i = fac * (-par[i] * sw(j, i));
+                x_acc[j].push_back(diff_x * fac_i);
+                y_acc[j].push_back(diff_y * fac_i);
+                z_acc[j].push_back(diff_z * fac_i);
+            } else if (j < n_massive) {
                 // Body j is massive and it interacts mutually with body i.
                 // NOTE: the idea here is that we want to help the CSE process
                 // when computing the Taylor decomposition. Thus, we try
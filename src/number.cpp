@@ -14,6 +14,7 @@
 #include <initializer_list>
 #include <limits>
 #include <locale>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -59,6 +60,38 @@ using fmt::literals::operator""_format;
 namespace heyoka
 {
 
+namespace detail
+{
+
+namespace
+{
+
+// Fast path for the arithmetic and comparison operators:
+// if both n1 and n2 contain double values, invoke op directly on
+// them and return the result, otherwise return an empty optional.
+// NOTE: numbers in the expressions are almost always double,
+// and in this case std::visit() on two variants (with type
+// promotion) is a noticeable overhead in the manipulation
+// of large expressions (e.g., in the decompositions).
+template <typename F>
+auto number_dbl_fast_path(const number &n1, const number &n2, const F &op)
+{
+    const auto *p1 = std::get_if<double>(&n1.value());
+    const auto *p2 = std::get_if<double>(&n2.value());
+
+    using ret_t = decltype(op(*p1, *p2));
+
+    if (p1 != nullptr && p2 != nullptr) {
+        return std::optional<ret_t>(op(*p1, *p2));
+    } else {
+        return std::optional<ret_t>{};
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
 number::number(double x) : m_value(x) {}
 
 number::number(long double x) : m_value(x) {}
@@ -153,26 +186,46 @@ void rename_variables(number &, const std::unordered_map<std::string, std::strin
 
 bool is_zero(const number &n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return *ptr == 0;
+    }
+
     return std::visit([](const auto &arg) { return arg == 0; }, n.value());
 }
 
 bool is_one(const number &n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return *ptr == 1;
+    }
+
     return std::visit([](const auto &arg) { return arg == 1; }, n.value());
 }
 
 bool is_negative_one(const number &n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return *ptr == -1;
+    }
+
     return std::visit([](const auto &arg) { return arg == -1; }, n.value());
 }
 
 number operator-(number n)
 {
+    if (const auto *ptr = std::get_if<double>(&n.value())) {
+        return number{-*ptr};
+    }
+
     return std::visit([](auto &&arg) { return number{-std::forward<decltype(arg)>(arg)}; }, std::move(n.value()));
 }
 
 number operator+(number n1, number n2)
 {
+    if (auto ret = detail::number_dbl_fast_path(n1, n2, [](double a, double b) { return a + b; })) {
+        return number{*ret};
+    }
+
     return std::visit(
         [](auto &&arg1, auto &&arg2) {
             return number{std::forward<decltype(arg1)>(arg1) + std::forward<decltype(arg2)>(arg2)};
@@ -182,6 +235,10 @@ number operator+(number n1, number n2)
 
 number operator-(number n1, number n2)
 {
+    if (auto ret = detail::number_dbl_fast_path(n1, n2, [](double a, double b) { return a - b; })) {
+        return number{*ret};
+    }
+
     return std::visit(
         [](auto &&arg1, auto &&arg2) {
             return number{std::forward<decltype(arg1)>(arg1) - std::forward<decltype(arg2)>(arg2)};
@@ -191,6 +248,10 @@ number operator-(number n1, number n2)
 
 number operator*(number n1, number n2)
 {
+    if (auto ret = detail::number_dbl_fast_path(n1, n2, [](double a, double b) { return a * b; })) {
+        return number{*ret};
+    }
+
     return std::visit(
         [](auto &&arg1, auto &&arg2) {
             return number{std::forward<decltype(arg1)>(arg1) * std::forward<decltype(arg2)>(arg2)};
@@ -200,6 +261,10 @@ number operator*(number n1, number n2)
 
 number operator/(number n1, number n2)
 {
+    if (auto ret = detail::number_dbl_fast_path(n1, n2, [](double a, double b) { return a / b; })) {
+        return number{*ret};
+    }
+
     return std::visit(
         [](auto &&arg1, auto &&arg2) {
             return number{std::forward<decltype(arg1)>(arg1) / std::forward<decltype(arg2)>(arg2)};
@@ -209,6 +274,13 @@ number operator/(number n1, number n2)
 
 bool operator==(const number &n1, const number &n2)
 {
+    // NOTE: the semantics of the fast path must
+    // match the semantics of the general case below.
+    if (auto ret = detail::number_dbl_fast_path(
+            n1, n2, [](double a, double b) { return (std::isnan(a) && std::isnan(b)) || a == b; })) {
+        return *ret;
+    }
+
     return std::visit(
         [](const auto &v1, const auto &v2) {
             using std::isnan;
@@ -0,0 +1,368 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <ios>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/detail/ephemeris.hpp>
+#include <heyoka/output_sink.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+template <typename T>
+output_sink<T>::output_sink(private_ctor_t, const taylor_adaptive<T> &ta, std::string path,
+                            std::tuple<sink_format, std::size_t, sink_policy, bool> ops)
+    : m_path(std::move(path)), m_format(std::get<0>(ops)), m_policy(std::get<2>(ops)),
+      // NOTE: the Taylor coefficients are always stored in ephemeris format.
+      m_wtc(std::get<3>(ops) || m_format == sink_format::ephemeris), m_dim(ta.get_dim()), m_order(ta.get_order()),
+      m_capacity(std::get<1>(ops))
+{
+    using namespace fmt::literals;
+
+    if (m_format != sink_format::raw && m_format != sink_format::ephemeris) {
+        throw std::invalid_argument("Invalid format specified for an output sink");
+    }
+    if (m_policy != sink_policy::block && m_policy != sink_policy::drop) {
+        throw std::invalid_argument("Invalid policy specified for an output sink");
+    }
+    if (m_capacity == 0u) {
+        throw std::invalid_argument("The capacity of an output sink cannot be zero");
+    }
+
+    // Compute the size of a record: time (hi and lo parts), size
+    // of the last step, state vector (in raw format only) and
+    // Taylor coefficients (if requested).
+    const auto tc_size = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+    m_rec_size = 3u + (m_format == sink_format::raw ? static_cast<std::size_t>(m_dim) : 0u) + (m_wtc ? tc_size : 0u);
+
+    // LCOV_EXCL_START
+    if (m_capacity > std::numeric_limits<std::size_t>::max() / m_rec_size) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the buffer of an output sink");
+    }
+    // LCOV_EXCL_STOP
+
+    m_buffer.resize(m_capacity * m_rec_size);
+
+    // Open the output stream.
+    // NOTE: in ephemeris format, the Taylor coefficients are streamed
+    // into a temporary file which is then copied into the ephemeris
+    // file in close().
+    const auto ofs_path = m_format == sink_format::raw ? m_path : "{}.tcs.tmp{}"_format(m_path, std::random_device{}());
+    m_ofs.open(ofs_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!m_ofs) {
+        throw std::invalid_argument("Unable to open the file '{}' for writing in an output sink"_format(ofs_path));
+    }
+    if (m_format == sink_format::ephemeris) {
+        m_tcs_path = ofs_path;
+    }
+
+    // NOTE: start the writer last, so that
+    // the object is fully set up.
+    m_writer = std::thread([this]() { writer_loop(); });
+}
+
+template <typename T>
+output_sink<T>::~output_sink()
+{
+    try {
+        close();
+        // LCOV_EXCL_START
+    } catch (...) {
+    }
+    // LCOV_EXCL_STOP
+}
+
+template <typename T>
+void output_sink<T>::check_error() const
+{
+    if (m_error.load(std::memory_order_acquire)) {
+        std::rethrow_exception(m_exc);
+    }
+}
+
+template <typename T>
+void output_sink<T>::write_record(const T *rec)
+{
+    using namespace fmt::literals;
+
+    if (m_format == sink_format::raw) {
+        m_ofs.write(reinterpret_cast<const char *>(rec), boost::numeric_cast<std::streamsize>(m_rec_size * sizeof(T)));
+    } else {
+        // Record the initial time and the size of the step.
+        const auto t0 = detail::dfloat<T>(rec[0], rec[1]) - rec[2];
+        m_times_hi.push_back(t0.hi);
+        m_times_lo.push_back(t0.lo);
+        m_hs.push_back(rec[2]);
+
+        m_ofs.write(reinterpret_cast<const char *>(rec + 3),
+                    boost::numeric_cast<std::streamsize>((m_rec_size - 3u) * sizeof(T)));
+    }
+
+    if (!m_ofs) {
+        throw std::runtime_error("Error writing the file '{}' in an output sink"_format(
+            m_format == sink_format::raw ? m_path : m_tcs_path));
+    }
+}
+
+template <typename T>
+void output_sink<T>::writer_loop()
+{
+    try {
+        while (true) {
+            // NOTE: load the stop flag before the head, so that
+            // all the snapshots pushed before close() are
+            // visible when the stop flag is seen.
+            const auto stop = m_stop.load(std::memory_order_acquire);
+            const auto head = m_head.load(std::memory_order_acquire);
+            auto tail = m_tail.load(std::memory_order_relaxed);
+
+            if (tail == head) {
+                if (stop) {
+                    break;
+                }
+
+                // NOTE: poll instead of waiting on a condition variable,
+                // so that push() never needs to take a lock.
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+                continue;
+            }
+
+            // Consume all the available snapshots, freeing
+            // each slot as soon as it has been written.
+            for (; tail != head; ++tail) {
+                write_record(m_buffer.data() + (tail % m_capacity) * m_rec_size);
+                m_tail.store(tail + 1u, std::memory_order_release);
+            }
+        }
+    } catch (...) {
+        m_exc = std::current_exception();
+        m_error.store(true, std::memory_order_release);
+    }
+}
+
+template <typename T>
+bool output_sink<T>::push(const taylor_adaptive<T> &ta)
+{
+    if (m_closed) {
+        throw std::invalid_argument("Cannot push a snapshot into a closed output sink");
+    }
+
+    if (ta.get_dim() != m_dim || ta.get_order() != m_order) {
+        throw std::invalid_argument("The dimension and/or the order of the integrator pushed into an output sink do "
+                                    "not match the dimension and/or the order of the output sink");
+    }
+
+    check_error();
+
+    // NOTE: in ephemeris format, the steps
+    // of zero size are not recorded.
+    if (m_format == sink_format::ephemeris && ta.get_last_h() == 0) {
+        return true;
+    }
+
+    // NOTE: only the producer writes m_head.
+    const auto head = m_head.load(std::memory_order_relaxed);
+
+    if (head - m_tail.load(std::memory_order_acquire) == m_capacity) {
+        // The buffer is full.
+        if (m_policy == sink_policy::drop) {
+            ++m_n_dropped;
+
+            return false;
+        }
+
+        while (head - m_tail.load(std::memory_order_acquire) == m_capacity) {
+            check_error();
+            std::this_thread::yield();
+        }
+    }
+
+    // Write the snapshot into the slot.
+    auto *rec = m_buffer.data() + (head % m_capacity) * m_rec_size;
+    rec[0] = ta.m_time.hi;
+    rec[1] = ta.m_time.lo;
+    rec[2] = ta.get_last_h();
+    rec += 3;
+
+    if (m_format == sink_format::raw) {
+        rec = std::copy(ta.get_state().begin(), ta.get_state().end(), rec);
+    }
+
+    if (m_wtc) {
+        const auto &tc = ta.get_tc();
+        std::copy(tc.begin(), tc.end(), rec);
+    }
+
+    // Make the snapshot visible to the writer.
+    m_head.store(head + 1u, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+void output_sink<T>::drain()
+{
+    const auto head = m_head.load(std::memory_order_relaxed);
+
+    while (m_tail.load(std::memory_order_acquire) != head) {
+        check_error();
+        std::this_thread::yield();
+    }
+
+    check_error();
+}
+
+template <typename T>
+void output_sink<T>::close()
+{
+    using namespace fmt::literals;
+
+    if (m_closed) {
+        return;
+    }
+
+    // Stop the writer.
+    m_stop.store(true, std::memory_order_release);
+    m_writer.join();
+    m_closed = true;
+
+    m_ofs.close();
+
+    if (!m_ofs && !m_exc) {
+        m_exc = std::make_exception_ptr(std::runtime_error("Error writing the file '{}' in an output sink"_format(
+            m_format == sink_format::raw ? m_path : m_tcs_path)));
+    }
+
+    if (m_format == sink_format::ephemeris) {
+        // Assemble the ephemeris file.
+        if (!m_exc) {
+            try {
+                if (m_hs.empty()) {
+                    throw std::invalid_argument("Cannot write an ephemeris file from an output sink with no steps");
+                }
+
+                detail::write_ephemeris_file<T>(
+                    m_path, m_dim, m_order, boost::numeric_cast<std::uint64_t>(m_hs.size()), m_times_hi.data(),
+                    m_times_lo.data(), m_hs.data(), [this](std::ostream &os) {
+                        std::ifstream ifs(m_tcs_path, std::ios_base::in | std::ios_base::binary);
+                        if (!ifs) {
+                            throw std::runtime_error("Unable to open the temporary file '{}'"_format(m_tcs_path));
+                        }
+
+                        os << ifs.rdbuf();
+                    });
+            } catch (...) {
+                m_exc = std::current_exception();
+            }
+        }
+
+        std::remove(m_tcs_path.c_str());
+    }
+
+    if (m_exc) {
+        std::rethrow_exception(m_exc);
+    }
+}
+
+template <typename T>
+const std::string &output_sink<T>::get_path() const
+{
+    return m_path;
+}
+
+template <typename T>
+sink_format output_sink<T>::get_format() const
+{
+    return m_format;
+}
+
+template <typename T>
+sink_policy output_sink<T>::get_policy() const
+{
+    return m_policy;
+}
+
+template <typename T>
+std::size_t output_sink<T>::get_capacity() const
+{
+    return m_capacity;
+}
+
+template <typename T>
+bool output_sink<T>::get_write_tc() const
+{
+    return m_wtc;
+}
+
+template <typename T>
+bool output_sink<T>::is_closed() const
+{
+    return m_closed;
+}
+
+template <typename T>
+std::size_t output_sink<T>::get_n_pushed() const
+{
+    return m_head.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+std::size_t output_sink<T>::get_n_written() const
+{
+    return m_tail.load(std::memory_order_acquire);
+}
+
+template <typename T>
+std::size_t output_sink<T>::get_n_dropped() const
+{
+    return m_n_dropped;
+}
+
+template class output_sink<double>;
+template class output_sink<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class output_sink<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,229 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <heyoka/detail/logging_impl.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/parareal.hpp>
+#include <heyoka/taylor.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// Propagate the state vector st from the time t0 up to the time t1
+// with the integrator ta, writing the final state into out.
+// name is the name of the integrator, used in the error messages.
+template <typename T>
+void parareal_prop_slice(taylor_adaptive<T> &ta, T t0, const T *st, T t1, T *out, std::size_t max_steps,
+                         const char *name)
+{
+    const auto dim = ta.get_dim();
+
+    std::copy(st, st + dim, ta.get_state_data());
+    ta.set_time(t0);
+
+    const auto oc = std::get<0>(ta.propagate_until(t1, kw::max_steps = max_steps));
+    if (oc != taylor_outcome::time_limit) {
+        throw std::runtime_error("The propagation of a time slice with the {} integrator stopped before the end of "
+                                 "the slice in a parareal propagation (the outcome is {})"_format(name, oc));
+    }
+
+    std::copy(ta.get_state().begin(), ta.get_state().end(), out);
+}
+
+template <typename T>
+parareal_res<T> parareal_propagate_until_generic(const taylor_adaptive<T> &fine, const taylor_adaptive<T> &coarse,
+                                                 T t, std::uint32_t n_slices, unsigned n_threads,
+                                                 std::uint32_t max_iter, std::size_t max_steps, T tol)
+{
+    using std::abs;
+    using std::isfinite;
+    using std::isnan;
+
+    if (n_slices == 0u) {
+        throw std::invalid_argument("The number of time slices in a parareal propagation must be nonzero");
+    }
+
+    if (!isfinite(t) || !isfinite(fine.get_time())) {
+        throw std::invalid_argument("The initial and final times in a parareal propagation must be finite");
+    }
+
+    if (isnan(tol) || tol < 0) {
+        throw std::invalid_argument(
+            "The tolerance in a parareal propagation must be non-negative, but it is {} instead"_format(tol));
+    }
+
+    if (fine.get_dim() != coarse.get_dim()) {
+        throw std::invalid_argument("The dimension of the fine integrator ({}) is inconsistent with the dimension of "
+                                    "the coarse integrator ({}) in a parareal propagation"_format(fine.get_dim(),
+                                                                                                  coarse.get_dim()));
+    }
+
+    if (fine.get_pars().size() != coarse.get_pars().size()) {
+        throw std::invalid_argument(
+            "The number of parameters of the fine integrator ({}) is inconsistent with the number of parameters of "
+            "the coarse integrator ({}) in a parareal propagation"_format(fine.get_pars().size(),
+                                                                          coarse.get_pars().size()));
+    }
+
+    if (!fine.get_t_events().empty() || !fine.get_nt_events().empty() || !coarse.get_t_events().empty()
+        || !coarse.get_nt_events().empty()) {
+        throw std::invalid_argument("Integrators with events are not supported in a parareal propagation");
+    }
+
+    const auto dim = fine.get_dim();
+
+    // Overflow check for the size of the state buffers.
+    // LCOV_EXCL_START
+    if (n_slices >= std::numeric_limits<std::size_t>::max() / dim) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the state buffers "
+                                  "of a parareal propagation");
+    }
+    // LCOV_EXCL_STOP
+
+    parareal_res<T> res;
+
+    // Set up the boundaries of the time slices.
+    // NOTE: make sure the last boundary is exactly t.
+    const auto t0 = fine.get_time();
+    res.times.resize(n_slices + static_cast<std::size_t>(1));
+    for (std::uint32_t i = 0; i < n_slices; ++i) {
+        res.times[i] = t0 + (t - t0) * T(i) / T(n_slices);
+    }
+    res.times.back() = t;
+
+    // The state vectors at the boundaries of the slices.
+    res.states.resize((n_slices + static_cast<std::size_t>(1)) * dim);
+    std::copy(fine.get_state().begin(), fine.get_state().end(), res.states.data());
+
+    // The coarse integrator, with the parameters of fine.
+    auto cta = coarse;
+    std::copy(fine.get_pars().begin(), fine.get_pars().end(), cta.get_pars_data());
+
+    // The coarse and fine propagations of each slice, and
+    // a temporary buffer for the coarse propagations.
+    std::vector<T> g_prop(n_slices * static_cast<std::size_t>(dim)), f_prop(g_prop.size()), tmp(dim);
+
+    // The initial prediction via the coarse integrator.
+    for (std::size_t i = 0; i < n_slices; ++i) {
+        parareal_prop_slice(cta, res.times[i], res.states.data() + i * dim, res.times[i + 1u],
+                            g_prop.data() + i * dim, max_steps, "coarse");
+        std::copy(g_prop.data() + i * dim, g_prop.data() + (i + 1u) * dim, res.states.data() + (i + 1u) * dim);
+    }
+
+    // The per-thread fine integrators, created lazily
+    // by the worker threads (see ensemble_propagate_generic()).
+    std::vector<std::optional<taylor_adaptive<T>>> tas(parallel_n_workers(n_slices, n_threads));
+
+    for (; res.n_iter < max_iter && !res.converged; ++res.n_iter) {
+        // NOTE: after k iterations, the states at the first
+        // k + 1 boundaries coincide with the sequential fine
+        // propagation, thus only the remaining slices are propagated.
+        const auto k = res.n_iter;
+
+        // The fine propagations, in parallel.
+        parallel_for(n_slices - k, n_threads, [&](std::size_t b, std::size_t e, unsigned idx) {
+            auto &opt_ta = tas[idx];
+            if (!opt_ta) {
+                opt_ta.emplace(fine);
+            }
+
+            for (auto j = b; j < e; ++j) {
+                const auto i = k + j;
+
+                parareal_prop_slice(*opt_ta, res.times[i], res.states.data() + i * dim, res.times[i + 1u],
+                                    f_prop.data() + i * dim, max_steps, "fine");
+            }
+        });
+
+        // The sequential correction.
+        res.err = 0;
+        for (std::size_t i = k; i < n_slices; ++i) {
+            parareal_prop_slice(cta, res.times[i], res.states.data() + i * dim, res.times[i + 1u], tmp.data(),
+                                max_steps, "coarse");
+
+            for (std::uint32_t j = 0; j < dim; ++j) {
+                const auto idx = i * dim + j;
+
+                // NOTE: write the update as F + (G_new - G_old), so that
+                // the result is exactly F if the coarse propagations coincide.
+                const auto new_val = f_prop[idx] + (tmp[j] - g_prop[idx]);
+                auto &cur_val = res.states[idx + dim];
+
+                res.err = std::max(res.err, abs(new_val - cur_val) / std::max(T(1), abs(new_val)));
+                cur_val = new_val;
+            }
+
+            std::copy(tmp.begin(), tmp.end(), g_prop.data() + i * dim);
+        }
+
+        res.converged = res.err <= tol || k + 1u == n_slices;
+
+        get_logger()->debug("parareal iteration {} - max correction: {}", k, res.err);
+    }
+
+    return res;
+}
+
+} // namespace
+
+#define HEYOKA_PARAREAL_IMPL(T)                                                                                        \
+    parareal_res<T> parareal_propagate_until_impl(const taylor_adaptive<T> &fine, const taylor_adaptive<T> &coarse,    \
+                                                  T t, std::uint32_t n_slices, unsigned n_threads,                     \
+                                                  std::uint32_t max_iter, std::size_t max_steps, T tol)                \
+    {                                                                                                                  \
+        return parareal_propagate_until_generic(fine, coarse, t, n_slices, n_threads, max_iter, max_steps, tol);       \
+    }
+
+HEYOKA_PARAREAL_IMPL(double)
+HEYOKA_PARAREAL_IMPL(long double)
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+HEYOKA_PARAREAL_IMPL(mppp::real128)
+
+#endif
+
+#undef HEYOKA_PARAREAL_IMPL
+
+} // namespace heyoka::detail
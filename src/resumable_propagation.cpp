@@ -0,0 +1,343 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/dfloat.hpp>
+#include <heyoka/resumable_propagation.hpp>
+#include <heyoka/taylor.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to establish if the outcome of a step terminates the
+// propagation, that is, if something went wrong in the propagation
+// of the timestep or a stopping terminal event triggered.
+bool rp_is_stop_outcome(taylor_outcome oc)
+{
+    return oc != taylor_outcome::success && oc != taylor_outcome::time_limit && oc < taylor_outcome{0};
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+resumable_propagation<T>::resumable_propagation(private_ctor_t, taylor_adaptive<T> &ta, std::vector<T> grid,
+                                                bool grid_mode, T max_delta_t, bool wtc)
+    : m_ta(&ta), m_grid(std::move(grid)), m_grid_mode(grid_mode), m_max_delta_t(max_delta_t), m_wtc(wtc)
+{
+    using std::isfinite;
+    using std::isnan;
+
+    if (!isfinite(ta.m_time)) {
+        throw std::invalid_argument(
+            "Cannot create a resumable propagation for an adaptive Taylor integrator if the current time is not "
+            "finite");
+    }
+
+    if (isnan(m_max_delta_t)) {
+        throw std::invalid_argument("A nan max_delta_t was passed to the constructor of a resumable propagation");
+    }
+    if (m_max_delta_t <= 0) {
+        throw std::invalid_argument(
+            "A non-positive max_delta_t was passed to the constructor of a resumable propagation");
+    }
+
+    // Check the time grid.
+    // NOTE: in the propagation up to a final
+    // time, the grid contains only the final time.
+    if (m_grid.empty()) {
+        throw std::invalid_argument("Cannot create a resumable propagation with an empty time grid");
+    }
+    for (decltype(m_grid.size()) i = 0; i < m_grid.size(); ++i) {
+        if (!isfinite(m_grid[i])) {
+            throw std::invalid_argument("A non-finite time value was passed to the constructor of a resumable "
+                                        "propagation");
+        }
+
+        if (i > 1u && (m_grid[i] > m_grid[i - 1u]) != (m_grid[1] > m_grid[0])) {
+            throw std::invalid_argument("A non-monotonic time grid was passed to the constructor of a resumable "
+                                        "propagation");
+        }
+    }
+    if (m_grid.size() > 1u && m_grid[1] == m_grid[0]) {
+        throw std::invalid_argument("A non-monotonic time grid was passed to the constructor of a resumable "
+                                    "propagation");
+    }
+
+    // Check the remaining time for the first and last grid points.
+    if (!isfinite(m_grid.front() - ta.m_time) || !isfinite(m_grid.back() - ta.m_time)) {
+        throw std::invalid_argument("The final time passed to the constructor of a resumable propagation results in "
+                                    "an overflow condition");
+    }
+
+    if (m_grid_mode) {
+        m_output.reserve(m_grid.size() * ta.get_dim());
+    }
+}
+
+template <typename T>
+resumable_propagation<T>::resumable_propagation(const resumable_propagation &) = default;
+
+template <typename T>
+resumable_propagation<T>::resumable_propagation(resumable_propagation &&) noexcept = default;
+
+template <typename T>
+resumable_propagation<T> &resumable_propagation<T>::operator=(const resumable_propagation &) = default;
+
+template <typename T>
+resumable_propagation<T> &resumable_propagation<T>::operator=(resumable_propagation &&) noexcept = default;
+
+template <typename T>
+resumable_propagation<T>::~resumable_propagation() = default;
+
+template <typename T>
+void resumable_propagation<T>::finish(taylor_outcome oc)
+{
+    m_outcome = oc;
+    m_done = true;
+}
+
+// Take a step towards the final time, given the
+// remaining time rem_time, and update the counters.
+// NOTE: this mirrors the body of the loop in propagate_until().
+template <typename T>
+std::tuple<taylor_outcome, T> resumable_propagation<T>::take_step(const detail::dfloat<T> &rem_time, bool wtc)
+{
+    using std::abs;
+
+    const auto t_dir = (rem_time >= T(0));
+    const auto dt_limit = t_dir ? std::min(detail::dfloat<T>(m_max_delta_t), rem_time)
+                                : std::max(detail::dfloat<T>(-m_max_delta_t), rem_time);
+    const auto [res, h] = m_ta->step_impl(static_cast<T>(dt_limit), wtc);
+
+    if (detail::rp_is_stop_outcome(res)) {
+        return std::tuple{res, h};
+    }
+
+    m_step_counter += static_cast<std::size_t>(h != 0);
+
+    // NOTE: update min_h/max_h only if the step was not
+    // artificially clamped.
+    if (res == taylor_outcome::success) {
+        const auto abs_h = abs(h);
+        m_min_h = std::min(m_min_h, abs_h);
+        m_max_h = std::max(m_max_h, abs_h);
+    }
+
+    return std::tuple{res, h};
+}
+
+// Perform a step in the propagation up to a final time.
+// The return value is false if the propagation is over.
+template <typename T>
+bool resumable_propagation<T>::step_until()
+{
+    const auto rem_time = m_grid[0] - m_ta->m_time;
+
+    const auto [res, h] = take_step(rem_time, m_wtc);
+
+    if (detail::rp_is_stop_outcome(res)) {
+        finish(res);
+        return false;
+    }
+
+    if (h == static_cast<T>(rem_time)) {
+        assert(res == taylor_outcome::time_limit);
+        finish(taylor_outcome::time_limit);
+        return false;
+    }
+
+    return true;
+}
+
+// Perform a step in the propagation over a time grid.
+// The return value is false if the propagation is over.
+// NOTE: this mirrors the implementation of propagate_grid().
+template <typename T>
+bool resumable_propagation<T>::step_grid()
+{
+    auto &ta = *m_ta;
+
+    if (!m_grid_started) {
+        // Propagate up to the first grid point, without
+        // writing the Taylor coefficients (see propagate_grid()).
+        const auto rem_time = m_grid[0] - ta.m_time;
+
+        const auto [res, h] = take_step(rem_time, false);
+
+        if (detail::rp_is_stop_outcome(res)) {
+            finish(res);
+            return false;
+        }
+
+        if (h != static_cast<T>(rem_time)) {
+            return true;
+        }
+
+        // The first grid point was reached.
+        m_grid_started = true;
+        m_output.insert(m_output.end(), ta.m_state.begin(), ta.m_state.end());
+        m_grid_idx = 1;
+        m_rem_time = m_grid.back() - ta.m_time;
+
+        if (m_grid.size() == 1u) {
+            finish(taylor_outcome::time_limit);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Take the next step, writing the Taylor coefficients
+    // for the dense output.
+    const auto [res, h] = take_step(m_rem_time, true);
+
+    if (detail::rp_is_stop_outcome(res)) {
+        finish(res);
+        return false;
+    }
+
+    // Update the remaining time. A zero remaining time
+    // forces the processing of all the remaining grid points.
+    if (h == static_cast<T>(m_rem_time)) {
+        assert(res == taylor_outcome::time_limit);
+        m_rem_time = detail::dfloat<T>(T(0));
+    } else {
+        m_rem_time = m_grid.back() - ta.m_time;
+    }
+
+    // Compute the state of the system via dense output for as many grid
+    // points as possible within the range of validity of the last step.
+    const auto t0 = std::min(ta.m_time, ta.m_time - ta.m_last_h);
+    const auto t1 = std::max(ta.m_time, ta.m_time - ta.m_last_h);
+
+    for (; m_grid_idx < m_grid.size(); ++m_grid_idx) {
+        const auto cur_tt = m_grid[m_grid_idx];
+
+        if ((cur_tt >= t0 && cur_tt <= t1) || (m_rem_time == detail::dfloat<T>(T(0)))) {
+            const auto &d_out = ta.update_d_output(cur_tt);
+            m_output.insert(m_output.end(), d_out.begin(), d_out.end());
+        } else {
+            break;
+        }
+    }
+
+    if (m_grid_idx == m_grid.size()) {
+        finish(taylor_outcome::time_limit);
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+taylor_outcome resumable_propagation<T>::resume(std::size_t max_steps, std::chrono::nanoseconds budget)
+{
+    if (m_done) {
+        return m_outcome;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t n_steps = 0;;) {
+        if (!(m_grid_mode ? step_grid() : step_until())) {
+            return m_outcome;
+        }
+
+        // NOTE: if max_steps is zero, this never triggers.
+        if (++n_steps == max_steps) {
+            break;
+        }
+
+        // NOTE: read the clock only if a budget was provided.
+        if (budget.count() > 0 && std::chrono::steady_clock::now() - start >= budget) {
+            break;
+        }
+    }
+
+    m_outcome = taylor_outcome::step_limit;
+
+    return m_outcome;
+}
+
+template <typename T>
+bool resumable_propagation<T>::is_done() const
+{
+    return m_done;
+}
+
+template <typename T>
+taylor_outcome resumable_propagation<T>::get_outcome() const
+{
+    return m_outcome;
+}
+
+template <typename T>
+std::size_t resumable_propagation<T>::get_step_counter() const
+{
+    return m_step_counter;
+}
+
+template <typename T>
+T resumable_propagation<T>::get_min_h() const
+{
+    return m_min_h;
+}
+
+template <typename T>
+T resumable_propagation<T>::get_max_h() const
+{
+    return m_max_h;
+}
+
+template <typename T>
+std::size_t resumable_propagation<T>::get_grid_idx() const
+{
+    return m_grid_idx;
+}
+
+template <typename T>
+const std::vector<T> &resumable_propagation<T>::get_output() const
+{
+    return m_output;
+}
+
+template class resumable_propagation<double>;
+template class resumable_propagation<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class resumable_propagation<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,278 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <fmt/format.h>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/sundman.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+std::vector<std::pair<expression, expression>>
+sundman_transform(const std::vector<std::pair<expression, expression>> &sys, const expression &g,
+                  const std::string &t_name)
+{
+    if (sys.empty()) {
+        throw std::invalid_argument("Cannot apply the Sundman transformation to an empty ODE system");
+    }
+
+    if (has_time(g)) {
+        throw std::invalid_argument("The time transformation function of a Sundman transformation cannot depend on "
+                                    "the physical time");
+    }
+
+    std::vector<std::string> sv_names;
+    for (const auto &[lhs, rhs] : sys) {
+        if (!std::holds_alternative<variable>(lhs.value())) {
+            throw std::invalid_argument("Invalid ODE system passed to the Sundman transformation: the left-hand side "
+                                        "of an equation must be a variable");
+        }
+
+        if (has_time(rhs)) {
+            throw std::invalid_argument(
+                "The Sundman transformation can be applied only to autonomous ODE systems, but the equation for the "
+                "state variable '{}' depends on time"_format(std::get<variable>(lhs.value()).name()));
+        }
+
+        sv_names.push_back(std::get<variable>(lhs.value()).name());
+    }
+
+    if (std::find(sv_names.begin(), sv_names.end(), t_name) != sv_names.end()) {
+        throw std::invalid_argument("The name '{}' of the physical time variable in a Sundman transformation "
+                                    "conflicts with the name of a state variable"_format(t_name));
+    }
+
+    for (const auto &name : get_variables(g)) {
+        if (std::find(sv_names.begin(), sv_names.end(), name) == sv_names.end()) {
+            throw std::invalid_argument("The time transformation function of a Sundman transformation can depend "
+                                        "only on the state variables, but the variable '{}' was detected"_format(name));
+        }
+    }
+
+    std::vector<std::pair<expression, expression>> retval;
+    for (const auto &[lhs, rhs] : sys) {
+        retval.emplace_back(lhs, g * rhs);
+    }
+    retval.emplace_back(expression{variable{t_name}}, g);
+
+    return retval;
+}
+
+expression make_nbody_sundman_g(std::uint32_t n, const std::vector<std::pair<std::uint32_t, std::uint32_t>> &pairs,
+                                double alpha)
+{
+    using std::isfinite;
+
+    if (n < 2u) {
+        throw std::invalid_argument("At least 2 bodies are needed to construct the Sundman time transformation "
+                                    "function of an N-body system");
+    }
+
+    if (!isfinite(alpha) || alpha <= 0) {
+        throw std::invalid_argument("The exponent of the Sundman time transformation function of an N-body system "
+                                    "must be finite and positive, but it is {} instead"_format(alpha));
+    }
+
+    // The term 1 / r_ij**alpha.
+    auto make_term = [alpha](std::uint32_t i, std::uint32_t j) {
+        auto diff_x = expression{variable{"x_{}"_format(j)}} - expression{variable{"x_{}"_format(i)}};
+        auto diff_y = expression{variable{"y_{}"_format(j)}} - expression{variable{"y_{}"_format(i)}};
+        auto diff_z = expression{variable{"z_{}"_format(j)}} - expression{variable{"z_{}"_format(i)}};
+
+        return pow(sum({square(std::move(diff_x)), square(std::move(diff_y)), square(std::move(diff_z))}),
+                   -alpha / 2);
+    };
+
+    std::vector<expression> terms;
+
+    if (pairs.empty()) {
+        for (std::uint32_t i = 0; i < n; ++i) {
+            for (auto j = i + 1u; j < n; ++j) {
+                terms.push_back(make_term(i, j));
+            }
+        }
+    } else {
+        for (const auto &[i, j] : pairs) {
+            if (i >= n || j >= n || i == j) {
+                throw std::invalid_argument("Invalid pair of bodies ({}, {}) passed to the construction of the "
+                                            "Sundman time transformation function of an N-body system with {} "
+                                            "bodies"_format(i, j, n));
+            }
+
+            terms.push_back(make_term(i, j));
+        }
+    }
+
+    return pow(sum(std::move(terms)), -1.);
+}
+
+template <typename T>
+std::tuple<taylor_outcome, std::size_t> sundman_propagate_until(taylor_adaptive<T> &ta, T t, std::size_t max_steps)
+{
+    using std::abs;
+    using std::isfinite;
+
+    if (!isfinite(t)) {
+        throw std::invalid_argument("A non-finite physical time was passed to sundman_propagate_until()");
+    }
+
+    // NOTE: the physical time is the last state variable.
+    const auto t_idx = ta.get_dim() - 1u;
+    const auto op1 = ta.get_order() + 1u;
+
+    auto cur_t = ta.get_state()[t_idx];
+    if (!isfinite(cur_t)) {
+        throw std::invalid_argument("Cannot invoke sundman_propagate_until() if the current physical time is not "
+                                    "finite");
+    }
+
+    if (cur_t == t) {
+        return std::tuple{taylor_outcome::time_limit, std::size_t(0)};
+    }
+
+    // NOTE: the physical time is monotonic in the fictitious time
+    // (because g is positive), thus the direction of the propagation
+    // is known in advance.
+    const auto fwd = t > cur_t;
+
+    std::size_t n_steps = 0;
+    while (true) {
+        if (max_steps != 0u && n_steps == max_steps) {
+            return std::tuple{taylor_outcome::step_limit, n_steps};
+        }
+
+        const auto [oc, h] = fwd ? ta.step(true) : ta.step_backward(true);
+        ++n_steps;
+
+        if (oc != taylor_outcome::success && oc != taylor_outcome::time_limit && oc < taylor_outcome{0}) {
+            // Non-finite state or stopping terminal event.
+            return std::tuple{oc, n_steps};
+        }
+
+        const auto new_t = ta.get_state()[t_idx];
+
+        if (fwd ? new_t < t : new_t > t) {
+            continue;
+        }
+
+        // The physical time t was crossed in the last timestep: solve p(x) = t via
+        // safeguarded Newton iterations, where p is the Taylor polynomial of the
+        // physical time and x is the fictitious time relative to the beginning
+        // of the timestep.
+        const auto *tc = ta.get_tc().data() + static_cast<std::size_t>(t_idx) * op1;
+
+        auto eval = [tc, op1](T x) {
+            T val = tc[op1 - 1u], der(0);
+            for (auto o = op1 - 1u; o > 0u; --o) {
+                der = der * x + val;
+                val = val * x + tc[o - 1u];
+            }
+
+            return std::pair{val, der};
+        };
+
+        // NOTE: p(lo) <= t <= p(hi) if fwd, with the reverse
+        // inequalities otherwise.
+        T lo(0), hi(h);
+        // Initial guess via linear interpolation.
+        auto x = new_t == tc[0] ? h : h * ((t - tc[0]) / (new_t - tc[0]));
+        for (auto it = 0; it < 100; ++it) {
+            const auto [val, der] = eval(x);
+            const auto f = val - t;
+
+            if (f == 0) {
+                break;
+            }
+
+            if ((f < 0) == fwd) {
+                lo = x;
+            } else {
+                hi = x;
+            }
+
+            auto new_x = x - f / der;
+            // NOTE: fall back to bisection if the Newton
+            // iteration leaves the bracket.
+            if (!isfinite(new_x) || new_x <= std::min(lo, hi) || new_x >= std::max(lo, hi)) {
+                new_x = lo + (hi - lo) / 2;
+            }
+
+            const auto done = abs(new_x - x) <= std::numeric_limits<T>::epsilon() * abs(h);
+            x = new_x;
+
+            if (done) {
+                break;
+            }
+        }
+
+        // Set the state and the time of the integrator
+        // to the values at the physical time t.
+        const auto &d_out = ta.update_d_output(x - h, true);
+        std::copy(d_out.begin(), d_out.end(), ta.get_state_data());
+        // NOTE: set the physical time exactly.
+        ta.get_state_data()[t_idx] = t;
+        ta.set_time(ta.get_time() - (h - x));
+
+        return std::tuple{taylor_outcome::time_limit, n_steps};
+    }
+}
+
+// Explicit instantiations.
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, std::size_t> sundman_propagate_until(taylor_adaptive<double> &,
+                                                                                          double, std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, std::size_t>
+sundman_propagate_until(taylor_adaptive<long double> &, long double, std::size_t);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, std::size_t>
+sundman_propagate_until(taylor_adaptive<mppp::real128> &, mppp::real128, std::size_t);
+
+#endif
+
+} // namespace heyoka
@@ -10,18 +10,33 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <functional>
+#include <future>
+#include <ios>
+#include <istream>
+#include <iterator>
 #include <limits>
 #include <locale>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <ostream>
+#include <random>
 #include <set>
+#include <shared_mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -40,6 +55,7 @@
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <llvm/Config/llvm-config.h>
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constant.h>
@@ -48,10 +64,21 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
+#include <llvm/Support/Alignment.h>
 #include <llvm/Support/Casting.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#if defined(HEYOKA_WITH_NVPTX)
+
+#include <llvm/IR/IntrinsicsNVPTX.h>
+
+#endif
 
 #if defined(HEYOKA_HAVE_REAL128)
 
@@ -59,16 +86,27 @@
 
 #endif
 
+#include <heyoka/cfunc.hpp>
+#include <heyoka/detail/aligned_buffer.hpp>
+#include <heyoka/detail/ephemeris.hpp>
 #include <heyoka/detail/event_detection.hpp>
 #include <heyoka/detail/llvm_fwd.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/logging_impl.hpp>
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/detail/s11n.hpp>
 #include <heyoka/detail/sleef.hpp>
 #include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/taylor_c_diff_lib.hpp>
+#include <heyoka/detail/tracing.hpp>
 #include <heyoka/detail/type_traits.hpp>
 #include <heyoka/detail/visibility.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
+#include <heyoka/math/binary_op.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/tpwpoly.hpp>
 #include <heyoka/number.hpp>
 #include <heyoka/param.hpp>
 #include <heyoka/taylor.hpp>
@@ -447,723 +485,1519 @@ void taylor_add_d_out_function(llvm_state &s, std::uint32_t n_eq, std::uint32_t
     s.optimise();
 }
 
-// Simplify a Taylor decomposition by removing
-// common subexpressions.
-// NOTE: the hidden deps are not considered for CSE
-// purposes, only the actual subexpressions.
-taylor_dc_t taylor_decompose_cse(taylor_dc_t &v_ex, std::vector<std::uint32_t> &sv_funcs_dc,
-                                 taylor_dc_t::size_type n_eq)
+// Add a function for computing the dense output of a scalar integrator
+// at batch_size different time coordinates at once. The function
+// has the same signature as the function created by taylor_add_d_out_function(),
+// but the Taylor coefficients are read in scalar layout (i.e., they are shared
+// by all the time coordinates), h_ptr points to batch_size timesteps and the
+// results are written into out_ptr in row-major order, with shape (batch_size, n_eq).
+template <typename T>
+void taylor_add_d_out_multi_function(llvm_state &s, std::uint32_t n_eq, std::uint32_t order, std::uint32_t batch_size,
+                                     bool high_accuracy)
 {
-    using idx_t = taylor_dc_t::size_type;
-
-    // A Taylor decomposition is supposed
-    // to have n_eq variables at the beginning,
-    // n_eq variables at the end and possibly
-    // extra variables in the middle.
-    assert(v_ex.size() >= n_eq * 2u);
-
-    // Init the return value.
-    taylor_dc_t retval;
-
-    // expression -> idx map. This will end up containing
-    // all the unique expressions from v_ex, and it will
-    // map them to their indices in retval (which will
-    // in general differ from their indices in v_ex).
-    std::unordered_map<expression, idx_t> ex_map;
-
-    // Map for the renaming of u variables
-    // in the expressions.
-    std::unordered_map<std::string, std::string> uvars_rename;
+    assert(n_eq > 0u);
+    assert(order > 0u);
+    assert(batch_size > 1u);
 
-    // The first n_eq definitions are just renaming
-    // of the state variables into u variables.
-    for (idx_t i = 0; i < n_eq; ++i) {
-        assert(std::holds_alternative<variable>(v_ex[i].first.value()));
-        // NOTE: no hidden deps allowed here.
-        assert(v_ex[i].second.empty());
-        retval.push_back(std::move(v_ex[i]));
+    auto &builder = s.builder();
+    auto &context = s.context();
 
-        // NOTE: the u vars that correspond to state
-        // variables are never simplified,
-        // thus map them onto themselves.
-        [[maybe_unused]] const auto res = uvars_rename.emplace("u_{}"_format(i), "u_{}"_format(i));
-        assert(res.second);
+    // The function arguments:
+    // - the output pointer (write-only),
+    // - the pointer to the Taylor coefficients (read-only),
+    // - the pointer to the h values (read-only).
+    // No overlap is allowed.
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "d_out_multi_f", &s.module());
+    // LCOV_EXCL_START
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for the multi-point dense output in an adaptive Taylor integrator");
     }
+    // LCOV_EXCL_STOP
 
-    // Handle the u variables which do not correspond to state variables.
-    for (auto i = n_eq; i < v_ex.size() - n_eq; ++i) {
-        auto &[ex, deps] = v_ex[i];
+    // Set the names/attributes of the function arguments.
+    auto *out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
 
-        // Rename the u variables in ex.
-        rename_variables(ex, uvars_rename);
+    auto *tc_ptr = f->args().begin() + 1;
+    tc_ptr->setName("tc_ptr");
+    tc_ptr->addAttr(llvm::Attribute::NoCapture);
+    tc_ptr->addAttr(llvm::Attribute::NoAlias);
+    tc_ptr->addAttr(llvm::Attribute::ReadOnly);
 
-        if (auto it = ex_map.find(ex); it == ex_map.end()) {
-            // This is the first occurrence of ex in the
-            // decomposition. Add it to retval.
-            retval.emplace_back(ex, std::move(deps));
+    auto *h_ptr = f->args().begin() + 2;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
+    h_ptr->addAttr(llvm::Attribute::ReadOnly);
 
-            // Add ex to ex_map, mapping it to
-            // the index it corresponds to in retval
-            // (let's call it j).
-            ex_map.emplace(std::move(ex), retval.size() - 1u);
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
 
-            // Update uvars_rename. This will ensure that
-            // occurrences of the variable 'u_i' in the next
-            // elements of v_ex will be renamed to 'u_j'.
-            [[maybe_unused]] const auto res = uvars_rename.emplace("u_{}"_format(i), "u_{}"_format(retval.size() - 1u));
-            assert(res.second);
-        } else {
-            // ex is redundant. This means
-            // that it already appears in retval at index
-            // it->second. Don't add anything to retval,
-            // and remap the variable name 'u_i' to
-            // 'u_{it->second}'.
-            [[maybe_unused]] const auto res = uvars_rename.emplace("u_{}"_format(i), "u_{}"_format(it->second));
-            assert(res.second);
-        }
-    }
+    // Load the values of h.
+    auto *h = load_vector_from_memory(builder, h_ptr, batch_size);
 
-    // Handle the derivatives of the state variables at the
-    // end of the decomposition. We just need to ensure that
-    // the u variables in their definitions are renamed with
-    // the new indices.
-    for (auto i = v_ex.size() - n_eq; i < v_ex.size(); ++i) {
-        auto &[ex, deps] = v_ex[i];
+    // Helper to load the scalar Taylor coefficient of order cur_order
+    // for the variable cur_var_idx, and to splat it into a vector.
+    // The index is: (order + 1u) * cur_var_idx + cur_order.
+    auto load_tc = [&](llvm::Value *cur_var_idx, llvm::Value *cur_order) {
+        auto *tc_idx = builder.CreateAdd(builder.CreateMul(builder.getInt32(order + 1u), cur_var_idx), cur_order);
 
-        // NOTE: here we expect only vars, numbers or params,
-        // and no hidden dependencies.
-        assert(std::holds_alternative<variable>(ex.value()) || std::holds_alternative<number>(ex.value())
-               || std::holds_alternative<param>(ex.value()));
-        assert(deps.empty());
+        return vector_splat(builder, builder.CreateLoad(builder.CreateInBoundsGEP(tc_ptr, {tc_idx})), batch_size);
+    };
 
-        rename_variables(ex, uvars_rename);
+    // The results are accumulated into a local array of vectors,
+    // and they are transposed into out_ptr at the end.
+    auto *vec_t = make_vector_type(to_llvm_type<T>(context), batch_size);
+    auto *res_arr = builder.CreateInBoundsGEP(builder.CreateAlloca(llvm::ArrayType::get(vec_t, n_eq)),
+                                              {builder.getInt32(0), builder.getInt32(0)});
 
-        retval.emplace_back(std::move(ex), std::move(deps));
-    }
+    if (high_accuracy) {
+        // Create the array for storing the running compensations.
+        auto *comp_arr = builder.CreateInBoundsGEP(builder.CreateAlloca(llvm::ArrayType::get(vec_t, n_eq)),
+                                                   {builder.getInt32(0), builder.getInt32(0)});
 
-    // Re-adjust all indices in the hidden dependencies in order to account
-    // for the renaming of the uvars.
-    for (auto &[_, deps] : retval) {
-        for (auto &idx : deps) {
-            auto it = uvars_rename.find("u_{}"_format(idx));
-            assert(it != uvars_rename.end());
-            idx = uname_to_index(it->second);
-        }
-    }
+        // Start by writing into res_arr the zero-order coefficients
+        // and by filling with zeroes the running compensations.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            builder.CreateStore(load_tc(cur_var_idx, builder.getInt32(0)),
+                                builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+            builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size),
+                                builder.CreateInBoundsGEP(comp_arr, {cur_var_idx}));
+        });
 
-    // Same for the indices in sv_funcs_dc.
-    for (auto &idx : sv_funcs_dc) {
-        auto it = uvars_rename.find("u_{}"_format(idx));
-        assert(it != uvars_rename.end());
-        idx = uname_to_index(it->second);
-    }
+        // Init the running updater for the powers of h.
+        auto *cur_h = builder.CreateAlloca(h->getType());
+        builder.CreateStore(h, cur_h);
 
-    return retval;
-}
+        // Run the evaluation.
+        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+            // Load the current power of h.
+            auto *cur_h_val = builder.CreateLoad(cur_h);
 
-// Perform a topological sort on a graph representation
-// of the Taylor decomposition. This can improve performance
-// by grouping together operations that can be performed in parallel,
-// and it also makes compact mode much more effective by creating
-// clusters of subexpressions whose derivatives can be computed in
-// parallel.
-// NOTE: the original decomposition dc is already topologically sorted,
-// in the sense that the definitions of the u variables are already
-// ordered according to dependency. However, because the original decomposition
-// comes from a depth-first search, it has the tendency to group together
-// expressions which are dependent on each other. By doing another topological
-// sort, this time based on breadth-first search, we determine another valid
-// sorting in which independent operations tend to be clustered together.
-auto taylor_sort_dc(taylor_dc_t &dc, std::vector<std::uint32_t> &sv_funcs_dc, taylor_dc_t::size_type n_eq)
-{
-    // A Taylor decomposition is supposed
-    // to have n_eq variables at the beginning,
-    // n_eq variables at the end and possibly
-    // extra variables in the middle
-    assert(dc.size() >= n_eq * 2u);
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                auto *tmp = builder.CreateFMul(load_tc(cur_var_idx, cur_order), cur_h_val);
 
-    // The graph type that we will use for the topological sorting.
-    using graph_t = boost::adjacency_list<boost::vecS,           // std::vector for list of adjacent vertices
-                                          boost::vecS,           // std::vector for the list of vertices
-                                          boost::bidirectionalS, // directed graph with efficient access
-                                                                 // to in-edges
-                                          boost::no_property,    // no vertex properties
-                                          boost::no_property,    // no edge properties
-                                          boost::no_property,    // no graph properties
-                                          boost::listS           // std::list for of the graph's edge list
-                                          >;
+                // Compute the quantities for the compensation.
+                auto *comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
+                auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+                auto *y = builder.CreateFSub(tmp, builder.CreateLoad(comp_ptr));
+                auto *cur_res = builder.CreateLoad(res_ptr);
+                auto *t = builder.CreateFAdd(cur_res, y);
 
-    graph_t g;
+                // Update the compensation and the return value.
+                builder.CreateStore(builder.CreateFSub(builder.CreateFSub(t, cur_res), y), comp_ptr);
+                builder.CreateStore(t, res_ptr);
+            });
 
-    // Add the root node.
-    const auto root_v = boost::add_vertex(g);
+            // Update the value of h.
+            builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
+        });
+    } else {
+        // Start by writing into res_arr the coefficients of the highest-degree
+        // monomial in each polynomial.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            builder.CreateStore(load_tc(cur_var_idx, builder.getInt32(order)),
+                                builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+        });
 
-    // Add the nodes corresponding to the state variables.
-    for (decltype(n_eq) i = 0; i < n_eq; ++i) {
-        auto v = boost::add_vertex(g);
+        // Now let's run the Horner scheme.
+        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                // NOTE: we are loading the coefficients backwards wrt the order, hence
+                // we specify order - cur_order.
+                auto *tc = load_tc(cur_var_idx, builder.CreateSub(builder.getInt32(order), cur_order));
 
-        // Add a dependency on the root node.
-        boost::add_edge(root_v, v, g);
+                auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+                builder.CreateStore(builder.CreateFAdd(tc, builder.CreateFMul(builder.CreateLoad(res_ptr), h)),
+                                    res_ptr);
+            });
+        });
     }
 
-    // Add the rest of the u variables.
-    for (decltype(n_eq) i = n_eq; i < dc.size() - n_eq; ++i) {
-        auto v = boost::add_vertex(g);
-
-        // Fetch the list of variables in the current expression.
-        const auto vars = get_variables(dc[i].first);
-
-        if (vars.empty()) {
-            // The current expression does not contain
-            // any variable: make it depend on the root
-            // node. This means that in the topological
-            // sort below, the current u var will appear
-            // immediately after the state variables.
-            boost::add_edge(root_v, v, g);
-        } else {
-            // Mark the current u variable as depending on all the
-            // variables in the current expression.
-            for (const auto &var : vars) {
-                // Extract the index.
-                const auto idx = uname_to_index(var);
+    // Transpose the results into out_ptr. The index of the result
+    // for the variable cur_var_idx at the time coordinate i is:
+    // n_eq * i + cur_var_idx.
+    // NOTE: no need to perform overflow checks on n_eq * batch_size,
+    // as it has already been checked by the caller.
+    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+        auto *res = builder.CreateLoad(builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
 
-                // Add the dependency.
-                // NOTE: add +1 because the i-th vertex
-                // corresponds to the (i-1)-th u variable
-                // due to the presence of the root node.
-                boost::add_edge(boost::vertex(idx + 1u, g), v, g);
-            }
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            auto *out_idx = builder.CreateAdd(builder.getInt32(n_eq * i), cur_var_idx);
+            builder.CreateStore(builder.CreateExtractElement(res, i), builder.CreateInBoundsGEP(out_ptr, {out_idx}));
         }
-    }
-
-    assert(boost::num_vertices(g) - 1u == dc.size() - n_eq);
-
-    // Run the BF topological sort on the graph. This is Kahn's algorithm:
-    // https://en.wikipedia.org/wiki/Topological_sorting
-
-    // The result of the sort.
-    std::vector<decltype(dc.size())> v_idx;
-
-    // Temp variable used to sort a list of edges in the loop below.
-    std::vector<boost::graph_traits<graph_t>::edge_descriptor> tmp_edges;
-
-    // The set of all nodes with no incoming edge.
-    std::deque<decltype(dc.size())> tmp;
-    // The root node has no incoming edge.
-    tmp.push_back(0);
+    });
 
-    // Main loop.
-    while (!tmp.empty()) {
-        // Pop the first element from tmp
-        // and append it to the result.
-        const auto v = tmp.front();
-        tmp.pop_front();
-        v_idx.push_back(v);
+    // Create the return value.
+    builder.CreateRetVoid();
 
-        // Fetch all the out edges of v and sort them according
-        // to the target vertex.
-        // NOTE: the sorting is important to ensure that all the state
-        // variables are insered into v_idx in the correct order.
-        const auto e_range = boost::out_edges(v, g);
-        tmp_edges.assign(e_range.first, e_range.second);
-        std::sort(tmp_edges.begin(), tmp_edges.end(),
-                  [&g](const auto &e1, const auto &e2) { return boost::target(e1, g) < boost::target(e2, g); });
+    // Verify the function.
+    s.verify_function(f);
 
-        // For each out edge of v:
-        // - eliminate it;
-        // - check if the target vertex of the edge
-        //   has other incoming edges;
-        // - if it does not, insert it into tmp.
-        for (auto &e : tmp_edges) {
-            // Fetch the target of the edge.
-            const auto t = boost::target(e, g);
+    // Run the optimisation pass.
+    s.optimise();
+}
 
-            // Remove the edge.
-            boost::remove_edge(e, g);
+// Add a function for computing an enclosure of the values of
+// the polynomials with coefficients in tc_ptr over the timestep,
+// i.e., for the time coordinate in [0, h] (or [h, 0] for h < 0).
+// Because tau**o is always between 0 and h**o over the timestep,
+// each term c_o * tau**o is between 0 and c_o * h**o, and thus the value
+// of the polynomial is within:
+// [c_0 + sum_{o >= 1} min(0, c_o * h**o), c_0 + sum_{o >= 1} max(0, c_o * h**o)].
+// The lower and upper bounds are written into out_ptr (first all the lower
+// bounds, then all the upper bounds), and they are enlarged in order to account
+// for the rounding errors in their computation.
+// NOTE: the enclosure is rigorous for the Taylor polynomials, it does not
+// account for the truncation error of the Taylor method.
+template <typename T>
+void taylor_add_tc_enc_function(llvm_state &s, std::uint32_t n_eq, std::uint32_t order, std::uint32_t batch_size)
+{
+    assert(n_eq > 0u);
+    assert(order > 0u);
+    assert(batch_size > 0u);
 
-            // Get the range of vertices connecting to t.
-            const auto iav = boost::inv_adjacent_vertices(t, g);
+    auto &builder = s.builder();
+    auto &context = s.context();
 
-            if (iav.first == iav.second) {
-                // t does not have any incoming edges, add it to tmp.
-                tmp.push_back(t);
-            }
-        }
-    }
+    // The function arguments:
+    // - the output pointer (write-only),
+    // - the pointer to the Taylor coefficients (read-only),
+    // - the pointer to the h values (read-only).
+    // No overlap is allowed.
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "tc_enc_f", &s.module());
+    // LCOV_EXCL_START
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for the enclosure of the state in an adaptive Taylor integrator");
+    }
+    // LCOV_EXCL_STOP
 
-    assert(v_idx.size() == boost::num_vertices(g));
-    assert(boost::num_edges(g) == 0u);
+    // Set the names/attributes of the function arguments.
+    auto *out_ptr = f->args().begin();
+    out_ptr->setName("out_ptr");
+    out_ptr->addAttr(llvm::Attribute::NoCapture);
+    out_ptr->addAttr(llvm::Attribute::NoAlias);
+    out_ptr->addAttr(llvm::Attribute::WriteOnly);
 
-    // Adjust v_idx: remove the index of the root node,
-    // decrease by one all other indices, insert the final
-    // n_eq indices.
-    for (decltype(v_idx.size()) i = 0; i < v_idx.size() - 1u; ++i) {
-        v_idx[i] = v_idx[i + 1u] - 1u;
-    }
-    v_idx.resize(boost::numeric_cast<decltype(v_idx.size())>(dc.size()));
-    std::iota(v_idx.data() + dc.size() - n_eq, v_idx.data() + dc.size(), dc.size() - n_eq);
+    auto *tc_ptr = f->args().begin() + 1;
+    tc_ptr->setName("tc_ptr");
+    tc_ptr->addAttr(llvm::Attribute::NoCapture);
+    tc_ptr->addAttr(llvm::Attribute::NoAlias);
+    tc_ptr->addAttr(llvm::Attribute::ReadOnly);
 
-    // Create the remapping dictionary.
-    std::unordered_map<std::string, std::string> remap;
-    // NOTE: the u vars that correspond to state
-    // variables were inserted into v_idx in the original
-    // order, thus they are not re-sorted and they do not
-    // need renaming.
-    for (decltype(v_idx.size()) i = 0; i < n_eq; ++i) {
-        [[maybe_unused]] const auto res = remap.emplace("u_{}"_format(i), "u_{}"_format(i));
-        assert(res.second);
-    }
-    // Establish the remapping for the u variables that are not
-    // state variables.
-    for (decltype(v_idx.size()) i = n_eq; i < v_idx.size() - n_eq; ++i) {
-        [[maybe_unused]] const auto res = remap.emplace("u_{}"_format(v_idx[i]), "u_{}"_format(i));
-        assert(res.second);
-    }
+    auto *h_ptr = f->args().begin() + 2;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
+    h_ptr->addAttr(llvm::Attribute::ReadOnly);
 
-    // Do the remap for the definitions of the u variables, the
-    // derivatives and the hidden deps.
-    for (auto *it = dc.data() + n_eq; it != dc.data() + dc.size(); ++it) {
-        // Remap the expression.
-        rename_variables(it->first, remap);
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
 
-        // Remap the hidden dependencies.
-        for (auto &idx : it->second) {
-            auto it_remap = remap.find("u_{}"_format(idx));
-            assert(it_remap != remap.end());
-            idx = uname_to_index(it_remap->second);
-        }
-    }
+    // Load the value of h.
+    auto *h = load_vector_from_memory(builder, h_ptr, batch_size);
 
-    // Do the remap for sv_funcs.
-    for (auto &idx : sv_funcs_dc) {
-        auto it_remap = remap.find("u_{}"_format(idx));
-        assert(it_remap != remap.end());
-        idx = uname_to_index(it_remap->second);
-    }
+    // The accumulators for the lower and upper bounds, for the sum
+    // of the absolute values of the terms and for the powers of h.
+    auto *vec_t = h->getType();
+    auto *lo = builder.CreateAlloca(vec_t);
+    auto *hi = builder.CreateAlloca(vec_t);
+    auto *abs_sum = builder.CreateAlloca(vec_t);
+    auto *cur_h = builder.CreateAlloca(vec_t);
 
-    // Reorder the decomposition.
-    taylor_dc_t retval;
-    retval.reserve(v_idx.size());
-    for (auto idx : v_idx) {
-        retval.push_back(std::move(dc[idx]));
-    }
+    auto *zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
 
-    return retval;
-}
+    // The relative enlargement of the bounds.
+    // NOTE: each bound is computed with order additions,
+    // each of which contributes at most one rounding error
+    // relative to the sum of the absolute values of the terms.
+    auto *rel_enl = vector_splat(
+        builder, codegen<T>(s, number{T(2) * T(order + 1u) * std::numeric_limits<T>::epsilon()}), batch_size);
 
-#if !defined(NDEBUG)
+    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+        // Helper to load the Taylor coefficient of order cur_order. The index is:
+        // batch_size * (order + 1u) * cur_var_idx + batch_size * cur_order.
+        auto load_tc = [&](llvm::Value *cur_order) -> llvm::Value * {
+            auto *tc_idx
+                = builder.CreateAdd(builder.CreateMul(builder.getInt32(batch_size * (order + 1u)), cur_var_idx),
+                                    builder.CreateMul(builder.getInt32(batch_size), cur_order));
 
-// Helper to verify a Taylor decomposition.
-void verify_taylor_dec(const std::vector<expression> &orig, const taylor_dc_t &dc)
-{
-    using idx_t = taylor_dc_t::size_type;
+            return load_vector_from_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {tc_idx}), batch_size);
+        };
 
-    const auto n_eq = orig.size();
+        auto *c0 = load_tc(builder.getInt32(0));
+        builder.CreateStore(c0, lo);
+        builder.CreateStore(c0, hi);
+        builder.CreateStore(llvm_abs(s, c0), abs_sum);
+        builder.CreateStore(h, cur_h);
 
-    assert(dc.size() >= n_eq * 2u);
+        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+            auto *cur_h_val = builder.CreateLoad(cur_h);
+            auto *tmp = builder.CreateFMul(load_tc(cur_order), cur_h_val);
 
-    // The first n_eq expressions of u variables
-    // must be just variables. No hidden dependencies
-    // are allowed.
-    for (idx_t i = 0; i < n_eq; ++i) {
-        assert(std::holds_alternative<variable>(dc[i].first.value()));
-        assert(dc[i].second.empty());
-    }
+            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(lo), llvm_min(s, tmp, zero)), lo);
+            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(hi), llvm_max(s, tmp, zero)), hi);
+            builder.CreateStore(builder.CreateFAdd(builder.CreateLoad(abs_sum), llvm_abs(s, tmp)), abs_sum);
 
-    // From n_eq to dc.size() - n_eq, the expressions
-    // must be functions whose arguments
-    // are either variables in the u_n form,
-    // where n < i, or numbers/params.
-    // The hidden dependencies must contain indices
-    // only in the [n_eq, dc.size() - n_eq) range.
-    for (auto i = n_eq; i < dc.size() - n_eq; ++i) {
-        std::visit(
-            [i](const auto &v) {
-                using type = detail::uncvref_t<decltype(v)>;
+            builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
+        });
 
-                if constexpr (std::is_same_v<type, func>) {
-                    auto check_arg = [i](const auto &arg) {
-                        if (auto p_var = std::get_if<variable>(&arg.value())) {
-                            assert(p_var->name().rfind("u_", 0) == 0);
-                            assert(uname_to_index(p_var->name()) < i);
-                        } else if (std::get_if<number>(&arg.value()) == nullptr
-                                   && std::get_if<param>(&arg.value()) == nullptr) {
-                            assert(false);
-                        }
-                    };
+        // Enlarge the bounds and store them.
+        auto *enl = builder.CreateFMul(builder.CreateLoad(abs_sum), rel_enl);
 
-                    for (const auto &arg : v.args()) {
-                        check_arg(arg);
-                    }
-                } else {
-                    assert(false);
-                }
-            },
-            dc[i].first.value());
+        auto *lo_idx = builder.CreateMul(builder.getInt32(batch_size), cur_var_idx);
+        auto *hi_idx
+            = builder.CreateMul(builder.getInt32(batch_size), builder.CreateAdd(cur_var_idx, builder.getInt32(n_eq)));
 
-        for (auto idx : dc[i].second) {
-            assert(idx >= n_eq);
-            assert(idx < dc.size() - n_eq);
+        store_vector_to_memory(builder, builder.CreateInBoundsGEP(out_ptr, {lo_idx}),
+                               builder.CreateFSub(builder.CreateLoad(lo), enl));
+        store_vector_to_memory(builder, builder.CreateInBoundsGEP(out_ptr, {hi_idx}),
+                               builder.CreateFAdd(builder.CreateLoad(hi), enl));
+    });
 
-            // Hidden dep onto itself does not make any sense.
-            assert(idx != i);
-        }
-    }
+    // Create the return value.
+    builder.CreateRetVoid();
 
-    // From dc.size() - n_eq to dc.size(), the expressions
-    // must be either variables in the u_n form, where n < i,
-    // or numbers/params.
-    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
-        std::visit(
-            [i](const auto &v) {
-                using type = detail::uncvref_t<decltype(v)>;
+    // Verify the function.
+    s.verify_function(f);
 
-                if constexpr (std::is_same_v<type, variable>) {
-                    assert(v.name().rfind("u_", 0) == 0);
-                    assert(uname_to_index(v.name()) < i);
-                } else if constexpr (!std::is_same_v<type, number> && !std::is_same_v<type, param>) {
-                    assert(false);
-                }
-            },
-            dc[i].first.value());
+    // Run the optimisation pass.
+    s.optimise();
+}
 
-        // No hidden dependencies.
-        assert(dc[i].second.empty());
-    }
+// The process-wide cache of the JIT-compiled functions
+// for the enclosure of the state over a timestep.
+// NOTE: the key contains the number of equations, the order
+// and the batch size. The LLVM states are kept alive for the
+// lifetime of the program, so that the function pointers remain valid.
+template <typename T>
+struct tc_enc_cache {
+    std::shared_mutex mutex;
+    std::map<std::array<std::uint32_t, 3>, std::pair<llvm_state, void (*)(T *, const T *, const T *)>> map;
+};
 
-    std::unordered_map<std::string, expression> subs_map;
+// Fetch the JIT-compiled function for the enclosure of the
+// state over a timestep, compiling it on first use.
+template <typename T>
+void (*taylor_get_tc_enc_function(std::uint32_t n_eq, std::uint32_t order,
+                                  std::uint32_t batch_size))(T *, const T *, const T *)
+{
+    static tc_enc_cache<T> cache;
 
-    // For each u variable, expand its definition
-    // in terms of state variables or other u variables,
-    // and store it in subs_map.
-    for (idx_t i = 0; i < dc.size() - n_eq; ++i) {
-        subs_map.emplace("u_{}"_format(i), subs(dc[i].first, subs_map));
+    const std::array<std::uint32_t, 3> key{n_eq, order, batch_size};
+
+    {
+        std::shared_lock lock(cache.mutex);
+
+        if (const auto it = cache.map.find(key); it != cache.map.end()) {
+            return it->second.second;
+        }
     }
 
-    // Reconstruct the right-hand sides of the system
-    // and compare them to the original ones.
-    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
-        assert(subs(dc[i].first, subs_map) == orig[i - (dc.size() - n_eq)]);
+    // NOTE: the compilation is run without holding the lock.
+    llvm_state s;
+
+    // Overflow check: we need to be able to index into the
+    // arrays of Taylor coefficients and of bounds.
+    // LCOV_EXCL_START
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || batch_size > std::numeric_limits<std::uint32_t>::max() / (order + 1u)
+        || n_eq > std::numeric_limits<std::uint32_t>::max() / 2u
+        || batch_size * (order + 1u) > std::numeric_limits<std::uint32_t>::max() / n_eq) {
+        throw std::overflow_error("Overflow detected while adding a function for the enclosure of the state");
     }
+    // LCOV_EXCL_STOP
+
+    taylor_add_tc_enc_function<T>(s, n_eq, order, batch_size);
+
+    s.compile();
+
+    auto *ptr = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("tc_enc_f"));
+
+    std::unique_lock lock(cache.mutex);
+
+    return cache.map.try_emplace(key, std::pair{std::move(s), ptr}).first->second.second;
 }
 
-// Helper to verify the decomposition of the sv funcs.
-void verify_taylor_dec_sv_funcs(const std::vector<std::uint32_t> &sv_funcs_dc, const std::vector<expression> &sv_funcs,
-                                const taylor_dc_t &dc, std::vector<expression>::size_type n_eq)
+// Helper to remap the indices of the u variables in ex:
+// the u variable u_i will be renamed to u_{remap[i]}.
+// NOTE: this is equivalent to, but faster than, rename_variables()
+// with a string-based map.
+void taylor_dc_remap_uvars(expression &ex, const std::vector<taylor_dc_t::size_type> &remap)
 {
-    assert(sv_funcs.size() == sv_funcs_dc.size());
+    std::visit(
+        [&remap](auto &v) {
+            using type = uncvref_t<decltype(v)>;
 
-    std::unordered_map<std::string, expression> subs_map;
+            if constexpr (std::is_same_v<type, variable>) {
+                const auto idx = uname_to_index(v);
+                assert(idx < remap.size());
 
-    // For each u variable, expand its definition
-    // in terms of state variables or other u variables,
-    // and store it in subs_map.
-    for (decltype(dc.size()) i = 0; i < dc.size() - n_eq; ++i) {
-        subs_map.emplace("u_{}"_format(i), subs(dc[i].first, subs_map));
-    }
+                if (remap[idx] != idx) {
+                    v = variable{"u_{}"_format(remap[idx])};
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                for (auto [b, e] = v.get_mutable_args_it(); b != e; ++b) {
+                    taylor_dc_remap_uvars(*b, remap);
+                }
+            }
+        },
+        ex.value());
+}
 
-    // Reconstruct the sv functions and compare them to the
-    // original ones.
-    for (decltype(sv_funcs.size()) i = 0; i < sv_funcs.size(); ++i) {
-        assert(sv_funcs_dc[i] < dc.size());
+// Helper to shift by the amount 'shift' the indices of the u variables in ex
+// which are not state variables (i.e., whose indices are not less than n_eq).
+void taylor_dc_shift_uvars(expression &ex, taylor_dc_t::size_type n_eq, taylor_dc_t::size_type shift)
+{
+    std::visit(
+        [n_eq, shift](auto &v) {
+            using type = uncvref_t<decltype(v)>;
 
-        auto sv_func = subs(dc[sv_funcs_dc[i]].first, subs_map);
-        assert(sv_func == sv_funcs[i]);
-    }
+            if constexpr (std::is_same_v<type, variable>) {
+                if (const auto idx = uname_to_index(v); idx >= n_eq) {
+                    v = variable{"u_{}"_format(idx + shift)};
+                }
+            } else if constexpr (std::is_same_v<type, func>) {
+                for (auto [b, e] = v.get_mutable_args_it(); b != e; ++b) {
+                    taylor_dc_shift_uvars(*b, n_eq, shift);
+                }
+            }
+        },
+        ex.value());
 }
 
-#endif
-
-} // namespace
+// Helper to collect into out the indices of the u variables in ex.
+void taylor_dc_uvars_indices(std::vector<std::uint32_t> &out, const expression &ex)
+{
+    std::visit(
+        [&out](const auto &v) {
+            using type = uncvref_t<decltype(v)>;
 
-} // namespace detail
+            if constexpr (std::is_same_v<type, variable>) {
+                out.push_back(uname_to_index(v));
+            } else if constexpr (std::is_same_v<type, func>) {
+                for (const auto &arg : v.args()) {
+                    taylor_dc_uvars_indices(out, arg);
+                }
+            }
+        },
+        ex.value());
+}
 
-// Taylor decomposition with automatic deduction
-// of variables.
-// NOTE: when dealing with functions with hidden deps,
-// we should consider avoiding adding hidden deps if the
-// function argument(s) is a number/param: the hidden deps
-// won't be used for the computation of the derivatives
-// and thus they can be optimised out. Note that a straightforward
-// implementation of this idea this will only work when the argument
-// is a number/param, not when, e.g., the argument is par[0] + par[1] - in
-// order to simplify this out, it should be recognized that the definition
-// of a u variable depends only on numbers/params.
-std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_decompose(std::vector<expression> v_ex,
-                                                                    std::vector<expression> sv_funcs)
+// Minimum number of equations for which the
+// decomposition is run in parallel.
+constexpr std::size_t taylor_par_decompose_min_n_eq = 16;
+
+// Run the Taylor decomposition of the equations in v_ex (which must be
+// expressed in terms of u variables), appending the result to u_vars_defs. u_vars_defs
+// is expected to contain only the definitions of the state variables. The return value
+// contains, for each equation, the index of the u variable representing the
+// equation in the decomposition (or zero if the equation was not decomposed).
+// NOTE: the equations are split in contiguous blocks, which are decomposed
+// in parallel into separate local decompositions. The local decompositions are then
+// merged, shifting the indices of the u variables. The final result is
+// identical to the serial decomposition of the equations.
+std::vector<taylor_dc_t::size_type> taylor_decompose_eqs(std::vector<expression> &v_ex, taylor_dc_t &u_vars_defs)
 {
-    if (v_ex.empty()) {
-        throw std::invalid_argument("Cannot decompose a system of zero equations");
-    }
+    using idx_t = taylor_dc_t::size_type;
 
-    // Determine the variables in the system of equations.
-    std::set<std::string> vars;
-    for (const auto &ex : v_ex) {
-        for (const auto &var : get_variables(ex)) {
-            vars.emplace(var);
+    const auto n_eq = u_vars_defs.size();
+    const auto n_ex = v_ex.size();
+
+    std::vector<idx_t> retval(n_ex);
+
+    if (n_ex < taylor_par_decompose_min_n_eq) {
+        // Small system, run the decomposition serially.
+        for (decltype(v_ex.size()) i = 0; i < n_ex; ++i) {
+            retval[i] = taylor_decompose_in_place(std::move(v_ex[i]), u_vars_defs);
         }
-    }
-    if (vars.size() != v_ex.size()) {
-        throw std::invalid_argument(
-            "The number of deduced variables for a Taylor decomposition ({}) differs from the number of equations ({})"_format(
-                vars.size(), v_ex.size()));
+
+        return retval;
     }
 
-    // Check that the expressions in sv_funcs contain only
-    // state variables.
-    for (const auto &ex : sv_funcs) {
-        for (const auto &var : get_variables(ex)) {
-            if (vars.find(var) == vars.end()) {
-                throw std::invalid_argument("The extra functions in a Taylor decomposition contain the variable '{}', "
-                                            "which is not a state variable"_format(var));
-            }
-        }
-    }
+    // Split the equations into blocks.
+    const auto n_blocks = std::min(static_cast<std::size_t>(parallel_n_workers(n_ex, 0)) * 4u, n_ex);
+    const auto block_size = n_ex / n_blocks, n_rem = n_ex % n_blocks;
+    // NOTE: the first n_rem blocks contain an extra equation.
+    auto block_begin = [block_size, n_rem](std::size_t bidx) { return bidx * block_size + std::min(bidx, n_rem); };
 
-    // Cache the number of equations/variables
-    // for later use.
-    const auto n_eq = v_ex.size();
+    // The local decompositions.
+    std::vector<taylor_dc_t> l_dcs(n_blocks);
 
-    // Create the map for renaming the variables to u_i.
-    // The renaming will be done in alphabetical order.
-    std::unordered_map<std::string, std::string> repl_map;
-    {
-        decltype(vars.size()) var_idx = 0;
-        for (const auto &var : vars) {
-            [[maybe_unused]] const auto eres = repl_map.emplace(var, "u_{}"_format(var_idx++));
-            assert(eres.second);
-        }
-    }
+    parallel_for(n_blocks, 0, [&](std::size_t b, std::size_t e, unsigned) {
+        for (auto bidx = b; bidx < e; ++bidx) {
+            auto &l_dc = l_dcs[bidx];
 
-#if !defined(NDEBUG)
-    // Store a copy of the original system and
-    // sv_funcs for checking later.
-    const auto orig_v_ex = v_ex;
-    const auto orig_sv_funcs = sv_funcs;
-#endif
+            // NOTE: the decomposition functions only care about the size
+            // of the decomposition, thus we can fill the slots of the state
+            // variables with placeholders.
+            l_dc.resize(n_eq);
 
-    // Rename the variables in the original equations.
-    for (auto &ex : v_ex) {
-        rename_variables(ex, repl_map);
-    }
+            for (auto i = block_begin(bidx); i < block_begin(bidx + 1u); ++i) {
+                retval[i] = taylor_decompose_in_place(std::move(v_ex[i]), l_dc);
+            }
+        }
+    });
 
-    // Rename the variables in sv_funcs.
-    for (auto &ex : sv_funcs) {
-        rename_variables(ex, repl_map);
+    // Compute the shifts for the indices of the u variables in the local decompositions.
+    std::vector<idx_t> shifts(n_blocks);
+    for (std::size_t bidx = 1; bidx < n_blocks; ++bidx) {
+        shifts[bidx] = shifts[bidx - 1u] + (l_dcs[bidx - 1u].size() - n_eq);
     }
 
-    // Init the decomposition. It begins with a list
-    // of the original variables of the system.
-    taylor_dc_t u_vars_defs;
-    u_vars_defs.reserve(vars.size());
-    for (const auto &var : vars) {
-        u_vars_defs.emplace_back(variable{var}, std::vector<std::uint32_t>{});
-    }
+    // Apply the shifts.
+    parallel_for(n_blocks, 0, [&](std::size_t b, std::size_t e, unsigned) {
+        for (auto bidx = b; bidx < e; ++bidx) {
+            const auto shift = shifts[bidx];
 
-    // Create a copy of the original equations in terms of u variables.
-    // We will be reusing this below.
-    auto v_ex_copy = v_ex;
+            if (shift == 0u) {
+                continue;
+            }
 
-    // Run the decomposition on each equation.
-    for (decltype(v_ex.size()) i = 0; i < v_ex.size(); ++i) {
-        // Decompose the current equation.
-        if (const auto dres = taylor_decompose_in_place(std::move(v_ex[i]), u_vars_defs)) {
-            // NOTE: if the equation was decomposed
-            // (that is, it is not constant or a single variable),
-            // we have to update the original definition
-            // of the equation in v_ex_copy
-            // so that it points to the u variable
-            // that now represents it.
-            // NOTE: all functions are forced to return dres != 0
-            // in the func API, so the only entities that
-            // can return dres == 0 are const/params or
-            // variables.
-            v_ex_copy[i] = expression{"u_{}"_format(dres)};
-        }
-    }
+            for (auto it = l_dcs[bidx].begin() + static_cast<std::ptrdiff_t>(n_eq); it != l_dcs[bidx].end(); ++it) {
+                taylor_dc_shift_uvars(it->first, n_eq, shift);
 
-    // Decompose sv_funcs, and write into sv_funcs_dc the index
-    // of the u variable which each sv_func corresponds to.
-    std::vector<std::uint32_t> sv_funcs_dc;
-    for (auto &sv_ex : sv_funcs) {
-        if (const auto *var_ptr = std::get_if<variable>(&sv_ex.value())) {
-            // The current sv_func is a variable, add its index to sv_funcs_dc.
-            sv_funcs_dc.push_back(detail::uname_to_index(var_ptr->name()));
-        } else if (const auto dres = taylor_decompose_in_place(std::move(sv_ex), u_vars_defs)) {
-            // The sv_func was decomposed, add to sv_funcs_dc
-            // the index of the u variable which represents
-            // the result of the decomposition.
-            sv_funcs_dc.push_back(boost::numeric_cast<std::uint32_t>(dres));
-        } else {
-            // The sv_func was not decomposed, meaning it's a const/param.
-            throw std::invalid_argument(
-                "The extra functions in a Taylor decomposition cannot be constants or parameters");
+                for (auto &idx : it->second) {
+                    if (idx >= n_eq) {
+                        idx = boost::numeric_cast<std::uint32_t>(idx + shift);
+                    }
+                }
+            }
+
+            for (auto i = block_begin(bidx); i < block_begin(bidx + 1u); ++i) {
+                if (retval[i] != 0u) {
+                    retval[i] += shift;
+                }
+            }
         }
-    }
-    assert(sv_funcs_dc.size() == sv_funcs.size());
+    });
 
-    // Append the (possibly updated) definitions of the diff equations
-    // in terms of u variables.
-    for (auto &ex : v_ex_copy) {
-        u_vars_defs.emplace_back(std::move(ex), std::vector<std::uint32_t>{});
+    // Merge the local decompositions.
+    for (auto &l_dc : l_dcs) {
+        u_vars_defs.insert(u_vars_defs.end(), std::make_move_iterator(l_dc.begin() + static_cast<std::ptrdiff_t>(n_eq)),
+                           std::make_move_iterator(l_dc.end()));
     }
 
-#if !defined(NDEBUG)
-    // Verify the decomposition.
-    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
-    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
-#endif
+    return retval;
+}
 
-    // Simplify the decomposition.
-    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, sv_funcs_dc, n_eq);
+// The timings (decomposition, CSE, sorting) of the last
+// Taylor decomposition performed in the current thread.
+// NOTE: these are used to fill in the construction
+// timings of the integrators.
+thread_local std::array<double, 3> taylor_last_dc_timings{};
 
-#if !defined(NDEBUG)
-    // Verify the simplified decomposition.
-    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
-    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
-#endif
+// Helper to log the timings of the phases of a Taylor decomposition.
+void taylor_decompose_log_timings(const taylor_dc_t &dc, std::chrono::steady_clock::time_point t0,
+                                  std::chrono::steady_clock::time_point t1, std::chrono::steady_clock::time_point t2,
+                                  std::chrono::steady_clock::time_point t3)
+{
+    using ms_t = std::chrono::duration<double, std::milli>;
+    using s_t = std::chrono::duration<double>;
 
-    // Run the breadth-first topological sort on the decomposition.
-    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, sv_funcs_dc, n_eq);
+    taylor_last_dc_timings = {s_t(t1 - t0).count(), s_t(t2 - t1).count(), s_t(t3 - t2).count()};
 
-#if !defined(NDEBUG)
-    // Verify the reordered decomposition.
-    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
-    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
-#endif
+    get_logger()->debug("Taylor decomposition of size {} - decomposition: {}ms, CSE: {}ms, sorting: {}ms", dc.size(),
+                        ms_t(t1 - t0).count(), ms_t(t2 - t1).count(), ms_t(t3 - t2).count());
+}
 
-    return std::make_pair(std::move(u_vars_defs), std::move(sv_funcs_dc));
+// Helper to fill in the construction timings of an integrator.
+// t0 is the beginning of the construction, ir_t0 and ir_t1 the
+// beginning and end of the IR generation (which includes
+// the Taylor decomposition). s is the compiled state.
+taylor_ctor_timings taylor_make_ctor_timings(const llvm_state &s, std::chrono::steady_clock::time_point t0,
+                                             std::chrono::steady_clock::time_point ir_t0,
+                                             std::chrono::steady_clock::time_point ir_t1)
+{
+    using s_t = std::chrono::duration<double>;
+
+    taylor_ctor_timings retval;
+
+    retval.decomposition = taylor_last_dc_timings[0];
+    retval.cse = taylor_last_dc_timings[1];
+    retval.sorting = taylor_last_dc_timings[2];
+    retval.ir_gen = std::max(0., s_t(ir_t1 - ir_t0).count() - retval.decomposition - retval.cse - retval.sorting);
+    retval.opt_function_passes = s.get_timings().opt_function_passes;
+    retval.opt_module_passes = s.get_timings().opt_module_passes;
+    retval.codegen = s.get_timings().codegen;
+    retval.total = s_t(std::chrono::steady_clock::now() - t0).count();
+
+    using ms_t = std::chrono::duration<double, std::milli>;
+    auto to_ms = [](double t) { return ms_t(s_t(t)).count(); };
+
+    get_logger()->debug("construction of an adaptive Taylor integrator - decomposition: {}ms, CSE: {}ms, sorting: "
+                        "{}ms, IR generation: {}ms, function passes: {}ms, module passes: {}ms, codegen: {}ms, "
+                        "total: {}ms",
+                        to_ms(retval.decomposition), to_ms(retval.cse), to_ms(retval.sorting), to_ms(retval.ir_gen),
+                        to_ms(retval.opt_function_passes), to_ms(retval.opt_module_passes), to_ms(retval.codegen),
+                        to_ms(retval.total));
+
+    return retval;
 }
 
-// Taylor decomposition from lhs and rhs
-// of a system of equations.
-std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_decompose(std::vector<std::pair<expression, expression>> sys,
-                                                                    std::vector<expression> sv_funcs)
+// Helpers to compute the memory usage of the data
+// members of an integrator (see taylor_memory_usage).
+template <typename V>
+std::size_t taylor_vec_mem_usage(const V &v)
 {
-    if (sys.empty()) {
-        throw std::invalid_argument("Cannot decompose a system of zero equations");
-    }
+    return static_cast<std::size_t>(v.capacity()) * sizeof(typename V::value_type);
+}
 
-    // Determine the variables in the system of equations
-    // from the lhs of the equations. We need to ensure that:
-    // - all the lhs expressions are variables
-    //   and there are no duplicates,
-    // - all the variables in the rhs expressions
-    //   appear in the lhs expressions.
-    // Note that not all variables in the lhs
-    // need to appear in the rhs.
+template <typename V>
+std::size_t taylor_nested_vec_mem_usage(const V &v)
+{
+    auto retval = taylor_vec_mem_usage(v);
 
-    // This will eventually contain the list
-    // of all variables in the system.
-    std::vector<std::string> lhs_vars;
-    // Maintain a set as well to check for duplicates.
-    std::unordered_set<std::string> lhs_vars_set;
-    // The set of variables in the rhs.
-    std::unordered_set<std::string> rhs_vars_set;
+    for (const auto &x : v) {
+        retval += taylor_vec_mem_usage(x);
+    }
 
-    for (const auto &p : sys) {
-        const auto &lhs = p.first;
-        const auto &rhs = p.second;
+    return retval;
+}
 
-        // Infer the variable from the current lhs.
-        std::visit(
-            [&lhs, &lhs_vars, &lhs_vars_set](const auto &v) {
-                if constexpr (std::is_same_v<detail::uncvref_t<decltype(v)>, variable>) {
-                    // Check if this is a duplicate variable.
-                    if (auto res = lhs_vars_set.emplace(v.name()); res.second) {
-                        // Not a duplicate, add it to lhs_vars.
-                        lhs_vars.emplace_back(v.name());
-                    } else {
-                        // Duplicate, error out.
-                        throw std::invalid_argument(
-                            "Error in the Taylor decomposition of a system of equations: the variable '{}' "
-                            "appears in the left-hand side twice"_format(v.name()));
-                    }
-                } else {
-                    throw std::invalid_argument(
-                        "Error in the Taylor decomposition of a system of equations: the "
-                        "left-hand side contains the expression '{}', which is not a variable"_format(lhs));
-                }
-            },
-            lhs.value());
+template <typename T>
+std::size_t taylor_ed_data_mem_usage(const ed_data<T> &ed)
+{
+    auto retval = taylor_vec_mem_usage(ed.polys) + taylor_vec_mem_usage(ed.free_polys)
+                  + taylor_vec_mem_usage(ed.wlist) + taylor_vec_mem_usage(ed.isol)
+                  + taylor_vec_mem_usage(ed.lane_poly) + taylor_vec_mem_usage(ed.r_poly)
+                  + taylor_vec_mem_usage(ed.t_poly1) + taylor_vec_mem_usage(ed.t_poly2)
+                  + taylor_vec_mem_usage(ed.n_sc) + taylor_vec_mem_usage(ed.skip) + taylor_vec_mem_usage(ed.r_fns)
+                  + taylor_nested_vec_mem_usage(ed.b_skip) + taylor_nested_vec_mem_usage(ed.b_d_tes)
+                  + taylor_nested_vec_mem_usage(ed.b_d_ntes) + taylor_vec_mem_usage(ed.blocks);
 
-        // Update the global list of variables
-        // for the rhs.
-        for (auto &var : get_variables(rhs)) {
-            rhs_vars_set.emplace(std::move(var));
-        }
+    for (const auto &b : ed.blocks) {
+        retval += taylor_ed_data_mem_usage(b);
     }
 
-    // Check that all variables in the rhs appear in the lhs.
-    for (const auto &var : rhs_vars_set) {
-        if (lhs_vars_set.find(var) == lhs_vars_set.end()) {
-            throw std::invalid_argument("Error in the Taylor decomposition of a system of equations: the variable '{}' "
-                                        "appears in the right-hand side but not in the left-hand side"_format(var));
-        }
-    }
+    return retval;
+}
 
-    // Check that the expressions in sv_funcs contain only
-    // state variables.
-    for (const auto &ex : sv_funcs) {
-        for (const auto &var : get_variables(ex)) {
-            if (lhs_vars_set.find(var) == lhs_vars_set.end()) {
-                throw std::invalid_argument("The extra functions in a Taylor decomposition contain the variable '{}', "
-                                            "which is not a state variable"_format(var));
-            }
+// NOTE: the memory usage of an expression is estimated
+// from the number of nodes and the sizes of the argument lists.
+// The names of the variables and functions are not accounted for.
+std::size_t taylor_ex_mem_usage(const expression &ex)
+{
+    if (const auto *fptr = std::get_if<func>(&ex.value())) {
+        auto retval = taylor_vec_mem_usage(fptr->args());
+
+        for (const auto &arg : fptr->args()) {
+            retval += taylor_ex_mem_usage(arg);
         }
+
+        return retval;
+    } else {
+        return 0;
     }
+}
 
-    // Cache the number of equations/variables.
-    const auto n_eq = sys.size();
-    assert(n_eq == lhs_vars.size());
+std::size_t taylor_dc_mem_usage(const taylor_dc_t &dc)
+{
+    auto retval = taylor_vec_mem_usage(dc);
 
-    // Create the map for renaming the variables to u_i.
-    // The renaming will be done following the order of the lhs
-    // variables.
-    std::unordered_map<std::string, std::string> repl_map;
-    for (decltype(lhs_vars.size()) i = 0; i < lhs_vars.size(); ++i) {
-        [[maybe_unused]] const auto eres = repl_map.emplace(lhs_vars[i], "u_{}"_format(i));
-        assert(eres.second);
+    for (const auto &[ex, deps] : dc) {
+        retval += taylor_ex_mem_usage(ex) + taylor_vec_mem_usage(deps);
     }
 
-#if !defined(NDEBUG)
-    // Store a copy of the original rhs and sv_funcs
-    // for checking later.
-    std::vector<expression> orig_rhs;
-    orig_rhs.reserve(sys.size());
-    for (const auto &[_, rhs_ex] : sys) {
-        orig_rhs.push_back(rhs_ex);
-    }
-    const auto orig_sv_funcs = sv_funcs;
-#endif
+    return retval;
+}
 
-    // Rename the variables in the original equations.
-    for (auto &[_, rhs_ex] : sys) {
-        rename_variables(rhs_ex, repl_map);
+// Add the memory usage of the llvm_state s (if not null) to mu.
+void taylor_add_llvm_mem_usage(taylor_memory_usage &mu, const llvm_state *s)
+{
+    if (s == nullptr) {
+        return;
     }
 
-    // Rename the variables in sv_funcs.
-    for (auto &ex : sv_funcs) {
-        rename_variables(ex, repl_map);
-    }
+    const auto lmu = s->get_memory_usage();
 
-    // Init the decomposition. It begins with a list
-    // of the original lhs variables of the system.
-    taylor_dc_t u_vars_defs;
-    u_vars_defs.reserve(lhs_vars.size());
-    for (const auto &var : lhs_vars) {
-        u_vars_defs.emplace_back(variable{var}, std::vector<std::uint32_t>{});
+    mu.bc_snapshot += lmu.bc_snapshot;
+    mu.object_code += lmu.object_code;
+    mu.jit += lmu.jit;
+}
+
+void taylor_mem_usage_finalise(taylor_memory_usage &mu)
+{
+    mu.total = mu.state + mu.pars + mu.tc + mu.d_out + mu.events + mu.other + mu.decomposition + mu.bc_snapshot
+               + mu.object_code + mu.jit;
+}
+
+// The per-thread scratch buffer for the jet of derivatives
+// of the integrators with events (see set_thread_scratch()).
+// The buffer is grown on demand to at least size elements.
+// NOTE: the buffer is used only within a single step (before
+// the invocation of any callback), thus it can be safely shared
+// by all the integrators stepping in the same thread.
+template <typename T>
+aligned_vector<T> &taylor_scratch_ev_jet(std::size_t size)
+{
+    thread_local aligned_vector<T> buf;
+
+    if (buf.size() < size) {
+        buf.resize(size);
     }
 
-    // Create a copy of the original equations in terms of u variables.
-    // We will be reusing this below.
-    auto sys_copy = sys;
+    return buf;
+}
 
-    // Run the decomposition on each equation.
-    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
-        // Decompose the current equation.
-        if (const auto dres = taylor_decompose_in_place(std::move(sys[i].second), u_vars_defs)) {
-            // NOTE: if the equation was decomposed
+// Helper to list the forms of the u variable definition ex which are not
+// structurally identical to ex but which are mathematically equivalent to it
+// and have the same Taylor recurrence. These are used in the CSE pass in order
+// to share the companion u variables produced by the decomposition of certain functions
+// (e.g., the auxiliary square(tan(a)) of tan() and the e*cos(E) of kepE())
+// with u variables defined elsewhere in the decomposition in an equivalent form.
+std::vector<expression> taylor_dc_cse_alt_forms(const expression &ex)
+{
+    std::vector<expression> retval;
+
+    const auto *fptr = std::get_if<func>(&ex.value());
+    if (fptr == nullptr) {
+        return retval;
+    }
+
+    if (const auto *bop = fptr->extract<binary_op>();
+        bop != nullptr && (bop->op() == binary_op::type::add || bop->op() == binary_op::type::mul)) {
+        // Commutative operations: swap the operands.
+        if (bop->lhs() != bop->rhs()) {
+            retval.emplace_back(func{binary_op(bop->op(), bop->rhs(), bop->lhs())});
+        }
+
+        // a*a -> square(a).
+        if (bop->op() == binary_op::type::mul && bop->lhs() == bop->rhs()) {
+            retval.push_back(square(bop->lhs()));
+        }
+    } else if (fptr->extract<square_impl>() != nullptr) {
+        // square(a) -> a*a.
+        assert(fptr->args().size() == 1u);
+        retval.emplace_back(func{binary_op(binary_op::type::mul, fptr->args()[0], fptr->args()[0])});
+    }
+
+    return retval;
+}
+
+// Simplify a Taylor decomposition by removing
+// common subexpressions.
+// NOTE: the hidden deps are not considered for CSE
+// purposes, only the actual subexpressions.
+// NOTE: paired functions (e.g., sin/cos, sinh/cosh) always emit
+// both members of the pair in the decomposition, thus the companion
+// u variables are shared by the CSE pass even if the functions appear
+// in different parts of the system. Mathematically-equivalent forms
+// of commutative operations and squares are also recognised
+// (see taylor_dc_cse_alt_forms()).
+taylor_dc_t taylor_decompose_cse(taylor_dc_t &v_ex, std::vector<std::uint32_t> &sv_funcs_dc,
+                                 taylor_dc_t::size_type n_eq)
+{
+    using idx_t = taylor_dc_t::size_type;
+
+    // A Taylor decomposition is supposed
+    // to have n_eq variables at the beginning,
+    // n_eq variables at the end and possibly
+    // extra variables in the middle.
+    assert(v_ex.size() >= n_eq * 2u);
+
+    // Init the return value.
+    taylor_dc_t retval;
+
+    // expression -> idx map. This will end up containing
+    // all the unique expressions from v_ex, and it will
+    // map them to their indices in retval (which will
+    // in general differ from their indices in v_ex).
+    std::unordered_map<expression, idx_t> ex_map;
+
+    // Vector for the renaming of u variables
+    // in the expressions: the u variable u_i will
+    // be renamed to u_{uvars_rename[i]}.
+    std::vector<idx_t> uvars_rename;
+    uvars_rename.reserve(v_ex.size() - n_eq);
+
+    // The first n_eq definitions are just renaming
+    // of the state variables into u variables.
+    for (idx_t i = 0; i < n_eq; ++i) {
+        assert(std::holds_alternative<variable>(v_ex[i].first.value()));
+        // NOTE: no hidden deps allowed here.
+        assert(v_ex[i].second.empty());
+        retval.push_back(std::move(v_ex[i]));
+
+        // NOTE: the u vars that correspond to state
+        // variables are never simplified,
+        // thus map them onto themselves.
+        uvars_rename.push_back(i);
+    }
+
+    // Handle the u variables which do not correspond to state variables.
+    for (auto i = n_eq; i < v_ex.size() - n_eq; ++i) {
+        auto &[ex, deps] = v_ex[i];
+
+        // Rename the u variables in ex.
+        taylor_dc_remap_uvars(ex, uvars_rename);
+
+        auto it = ex_map.find(ex);
+        if (it == ex_map.end()) {
+            // Look for an equivalent form of ex.
+            // NOTE: ex is kept in its original form if
+            // no equivalent form is found, so that the
+            // decomposition is altered only if a redundancy
+            // is actually detected.
+            for (const auto &alt : taylor_dc_cse_alt_forms(ex)) {
+                if (it = ex_map.find(alt); it != ex_map.end()) {
+                    break;
+                }
+            }
+        }
+
+        if (it == ex_map.end()) {
+            // This is the first occurrence of ex in the
+            // decomposition. Add it to retval.
+            retval.emplace_back(ex, std::move(deps));
+
+            // Add ex to ex_map, mapping it to
+            // the index it corresponds to in retval
+            // (let's call it j).
+            ex_map.emplace(std::move(ex), retval.size() - 1u);
+
+            // Update uvars_rename. This will ensure that
+            // occurrences of the variable 'u_i' in the next
+            // elements of v_ex will be renamed to 'u_j'.
+            assert(uvars_rename.size() == i);
+            uvars_rename.push_back(retval.size() - 1u);
+        } else {
+            // ex is redundant. This means
+            // that it already appears in retval at index
+            // it->second. Don't add anything to retval,
+            // and remap the variable name 'u_i' to
+            // 'u_{it->second}'.
+            assert(uvars_rename.size() == i);
+            uvars_rename.push_back(it->second);
+        }
+    }
+
+    // Handle the derivatives of the state variables at the
+    // end of the decomposition. We just need to ensure that
+    // the u variables in their definitions are renamed with
+    // the new indices.
+    for (auto i = v_ex.size() - n_eq; i < v_ex.size(); ++i) {
+        auto &[ex, deps] = v_ex[i];
+
+        // NOTE: here we expect only vars, numbers or params,
+        // and no hidden dependencies.
+        assert(std::holds_alternative<variable>(ex.value()) || std::holds_alternative<number>(ex.value())
+               || std::holds_alternative<param>(ex.value()));
+        assert(deps.empty());
+
+        taylor_dc_remap_uvars(ex, uvars_rename);
+
+        retval.emplace_back(std::move(ex), std::move(deps));
+    }
+
+    // Re-adjust all indices in the hidden dependencies in order to account
+    // for the renaming of the uvars.
+    for (auto &[_, deps] : retval) {
+        for (auto &idx : deps) {
+            assert(idx < uvars_rename.size());
+            idx = boost::numeric_cast<std::uint32_t>(uvars_rename[idx]);
+        }
+    }
+
+    // Same for the indices in sv_funcs_dc.
+    for (auto &idx : sv_funcs_dc) {
+        assert(idx < uvars_rename.size());
+        idx = boost::numeric_cast<std::uint32_t>(uvars_rename[idx]);
+    }
+
+    return retval;
+}
+
+// Perform a topological sort on a graph representation
+// of the Taylor decomposition. This can improve performance
+// by grouping together operations that can be performed in parallel,
+// and it also makes compact mode much more effective by creating
+// clusters of subexpressions whose derivatives can be computed in
+// parallel.
+// NOTE: the original decomposition dc is already topologically sorted,
+// in the sense that the definitions of the u variables are already
+// ordered according to dependency. However, because the original decomposition
+// comes from a depth-first search, it has the tendency to group together
+// expressions which are dependent on each other. By doing another topological
+// sort, this time based on breadth-first search, we determine another valid
+// sorting in which independent operations tend to be clustered together.
+// Within each group of independent operations, the u variables are then
+// sorted according to the position of their operands, so that operations
+// reading nearby operands are placed close together.
+auto taylor_sort_dc(taylor_dc_t &dc, std::vector<std::uint32_t> &sv_funcs_dc, taylor_dc_t::size_type n_eq)
+{
+    // A Taylor decomposition is supposed
+    // to have n_eq variables at the beginning,
+    // n_eq variables at the end and possibly
+    // extra variables in the middle
+    assert(dc.size() >= n_eq * 2u);
+
+    // The graph type that we will use for the topological sorting.
+    using graph_t = boost::adjacency_list<boost::vecS,           // std::vector for list of adjacent vertices
+                                          boost::vecS,           // std::vector for the list of vertices
+                                          boost::bidirectionalS, // directed graph with efficient access
+                                                                 // to in-edges
+                                          boost::no_property,    // no vertex properties
+                                          boost::no_property,    // no edge properties
+                                          boost::no_property,    // no graph properties
+                                          boost::listS           // std::list for of the graph's edge list
+                                          >;
+
+    graph_t g;
+
+    // Add the root node.
+    const auto root_v = boost::add_vertex(g);
+
+    // Add the nodes corresponding to the state variables.
+    for (decltype(n_eq) i = 0; i < n_eq; ++i) {
+        auto v = boost::add_vertex(g);
+
+        // Add a dependency on the root node.
+        boost::add_edge(root_v, v, g);
+    }
+
+    // List of the indices of the variables in the current expression.
+    std::vector<std::uint32_t> vars;
+
+    // The list of the operands of each vertex.
+    std::vector<std::vector<std::uint32_t>> v_ops(boost::num_vertices(g));
+
+    // Add the rest of the u variables.
+    for (decltype(n_eq) i = n_eq; i < dc.size() - n_eq; ++i) {
+        auto v = boost::add_vertex(g);
+
+        // Fetch the list of variables in the current expression.
+        vars.clear();
+        taylor_dc_uvars_indices(vars, dc[i].first);
+        std::sort(vars.begin(), vars.end());
+        vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+
+        v_ops.push_back(vars);
+
+        if (vars.empty()) {
+            // The current expression does not contain
+            // any variable: make it depend on the root
+            // node. This means that in the topological
+            // sort below, the current u var will appear
+            // immediately after the state variables.
+            boost::add_edge(root_v, v, g);
+        } else {
+            // Mark the current u variable as depending on all the
+            // variables in the current expression.
+            for (const auto idx : vars) {
+                // Add the dependency.
+                // NOTE: add +1 because the i-th vertex
+                // corresponds to the (i-1)-th u variable
+                // due to the presence of the root node.
+                boost::add_edge(boost::vertex(idx + 1u, g), v, g);
+            }
+        }
+    }
+
+    assert(boost::num_vertices(g) - 1u == dc.size() - n_eq);
+
+    // Run the BF topological sort on the graph. This is Kahn's algorithm:
+    // https://en.wikipedia.org/wiki/Topological_sorting
+    // NOTE: the nodes are processed in groups: the nodes in the next group
+    // are the nodes left with no incoming edges after the removal of
+    // the nodes in the current group. This results in the same grouping
+    // as the FIFO version of Kahn's algorithm (and thus in the same segments
+    // in compact mode), but it allows us to reorder the nodes within each group.
+
+    // The result of the sort.
+    std::vector<decltype(dc.size())> v_idx;
+
+    // The position of each vertex in v_idx.
+    std::vector<decltype(dc.size())> v_pos(boost::num_vertices(g));
+
+    // Temp variable used to sort a list of edges in the loop below.
+    std::vector<boost::graph_traits<graph_t>::edge_descriptor> tmp_edges;
+
+    // The current and the next group of nodes with no incoming edges.
+    // The root node has no incoming edge.
+    std::vector<decltype(dc.size())> cur_group{0}, next_group;
+
+    // Temp variable used to sort the next group in the loop below.
+    std::vector<std::tuple<decltype(dc.size()), decltype(dc.size()), decltype(dc.size())>> group_keys;
+
+    // Main loop.
+    while (!cur_group.empty()) {
+        next_group.clear();
+
+        for (const auto v : cur_group) {
+            // Append v to the result.
+            v_pos[v] = v_idx.size();
+            v_idx.push_back(v);
+
+            // Fetch all the out edges of v and sort them according
+            // to the target vertex.
+            // NOTE: the sorting is important to ensure that all the state
+            // variables are insered into v_idx in the correct order.
+            const auto e_range = boost::out_edges(v, g);
+            tmp_edges.assign(e_range.first, e_range.second);
+            std::sort(tmp_edges.begin(), tmp_edges.end(),
+                      [&g](const auto &e1, const auto &e2) { return boost::target(e1, g) < boost::target(e2, g); });
+
+            // For each out edge of v:
+            // - eliminate it;
+            // - check if the target vertex of the edge
+            //   has other incoming edges;
+            // - if it does not, insert it into next_group.
+            for (auto &e : tmp_edges) {
+                // Fetch the target of the edge.
+                const auto t = boost::target(e, g);
+
+                // Remove the edge.
+                boost::remove_edge(e, g);
+
+                // Get the range of vertices connecting to t.
+                const auto iav = boost::inv_adjacent_vertices(t, g);
+
+                if (iav.first == iav.second) {
+                    // t does not have any incoming edges, add it to next_group.
+                    next_group.push_back(t);
+                }
+            }
+        }
+
+        // Sort the next group according to the smallest and largest
+        // positions of the operands in v_idx (ties are broken by
+        // the original order of the u variables).
+        // NOTE: the group following the root node contains the state variables,
+        // which must not be reordered. The other nodes in this group do not
+        // depend on any variable.
+        if (cur_group.size() != 1u || cur_group[0] != 0u) {
+            group_keys.clear();
+
+            for (const auto t : next_group) {
+                assert(!v_ops[t].empty());
+
+                decltype(dc.size()) min_pos = v_idx.size(), max_pos = 0;
+                for (const auto op : v_ops[t]) {
+                    // NOTE: add +1 because the i-th vertex
+                    // corresponds to the (i-1)-th u variable.
+                    const auto pos = v_pos[op + 1u];
+                    min_pos = std::min(min_pos, pos);
+                    max_pos = std::max(max_pos, pos);
+                }
+
+                group_keys.emplace_back(min_pos, max_pos, t);
+            }
+
+            std::sort(group_keys.begin(), group_keys.end());
+
+            for (decltype(group_keys.size()) i = 0; i < group_keys.size(); ++i) {
+                next_group[i] = std::get<2>(group_keys[i]);
+            }
+        }
+
+        cur_group.swap(next_group);
+    }
+
+    assert(v_idx.size() == boost::num_vertices(g));
+    assert(boost::num_edges(g) == 0u);
+
+    // Adjust v_idx: remove the index of the root node,
+    // decrease by one all other indices, insert the final
+    // n_eq indices.
+    for (decltype(v_idx.size()) i = 0; i < v_idx.size() - 1u; ++i) {
+        v_idx[i] = v_idx[i + 1u] - 1u;
+    }
+    v_idx.resize(boost::numeric_cast<decltype(v_idx.size())>(dc.size()));
+    std::iota(v_idx.data() + dc.size() - n_eq, v_idx.data() + dc.size(), dc.size() - n_eq);
+
+    // Create the remapping vector: the u variable u_i
+    // will be renamed to u_{remap[i]}.
+    std::vector<taylor_dc_t::size_type> remap(dc.size() - n_eq);
+    // NOTE: the u vars that correspond to state
+    // variables were inserted into v_idx in the original
+    // order, thus they are not re-sorted and they do not
+    // need renaming.
+    std::iota(remap.begin(), remap.begin() + static_cast<std::ptrdiff_t>(n_eq), taylor_dc_t::size_type(0));
+    // Establish the remapping for the u variables that are not
+    // state variables.
+    for (decltype(v_idx.size()) i = n_eq; i < v_idx.size() - n_eq; ++i) {
+        remap[v_idx[i]] = i;
+    }
+
+    // Do the remap for the definitions of the u variables, the
+    // derivatives and the hidden deps.
+    for (auto *it = dc.data() + n_eq; it != dc.data() + dc.size(); ++it) {
+        // Remap the expression.
+        taylor_dc_remap_uvars(it->first, remap);
+
+        // Remap the hidden dependencies.
+        for (auto &idx : it->second) {
+            assert(idx < remap.size());
+            idx = boost::numeric_cast<std::uint32_t>(remap[idx]);
+        }
+    }
+
+    // Do the remap for sv_funcs.
+    for (auto &idx : sv_funcs_dc) {
+        assert(idx < remap.size());
+        idx = boost::numeric_cast<std::uint32_t>(remap[idx]);
+    }
+
+    // Reorder the decomposition.
+    taylor_dc_t retval;
+    retval.reserve(v_idx.size());
+    for (auto idx : v_idx) {
+        retval.push_back(std::move(dc[idx]));
+    }
+
+    return retval;
+}
+
+#if !defined(NDEBUG)
+
+// Helper to verify a Taylor decomposition.
+void verify_taylor_dec(const std::vector<expression> &orig, const taylor_dc_t &dc)
+{
+    using idx_t = taylor_dc_t::size_type;
+
+    const auto n_eq = orig.size();
+
+    assert(dc.size() >= n_eq * 2u);
+
+    // The first n_eq expressions of u variables
+    // must be just variables. No hidden dependencies
+    // are allowed.
+    for (idx_t i = 0; i < n_eq; ++i) {
+        assert(std::holds_alternative<variable>(dc[i].first.value()));
+        assert(dc[i].second.empty());
+    }
+
+    // From n_eq to dc.size() - n_eq, the expressions
+    // must be functions whose arguments
+    // are either variables in the u_n form,
+    // where n < i, or numbers/params.
+    // The hidden dependencies must contain indices
+    // only in the [n_eq, dc.size() - n_eq) range.
+    for (auto i = n_eq; i < dc.size() - n_eq; ++i) {
+        std::visit(
+            [i](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, func>) {
+                    auto check_arg = [i](const auto &arg) {
+                        if (auto p_var = std::get_if<variable>(&arg.value())) {
+                            assert(p_var->name().rfind("u_", 0) == 0);
+                            assert(uname_to_index(*p_var) < i);
+                        } else if (std::get_if<number>(&arg.value()) == nullptr
+                                   && std::get_if<param>(&arg.value()) == nullptr) {
+                            assert(false);
+                        }
+                    };
+
+                    for (const auto &arg : v.args()) {
+                        check_arg(arg);
+                    }
+                } else {
+                    assert(false);
+                }
+            },
+            dc[i].first.value());
+
+        for (auto idx : dc[i].second) {
+            assert(idx >= n_eq);
+            assert(idx < dc.size() - n_eq);
+
+            // Hidden dep onto itself does not make any sense.
+            assert(idx != i);
+        }
+    }
+
+    // From dc.size() - n_eq to dc.size(), the expressions
+    // must be either variables in the u_n form, where n < i,
+    // or numbers/params.
+    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
+        std::visit(
+            [i](const auto &v) {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    assert(v.name().rfind("u_", 0) == 0);
+                    assert(uname_to_index(v) < i);
+                } else if constexpr (!std::is_same_v<type, number> && !std::is_same_v<type, param>) {
+                    assert(false);
+                }
+            },
+            dc[i].first.value());
+
+        // No hidden dependencies.
+        assert(dc[i].second.empty());
+    }
+
+    std::unordered_map<std::string, expression> subs_map;
+
+    // For each u variable, expand its definition
+    // in terms of state variables or other u variables,
+    // and store it in subs_map.
+    for (idx_t i = 0; i < dc.size() - n_eq; ++i) {
+        subs_map.emplace("u_{}"_format(i), subs(dc[i].first, subs_map));
+    }
+
+    // Reconstruct the right-hand sides of the system
+    // and compare them to the original ones.
+    for (auto i = dc.size() - n_eq; i < dc.size(); ++i) {
+        assert(subs(dc[i].first, subs_map) == orig[i - (dc.size() - n_eq)]);
+    }
+}
+
+// Helper to verify the decomposition of the sv funcs.
+void verify_taylor_dec_sv_funcs(const std::vector<std::uint32_t> &sv_funcs_dc, const std::vector<expression> &sv_funcs,
+                                const taylor_dc_t &dc, std::vector<expression>::size_type n_eq)
+{
+    assert(sv_funcs.size() == sv_funcs_dc.size());
+
+    std::unordered_map<std::string, expression> subs_map;
+
+    // For each u variable, expand its definition
+    // in terms of state variables or other u variables,
+    // and store it in subs_map.
+    for (decltype(dc.size()) i = 0; i < dc.size() - n_eq; ++i) {
+        subs_map.emplace("u_{}"_format(i), subs(dc[i].first, subs_map));
+    }
+
+    // Reconstruct the sv functions and compare them to the
+    // original ones.
+    for (decltype(sv_funcs.size()) i = 0; i < sv_funcs.size(); ++i) {
+        assert(sv_funcs_dc[i] < dc.size());
+
+        auto sv_func = subs(dc[sv_funcs_dc[i]].first, subs_map);
+        assert(sv_func == sv_funcs[i]);
+    }
+}
+
+#endif
+
+} // namespace
+
+} // namespace detail
+
+// Taylor decomposition with automatic deduction
+// of variables.
+// NOTE: when dealing with functions with hidden deps,
+// we should consider avoiding adding hidden deps if the
+// function argument(s) is a number/param: the hidden deps
+// won't be used for the computation of the derivatives
+// and thus they can be optimised out. Note that a straightforward
+// implementation of this idea this will only work when the argument
+// is a number/param, not when, e.g., the argument is par[0] + par[1] - in
+// order to simplify this out, it should be recognized that the definition
+// of a u variable depends only on numbers/params.
+std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_decompose(std::vector<expression> v_ex,
+                                                                    std::vector<expression> sv_funcs)
+{
+    if (v_ex.empty()) {
+        throw std::invalid_argument("Cannot decompose a system of zero equations");
+    }
+
+    // Determine the variables in the system of equations.
+    std::set<std::string> vars;
+    for (const auto &ex : v_ex) {
+        for (const auto &var : get_variables(ex)) {
+            vars.emplace(var);
+        }
+    }
+    if (vars.size() != v_ex.size()) {
+        throw std::invalid_argument(
+            "The number of deduced variables for a Taylor decomposition ({}) differs from the number of equations ({})"_format(
+                vars.size(), v_ex.size()));
+    }
+
+    // Check that the expressions in sv_funcs contain only
+    // state variables.
+    for (const auto &ex : sv_funcs) {
+        for (const auto &var : get_variables(ex)) {
+            if (vars.find(var) == vars.end()) {
+                throw std::invalid_argument("The extra functions in a Taylor decomposition contain the variable '{}', "
+                                            "which is not a state variable"_format(var));
+            }
+        }
+    }
+
+    // Cache the number of equations/variables
+    // for later use.
+    const auto n_eq = v_ex.size();
+
+    // Create the map for renaming the variables to u_i.
+    // The renaming will be done in alphabetical order.
+    std::unordered_map<std::string, std::string> repl_map;
+    {
+        decltype(vars.size()) var_idx = 0;
+        for (const auto &var : vars) {
+            [[maybe_unused]] const auto eres = repl_map.emplace(var, "u_{}"_format(var_idx++));
+            assert(eres.second);
+        }
+    }
+
+#if !defined(NDEBUG)
+    // Store a copy of the original system and
+    // sv_funcs for checking later.
+    const auto orig_v_ex = v_ex;
+    const auto orig_sv_funcs = sv_funcs;
+#endif
+
+    // Rename the variables in the original equations.
+    for (auto &ex : v_ex) {
+        rename_variables(ex, repl_map);
+    }
+
+    // Rename the variables in sv_funcs.
+    for (auto &ex : sv_funcs) {
+        rename_variables(ex, repl_map);
+    }
+
+    // Init the decomposition. It begins with a list
+    // of the original variables of the system.
+    taylor_dc_t u_vars_defs;
+    u_vars_defs.reserve(vars.size());
+    for (const auto &var : vars) {
+        u_vars_defs.emplace_back(variable{var}, std::vector<std::uint32_t>{});
+    }
+
+    // Create a copy of the original equations in terms of u variables.
+    // We will be reusing this below.
+    auto v_ex_copy = v_ex;
+
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Run the decomposition on each equation.
+    const auto v_dres = detail::taylor_decompose_eqs(v_ex, u_vars_defs);
+    for (decltype(v_ex.size()) i = 0; i < v_ex.size(); ++i) {
+        if (const auto dres = v_dres[i]) {
+            // NOTE: if the equation was decomposed
+            // (that is, it is not constant or a single variable),
+            // we have to update the original definition
+            // of the equation in v_ex_copy
+            // so that it points to the u variable
+            // that now represents it.
+            // NOTE: all functions are forced to return dres != 0
+            // in the func API, so the only entities that
+            // can return dres == 0 are const/params or
+            // variables.
+            v_ex_copy[i] = expression{"u_{}"_format(dres)};
+        }
+    }
+
+    // Decompose sv_funcs, and write into sv_funcs_dc the index
+    // of the u variable which each sv_func corresponds to.
+    std::vector<std::uint32_t> sv_funcs_dc;
+    for (auto &sv_ex : sv_funcs) {
+        if (const auto *var_ptr = std::get_if<variable>(&sv_ex.value())) {
+            // The current sv_func is a variable, add its index to sv_funcs_dc.
+            sv_funcs_dc.push_back(detail::uname_to_index(*var_ptr));
+        } else if (const auto dres = taylor_decompose_in_place(std::move(sv_ex), u_vars_defs)) {
+            // The sv_func was decomposed, add to sv_funcs_dc
+            // the index of the u variable which represents
+            // the result of the decomposition.
+            sv_funcs_dc.push_back(boost::numeric_cast<std::uint32_t>(dres));
+        } else {
+            // The sv_func was not decomposed, meaning it's a const/param.
+            throw std::invalid_argument(
+                "The extra functions in a Taylor decomposition cannot be constants or parameters");
+        }
+    }
+    assert(sv_funcs_dc.size() == sv_funcs.size());
+
+    // Append the (possibly updated) definitions of the diff equations
+    // in terms of u variables.
+    for (auto &ex : v_ex_copy) {
+        u_vars_defs.emplace_back(std::move(ex), std::vector<std::uint32_t>{});
+    }
+
+#if !defined(NDEBUG)
+    // Verify the decomposition.
+    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
+#endif
+
+    const auto t1 = std::chrono::steady_clock::now();
+
+    // Simplify the decomposition.
+    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, sv_funcs_dc, n_eq);
+
+    const auto t2 = std::chrono::steady_clock::now();
+
+#if !defined(NDEBUG)
+    // Verify the simplified decomposition.
+    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
+#endif
+
+    // Run the breadth-first topological sort on the decomposition.
+    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, sv_funcs_dc, n_eq);
+
+    detail::taylor_decompose_log_timings(u_vars_defs, t0, t1, t2, std::chrono::steady_clock::now());
+
+#if !defined(NDEBUG)
+    // Verify the reordered decomposition.
+    detail::verify_taylor_dec(orig_v_ex, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
+#endif
+
+    return std::make_pair(std::move(u_vars_defs), std::move(sv_funcs_dc));
+}
+
+// Taylor decomposition from lhs and rhs
+// of a system of equations.
+std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_decompose(std::vector<std::pair<expression, expression>> sys,
+                                                                    std::vector<expression> sv_funcs)
+{
+    detail::trace_span span("taylor_decompose", "taylor");
+
+    if (sys.empty()) {
+        throw std::invalid_argument("Cannot decompose a system of zero equations");
+    }
+
+    // Determine the variables in the system of equations
+    // from the lhs of the equations. We need to ensure that:
+    // - all the lhs expressions are variables
+    //   and there are no duplicates,
+    // - all the variables in the rhs expressions
+    //   appear in the lhs expressions.
+    // Note that not all variables in the lhs
+    // need to appear in the rhs.
+
+    // This will eventually contain the list
+    // of all variables in the system.
+    std::vector<std::string> lhs_vars;
+    // Maintain a set as well to check for duplicates.
+    std::unordered_set<std::string> lhs_vars_set;
+    // The set of variables in the rhs.
+    std::unordered_set<std::string> rhs_vars_set;
+
+    for (const auto &p : sys) {
+        const auto &lhs = p.first;
+        const auto &rhs = p.second;
+
+        // Infer the variable from the current lhs.
+        std::visit(
+            [&lhs, &lhs_vars, &lhs_vars_set](const auto &v) {
+                if constexpr (std::is_same_v<detail::uncvref_t<decltype(v)>, variable>) {
+                    // Check if this is a duplicate variable.
+                    if (auto res = lhs_vars_set.emplace(v.name()); res.second) {
+                        // Not a duplicate, add it to lhs_vars.
+                        lhs_vars.emplace_back(v.name());
+                    } else {
+                        // Duplicate, error out.
+                        throw std::invalid_argument(
+                            "Error in the Taylor decomposition of a system of equations: the variable '{}' "
+                            "appears in the left-hand side twice"_format(v.name()));
+                    }
+                } else {
+                    throw std::invalid_argument(
+                        "Error in the Taylor decomposition of a system of equations: the "
+                        "left-hand side contains the expression '{}', which is not a variable"_format(lhs));
+                }
+            },
+            lhs.value());
+
+        // Update the global list of variables
+        // for the rhs.
+        for (auto &var : get_variables(rhs)) {
+            rhs_vars_set.emplace(std::move(var));
+        }
+    }
+
+    // Check that all variables in the rhs appear in the lhs.
+    for (const auto &var : rhs_vars_set) {
+        if (lhs_vars_set.find(var) == lhs_vars_set.end()) {
+            throw std::invalid_argument("Error in the Taylor decomposition of a system of equations: the variable '{}' "
+                                        "appears in the right-hand side but not in the left-hand side"_format(var));
+        }
+    }
+
+    // Check that the expressions in sv_funcs contain only
+    // state variables.
+    for (const auto &ex : sv_funcs) {
+        for (const auto &var : get_variables(ex)) {
+            if (lhs_vars_set.find(var) == lhs_vars_set.end()) {
+                throw std::invalid_argument("The extra functions in a Taylor decomposition contain the variable '{}', "
+                                            "which is not a state variable"_format(var));
+            }
+        }
+    }
+
+    // Cache the number of equations/variables.
+    const auto n_eq = sys.size();
+    assert(n_eq == lhs_vars.size());
+
+    // Create the map for renaming the variables to u_i.
+    // The renaming will be done following the order of the lhs
+    // variables.
+    std::unordered_map<std::string, std::string> repl_map;
+    for (decltype(lhs_vars.size()) i = 0; i < lhs_vars.size(); ++i) {
+        [[maybe_unused]] const auto eres = repl_map.emplace(lhs_vars[i], "u_{}"_format(i));
+        assert(eres.second);
+    }
+
+#if !defined(NDEBUG)
+    // Store a copy of the original rhs and sv_funcs
+    // for checking later.
+    std::vector<expression> orig_rhs;
+    orig_rhs.reserve(sys.size());
+    for (const auto &[_, rhs_ex] : sys) {
+        orig_rhs.push_back(rhs_ex);
+    }
+    const auto orig_sv_funcs = sv_funcs;
+#endif
+
+    // Rename the variables in the original equations.
+    for (auto &[_, rhs_ex] : sys) {
+        rename_variables(rhs_ex, repl_map);
+    }
+
+    // Rename the variables in sv_funcs.
+    for (auto &ex : sv_funcs) {
+        rename_variables(ex, repl_map);
+    }
+
+    // Init the decomposition. It begins with a list
+    // of the original lhs variables of the system.
+    taylor_dc_t u_vars_defs;
+    u_vars_defs.reserve(lhs_vars.size());
+    for (const auto &var : lhs_vars) {
+        u_vars_defs.emplace_back(variable{var}, std::vector<std::uint32_t>{});
+    }
+
+    // Create a copy of the original equations in terms of u variables.
+    // We will be reusing this below.
+    auto sys_copy = sys;
+
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Run the decomposition on each equation.
+    std::vector<expression> rhs_ex;
+    rhs_ex.reserve(sys.size());
+    for (auto &[_, rhs] : sys) {
+        rhs_ex.push_back(std::move(rhs));
+    }
+    const auto v_dres = detail::taylor_decompose_eqs(rhs_ex, u_vars_defs);
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        if (const auto dres = v_dres[i]) {
+            // NOTE: if the equation was decomposed
             // (that is, it is not constant or a single variable),
             // we have to update the original definition
             // of the equation in sys_copy
@@ -1177,3091 +2011,7771 @@ std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_decompose(std::vector<
         }
     }
 
-    // Decompose sv_funcs, and write into sv_funcs_dc the index
-    // of the u variable which each sv_func corresponds to.
-    std::vector<std::uint32_t> sv_funcs_dc;
-    for (auto &sv_ex : sv_funcs) {
-        if (auto *const var_ptr = std::get_if<variable>(&sv_ex.value())) {
-            // The current sv_func is a variable, add its index to sv_funcs_dc.
-            sv_funcs_dc.push_back(detail::uname_to_index(var_ptr->name()));
-        } else if (const auto dres = taylor_decompose_in_place(std::move(sv_ex), u_vars_defs)) {
-            // The sv_func was decomposed, add to sv_funcs_dc
-            // the index of the u variable which represents
-            // the result of the decomposition.
-            sv_funcs_dc.push_back(boost::numeric_cast<std::uint32_t>(dres));
-        } else {
-            // The sv_func was not decomposed, meaning it's a const/param.
-            throw std::invalid_argument(
-                "The extra functions in a Taylor decomposition cannot be constants or parameters");
-        }
+    // Decompose sv_funcs, and write into sv_funcs_dc the index
+    // of the u variable which each sv_func corresponds to.
+    std::vector<std::uint32_t> sv_funcs_dc;
+    for (auto &sv_ex : sv_funcs) {
+        if (auto *const var_ptr = std::get_if<variable>(&sv_ex.value())) {
+            // The current sv_func is a variable, add its index to sv_funcs_dc.
+            sv_funcs_dc.push_back(detail::uname_to_index(*var_ptr));
+        } else if (const auto dres = taylor_decompose_in_place(std::move(sv_ex), u_vars_defs)) {
+            // The sv_func was decomposed, add to sv_funcs_dc
+            // the index of the u variable which represents
+            // the result of the decomposition.
+            sv_funcs_dc.push_back(boost::numeric_cast<std::uint32_t>(dres));
+        } else {
+            // The sv_func was not decomposed, meaning it's a const/param.
+            throw std::invalid_argument(
+                "The extra functions in a Taylor decomposition cannot be constants or parameters");
+        }
+    }
+    assert(sv_funcs_dc.size() == sv_funcs.size());
+
+    // Append the (possibly updated) definitions of the diff equations
+    // in terms of u variables.
+    for (auto &[_, rhs] : sys_copy) {
+        u_vars_defs.emplace_back(std::move(rhs), std::vector<std::uint32_t>{});
+    }
+
+#if !defined(NDEBUG)
+    // Verify the decomposition.
+    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
+#endif
+
+    const auto t1 = std::chrono::steady_clock::now();
+
+    // Simplify the decomposition.
+    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, sv_funcs_dc, n_eq);
+
+    const auto t2 = std::chrono::steady_clock::now();
+
+#if !defined(NDEBUG)
+    // Verify the simplified decomposition.
+    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
+#endif
+
+    // Run the breadth-first topological sort on the decomposition.
+    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, sv_funcs_dc, n_eq);
+
+    detail::taylor_decompose_log_timings(u_vars_defs, t0, t1, t2, std::chrono::steady_clock::now());
+
+#if !defined(NDEBUG)
+    // Verify the reordered decomposition.
+    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
+    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
+#endif
+
+    return std::make_pair(std::move(u_vars_defs), std::move(sv_funcs_dc));
+}
+
+// Determine the state variables of the Taylor decomposition dc (of a system
+// of n_eq equations) which are one-way coupled to the rest of the system. A state
+// variable x_i is one-way coupled if its dynamics depends (directly or indirectly)
+// on a state variable x_j whose dynamics does not depend on x_i. A typical example
+// are the variational equations, which depend on the original dynamics without
+// influencing it. The return value contains the indices of the one-way coupled
+// state variables, in ascending order.
+// NOTE: x_i is one-way coupled if and only if, in the dependency graph of the
+// u variables, the strongly connected component of x_i can reach another
+// strongly connected component containing a state variable.
+std::vector<std::uint32_t> taylor_one_way_states(const taylor_dc_t &dc, std::uint32_t n_eq)
+{
+    if (dc.size() < 2u * static_cast<taylor_dc_t::size_type>(n_eq)) {
+        throw std::invalid_argument("Invalid Taylor decomposition detected in taylor_one_way_states(): the "
+                                    "decomposition has a size of {}, but the number of equations is {}"_format(
+                                        dc.size(), n_eq));
+    }
+
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    // Build the dependency graph of the u variables: the node i is connected to the
+    // nodes of the u variables appearing in the definition of u_i. For the state
+    // variables, the definition is the right-hand side of the differential equation.
+    std::vector<std::vector<std::uint32_t>> graph(n_uvars);
+    for (std::uint32_t i = 0; i < n_uvars; ++i) {
+        detail::taylor_dc_uvars_indices(graph[i], i < n_eq ? dc[n_uvars + i].first : dc[i].first);
+    }
+
+    // Determine the strongly connected components via an iterative
+    // version of Tarjan's algorithm. The components are completed in reverse
+    // topological order, that is, when a component is completed all the components
+    // reachable from it have already been completed.
+    constexpr auto unvisited = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> index(n_uvars, unvisited), lowlink(n_uvars), comp(n_uvars, unvisited);
+    std::vector<std::uint32_t> stack, members;
+    std::vector<bool> on_stack(n_uvars);
+    // The DFS stack: node index and index of the next edge to be explored.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> dfs;
+    std::uint32_t counter = 0;
+
+    // For each component, flags signalling whether it contains a state
+    // variable and whether it can reach another component containing
+    // a state variable.
+    std::vector<bool> has_state, reaches_state;
+
+    auto visit = [&](std::uint32_t v) {
+        index[v] = lowlink[v] = counter++;
+        stack.push_back(v);
+        on_stack[v] = true;
+        dfs.emplace_back(v, 0);
+    };
+
+    for (std::uint32_t root = 0; root < n_uvars; ++root) {
+        if (index[root] != unvisited) {
+            continue;
+        }
+
+        visit(root);
+
+        while (!dfs.empty()) {
+            const auto v = dfs.back().first;
+
+            if (dfs.back().second < graph[v].size()) {
+                const auto w = graph[v][dfs.back().second++];
+
+                if (index[w] == unvisited) {
+                    visit(w);
+                } else if (on_stack[w]) {
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+                }
+
+                continue;
+            }
+
+            // All the edges of v have been explored.
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                auto &lw = lowlink[dfs.back().first];
+                lw = std::min(lw, lowlink[v]);
+            }
+
+            if (lowlink[v] != index[v]) {
+                continue;
+            }
+
+            // v is the root of a component, pop it from the stack.
+            const auto c = boost::numeric_cast<std::uint32_t>(has_state.size());
+            has_state.push_back(false);
+            reaches_state.push_back(false);
+
+            members.clear();
+            std::uint32_t w = 0;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                on_stack[w] = false;
+                comp[w] = c;
+                members.push_back(w);
+                if (w < n_eq) {
+                    has_state[c] = true;
+                }
+            } while (w != v);
+
+            for (auto m : members) {
+                for (auto x : graph[m]) {
+                    if (const auto cx = comp[x]; cx != c && (has_state[cx] || reaches_state[cx])) {
+                        reaches_state[c] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> retval;
+    for (std::uint32_t i = 0; i < n_eq; ++i) {
+        if (reaches_state[comp[i]]) {
+            retval.push_back(i);
+        }
+    }
+
+    return retval;
+}
+
+// Determine the u variables of the Taylor decomposition dc (of a system of n_eq
+// equations) whose Taylor derivatives depend on the runtime parameters. A u variable depends
+// on the runtime parameters if its definition (or, for the state variables, the right-hand side
+// of the differential equation) contains a parameter, or if it depends (directly or indirectly)
+// on a u variable which depends on the runtime parameters. The return value contains the indices
+// of the parameter-dependent u variables, in ascending order.
+// NOTE: the derivatives of the other u variables are not affected by changes in the values
+// of the parameters, and, for a fixed initial state, they can be reused between propagations.
+std::vector<std::uint32_t> taylor_par_dep_uvars(const taylor_dc_t &dc, std::uint32_t n_eq)
+{
+    if (dc.size() < 2u * static_cast<taylor_dc_t::size_type>(n_eq)) {
+        throw std::invalid_argument("Invalid Taylor decomposition detected in taylor_par_dep_uvars(): the "
+                                    "decomposition has a size of {}, but the number of equations is {}"_format(
+                                        dc.size(), n_eq));
+    }
+
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    // Build the reverse dependency graph of the u variables: the node i
+    // is connected to the nodes of the u variables whose definitions contain u_i.
+    // At the same time, flag the u variables which depend directly on the parameters.
+    std::vector<std::vector<std::uint32_t>> rgraph(n_uvars);
+    std::vector<std::uint32_t> deps, stack;
+    std::vector<bool> par_dep(n_uvars);
+    for (std::uint32_t i = 0; i < n_uvars; ++i) {
+        const auto &ex = i < n_eq ? dc[n_uvars + i].first : dc[i].first;
+
+        deps.clear();
+        detail::taylor_dc_uvars_indices(deps, ex);
+        for (auto j : deps) {
+            rgraph[j].push_back(i);
+        }
+
+        if (get_param_size(ex) > 0u) {
+            par_dep[i] = true;
+            stack.push_back(i);
+        }
+    }
+
+    // Propagate the dependency along the reverse edges.
+    while (!stack.empty()) {
+        const auto v = stack.back();
+        stack.pop_back();
+
+        for (auto w : rgraph[v]) {
+            if (!par_dep[w]) {
+                par_dep[w] = true;
+                stack.push_back(w);
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> retval;
+    for (std::uint32_t i = 0; i < n_uvars; ++i) {
+        if (par_dep[i]) {
+            retval.push_back(i);
+        }
+    }
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to check the structure of a deserialised Taylor decomposition
+// of a system of n_eq equations. These are the same structural checks
+// performed by verify_taylor_dec(), without the reconstruction of the
+// original system (which is not available). The checks guarantee that
+// all the indices in the decomposition are valid.
+void taylor_check_dc(std::uint32_t n_eq, const taylor_dc_t &dc, const std::vector<std::uint32_t> &sv_funcs_dc)
+{
+    auto error = [](const std::string &msg) {
+        throw std::invalid_argument("Invalid Taylor decomposition detected during deserialisation: " + msg);
+    };
+
+    if (n_eq == 0u) {
+        error("the number of equations is zero");
+    }
+
+    if (dc.size() / 2u < n_eq || dc.size() > std::numeric_limits<std::uint32_t>::max()) {
+        error("the decomposition has a size of {}, but the number of equations is {}"_format(dc.size(), n_eq));
+    }
+
+    const auto n_uvars = dc.size() - n_eq;
+
+    // Check that an expression is either a number/param or a
+    // u variable whose index is less than max_idx.
+    auto check_arg = [&error](const expression &ex, taylor_dc_t::size_type max_idx) {
+        if (const auto *p_var = std::get_if<variable>(&ex.value())) {
+            const auto &name = p_var->name();
+
+            std::uint32_t idx = 0;
+            if (name.rfind("u_", 0) != 0) {
+                error("the variable '{}' is not a u variable"_format(name));
+            }
+            const auto ret = std::from_chars(name.data() + 2, name.data() + name.size(), idx);
+            if (ret.ec != std::errc{} || ret.ptr != name.data() + name.size() || idx >= max_idx) {
+                error("the u variable '{}' is invalid"_format(name));
+            }
+        } else if (std::holds_alternative<func>(ex.value())) {
+            error("an argument of a u variable definition is a function");
+        }
+    };
+
+    for (taylor_dc_t::size_type i = 0; i < dc.size(); ++i) {
+        const auto &[ex, deps] = dc[i];
+
+        if (i < n_eq || i >= n_uvars) {
+            // The state variables and the rhs of the equations: no hidden
+            // dependencies, the state variables must be variables, the
+            // rhs of the equations u variables or numbers/params.
+            if (!deps.empty()) {
+                error("hidden dependencies are associated to the u variable at index {}"_format(i));
+            }
+
+            if (i < n_eq) {
+                if (!std::holds_alternative<variable>(ex.value())) {
+                    error("the u variable at index {} is not a state variable"_format(i));
+                }
+            } else {
+                check_arg(ex, n_uvars);
+            }
+        } else {
+            // The definitions of the u variables: functions whose
+            // arguments are u variables with a lower index or numbers/params.
+            const auto *f = std::get_if<func>(&ex.value());
+            if (f == nullptr) {
+                error("the definition of the u variable at index {} is not a function"_format(i));
+            }
+
+            for (const auto &arg : f->args()) {
+                check_arg(arg, i);
+            }
+
+            for (auto idx : deps) {
+                if (idx < n_eq || idx >= n_uvars || idx == i) {
+                    error("the u variable at index {} has an invalid hidden dependency {}"_format(i, idx));
+                }
+            }
+        }
+    }
+
+    for (auto idx : sv_funcs_dc) {
+        if (idx >= n_uvars) {
+            error("the sv function index {} is invalid"_format(idx));
+        }
+    }
+}
+
+} // namespace
+
+} // namespace detail
+
+taylor_precomputed_dc::taylor_precomputed_dc() = default;
+
+taylor_precomputed_dc::taylor_precomputed_dc(std::vector<expression> sys, std::vector<expression> sv_funcs)
+    : m_n_eq(boost::numeric_cast<std::uint32_t>(sys.size()))
+{
+    std::tie(m_dc, m_sv_funcs_dc) = taylor_decompose(std::move(sys), std::move(sv_funcs));
+}
+
+taylor_precomputed_dc::taylor_precomputed_dc(std::vector<std::pair<expression, expression>> sys,
+                                             std::vector<expression> sv_funcs)
+    : m_n_eq(boost::numeric_cast<std::uint32_t>(sys.size()))
+{
+    std::tie(m_dc, m_sv_funcs_dc) = taylor_decompose(std::move(sys), std::move(sv_funcs));
+}
+
+std::uint32_t taylor_precomputed_dc::get_n_eq() const
+{
+    return m_n_eq;
+}
+
+const taylor_dc_t &taylor_precomputed_dc::get_decomposition() const
+{
+    return m_dc;
+}
+
+const std::vector<std::uint32_t> &taylor_precomputed_dc::get_sv_funcs_dc() const
+{
+    return m_sv_funcs_dc;
+}
+
+void taylor_precomputed_dc::save(std::ostream &os) const
+{
+    detail::s11n_save_header(os, "taylor_precomputed_dc", 1);
+
+    detail::s11n_save(os, m_n_eq);
+    detail::s11n_save(os, m_dc);
+    detail::s11n_save(os, m_sv_funcs_dc);
+}
+
+taylor_precomputed_dc taylor_precomputed_dc::load(std::istream &is)
+{
+    detail::s11n_load_header(is, "taylor_precomputed_dc", 1);
+
+    taylor_precomputed_dc retval;
+
+    detail::s11n_load(is, retval.m_n_eq);
+    detail::s11n_load(is, retval.m_dc);
+    detail::s11n_load(is, retval.m_sv_funcs_dc);
+
+    detail::taylor_check_dc(retval.m_n_eq, retval.m_dc, retval.m_sv_funcs_dc);
+
+    return retval;
+}
+
+namespace detail
+{
+
+namespace
+{
+
+// Helper to determine the optimal Taylor order for a given tolerance,
+// following Jorba's prescription.
+template <typename T>
+std::uint32_t taylor_order_from_tol(T tol)
+{
+    using std::ceil;
+    using std::isfinite;
+    using std::log;
+
+    // Determine the order from the tolerance.
+    auto order_f = ceil(-log(tol) / 2 + 1);
+    if (!isfinite(order_f)) {
+        throw std::invalid_argument(
+            "The computation of the Taylor order in an adaptive Taylor stepper produced a non-finite value");
+    }
+    // NOTE: min order is 2.
+    order_f = std::max(T(2), order_f);
+
+    // NOTE: cast to double as that ensures that the
+    // max of std::uint32_t is exactly representable.
+    // LCOV_EXCL_START
+    if (order_f > static_cast<double>(std::numeric_limits<std::uint32_t>::max())) {
+        throw std::overflow_error("The computation of the Taylor order in an adaptive Taylor stepper resulted "
+                                  "in an overflow condition");
+    }
+    // LCOV_EXCL_STOP
+    return static_cast<std::uint32_t>(order_f);
+}
+
+// Helper to determine the Taylor order of an adaptive Taylor stepper. If req_order
+// is nonzero, it is used in place of the order deduced from the tolerance. The second
+// return value is the tolerance to be passed to taylor_determine_h(): it is zero
+// if the order coincides with the one deduced from the tolerance.
+template <typename T>
+std::pair<std::uint32_t, T> taylor_stepper_order(T tol, std::uint32_t req_order)
+{
+    const auto tol_order = taylor_order_from_tol(tol);
+
+    if (req_order == 0u || req_order == tol_order) {
+        return {tol_order, T(0)};
+    }
+
+    if (req_order < 2u) {
+        throw std::invalid_argument("The Taylor order of an adaptive Taylor integrator must be at least 2, but "
+                                    "an order of {} was specified"_format(req_order));
+    }
+
+    return {req_order, tol};
+}
+
+// Helper to determine the tolerances to be passed to taylor_determine_h().
+// h_tol is the tolerance returned by taylor_stepper_order(), lane_tols
+// the (optional) tolerances of the batch elements.
+// NOTE: with per-batch-element tolerances, the tolerances are always
+// accounted for explicitly, as the order is deduced from the tightest one.
+template <typename T>
+std::vector<T> taylor_h_tols(T h_tol, const std::vector<T> &lane_tols, std::uint32_t batch_size)
+{
+    if (!lane_tols.empty()) {
+        assert(lane_tols.size() == batch_size);
+
+        return lane_tols;
+    }
+
+    if (h_tol == 0) {
+        return {};
+    }
+
+    return std::vector<T>(boost::numeric_cast<typename std::vector<T>::size_type>(batch_size), h_tol);
+}
+
+// Helper to compute max(x_v, abs(y_v)) in the Taylor stepper implementation.
+llvm::Value *taylor_step_maxabs(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
+{
+#if defined(HEYOKA_HAVE_REAL128)
+    // Determine the scalar type of the vector arguments.
+    auto *x_t = x_v->getType()->getScalarType();
+
+    if (x_t == llvm::Type::getFP128Ty(s.context())) {
+        // NOTE: for __float128 we cannot use the intrinsic, we need
+        // to call an external function.
+        auto &builder = s.builder();
+
+        // Convert the vector arguments to scalars.
+        auto x_scalars = vector_to_scalars(builder, x_v), y_scalars = vector_to_scalars(builder, y_v);
+
+        // Execute the heyoka_maxabs128() function on the scalar values and store
+        // the results in res_scalars.
+        std::vector<llvm::Value *> res_scalars;
+        for (decltype(x_scalars.size()) i = 0; i < x_scalars.size(); ++i) {
+            res_scalars.push_back(llvm_invoke_external(
+                s, "heyoka_maxabs128", x_t, {x_scalars[i], y_scalars[i]},
+                // NOTE: in theory we may add ReadNone here as well,
+                // but for some reason, at least up to LLVM 10,
+                // this causes strange codegen issues. Revisit
+                // in the future.
+                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
+        }
+
+        // Reconstruct the return value as a vector.
+        return scalars_to_vector(builder, res_scalars);
+    } else {
+#endif
+        // Compute abs(b).
+        auto *abs_y_v = llvm_invoke_intrinsic(s, "llvm.fabs", {y_v->getType()}, {y_v});
+        // Return max(a, abs(b)).
+        return llvm_invoke_intrinsic(s, "llvm.maxnum", {x_v->getType()}, {x_v, abs_y_v});
+#if defined(HEYOKA_HAVE_REAL128)
+    }
+#endif
+}
+
+// Helper to compute min(x_v, abs(y_v)) in the Taylor stepper implementation.
+llvm::Value *taylor_step_minabs(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
+{
+#if defined(HEYOKA_HAVE_REAL128)
+    // Determine the scalar type of the vector arguments.
+    auto *x_t = x_v->getType()->getScalarType();
+
+    if (x_t == llvm::Type::getFP128Ty(s.context())) {
+        // NOTE: for __float128 we cannot use the intrinsic, we need
+        // to call an external function.
+        auto &builder = s.builder();
+
+        // Convert the vector arguments to scalars.
+        auto x_scalars = vector_to_scalars(builder, x_v), y_scalars = vector_to_scalars(builder, y_v);
+
+        // Execute the heyoka_minabs128() function on the scalar values and store
+        // the results in res_scalars.
+        std::vector<llvm::Value *> res_scalars;
+        for (decltype(x_scalars.size()) i = 0; i < x_scalars.size(); ++i) {
+            res_scalars.push_back(llvm_invoke_external(
+                s, "heyoka_minabs128", x_t, {x_scalars[i], y_scalars[i]},
+                // NOTE: in theory we may add ReadNone here as well,
+                // but for some reason, at least up to LLVM 10,
+                // this causes strange codegen issues. Revisit
+                // in the future.
+                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
+        }
+
+        // Reconstruct the return value as a vector.
+        return scalars_to_vector(builder, res_scalars);
+    } else {
+#endif
+        // Compute abs(b).
+        auto *abs_y_v = llvm_invoke_intrinsic(s, "llvm.fabs", {y_v->getType()}, {y_v});
+        // Return min(a, abs(b)).
+        return llvm_invoke_intrinsic(s, "llvm.minnum", {x_v->getType()}, {x_v, abs_y_v});
+#if defined(HEYOKA_HAVE_REAL128)
+    }
+#endif
+}
+
+// Helper to compute the unary function name ("log" or "exp") of x_v
+// in the Taylor stepper implementation.
+llvm::Value *taylor_step_unary_fn(llvm_state &s, const std::string &name, llvm::Value *x_v)
+{
+    assert(name == "log" || name == "exp");
+
+#if defined(HEYOKA_HAVE_REAL128)
+    // Determine the scalar type of the vector argument.
+    auto *x_t = x_v->getType()->getScalarType();
+
+    if (x_t == llvm::Type::getFP128Ty(s.context())) {
+        // NOTE: for __float128 we cannot use the intrinsic, we need
+        // to call an external function.
+        auto &builder = s.builder();
+
+        // Convert the vector argument to scalars.
+        auto x_scalars = vector_to_scalars(builder, x_v);
+
+        // Execute the function on the scalar values and store
+        // the results in res_scalars.
+        std::vector<llvm::Value *> res_scalars;
+        for (auto *x_scal : x_scalars) {
+            res_scalars.push_back(llvm_invoke_external(
+                s, name + "q", llvm::Type::getFP128Ty(s.context()), {x_scal},
+                // NOTE: in theory we may add ReadNone here as well,
+                // but for some reason, at least up to LLVM 10,
+                // this causes strange codegen issues. Revisit
+                // in the future.
+                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
+        }
+
+        // Reconstruct the return value as a vector.
+        return scalars_to_vector(builder, res_scalars);
+    } else {
+#endif
+        // If we are operating on SIMD vectors, try to see if we have a sleef
+        // function available.
+        if (auto *vec_t = llvm::dyn_cast<llvm::VectorType>(x_v->getType())) {
+            // NOTE: if sfn ends up empty, we will be falling through
+            // below and use the LLVM intrinsic instead.
+            if (const auto sfn = sleef_function_name(s.context(), name, vec_t->getElementType(),
+                                                     boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
+                !sfn.empty()) {
+                return llvm_invoke_external(
+                    s, sfn, vec_t, {x_v},
+                    // NOTE: in theory we may add ReadNone here as well,
+                    // but for some reason, at least up to LLVM 10,
+                    // this causes strange codegen issues. Revisit
+                    // in the future.
+                    {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
+            }
+        }
+
+        return llvm_invoke_intrinsic(s, "llvm." + name, {x_v->getType()}, {x_v});
+#if defined(HEYOKA_HAVE_REAL128)
+    }
+#endif
+}
+
+// Create a global read-only array containing the values in sv_funcs_dc, if any
+// (otherwise, the return value will be null). This is for use in the adaptive steppers
+// when employing compact mode.
+llvm::Value *taylor_c_make_sv_funcs_arr(llvm_state &s, const std::vector<std::uint32_t> &sv_funcs_dc)
+{
+    auto &builder = s.builder();
+
+    if (sv_funcs_dc.empty()) {
+        return nullptr;
+    } else {
+        auto *arr_type = llvm::ArrayType::get(llvm::Type::getInt32Ty(s.context()),
+                                              boost::numeric_cast<std::uint64_t>(sv_funcs_dc.size()));
+        std::vector<llvm::Constant *> sv_funcs_dc_const;
+        sv_funcs_dc_const.reserve(sv_funcs_dc.size());
+        for (auto idx : sv_funcs_dc) {
+            sv_funcs_dc_const.emplace_back(builder.getInt32(idx));
+        }
+        auto *sv_funcs_dc_arr = llvm::ConstantArray::get(arr_type, sv_funcs_dc_const);
+        auto *g_sv_funcs_dc = new llvm::GlobalVariable(s.module(), sv_funcs_dc_arr->getType(), true,
+                                                       llvm::GlobalVariable::InternalLinkage, sv_funcs_dc_arr);
+
+        // Get out a pointer to the beginning of the array.
+        return builder.CreateInBoundsGEP(g_sv_funcs_dc, {builder.getInt32(0), builder.getInt32(0)});
+    }
+}
+
+// Helper to determine the indices of the state variables that are used in the
+// computation of the timestep. If h_vars is not empty, only the state variables
+// in h_vars are used. If skip_one_way is true, the one-way coupled state variables
+// are excluded (see taylor_one_way_states()). If all state variables are used,
+// an empty vector is returned.
+std::vector<std::uint32_t> taylor_h_states(const taylor_dc_t &dc, std::uint32_t n_eq, bool skip_one_way,
+                                           const std::vector<expression> &h_vars)
+{
+    assert(dc.size() >= 2u * static_cast<taylor_dc_t::size_type>(n_eq));
+
+    // Init the mask of the state variables used for the timestep.
+    std::vector<bool> mask(n_eq, h_vars.empty());
+
+    for (const auto &ex : h_vars) {
+        const auto *var_ptr = std::get_if<variable>(&ex.value());
+        if (var_ptr == nullptr) {
+            throw std::invalid_argument(
+                "The list of variables for the timestep control in an adaptive Taylor integrator can contain only "
+                "variables, but the expression '{}' was detected instead"_format(ex));
+        }
+
+        // NOTE: the first n_eq elements of the decomposition
+        // are the state variables, in order.
+        const auto it = std::find_if(dc.begin(), dc.begin() + n_eq,
+                                     [var_ptr](const auto &p) { return p.first == expression{*var_ptr}; });
+        if (it == dc.begin() + n_eq) {
+            throw std::invalid_argument("The variable '{}' in the list of variables for the timestep control in an "
+                                        "adaptive Taylor integrator is not a state variable"_format(ex));
+        }
+
+        mask[static_cast<decltype(mask.size())>(it - dc.begin())] = true;
+    }
+
+    if (skip_one_way) {
+        for (auto idx : taylor_one_way_states(dc, n_eq)) {
+            mask[idx] = false;
+        }
+    }
+
+    if (std::none_of(mask.begin(), mask.end(), [](bool b) { return b; })) {
+        throw std::invalid_argument(
+            "No state variable is left for the timestep control in an adaptive Taylor integrator: the variables "
+            "selected for the timestep control are all one-way coupled to the rest of the system");
+    }
+
+    if (std::all_of(mask.begin(), mask.end(), [](bool b) { return b; })) {
+        return {};
+    }
+
+    std::vector<std::uint32_t> retval;
+    for (std::uint32_t i = 0; i < n_eq; ++i) {
+        if (mask[i]) {
+            retval.push_back(i);
+        }
+    }
+
+    return retval;
+}
+
+// Helper to determine the indices of the state variables in ha_vars, which are
+// updated via compensated summation in the stepper (see taylor_run_sel_ceval()).
+// The indices are returned in ascending order, without duplicates.
+std::vector<std::uint32_t> taylor_ha_states(const taylor_dc_t &dc, std::uint32_t n_eq,
+                                            const std::vector<expression> &ha_vars)
+{
+    assert(dc.size() >= 2u * static_cast<taylor_dc_t::size_type>(n_eq));
+
+    std::vector<bool> mask(n_eq, false);
+
+    for (const auto &ex : ha_vars) {
+        const auto *var_ptr = std::get_if<variable>(&ex.value());
+        if (var_ptr == nullptr) {
+            throw std::invalid_argument(
+                "The list of variables for the high-accuracy mode in an adaptive Taylor integrator can contain only "
+                "variables, but the expression '{}' was detected instead"_format(ex));
+        }
+
+        // NOTE: the first n_eq elements of the decomposition
+        // are the state variables, in order.
+        const auto it = std::find_if(dc.begin(), dc.begin() + n_eq,
+                                     [var_ptr](const auto &p) { return p.first == expression{*var_ptr}; });
+        if (it == dc.begin() + n_eq) {
+            throw std::invalid_argument("The variable '{}' in the list of variables for the high-accuracy mode in an "
+                                        "adaptive Taylor integrator is not a state variable"_format(ex));
+        }
+
+        mask[static_cast<decltype(mask.size())>(it - dc.begin())] = true;
+    }
+
+    std::vector<std::uint32_t> retval;
+    for (std::uint32_t i = 0; i < n_eq; ++i) {
+        if (mask[i]) {
+            retval.push_back(i);
+        }
+    }
+
+    return retval;
+}
+
+// Helper to generate the LLVM code to determine the timestep in an adaptive Taylor integrator,
+// following Jorba's prescription. diff_variant is the output of taylor_compute_jet(), and it contains
+// the jet of derivatives for the state variables and the sv_funcs. h_ptr is a pointer containing
+// the clamping values for the timesteps. svf_ptr is a pointer to an LLVM array containing the
+// values in sv_funcs_dc. h_states contains the indices of the state variables which are
+// considered for the determination of the timestep (if empty, all state variables are considered).
+// If tols is not empty, it contains the tolerances of the batch elements, which are
+// explicitly accounted for in the estimation of rho (see below and taylor_h_tols()).
+template <typename T>
+llvm::Value *
+taylor_determine_h(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_variant,
+                   const std::vector<std::uint32_t> &sv_funcs_dc, llvm::Value *svf_ptr, llvm::Value *h_ptr,
+                   std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size,
+                   const std::vector<std::uint32_t> &h_states = {}, const std::vector<T> &tols = {})
+{
+    assert(batch_size != 0u);
+    assert(tols.empty() || tols.size() == batch_size);
+    assert(std::all_of(h_states.begin(), h_states.end(), [n_eq](auto idx) { return idx < n_eq; }));
+#if !defined(NDEBUG)
+    if (diff_variant.index() == 0u) {
+        // Compact mode.
+        assert(sv_funcs_dc.empty() == !svf_ptr);
+    } else {
+        // Non-compact mode.
+        assert(svf_ptr == nullptr);
+    }
+#endif
+
+    using std::exp;
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    llvm::Value *max_abs_state = nullptr, *max_abs_diff_o = nullptr, *max_abs_diff_om1 = nullptr;
+
+    if (diff_variant.index() == 0u) {
+        // Compact mode.
+        auto *diff_arr = std::get<llvm::Value *>(diff_variant);
+
+        // These will end up containing the norm infinity of the state vector + sv_funcs and the
+        // norm infinity of the derivatives at orders order and order - 1.
+        auto vec_t = to_llvm_vector_type<T>(context, batch_size);
+        max_abs_state = builder.CreateAlloca(vec_t);
+        max_abs_diff_o = builder.CreateAlloca(vec_t);
+        max_abs_diff_om1 = builder.CreateAlloca(vec_t);
+
+        // Create a global read-only array containing the values in h_states, if any
+        // (otherwise, hs_ptr will be null).
+        auto *hs_ptr = taylor_c_make_sv_funcs_arr(s, h_states);
+
+        // Helper to fetch the index of the i-th state variable
+        // considered for the timestep.
+        auto state_idx = [&](llvm::Value *i) -> llvm::Value * {
+            return hs_ptr == nullptr ? i : builder.CreateLoad(builder.CreateInBoundsGEP(hs_ptr, {i}));
+        };
+
+        // Initialise with the abs(derivatives) of the first state variable at orders 0, 'order' and 'order - 1'.
+        auto *first_idx = builder.getInt32(h_states.empty() ? 0 : h_states[0]);
+        builder.CreateStore(llvm_abs(s, taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(0), first_idx)),
+                            max_abs_state);
+        builder.CreateStore(llvm_abs(s, taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), first_idx)),
+                            max_abs_diff_o);
+        builder.CreateStore(
+            llvm_abs(s, taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order - 1u), first_idx)),
+            max_abs_diff_om1);
+
+        // Iterate over the variables to compute the norm infinities.
+        const auto n_h_states = h_states.empty() ? n_eq : boost::numeric_cast<std::uint32_t>(h_states.size());
+        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(n_h_states), [&](llvm::Value *loop_idx) {
+            auto *cur_idx = state_idx(loop_idx);
+
+            builder.CreateStore(
+                taylor_step_maxabs(s, builder.CreateLoad(max_abs_state),
+                                   taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(0), cur_idx)),
+                max_abs_state);
+            builder.CreateStore(
+                taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_o),
+                                   taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_idx)),
+                max_abs_diff_o);
+            builder.CreateStore(
+                taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_om1),
+                                   taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order - 1u), cur_idx)),
+                max_abs_diff_om1);
+        });
+
+        if (svf_ptr != nullptr) {
+            // Consider also the functions of state variables for
+            // the computation of the timestep.
+            llvm_loop_u32(
+                s, builder.getInt32(0), builder.getInt32(boost::numeric_cast<std::uint32_t>(sv_funcs_dc.size())),
+                [&](llvm::Value *arr_idx) {
+                    // Fetch the index value from the array.
+                    auto cur_idx = builder.CreateLoad(builder.CreateInBoundsGEP(svf_ptr, {arr_idx}));
+
+                    builder.CreateStore(
+                        taylor_step_maxabs(s, builder.CreateLoad(max_abs_state),
+                                           taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(0), cur_idx)),
+                        max_abs_state);
+                    builder.CreateStore(
+                        taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_o),
+                                           taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_idx)),
+                        max_abs_diff_o);
+                    builder.CreateStore(taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_om1),
+                                                           taylor_c_load_diff(s, diff_arr, n_uvars,
+                                                                              builder.getInt32(order - 1u), cur_idx)),
+                                        max_abs_diff_om1);
+                });
+        }
+
+        // Load the values for later use.
+        max_abs_state = builder.CreateLoad(max_abs_state);
+        max_abs_diff_o = builder.CreateLoad(max_abs_diff_o);
+        max_abs_diff_om1 = builder.CreateLoad(max_abs_diff_om1);
+    } else {
+        // Non-compact mode.
+        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+
+        const auto n_sv_funcs = static_cast<std::uint32_t>(sv_funcs_dc.size());
+
+        // Compute the norm infinity of the state vector and the norm infinity of the derivatives
+        // at orders order and order - 1. We first create vectors of absolute values and then
+        // compute their maxima.
+        std::vector<llvm::Value *> v_max_abs_state, v_max_abs_diff_o, v_max_abs_diff_om1;
+
+        // NOTE: iterate up to n_eq + n_sv_funcs in order to
+        // consider also the functions of state variables for
+        // the computation of the timestep.
+        for (std::uint32_t i = 0; i < n_eq + n_sv_funcs; ++i) {
+            if (i < n_eq && !h_states.empty() && !std::binary_search(h_states.begin(), h_states.end(), i)) {
+                // The state variable is excluded from the computation of the timestep.
+                continue;
+            }
+
+            v_max_abs_state.push_back(llvm_abs(s, diff_arr[i]));
+            // NOTE: in non-compact mode, diff_arr contains the derivatives only of the
+            // state variables and sv funcs (not all u vars), hence the indexing is
+            // order * (n_eq + n_sv_funcs).
+            v_max_abs_diff_o.push_back(llvm_abs(s, diff_arr[order * (n_eq + n_sv_funcs) + i]));
+            v_max_abs_diff_om1.push_back(llvm_abs(s, diff_arr[(order - 1u) * (n_eq + n_sv_funcs) + i]));
+        }
+
+        // Find the maxima via pairwise reduction.
+        auto reducer = [&s](llvm::Value *a, llvm::Value *b) -> llvm::Value * { return llvm_max(s, a, b); };
+        max_abs_state = pairwise_reduce(v_max_abs_state, reducer);
+        max_abs_diff_o = pairwise_reduce(v_max_abs_diff_o, reducer);
+        max_abs_diff_om1 = pairwise_reduce(v_max_abs_diff_om1, reducer);
+    }
+
+    // Determine if we are in absolute or relative tolerance mode.
+    auto abs_or_rel
+        = builder.CreateFCmpOLE(max_abs_state, vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
+
+    // Estimate rho at orders order - 1 and order.
+    auto num_rho
+        = builder.CreateSelect(abs_or_rel, vector_splat(builder, codegen<T>(s, number{1.}), batch_size), max_abs_state);
+    if (!tols.empty()) {
+        // NOTE: with an order deduced from the tolerance, tol ** (1 / order)
+        // is approximately exp(-2), which is accounted for in rhofac below.
+        // Otherwise, we follow Jorba's general prescription and scale
+        // num_rho by the tolerances.
+        std::vector<llvm::Value *> tols_v;
+        for (const auto &tol : tols) {
+            tols_v.push_back(codegen<T>(s, number{tol}));
+        }
+        num_rho = builder.CreateFMul(num_rho, scalars_to_vector(builder, tols_v));
+    }
+    // NOTE: rho_o = (num_rho / max_abs_diff_o) ** (1 / order) and
+    // rho_om1 = (num_rho / max_abs_diff_om1) ** (1 / (order - 1)). Rather than
+    // computing two pow()s, we take the minimum in logarithmic space and
+    // exponentiate only once, which saves one transcendental function
+    // evaluation per step. The inverse exponents are compile-time constants.
+    auto log_rho_o = builder.CreateFMul(taylor_step_unary_fn(s, "log", builder.CreateFDiv(num_rho, max_abs_diff_o)),
+                                        vector_splat(builder, codegen<T>(s, number{T(1) / order}), batch_size));
+    auto log_rho_om1
+        = builder.CreateFMul(taylor_step_unary_fn(s, "log", builder.CreateFDiv(num_rho, max_abs_diff_om1)),
+                             vector_splat(builder, codegen<T>(s, number{T(1) / (order - 1u)}), batch_size));
+
+    // Take the minimum.
+    auto rho_m = taylor_step_unary_fn(s, "exp", llvm_min(s, log_rho_o, log_rho_om1));
+
+    // Compute the scaling + safety factor.
+    const auto rhofac = !tols.empty() ? exp((T(-7) / T(10)) / (order - 1u))
+                                      : exp((T(-7) / T(10)) / (order - 1u)) / (exp(T(1)) * exp(T(1)));
+
+    // Determine the step size in absolute value.
+    auto h = builder.CreateFMul(rho_m, vector_splat(builder, codegen<T>(s, number{rhofac}), batch_size));
+
+    // Ensure that the step size does not exceed the limit in absolute value.
+    auto *max_h_vec = load_vector_from_memory(builder, h_ptr, batch_size);
+    h = taylor_step_minabs(s, h, max_h_vec);
+
+    // Handle backwards propagation.
+    auto backward = builder.CreateFCmpOLT(max_h_vec, vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+    auto h_fac = builder.CreateSelect(backward, vector_splat(builder, codegen<T>(s, number{-1.}), batch_size),
+                                      vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
+    h = builder.CreateFMul(h_fac, h);
+
+    return h;
+}
+
+// Store the value val as the derivative of order 'order' of the u variable u_idx
+// into the array of Taylor derivatives diff_arr. n_uvars is the total number of u variables.
+void taylor_c_store_diff(llvm_state &s, llvm::Value *diff_arr, std::uint32_t n_uvars, llvm::Value *order,
+                         llvm::Value *u_idx, llvm::Value *val)
+{
+    auto &builder = s.builder();
+
+    // NOTE: overflow check has already been done to ensure that the
+    // total size of diff_arr fits in a 32-bit unsigned integer.
+    auto *ptr = builder.CreateInBoundsGEP(
+        diff_arr, {builder.CreateAdd(builder.CreateMul(order, builder.getInt32(n_uvars)), u_idx)});
+
+    builder.CreateStore(val, ptr);
+}
+
+// Compute the derivative of order "order" of a state variable.
+// ex is the formula for the first-order derivative of the state variable (which
+// is either a u variable or a number/param), n_uvars the number of variables in
+// the decomposition, arr the array containing the derivatives of all u variables
+// up to order - 1.
+template <typename T>
+llvm::Value *taylor_compute_sv_diff(llvm_state &s, const expression &ex, const std::vector<llvm::Value *> &arr,
+                                    llvm::Value *par_ptr, std::uint32_t n_uvars, std::uint32_t order,
+                                    std::uint32_t batch_size)
+{
+    assert(order > 0u);
+
+    auto &builder = s.builder();
+
+    return std::visit(
+        [&](const auto &v) -> llvm::Value * {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, variable>) {
+                // Extract the index of the u variable in the expression
+                // of the first-order derivative.
+                const auto u_idx = uname_to_index(v);
+
+                // Fetch from arr the derivative
+                // of order 'order - 1' of the u variable at u_idx. The index is:
+                // (order - 1) * n_uvars + u_idx.
+                auto ret = taylor_fetch_diff(arr, u_idx, order - 1u, n_uvars);
+
+                // We have to divide the derivative by order
+                // to get the normalised derivative of the state variable.
+                return builder.CreateFDiv(
+                    ret, vector_splat(builder, codegen<T>(s, number(static_cast<T>(order))), batch_size));
+            } else if constexpr (std::is_same_v<type, number> || std::is_same_v<type, param>) {
+                // The first-order derivative is a constant.
+                // If the first-order derivative is being requested,
+                // do the codegen for the constant itself, otherwise
+                // return 0. No need for normalization as the only
+                // nonzero value that can be produced here is the first-order
+                // derivative.
+                if (order == 1u) {
+                    return taylor_codegen_numparam<T>(s, v, par_ptr, batch_size);
+                } else {
+                    return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+                }
+            } else {
+                assert(false);
+                return nullptr;
+            }
+        },
+        ex.value());
+}
+
+// Function to split the central part of the decomposition (i.e., the definitions of the u variables
+// that do not represent state variables) into parallelisable segments. Within a segment,
+// the definition of a u variable does not depend on any u variable defined within that segment.
+// NOTE: the hidden deps are not considered as dependencies.
+std::vector<taylor_dc_t> taylor_segment_dc(const taylor_dc_t &dc, std::uint32_t n_eq)
+{
+    // Helper that takes in input the definition ex of a u variable, and returns
+    // in output the list of indices of the u variables on which ex depends.
+    auto udef_args_indices = [](const expression &ex) -> std::vector<std::uint32_t> {
+        return std::visit(
+            [](const auto &v) -> std::vector<std::uint32_t> {
+                using type = detail::uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, func>) {
+                    std::vector<std::uint32_t> retval;
+
+                    for (const auto &arg : v.args()) {
+                        std::visit(
+                            [&retval](const auto &x) {
+                                using tp = detail::uncvref_t<decltype(x)>;
+
+                                if constexpr (std::is_same_v<tp, variable>) {
+                                    retval.push_back(uname_to_index(x));
+                                } else if constexpr (!std::is_same_v<tp, number> && !std::is_same_v<tp, param>) {
+                                    throw std::invalid_argument(
+                                        "Invalid argument encountered in an element of a Taylor decomposition: the "
+                                        "argument is not a variable or a number/param");
+                                }
+                            },
+                            arg.value());
+                    }
+
+                    return retval;
+                } else {
+                    throw std::invalid_argument("Invalid expression encountered in a Taylor decomposition: the "
+                                                "expression is not a function");
+                }
+            },
+            ex.value());
+    };
+
+    // Init the return value.
+    std::vector<taylor_dc_t> s_dc;
+
+    // cur_limit_idx is initially the index of the first
+    // u variable which is not a state variable.
+    auto cur_limit_idx = n_eq;
+    for (std::uint32_t i = n_eq; i < dc.size() - n_eq; ++i) {
+        // NOTE: at the very first iteration of this for loop,
+        // no block has been created yet. Do it now.
+        if (i == n_eq) {
+            assert(s_dc.empty());
+            s_dc.emplace_back();
+        } else {
+            assert(!s_dc.empty());
+        }
+
+        const auto &[ex, deps] = dc[i];
+
+        // Determine the u indices on which ex depends.
+        const auto u_indices = udef_args_indices(ex);
+
+        if (std::any_of(u_indices.begin(), u_indices.end(),
+                        [cur_limit_idx](auto idx) { return idx >= cur_limit_idx; })) {
+            // The current expression depends on one or more variables
+            // within the current block. Start a new block and
+            // update cur_limit_idx with the start index of the new block.
+            s_dc.emplace_back();
+            cur_limit_idx = i;
+        }
+
+        // Append ex to the current block.
+        s_dc.back().emplace_back(ex, deps);
+    }
+
+#if !defined(NDEBUG)
+    // Verify s_dc.
+
+    decltype(dc.size()) counter = 0;
+    for (const auto &s : s_dc) {
+        // No segment can be empty.
+        assert(!s.empty());
+
+        for (const auto &[ex, _] : s) {
+            // All the indices in the definitions of the
+            // u variables in the current block must be
+            // less than counter + n_eq (which is the starting
+            // index of the block).
+            const auto u_indices = udef_args_indices(ex);
+            assert(std::all_of(u_indices.begin(), u_indices.end(),
+                               [idx_limit = counter + n_eq](auto idx) { return idx < idx_limit; }));
+        }
+
+        // Update the counter.
+        counter += s.size();
+    }
+
+    assert(counter == dc.size() - n_eq * 2u);
+#endif
+
+    return s_dc;
+}
+
+// Small helper to compute the size of a global array.
+std::uint32_t taylor_c_gl_arr_size(llvm::Value *v)
+{
+    assert(llvm::isa<llvm::GlobalVariable>(v));
+
+    return boost::numeric_cast<std::uint32_t>(
+        llvm::cast<llvm::ArrayType>(llvm::cast<llvm::PointerType>(v->getType())->getElementType())->getNumElements());
+}
+
+// Helper to construct the global arrays needed for the computation of the
+// derivatives of the state variables in compact mode. The first part of the
+// return value is a set of 6 arrays:
+// - the indices of the state variables whose time derivative is a u variable, paired to
+// - the indices of the u variables appearing in the derivatives, and
+// - the indices of the state variables whose time derivative is a constant, paired to
+// - the values of said constants, and
+// - the indices of the state variables whose time derivative is a param, paired to
+// - the indices of the params.
+// The second part of the return value is a boolean flag that will be true if
+// the time derivatives of all state variables are u variables, false otherwise.
+// The indices of the u variables in the return value are multiplied by u_stride
+// (see taylor_compute_jet_compact_mode()).
+template <typename T>
+auto taylor_c_make_sv_diff_globals(llvm_state &s, const taylor_dc_t &dc, std::uint32_t n_uvars,
+                                   std::uint32_t u_stride)
+{
+    auto &context = s.context();
+    auto &builder = s.builder();
+    auto &module = s.module();
+
+    // Build iteratively the output values as vectors of constants.
+    std::vector<llvm::Constant *> var_indices, vars, num_indices, nums, par_indices, pars;
+
+    // Keep track of how many time derivatives
+    // of the state variables are u variables.
+    std::uint32_t n_der_vars = 0;
+
+    // NOTE: the derivatives of the state variables are at the end of the decomposition.
+    for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
+        std::visit(
+            [&](const auto &v) {
+                using type = uncvref_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<type, variable>) {
+                    ++n_der_vars;
+                    // NOTE: remove from i the n_uvars offset to get the
+                    // true index of the state variable.
+                    var_indices.push_back(builder.getInt32((i - n_uvars) * u_stride));
+                    vars.push_back(builder.getInt32(uname_to_index(v) * u_stride));
+                } else if constexpr (std::is_same_v<type, number>) {
+                    num_indices.push_back(builder.getInt32((i - n_uvars) * u_stride));
+                    nums.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, v)));
+                } else if constexpr (std::is_same_v<type, param>) {
+                    par_indices.push_back(builder.getInt32((i - n_uvars) * u_stride));
+                    pars.push_back(builder.getInt32(v.idx()));
+                } else {
+                    assert(false);
+                }
+            },
+            dc[i].first.value());
+    }
+
+    // Flag to signal that the time derivatives of all state variables are u variables.
+    assert(dc.size() >= n_uvars);
+    const auto all_der_vars = (n_der_vars == (dc.size() - n_uvars));
+
+    assert(var_indices.size() == vars.size());
+    assert(num_indices.size() == nums.size());
+    assert(par_indices.size() == pars.size());
+
+    // Turn the vectors into global read-only LLVM arrays.
+
+    // Variables.
+    auto *var_arr_type
+        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(var_indices.size()));
+
+    auto *var_indices_arr = llvm::ConstantArray::get(var_arr_type, var_indices);
+    auto *g_var_indices = new llvm::GlobalVariable(module, var_indices_arr->getType(), true,
+                                                   llvm::GlobalVariable::InternalLinkage, var_indices_arr);
+
+    auto *vars_arr = llvm::ConstantArray::get(var_arr_type, vars);
+    auto *g_vars
+        = new llvm::GlobalVariable(module, vars_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, vars_arr);
+
+    // Numbers.
+    auto *num_indices_arr_type
+        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(num_indices.size()));
+    auto *num_indices_arr = llvm::ConstantArray::get(num_indices_arr_type, num_indices);
+    auto *g_num_indices = new llvm::GlobalVariable(module, num_indices_arr->getType(), true,
+                                                   llvm::GlobalVariable::InternalLinkage, num_indices_arr);
+
+    auto nums_arr_type
+        = llvm::ArrayType::get(to_llvm_type<T>(context), boost::numeric_cast<std::uint64_t>(nums.size()));
+    auto nums_arr = llvm::ConstantArray::get(nums_arr_type, nums);
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    auto *g_nums
+        = new llvm::GlobalVariable(module, nums_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, nums_arr);
+
+    // Params.
+    auto *par_arr_type
+        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(par_indices.size()));
+
+    auto *par_indices_arr = llvm::ConstantArray::get(par_arr_type, par_indices);
+    auto *g_par_indices = new llvm::GlobalVariable(module, par_indices_arr->getType(), true,
+                                                   llvm::GlobalVariable::InternalLinkage, par_indices_arr);
+
+    auto *pars_arr = llvm::ConstantArray::get(par_arr_type, pars);
+    auto *g_pars
+        = new llvm::GlobalVariable(module, pars_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, pars_arr);
+
+    return std::pair{std::array{g_var_indices, g_vars, g_num_indices, g_nums, g_par_indices, g_pars}, all_der_vars};
+}
+
+// Helper to compute and store the derivatives of the state variables in compact mode at order 'order'.
+// svd_gl is the return value of taylor_c_make_sv_diff_globals(), which contains
+// the indices/constants necessary for the computation.
+template <typename T, typename U>
+void taylor_c_compute_sv_diffs(llvm_state &s, const U &svd_gl, llvm::Value *diff_arr, llvm::Value *par_ptr,
+                               std::uint32_t n_uvars, llvm::Value *order, std::uint32_t batch_size,
+                               std::uint32_t u_stride)
+{
+    assert(batch_size > 0u);
+
+    // Fetch the global arrays and
+    // the all_der_vars flag.
+    const auto &sv_diff_gl = svd_gl.first;
+    const auto all_der_vars = svd_gl.second;
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Recover the number of state variables whose derivatives are given
+    // by u variables, numbers and params.
+    const auto n_vars = taylor_c_gl_arr_size(sv_diff_gl[0]);
+    const auto n_nums = taylor_c_gl_arr_size(sv_diff_gl[2]);
+    const auto n_pars = taylor_c_gl_arr_size(sv_diff_gl[4]);
+
+    // Handle the u variables definitions.
+    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_vars), [&](llvm::Value *cur_idx) {
+        // Fetch the index of the state variable.
+        // NOTE: if the time derivatives of all state variables are u variables, there's
+        // no need to lookup the index in the global array (which will just contain
+        // the values in the [0, n_vars] range, multiplied by u_stride).
+        auto *sv_idx
+            = all_der_vars
+                  ? (u_stride == 1u ? cur_idx : builder.CreateMul(cur_idx, builder.getInt32(u_stride)))
+                  : builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[0], {builder.getInt32(0), cur_idx}));
+
+        // Fetch the index of the u variable.
+        auto *u_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[1], {builder.getInt32(0), cur_idx}));
+
+        // Fetch from diff_arr the derivative of order 'order - 1' of the u variable u_idx.
+        auto *ret = taylor_c_load_diff(s, diff_arr, n_uvars, builder.CreateSub(order, builder.getInt32(1)), u_idx);
+
+        // We have to divide the derivative by 'order' in order
+        // to get the normalised derivative of the state variable.
+        ret = builder.CreateFDiv(
+            ret, vector_splat(builder, builder.CreateUIToFP(order, to_llvm_type<T>(context)), batch_size));
+
+        // Store the derivative.
+        taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx, ret);
+    });
+
+    // Handle the number definitions.
+    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_nums), [&](llvm::Value *cur_idx) {
+        // Fetch the index of the state variable.
+        auto *sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[2], {builder.getInt32(0), cur_idx}));
+
+        // Fetch the constant.
+        auto *num = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[3], {builder.getInt32(0), cur_idx}));
+
+        // If the first-order derivative is being requested,
+        // do the codegen for the constant itself, otherwise
+        // return 0. No need for normalization as the only
+        // nonzero value that can be produced here is the first-order
+        // derivative.
+        auto *cmp_cond = builder.CreateICmpEQ(order, builder.getInt32(1));
+        auto ret = builder.CreateSelect(cmp_cond, vector_splat(builder, num, batch_size),
+                                        vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+
+        // Store the derivative.
+        taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx, ret);
+    });
+
+    // Handle the param definitions.
+    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_pars), [&](llvm::Value *cur_idx) {
+        // Fetch the index of the state variable.
+        auto *sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[4], {builder.getInt32(0), cur_idx}));
+
+        // Fetch the index of the param.
+        auto *par_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[5], {builder.getInt32(0), cur_idx}));
+
+        // If the first-order derivative is being requested,
+        // do the codegen for the constant itself, otherwise
+        // return 0. No need for normalization as the only
+        // nonzero value that can be produced here is the first-order
+        // derivative.
+        llvm_if_then_else(
+            s, builder.CreateICmpEQ(order, builder.getInt32(1)),
+            [&]() {
+                // Derivative of order 1. Fetch the value from par_ptr.
+                // NOTE: param{0} is unused, its only purpose is type tagging.
+                taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx,
+                                    taylor_c_diff_numparam_codegen(s, param{0}, par_idx, par_ptr, batch_size));
+            },
+            [&]() {
+                // Derivative of order > 1, return 0.
+                taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx,
+                                    vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+            });
+    });
+}
+
+// Helper to convert the arguments of the definition of a u variable
+// into a vector of variants. u variables will be converted to their indices
+// (multiplied by u_stride), numbers will be unchanged, parameters will be converted
+// to their indices. The hidden deps will also be converted to indices (multiplied by u_stride).
+auto taylor_udef_to_variants(const expression &ex, const std::vector<std::uint32_t> &deps, std::uint32_t u_stride)
+{
+    return std::visit(
+        [&deps, u_stride](const auto &v) -> std::vector<std::variant<std::uint32_t, number>> {
+            using type = detail::uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, func>) {
+                std::vector<std::variant<std::uint32_t, number>> retval;
+
+                for (const auto &arg : v.args()) {
+                    std::visit(
+                        [&retval, u_stride](const auto &x) {
+                            using tp = detail::uncvref_t<decltype(x)>;
+
+                            if constexpr (std::is_same_v<tp, variable>) {
+                                retval.emplace_back(uname_to_index(x) * u_stride);
+                            } else if constexpr (std::is_same_v<tp, number>) {
+                                retval.emplace_back(x);
+                            } else if constexpr (std::is_same_v<tp, param>) {
+                                retval.emplace_back(x.idx());
+                            } else {
+                                throw std::invalid_argument(
+                                    "Invalid argument encountered in an element of a Taylor decomposition: the "
+                                    "argument is not a variable or a number");
+                            }
+                        },
+                        arg.value());
+                }
+
+                // Handle the hidden deps.
+                for (auto idx : deps) {
+                    retval.emplace_back(idx * u_stride);
+                }
+
+                return retval;
+            } else {
+                throw std::invalid_argument("Invalid expression encountered in a Taylor decomposition: the "
+                                            "expression is not a function");
+            }
+        },
+        ex.value());
+}
+
+// Helper to convert a vector of variants into a variant of vectors.
+// All elements of v must be of the same type, and v cannot be empty.
+template <typename... T>
+auto taylor_c_vv_transpose(const std::vector<std::variant<T...>> &v)
+{
+    assert(!v.empty());
+
+    // Init the return value based on the type
+    // of the first element of v.
+    auto retval = std::visit(
+        [size = v.size()](const auto &x) {
+            using type = detail::uncvref_t<decltype(x)>;
+
+            std::vector<type> tmp;
+            tmp.reserve(boost::numeric_cast<decltype(tmp.size())>(size));
+            tmp.push_back(x);
+
+            return std::variant<std::vector<T>...>(std::move(tmp));
+        },
+        v[0]);
+
+    // Append the other values from v.
+    for (decltype(v.size()) i = 1; i < v.size(); ++i) {
+        std::visit(
+            [&retval](const auto &x) {
+                std::visit(
+                    [&x](auto &vv) {
+                        // The value type of retval.
+                        using scal_t = typename detail::uncvref_t<decltype(vv)>::value_type;
+
+                        // The type of the current element of v.
+                        using x_t = detail::uncvref_t<decltype(x)>;
+
+                        if constexpr (std::is_same_v<scal_t, x_t>) {
+                            vv.push_back(x);
+                        } else {
+                            throw std::invalid_argument(
+                                "Inconsistent types detected while building the transposed sets of "
+                                "arguments for the Taylor derivative functions in compact mode");
+                        }
+                    },
+                    retval);
+            },
+            v[i]);
+    }
+
+    return retval;
+}
+
+// Functions the create the arguments generators for the functions that compute
+// the Taylor derivatives in compact mode. The generators are created from vectors
+// of either u var indices or floating-point constants.
+std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vidx(llvm_state &s,
+                                                                       const std::vector<std::uint32_t> &ind)
+{
+    assert(!ind.empty());
+
+    auto &builder = s.builder();
+
+    // Check if all indices in ind are the same.
+    if (std::all_of(ind.begin() + 1, ind.end(), [&ind](const auto &n) { return n == ind[0]; })) {
+        // If all indices are the same, don't construct an array, just always return
+        // the same value.
+        return [num = builder.getInt32(ind[0])](llvm::Value *) -> llvm::Value * { return num; };
+    }
+
+    // Check if ind is an arithmetic progression.
+    // NOTE: the stride is computed in modular arithmetic, so that
+    // decreasing progressions are detected as well (the evaluation
+    // of the generator wraps around in the same way).
+    const std::uint32_t stride = ind[1] - ind[0];
+    bool is_arith = true;
+    for (decltype(ind.size()) i = 2; i < ind.size(); ++i) {
+        if (ind[i] != static_cast<std::uint32_t>(ind[i - 1u] + stride)) {
+            is_arith = false;
+            break;
+        }
+    }
+
+    if (is_arith) {
+        // If ind is an arithmetic progression, we can replace
+        // the index array with a simple offset computation. This is
+        // the case, e.g., for the indices of the u variables with
+        // contiguous jets (whose stride is order + 1).
+        if (stride == 1u) {
+            return [&s, start_idx = builder.getInt32(ind[0])](llvm::Value *cur_call_idx) -> llvm::Value * {
+                return s.builder().CreateAdd(start_idx, cur_call_idx);
+            };
+        }
+
+        return [&s, start_idx = builder.getInt32(ind[0]),
+                stride_val = builder.getInt32(stride)](llvm::Value *cur_call_idx) -> llvm::Value * {
+            auto &builder = s.builder();
+
+            return builder.CreateAdd(start_idx, builder.CreateMul(stride_val, cur_call_idx));
+        };
+    }
+
+    auto &module = s.module();
+
+    // Generate the array of indices as llvm constants.
+    std::vector<llvm::Constant *> tmp_c_vec;
+    tmp_c_vec.reserve(ind.size());
+    for (const auto &val : ind) {
+        tmp_c_vec.push_back(builder.getInt32(val));
+    }
+
+    // Create the array type.
+    auto *arr_type = llvm::ArrayType::get(tmp_c_vec[0]->getType(), boost::numeric_cast<std::uint64_t>(ind.size()));
+    assert(arr_type != nullptr);
+
+    // Create the constant array as a global read-only variable.
+    auto *const_arr = llvm::ConstantArray::get(arr_type, tmp_c_vec);
+    assert(const_arr != nullptr);
+    // NOTE: naked new here is fine, gvar will be registered in the module
+    // object and cleaned up when the module is destroyed.
+    auto *gvar = new llvm::GlobalVariable(module, const_arr->getType(), true, llvm::GlobalVariable::InternalLinkage,
+                                          const_arr);
+
+    // Return the generator.
+    return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * {
+        auto &builder = s.builder();
+
+        return builder.CreateLoad(builder.CreateInBoundsGEP(gvar, {builder.getInt32(0), cur_call_idx}));
+    };
+}
+
+template <typename T>
+std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vc(llvm_state &s, const std::vector<number> &vc)
+{
+    assert(!vc.empty());
+
+    // Check if all the numbers are the same.
+    // NOTE: the comparison operator of number will consider two numbers of different
+    // type but equal value to be equal.
+    if (std::all_of(vc.begin() + 1, vc.end(), [&vc](const auto &n) { return n == vc[0]; })) {
+        // If all constants are the same, don't construct an array, just always return
+        // the same value.
+        return [num = codegen<T>(s, vc[0])](llvm::Value *) -> llvm::Value * { return num; };
+    }
+
+    auto &module = s.module();
+
+    // Generate the array of constants as llvm constants.
+    std::vector<llvm::Constant *> tmp_c_vec;
+    tmp_c_vec.reserve(vc.size());
+    for (const auto &val : vc) {
+        tmp_c_vec.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, val)));
+    }
+
+    // Create the array type.
+    auto *arr_type = llvm::ArrayType::get(tmp_c_vec[0]->getType(), boost::numeric_cast<std::uint64_t>(vc.size()));
+    assert(arr_type != nullptr);
+
+    // Create the constant array as a global read-only variable.
+    auto *const_arr = llvm::ConstantArray::get(arr_type, tmp_c_vec);
+    assert(const_arr != nullptr);
+    // NOTE: naked new here is fine, gvar will be registered in the module
+    // object and cleaned up when the module is destroyed.
+    auto *gvar = new llvm::GlobalVariable(module, const_arr->getType(), true, llvm::GlobalVariable::InternalLinkage,
+                                          const_arr);
+
+    // Return the generator.
+    return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * {
+        auto &builder = s.builder();
+
+        return builder.CreateLoad(builder.CreateInBoundsGEP(gvar, {builder.getInt32(0), cur_call_idx}));
+    };
+}
+
+// For each segment in s_dc, this function will return a vector containing a dict mapping an LLVM function
+// f for the computation of a Taylor derivative to a size and a vector of std::functions. For example, one entry
+// in the return value will read something like:
+// {f : (2, [g_0, g_1, g_2])}
+// The meaning in this example is that the arity of f is 3 and it will be called with 2 different
+// sets of arguments. The g_i functions are expected to be called with input argument j in [0, 1]
+// to yield the value of the i-th function argument for f at the j-th invocation.
+// The indices of the u variables are multiplied by u_stride (see taylor_compute_jet_compact_mode()).
+template <typename T>
+auto taylor_build_function_maps(llvm_state &s, const std::vector<taylor_dc_t> &s_dc, std::uint32_t n_eq,
+                                std::uint32_t n_uvars, std::uint32_t batch_size, std::uint32_t u_stride)
+{
+    // Init the return value.
+    std::vector<std::unordered_map<llvm::Function *,
+                                   std::pair<std::uint32_t, std::vector<std::function<llvm::Value *(llvm::Value *)>>>>>
+        retval;
+
+    // Variable to keep track of the u variable
+    // on whose definition we are operating.
+    auto cur_u_idx = n_eq;
+    for (const auto &seg : s_dc) {
+        // This structure maps an LLVM function to sets of arguments
+        // with which the function is to be called. For instance, if function
+        // f(x, y, z) is to be called as f(a, b, c) and f(d, e, f), then tmp_map
+        // will contain {f : [[a, b, c], [d, e, f]]}.
+        // After construction, we have verified that for each function
+        // in the map the sets of arguments have all the same size.
+        std::unordered_map<llvm::Function *, std::vector<std::vector<std::variant<std::uint32_t, number>>>> tmp_map;
+
+        for (const auto &ex : seg) {
+            // Get the function for the computation of the derivative.
+            // NOTE: the derivative functions are fetched from the library
+            // of precompiled derivative functions, which avoids generating
+            // and optimising them from scratch in every module.
+            auto func = std::holds_alternative<heyoka::func>(ex.first.value())
+                            ? taylor_c_diff_lib_fetch<T>(s, std::get<heyoka::func>(ex.first.value()), n_uvars,
+                                                         batch_size)
+                            : taylor_c_diff_func<T>(s, ex.first, n_uvars, batch_size);
+
+            // Insert the function into tmp_map.
+            const auto [it, is_new_func] = tmp_map.try_emplace(func);
+
+            assert(is_new_func || !it->second.empty());
+
+            // Convert the variables/constants in the current dc
+            // element into a set of indices/constants.
+            const auto cdiff_args = taylor_udef_to_variants(ex.first, ex.second, u_stride);
+
+            if (!is_new_func && it->second.back().size() - 1u != cdiff_args.size()) {
+                throw std::invalid_argument(
+                    "Inconsistent arity detected in a Taylor derivative function in compact "
+                    "mode: the same function is being called with both {} and {} arguments"_format(
+                        it->second.back().size() - 1u, cdiff_args.size()));
+            }
+
+            // Add the new set of arguments.
+            it->second.emplace_back();
+            // Add the idx of the u variable.
+            it->second.back().emplace_back(cur_u_idx * u_stride);
+            // Add the actual function arguments.
+            it->second.back().insert(it->second.back().end(), cdiff_args.begin(), cdiff_args.end());
+
+            ++cur_u_idx;
+        }
+
+        // Now we build the transposition of tmp_map: from {f : [[a, b, c], [d, e, f]]}
+        // to {f : [[a, d], [b, e], [c, f]]}.
+        std::unordered_map<llvm::Function *, std::vector<std::variant<std::vector<std::uint32_t>, std::vector<number>>>>
+            tmp_map_transpose;
+        for (const auto &[func, vv] : tmp_map) {
+            assert(!vv.empty());
+
+            // Add the function.
+            const auto [it, ins_status] = tmp_map_transpose.try_emplace(func);
+            assert(ins_status);
+
+            const auto n_calls = vv.size();
+            const auto n_args = vv[0].size();
+            // NOTE: n_args must be at least 1 because the u idx
+            // is prepended to the actual function arguments in
+            // the tmp_map entries.
+            assert(n_args >= 1u);
+
+            for (decltype(vv[0].size()) i = 0; i < n_args; ++i) {
+                // Build the vector of values corresponding
+                // to the current argument index.
+                std::vector<std::variant<std::uint32_t, number>> tmp_c_vec;
+                for (decltype(vv.size()) j = 0; j < n_calls; ++j) {
+                    tmp_c_vec.push_back(vv[j][i]);
+                }
+
+                // Turn tmp_c_vec (a vector of variants) into a variant
+                // of vectors, and insert the result.
+                it->second.push_back(taylor_c_vv_transpose(tmp_c_vec));
+            }
+        }
+
+        // Add a new entry in retval for the current segment.
+        retval.emplace_back();
+        auto &a_map = retval.back();
+
+        for (const auto &[func, vv] : tmp_map_transpose) {
+            assert(!vv.empty());
+
+            // Add the function.
+            const auto [it, ins_status] = a_map.try_emplace(func);
+            assert(ins_status);
+
+            // Set the number of calls for this function.
+            it->second.first
+                = std::visit([](const auto &x) { return boost::numeric_cast<std::uint32_t>(x.size()); }, vv[0]);
+            assert(it->second.first > 0u);
+
+            // Create the g functions for each argument.
+            for (const auto &v : vv) {
+                it->second.second.push_back(std::visit(
+                    [&s](const auto &x) {
+                        using type = detail::uncvref_t<decltype(x)>;
+
+                        if constexpr (std::is_same_v<type, std::vector<std::uint32_t>>) {
+                            return taylor_c_make_arg_gen_vidx(s, x);
+                        } else {
+                            return taylor_c_make_arg_gen_vc<T>(s, x);
+                        }
+                    },
+                    v));
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Helper to codegen the call to func for the computation of the derivative
+// of order cur_order of the u variable corresponding to the call index cur_call_idx.
+// gens are the argument generators created by taylor_build_function_maps().
+void taylor_c_codegen_u_diff(llvm_state &s, llvm::Function *func,
+                             const std::vector<std::function<llvm::Value *(llvm::Value *)>> &gens,
+                             llvm::Value *cur_order, llvm::Value *cur_call_idx, llvm::Value *diff_arr,
+                             llvm::Value *par_ptr, llvm::Value *time_ptr, std::uint32_t n_uvars)
+{
+    auto &builder = s.builder();
+
+    // Create the u variable index from the first generator.
+    auto u_idx = gens[0](cur_call_idx);
+
+    // Initialise the vector of arguments with which func must be called. The following
+    // initial arguments are always present:
+    // - current Taylor order,
+    // - u index of the variable,
+    // - array of derivatives,
+    // - pointer to the param values,
+    // - pointer to the time value(s).
+    std::vector<llvm::Value *> args{cur_order, u_idx, diff_arr, par_ptr, time_ptr};
+
+    // Create the other arguments via the generators.
+    for (decltype(gens.size()) i = 1; i < gens.size(); ++i) {
+        args.push_back(gens[i](cur_call_idx));
+    }
+
+    // Calculate the derivative and store the result.
+    taylor_c_store_diff(s, diff_arr, n_uvars, cur_order, u_idx, builder.CreateCall(func, args));
+}
+
+// Helper to create the worker functions used in parallel mode. For each segment
+// in f_maps, a worker function with signature
+//
+// void (void *ctx, std::uint32_t b, std::uint32_t e)
+//
+// is created. The worker will compute the derivatives of the u variables
+// corresponding to the call indices in the [b, e) range, where the call indices of the
+// blocks in the segment are laid out consecutively, in the iteration order of the segment map.
+// ctx is a pointer to a struct of type ctx_t containing the current Taylor order,
+// the pointer to the param values and the pointer to the time value(s).
+// The return value contains the worker functions and the total number of calls
+// in each segment.
+template <typename F>
+auto taylor_c_make_par_workers(llvm_state &s, const F &f_maps, llvm::StructType *ctx_t, llvm::GlobalVariable *diff_gl,
+                               std::uint32_t n_uvars)
+{
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto &module = s.module();
+
+    std::vector<std::pair<llvm::Function *, std::uint32_t>> retval;
+
+    // Fetch the current insertion block.
+    auto orig_bb = builder.GetInsertBlock();
+
+    // The function type.
+    auto *ft = llvm::FunctionType::get(
+        builder.getVoidTy(),
+        {llvm::Type::getInt8PtrTy(context), llvm::Type::getInt32Ty(context), llvm::Type::getInt32Ty(context)}, false);
+
+    for (const auto &map : f_maps) {
+        // NOTE: the name of the function will be uniqued
+        // automatically by LLVM in case of clashes.
+        auto *f = llvm::Function::Create(ft, llvm::Function::InternalLinkage, "heyoka_taylor_cm_par_worker", &module);
+        assert(f != nullptr);
+
+        // Fetch the function arguments.
+        auto ctx_ptr = f->args().begin();
+        auto b_idx = f->args().begin() + 1;
+        auto e_idx = f->args().begin() + 2;
+
+        // Create a new basic block to start insertion into.
+        builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+        // Load the values from the context.
+        auto *ctx = builder.CreateBitCast(ctx_ptr, llvm::PointerType::getUnqual(ctx_t));
+        auto *cur_order
+            = builder.CreateLoad(builder.CreateInBoundsGEP(ctx, {builder.getInt32(0), builder.getInt32(0)}));
+        auto *par_ptr = builder.CreateLoad(builder.CreateInBoundsGEP(ctx, {builder.getInt32(0), builder.getInt32(1)}));
+        auto *time_ptr
+            = builder.CreateLoad(builder.CreateInBoundsGEP(ctx, {builder.getInt32(0), builder.getInt32(2)}));
+
+        // Fetch a pointer to the beginning of the array of derivatives.
+        auto *diff_arr = builder.CreateInBoundsGEP(diff_gl, {builder.getInt32(0), builder.getInt32(0)});
+
+        // The offset of the current block within the segment.
+        std::uint32_t offset = 0;
+
+        for (const auto &p : map) {
+            const auto &func = p.first;
+            const auto ncalls = p.second.first;
+            const auto &gens = p.second.second;
+
+            assert(ncalls > 0u);
+            assert(!gens.empty());
+            assert(std::all_of(gens.begin(), gens.end(), [](const auto &g) { return static_cast<bool>(g); }));
+
+            // NOTE: the offsets cannot overflow, as the total
+            // number of calls is bounded by the number of u variables.
+            assert(ncalls <= std::numeric_limits<std::uint32_t>::max() - offset);
+
+            // Compute the intersection between [b, e) and the range of
+            // call indices of the current block, [offset, offset + ncalls).
+            // The intersection is translated so that it starts from the beginning
+            // of the block. If the intersection is empty, the loop will be skipped.
+            auto *off_v = builder.getInt32(offset);
+            auto *off_end_v = builder.getInt32(offset + ncalls);
+
+            auto *start = builder.CreateSelect(builder.CreateICmpUGT(b_idx, off_v), b_idx, off_v);
+            auto *stop = builder.CreateSelect(builder.CreateICmpULT(e_idx, off_end_v), e_idx, off_end_v);
+
+            llvm_loop_u32(s, builder.CreateSub(start, off_v), builder.CreateSub(stop, off_v),
+                          [&](llvm::Value *cur_call_idx) {
+                              taylor_c_codegen_u_diff(s, func, gens, cur_order, cur_call_idx, diff_arr, par_ptr,
+                                                      time_ptr, n_uvars);
+                          });
+
+            offset += ncalls;
+        }
+
+        // Return.
+        builder.CreateRetVoid();
+
+        // Verify.
+        s.verify_function(f);
+
+        retval.emplace_back(f, offset);
+    }
+
+    // Restore the original insertion block.
+    builder.SetInsertPoint(orig_bb);
+
+    return retval;
+}
+
+// Helper for the computation of a jet of derivatives in compact mode,
+// used in taylor_compute_jet() below.
+template <typename T>
+llvm::Value *taylor_compute_jet_compact_mode(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr,
+                                             llvm::Value *time_ptr, const taylor_dc_t &dc,
+                                             const std::vector<std::uint32_t> &sv_funcs_dc, std::uint32_t n_eq,
+                                             std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size,
+                                             bool parallel_mode, std::uint32_t unroll_threshold,
+                                             bool contiguous_jets)
+{
+    auto &builder = s.builder();
+
+    // Setup the layout of the array of derivatives. In the default layout,
+    // the derivatives are stored order by order, that is, the derivative of
+    // order o of the u variable u_idx is stored at the index o * n_uvars + u_idx.
+    // If contiguous_jets is true, the derivatives of each u variable are instead
+    // stored contiguously, at the index u_idx * (order + 1) + o, so that the
+    // Cauchy products in the computation of the derivatives access contiguous memory.
+    // The contiguous layout is implemented by using 1 in place of n_uvars
+    // when indexing into the array (diff_n_uvars), and by multiplying
+    // the indices of the u variables by u_stride.
+    const auto diff_n_uvars = contiguous_jets ? std::uint32_t(1) : n_uvars;
+    const auto u_stride = contiguous_jets ? order + 1u : std::uint32_t(1);
+
+    // Split dc into segments.
+    const auto s_dc = taylor_segment_dc(dc, n_eq);
+
+    // Generate the function maps.
+    const auto f_maps = taylor_build_function_maps<T>(s, s_dc, n_eq, diff_n_uvars, batch_size, u_stride);
+
+    // Generate the global arrays for the computation of the derivatives
+    // of the state variables.
+    const auto svd_gl = taylor_c_make_sv_diff_globals<T>(s, dc, n_uvars, u_stride);
+
+    // Determine the maximum u variable index appearing in sv_funcs_dc, or zero
+    // if sv_funcs_dc is empty.
+    const auto max_svf_idx
+        = sv_funcs_dc.empty() ? std::uint32_t(0) : *std::max_element(sv_funcs_dc.begin(), sv_funcs_dc.end());
+
+    // Prepare the array that will contain the jet of derivatives.
+    // We will be storing all the derivatives of the u variables
+    // up to order 'order - 1', the derivatives of order
+    // 'order' of the state variables and the derivatives
+    // of order 'order' of the sv_funcs.
+    // NOTE: the array size is specified as a 64-bit integer in the
+    // LLVM API.
+    // NOTE: fp_type is the original, scalar floating-point type.
+    // It will be turned into a vector type (if necessary) by
+    // make_vector_type() below.
+    // NOTE: if sv_funcs_dc is empty, or if all its indices are not greater
+    // than the indices of the state variables, then we don't need additional
+    // slots after the sv derivatives. If we need additional slots, allocate
+    // another full column of derivatives, as it is complicated at this stage
+    // to know exactly how many slots we will need.
+    // NOTE: in the contiguous layout, we always allocate the
+    // full n_uvars * (order + 1) array.
+    auto *fp_type = llvm::cast<llvm::PointerType>(order0->getType())->getElementType();
+    auto *array_type = llvm::ArrayType::get(make_vector_type(fp_type, batch_size),
+                                            (max_svf_idx < n_eq) ? (n_uvars * order + n_eq) : (n_uvars * (order + 1u)));
+    auto *diff_array_type = contiguous_jets
+                                ? llvm::ArrayType::get(make_vector_type(fp_type, batch_size), n_uvars * (order + 1u))
+                                : array_type;
+
+    // Make the global array and fetch a pointer to its first element.
+    // NOTE: we use a global array rather than a local one here because
+    // its size can grow quite large, which can lead to stack overflow issues.
+    // This has of course consequences in terms of thread safety, which
+    // we will have to document.
+    auto *diff_gl = llvm::cast<llvm::GlobalVariable>(make_global_zero_array(s.module(), diff_array_type));
+    auto *diff_arr = builder.CreateInBoundsGEP(diff_gl, {builder.getInt32(0), builder.getInt32(0)});
+
+    // Helper to multiply a u variable index by u_stride.
+    auto scale_u_idx = [&](llvm::Value *u_idx) {
+        return u_stride == 1u ? u_idx : builder.CreateMul(u_idx, builder.getInt32(u_stride));
+    };
+
+    // Copy over the order-0 derivatives of the state variables.
+    // NOTE: overflow checking is already done in the parent function.
+    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+        // Fetch the pointer from order0.
+        auto *ptr = builder.CreateInBoundsGEP(order0, {builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))});
+
+        // Load as a vector.
+        auto *vec = load_vector_from_memory(builder, ptr, batch_size);
+
+        // Store into diff_arr.
+        builder.CreateStore(vec, builder.CreateInBoundsGEP(diff_arr, {scale_u_idx(cur_var_idx)}));
+    });
+
+    // In parallel mode, create the worker functions for the segments
+    // and the context to be passed to them.
+    std::vector<std::pair<llvm::Function *, std::uint32_t>> par_workers;
+    llvm::Value *ctx_ptr = nullptr, *ctx = nullptr;
+    if (parallel_mode) {
+        auto *ctx_t
+            = llvm::StructType::get(s.context(), {builder.getInt32Ty(), par_ptr->getType(), time_ptr->getType()});
+
+        par_workers = taylor_c_make_par_workers(s, f_maps, ctx_t, diff_gl, diff_n_uvars);
+
+        // NOTE: the context is allocated on the stack, as the workers
+        // are always done by the time the looper returns.
+        ctx = builder.CreateAlloca(ctx_t);
+        builder.CreateStore(par_ptr, builder.CreateInBoundsGEP(ctx, {builder.getInt32(0), builder.getInt32(1)}));
+        builder.CreateStore(time_ptr, builder.CreateInBoundsGEP(ctx, {builder.getInt32(0), builder.getInt32(2)}));
+        ctx_ptr = builder.CreateBitCast(ctx, builder.getInt8PtrTy());
+    }
+
+    // Helper to compute in parallel the derivatives of order cur_order of the
+    // u variables in the segment seg_idx.
+    auto compute_seg_diffs_par = [&](llvm::Value *cur_order, decltype(par_workers.size()) seg_idx) {
+        assert(parallel_mode);
+        assert(seg_idx < par_workers.size());
+
+        // Update the order in the context.
+        builder.CreateStore(cur_order, builder.CreateInBoundsGEP(ctx, {builder.getInt32(0), builder.getInt32(0)}));
+
+        // NOTE: the looper returns only after all the derivatives in the
+        // segment have been computed. This acts as a barrier between
+        // the segments.
+        llvm_invoke_external(
+            s, "heyoka_cm_par_looper", builder.getVoidTy(),
+            {builder.getInt32(par_workers[seg_idx].second), par_workers[seg_idx].first, ctx_ptr},
+            {llvm::Attribute::NoUnwind, llvm::Attribute::WillReturn});
+    };
+
+    // Helper to codegen the ncalls invocations of func for the computation
+    // of the derivatives of order cur_order. If ncalls is not greater than
+    // unroll_threshold, the invocations are fully unrolled, otherwise
+    // they are performed in a loop.
+    // NOTE: in the unrolled case the call indices are compile-time constants,
+    // so that the optimiser can fold the loads from the global arrays
+    // of the argument generators and inline the calls.
+    auto codegen_block = [&](llvm::Function *func, std::uint32_t ncalls,
+                             const std::vector<std::function<llvm::Value *(llvm::Value *)>> &gens,
+                             llvm::Value *cur_order) {
+        assert(ncalls > 0u);
+        assert(!gens.empty());
+        assert(std::all_of(gens.begin(), gens.end(), [](const auto &f) { return static_cast<bool>(f); }));
+
+        if (ncalls <= unroll_threshold) {
+            for (std::uint32_t i = 0; i < ncalls; ++i) {
+                taylor_c_codegen_u_diff(s, func, gens, cur_order, builder.getInt32(i), diff_arr, par_ptr, time_ptr,
+                                        diff_n_uvars);
+            }
+        } else {
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(ncalls), [&](llvm::Value *cur_call_idx) {
+                taylor_c_codegen_u_diff(s, func, gens, cur_order, cur_call_idx, diff_arr, par_ptr, time_ptr,
+                                        diff_n_uvars);
+            });
+        }
+    };
+
+    // Helper to compute and store the derivatives of order cur_order
+    // of the u variables which are not state variables.
+    auto compute_u_diffs = [&](llvm::Value *cur_order) {
+        if (parallel_mode) {
+            for (decltype(par_workers.size()) i = 0; i < par_workers.size(); ++i) {
+                compute_seg_diffs_par(cur_order, i);
+            }
+
+            return;
+        }
+
+        for (const auto &map : f_maps) {
+            for (const auto &p : map) {
+                // The LLVM function for the computation of the
+                // derivative in compact mode.
+                const auto &func = p.first;
+
+                // The number of func calls.
+                const auto ncalls = p.second.first;
+
+                // The generators for the arguments of func.
+                const auto &gens = p.second.second;
+
+                // Compute the derivatives, unrolling the calls
+                // if the block is small enough.
+                codegen_block(func, ncalls, gens, cur_order);
+            }
+        }
+    };
+
+    // Compute the order-0 derivatives (i.e., the initial values)
+    // for all u variables which are not state variables.
+    compute_u_diffs(builder.getInt32(0));
+
+    // Compute all derivatives up to order 'order - 1'.
+    llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order), [&](llvm::Value *cur_order) {
+        // State variables first.
+        taylor_c_compute_sv_diffs<T>(s, svd_gl, diff_arr, par_ptr, diff_n_uvars, cur_order, batch_size, u_stride);
+
+        // The other u variables.
+        compute_u_diffs(cur_order);
+    });
+
+    // Compute the last-order derivatives for the state variables.
+    taylor_c_compute_sv_diffs<T>(s, svd_gl, diff_arr, par_ptr, diff_n_uvars, builder.getInt32(order), batch_size,
+                                 u_stride);
+
+    // Compute the last-order derivatives for the sv_funcs, if any. Because the sv funcs
+    // correspond to u variables in the decomposition, we will have to compute the
+    // last-order derivatives of the u variables until we are sure all sv_funcs derivatives
+    // have been properly computed.
+
+    // Monitor the starting index of the current
+    // segment while iterating on f_maps.
+    auto cur_start_u_idx = n_eq;
+
+    // NOTE: this is a slight repetition of compute_u_diffs() with minor modifications.
+    for (decltype(f_maps.size()) seg_idx = 0; seg_idx < f_maps.size(); ++seg_idx) {
+        const auto &map = f_maps[seg_idx];
+
+        if (cur_start_u_idx > max_svf_idx) {
+            // We computed all the necessary derivatives, break out.
+            // NOTE: if we did not have sv_funcs to begin with,
+            // max_svf_idx is zero and we exit at the first iteration
+            // without doing anything. If all sv funcs alias state variables,
+            // then max_svf_idx < n_eq and thus we also exit immediately
+            // at the first iteration.
+            break;
+        }
+
+        if (parallel_mode) {
+            compute_seg_diffs_par(builder.getInt32(order), seg_idx);
+
+            cur_start_u_idx += par_workers[seg_idx].second;
+
+            continue;
+        }
+
+        for (const auto &p : map) {
+            const auto &func = p.first;
+            const auto ncalls = p.second.first;
+            const auto &gens = p.second.second;
+
+            codegen_block(func, ncalls, gens, builder.getInt32(order));
+
+            // Update cur_start_u_idx taking advantage of the fact
+            // that each block in a segment processes the derivatives
+            // of exactly ncalls u variables.
+            cur_start_u_idx += ncalls;
+        }
+    }
+
+    if (contiguous_jets) {
+        // The users of the jet expect the default layout. Copy the derivatives
+        // of the state variables and of the sv_funcs into a separate array
+        // with the default layout.
+        // NOTE: the other entries in the new array are never accessed.
+        auto *out_gl = make_global_zero_array(s.module(), array_type);
+        auto *out_arr = builder.CreateInBoundsGEP(out_gl, {builder.getInt32(0), builder.getInt32(0)});
+
+        // Helper to copy the derivatives up to order 'order' of the u variable u_idx.
+        auto copy_jet = [&](llvm::Value *u_idx) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+                taylor_c_store_diff(s, out_arr, n_uvars, cur_order, u_idx,
+                                    taylor_c_load_diff(s, diff_arr, diff_n_uvars, cur_order, scale_u_idx(u_idx)));
+            });
+        };
+
+        // The state variables.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), copy_jet);
+
+        // The sv_funcs, if any of them is not a state variable.
+        if (max_svf_idx >= n_eq) {
+            auto *svf_arr = taylor_c_make_sv_funcs_arr(s, sv_funcs_dc);
+            const auto n_svf = boost::numeric_cast<std::uint32_t>(sv_funcs_dc.size());
+
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_svf), [&](llvm::Value *cur_idx) {
+                copy_jet(builder.CreateLoad(builder.CreateInBoundsGEP(svf_arr, {cur_idx})));
+            });
+        }
+
+        return out_arr;
+    }
+
+    // Return the array of derivatives of the u variables.
+    return diff_arr;
+}
+
+// Given an input pointer 'in', load the first n * batch_size values in it as n vectors
+// with size batch_size. If batch_size is 1, the values will be loaded as scalars.
+auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::uint32_t batch_size)
+{
+    assert(batch_size > 0u);
+
+    auto &builder = s.builder();
+
+    std::vector<llvm::Value *> retval;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        // Fetch the pointer from in.
+        // NOTE: overflow checking is done in the parent function.
+        auto *ptr = builder.CreateInBoundsGEP(in, {builder.getInt32(i * batch_size)});
+
+        // Load the value in vector mode.
+        retval.push_back(load_vector_from_memory(builder, ptr, batch_size));
+    }
+
+    return retval;
+}
+
+// Helper function to compute the jet of Taylor derivatives up to a given order. n_eq
+// is the number of equations/variables in the ODE sys, dc its Taylor decomposition,
+// n_uvars the total number of u variables in the decomposition.
+// order is the max derivative order desired, batch_size the batch size.
+// order0 is a pointer to an array of (at least) n_eq * batch_size scalar elements
+// containing the derivatives of order 0. par_ptr is a pointer to an array containing
+// the numerical values of the parameters, time_ptr a pointer to the time value(s).
+// sv_funcs are the indices, in the decomposition, of the functions of state
+// variables.
+//
+// The return value is a variant containing either:
+// - in compact mode, the array containing the derivatives of all u variables,
+// - otherwise, the jet of derivatives of the state variables and sv_funcs
+//   up to order 'order'.
+template <typename T>
+std::variant<llvm::Value *, std::vector<llvm::Value *>>
+taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llvm::Value *time_ptr,
+                   const taylor_dc_t &dc, const std::vector<std::uint32_t> &sv_funcs_dc, std::uint32_t n_eq,
+                   std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool compact_mode,
+                   bool parallel_mode, std::uint32_t unroll_threshold, bool contiguous_jets)
+{
+    assert(batch_size > 0u);
+    assert(n_eq > 0u);
+    assert(order > 0u);
+
+    // Make sure we can represent n_uvars * (order + 1) as a 32-bit
+    // unsigned integer. This is the maximum total number of derivatives we will have to compute
+    // and store, with the +1 taking into account the extra slots that might be needed by sv_funcs_dc.
+    // If sv_funcs_dc is empty, we need only n_uvars * order + n_eq derivatives.
+    // LCOV_EXCL_START
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || n_uvars > std::numeric_limits<std::uint32_t>::max() / (order + 1u)) {
+        throw std::overflow_error(
+            "An overflow condition was detected in the computation of a jet of Taylor derivatives");
+    }
+
+    // We also need to be able to index up to n_eq * batch_size in order0.
+    if (n_eq > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+        throw std::overflow_error(
+            "An overflow condition was detected in the computation of a jet of Taylor derivatives");
+    }
+    // LCOV_EXCL_STOP
+
+    if (compact_mode) {
+        // In compact mode, let's ensure that we can index into par_ptr using std::uint32_t.
+        // NOTE: in default mode the check is done inside taylor_codegen_numparam_par().
+
+        // Deduce the size of the param array from the expressions in the decomposition.
+        std::uint32_t param_size = 0;
+        for (auto i = n_eq; i < dc.size(); ++i) {
+            param_size = std::max(param_size, get_param_size(dc[i].first));
+        }
+        // LCOV_EXCL_START
+        if (param_size > std::numeric_limits<std::uint32_t>::max() / batch_size) {
+            throw std::overflow_error(
+                "An overflow condition was detected in the computation of a jet of Taylor derivatives in compact mode");
+        }
+        // LCOV_EXCL_STOP
+
+        return taylor_compute_jet_compact_mode<T>(s, order0, par_ptr, time_ptr, dc, sv_funcs_dc, n_eq, n_uvars, order,
+                                                  batch_size, parallel_mode, unroll_threshold, contiguous_jets);
+    } else {
+        // Init the derivatives array with the order 0 of the state variables.
+        auto diff_arr = taylor_load_values(s, order0, n_eq, batch_size);
+
+        // Compute the order-0 derivatives of the other u variables.
+        for (auto i = n_eq; i < n_uvars; ++i) {
+            diff_arr.push_back(
+                taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars, 0, i, batch_size));
+        }
+
+        // Compute the derivatives order by order, starting from 1 to order excluded.
+        // We will compute the highest derivatives of the state variables separately
+        // in the last step.
+        for (std::uint32_t cur_order = 1; cur_order < order; ++cur_order) {
+            // Begin with the state variables.
+            // NOTE: the derivatives of the state variables
+            // are at the end of the decomposition vector.
+            for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
+                diff_arr.push_back(
+                    taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, cur_order, batch_size));
+            }
+
+            // Now the other u variables.
+            for (auto i = n_eq; i < n_uvars; ++i) {
+                diff_arr.push_back(taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars,
+                                                  cur_order, i, batch_size));
+            }
+        }
+
+        // Compute the last-order derivatives for the state variables.
+        for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
+            diff_arr.push_back(
+                taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, order, batch_size));
+        }
+
+        // If there are sv funcs, we need to compute their last-order derivatives too:
+        // we will need to compute the derivatives of the u variables up to
+        // the maximum index in sv_funcs_dc.
+        const auto max_svf_idx
+            = sv_funcs_dc.empty() ? std::uint32_t(0) : *std::max_element(sv_funcs_dc.begin(), sv_funcs_dc.end());
+
+        // NOTE: if there are no sv_funcs, max_svf_idx is set to zero
+        // above, thus we never enter the loop.
+        // NOTE: <= because max_svf_idx is an index, not a size.
+        for (std::uint32_t i = n_eq; i <= max_svf_idx; ++i) {
+            diff_arr.push_back(taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars, order,
+                                              i, batch_size));
+        }
+
+#if !defined(NDEBUG)
+        if (sv_funcs_dc.empty()) {
+            assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(n_uvars) * order + n_eq);
+        } else {
+            // NOTE: we use std::max<std::uint32_t>(n_eq, max_svf_idx + 1u) here because
+            // the sv funcs could all be aliases of the state variables themselves,
+            // in which case in the previous loop we ended up appending nothing.
+            assert(diff_arr.size()
+                   == static_cast<decltype(diff_arr.size())>(n_uvars) * order
+                          + std::max<std::uint32_t>(n_eq, max_svf_idx + 1u));
+        }
+#endif
+
+        // Extract the derivatives of the state variables and sv_funcs from diff_arr.
+        std::vector<llvm::Value *> retval;
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
+                retval.push_back(taylor_fetch_diff(diff_arr, var_idx, o, n_uvars));
+            }
+            for (auto idx : sv_funcs_dc) {
+                retval.push_back(taylor_fetch_diff(diff_arr, idx, o, n_uvars));
+            }
+        }
+
+        return retval;
+    }
+}
+
+// Helper to generate the LLVM code to store the Taylor coefficients of the state variables and
+// the sv funcs into an external array. The Taylor polynomials are stored in row-major order,
+// first the state variables and after the sv funcs. For use in the adaptive timestepper implementations.
+void taylor_write_tc(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_variant,
+                     const std::vector<std::uint32_t> &sv_funcs_dc, llvm::Value *svf_ptr, llvm::Value *tc_ptr,
+                     std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size)
+{
+    assert(batch_size != 0u);
+#if !defined(NDEBUG)
+    if (diff_variant.index() == 0u) {
+        // Compact mode.
+        assert(sv_funcs_dc.empty() == !svf_ptr);
+    } else {
+        // Non-compact mode.
+        assert(svf_ptr == nullptr);
+    }
+#endif
+
+    auto &builder = s.builder();
+
+    // Convert to std::uint32_t for overflow checking and use below.
+    const auto n_sv_funcs = boost::numeric_cast<std::uint32_t>(sv_funcs_dc.size());
+
+    // Overflow checking: ensure we can index into
+    // tc_ptr using std::uint32_t.
+    // NOTE: this is the same check done in taylor_add_jet_impl().
+    // LCOV_EXCL_START
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_eq > std::numeric_limits<std::uint32_t>::max() - n_sv_funcs
+        || n_eq + n_sv_funcs > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected while generating the code for writing the Taylor "
+                                  "polynomials of an ODE system into the output array");
+    }
+    // LCOV_EXCL_STOP
+
+    if (diff_variant.index() == 0u) {
+        // Compact mode.
+
+        auto *diff_arr = std::get<llvm::Value *>(diff_variant);
+
+        // Write out the Taylor coefficients for the state variables.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
+                          [&](llvm::Value *cur_order) {
+                              // Load the value of the derivative from diff_arr.
+                              auto *diff_val = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var);
+
+                              // Compute the index in the output pointer.
+                              auto *out_idx = builder.CreateAdd(
+                                  builder.CreateMul(builder.getInt32((order + 1u) * batch_size), cur_var),
+                                  builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+
+                              // Store into tc_ptr.
+                              store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val);
+                          });
+        });
+
+        // Write out the Taylor coefficients for the sv funcs, if necessary.
+        if (svf_ptr != nullptr) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_sv_funcs), [&](llvm::Value *arr_idx) {
+                // Fetch the u var index from svf_ptr.
+                auto *cur_idx = builder.CreateLoad(builder.CreateInBoundsGEP(svf_ptr, {arr_idx}));
+
+                llvm_loop_u32(
+                    s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
+                    [&](llvm::Value *cur_order) {
+                        // Load the derivative value from diff_arr.
+                        auto *diff_val = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_idx);
+
+                        // Compute the index in the output pointer.
+                        auto *out_idx
+                            = builder.CreateAdd(builder.CreateMul(builder.getInt32((order + 1u) * batch_size),
+                                                                  builder.CreateAdd(builder.getInt32(n_eq), arr_idx)),
+                                                builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+
+                        // Store into tc_ptr.
+                        store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val);
+                    });
+            });
+        }
+    } else {
+        // Non-compact mode.
+
+        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+
+        for (std::uint32_t j = 0; j < n_eq; ++j) {
+            for (decltype(diff_arr.size()) cur_order = 0; cur_order <= order; ++cur_order) {
+                // Index in the jet of derivatives.
+                // NOTE: in non-compact mode, diff_arr contains the derivatives only of the
+                // state variables and sv_variable (not all u vars), hence the indexing
+                // is cur_order * (n_eq + n_sv_funcs) + j.
+                const auto arr_idx = cur_order * (n_eq + n_sv_funcs) + j;
+                assert(arr_idx < diff_arr.size());
+                auto *const val = diff_arr[arr_idx];
+
+                // Index in tc_ptr.
+                const auto out_idx = (order + 1u) * batch_size * j + cur_order * batch_size;
+
+                // Write to tc_ptr.
+                auto *out_ptr
+                    = builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(static_cast<std::uint32_t>(out_idx))});
+                store_vector_to_memory(builder, out_ptr, val);
+            }
+        }
+
+        for (std::uint32_t j = 0; j < n_sv_funcs; ++j) {
+            for (decltype(diff_arr.size()) cur_order = 0; cur_order <= order; ++cur_order) {
+                // Index in the jet of derivatives.
+                const auto arr_idx = cur_order * (n_eq + n_sv_funcs) + n_eq + j;
+                assert(arr_idx < diff_arr.size());
+                auto *const val = diff_arr[arr_idx];
+
+                // Index in tc_ptr.
+                const auto out_idx = (order + 1u) * batch_size * (n_eq + j) + cur_order * batch_size;
+
+                // Write to tc_ptr.
+                auto *out_ptr
+                    = builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(static_cast<std::uint32_t>(out_idx))});
+                store_vector_to_memory(builder, out_ptr, val);
+            }
+        }
+    }
+}
+
+// Helper to fetch the number of equations of an ODE system,
+// which can also be given as a precomputed decomposition.
+template <typename U>
+std::size_t taylor_sys_size(const U &sys)
+{
+    if constexpr (std::is_same_v<U, taylor_precomputed_dc>) {
+        return static_cast<std::size_t>(sys.get_n_eq());
+    } else {
+        return sys.size();
+    }
+}
+
+// Helper to check that, if sys is a precomputed decomposition,
+// it contains the decomposition of the n_events event equations.
+template <typename U>
+void taylor_check_precomputed_dc_events([[maybe_unused]] const U &sys, [[maybe_unused]] std::size_t n_events)
+{
+    if constexpr (std::is_same_v<U, taylor_precomputed_dc>) {
+        if (sys.get_sv_funcs_dc().size() != n_events) {
+            throw std::invalid_argument(
+                "Invalid precomputed Taylor decomposition passed to the constructor of an adaptive Taylor "
+                "integrator: the decomposition includes {} event equation(s), but the integrator has {} "
+                "event(s)"_format(sys.get_sv_funcs_dc().size(), n_events));
+        }
+    }
+}
+
+// Helper to decompose an ODE system. If sys is
+// a precomputed decomposition, it is returned as is.
+// NOTE: in the precomputed case, sv_funcs is ignored: their
+// decomposition was checked against the events by the integrators'
+// constructors, and the steppers without events do not need it
+// (the u variables for the sv funcs are just not used).
+template <typename U>
+std::pair<taylor_dc_t, std::vector<std::uint32_t>> taylor_decompose_sys(U sys, std::vector<expression> sv_funcs)
+{
+    if constexpr (std::is_same_v<U, taylor_precomputed_dc>) {
+        return std::make_pair(sys.get_decomposition(), sys.get_sv_funcs_dc());
+    } else {
+        return taylor_decompose(std::move(sys), std::move(sv_funcs));
+    }
+}
+
+// Add to s an adaptive timestepper function with support for events. This timestepper will *not*
+// propagate the state of the system. Instead, its output will be the jet of derivatives
+// of all state variables and event equations, and the deduced timestep value(s).
+// NOTE: see taylor_add_adaptive_step() for the meaning of req_order and lane_tols.
+template <typename T, typename U>
+auto taylor_add_adaptive_step_with_events(llvm_state &s, const std::string &name, U sys, T tol,
+                                          std::uint32_t batch_size, bool, bool compact_mode, bool parallel_mode,
+                                          std::uint32_t unroll_threshold, bool contiguous_jets,
+                                          std::vector<expression> ntes, bool skip_one_way = false,
+                                          const std::vector<expression> &h_vars = {}, std::uint32_t req_order = 0,
+                                          const std::vector<T> &lane_tols = {})
+{
+    using std::isfinite;
+
+    trace_span span("taylor_add_adaptive_step", "taylor");
+
+    assert(!s.is_compiled());
+    assert(batch_size != 0u);
+    assert(isfinite(tol) && tol > 0);
+
+    // Determine the order.
+    // NOTE: no structured bindings, as order may be captured in lambdas.
+    const auto order_p = taylor_stepper_order(tol, req_order);
+    const auto order = order_p.first;
+    const auto h_tol = order_p.second;
+
+    // Record the number of equations/variables.
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(taylor_sys_size(sys));
+
+    // Decompose the system of equations.
+    auto [dc, ev_dc] = taylor_decompose_sys(std::move(sys), std::move(ntes));
+
+    // Compute the number of u variables.
+    assert(dc.size() > n_eq);
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Prepare the function prototype. The arguments are:
+    // - pointer to the output jet of derivative (write only),
+    // - pointer to the current state vector (read only),
+    // - pointer to the parameters (read only),
+    // - pointer to the time value(s) (read only),
+    // - pointer to the array of max timesteps (read & write).
+    // These pointers cannot overlap.
+    std::vector<llvm::Type *> fargs(5, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for an adaptive Taylor stepper with name '{}'"_format(name));
+    }
+
+    // Set the names/attributes of the function arguments.
+    auto *jet_ptr = f->args().begin();
+    jet_ptr->setName("jet_ptr");
+    jet_ptr->addAttr(llvm::Attribute::NoCapture);
+    jet_ptr->addAttr(llvm::Attribute::NoAlias);
+    jet_ptr->addAttr(llvm::Attribute::WriteOnly);
+    // NOTE: the jet of derivatives is always stored in an aligned_vector.
+    jet_ptr->addAttr(llvm::Attribute::getWithAlignment(context, llvm::Align(buffer_alignment)));
+
+    auto *state_ptr = jet_ptr + 1;
+    state_ptr->setName("state_ptr");
+    state_ptr->addAttr(llvm::Attribute::NoCapture);
+    state_ptr->addAttr(llvm::Attribute::NoAlias);
+    state_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *par_ptr = state_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *h_ptr = time_ptr + 1;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // Create a global read-only array containing the values in ev_dc, if there
+    // are any and we are in compact mode (otherwise, svf_ptr will be null).
+    auto *svf_ptr = compact_mode ? taylor_c_make_sv_funcs_arr(s, ev_dc) : nullptr;
+
+    // Compute the jet of derivatives at the given order.
+    auto diff_variant
+        = taylor_compute_jet<T>(s, state_ptr, par_ptr, time_ptr, dc, ev_dc, n_eq, n_uvars, order, batch_size,
+                                compact_mode, parallel_mode, unroll_threshold, contiguous_jets);
+
+    // Determine the integration timestep.
+    auto h = taylor_determine_h<T>(s, diff_variant, ev_dc, svf_ptr, h_ptr, n_eq, n_uvars, order, batch_size,
+                                   taylor_h_states(dc, n_eq, skip_one_way, h_vars),
+                                   taylor_h_tols(h_tol, lane_tols, batch_size));
+
+    // Store h to memory.
+    store_vector_to_memory(builder, h_ptr, h);
+
+    // Copy the jet of derivatives to jet_ptr.
+    taylor_write_tc(s, diff_variant, ev_dc, svf_ptr, jet_ptr, n_eq, n_uvars, order, batch_size);
+
+    // Create the return value.
+    builder.CreateRetVoid();
+
+    // Verify the function.
+    s.verify_function(f);
+
+    // Run the optimisation pass.
+    s.optimise();
+
+    return std::tuple{std::move(dc), order};
+}
+
+// Add to s a function computing the jet of derivatives of the event equations ee
+// from the jet of derivatives of the state variables vars, up to order 'order'. The
+// function reads the Taylor coefficients of the state variables from the first rows
+// of the jet (in the layout used by taylor_write_tc()), and it writes the Taylor
+// coefficients of the event equations in the following rows. This is used when the
+// event equations are compiled separately from the stepper.
+// NOTE: the code is always generated in non-compact mode, as the
+// event equations are typically small.
+template <typename T>
+void taylor_add_ev_jet(llvm_state &s, const std::string &name, const std::vector<expression> &vars,
+                       std::vector<expression> ee, std::uint32_t order, std::uint32_t batch_size)
+{
+    assert(!s.is_compiled());
+    assert(batch_size != 0u);
+    assert(order > 0u);
+    assert(!ee.empty());
+
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(vars.size());
+    const auto n_ev = boost::numeric_cast<std::uint32_t>(ee.size());
+
+    // LCOV_EXCL_START
+    if (n_eq > std::numeric_limits<std::uint32_t>::max() - n_ev || order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_eq + n_ev > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected in the generation of the jet of the "
+                                  "event equations");
+    }
+    // LCOV_EXCL_STOP
+
+    // Decompose the event equations.
+    // NOTE: the dummy dynamics x_i' = x_i does not add any u variable
+    // to the decomposition, which thus contains only the state variables
+    // and the u variables of the event equations.
+    std::vector<std::pair<expression, expression>> dsys;
+    for (const auto &var : vars) {
+        dsys.emplace_back(var, var);
+    }
+    auto [dc, ev_dc] = taylor_decompose(std::move(dsys), std::move(ee));
+    assert(ev_dc.size() == n_ev);
+
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Prepare the function prototype. The arguments are:
+    // - pointer to the jet of derivatives (read & write),
+    // - pointer to the parameters (read only),
+    // - pointer to the time value(s) (read only).
+    // These pointers cannot overlap.
+    std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    // LCOV_EXCL_START
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for the jet of the event equations with name '{}'"_format(name));
+    }
+    // LCOV_EXCL_STOP
+
+    auto *jet_ptr = f->args().begin();
+    jet_ptr->setName("jet_ptr");
+    jet_ptr->addAttr(llvm::Attribute::NoCapture);
+    jet_ptr->addAttr(llvm::Attribute::NoAlias);
+    jet_ptr->addAttr(llvm::Attribute::getWithAlignment(context, llvm::Align(buffer_alignment)));
+
+    auto *par_ptr = jet_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // Compute the derivatives order by order. The derivatives of the
+    // state variables are loaded from the jet, the derivatives of the
+    // other u variables are computed as in taylor_compute_jet().
+    std::vector<llvm::Value *> diff_arr;
+    for (std::uint32_t o = 0; o <= order; ++o) {
+        for (std::uint32_t j = 0; j < n_eq; ++j) {
+            const auto idx = (order + 1u) * batch_size * j + o * batch_size;
+            auto *ptr = builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(idx)});
+            diff_arr.push_back(load_vector_from_memory(builder, ptr, batch_size));
+        }
+
+        for (auto i = n_eq; i < n_uvars; ++i) {
+            diff_arr.push_back(
+                taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars, o, i, batch_size));
+        }
+    }
+
+    // Write the derivatives of the event equations.
+    for (std::uint32_t k = 0; k < n_ev; ++k) {
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            const auto idx = (order + 1u) * batch_size * (n_eq + k) + o * batch_size;
+            auto *ptr = builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32(idx)});
+            store_vector_to_memory(builder, ptr, taylor_fetch_diff(diff_arr, ev_dc[k], o, n_uvars));
+        }
+    }
+
+    builder.CreateRetVoid();
+
+    s.verify_function(f);
+}
+
+// Small helper to deduce the number of parameters
+// present in the rhs of an ODE.
+template <typename T>
+std::uint32_t n_pars_in_sys(const T &sys)
+{
+    std::uint32_t retval = 0;
+
+    if constexpr (std::is_same_v<T, taylor_precomputed_dc>) {
+        // NOTE: the params can appear only as arguments of the
+        // u variables definitions or in the rhs of the equations.
+        for (const auto &p : sys.get_decomposition()) {
+            retval = std::max(retval, get_param_size(p.first));
+        }
+    } else {
+        for (const auto &p : sys) {
+            if constexpr (std::is_same_v<uncvref_t<decltype(p)>, expression>) {
+                retval = std::max(retval, get_param_size(p));
+            } else {
+                retval = std::max(retval, get_param_size(p.second));
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Small helper to convert an ODE system into the explicit
+// form. In the implicit form, the state variables are ordered
+// alphabetically, as in taylor_decompose(). For a precomputed
+// decomposition, an empty optional is returned.
+template <typename T>
+std::optional<std::vector<std::pair<expression, expression>>> taylor_sys_to_pairs(const T &sys)
+{
+    if constexpr (std::is_same_v<T, taylor_precomputed_dc>) {
+        return {};
+    } else if constexpr (std::is_same_v<T, std::vector<expression>>) {
+        std::set<std::string> vars;
+        for (const auto &ex : sys) {
+            for (const auto &var : get_variables(ex)) {
+                vars.emplace(var);
+            }
+        }
+
+        // NOTE: the system will be rejected by taylor_decompose().
+        if (vars.size() != sys.size()) {
+            return {};
+        }
+
+        std::vector<std::pair<expression, expression>> retval;
+        auto it = vars.begin();
+        for (const auto &ex : sys) {
+            retval.emplace_back(expression{variable{*it++}}, ex);
+        }
+
+        return retval;
+    } else {
+        return sys;
+    }
+}
+
+// Small helper to replace the params in ex
+// with the corresponding values in pars.
+template <typename T>
+expression taylor_pars_to_numbers(const expression &ex, const std::vector<T> &pars)
+{
+    return std::visit(
+        [&pars](const auto &v) -> expression {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, param>) {
+                assert(v.idx() < pars.size());
+
+                return expression{number{pars[v.idx()]}};
+            } else if constexpr (std::is_same_v<type, func>) {
+                auto f_copy = v;
+
+                for (auto [b, e] = f_copy.get_mutable_args_it(); b != e; ++b) {
+                    *b = taylor_pars_to_numbers(*b, pars);
+                }
+
+                return expression{std::move(f_copy)};
+            } else {
+                return expression{v};
+            }
+        },
+        ex.value());
+}
+
+// Run the Horner scheme to propagate an ODE state via the evaluation of the Taylor polynomials.
+// diff_var contains either the derivatives for all u variables (in compact mode) or only
+// for the state variables (non-compact mode). The evaluation point (i.e., the timestep)
+// is h. The evaluation is run in parallel over the polynomials of all the state
+// variables.
+// NOTE: the Taylor coefficients of order less than dl_order are accumulated
+// in double-length arithmetic. The higher orders, whose contribution to the
+// result is small, are accumulated in the working precision.
+std::variant<llvm::Value *, std::vector<llvm::Value *>>
+taylor_run_multihorner(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var,
+                       llvm::Value *h, std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
+                       bool compact_mode, std::uint32_t dl_order = 0)
+{
+    auto &builder = s.builder();
+
+    // Number of orders evaluated in double-length arithmetic.
+    // NOTE: the highest-order coefficient is used to init
+    // the evaluation, thus at most order orders are accumulated.
+    const auto n_dl = std::min(dl_order, order);
+
+    // The zero constant, used as low part of the coefficients
+    // and of h in the double-length evaluation.
+    auto *fp_zero = llvm::Constant::getNullValue(h->getType());
+
+    // NOTE: the fast math flags must be cleared
+    // in the double-length evaluation.
+    std::optional<ir_builder::FastMathFlagGuard> fmf_guard;
+
+    if (compact_mode) {
+        // Compact mode.
+        auto *diff_arr = std::get<llvm::Value *>(diff_var);
+
+        // Create the array storing the results of the evaluation.
+        auto *array_type = llvm::ArrayType::get(pointee_type(diff_arr), n_eq);
+        auto *res_arr
+            = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
+
+        // Init the return value, filling it with the values of the
+        // coefficients of the highest-degree monomial in each polynomial.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            // Load the value from diff_arr and store it in res_arr.
+            builder.CreateStore(taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_var_idx),
+                                builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+        });
+
+        // Run the evaluation.
+        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order - n_dl + 1u), [&](llvm::Value *cur_order) {
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                // Load the current poly coeff from diff_arr.
+                // NOTE: we are loading the coefficients backwards wrt the order, hence
+                // we specify order - cur_order.
+                auto *cf = taylor_c_load_diff(s, diff_arr, n_uvars,
+                                              builder.CreateSub(builder.getInt32(order), cur_order), cur_var_idx);
+
+                // Accumulate in res_arr.
+                auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+                builder.CreateStore(builder.CreateFAdd(cf, builder.CreateFMul(builder.CreateLoad(res_ptr), h)),
+                                    res_ptr);
+            });
+        });
+
+        if (n_dl > 0u) {
+            fmf_guard.emplace(builder);
+            builder.clearFastMathFlags();
+
+            // Create and zero-init the array storing the low parts of the results.
+            auto *lo_arr = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type),
+                                                     {builder.getInt32(0), builder.getInt32(0)});
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                builder.CreateStore(fp_zero, builder.CreateInBoundsGEP(lo_arr, {cur_var_idx}));
+            });
+
+            // Run the double-length evaluation of the low orders.
+            llvm_loop_u32(
+                s, builder.getInt32(order - n_dl + 1u), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+                    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                        auto *cf = taylor_c_load_diff(s, diff_arr, n_uvars,
+                                                      builder.CreateSub(builder.getInt32(order), cur_order),
+                                                      cur_var_idx);
+
+                        auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+                        auto *lo_ptr = builder.CreateInBoundsGEP(lo_arr, {cur_var_idx});
+
+                        auto [p_hi, p_lo]
+                            = llvm_dl_mul(s, builder.CreateLoad(res_ptr), builder.CreateLoad(lo_ptr), h, fp_zero);
+                        auto [r_hi, r_lo] = llvm_dl_add(s, p_hi, p_lo, cf, fp_zero);
+
+                        builder.CreateStore(r_hi, res_ptr);
+                        builder.CreateStore(r_lo, lo_ptr);
+                    });
+                });
+        }
+
+        return res_arr;
+    } else {
+        // Non-compact mode.
+        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
+
+        // Init the return value, filling it with the values of the
+        // coefficients of the highest-degree monomial in each polynomial.
+        std::vector<llvm::Value *> res_arr;
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            res_arr.push_back(diff_arr[(n_eq * order) + i]);
+        }
+
+        // Run the Horner scheme simultaneously for all polynomials.
+        for (std::uint32_t i = 1; i <= order - n_dl; ++i) {
+            for (std::uint32_t j = 0; j < n_eq; ++j) {
+                res_arr[j] = builder.CreateFAdd(diff_arr[(order - i) * n_eq + j], builder.CreateFMul(res_arr[j], h));
+            }
+        }
+
+        if (n_dl > 0u) {
+            fmf_guard.emplace(builder);
+            builder.clearFastMathFlags();
+
+            // Run the double-length evaluation of the low orders.
+            std::vector<llvm::Value *> lo_arr(n_eq, fp_zero);
+            for (auto i = order - n_dl + 1u; i <= order; ++i) {
+                for (std::uint32_t j = 0; j < n_eq; ++j) {
+                    auto [p_hi, p_lo] = llvm_dl_mul(s, res_arr[j], lo_arr[j], h, fp_zero);
+                    std::tie(res_arr[j], lo_arr[j])
+                        = llvm_dl_add(s, p_hi, p_lo, diff_arr[(order - i) * n_eq + j], fp_zero);
+                }
+            }
+        }
+
+        return res_arr;
+    }
+}
+
+// Same as taylor_run_multihorner(), but instead of the Horner scheme this implementation uses
+// a compensated summation over the naive evaluation of monomials.
+template <typename T>
+std::variant<llvm::Value *, std::vector<llvm::Value *>>
+taylor_run_ceval(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var, llvm::Value *h,
+                 std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool,
+                 bool compact_mode)
+{
+    auto &builder = s.builder();
+
+    if (compact_mode) {
+        // Compact mode.
+        auto *diff_arr = std::get<llvm::Value *>(diff_var);
+
+        // Create the arrays storing the results of the evaluation and the running compensations.
+        auto *array_type = llvm::ArrayType::get(pointee_type(diff_arr), n_eq);
+        auto *res_arr
+            = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
+        auto *comp_arr
+            = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
+
+        // Init res_arr with the order-0 coefficients, and the running
+        // compensations with zero.
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            // Load the value from diff_arr.
+            auto *val = builder.CreateLoad(builder.CreateInBoundsGEP(diff_arr, {cur_var_idx}));
+
+            // Store it in res_arr.
+            builder.CreateStore(val, builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+
+            // Zero-init the element in comp_arr.
+            builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size),
+                                builder.CreateInBoundsGEP(comp_arr, {cur_var_idx}));
+        });
+
+        // Init the running updater for the powers of h.
+        auto *cur_h = builder.CreateAlloca(h->getType());
+        builder.CreateStore(h, cur_h);
+
+        // Run the evaluation.
+        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+            // Load the current power of h.
+            auto *cur_h_val = builder.CreateLoad(cur_h);
+
+            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+                // Evaluate the current monomial.
+                auto *cf = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var_idx);
+                auto *tmp = builder.CreateFMul(cf, cur_h_val);
+
+                // Compute the quantities for the compensation.
+                auto *comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
+                auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
+                auto *y = builder.CreateFSub(tmp, builder.CreateLoad(comp_ptr));
+                auto *cur_res = builder.CreateLoad(res_ptr);
+                auto *t = builder.CreateFAdd(cur_res, y);
+
+                // Update the compensation and the return value.
+                builder.CreateStore(builder.CreateFSub(builder.CreateFSub(t, cur_res), y), comp_ptr);
+                builder.CreateStore(t, res_ptr);
+            });
+
+            // Update the value of h.
+            builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
+        });
+
+        return res_arr;
+    } else {
+        // Non-compact mode.
+        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
+
+        // Init the return values with the order-0 monomials, and the running
+        // compensations with zero.
+        std::vector<llvm::Value *> res_arr, comp_arr;
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            res_arr.push_back(diff_arr[i]);
+            comp_arr.push_back(vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+        }
+
+        // Evaluate and sum.
+        auto *cur_h = h;
+        for (std::uint32_t i = 1; i <= order; ++i) {
+            for (std::uint32_t j = 0; j < n_eq; ++j) {
+                // Evaluate the current monomial.
+                auto *tmp = builder.CreateFMul(diff_arr[i * n_eq + j], cur_h);
+
+                // Compute the quantities for the compensation.
+                auto *y = builder.CreateFSub(tmp, comp_arr[j]);
+                auto *t = builder.CreateFAdd(res_arr[j], y);
+
+                // Update the compensation and the return value.
+                comp_arr[j] = builder.CreateFSub(builder.CreateFSub(t, res_arr[j]), y);
+                res_arr[j] = t;
+            }
+
+            // Update the power of h.
+            cur_h = builder.CreateFMul(cur_h, h);
+        }
+
+        return res_arr;
+    }
+}
+
+// Selective version of taylor_run_ceval(): only the state variables whose indices are
+// in ha_states are evaluated via compensated summation, while the other state variables
+// are evaluated via the Horner scheme (see taylor_run_multihorner()).
+template <typename T>
+std::variant<llvm::Value *, std::vector<llvm::Value *>>
+taylor_run_sel_ceval(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var,
+                     llvm::Value *h, std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order,
+                     std::uint32_t batch_size, bool compact_mode, const std::vector<std::uint32_t> &ha_states)
+{
+    assert(!ha_states.empty());
+    assert(std::is_sorted(ha_states.begin(), ha_states.end()));
+
+    auto &builder = s.builder();
+
+    // Run first the Horner scheme for all the state variables.
+    auto retval = taylor_run_multihorner(s, diff_var, h, n_eq, n_uvars, order, batch_size, compact_mode);
+
+    if (compact_mode) {
+        auto *diff_arr = std::get<llvm::Value *>(diff_var);
+        auto *res_arr = std::get<llvm::Value *>(retval);
+
+        // Fetch the global array of the indices of the
+        // state variables in high-accuracy mode.
+        auto *ha_arr = taylor_c_make_sv_funcs_arr(s, ha_states);
+
+        // The storage for the running sum, the running
+        // compensation and the current power of h.
+        auto *res_ptr = builder.CreateAlloca(h->getType());
+        auto *comp_ptr = builder.CreateAlloca(h->getType());
+        auto *cur_h = builder.CreateAlloca(h->getType());
+
+        // Overwrite the results of the Horner scheme with
+        // the compensated summation for the state variables in ha_states.
+        llvm_loop_u32(
+            s, builder.getInt32(0), builder.getInt32(static_cast<std::uint32_t>(ha_states.size())),
+            [&](llvm::Value *k) {
+                auto *cur_var_idx = builder.CreateLoad(builder.CreateInBoundsGEP(ha_arr, {k}));
+
+                builder.CreateStore(builder.CreateLoad(builder.CreateInBoundsGEP(diff_arr, {cur_var_idx})), res_ptr);
+                builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size), comp_ptr);
+                builder.CreateStore(h, cur_h);
+
+                llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
+                    auto *cur_h_val = builder.CreateLoad(cur_h);
+
+                    // Evaluate the current monomial.
+                    auto *cf = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var_idx);
+                    auto *tmp = builder.CreateFMul(cf, cur_h_val);
+
+                    // Compute the quantities for the compensation.
+                    auto *y = builder.CreateFSub(tmp, builder.CreateLoad(comp_ptr));
+                    auto *cur_res = builder.CreateLoad(res_ptr);
+                    auto *t = builder.CreateFAdd(cur_res, y);
+
+                    // Update the compensation, the running sum and the power of h.
+                    builder.CreateStore(builder.CreateFSub(builder.CreateFSub(t, cur_res), y), comp_ptr);
+                    builder.CreateStore(t, res_ptr);
+                    builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
+                });
+
+                builder.CreateStore(builder.CreateLoad(res_ptr), builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+            });
+    } else {
+        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
+        auto &res_arr = std::get<std::vector<llvm::Value *>>(retval);
+
+        // NOTE: the results of the Horner scheme which are
+        // overwritten here are removed by dead code elimination.
+        for (auto j : ha_states) {
+            auto *res = diff_arr[j];
+            auto *comp = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+
+            auto *cur_h = h;
+            for (std::uint32_t i = 1; i <= order; ++i) {
+                // Evaluate the current monomial.
+                auto *tmp = builder.CreateFMul(diff_arr[i * n_eq + j], cur_h);
+
+                // Compute the quantities for the compensation.
+                auto *y = builder.CreateFSub(tmp, comp);
+                auto *t = builder.CreateFAdd(res, y);
+
+                // Update the compensation and the running sum.
+                comp = builder.CreateFSub(builder.CreateFSub(t, res), y);
+                res = t;
+
+                // Update the power of h.
+                cur_h = builder.CreateFMul(cur_h, h);
+            }
+
+            res_arr[j] = res;
+        }
+    }
+
+    return retval;
+}
+
+// The outcome flags written by the fused stepper.
+// NOTE: these are also the outcome codes of the raw stepper.
+constexpr std::int32_t taylor_step_flag_success = taylor_raw_step_success;
+constexpr std::int32_t taylor_step_flag_tl = taylor_raw_step_time_limit;
+constexpr std::int32_t taylor_step_flag_nf = taylor_raw_step_err_nf_state;
+
+// NOTE: in compact mode, care must be taken when adding multiple stepper functions to the same llvm state
+// with the same floating-point type, batch size and number of u variables. The potential issue there
+// is that when the first stepper is added, the compact mode AD functions are created and then optimised.
+// The optimisation pass might alter the functions in a way that makes them incompatible with subsequent
+// uses in the second stepper (e.g., an argument might be removed from the signature because it is a
+// compile-time constant). A workaround to avoid issues is to set the optimisation level to zero
+// in the state, add the 2 steppers and then run a single optimisation pass. This is what we do
+// in the integrators' ctors.
+// NOTE: document this eventually.
+// NOTE: if fused is true, the stepper also updates the time
+// in double-length arithmetic, checks the new state and time
+// for non-finite values and classifies the outcome of the
+// timestep (see below for the function prototype).
+// NOTE: if dl_order is nonzero, the Taylor coefficients of order less
+// than dl_order are accumulated in double-length arithmetic in the
+// evaluation of the Taylor polynomials (see taylor_run_multihorner()).
+// NOTE: if fixed_order is nonzero, the stepper has the order fixed_order
+// and it uses as-is the timesteps in h_ptr, without step-size control.
+// NOTE: if req_order is nonzero, it is used in place of the order
+// deduced from the tolerance (see taylor_stepper_order()).
+// NOTE: if lane_tols is not empty, it contains the tolerances of the
+// batch elements, and tol must be the tightest one (see taylor_h_tols()).
+template <typename T, typename U>
+auto taylor_add_adaptive_step(llvm_state &s, const std::string &name, U sys, T tol, std::uint32_t batch_size,
+                              bool high_accuracy, bool compact_mode, bool parallel_mode, std::uint32_t unroll_threshold,
+                              bool contiguous_jets, bool fused = false, std::uint32_t dl_order = 0,
+                              bool skip_one_way = false, const std::vector<expression> &h_vars = {},
+                              std::uint32_t fixed_order = 0, std::uint32_t req_order = 0,
+                              const std::vector<T> &lane_tols = {}, const std::vector<expression> &ha_vars = {})
+{
+    using std::isfinite;
+
+    trace_span span("taylor_add_adaptive_step", "taylor");
+
+    assert(!s.is_compiled());
+    assert(batch_size > 0u);
+    assert(isfinite(tol) && tol > 0);
+
+    // Determine the order.
+    // NOTE: no structured bindings, as order may be captured in lambdas.
+    const auto order_p = fixed_order > 0u ? std::pair{fixed_order, T(0)} : taylor_stepper_order(tol, req_order);
+    const auto order = order_p.first;
+    const auto h_tol = order_p.second;
+
+    // Record the number of equations/variables.
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(taylor_sys_size(sys));
+
+    // Decompose the system of equations.
+    // NOTE: no sv_funcs needed for this stepper.
+    auto [dc, sv_funcs_dc] = taylor_decompose_sys(std::move(sys), {});
+
+    assert((sv_funcs_dc.empty() || std::is_same_v<U, taylor_precomputed_dc>));
+
+    // Compute the number of u variables.
+    assert(dc.size() > n_eq);
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+
+    // Prepare the function prototype. The arguments are:
+    // - pointer to the current state vector (read & write),
+    // - pointer to the parameters (read only),
+    // - pointer to the time value(s) (read only),
+    // - pointer to the array of max timesteps (read & write),
+    // - pointer to the Taylor coefficients output (write only).
+    // In fused mode, the arguments are instead:
+    // - pointer to the current state vector (read & write),
+    // - pointer to the parameters (read only),
+    // - pointer to the hi part of the time value(s) (read & write),
+    // - pointer to the lo part of the time value(s) (read & write),
+    // - pointer to the array of max timesteps (read & write),
+    // - pointer to the Taylor coefficients output (write only),
+    // - pointer to the outcome flags output (write only).
+    // The outcome flag of each batch element is 0 if the timestep was
+    // successful, 1 if the timestep was limited by the max timestep
+    // and 2 if non-finite values were detected in the new state or time
+    // (see the taylor_step_flag_* constants).
+    // These pointers cannot overlap.
+    std::vector<llvm::Type *> fargs(fused ? 6u : 5u, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
+    if (fused) {
+        fargs.push_back(llvm::PointerType::getUnqual(builder.getInt32Ty()));
+    }
+    // The function does not return anything.
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    // Now create the function.
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    if (f == nullptr) {
+        throw std::invalid_argument(
+            "Unable to create a function for an adaptive Taylor stepper with name '{}'"_format(name));
+    }
+
+    // Set the names/attributes of the function arguments.
+    auto *state_ptr = f->args().begin();
+    state_ptr->setName("state_ptr");
+    state_ptr->addAttr(llvm::Attribute::NoCapture);
+    state_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    auto *par_ptr = state_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    if (!fused) {
+        time_ptr->addAttr(llvm::Attribute::ReadOnly);
     }
-    assert(sv_funcs_dc.size() == sv_funcs.size());
 
-    // Append the (possibly updated) definitions of the diff equations
-    // in terms of u variables.
-    for (auto &[_, rhs] : sys_copy) {
-        u_vars_defs.emplace_back(std::move(rhs), std::vector<std::uint32_t>{});
+    llvm::Argument *time_lo_ptr = nullptr;
+    if (fused) {
+        time_lo_ptr = time_ptr + 1;
+        time_lo_ptr->setName("time_lo_ptr");
+        time_lo_ptr->addAttr(llvm::Attribute::NoCapture);
+        time_lo_ptr->addAttr(llvm::Attribute::NoAlias);
     }
 
-#if !defined(NDEBUG)
-    // Verify the decomposition.
-    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
-    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
-#endif
+    auto *h_ptr = fused ? time_lo_ptr + 1 : time_ptr + 1;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
 
-    // Simplify the decomposition.
-    u_vars_defs = detail::taylor_decompose_cse(u_vars_defs, sv_funcs_dc, n_eq);
+    auto *tc_ptr = h_ptr + 1;
+    tc_ptr->setName("tc_ptr");
+    tc_ptr->addAttr(llvm::Attribute::NoCapture);
+    tc_ptr->addAttr(llvm::Attribute::NoAlias);
+    tc_ptr->addAttr(llvm::Attribute::WriteOnly);
 
-#if !defined(NDEBUG)
-    // Verify the simplified decomposition.
-    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
-    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
-#endif
+    llvm::Argument *flags_ptr = nullptr;
+    if (fused) {
+        flags_ptr = tc_ptr + 1;
+        flags_ptr->setName("flags_ptr");
+        flags_ptr->addAttr(llvm::Attribute::NoCapture);
+        flags_ptr->addAttr(llvm::Attribute::NoAlias);
+        flags_ptr->addAttr(llvm::Attribute::WriteOnly);
+    }
 
-    // Run the breadth-first topological sort on the decomposition.
-    u_vars_defs = detail::taylor_sort_dc(u_vars_defs, sv_funcs_dc, n_eq);
+    // Create a new basic block to start insertion into.
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
 
-#if !defined(NDEBUG)
-    // Verify the reordered decomposition.
-    detail::verify_taylor_dec(orig_rhs, u_vars_defs);
-    detail::verify_taylor_dec_sv_funcs(sv_funcs_dc, orig_sv_funcs, u_vars_defs, n_eq);
-#endif
+    // Compute the jet of derivatives at the given order.
+    auto diff_variant = taylor_compute_jet<T>(s, state_ptr, par_ptr, time_ptr, dc, {}, n_eq, n_uvars, order, batch_size,
+                                              compact_mode, parallel_mode, unroll_threshold, contiguous_jets);
 
-    return std::make_pair(std::move(u_vars_defs), std::move(sv_funcs_dc));
+    // In fused mode, load the max timesteps for
+    // the classification of the outcome.
+    auto *max_h = fused ? load_vector_from_memory(builder, h_ptr, batch_size) : nullptr;
+
+    // Determine the integration timestep.
+    auto h = fixed_order > 0u
+                 ? load_vector_from_memory(builder, h_ptr, batch_size)
+                 : taylor_determine_h<T>(s, diff_variant, sv_funcs_dc, nullptr, h_ptr, n_eq, n_uvars, order,
+                                         batch_size, taylor_h_states(dc, n_eq, skip_one_way, h_vars),
+                                         taylor_h_tols(h_tol, lane_tols, batch_size));
+
+    // Evaluate the Taylor polynomials, producing the updated state of the system.
+    // NOTE: the double-length evaluation of the low orders takes the precedence
+    // over the compensated summation of high accuracy mode. If ha_vars is not empty,
+    // the compensated summation is used only for the state variables in ha_vars.
+    const auto ha_states = taylor_ha_states(dc, n_eq, ha_vars);
+    auto new_state_var
+        = dl_order > 0u || (!high_accuracy && ha_states.empty())
+              ? taylor_run_multihorner(s, diff_variant, h, n_eq, n_uvars, order, batch_size, compact_mode, dl_order)
+          : ha_states.empty()
+              ? taylor_run_ceval<T>(s, diff_variant, h, n_eq, n_uvars, order, batch_size, high_accuracy, compact_mode)
+              : taylor_run_sel_ceval<T>(s, diff_variant, h, n_eq, n_uvars, order, batch_size, compact_mode, ha_states);
+
+    // In fused mode, the accumulator for the finiteness check.
+    // NOTE: the non-finite values are detected by accumulating
+    // x * 0 for all the values x to be checked: the result
+    // is NaN if and only if at least one x is non-finite.
+    // NOTE: the fast math flags must be cleared, as they
+    // would allow to fold away the check.
+    std::optional<ir_builder::FastMathFlagGuard> fmf_guard;
+    llvm::Value *nf_acc = nullptr;
+    llvm::Value *fp_zero = nullptr;
+    if (fused) {
+        fmf_guard.emplace(builder);
+        builder.clearFastMathFlags();
+
+        fp_zero = vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
+        nf_acc = fp_zero;
+    }
+
+    // Store the new state.
+    // NOTE: no need to perform overflow check on n_eq * batch_size,
+    // as in taylor_compute_jet() we already checked.
+    if (compact_mode) {
+        auto new_state = std::get<llvm::Value *>(new_state_var);
+
+        llvm::Value *nf_acc_ptr = nullptr;
+        if (fused) {
+            nf_acc_ptr = builder.CreateAlloca(nf_acc->getType());
+            builder.CreateStore(nf_acc, nf_acc_ptr);
+        }
+
+        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
+            auto val = builder.CreateLoad(builder.CreateInBoundsGEP(new_state, {cur_var_idx}));
+            store_vector_to_memory(
+                builder,
+                builder.CreateInBoundsGEP(state_ptr, builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))),
+                val);
+
+            if (fused) {
+                builder.CreateStore(
+                    builder.CreateFAdd(builder.CreateLoad(nf_acc_ptr), builder.CreateFMul(val, fp_zero)), nf_acc_ptr);
+            }
+        });
+
+        if (fused) {
+            nf_acc = builder.CreateLoad(nf_acc_ptr);
+        }
+    } else {
+        const auto &new_state = std::get<std::vector<llvm::Value *>>(new_state_var);
+
+        assert(new_state.size() == n_eq);
+
+        for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
+            store_vector_to_memory(builder,
+                                   builder.CreateInBoundsGEP(state_ptr, builder.getInt32(var_idx * batch_size)),
+                                   new_state[var_idx]);
+
+            if (fused) {
+                nf_acc = builder.CreateFAdd(nf_acc, builder.CreateFMul(new_state[var_idx], fp_zero));
+            }
+        }
+    }
+
+    // Store the timesteps that were used.
+    store_vector_to_memory(builder, h_ptr, h);
+
+    if (fused) {
+        // Update the time in double-length arithmetic.
+        // NOTE: the lo part of the timestep is zero.
+        auto [new_time_hi, new_time_lo]
+            = llvm_dl_add(s, load_vector_from_memory(builder, time_ptr, batch_size),
+                            load_vector_from_memory(builder, time_lo_ptr, batch_size), h, fp_zero);
+        store_vector_to_memory(builder, time_ptr, new_time_hi);
+        store_vector_to_memory(builder, time_lo_ptr, new_time_lo);
+
+        // Add the new time to the finiteness check.
+        nf_acc = builder.CreateFAdd(nf_acc, builder.CreateFMul(new_time_hi, fp_zero));
+        nf_acc = builder.CreateFAdd(nf_acc, builder.CreateFMul(new_time_lo, fp_zero));
+        auto *nf_flags = builder.CreateFCmpUNO(nf_acc, nf_acc);
+
+        // Classify the outcome and store the flags.
+        auto flag_splat = [&](std::int32_t v) {
+            return vector_splat(builder, builder.getInt32(static_cast<std::uint32_t>(v)), batch_size);
+        };
+        auto *flags = builder.CreateSelect(nf_flags, flag_splat(taylor_step_flag_nf),
+                                           builder.CreateSelect(builder.CreateFCmpOEQ(h, max_h),
+                                                                flag_splat(taylor_step_flag_tl),
+                                                                flag_splat(taylor_step_flag_success)));
+        store_vector_to_memory(builder, flags_ptr, flags);
+
+        fmf_guard.reset();
+    }
+
+    // Write the Taylor coefficients, if requested.
+    auto nptr = llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
+    llvm_if_then_else(
+        s, builder.CreateICmpNE(tc_ptr, nptr),
+        [&]() {
+            // tc_ptr is not null: copy the Taylor coefficients
+            // for the state variables.
+            taylor_write_tc(s, diff_variant, {}, nullptr, tc_ptr, n_eq, n_uvars, order, batch_size);
+        },
+        [&]() {
+            // Taylor coefficients were not requested,
+            // don't do anything in this branch.
+        });
+
+    // Create the return value.
+    builder.CreateRetVoid();
+
+    // Verify the function.
+    s.verify_function(f);
+
+    // Run the optimisation pass.
+    s.optimise();
+
+    return std::tuple{std::move(dc), order};
 }
 
-namespace detail
+// Name of the stepper function in an adaptive integrator.
+const char *taylor_step_name(bool with_events, bool fused_step)
 {
+    assert(!with_events || !fused_step);
 
-namespace
+    if (with_events) {
+        return "step_e";
+    }
+
+    return fused_step ? "step_f" : "step";
+}
+
+// Look up the stepper of an adaptive integrator in the compiled state s.
+// V is the variant type holding the stepper. Its alternatives are, in order,
+// the vanilla stepper, the stepper with events and the fused stepper.
+template <typename V>
+V taylor_lookup_step(llvm_state &s, bool with_events, bool fused_step)
 {
+    const auto addr = s.jit_lookup(taylor_step_name(with_events, fused_step));
 
-// Helper to determine the optimal Taylor order for a given tolerance,
-// following Jorba's prescription.
+    if (with_events) {
+        return reinterpret_cast<std::variant_alternative_t<1, V>>(addr);
+    } else if (fused_step) {
+        return reinterpret_cast<std::variant_alternative_t<2, V>>(addr);
+    } else {
+        return reinterpret_cast<std::variant_alternative_t<0, V>>(addr);
+    }
+}
+
+// Add to s a function with name 'name' which repeatedly invokes the scalar fused stepper
+// step_name (already present in s) until either the final time is reached, the maximum number
+// of steps is reached or a non-finite state is detected. The logic mirrors exactly the
+// implementation of taylor_adaptive_impl::propagate_until_impl() without callbacks and
+// continuous output. The arguments of the function are:
+// - pointer to the current state vector (read & write),
+// - pointer to the parameters (read only),
+// - pointers to the hi and lo parts of the time value (read & write),
+// - pointer to the Taylor coefficients output (write only, may be null),
+// - pointer to the input values (read only), that is, the hi and lo parts of the final time,
+//   the max timestep and the integration direction (nonzero if forward),
+// - the maximum number of steps (zero meaning no limit),
+// - pointer to the output values (read & write), that is, the min and max abs timesteps
+//   (which must be inited by the caller) and the last timestep,
+// - pointer to the output step counter (write only).
+// The return value is 0 if the final time was reached, 1 if the maximum
+// number of steps was reached and 2 if a non-finite state was detected.
 template <typename T>
-std::uint32_t taylor_order_from_tol(T tol)
+void taylor_add_step_n(llvm_state &s, const std::string &name, const std::string &step_name)
 {
-    using std::ceil;
-    using std::isfinite;
-    using std::log;
+    auto &builder = s.builder();
+    auto &context = s.context();
 
-    // Determine the order from the tolerance.
-    auto order_f = ceil(-log(tol) / 2 + 1);
-    if (!isfinite(order_f)) {
+    auto *step_f = s.module().getFunction(step_name);
+    assert(step_f != nullptr);
+
+    auto *fp_ptr_t = llvm::PointerType::getUnqual(to_llvm_type<T>(context));
+    const std::vector<llvm::Type *> fargs{fp_ptr_t,
+                                          fp_ptr_t,
+                                          fp_ptr_t,
+                                          fp_ptr_t,
+                                          fp_ptr_t,
+                                          fp_ptr_t,
+                                          builder.getInt64Ty(),
+                                          fp_ptr_t,
+                                          llvm::PointerType::getUnqual(builder.getInt64Ty())};
+    auto *ft = llvm::FunctionType::get(builder.getInt32Ty(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
+    // LCOV_EXCL_START
+    if (f == nullptr) {
         throw std::invalid_argument(
-            "The computation of the Taylor order in an adaptive Taylor stepper produced a non-finite value");
+            "Unable to create a function for a multi-step adaptive Taylor driver with name '{}'"_format(name));
     }
-    // NOTE: min order is 2.
-    order_f = std::max(T(2), order_f);
+    // LCOV_EXCL_STOP
 
-    // NOTE: cast to double as that ensures that the
-    // max of std::uint32_t is exactly representable.
-    // LCOV_EXCL_START
-    if (order_f > static_cast<double>(std::numeric_limits<std::uint32_t>::max())) {
-        throw std::overflow_error("The computation of the Taylor order in an adaptive Taylor stepper resulted "
-                                  "in an overflow condition");
+    auto *state_ptr = f->args().begin();
+    state_ptr->setName("state_ptr");
+    auto *par_ptr = state_ptr + 1;
+    par_ptr->setName("par_ptr");
+    auto *time_hi_ptr = par_ptr + 1;
+    time_hi_ptr->setName("time_hi_ptr");
+    auto *time_lo_ptr = time_hi_ptr + 1;
+    time_lo_ptr->setName("time_lo_ptr");
+    auto *tc_ptr = time_lo_ptr + 1;
+    tc_ptr->setName("tc_ptr");
+    auto *in_ptr = tc_ptr + 1;
+    in_ptr->setName("in_ptr");
+    in_ptr->addAttr(llvm::Attribute::ReadOnly);
+    auto *max_steps = in_ptr + 1;
+    max_steps->setName("max_steps");
+    auto *out_ptr = max_steps + 1;
+    out_ptr->setName("out_ptr");
+    auto *n_steps_ptr = out_ptr + 1;
+    n_steps_ptr->setName("n_steps_ptr");
+    n_steps_ptr->addAttr(llvm::Attribute::WriteOnly);
+
+    for (auto &arg : f->args()) {
+        if (arg.getType()->isPointerTy()) {
+            arg.addAttr(llvm::Attribute::NoCapture);
+            arg.addAttr(llvm::Attribute::NoAlias);
+        }
     }
-    // LCOV_EXCL_STOP
-    return static_cast<std::uint32_t>(order_f);
+
+    auto *entry_bb = llvm::BasicBlock::Create(context, "entry", f);
+    auto *loop_bb = llvm::BasicBlock::Create(context, "loop", f);
+    auto *cont_bb = llvm::BasicBlock::Create(context, "cont", f);
+    auto *check_steps_bb = llvm::BasicBlock::Create(context, "check_steps", f);
+    auto *end_bb = llvm::BasicBlock::Create(context, "end", f);
+
+    // NOTE: the fast math flags must be cleared, as the logic
+    // relies on double-length arithmetic and on exact comparisons.
+    ir_builder::FastMathFlagGuard fmf_guard(builder);
+    builder.clearFastMathFlags();
+
+    builder.SetInsertPoint(entry_bb);
+
+    auto *fp_t = to_llvm_type<T>(context);
+    auto *zero = codegen<T>(s, number{0.});
+
+    // Load the input values.
+    auto *t_hi = builder.CreateLoad(in_ptr);
+    auto *t_lo = builder.CreateLoad(builder.CreateInBoundsGEP(in_ptr, {builder.getInt32(1)}));
+    auto *max_delta_t = builder.CreateLoad(builder.CreateInBoundsGEP(in_ptr, {builder.getInt32(2)}));
+    auto *t_dir = builder.CreateFCmpONE(builder.CreateLoad(builder.CreateInBoundsGEP(in_ptr, {builder.getInt32(3)})),
+                                        zero);
+    auto *m_max_delta_t = builder.CreateFNeg(max_delta_t);
+
+    // Setup the local variables.
+    auto *min_h_ptr = out_ptr;
+    auto *max_h_ptr = builder.CreateInBoundsGEP(out_ptr, {builder.getInt32(1)});
+    auto *h_ptr = builder.CreateAlloca(fp_t);
+    builder.CreateStore(zero, h_ptr);
+    auto *flags_ptr = builder.CreateAlloca(builder.getInt32Ty());
+    auto *iter_ptr = builder.CreateAlloca(builder.getInt64Ty());
+    builder.CreateStore(builder.getInt64(0), iter_ptr);
+    auto *step_counter_ptr = builder.CreateAlloca(builder.getInt64Ty());
+    builder.CreateStore(builder.getInt64(0), step_counter_ptr);
+    auto *retval_ptr = builder.CreateAlloca(builder.getInt32Ty());
+
+    builder.CreateBr(loop_bb);
+
+    // The loop body.
+    builder.SetInsertPoint(loop_bb);
+
+    // Compute the remaining time.
+    auto [rem_hi, rem_lo] = llvm_dl_add(s, t_hi, t_lo, builder.CreateFNeg(builder.CreateLoad(time_hi_ptr)),
+                                          builder.CreateFNeg(builder.CreateLoad(time_lo_ptr)));
+
+    // Compute the max integration time for this timestep, i.e.,
+    // min(max_delta_t, rem_time) if t_dir, max(-max_delta_t, rem_time) otherwise.
+    // NOTE: the comparisons mirror the implementation of the dfloat class.
+    auto *rem_lt_mdt = builder.CreateOr(
+        builder.CreateFCmpOLT(rem_hi, max_delta_t),
+        builder.CreateAnd(builder.CreateFCmpOEQ(rem_hi, max_delta_t), builder.CreateFCmpOLT(rem_lo, zero)));
+    auto *mmdt_lt_rem = builder.CreateOr(
+        builder.CreateFCmpOLT(m_max_delta_t, rem_hi),
+        builder.CreateAnd(builder.CreateFCmpOEQ(m_max_delta_t, rem_hi), builder.CreateFCmpOLT(zero, rem_lo)));
+    auto *dt_limit = builder.CreateSelect(t_dir, builder.CreateSelect(rem_lt_mdt, rem_hi, max_delta_t),
+                                          builder.CreateSelect(mmdt_lt_rem, rem_hi, m_max_delta_t));
+
+    // Run the timestep.
+    builder.CreateStore(dt_limit, h_ptr);
+    builder.CreateCall(step_f, {state_ptr, par_ptr, time_hi_ptr, time_lo_ptr, h_ptr, tc_ptr, flags_ptr});
+    auto *h = builder.CreateLoad(h_ptr);
+
+    // Exit if non-finite values were detected.
+    builder.CreateStore(builder.getInt32(2), retval_ptr);
+    builder.CreateCondBr(
+        builder.CreateICmpEQ(builder.CreateLoad(flags_ptr),
+                             builder.getInt32(static_cast<std::uint32_t>(taylor_step_flag_nf))),
+        end_bb, cont_bb);
+
+    builder.SetInsertPoint(cont_bb);
+
+    // Update the counters.
+    builder.CreateStore(builder.CreateAdd(builder.CreateLoad(iter_ptr), builder.getInt64(1)), iter_ptr);
+    builder.CreateStore(builder.CreateAdd(builder.CreateLoad(step_counter_ptr),
+                                          builder.CreateZExt(builder.CreateFCmpUNE(h, zero), builder.getInt64Ty())),
+                        step_counter_ptr);
+
+    // Update min_h/max_h, if the timestep was not clamped.
+    llvm_if_then_else(
+        s, builder.CreateFCmpUNE(h, dt_limit),
+        [&]() {
+            auto *abs_h = llvm_abs(s, h);
+            auto *min_h = builder.CreateLoad(min_h_ptr);
+            auto *max_h = builder.CreateLoad(max_h_ptr);
+            builder.CreateStore(builder.CreateSelect(builder.CreateFCmpOLT(abs_h, min_h), abs_h, min_h), min_h_ptr);
+            builder.CreateStore(builder.CreateSelect(builder.CreateFCmpOLT(max_h, abs_h), abs_h, max_h), max_h_ptr);
+        },
+        []() {});
+
+    // Exit if the final time was reached.
+    builder.CreateStore(builder.getInt32(0), retval_ptr);
+    builder.CreateCondBr(builder.CreateFCmpOEQ(h, rem_hi), end_bb, check_steps_bb);
+
+    // Exit if the maximum number of steps was reached.
+    builder.SetInsertPoint(check_steps_bb);
+    builder.CreateStore(builder.getInt32(1), retval_ptr);
+    builder.CreateCondBr(builder.CreateICmpEQ(builder.CreateLoad(iter_ptr), max_steps), end_bb, loop_bb);
+
+    // Write the outputs.
+    builder.SetInsertPoint(end_bb);
+    builder.CreateStore(builder.CreateLoad(h_ptr), builder.CreateInBoundsGEP(out_ptr, {builder.getInt32(2)}));
+    builder.CreateStore(builder.CreateLoad(step_counter_ptr), n_steps_ptr);
+    builder.CreateRet(builder.CreateLoad(retval_ptr));
+
+    s.verify_function(f);
+
+    s.optimise();
 }
 
-// Helper to compute max(x_v, abs(y_v)) in the Taylor stepper implementation.
-llvm::Value *taylor_step_maxabs(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
+// Helper to auto-tune the Taylor order of an adaptive Taylor integrator. A short
+// benchmark of the stepper (without events) is run starting from the initial conditions
+// for a few orders around the one deduced from the tolerance, and the order with the
+// lowest cost per unit of integration time is selected. This accounts for systems in which
+// the cost of the jet of derivatives grows faster than quadratically with the order
+// (or for which the deduced order is too high for the batch size). state, pars
+// and time are in batch layout.
+template <typename T, typename U>
+std::uint32_t taylor_auto_order(const llvm_state &s, const U &sys, const std::vector<T> &state,
+                                const std::vector<T> &pars, const std::vector<T> &time, T tol,
+                                std::uint32_t batch_size, bool high_accuracy, bool compact_mode, bool parallel_mode,
+                                std::uint32_t unroll_threshold, bool contiguous_jets, std::uint32_t dl_order,
+                                bool skip_one_way, const std::vector<expression> &h_vars)
 {
-#if defined(HEYOKA_HAVE_REAL128)
-    // Determine the scalar type of the vector arguments.
-    auto *x_t = x_v->getType()->getScalarType();
+    using std::abs;
+    using std::isfinite;
 
-    if (x_t == llvm::Type::getFP128Ty(s.context())) {
-        // NOTE: for __float128 we cannot use the intrinsic, we need
-        // to call an external function.
-        auto &builder = s.builder();
+    trace_span span("taylor_auto_order", "taylor");
 
-        // Convert the vector arguments to scalars.
-        auto x_scalars = vector_to_scalars(builder, x_v), y_scalars = vector_to_scalars(builder, y_v);
+    // NOTE: the number of steps in the benchmark.
+    constexpr unsigned n_bench_steps = 20;
 
-        // Execute the heyoka_maxabs128() function on the scalar values and store
-        // the results in res_scalars.
-        std::vector<llvm::Value *> res_scalars;
-        for (decltype(x_scalars.size()) i = 0; i < x_scalars.size(); ++i) {
-            res_scalars.push_back(llvm_invoke_external(
-                s, "heyoka_maxabs128", x_t, {x_scalars[i], y_scalars[i]},
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
+    const auto tol_order = taylor_order_from_tol(tol);
+
+    auto best = tol_order;
+    auto best_cost = std::numeric_limits<double>::infinity();
+
+    for (auto delta : {-4, -2, 0, 2, 4}) {
+        if (delta < 0 && tol_order < static_cast<std::uint32_t>(2 - delta)) {
+            continue;
+        }
+        const auto order = static_cast<std::uint32_t>(static_cast<std::int64_t>(tol_order) + delta);
+
+        // NOTE: copy s in order to fetch its options.
+        auto ls = s;
+        taylor_add_adaptive_step<T>(ls, "step", sys, tol, batch_size, high_accuracy, compact_mode, parallel_mode,
+                                    unroll_threshold, contiguous_jets, false, dl_order, skip_one_way, h_vars, 0,
+                                    order);
+        ls.compile();
+
+        auto *step_f = reinterpret_cast<void (*)(T *, const T *, const T *, T *, T *)>(ls.jit_lookup("step"));
+
+        auto b_state = state;
+        auto b_time = time;
+        std::vector<T> b_h(batch_size);
+
+        // NOTE: run a first step for warmup.
+        b_h.assign(batch_size, std::numeric_limits<T>::infinity());
+        step_f(b_state.data(), pars.data(), b_time.data(), b_h.data(), nullptr);
+        for (std::uint32_t j = 0; j < batch_size; ++j) {
+            b_time[j] += b_h[j];
+        }
+
+        // NOTE: accumulate the integration time in double
+        // precision, as it is used only for the cost estimation.
+        double int_time = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < n_bench_steps; ++i) {
+            b_h.assign(batch_size, std::numeric_limits<T>::infinity());
+            step_f(b_state.data(), pars.data(), b_time.data(), b_h.data(), nullptr);
+
+            for (std::uint32_t j = 0; j < batch_size; ++j) {
+                b_time[j] += b_h[j];
+                int_time += static_cast<double>(abs(b_h[j]));
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // NOTE: discard the orders for which the propagation broke down.
+        if (!std::isfinite(int_time) || int_time <= 0
+            || std::any_of(b_state.begin(), b_state.end(), [](const auto &x) { return !isfinite(x); })) {
+            get_logger()->trace("Taylor order auto-tuning: order {}, non-finite propagation", order);
+            continue;
+        }
+
+        // Cost per unit of integration time.
+        const auto cur_cost = elapsed / int_time;
+
+        get_logger()->trace("Taylor order auto-tuning: order {}, cost per unit time {}s", order, cur_cost);
+
+        if (cur_cost < best_cost) {
+            best_cost = cur_cost;
+            best = order;
         }
+    }
+
+    get_logger()->debug("Taylor order auto-tuning: selected order {} (order deduced from the tolerance: {})", best,
+                        tol_order);
+
+    return best;
+}
+
+} // namespace
+
+// Heuristic selection of compact mode and function inlining.
+// NOTE: in non-compact mode, the size of the generated code grows
+// as the number of elementary operations in the decomposition times
+// the square of the order (the derivative of order n of a product
+// consists of n + 1 terms), times the batch size. Above a threshold
+// the compilation time becomes prohibitive, and we switch to compact
+// mode. In compact mode, the derivatives are computed by functions
+// invoked in loops, and inlining them into the loops would inflate
+// the code size again, thus inlining is disabled.
+namespace
+{
+
+// Estimate the size of the non-compact code (see taylor_auto_compact_mode()).
+// The return value contains the number of elementary operations
+// in the decomposition and the estimated code size.
+template <typename T>
+std::pair<double, double> taylor_nc_code_size(const taylor_dc_t &dc, std::uint32_t n_eq, T tol, std::uint32_t order,
+                                              std::uint32_t batch_size)
+{
+    assert(dc.size() >= 2u * n_eq);
+    const auto n_ops = static_cast<double>(dc.size() - 2u * n_eq);
 
-        // Reconstruct the return value as a vector.
-        return scalars_to_vector(builder, res_scalars);
-    } else {
-#endif
-        // Compute abs(b).
-        auto *abs_y_v = llvm_invoke_intrinsic(s, "llvm.fabs", {y_v->getType()}, {y_v});
-        // Return max(a, abs(b)).
-        return llvm_invoke_intrinsic(s, "llvm.maxnum", {x_v->getType()}, {x_v, abs_y_v});
-#if defined(HEYOKA_HAVE_REAL128)
-    }
-#endif
+    const auto ord = static_cast<double>(order == 0u ? taylor_order_from_tol(tol) : order);
+    const auto bs = static_cast<double>(batch_size == 0u ? recommended_simd_size<T>() : batch_size);
+
+    return {n_ops, n_ops * (ord + 1.) * (ord + 2.) / 2. * bs};
 }
 
-// Helper to compute min(x_v, abs(y_v)) in the Taylor stepper implementation.
-llvm::Value *taylor_step_minabs(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
+} // namespace
+
+template <typename T>
+std::pair<bool, bool> taylor_auto_compact_mode(const taylor_dc_t &dc, std::uint32_t n_eq, T tol, std::uint32_t order,
+                                               std::uint32_t batch_size)
 {
-#if defined(HEYOKA_HAVE_REAL128)
-    // Determine the scalar type of the vector arguments.
-    auto *x_t = x_v->getType()->getScalarType();
+    // The threshold on the estimated number of operations
+    // in the non-compact code above which compact mode is selected.
+    constexpr double cm_threshold = 2e5;
 
-    if (x_t == llvm::Type::getFP128Ty(s.context())) {
-        // NOTE: for __float128 we cannot use the intrinsic, we need
-        // to call an external function.
-        auto &builder = s.builder();
+    const auto [n_ops, est] = taylor_nc_code_size(dc, n_eq, tol, order, batch_size);
 
-        // Convert the vector arguments to scalars.
-        auto x_scalars = vector_to_scalars(builder, x_v), y_scalars = vector_to_scalars(builder, y_v);
+    const auto cm = est > cm_threshold;
 
-        // Execute the heyoka_minabs128() function on the scalar values and store
-        // the results in res_scalars.
-        std::vector<llvm::Value *> res_scalars;
-        for (decltype(x_scalars.size()) i = 0; i < x_scalars.size(); ++i) {
-            res_scalars.push_back(llvm_invoke_external(
-                s, "heyoka_minabs128", x_t, {x_scalars[i], y_scalars[i]},
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
-        }
+    get_logger()->debug("compact mode auto-selection: {} elementary operations, estimated code size {}, compact mode: "
+                        "{}, inline functions: {}",
+                        n_ops, est, cm, !cm);
+
+    return {cm, !cm};
+}
+
+template std::pair<bool, bool> taylor_auto_compact_mode<double>(const taylor_dc_t &, std::uint32_t, double,
+                                                                std::uint32_t, std::uint32_t);
+template std::pair<bool, bool> taylor_auto_compact_mode<long double>(const taylor_dc_t &, std::uint32_t, long double,
+                                                                     std::uint32_t, std::uint32_t);
 
-        // Reconstruct the return value as a vector.
-        return scalars_to_vector(builder, res_scalars);
-    } else {
-#endif
-        // Compute abs(b).
-        auto *abs_y_v = llvm_invoke_intrinsic(s, "llvm.fabs", {y_v->getType()}, {y_v});
-        // Return min(a, abs(b)).
-        return llvm_invoke_intrinsic(s, "llvm.minnum", {x_v->getType()}, {x_v, abs_y_v});
 #if defined(HEYOKA_HAVE_REAL128)
-    }
+
+template std::pair<bool, bool> taylor_auto_compact_mode<mppp::real128>(const taylor_dc_t &, std::uint32_t,
+                                                                       mppp::real128, std::uint32_t, std::uint32_t);
+
 #endif
-}
 
-// Helper to compute pow(x_v, y_v) in the Taylor stepper implementation.
-llvm::Value *taylor_step_pow(llvm_state &s, llvm::Value *x_v, llvm::Value *y_v)
+template <typename T>
+bool taylor_cm_budget_exceeded(const taylor_dc_t &dc, std::uint32_t n_eq, T tol, std::uint32_t order,
+                               std::uint32_t batch_size, double budget)
 {
-#if defined(HEYOKA_HAVE_REAL128)
-    // Determine the scalar type of the vector arguments.
-    auto *x_t = x_v->getType()->getScalarType();
+    const auto [n_ops, est] = taylor_nc_code_size(dc, n_eq, tol, order, batch_size);
 
-    if (x_t == llvm::Type::getFP128Ty(s.context())) {
-        // NOTE: for __float128 we cannot use the intrinsic, we need
-        // to call an external function.
-        auto &builder = s.builder();
+    if (est > budget) {
+        get_logger()->warn("The estimated size of the non-compact code of an adaptive Taylor integrator ({} elementary "
+                           "operations, estimated code size {}) exceeds the budget of {}, switching to compact mode",
+                           n_ops, est, budget);
 
-        // Convert the vector arguments to scalars.
-        auto x_scalars = vector_to_scalars(builder, x_v), y_scalars = vector_to_scalars(builder, y_v);
+        return true;
+    }
 
-        // Execute the pow() function on the scalar values and store
-        // the results in res_scalars.
-        std::vector<llvm::Value *> res_scalars;
-        for (decltype(x_scalars.size()) i = 0; i < x_scalars.size(); ++i) {
-            res_scalars.push_back(llvm_invoke_external(
-                s, "powq", llvm::Type::getFP128Ty(s.context()), {x_scalars[i], y_scalars[i]},
-                // NOTE: in theory we may add ReadNone here as well,
-                // but for some reason, at least up to LLVM 10,
-                // this causes strange codegen issues. Revisit
-                // in the future.
-                {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn}));
-        }
+    return false;
+}
 
-        // Reconstruct the return value as a vector.
-        return scalars_to_vector(builder, res_scalars);
-    } else {
-#endif
-        // If we are operating on SIMD vectors, try to see if we have a sleef
-        // function available for pow().
-        if (auto *vec_t = llvm::dyn_cast<llvm::VectorType>(x_v->getType())) {
-            // NOTE: if sfn ends up empty, we will be falling through
-            // below and use the LLVM intrinsic instead.
-            if (const auto sfn = sleef_function_name(s.context(), "pow", vec_t->getElementType(),
-                                                     boost::numeric_cast<std::uint32_t>(vec_t->getNumElements()));
-                !sfn.empty()) {
-                return llvm_invoke_external(
-                    s, sfn, vec_t, {x_v, y_v},
-                    // NOTE: in theory we may add ReadNone here as well,
-                    // but for some reason, at least up to LLVM 10,
-                    // this causes strange codegen issues. Revisit
-                    // in the future.
-                    {llvm::Attribute::NoUnwind, llvm::Attribute::Speculatable, llvm::Attribute::WillReturn});
-            }
-        }
+template bool taylor_cm_budget_exceeded<double>(const taylor_dc_t &, std::uint32_t, double, std::uint32_t,
+                                                std::uint32_t, double);
+template bool taylor_cm_budget_exceeded<long double>(const taylor_dc_t &, std::uint32_t, long double, std::uint32_t,
+                                                     std::uint32_t, double);
 
-        return llvm_invoke_intrinsic(s, "llvm.pow", {x_v->getType()}, {x_v, y_v});
 #if defined(HEYOKA_HAVE_REAL128)
-    }
+
+template bool taylor_cm_budget_exceeded<mppp::real128>(const taylor_dc_t &, std::uint32_t, mppp::real128,
+                                                       std::uint32_t, std::uint32_t, double);
+
 #endif
+
+// Small helper to create an empty llvm_state
+// with the same options as ls.
+std::shared_ptr<llvm_state> taylor_make_empty_state(const llvm_state &ls)
+{
+    return std::make_shared<llvm_state>(
+        kw::mname = ls.module_name(), kw::opt_level = ls.opt_level(), kw::fast_math = ls.fast_math(),
+        kw::inline_functions = ls.inline_functions(), kw::cache_dir = ls.cache_dir(), kw::target_cpu = ls.target_cpu(),
+        kw::slp_vectorize = ls.slp_vectorize(), kw::loop_vectorize = ls.loop_vectorize(),
+        kw::compile_threads = ls.compile_threads());
 }
 
-// Create a global read-only array containing the values in sv_funcs_dc, if any
-// (otherwise, the return value will be null). This is for use in the adaptive steppers
-// when employing compact mode.
-llvm::Value *taylor_c_make_sv_funcs_arr(llvm_state &s, const std::vector<std::uint32_t> &sv_funcs_dc)
+template <typename T>
+template <typename U>
+void taylor_adaptive_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, T time, T tol, bool high_accuracy,
+                                                 bool compact_mode, bool parallel_mode, std::vector<T> pars,
+                                                 std::vector<t_event_t> tes, std::vector<nt_event_t> ntes,
+                                                 bool lazy_compile, std::uint32_t unroll_threshold,
+                                                 bool contiguous_jets, bool fused_step, std::uint32_t dl_order,
+                                                 bool skip_one_way, std::vector<expression> h_vars,
+                                                 std::vector<expression> ha_vars, std::uint32_t order,
+                                                 bool tune_order)
 {
-    auto &builder = s.builder();
+    using std::isfinite;
 
-    if (sv_funcs_dc.empty()) {
-        return nullptr;
-    } else {
-        auto *arr_type = llvm::ArrayType::get(llvm::Type::getInt32Ty(s.context()),
-                                              boost::numeric_cast<std::uint64_t>(sv_funcs_dc.size()));
-        std::vector<llvm::Constant *> sv_funcs_dc_const;
-        sv_funcs_dc_const.reserve(sv_funcs_dc.size());
-        for (auto idx : sv_funcs_dc) {
-            sv_funcs_dc_const.emplace_back(builder.getInt32(idx));
-        }
-        auto *sv_funcs_dc_arr = llvm::ConstantArray::get(arr_type, sv_funcs_dc_const);
-        auto *g_sv_funcs_dc = new llvm::GlobalVariable(s.module(), sv_funcs_dc_arr->getType(), true,
-                                                       llvm::GlobalVariable::InternalLinkage, sv_funcs_dc_arr);
+    trace_span span("taylor_adaptive::ctor", "taylor");
 
-        // Get out a pointer to the beginning of the array.
-        return builder.CreateInBoundsGEP(g_sv_funcs_dc, {builder.getInt32(0), builder.getInt32(0)});
+    const auto ctor_t0 = std::chrono::steady_clock::now();
+
+    // Assign the data members.
+    m_state = std::move(state);
+    m_time = dfloat<T>(time);
+    m_pars = std::move(pars);
+    m_tes = std::move(tes);
+    m_ntes = std::move(ntes);
+
+    // Check input params.
+    if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !isfinite(x); })) {
+        throw std::invalid_argument(
+            "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
     }
-}
 
-// Helper to generate the LLVM code to determine the timestep in an adaptive Taylor integrator,
-// following Jorba's prescription. diff_variant is the output of taylor_compute_jet(), and it contains
-// the jet of derivatives for the state variables and the sv_funcs. h_ptr is a pointer containing
-// the clamping values for the timesteps. svf_ptr is a pointer to an LLVM array containing the
-// values in sv_funcs_dc.
-template <typename T>
-llvm::Value *
-taylor_determine_h(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_variant,
-                   const std::vector<std::uint32_t> &sv_funcs_dc, llvm::Value *svf_ptr, llvm::Value *h_ptr,
-                   std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size)
-{
-    assert(batch_size != 0u);
-#if !defined(NDEBUG)
-    if (diff_variant.index() == 0u) {
-        // Compact mode.
-        assert(sv_funcs_dc.empty() == !svf_ptr);
-    } else {
-        // Non-compact mode.
-        assert(svf_ptr == nullptr);
+    if (m_state.size() != taylor_sys_size(sys)) {
+        throw std::invalid_argument(
+            "Inconsistent sizes detected in the initialization of an adaptive Taylor "
+            "integrator: the state vector has a dimension of {}, while the number of equations is {}"_format(
+                m_state.size(), taylor_sys_size(sys)));
     }
-#endif
 
-    using std::exp;
+    if (!isfinite(m_time)) {
+        throw std::invalid_argument(
+            "Cannot initialise an adaptive Taylor integrator with a non-finite initial time of {}"_format(
+                static_cast<T>(m_time)));
+    }
 
-    auto &builder = s.builder();
-    auto &context = s.context();
+    if (!isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is {} instead"_format(
+                tol));
+    }
 
-    llvm::Value *max_abs_state = nullptr, *max_abs_diff_o = nullptr, *max_abs_diff_om1 = nullptr;
+    // NOTE: we need to be able to index into the events
+    // using 32-bit ints.
+    // LCOV_EXCL_START
+    if (m_tes.size() > std::numeric_limits<std::uint32_t>::max()
+        || m_ntes.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("The number of events is too large, and it results in an overflow condition");
+    }
+    // LCOV_EXCL_STOP
 
-    if (diff_variant.index() == 0u) {
-        // Compact mode.
-        auto *diff_arr = std::get<llvm::Value *>(diff_variant);
+    const auto with_events = !m_tes.empty() || !m_ntes.empty();
 
-        // These will end up containing the norm infinity of the state vector + sv_funcs and the
-        // norm infinity of the derivatives at orders order and order - 1.
-        auto vec_t = to_llvm_vector_type<T>(context, batch_size);
-        max_abs_state = builder.CreateAlloca(vec_t);
-        max_abs_diff_o = builder.CreateAlloca(vec_t);
-        max_abs_diff_om1 = builder.CreateAlloca(vec_t);
+    // NOTE: the fused stepper is not available with events.
+    m_fused_step = fused_step && !with_events;
 
-        // Initialise with the abs(derivatives) of the first state variable at orders 0, 'order' and 'order - 1'.
-        builder.CreateStore(
-            llvm_abs(s, taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(0), builder.getInt32(0))),
-            max_abs_state);
-        builder.CreateStore(
-            llvm_abs(s, taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), builder.getInt32(0))),
-            max_abs_diff_o);
-        builder.CreateStore(
-            llvm_abs(s, taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order - 1u), builder.getInt32(0))),
-            max_abs_diff_om1);
+    // Check that a precomputed decomposition
+    // includes the event equations.
+    taylor_check_precomputed_dc_events(sys, m_tes.size() + m_ntes.size());
 
-        // Iterate over the variables to compute the norm infinities.
-        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(n_eq), [&](llvm::Value *cur_idx) {
-            builder.CreateStore(
-                taylor_step_maxabs(s, builder.CreateLoad(max_abs_state),
-                                   taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(0), cur_idx)),
-                max_abs_state);
-            builder.CreateStore(
-                taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_o),
-                                   taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_idx)),
-                max_abs_diff_o);
-            builder.CreateStore(
-                taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_om1),
-                                   taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order - 1u), cur_idx)),
-                max_abs_diff_om1);
-        });
+    // Fix m_pars' size, if necessary.
+    const auto npars = n_pars_in_sys(sys);
+    if (m_pars.size() < npars) {
+        m_pars.resize(boost::numeric_cast<decltype(m_pars.size())>(npars));
+    } else if (m_pars.size() > npars) {
+        throw std::invalid_argument(
+            "Excessive number of parameter values passed to the constructor of an adaptive "
+            "Taylor integrator: {} parameter values were passed, but the ODE system contains only {} parameters"_format(
+                m_pars.size(), npars));
+    }
 
-        if (svf_ptr != nullptr) {
-            // Consider also the functions of state variables for
-            // the computation of the timestep.
-            llvm_loop_u32(
-                s, builder.getInt32(0), builder.getInt32(boost::numeric_cast<std::uint32_t>(sv_funcs_dc.size())),
-                [&](llvm::Value *arr_idx) {
-                    // Fetch the index value from the array.
-                    auto cur_idx = builder.CreateLoad(builder.CreateInBoundsGEP(svf_ptr, {arr_idx}));
+    if (order != 0u && tune_order) {
+        throw std::invalid_argument("The Taylor order of an adaptive Taylor integrator cannot be auto-tuned if an "
+                                    "explicit order is specified");
+    }
 
-                    builder.CreateStore(
-                        taylor_step_maxabs(s, builder.CreateLoad(max_abs_state),
-                                           taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(0), cur_idx)),
-                        max_abs_state);
-                    builder.CreateStore(
-                        taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_o),
-                                           taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_idx)),
-                        max_abs_diff_o);
-                    builder.CreateStore(taylor_step_maxabs(s, builder.CreateLoad(max_abs_diff_om1),
-                                                           taylor_c_load_diff(s, diff_arr, n_uvars,
-                                                                              builder.getInt32(order - 1u), cur_idx)),
-                                        max_abs_diff_om1);
-                });
+    // Store the dimension of the system.
+    m_dim = boost::numeric_cast<std::uint32_t>(taylor_sys_size(sys));
+
+    // Auto-tune the Taylor order, if requested.
+    if (tune_order) {
+        order = taylor_auto_order<T>(*m_llvm, sys, m_state, m_pars, {static_cast<T>(m_time)}, tol, 1, high_accuracy,
+                                     compact_mode, parallel_mode, unroll_threshold, contiguous_jets, dl_order,
+                                     skip_one_way, h_vars);
+    }
+
+    // Store the system and the options for update_equations().
+    // NOTE: the tuned order is stored as an explicit order, so that
+    // the rebuilt integrators (e.g., in specialise_pars()) have the same order.
+    if (auto sys_pairs = taylor_sys_to_pairs(sys)) {
+        m_upd_data.emplace(upd_data_t{std::move(*sys_pairs), tol, high_accuracy, compact_mode, parallel_mode,
+                                      lazy_compile, unroll_threshold, contiguous_jets, fused_step, dl_order,
+                                      skip_one_way, h_vars, ha_vars, order});
+    }
+
+    // Temporarily disable optimisations in s, so that
+    // we don't optimise twice when adding the step
+    // and then the d_out.
+    std::optional<opt_disabler> od(*m_llvm);
+
+    taylor_last_dc_timings = {};
+    const auto ir_t0 = std::chrono::steady_clock::now();
+
+    // The separate jet of the event equations
+    // is used only if there are events.
+    m_sep_ev_jet = m_sep_ev_jet && with_events;
+
+    // Add the stepper function.
+    taylor_dc_t dc;
+    std::vector<expression> ee;
+    if (with_events) {
+        for (const auto &ev : m_tes) {
+            ee.push_back(ev.get_expression());
+        }
+        for (const auto &ev : m_ntes) {
+            ee.push_back(ev.get_expression());
         }
 
-        // Load the values for later use.
-        max_abs_state = builder.CreateLoad(max_abs_state);
-        max_abs_diff_o = builder.CreateLoad(max_abs_diff_o);
-        max_abs_diff_om1 = builder.CreateLoad(max_abs_diff_om1);
+        // NOTE: with the separate jet of the event equations,
+        // the stepper computes only the jet of the dynamics.
+        std::tie(dc, m_order) = taylor_add_adaptive_step_with_events<T>(
+            *m_llvm, "step_e", std::move(sys), tol, 1, high_accuracy, compact_mode, parallel_mode, unroll_threshold,
+            contiguous_jets, m_sep_ev_jet ? std::vector<expression>{} : ee, skip_one_way, h_vars, order);
     } else {
-        // Non-compact mode.
-        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+        std::tie(dc, m_order) = taylor_add_adaptive_step<T>(
+            *m_llvm, m_fused_step ? "step_f" : "step", std::move(sys), tol, 1, high_accuracy, compact_mode,
+            parallel_mode, unroll_threshold, contiguous_jets, m_fused_step, dl_order, skip_one_way, h_vars, 0, order,
+            {}, ha_vars);
+
+        // Add the multi-step driver for the fused stepper.
+        if (m_fused_step) {
+            taylor_add_step_n<T>(*m_llvm, "step_n", "step_f");
+        }
+    }
 
-        const auto n_sv_funcs = static_cast<std::uint32_t>(sv_funcs_dc.size());
+    // Fetch the knots of the piecewise polynomials of time.
+    m_dc = std::make_shared<const taylor_dc_t>(std::move(dc));
 
-        // Compute the norm infinity of the state vector and the norm infinity of the derivatives
-        // at orders order and order - 1. We first create vectors of absolute values and then
-        // compute their maxima.
-        std::vector<llvm::Value *> v_max_abs_state, v_max_abs_diff_o, v_max_abs_diff_om1;
+    m_tpw_knots = tpwpoly_knots(*m_dc);
 
-        // NOTE: iterate up to n_eq + n_sv_funcs in order to
-        // consider also the functions of state variables for
-        // the computation of the timestep.
-        for (std::uint32_t i = 0; i < n_eq + n_sv_funcs; ++i) {
-            v_max_abs_state.push_back(llvm_abs(s, diff_arr[i]));
-            // NOTE: in non-compact mode, diff_arr contains the derivatives only of the
-            // state variables and sv funcs (not all u vars), hence the indexing is
-            // order * (n_eq + n_sv_funcs).
-            v_max_abs_diff_o.push_back(llvm_abs(s, diff_arr[order * (n_eq + n_sv_funcs) + i]));
-            v_max_abs_diff_om1.push_back(llvm_abs(s, diff_arr[(order - 1u) * (n_eq + n_sv_funcs) + i]));
+    // Add the function for the computation of
+    // the dense output.
+    taylor_add_d_out_function<T>(*m_llvm, m_dim, m_order, 1, high_accuracy);
+
+    // Add the function for the computation of the dense output
+    // at multiple time coordinates at once, if the host machine
+    // supports SIMD instructions for the type T.
+    m_d_out_multi_size = recommended_simd_size<T>();
+    if (m_d_out_multi_size > 1u) {
+        // LCOV_EXCL_START
+        if (m_dim > std::numeric_limits<std::uint32_t>::max() / m_d_out_multi_size) {
+            throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the "
+                                      "state size is too large");
         }
+        // LCOV_EXCL_STOP
 
-        // Find the maxima via pairwise reduction.
-        auto reducer = [&s](llvm::Value *a, llvm::Value *b) -> llvm::Value * { return llvm_max(s, a, b); };
-        max_abs_state = pairwise_reduce(v_max_abs_state, reducer);
-        max_abs_diff_o = pairwise_reduce(v_max_abs_diff_o, reducer);
-        max_abs_diff_om1 = pairwise_reduce(v_max_abs_diff_om1, reducer);
+        taylor_add_d_out_multi_function<T>(*m_llvm, m_dim, m_order, m_d_out_multi_size, high_accuracy);
     }
 
-    // Determine if we are in absolute or relative tolerance mode.
-    auto abs_or_rel
-        = builder.CreateFCmpOLE(max_abs_state, vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
+    const auto ir_t1 = std::chrono::steady_clock::now();
 
-    // Estimate rho at orders order - 1 and order.
-    auto num_rho
-        = builder.CreateSelect(abs_or_rel, vector_splat(builder, codegen<T>(s, number{1.}), batch_size), max_abs_state);
-    auto rho_o = taylor_step_pow(s, builder.CreateFDiv(num_rho, max_abs_diff_o),
-                                 vector_splat(builder, codegen<T>(s, number{T(1) / order}), batch_size));
-    auto rho_om1 = taylor_step_pow(s, builder.CreateFDiv(num_rho, max_abs_diff_om1),
-                                   vector_splat(builder, codegen<T>(s, number{T(1) / (order - 1u)}), batch_size));
+    // Restore the original optimisation level in s.
+    od.reset();
 
-    // Take the minimum.
-    auto rho_m = llvm_min(s, rho_o, rho_om1);
+    // Compile the jet of the event equations, if requested.
+    // NOTE: this must be done before the lazy compilation
+    // setup below, which lowers the optimisation level of m_llvm.
+    if (m_sep_ev_jet) {
+        std::vector<expression> vars;
+        for (std::uint32_t i = 0; i < m_dim; ++i) {
+            vars.push_back((*m_dc)[i].first);
+        }
 
-    // Compute the scaling + safety factor.
-    const auto rhofac = exp((T(-7) / T(10)) / (order - 1u)) / (exp(T(1)) * exp(T(1)));
+        auto ev_llvm = taylor_make_empty_state(*m_llvm);
+        taylor_add_ev_jet<T>(*ev_llvm, "ev_jet", vars, std::move(ee), m_order, 1);
+        ev_llvm->compile();
 
-    // Determine the step size in absolute value.
-    auto h = builder.CreateFMul(rho_m, vector_splat(builder, codegen<T>(s, number{rhofac}), batch_size));
+        m_ev_jet_f = reinterpret_cast<ev_jet_f_t>(ev_llvm->jit_lookup("ev_jet"));
+        m_ev_llvm = std::move(ev_llvm);
+    }
 
-    // Ensure that the step size does not exceed the limit in absolute value.
-    auto *max_h_vec = load_vector_from_memory(builder, h_ptr, batch_size);
-    h = taylor_step_minabs(s, h, max_h_vec);
+    if (lazy_compile && m_llvm->opt_level() > 0u) {
+        // Lazy compilation: optimise and compile a copy of
+        // the state in a background thread, while m_llvm is compiled
+        // right away without optimisations.
+        // NOTE: the copy is made in this thread, as m_llvm
+        // cannot be accessed concurrently.
+        m_bg_llvm = std::async(std::launch::async,
+                               [bg_llvm = llvm_state(*m_llvm), step_name = taylor_step_name(with_events, m_fused_step),
+                                fused_step = m_fused_step, d_out_multi = m_d_out_multi_size > 1u]() mutable {
+                                   bg_llvm.optimise();
+                                   bg_llvm.compile();
 
-    // Handle backwards propagation.
-    auto backward = builder.CreateFCmpOLT(max_h_vec, vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
-    auto h_fac = builder.CreateSelect(backward, vector_splat(builder, codegen<T>(s, number{-1.}), batch_size),
-                                      vector_splat(builder, codegen<T>(s, number{1.}), batch_size));
-    h = builder.CreateFMul(h_fac, h);
+                                   // NOTE: look up the functions in order to trigger
+                                   // the code generation in this thread.
+                                   bg_llvm.jit_lookup(step_name);
+                                   if (fused_step) {
+                                       bg_llvm.jit_lookup("step_n");
+                                   }
+                                   bg_llvm.jit_lookup("d_out_f");
+                                   if (d_out_multi) {
+                                       bg_llvm.jit_lookup("d_out_multi_f");
+                                   }
 
-    return h;
-}
+                                   return std::move(bg_llvm);
+                               })
+                        .share();
 
-// Store the value val as the derivative of order 'order' of the u variable u_idx
-// into the array of Taylor derivatives diff_arr. n_uvars is the total number of u variables.
-void taylor_c_store_diff(llvm_state &s, llvm::Value *diff_arr, std::uint32_t n_uvars, llvm::Value *order,
-                         llvm::Value *u_idx, llvm::Value *val)
-{
-    auto &builder = s.builder();
+        m_llvm->opt_level() = 0;
+    }
 
-    // NOTE: overflow check has already been done to ensure that the
-    // total size of diff_arr fits in a 32-bit unsigned integer.
-    auto *ptr = builder.CreateInBoundsGEP(
-        diff_arr, {builder.CreateAdd(builder.CreateMul(order, builder.getInt32(n_uvars)), u_idx)});
+    // Run the optimisation pass manually.
+    m_llvm->optimise();
 
-    builder.CreateStore(val, ptr);
-}
+    // Run the jit.
+    m_llvm->compile();
 
-// Compute the derivative of order "order" of a state variable.
-// ex is the formula for the first-order derivative of the state variable (which
-// is either a u variable or a number/param), n_uvars the number of variables in
-// the decomposition, arr the array containing the derivatives of all u variables
-// up to order - 1.
-template <typename T>
-llvm::Value *taylor_compute_sv_diff(llvm_state &s, const expression &ex, const std::vector<llvm::Value *> &arr,
-                                    llvm::Value *par_ptr, std::uint32_t n_uvars, std::uint32_t order,
-                                    std::uint32_t batch_size)
-{
-    assert(order > 0u);
+    // Fetch the stepper.
+    m_step_f = taylor_lookup_step<decltype(m_step_f)>(*m_llvm, with_events, m_fused_step);
+    if (m_fused_step) {
+        m_step_n_f = reinterpret_cast<step_n_f_t>(m_llvm->jit_lookup("step_n"));
+    }
 
-    auto &builder = s.builder();
+    // Fetch the function to compute the dense output.
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm->jit_lookup("d_out_f"));
 
-    return std::visit(
-        [&](const auto &v) -> llvm::Value * {
-            using type = uncvref_t<decltype(v)>;
+    m_ctor_timings = taylor_make_ctor_timings(*m_llvm, ctor_t0, ir_t0, ir_t1);
 
-            if constexpr (std::is_same_v<type, variable>) {
-                // Extract the index of the u variable in the expression
-                // of the first-order derivative.
-                const auto u_idx = uname_to_index(v.name());
+    // Setup the vector for the Taylor coefficients.
+    // LCOV_EXCL_START
+    if (m_order == std::numeric_limits<std::uint32_t>::max()
+        || m_state.size() > std::numeric_limits<decltype(m_tc.size())>::max() / (m_order + 1u)) {
+        throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
+                                  "or the state size is too large");
+    }
+    // LCOV_EXCL_STOP
 
-                // Fetch from arr the derivative
-                // of order 'order - 1' of the u variable at u_idx. The index is:
-                // (order - 1) * n_uvars + u_idx.
-                auto ret = taylor_fetch_diff(arr, u_idx, order - 1u, n_uvars);
+    m_tc.resize(m_state.size() * (m_order + 1u));
 
-                // We have to divide the derivative by order
-                // to get the normalised derivative of the state variable.
-                return builder.CreateFDiv(
-                    ret, vector_splat(builder, codegen<T>(s, number(static_cast<T>(order))), batch_size));
-            } else if constexpr (std::is_same_v<type, number> || std::is_same_v<type, param>) {
-                // The first-order derivative is a constant.
-                // If the first-order derivative is being requested,
-                // do the codegen for the constant itself, otherwise
-                // return 0. No need for normalization as the only
-                // nonzero value that can be produced here is the first-order
-                // derivative.
-                if (order == 1u) {
-                    return taylor_codegen_numparam<T>(s, v, par_ptr, batch_size);
-                } else {
-                    return vector_splat(builder, codegen<T>(s, number{0.}), batch_size);
-                }
-            } else {
-                assert(false);
-                return nullptr;
-            }
-        },
-        ex.value());
+    // Setup the vector for the dense output.
+    m_d_out.resize(m_state.size());
+
+    // If we have events, we need to setup
+    // m_ev_jet.
+    if (with_events) {
+        const auto n_tes = static_cast<std::uint32_t>(m_tes.size());
+        const auto n_ntes = static_cast<std::uint32_t>(m_ntes.size());
+
+        // NOTE: check that we can represent
+        // the requested size for m_ev_jet using
+        // both its size type and std::uint32_t.
+        // LCOV_EXCL_START
+        if (n_tes > std::numeric_limits<std::uint32_t>::max() - n_ntes
+            || m_order == std::numeric_limits<std::uint32_t>::max()
+            || m_dim > std::numeric_limits<std::uint32_t>::max() - (n_tes + n_ntes)
+            || m_dim + (n_tes + n_ntes) > std::numeric_limits<std::uint32_t>::max() / (m_order + 1u)
+            || m_dim + (n_tes + n_ntes) > std::numeric_limits<decltype(m_ev_jet.size())>::max() / (m_order + 1u)) {
+            throw std::overflow_error(
+                "Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
+                "or the state size is too large");
+        }
+        // LCOV_EXCL_STOP
+
+        m_ev_jet.resize((m_dim + (n_tes + n_ntes)) * (m_order + 1u));
+    }
+
+    // Setup the vector of cooldowns.
+    m_te_cooldowns.resize(boost::numeric_cast<decltype(m_te_cooldowns.size())>(m_tes.size()));
 }
 
-// Function to split the central part of the decomposition (i.e., the definitions of the u variables
-// that do not represent state variables) into parallelisable segments. Within a segment,
-// the definition of a u variable does not depend on any u variable defined within that segment.
-// NOTE: the hidden deps are not considered as dependencies.
-std::vector<taylor_dc_t> taylor_segment_dc(const taylor_dc_t &dc, std::uint32_t n_eq)
+// Switch in the optimised LLVM state compiled
+// in the background, if available.
+template <typename T>
+void taylor_adaptive_impl<T>::swap_bg_llvm()
 {
-    // Helper that takes in input the definition ex of a u variable, and returns
-    // in output the list of indices of the u variables on which ex depends.
-    auto udef_args_indices = [](const expression &ex) -> std::vector<std::uint32_t> {
-        return std::visit(
-            [](const auto &v) -> std::vector<std::uint32_t> {
-                using type = detail::uncvref_t<decltype(v)>;
+    assert(m_bg_llvm.valid());
 
-                if constexpr (std::is_same_v<type, func>) {
-                    std::vector<std::uint32_t> retval;
+    try {
+        llvm_state bg_llvm(m_bg_llvm.get());
 
-                    for (const auto &arg : v.args()) {
-                        std::visit(
-                            [&retval](const auto &x) {
-                                using tp = detail::uncvref_t<decltype(x)>;
+        const auto step_f
+            = taylor_lookup_step<decltype(m_step_f)>(bg_llvm, !m_tes.empty() || !m_ntes.empty(), m_fused_step);
+        const auto step_n_f
+            = m_fused_step ? reinterpret_cast<step_n_f_t>(bg_llvm.jit_lookup("step_n")) : step_n_f_t(nullptr);
 
-                                if constexpr (std::is_same_v<tp, variable>) {
-                                    retval.push_back(uname_to_index(x.name()));
-                                } else if constexpr (!std::is_same_v<tp, number> && !std::is_same_v<tp, param>) {
-                                    throw std::invalid_argument(
-                                        "Invalid argument encountered in an element of a Taylor decomposition: the "
-                                        "argument is not a variable or a number/param");
-                                }
-                            },
-                            arg.value());
-                    }
+        auto d_out_f = reinterpret_cast<d_out_f_t>(bg_llvm.jit_lookup("d_out_f"));
+        auto d_out_multi_f = m_d_out_multi_f;
+        if (m_d_out_multi_size > 1u) {
+            d_out_multi_f = reinterpret_cast<d_out_f_t>(bg_llvm.jit_lookup("d_out_multi_f"));
+        }
 
-                    return retval;
-                } else {
-                    throw std::invalid_argument("Invalid expression encountered in a Taylor decomposition: the "
-                                                "expression is not a function");
-                }
-            },
-            ex.value());
-    };
+        m_llvm = std::make_shared<llvm_state>(std::move(bg_llvm));
+        m_step_f = step_f;
+        m_step_n_f = step_n_f;
+        m_d_out_f = d_out_f;
+        m_d_out_multi_f = d_out_multi_f;
+        // LCOV_EXCL_START
+    } catch (const std::exception &e) {
+        // NOTE: if the background compilation failed,
+        // keep on using the unoptimised code.
+        get_logger()->warn("The background compilation of an adaptive Taylor integrator failed, the unoptimised "
+                           "code will be used instead. The full error message is: {}",
+                           e.what());
+    }
+    // LCOV_EXCL_STOP
 
-    // Init the return value.
-    std::vector<taylor_dc_t> s_dc;
+    m_bg_llvm = {};
+}
 
-    // cur_limit_idx is initially the index of the first
-    // u variable which is not a state variable.
-    auto cur_limit_idx = n_eq;
-    for (std::uint32_t i = n_eq; i < dc.size() - n_eq; ++i) {
-        // NOTE: at the very first iteration of this for loop,
-        // no block has been created yet. Do it now.
-        if (i == n_eq) {
-            assert(s_dc.empty());
-            s_dc.emplace_back();
-        } else {
-            assert(!s_dc.empty());
+// Fetch the optimised LLVM state, waiting for the
+// completion of the background compilation if needed.
+template <typename T>
+const llvm_state &taylor_adaptive_impl<T>::final_llvm_state() const
+{
+    if (m_bg_llvm.valid()) {
+        try {
+            return m_bg_llvm.get();
+            // LCOV_EXCL_START
+        } catch (const std::exception &) {
+            // NOTE: fall back to the unoptimised state
+            // if the background compilation failed.
         }
+        // LCOV_EXCL_STOP
+    }
 
-        const auto &[ex, deps] = dc[i];
+    return *m_llvm;
+}
 
-        // Determine the u indices on which ex depends.
-        const auto u_indices = udef_args_indices(ex);
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other) : taylor_adaptive_impl(other, false)
+{
+}
 
-        if (std::any_of(u_indices.begin(), u_indices.end(),
-                        [cur_limit_idx](auto idx) { return idx >= cur_limit_idx; })) {
-            // The current expression depends on one or more variables
-            // within the current block. Start a new block and
-            // update cur_limit_idx with the start index of the new block.
-            s_dc.emplace_back();
-            cur_limit_idx = i;
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other, bool share_code)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    // If the compiled code is not shared and a background compilation
+    // is ongoing, wait for it and copy the optimised LLVM state.
+    : m_state(other.m_state), m_time(other.m_time),
+      m_llvm(share_code ? other.m_llvm : std::make_shared<llvm_state>(other.final_llvm_state())), m_dim(other.m_dim),
+      m_dc(other.m_dc),
+      m_order(other.m_order), m_fused_step(other.m_fused_step), m_pars(other.m_pars), m_tpw_knots(other.m_tpw_knots),
+      m_tc(other.m_tc),
+      m_tc_pending(other.m_tc_pending), m_last_h(other.m_last_h), m_d_out(other.m_d_out),
+      m_d_out_multi_size(other.m_d_out_multi_size), m_tes(other.m_tes), m_ntes(other.m_ntes),
+      m_nt_batch_cb(other.m_nt_batch_cb), m_ev_jet(other.m_ev_jet), m_thread_scratch(other.m_thread_scratch),
+      m_te_cooldowns(other.m_te_cooldowns), m_perf(other.m_perf), m_perf_enabled(other.m_perf_enabled),
+      m_par_ed(other.m_par_ed), m_ctor_timings(other.m_ctor_timings), m_upd_data(other.m_upd_data),
+      m_spec_pars(other.m_spec_pars), m_fixed_order(other.m_fixed_order), m_vo_orders(other.m_vo_orders),
+      m_vo_cost(other.m_vo_cost), m_vo_last_h(other.m_vo_last_h), m_vo_tc(other.m_vo_tc), m_vo_idx(other.m_vo_idx),
+      m_vo_counter(other.m_vo_counter), m_sv_funcs(other.m_sv_funcs), m_sv_values(other.m_sv_values),
+      m_sv_ev_rows(other.m_sv_ev_rows), m_sep_ev_jet(other.m_sep_ev_jet), m_hc_rel(other.m_hc_rel),
+      m_hc_n(other.m_hc_n), m_invs(other.m_invs), m_inv_every(other.m_inv_every), m_inv_thr(other.m_inv_thr),
+      m_inv_ref(other.m_inv_ref), m_inv_drift(other.m_inv_drift), m_inv_hist(other.m_inv_hist),
+      m_inv_hist_cap(other.m_inv_hist_cap), m_inv_hist_pos(other.m_inv_hist_pos), m_inv_counter(other.m_inv_counter),
+      m_inv_out(other.m_inv_out)
+{
+    if (share_code) {
+        // NOTE: the function pointers refer to the shared
+        // compiled code, thus they can be copied. If a background
+        // compilation is ongoing, this integrator will switch
+        // to the optimised code independently of other.
+        m_step_f = other.m_step_f;
+        m_step_n_f = other.m_step_n_f;
+        m_d_out_f = other.m_d_out_f;
+        m_d_out_multi_f = other.m_d_out_multi_f;
+        m_bg_llvm = other.m_bg_llvm;
+        m_spec_llvm = other.m_spec_llvm;
+        m_spec_step_f = other.m_spec_step_f;
+        m_spec_step_n_f = other.m_spec_step_n_f;
+        m_fixed_llvm = other.m_fixed_llvm;
+        m_fixed_step_f = other.m_fixed_step_f;
+        m_vo_llvm = other.m_vo_llvm;
+        m_vo_step_f = other.m_vo_step_f;
+        m_svf_llvm = other.m_svf_llvm;
+        m_svf_f = other.m_svf_f;
+        m_ev_llvm = other.m_ev_llvm;
+        m_ev_jet_f = other.m_ev_jet_f;
+        m_inv_llvm = other.m_inv_llvm;
+        m_inv_f = other.m_inv_f;
+    } else {
+        m_step_f = taylor_lookup_step<decltype(m_step_f)>(*m_llvm, !m_tes.empty() || !m_ntes.empty(), m_fused_step);
+        if (m_fused_step) {
+            m_step_n_f = reinterpret_cast<step_n_f_t>(m_llvm->jit_lookup("step_n"));
         }
 
-        // Append ex to the current block.
-        s_dc.back().emplace_back(ex, deps);
-    }
-
-#if !defined(NDEBUG)
-    // Verify s_dc.
+        m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm->jit_lookup("d_out_f"));
+        if (m_d_out_multi_size > 1u) {
+            m_d_out_multi_f = reinterpret_cast<d_out_f_t>(m_llvm->jit_lookup("d_out_multi_f"));
+        }
 
-    decltype(dc.size()) counter = 0;
-    for (const auto &s : s_dc) {
-        // No segment can be empty.
-        assert(!s.empty());
+        if (other.m_spec_llvm) {
+            m_spec_llvm = std::make_shared<llvm_state>(*other.m_spec_llvm);
+            m_spec_step_f
+                = taylor_lookup_step<decltype(m_step_f)>(*m_spec_llvm, !m_tes.empty() || !m_ntes.empty(), m_fused_step);
+            if (m_fused_step) {
+                m_spec_step_n_f = reinterpret_cast<step_n_f_t>(m_spec_llvm->jit_lookup("step_n"));
+            }
+        }
 
-        for (const auto &[ex, _] : s) {
-            // All the indices in the definitions of the
-            // u variables in the current block must be
-            // less than counter + n_eq (which is the starting
-            // index of the block).
-            const auto u_indices = udef_args_indices(ex);
-            assert(std::all_of(u_indices.begin(), u_indices.end(),
-                               [idx_limit = counter + n_eq](auto idx) { return idx < idx_limit; }));
+        if (other.m_fixed_llvm) {
+            m_fixed_llvm = std::make_shared<llvm_state>(*other.m_fixed_llvm);
+            m_fixed_step_f = reinterpret_cast<step_f_t>(m_fixed_llvm->jit_lookup("step_fixed"));
+        }
+
+        if (other.m_vo_llvm) {
+            m_vo_llvm = std::make_shared<llvm_state>(*other.m_vo_llvm);
+            for (auto order : m_vo_orders) {
+                m_vo_step_f.push_back(reinterpret_cast<step_f_t>(m_vo_llvm->jit_lookup("step_vo_{}"_format(order))));
+            }
         }
 
-        // Update the counter.
-        counter += s.size();
-    }
+        if (other.m_svf_llvm) {
+            m_svf_llvm = std::make_shared<llvm_state>(*other.m_svf_llvm);
+            m_svf_f = reinterpret_cast<sv_funcs_f_t>(m_svf_llvm->jit_lookup("sv_funcs"));
+        }
 
-    assert(counter == dc.size() - n_eq * 2u);
-#endif
+        if (other.m_ev_llvm) {
+            m_ev_llvm = std::make_shared<llvm_state>(*other.m_ev_llvm);
+            m_ev_jet_f = reinterpret_cast<ev_jet_f_t>(m_ev_llvm->jit_lookup("ev_jet"));
+        }
 
-    return s_dc;
+        if (other.m_inv_llvm) {
+            m_inv_llvm = std::make_shared<llvm_state>(*other.m_inv_llvm);
+            m_inv_f = reinterpret_cast<sv_funcs_f_t>(m_inv_llvm->jit_lookup("invariants"));
+        }
+    }
+
+    // NOTE: instead of copying these, reserve the capacity.
+    m_d_tes.reserve(other.m_d_tes.capacity());
+    m_d_ntes.reserve(other.m_d_ntes.capacity());
+    m_d_ntes_idx.reserve(other.m_d_ntes_idx.capacity());
+    m_d_ntes_time.reserve(other.m_d_ntes_time.capacity());
+    m_d_ntes_sgn.reserve(other.m_d_ntes_sgn.capacity());
+    m_d_ntes_key.reserve(other.m_d_ntes_key.capacity());
+    m_d_ntes_perm.reserve(other.m_d_ntes_perm.capacity());
 }
 
-// Small helper to compute the size of a global array.
-std::uint32_t taylor_c_gl_arr_size(llvm::Value *v)
-{
-    assert(llvm::isa<llvm::GlobalVariable>(v));
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept = default;
 
-    return boost::numeric_cast<std::uint32_t>(
-        llvm::cast<llvm::ArrayType>(llvm::cast<llvm::PointerType>(v->getType())->getElementType())->getNumElements());
+template <typename T>
+taylor_adaptive_impl<T> taylor_adaptive_impl<T>::shared_copy() const
+{
+    return taylor_adaptive_impl(*this, true);
 }
 
-// Helper to construct the global arrays needed for the computation of the
-// derivatives of the state variables in compact mode. The first part of the
-// return value is a set of 6 arrays:
-// - the indices of the state variables whose time derivative is a u variable, paired to
-// - the indices of the u variables appearing in the derivatives, and
-// - the indices of the state variables whose time derivative is a constant, paired to
-// - the values of said constants, and
-// - the indices of the state variables whose time derivative is a param, paired to
-// - the indices of the params.
-// The second part of the return value is a boolean flag that will be true if
-// the time derivatives of all state variables are u variables, false otherwise.
 template <typename T>
-auto taylor_c_make_sv_diff_globals(llvm_state &s, const taylor_dc_t &dc, std::uint32_t n_uvars)
+std::vector<taylor_adaptive_impl<T>> taylor_adaptive_impl<T>::shared_copies(std::size_t n) const
 {
-    auto &context = s.context();
-    auto &builder = s.builder();
-    auto &module = s.module();
+    std::vector<taylor_adaptive_impl> retval;
+    retval.reserve(n);
 
-    // Build iteratively the output values as vectors of constants.
-    std::vector<llvm::Constant *> var_indices, vars, num_indices, nums, par_indices, pars;
+    for (std::size_t i = 0; i < n; ++i) {
+        retval.push_back(taylor_adaptive_impl(*this, true));
+    }
 
-    // Keep track of how many time derivatives
-    // of the state variables are u variables.
-    std::uint32_t n_der_vars = 0;
+    return retval;
+}
 
-    // NOTE: the derivatives of the state variables are at the end of the decomposition.
-    for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-        std::visit(
-            [&](const auto &v) {
-                using type = uncvref_t<decltype(v)>;
+// Create an llvm_state with the same options as ls, containing the compiled
+// function "sv_funcs" for the evaluation of the sv_funcs of an integrator
+// whose decomposition is dc and whose number of parameters (per batch element)
+// is n_pars. The input variables of the function are the
+// state variables, in the order of the state vector.
+// NOTE: name is the name of the compiled function, which is
+// also used in the error messages (e.g., for the stop condition).
+template <typename T>
+std::shared_ptr<llvm_state> taylor_make_sv_funcs_state(const llvm_state &ls, const taylor_dc_t &dc,
+                                                       std::uint32_t n_eq, std::size_t n_pars,
+                                                       const std::vector<expression> &sv_funcs,
+                                                       const std::string &name = "sv_funcs")
+{
+    assert(!sv_funcs.empty());
+    assert(dc.size() >= n_eq);
+
+    // NOTE: the first n_eq elements of the decomposition
+    // are the state variables.
+    std::vector<expression> vars;
+    std::unordered_set<std::string> var_names;
+    for (std::uint32_t i = 0; i < n_eq; ++i) {
+        assert(std::holds_alternative<variable>(dc[i].first.value()));
 
-                if constexpr (std::is_same_v<type, variable>) {
-                    ++n_der_vars;
-                    // NOTE: remove from i the n_uvars offset to get the
-                    // true index of the state variable.
-                    var_indices.push_back(builder.getInt32(i - n_uvars));
-                    vars.push_back(builder.getInt32(uname_to_index(v.name())));
-                } else if constexpr (std::is_same_v<type, number>) {
-                    num_indices.push_back(builder.getInt32(i - n_uvars));
-                    nums.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, v)));
-                } else if constexpr (std::is_same_v<type, param>) {
-                    par_indices.push_back(builder.getInt32(i - n_uvars));
-                    pars.push_back(builder.getInt32(v.idx()));
-                } else {
-                    assert(false);
-                }
-            },
-            dc[i].first.value());
+        vars.push_back(dc[i].first);
+        var_names.insert(std::get<variable>(dc[i].first.value()).name());
     }
 
-    // Flag to signal that the time derivatives of all state variables are u variables.
-    assert(dc.size() >= n_uvars);
-    const auto all_der_vars = (n_der_vars == (dc.size() - n_uvars));
+    for (const auto &ex : sv_funcs) {
+        if (has_time(ex)) {
+            throw std::invalid_argument("The {} of an adaptive Taylor integrator cannot depend on time"_format(name));
+        }
 
-    assert(var_indices.size() == vars.size());
-    assert(num_indices.size() == nums.size());
-    assert(par_indices.size() == pars.size());
+        for (const auto &var : get_variables(ex)) {
+            if (var_names.count(var) == 0u) {
+                throw std::invalid_argument("The {} of an adaptive Taylor integrator can depend only on the "
+                                            "state variables, but the variable '{}' was detected"_format(name, var));
+            }
+        }
 
-    // Turn the vectors into global read-only LLVM arrays.
+        // NOTE: the compiled function reads the parameters
+        // directly from the array of parameters of the integrator.
+        if (get_param_size(ex) > n_pars) {
+            throw std::invalid_argument(
+                "The {} of an adaptive Taylor integrator require {} parameter(s), but the integrator has only "
+                "{} parameter(s)"_format(name, get_param_size(ex), n_pars));
+        }
+    }
 
-    // Variables.
-    auto *var_arr_type
-        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(var_indices.size()));
+    auto retval = taylor_make_empty_state(ls);
 
-    auto *var_indices_arr = llvm::ConstantArray::get(var_arr_type, var_indices);
-    auto *g_var_indices = new llvm::GlobalVariable(module, var_indices_arr->getType(), true,
-                                                   llvm::GlobalVariable::InternalLinkage, var_indices_arr);
+    add_cfunc<T>(*retval, name, sv_funcs, 1, std::move(vars));
 
-    auto *vars_arr = llvm::ConstantArray::get(var_arr_type, vars);
-    auto *g_vars
-        = new llvm::GlobalVariable(module, vars_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, vars_arr);
+    retval->compile();
 
-    // Numbers.
-    auto *num_indices_arr_type
-        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(num_indices.size()));
-    auto *num_indices_arr = llvm::ConstantArray::get(num_indices_arr_type, num_indices);
-    auto *g_num_indices = new llvm::GlobalVariable(module, num_indices_arr->getType(), true,
-                                                   llvm::GlobalVariable::InternalLinkage, num_indices_arr);
+    return retval;
+}
 
-    auto nums_arr_type
-        = llvm::ArrayType::get(to_llvm_type<T>(context), boost::numeric_cast<std::uint64_t>(nums.size()));
-    auto nums_arr = llvm::ConstantArray::get(nums_arr_type, nums);
-    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
-    auto *g_nums
-        = new llvm::GlobalVariable(module, nums_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, nums_arr);
+// Build a new integrator for the ODE system sys with the
+// parameter values pars, the state, time, events and
+// construction options of this.
+template <typename T>
+taylor_adaptive_impl<T> taylor_adaptive_impl<T>::rebuild(std::vector<std::pair<expression, expression>> sys,
+                                                         std::vector<T> pars, bool lazy_compile) const
+{
+    assert(m_upd_data);
 
-    // Params.
-    auto *par_arr_type
-        = llvm::ArrayType::get(llvm::Type::getInt32Ty(context), boost::numeric_cast<std::uint64_t>(par_indices.size()));
+    // NOTE: if a background compilation is ongoing, wait
+    // for it in order to fetch the original optimisation level.
+    const auto &ls = final_llvm_state();
 
-    auto *par_indices_arr = llvm::ConstantArray::get(par_arr_type, par_indices);
-    auto *g_par_indices = new llvm::GlobalVariable(module, par_indices_arr->getType(), true,
-                                                   llvm::GlobalVariable::InternalLinkage, par_indices_arr);
+    taylor_adaptive_impl retval;
+    retval.m_llvm = taylor_make_empty_state(ls);
+    // NOTE: this is read by finalise_ctor_impl().
+    retval.m_sep_ev_jet = m_sep_ev_jet;
 
-    auto *pars_arr = llvm::ConstantArray::get(par_arr_type, pars);
-    auto *g_pars
-        = new llvm::GlobalVariable(module, pars_arr->getType(), true, llvm::GlobalVariable::InternalLinkage, pars_arr);
+    const auto &ud = *m_upd_data;
+    retval.finalise_ctor_impl(std::move(sys), m_state, static_cast<T>(m_time), ud.tol, ud.high_accuracy,
+                              ud.compact_mode, ud.parallel_mode, std::move(pars), m_tes, m_ntes, lazy_compile,
+                              ud.unroll_threshold, ud.contiguous_jets, ud.fused_step, ud.dl_order, ud.skip_one_way,
+                              ud.h_vars, ud.ha_vars, ud.order, false);
 
-    return std::pair{std::array{g_var_indices, g_vars, g_num_indices, g_nums, g_par_indices, g_pars}, all_der_vars};
+    return retval;
 }
 
-// Helper to compute and store the derivatives of the state variables in compact mode at order 'order'.
-// svd_gl is the return value of taylor_c_make_sv_diff_globals(), which contains
-// the indices/constants necessary for the computation.
-template <typename T, typename U>
-void taylor_c_compute_sv_diffs(llvm_state &s, const U &svd_gl, llvm::Value *diff_arr, llvm::Value *par_ptr,
-                               std::uint32_t n_uvars, llvm::Value *order, std::uint32_t batch_size)
+template <typename T>
+void taylor_adaptive_impl<T>::update_equations(std::vector<std::pair<std::uint32_t, expression>> new_eqs)
 {
-    assert(batch_size > 0u);
-
-    // Fetch the global arrays and
-    // the all_der_vars flag.
-    const auto &sv_diff_gl = svd_gl.first;
-    const auto all_der_vars = svd_gl.second;
-
-    auto &builder = s.builder();
-    auto &context = s.context();
-
-    // Recover the number of state variables whose derivatives are given
-    // by u variables, numbers and params.
-    const auto n_vars = taylor_c_gl_arr_size(sv_diff_gl[0]);
-    const auto n_nums = taylor_c_gl_arr_size(sv_diff_gl[2]);
-    const auto n_pars = taylor_c_gl_arr_size(sv_diff_gl[4]);
+    if (!m_upd_data) {
+        throw std::invalid_argument("Cannot update the equations of an adaptive Taylor integrator which was "
+                                    "constructed from a precomputed decomposition or deserialised");
+    }
 
-    // Handle the u variables definitions.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_vars), [&](llvm::Value *cur_idx) {
-        // Fetch the index of the state variable.
-        // NOTE: if the time derivatives of all state variables are u variables, there's
-        // no need to lookup the index in the global array (which will just contain
-        // the values in the [0, n_vars] range).
-        auto *sv_idx
-            = all_der_vars
-                  ? cur_idx
-                  : builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[0], {builder.getInt32(0), cur_idx}));
+    // Build the new system.
+    auto sys = m_upd_data->sys;
+    for (auto &[idx, rhs] : new_eqs) {
+        if (idx >= m_dim) {
+            throw std::invalid_argument(
+                "Cannot update the equation at index {} of an adaptive Taylor integrator with {} equations"_format(
+                    idx, m_dim));
+        }
 
-        // Fetch the index of the u variable.
-        auto *u_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[1], {builder.getInt32(0), cur_idx}));
+        sys[idx].second = std::move(rhs);
+    }
 
-        // Fetch from diff_arr the derivative of order 'order - 1' of the u variable u_idx.
-        auto *ret = taylor_c_load_diff(s, diff_arr, n_uvars, builder.CreateSub(order, builder.getInt32(1)), u_idx);
+    // Keep the values of the parameters which
+    // are still present in the new system.
+    auto pars = m_pars;
+    pars.resize(std::min(pars.size(), static_cast<decltype(pars.size())>(n_pars_in_sys(sys))));
 
-        // We have to divide the derivative by 'order' in order
-        // to get the normalised derivative of the state variable.
-        ret = builder.CreateFDiv(
-            ret, vector_splat(builder, builder.CreateUIToFP(order, to_llvm_type<T>(context)), batch_size));
+    // NOTE: build the new integrator in a separate object,
+    // so that this is left untouched in case of errors.
+    auto tmp = rebuild(std::move(sys), std::move(pars), m_upd_data->lazy_compile);
 
-        // Store the derivative.
-        taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx, ret);
-    });
+    // Restore the members which are not set up
+    // by finalise_ctor_impl().
+    tmp.m_time = m_time;
+    tmp.m_nt_batch_cb = m_nt_batch_cb;
+    tmp.m_te_cooldowns = m_te_cooldowns;
+    tmp.m_perf_enabled = m_perf_enabled;
+    tmp.m_par_ed = m_par_ed;
+    tmp.set_thread_scratch(m_thread_scratch);
 
-    // Handle the number definitions.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_nums), [&](llvm::Value *cur_idx) {
-        // Fetch the index of the state variable.
-        auto *sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[2], {builder.getInt32(0), cur_idx}));
+    *this = std::move(tmp);
+}
 
-        // Fetch the constant.
-        auto *num = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[3], {builder.getInt32(0), cur_idx}));
+template <typename T>
+void taylor_adaptive_impl<T>::specialise_pars()
+{
+    if (!m_upd_data) {
+        throw std::invalid_argument("Cannot specialise the parameters of an adaptive Taylor integrator which was "
+                                    "constructed from a precomputed decomposition or deserialised");
+    }
 
-        // If the first-order derivative is being requested,
-        // do the codegen for the constant itself, otherwise
-        // return 0. No need for normalization as the only
-        // nonzero value that can be produced here is the first-order
-        // derivative.
-        auto *cmp_cond = builder.CreateICmpEQ(order, builder.getInt32(1));
-        auto ret = builder.CreateSelect(cmp_cond, vector_splat(builder, num, batch_size),
-                                        vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
+    // Replace the parameters in the system with their current values.
+    auto sys = m_upd_data->sys;
+    for (auto &p : sys) {
+        p.second = taylor_pars_to_numbers(p.second, m_pars);
+    }
 
-        // Store the derivative.
-        taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx, ret);
-    });
+    // NOTE: the parameters may still appear in the events,
+    // which are not specialised. The specialised
+    // stepper is passed the values in m_pars.
+    // NOTE: no need for lazy compilation here, as the
+    // generic stepper is already available.
+    auto tmp = rebuild(std::move(sys), {}, false);
 
-    // Handle the param definitions.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_pars), [&](llvm::Value *cur_idx) {
-        // Fetch the index of the state variable.
-        auto *sv_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[4], {builder.getInt32(0), cur_idx}));
+    // NOTE: the interface of the specialised stepper
+    // is identical to the interface of the generic one.
+    assert(tmp.m_step_f.index() == m_step_f.index());
+    assert(tmp.m_order == m_order);
 
-        // Fetch the index of the param.
-        auto *par_idx = builder.CreateLoad(builder.CreateInBoundsGEP(sv_diff_gl[5], {builder.getInt32(0), cur_idx}));
+    m_spec_llvm = std::move(tmp.m_llvm);
+    m_spec_step_f = tmp.m_step_f;
+    m_spec_step_n_f = tmp.m_step_n_f;
+    m_spec_pars = m_pars;
+}
 
-        // If the first-order derivative is being requested,
-        // do the codegen for the constant itself, otherwise
-        // return 0. No need for normalization as the only
-        // nonzero value that can be produced here is the first-order
-        // derivative.
-        llvm_if_then_else(
-            s, builder.CreateICmpEQ(order, builder.getInt32(1)),
-            [&]() {
-                // Derivative of order 1. Fetch the value from par_ptr.
-                // NOTE: param{0} is unused, its only purpose is type tagging.
-                taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx,
-                                    taylor_c_diff_numparam_codegen(s, param{0}, par_idx, par_ptr, batch_size));
-            },
-            [&]() {
-                // Derivative of order > 1, return 0.
-                taylor_c_store_diff(s, diff_arr, n_uvars, order, sv_idx,
-                                    vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
-            });
-    });
+template <typename T>
+bool taylor_adaptive_impl<T>::get_pars_specialised() const
+{
+    return m_spec_llvm && m_pars == m_spec_pars;
 }
 
-// Helper to convert the arguments of the definition of a u variable
-// into a vector of variants. u variables will be converted to their indices,
-// numbers will be unchanged, parameters will be converted to their indices.
-// The hidden deps will also be converted to indices.
-auto taylor_udef_to_variants(const expression &ex, const std::vector<std::uint32_t> &deps)
+template <typename T>
+void taylor_adaptive_impl<T>::prepare_fixed_step(std::uint32_t order)
 {
-    return std::visit(
-        [&deps](const auto &v) -> std::vector<std::variant<std::uint32_t, number>> {
-            using type = detail::uncvref_t<decltype(v)>;
+    if (!m_upd_data) {
+        throw std::invalid_argument("The fixed-step mode is not available in an adaptive Taylor integrator which was "
+                                    "constructed from a precomputed decomposition or deserialised");
+    }
 
-            if constexpr (std::is_same_v<type, func>) {
-                std::vector<std::variant<std::uint32_t, number>> retval;
+    if (!m_tes.empty() || !m_ntes.empty()) {
+        throw std::invalid_argument(
+            "The fixed-step mode is not available in an adaptive Taylor integrator with events");
+    }
 
-                for (const auto &arg : v.args()) {
-                    std::visit(
-                        [&retval](const auto &x) {
-                            using tp = detail::uncvref_t<decltype(x)>;
+    if (order == 0u) {
+        order = m_order;
+    }
 
-                            if constexpr (std::is_same_v<tp, variable>) {
-                                retval.emplace_back(uname_to_index(x.name()));
-                            } else if constexpr (std::is_same_v<tp, number>) {
-                                retval.emplace_back(x);
-                            } else if constexpr (std::is_same_v<tp, param>) {
-                                retval.emplace_back(x.idx());
-                            } else {
-                                throw std::invalid_argument(
-                                    "Invalid argument encountered in an element of a Taylor decomposition: the "
-                                    "argument is not a variable or a number");
-                            }
-                        },
-                        arg.value());
-                }
+    // NOTE: if a background compilation is ongoing, wait
+    // for it in order to fetch the original optimisation level.
+    auto fixed_llvm = taylor_make_empty_state(final_llvm_state());
 
-                // Handle the hidden deps.
-                for (auto idx : deps) {
-                    retval.emplace_back(idx);
-                }
+    const auto &ud = *m_upd_data;
+    taylor_add_adaptive_step<T>(*fixed_llvm, "step_fixed", ud.sys, ud.tol, 1, ud.high_accuracy, ud.compact_mode,
+                                ud.parallel_mode, ud.unroll_threshold, ud.contiguous_jets, false, ud.dl_order, false,
+                                {}, order, 0, {}, ud.ha_vars);
 
-                return retval;
-            } else {
-                throw std::invalid_argument("Invalid expression encountered in a Taylor decomposition: the "
-                                            "expression is not a function");
-            }
-        },
-        ex.value());
+    fixed_llvm->compile();
+
+    m_fixed_step_f = reinterpret_cast<step_f_t>(fixed_llvm->jit_lookup("step_fixed"));
+    m_fixed_llvm = std::move(fixed_llvm);
+    m_fixed_order = order;
 }
 
-// Helper to convert a vector of variants into a variant of vectors.
-// All elements of v must be of the same type, and v cannot be empty.
-template <typename... T>
-auto taylor_c_vv_transpose(const std::vector<std::variant<T...>> &v)
+template <typename T>
+std::uint32_t taylor_adaptive_impl<T>::get_fixed_step_order() const
 {
-    assert(!v.empty());
+    return m_fixed_order;
+}
 
-    // Init the return value based on the type
-    // of the first element of v.
-    auto retval = std::visit(
-        [size = v.size()](const auto &x) {
-            using type = detail::uncvref_t<decltype(x)>;
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_fixed(T h, bool wtc)
+{
+    using std::isfinite;
 
-            std::vector<type> tmp;
-            tmp.reserve(boost::numeric_cast<decltype(tmp.size())>(size));
-            tmp.push_back(x);
+    if (!isfinite(h)) {
+        throw std::invalid_argument("A non-finite timestep of {} was passed to the step_fixed() function of an "
+                                    "adaptive Taylor integrator"_format(h));
+    }
 
-            return std::variant<std::vector<T>...>(std::move(tmp));
-        },
-        v[0]);
+    if (m_fixed_order == 0u) {
+        prepare_fixed_step();
+    }
 
-    // Append the other values from v.
-    for (decltype(v.size()) i = 1; i < v.size(); ++i) {
-        std::visit(
-            [&retval](const auto &x) {
-                std::visit(
-                    [&x](auto &vv) {
-                        // The value type of retval.
-                        using scal_t = typename detail::uncvref_t<decltype(vv)>::value_type;
+    if (wtc && m_fixed_order != m_order) {
+        throw std::invalid_argument(
+            "The Taylor coefficients cannot be written by the step_fixed() function of an adaptive Taylor integrator "
+            "if the order of the fixed-step stepper ({}) differs from the order of the integrator ({})"_format(
+                m_fixed_order, m_order));
+    }
 
-                        // The type of the current element of v.
-                        using x_t = detail::uncvref_t<decltype(x)>;
+    m_fixed_step_f(m_state.data(), m_pars.data(), &m_time.hi, &h, wtc ? m_tc.data() : nullptr);
 
-                        if constexpr (std::is_same_v<scal_t, x_t>) {
-                            vv.push_back(x);
-                        } else {
-                            throw std::invalid_argument(
-                                "Inconsistent types detected while building the transposed sets of "
-                                "arguments for the Taylor derivative functions in compact mode");
-                        }
-                    },
-                    retval);
-            },
-            v[i]);
+    // Update the time.
+    m_time += h;
+
+    // Store the last timestep.
+    m_last_h = h;
+
+    // Check if the time or the state vector are non-finite at the
+    // end of the timestep.
+    if (!isfinite(m_time)
+        || std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !isfinite(x); })) {
+        return std::tuple{taylor_outcome::err_nf_state, h};
     }
 
-    return retval;
+    return std::tuple{taylor_outcome::success, h};
 }
 
-// Functions the create the arguments generators for the functions that compute
-// the Taylor derivatives in compact mode. The generators are created from vectors
-// of either u var indices or floating-point constants.
-std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vidx(llvm_state &s,
-                                                                       const std::vector<std::uint32_t> &ind)
+template <typename T>
+void taylor_adaptive_impl<T>::enable_var_order(std::vector<std::uint32_t> orders)
 {
-    assert(!ind.empty());
+    using std::abs;
+    using std::isfinite;
 
-    auto &builder = s.builder();
+    if (!m_upd_data) {
+        throw std::invalid_argument("The variable-order mode is not available in an adaptive Taylor integrator which "
+                                    "was constructed from a precomputed decomposition or deserialised");
+    }
 
-    // Check if all indices in ind are the same.
-    if (std::all_of(ind.begin() + 1, ind.end(), [&ind](const auto &n) { return n == ind[0]; })) {
-        // If all indices are the same, don't construct an array, just always return
-        // the same value.
-        return [num = builder.getInt32(ind[0])](llvm::Value *) -> llvm::Value * { return num; };
+    if (!m_tes.empty() || !m_ntes.empty()) {
+        throw std::invalid_argument(
+            "The variable-order mode is not available in an adaptive Taylor integrator with events");
     }
 
-    // Check if ind consists of consecutive indices.
-    bool are_consecutive = true;
-    auto prev_ind = ind[0];
-    for (decltype(ind.size()) i = 1; i < ind.size(); ++i) {
-        if (ind[i] != prev_ind + 1u) {
-            are_consecutive = false;
-            break;
+    if (m_fused_step) {
+        throw std::invalid_argument(
+            "The variable-order mode is not available in an adaptive Taylor integrator with the fused stepper");
+    }
+
+    // Default orders.
+    if (orders.empty()) {
+        for (auto delta : {8u, 4u}) {
+            if (m_order >= delta + 2u) {
+                orders.push_back(m_order - delta);
+            }
         }
-        prev_ind = ind[i];
     }
 
-    if (are_consecutive) {
-        // If ind consists of consecutive indices, we can replace
-        // the index array with a simple offset computation.
-        return [&s, start_idx = builder.getInt32(ind[0])](llvm::Value *cur_call_idx) -> llvm::Value * {
-            return s.builder().CreateAdd(start_idx, cur_call_idx);
-        };
+    // Validate the orders.
+    std::sort(orders.begin(), orders.end());
+    orders.erase(std::unique(orders.begin(), orders.end()), orders.end());
+    for (auto order : orders) {
+        if (order < 2u || order >= m_order) {
+            throw std::invalid_argument("Invalid order {} passed to enable_var_order() in an adaptive Taylor "
+                                        "integrator: the order must be at least 2 and less than the order of the "
+                                        "integrator ({})"_format(order, m_order));
+        }
     }
 
-    auto &module = s.module();
+    if (orders.empty()) {
+        // LCOV_EXCL_START
+        throw std::invalid_argument("No valid order is available for the variable-order mode of an adaptive Taylor "
+                                    "integrator with an order of {}"_format(m_order));
+        // LCOV_EXCL_STOP
+    }
 
-    // Generate the array of indices as llvm constants.
-    std::vector<llvm::Constant *> tmp_c_vec;
-    tmp_c_vec.reserve(ind.size());
-    for (const auto &val : ind) {
-        tmp_c_vec.push_back(builder.getInt32(val));
+    // NOTE: if a background compilation is ongoing, wait
+    // for it in order to fetch the original optimisation level.
+    auto vo_llvm = taylor_make_empty_state(final_llvm_state());
+
+    // NOTE: decompose the system only once.
+    const auto &ud = *m_upd_data;
+    const taylor_precomputed_dc pdc(ud.sys);
+
+    for (auto order : orders) {
+        taylor_add_adaptive_step<T>(*vo_llvm, "step_vo_{}"_format(order), pdc, ud.tol, 1, ud.high_accuracy,
+                                    ud.compact_mode, ud.parallel_mode, ud.unroll_threshold, ud.contiguous_jets, false,
+                                    ud.dl_order, ud.skip_one_way, ud.h_vars, 0, order, {}, ud.ha_vars);
     }
 
-    // Create the array type.
-    auto *arr_type = llvm::ArrayType::get(tmp_c_vec[0]->getType(), boost::numeric_cast<std::uint64_t>(ind.size()));
-    assert(arr_type != nullptr);
+    vo_llvm->compile();
 
-    // Create the constant array as a global read-only variable.
-    auto *const_arr = llvm::ConstantArray::get(arr_type, tmp_c_vec);
-    assert(const_arr != nullptr);
-    // NOTE: naked new here is fine, gvar will be registered in the module
-    // object and cleaned up when the module is destroyed.
-    auto *gvar = new llvm::GlobalVariable(module, const_arr->getType(), true, llvm::GlobalVariable::InternalLinkage,
-                                          const_arr);
+    std::vector<step_f_t> vo_step_f;
+    for (auto order : orders) {
+        vo_step_f.push_back(reinterpret_cast<step_f_t>(vo_llvm->jit_lookup("step_vo_{}"_format(order))));
+    }
 
-    // Return the generator.
-    return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * {
-        auto &builder = s.builder();
+    // Measure the cost of a timestep for each order,
+    // starting from the current state. The integrator's
+    // stepper is the last one.
+    // NOTE: the number of steps in the benchmark.
+    constexpr unsigned n_bench_steps = 10;
 
-        return builder.CreateLoad(builder.CreateInBoundsGEP(gvar, {builder.getInt32(0), cur_call_idx}));
-    };
+    auto all_step_f = vo_step_f;
+    all_step_f.push_back(std::get<0>(m_step_f));
+
+    std::vector<double> vo_cost;
+    std::vector<T> vo_last_h;
+    std::vector<T> tmp_state;
+    const auto time = m_time.hi;
+
+    for (auto *step_f : all_step_f) {
+        // NOTE: the first step is also used to
+        // initialise the timestep estimate.
+        tmp_state = m_state;
+        auto h = std::numeric_limits<T>::infinity();
+        step_f(tmp_state.data(), m_pars.data(), &time, &h, nullptr);
+        vo_last_h.push_back(isfinite(h) ? abs(h) : T(0));
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < n_bench_steps; ++i) {
+            tmp_state = m_state;
+            h = std::numeric_limits<T>::infinity();
+            step_f(tmp_state.data(), m_pars.data(), &time, &h, nullptr);
+        }
+        vo_cost.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                          / n_bench_steps);
+    }
+
+    // Assign the data members.
+    m_vo_llvm = std::move(vo_llvm);
+    m_vo_step_f = std::move(vo_step_f);
+    m_vo_orders = std::move(orders);
+    m_vo_cost = std::move(vo_cost);
+    m_vo_last_h = std::move(vo_last_h);
+    m_vo_tc.resize(boost::numeric_cast<decltype(m_vo_tc.size())>(m_tc.size()));
+    m_vo_idx = m_vo_orders.size();
+    m_vo_counter = 0;
 }
 
 template <typename T>
-std::function<llvm::Value *(llvm::Value *)> taylor_c_make_arg_gen_vc(llvm_state &s, const std::vector<number> &vc)
+void taylor_adaptive_impl<T>::disable_var_order()
+{
+    m_vo_llvm.reset();
+    m_vo_step_f.clear();
+    m_vo_orders.clear();
+    m_vo_cost.clear();
+    m_vo_last_h.clear();
+    m_vo_tc.clear();
+    m_vo_idx = 0;
+    m_vo_counter = 0;
+}
+
+// Select the order of the next timestep in variable-order mode. The
+// return value is an index into m_vo_cost.
+template <typename T>
+std::size_t taylor_adaptive_impl<T>::vo_select()
 {
-    assert(!vc.empty());
+    assert(!m_vo_cost.empty());
 
-    // Check if all the numbers are the same.
-    // NOTE: the comparison operator of number will consider two numbers of different
-    // type but equal value to be equal.
-    if (std::all_of(vc.begin() + 1, vc.end(), [&vc](const auto &n) { return n == vc[0]; })) {
-        // If all constants are the same, don't construct an array, just always return
-        // the same value.
-        return [num = codegen<T>(s, vc[0])](llvm::Value *) -> llvm::Value * { return num; };
+    const auto n = m_vo_cost.size();
+
+    // NOTE: periodically take a timestep with the order following
+    // the current one, in order to refresh the timestep estimates
+    // of the orders which are not being selected.
+    constexpr std::size_t explore_period = 16;
+    if (++m_vo_counter % explore_period == 0u) {
+        return (m_vo_idx + 1u) % n;
     }
 
-    auto &module = s.module();
+    // Select the order with the lowest cost
+    // per unit of integration time.
+    auto best = n - 1u;
+    auto best_cost = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (m_vo_last_h[i] > 0) {
+            const auto cur_cost = m_vo_cost[i] / static_cast<double>(m_vo_last_h[i]);
 
-    // Generate the array of constants as llvm constants.
-    std::vector<llvm::Constant *> tmp_c_vec;
-    tmp_c_vec.reserve(vc.size());
-    for (const auto &val : vc) {
-        tmp_c_vec.push_back(llvm::cast<llvm::Constant>(codegen<T>(s, val)));
+            if (cur_cost < best_cost) {
+                best_cost = cur_cost;
+                best = i;
+            }
+        }
     }
 
-    // Create the array type.
-    auto *arr_type = llvm::ArrayType::get(tmp_c_vec[0]->getType(), boost::numeric_cast<std::uint64_t>(vc.size()));
-    assert(arr_type != nullptr);
+    return best;
+}
 
-    // Create the constant array as a global read-only variable.
-    auto *const_arr = llvm::ConstantArray::get(arr_type, tmp_c_vec);
-    assert(const_arr != nullptr);
-    // NOTE: naked new here is fine, gvar will be registered in the module
-    // object and cleaned up when the module is destroyed.
-    auto *gvar = new llvm::GlobalVariable(module, const_arr->getType(), true, llvm::GlobalVariable::InternalLinkage,
-                                          const_arr);
+template <typename T>
+std::uint32_t taylor_adaptive_impl<T>::get_last_order() const
+{
+    return m_vo_idx < m_vo_orders.size() ? m_vo_orders[m_vo_idx] : m_order;
+}
 
-    // Return the generator.
-    return [gvar, &s](llvm::Value *cur_call_idx) -> llvm::Value * {
-        auto &builder = s.builder();
+template <typename T>
+void taylor_adaptive_impl<T>::set_sv_funcs(std::vector<expression> sv_funcs)
+{
+    if (sv_funcs.empty()) {
+        m_svf_llvm.reset();
+        m_svf_f = nullptr;
+        m_sv_funcs.clear();
+        m_sv_values.clear();
+        m_sv_ev_rows.clear();
 
-        return builder.CreateLoad(builder.CreateInBoundsGEP(gvar, {builder.getInt32(0), cur_call_idx}));
-    };
+        return;
+    }
+
+    // NOTE: if a background compilation is ongoing, wait
+    // for it in order to fetch the original optimisation level.
+    auto svf_llvm = taylor_make_sv_funcs_state<T>(final_llvm_state(), *m_dc, m_dim, m_pars.size(), sv_funcs);
+
+    // Look for the sv_funcs which are identical to an event equation.
+    // NOTE: the event equations are decomposed together with the
+    // dynamics (as the sv_funcs of the decomposition), and the jet of the
+    // stepper contains their Taylor coefficients after the rows of the
+    // state variables, first the terminal and then the non-terminal events.
+    std::vector<std::uint32_t> sv_ev_rows;
+    for (const auto &ex : sv_funcs) {
+        auto row = std::numeric_limits<std::uint32_t>::max();
+
+        for (decltype(m_tes.size()) i = 0; i < m_tes.size() && row == std::numeric_limits<std::uint32_t>::max();
+             ++i) {
+            if (m_tes[i].get_expression() == ex) {
+                row = m_dim + static_cast<std::uint32_t>(i);
+            }
+        }
+
+        for (decltype(m_ntes.size()) i = 0; i < m_ntes.size() && row == std::numeric_limits<std::uint32_t>::max();
+             ++i) {
+            if (m_ntes[i].get_expression() == ex) {
+                row = m_dim + static_cast<std::uint32_t>(m_tes.size() + i);
+            }
+        }
+
+        sv_ev_rows.push_back(row);
+    }
+
+    m_svf_f = reinterpret_cast<sv_funcs_f_t>(svf_llvm->jit_lookup("sv_funcs"));
+    m_svf_llvm = std::move(svf_llvm);
+    m_sv_values.resize(sv_funcs.size());
+    m_sv_funcs = std::move(sv_funcs);
+    m_sv_ev_rows = std::move(sv_ev_rows);
 }
 
-// For each segment in s_dc, this function will return a vector containing a dict mapping an LLVM function
-// f for the computation of a Taylor derivative to a size and a vector of std::functions. For example, one entry
-// in the return value will read something like:
-// {f : (2, [g_0, g_1, g_2])}
-// The meaning in this example is that the arity of f is 3 and it will be called with 2 different
-// sets of arguments. The g_i functions are expected to be called with input argument j in [0, 1]
-// to yield the value of the i-th function argument for f at the j-th invocation.
+// Evaluate the sv_funcs for the state vector
+// state, writing the result into m_sv_values.
 template <typename T>
-auto taylor_build_function_maps(llvm_state &s, const std::vector<taylor_dc_t> &s_dc, std::uint32_t n_eq,
-                                std::uint32_t n_uvars, std::uint32_t batch_size)
+void taylor_adaptive_impl<T>::eval_sv_funcs(const std::vector<T> &state) const
 {
-    // Init the return value.
-    std::vector<std::unordered_map<llvm::Function *,
-                                   std::pair<std::uint32_t, std::vector<std::function<llvm::Value *(llvm::Value *)>>>>>
-        retval;
+    assert(m_svf_f != nullptr);
+    assert(state.size() == m_dim);
+    assert(m_sv_values.size() == m_sv_funcs.size());
 
-    // Variable to keep track of the u variable
-    // on whose definition we are operating.
-    auto cur_u_idx = n_eq;
-    for (const auto &seg : s_dc) {
-        // This structure maps an LLVM function to sets of arguments
-        // with which the function is to be called. For instance, if function
-        // f(x, y, z) is to be called as f(a, b, c) and f(d, e, f), then tmp_map
-        // will contain {f : [[a, b, c], [d, e, f]]}.
-        // After construction, we have verified that for each function
-        // in the map the sets of arguments have all the same size.
-        std::unordered_map<llvm::Function *, std::vector<std::vector<std::variant<std::uint32_t, number>>>> tmp_map;
+    m_svf_f(m_sv_values.data(), state.data(), m_pars.data(), 1);
+}
 
-        for (const auto &ex : seg) {
-            // Get the function for the computation of the derivative.
-            auto func = taylor_c_diff_func<T>(s, ex.first, n_uvars, batch_size);
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::get_sv_values() const
+{
+    if (m_svf_f != nullptr) {
+        eval_sv_funcs(m_state);
+    }
 
-            // Insert the function into tmp_map.
-            const auto [it, is_new_func] = tmp_map.try_emplace(func);
+    return m_sv_values;
+}
 
-            assert(is_new_func || !it->second.empty());
+template <typename T>
+void taylor_adaptive_impl<T>::set_h_collapse(T rel_h, std::size_t n_steps)
+{
+    using std::isfinite;
 
-            // Convert the variables/constants in the current dc
-            // element into a set of indices/constants.
-            const auto cdiff_args = taylor_udef_to_variants(ex.first, ex.second);
+    if (!isfinite(rel_h) || rel_h < 0) {
+        throw std::invalid_argument("The relative timestep threshold of the step-size collapse detector must be "
+                                    "finite and non-negative, but it is {} instead"_format(rel_h));
+    }
 
-            if (!is_new_func && it->second.back().size() - 1u != cdiff_args.size()) {
-                throw std::invalid_argument(
-                    "Inconsistent arity detected in a Taylor derivative function in compact "
-                    "mode: the same function is being called with both {} and {} arguments"_format(
-                        it->second.back().size() - 1u, cdiff_args.size()));
-            }
+    if (rel_h > 0 && n_steps == 0u) {
+        throw std::invalid_argument(
+            "The number of timesteps of the step-size collapse detector must be positive");
+    }
 
-            // Add the new set of arguments.
-            it->second.emplace_back();
-            // Add the idx of the u variable.
-            it->second.back().emplace_back(cur_u_idx);
-            // Add the actual function arguments.
-            it->second.back().insert(it->second.back().end(), cdiff_args.begin(), cdiff_args.end());
+    m_hc_rel = rel_h;
+    m_hc_n = rel_h > 0 ? n_steps : 0;
+}
 
-            ++cur_u_idx;
-        }
+template <typename T>
+void taylor_adaptive_impl<T>::set_invariants(std::vector<expression> invs, std::size_t n_steps,
+                                             std::vector<T> thresholds, std::size_t hist_size)
+{
+    using std::isnan;
 
-        // Now we build the transposition of tmp_map: from {f : [[a, b, c], [d, e, f]]}
-        // to {f : [[a, d], [b, e], [c, f]]}.
-        std::unordered_map<llvm::Function *, std::vector<std::variant<std::vector<std::uint32_t>, std::vector<number>>>>
-            tmp_map_transpose;
-        for (const auto &[func, vv] : tmp_map) {
-            assert(!vv.empty());
+    if (invs.empty()) {
+        m_inv_llvm.reset();
+        m_inv_f = nullptr;
+        m_invs.clear();
+        m_inv_every = 0;
+        m_inv_thr.clear();
+        m_inv_ref.clear();
+        m_inv_drift.clear();
+        m_inv_hist.clear();
+        m_inv_hist_cap = 0;
+        m_inv_hist_pos = 0;
+        m_inv_counter = 0;
+        m_inv_out.clear();
 
-            // Add the function.
-            const auto [it, ins_status] = tmp_map_transpose.try_emplace(func);
-            assert(ins_status);
+        return;
+    }
 
-            const auto n_calls = vv.size();
-            const auto n_args = vv[0].size();
-            // NOTE: n_args must be at least 1 because the u idx
-            // is prepended to the actual function arguments in
-            // the tmp_map entries.
-            assert(n_args >= 1u);
+    if (n_steps == 0u) {
+        throw std::invalid_argument("The number of timesteps between the evaluations of the invariants in an "
+                                    "adaptive Taylor integrator must be positive");
+    }
 
-            for (decltype(vv[0].size()) i = 0; i < n_args; ++i) {
-                // Build the vector of values corresponding
-                // to the current argument index.
-                std::vector<std::variant<std::uint32_t, number>> tmp_c_vec;
-                for (decltype(vv.size()) j = 0; j < n_calls; ++j) {
-                    tmp_c_vec.push_back(vv[j][i]);
-                }
+    if (!thresholds.empty() && thresholds.size() != invs.size()) {
+        throw std::invalid_argument("Invalid number of thresholds for the invariants of an adaptive Taylor "
+                                    "integrator: the number of invariants is {}, but the number of thresholds is "
+                                    "{}"_format(invs.size(), thresholds.size()));
+    }
 
-                // Turn tmp_c_vec (a vector of variants) into a variant
-                // of vectors, and insert the result.
-                it->second.push_back(taylor_c_vv_transpose(tmp_c_vec));
-            }
+    for (const auto &thr : thresholds) {
+        if (isnan(thr) || thr <= 0) {
+            throw std::invalid_argument("The thresholds for the invariants of an adaptive Taylor integrator must be "
+                                        "positive, but the threshold {} was found instead"_format(thr));
         }
+    }
+
+    // LCOV_EXCL_START
+    if (hist_size > std::numeric_limits<std::size_t>::max() / (invs.size() + 1u)) {
+        throw std::overflow_error("Overflow detected in the size of the history of the invariants of an adaptive "
+                                  "Taylor integrator");
+    }
+    // LCOV_EXCL_STOP
+
+    // NOTE: like the sv_funcs, the invariants are compiled in a separate LLVM state.
+    auto inv_llvm
+        = taylor_make_sv_funcs_state<T>(final_llvm_state(), *m_dc, m_dim, m_pars.size(), invs, "invariants");
+    m_inv_f = reinterpret_cast<sv_funcs_f_t>(inv_llvm->jit_lookup("invariants"));
+    m_inv_llvm = std::move(inv_llvm);
+
+    // Compute the reference values.
+    m_inv_ref.resize(invs.size());
+    m_inv_f(m_inv_ref.data(), m_state.data(), m_pars.data(), 1);
+
+    m_inv_every = n_steps;
+    m_inv_thr = std::move(thresholds);
+    m_inv_drift.assign(invs.size(), T(0));
+    m_inv_hist.clear();
+    m_inv_hist.reserve(hist_size * (invs.size() + 1u));
+    m_inv_hist_cap = hist_size;
+    m_inv_hist_pos = 0;
+    m_inv_counter = 0;
+    m_inv_out.resize(invs.size());
+    m_invs = std::move(invs);
+}
+
+// Evaluate the invariants for the current state, updating the drifts
+// and the history. The return value is false if the drift of an
+// invariant exceeds its threshold, true otherwise.
+// NOTE: a nan drift does not stop the propagation.
+template <typename T>
+bool taylor_adaptive_impl<T>::eval_invariants()
+{
+    using std::abs;
+
+    assert(m_inv_f != nullptr);
 
-        // Add a new entry in retval for the current segment.
-        retval.emplace_back();
-        auto &a_map = retval.back();
+    const auto n_invs = m_invs.size();
 
-        for (const auto &[func, vv] : tmp_map_transpose) {
-            assert(!vv.empty());
+    m_inv_f(m_inv_out.data(), m_state.data(), m_pars.data(), 1);
 
-            // Add the function.
-            const auto [it, ins_status] = a_map.try_emplace(func);
-            assert(ins_status);
+    // Record the evaluation in the history.
+    if (m_inv_hist_cap > 0u) {
+        const auto rec_size = n_invs + 1u;
 
-            // Set the number of calls for this function.
-            it->second.first
-                = std::visit([](const auto &x) { return boost::numeric_cast<std::uint32_t>(x.size()); }, vv[0]);
-            assert(it->second.first > 0u);
+        T *rec = nullptr;
+        if (m_inv_hist.size() < m_inv_hist_cap * rec_size) {
+            // NOTE: the capacity of m_inv_hist was reserved
+            // in set_invariants(), thus no allocation happens here.
+            m_inv_hist.resize(m_inv_hist.size() + rec_size);
+            rec = m_inv_hist.data() + (m_inv_hist.size() - rec_size);
+        } else {
+            // The history is full, overwrite the oldest record.
+            rec = m_inv_hist.data() + m_inv_hist_pos * rec_size;
+            m_inv_hist_pos = (m_inv_hist_pos + 1u) % m_inv_hist_cap;
+        }
 
-            // Create the g functions for each argument.
-            for (const auto &v : vv) {
-                it->second.second.push_back(std::visit(
-                    [&s](const auto &x) {
-                        using type = detail::uncvref_t<decltype(x)>;
+        rec[0] = static_cast<T>(m_time);
+        std::copy(m_inv_out.begin(), m_inv_out.end(), rec + 1);
+    }
 
-                        if constexpr (std::is_same_v<type, std::vector<std::uint32_t>>) {
-                            return taylor_c_make_arg_gen_vidx(s, x);
-                        } else {
-                            return taylor_c_make_arg_gen_vc<T>(s, x);
-                        }
-                    },
-                    v));
-            }
+    bool retval = true;
+    for (decltype(m_invs.size()) i = 0; i < n_invs; ++i) {
+        auto drift = abs(m_inv_out[i] - m_inv_ref[i]);
+        if (m_inv_ref[i] != 0) {
+            drift /= abs(m_inv_ref[i]);
+        }
+        m_inv_drift[i] = drift;
+
+        if (!m_inv_thr.empty() && drift > m_inv_thr[i]) {
+            retval = false;
         }
     }
 
     return retval;
 }
 
-// Helper for the computation of a jet of derivatives in compact mode,
-// used in taylor_compute_jet() below.
 template <typename T>
-llvm::Value *taylor_compute_jet_compact_mode(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr,
-                                             llvm::Value *time_ptr, const taylor_dc_t &dc,
-                                             const std::vector<std::uint32_t> &sv_funcs_dc, std::uint32_t n_eq,
-                                             std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size)
+std::vector<T> taylor_adaptive_impl<T>::get_invariants_history() const
 {
-    auto &builder = s.builder();
+    // NOTE: once the history is full, the oldest
+    // record is the one at m_inv_hist_pos.
+    const auto pos = static_cast<decltype(m_inv_hist.size())>(m_inv_hist_pos * (m_invs.size() + 1u));
 
-    // Split dc into segments.
-    const auto s_dc = taylor_segment_dc(dc, n_eq);
+    std::vector<T> retval;
+    retval.reserve(m_inv_hist.size());
+    retval.insert(retval.end(), m_inv_hist.begin() + pos, m_inv_hist.end());
+    retval.insert(retval.end(), m_inv_hist.begin(), m_inv_hist.begin() + pos);
 
-    // Generate the function maps.
-    const auto f_maps = taylor_build_function_maps<T>(s, s_dc, n_eq, n_uvars, batch_size);
+    return retval;
+}
 
-    // Generate the global arrays for the computation of the derivatives
-    // of the state variables.
-    const auto svd_gl = taylor_c_make_sv_diff_globals<T>(s, dc, n_uvars);
+// Helper to update the state of the step-size collapse detector
+// after a timestep of size h with outcome res. thr is the timestep
+// threshold and counter the number of consecutive timesteps
+// below the threshold. The return value is true if a collapse
+// was detected.
+template <typename T>
+bool taylor_adaptive_impl<T>::h_collapse_check(taylor_outcome res, T h, T thr, std::size_t &counter) const
+{
+    using std::abs;
 
-    // Determine the maximum u variable index appearing in sv_funcs_dc, or zero
-    // if sv_funcs_dc is empty.
-    const auto max_svf_idx
-        = sv_funcs_dc.empty() ? std::uint32_t(0) : *std::max_element(sv_funcs_dc.begin(), sv_funcs_dc.end());
+    // NOTE: the timesteps clamped by time limits
+    // or by terminal events are not considered.
+    if (m_hc_n == 0u || res != taylor_outcome::success) {
+        return false;
+    }
 
-    // Prepare the array that will contain the jet of derivatives.
-    // We will be storing all the derivatives of the u variables
-    // up to order 'order - 1', the derivatives of order
-    // 'order' of the state variables and the derivatives
-    // of order 'order' of the sv_funcs.
-    // NOTE: the array size is specified as a 64-bit integer in the
-    // LLVM API.
-    // NOTE: fp_type is the original, scalar floating-point type.
-    // It will be turned into a vector type (if necessary) by
-    // make_vector_type() below.
-    // NOTE: if sv_funcs_dc is empty, or if all its indices are not greater
-    // than the indices of the state variables, then we don't need additional
-    // slots after the sv derivatives. If we need additional slots, allocate
-    // another full column of derivatives, as it is complicated at this stage
-    // to know exactly how many slots we will need.
-    auto *fp_type = llvm::cast<llvm::PointerType>(order0->getType())->getElementType();
-    auto *array_type = llvm::ArrayType::get(make_vector_type(fp_type, batch_size),
-                                            (max_svf_idx < n_eq) ? (n_uvars * order + n_eq) : (n_uvars * (order + 1u)));
+    if (abs(h) < thr) {
+        return ++counter == m_hc_n;
+    }
 
-    // Make the global array and fetch a pointer to its first element.
-    // NOTE: we use a global array rather than a local one here because
-    // its size can grow quite large, which can lead to stack overflow issues.
-    // This has of course consequences in terms of thread safety, which
-    // we will have to document.
-    auto *diff_arr = builder.CreateInBoundsGEP(make_global_zero_array(s.module(), array_type),
-                                               {builder.getInt32(0), builder.getInt32(0)});
+    counter = 0;
 
-    // Copy over the order-0 derivatives of the state variables.
-    // NOTE: overflow checking is already done in the parent function.
-    llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-        // Fetch the pointer from order0.
-        auto *ptr = builder.CreateInBoundsGEP(order0, {builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))});
+    return false;
+}
 
-        // Load as a vector.
-        auto *vec = load_vector_from_memory(builder, ptr, batch_size);
+template <typename T>
+taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(const taylor_adaptive_impl &other)
+{
+    if (this != &other) {
+        *this = taylor_adaptive_impl(other);
+    }
 
-        // Store into diff_arr.
-        builder.CreateStore(vec, builder.CreateInBoundsGEP(diff_arr, {cur_var_idx}));
-    });
+    return *this;
+}
 
-    // Helper to compute and store the derivatives of order cur_order
-    // of the u variables which are not state variables.
-    auto compute_u_diffs = [&](llvm::Value *cur_order) {
-        for (const auto &map : f_maps) {
-            for (const auto &p : map) {
-                // The LLVM function for the computation of the
-                // derivative in compact mode.
-                const auto &func = p.first;
+template <typename T>
+taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(taylor_adaptive_impl &&) noexcept = default;
 
-                // The number of func calls.
-                const auto ncalls = p.second.first;
+template <typename T>
+taylor_adaptive_impl<T>::~taylor_adaptive_impl() = default;
 
-                // The generators for the arguments of func.
-                const auto &gens = p.second.second;
+template <typename T>
+taylor_adaptive_impl<T>::taylor_adaptive_impl() = default;
 
-                assert(ncalls > 0u);
-                assert(!gens.empty());
-                assert(std::all_of(gens.begin(), gens.end(), [](const auto &f) { return static_cast<bool>(f); }));
-
-                // Loop over the number of calls.
-                llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(ncalls), [&](llvm::Value *cur_call_idx) {
-                    // Create the u variable index from the first generator.
-                    auto u_idx = gens[0](cur_call_idx);
-
-                    // Initialise the vector of arguments with which func must be called. The following
-                    // initial arguments are always present:
-                    // - current Taylor order,
-                    // - u index of the variable,
-                    // - array of derivatives,
-                    // - pointer to the param values,
-                    // - pointer to the time value(s).
-                    std::vector<llvm::Value *> args{cur_order, u_idx, diff_arr, par_ptr, time_ptr};
-
-                    // Create the other arguments via the generators.
-                    for (decltype(gens.size()) i = 1; i < gens.size(); ++i) {
-                        args.push_back(gens[i](cur_call_idx));
-                    }
+template <typename T>
+void taylor_adaptive_impl<T>::save(std::ostream &os) const
+{
+    s11n_save_header(os, "taylor_adaptive", 3);
+
+    sync_tc();
+
+    // NOTE: store the number of binary digits in order
+    // to distinguish between the floating-point types.
+    s11n_save(os, static_cast<std::uint32_t>(std::numeric_limits<T>::digits));
+
+    s11n_save(os, m_state);
+    s11n_save(os, m_time.hi);
+    s11n_save(os, m_time.lo);
+    // NOTE: if a background compilation is ongoing,
+    // wait for it and save the optimised LLVM state.
+    final_llvm_state().save(os);
+    s11n_save(os, m_dim);
+    s11n_save(os, *m_dc);
+    s11n_save(os, m_order);
+    s11n_save(os, m_fused_step);
+    s11n_save(os, m_pars);
+    s11n_save(os, m_tc);
+    s11n_save(os, m_last_h);
+    s11n_save(os, m_d_out);
+    s11n_save(os, m_d_out_multi_size);
+
+    // NOTE: the callbacks of the events cannot be serialised,
+    // thus we store only the event equations, which will be
+    // used to validate the events passed to load().
+    s11n_save_size(os, m_tes.size());
+    for (const auto &ev : m_tes) {
+        s11n_save(os, ev.get_expression());
+    }
+    s11n_save_size(os, m_ntes.size());
+    for (const auto &ev : m_ntes) {
+        s11n_save(os, ev.get_expression());
+    }
+
+    // NOTE: in scratch mode, m_ev_jet is empty. Save it
+    // with its regular size, so that the deserialised
+    // integrator does not need any special handling.
+    if (m_thread_scratch) {
+        s11n_save(os, aligned_vector<T>(ev_jet_size()));
+    } else {
+        s11n_save(os, m_ev_jet);
+    }
 
-                    // Calculate the derivative and store the result.
-                    taylor_c_store_diff(s, diff_arr, n_uvars, cur_order, u_idx, builder.CreateCall(func, args));
-                });
-            }
+    s11n_save_size(os, m_te_cooldowns.size());
+    for (const auto &cd : m_te_cooldowns) {
+        s11n_save(os, static_cast<bool>(cd));
+        if (cd) {
+            s11n_save(os, cd->first);
+            s11n_save(os, cd->second);
         }
-    };
-
-    // Compute the order-0 derivatives (i.e., the initial values)
-    // for all u variables which are not state variables.
-    compute_u_diffs(builder.getInt32(0));
+    }
 
-    // Compute all derivatives up to order 'order - 1'.
-    llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order), [&](llvm::Value *cur_order) {
-        // State variables first.
-        taylor_c_compute_sv_diffs<T>(s, svd_gl, diff_arr, par_ptr, n_uvars, cur_order, batch_size);
+    s11n_save(os, m_sep_ev_jet);
+    if (m_sep_ev_jet) {
+        m_ev_llvm->save(os);
+    }
+}
 
-        // The other u variables.
-        compute_u_diffs(cur_order);
-    });
+// NOTE: the events passed to this function must have the same
+// equations as the events of the serialised integrator.
+template <typename T>
+taylor_adaptive_impl<T> taylor_adaptive_impl<T>::load(std::istream &is, std::vector<t_event_t> tes,
+                                                      std::vector<nt_event_t> ntes)
+{
+    s11n_load_header(is, "taylor_adaptive", 3);
 
-    // Compute the last-order derivatives for the state variables.
-    taylor_c_compute_sv_diffs<T>(s, svd_gl, diff_arr, par_ptr, n_uvars, builder.getInt32(order), batch_size);
+    std::uint32_t digits = 0;
+    s11n_load(is, digits);
+    if (digits != static_cast<std::uint32_t>(std::numeric_limits<T>::digits)) {
+        throw std::invalid_argument("Cannot deserialise an adaptive Taylor integrator: the floating-point type of "
+                                    "the serialised integrator does not match the type of the integrator being "
+                                    "deserialised");
+    }
 
-    // Compute the last-order derivatives for the sv_funcs, if any. Because the sv funcs
-    // correspond to u variables in the decomposition, we will have to compute the
-    // last-order derivatives of the u variables until we are sure all sv_funcs derivatives
-    // have been properly computed.
+    taylor_adaptive_impl retval;
 
-    // Monitor the starting index of the current
-    // segment while iterating on f_maps.
-    auto cur_start_u_idx = n_eq;
+    s11n_load(is, retval.m_state);
+    s11n_load(is, retval.m_time.hi);
+    s11n_load(is, retval.m_time.lo);
+    retval.m_llvm->load(is);
+    s11n_load(is, retval.m_dim);
+    {
+        taylor_dc_t dc;
+        s11n_load(is, dc);
+        retval.m_dc = std::make_shared<const taylor_dc_t>(std::move(dc));
+    }
+    s11n_load(is, retval.m_order);
+    s11n_load(is, retval.m_fused_step);
+    s11n_load(is, retval.m_pars);
+    s11n_load(is, retval.m_tc);
+    s11n_load(is, retval.m_last_h);
+    s11n_load(is, retval.m_d_out);
+    s11n_load(is, retval.m_d_out_multi_size);
+
+    // NOTE: the knots are not serialised, they are
+    // recovered from the decomposition.
+    retval.m_tpw_knots = tpwpoly_knots(*retval.m_dc);
+
+    // Validate the events.
+    auto check_events = [&is](const auto &evs, const char *ev_type) {
+        const auto n_evs = s11n_load_size<decltype(evs.size())>(is);
+        if (n_evs != evs.size()) {
+            throw std::invalid_argument(
+                "Cannot deserialise an adaptive Taylor integrator: the serialised integrator contains {} {} "
+                "event(s), but {} {} event(s) were provided"_format(n_evs, ev_type, evs.size(), ev_type));
+        }
 
-    // NOTE: this is a slight repetition of compute_u_diffs() with minor modifications.
-    for (const auto &map : f_maps) {
-        if (cur_start_u_idx > max_svf_idx) {
-            // We computed all the necessary derivatives, break out.
-            // NOTE: if we did not have sv_funcs to begin with,
-            // max_svf_idx is zero and we exit at the first iteration
-            // without doing anything. If all sv funcs alias state variables,
-            // then max_svf_idx < n_eq and thus we also exit immediately
-            // at the first iteration.
-            break;
+        expression ex;
+        for (decltype(evs.size()) i = 0; i < n_evs; ++i) {
+            s11n_load(is, ex);
+            if (ex != evs[i].get_expression()) {
+                throw std::invalid_argument(
+                    "Cannot deserialise an adaptive Taylor integrator: the equation of the {} event at index {} "
+                    "does not match the equation of the serialised event"_format(ev_type, i));
+            }
         }
+    };
 
-        for (const auto &p : map) {
-            const auto &func = p.first;
-            const auto ncalls = p.second.first;
-            const auto &gens = p.second.second;
+    check_events(tes, "terminal");
+    check_events(ntes, "non-terminal");
 
-            assert(ncalls > 0u);
-            assert(!gens.empty());
-            assert(std::all_of(gens.begin(), gens.end(), [](const auto &f) { return static_cast<bool>(f); }));
+    retval.m_tes = std::move(tes);
+    retval.m_ntes = std::move(ntes);
 
-            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(ncalls), [&](llvm::Value *cur_call_idx) {
-                auto u_idx = gens[0](cur_call_idx);
+    s11n_load(is, retval.m_ev_jet);
 
-                std::vector<llvm::Value *> args{builder.getInt32(order), u_idx, diff_arr, par_ptr, time_ptr};
+    retval.m_te_cooldowns.resize(s11n_load_size<decltype(retval.m_te_cooldowns.size())>(is));
+    for (auto &cd : retval.m_te_cooldowns) {
+        bool has_cd = false;
+        s11n_load(is, has_cd);
+        if (has_cd) {
+            T first(0), second(0);
+            s11n_load(is, first);
+            s11n_load(is, second);
+            cd.emplace(first, second);
+        }
+    }
 
-                for (decltype(gens.size()) i = 1; i < gens.size(); ++i) {
-                    args.push_back(gens[i](cur_call_idx));
-                }
+    s11n_load(is, retval.m_sep_ev_jet);
+    if (retval.m_sep_ev_jet) {
+        retval.m_ev_llvm = std::make_shared<llvm_state>();
+        retval.m_ev_llvm->load(is);
+    }
 
-                taylor_c_store_diff(s, diff_arr, n_uvars, builder.getInt32(order), u_idx,
-                                    builder.CreateCall(func, args));
-            });
+    // Sanity checks.
+    if (retval.m_te_cooldowns.size() != retval.m_tes.size()
+        || (retval.m_sep_ev_jet && retval.m_tes.empty() && retval.m_ntes.empty())
+        || retval.m_state.size() != retval.m_dim
+        || retval.m_tc.size() != retval.m_state.size() * (retval.m_order + 1u)
+        || (retval.m_fused_step && (!retval.m_tes.empty() || !retval.m_ntes.empty()))) {
+        throw std::invalid_argument(
+            "Cannot deserialise an adaptive Taylor integrator: inconsistent data detected in the input stream");
+    }
 
-            // Update cur_start_u_idx taking advantage of the fact
-            // that each block in a segment processes the derivatives
-            // of exactly ncalls u variables.
-            cur_start_u_idx += ncalls;
-        }
+    // Fetch the compiled functions.
+    retval.m_step_f = taylor_lookup_step<decltype(retval.m_step_f)>(
+        *retval.m_llvm, !retval.m_tes.empty() || !retval.m_ntes.empty(), retval.m_fused_step);
+    if (retval.m_fused_step) {
+        retval.m_step_n_f = reinterpret_cast<step_n_f_t>(retval.m_llvm->jit_lookup("step_n"));
     }
 
-    // Return the array of derivatives of the u variables.
-    return diff_arr;
+    retval.m_d_out_f = reinterpret_cast<d_out_f_t>(retval.m_llvm->jit_lookup("d_out_f"));
+    if (retval.m_d_out_multi_size > 1u) {
+        retval.m_d_out_multi_f = reinterpret_cast<d_out_f_t>(retval.m_llvm->jit_lookup("d_out_multi_f"));
+    }
+    if (retval.m_sep_ev_jet) {
+        retval.m_ev_jet_f = reinterpret_cast<ev_jet_f_t>(retval.m_ev_llvm->jit_lookup("ev_jet"));
+    }
+
+    return retval;
 }
 
-// Given an input pointer 'in', load the first n * batch_size values in it as n vectors
-// with size batch_size. If batch_size is 1, the values will be loaded as scalars.
-auto taylor_load_values(llvm_state &s, llvm::Value *in, std::uint32_t n, std::uint32_t batch_size)
+namespace
 {
-    assert(batch_size > 0u);
-
-    auto &builder = s.builder();
-
-    std::vector<llvm::Value *> retval;
-    for (std::uint32_t i = 0; i < n; ++i) {
-        // Fetch the pointer from in.
-        // NOTE: overflow checking is done in the parent function.
-        auto *ptr = builder.CreateInBoundsGEP(in, {builder.getInt32(i * batch_size)});
 
-        // Load the value in vector mode.
-        retval.push_back(load_vector_from_memory(builder, ptr, batch_size));
-    }
+// Helper to add to acc the time elapsed
+// since start (in seconds).
+void taylor_perf_add_time(double &acc, const std::chrono::steady_clock::time_point &start)
+{
+    acc += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-    return retval;
+// Helper to fetch the current time, but only
+// if the performance counters are enabled.
+std::chrono::steady_clock::time_point taylor_perf_now(bool enabled)
+{
+    return enabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
 }
 
-// Helper function to compute the jet of Taylor derivatives up to a given order. n_eq
-// is the number of equations/variables in the ODE sys, dc its Taylor decomposition,
-// n_uvars the total number of u variables in the decomposition.
-// order is the max derivative order desired, batch_size the batch size.
-// order0 is a pointer to an array of (at least) n_eq * batch_size scalar elements
-// containing the derivatives of order 0. par_ptr is a pointer to an array containing
-// the numerical values of the parameters, time_ptr a pointer to the time value(s).
-// sv_funcs are the indices, in the decomposition, of the functions of state
-// variables.
-//
-// The return value is a variant containing either:
-// - in compact mode, the array containing the derivatives of all u variables,
-// - otherwise, the jet of derivatives of the state variables and sv_funcs
-//   up to order 'order'.
+// Limit the timestep max_delta_t of the batch element batch_idx, starting at time t,
+// so that it does not cross the knots of the piecewise polynomials of time. The values
+// of the knots are read from the array of parameters pars. at_knot is set to true if the
+// timestep is backward and t is exactly at a knot.
+// NOTE: the first and last knots are not breakpoints, as the polynomials
+// of the first and last segments are used beyond them.
 template <typename T>
-std::variant<llvm::Value *, std::vector<llvm::Value *>>
-taylor_compute_jet(llvm_state &s, llvm::Value *order0, llvm::Value *par_ptr, llvm::Value *time_ptr,
-                   const taylor_dc_t &dc, const std::vector<std::uint32_t> &sv_funcs_dc, std::uint32_t n_eq,
-                   std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool compact_mode)
+T taylor_tpw_clamp(const std::vector<std::pair<std::uint32_t, std::uint32_t>> &knots, const std::vector<T> &pars,
+                   std::uint32_t batch_size, std::uint32_t batch_idx, const dfloat<T> &t, T max_delta_t, bool &at_knot)
 {
-    assert(batch_size > 0u);
-    assert(n_eq > 0u);
-    assert(order > 0u);
+    using std::abs;
 
-    // Make sure we can represent n_uvars * (order + 1) as a 32-bit
-    // unsigned integer. This is the maximum total number of derivatives we will have to compute
-    // and store, with the +1 taking into account the extra slots that might be needed by sv_funcs_dc.
-    // If sv_funcs_dc is empty, we need only n_uvars * order + n_eq derivatives.
-    // LCOV_EXCL_START
-    if (order == std::numeric_limits<std::uint32_t>::max()
-        || n_uvars > std::numeric_limits<std::uint32_t>::max() / (order + 1u)) {
-        throw std::overflow_error(
-            "An overflow condition was detected in the computation of a jet of Taylor derivatives");
-    }
+    at_knot = false;
 
-    // We also need to be able to index up to n_eq * batch_size in order0.
-    if (n_eq > std::numeric_limits<std::uint32_t>::max() / batch_size) {
-        throw std::overflow_error(
-            "An overflow condition was detected in the computation of a jet of Taylor derivatives");
+    if (max_delta_t == 0) {
+        return max_delta_t;
     }
-    // LCOV_EXCL_STOP
 
-    if (compact_mode) {
-        // In compact mode, let's ensure that we can index into par_ptr using std::uint32_t.
-        // NOTE: in default mode the check is done inside taylor_codegen_numparam_par().
+    const auto fwd = max_delta_t > 0;
 
-        // Deduce the size of the param array from the expressions in the decomposition.
-        std::uint32_t param_size = 0;
-        for (auto i = n_eq; i < dc.size(); ++i) {
-            param_size = std::max(param_size, get_param_size(dc[i].first));
-        }
-        // LCOV_EXCL_START
-        if (param_size > std::numeric_limits<std::uint32_t>::max() / batch_size) {
-            throw std::overflow_error(
-                "An overflow condition was detected in the computation of a jet of Taylor derivatives in compact mode");
-        }
-        // LCOV_EXCL_STOP
+    for (const auto &[b_idx, n_knots] : knots) {
+        assert(n_knots >= 2u);
+
+        auto knot = [&, b_idx = b_idx](std::uint32_t j) {
+            return pars[(static_cast<decltype(pars.size())>(b_idx) + j) * batch_size + batch_idx];
+        };
 
-        return taylor_compute_jet_compact_mode<T>(s, order0, par_ptr, time_ptr, dc, sv_funcs_dc, n_eq, n_uvars, order,
-                                                  batch_size);
-    } else {
-        // Init the derivatives array with the order 0 of the state variables.
-        auto diff_arr = taylor_load_values(s, order0, n_eq, batch_size);
+        // Locate the first interior knot greater than t (forward) or
+        // not less than t (backward).
+        std::uint32_t lo = 1, hi = n_knots - 1u;
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2u;
 
-        // Compute the order-0 derivatives of the other u variables.
-        for (auto i = n_eq; i < n_uvars; ++i) {
-            diff_arr.push_back(
-                taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars, 0, i, batch_size));
+            if (fwd ? knot(mid) > t : knot(mid) >= t) {
+                hi = mid;
+            } else {
+                lo = mid + 1u;
+            }
         }
 
-        // Compute the derivatives order by order, starting from 1 to order excluded.
-        // We will compute the highest derivatives of the state variables separately
-        // in the last step.
-        for (std::uint32_t cur_order = 1; cur_order < order; ++cur_order) {
-            // Begin with the state variables.
-            // NOTE: the derivatives of the state variables
-            // are at the end of the decomposition vector.
-            for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-                diff_arr.push_back(
-                    taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, cur_order, batch_size));
+        std::uint32_t next = 0;
+        if (fwd) {
+            if (lo == n_knots - 1u) {
+                continue;
             }
 
-            // Now the other u variables.
-            for (auto i = n_eq; i < n_uvars; ++i) {
-                diff_arr.push_back(taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars,
-                                                  cur_order, i, batch_size));
+            next = lo;
+        } else {
+            if (lo < n_knots - 1u && knot(lo) == t.hi) {
+                at_knot = true;
+            }
+
+            if (lo == 1u) {
+                continue;
             }
+
+            next = lo - 1u;
         }
 
-        // Compute the last-order derivatives for the state variables.
-        for (auto i = n_uvars; i < boost::numeric_cast<std::uint32_t>(dc.size()); ++i) {
-            diff_arr.push_back(
-                taylor_compute_sv_diff<T>(s, dc[i].first, diff_arr, par_ptr, n_uvars, order, batch_size));
+        const auto dt = static_cast<T>(knot(next) - t);
+        if (abs(dt) < abs(max_delta_t)) {
+            max_delta_t = dt;
         }
+    }
 
-        // If there are sv funcs, we need to compute their last-order derivatives too:
-        // we will need to compute the derivatives of the u variables up to
-        // the maximum index in sv_funcs_dc.
-        const auto max_svf_idx
-            = sv_funcs_dc.empty() ? std::uint32_t(0) : *std::max_element(sv_funcs_dc.begin(), sv_funcs_dc.end());
+    return max_delta_t;
+}
 
-        // NOTE: if there are no sv_funcs, max_svf_idx is set to zero
-        // above, thus we never enter the loop.
-        // NOTE: <= because max_svf_idx is an index, not a size.
-        for (std::uint32_t i = n_eq; i <= max_svf_idx; ++i) {
-            diff_arr.push_back(taylor_diff<T>(s, dc[i].first, dc[i].second, diff_arr, par_ptr, time_ptr, n_uvars, order,
-                                              i, batch_size));
-        }
+// Helper to move the high part of a double-length time 1 ulp
+// backward, without changing the value of the time.
+// NOTE: at a knot, the compiled code of the piecewise polynomials of time
+// selects the segment to the right of the knot. This is used before a backward
+// timestep starting at a knot, so that the segment to the left is selected instead.
+// The time seen by the Taylor derivatives is perturbed by 1 ulp, which is
+// the same order of magnitude as the truncation of the low part of the time.
+template <typename T>
+void taylor_tpw_nudge(T &hi, T &lo)
+{
+    using std::nextafter;
 
-#if !defined(NDEBUG)
-        if (sv_funcs_dc.empty()) {
-            assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(n_uvars) * order + n_eq);
-        } else {
-            // NOTE: we use std::max<std::uint32_t>(n_eq, max_svf_idx + 1u) here because
-            // the sv funcs could all be aliases of the state variables themselves,
-            // in which case in the previous loop we ended up appending nothing.
-            assert(diff_arr.size()
-                   == static_cast<decltype(diff_arr.size())>(n_uvars) * order
-                          + std::max<std::uint32_t>(n_eq, max_svf_idx + 1u));
-        }
-#endif
+    const auto new_hi = nextafter(hi, -std::numeric_limits<T>::infinity());
+    lo += hi - new_hi;
+    hi = new_hi;
+}
 
-        // Extract the derivatives of the state variables and sv_funcs from diff_arr.
-        std::vector<llvm::Value *> retval;
-        for (std::uint32_t o = 0; o <= order; ++o) {
-            for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
-                retval.push_back(taylor_fetch_diff(diff_arr, var_idx, o, n_uvars));
-            }
-            for (auto idx : sv_funcs_dc) {
-                retval.push_back(taylor_fetch_diff(diff_arr, idx, o, n_uvars));
-            }
+// Comparator for the ordering of the detected events: by absolute
+// value of the time coordinate, with the ties broken by event index.
+struct taylor_ev_cmp {
+    template <typename Ev>
+    bool operator()(const Ev &ev0, const Ev &ev1) const
+    {
+        using std::abs;
+
+        const auto t0 = abs(std::get<1>(ev0)), t1 = abs(std::get<1>(ev1));
+
+        if (t0 != t1) {
+            return t0 < t1;
         }
 
-        return retval;
+        return std::get<0>(ev0) < std::get<0>(ev1);
+    }
+};
+
+} // namespace
+
+// Implementation detail to make a single integration timestep.
+// The magnitude of the timestep is automatically deduced, but it will
+// always be not greater than abs(max_delta_t). The propagation
+// is done forward in time if max_delta_t >= 0, backwards in
+// time otherwise.
+//
+// The function will return a pair, containing
+// a flag describing the outcome of the integration,
+// and the integration timestep that was used.
+template <typename T>
+typename taylor_adaptive_impl<T>::raw_step_f_t taylor_adaptive_impl<T>::get_raw_step()
+{
+    if (!m_fused_step) {
+        throw std::invalid_argument("The raw stepper is available only if the adaptive Taylor integrator was "
+                                    "constructed with the fused stepper (kw::fused_step)");
+    }
+
+    // NOTE: wait for the background compilation, if any, so that
+    // the returned pointer is not invalidated by swap_bg_llvm().
+    if (m_bg_llvm.valid()) {
+        m_bg_llvm.wait();
+        swap_bg_llvm();
     }
+
+    assert(m_step_f.index() == 2u);
+
+    return std::get<2>(m_step_f);
 }
 
-// Helper to generate the LLVM code to store the Taylor coefficients of the state variables and
-// the sv funcs into an external array. The Taylor polynomials are stored in row-major order,
-// first the state variables and after the sv funcs. For use in the adaptive timestepper implementations.
-void taylor_write_tc(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_variant,
-                     const std::vector<std::uint32_t> &sv_funcs_dc, llvm::Value *svf_ptr, llvm::Value *tc_ptr,
-                     std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size)
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl(T max_delta_t, bool wtc)
 {
-    assert(batch_size != 0u);
+    using std::isfinite;
+
 #if !defined(NDEBUG)
-    if (diff_variant.index() == 0u) {
-        // Compact mode.
-        assert(sv_funcs_dc.empty() == !svf_ptr);
-    } else {
-        // Non-compact mode.
-        assert(svf_ptr == nullptr);
-    }
+    // NOTE: this is the only precondition on max_delta_t.
+    using std::isnan;
+    assert(!isnan(max_delta_t));
 #endif
 
-    auto &builder = s.builder();
+    // Switch to the optimised code, if the
+    // background compilation has completed.
+    if (m_bg_llvm.valid() && m_bg_llvm.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        swap_bg_llvm();
+    }
 
-    // Convert to std::uint32_t for overflow checking and use below.
-    const auto n_sv_funcs = boost::numeric_cast<std::uint32_t>(sv_funcs_dc.size());
+    // Use the specialised stepper, if possible.
+    const auto &step_f = get_pars_specialised() ? m_spec_step_f : m_step_f;
 
-    // Overflow checking: ensure we can index into
-    // tc_ptr using std::uint32_t.
-    // NOTE: this is the same check done in taylor_add_jet_impl().
-    // LCOV_EXCL_START
-    if (order == std::numeric_limits<std::uint32_t>::max()
-        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
-        || n_eq > std::numeric_limits<std::uint32_t>::max() - n_sv_funcs
-        || n_eq + n_sv_funcs > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
-        throw std::overflow_error("An overflow condition was detected while generating the code for writing the Taylor "
-                                  "polynomials of an ODE system into the output array");
+    // Limit the timestep at the knots of the piecewise polynomials of time.
+    // NOTE: a timestep limited at a knot results in time_limit, as
+    // a timestep limited by max_delta_t.
+    if (!m_tpw_knots.empty()) {
+        bool at_knot = false;
+        max_delta_t = taylor_tpw_clamp(m_tpw_knots, m_pars, 1, 0, m_time, max_delta_t, at_knot);
+
+        if (at_knot) {
+            taylor_tpw_nudge(m_time.hi, m_time.lo);
+        }
     }
-    // LCOV_EXCL_STOP
 
-    if (diff_variant.index() == 0u) {
-        // Compact mode.
+    auto h = max_delta_t;
 
-        auto *diff_arr = std::get<llvm::Value *>(diff_variant);
+    if (m_perf_enabled) {
+        ++m_perf.n_steps;
+    }
 
-        // Write out the Taylor coefficients for the state variables.
-        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var) {
-            llvm_loop_u32(s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
-                          [&](llvm::Value *cur_order) {
-                              // Load the value of the derivative from diff_arr.
-                              auto *diff_val = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var);
+    if (step_f.index() == 2u) {
+        assert(m_tes.empty() && m_ntes.empty());
 
-                              // Compute the index in the output pointer.
-                              auto *out_idx = builder.CreateAdd(
-                                  builder.CreateMul(builder.getInt32((order + 1u) * batch_size), cur_var),
-                                  builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+        // Invoke the fused stepper, which also updates the time,
+        // checks for non-finite values and classifies the outcome.
+        std::int32_t flag = 0;
+        const auto step_start = taylor_perf_now(m_perf_enabled);
+        std::get<2>(step_f)(m_state.data(), m_pars.data(), &m_time.hi, &m_time.lo, &h,
+                            wtc ? m_tc.data() : nullptr, &flag);
+        if (m_perf_enabled) {
+            taylor_perf_add_time(m_perf.stepper_time, step_start);
+        }
 
-                              // Store into tc_ptr.
-                              store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val);
-                          });
-        });
+        // Store the last timestep.
+        m_last_h = h;
 
-        // Write out the Taylor coefficients for the sv funcs, if necessary.
-        if (svf_ptr != nullptr) {
-            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_sv_funcs), [&](llvm::Value *arr_idx) {
-                // Fetch the u var index from svf_ptr.
-                auto *cur_idx = builder.CreateLoad(builder.CreateInBoundsGEP(svf_ptr, {arr_idx}));
+        if (flag == taylor_step_flag_nf) {
+            if (m_perf_enabled) {
+                ++m_perf.n_nf_steps;
+            }
 
-                llvm_loop_u32(
-                    s, builder.getInt32(0), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
-                    [&](llvm::Value *cur_order) {
-                        // Load the derivative value from diff_arr.
-                        auto *diff_val = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_idx);
+            return std::tuple{taylor_outcome::err_nf_state, h};
+        }
 
-                        // Compute the index in the output pointer.
-                        auto *out_idx
-                            = builder.CreateAdd(builder.CreateMul(builder.getInt32((order + 1u) * batch_size),
-                                                                  builder.CreateAdd(builder.getInt32(n_eq), arr_idx)),
-                                                builder.CreateMul(cur_order, builder.getInt32(batch_size)));
+        if (flag == taylor_step_flag_tl) {
+            if (m_perf_enabled) {
+                ++m_perf.n_limited_steps;
+            }
 
-                        // Store into tc_ptr.
-                        store_vector_to_memory(builder, builder.CreateInBoundsGEP(tc_ptr, {out_idx}), diff_val);
-                    });
-            });
+            return std::tuple{taylor_outcome::time_limit, h};
         }
-    } else {
-        // Non-compact mode.
 
-        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_variant);
+        return std::tuple{taylor_outcome::success, h};
+    } else if (step_f.index() == 0u) {
+        assert(m_tes.empty() && m_ntes.empty());
 
-        for (std::uint32_t j = 0; j < n_eq; ++j) {
-            for (decltype(diff_arr.size()) cur_order = 0; cur_order <= order; ++cur_order) {
-                // Index in the jet of derivatives.
-                // NOTE: in non-compact mode, diff_arr contains the derivatives only of the
-                // state variables and sv_variable (not all u vars), hence the indexing
-                // is cur_order * (n_eq + n_sv_funcs) + j.
-                const auto arr_idx = cur_order * (n_eq + n_sv_funcs) + j;
-                assert(arr_idx < diff_arr.size());
-                auto *const val = diff_arr[arr_idx];
+        // In variable-order mode, select the order of the timestep.
+        const auto vo_mode = !m_vo_step_f.empty();
+        const auto vo_idx = vo_mode ? vo_select() : std::size_t(0);
+        const auto use_vo = vo_mode && vo_idx < m_vo_step_f.size();
 
-                // Index in tc_ptr.
-                const auto out_idx = (order + 1u) * batch_size * j + cur_order * batch_size;
+        // Invoke the vanilla stepper.
+        const auto step_start = taylor_perf_now(m_perf_enabled);
+        if (use_vo) {
+            m_vo_step_f[vo_idx](m_state.data(), m_pars.data(), &m_time.hi, &h, wtc ? m_vo_tc.data() : nullptr);
+        } else {
+            std::get<0>(step_f)(m_state.data(), m_pars.data(), &m_time.hi, &h, wtc ? m_tc.data() : nullptr);
+        }
+        if (m_perf_enabled) {
+            taylor_perf_add_time(m_perf.stepper_time, step_start);
+        }
 
-                // Write to tc_ptr.
-                auto *out_ptr
-                    = builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(static_cast<std::uint32_t>(out_idx))});
-                store_vector_to_memory(builder, out_ptr, val);
+        if (vo_mode) {
+            using std::abs;
+
+            m_vo_idx = vo_idx;
+
+            // NOTE: the timesteps clamped by max_delta_t do
+            // not say anything about the cost of the order.
+            if (h != max_delta_t && isfinite(h)) {
+                m_vo_last_h[vo_idx] = abs(h);
+            }
+
+            // Pad the Taylor coefficients of the lower order
+            // with zeroes up to the order of the integrator.
+            if (use_vo && wtc) {
+                const auto vo_order = m_vo_orders[vo_idx];
+
+                for (std::uint32_t i = 0; i < m_dim; ++i) {
+                    const auto src = m_vo_tc.begin() + static_cast<std::ptrdiff_t>(i) * (vo_order + 1u);
+                    const auto dst = m_tc.begin() + static_cast<std::ptrdiff_t>(i) * (m_order + 1u);
+
+                    std::copy(src, src + (vo_order + 1u), dst);
+                    std::fill(dst + (vo_order + 1u), dst + (m_order + 1u), T(0));
+                }
             }
         }
 
-        for (std::uint32_t j = 0; j < n_sv_funcs; ++j) {
-            for (decltype(diff_arr.size()) cur_order = 0; cur_order <= order; ++cur_order) {
-                // Index in the jet of derivatives.
-                const auto arr_idx = cur_order * (n_eq + n_sv_funcs) + n_eq + j;
-                assert(arr_idx < diff_arr.size());
-                auto *const val = diff_arr[arr_idx];
+        // Update the time.
+        m_time += h;
 
-                // Index in tc_ptr.
-                const auto out_idx = (order + 1u) * batch_size * (n_eq + j) + cur_order * batch_size;
+        // Store the last timestep.
+        m_last_h = h;
 
-                // Write to tc_ptr.
-                auto *out_ptr
-                    = builder.CreateInBoundsGEP(tc_ptr, {builder.getInt32(static_cast<std::uint32_t>(out_idx))});
-                store_vector_to_memory(builder, out_ptr, val);
+        // Check if the time or the state vector are non-finite at the
+        // end of the timestep.
+        if (!isfinite(m_time)
+            || std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !isfinite(x); })) {
+            if (m_perf_enabled) {
+                ++m_perf.n_nf_steps;
             }
+
+            return std::tuple{taylor_outcome::err_nf_state, h};
         }
-    }
-}
 
-// Add to s an adaptive timestepper function with support for events. This timestepper will *not*
-// propagate the state of the system. Instead, its output will be the jet of derivatives
-// of all state variables and event equations, and the deduced timestep value(s).
-template <typename T, typename U>
-auto taylor_add_adaptive_step_with_events(llvm_state &s, const std::string &name, U sys, T tol,
-                                          std::uint32_t batch_size, bool, bool compact_mode,
-                                          std::vector<expression> ntes)
-{
-    using std::isfinite;
+        if (h == max_delta_t) {
+            if (m_perf_enabled) {
+                ++m_perf.n_limited_steps;
+            }
+
+            return std::tuple{taylor_outcome::time_limit, h};
+        }
+
+        return std::tuple{taylor_outcome::success, h};
+    } else {
+        assert(!m_tes.empty() || !m_ntes.empty());
+
+        using std::abs;
+
+        // Fetch the buffer for the jet of derivatives.
+        auto &ev_jet = m_thread_scratch ? taylor_scratch_ev_jet<T>(ev_jet_size()) : m_ev_jet;
+
+        // Invoke the stepper for event handling.
+        const auto step_start = taylor_perf_now(m_perf_enabled);
+        std::get<1>(step_f)(ev_jet.data(), m_state.data(), m_pars.data(), &m_time.hi, &h);
+        if (m_ev_jet_f != nullptr) {
+            m_ev_jet_f(ev_jet.data(), m_pars.data(), &m_time.hi);
+        }
+        if (m_perf_enabled) {
+            taylor_perf_add_time(m_perf.stepper_time, step_start);
+        }
+
+        // NOTE: the tcs of the state variables are copied
+        // from m_ev_jet only when needed (see sync_tc()).
+        // In scratch mode, they are copied out below.
+        m_tc_pending = !m_thread_scratch;
+
+        // Do the event detection.
+        // NOTE: the difference between the arena counters before and
+        // after event detection gives the hits/misses for this timestep.
+        const auto ed_start = taylor_perf_now(m_perf_enabled);
+        const auto n_hits_start = m_ed_data.n_hits, n_misses_start = m_ed_data.n_misses;
+        m_ed_data.parallel = m_par_ed;
+        taylor_detect_events<T>(m_d_tes, m_d_ntes, m_tes, m_ntes, m_te_cooldowns, h, ev_jet, m_order, m_dim,
+                                m_ed_data);
+        if (m_perf_enabled) {
+            taylor_perf_add_time(m_perf.ed_time, ed_start);
+
+            m_perf.n_poly_cache_hits += m_ed_data.n_hits - n_hits_start;
+            m_perf.n_poly_cache_misses += m_ed_data.n_misses - n_misses_start;
+        }
 
-    assert(!s.is_compiled());
-    assert(batch_size != 0u);
-    assert(isfinite(tol) && tol > 0);
+        // Prepare the buffers for the sorting of the non-terminal events.
+        const auto n_d_ntes = m_d_ntes.size();
+        m_d_ntes_key.resize(n_d_ntes);
+        m_d_ntes_perm.resize(n_d_ntes);
+        m_d_ntes_idx.resize(n_d_ntes);
+        m_d_ntes_time.resize(n_d_ntes);
+        m_d_ntes_sgn.resize(n_d_ntes);
 
-    // Determine the order from the tolerance.
-    const auto order = taylor_order_from_tol(tol);
+        // NOTE: before this point, we did not alter
+        // any user-visible data in the integrator (just
+        // temporary memory). From here until we start invoking
+        // the callbacks, everything is noexcept, so we don't
+        // risk leaving the integrator in a half-baked state.
 
-    // Record the number of equations/variables.
-    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+        // Sort the events by time.
+        // NOTE: the time coordinates in m_d_(n)tes is relative
+        // to the beginning of the timestep. It will be negative
+        // for backward integration, thus we compare using
+        // abs() so that the first events are those which
+        // happen closer to the beginning of the timestep.
+        // NOTE: the checks inside taylor_detect_events() ensure
+        // that we can safely sort the events' times.
+        // NOTE: only the first terminal event is needed, thus
+        // we just move it to the front. The non-terminal events
+        // are sorted indirectly, via a permutation on a contiguous
+        // array of keys, and then gathered into the SoA buffers.
+        // NOTE: the ties are broken by event index, so that the
+        // ordering is a total order which does not depend on the order
+        // in which the events were detected (e.g., on the splitting
+        // of the work in parallel event detection). This guarantees
+        // bitwise reproducible integrations regardless of the number
+        // of threads.
+        if (!m_d_tes.empty()) {
+            std::iter_swap(m_d_tes.begin(),
+                           std::min_element(m_d_tes.begin(), m_d_tes.end(), taylor_ev_cmp{}));
+        }
+        for (decltype(m_d_ntes.size()) i = 0; i < n_d_ntes; ++i) {
+            m_d_ntes_key[i] = abs(std::get<1>(m_d_ntes[i]));
+            m_d_ntes_perm[i] = static_cast<std::uint32_t>(i);
+        }
+        std::sort(m_d_ntes_perm.begin(), m_d_ntes_perm.end(), [this](std::uint32_t a, std::uint32_t b) {
+            if (m_d_ntes_key[a] != m_d_ntes_key[b]) {
+                return m_d_ntes_key[a] < m_d_ntes_key[b];
+            }
 
-    // Decompose the system of equations.
-    auto [dc, ev_dc] = taylor_decompose(std::move(sys), std::move(ntes));
+            return std::get<0>(m_d_ntes[a]) < std::get<0>(m_d_ntes[b]);
+        });
 
-    // Compute the number of u variables.
-    assert(dc.size() > n_eq);
-    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+        // Store the timestep that was used during event
+        // detection, before possibly modifying it.
+        const auto orig_h = h;
 
-    auto &builder = s.builder();
-    auto &context = s.context();
+        // If we have terminal events we need
+        // to update the value of h.
+        if (!m_d_tes.empty()) {
+            h = std::get<1>(m_d_tes[0]);
+        }
 
-    // Prepare the function prototype. The arguments are:
-    // - pointer to the output jet of derivative (write only),
-    // - pointer to the current state vector (read only),
-    // - pointer to the parameters (read only),
-    // - pointer to the time value(s) (read only),
-    // - pointer to the array of max timesteps (read & write).
-    // These pointers cannot overlap.
-    std::vector<llvm::Type *> fargs(5, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
-    // The function does not return anything.
-    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
-    assert(ft != nullptr);
-    // Now create the function.
-    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
-    if (f == nullptr) {
-        throw std::invalid_argument(
-            "Unable to create a function for an adaptive Taylor stepper with name '{}'"_format(name));
-    }
+        // If we don't have terminal events, we will invoke the callbacks
+        // of *all* the non-terminal events. Otherwise, we need to figure
+        // out which non-terminal events do not happen because their time
+        // coordinate is past the the first terminal event.
+        auto key_cmp = [this](std::uint32_t j, const T &t) { return m_d_ntes_key[j] < t; };
+        const auto n_ntes
+            = m_d_tes.empty() ? n_d_ntes
+                              : static_cast<decltype(m_d_ntes.size())>(
+                                  std::lower_bound(m_d_ntes_perm.begin(), m_d_ntes_perm.end(), abs(h), key_cmp)
+                                  - m_d_ntes_perm.begin());
+
+        // Gather the non-terminal events which
+        // happen in the timestep into the SoA buffers.
+        for (decltype(m_d_ntes.size()) i = 0; i < n_ntes; ++i) {
+            const auto &ev = m_d_ntes[m_d_ntes_perm[i]];
+            m_d_ntes_idx[i] = std::get<0>(ev);
+            m_d_ntes_time[i] = std::get<1>(ev);
+            m_d_ntes_sgn[i] = std::get<2>(ev);
+        }
+        // NOTE: shrinking does not allocate.
+        m_d_ntes_idx.resize(n_ntes);
+        m_d_ntes_time.resize(n_ntes);
+        m_d_ntes_sgn.resize(n_ntes);
 
-    // Set the names/attributes of the function arguments.
-    auto *jet_ptr = f->args().begin();
-    jet_ptr->setName("jet_ptr");
-    jet_ptr->addAttr(llvm::Attribute::NoCapture);
-    jet_ptr->addAttr(llvm::Attribute::NoAlias);
-    jet_ptr->addAttr(llvm::Attribute::WriteOnly);
+        // Update the state.
+        m_d_out_f(m_state.data(), ev_jet.data(), &h);
 
-    auto *state_ptr = jet_ptr + 1;
-    state_ptr->setName("state_ptr");
-    state_ptr->addAttr(llvm::Attribute::NoCapture);
-    state_ptr->addAttr(llvm::Attribute::NoAlias);
-    state_ptr->addAttr(llvm::Attribute::ReadOnly);
+        // In scratch mode, copy out the tcs of the state
+        // variables before the buffer can be reused.
+        if (m_thread_scratch) {
+            std::copy(ev_jet.data(), ev_jet.data() + m_tc.size(), m_tc.data());
+        }
 
-    auto *par_ptr = state_ptr + 1;
-    par_ptr->setName("par_ptr");
-    par_ptr->addAttr(llvm::Attribute::NoCapture);
-    par_ptr->addAttr(llvm::Attribute::NoAlias);
-    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+        // Update the time.
+        m_time += h;
 
-    auto *time_ptr = par_ptr + 1;
-    time_ptr->setName("time_ptr");
-    time_ptr->addAttr(llvm::Attribute::NoCapture);
-    time_ptr->addAttr(llvm::Attribute::NoAlias);
-    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+        // Store the last timestep.
+        m_last_h = h;
 
-    auto *h_ptr = time_ptr + 1;
-    h_ptr->setName("h_ptr");
-    h_ptr->addAttr(llvm::Attribute::NoCapture);
-    h_ptr->addAttr(llvm::Attribute::NoAlias);
+        // Transform the trigger times of the non-terminal
+        // events into absolute times.
+        for (auto &t : m_d_ntes_time) {
+            t = static_cast<T>(m_time - m_last_h + t);
+        }
 
-    // Create a new basic block to start insertion into.
-    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
-    assert(bb != nullptr);
-    builder.SetInsertPoint(bb);
+        // Check if the time or the state vector are non-finite at the
+        // end of the timestep.
+        if (!isfinite(m_time)
+            || std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !isfinite(x); })) {
+            // Let's also reset the cooldown values, as at this point
+            // they have become useless.
+            reset_cooldowns();
 
-    // Create a global read-only array containing the values in ev_dc, if there
-    // are any and we are in compact mode (otherwise, svf_ptr will be null).
-    auto *svf_ptr = compact_mode ? taylor_c_make_sv_funcs_arr(s, ev_dc) : nullptr;
+            if (m_perf_enabled) {
+                ++m_perf.n_nf_steps;
+            }
 
-    // Compute the jet of derivatives at the given order.
-    auto diff_variant = taylor_compute_jet<T>(s, state_ptr, par_ptr, time_ptr, dc, ev_dc, n_eq, n_uvars, order,
-                                              batch_size, compact_mode);
+            return std::tuple{taylor_outcome::err_nf_state, h};
+        }
 
-    // Determine the integration timestep.
-    auto h = taylor_determine_h<T>(s, diff_variant, ev_dc, svf_ptr, h_ptr, n_eq, n_uvars, order, batch_size);
+        // Update the cooldowns.
+        for (auto &cd : m_te_cooldowns) {
+            if (cd) {
+                // Check if the timestep we just took
+                // brought this event outside the cooldown.
+                auto tmp = cd->first + h;
 
-    // Store h to memory.
-    store_vector_to_memory(builder, h_ptr, h);
+                if (abs(tmp) >= cd->second) {
+                    // We are now outside the cooldown period
+                    // for this event, reset cd.
+                    cd.reset();
+                } else {
+                    // Still in cooldown, update the
+                    // time spent in cooldown.
+                    cd->first = tmp;
+                }
+            }
+        }
 
-    // Copy the jet of derivatives to jet_ptr.
-    taylor_write_tc(s, diff_variant, ev_dc, svf_ptr, jet_ptr, n_eq, n_uvars, order, batch_size);
+        // Invoke the callbacks of the non-terminal events, which are guaranteed
+        // to happen before the first terminal event.
+        const auto cb_start = taylor_perf_now(m_perf_enabled);
+        if (m_nt_buf != nullptr) {
+            // NOTE: if a buffer was provided, accumulate
+            // the events into it instead of invoking the callbacks.
+            for (decltype(m_d_ntes.size()) i = 0; i < n_ntes; ++i) {
+                m_nt_buf->emplace_back(m_d_ntes_idx[i], m_d_ntes_time[i], m_d_ntes_sgn[i]);
+            }
+        } else if (m_nt_batch_cb) {
+            if (n_ntes > 0) {
+                // NOTE: with the batched callback, pass all the non-terminal
+                // events happening before the first terminal event at once.
+                // The list is rebuilt in m_d_ntes, whose capacity is
+                // already large enough.
+                m_d_ntes.clear();
+                for (decltype(m_d_ntes.size()) i = 0; i < n_ntes; ++i) {
+                    m_d_ntes.emplace_back(m_d_ntes_idx[i], m_d_ntes_time[i], m_d_ntes_sgn[i]);
+                }
 
-    // Create the return value.
-    builder.CreateRetVoid();
+                m_nt_batch_cb(*this, m_d_ntes);
+            }
+        } else {
+            for (decltype(m_d_ntes.size()) i = 0; i < n_ntes; ++i) {
+                const auto &cb = m_ntes[m_d_ntes_idx[i]].get_callback();
+                assert(cb);
+                cb(*this, m_d_ntes_time[i], m_d_ntes_sgn[i]);
+            }
+        }
+        if (m_perf_enabled) {
+            m_perf.n_nt_events += static_cast<std::uint64_t>(n_ntes);
+        }
 
-    // Verify the function.
-    s.verify_function(f);
+        // The return value of the first
+        // terminal event's callback. It will be
+        // unused if there are no terminal events.
+        bool te_cb_ret = false;
 
-    // Run the optimisation pass.
-    s.optimise();
+        if (!m_d_tes.empty()) {
+            // Fetch the first terminal event.
+            const auto te_idx = std::get<0>(m_d_tes[0]);
+            assert(te_idx < m_tes.size());
+            const auto &te = m_tes[te_idx];
 
-    return std::tuple{std::move(dc), order};
-}
+            // Set the corresponding cooldown.
+            if (te.get_cooldown() >= 0) {
+                // Cooldown explicitly provided by the user, use it.
+                m_te_cooldowns[te_idx].emplace(0, te.get_cooldown());
+            } else {
+                // Deduce the cooldown automatically.
+                // NOTE: the automatic cooldown deduction is done on the
+                // timestep that was used for event detection, not on the timestep
+                // which was clamped by the occurrence of a terminal event.
+                m_te_cooldowns[te_idx].emplace(0, taylor_deduce_cooldown(orig_h));
+            }
 
-// Small helper to deduce the number of parameters
-// present in the rhs of an ODE.
-template <typename T>
-std::uint32_t n_pars_in_sys(const T &sys)
-{
-    std::uint32_t retval = 0;
+            // Invoke the callback of the first terminal event, if it has one.
+            if (te.get_callback()) {
+                te_cb_ret = te.get_callback()(*this, std::get<2>(m_d_tes[0]), std::get<3>(m_d_tes[0]));
+            }
+        }
 
-    for (const auto &p : sys) {
-        if constexpr (std::is_same_v<uncvref_t<decltype(p)>, expression>) {
-            retval = std::max(retval, get_param_size(p));
+        if (m_perf_enabled) {
+            taylor_perf_add_time(m_perf.cb_time, cb_start);
+
+            m_perf.n_t_events += static_cast<std::uint64_t>(!m_d_tes.empty());
+            m_perf.n_limited_steps += static_cast<std::uint64_t>(m_d_tes.empty() && h == max_delta_t);
+        }
+
+        if (m_d_tes.empty()) {
+            // No terminal events detected, return success or time limit.
+            return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
         } else {
-            retval = std::max(retval, get_param_size(p.second));
+            // Terminal event detected. Fetch its index.
+            const auto ev_idx = static_cast<std::int64_t>(std::get<0>(m_d_tes[0]));
+
+            // NOTE: if te_cb_ret is true, it means that the terminal event has
+            // a callback and its invocation returned true (meaning that the
+            // integration should continue). Otherwise, either the terminal event
+            // has no callback or its callback returned false, meaning that the
+            // integration must stop.
+            return std::tuple{taylor_outcome{te_cb_ret ? ev_idx : (-ev_idx - 1)}, h};
         }
     }
-
-    return retval;
 }
 
-// Run the Horner scheme to propagate an ODE state via the evaluation of the Taylor polynomials.
-// diff_var contains either the derivatives for all u variables (in compact mode) or only
-// for the state variables (non-compact mode). The evaluation point (i.e., the timestep)
-// is h. The evaluation is run in parallel over the polynomials of all the state
-// variables.
-std::variant<llvm::Value *, std::vector<llvm::Value *>>
-taylor_run_multihorner(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var,
-                       llvm::Value *h, std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t,
-                       bool compact_mode)
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(bool wtc)
 {
-    auto &builder = s.builder();
-
-    if (compact_mode) {
-        // Compact mode.
-        auto *diff_arr = std::get<llvm::Value *>(diff_var);
-
-        // Create the array storing the results of the evaluation.
-        auto *array_type = llvm::ArrayType::get(pointee_type(diff_arr), n_eq);
-        auto *res_arr
-            = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
-
-        // Init the return value, filling it with the values of the
-        // coefficients of the highest-degree monomial in each polynomial.
-        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-            // Load the value from diff_arr and store it in res_arr.
-            builder.CreateStore(taylor_c_load_diff(s, diff_arr, n_uvars, builder.getInt32(order), cur_var_idx),
-                                builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
-        });
+    // NOTE: time limit +inf means integration forward in time
+    // and no time limit.
+    return step_impl(std::numeric_limits<T>::infinity(), wtc);
+}
 
-        // Run the evaluation.
-        llvm_loop_u32(s, builder.getInt32(1), builder.CreateAdd(builder.getInt32(order), builder.getInt32(1)),
-                      [&](llvm::Value *cur_order) {
-                          llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-                              // Load the current poly coeff from diff_arr.
-                              // NOTE: we are loading the coefficients backwards wrt the order, hence
-                              // we specify order - cur_order.
-                              auto *cf = taylor_c_load_diff(s, diff_arr, n_uvars,
-                                                            builder.CreateSub(builder.getInt32(order), cur_order),
-                                                            cur_var_idx);
-
-                              // Accumulate in res_arr.
-                              auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
-                              builder.CreateStore(
-                                  builder.CreateFAdd(cf, builder.CreateFMul(builder.CreateLoad(res_ptr), h)), res_ptr);
-                          });
-                      });
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_backward(bool wtc)
+{
+    return step_impl(-std::numeric_limits<T>::infinity(), wtc);
+}
 
-        return res_arr;
-    } else {
-        // Non-compact mode.
-        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
+template <typename T>
+std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(T max_delta_t, bool wtc)
+{
+    using std::isnan;
 
-        // Init the return value, filling it with the values of the
-        // coefficients of the highest-degree monomial in each polynomial.
-        std::vector<llvm::Value *> res_arr;
-        for (std::uint32_t i = 0; i < n_eq; ++i) {
-            res_arr.push_back(diff_arr[(n_eq * order) + i]);
-        }
+    if (isnan(max_delta_t)) {
+        throw std::invalid_argument(
+            "A NaN max_delta_t was passed to the step() function of an adaptive Taylor integrator");
+    }
 
-        // Run the Horner scheme simultaneously for all polynomials.
-        for (std::uint32_t i = 1; i <= order; ++i) {
-            for (std::uint32_t j = 0; j < n_eq; ++j) {
-                res_arr[j] = builder.CreateFAdd(diff_arr[(order - i) * n_eq + j], builder.CreateFMul(res_arr[j], h));
-            }
-        }
+    return step_impl(max_delta_t, wtc);
+}
 
-        return res_arr;
+// Reset all cooldowns for the terminal events.
+template <typename T>
+void taylor_adaptive_impl<T>::reset_cooldowns()
+{
+    for (auto &cd : m_te_cooldowns) {
+        cd.reset();
     }
 }
 
-// Same as taylor_run_multihorner(), but instead of the Horner scheme this implementation uses
-// a compensated summation over the naive evaluation of monomials.
+// Invoke the callback of a propagate_*() function,
+// accounting for the time spent in it.
 template <typename T>
-std::variant<llvm::Value *, std::vector<llvm::Value *>>
-taylor_run_ceval(llvm_state &s, const std::variant<llvm::Value *, std::vector<llvm::Value *>> &diff_var, llvm::Value *h,
-                 std::uint32_t n_eq, std::uint32_t n_uvars, std::uint32_t order, std::uint32_t batch_size, bool,
-                 bool compact_mode)
+bool taylor_adaptive_impl<T>::invoke_propagate_cb(const propagate_cb_t &cb)
 {
-    auto &builder = s.builder();
+    assert(cb);
 
-    if (compact_mode) {
-        // Compact mode.
-        auto *diff_arr = std::get<llvm::Value *>(diff_var);
+    const auto cb_start = taylor_perf_now(m_perf_enabled);
+    const auto ret = cb(*this);
+    if (m_perf_enabled) {
+        taylor_perf_add_time(m_perf.cb_time, cb_start);
+    }
 
-        // Create the arrays storing the results of the evaluation and the running compensations.
-        auto *array_type = llvm::ArrayType::get(pointee_type(diff_arr), n_eq);
-        auto *res_arr
-            = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
-        auto *comp_arr
-            = builder.CreateInBoundsGEP(builder.CreateAlloca(array_type), {builder.getInt32(0), builder.getInt32(0)});
+    return ret;
+}
 
-        // Init res_arr with the order-0 coefficients, and the running
-        // compensations with zero.
-        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-            // Load the value from diff_arr.
-            auto *val = builder.CreateLoad(builder.CreateInBoundsGEP(diff_arr, {cur_var_idx}));
+template <typename T>
+taylor_memory_usage taylor_adaptive_impl<T>::get_memory_usage() const
+{
+    taylor_memory_usage retval;
 
-            // Store it in res_arr.
-            builder.CreateStore(val, builder.CreateInBoundsGEP(res_arr, {cur_var_idx}));
+    retval.state = taylor_vec_mem_usage(m_state);
+    retval.pars = taylor_vec_mem_usage(m_pars) + taylor_vec_mem_usage(m_spec_pars);
+    retval.tc = taylor_vec_mem_usage(m_tc);
+    retval.d_out = taylor_vec_mem_usage(m_d_out);
+    retval.events = taylor_vec_mem_usage(m_ev_jet) + taylor_vec_mem_usage(m_d_tes) + taylor_vec_mem_usage(m_d_ntes)
+                    + taylor_vec_mem_usage(m_d_ntes_idx) + taylor_vec_mem_usage(m_d_ntes_time)
+                    + taylor_vec_mem_usage(m_d_ntes_sgn) + taylor_vec_mem_usage(m_d_ntes_key)
+                    + taylor_vec_mem_usage(m_d_ntes_perm) + taylor_vec_mem_usage(m_te_cooldowns)
+                    + taylor_ed_data_mem_usage(m_ed_data);
+    retval.other = taylor_vec_mem_usage(m_tc_enc);
+    retval.decomposition = taylor_dc_mem_usage(*m_dc);
 
-            // Zero-init the element in comp_arr.
-            builder.CreateStore(vector_splat(builder, codegen<T>(s, number{0.}), batch_size),
-                                builder.CreateInBoundsGEP(comp_arr, {cur_var_idx}));
-        });
+    taylor_add_llvm_mem_usage(retval, m_llvm.get());
+    taylor_add_llvm_mem_usage(retval, m_spec_llvm.get());
+    taylor_add_llvm_mem_usage(retval, m_fixed_llvm.get());
 
-        // Init the running updater for the powers of h.
-        auto *cur_h = builder.CreateAlloca(h->getType());
-        builder.CreateStore(h, cur_h);
+    taylor_mem_usage_finalise(retval);
 
-        // Run the evaluation.
-        llvm_loop_u32(s, builder.getInt32(1), builder.getInt32(order + 1u), [&](llvm::Value *cur_order) {
-            // Load the current power of h.
-            auto *cur_h_val = builder.CreateLoad(cur_h);
+    return retval;
+}
 
-            llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-                // Evaluate the current monomial.
-                auto *cf = taylor_c_load_diff(s, diff_arr, n_uvars, cur_order, cur_var_idx);
-                auto *tmp = builder.CreateFMul(cf, cur_h_val);
+// Dump the performance counters via the logger.
+template <typename T>
+void taylor_adaptive_impl<T>::log_perf_counters() const
+{
+    std::ostringstream oss;
+    oss << m_perf;
 
-                // Compute the quantities for the compensation.
-                auto *comp_ptr = builder.CreateInBoundsGEP(comp_arr, {cur_var_idx});
-                auto *res_ptr = builder.CreateInBoundsGEP(res_arr, {cur_var_idx});
-                auto *y = builder.CreateFSub(tmp, builder.CreateLoad(comp_ptr));
-                auto *cur_res = builder.CreateLoad(res_ptr);
-                auto *t = builder.CreateFAdd(cur_res, y);
+    get_logger()->info("performance counters of an adaptive Taylor integrator:\n{}", oss.str());
+}
 
-                // Update the compensation and the return value.
-                builder.CreateStore(builder.CreateFSub(builder.CreateFSub(t, cur_res), y), comp_ptr);
-                builder.CreateStore(t, res_ptr);
-            });
+template <typename T>
+std::tuple<taylor_outcome, T, T, std::size_t>
+taylor_adaptive_impl<T>::propagate_until_impl(const dfloat<T> &t, std::size_t max_steps, T max_delta_t,
+                                              propagate_cb_t cb, bool wtc, continuous_output_impl<T> *c_out)
+{
+    using std::abs;
+    using std::isfinite;
+    using std::isnan;
 
-            // Update the value of h.
-            builder.CreateStore(builder.CreateFMul(cur_h_val, h), cur_h);
-        });
+    trace_span span("taylor_adaptive::propagate_until", "taylor");
+    // NOTE: aggregate the hot-path warnings emitted during the propagation.
+    const warn_aggregation_scope wa_scope;
 
-        return res_arr;
-    } else {
-        // Non-compact mode.
-        const auto &diff_arr = std::get<std::vector<llvm::Value *>>(diff_var);
+    // Check the current time.
+    if (!isfinite(m_time)) {
+        throw std::invalid_argument("Cannot invoke the propagate_until() function of an adaptive Taylor integrator if "
+                                    "the current time is not finite");
+    }
 
-        // Init the return values with the order-0 monomials, and the running
-        // compensations with zero.
-        std::vector<llvm::Value *> res_arr, comp_arr;
-        for (std::uint32_t i = 0; i < n_eq; ++i) {
-            res_arr.push_back(diff_arr[i]);
-            comp_arr.push_back(vector_splat(builder, codegen<T>(s, number{0.}), batch_size));
-        }
+    // Check the final time.
+    if (!isfinite(t)) {
+        throw std::invalid_argument(
+            "A non-finite time was passed to the propagate_until() function of an adaptive Taylor integrator");
+    }
 
-        // Evaluate and sum.
-        auto *cur_h = h;
-        for (std::uint32_t i = 1; i <= order; ++i) {
-            for (std::uint32_t j = 0; j < n_eq; ++j) {
-                // Evaluate the current monomial.
-                auto *tmp = builder.CreateFMul(diff_arr[i * n_eq + j], cur_h);
+    // Check max_delta_t.
+    if (isnan(max_delta_t)) {
+        throw std::invalid_argument(
+            "A nan max_delta_t was passed to the propagate_until() function of an adaptive Taylor integrator");
+    }
+    if (max_delta_t <= 0) {
+        throw std::invalid_argument(
+            "A non-positive max_delta_t was passed to the propagate_until() function of an adaptive Taylor integrator");
+    }
 
-                // Compute the quantities for the compensation.
-                auto *y = builder.CreateFSub(tmp, comp_arr[j]);
-                auto *t = builder.CreateFAdd(res_arr[j], y);
+    if (c_out != nullptr) {
+        c_out->check_compat(*this);
 
-                // Update the compensation and the return value.
-                comp_arr[j] = builder.CreateFSub(builder.CreateFSub(t, res_arr[j]), y);
-                res_arr[j] = t;
-            }
+        // NOTE: the continuous output needs
+        // the Taylor coefficients of each step.
+        wtc = true;
+    }
 
-            // Update the power of h.
-            cur_h = builder.CreateFMul(cur_h, h);
-        }
+    // Initial values for the counters
+    // and the min/max abs of the integration
+    // timesteps.
+    // NOTE: iter_counter is for keeping track of the max_steps
+    // limits, step_counter counts the number of timesteps performed
+    // with a nonzero h. Most of the time these two quantities
+    // will be identical, apart from corner cases.
+    std::size_t iter_counter = 0, step_counter = 0;
+    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
 
-        return res_arr;
-    }
-}
+    // Init the remaining time.
+    auto rem_time = t - m_time;
 
-// NOTE: in compact mode, care must be taken when adding multiple stepper functions to the same llvm state
-// with the same floating-point type, batch size and number of u variables. The potential issue there
-// is that when the first stepper is added, the compact mode AD functions are created and then optimised.
-// The optimisation pass might alter the functions in a way that makes them incompatible with subsequent
-// uses in the second stepper (e.g., an argument might be removed from the signature because it is a
-// compile-time constant). A workaround to avoid issues is to set the optimisation level to zero
-// in the state, add the 2 steppers and then run a single optimisation pass. This is what we do
-// in the integrators' ctors.
-// NOTE: document this eventually.
-template <typename T, typename U>
-auto taylor_add_adaptive_step(llvm_state &s, const std::string &name, U sys, T tol, std::uint32_t batch_size,
-                              bool high_accuracy, bool compact_mode)
-{
-    using std::isfinite;
+    // Check it.
+    if (!isfinite(rem_time)) {
+        throw std::invalid_argument("The final time passed to the propagate_until() function of an adaptive Taylor "
+                                    "integrator results in an overflow condition");
+    }
 
-    assert(!s.is_compiled());
-    assert(batch_size > 0u);
-    assert(isfinite(tol) && tol > 0);
+    // Cache the integration direction.
+    const auto t_dir = (rem_time >= T(0));
 
-    // Determine the order from the tolerance.
-    const auto order = taylor_order_from_tol(tol);
+    // Setup the step-size collapse detector.
+    const auto hc_thr = m_hc_rel * abs(static_cast<T>(rem_time));
+    std::size_t hc_counter = 0;
+
+    // Run the whole propagation in the multi-step driver, if possible.
+    // NOTE: the driver does not record the performance counters.
+    // NOTE: the driver does not limit the timesteps at the knots
+    // of the piecewise polynomials of time.
+    // NOTE: the driver does not run the step-size collapse detector.
+    // NOTE: the driver does not monitor the invariants.
+    if (m_step_n_f != nullptr && !cb && c_out == nullptr && !m_perf_enabled && m_tpw_knots.empty() && m_hc_n == 0u
+        && m_inv_f == nullptr) {
+        // Switch to the optimised code, if the
+        // background compilation has completed.
+        if (m_bg_llvm.valid() && m_bg_llvm.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            swap_bg_llvm();
+        }
 
-    // Record the number of equations/variables.
-    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+        // Use the specialised driver, if possible.
+        const auto step_n_f = get_pars_specialised() ? m_spec_step_n_f : m_step_n_f;
 
-    // Decompose the system of equations.
-    // NOTE: no sv_funcs needed for this stepper.
-    auto [dc, sv_funcs_dc] = taylor_decompose(std::move(sys), {});
+        const std::array<T, 4> in{t.hi, t.lo, max_delta_t, t_dir ? T(1) : T(0)};
+        std::array<T, 3> out{std::numeric_limits<T>::infinity(), T(0), T(0)};
+        std::uint64_t step_counter_n = 0;
 
-    assert(sv_funcs_dc.empty());
+        const auto ret = step_n_f(m_state.data(), m_pars.data(), &m_time.hi, &m_time.lo, wtc ? m_tc.data() : nullptr,
+                                  in.data(), boost::numeric_cast<std::uint64_t>(max_steps), out.data(),
+                                  &step_counter_n);
 
-    // Compute the number of u variables.
-    assert(dc.size() > n_eq);
-    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+        m_last_h = out[2];
 
-    auto &builder = s.builder();
-    auto &context = s.context();
+        const auto oc = ret == 0 ? taylor_outcome::time_limit
+                                 : (ret == 1 ? taylor_outcome::step_limit : taylor_outcome::err_nf_state);
 
-    // Prepare the function prototype. The arguments are:
-    // - pointer to the current state vector (read & write),
-    // - pointer to the parameters (read only),
-    // - pointer to the time value(s) (read only),
-    // - pointer to the array of max timesteps (read & write),
-    // - pointer to the Taylor coefficients output (write only).
-    // These pointers cannot overlap.
-    std::vector<llvm::Type *> fargs(5, llvm::PointerType::getUnqual(to_llvm_type<T>(context)));
-    // The function does not return anything.
-    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
-    assert(ft != nullptr);
-    // Now create the function.
-    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &s.module());
-    if (f == nullptr) {
-        throw std::invalid_argument(
-            "Unable to create a function for an adaptive Taylor stepper with name '{}'"_format(name));
+        return std::tuple{oc, out[0], out[1], boost::numeric_cast<std::size_t>(step_counter_n)};
     }
 
-    // Set the names/attributes of the function arguments.
-    auto *state_ptr = f->args().begin();
-    state_ptr->setName("state_ptr");
-    state_ptr->addAttr(llvm::Attribute::NoCapture);
-    state_ptr->addAttr(llvm::Attribute::NoAlias);
-
-    auto *par_ptr = state_ptr + 1;
-    par_ptr->setName("par_ptr");
-    par_ptr->addAttr(llvm::Attribute::NoCapture);
-    par_ptr->addAttr(llvm::Attribute::NoAlias);
-    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+    while (true) {
+        // Compute the max integration times for this timestep.
+        // NOTE: rem_time is guaranteed to be finite: we check it explicitly above
+        // and we keep on decreasing its magnitude at the following iterations.
+        // If some non-finite state/time is generated in
+        // the step function, the integration will be stopped.
+        assert((rem_time >= T(0)) == t_dir);
+        const auto dt_limit
+            = t_dir ? std::min(dfloat<T>(max_delta_t), rem_time) : std::max(dfloat<T>(-max_delta_t), rem_time);
+        // NOTE: if dt_limit is zero, step_impl() will always return time_limit.
+        const auto [res, h] = step_impl(static_cast<T>(dt_limit), wtc);
 
-    auto *time_ptr = par_ptr + 1;
-    time_ptr->setName("time_ptr");
-    time_ptr->addAttr(llvm::Attribute::NoCapture);
-    time_ptr->addAttr(llvm::Attribute::NoAlias);
-    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+        // Record the step in the continuous output. We do this before checking
+        // the outcome so that the step leading to a stopping terminal
+        // event is recorded as well.
+        if (c_out != nullptr && h != 0 && res != taylor_outcome::err_nf_state) {
+            c_out->add_step(*this);
+        }
 
-    auto *h_ptr = time_ptr + 1;
-    h_ptr->setName("h_ptr");
-    h_ptr->addAttr(llvm::Attribute::NoCapture);
-    h_ptr->addAttr(llvm::Attribute::NoAlias);
+        if (res != taylor_outcome::success && res != taylor_outcome::time_limit && res < taylor_outcome{0}) {
+            // Something went wrong in the propagation of the timestep, or we reached
+            // a stopping terminal event
+            return std::tuple{res, min_h, max_h, step_counter};
+        }
 
-    auto *tc_ptr = h_ptr + 1;
-    tc_ptr->setName("tc_ptr");
-    tc_ptr->addAttr(llvm::Attribute::NoCapture);
-    tc_ptr->addAttr(llvm::Attribute::NoAlias);
-    tc_ptr->addAttr(llvm::Attribute::WriteOnly);
+        // Update the number of iterations.
+        ++iter_counter;
 
-    // Create a new basic block to start insertion into.
-    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
-    assert(bb != nullptr);
-    builder.SetInsertPoint(bb);
+        // Update the number of steps.
+        step_counter += static_cast<std::size_t>(h != 0);
 
-    // Compute the jet of derivatives at the given order.
-    auto diff_variant = taylor_compute_jet<T>(s, state_ptr, par_ptr, time_ptr, dc, {}, n_eq, n_uvars, order, batch_size,
-                                              compact_mode);
+        // Update min_h/max_h, but only if the outcome is success (otherwise
+        // the step was artificially clamped either by a time limit or
+        // by a terminal event).
+        if (res == taylor_outcome::success) {
+            const auto abs_h = abs(h);
+            min_h = std::min(min_h, abs_h);
+            max_h = std::max(max_h, abs_h);
+        }
 
-    // Determine the integration timestep.
-    auto h = taylor_determine_h<T>(s, diff_variant, sv_funcs_dc, nullptr, h_ptr, n_eq, n_uvars, order, batch_size);
+        // The step was successful, execute the callback if applicable.
+        if (cb && !invoke_propagate_cb(cb)) {
+            // Interruption via callback.
+            return std::tuple{taylor_outcome::cb_stop, min_h, max_h, step_counter};
+        }
 
-    // Evaluate the Taylor polynomials, producing the updated state of the system.
-    auto new_state_var
-        = high_accuracy
-              ? taylor_run_ceval<T>(s, diff_variant, h, n_eq, n_uvars, order, batch_size, high_accuracy, compact_mode)
-              : taylor_run_multihorner(s, diff_variant, h, n_eq, n_uvars, order, batch_size, compact_mode);
+        // Monitor the invariants, if needed.
+        if (m_inv_f != nullptr && h != 0 && ++m_inv_counter == m_inv_every) {
+            m_inv_counter = 0;
 
-    // Store the new state.
-    // NOTE: no need to perform overflow check on n_eq * batch_size,
-    // as in taylor_compute_jet() we already checked.
-    if (compact_mode) {
-        auto new_state = std::get<llvm::Value *>(new_state_var);
+            if (!eval_invariants()) {
+                // The drift of an invariant exceeded its threshold.
+                return std::tuple{taylor_outcome::cb_stop, min_h, max_h, step_counter};
+            }
+        }
 
-        llvm_loop_u32(s, builder.getInt32(0), builder.getInt32(n_eq), [&](llvm::Value *cur_var_idx) {
-            auto val = builder.CreateLoad(builder.CreateInBoundsGEP(new_state, {cur_var_idx}));
-            store_vector_to_memory(
-                builder,
-                builder.CreateInBoundsGEP(state_ptr, builder.CreateMul(cur_var_idx, builder.getInt32(batch_size))),
-                val);
-        });
-    } else {
-        const auto &new_state = std::get<std::vector<llvm::Value *>>(new_state_var);
+        // Check for a step-size collapse.
+        if (h_collapse_check(res, h, hc_thr, hc_counter)) {
+            return std::tuple{taylor_outcome::err_h_collapse, min_h, max_h, step_counter};
+        }
 
-        assert(new_state.size() == n_eq);
+        // Break out if the final time is reached,
+        // NOTE: here we check h == rem_time, instead of just
+        // res == time_limit, because clamping via max_delta_t
+        // could also result in time_limit.
+        if (h == static_cast<T>(rem_time)) {
+            assert(res == taylor_outcome::time_limit);
+            return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter};
+        }
 
-        for (std::uint32_t var_idx = 0; var_idx < n_eq; ++var_idx) {
-            store_vector_to_memory(builder,
-                                   builder.CreateInBoundsGEP(state_ptr, builder.getInt32(var_idx * batch_size)),
-                                   new_state[var_idx]);
+        // Check the iteration limit.
+        // NOTE: if max_steps is 0 (i.e., no limit on the number of steps),
+        // then this condition will never trigger as by this point we are
+        // sure iter_counter is at least 1.
+        if (iter_counter == max_steps) {
+            return std::tuple{taylor_outcome::step_limit, min_h, max_h, step_counter};
         }
-    }
 
-    // Store the timesteps that were used.
-    store_vector_to_memory(builder, h_ptr, h);
+        // Update the remaining time.
+        // NOTE: in principle, due to the fact that
+        // dt_limit is computed in extended
+        // precision but it is cast to normal precision
+        // before being added to m_time in step_impl(),
+        // there could be numerical inconsistencies
+        // at the last timestep which could result in rem_time
+        // not exactly zero or with a flipped sign.
+        // For this function, this should
+        // not matter because if static_cast<T>(rem_time) was used
+        // as an integration step, we will have already exited
+        // above before anything bad can
+        // happen. If anything smaller than static_cast<T>(rem_time)
+        // was used as timestep, rem_time should not change sign.
+        rem_time = t - m_time;
+    }
+}
 
-    // Write the Taylor coefficients, if requested.
-    auto nptr = llvm::ConstantPointerNull::get(llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
-    llvm_if_then_else(
-        s, builder.CreateICmpNE(tc_ptr, nptr),
-        [&]() {
-            // tc_ptr is not null: copy the Taylor coefficients
-            // for the state variables.
-            taylor_write_tc(s, diff_variant, {}, nullptr, tc_ptr, n_eq, n_uvars, order, batch_size);
-        },
-        [&]() {
-            // Taylor coefficients were not requested,
-            // don't do anything in this branch.
-        });
+template <typename T>
+template <typename U>
+std::tuple<taylor_outcome, T, T, std::size_t, std::vector<U>>
+taylor_adaptive_impl<T>::propagate_grid_impl(const std::vector<T> &grid, std::size_t max_steps, T max_delta_t,
+                                             propagate_cb_t cb, const std::vector<std::uint32_t> &comps)
+{
+    // Number of output components.
+    const auto n_comps = comps.empty() ? get_dim() : comps.size();
 
-    // Create the return value.
-    builder.CreateRetVoid();
+    // Pre-allocate the return value.
+    std::vector<U> retval;
+    // LCOV_EXCL_START
+    if (!grid.empty() && n_comps > std::numeric_limits<decltype(retval.size())>::max() / grid.size()) {
+        throw std::overflow_error("Overflow detected in the creation of the return value of propagate_grid() in an "
+                                  "adaptive Taylor integrator");
+    }
+    // LCOV_EXCL_STOP
+    retval.resize(grid.size() * n_comps);
 
-    // Verify the function.
-    s.verify_function(f);
+    auto [oc, min_h, max_h, step_counter, n_written]
+        = propagate_grid_impl<U>(grid, max_steps, max_delta_t, std::move(cb), retval.data(), comps, n_comps);
 
-    // Run the optimisation pass.
-    s.optimise();
+    // Discard the grid points which were not reached.
+    retval.resize(n_written * n_comps);
 
-    return std::tuple{std::move(dc), order};
+    return std::tuple{oc, min_h, max_h, step_counter, std::move(retval)};
 }
 
-} // namespace
-
 template <typename T>
 template <typename U>
-void taylor_adaptive_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, T time, T tol, bool high_accuracy,
-                                                 bool compact_mode, std::vector<T> pars, std::vector<t_event_t> tes,
-                                                 std::vector<nt_event_t> ntes)
+std::tuple<taylor_outcome, T, T, std::size_t, std::size_t>
+taylor_adaptive_impl<T>::propagate_grid_impl(const std::vector<T> &grid, std::size_t max_steps, T max_delta_t,
+                                             propagate_cb_t cb, U *out, const std::vector<std::uint32_t> &comps,
+                                             std::size_t stride)
 {
+    using std::abs;
     using std::isfinite;
+    using std::isnan;
 
-    // Assign the data members.
-    m_state = std::move(state);
-    m_time = dfloat<T>(time);
-    m_pars = std::move(pars);
-    m_tes = std::move(tes);
-    m_ntes = std::move(ntes);
+    trace_span span("taylor_adaptive::propagate_grid", "taylor");
+    // NOTE: aggregate the hot-path warnings emitted during the propagation.
+    const warn_aggregation_scope wa_scope;
 
-    // Check input params.
-    if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !isfinite(x); })) {
+    if (!isfinite(m_time)) {
         throw std::invalid_argument(
-            "A non-finite value was detected in the initial state of an adaptive Taylor integrator");
+            "Cannot invoke propagate_grid() in an adaptive Taylor integrator if the current time is not finite");
     }
 
-    if (m_state.size() != sys.size()) {
+    // Check max_delta_t.
+    if (isnan(max_delta_t)) {
         throw std::invalid_argument(
-            "Inconsistent sizes detected in the initialization of an adaptive Taylor "
-            "integrator: the state vector has a dimension of {}, while the number of equations is {}"_format(
-                m_state.size(), sys.size()));
+            "A nan max_delta_t was passed to the propagate_grid() function of an adaptive Taylor integrator");
+    }
+    if (max_delta_t <= 0) {
+        throw std::invalid_argument(
+            "A non-positive max_delta_t was passed to the propagate_grid() function of an adaptive Taylor integrator");
     }
 
-    if (!isfinite(m_time)) {
+    // Check the grid.
+    if (grid.empty()) {
         throw std::invalid_argument(
-            "Cannot initialise an adaptive Taylor integrator with a non-finite initial time of {}"_format(
-                static_cast<T>(m_time)));
+            "Cannot invoke propagate_grid() in an adaptive Taylor integrator if the time grid is empty");
     }
 
-    if (!isfinite(tol) || tol <= 0) {
+    constexpr auto nf_err_msg
+        = "A non-finite time value was passed to propagate_grid() in an adaptive Taylor integrator";
+    constexpr auto ig_err_msg
+        = "A non-monotonic time grid was passed to propagate_grid() in an adaptive Taylor integrator";
+    // Check the first point.
+    if (!isfinite(grid[0])) {
+        throw std::invalid_argument(nf_err_msg);
+    }
+    if (grid.size() > 1u) {
+        // Establish the direction of the grid from
+        // the first two points.
+        if (!isfinite(grid[1])) {
+            throw std::invalid_argument(nf_err_msg);
+        }
+        if (grid[1] == grid[0]) {
+            throw std::invalid_argument(ig_err_msg);
+        }
+        const auto grid_direction = grid[1] > grid[0];
+
+        // Check that the remaining points are finite and that
+        // they are ordered monotonically.
+        for (decltype(grid.size()) i = 2; i < grid.size(); ++i) {
+            if (!isfinite(grid[i])) {
+                throw std::invalid_argument(nf_err_msg);
+            }
+
+            if ((grid[i] > grid[i - 1u]) != grid_direction) {
+                throw std::invalid_argument(ig_err_msg);
+            }
+        }
+    }
+
+    // Check the output buffer and the output components.
+    if (out == nullptr) {
         throw std::invalid_argument(
-            "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is {} instead"_format(
-                tol));
+            "A null output buffer was passed to the propagate_grid() function of an adaptive Taylor integrator");
+    }
+    // NOTE: the components dim, dim + 1, ... select the sv_funcs.
+    for (auto c : comps) {
+        if (c >= get_dim() + m_sv_funcs.size()) {
+            throw std::invalid_argument(
+                "Invalid output component {} passed to the propagate_grid() function of an adaptive Taylor "
+                "integrator: the component must be less than the dimension of the system plus the number of "
+                "sv_funcs ({})"_format(c, get_dim() + m_sv_funcs.size()));
+        }
     }
+    const auto with_sv = std::any_of(comps.begin(), comps.end(), [this](auto c) { return c >= get_dim(); });
+    // NOTE: if all the selected sv_funcs are identical to event equations,
+    // the values at the grid points computed via dense output are obtained
+    // from the Taylor coefficients of the event equations in the jet of the
+    // last timestep, rather than via the evaluation of the sv_funcs. This is
+    // not possible in scratch mode, where the jet buffer may be reused
+    // (e.g., by other integrators in the callbacks).
+    const auto sv_from_ev
+        = with_sv && !m_thread_scratch && !m_ev_jet.empty() && std::all_of(comps.begin(), comps.end(), [this](auto c) {
+              return c < m_dim || m_sv_ev_rows[c - m_dim] != std::numeric_limits<std::uint32_t>::max();
+          });
+    const auto n_comps = comps.empty() ? get_dim() : comps.size();
+    if (stride == 0u) {
+        stride = n_comps;
+    } else if (stride < n_comps) {
+        throw std::invalid_argument(
+            "The stride passed to the propagate_grid() function of an adaptive Taylor integrator ({}) is less than "
+            "the number of output components ({})"_format(stride, n_comps));
+    }
+
+    // Number of grid points written
+    // into the output buffer.
+    std::size_t n_written = 0;
+
+    // Helper to write into the output buffer the
+    // selected components of the state vector src,
+    // converting them to the output type.
+    // NOTE: h is the timestep, with respect to the beginning of the
+    // last timestep, corresponding to a state vector src computed
+    // via dense output. If h is not null and sv_from_ev is true, the
+    // values of the sv_funcs are computed from the jet of the last timestep.
+    auto write_out = [&](const std::vector<T> &src, const T *h = nullptr) {
+        auto *const dst = out + n_written * stride;
+
+        if (comps.empty()) {
+            std::transform(src.begin(), src.end(), dst, [](const T &x) { return static_cast<U>(x); });
+        } else {
+            if (with_sv) {
+                if (h != nullptr && sv_from_ev) {
+                    // Evaluate the Taylor polynomials of the
+                    // event equations via the Horner scheme.
+                    for (auto c : comps) {
+                        if (c >= m_dim) {
+                            const auto *tc = m_ev_jet.data() + static_cast<std::size_t>(m_sv_ev_rows[c - m_dim])
+                                                                   * (m_order + 1u);
+
+                            T val = tc[m_order];
+                            for (std::uint32_t o = 1; o <= m_order; ++o) {
+                                val = tc[m_order - o] + val * *h;
+                            }
 
-    // NOTE: we need to be able to index into the events
-    // using 32-bit ints.
-    // LCOV_EXCL_START
-    if (m_tes.size() > std::numeric_limits<std::uint32_t>::max()
-        || m_ntes.size() > std::numeric_limits<std::uint32_t>::max()) {
-        throw std::invalid_argument("The number of events is too large, and it results in an overflow condition");
+                            m_sv_values[c - m_dim] = val;
+                        }
+                    }
+                } else {
+                    eval_sv_funcs(src);
+                }
+            }
+
+            for (decltype(comps.size()) j = 0; j < comps.size(); ++j) {
+                const auto c = comps[j];
+                dst[j] = static_cast<U>(c < m_dim ? src[c] : m_sv_values[c - m_dim]);
+            }
+        }
+
+        ++n_written;
+    };
+
+    // Buffer for the dense output of the blocks of grid points
+    // falling within a timestep (see below).
+    std::vector<T> d_out_block;
+
+    // Helper to compute the dense output for the n grid points
+    // starting from times and write the results into the output buffer.
+    // NOTE: the dense output is computed for all the grid points at once
+    // via the multi-point update_d_output(), which processes the grid points
+    // in SIMD batches. If no conversion or component selection is needed,
+    // the results are written directly into the output buffer.
+    // NOTE: the dense output of the last grid point of the block
+    // is also copied into m_d_out, as it used to be done
+    // when computing the dense output one grid point at a time.
+    const auto dim = static_cast<std::size_t>(m_dim);
+    auto write_out_block = [&](const T *times, std::size_t n) {
+        assert(n > 0u);
+
+        if constexpr (std::is_same_v<U, T>) {
+            if (comps.empty() && stride == dim) {
+                auto *const dst = out + n_written * stride;
+                update_d_output(times, n, dst);
+                std::copy(dst + (n - 1u) * dim, dst + n * dim, m_d_out.data());
+                n_written += n;
+
+                return;
+            }
+        }
+
+        d_out_block.resize(n * dim);
+        update_d_output(times, n, d_out_block.data());
+
+        for (std::size_t k = 0; k < n; ++k) {
+            std::copy(d_out_block.data() + k * dim, d_out_block.data() + (k + 1u) * dim, m_d_out.data());
+
+            const auto h = static_cast<T>(times[k] - (m_time - m_last_h));
+            write_out(m_d_out, &h);
+        }
+    };
+
+    // Initial values for the counters
+    // and the min/max abs of the integration
+    // timesteps.
+    // NOTE: iter_counter is for keeping track of the max_steps
+    // limits, step_counter counts the number of timesteps performed
+    // with a nonzero h. Most of the time these two quantities
+    // will be identical, apart from corner cases.
+    std::size_t iter_counter = 0, step_counter = 0;
+    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+
+    // If the first grid point lies ahead of the current time in the
+    // direction of the grid, it is computed via dense output together
+    // with the other grid points. Otherwise, the system is first
+    // propagated up to the first grid point.
+    // NOTE: the dense output avoids the truncation of the timestep
+    // which ends at the first grid point, so that the integrator
+    // keeps its natural timesteps up to the last grid point.
+    const auto d_out_first
+        = grid.size() > 1u && m_time != dfloat<T>(grid[0]) && ((grid[0] > m_time) == (grid[1] > grid[0]));
+
+    // Flag signalling whether the Taylor coefficients of the
+    // last timestep are available for the dense output.
+    auto tc_ready = !d_out_first;
+
+    if (!d_out_first) {
+        // NOTE: this may not be needed strictly speaking if
+        // the time is already grid[0], but it will ensure that
+        // m_last_h is properly updated.
+        // NOTE: this will *not* write the TCs, but, because we
+        // know that the grid is strictly monotonic, we know that we
+        // will take at least 1 TC-writing timestep before starting
+        // to use the dense output.
+        // NOTE: use the same max_steps for the initial propagation,
+        // and don't pass the callback.
+        const auto oc
+            = std::get<0>(propagate_until(grid[0], kw::max_delta_t = max_delta_t, kw::max_steps = max_steps));
+
+        if (oc != taylor_outcome::time_limit && oc < taylor_outcome{0}) {
+            // The outcome is not time_limit and it is not a continuing
+            // terminal event. This means that a non-finite state was
+            // encountered, or a stopping terminal event triggered, or
+            // the step limit was hit.
+            return std::tuple{oc, min_h, max_h, step_counter, n_written};
+        }
+
+        // Write the first result.
+        write_out(m_state);
     }
-    // LCOV_EXCL_STOP
 
-    const auto with_events = !m_tes.empty() || !m_ntes.empty();
+    // Init the remaining time.
+    auto rem_time = grid.back() - m_time;
+
+    // Check it.
+    if (!isfinite(rem_time)) {
+        throw std::invalid_argument("The final time passed to the propagate_grid() function of an adaptive Taylor "
+                                    "integrator results in an overflow condition");
+    }
+
+    // Cache the integration direction.
+    const auto t_dir = (rem_time >= T(0));
+
+    // Setup the step-size collapse detector.
+    const auto hc_thr = m_hc_rel * abs(static_cast<T>(rem_time));
+    std::size_t hc_counter = 0;
+
+    // Iterate over the remaining grid points.
+    for (decltype(grid.size()) cur_grid_idx = d_out_first ? 0 : 1; cur_grid_idx < grid.size();) {
+        // Establish the time range of the last
+        // taken timestep.
+        // NOTE: t0 < t1.
+        const auto t0 = std::min(m_time, m_time - m_last_h);
+        const auto t1 = std::max(m_time, m_time - m_last_h);
+
+        // Determine the block of grid points for which the state of the
+        // system can be computed via dense output, i.e., the grid points
+        // falling within the validity range for the dense output.
+        // NOTE: we force processing of all remaining grid points
+        // if we are at the last timestep. We do this in order to avoid
+        // numerical issues when deciding if the last grid point
+        // falls within the range of validity of the dense output.
+        // NOTE: if the Taylor coefficients are not available yet, a
+        // timestep must be taken before using the dense output.
+        auto block_end = cur_grid_idx;
+        if (tc_ready) {
+            if (rem_time == dfloat<T>(T(0))) {
+                block_end = grid.size();
+            } else {
+                while (block_end < grid.size() && grid[block_end] >= t0 && grid[block_end] <= t1) {
+                    ++block_end;
+                }
+            }
+        }
+
+        // Compute and write the dense output for the block.
+        if (block_end > cur_grid_idx) {
+            write_out_block(grid.data() + cur_grid_idx, block_end - cur_grid_idx);
+            cur_grid_idx = block_end;
+        }
+
+        if (cur_grid_idx == grid.size()) {
+            // No more grid points, exit.
+            break;
+        }
+
+        // Take the next step, making sure to write the Taylor coefficients
+        // and to cap the timestep size so that we don't go past the
+        // last grid point and we don't use a timestep exceeding max_delta_t.
+        // NOTE: rem_time is guaranteed to be finite: we check it explicitly above
+        // and we keep on decreasing its magnitude at the following iterations.
+        // If some non-finite state/time is generated in
+        // the step function, the integration will be stopped.
+        assert((rem_time >= T(0)) == t_dir);
+        const auto dt_limit
+            = t_dir ? std::min(dfloat<T>(max_delta_t), rem_time) : std::max(dfloat<T>(-max_delta_t), rem_time);
+        const auto [res, h] = step_impl(static_cast<T>(dt_limit), true);
+
+        if (res != taylor_outcome::success && res != taylor_outcome::time_limit && res < taylor_outcome{0}) {
+            // Something went wrong in the propagation of the timestep, or we reached
+            // a stopping terminal event.
+            return std::tuple{res, min_h, max_h, step_counter, n_written};
+        }
+
+        // The Taylor coefficients of the timestep are now available.
+        tc_ready = true;
+
+        // Update the number of iterations.
+        ++iter_counter;
 
-    // Fix m_pars' size, if necessary.
-    const auto npars = n_pars_in_sys(sys);
-    if (m_pars.size() < npars) {
-        m_pars.resize(boost::numeric_cast<decltype(m_pars.size())>(npars));
-    } else if (m_pars.size() > npars) {
-        throw std::invalid_argument(
-            "Excessive number of parameter values passed to the constructor of an adaptive "
-            "Taylor integrator: {} parameter values were passed, but the ODE system contains only {} parameters"_format(
-                m_pars.size(), npars));
-    }
+        // Update the number of steps.
+        step_counter += static_cast<std::size_t>(h != 0);
 
-    // Store the dimension of the system.
-    m_dim = boost::numeric_cast<std::uint32_t>(sys.size());
+        // Update min_h/max_h, but only if the outcome is success (otherwise
+        // the step was artificially clamped either by a time limit or
+        // by a terminal event).
+        if (res == taylor_outcome::success) {
+            const auto abs_h = abs(h);
+            min_h = std::min(min_h, abs_h);
+            max_h = std::max(max_h, abs_h);
+        }
 
-    // Temporarily disable optimisations in s, so that
-    // we don't optimise twice when adding the step
-    // and then the d_out.
-    std::optional<opt_disabler> od(m_llvm);
+        // Step successful: invoke the callback, if needed.
+        if (cb && !invoke_propagate_cb(cb)) {
+            // Interruption via callback.
+            return std::tuple{taylor_outcome::cb_stop, min_h, max_h, step_counter, n_written};
+        }
 
-    // Add the stepper function.
-    if (with_events) {
-        std::vector<expression> ee;
-        for (const auto &ev : m_tes) {
-            ee.push_back(ev.get_expression());
+        // Check for a step-size collapse.
+        if (h_collapse_check(res, h, hc_thr, hc_counter)) {
+            return std::tuple{taylor_outcome::err_h_collapse, min_h, max_h, step_counter, n_written};
         }
-        for (const auto &ev : m_ntes) {
-            ee.push_back(ev.get_expression());
+
+        // Check the iteration limit.
+        // NOTE: if max_steps is 0 (i.e., no limit on the number of steps),
+        // then this condition will never trigger as by this point we are
+        // sure iter_counter is at least 1.
+        if (iter_counter == max_steps) {
+            return std::tuple{taylor_outcome::step_limit, min_h, max_h, step_counter, n_written};
         }
 
-        std::tie(m_dc, m_order) = taylor_add_adaptive_step_with_events<T>(m_llvm, "step_e", std::move(sys), tol, 1,
-                                                                          high_accuracy, compact_mode, std::move(ee));
-    } else {
-        std::tie(m_dc, m_order)
-            = taylor_add_adaptive_step<T>(m_llvm, "step", std::move(sys), tol, 1, high_accuracy, compact_mode);
+        // Update the remaining time.
+        // NOTE: if static_cast<T>(rem_time) was used as a timestep,
+        // it means that we hit the time limit. Force rem_time to zero
+        // to signal this, avoiding inconsistencies with grid.back() - m_time
+        // not going exactly to zero due to numerical issues. A zero rem_time
+        // will also force the processing of all remaining grid points.
+        if (h == static_cast<T>(rem_time)) {
+            assert(res == taylor_outcome::time_limit);
+            rem_time = dfloat<T>(T(0));
+        } else {
+            rem_time = grid.back() - m_time;
+        }
     }
 
-    // Add the function for the computation of
-    // the dense output.
-    taylor_add_d_out_function<T>(m_llvm, m_dim, m_order, 1, high_accuracy);
-
-    // Restore the original optimisation level in s.
-    od.reset();
+    // Everything went well, return time_limit.
+    return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter, n_written};
+}
 
-    // Run the optimisation pass manually.
-    m_llvm.optimise();
+namespace
+{
 
-    // Run the jit.
-    m_llvm.compile();
+// Run the task f asynchronously via the executor ex (or in a new
+// thread, if ex is empty), returning a future for its result.
+template <typename F>
+auto taylor_async_run(F f, const taylor_executor_t &ex)
+{
+    using ret_t = decltype(f());
 
-    // Fetch the stepper.
-    if (with_events) {
-        m_step_f = reinterpret_cast<step_f_e_t>(m_llvm.jit_lookup("step_e"));
-    } else {
-        m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    if (!ex) {
+        return std::async(std::launch::async, std::move(f));
     }
 
-    // Fetch the function to compute the dense output.
-    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+    // NOTE: the promise is held by a shared pointer, as the executor
+    // accepts only copyable tasks. If the executor discards the task
+    // without invoking it, the future will report a broken promise.
+    auto pr = std::make_shared<std::promise<ret_t>>();
+    auto fut = pr->get_future();
 
-    // Setup the vector for the Taylor coefficients.
-    // LCOV_EXCL_START
-    if (m_order == std::numeric_limits<std::uint32_t>::max()
-        || m_state.size() > std::numeric_limits<decltype(m_tc.size())>::max() / (m_order + 1u)) {
-        throw std::overflow_error("Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
-                                  "or the state size is too large");
+    ex([pr, f = std::move(f)]() {
+        try {
+            pr->set_value(f());
+        } catch (...) {
+            pr->set_exception(std::current_exception());
+        }
+    });
+
+    return fut;
+}
+
+// Combine the callback cb of an asynchronous propagation with
+// the cancellation flag cancel. The result is empty
+// if both cb and cancel are empty.
+template <typename CB>
+CB taylor_async_cb(CB cb, taylor_cancel_flag_t cancel)
+{
+    if (!cancel) {
+        return cb;
     }
-    // LCOV_EXCL_STOP
 
-    m_tc.resize(m_state.size() * (m_order + 1u));
+    return [cb = std::move(cb), cancel = std::move(cancel)](auto &ta) {
+        if (cancel->load(std::memory_order_relaxed)) {
+            return false;
+        }
 
-    // Setup the vector for the dense output.
-    m_d_out.resize(m_state.size());
+        return cb ? cb(ta) : true;
+    };
+}
 
-    // If we have events, we need to setup
-    // m_ev_jet.
-    if (with_events) {
-        const auto n_tes = static_cast<std::uint32_t>(m_tes.size());
-        const auto n_ntes = static_cast<std::uint32_t>(m_ntes.size());
+} // namespace
 
-        // NOTE: check that we can represent
-        // the requested size for m_ev_jet using
-        // both its size type and std::uint32_t.
-        // LCOV_EXCL_START
-        if (n_tes > std::numeric_limits<std::uint32_t>::max() - n_ntes
-            || m_order == std::numeric_limits<std::uint32_t>::max()
-            || m_dim > std::numeric_limits<std::uint32_t>::max() - (n_tes + n_ntes)
-            || m_dim + (n_tes + n_ntes) > std::numeric_limits<std::uint32_t>::max() / (m_order + 1u)
-            || m_dim + (n_tes + n_ntes) > std::numeric_limits<decltype(m_ev_jet.size())>::max() / (m_order + 1u)) {
-            throw std::overflow_error(
-                "Overflow detected in the initialisation of an adaptive Taylor integrator: the order "
-                "or the state size is too large");
-        }
-        // LCOV_EXCL_STOP
+template <typename T>
+std::future<std::tuple<taylor_outcome, T, T, std::size_t>>
+taylor_adaptive_impl<T>::propagate_until_async_impl(const dfloat<T> &t, std::size_t max_steps, T max_delta_t,
+                                                    async_cb_t cb, bool write_tc, const taylor_executor_t &ex,
+                                                    taylor_cancel_flag_t cancel)
+{
+    return taylor_async_run(
+        [this, t, max_steps, max_delta_t, cb = taylor_async_cb(std::move(cb), std::move(cancel)), write_tc]() {
+            return propagate_until_impl(t, max_steps, max_delta_t, cb, write_tc, nullptr);
+        },
+        ex);
+}
 
-        m_ev_jet.resize((m_dim + (n_tes + n_ntes)) * (m_order + 1u));
-    }
+template <typename T>
+std::future<std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>>>
+taylor_adaptive_impl<T>::propagate_grid_async_impl(std::vector<T> grid, std::size_t max_steps, T max_delta_t,
+                                                   async_cb_t cb, std::vector<std::uint32_t> comps,
+                                                   const taylor_executor_t &ex, taylor_cancel_flag_t cancel)
+{
+    return taylor_async_run(
+        [this, grid = std::move(grid), max_steps, max_delta_t, cb = taylor_async_cb(std::move(cb), std::move(cancel)),
+         comps = std::move(comps)]() { return propagate_grid_impl<T>(grid, max_steps, max_delta_t, cb, comps); },
+        ex);
+}
 
-    // Setup the vector of cooldowns.
-    m_te_cooldowns.resize(boost::numeric_cast<decltype(m_te_cooldowns.size())>(m_tes.size()));
+template <typename T>
+const llvm_state &taylor_adaptive_impl<T>::get_llvm_state() const
+{
+    return *m_llvm;
 }
 
 template <typename T>
-taylor_adaptive_impl<T>::taylor_adaptive_impl(const taylor_adaptive_impl &other)
-    // NOTE: make a manual copy of all members, apart from the function pointers.
-    : m_state(other.m_state), m_time(other.m_time), m_llvm(other.m_llvm), m_dim(other.m_dim), m_dc(other.m_dc),
-      m_order(other.m_order), m_pars(other.m_pars), m_tc(other.m_tc), m_last_h(other.m_last_h), m_d_out(other.m_d_out),
-      m_tes(other.m_tes), m_ntes(other.m_ntes), m_ev_jet(other.m_ev_jet), m_te_cooldowns(other.m_te_cooldowns)
+const taylor_dc_t &taylor_adaptive_impl<T>::get_decomposition() const
 {
-    if (m_tes.empty() && m_ntes.empty()) {
-        m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
-    } else {
-        m_step_f = reinterpret_cast<step_f_e_t>(m_llvm.jit_lookup("step_e"));
-    }
+    return *m_dc;
+}
 
-    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+template <typename T>
+std::uint32_t taylor_adaptive_impl<T>::get_order() const
+{
+    return m_order;
+}
 
-    // NOTE: instead of copying these, reserve the capacity.
-    m_d_tes.reserve(other.m_d_tes.capacity());
-    m_d_ntes.reserve(other.m_d_ntes.capacity());
+template <typename T>
+std::uint32_t taylor_adaptive_impl<T>::get_dim() const
+{
+    return m_dim;
 }
 
+// The size of the jet of derivatives used
+// in the steps with events.
 template <typename T>
-taylor_adaptive_impl<T>::taylor_adaptive_impl(taylor_adaptive_impl &&) noexcept = default;
+std::size_t taylor_adaptive_impl<T>::ev_jet_size() const
+{
+    if (m_tes.empty() && m_ntes.empty()) {
+        return 0;
+    }
+
+    // NOTE: the absence of overflows has been
+    // checked in the construction of the integrator.
+    return (m_dim + static_cast<std::size_t>(m_tes.size() + m_ntes.size())) * (m_order + 1u);
+}
 
 template <typename T>
-taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(const taylor_adaptive_impl &other)
+void taylor_adaptive_impl<T>::set_thread_scratch(bool flag)
 {
-    if (this != &other) {
-        *this = taylor_adaptive_impl(other);
+    if (flag == m_thread_scratch) {
+        return;
     }
 
-    return *this;
+    if (flag) {
+        // NOTE: copy out the pending tcs
+        // before releasing m_ev_jet.
+        sync_tc();
+        aligned_vector<T>{}.swap(m_ev_jet);
+    } else {
+        m_ev_jet.resize(ev_jet_size());
+    }
+
+    m_thread_scratch = flag;
 }
 
+// Copy the Taylor coefficients of the state variables
+// from m_ev_jet into m_tc, if needed.
 template <typename T>
-taylor_adaptive_impl<T> &taylor_adaptive_impl<T>::operator=(taylor_adaptive_impl &&) noexcept = default;
+void taylor_adaptive_impl<T>::sync_tc() const
+{
+    if (m_tc_pending) {
+        // NOTE: the Taylor coefficients of the state
+        // variables are at the beginning of m_ev_jet.
+        assert(m_ev_jet.size() >= m_tc.size());
+        std::copy(m_ev_jet.data(), m_ev_jet.data() + m_tc.size(), m_tc.data());
+
+        m_tc_pending = false;
+    }
+}
 
 template <typename T>
-taylor_adaptive_impl<T>::~taylor_adaptive_impl() = default;
+void taylor_adaptive_impl<T>::set_state(const T *src, std::size_t stride)
+{
+    if (src == nullptr) {
+        throw std::invalid_argument(
+            "A null pointer was passed to the set_state() function of an adaptive Taylor integrator");
+    }
+
+    if (stride == 1u) {
+        std::copy(src, src + m_state.size(), m_state.begin());
+    } else {
+        for (decltype(m_state.size()) i = 0; i < m_state.size(); ++i) {
+            m_state[i] = src[i * stride];
+        }
+    }
+}
 
-// Implementation detail to make a single integration timestep.
-// The magnitude of the timestep is automatically deduced, but it will
-// always be not greater than abs(max_delta_t). The propagation
-// is done forward in time if max_delta_t >= 0, backwards in
-// time otherwise.
-//
-// The function will return a pair, containing
-// a flag describing the outcome of the integration,
-// and the integration timestep that was used.
 template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_impl(T max_delta_t, bool wtc)
+void taylor_adaptive_impl<T>::set_pars(const T *src, std::size_t stride)
 {
-    using std::isfinite;
+    if (m_pars.empty()) {
+        return;
+    }
 
-#if !defined(NDEBUG)
-    // NOTE: this is the only precondition on max_delta_t.
-    using std::isnan;
-    assert(!isnan(max_delta_t));
-#endif
+    if (src == nullptr) {
+        throw std::invalid_argument(
+            "A null pointer was passed to the set_pars() function of an adaptive Taylor integrator");
+    }
 
-    auto h = max_delta_t;
+    if (stride == 1u) {
+        std::copy(src, src + m_pars.size(), m_pars.begin());
+    } else {
+        for (decltype(m_pars.size()) i = 0; i < m_pars.size(); ++i) {
+            m_pars[i] = src[i * stride];
+        }
+    }
+}
 
-    if (m_step_f.index() == 0u) {
-        assert(m_tes.empty() && m_ntes.empty());
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::get_tc() const
+{
+    sync_tc();
 
-        // Invoke the vanilla stepper.
-        std::get<0>(m_step_f)(m_state.data(), m_pars.data(), &m_time.hi, &h, wtc ? m_tc.data() : nullptr);
+    return m_tc;
+}
 
-        // Update the time.
-        m_time += h;
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::get_step_enclosure()
+{
+    if (m_tc_enc_f == nullptr) {
+        m_tc_enc_f = taylor_get_tc_enc_function<T>(m_dim, m_order, 1);
+    }
 
-        // Store the last timestep.
-        m_last_h = h;
+    // NOTE: no overflow check needed here, the size of the
+    // enclosure is checked when fetching the function.
+    m_tc_enc.resize(static_cast<decltype(m_tc_enc.size())>(m_dim) * 2u);
 
-        // Check if the time or the state vector are non-finite at the
-        // end of the timestep.
-        if (!isfinite(m_time)
-            || std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !isfinite(x); })) {
-            return std::tuple{taylor_outcome::err_nf_state, h};
-        }
+    sync_tc();
+    m_tc_enc_f(m_tc_enc.data(), m_tc.data(), &m_last_h);
 
-        return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
-    } else {
-        assert(!m_tes.empty() || !m_ntes.empty());
+    return m_tc_enc;
+}
 
-        using std::abs;
+template <typename T>
+const std::vector<T> &taylor_adaptive_impl<T>::update_d_output(T time, bool rel_time)
+{
+    sync_tc();
 
-        // Invoke the stepper for event handling.
-        std::get<1>(m_step_f)(m_ev_jet.data(), m_state.data(), m_pars.data(), &m_time.hi, &h);
+    // NOTE: "time" needs to be translated
+    // because m_d_out_f expects a time coordinate
+    // with respect to the starting time t0 of
+    // the *previous* timestep.
+    if (rel_time) {
+        // Time coordinate relative to the current time.
+        const auto h = m_last_h + time;
 
-        // Write unconditionally the tcs.
-        std::copy(m_ev_jet.data(), m_ev_jet.data() + m_dim * (m_order + 1u), m_tc.data());
+        m_d_out_f(m_d_out.data(), m_tc.data(), &h);
+    } else {
+        // Absolute time coordinate.
+        const auto h = time - (m_time - m_last_h);
 
-        // Do the event detection.
-        taylor_detect_events<T>(m_d_tes, m_d_ntes, m_tes, m_ntes, m_te_cooldowns, h, m_ev_jet, m_order, m_dim);
+        m_d_out_f(m_d_out.data(), m_tc.data(), &h.hi);
+    }
 
-        // NOTE: before this point, we did not alter
-        // any user-visible data in the integrator (just
-        // temporary memory). From here until we start invoking
-        // the callbacks, everything is noexcept, so we don't
-        // risk leaving the integrator in a half-baked state.
+    return m_d_out;
+}
 
-        // Sort the events by time.
-        // NOTE: the time coordinates in m_d_(n)tes is relative
-        // to the beginning of the timestep. It will be negative
-        // for backward integration, thus we compare using
-        // abs() so that the first events are those which
-        // happen closer to the beginning of the timestep.
-        // NOTE: the checks inside taylor_detect_events() ensure
-        // that we can safely sort the events' times.
-        auto cmp = [](const auto &ev0, const auto &ev1) { return abs(std::get<1>(ev0)) < abs(std::get<1>(ev1)); };
-        std::sort(m_d_tes.begin(), m_d_tes.end(), cmp);
-        std::sort(m_d_ntes.begin(), m_d_ntes.end(), cmp);
+// Compute the dense output at the n time coordinates in times,
+// writing the results into out in row-major order, with shape (n, dim).
+// The time coordinates are processed in batches via the multi-point
+// dense output function (if available), and the remainder is processed
+// one time coordinate at a time.
+template <typename T>
+void taylor_adaptive_impl<T>::update_d_output(const T *times, std::size_t n, T *out, bool rel_time) const
+{
+    if (n == 0u) {
+        return;
+    }
 
-        // Store the timestep that was used during event
-        // detection, before possibly modifying it.
-        const auto orig_h = h;
+    sync_tc();
 
-        // If we have terminal events we need
-        // to update the value of h.
-        if (!m_d_tes.empty()) {
-            h = std::get<1>(m_d_tes[0]);
+    if (times == nullptr || out == nullptr) {
+        throw std::invalid_argument("A null pointer was passed to the multi-point update_d_output() function of an "
+                                    "adaptive Taylor integrator");
+    }
+
+    // Helper to translate a time coordinate into a timestep
+    // with respect to the starting time of the previous timestep
+    // (see the other update_d_output() overload).
+    auto time_to_h = [&](const T &time) {
+        if (rel_time) {
+            return m_last_h + time;
+        } else {
+            return static_cast<T>(time - (m_time - m_last_h));
         }
+    };
 
-        // If we don't have terminal events, we will invoke the callbacks
-        // of *all* the non-terminal events. Otherwise, we need to figure
-        // out which non-terminal events do not happen because their time
-        // coordinate is past the the first terminal event.
-        const auto ntes_end_it
-            = m_d_tes.empty()
-                  ? m_d_ntes.end()
-                  : std::lower_bound(m_d_ntes.begin(), m_d_ntes.end(), h,
-                                     [](const auto &ev, const auto &t) { return abs(std::get<1>(ev)) < abs(t); });
+    const auto dim = static_cast<std::size_t>(m_dim);
 
-        // Update the state.
-        m_d_out_f(m_state.data(), m_ev_jet.data(), &h);
+    std::size_t i = 0;
 
-        // Update the time.
-        m_time += h;
+    if (m_d_out_multi_size > 1u) {
+        assert(m_d_out_multi_f != nullptr);
 
-        // Store the last timestep.
-        m_last_h = h;
+        std::vector<T> hs(m_d_out_multi_size);
 
-        // Check if the time or the state vector are non-finite at the
-        // end of the timestep.
-        if (!isfinite(m_time)
-            || std::any_of(m_state.cbegin(), m_state.cend(), [](const auto &x) { return !isfinite(x); })) {
-            // Let's also reset the cooldown values, as at this point
-            // they have become useless.
-            reset_cooldowns();
+        for (; n - i >= m_d_out_multi_size; i += m_d_out_multi_size) {
+            std::transform(times + i, times + i + m_d_out_multi_size, hs.begin(), time_to_h);
 
-            return std::tuple{taylor_outcome::err_nf_state, h};
+            m_d_out_multi_f(out + i * dim, m_tc.data(), hs.data());
         }
+    }
 
-        // Update the cooldowns.
-        for (auto &cd : m_te_cooldowns) {
-            if (cd) {
-                // Check if the timestep we just took
-                // brought this event outside the cooldown.
-                auto tmp = cd->first + h;
+    for (; i < n; ++i) {
+        const auto h = time_to_h(times[i]);
 
-                if (abs(tmp) >= cd->second) {
-                    // We are now outside the cooldown period
-                    // for this event, reset cd.
-                    cd.reset();
-                } else {
-                    // Still in cooldown, update the
-                    // time spent in cooldown.
-                    cd->first = tmp;
-                }
-            }
-        }
+        m_d_out_f(out + i * dim, m_tc.data(), &h);
+    }
+}
 
-        // Invoke the callbacks of the non-terminal events, which are guaranteed
-        // to happen before the first terminal event.
-        for (auto it = m_d_ntes.begin(); it != ntes_end_it; ++it) {
-            const auto &t = *it;
-            const auto &cb = m_ntes[std::get<0>(t)].get_callback();
-            assert(cb);
-            cb(*this, static_cast<T>(m_time - m_last_h + std::get<1>(t)), std::get<2>(t));
-        }
+template <typename T, bool B>
+void nt_event_impl<T, B>::finalise_ctor(event_direction d, std::uint32_t o)
+{
+    if (!callback) {
+        throw std::invalid_argument("Cannot construct a non-terminal event with an empty callback");
+    }
 
-        // The return value of the first
-        // terminal event's callback. It will be
-        // unused if there are no terminal events.
-        bool te_cb_ret = false;
+    if (d < event_direction::negative || d > event_direction::positive) {
+        throw std::invalid_argument("Invalid value selected for the direction of a non-terminal event");
+    }
 
-        if (!m_d_tes.empty()) {
-            // Fetch the first terminal event.
-            const auto te_idx = std::get<0>(m_d_tes[0]);
-            assert(te_idx < m_tes.size());
-            const auto &te = m_tes[te_idx];
+    if (o == 1u) {
+        throw std::invalid_argument("The detection order of a non-terminal event must be either zero or at least 2");
+    }
 
-            // Set the corresponding cooldown.
-            if (te.get_cooldown() >= 0) {
-                // Cooldown explicitly provided by the user, use it.
-                m_te_cooldowns[te_idx].emplace(0, te.get_cooldown());
-            } else {
-                // Deduce the cooldown automatically.
-                // NOTE: the automatic cooldown deduction is done on the
-                // timestep that was used for event detection, not on the timestep
-                // which was clamped by the occurrence of a terminal event.
-                m_te_cooldowns[te_idx].emplace(0, taylor_deduce_cooldown(orig_h));
-            }
+    dir = d;
+    d_order = o;
+}
 
-            // Invoke the callback of the first terminal event, if it has one.
-            if (te.get_callback()) {
-                te_cb_ret = te.get_callback()(*this, std::get<2>(m_d_tes[0]), std::get<3>(m_d_tes[0]));
-            }
-        }
+template <typename T, bool B>
+nt_event_impl<T, B>::nt_event_impl(const nt_event_impl &) = default;
 
-        if (m_d_tes.empty()) {
-            // No terminal events detected, return success or time limit.
-            return std::tuple{h == max_delta_t ? taylor_outcome::time_limit : taylor_outcome::success, h};
-        } else {
-            // Terminal event detected. Fetch its index.
-            const auto ev_idx = static_cast<std::int64_t>(std::get<0>(m_d_tes[0]));
+template <typename T, bool B>
+nt_event_impl<T, B>::nt_event_impl(nt_event_impl &&) noexcept = default;
 
-            // NOTE: if te_cb_ret is true, it means that the terminal event has
-            // a callback and its invocation returned true (meaning that the
-            // integration should continue). Otherwise, either the terminal event
-            // has no callback or its callback returned false, meaning that the
-            // integration must stop.
-            return std::tuple{taylor_outcome{te_cb_ret ? ev_idx : (-ev_idx - 1)}, h};
-        }
-    }
+template <typename T, bool B>
+nt_event_impl<T, B> &nt_event_impl<T, B>::operator=(const nt_event_impl<T, B> &) = default;
+
+template <typename T, bool B>
+nt_event_impl<T, B> &nt_event_impl<T, B>::operator=(nt_event_impl<T, B> &&) noexcept = default;
+
+template <typename T, bool B>
+nt_event_impl<T, B>::~nt_event_impl() = default;
+
+template <typename T, bool B>
+const expression &nt_event_impl<T, B>::get_expression() const
+{
+    return eq;
 }
 
-template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(bool wtc)
+template <typename T, bool B>
+const typename nt_event_impl<T, B>::callback_t &nt_event_impl<T, B>::get_callback() const
 {
-    // NOTE: time limit +inf means integration forward in time
-    // and no time limit.
-    return step_impl(std::numeric_limits<T>::infinity(), wtc);
+    return callback;
 }
 
-template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step_backward(bool wtc)
+template <typename T, bool B>
+event_direction nt_event_impl<T, B>::get_direction() const
 {
-    return step_impl(-std::numeric_limits<T>::infinity(), wtc);
+    return dir;
 }
 
-template <typename T>
-std::tuple<taylor_outcome, T> taylor_adaptive_impl<T>::step(T max_delta_t, bool wtc)
+template <typename T, bool B>
+std::uint32_t nt_event_impl<T, B>::get_detection_order() const
 {
-    using std::isnan;
+    return d_order;
+}
 
-    if (isnan(max_delta_t)) {
-        throw std::invalid_argument(
-            "A NaN max_delta_t was passed to the step() function of an adaptive Taylor integrator");
-    }
+namespace
+{
 
-    return step_impl(max_delta_t, wtc);
+// Implementation of stream insertion for the non-terminal event class.
+std::ostream &nt_event_impl_stream_impl(std::ostream &os, const expression &eq, event_direction dir)
+{
+    os << "Event type     : non-terminal\n";
+    os << "Event equation : " << eq << '\n';
+    os << "Event direction: " << dir << '\n';
+
+    return os;
 }
 
-// Reset all cooldowns for the terminal events.
-template <typename T>
-void taylor_adaptive_impl<T>::reset_cooldowns()
+} // namespace
+
+template <>
+std::ostream &operator<<(std::ostream &os, const nt_event_impl<double, false> &e)
 {
-    for (auto &cd : m_te_cooldowns) {
-        cd.reset();
-    }
+    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
 }
 
-template <typename T>
-std::tuple<taylor_outcome, T, T, std::size_t>
-taylor_adaptive_impl<T>::propagate_until_impl(const dfloat<T> &t, std::size_t max_steps, T max_delta_t,
-                                              std::function<bool(taylor_adaptive_impl &)> cb, bool wtc)
+template <>
+std::ostream &operator<<(std::ostream &os, const nt_event_impl<double, true> &e)
+{
+    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
+}
+
+template <>
+std::ostream &operator<<(std::ostream &os, const nt_event_impl<long double, false> &e)
+{
+    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
+}
+
+template <>
+std::ostream &operator<<(std::ostream &os, const nt_event_impl<long double, true> &e)
+{
+    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template <>
+std::ostream &operator<<(std::ostream &os, const nt_event_impl<mppp::real128, false> &e)
+{
+    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
+}
+
+template <>
+std::ostream &operator<<(std::ostream &os, const nt_event_impl<mppp::real128, true> &e)
+{
+    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
+}
+
+#endif
+
+template <typename T, bool B>
+void t_event_impl<T, B>::finalise_ctor(callback_t cb, T cd, event_direction d, std::uint32_t o)
 {
-    using std::abs;
     using std::isfinite;
-    using std::isnan;
 
-    // Check the current time.
-    if (!isfinite(m_time)) {
-        throw std::invalid_argument("Cannot invoke the propagate_until() function of an adaptive Taylor integrator if "
-                                    "the current time is not finite");
-    }
+    callback = std::move(cb);
 
-    // Check the final time.
-    if (!isfinite(t)) {
-        throw std::invalid_argument(
-            "A non-finite time was passed to the propagate_until() function of an adaptive Taylor integrator");
+    if (!isfinite(cd)) {
+        throw std::invalid_argument("Cannot set a non-finite cooldown value for a terminal event");
     }
+    cooldown = cd;
 
-    // Check max_delta_t.
-    if (isnan(max_delta_t)) {
-        throw std::invalid_argument(
-            "A nan max_delta_t was passed to the propagate_until() function of an adaptive Taylor integrator");
+    if (d < event_direction::negative || d > event_direction::positive) {
+        throw std::invalid_argument("Invalid value selected for the direction of a terminal event");
     }
-    if (max_delta_t <= 0) {
-        throw std::invalid_argument(
-            "A non-positive max_delta_t was passed to the propagate_until() function of an adaptive Taylor integrator");
+    dir = d;
+
+    if (o == 1u) {
+        throw std::invalid_argument("The detection order of a terminal event must be either zero or at least 2");
     }
+    d_order = o;
+}
 
-    // Initial values for the counters
-    // and the min/max abs of the integration
-    // timesteps.
-    // NOTE: iter_counter is for keeping track of the max_steps
-    // limits, step_counter counts the number of timesteps performed
-    // with a nonzero h. Most of the time these two quantities
-    // will be identical, apart from corner cases.
-    std::size_t iter_counter = 0, step_counter = 0;
-    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
+template <typename T, bool B>
+t_event_impl<T, B>::t_event_impl(const t_event_impl &) = default;
 
-    // Init the remaining time.
-    auto rem_time = t - m_time;
+template <typename T, bool B>
+t_event_impl<T, B>::t_event_impl(t_event_impl &&) noexcept = default;
 
-    // Check it.
-    if (!isfinite(rem_time)) {
-        throw std::invalid_argument("The final time passed to the propagate_until() function of an adaptive Taylor "
-                                    "integrator results in an overflow condition");
-    }
+template <typename T, bool B>
+t_event_impl<T, B> &t_event_impl<T, B>::operator=(const t_event_impl<T, B> &) = default;
 
-    // Cache the integration direction.
-    const auto t_dir = (rem_time >= T(0));
+template <typename T, bool B>
+t_event_impl<T, B> &t_event_impl<T, B>::operator=(t_event_impl<T, B> &&) noexcept = default;
 
-    while (true) {
-        // Compute the max integration times for this timestep.
-        // NOTE: rem_time is guaranteed to be finite: we check it explicitly above
-        // and we keep on decreasing its magnitude at the following iterations.
-        // If some non-finite state/time is generated in
-        // the step function, the integration will be stopped.
-        assert((rem_time >= T(0)) == t_dir);
-        const auto dt_limit
-            = t_dir ? std::min(dfloat<T>(max_delta_t), rem_time) : std::max(dfloat<T>(-max_delta_t), rem_time);
-        // NOTE: if dt_limit is zero, step_impl() will always return time_limit.
-        const auto [res, h] = step_impl(static_cast<T>(dt_limit), wtc);
+template <typename T, bool B>
+t_event_impl<T, B>::~t_event_impl() = default;
+
+template <typename T, bool B>
+const expression &t_event_impl<T, B>::get_expression() const
+{
+    return eq;
+}
+
+template <typename T, bool B>
+const typename t_event_impl<T, B>::callback_t &t_event_impl<T, B>::get_callback() const
+{
+    return callback;
+}
+
+template <typename T, bool B>
+event_direction t_event_impl<T, B>::get_direction() const
+{
+    return dir;
+}
+
+template <typename T, bool B>
+T t_event_impl<T, B>::get_cooldown() const
+{
+    return cooldown;
+}
+
+template <typename T, bool B>
+std::uint32_t t_event_impl<T, B>::get_detection_order() const
+{
+    return d_order;
+}
+
+namespace
+{
+
+// Implementation of stream insertion for the terminal event class.
+template <typename C, typename T>
+std::ostream &t_event_impl_stream_impl(std::ostream &os, const expression &eq, event_direction dir, const C &callback,
+                                       const T &cooldown)
+{
+    os << "Event type     : terminal\n";
+    os << "Event equation : " << eq << '\n';
+    os << "Event direction: " << dir << '\n';
+    os << "With callback  : " << (callback ? "yes" : "no") << '\n';
+    os << "Cooldown       : " << (cooldown < 0 ? "auto" : "{}"_format(cooldown)) << '\n';
 
-        if (res != taylor_outcome::success && res != taylor_outcome::time_limit && res < taylor_outcome{0}) {
-            // Something went wrong in the propagation of the timestep, or we reached
-            // a stopping terminal event
-            return std::tuple{res, min_h, max_h, step_counter};
-        }
+    return os;
+}
 
-        // Update the number of iterations.
-        ++iter_counter;
+} // namespace
 
-        // Update the number of steps.
-        step_counter += static_cast<std::size_t>(h != 0);
+template <>
+std::ostream &operator<<(std::ostream &os, const t_event_impl<double, false> &e)
+{
+    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
+}
 
-        // Update min_h/max_h, but only if the outcome is success (otherwise
-        // the step was artificially clamped either by a time limit or
-        // by a terminal event).
-        if (res == taylor_outcome::success) {
-            const auto abs_h = abs(h);
-            min_h = std::min(min_h, abs_h);
-            max_h = std::max(max_h, abs_h);
-        }
+template <>
+std::ostream &operator<<(std::ostream &os, const t_event_impl<double, true> &e)
+{
+    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
+}
 
-        // The step was successful, execute the callback if applicable.
-        if (cb && !cb(*this)) {
-            // Interruption via callback.
-            return std::tuple{taylor_outcome::cb_stop, min_h, max_h, step_counter};
-        }
+template <>
+std::ostream &operator<<(std::ostream &os, const t_event_impl<long double, false> &e)
+{
+    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
+}
 
-        // Break out if the final time is reached,
-        // NOTE: here we check h == rem_time, instead of just
-        // res == time_limit, because clamping via max_delta_t
-        // could also result in time_limit.
-        if (h == static_cast<T>(rem_time)) {
-            assert(res == taylor_outcome::time_limit);
-            return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter};
-        }
+template <>
+std::ostream &operator<<(std::ostream &os, const t_event_impl<long double, true> &e)
+{
+    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
+}
 
-        // Check the iteration limit.
-        // NOTE: if max_steps is 0 (i.e., no limit on the number of steps),
-        // then this condition will never trigger as by this point we are
-        // sure iter_counter is at least 1.
-        if (iter_counter == max_steps) {
-            return std::tuple{taylor_outcome::step_limit, min_h, max_h, step_counter};
-        }
+#if defined(HEYOKA_HAVE_REAL128)
 
-        // Update the remaining time.
-        // NOTE: in principle, due to the fact that
-        // dt_limit is computed in extended
-        // precision but it is cast to normal precision
-        // before being added to m_time in step_impl(),
-        // there could be numerical inconsistencies
-        // at the last timestep which could result in rem_time
-        // not exactly zero or with a flipped sign.
-        // For this function, this should
-        // not matter because if static_cast<T>(rem_time) was used
-        // as an integration step, we will have already exited
-        // above before anything bad can
-        // happen. If anything smaller than static_cast<T>(rem_time)
-        // was used as timestep, rem_time should not change sign.
-        rem_time = t - m_time;
-    }
+template <>
+std::ostream &operator<<(std::ostream &os, const t_event_impl<mppp::real128, false> &e)
+{
+    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
 }
 
-template <typename T>
-std::tuple<taylor_outcome, T, T, std::size_t, std::vector<T>>
-taylor_adaptive_impl<T>::propagate_grid_impl(const std::vector<T> &grid, std::size_t max_steps, T max_delta_t,
-                                             std::function<bool(taylor_adaptive_impl &)> cb)
+template <>
+std::ostream &operator<<(std::ostream &os, const t_event_impl<mppp::real128, true> &e)
 {
-    using std::abs;
-    using std::isfinite;
-    using std::isnan;
+    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
+}
 
-    if (!isfinite(m_time)) {
-        throw std::invalid_argument(
-            "Cannot invoke propagate_grid() in an adaptive Taylor integrator if the current time is not finite");
-    }
+#endif
 
-    // Check max_delta_t.
-    if (isnan(max_delta_t)) {
-        throw std::invalid_argument(
-            "A nan max_delta_t was passed to the propagate_grid() function of an adaptive Taylor integrator");
-    }
-    if (max_delta_t <= 0) {
-        throw std::invalid_argument(
-            "A non-positive max_delta_t was passed to the propagate_grid() function of an adaptive Taylor integrator");
-    }
+namespace
+{
 
-    // Check the grid.
-    if (grid.empty()) {
-        throw std::invalid_argument(
-            "Cannot invoke propagate_grid() in an adaptive Taylor integrator if the time grid is empty");
-    }
+// Locate, among the n recorded steps with initial times t0, the last step
+// whose initial time does not come after t in the direction of integration.
+// If t comes before the first step, zero is returned.
+template <typename T>
+std::size_t c_output_find_step(const T *t0, std::size_t n, bool forward, T t)
+{
+    assert(n > 0u);
 
-    constexpr auto nf_err_msg
-        = "A non-finite time value was passed to propagate_grid() in an adaptive Taylor integrator";
-    constexpr auto ig_err_msg
-        = "A non-monotonic time grid was passed to propagate_grid() in an adaptive Taylor integrator";
-    // Check the first point.
-    if (!isfinite(grid[0])) {
-        throw std::invalid_argument(nf_err_msg);
-    }
-    if (grid.size() > 1u) {
-        // Establish the direction of the grid from
-        // the first two points.
-        if (!isfinite(grid[1])) {
-            throw std::invalid_argument(nf_err_msg);
-        }
-        if (grid[1] == grid[0]) {
-            throw std::invalid_argument(ig_err_msg);
-        }
-        const auto grid_direction = grid[1] > grid[0];
+    const auto *const it
+        = forward ? std::upper_bound(t0, t0 + n, t) : std::upper_bound(t0, t0 + n, t, std::greater<T>{});
 
-        // Check that the remaining points are finite and that
-        // they are ordered monotonically.
-        for (decltype(grid.size()) i = 2; i < grid.size(); ++i) {
-            if (!isfinite(grid[i])) {
-                throw std::invalid_argument(nf_err_msg);
-            }
+    return (it == t0) ? std::size_t(0) : static_cast<std::size_t>(it - t0 - 1);
+}
 
-            if ((grid[i] > grid[i - 1u]) != grid_direction) {
-                throw std::invalid_argument(ig_err_msg);
-            }
-        }
+} // namespace
+
+template <typename T>
+void continuous_output_impl<T>::finalise_ctor_impl(const taylor_adaptive_impl<T> &ta, std::size_t chunk_size,
+                                                   bool compress, bool high_accuracy)
+{
+    if (chunk_size == 0u) {
+        throw std::invalid_argument("The chunk size of a continuous output cannot be zero");
     }
 
-    // Pre-allocate the return value.
-    std::vector<T> retval;
+    m_dim = ta.get_dim();
+    m_order = ta.get_order();
+    m_chunk_size = chunk_size;
+    m_compress = compress;
+
+    // NOTE: the size of the Taylor coefficients vector has
+    // already been checked for overflow in the integrator.
+    const auto tc_size = ta.get_tc().size();
     // LCOV_EXCL_START
-    if (get_dim() > std::numeric_limits<decltype(retval.size())>::max() / grid.size()) {
-        throw std::overflow_error("Overflow detected in the creation of the return value of propagate_grid() in an "
-                                  "adaptive Taylor integrator");
+    if (tc_size > std::numeric_limits<std::size_t>::max() / m_chunk_size) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the chunks of a continuous "
+                                  "output");
     }
     // LCOV_EXCL_STOP
-    retval.reserve(grid.size() * get_dim());
-
-    // Initial values for the counters
-    // and the min/max abs of the integration
-    // timesteps.
-    // NOTE: iter_counter is for keeping track of the max_steps
-    // limits, step_counter counts the number of timesteps performed
-    // with a nonzero h. Most of the time these two quantities
-    // will be identical, apart from corner cases.
-    std::size_t iter_counter = 0, step_counter = 0;
-    T min_h = std::numeric_limits<T>::infinity(), max_h(0);
 
-    // Propagate the system up to the first grid point.
-    // NOTE: this may not be needed strictly speaking if
-    // the time is already grid[0], but it will ensure that
-    // m_last_h is properly updated.
-    // NOTE: this will *not* write the TCs, but, because we
-    // know that the grid is strictly monotonic, we know that we
-    // will take at least 1 TC-writing timestep before starting
-    // to use the dense output.
-    // NOTE: use the same max_steps for the initial propagation,
-    // and don't pass the callback.
-    const auto oc = std::get<0>(propagate_until(grid[0], kw::max_delta_t = max_delta_t, kw::max_steps = max_steps));
+    // Add the function for the evaluation of the Taylor series.
+    taylor_add_d_out_function<T>(m_llvm, m_dim, m_order, 1, high_accuracy);
 
-    if (oc != taylor_outcome::time_limit && oc < taylor_outcome{0}) {
-        // The outcome is not time_limit and it is not a continuing
-        // terminal event. This means that a non-finite state was
-        // encountered, or a stopping terminal event triggered, or
-        // the step limit was hit.
-        return std::tuple{oc, min_h, max_h, step_counter, std::move(retval)};
-    }
+    m_llvm.optimise();
 
-    // Add the first result to retval.
-    retval.insert(retval.end(), m_state.begin(), m_state.end());
+    m_llvm.compile();
 
-    // Init the remaining time.
-    auto rem_time = grid.back() - m_time;
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
 
-    // Check it.
-    if (!isfinite(rem_time)) {
-        throw std::invalid_argument("The final time passed to the propagate_grid() function of an adaptive Taylor "
-                                    "integrator results in an overflow condition");
+    // Setup the output and temporary buffers.
+    m_output.resize(boost::numeric_cast<decltype(m_output.size())>(m_dim));
+    if (m_compress) {
+        m_tc_tmp.resize(tc_size);
     }
+}
 
-    // Cache the integration direction.
-    const auto t_dir = (rem_time >= T(0));
-
-    // Iterate over the remaining grid points.
-    for (decltype(grid.size()) cur_grid_idx = 1; cur_grid_idx < grid.size();) {
-        // Establish the time range of the last
-        // taken timestep.
-        // NOTE: t0 < t1.
-        const auto t0 = std::min(m_time, m_time - m_last_h);
-        const auto t1 = std::max(m_time, m_time - m_last_h);
-
-        // Compute the state of the system via dense output for as many grid
-        // points as possible, i.e., as long as the grid times
-        // fall within the validity range for the dense output.
-        while (true) {
-            // Fetch the current time target.
-            const auto cur_tt = grid[cur_grid_idx];
-
-            // NOTE: we force processing of all remaining grid points
-            // if we are at the last timestep. We do this in order to avoid
-            // numerical issues when deciding if the last grid point
-            // falls within the range of validity of the dense output.
-            if ((cur_tt >= t0 && cur_tt <= t1) || (rem_time == dfloat<T>(T(0)))) {
-                // The current time target falls within the range of
-                // validity of the dense output. Compute the dense
-                // output in cur_tt.
-                update_d_output(cur_tt);
-
-                // Add the result to retval.
-                retval.insert(retval.end(), m_d_out.begin(), m_d_out.end());
-            } else {
-                // Cannot use dense output on the current time target,
-                // need to take another step.
-                break;
-            }
-
-            // Move to the next time target, or break out
-            // if we have no more.
-            if (++cur_grid_idx == grid.size()) {
-                break;
-            }
-        }
+template <typename T>
+continuous_output_impl<T>::continuous_output_impl(const continuous_output_impl &other)
+    // NOTE: make a manual copy of all members, apart from the function pointer.
+    : m_llvm(other.m_llvm), m_dim(other.m_dim), m_order(other.m_order), m_chunk_size(other.m_chunk_size),
+      m_compress(other.m_compress), m_n_steps(other.m_n_steps), m_tcs(other.m_tcs), m_tcs_f32(other.m_tcs_f32),
+      m_times_hi(other.m_times_hi), m_times_lo(other.m_times_lo), m_hs(other.m_hs), m_tc_tmp(other.m_tc_tmp),
+      m_output(other.m_output)
+{
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+}
 
-        if (cur_grid_idx == grid.size()) {
-            // No more grid points, exit.
-            break;
-        }
+template <typename T>
+continuous_output_impl<T>::continuous_output_impl(continuous_output_impl &&) noexcept = default;
 
-        // Take the next step, making sure to write the Taylor coefficients
-        // and to cap the timestep size so that we don't go past the
-        // last grid point and we don't use a timestep exceeding max_delta_t.
-        // NOTE: rem_time is guaranteed to be finite: we check it explicitly above
-        // and we keep on decreasing its magnitude at the following iterations.
-        // If some non-finite state/time is generated in
-        // the step function, the integration will be stopped.
-        assert((rem_time >= T(0)) == t_dir);
-        const auto dt_limit
-            = t_dir ? std::min(dfloat<T>(max_delta_t), rem_time) : std::max(dfloat<T>(-max_delta_t), rem_time);
-        const auto [res, h] = step_impl(static_cast<T>(dt_limit), true);
+template <typename T>
+continuous_output_impl<T> &continuous_output_impl<T>::operator=(const continuous_output_impl &other)
+{
+    if (this != &other) {
+        *this = continuous_output_impl(other);
+    }
 
-        if (res != taylor_outcome::success && res != taylor_outcome::time_limit && res < taylor_outcome{0}) {
-            // Something went wrong in the propagation of the timestep, or we reached
-            // a stopping terminal event.
-            return std::tuple{res, min_h, max_h, step_counter, std::move(retval)};
-        }
+    return *this;
+}
 
-        // Update the number of iterations.
-        ++iter_counter;
+template <typename T>
+continuous_output_impl<T> &continuous_output_impl<T>::operator=(continuous_output_impl &&) noexcept = default;
 
-        // Update the number of steps.
-        step_counter += static_cast<std::size_t>(h != 0);
+template <typename T>
+continuous_output_impl<T>::~continuous_output_impl() = default;
 
-        // Update min_h/max_h, but only if the outcome is success (otherwise
-        // the step was artificially clamped either by a time limit or
-        // by a terminal event).
-        if (res == taylor_outcome::success) {
-            const auto abs_h = abs(h);
-            min_h = std::min(min_h, abs_h);
-            max_h = std::max(max_h, abs_h);
-        }
+template <typename T>
+void continuous_output_impl<T>::check_compat(const taylor_adaptive_impl<T> &ta) const
+{
+    if (ta.get_dim() != m_dim || ta.get_order() != m_order) {
+        throw std::invalid_argument(
+            "Cannot record the steps of an adaptive Taylor integrator with dimension {} and order {} into a "
+            "continuous output for a system with dimension {} and order {}"_format(ta.get_dim(), ta.get_order(),
+                                                                                   m_dim, m_order));
+    }
+}
 
-        // Step successful: invoke the callback, if needed.
-        if (cb && !cb(*this)) {
-            // Interruption via callback.
-            return std::tuple{taylor_outcome::cb_stop, min_h, max_h, step_counter, std::move(retval)};
-        }
+template <typename T>
+void continuous_output_impl<T>::add_step(const taylor_adaptive_impl<T> &ta)
+{
+    ta.sync_tc();
 
-        // Check the iteration limit.
-        // NOTE: if max_steps is 0 (i.e., no limit on the number of steps),
-        // then this condition will never trigger as by this point we are
-        // sure iter_counter is at least 1.
-        if (iter_counter == max_steps) {
-            return std::tuple{taylor_outcome::step_limit, min_h, max_h, step_counter, std::move(retval)};
+    assert(ta.m_last_h != 0);
+    assert(ta.m_tc.size() == static_cast<decltype(ta.m_tc.size())>(m_dim) * (m_order + 1u));
+
+    // NOTE: the binary search in operator() requires
+    // the steps to be ordered monotonically in time.
+    if (m_n_steps > 0u && (ta.m_last_h > 0) != (m_hs[0] > 0)) {
+        throw std::invalid_argument("Cannot record into a continuous output a step whose time direction is "
+                                    "different from the time direction of the previously recorded steps");
+    }
+
+    const auto tc_size = ta.m_tc.size();
+    const auto chunk_idx = m_n_steps / m_chunk_size;
+    const auto offset = (m_n_steps % m_chunk_size) * tc_size;
+
+    // Add a new chunk, if needed.
+    // NOTE: the chunks might be available already
+    // if the continuous output was cleared.
+    if (chunk_idx == (m_compress ? m_tcs_f32.size() : m_tcs.size())) {
+        // LCOV_EXCL_START
+        if (chunk_idx == std::numeric_limits<std::size_t>::max() / m_chunk_size) {
+            throw std::overflow_error("Overflow detected in the number of steps recorded in a continuous output");
         }
+        // LCOV_EXCL_STOP
 
-        // Update the remaining time.
-        // NOTE: if static_cast<T>(rem_time) was used as a timestep,
-        // it means that we hit the time limit. Force rem_time to zero
-        // to signal this, avoiding inconsistencies with grid.back() - m_time
-        // not going exactly to zero due to numerical issues. A zero rem_time
-        // will also force the processing of all remaining grid points.
-        if (h == static_cast<T>(rem_time)) {
-            assert(res == taylor_outcome::time_limit);
-            rem_time = dfloat<T>(T(0));
+        if (m_compress) {
+            m_tcs_f32.emplace_back(m_chunk_size * tc_size);
         } else {
-            rem_time = grid.back() - m_time;
+            m_tcs.emplace_back(m_chunk_size * tc_size);
         }
+
+        const auto new_size = (chunk_idx + 1u) * m_chunk_size;
+        m_times_hi.resize(new_size);
+        m_times_lo.resize(new_size);
+        m_hs.resize(new_size);
     }
 
-    // Everything went well, return time_limit.
-    return std::tuple{taylor_outcome::time_limit, min_h, max_h, step_counter, std::move(retval)};
+    // Write the Taylor coefficients.
+    if (m_compress) {
+        std::transform(ta.m_tc.begin(), ta.m_tc.end(), m_tcs_f32[chunk_idx].begin() + offset,
+                       [](const T &x) { return static_cast<float>(x); });
+    } else {
+        std::copy(ta.m_tc.begin(), ta.m_tc.end(), m_tcs[chunk_idx].begin() + offset);
+    }
+
+    // Write the initial time and the size of the step.
+    const auto t0 = ta.m_time - ta.m_last_h;
+    m_times_hi[m_n_steps] = t0.hi;
+    m_times_lo[m_n_steps] = t0.lo;
+    m_hs[m_n_steps] = ta.m_last_h;
+
+    ++m_n_steps;
 }
 
 template <typename T>
-const llvm_state &taylor_adaptive_impl<T>::get_llvm_state() const
+const llvm_state &continuous_output_impl<T>::get_llvm_state() const
 {
     return m_llvm;
 }
 
 template <typename T>
-const taylor_dc_t &taylor_adaptive_impl<T>::get_decomposition() const
+std::uint32_t continuous_output_impl<T>::get_dim() const
 {
-    return m_dc;
+    return m_dim;
 }
 
 template <typename T>
-std::uint32_t taylor_adaptive_impl<T>::get_order() const
+std::uint32_t continuous_output_impl<T>::get_order() const
 {
     return m_order;
 }
 
 template <typename T>
-std::uint32_t taylor_adaptive_impl<T>::get_dim() const
+std::size_t continuous_output_impl<T>::get_chunk_size() const
 {
-    return m_dim;
+    return m_chunk_size;
 }
 
 template <typename T>
-const std::vector<T> &taylor_adaptive_impl<T>::update_d_output(T time, bool rel_time)
+bool continuous_output_impl<T>::get_compress_tcs() const
 {
-    // NOTE: "time" needs to be translated
-    // because m_d_out_f expects a time coordinate
-    // with respect to the starting time t0 of
-    // the *previous* timestep.
-    if (rel_time) {
-        // Time coordinate relative to the current time.
-        const auto h = m_last_h + time;
+    return m_compress;
+}
 
-        m_d_out_f(m_d_out.data(), m_tc.data(), &h);
-    } else {
-        // Absolute time coordinate.
-        const auto h = time - (m_time - m_last_h);
+template <typename T>
+std::size_t continuous_output_impl<T>::get_n_steps() const
+{
+    return m_n_steps;
+}
 
-        m_d_out_f(m_d_out.data(), m_tc.data(), &h.hi);
+template <typename T>
+std::pair<T, T> continuous_output_impl<T>::get_bounds() const
+{
+    if (m_n_steps == 0u) {
+        throw std::invalid_argument("Cannot compute the time bounds of an empty continuous output");
     }
 
-    return m_d_out;
+    const auto last = m_n_steps - 1u;
+
+    return {m_times_hi[0], static_cast<T>(dfloat<T>(m_times_hi[last], m_times_lo[last]) + m_hs[last])};
 }
 
 template <typename T>
-void nt_event_impl<T>::finalise_ctor(event_direction d)
+const std::vector<T> &continuous_output_impl<T>::operator()(T t)
 {
-    if (!callback) {
-        throw std::invalid_argument("Cannot construct a non-terminal event with an empty callback");
+    using std::isfinite;
+
+    if (m_n_steps == 0u) {
+        throw std::invalid_argument("Cannot compute the state of the system from an empty continuous output");
     }
 
-    if (d < event_direction::negative || d > event_direction::positive) {
-        throw std::invalid_argument("Invalid value selected for the direction of a non-terminal event");
+    if (!isfinite(t)) {
+        throw std::invalid_argument("Cannot compute the continuous output at a non-finite time");
     }
 
-    dir = d;
-}
+    const auto idx = c_output_find_step(m_times_hi.data(), m_n_steps, m_hs[0] > 0, t);
 
-template <typename T>
-nt_event_impl<T>::nt_event_impl(const nt_event_impl &) = default;
+    // Fetch the Taylor coefficients.
+    const auto tc_size = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+    const auto chunk_idx = idx / m_chunk_size;
+    const auto offset = (idx % m_chunk_size) * tc_size;
 
-template <typename T>
-nt_event_impl<T>::nt_event_impl(nt_event_impl &&) noexcept = default;
+    const T *tc_ptr = nullptr;
+    if (m_compress) {
+        const auto *f32_ptr = m_tcs_f32[chunk_idx].data() + offset;
+        std::transform(f32_ptr, f32_ptr + tc_size, m_tc_tmp.begin(), [](float x) { return static_cast<T>(x); });
+        tc_ptr = m_tc_tmp.data();
+    } else {
+        tc_ptr = m_tcs[chunk_idx].data() + offset;
+    }
 
-template <typename T>
-nt_event_impl<T> &nt_event_impl<T>::operator=(const nt_event_impl<T> &) = default;
+    // NOTE: the time coordinate for the evaluation
+    // is relative to the initial time of the step.
+    const auto h = t - dfloat<T>(m_times_hi[idx], m_times_lo[idx]);
 
-template <typename T>
-nt_event_impl<T> &nt_event_impl<T>::operator=(nt_event_impl<T> &&) noexcept = default;
+    m_d_out_f(m_output.data(), tc_ptr, &h.hi);
 
-template <typename T>
-nt_event_impl<T>::~nt_event_impl() = default;
+    return m_output;
+}
 
 template <typename T>
-const expression &nt_event_impl<T>::get_expression() const
+void continuous_output_impl<T>::clear()
 {
-    return eq;
+    // NOTE: keep the chunks around
+    // for the next recorded steps.
+    m_n_steps = 0;
 }
 
 template <typename T>
-const typename nt_event_impl<T>::callback_t &nt_event_impl<T>::get_callback() const
+std::pair<std::vector<T>, std::vector<T>> continuous_output_impl<T>::sample(T tol)
 {
-    return callback;
+    using std::abs;
+    using std::isfinite;
+
+    if (m_n_steps == 0u) {
+        throw std::invalid_argument("Cannot sample an empty continuous output");
+    }
+
+    if (!isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance for the adaptive sampling of a continuous output must be finite and positive, but it is {} "
+            "instead"_format(tol));
+    }
+
+    // NOTE: cap the number of bisections of each step, so
+    // that sampling terminates also when tol cannot be reached
+    // due to roundoff (at most 2**16 intervals per step).
+    constexpr unsigned max_depth = 16;
+
+    const auto tc_size = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+
+    std::vector<T> times, states;
+
+    // Buffers for the states at the endpoints and
+    // at the quarter points of an interval.
+    std::vector<T> y_a(m_dim), y_b(m_dim), y_q(m_dim);
+
+    // Evaluation of the Taylor series of the current
+    // step via the Horner scheme.
+    const T *tc_ptr = nullptr;
+    auto eval = [this, &tc_ptr](T h, std::vector<T> &out) {
+        for (std::uint32_t i = 0; i < m_dim; ++i) {
+            const auto *tc = tc_ptr + static_cast<std::size_t>(i) * (m_order + 1u);
+
+            T val = tc[m_order];
+            for (std::uint32_t o = 1; o <= m_order; ++o) {
+                val = tc[m_order - o] + val * h;
+            }
+
+            out[i] = val;
+        }
+    };
+
+    // The intervals (in the time coordinates local to the step)
+    // pending evaluation, with their bisection depth.
+    std::vector<std::tuple<T, T, unsigned>> stack;
+
+    for (std::size_t idx = 0; idx < m_n_steps; ++idx) {
+        const auto chunk_idx = idx / m_chunk_size;
+        const auto offset = (idx % m_chunk_size) * tc_size;
+
+        if (m_compress) {
+            const auto *f32_ptr = m_tcs_f32[chunk_idx].data() + offset;
+            std::transform(f32_ptr, f32_ptr + tc_size, m_tc_tmp.begin(), [](float x) { return static_cast<T>(x); });
+            tc_ptr = m_tc_tmp.data();
+        } else {
+            tc_ptr = m_tcs[chunk_idx].data() + offset;
+        }
+
+        const auto t0 = dfloat<T>(m_times_hi[idx], m_times_lo[idx]);
+
+        // NOTE: the initial time of a step is the final time
+        // of the previous step, hence it is added only for
+        // the first step.
+        if (idx == 0u) {
+            eval(T(0), y_a);
+            times.push_back(m_times_hi[0]);
+            states.insert(states.end(), y_a.begin(), y_a.end());
+        }
+
+        // NOTE: the intervals are processed left-to-right
+        // (in the direction of time), so that the samples
+        // are produced in chronological order.
+        stack.clear();
+        stack.emplace_back(T(0), m_hs[idx], 0u);
+
+        while (!stack.empty()) {
+            const auto [a, b, depth] = stack.back();
+            stack.pop_back();
+
+            eval(a, y_a);
+            eval(b, y_b);
+
+            // Check the error of the linear interpolation
+            // at the quarter points.
+            auto accept = depth == max_depth;
+            if (!accept) {
+                accept = true;
+
+                for (auto q = 1; q <= 3 && accept; ++q) {
+                    const auto w = T(q) / 4;
+                    eval(a + (b - a) * w, y_q);
+
+                    for (std::uint32_t i = 0; i < m_dim; ++i) {
+                        // NOTE: a non-finite error rejects the interval.
+                        if (!(abs(y_q[i] - (y_a[i] + (y_b[i] - y_a[i]) * w)) <= tol)) {
+                            accept = false;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (accept) {
+                times.push_back(static_cast<T>(t0 + b));
+                states.insert(states.end(), y_b.begin(), y_b.end());
+            } else {
+                const auto mid = a + (b - a) / 2;
+
+                stack.emplace_back(mid, b, depth + 1u);
+                stack.emplace_back(a, mid, depth + 1u);
+            }
+        }
+    }
+
+    return {std::move(times), std::move(states)};
 }
 
+namespace
+{
+
+// The header of the ephemeris files.
+// NOTE: the data arrays are stored after the header,
+// with offsets which are multiples of ephemeris_align.
+struct ephemeris_header {
+    char magic[8];
+    std::uint32_t version;
+    // Marker to detect a mismatched byte order.
+    std::uint32_t endian_tag;
+    // Floating-point format of the data.
+    std::uint32_t fp_tag;
+    std::uint32_t fp_size;
+    std::uint32_t dim;
+    std::uint32_t order;
+    std::uint64_t n_steps;
+    // Offsets of the initial times (hi and lo parts), of the
+    // sizes of the steps and of the Taylor coefficients.
+    std::uint64_t offsets[4];
+};
+
+constexpr char ephemeris_magic[8] = {'h', 'e', 'y', 'o', 'k', 'a', 'e', 'p'};
+constexpr std::uint32_t ephemeris_version = 1;
+constexpr std::uint32_t ephemeris_endian_tag = 0x01020304;
+constexpr std::uint64_t ephemeris_align = 64;
+
 template <typename T>
-event_direction nt_event_impl<T>::get_direction() const
+constexpr std::uint32_t ephemeris_fp_tag()
 {
-    return dir;
+    if constexpr (std::is_same_v<T, double>) {
+        return 0;
+    } else if constexpr (std::is_same_v<T, long double>) {
+        return 1;
+#if defined(HEYOKA_HAVE_REAL128)
+    } else if constexpr (std::is_same_v<T, mppp::real128>) {
+        return 2;
+#endif
+    } else {
+        static_assert(always_false_v<T>, "Unhandled type.");
+    }
 }
 
-namespace
+// Round up off to the next multiple of ephemeris_align.
+std::uint64_t ephemeris_round_up(std::uint64_t off)
 {
+    // LCOV_EXCL_START
+    if (off > std::numeric_limits<std::uint64_t>::max() - ephemeris_align) {
+        throw std::overflow_error("Overflow detected in the computation of the layout of an ephemeris file");
+    }
+    // LCOV_EXCL_STOP
 
-// Implementation of stream insertion for the non-terminal event class.
-std::ostream &nt_event_impl_stream_impl(std::ostream &os, const expression &eq, event_direction dir)
+    return (off + ephemeris_align - 1u) / ephemeris_align * ephemeris_align;
+}
+
+// Compute the offsets of the data arrays of an ephemeris file.
+// The last element of the return value is the total size of the file.
+template <typename T>
+std::array<std::uint64_t, 5> ephemeris_offsets(std::uint32_t dim, std::uint32_t order, std::uint64_t n_steps)
 {
-    os << "Event type     : non-terminal\n";
-    os << "Event equation : " << eq << '\n';
-    os << "Event direction: " << dir << '\n';
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
 
-    return os;
+    // LCOV_EXCL_START
+    if (n_steps > max / sizeof(T)
+        || static_cast<std::uint64_t>(dim) * (order + 1ull) > max / (n_steps * sizeof(T))) {
+        throw std::overflow_error("Overflow detected in the computation of the layout of an ephemeris file");
+    }
+    // LCOV_EXCL_STOP
+
+    const auto times_size = n_steps * sizeof(T);
+    const auto tcs_size = static_cast<std::uint64_t>(dim) * (order + 1ull) * n_steps * sizeof(T);
+
+    std::array<std::uint64_t, 5> retval{};
+    retval[0] = ephemeris_round_up(sizeof(ephemeris_header));
+    for (auto i = 1u; i < 4u; ++i) {
+        retval[i] = ephemeris_round_up(retval[i - 1u] + times_size);
+    }
+
+    // LCOV_EXCL_START
+    if (retval[3] > max - tcs_size) {
+        throw std::overflow_error("Overflow detected in the computation of the layout of an ephemeris file");
+    }
+    // LCOV_EXCL_STOP
+    retval[4] = retval[3] + tcs_size;
+
+    return retval;
 }
 
 } // namespace
 
-template <>
-std::ostream &operator<<(std::ostream &os, const nt_event_impl<double> &e)
-{
-    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
+template <typename T>
+void write_ephemeris_file(const std::string &path, std::uint32_t dim, std::uint32_t order, std::uint64_t n_steps,
+                          const T *times_hi, const T *times_lo, const T *hs,
+                          const std::function<void(std::ostream &)> &write_tcs)
+{
+    const auto offsets = ephemeris_offsets<T>(dim, order, n_steps);
+
+    // Setup the header.
+    ephemeris_header h{};
+    std::copy(std::begin(ephemeris_magic), std::end(ephemeris_magic), h.magic);
+    h.version = ephemeris_version;
+    h.endian_tag = ephemeris_endian_tag;
+    h.fp_tag = ephemeris_fp_tag<T>();
+    h.fp_size = static_cast<std::uint32_t>(sizeof(T));
+    h.dim = dim;
+    h.order = order;
+    h.n_steps = n_steps;
+    std::copy(offsets.begin(), offsets.begin() + 4, h.offsets);
+
+    // NOTE: write first to a temporary file and then rename it,
+    // so that concurrent readers (possibly in other processes)
+    // never see a partially-written ephemeris file.
+    const auto tmp_path = "{}.tmp{}"_format(path, std::random_device{}());
+
+    {
+        std::ofstream ofs(tmp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs) {
+            throw std::invalid_argument("Unable to open the file '{}' for writing an ephemeris"_format(tmp_path));
+        }
+
+        // Helper to write zero padding up to the offset off.
+        auto pad_to = [&ofs](std::uint64_t off) {
+            const auto cur = boost::numeric_cast<std::uint64_t>(static_cast<std::streamoff>(ofs.tellp()));
+            assert(off >= cur);
+            const std::vector<char> zeros(boost::numeric_cast<std::vector<char>::size_type>(off - cur));
+            ofs.write(zeros.data(), boost::numeric_cast<std::streamsize>(zeros.size()));
+        };
+
+        // Helper to write the first n_steps values of an array.
+        auto write_arr = [&ofs, n_steps](const T *ptr) {
+            ofs.write(reinterpret_cast<const char *>(ptr), boost::numeric_cast<std::streamsize>(n_steps * sizeof(T)));
+        };
+
+        ofs.write(reinterpret_cast<const char *>(&h), sizeof(h));
+
+        pad_to(offsets[0]);
+        write_arr(times_hi);
+        pad_to(offsets[1]);
+        write_arr(times_lo);
+        pad_to(offsets[2]);
+        write_arr(hs);
+        pad_to(offsets[3]);
+
+        try {
+            write_tcs(ofs);
+        } catch (...) {
+            ofs.close();
+            std::remove(tmp_path.c_str());
+            throw;
+        }
+
+        // Check that the expected amount of data was written.
+        if (ofs && boost::numeric_cast<std::uint64_t>(static_cast<std::streamoff>(ofs.tellp())) != offsets[4]) {
+            ofs.close();
+            std::remove(tmp_path.c_str());
+            throw std::invalid_argument(
+                "Inconsistent amount of Taylor coefficients written into the ephemeris file '{}'"_format(tmp_path));
+        }
+
+        ofs.close();
+
+        if (!ofs) {
+            std::remove(tmp_path.c_str());
+            throw std::invalid_argument("Error writing the ephemeris file '{}'"_format(tmp_path));
+        }
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::invalid_argument("Unable to rename the temporary file '{}' to '{}'"_format(tmp_path, path));
+    }
 }
 
-template <>
-std::ostream &operator<<(std::ostream &os, const nt_event_impl<long double> &e)
+template <typename T>
+void continuous_output_impl<T>::save_ephemeris(const std::string &path) const
 {
-    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
-}
+    if (m_n_steps == 0u) {
+        throw std::invalid_argument("Cannot save an empty continuous output into an ephemeris file");
+    }
 
-#if defined(HEYOKA_HAVE_REAL128)
+    // Write the Taylor coefficients, decompressing them if needed.
+    auto write_tcs = [this](std::ostream &os) {
+        const auto tc_size = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+        std::vector<T> tmp;
+        if (m_compress) {
+            tmp.resize(tc_size);
+        }
 
-template <>
-std::ostream &operator<<(std::ostream &os, const nt_event_impl<mppp::real128> &e)
-{
-    return nt_event_impl_stream_impl(os, e.get_expression(), e.get_direction());
-}
+        for (std::size_t i = 0; i < m_n_steps; ++i) {
+            const auto chunk_idx = i / m_chunk_size;
+            const auto offset = (i % m_chunk_size) * tc_size;
 
-#endif
+            const T *ptr = nullptr;
+            if (m_compress) {
+                const auto *f32_ptr = m_tcs_f32[chunk_idx].data() + offset;
+                std::transform(f32_ptr, f32_ptr + tc_size, tmp.begin(), [](float x) { return static_cast<T>(x); });
+                ptr = tmp.data();
+            } else {
+                ptr = m_tcs[chunk_idx].data() + offset;
+            }
+
+            os.write(reinterpret_cast<const char *>(ptr), boost::numeric_cast<std::streamsize>(tc_size * sizeof(T)));
+        }
+    };
+
+    write_ephemeris_file<T>(path, m_dim, m_order, boost::numeric_cast<std::uint64_t>(m_n_steps), m_times_hi.data(),
+                            m_times_lo.data(), m_hs.data(), write_tcs);
+}
 
 template <typename T>
-void t_event_impl<T>::finalise_ctor(callback_t cb, T cd, event_direction d)
+void ephemeris_impl<T>::finalise_ctor_impl(std::string path, bool high_accuracy)
 {
-    using std::isfinite;
+    // Map the file into memory.
+    // NOTE: the file does not need to be null-terminated,
+    // this allows LLVM to memory-map it.
+#if LLVM_VERSION_MAJOR < 13
+    auto ret = llvm::MemoryBuffer::getFile(path, -1, false);
+#else
+    auto ret = llvm::MemoryBuffer::getFile(path, false, false);
+#endif
+    if (!ret) {
+        throw std::invalid_argument(
+            "Unable to open the ephemeris file '{}': {}"_format(path, ret.getError().message()));
+    }
+    std::shared_ptr<const llvm::MemoryBuffer> buffer(std::move(*ret));
 
-    callback = std::move(cb);
+    const auto *const base = buffer->getBufferStart();
+    const auto size = static_cast<std::uint64_t>(buffer->getBufferSize());
 
-    if (!isfinite(cd)) {
-        throw std::invalid_argument("Cannot set a non-finite cooldown value for a terminal event");
+    // Read and validate the header.
+    ephemeris_header h{};
+    if (size < sizeof(h)) {
+        throw std::invalid_argument("The file '{}' is too small to be an ephemeris file"_format(path));
     }
-    cooldown = cd;
+    std::memcpy(&h, base, sizeof(h));
 
-    if (d < event_direction::negative || d > event_direction::positive) {
-        throw std::invalid_argument("Invalid value selected for the direction of a terminal event");
+    if (!std::equal(std::begin(ephemeris_magic), std::end(ephemeris_magic), h.magic)) {
+        throw std::invalid_argument("The file '{}' is not an ephemeris file"_format(path));
     }
-    dir = d;
+    if (h.endian_tag != ephemeris_endian_tag) {
+        throw std::invalid_argument(
+            "The ephemeris file '{}' was written on a machine with a different byte order"_format(path));
+    }
+    if (h.version != ephemeris_version) {
+        throw std::invalid_argument(
+            "The ephemeris file '{}' has version {}, but only version {} is supported"_format(path, h.version,
+                                                                                              ephemeris_version));
+    }
+    if (h.fp_tag != ephemeris_fp_tag<T>() || h.fp_size != sizeof(T)) {
+        throw std::invalid_argument(
+            "The ephemeris file '{}' contains data in a floating-point format different from the requested one"_format(
+                path));
+    }
+    if (h.dim == 0u || h.order == 0u || h.n_steps == 0u) {
+        throw std::invalid_argument("The ephemeris file '{}' has an invalid header"_format(path));
+    }
+
+    // Check the layout.
+    const auto offsets = ephemeris_offsets<T>(h.dim, h.order, h.n_steps);
+    if (!std::equal(offsets.begin(), offsets.begin() + 4, h.offsets) || offsets[4] > size) {
+        throw std::invalid_argument("The ephemeris file '{}' has an invalid layout"_format(path));
+    }
+
+    // NOTE: memory-mapped buffers are page-aligned, while the other
+    // buffers are allocated by LLVM with an alignment of at least 16 bytes.
+    // LCOV_EXCL_START
+    if (reinterpret_cast<std::uintptr_t>(base) % alignof(T) != 0u) {
+        throw std::invalid_argument("The data of the ephemeris file '{}' is misaligned in memory"_format(path));
+    }
+    // LCOV_EXCL_STOP
+
+    m_path = std::move(path);
+    m_dim = h.dim;
+    m_order = h.order;
+    m_n_steps = boost::numeric_cast<std::size_t>(h.n_steps);
+    m_times_hi = reinterpret_cast<const T *>(base + offsets[0]);
+    m_times_lo = reinterpret_cast<const T *>(base + offsets[1]);
+    m_hs = reinterpret_cast<const T *>(base + offsets[2]);
+    m_tcs = reinterpret_cast<const T *>(base + offsets[3]);
+    m_buffer = std::move(buffer);
+
+    // Add the function for the evaluation of the Taylor series.
+    taylor_add_d_out_function<T>(m_llvm, m_dim, m_order, 1, high_accuracy);
+
+    m_llvm.optimise();
+
+    m_llvm.compile();
+
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+
+    m_output.resize(boost::numeric_cast<decltype(m_output.size())>(m_dim));
 }
 
 template <typename T>
-t_event_impl<T>::t_event_impl(const t_event_impl &) = default;
+ephemeris_impl<T>::ephemeris_impl(const ephemeris_impl &other)
+    // NOTE: make a manual copy of all members, apart from the function pointer.
+    // The mapped file is shared with other.
+    : m_llvm(other.m_llvm), m_path(other.m_path), m_buffer(other.m_buffer), m_dim(other.m_dim),
+      m_order(other.m_order), m_n_steps(other.m_n_steps), m_times_hi(other.m_times_hi),
+      m_times_lo(other.m_times_lo), m_hs(other.m_hs), m_tcs(other.m_tcs), m_output(other.m_output)
+{
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+}
 
 template <typename T>
-t_event_impl<T>::t_event_impl(t_event_impl &&) noexcept = default;
+ephemeris_impl<T>::ephemeris_impl(ephemeris_impl &&) noexcept = default;
 
 template <typename T>
-t_event_impl<T> &t_event_impl<T>::operator=(const t_event_impl<T> &) = default;
+ephemeris_impl<T> &ephemeris_impl<T>::operator=(const ephemeris_impl &other)
+{
+    if (this != &other) {
+        *this = ephemeris_impl(other);
+    }
 
-template <typename T>
-t_event_impl<T> &t_event_impl<T>::operator=(t_event_impl<T> &&) noexcept = default;
+    return *this;
+}
 
 template <typename T>
-t_event_impl<T>::~t_event_impl() = default;
+ephemeris_impl<T> &ephemeris_impl<T>::operator=(ephemeris_impl &&) noexcept = default;
 
 template <typename T>
-const expression &t_event_impl<T>::get_expression() const
-{
-    return eq;
-}
+ephemeris_impl<T>::~ephemeris_impl() = default;
 
 template <typename T>
-const typename t_event_impl<T>::callback_t &t_event_impl<T>::get_callback() const
+const llvm_state &ephemeris_impl<T>::get_llvm_state() const
 {
-    return callback;
+    return m_llvm;
 }
 
 template <typename T>
-event_direction t_event_impl<T>::get_direction() const
+const std::string &ephemeris_impl<T>::get_path() const
 {
-    return dir;
+    return m_path;
 }
 
 template <typename T>
-T t_event_impl<T>::get_cooldown() const
+std::uint32_t ephemeris_impl<T>::get_dim() const
 {
-    return cooldown;
+    return m_dim;
 }
 
-namespace
-{
-
-// Implementation of stream insertion for the terminal event class.
-template <typename C, typename T>
-std::ostream &t_event_impl_stream_impl(std::ostream &os, const expression &eq, event_direction dir, const C &callback,
-                                       const T &cooldown)
+template <typename T>
+std::uint32_t ephemeris_impl<T>::get_order() const
 {
-    os << "Event type     : terminal\n";
-    os << "Event equation : " << eq << '\n';
-    os << "Event direction: " << dir << '\n';
-    os << "With callback  : " << (callback ? "yes" : "no") << '\n';
-    os << "Cooldown       : " << (cooldown < 0 ? "auto" : "{}"_format(cooldown)) << '\n';
-
-    return os;
+    return m_order;
 }
 
-} // namespace
-
-template <>
-std::ostream &operator<<(std::ostream &os, const t_event_impl<double> &e)
+template <typename T>
+std::size_t ephemeris_impl<T>::get_n_steps() const
 {
-    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
+    return m_n_steps;
 }
 
-template <>
-std::ostream &operator<<(std::ostream &os, const t_event_impl<long double> &e)
+template <typename T>
+std::pair<T, T> ephemeris_impl<T>::get_bounds() const
 {
-    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
-}
+    const auto last = m_n_steps - 1u;
 
-#if defined(HEYOKA_HAVE_REAL128)
+    return {m_times_hi[0], static_cast<T>(dfloat<T>(m_times_hi[last], m_times_lo[last]) + m_hs[last])};
+}
 
-template <>
-std::ostream &operator<<(std::ostream &os, const t_event_impl<mppp::real128> &e)
+template <typename T>
+const std::vector<T> &ephemeris_impl<T>::operator()(T t)
 {
-    return t_event_impl_stream_impl(os, e.get_expression(), e.get_direction(), e.get_callback(), e.get_cooldown());
-}
+    using std::isfinite;
 
-#endif
+    if (!isfinite(t)) {
+        throw std::invalid_argument("Cannot compute the state of the system from an ephemeris at a non-finite time");
+    }
+
+    const auto idx = c_output_find_step(m_times_hi, m_n_steps, m_hs[0] > 0, t);
+
+    // NOTE: the Taylor coefficients are read
+    // directly from the mapped file.
+    const auto tc_size = static_cast<std::size_t>(m_dim) * (m_order + 1u);
+    const auto h = t - dfloat<T>(m_times_hi[idx], m_times_lo[idx]);
+
+    m_d_out_f(m_output.data(), m_tcs + idx * tc_size, &h.hi);
+
+    return m_output;
+}
 
 // Explicit instantiation of the implementation classes/functions.
 // NOTE: on Windows apparently it is necessary to declare that
 // these instantiations are meant to be dll-exported.
 template class taylor_adaptive_impl<double>;
-template class nt_event_impl<double>;
-template class t_event_impl<double>;
-
-template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(std::vector<expression>,
-                                                                                 std::vector<double>, double, double,
-                                                                                 bool, bool, std::vector<double>,
-                                                                                 std::vector<t_event_t>,
-                                                                                 std::vector<nt_event_t>);
-
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>, std::vector<double>,
-                                                 double, double, bool, bool, std::vector<double>,
-                                                 std::vector<t_event_t>, std::vector<nt_event_t>);
+template class continuous_output_impl<double>;
+template class ephemeris_impl<double>;
+template void write_ephemeris_file<double>(const std::string &, std::uint32_t, std::uint32_t, std::uint64_t,
+                                           const double *, const double *, const double *,
+                                           const std::function<void(std::ostream &)> &);
+template class nt_event_impl<double, false>;
+template class nt_event_impl<double, true>;
+template class t_event_impl<double, false>;
+template class t_event_impl<double, true>;
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<double>, double, double, bool, bool, bool, std::vector<double>,
+    std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool, std::uint32_t, bool,
+    std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<double>, double, double, bool, bool, bool,
+    std::vector<double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<double>::finalise_ctor_impl(
+    taylor_precomputed_dc, std::vector<double>, double, double, bool, bool, bool, std::vector<double>,
+    std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool, std::uint32_t, bool,
+    std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, double, double, std::size_t, std::vector<double>>
+taylor_adaptive_impl<double>::propagate_grid_impl<double>(const std::vector<double> &, std::size_t, double,
+                                                          propagate_cb_t, const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, double, double, std::size_t, std::size_t>
+taylor_adaptive_impl<double>::propagate_grid_impl<double>(const std::vector<double> &, std::size_t, double,
+                                                          propagate_cb_t, double *, const std::vector<std::uint32_t> &,
+                                                          std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, double, double, std::size_t, std::vector<float>>
+taylor_adaptive_impl<double>::propagate_grid_impl<float>(const std::vector<double> &, std::size_t, double,
+                                                         propagate_cb_t, const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, double, double, std::size_t, std::size_t>
+taylor_adaptive_impl<double>::propagate_grid_impl<float>(const std::vector<double> &, std::size_t, double,
+                                                         propagate_cb_t, float *, const std::vector<std::uint32_t> &,
+                                                         std::size_t);
 
 template class taylor_adaptive_impl<long double>;
-template class nt_event_impl<long double>;
-template class t_event_impl<long double>;
+template class continuous_output_impl<long double>;
+template class ephemeris_impl<long double>;
+template void write_ephemeris_file<long double>(const std::string &, std::uint32_t, std::uint32_t, std::uint64_t,
+                                                const long double *, const long double *, const long double *,
+                                                const std::function<void(std::ostream &)> &);
+template class nt_event_impl<long double, false>;
+template class nt_event_impl<long double, true>;
+template class t_event_impl<long double, false>;
+template class t_event_impl<long double, true>;
 
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_impl<long double>::finalise_ctor_impl(std::vector<expression>, std::vector<long double>, long double,
-                                                      long double, bool, bool, std::vector<long double>,
-                                                      std::vector<t_event_t>, std::vector<nt_event_t>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<long double>, long double, long double, bool, bool, bool,
+    std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
 
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(
     std::vector<std::pair<expression, expression>>, std::vector<long double>, long double, long double, bool, bool,
-    std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>);
+    bool, std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<long double>::finalise_ctor_impl(
+    taylor_precomputed_dc, std::vector<long double>, long double, long double, bool, bool, bool,
+    std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t, std::vector<long double>>
+taylor_adaptive_impl<long double>::propagate_grid_impl<long double>(const std::vector<long double> &, std::size_t,
+                                                                    long double, propagate_cb_t,
+                                                                    const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t, std::size_t>
+taylor_adaptive_impl<long double>::propagate_grid_impl<long double>(const std::vector<long double> &, std::size_t,
+                                                                    long double, propagate_cb_t, long double *,
+                                                                    const std::vector<std::uint32_t> &, std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t, std::vector<float>>
+taylor_adaptive_impl<long double>::propagate_grid_impl<float>(const std::vector<long double> &, std::size_t,
+                                                              long double, propagate_cb_t,
+                                                              const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t, std::size_t>
+taylor_adaptive_impl<long double>::propagate_grid_impl<float>(const std::vector<long double> &, std::size_t,
+                                                              long double, propagate_cb_t, float *,
+                                                              const std::vector<std::uint32_t> &, std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t, std::vector<double>>
+taylor_adaptive_impl<long double>::propagate_grid_impl<double>(const std::vector<long double> &, std::size_t,
+                                                               long double, propagate_cb_t,
+                                                               const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, long double, long double, std::size_t, std::size_t>
+taylor_adaptive_impl<long double>::propagate_grid_impl<double>(const std::vector<long double> &, std::size_t,
+                                                               long double, propagate_cb_t, double *,
+                                                               const std::vector<std::uint32_t> &, std::size_t);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template class taylor_adaptive_impl<mppp::real128>;
-template class nt_event_impl<mppp::real128>;
-template class t_event_impl<mppp::real128>;
+template class continuous_output_impl<mppp::real128>;
+template class ephemeris_impl<mppp::real128>;
+template void write_ephemeris_file<mppp::real128>(const std::string &, std::uint32_t, std::uint32_t, std::uint64_t,
+                                                  const mppp::real128 *, const mppp::real128 *, const mppp::real128 *,
+                                                  const std::function<void(std::ostream &)> &);
+template class nt_event_impl<mppp::real128, false>;
+template class nt_event_impl<mppp::real128, true>;
+template class t_event_impl<mppp::real128, false>;
+template class t_event_impl<mppp::real128, true>;
 
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
-    std::vector<expression>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool, bool,
-    std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>);
+    std::vector<expression>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool, bool, bool,
+    std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
 
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
     std::vector<std::pair<expression, expression>>, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool,
-    bool, std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>);
+    bool, bool, std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool,
+    bool, std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ctor_impl(
+    taylor_precomputed_dc, std::vector<mppp::real128>, mppp::real128, mppp::real128, bool, bool, bool,
+    std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool);
+
+template HEYOKA_DLL_PUBLIC
+    std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t, std::vector<mppp::real128>>
+taylor_adaptive_impl<mppp::real128>::propagate_grid_impl<mppp::real128>(const std::vector<mppp::real128> &, std::size_t,
+                                                                        mppp::real128, propagate_cb_t,
+                                                                        const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t, std::size_t>
+taylor_adaptive_impl<mppp::real128>::propagate_grid_impl<mppp::real128>(const std::vector<mppp::real128> &, std::size_t,
+                                                                        mppp::real128, propagate_cb_t, mppp::real128 *,
+                                                                        const std::vector<std::uint32_t> &,
+                                                                        std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t, std::vector<float>>
+taylor_adaptive_impl<mppp::real128>::propagate_grid_impl<float>(const std::vector<mppp::real128> &, std::size_t,
+                                                                mppp::real128, propagate_cb_t,
+                                                                const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t, std::size_t>
+taylor_adaptive_impl<mppp::real128>::propagate_grid_impl<float>(const std::vector<mppp::real128> &, std::size_t,
+                                                                mppp::real128, propagate_cb_t, float *,
+                                                                const std::vector<std::uint32_t> &, std::size_t);
+
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t, std::vector<double>>
+taylor_adaptive_impl<mppp::real128>::propagate_grid_impl<double>(const std::vector<mppp::real128> &, std::size_t,
+                                                                 mppp::real128, propagate_cb_t,
+                                                                 const std::vector<std::uint32_t> &);
+template HEYOKA_DLL_PUBLIC std::tuple<taylor_outcome, mppp::real128, mppp::real128, std::size_t, std::size_t>
+taylor_adaptive_impl<mppp::real128>::propagate_grid_impl<double>(const std::vector<mppp::real128> &, std::size_t,
+                                                                 mppp::real128, propagate_cb_t, double *,
+                                                                 const std::vector<std::uint32_t> &, std::size_t);
 
 #endif
 
@@ -4270,25 +9784,175 @@ template HEYOKA_DLL_PUBLIC void taylor_adaptive_impl<mppp::real128>::finalise_ct
 namespace detail
 {
 
+namespace
+{
+
+// Helper to replicate the values in v for each element of a batch,
+// i.e., to transform v into a vector in batch layout.
+template <typename T>
+std::vector<T> taylor_batch_splat(const std::vector<T> &v, std::uint32_t batch_size)
+{
+    std::vector<T> retval;
+    retval.reserve(v.size() * batch_size);
+
+    for (const auto &x : v) {
+        retval.insert(retval.end(), batch_size, x);
+    }
+
+    return retval;
+}
+
+// Helper to select the batch size of an adaptive Taylor integrator in
+// automatic batch size mode. The selected batch size is the recommended
+// SIMD width for T. If tune is true, a short benchmark of the stepper is run
+// for 1x, 2x and 4x the recommended width (as a larger batch may hide latencies,
+// while register pressure may make it slower for large systems), and the batch
+// size with the highest throughput is selected. state and pars are the values
+// for a single batch element.
+template <typename T, typename U>
+std::uint32_t taylor_auto_batch_size(const llvm_state &s, const U &sys, const std::vector<T> &state,
+                                     const std::vector<T> &pars, T tol, bool high_accuracy, bool compact_mode,
+                                     bool parallel_mode, std::uint32_t unroll_threshold, bool contiguous_jets,
+                                     bool tune)
+{
+    const auto w = recommended_simd_size<T>();
+
+    if (!tune) {
+        return w;
+    }
+
+    // NOTE: the number of steps in the benchmark.
+    constexpr unsigned n_bench_steps = 20;
+
+    auto best = w;
+    auto best_time = std::numeric_limits<double>::infinity();
+
+    for (auto mult : {1u, 2u, 4u}) {
+        const auto bs = w * mult;
+
+        // NOTE: copy s in order to fetch its options.
+        auto ls = s;
+        taylor_add_adaptive_step<T>(ls, "step", sys, tol, bs, high_accuracy, compact_mode, parallel_mode,
+                                    unroll_threshold, contiguous_jets);
+        ls.compile();
+
+        auto *step_f = reinterpret_cast<void (*)(T *, const T *, const T *, T *, T *)>(ls.jit_lookup("step"));
+
+        auto b_state = taylor_batch_splat(state, bs);
+        const auto b_pars = taylor_batch_splat(pars, bs);
+        const std::vector<T> b_time(bs, T(0));
+        std::vector<T> b_h(bs);
+
+        // NOTE: run a first step for warmup.
+        b_h.assign(bs, std::numeric_limits<T>::infinity());
+        step_f(b_state.data(), b_pars.data(), b_time.data(), b_h.data(), nullptr);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < n_bench_steps; ++i) {
+            b_h.assign(bs, std::numeric_limits<T>::infinity());
+            step_f(b_state.data(), b_pars.data(), b_time.data(), b_h.data(), nullptr);
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Time per batch element.
+        const auto cur_time = elapsed / static_cast<double>(bs);
+
+        get_logger()->trace("batch size auto-tuning: batch size {}, time per element {}s", bs,
+                            cur_time / n_bench_steps);
+
+        if (cur_time < best_time) {
+            best_time = cur_time;
+            best = bs;
+        }
+    }
+
+    get_logger()->debug("batch size auto-tuning: selected batch size {}", best);
+
+    return best;
+}
+
+} // namespace
+
 template <typename T>
 template <typename U>
 void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> state, std::uint32_t batch_size,
                                                        std::vector<T> time, T tol, bool high_accuracy,
-                                                       bool compact_mode, std::vector<T> pars)
+                                                       bool compact_mode, bool parallel_mode, std::vector<T> pars,
+                                                       std::vector<t_event_t> tes, std::vector<nt_event_t> ntes,
+                                                       bool tune_batch_size, std::uint32_t unroll_threshold,
+                                                       bool contiguous_jets, bool fused_step, std::uint32_t dl_order,
+                                                       bool skip_one_way, std::vector<expression> h_vars,
+                                                       std::vector<expression> ha_vars, std::uint32_t order,
+                                                       bool tune_order, std::vector<T> lane_tols)
 {
     using std::isfinite;
 
+    trace_span span("taylor_adaptive_batch::ctor", "taylor");
+
+    const auto ctor_t0 = std::chrono::steady_clock::now();
+
+    if (batch_size == 0u) {
+        // Automatic batch size mode: the state, time and parameter
+        // values refer to a single batch element, and they are
+        // replicated for all the elements of the batch.
+        if (state.size() != taylor_sys_size(sys)) {
+            throw std::invalid_argument(
+                "Inconsistent sizes detected in the initialization of an adaptive Taylor "
+                "integrator in automatic batch size mode: the state vector has a size of {}, "
+                "while the number of equations is {}"_format(state.size(), taylor_sys_size(sys)));
+        }
+
+        if (time.size() != 1u) {
+            throw std::invalid_argument(
+                "Invalid size detected in the initialization of an adaptive Taylor "
+                "integrator in automatic batch size mode: the time vector has a size of {}, "
+                "but a size of 1 is required"_format(time.size()));
+        }
+
+        const auto npars = n_pars_in_sys(sys);
+        if (pars.size() > npars) {
+            throw std::invalid_argument(
+                "Excessive number of parameter values passed to the constructor of an adaptive "
+                "Taylor integrator in automatic batch size mode: {} parameter values were passed, but the ODE "
+                "system contains only {} parameters"_format(pars.size(), npars));
+        }
+        pars.resize(boost::numeric_cast<decltype(pars.size())>(npars));
+
+        if (!lane_tols.empty()) {
+            throw std::invalid_argument("The tolerances of the batch elements cannot be specified in an adaptive "
+                                        "Taylor integrator in automatic batch size mode");
+        }
+
+        // NOTE: check the tolerance here, as it is
+        // needed by the auto-tuning machinery.
+        if (!isfinite(tol) || tol <= 0) {
+            throw std::invalid_argument(
+                "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is {} instead"_format(
+                    tol));
+        }
+
+        batch_size = taylor_auto_batch_size<T>(*m_llvm, sys, state, pars, tol, high_accuracy, compact_mode,
+                                               parallel_mode, unroll_threshold, contiguous_jets, tune_batch_size);
+
+        state = taylor_batch_splat(state, batch_size);
+        time = taylor_batch_splat(time, batch_size);
+        pars = taylor_batch_splat(pars, batch_size);
+    } else if (tune_batch_size) {
+        throw std::invalid_argument("The batch size of an adaptive Taylor integrator can be tuned only in "
+                                    "automatic batch size mode (i.e., if the batch size is zero)");
+    }
+
     // Init the data members.
     m_batch_size = batch_size;
     m_state = std::move(state);
     m_time_hi = std::move(time);
     m_time_lo.resize(m_time_hi.size());
     m_pars = std::move(pars);
+    m_tes = std::move(tes);
+    m_ntes = std::move(ntes);
 
     // Check input params.
-    if (m_batch_size == 0u) {
-        throw std::invalid_argument("The batch size in an adaptive Taylor integrator cannot be zero");
-    }
+    assert(m_batch_size > 0u);
 
     if (std::any_of(m_state.begin(), m_state.end(), [](const auto &x) { return !isfinite(x); })) {
         throw std::invalid_argument(
@@ -4302,11 +9966,12 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
                 m_state.size(), m_batch_size));
     }
 
-    if (m_state.size() / m_batch_size != sys.size()) {
+    if (m_state.size() / m_batch_size != taylor_sys_size(sys)) {
         throw std::invalid_argument(
             "Inconsistent sizes detected in the initialization of an adaptive Taylor "
             "integrator: the state vector has a dimension of {} and a batch size of {}, "
-            "while the number of equations is {}"_format(m_state.size() / m_batch_size, m_batch_size, sys.size()));
+            "while the number of equations is {}"_format(m_state.size() / m_batch_size, m_batch_size,
+                                                          taylor_sys_size(sys)));
     }
 
     if (m_time_hi.size() != m_batch_size) {
@@ -4322,12 +9987,61 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
             "A non-finite initial time was detected in the initialisation of an adaptive Taylor integrator");
     }
 
+    if (!lane_tols.empty()) {
+        if (lane_tols.size() != m_batch_size) {
+            throw std::invalid_argument(
+                "Invalid number of tolerances specified in the initialisation of an adaptive Taylor integrator in "
+                "batch mode: the batch size is {}, but the number of specified tolerances is {}"_format(
+                    m_batch_size, lane_tols.size()));
+        }
+
+        for (const auto &lt : lane_tols) {
+            if (!isfinite(lt) || lt <= 0) {
+                throw std::invalid_argument("The tolerances in an adaptive Taylor integrator must be finite and "
+                                            "positive, but a tolerance of {} was specified"_format(lt));
+            }
+        }
+
+        // NOTE: the Taylor order is deduced from the tightest tolerance.
+        tol = *std::min_element(lane_tols.begin(), lane_tols.end());
+    }
+
     if (!isfinite(tol) || tol <= 0) {
         throw std::invalid_argument(
             "The tolerance in an adaptive Taylor integrator must be finite and positive, but it is {} instead"_format(
                 tol));
     }
 
+    if (lane_tols.empty()) {
+        m_lane_tols.assign(boost::numeric_cast<typename std::vector<T>::size_type>(m_batch_size), tol);
+    } else {
+        m_lane_tols = lane_tols;
+
+        // NOTE: if the tolerances are all equal, there is
+        // no need to pass them to the stepper.
+        if (std::all_of(lane_tols.begin(), lane_tols.end(), [tol](const auto &lt) { return lt == tol; })) {
+            lane_tols.clear();
+        }
+    }
+
+    // NOTE: we need to be able to index into the events
+    // using 32-bit ints.
+    // LCOV_EXCL_START
+    if (m_tes.size() > std::numeric_limits<std::uint32_t>::max()
+        || m_ntes.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("The number of events is too large, and it results in an overflow condition");
+    }
+    // LCOV_EXCL_STOP
+
+    const auto with_events = !m_tes.empty() || !m_ntes.empty();
+
+    // NOTE: the fused stepper is not available with events.
+    m_fused_step = fused_step && !with_events;
+
+    // Check that a precomputed decomposition
+    // includes the event equations.
+    taylor_check_precomputed_dc_events(sys, m_tes.size() + m_ntes.size());
+
     // Fix m_pars' size, if necessary.
     const auto npars = n_pars_in_sys(sys);
     // LCOV_EXCL_START
@@ -4347,36 +10061,80 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
         // LCOV_EXCL_STOP
     }
 
+    if (order != 0u && tune_order) {
+        throw std::invalid_argument("The Taylor order of an adaptive Taylor integrator cannot be auto-tuned if an "
+                                    "explicit order is specified");
+    }
+
     // Store the dimension of the system.
-    m_dim = boost::numeric_cast<std::uint32_t>(sys.size());
+    m_dim = boost::numeric_cast<std::uint32_t>(taylor_sys_size(sys));
+
+    // Auto-tune the Taylor order, if requested.
+    // NOTE: in automatic batch size mode, the batch size
+    // is selected first (with the order deduced from the tolerance).
+    if (tune_order) {
+        order = taylor_auto_order<T>(*m_llvm, sys, m_state, m_pars, m_time_hi, tol, m_batch_size, high_accuracy,
+                                     compact_mode, parallel_mode, unroll_threshold, contiguous_jets, dl_order,
+                                     skip_one_way, h_vars);
+    }
 
     // Temporarily disable optimisations in s, so that
     // we don't optimise twice when adding the step
     // and then the d_out.
-    std::optional<opt_disabler> od(m_llvm);
+    std::optional<opt_disabler> od(*m_llvm);
+
+    taylor_last_dc_timings = {};
+    const auto ir_t0 = std::chrono::steady_clock::now();
 
     // Add the stepper function.
-    std::tie(m_dc, m_order)
-        = taylor_add_adaptive_step<T>(m_llvm, "step", std::move(sys), tol, m_batch_size, high_accuracy, compact_mode);
+    taylor_dc_t dc;
+    if (with_events) {
+        std::vector<expression> ee;
+        for (const auto &ev : m_tes) {
+            ee.push_back(ev.get_expression());
+        }
+        for (const auto &ev : m_ntes) {
+            ee.push_back(ev.get_expression());
+        }
+
+        std::tie(dc, m_order) = taylor_add_adaptive_step_with_events<T>(
+            *m_llvm, "step_e", std::move(sys), tol, m_batch_size, high_accuracy, compact_mode, parallel_mode,
+            unroll_threshold, contiguous_jets, std::move(ee), skip_one_way, h_vars, order, lane_tols);
+    } else {
+        std::tie(dc, m_order) = taylor_add_adaptive_step<T>(
+            *m_llvm, m_fused_step ? "step_f" : "step", std::move(sys), tol, m_batch_size, high_accuracy, compact_mode,
+            parallel_mode, unroll_threshold, contiguous_jets, m_fused_step, dl_order, skip_one_way, h_vars, 0, order,
+            lane_tols, ha_vars);
+    }
+
+    // Fetch the knots of the piecewise polynomials of time.
+    m_dc = std::make_shared<const taylor_dc_t>(std::move(dc));
+
+    m_tpw_knots = tpwpoly_knots(*m_dc);
+    m_tpw_max_delta_ts.resize(m_tpw_knots.empty() ? 0u : m_batch_size);
 
     // Add the function for the computation of
     // the dense output.
-    taylor_add_d_out_function<T>(m_llvm, m_dim, m_order, m_batch_size, high_accuracy);
+    taylor_add_d_out_function<T>(*m_llvm, m_dim, m_order, m_batch_size, high_accuracy);
+
+    const auto ir_t1 = std::chrono::steady_clock::now();
 
     // Restore the original optimisation level in s.
     od.reset();
 
     // Run the optimisation pass manually.
-    m_llvm.optimise();
+    m_llvm->optimise();
 
     // Run the jit.
-    m_llvm.compile();
+    m_llvm->compile();
 
     // Fetch the stepper.
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
+    m_step_f = taylor_lookup_step<decltype(m_step_f)>(*m_llvm, with_events, m_fused_step);
 
     // Fetch the function to compute the dense output.
-    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm->jit_lookup("d_out_f"));
+
+    m_ctor_timings = taylor_make_ctor_timings(*m_llvm, ctor_t0, ir_t0, ir_t1);
 
     // Setup the vector for the Taylor coefficients.
     // LCOV_EXCL_START
@@ -4399,10 +10157,48 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
     // into account the batch size.
     m_d_out.resize(m_state.size());
 
+    // If we have events, we need to setup
+    // m_ev_jet.
+    if (with_events) {
+        const auto n_tes = static_cast<std::uint32_t>(m_tes.size());
+        const auto n_ntes = static_cast<std::uint32_t>(m_ntes.size());
+
+        // NOTE: check that we can represent
+        // the requested size for m_ev_jet using
+        // both its size type and std::uint32_t.
+        // LCOV_EXCL_START
+        if (n_tes > std::numeric_limits<std::uint32_t>::max() - n_ntes
+            || m_dim > std::numeric_limits<std::uint32_t>::max() - (n_tes + n_ntes)
+            || m_dim + (n_tes + n_ntes) > std::numeric_limits<std::uint32_t>::max() / (m_order + 1u)
+            || (m_dim + (n_tes + n_ntes)) * (m_order + 1u) > std::numeric_limits<std::uint32_t>::max() / m_batch_size
+            || (m_dim + (n_tes + n_ntes)) * (m_order + 1u)
+                   > std::numeric_limits<decltype(m_ev_jet.size())>::max() / m_batch_size) {
+            throw std::overflow_error(
+                "Overflow detected in the initialisation of an adaptive Taylor integrator in batch mode: the order "
+                "or the state size is too large");
+        }
+        // LCOV_EXCL_STOP
+
+        m_ev_jet.resize((m_dim + (n_tes + n_ntes)) * (m_order + 1u) * m_batch_size);
+    }
+
+    // Setup the vectors of cooldowns.
+    m_te_cooldowns.resize(boost::numeric_cast<decltype(m_te_cooldowns.size())>(m_batch_size));
+    for (auto &v : m_te_cooldowns) {
+        v.resize(boost::numeric_cast<decltype(v.size())>(m_tes.size()));
+    }
+
     // Prepare the temp vectors.
+    setup_tmp_vectors();
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::setup_tmp_vectors()
+{
     m_pinf.resize(m_batch_size, std::numeric_limits<T>::infinity());
     m_minf.resize(m_batch_size, -std::numeric_limits<T>::infinity());
     m_delta_ts.resize(m_batch_size);
+    m_step_flags.resize(m_batch_size);
 
     // NOTE: init the outcome to success, the rest to zero.
     m_step_res.resize(boost::numeric_cast<decltype(m_step_res.size())>(m_batch_size),
@@ -4410,66 +10206,415 @@ void taylor_adaptive_batch_impl<T>::finalise_ctor_impl(U sys, std::vector<T> sta
     m_prop_res.resize(boost::numeric_cast<decltype(m_prop_res.size())>(m_batch_size),
                       std::tuple{taylor_outcome::success, T(0), T(0), std::size_t(0)});
 
+    // NOTE: all the batch elements are initially active.
+    m_active.resize(boost::numeric_cast<decltype(m_active.size())>(m_batch_size), 1);
+
     m_ts_count.resize(boost::numeric_cast<decltype(m_ts_count.size())>(m_batch_size));
     m_min_abs_h.resize(m_batch_size);
     m_max_abs_h.resize(m_batch_size);
     m_cur_max_delta_ts.resize(m_batch_size);
     m_pfor_ts.resize(boost::numeric_cast<decltype(m_pfor_ts.size())>(m_batch_size));
     m_t_dir.resize(boost::numeric_cast<decltype(m_t_dir.size())>(m_batch_size));
+    m_step_active.resize(boost::numeric_cast<decltype(m_step_active.size())>(m_batch_size));
+    m_stop_flags.resize(boost::numeric_cast<decltype(m_stop_flags.size())>(m_batch_size));
     m_rem_time.resize(m_batch_size);
 
     m_d_out_time.resize(m_batch_size);
+
+    m_d_tes.resize(boost::numeric_cast<decltype(m_d_tes.size())>(m_batch_size));
+    m_d_ntes.resize(boost::numeric_cast<decltype(m_d_ntes.size())>(m_batch_size));
+    m_ev_orig_h.resize(m_batch_size);
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &other)
+    : taylor_adaptive_batch_impl(other, false)
+{
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &other, bool share_code)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_batch_size(other.m_batch_size), m_state(other.m_state), m_time_hi(other.m_time_hi), m_time_lo(other.m_time_lo),
+      m_llvm(share_code ? other.m_llvm : std::make_shared<llvm_state>(*other.m_llvm)), m_dim(other.m_dim),
+      m_dc(other.m_dc), m_order(other.m_order), m_fused_step(other.m_fused_step), m_pars(other.m_pars),
+      m_lane_tols(other.m_lane_tols), m_tpw_knots(other.m_tpw_knots), m_tpw_max_delta_ts(other.m_tpw_max_delta_ts),
+      m_tc(other.m_tc), m_tc_pending(other.m_tc_pending), m_last_h(other.m_last_h), m_d_out(other.m_d_out),
+      m_tes(other.m_tes), m_ntes(other.m_ntes), m_nt_batch_cb(other.m_nt_batch_cb), m_ev_jet(other.m_ev_jet),
+      m_thread_scratch(other.m_thread_scratch), m_te_cooldowns(other.m_te_cooldowns), m_pinf(other.m_pinf),
+      m_minf(other.m_minf), m_delta_ts(other.m_delta_ts),
+      m_step_flags(other.m_step_flags), m_step_res(other.m_step_res), m_prop_res(other.m_prop_res),
+      m_active(other.m_active), m_ts_count(other.m_ts_count), m_min_abs_h(other.m_min_abs_h),
+      m_max_abs_h(other.m_max_abs_h), m_cur_max_delta_ts(other.m_cur_max_delta_ts), m_pfor_ts(other.m_pfor_ts),
+      m_t_dir(other.m_t_dir), m_step_active(other.m_step_active), m_rem_time(other.m_rem_time),
+      m_d_out_time(other.m_d_out_time), m_ev_orig_h(other.m_ev_orig_h), m_sv_funcs(other.m_sv_funcs),
+      m_sv_values(other.m_sv_values), m_sv_state(other.m_sv_state), m_sv_pars(other.m_sv_pars),
+      m_sv_out(other.m_sv_out), m_stop_cond(other.m_stop_cond), m_stop_state(other.m_stop_state),
+      m_stop_pars(other.m_stop_pars), m_stop_flags(other.m_stop_flags), m_ctor_timings(other.m_ctor_timings)
+{
+    if (share_code) {
+        // NOTE: the function pointers refer to the shared
+        // compiled code, thus they can be copied.
+        m_step_f = other.m_step_f;
+        m_d_out_f = other.m_d_out_f;
+        m_svf_llvm = other.m_svf_llvm;
+        m_svf_f = other.m_svf_f;
+        m_stop_llvm = other.m_stop_llvm;
+        m_stop_f = other.m_stop_f;
+    } else {
+        m_step_f = taylor_lookup_step<decltype(m_step_f)>(*m_llvm, !m_tes.empty() || !m_ntes.empty(), m_fused_step);
+
+        m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm->jit_lookup("d_out_f"));
+
+        if (other.m_svf_llvm) {
+            m_svf_llvm = std::make_shared<llvm_state>(*other.m_svf_llvm);
+            m_svf_f = reinterpret_cast<sv_funcs_f_t>(m_svf_llvm->jit_lookup("sv_funcs"));
+        }
+
+        if (other.m_stop_llvm) {
+            m_stop_llvm = std::make_shared<llvm_state>(*other.m_stop_llvm);
+            m_stop_f = reinterpret_cast<sv_funcs_f_t>(m_stop_llvm->jit_lookup("stop_cond"));
+        }
+    }
+
+    // NOTE: instead of copying these, reserve the capacity.
+    m_d_tes.resize(other.m_d_tes.size());
+    for (decltype(m_d_tes.size()) i = 0; i < m_d_tes.size(); ++i) {
+        m_d_tes[i].reserve(other.m_d_tes[i].capacity());
+    }
+    m_d_ntes.resize(other.m_d_ntes.size());
+    for (decltype(m_d_ntes.size()) i = 0; i < m_d_ntes.size(); ++i) {
+        m_d_ntes[i].reserve(other.m_d_ntes[i].capacity());
+    }
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_batch_impl<T> taylor_adaptive_batch_impl<T>::shared_copy() const
+{
+    return taylor_adaptive_batch_impl(*this, true);
+}
+
+template <typename T>
+std::vector<taylor_adaptive_batch_impl<T>> taylor_adaptive_batch_impl<T>::shared_copies(std::size_t n) const
+{
+    std::vector<taylor_adaptive_batch_impl> retval;
+    retval.reserve(n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        retval.push_back(taylor_adaptive_batch_impl(*this, true));
+    }
+
+    return retval;
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T> &taylor_adaptive_batch_impl<T>::operator=(const taylor_adaptive_batch_impl &other)
+{
+    if (this != &other) {
+        *this = taylor_adaptive_batch_impl(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+taylor_adaptive_batch_impl<T> &
+taylor_adaptive_batch_impl<T>::operator=(taylor_adaptive_batch_impl &&) noexcept = default;
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::~taylor_adaptive_batch_impl() = default;
+
+template <typename T>
+taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl() = default;
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::save(std::ostream &os) const
+{
+    s11n_save_header(os, "taylor_adaptive_batch", 3);
+
+    sync_tc();
+
+    // NOTE: store the number of binary digits in order
+    // to distinguish between the floating-point types.
+    s11n_save(os, static_cast<std::uint32_t>(std::numeric_limits<T>::digits));
+
+    s11n_save(os, m_batch_size);
+    s11n_save(os, m_state);
+    s11n_save(os, m_time_hi);
+    s11n_save(os, m_time_lo);
+    m_llvm->save(os);
+    s11n_save(os, m_dim);
+    s11n_save(os, *m_dc);
+    s11n_save(os, m_order);
+    s11n_save(os, m_fused_step);
+    s11n_save(os, m_pars);
+    s11n_save(os, m_lane_tols);
+    s11n_save(os, m_tc);
+    s11n_save(os, m_last_h);
+    s11n_save(os, m_d_out);
+
+    // NOTE: like in the scalar integrator, store
+    // only the event equations.
+    s11n_save_size(os, m_tes.size());
+    for (const auto &ev : m_tes) {
+        s11n_save(os, ev.get_expression());
+    }
+    s11n_save_size(os, m_ntes.size());
+    for (const auto &ev : m_ntes) {
+        s11n_save(os, ev.get_expression());
+    }
+
+    // NOTE: in scratch mode, m_ev_jet is empty. Save it
+    // with its regular size, so that the deserialised
+    // integrator does not need any special handling.
+    if (m_thread_scratch) {
+        s11n_save(os, aligned_vector<T>(ev_jet_size()));
+    } else {
+        s11n_save(os, m_ev_jet);
+    }
+
+    s11n_save_size(os, m_te_cooldowns.size());
+    for (const auto &cds : m_te_cooldowns) {
+        s11n_save_size(os, cds.size());
+        for (const auto &cd : cds) {
+            s11n_save(os, static_cast<bool>(cd));
+            if (cd) {
+                s11n_save(os, cd->first);
+                s11n_save(os, cd->second);
+            }
+        }
+    }
+}
+
+// NOTE: the events passed to this function must have the same
+// equations as the events of the serialised integrator.
+template <typename T>
+taylor_adaptive_batch_impl<T> taylor_adaptive_batch_impl<T>::load(std::istream &is, std::vector<t_event_t> tes,
+                                                                  std::vector<nt_event_t> ntes)
+{
+    s11n_load_header(is, "taylor_adaptive_batch", 3);
+
+    std::uint32_t digits = 0;
+    s11n_load(is, digits);
+    if (digits != static_cast<std::uint32_t>(std::numeric_limits<T>::digits)) {
+        throw std::invalid_argument("Cannot deserialise an adaptive batch Taylor integrator: the floating-point type "
+                                    "of the serialised integrator does not match the type of the integrator being "
+                                    "deserialised");
+    }
+
+    taylor_adaptive_batch_impl retval;
+
+    s11n_load(is, retval.m_batch_size);
+    s11n_load(is, retval.m_state);
+    s11n_load(is, retval.m_time_hi);
+    s11n_load(is, retval.m_time_lo);
+    retval.m_llvm->load(is);
+    s11n_load(is, retval.m_dim);
+    {
+        taylor_dc_t dc;
+        s11n_load(is, dc);
+        retval.m_dc = std::make_shared<const taylor_dc_t>(std::move(dc));
+    }
+    s11n_load(is, retval.m_order);
+    s11n_load(is, retval.m_fused_step);
+    s11n_load(is, retval.m_pars);
+    s11n_load(is, retval.m_lane_tols);
+    s11n_load(is, retval.m_tc);
+    s11n_load(is, retval.m_last_h);
+    s11n_load(is, retval.m_d_out);
+
+    // NOTE: the knots are not serialised, they are
+    // recovered from the decomposition.
+    retval.m_tpw_knots = tpwpoly_knots(*retval.m_dc);
+    retval.m_tpw_max_delta_ts.resize(retval.m_tpw_knots.empty() ? 0u : retval.m_batch_size);
+
+    // Validate the events.
+    auto check_events = [&is](const auto &evs, const char *ev_type) {
+        const auto n_evs = s11n_load_size<decltype(evs.size())>(is);
+        if (n_evs != evs.size()) {
+            throw std::invalid_argument(
+                "Cannot deserialise an adaptive batch Taylor integrator: the serialised integrator contains {} {} "
+                "event(s), but {} {} event(s) were provided"_format(n_evs, ev_type, evs.size(), ev_type));
+        }
+
+        expression ex;
+        for (decltype(evs.size()) i = 0; i < n_evs; ++i) {
+            s11n_load(is, ex);
+            if (ex != evs[i].get_expression()) {
+                throw std::invalid_argument(
+                    "Cannot deserialise an adaptive batch Taylor integrator: the equation of the {} event at index {} "
+                    "does not match the equation of the serialised event"_format(ev_type, i));
+            }
+        }
+    };
+
+    check_events(tes, "terminal");
+    check_events(ntes, "non-terminal");
+
+    retval.m_tes = std::move(tes);
+    retval.m_ntes = std::move(ntes);
+
+    s11n_load(is, retval.m_ev_jet);
+
+    retval.m_te_cooldowns.resize(s11n_load_size<decltype(retval.m_te_cooldowns.size())>(is));
+    for (auto &cds : retval.m_te_cooldowns) {
+        cds.resize(s11n_load_size<decltype(cds.size())>(is));
+        for (auto &cd : cds) {
+            bool has_cd = false;
+            s11n_load(is, has_cd);
+            if (has_cd) {
+                T first(0), second(0);
+                s11n_load(is, first);
+                s11n_load(is, second);
+                cd.emplace(first, second);
+            }
+        }
+    }
+
+    // Sanity checks.
+    if (retval.m_batch_size == 0u || retval.m_time_hi.size() != retval.m_batch_size
+        || retval.m_time_lo.size() != retval.m_batch_size || retval.m_last_h.size() != retval.m_batch_size
+        || retval.m_state.size() != static_cast<decltype(retval.m_state.size())>(retval.m_dim) * retval.m_batch_size
+        || retval.m_tc.size() != retval.m_state.size() * (retval.m_order + 1u)
+        || retval.m_te_cooldowns.size() != retval.m_batch_size
+        || std::any_of(retval.m_te_cooldowns.begin(), retval.m_te_cooldowns.end(),
+                       [&retval](const auto &cds) { return cds.size() != retval.m_tes.size(); })
+        || (retval.m_fused_step && (!retval.m_tes.empty() || !retval.m_ntes.empty()))) {
+        throw std::invalid_argument(
+            "Cannot deserialise an adaptive batch Taylor integrator: inconsistent data detected in the input stream");
+    }
+
+    // Fetch the compiled functions.
+    retval.m_step_f = taylor_lookup_step<decltype(retval.m_step_f)>(
+        *retval.m_llvm, !retval.m_tes.empty() || !retval.m_ntes.empty(), retval.m_fused_step);
+
+    retval.m_d_out_f = reinterpret_cast<d_out_f_t>(retval.m_llvm->jit_lookup("d_out_f"));
+
+    // Setup the temporary vectors.
+    retval.setup_tmp_vectors();
+
+    return retval;
 }
 
 template <typename T>
-taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(const taylor_adaptive_batch_impl &other)
-    // NOTE: make a manual copy of all members, apart from the function pointers.
-    : m_batch_size(other.m_batch_size), m_state(other.m_state), m_time_hi(other.m_time_hi), m_time_lo(other.m_time_lo),
-      m_llvm(other.m_llvm), m_dim(other.m_dim), m_dc(other.m_dc), m_order(other.m_order), m_pars(other.m_pars),
-      m_tc(other.m_tc), m_last_h(other.m_last_h), m_d_out(other.m_d_out), m_pinf(other.m_pinf), m_minf(other.m_minf),
-      m_delta_ts(other.m_delta_ts), m_step_res(other.m_step_res), m_prop_res(other.m_prop_res),
-      m_ts_count(other.m_ts_count), m_min_abs_h(other.m_min_abs_h), m_max_abs_h(other.m_max_abs_h),
-      m_cur_max_delta_ts(other.m_cur_max_delta_ts), m_pfor_ts(other.m_pfor_ts), m_t_dir(other.m_t_dir),
-      m_rem_time(other.m_rem_time), m_d_out_time(other.m_d_out_time)
-{
-    m_step_f = reinterpret_cast<step_f_t>(m_llvm.jit_lookup("step"));
-    m_d_out_f = reinterpret_cast<d_out_f_t>(m_llvm.jit_lookup("d_out_f"));
+void taylor_adaptive_batch_impl<T>::set_time(const std::vector<T> &new_time)
+{
+    // Check the dimensionality of new_time.
+    if (new_time.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of new times specified in a Taylor integrator in batch mode: the batch size is {}, "
+            "but the number of specified times is {}"_format(m_batch_size, new_time.size()));
+    }
+
+    // Copy over the new times.
+    std::copy(new_time.begin(), new_time.end(), m_time_hi.begin());
+    // Reset the lo part.
+    std::fill(m_time_lo.begin(), m_time_lo.end(), T(0));
 }
 
+// Set the time of a single batch element, leaving
+// the times of the other batch elements untouched.
 template <typename T>
-taylor_adaptive_batch_impl<T>::taylor_adaptive_batch_impl(taylor_adaptive_batch_impl &&) noexcept = default;
+void taylor_adaptive_batch_impl<T>::set_time(std::uint32_t idx, T new_time)
+{
+    if (idx >= m_batch_size) {
+        throw std::invalid_argument(
+            "Cannot set the time of the batch element at index {} in a Taylor integrator in batch mode: the "
+            "batch size is only {}"_format(idx, m_batch_size));
+    }
+
+    m_time_hi[idx] = new_time;
+    m_time_lo[idx] = 0;
+}
 
 template <typename T>
-taylor_adaptive_batch_impl<T> &taylor_adaptive_batch_impl<T>::operator=(const taylor_adaptive_batch_impl &other)
+void taylor_adaptive_batch_impl<T>::reset_lane(std::uint32_t idx, const std::vector<T> &state, T time,
+                                               const std::vector<T> &pars)
 {
-    if (this != &other) {
-        *this = taylor_adaptive_batch_impl(other);
+    if (idx >= m_batch_size) {
+        throw std::invalid_argument(
+            "Cannot reset the batch element at index {} in a Taylor integrator in batch mode: the "
+            "batch size is only {}"_format(idx, m_batch_size));
     }
 
-    return *this;
+    if (state.size() != m_dim) {
+        throw std::invalid_argument(
+            "Invalid state vector passed to reset_lane() in a Taylor integrator in batch mode: the state vector has "
+            "a size of {}, but the dimension of the system is {}"_format(state.size(), m_dim));
+    }
+
+    const auto n_pars = m_pars.size() / m_batch_size;
+    if (!pars.empty() && pars.size() != n_pars) {
+        throw std::invalid_argument(
+            "Invalid vector of parameters passed to reset_lane() in a Taylor integrator in batch mode: the vector "
+            "has a size of {}, but the number of parameters is {}"_format(pars.size(), n_pars));
+    }
+
+    for (std::uint32_t j = 0; j < m_dim; ++j) {
+        m_state[j * m_batch_size + idx] = state[j];
+    }
+    for (decltype(pars.size()) j = 0; j < pars.size(); ++j) {
+        m_pars[j * m_batch_size + idx] = pars[j];
+    }
+
+    set_time(idx, time);
+    reset_cooldowns(idx);
 }
 
+namespace
+{
+
+// Copy into the buffer dst, with shape (n_rows, batch_size), the values
+// read from a strided view of src. The value at (i, j) is read from
+// src[i * var_stride + j * lane_stride].
 template <typename T>
-taylor_adaptive_batch_impl<T> &
-taylor_adaptive_batch_impl<T>::operator=(taylor_adaptive_batch_impl &&) noexcept = default;
+void taylor_batch_copy_strided(std::vector<T> &dst, std::uint32_t batch_size, const T *src, std::size_t var_stride,
+                               std::size_t lane_stride)
+{
+    const auto bs = static_cast<std::size_t>(batch_size);
+    const auto n_rows = dst.size() / bs;
+
+    if (var_stride == bs && lane_stride == 1u) {
+        // The layout of the view matches the layout of dst.
+        std::copy(src, src + dst.size(), dst.begin());
+    } else {
+        for (std::size_t i = 0; i < n_rows; ++i) {
+            for (std::size_t j = 0; j < bs; ++j) {
+                dst[i * bs + j] = src[i * var_stride + j * lane_stride];
+            }
+        }
+    }
+}
+
+} // namespace
 
 template <typename T>
-taylor_adaptive_batch_impl<T>::~taylor_adaptive_batch_impl() = default;
+void taylor_adaptive_batch_impl<T>::set_state(const T *src, std::size_t var_stride, std::size_t lane_stride)
+{
+    if (src == nullptr) {
+        throw std::invalid_argument(
+            "A null pointer was passed to the set_state() function of an adaptive Taylor integrator in batch mode");
+    }
+
+    taylor_batch_copy_strided(m_state, m_batch_size, src, var_stride, lane_stride);
+}
 
 template <typename T>
-void taylor_adaptive_batch_impl<T>::set_time(const std::vector<T> &new_time)
+void taylor_adaptive_batch_impl<T>::set_pars(const T *src, std::size_t var_stride, std::size_t lane_stride)
 {
-    // Check the dimensionality of new_time.
-    if (new_time.size() != m_batch_size) {
+    if (m_pars.empty()) {
+        return;
+    }
+
+    if (src == nullptr) {
         throw std::invalid_argument(
-            "Invalid number of new times specified in a Taylor integrator in batch mode: the batch size is {}, "
-            "but the number of specified times is {}"_format(m_batch_size, new_time.size()));
+            "A null pointer was passed to the set_pars() function of an adaptive Taylor integrator in batch mode");
     }
 
-    // Copy over the new times.
-    std::copy(new_time.begin(), new_time.end(), m_time_hi.begin());
-    // Reset the lo part.
-    std::fill(m_time_lo.begin(), m_time_lo.end(), T(0));
+    taylor_batch_copy_strided(m_pars, m_batch_size, src, var_stride, lane_stride);
 }
 
 // Implementation detail to make a single integration timestep.
@@ -4483,13 +10628,17 @@ void taylor_adaptive_batch_impl<T>::set_time(const std::vector<T> &new_time)
 // The function will write to res a pair for each state
 // vector, containing a flag describing the outcome of the integration
 // and the integration timestep that was used.
+// NOTE: active is the mask of the batch elements to be advanced,
+// the other batch elements take zero-length timesteps (see set_lane_active()).
 template <typename T>
-void taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts, bool wtc)
+void taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts, bool wtc,
+                                              const std::vector<int> &active)
 {
     using std::isfinite;
 
     // Check preconditions.
     assert(max_delta_ts.size() == m_batch_size);
+    assert(active.size() == m_batch_size);
     assert(std::none_of(max_delta_ts.begin(), max_delta_ts.end(), [](const auto &x) {
         using std::isnan;
         return isnan(x);
@@ -4498,11 +10647,41 @@ void taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts
     // Sanity check.
     assert(m_step_res.size() == m_batch_size);
 
-    // Copy max_delta_ts to the tmp buffer.
-    std::copy(max_delta_ts.begin(), max_delta_ts.end(), m_delta_ts.begin());
+    // Limit the timesteps at the knots of the piecewise polynomials of time.
+    if (!m_tpw_knots.empty()) {
+        assert(m_tpw_max_delta_ts.size() == m_batch_size);
+
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 0) {
+                m_tpw_max_delta_ts[i] = 0;
+                continue;
+            }
+
+            bool at_knot = false;
+            m_tpw_max_delta_ts[i] = taylor_tpw_clamp(m_tpw_knots, m_pars, m_batch_size, i,
+                                                     dfloat<T>(m_time_hi[i], m_time_lo[i]), max_delta_ts[i], at_knot);
+
+            if (at_knot) {
+                taylor_tpw_nudge(m_time_hi[i], m_time_lo[i]);
+            }
+        }
+    }
+
+    // The max timesteps, possibly limited at the knots.
+    const auto &max_dts = m_tpw_knots.empty() ? max_delta_ts : m_tpw_max_delta_ts;
+
+    // Copy max_dts to the tmp buffer, zeroing
+    // out the timesteps of the inactive batch elements.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        m_delta_ts[i] = active[i] == 0 ? T(0) : max_dts[i];
+    }
 
-    // Invoke the stepper.
-    m_step_f(m_state.data(), m_pars.data(), m_time_hi.data(), m_delta_ts.data(), wtc ? m_tc.data() : nullptr);
+    // Helper to write out the result of the zero-length
+    // timestep of an inactive batch element.
+    auto skip_batch = [this](std::uint32_t batch_idx) {
+        m_last_h[batch_idx] = 0;
+        m_step_res[batch_idx] = std::tuple{taylor_outcome::time_limit, T(0)};
+    };
 
     // Helper to check if the state vector of a batch element
     // contains a non-finite value.
@@ -4515,26 +10694,267 @@ void taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts
         return false;
     };
 
-    // Update the times and the last timesteps, and write out the result.
-    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-        // The timestep that was actually used for
-        // this batch element.
-        const auto h = m_delta_ts[i];
-
-        // Compute the new time in double-length arithmetic.
-        const auto new_time = dfloat<T>(m_time_hi[i], m_time_lo[i]) + h;
-        m_time_hi[i] = new_time.hi;
-        m_time_lo[i] = new_time.lo;
-
-        // Update the size of the last timestep.
-        m_last_h[i] = h;
-
-        if (!isfinite(new_time) || check_nf_batch(i)) {
-            // Either the new time or state contain non-finite values,
-            // return an error condition.
-            m_step_res[i] = std::tuple{taylor_outcome::err_nf_state, h};
-        } else {
-            m_step_res[i] = std::tuple{h == max_delta_ts[i] ? taylor_outcome::time_limit : taylor_outcome::success, h};
+    if (m_step_f.index() == 2u) {
+        assert(m_tes.empty() && m_ntes.empty());
+
+        // Invoke the fused stepper, which also updates the times,
+        // checks for non-finite values and classifies the outcomes
+        // of all the batch elements in vectorised code.
+        std::get<2>(m_step_f)(m_state.data(), m_pars.data(), m_time_hi.data(), m_time_lo.data(), m_delta_ts.data(),
+                              wtc ? m_tc.data() : nullptr, m_step_flags.data());
+
+        // Update the last timesteps and write out the result.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 0) {
+                skip_batch(i);
+                continue;
+            }
+
+            const auto h = m_delta_ts[i];
+
+            m_last_h[i] = h;
+
+            switch (m_step_flags[i]) {
+                case taylor_step_flag_nf:
+                    m_step_res[i] = std::tuple{taylor_outcome::err_nf_state, h};
+                    break;
+                case taylor_step_flag_tl:
+                    m_step_res[i] = std::tuple{taylor_outcome::time_limit, h};
+                    break;
+                default:
+                    assert(m_step_flags[i] == taylor_step_flag_success);
+                    m_step_res[i] = std::tuple{taylor_outcome::success, h};
+            }
+        }
+    } else if (m_step_f.index() == 0u) {
+        assert(m_tes.empty() && m_ntes.empty());
+
+        // Invoke the vanilla stepper.
+        std::get<0>(m_step_f)(m_state.data(), m_pars.data(), m_time_hi.data(), m_delta_ts.data(),
+                              wtc ? m_tc.data() : nullptr);
+
+        // Update the times in double-length arithmetic.
+        // NOTE: this loop is branchless and it operates on
+        // contiguous arrays, so that it can be vectorised. The times
+        // of the inactive batch elements are not altered,
+        // as their timesteps are zero.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            const auto new_time = dfloat<T>(m_time_hi[i], m_time_lo[i]) + m_delta_ts[i];
+            m_time_hi[i] = new_time.hi;
+            m_time_lo[i] = new_time.lo;
+        }
+
+        // Update the last timesteps, and write out the result.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 0) {
+                skip_batch(i);
+                continue;
+            }
+
+            // The timestep that was actually used for
+            // this batch element.
+            const auto h = m_delta_ts[i];
+
+            // Update the size of the last timestep.
+            m_last_h[i] = h;
+
+            if (!isfinite(m_time_hi[i]) || !isfinite(m_time_lo[i]) || check_nf_batch(i)) {
+                // Either the new time or state contain non-finite values,
+                // return an error condition.
+                m_step_res[i] = std::tuple{taylor_outcome::err_nf_state, h};
+            } else {
+                m_step_res[i]
+                    = std::tuple{h == max_dts[i] ? taylor_outcome::time_limit : taylor_outcome::success, h};
+            }
+        }
+    } else {
+        assert(!m_tes.empty() || !m_ntes.empty());
+
+        using std::abs;
+
+        // Fetch the buffer for the jet of derivatives.
+        auto &ev_jet = m_thread_scratch ? taylor_scratch_ev_jet<T>(ev_jet_size()) : m_ev_jet;
+
+        // Invoke the stepper for event handling.
+        std::get<1>(m_step_f)(ev_jet.data(), m_state.data(), m_pars.data(), m_time_hi.data(), m_delta_ts.data());
+
+        // NOTE: the tcs of the state variables are copied
+        // from m_ev_jet only when needed (see sync_tc()).
+        // In scratch mode, they are copied out below.
+        m_tc_pending = !m_thread_scratch;
+
+        // Do the event detection.
+        taylor_detect_events_batch<T>(m_d_tes, m_d_ntes, m_tes, m_ntes, m_te_cooldowns, m_delta_ts, ev_jet, m_order,
+                                      m_dim, m_batch_size, m_ed_data);
+
+        // NOTE: before this point, we did not alter
+        // any user-visible data in the integrator (just
+        // temporary memory). From here until we start invoking
+        // the callbacks, everything is noexcept, so we don't
+        // risk leaving the integrator in a half-baked state.
+
+        // Sort the events by time and, for each batch element,
+        // clamp the timestep to the first terminal event (if any).
+        // See the scalar integrator for an explanation.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            // NOTE: no events are detected in the zero-length
+            // timesteps of the inactive batch elements.
+            assert(active[i] != 0 || (m_d_tes[i].empty() && m_d_ntes[i].empty()));
+
+            // NOTE: only the first terminal event is needed.
+            if (!m_d_tes[i].empty()) {
+                std::iter_swap(m_d_tes[i].begin(),
+                               std::min_element(m_d_tes[i].begin(), m_d_tes[i].end(), taylor_ev_cmp{}));
+            }
+            std::sort(m_d_ntes[i].begin(), m_d_ntes[i].end(), taylor_ev_cmp{});
+
+            // Store the timestep that was used during event
+            // detection, before possibly modifying it.
+            m_ev_orig_h[i] = m_delta_ts[i];
+
+            if (!m_d_tes[i].empty()) {
+                m_delta_ts[i] = std::get<1>(m_d_tes[i][0]);
+            }
+        }
+
+        // Update the state.
+        m_d_out_f(m_state.data(), ev_jet.data(), m_delta_ts.data());
+
+        // See the scalar integrator.
+        if (m_thread_scratch) {
+            std::copy(ev_jet.data(), ev_jet.data() + m_tc.size(), m_tc.data());
+        }
+
+        // Update the times, the last timesteps and the cooldowns.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 0) {
+                skip_batch(i);
+                continue;
+            }
+
+            const auto h = m_delta_ts[i];
+
+            // Compute the new time in double-length arithmetic.
+            const auto new_time = dfloat<T>(m_time_hi[i], m_time_lo[i]) + h;
+            m_time_hi[i] = new_time.hi;
+            m_time_lo[i] = new_time.lo;
+
+            // Update the size of the last timestep.
+            m_last_h[i] = h;
+
+            if (!isfinite(new_time) || check_nf_batch(i)) {
+                // Either the new time or state contain non-finite values,
+                // return an error condition for this batch element.
+                m_step_res[i] = std::tuple{taylor_outcome::err_nf_state, h};
+
+                // Let's also reset the cooldown values for this batch element,
+                // as at this point they have become useless.
+                reset_cooldowns(i);
+
+                continue;
+            }
+
+            // Update the cooldowns.
+            for (auto &cd : m_te_cooldowns[i]) {
+                if (cd) {
+                    // Check if the timestep we just took
+                    // brought this event outside the cooldown.
+                    auto tmp = cd->first + h;
+
+                    if (abs(tmp) >= cd->second) {
+                        // We are now outside the cooldown period
+                        // for this event, reset cd.
+                        cd.reset();
+                    } else {
+                        // Still in cooldown, update the
+                        // time spent in cooldown.
+                        cd->first = tmp;
+                    }
+                }
+            }
+
+            // Set the result for this batch element. In case of
+            // a detected terminal event, it will be overwritten below.
+            m_step_res[i] = std::tuple{h == max_dts[i] ? taylor_outcome::time_limit : taylor_outcome::success, h};
+        }
+
+        // Invoke the callbacks.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 0 || std::get<0>(m_step_res[i]) == taylor_outcome::err_nf_state) {
+                continue;
+            }
+
+            const auto h = m_delta_ts[i];
+            const auto &d_tes = m_d_tes[i];
+            auto &d_ntes = m_d_ntes[i];
+
+            // Determine which non-terminal events happen
+            // before the first terminal event.
+            const auto ntes_end_it
+                = d_tes.empty()
+                      ? d_ntes.end()
+                      : std::lower_bound(d_ntes.begin(), d_ntes.end(), h,
+                                         [](const auto &ev, const auto &t) { return abs(std::get<1>(ev)) < abs(t); });
+
+            // Invoke the callbacks of the non-terminal events.
+            if (m_nt_buf != nullptr) {
+                // NOTE: see the scalar integrator.
+                assert(i < m_nt_buf->size());
+                auto &buf = (*m_nt_buf)[i];
+                for (auto it = d_ntes.begin(); it != ntes_end_it; ++it) {
+                    const auto &t = *it;
+                    buf.emplace_back(
+                        std::get<0>(t),
+                        static_cast<T>(dfloat<T>(m_time_hi[i], m_time_lo[i]) - m_last_h[i] + std::get<1>(t)),
+                        std::get<2>(t));
+                }
+            } else if (m_nt_batch_cb) {
+                if (ntes_end_it != d_ntes.begin()) {
+                    // NOTE: see the scalar integrator.
+                    d_ntes.erase(ntes_end_it, d_ntes.end());
+                    for (auto &t : d_ntes) {
+                        std::get<1>(t)
+                            = static_cast<T>(dfloat<T>(m_time_hi[i], m_time_lo[i]) - m_last_h[i] + std::get<1>(t));
+                    }
+
+                    m_nt_batch_cb(*this, d_ntes, i);
+                }
+            } else {
+                for (auto it = d_ntes.begin(); it != ntes_end_it; ++it) {
+                    const auto &t = *it;
+                    const auto &cb = m_ntes[std::get<0>(t)].get_callback();
+                    assert(cb);
+                    cb(*this, static_cast<T>(dfloat<T>(m_time_hi[i], m_time_lo[i]) - m_last_h[i] + std::get<1>(t)),
+                       std::get<2>(t), i);
+                }
+            }
+
+            if (!d_tes.empty()) {
+                // Fetch the first terminal event.
+                const auto te_idx = std::get<0>(d_tes[0]);
+                assert(te_idx < m_tes.size());
+                const auto &te = m_tes[te_idx];
+
+                // Set the corresponding cooldown.
+                if (te.get_cooldown() >= 0) {
+                    // Cooldown explicitly provided by the user, use it.
+                    m_te_cooldowns[i][te_idx].emplace(0, te.get_cooldown());
+                } else {
+                    // Deduce the cooldown automatically.
+                    m_te_cooldowns[i][te_idx].emplace(0, taylor_deduce_cooldown(m_ev_orig_h[i]));
+                }
+
+                // Invoke the callback of the first terminal event, if it has one.
+                bool te_cb_ret = false;
+                if (te.get_callback()) {
+                    te_cb_ret = te.get_callback()(*this, std::get<2>(d_tes[0]), std::get<3>(d_tes[0]), i);
+                }
+
+                // NOTE: see the scalar integrator for the meaning
+                // of the outcome.
+                const auto ev_idx = static_cast<std::int64_t>(te_idx);
+                m_step_res[i] = std::tuple{taylor_outcome{te_cb_ret ? ev_idx : (-ev_idx - 1)}, h};
+            }
         }
     }
 }
@@ -4542,13 +10962,13 @@ void taylor_adaptive_batch_impl<T>::step_impl(const std::vector<T> &max_delta_ts
 template <typename T>
 void taylor_adaptive_batch_impl<T>::step(bool wtc)
 {
-    step_impl(m_pinf, wtc);
+    step_impl(m_pinf, wtc, m_active);
 }
 
 template <typename T>
 void taylor_adaptive_batch_impl<T>::step_backward(bool wtc)
 {
-    step_impl(m_minf, wtc);
+    step_impl(m_minf, wtc, m_active);
 }
 
 template <typename T>
@@ -4571,13 +10991,179 @@ void taylor_adaptive_batch_impl<T>::step(const std::vector<T> &max_delta_ts, boo
             "one of the max timesteps is nan");
     }
 
-    step_impl(max_delta_ts, wtc);
+    step_impl(max_delta_ts, wtc, m_active);
+}
+
+// Reset all cooldowns for the terminal events,
+// in all batch elements.
+template <typename T>
+void taylor_adaptive_batch_impl<T>::reset_cooldowns()
+{
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        reset_cooldowns(i);
+    }
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_sv_funcs(std::vector<expression> sv_funcs)
+{
+    if (sv_funcs.empty()) {
+        m_svf_llvm.reset();
+        m_svf_f = nullptr;
+        m_sv_funcs.clear();
+        m_sv_values.clear();
+        m_sv_state.clear();
+        m_sv_pars.clear();
+        m_sv_out.clear();
+
+        return;
+    }
+
+    // NOTE: the sv_funcs are compiled in scalar mode, and they
+    // are evaluated separately for each batch element.
+    const auto n_pars = m_pars.size() / m_batch_size;
+    auto svf_llvm = taylor_make_sv_funcs_state<T>(*m_llvm, *m_dc, m_dim, n_pars, sv_funcs);
+
+    m_svf_f = reinterpret_cast<sv_funcs_f_t>(svf_llvm->jit_lookup("sv_funcs"));
+    m_svf_llvm = std::move(svf_llvm);
+    m_sv_values.resize(sv_funcs.size() * m_batch_size);
+    m_sv_state.resize(m_dim);
+    m_sv_pars.resize(n_pars);
+    m_sv_out.resize(sv_funcs.size());
+    m_sv_funcs = std::move(sv_funcs);
+}
+
+// Evaluate the sv_funcs for the batch element i
+// of the state vector state, writing the result into m_sv_values.
+template <typename T>
+void taylor_adaptive_batch_impl<T>::eval_sv_funcs(const std::vector<T> &state, std::uint32_t i) const
+{
+    assert(m_svf_f != nullptr);
+    assert(state.size() == m_state.size());
+    assert(i < m_batch_size);
+
+    for (std::uint32_t j = 0; j < m_dim; ++j) {
+        m_sv_state[j] = state[j * m_batch_size + i];
+    }
+    for (decltype(m_sv_pars.size()) j = 0; j < m_sv_pars.size(); ++j) {
+        m_sv_pars[j] = m_pars[j * m_batch_size + i];
+    }
+
+    m_svf_f(m_sv_out.data(), m_sv_state.data(), m_sv_pars.data(), 1);
+
+    for (decltype(m_sv_out.size()) j = 0; j < m_sv_out.size(); ++j) {
+        m_sv_values[j * m_batch_size + i] = m_sv_out[j];
+    }
+}
+
+template <typename T>
+const std::vector<T> &taylor_adaptive_batch_impl<T>::get_sv_values() const
+{
+    if (m_svf_f != nullptr) {
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            eval_sv_funcs(m_state, i);
+        }
+    }
+
+    return m_sv_values;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_stop_cond(expression ex)
+{
+    // NOTE: like the sv_funcs, the stop condition is compiled
+    // in scalar mode and evaluated separately for each batch element.
+    const auto n_pars = m_pars.size() / m_batch_size;
+    auto stop_llvm = taylor_make_sv_funcs_state<T>(*m_llvm, *m_dc, m_dim, n_pars, {ex}, "stop_cond");
+
+    m_stop_f = reinterpret_cast<sv_funcs_f_t>(stop_llvm->jit_lookup("stop_cond"));
+    m_stop_llvm = std::move(stop_llvm);
+    m_stop_state.resize(m_dim);
+    m_stop_pars.resize(n_pars);
+    m_stop_cond = std::move(ex);
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::clear_stop_cond()
+{
+    m_stop_llvm.reset();
+    m_stop_f = nullptr;
+    m_stop_cond.reset();
+    m_stop_state.clear();
+    m_stop_pars.clear();
+}
+
+// Evaluate the stop condition for the batch element i of the current state.
+// NOTE: a nan value of the stop condition does not stop the propagation.
+template <typename T>
+bool taylor_adaptive_batch_impl<T>::eval_stop_cond(std::uint32_t i) const
+{
+    assert(m_stop_f != nullptr);
+    assert(i < m_batch_size);
+
+    for (std::uint32_t j = 0; j < m_dim; ++j) {
+        m_stop_state[j] = m_state[j * m_batch_size + i];
+    }
+    for (decltype(m_stop_pars.size()) j = 0; j < m_stop_pars.size(); ++j) {
+        m_stop_pars[j] = m_pars[j * m_batch_size + i];
+    }
+
+    T out(0);
+    m_stop_f(&out, m_stop_state.data(), m_stop_pars.data(), 1);
+
+    return out > 0;
+}
+
+// Reset the cooldowns for the terminal events
+// in the batch element at index i.
+template <typename T>
+void taylor_adaptive_batch_impl<T>::reset_cooldowns(std::uint32_t i)
+{
+    if (i >= m_batch_size) {
+        throw std::invalid_argument(
+            "Cannot reset the cooldowns of the batch element at index {} in a Taylor integrator in batch mode: the "
+            "batch size is only {}"_format(i, m_batch_size));
+    }
+
+    for (auto &cd : m_te_cooldowns[i]) {
+        cd.reset();
+    }
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_lane_active(std::uint32_t i, bool flag)
+{
+    if (i >= m_batch_size) {
+        throw std::invalid_argument(
+            "Cannot set the activity flag of the batch element at index {} in a Taylor integrator in batch mode: the "
+            "batch size is only {}"_format(i, m_batch_size));
+    }
+
+    m_active[i] = static_cast<int>(flag);
+}
+
+template <typename T>
+bool taylor_adaptive_batch_impl<T>::get_lane_active(std::uint32_t i) const
+{
+    if (i >= m_batch_size) {
+        throw std::invalid_argument(
+            "Cannot fetch the activity flag of the batch element at index {} in a Taylor integrator in batch mode: the "
+            "batch size is only {}"_format(i, m_batch_size));
+    }
+
+    return m_active[i] != 0;
+}
+
+template <typename T>
+std::uint32_t taylor_adaptive_batch_impl<T>::get_n_active_lanes() const
+{
+    return static_cast<std::uint32_t>(std::count_if(m_active.begin(), m_active.end(), [](int a) { return a != 0; }));
 }
 
 template <typename T>
 void taylor_adaptive_batch_impl<T>::propagate_for_impl(const std::vector<T> &delta_ts, std::size_t max_steps,
-                                                       const std::vector<T> &max_delta_ts,
-                                                       std::function<bool(taylor_adaptive_batch_impl &)> cb, bool wtc)
+                                                       const std::vector<T> &max_delta_ts, propagate_cb_t cb, bool wtc,
+                                                       const std::vector<std::size_t> &lane_max_steps)
 {
     // Check the dimensionality of delta_ts.
     if (delta_ts.size() != m_batch_size) {
@@ -4590,19 +11176,23 @@ void taylor_adaptive_batch_impl<T>::propagate_for_impl(const std::vector<T> &del
         m_pfor_ts[i] = dfloat<T>(m_time_hi[i], m_time_lo[i]) + delta_ts[i];
     }
 
-    // NOTE: max_delta_ts is checked in propagate_until_impl().
-    propagate_until_impl(m_pfor_ts, max_steps, max_delta_ts, std::move(cb), wtc);
+    // NOTE: max_delta_ts and lane_max_steps are checked in propagate_until_impl().
+    propagate_until_impl(m_pfor_ts, max_steps, max_delta_ts, std::move(cb), wtc, lane_max_steps);
 }
 
 template <typename T>
 void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloat<T>> &ts, std::size_t max_steps,
-                                                         const std::vector<T> &max_delta_ts,
-                                                         std::function<bool(taylor_adaptive_batch_impl &)> cb, bool wtc)
+                                                         const std::vector<T> &max_delta_ts, propagate_cb_t cb,
+                                                         bool wtc, const std::vector<std::size_t> &lane_max_steps)
 {
     using std::abs;
     using std::isfinite;
     using std::isnan;
 
+    trace_span span("taylor_adaptive_batch::propagate_until", "taylor");
+    // NOTE: aggregate the hot-path warnings emitted during the propagation.
+    const warn_aggregation_scope wa_scope;
+
     // NOTE: this function is called from either the other propagate_until() overload,
     // or propagate_for(). In both cases, we have already set up correctly the dimension of ts.
     assert(ts.size() == m_batch_size);
@@ -4638,6 +11228,13 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
         }
     }
 
+    // Check lane_max_steps.
+    if (!lane_max_steps.empty() && lane_max_steps.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of per-lane step budgets specified in a Taylor integrator in batch mode: the batch size is "
+            "{}, but the number of specified budgets is {}"_format(m_batch_size, lane_max_steps.size()));
+    }
+
     // Reset the counters and the min/max abs(h) vectors.
     std::size_t iter_counter = 0;
     for (std::uint32_t i = 0; i < m_batch_size; ++i) {
@@ -4656,8 +11253,30 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
         }
 
         m_t_dir[i] = (m_rem_time[i] >= T(0));
+
+        // NOTE: the inactive batch elements are not propagated,
+        // treat them as if they had already reached the final time.
+        if (m_active[i] == 0) {
+            m_rem_time[i] = dfloat<T>(T(0));
+        }
     }
 
+    // Reset the stop flags.
+    std::fill(m_stop_flags.begin(), m_stop_flags.end(), 0);
+
+    // Helper to fetch the outcome of the batch element i,
+    // accounting for the stop condition and the step budget.
+    auto lane_oc = [this](std::uint32_t i, taylor_outcome oc) {
+        switch (m_stop_flags[i]) {
+            case 1:
+                return taylor_outcome::cb_stop;
+            case 2:
+                return taylor_outcome::step_limit;
+            default:
+                return oc;
+        }
+    };
+
     while (true) {
         // Compute the max integration times for this timestep.
         // NOTE: m_rem_time[i] is guaranteed to be finite: we check it explicitly above
@@ -4673,11 +11292,15 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
 
             // Store it.
             m_cur_max_delta_ts[i] = static_cast<T>(dt_limit);
+
+            // NOTE: the batch elements which have already reached the final
+            // time take zero-length timesteps, skipping the post-step work.
+            m_step_active[i] = static_cast<int>(m_rem_time[i] != dfloat<T>(T(0)));
         }
 
         // Run the integration timestep.
         // NOTE: if dt_limit is zero, step_impl() will always return time_limit.
-        step_impl(m_cur_max_delta_ts, wtc);
+        step_impl(m_cur_max_delta_ts, wtc, m_step_active);
 
         // Check if the integration timestep produced an error condition or we reached
         // a stopping terminal event.
@@ -4687,7 +11310,8 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
             })) {
             // Setup m_prop_res before exiting.
             for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-                m_prop_res[i] = std::tuple{std::get<0>(m_step_res[i]), m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                m_prop_res[i] = std::tuple{lane_oc(i, std::get<0>(m_step_res[i])), m_min_abs_h[i], m_max_abs_h[i],
+                                           m_ts_count[i]};
             }
 
             return;
@@ -4712,6 +11336,21 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
                 m_min_abs_h[i] = std::min(m_min_abs_h[i], abs_h);
                 m_max_abs_h[i] = std::max(m_max_abs_h[i], abs_h);
             }
+
+            // Evaluate the stop condition, if needed.
+            // NOTE: the stopped batch elements take zero-length
+            // timesteps for the remaining iterations (see below).
+            if (m_stop_f != nullptr && h != 0 && eval_stop_cond(i)) {
+                m_stop_flags[i] = 1;
+            }
+
+            // Check the step budget.
+            // NOTE: like in the all_done check below, we check h == rem_time
+            // in order to detect if the final time was reached in this timestep.
+            if (m_stop_flags[i] == 0 && !lane_max_steps.empty() && lane_max_steps[i] != 0u
+                && m_ts_count[i] >= lane_max_steps[i] && h != static_cast<T>(m_rem_time[i])) {
+                m_stop_flags[i] = 2;
+            }
         }
 
         // The step was successful, execute the callback.
@@ -4725,22 +11364,25 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
             return;
         }
 
-        // Break out if we have reached the final time
-        // for all batch elements.
+        // Break out if we have reached the final time (or
+        // we have been stopped) for all batch elements.
         bool all_done = true;
         for (std::uint32_t i = 0; i < m_batch_size; ++i) {
             // NOTE: here we check h == rem_time, instead of just
             // res == time_limit, because clamping via max_delta_t
             // could also result in time_limit.
-            if (std::get<1>(m_step_res[i]) != static_cast<T>(m_rem_time[i])) {
+            if (m_stop_flags[i] == 0 && std::get<1>(m_step_res[i]) != static_cast<T>(m_rem_time[i])) {
                 all_done = false;
                 break;
             }
         }
         if (all_done) {
-            // Setup m_prop_res before exiting. The outcomes will all be time_limit.
+            // Setup m_prop_res before exiting. The outcomes will all be time_limit
+            // (or cb_stop/step_limit for the batch elements stopped by the stop
+            // condition/the step budget).
             for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-                m_prop_res[i] = std::tuple{taylor_outcome::time_limit, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                m_prop_res[i] = std::tuple{lane_oc(i, taylor_outcome::time_limit), m_min_abs_h[i], m_max_abs_h[i],
+                                           m_ts_count[i]};
             }
 
             return;
@@ -4753,12 +11395,14 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
         if (iter_counter == max_steps) {
             // We reached the max_steps limit: the outcome for each batch element must be
             // either step_limit or time_limit.
-            // NOTE: how does the outcome logic change with events?
+            // NOTE: like in the all_done check above, we check h == rem_time
+            // rather than the outcome of the timestep, as the timestep
+            // may have been clamped by max_delta_t or by a terminal event.
             for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-                m_prop_res[i]
-                    = std::tuple{std::get<0>(m_step_res[i]) == taylor_outcome::success ? taylor_outcome::step_limit
-                                                                                       : taylor_outcome::time_limit,
-                                 m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                m_prop_res[i] = std::tuple{lane_oc(i, std::get<1>(m_step_res[i]) == static_cast<T>(m_rem_time[i])
+                                                          ? taylor_outcome::time_limit
+                                                          : taylor_outcome::step_limit),
+                                           m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
             }
 
             return;
@@ -4768,6 +11412,13 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
         for (std::uint32_t i = 0; i < m_batch_size; ++i) {
             const auto [res, h] = m_step_res[i];
 
+            // NOTE: the batch elements stopped by the stop condition
+            // or the step budget take zero-length timesteps from now on.
+            if (m_stop_flags[i] != 0) {
+                m_rem_time[i] = dfloat<T>(T(0));
+                continue;
+            }
+
             // NOTE: if static_cast<T>(m_rem_time[i]) was used as a timestep,
             // it means that we hit the time limit. Force rem_time to zero
             // to signal this, so that zero-length steps will be taken
@@ -4787,8 +11438,8 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<dfloa
 
 template <typename T>
 void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<T> &ts, std::size_t max_steps,
-                                                         const std::vector<T> &max_delta_ts,
-                                                         std::function<bool(taylor_adaptive_batch_impl &)> cb, bool wtc)
+                                                         const std::vector<T> &max_delta_ts, propagate_cb_t cb,
+                                                         bool wtc, const std::vector<std::size_t> &lane_max_steps)
 {
     // Check the dimensionality of ts.
     if (ts.size() != m_batch_size) {
@@ -4803,18 +11454,46 @@ void taylor_adaptive_batch_impl<T>::propagate_until_impl(const std::vector<T> &t
         m_pfor_ts[i] = dfloat<T>(ts[i]);
     }
 
-    // NOTE: max_delta_ts is checked in the other propagate_until_impl() overload.
-    propagate_until_impl(m_pfor_ts, max_steps, max_delta_ts, std::move(cb), wtc);
+    // NOTE: max_delta_ts and lane_max_steps are checked
+    // in the other propagate_until_impl() overload.
+    propagate_until_impl(m_pfor_ts, max_steps, max_delta_ts, std::move(cb), wtc, lane_max_steps);
 }
 
 template <typename T>
 std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vector<T> &grid, std::size_t max_steps,
-                                                                  const std::vector<T> &max_delta_ts,
-                                                                  std::function<bool(taylor_adaptive_batch_impl &)> cb)
+                                                                  const std::vector<T> &max_delta_ts, propagate_cb_t cb,
+                                                                  const std::vector<std::uint32_t> &comps)
+{
+    // Number of output components.
+    const auto n_comps = comps.empty() ? static_cast<std::size_t>(m_dim) : comps.size();
+
+    // Pre-allocate the return value.
+    std::vector<T> retval;
+    // LCOV_EXCL_START
+    if (!grid.empty() && n_comps > std::numeric_limits<decltype(retval.size())>::max() / grid.size()) {
+        throw std::overflow_error("Overflow detected in the creation of the return value of propagate_grid() in an "
+                                  "adaptive Taylor integrator in batch mode");
+    }
+    // LCOV_EXCL_STOP
+    retval.resize(grid.size() * n_comps);
+
+    propagate_grid_impl(grid, max_steps, max_delta_ts, std::move(cb), retval.data(), comps, n_comps * m_batch_size);
+
+    return retval;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vector<T> &grid, std::size_t max_steps,
+                                                        const std::vector<T> &max_delta_ts, propagate_cb_t cb, T *out,
+                                                        const std::vector<std::uint32_t> &comps, std::size_t stride)
 {
     using std::abs;
     using std::isnan;
 
+    trace_span span("taylor_adaptive_batch::propagate_grid", "taylor");
+    // NOTE: aggregate the hot-path warnings emitted during the propagation.
+    const warn_aggregation_scope wa_scope;
+
     // Helper to detect if an input value is nonfinite.
     auto is_nf = [](const T &t) {
         using std::isfinite;
@@ -4906,15 +11585,59 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
         }
     }
 
-    // Pre-allocate the return value.
-    std::vector<T> retval;
+    // Check the output buffer and the output components.
+    if (out == nullptr) {
+        throw std::invalid_argument("A null output buffer was passed to the propagate_grid() function of an adaptive "
+                                    "Taylor integrator in batch mode");
+    }
+    // NOTE: the components dim, dim + 1, ... select the sv_funcs.
+    for (auto c : comps) {
+        if (c >= m_dim + m_sv_funcs.size()) {
+            throw std::invalid_argument(
+                "Invalid output component {} passed to the propagate_grid() function of an adaptive Taylor "
+                "integrator in batch mode: the component must be less than the dimension of the system plus the "
+                "number of sv_funcs ({})"_format(c, m_dim + m_sv_funcs.size()));
+        }
+    }
+    const auto with_sv = std::any_of(comps.begin(), comps.end(), [this](auto c) { return c >= m_dim; });
+    const auto n_comps = comps.empty() ? static_cast<std::size_t>(m_dim) : comps.size();
     // LCOV_EXCL_START
-    if (get_dim() > std::numeric_limits<decltype(retval.size())>::max() / grid.size()) {
-        throw std::overflow_error("Overflow detected in the creation of the return value of propagate_grid() in an "
+    if (n_comps > std::numeric_limits<std::size_t>::max() / m_batch_size) {
+        throw std::overflow_error("Overflow detected in the computation of the stride in propagate_grid() in an "
                                   "adaptive Taylor integrator in batch mode");
     }
     // LCOV_EXCL_STOP
-    retval.resize(grid.size() * get_dim());
+    if (stride == 0u) {
+        stride = n_comps * m_batch_size;
+    } else if (stride < n_comps * m_batch_size) {
+        throw std::invalid_argument(
+            "The stride passed to the propagate_grid() function of an adaptive Taylor integrator in batch mode ({}) "
+            "is less than the number of output components times the batch size ({})"_format(stride,
+                                                                                            n_comps * m_batch_size));
+    }
+
+    // Helper to write into the output buffer the selected
+    // components of the state vector src for the batch element i
+    // at the grid index gidx.
+    auto write_out = [&](const std::vector<T> &src, decltype(grid.size()) gidx, std::uint32_t i) {
+        auto *const dst = out + gidx * stride;
+
+        if (comps.empty()) {
+            for (std::uint32_t j = 0; j < m_dim; ++j) {
+                dst[j * m_batch_size + i] = src[j * m_batch_size + i];
+            }
+        } else {
+            if (with_sv) {
+                eval_sv_funcs(src, i);
+            }
+
+            for (decltype(comps.size()) j = 0; j < comps.size(); ++j) {
+                const auto c = comps[j];
+                dst[j * m_batch_size + i]
+                    = c < m_dim ? src[c * m_batch_size + i] : m_sv_values[(c - m_dim) * m_batch_size + i];
+            }
+        }
+    };
 
     // Propagate the system up to the first batch of grid points.
     // NOTE: this will *not* write the TCs, but because we know that
@@ -4945,11 +11668,16 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
             ts_count = 0;
         }
 
-        return retval;
+        return;
     }
 
-    // Add the first result to retval.
-    std::copy(m_state.begin(), m_state.end(), retval.begin());
+    // Write the first result.
+    // NOTE: the inactive batch elements do not write any output.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        if (m_active[i] != 0) {
+            write_out(m_state, 0, i);
+        }
+    }
 
     // Init the remaining times and directions.
     for (std::uint32_t i = 0; i < m_batch_size; ++i) {
@@ -4962,6 +11690,12 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
         }
 
         m_t_dir[i] = (m_rem_time[i] >= T(0));
+
+        // NOTE: the inactive batch elements are not propagated
+        // (see propagate_until_impl()).
+        if (m_active[i] == 0) {
+            m_rem_time[i] = dfloat<T>(T(0));
+        }
     }
 
     // Reset the counters and the min/max abs(h) vectors.
@@ -4979,6 +11713,12 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
     // index 0 already.
     std::vector<decltype(grid.size())> cur_grid_idx(
         boost::numeric_cast<typename std::vector<decltype(grid.size())>::size_type>(m_batch_size), 1);
+    // NOTE: the inactive batch elements have no grid points to process.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        if (m_active[i] == 0) {
+            cur_grid_idx[i] = n_grid_points;
+        }
+    }
 
     // Vectors to keep track of the time range of the last taken timestep.
     std::vector<dfloat<T>> t0(boost::numeric_cast<typename std::vector<dfloat<T>>::size_type>(m_batch_size)), t1(t0);
@@ -5056,14 +11796,10 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
             // Compute the dense output.
             update_d_output(pgrid_tmp);
 
-            // Add the results to retval and bump up the values in cur_grid_idx.
+            // Write the results and bump up the values in cur_grid_idx.
             for (std::uint32_t i = 0; i < m_batch_size; ++i) {
                 if (dflags[i] != 0u) {
-                    const auto gidx = cur_grid_idx[i];
-
-                    for (std::uint32_t j = 0; j < m_dim; ++j) {
-                        retval[gidx * m_batch_size * m_dim + j * m_batch_size + i] = m_d_out[j * m_batch_size + i];
-                    }
+                    write_out(m_d_out, cur_grid_idx[i], i);
 
                     assert(cur_grid_idx[i] < n_grid_points);
                     ++cur_grid_idx[i];
@@ -5098,8 +11834,12 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
                                              : std::max(dfloat<T>(-max_delta_t), m_rem_time[i]);
 
             pgrid_tmp[i] = static_cast<T>(dt_limit);
+
+            // NOTE: the batch elements which have already reached
+            // the last grid point take zero-length timesteps.
+            m_step_active[i] = static_cast<int>(m_rem_time[i] != dfloat<T>(T(0)));
         }
-        step_impl(pgrid_tmp, true);
+        step_impl(pgrid_tmp, true, m_step_active);
 
         // Check the result of the integration.
         if (std::any_of(m_step_res.begin(), m_step_res.end(), [](const auto &t) {
@@ -5113,7 +11853,7 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
                 m_prop_res[i] = std::tuple{std::get<0>(m_step_res[i]), m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
             }
 
-            return retval;
+            return;
         }
 
         // Update the number of iterations.
@@ -5163,7 +11903,7 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
                 m_prop_res[i] = std::tuple{taylor_outcome::cb_stop, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
             }
 
-            return retval;
+            return;
         }
 
         // Check the iteration limit.
@@ -5173,14 +11913,15 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
         if (iter_counter == max_steps) {
             // We reached the max_steps limit: the outcome for each batch element must be
             // either step_limit or time_limit.
+            // NOTE: m_rem_time[i] was set to zero above if the
+            // batch element reached the last grid point.
             for (std::uint32_t i = 0; i < m_batch_size; ++i) {
-                m_prop_res[i]
-                    = std::tuple{std::get<0>(m_step_res[i]) == taylor_outcome::success ? taylor_outcome::step_limit
-                                                                                       : taylor_outcome::time_limit,
-                                 m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                m_prop_res[i] = std::tuple{m_rem_time[i] == dfloat<T>(T(0)) ? taylor_outcome::time_limit
+                                                                            : taylor_outcome::step_limit,
+                                           m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
             }
 
-            return retval;
+            return;
         }
     }
 
@@ -5188,6 +11929,335 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
     for (std::uint32_t i = 0; i < m_batch_size; ++i) {
         m_prop_res[i] = std::tuple{taylor_outcome::time_limit, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
     }
+}
+
+template <typename T>
+std::vector<std::vector<T>> taylor_adaptive_batch_impl<T>::propagate_grid_lanes_impl(
+    std::vector<std::vector<T>> grids, std::size_t max_steps, const std::vector<T> &max_delta_ts, propagate_cb_t cb,
+    refill_cb_t refill, const std::vector<std::uint32_t> &comps)
+{
+    using std::abs;
+    using std::isfinite;
+    using std::isnan;
+
+    // Check the number of grids.
+    if (grids.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of grids passed to propagate_grid_lanes() in an adaptive Taylor integrator in batch mode: "
+            "the batch size is {}, but the number of grids is {}"_format(m_batch_size, grids.size()));
+    }
+
+    // Check max_delta_ts.
+    if (max_delta_ts.size() != m_batch_size) {
+        throw std::invalid_argument(
+            "Invalid number of max timesteps specified in a Taylor integrator in batch mode: the batch size is {}, "
+            "but the number of specified timesteps is {}"_format(m_batch_size, max_delta_ts.size()));
+    }
+    for (const auto &dt : max_delta_ts) {
+        if (isnan(dt)) {
+            throw std::invalid_argument("A nan max_delta_t was passed to the propagate_grid_lanes() function of an "
+                                        "adaptive Taylor integrator in batch mode");
+        }
+        if (dt <= 0) {
+            throw std::invalid_argument("A non-positive max_delta_t was passed to the propagate_grid_lanes() function "
+                                        "of an adaptive Taylor integrator in batch mode");
+        }
+    }
+
+    // Check the output components.
+    // NOTE: the components dim, dim + 1, ... select the sv_funcs.
+    for (auto c : comps) {
+        if (c >= m_dim + m_sv_funcs.size()) {
+            throw std::invalid_argument(
+                "Invalid output component {} passed to the propagate_grid_lanes() function of an adaptive Taylor "
+                "integrator in batch mode: the component must be less than the dimension of the system plus the "
+                "number of sv_funcs ({})"_format(c, m_dim + m_sv_funcs.size()));
+        }
+    }
+    const auto with_sv = std::any_of(comps.begin(), comps.end(), [this](auto c) { return c >= m_dim; });
+    const auto n_comps = comps.empty() ? static_cast<std::size_t>(m_dim) : comps.size();
+
+    using g_size_t = typename std::vector<T>::size_type;
+
+    // The return value and the status of each batch element: index of
+    // the next grid point, number of steps taken in the current task and
+    // activity flag (0 for idle, 1 for active, 2 for a task completed in
+    // the current iteration, pending the invocation of the refill callback).
+    std::vector<std::vector<T>> retval(grids.size());
+    std::vector<g_size_t> gidx(grids.size());
+    std::vector<std::size_t> n_steps(grids.size());
+    std::vector<unsigned> active(grids.size());
+
+    // Helper to write into the output of the batch element i the selected
+    // components of the state vector src at the next grid point.
+    auto write_out = [&](const std::vector<T> &src, std::uint32_t i) {
+        assert(gidx[i] < grids[i].size());
+        auto *const dst = retval[i].data() + gidx[i] * n_comps;
+
+        if (comps.empty()) {
+            for (std::uint32_t j = 0; j < m_dim; ++j) {
+                dst[j] = src[j * m_batch_size + i];
+            }
+        } else {
+            if (with_sv) {
+                eval_sv_funcs(src, i);
+            }
+
+            for (decltype(comps.size()) j = 0; j < comps.size(); ++j) {
+                const auto c = comps[j];
+                dst[j] = c < m_dim ? src[c * m_batch_size + i] : m_sv_values[(c - m_dim) * m_batch_size + i];
+            }
+        }
+
+        ++gidx[i];
+    };
+
+    // Helper to set up a new task for the batch element i: check its grid,
+    // reset the output and the counters and write the output for the grid point
+    // at the current time, if any. Returns true if the batch element has to be
+    // propagated, false if the task is already complete.
+    auto setup_lane = [&](std::uint32_t i) {
+        const auto &grid = grids[i];
+
+        const dfloat<T> cur_time(m_time_hi[i], m_time_lo[i]);
+        if (!isfinite(cur_time)) {
+            throw std::invalid_argument("Cannot invoke propagate_grid_lanes() in an adaptive Taylor integrator in "
+                                        "batch mode if the current time is not finite");
+        }
+
+        // LCOV_EXCL_START
+        if (n_comps > std::numeric_limits<g_size_t>::max() / std::max(grid.size(), g_size_t(1))) {
+            throw std::overflow_error("Overflow detected in the creation of the return value of "
+                                      "propagate_grid_lanes() in an adaptive Taylor integrator in batch mode");
+        }
+        // LCOV_EXCL_STOP
+
+        retval[i].clear();
+        retval[i].resize(grid.size() * n_comps);
+        gidx[i] = 0;
+        n_steps[i] = 0;
+        m_ts_count[i] = 0;
+        m_min_abs_h[i] = std::numeric_limits<T>::infinity();
+        m_max_abs_h[i] = 0;
+
+        if (grid.empty()) {
+            return false;
+        }
+
+        if (std::any_of(grid.begin(), grid.end(), [](const T &t) { return !isfinite(t); })) {
+            throw std::invalid_argument("A non-finite time value was passed to propagate_grid_lanes() in an adaptive "
+                                        "Taylor integrator in batch mode");
+        }
+
+        // Init the remaining time and the direction.
+        m_rem_time[i] = grid.back() - cur_time;
+        if (!isfinite(m_rem_time[i])) {
+            throw std::invalid_argument("The final time passed to the propagate_grid_lanes() function of an adaptive "
+                                        "Taylor integrator in batch mode results in an overflow condition");
+        }
+        m_t_dir[i] = (m_rem_time[i] >= T(0));
+
+        // Check that the grid is strictly monotonic in the
+        // direction of the propagation.
+        const auto first_ok = m_t_dir[i] ? dfloat<T>(grid[0]) >= cur_time : dfloat<T>(grid[0]) <= cur_time;
+        auto bad_pair = [dir = m_t_dir[i]](const T &a, const T &b) { return dir ? !(b > a) : !(b < a); };
+        if (!first_ok || std::adjacent_find(grid.begin(), grid.end(), bad_pair) != grid.end()) {
+            throw std::invalid_argument("A non-monotonic time grid was passed to propagate_grid_lanes() in an adaptive "
+                                        "Taylor integrator in batch mode");
+        }
+
+        // NOTE: a grid point at the current time can be written
+        // directly, without using the dense output (which would
+        // refer to the last timestep, possibly of a previous task).
+        if (dfloat<T>(grid[0]) == cur_time) {
+            write_out(m_state, i);
+        }
+
+        return gidx[i] < grid.size();
+    };
+
+    // Helper to complete the task of the batch element i with
+    // outcome oc, and to invoke the refill callback (if any) until
+    // either a task requiring propagation is set up or the
+    // batch element is left idle.
+    auto finish_lane = [&](std::uint32_t i, taylor_outcome oc) {
+        active[i] = 0;
+        m_prop_res[i] = std::tuple{oc, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+
+        while (refill && refill(*this, i, grids[i], retval[i])) {
+            if (setup_lane(i)) {
+                active[i] = 1;
+                return;
+            }
+
+            // NOTE: the new task was completed without
+            // propagation (empty grid or single grid point
+            // at the current time).
+            m_prop_res[i] = std::tuple{taylor_outcome::time_limit, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+        }
+    };
+
+    // Set up the initial tasks.
+    // NOTE: the inactive batch elements are left idle,
+    // and the refill callback is not invoked for them.
+    for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+        if (m_active[i] == 0) {
+            m_prop_res[i] = std::tuple{taylor_outcome::time_limit, std::numeric_limits<T>::infinity(), T(0),
+                                       std::size_t(0)};
+            continue;
+        }
+
+        if (setup_lane(i)) {
+            active[i] = 1;
+        } else {
+            finish_lane(i, taylor_outcome::time_limit);
+        }
+    }
+
+    auto any_active = [&active]() { return std::any_of(active.begin(), active.end(), [](auto a) { return a != 0u; }); };
+
+    // Temporary vectors: the timesteps/grid points, the time ranges
+    // of the last timestep and the dense output flags.
+    std::vector<T> pgrid_tmp(boost::numeric_cast<typename std::vector<T>::size_type>(m_batch_size));
+    std::vector<dfloat<T>> t0(boost::numeric_cast<typename std::vector<dfloat<T>>::size_type>(m_batch_size)), t1(t0);
+    std::vector<unsigned> dflags(boost::numeric_cast<std::vector<unsigned>::size_type>(m_batch_size));
+
+    while (any_active()) {
+        // Take the next step, making sure to write the Taylor coefficients
+        // and to cap the timestep size so that the active batch elements don't go
+        // past the last grid point and don't use a timestep exceeding max_delta_t.
+        // The idle batch elements take zero-length steps.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] != 0u) {
+                assert((m_rem_time[i] >= T(0)) == m_t_dir[i] || m_rem_time[i] == T(0));
+                const auto dt_limit = m_t_dir[i] ? std::min(dfloat<T>(max_delta_ts[i]), m_rem_time[i])
+                                                 : std::max(dfloat<T>(-max_delta_ts[i]), m_rem_time[i]);
+
+                pgrid_tmp[i] = static_cast<T>(dt_limit);
+            } else {
+                pgrid_tmp[i] = 0;
+            }
+
+            m_step_active[i] = static_cast<int>(active[i] != 0u);
+        }
+        step_impl(pgrid_tmp, true, m_step_active);
+
+        // Process the outcomes of the step for the active batch elements.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 0u) {
+                continue;
+            }
+
+            const auto [res, h] = m_step_res[i];
+
+            if (res != taylor_outcome::success && res != taylor_outcome::time_limit && res < taylor_outcome{0}) {
+                // Non-finite state or stopping terminal event: the remaining
+                // grid points for this batch element cannot be reached.
+                // NOTE: mark the batch element as complete, the refill
+                // callback will be invoked below.
+                active[i] = 2;
+                m_prop_res[i] = std::tuple{res, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+
+                continue;
+            }
+
+            m_ts_count[i] += static_cast<std::size_t>(h != 0);
+            ++n_steps[i];
+
+            // Update the remaining time (see propagate_grid_impl()).
+            if (h == static_cast<T>(m_rem_time[i])) {
+                assert(res == taylor_outcome::time_limit);
+                m_rem_time[i] = dfloat<T>(T(0));
+            } else {
+                m_rem_time[i] = grids[i].back() - dfloat<T>(m_time_hi[i], m_time_lo[i]);
+            }
+
+            if (res == taylor_outcome::success) {
+                const auto abs_h = abs(h);
+                m_min_abs_h[i] = std::min(m_min_abs_h[i], abs_h);
+                m_max_abs_h[i] = std::max(m_max_abs_h[i], abs_h);
+            }
+
+            // Establish the time range of the last timestep.
+            const dfloat<T> cur_time(m_time_hi[i], m_time_lo[i]), cmp = cur_time - m_last_h[i];
+            t0[i] = std::min(cur_time, cmp);
+            t1[i] = std::max(cur_time, cmp);
+        }
+
+        // Compute the state of the system via dense output for as many grid
+        // points as possible (see propagate_grid_impl()).
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            dflags[i] = static_cast<unsigned>(active[i] == 1u);
+        }
+        while (true) {
+            std::uint32_t counter = 0;
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (dflags[i] != 0u && gidx[i] < grids[i].size()) {
+                    const auto gt = grids[i][gidx[i]];
+                    const auto d_avail = (gt >= t0[i] && gt <= t1[i]) || (m_rem_time[i] == dfloat<T>(T(0)));
+                    dflags[i] = d_avail;
+                    counter += d_avail;
+
+                    pgrid_tmp[i] = gt;
+                } else {
+                    dflags[i] = 0;
+
+                    // NOTE: the dense output for this batch element
+                    // is not used, just pass the current time.
+                    pgrid_tmp[i] = m_time_hi[i];
+                }
+            }
+
+            if (counter == 0u) {
+                break;
+            }
+
+            update_d_output(pgrid_tmp);
+
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (dflags[i] != 0u) {
+                    write_out(m_d_out, i);
+                }
+            }
+        }
+
+        // Check for completed tasks and for the step limit.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] != 1u) {
+                continue;
+            }
+
+            if (gidx[i] == grids[i].size()) {
+                m_prop_res[i] = std::tuple{taylor_outcome::time_limit, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                active[i] = 2;
+            } else if (n_steps[i] == max_steps) {
+                // NOTE: if max_steps is 0, this will never trigger
+                // because n_steps[i] is at least 1 here.
+                m_prop_res[i] = std::tuple{taylor_outcome::step_limit, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                active[i] = 2;
+            }
+        }
+
+        // Invoke the callback, if needed.
+        if (cb && !cb(*this)) {
+            // Set the outcome to cb_stop for the batch
+            // elements with unfinished tasks.
+            for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+                if (active[i] == 1u) {
+                    m_prop_res[i] = std::tuple{taylor_outcome::cb_stop, m_min_abs_h[i], m_max_abs_h[i], m_ts_count[i]};
+                }
+            }
+
+            return retval;
+        }
+
+        // Refill the batch elements whose task was completed.
+        for (std::uint32_t i = 0; i < m_batch_size; ++i) {
+            if (active[i] == 2u) {
+                finish_lane(i, std::get<0>(m_prop_res[i]));
+            }
+        }
+    }
 
     return retval;
 }
@@ -5195,36 +12265,137 @@ std::vector<T> taylor_adaptive_batch_impl<T>::propagate_grid_impl(const std::vec
 template <typename T>
 const llvm_state &taylor_adaptive_batch_impl<T>::get_llvm_state() const
 {
-    return m_llvm;
+    return *m_llvm;
+}
+
+template <typename T>
+taylor_memory_usage taylor_adaptive_batch_impl<T>::get_memory_usage() const
+{
+    taylor_memory_usage retval;
+
+    retval.state = taylor_vec_mem_usage(m_state) + taylor_vec_mem_usage(m_time_hi) + taylor_vec_mem_usage(m_time_lo);
+    retval.pars = taylor_vec_mem_usage(m_pars);
+    retval.tc = taylor_vec_mem_usage(m_tc);
+    retval.d_out = taylor_vec_mem_usage(m_d_out) + taylor_vec_mem_usage(m_d_out_time);
+    retval.events = taylor_vec_mem_usage(m_ev_jet) + taylor_nested_vec_mem_usage(m_d_tes)
+                    + taylor_nested_vec_mem_usage(m_d_ntes) + taylor_nested_vec_mem_usage(m_te_cooldowns)
+                    + taylor_ed_data_mem_usage(m_ed_data) + taylor_vec_mem_usage(m_ev_orig_h);
+    retval.other = taylor_vec_mem_usage(m_last_h) + taylor_vec_mem_usage(m_tc_enc) + taylor_vec_mem_usage(m_pinf)
+                   + taylor_vec_mem_usage(m_minf) + taylor_vec_mem_usage(m_delta_ts)
+                   + taylor_vec_mem_usage(m_step_flags) + taylor_vec_mem_usage(m_step_res)
+                   + taylor_vec_mem_usage(m_prop_res) + taylor_vec_mem_usage(m_ts_count)
+                   + taylor_vec_mem_usage(m_min_abs_h) + taylor_vec_mem_usage(m_max_abs_h)
+                   + taylor_vec_mem_usage(m_cur_max_delta_ts) + taylor_vec_mem_usage(m_pfor_ts)
+                   + taylor_vec_mem_usage(m_t_dir) + taylor_vec_mem_usage(m_rem_time);
+    retval.decomposition = taylor_dc_mem_usage(*m_dc);
+
+    taylor_add_llvm_mem_usage(retval, m_llvm.get());
+
+    taylor_mem_usage_finalise(retval);
+
+    return retval;
 }
 
 template <typename T>
 const taylor_dc_t &taylor_adaptive_batch_impl<T>::get_decomposition() const
 {
-    return m_dc;
+    return *m_dc;
+}
+
+template <typename T>
+std::uint32_t taylor_adaptive_batch_impl<T>::get_order() const
+{
+    return m_order;
+}
+
+template <typename T>
+std::uint32_t taylor_adaptive_batch_impl<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+template <typename T>
+std::uint32_t taylor_adaptive_batch_impl<T>::get_dim() const
+{
+    return m_dim;
+}
+
+// The size of the jet of derivatives used
+// in the steps with events.
+template <typename T>
+std::size_t taylor_adaptive_batch_impl<T>::ev_jet_size() const
+{
+    if (m_tes.empty() && m_ntes.empty()) {
+        return 0;
+    }
+
+    // NOTE: the absence of overflows has been
+    // checked in the construction of the integrator.
+    return (m_dim + static_cast<std::size_t>(m_tes.size() + m_ntes.size())) * (m_order + 1u) * m_batch_size;
+}
+
+template <typename T>
+void taylor_adaptive_batch_impl<T>::set_thread_scratch(bool flag)
+{
+    if (flag == m_thread_scratch) {
+        return;
+    }
+
+    if (flag) {
+        // NOTE: copy out the pending tcs
+        // before releasing m_ev_jet.
+        sync_tc();
+        aligned_vector<T>{}.swap(m_ev_jet);
+    } else {
+        m_ev_jet.resize(ev_jet_size());
+    }
+
+    m_thread_scratch = flag;
 }
 
+// Copy the Taylor coefficients of the state variables
+// from m_ev_jet into m_tc, if needed.
 template <typename T>
-std::uint32_t taylor_adaptive_batch_impl<T>::get_order() const
+void taylor_adaptive_batch_impl<T>::sync_tc() const
 {
-    return m_order;
+    if (m_tc_pending) {
+        assert(m_ev_jet.size() >= m_tc.size());
+        std::copy(m_ev_jet.data(), m_ev_jet.data() + m_tc.size(), m_tc.data());
+
+        m_tc_pending = false;
+    }
 }
 
 template <typename T>
-std::uint32_t taylor_adaptive_batch_impl<T>::get_batch_size() const
+const std::vector<T> &taylor_adaptive_batch_impl<T>::get_tc() const
 {
-    return m_batch_size;
+    sync_tc();
+
+    return m_tc;
 }
 
 template <typename T>
-std::uint32_t taylor_adaptive_batch_impl<T>::get_dim() const
+const std::vector<T> &taylor_adaptive_batch_impl<T>::get_step_enclosure()
 {
-    return m_dim;
+    if (m_tc_enc_f == nullptr) {
+        m_tc_enc_f = taylor_get_tc_enc_function<T>(m_dim, m_order, m_batch_size);
+    }
+
+    // NOTE: no overflow check needed here, the size of the
+    // enclosure is checked when fetching the function.
+    m_tc_enc.resize(static_cast<decltype(m_tc_enc.size())>(m_dim) * 2u * m_batch_size);
+
+    sync_tc();
+    m_tc_enc_f(m_tc_enc.data(), m_tc.data(), m_last_h.data());
+
+    return m_tc_enc;
 }
 
 template <typename T>
 const std::vector<T> &taylor_adaptive_batch_impl<T>::update_d_output(const std::vector<T> &time, bool rel_time)
 {
+    sync_tc();
+
     // Check the dimensionality of time.
     if (time.size() != m_batch_size) {
         throw std::invalid_argument(
@@ -5253,41 +12424,154 @@ const std::vector<T> &taylor_adaptive_batch_impl<T>::update_d_output(const std::
     return m_d_out;
 }
 
+// Compute the dense output at the n batches of time coordinates in times
+// (with shape (n, batch_size)), writing the results into out with
+// shape (n, dim, batch_size).
+template <typename T>
+void taylor_adaptive_batch_impl<T>::update_d_output(const T *times, std::size_t n, T *out, bool rel_time) const
+{
+    if (n == 0u) {
+        return;
+    }
+
+    if (times == nullptr || out == nullptr) {
+        throw std::invalid_argument("A null pointer was passed to the multi-point update_d_output() function of an "
+                                    "adaptive Taylor integrator in batch mode");
+    }
+
+    sync_tc();
+
+    const auto bs = static_cast<std::size_t>(m_batch_size);
+    const auto out_size = static_cast<std::size_t>(m_dim) * bs;
+
+    // NOTE: use a local vector for the timesteps, so that
+    // this function can be const.
+    std::vector<T> hs(bs);
+
+    // NOTE: the starting times of the previous timestep
+    // are computed once for all the time coordinates.
+    std::vector<dfloat<T>> t0s;
+    if (!rel_time) {
+        t0s.reserve(bs);
+        for (std::size_t i = 0; i < bs; ++i) {
+            t0s.push_back(dfloat<T>(m_time_hi[i], m_time_lo[i]) - m_last_h[i]);
+        }
+    }
+
+    for (std::size_t j = 0; j < n; ++j) {
+        const auto *cur_times = times + j * bs;
+
+        for (std::size_t i = 0; i < bs; ++i) {
+            if (rel_time) {
+                hs[i] = m_last_h[i] + cur_times[i];
+            } else {
+                hs[i] = static_cast<T>(cur_times[i] - t0s[i]);
+            }
+        }
+
+        m_d_out_f(out + j * out_size, m_tc.data(), hs.data());
+    }
+}
+
+// Compute the dense output at the time coordinates in times, which
+// contains k time coordinates for each batch element (i.e., it has shape
+// (batch_size, k)). The results are returned with shape (k, dim, batch_size).
+template <typename T>
+std::vector<T> taylor_adaptive_batch_impl<T>::update_d_output_lanes(const std::vector<T> &times, bool rel_time) const
+{
+    const auto bs = static_cast<std::size_t>(m_batch_size);
+
+    if (times.size() % bs != 0u) {
+        throw std::invalid_argument(
+            "Invalid number of time coordinates specified for the dense output in a Taylor integrator in batch "
+            "mode: the number of time coordinates ({}) is not a multiple of the batch size ({})"_format(
+                times.size(), bs));
+    }
+
+    const auto k = times.size() / bs;
+
+    // Transpose the time coordinates into
+    // the (k, batch_size) layout.
+    std::vector<T> tr_times(times.size());
+    for (std::size_t i = 0; i < bs; ++i) {
+        for (std::size_t j = 0; j < k; ++j) {
+            tr_times[j * bs + i] = times[i * k + j];
+        }
+    }
+
+    // LCOV_EXCL_START
+    if (k > std::numeric_limits<std::size_t>::max() / m_dim / bs) {
+        throw std::overflow_error("Overflow detected in the creation of the return value of update_d_output_lanes() "
+                                  "in an adaptive Taylor integrator in batch mode");
+    }
+    // LCOV_EXCL_STOP
+
+    std::vector<T> retval(k * m_dim * bs);
+    update_d_output(tr_times.data(), k, retval.data(), rel_time);
+
+    return retval;
+}
+
 // Explicit instantiation of the batch implementation classes.
 template class taylor_adaptive_batch_impl<double>;
 
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<double>::finalise_ctor_impl(std::vector<expression>, std::vector<double>, std::uint32_t,
-                                                       std::vector<double>, double, bool, bool, std::vector<double>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<double>, std::uint32_t, std::vector<double>, double, bool, bool, bool,
+    std::vector<double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool, std::vector<double>);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    std::vector<std::pair<expression, expression>>, std::vector<double>, std::uint32_t, std::vector<double>, double,
+    bool, bool, bool, std::vector<double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool,
+    bool, std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool,
+    std::vector<double>);
 
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
-                                                       std::vector<double>, std::uint32_t, std::vector<double>, double,
-                                                       bool, bool, std::vector<double>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<double>::finalise_ctor_impl(
+    taylor_precomputed_dc, std::vector<double>, std::uint32_t, std::vector<double>, double, bool, bool, bool,
+    std::vector<double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool, std::vector<double>);
 
 template class taylor_adaptive_batch_impl<long double>;
 
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(std::vector<expression>, std::vector<long double>,
-                                                            std::uint32_t, std::vector<long double>, long double, bool,
-                                                            bool, std::vector<long double>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<long double>, std::uint32_t, std::vector<long double>, long double, bool, bool,
+    bool, std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool,
+    std::vector<long double>);
 
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
     std::vector<std::pair<expression, expression>>, std::vector<long double>, std::uint32_t, std::vector<long double>,
-    long double, bool, bool, std::vector<long double>);
+    long double, bool, bool, bool, std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool,
+    std::uint32_t, bool, bool, std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t,
+    bool, std::vector<long double>);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<long double>::finalise_ctor_impl(
+    taylor_precomputed_dc, std::vector<long double>, std::uint32_t, std::vector<long double>, long double, bool, bool,
+    bool, std::vector<long double>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool, bool,
+    std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool,
+    std::vector<long double>);
 
 #if defined(HEYOKA_HAVE_REAL128)
 
 template class taylor_adaptive_batch_impl<mppp::real128>;
 
-template HEYOKA_DLL_PUBLIC void
-taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(std::vector<expression>, std::vector<mppp::real128>,
-                                                              std::uint32_t, std::vector<mppp::real128>, mppp::real128,
-                                                              bool, bool, std::vector<mppp::real128>);
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
+    std::vector<expression>, std::vector<mppp::real128>, std::uint32_t, std::vector<mppp::real128>, mppp::real128, bool,
+    bool, bool, std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool,
+    bool, std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool,
+    std::vector<mppp::real128>);
 
 template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
     std::vector<std::pair<expression, expression>>, std::vector<mppp::real128>, std::uint32_t,
-    std::vector<mppp::real128>, mppp::real128, bool, bool, std::vector<mppp::real128>);
+    std::vector<mppp::real128>, mppp::real128, bool, bool, bool, std::vector<mppp::real128>, std::vector<t_event_t>,
+    std::vector<nt_event_t>, bool, std::uint32_t, bool, bool, std::uint32_t, bool, std::vector<expression>,
+    std::vector<expression>, std::uint32_t, bool, std::vector<mppp::real128>);
+
+template HEYOKA_DLL_PUBLIC void taylor_adaptive_batch_impl<mppp::real128>::finalise_ctor_impl(
+    taylor_precomputed_dc, std::vector<mppp::real128>, std::uint32_t, std::vector<mppp::real128>, mppp::real128, bool,
+    bool, bool, std::vector<mppp::real128>, std::vector<t_event_t>, std::vector<nt_event_t>, bool, std::uint32_t, bool,
+    bool, std::uint32_t, bool, std::vector<expression>, std::vector<expression>, std::uint32_t, bool,
+    std::vector<mppp::real128>);
 
 #endif
 
@@ -5385,7 +12669,7 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
 
     // Compute the jet of derivatives.
     auto diff_variant = taylor_compute_jet<T>(s, in_out, par_ptr, time_ptr, dc, sv_funcs_dc, n_eq, n_uvars, order,
-                                              batch_size, compact_mode);
+                                              batch_size, compact_mode, false, 0, false);
 
     // Write the derivatives to in_out.
     // NOTE: overflow checking. We need to be able to index into the jet array
@@ -5525,6 +12809,151 @@ auto taylor_add_jet_impl(llvm_state &s, const std::string &name, U sys, std::uin
     return dc;
 }
 
+// Implementation of taylor_add_par_jet().
+template <typename T>
+taylor_dc_t taylor_add_par_jet_impl(llvm_state &s, const std::string &name,
+                                    std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                                    std::uint32_t batch_size)
+{
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A function for the computation of the jet of Taylor derivatives cannot be added "
+                                    "to an llvm_state after compilation");
+    }
+
+    if (order == 0u) {
+        throw std::invalid_argument("The order of a Taylor jet cannot be zero");
+    }
+
+    if (batch_size == 0u) {
+        throw std::invalid_argument("The batch size of a Taylor jet cannot be zero");
+    }
+
+    auto &builder = s.builder();
+
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    auto dc = taylor_decompose(std::move(sys), {}).first;
+
+    assert(dc.size() > n_eq);
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    // NOTE: overflow checking. We need to be able to index into the jet array
+    // (size (order + 1) * n_uvars * batch_size) using uint32_t.
+    // LCOV_EXCL_START
+    if (order == std::numeric_limits<std::uint32_t>::max()
+        || (order + 1u) > std::numeric_limits<std::uint32_t>::max() / batch_size
+        || n_uvars > std::numeric_limits<std::uint32_t>::max() / ((order + 1u) * batch_size)) {
+        throw std::overflow_error("An overflow condition was detected while adding a Taylor jet");
+    }
+    // LCOV_EXCL_STOP
+
+    // Flag the parameter-dependent u variables.
+    std::vector<bool> par_dep(n_uvars);
+    for (auto idx : taylor_par_dep_uvars(dc, n_eq)) {
+        par_dep[idx] = true;
+    }
+
+    // Helper to fetch the pointer to the derivative of order o
+    // of the u variable idx in the jet array.
+    auto jet_elem_ptr = [&builder, n_uvars, batch_size](llvm::Value *jet_ptr, std::uint32_t o, std::uint32_t idx) {
+        return builder.CreateInBoundsGEP(jet_ptr, {builder.getInt32((o * n_uvars + idx) * batch_size)});
+    };
+
+    // Add a function with the given name. If partial is true, the derivatives
+    // of the parameter-independent u variables are loaded from the jet
+    // array instead of being computed.
+    auto add_func = [&](const std::string &fname, bool partial) {
+        // The function arguments: the jet array, the pars
+        // and the time. These arrays cannot overlap.
+        std::vector<llvm::Type *> fargs(3, llvm::PointerType::getUnqual(to_llvm_type<T>(s.context())));
+        auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+        assert(ft != nullptr);
+        auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, fname, &s.module());
+        if (f == nullptr) {
+            throw std::invalid_argument("Unable to create a function for the computation of the jet of Taylor "
+                                        "derivatives with name '{}'"_format(fname));
+        }
+
+        auto *jet_ptr = f->args().begin();
+        jet_ptr->setName("jet_ptr");
+        jet_ptr->addAttr(llvm::Attribute::NoCapture);
+        jet_ptr->addAttr(llvm::Attribute::NoAlias);
+
+        auto *par_ptr = jet_ptr + 1;
+        par_ptr->setName("par_ptr");
+        par_ptr->addAttr(llvm::Attribute::NoCapture);
+        par_ptr->addAttr(llvm::Attribute::NoAlias);
+        par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+        auto *time_ptr = par_ptr + 1;
+        time_ptr->setName("time_ptr");
+        time_ptr->addAttr(llvm::Attribute::NoCapture);
+        time_ptr->addAttr(llvm::Attribute::NoAlias);
+        time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+        auto *bb = llvm::BasicBlock::Create(s.context(), "entry", f);
+        assert(bb != nullptr);
+        builder.SetInsertPoint(bb);
+
+        // NOTE: the derivatives are accumulated in diff_arr in the layout
+        // expected by taylor_fetch_diff() (i.e., order by order, with each order
+        // containing the derivatives of all the u variables), as in
+        // taylor_compute_jet(). The derivatives of the last order
+        // are computed for all the u variables.
+        std::vector<llvm::Value *> diff_arr;
+
+        // Helper to compute (or load) the derivative of order o of the u variable idx.
+        auto add_diff = [&](std::uint32_t o, std::uint32_t idx) {
+            if (partial && !par_dep[idx]) {
+                diff_arr.push_back(load_vector_from_memory(builder, jet_elem_ptr(jet_ptr, o, idx), batch_size));
+            } else if (idx < n_eq) {
+                diff_arr.push_back(
+                    taylor_compute_sv_diff<T>(s, dc[n_uvars + idx].first, diff_arr, par_ptr, n_uvars, o, batch_size));
+            } else {
+                diff_arr.push_back(taylor_diff<T>(s, dc[idx].first, dc[idx].second, diff_arr, par_ptr, time_ptr,
+                                                  n_uvars, o, idx, batch_size));
+            }
+        };
+
+        // The order 0 of the state variables is always loaded.
+        for (std::uint32_t i = 0; i < n_eq; ++i) {
+            diff_arr.push_back(load_vector_from_memory(builder, jet_elem_ptr(jet_ptr, 0, i), batch_size));
+        }
+        for (auto i = n_eq; i < n_uvars; ++i) {
+            add_diff(0, i);
+        }
+
+        for (std::uint32_t o = 1; o <= order; ++o) {
+            for (std::uint32_t i = 0; i < n_uvars; ++i) {
+                add_diff(o, i);
+            }
+        }
+
+        assert(diff_arr.size() == static_cast<decltype(diff_arr.size())>(order + 1u) * n_uvars);
+
+        // Write the computed derivatives into the jet array.
+        for (std::uint32_t o = 0; o <= order; ++o) {
+            for (std::uint32_t i = (o == 0u ? n_eq : 0u); i < n_uvars; ++i) {
+                if (!partial || par_dep[i]) {
+                    store_vector_to_memory(builder, jet_elem_ptr(jet_ptr, o, i),
+                                           taylor_fetch_diff(diff_arr, i, o, n_uvars));
+                }
+            }
+        }
+
+        builder.CreateRetVoid();
+
+        s.verify_function(f);
+    };
+
+    add_func(name, false);
+    add_func(name + "_par", true);
+
+    s.optimise();
+
+    return dc;
+}
+
 } // namespace
 
 } // namespace detail
@@ -5588,6 +13017,180 @@ taylor_dc_t taylor_add_jet_f128(llvm_state &s, const std::string &name,
 
 #endif
 
+taylor_dc_t taylor_add_par_jet_dbl(llvm_state &s, const std::string &name,
+                                   std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                                   std::uint32_t batch_size)
+{
+    return detail::taylor_add_par_jet_impl<double>(s, name, std::move(sys), order, batch_size);
+}
+
+taylor_dc_t taylor_add_par_jet_ldbl(llvm_state &s, const std::string &name,
+                                    std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                                    std::uint32_t batch_size)
+{
+    return detail::taylor_add_par_jet_impl<long double>(s, name, std::move(sys), order, batch_size);
+}
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+taylor_dc_t taylor_add_par_jet_f128(llvm_state &s, const std::string &name,
+                                    std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                                    std::uint32_t batch_size)
+{
+    return detail::taylor_add_par_jet_impl<mppp::real128>(s, name, std::move(sys), order, batch_size);
+}
+
+#endif
+
+#if defined(HEYOKA_WITH_NVPTX)
+
+namespace detail
+{
+
+namespace
+{
+
+// Implementation of taylor_add_nvptx_step().
+// NOTE: the kernel invokes the scalar stepper of the adaptive integrator
+// in each GPU thread. The arguments of the kernel are:
+// - pointer to the states (read & write),
+// - pointer to the parameters (read only),
+// - pointer to the times (read only),
+// - pointer to the max timesteps (read & write),
+// - the number of trajectories n.
+// The data of each trajectory is stored contiguously, e.g., the state
+// of the i-th trajectory begins at state_ptr + i * n_eq. As in the
+// stepper, on output the array of max timesteps contains the
+// timesteps that were used. The times are not updated.
+template <typename U>
+taylor_dc_t taylor_add_nvptx_step_impl(llvm_state &s, const std::string &name, U sys, double tol, bool high_accuracy,
+                                       bool compact_mode)
+{
+    using std::isfinite;
+
+    if (s.is_compiled()) {
+        throw std::invalid_argument("A GPU stepper cannot be added to an llvm_state after compilation");
+    }
+
+    if (!isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument(
+            "The tolerance of a GPU stepper must be finite and positive, but it is {} instead"_format(tol));
+    }
+
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(taylor_sys_size(sys));
+    const auto n_pars = n_pars_in_sys(sys);
+
+    // Add the scalar stepper.
+    // NOTE: parallel mode is not available on the GPU.
+    const auto step_name = name + ".step";
+    auto dc = std::get<0>(taylor_add_adaptive_step<double>(s, step_name, std::move(sys), tol, 1, high_accuracy,
+                                                           compact_mode, false, 0, false));
+
+    auto &builder = s.builder();
+    auto &context = s.context();
+    auto &md = s.module();
+
+    auto *step_f = md.getFunction(step_name);
+    assert(step_f != nullptr);
+
+    // Prepare the kernel prototype.
+    auto *fp_ptr_t = llvm::PointerType::getUnqual(to_llvm_type<double>(context));
+    const std::vector<llvm::Type *> fargs{fp_ptr_t, fp_ptr_t, fp_ptr_t, fp_ptr_t, builder.getInt32Ty()};
+    auto *ft = llvm::FunctionType::get(builder.getVoidTy(), fargs, false);
+    assert(ft != nullptr);
+    auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &md);
+    if (f == nullptr) {
+        throw std::invalid_argument("Unable to create a GPU stepper with name '{}'"_format(name));
+    }
+
+    auto *state_ptr = f->args().begin();
+    state_ptr->setName("state_ptr");
+    state_ptr->addAttr(llvm::Attribute::NoCapture);
+    state_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    auto *par_ptr = state_ptr + 1;
+    par_ptr->setName("par_ptr");
+    par_ptr->addAttr(llvm::Attribute::NoCapture);
+    par_ptr->addAttr(llvm::Attribute::NoAlias);
+    par_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *time_ptr = par_ptr + 1;
+    time_ptr->setName("time_ptr");
+    time_ptr->addAttr(llvm::Attribute::NoCapture);
+    time_ptr->addAttr(llvm::Attribute::NoAlias);
+    time_ptr->addAttr(llvm::Attribute::ReadOnly);
+
+    auto *h_ptr = time_ptr + 1;
+    h_ptr->setName("h_ptr");
+    h_ptr->addAttr(llvm::Attribute::NoCapture);
+    h_ptr->addAttr(llvm::Attribute::NoAlias);
+
+    auto *n_tr = h_ptr + 1;
+    n_tr->setName("n");
+
+    auto *bb = llvm::BasicBlock::Create(context, "entry", f);
+    assert(bb != nullptr);
+    builder.SetInsertPoint(bb);
+
+    // Compute the global index of the current thread.
+    auto *tid = builder.CreateCall(llvm::Intrinsic::getDeclaration(&md, llvm::Intrinsic::nvvm_read_ptx_sreg_tid_x));
+    auto *ntid = builder.CreateCall(llvm::Intrinsic::getDeclaration(&md, llvm::Intrinsic::nvvm_read_ptx_sreg_ntid_x));
+    auto *ctaid
+        = builder.CreateCall(llvm::Intrinsic::getDeclaration(&md, llvm::Intrinsic::nvvm_read_ptx_sreg_ctaid_x));
+    auto *idx = builder.CreateAdd(builder.CreateMul(ctaid, ntid), tid);
+
+    llvm_if_then_else(
+        s, builder.CreateICmpULT(idx, n_tr),
+        [&]() {
+            // NOTE: compute the offsets in 64-bit arithmetic,
+            // as they may overflow a 32-bit integer.
+            auto *idx64 = builder.CreateZExt(idx, builder.getInt64Ty());
+
+            auto *cur_state
+                = builder.CreateInBoundsGEP(state_ptr, builder.CreateMul(idx64, builder.getInt64(n_eq)));
+            auto *cur_pars = builder.CreateInBoundsGEP(par_ptr, builder.CreateMul(idx64, builder.getInt64(n_pars)));
+            auto *cur_time = builder.CreateInBoundsGEP(time_ptr, idx64);
+            auto *cur_h = builder.CreateInBoundsGEP(h_ptr, idx64);
+
+            // NOTE: the Taylor coefficients are not written.
+            builder.CreateCall(step_f,
+                               {cur_state, cur_pars, cur_time, cur_h, llvm::ConstantPointerNull::get(fp_ptr_t)});
+        },
+        []() {});
+
+    builder.CreateRetVoid();
+
+    // Mark the function as a kernel.
+    md.getOrInsertNamedMetadata("nvvm.annotations")
+        ->addOperand(llvm::MDNode::get(context, {llvm::ValueAsMetadata::get(f), llvm::MDString::get(context, "kernel"),
+                                                 llvm::ConstantAsMetadata::get(builder.getInt32(1))}));
+
+    s.verify_function(f);
+
+    s.optimise();
+
+    return dc;
+}
+
+} // namespace
+
+} // namespace detail
+
+taylor_dc_t taylor_add_nvptx_step(llvm_state &s, const std::string &name, std::vector<expression> sys, double tol,
+                                  bool high_accuracy, bool compact_mode)
+{
+    return detail::taylor_add_nvptx_step_impl(s, name, std::move(sys), tol, high_accuracy, compact_mode);
+}
+
+taylor_dc_t taylor_add_nvptx_step(llvm_state &s, const std::string &name,
+                                  std::vector<std::pair<expression, expression>> sys, double tol, bool high_accuracy,
+                                  bool compact_mode)
+{
+    return detail::taylor_add_nvptx_step_impl(s, name, std::move(sys), tol, high_accuracy, compact_mode);
+}
+
+#endif
+
 namespace detail
 {
 
@@ -5648,10 +13251,10 @@ std::ostream &taylor_adaptive_batch_stream_impl(std::ostream &os, const taylor_a
     oss << std::showpoint;
     oss.precision(std::numeric_limits<T>::max_digits10);
 
-    oss << "Taylor order: " << ta.get_order() << '\n';
-    oss << "Dimension   : " << ta.get_dim() << '\n';
-    oss << "Batch size  : " << ta.get_batch_size() << '\n';
-    oss << "Time        : [";
+    oss << "Taylor order            : " << ta.get_order() << '\n';
+    oss << "Dimension               : " << ta.get_dim() << '\n';
+    oss << "Batch size              : " << ta.get_batch_size() << '\n';
+    oss << "Time                    : [";
     for (decltype(ta.get_time().size()) i = 0; i < ta.get_time().size(); ++i) {
         oss << ta.get_time()[i];
         if (i != ta.get_time().size() - 1u) {
@@ -5659,7 +13262,7 @@ std::ostream &taylor_adaptive_batch_stream_impl(std::ostream &os, const taylor_a
         }
     }
     oss << "]\n";
-    oss << "State       : [";
+    oss << "State                   : [";
     for (decltype(ta.get_state().size()) i = 0; i < ta.get_state().size(); ++i) {
         oss << ta.get_state()[i];
         if (i != ta.get_state().size() - 1u) {
@@ -5669,7 +13272,7 @@ std::ostream &taylor_adaptive_batch_stream_impl(std::ostream &os, const taylor_a
     oss << "]\n";
 
     if (!ta.get_pars().empty()) {
-        oss << "Parameters  : [";
+        oss << "Parameters              : [";
         for (decltype(ta.get_pars().size()) i = 0; i < ta.get_pars().size(); ++i) {
             oss << ta.get_pars()[i];
             if (i != ta.get_pars().size() - 1u) {
@@ -5679,6 +13282,14 @@ std::ostream &taylor_adaptive_batch_stream_impl(std::ostream &os, const taylor_a
         oss << "]\n";
     }
 
+    if (!ta.get_t_events().empty()) {
+        oss << "N of terminal events    : " << ta.get_t_events().size() << '\n';
+    }
+
+    if (!ta.get_nt_events().empty()) {
+        oss << "N of non-terminal events: " << ta.get_nt_events().size() << '\n';
+    }
+
     return os << oss.str();
 }
 
@@ -5743,6 +13354,7 @@ std::ostream &operator<<(std::ostream &os, taylor_outcome oc)
         HEYOKA_TAYLOR_ENUM_STREAM_CASE(taylor_outcome::time_limit);
         HEYOKA_TAYLOR_ENUM_STREAM_CASE(taylor_outcome::err_nf_state);
         HEYOKA_TAYLOR_ENUM_STREAM_CASE(taylor_outcome::cb_stop);
+        HEYOKA_TAYLOR_ENUM_STREAM_CASE(taylor_outcome::err_h_collapse);
         default:
             if (oc >= taylor_outcome{0}) {
                 // Continuing terminal event.
@@ -5775,4 +13387,65 @@ std::ostream &operator<<(std::ostream &os, event_direction dir)
 
 #undef HEYOKA_TAYLOR_OUTCOME_STREAM_CASE
 
+std::ostream &operator<<(std::ostream &os, const taylor_perf_counters &pc)
+{
+    os << "N of steps           : " << pc.n_steps << '\n';
+    os << "N of limited steps   : " << pc.n_limited_steps << '\n';
+    os << "N of non-finite steps: " << pc.n_nf_steps << '\n';
+    os << "N of terminal events : " << pc.n_t_events << '\n';
+    os << "N of non-terminal evs: " << pc.n_nt_events << '\n';
+    os << "Poly cache hits      : " << pc.n_poly_cache_hits << '\n';
+    os << "Poly cache misses    : " << pc.n_poly_cache_misses << '\n';
+    os << "Stepper time         : " << pc.stepper_time << "s\n";
+    os << "Event detection time : " << pc.ed_time << "s\n";
+    os << "Callbacks time       : " << pc.cb_time << "s\n";
+
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, const taylor_ctor_timings &ct)
+{
+    os << "Decomposition      : " << ct.decomposition << "s\n";
+    os << "CSE                : " << ct.cse << "s\n";
+    os << "Sorting            : " << ct.sorting << "s\n";
+    os << "IR generation      : " << ct.ir_gen << "s\n";
+    os << "Function passes    : " << ct.opt_function_passes << "s\n";
+    os << "Module passes      : " << ct.opt_module_passes << "s\n";
+    os << "Codegen            : " << ct.codegen << "s\n";
+    os << "Total              : " << ct.total << "s\n";
+
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, const taylor_memory_usage &mu)
+{
+    os << "State              : " << mu.state << " bytes\n";
+    os << "Parameters         : " << mu.pars << " bytes\n";
+    os << "Taylor coefficients: " << mu.tc << " bytes\n";
+    os << "Dense output       : " << mu.d_out << " bytes\n";
+    os << "Events             : " << mu.events << " bytes\n";
+    os << "Other buffers      : " << mu.other << " bytes\n";
+    os << "Decomposition      : " << mu.decomposition << " bytes\n";
+    os << "Bitcode snapshot   : " << mu.bc_snapshot << " bytes\n";
+    os << "Object code        : " << mu.object_code << " bytes\n";
+    os << "JIT memory         : " << mu.jit << " bytes\n";
+    os << "Total              : " << mu.total << " bytes\n";
+
+    return os;
+}
+
 } // namespace heyoka
+
+// NOTE: this function will be called by the compact mode implementation of the
+// Taylor integrators in parallel mode, in order to compute the derivatives of the
+// u variables in a segment of the decomposition. f is the worker function
+// for the segment, n the total number of u variables in the segment and ctx the
+// context to be passed to f.
+extern "C" HEYOKA_DLL_PUBLIC void heyoka_cm_par_looper(std::uint32_t n, void (*f)(void *, std::uint32_t, std::uint32_t),
+                                                       void *ctx) noexcept
+{
+    heyoka::detail::pool_parallel_for(n, [f, ctx](std::size_t b, std::size_t e) {
+        // NOTE: b and e are in the [0, n] range.
+        f(ctx, static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(e));
+    });
+}
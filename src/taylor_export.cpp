@@ -0,0 +1,500 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <heyoka/detail/string_conv.hpp>
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/math/binary_op.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/log.hpp>
+#include <heyoka/math/neg.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_export.hpp>
+#include <heyoka/variable.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Format the number n as a C++ expression of type T.
+std::string texp_number(const number &n)
+{
+    const auto x = std::visit([](const auto &v) { return static_cast<double>(v); }, n.value());
+
+    if (!std::isfinite(x)) {
+        throw std::invalid_argument(
+            "Cannot export to C++ a Taylor stepper containing the non-finite number {}"_format(x));
+    }
+
+    return "static_cast<T>({:.17g})"_format(x);
+}
+
+// The C++ expression for the derivative of order o
+// of the u variable idx. o is itself a C++ expression.
+std::string texp_u(std::uint32_t idx, const std::string &o)
+{
+    if (o.find(' ') == std::string::npos) {
+        return "u[{} * n_uvars + {}u]"_format(o, idx);
+    } else {
+        return "u[({}) * n_uvars + {}u]"_format(o, idx);
+    }
+}
+
+// An argument of a function in a Taylor decomposition: either
+// a u variable or a constant (i.e., a number or a runtime parameter).
+struct texp_arg {
+    // The index of the u variable (empty for constants).
+    std::optional<std::uint32_t> u_idx;
+    // The C++ expression for the value of the argument.
+    std::string val;
+
+    // The C++ expression for the derivative of order o of the argument,
+    // or an empty string if the derivative is zero (i.e., for order
+    // o > 0 and a constant argument).
+    std::string diff(const std::string &o) const
+    {
+        return u_idx ? texp_u(*u_idx, o) : std::string{};
+    }
+};
+
+texp_arg texp_parse_arg(const expression &ex, std::uint32_t &n_pars)
+{
+    return std::visit(
+        [&n_pars](const auto &v) -> texp_arg {
+            using type = uncvref_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<type, variable>) {
+                const auto idx = uname_to_index(v);
+                return {idx, texp_u(idx, "0")};
+            } else if constexpr (std::is_same_v<type, number>) {
+                return {{}, texp_number(v)};
+            } else if constexpr (std::is_same_v<type, param>) {
+                // LCOV_EXCL_START
+                if (v.idx() == std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::overflow_error("Overflow detected in the number of parameters of a Taylor stepper");
+                }
+                // LCOV_EXCL_STOP
+
+                n_pars = std::max(n_pars, v.idx() + 1u);
+                return {{}, "pars[{}u]"_format(v.idx())};
+            } else {
+                // LCOV_EXCL_START
+                throw std::invalid_argument("Invalid argument detected in a Taylor decomposition: the arguments of "
+                                            "the functions must be variables, numbers or parameters");
+                // LCOV_EXCL_STOP
+            }
+        },
+        ex.value());
+}
+
+// The code for a sum over the index j in the range [begin, end]. The body
+// is the C++ expression of the summand, acc the name of the accumulator.
+std::string texp_sum(const std::string &acc, const std::string &begin, const std::string &end, const std::string &body)
+{
+    return "            for (std::uint32_t j = {}; j <= {}; ++j) {{\n"
+           "                {} += {};\n"
+           "            }}\n"_format(begin, end, acc, body);
+}
+
+// The code for the convolution of the derivatives of a and b (which must be u variables),
+// that is, sum_{j=0}^n a^[j] * b^[n - j], assigned to the u variable idx.
+std::string texp_conv(std::uint32_t idx, const texp_arg &a, const texp_arg &b)
+{
+    return "        {\n"
+           "            T acc(0);\n"
+           + texp_sum("acc", "0u", "n", "{} * {}"_format(a.diff("j"), b.diff("n - j")))
+           + "            {} = acc;\n"
+             "        }}\n"_format(texp_u(idx, "n"));
+}
+
+// The code computing the order-0 value and the derivative of order n of the
+// u variable idx, defined as the function f in the Taylor decomposition.
+// hidden are the hidden dependencies of f.
+std::pair<std::string, std::string> texp_func(std::uint32_t idx, const func &f,
+                                              const std::vector<std::uint32_t> &hidden, std::uint32_t &n_pars)
+{
+    std::vector<texp_arg> args;
+    for (const auto &arg : f.args()) {
+        args.push_back(texp_parse_arg(arg, n_pars));
+    }
+
+    const auto u_n = texp_u(idx, "n");
+    const std::string zero = "        {} = static_cast<T>(0);\n"_format(u_n);
+
+    // Helper to check the number of arguments.
+    auto check_nargs = [&](std::size_t n) {
+        // LCOV_EXCL_START
+        if (args.size() != n) {
+            throw std::invalid_argument(
+                "Invalid number of arguments for the function '{}' in the export to C++ of a Taylor stepper: {} "
+                "arguments were expected, but {} were found instead"_format(f.get_name(), n, args.size()));
+        }
+        // LCOV_EXCL_STOP
+    };
+
+    if (const auto *bop = f.extract<binary_op>()) {
+        check_nargs(2);
+        const auto &a = args[0], &b = args[1];
+
+        switch (bop->op()) {
+            case binary_op::type::add:
+            case binary_op::type::sub: {
+                const auto is_add = bop->op() == binary_op::type::add;
+                const auto op_str = is_add ? " + " : " - ";
+
+                std::string diff;
+                if (a.u_idx && b.u_idx) {
+                    diff = a.diff("n") + op_str + b.diff("n");
+                } else if (a.u_idx) {
+                    diff = a.diff("n");
+                } else if (b.u_idx) {
+                    diff = is_add ? b.diff("n") : "-" + b.diff("n");
+                }
+
+                return {a.val + op_str + b.val, diff.empty() ? zero : "        {} = {};\n"_format(u_n, diff)};
+            }
+            case binary_op::type::mul: {
+                std::string diff;
+                if (a.u_idx && b.u_idx) {
+                    diff = texp_conv(idx, a, b);
+                } else if (a.u_idx) {
+                    diff = "        {} = {} * {};\n"_format(u_n, b.val, a.diff("n"));
+                } else if (b.u_idx) {
+                    diff = "        {} = {} * {};\n"_format(u_n, a.val, b.diff("n"));
+                } else {
+                    diff = zero;
+                }
+
+                return {a.val + " * " + b.val, std::move(diff)};
+            }
+            default: {
+                assert(bop->op() == binary_op::type::div);
+
+                std::string diff;
+                if (b.u_idx) {
+                    // NOTE: c^[n] = (a^[n] - sum_{j=1}^n b^[j] * c^[n - j]) / b^[0].
+                    diff = "        {{\n"
+                           "            T acc({});\n"_format(a.u_idx ? a.diff("n") : "0")
+                           + texp_sum("acc", "1u", "n", "-{} * {}"_format(b.diff("j"), texp_u(idx, "n - j")))
+                           + "            {} = acc / {};\n"
+                             "        }}\n"_format(u_n, b.val);
+                } else if (a.u_idx) {
+                    diff = "        {} = {} / {};\n"_format(u_n, a.diff("n"), b.val);
+                } else {
+                    diff = zero;
+                }
+
+                return {a.val + " / " + b.val, std::move(diff)};
+            }
+        }
+    }
+
+    // The remaining functions are recognised by their implementation type. Apart
+    // from time, they all have a first argument whose derivatives of order > 0
+    // vanish if it is a constant.
+    if (f.extract<time_impl>() != nullptr) {
+        return {"time", "        {} = n == 1u ? static_cast<T>(1) : static_cast<T>(0);\n"_format(u_n)};
+    }
+
+    // Helper to produce the code for the derivative of order n,
+    // given the code for the case of a u variable as first argument.
+    auto ud = [&](const std::string &code) { return args[0].u_idx ? code : zero; };
+
+    if (f.extract<neg_impl>() != nullptr) {
+        check_nargs(1);
+        return {"-" + args[0].val, ud("        {} = -{};\n"_format(u_n, args[0].diff("n")))};
+    } else if (f.extract<square_impl>() != nullptr) {
+        check_nargs(1);
+        return {args[0].val + " * " + args[0].val, ud(texp_conv(idx, args[0], args[0]))};
+    } else if (f.extract<sqrt_impl>() != nullptr) {
+        check_nargs(1);
+        // NOTE: s^[n] = (a^[n] - sum_{j=1}^{n-1} s^[j] * s^[n - j]) / (2 * s^[0]).
+        return {"sqrt({})"_format(args[0].val),
+                ud("        {{\n"
+                   "            T acc({});\n"_format(args[0].diff("n"))
+                   + texp_sum("acc", "1u", "n - 1u", "-{} * {}"_format(texp_u(idx, "j"), texp_u(idx, "n - j")))
+                   + "            {} = acc / (2 * {});\n"
+                     "        }}\n"_format(u_n, texp_u(idx, "0")))};
+    } else if (f.extract<exp_impl>() != nullptr) {
+        check_nargs(1);
+        // NOTE: e^[n] = 1 / n * sum_{j=1}^n j * a^[j] * e^[n - j].
+        return {"exp({})"_format(args[0].val),
+                ud("        {\n"
+                   "            T acc(0);\n"
+                   + texp_sum("acc", "1u", "n",
+                              "static_cast<T>(j) * {} * {}"_format(args[0].diff("j"), texp_u(idx, "n - j")))
+                   + "            {} = acc / nf;\n"
+                     "        }}\n"_format(u_n))};
+    } else if (f.extract<log_impl>() != nullptr) {
+        check_nargs(1);
+        // NOTE: l^[n] = (a^[n] - 1 / n * sum_{j=1}^{n-1} j * l^[j] * a^[n - j]) / a^[0].
+        return {"log({})"_format(args[0].val),
+                ud("        {\n"
+                   "            T acc(0);\n"
+                   + texp_sum("acc", "1u", "n - 1u",
+                              "static_cast<T>(j) * {} * {}"_format(texp_u(idx, "j"), args[0].diff("n - j")))
+                   + "            {} = ({} - acc / nf) / {};\n"
+                     "        }}\n"_format(u_n, args[0].diff("n"), args[0].val))};
+    } else if (f.extract<sin_impl>() != nullptr || f.extract<cos_impl>() != nullptr) {
+        check_nargs(1);
+
+        const auto is_sin = f.extract<sin_impl>() != nullptr;
+
+        // NOTE: the hidden dependency is the cosine (resp. sine) of the argument.
+        // LCOV_EXCL_START
+        if (hidden.size() != 1u) {
+            throw std::invalid_argument("Invalid hidden dependencies for the function '{}' in the export to C++ of "
+                                        "a Taylor stepper"_format(f.get_name()));
+        }
+        // LCOV_EXCL_STOP
+
+        // NOTE: s^[n] = 1 / n * sum_{j=1}^n j * a^[j] * c^[n - j],
+        // c^[n] = -1 / n * sum_{j=1}^n j * a^[j] * s^[n - j].
+        return {"{}({})"_format(is_sin ? "sin" : "cos", args[0].val),
+                ud("        {\n"
+                   "            T acc(0);\n"
+                   + texp_sum("acc", "1u", "n",
+                              "static_cast<T>(j) * {} * {}"_format(args[0].diff("j"), texp_u(hidden[0], "n - j")))
+                   + "            {} = {}acc / nf;\n"
+                     "        }}\n"_format(u_n, is_sin ? "" : "-"))};
+    } else if (f.extract<pow_impl>() != nullptr) {
+        check_nargs(2);
+
+        if (!std::holds_alternative<number>(f.args()[1].value())) {
+            throw std::invalid_argument("The export to C++ of a Taylor stepper supports only the exponentiation to "
+                                        "a numerical power, but the exponent {} was found instead"_format(f.args()[1]));
+        }
+
+        const auto &alpha = args[1].val;
+
+        // NOTE: p^[n] = 1 / (n * a^[0]) * sum_{j=0}^{n-1} (n * alpha - j * (alpha + 1)) * a^[n - j] * p^[j].
+        return {"pow({}, {})"_format(args[0].val, alpha),
+                ud("        {\n"
+                   "            T acc(0);\n"
+                   + texp_sum("acc", "0u", "n - 1u",
+                              "(nf * {0} - static_cast<T>(j) * ({0} + 1)) * {1} * {2}"_format(
+                                  alpha, args[0].diff("n - j"), texp_u(idx, "j")))
+                   + "            {} = acc / (nf * {});\n"
+                     "        }}\n"_format(u_n, args[0].val))};
+    }
+
+    throw std::invalid_argument(
+        "The function '{}' is not supported in the export to C++ of a Taylor stepper"_format(f.get_name()));
+}
+
+// Check that name is a valid C++ identifier.
+void texp_check_name(const std::string &name)
+{
+    auto is_valid_char = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_'; };
+
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])) != 0
+        || !std::all_of(name.begin(), name.end(), is_valid_char)) {
+        throw std::invalid_argument(
+            "The name '{}' is not a valid C++ identifier for the export of a Taylor stepper"_format(name));
+    }
+}
+
+std::string taylor_export_cpp_impl(const taylor_dc_t &dc, std::uint32_t n_eq, const std::string &name, double tol)
+{
+    texp_check_name(name);
+
+    if (!std::isfinite(tol) || tol <= 0) {
+        throw std::invalid_argument("The tolerance in the export to C++ of a Taylor stepper must be finite and "
+                                    "positive, but it is {} instead"_format(tol));
+    }
+
+    // NOTE: the order and the safety factor for the timestep
+    // are computed as in the adaptive integrators.
+    const auto order = boost::numeric_cast<std::uint32_t>(std::max(2., std::ceil(-std::log(tol) / 2 + 1)));
+    const auto rhofac = std::exp((-7. / 10) / (order - 1u)) / (std::exp(1.) * std::exp(1.));
+
+    assert(dc.size() > n_eq);
+    const auto n_uvars = boost::numeric_cast<std::uint32_t>(dc.size() - n_eq);
+
+    std::uint32_t n_pars = 0;
+
+    // Code for the order-0 values of the u variables
+    // and for the derivatives of order n.
+    std::string init_code, diff_code;
+
+    // The derivatives of the state variables.
+    for (std::uint32_t i = 0; i < n_eq; ++i) {
+        const auto rhs = texp_parse_arg(dc[n_uvars + i].first, n_pars);
+
+        if (rhs.u_idx) {
+            diff_code += "        {} = {} / nf;\n"_format(texp_u(i, "n"), rhs.diff("n - 1u"));
+        } else {
+            diff_code += "        {} = n == 1u ? {} : static_cast<T>(0);\n"_format(texp_u(i, "n"), rhs.val);
+        }
+    }
+
+    // The derivatives of the other u variables.
+    for (auto i = n_eq; i < n_uvars; ++i) {
+        const auto &[ex, hidden] = dc[i];
+
+        const auto *f = std::get_if<func>(&ex.value());
+        // LCOV_EXCL_START
+        if (f == nullptr) {
+            throw std::invalid_argument(
+                "Invalid Taylor decomposition detected: the u variable {} is not a function"_format(i));
+        }
+        // LCOV_EXCL_STOP
+
+        auto [init, diff] = texp_func(i, *f, hidden, n_pars);
+
+        init_code += "    {} = {};\n"_format(texp_u(i, "0"), init);
+        diff_code += "        // u_{}\n"_format(i) + diff;
+    }
+
+    return "// Taylor stepper exported by heyoka.\n"
+           "\n"
+           "#include <algorithm>\n"
+           "#include <array>\n"
+           "#include <cmath>\n"
+           "#include <cstdint>\n"
+           "\n"
+           "namespace {0}\n"
+           "{{\n"
+           "\n"
+           "inline constexpr std::uint32_t n_eq = {1};\n"
+           "inline constexpr std::uint32_t n_pars = {2};\n"
+           "inline constexpr std::uint32_t order = {3};\n"
+           "inline constexpr std::uint32_t n_uvars = {4};\n"
+           "\n"
+           "template <typename T>\n"
+           "inline void jet(T *u, const T *pars, T time)\n"
+           "{{\n"
+           "    using std::cos;\n"
+           "    using std::exp;\n"
+           "    using std::log;\n"
+           "    using std::pow;\n"
+           "    using std::sin;\n"
+           "    using std::sqrt;\n"
+           "\n"
+           "    static_cast<void>(pars);\n"
+           "    static_cast<void>(time);\n"
+           "\n"
+           "{5}"
+           "\n"
+           "    for (std::uint32_t n = 1; n <= order; ++n) {{\n"
+           "        const auto nf = static_cast<T>(n);\n"
+           "        static_cast<void>(nf);\n"
+           "\n"
+           "{6}"
+           "    }}\n"
+           "}}\n"
+           "\n"
+           "template <typename T>\n"
+           "inline T step(T *state, const T *pars, T time, T max_h)\n"
+           "{{\n"
+           "    using std::abs;\n"
+           "    using std::exp;\n"
+           "    using std::log;\n"
+           "\n"
+           "    std::array<T, (order + 1u) * n_uvars> u{{}};\n"
+           "    std::copy(state, state + n_eq, u.data());\n"
+           "    jet(u.data(), pars, time);\n"
+           "\n"
+           "    T max_abs_state(0), max_abs_diff_o(0), max_abs_diff_om1(0);\n"
+           "    for (std::uint32_t i = 0; i < n_eq; ++i) {{\n"
+           "        max_abs_state = std::max(max_abs_state, abs(u[i]));\n"
+           "        max_abs_diff_o = std::max(max_abs_diff_o, abs(u[order * n_uvars + i]));\n"
+           "        max_abs_diff_om1 = std::max(max_abs_diff_om1, abs(u[(order - 1u) * n_uvars + i]));\n"
+           "    }}\n"
+           "\n"
+           "    const auto num_rho = max_abs_state <= 1 ? static_cast<T>(1) : max_abs_state;\n"
+           "    const auto rho_m = exp(std::min(log(num_rho / max_abs_diff_o) / static_cast<T>(order),\n"
+           "                                    log(num_rho / max_abs_diff_om1) / static_cast<T>(order - 1u)));\n"
+           "\n"
+           "    auto h = rho_m * static_cast<T>({7:.17g});\n"
+           "    if (abs(max_h) < h) {{\n"
+           "        h = abs(max_h);\n"
+           "    }}\n"
+           "    if (max_h < 0) {{\n"
+           "        h = -h;\n"
+           "    }}\n"
+           "\n"
+           "    for (std::uint32_t i = 0; i < n_eq; ++i) {{\n"
+           "        auto acc = u[order * n_uvars + i];\n"
+           "        for (std::uint32_t o = order; o-- > 0u;) {{\n"
+           "            acc = acc * h + u[o * n_uvars + i];\n"
+           "        }}\n"
+           "        state[i] = acc;\n"
+           "    }}\n"
+           "\n"
+           "    return h;\n"
+           "}}\n"
+           "\n"
+           "}} // namespace {0}\n"_format(name, n_eq, n_pars, order, n_uvars, init_code, diff_code, rhofac);
+}
+
+} // namespace
+
+} // namespace detail
+
+std::string taylor_export_cpp(std::vector<std::pair<expression, expression>> sys, const std::string &name, double tol)
+{
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    return detail::taylor_export_cpp_impl(taylor_decompose(std::move(sys), {}).first, n_eq, name, tol);
+}
+
+std::string taylor_export_cpp(std::vector<expression> sys, const std::string &name, double tol)
+{
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+
+    return detail::taylor_export_cpp_impl(taylor_decompose(std::move(sys), {}).first, n_eq, name, tol);
+}
+
+} // namespace heyoka
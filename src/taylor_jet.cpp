@@ -0,0 +1,539 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/container_hash/hash.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <fmt/format.h>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/detail/parallel.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_jet.hpp>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// NOTE: MSVC has issues with the other "using"
+// statement form.
+using namespace fmt::literals;
+
+#else
+
+using fmt::literals::operator""_format;
+
+#endif
+
+namespace heyoka::detail
+{
+
+namespace
+{
+
+// Hint to prefetch into the cache the memory pointed to by ptr.
+// NOTE: this is a no-op on compilers without the prefetch builtin.
+inline void taylor_jet_prefetch(const void *ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(ptr);
+#else
+    (void)ptr;
+#endif
+}
+
+} // namespace
+
+template <typename T>
+template <typename U>
+void taylor_jet_impl<T>::finalise_ctor_impl(U sys, std::uint32_t order, std::uint32_t batch_size, bool high_accuracy,
+                                            bool compact_mode, std::vector<expression> sv_funcs)
+{
+    if (batch_size == 0u) {
+        batch_size = recommended_simd_size<T>();
+    }
+
+    const auto n_eq = boost::numeric_cast<std::uint32_t>(sys.size());
+    const auto n_sv_funcs = boost::numeric_cast<std::uint32_t>(sv_funcs.size());
+
+    // Add the batch-mode jet and, if needed,
+    // the scalar jet for the remainder points.
+    if (batch_size > 1u) {
+        taylor_add_jet<T>(m_llvm_scalar, "jet", sys, order, 1, high_accuracy, compact_mode, sv_funcs);
+        m_llvm_scalar.compile();
+    }
+    m_dc = taylor_add_jet<T>(m_llvm, "jet", std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                             std::move(sv_funcs));
+    m_llvm.compile();
+
+    m_f_batch = reinterpret_cast<jet_f_t>(m_llvm.jit_lookup("jet"));
+    m_f_scalar = batch_size > 1u ? reinterpret_cast<jet_f_t>(m_llvm_scalar.jit_lookup("jet")) : m_f_batch;
+
+    // Compute the number of runtime parameters and
+    // detect the time dependence from the decomposition.
+    std::uint32_t n_pars = 0;
+    bool htime = false;
+    for (const auto &p : m_dc) {
+        n_pars = std::max(n_pars, get_param_size(p.first));
+        htime = htime || has_time(p.first);
+    }
+
+    m_order = order;
+    m_batch_size = batch_size;
+    m_n_eq = n_eq;
+    m_n_sv_funcs = n_sv_funcs;
+    m_n_pars = n_pars;
+    m_has_time = htime;
+}
+
+template <typename T>
+taylor_jet_impl<T>::taylor_jet_impl(const taylor_jet_impl &other)
+    // NOTE: make a manual copy of all members, apart from the function pointers.
+    : m_llvm(other.m_llvm), m_llvm_scalar(other.m_llvm_scalar), m_dc(other.m_dc), m_order(other.m_order),
+      m_batch_size(other.m_batch_size), m_n_eq(other.m_n_eq), m_n_sv_funcs(other.m_n_sv_funcs),
+      m_n_pars(other.m_n_pars), m_has_time(other.m_has_time)
+{
+    m_f_batch = reinterpret_cast<jet_f_t>(m_llvm.jit_lookup("jet"));
+    m_f_scalar = m_batch_size > 1u ? reinterpret_cast<jet_f_t>(m_llvm_scalar.jit_lookup("jet")) : m_f_batch;
+}
+
+template <typename T>
+taylor_jet_impl<T>::taylor_jet_impl(taylor_jet_impl &&) noexcept = default;
+
+template <typename T>
+taylor_jet_impl<T> &taylor_jet_impl<T>::operator=(const taylor_jet_impl &other)
+{
+    if (this != &other) {
+        *this = taylor_jet_impl(other);
+    }
+
+    return *this;
+}
+
+template <typename T>
+taylor_jet_impl<T> &taylor_jet_impl<T>::operator=(taylor_jet_impl &&) noexcept = default;
+
+template <typename T>
+taylor_jet_impl<T>::~taylor_jet_impl() = default;
+
+template <typename T>
+const llvm_state &taylor_jet_impl<T>::get_llvm_state() const
+{
+    return m_llvm;
+}
+
+template <typename T>
+const taylor_dc_t &taylor_jet_impl<T>::get_decomposition() const
+{
+    return m_dc;
+}
+
+template <typename T>
+std::uint32_t taylor_jet_impl<T>::get_order() const
+{
+    return m_order;
+}
+
+template <typename T>
+std::uint32_t taylor_jet_impl<T>::get_batch_size() const
+{
+    return m_batch_size;
+}
+
+template <typename T>
+std::uint32_t taylor_jet_impl<T>::get_n_eq() const
+{
+    return m_n_eq;
+}
+
+template <typename T>
+std::uint32_t taylor_jet_impl<T>::get_n_sv_funcs() const
+{
+    return m_n_sv_funcs;
+}
+
+template <typename T>
+std::uint32_t taylor_jet_impl<T>::get_n_pars() const
+{
+    return m_n_pars;
+}
+
+// Evaluate the jets on n_points points (see the layout of the arrays in the
+// documentation of the class). time can be null if the system does not depend
+// on time. The batches of points are distributed among n_threads threads (a value
+// of zero means to use all the hardware threads available on the machine).
+template <typename T>
+void taylor_jet_impl<T>::operator()(T *out, const T *in, std::size_t n_points, const T *pars, const T *time,
+                                    unsigned n_threads) const
+{
+    if (n_points == 0u) {
+        return;
+    }
+
+    if (out == nullptr) {
+        throw std::invalid_argument("A null output array was passed to a Taylor jet evaluator");
+    }
+
+    if (in == nullptr) {
+        throw std::invalid_argument("A null input array was passed to a Taylor jet evaluator");
+    }
+
+    if (pars == nullptr && m_n_pars > 0u) {
+        throw std::invalid_argument("A null array of parameters was passed to a Taylor jet evaluator "
+                                    "which requires {} parameter(s)"_format(m_n_pars));
+    }
+
+    if (time == nullptr && m_has_time) {
+        throw std::invalid_argument(
+            "A null time array was passed to a Taylor jet evaluator for a system which depends on time");
+    }
+
+    const auto n_tot = static_cast<std::size_t>(m_n_eq) + m_n_sv_funcs;
+    const auto jet_size = n_tot * (m_order + 1u);
+    const auto n_batches = n_points / m_batch_size;
+
+    // Evaluate the jet function f with batch size bs on the points
+    // starting from offset, using buf as temporary storage. buf contains
+    // the jet, followed by the parameters and the time. If next is true,
+    // the input of the next batch is prefetched while the jet is being computed.
+    auto eval_batch = [&](jet_f_t f, std::uint32_t bs, std::size_t offset, T *buf, bool next) {
+        auto *const jet = buf;
+        auto *const par_buf = jet + jet_size * bs;
+        auto *const time_buf = par_buf + static_cast<std::size_t>(m_n_pars) * bs;
+
+        // Gather the input.
+        for (std::uint32_t j = 0; j < m_n_eq; ++j) {
+            std::copy(in + j * n_points + offset, in + j * n_points + offset + bs, jet + j * bs);
+        }
+        for (std::uint32_t j = 0; j < m_n_pars; ++j) {
+            std::copy(pars + j * n_points + offset, pars + j * n_points + offset + bs, par_buf + j * bs);
+        }
+        if (time == nullptr) {
+            std::fill(time_buf, time_buf + bs, T(0));
+        } else {
+            std::copy(time + offset, time + offset + bs, time_buf);
+        }
+
+        if (next) {
+            for (std::uint32_t j = 0; j < m_n_eq; ++j) {
+                taylor_jet_prefetch(in + j * n_points + offset + bs);
+            }
+        }
+
+        f(jet, par_buf, time_buf);
+
+        // Scatter the output.
+        for (std::size_t j = 0; j < jet_size; ++j) {
+            std::copy(jet + j * bs, jet + j * bs + bs, out + j * n_points + offset);
+        }
+    };
+
+    // Size of the temporary storage for a batch of size bs.
+    const auto buf_size = [&](std::uint32_t bs) { return (jet_size + m_n_pars + 1u) * bs; };
+
+    // Process the full batches.
+    // NOTE: the per-thread storage is set up by
+    // the worker threads the first time they are invoked.
+    std::vector<std::vector<T>> bufs(parallel_n_workers(n_batches, n_threads));
+    parallel_for(n_batches, n_threads, [&](std::size_t b, std::size_t e, unsigned idx) {
+        auto &buf = bufs[idx];
+        if (buf.empty()) {
+            buf.resize(boost::numeric_cast<decltype(buf.size())>(buf_size(m_batch_size)));
+        }
+
+        for (auto i = b; i < e; ++i) {
+            eval_batch(m_f_batch, m_batch_size, i * m_batch_size, buf.data(), i + 1u < e);
+        }
+    });
+
+    // Process the remaining points one by one.
+    std::vector<T> buf;
+    for (auto offset = n_batches * m_batch_size; offset < n_points; ++offset) {
+        if (buf.empty()) {
+            buf.resize(boost::numeric_cast<decltype(buf.size())>(buf_size(1)));
+        }
+
+        eval_batch(m_f_scalar, 1, offset, buf.data(), false);
+    }
+}
+
+template <typename T>
+std::vector<T> taylor_jet_impl<T>::operator()(const std::vector<T> &in, std::size_t n_points,
+                                              const std::vector<T> &pars, const std::vector<T> &time,
+                                              unsigned n_threads) const
+{
+    const auto jet_size = (static_cast<std::size_t>(m_n_eq) + m_n_sv_funcs) * (m_order + 1u);
+
+    // LCOV_EXCL_START
+    if (n_points > std::numeric_limits<std::size_t>::max() / m_n_eq) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the input "
+                                  "array of a Taylor jet evaluator");
+    }
+
+    if (n_points > std::numeric_limits<std::size_t>::max() / jet_size) {
+        throw std::overflow_error("Overflow detected in the computation of the size of the output "
+                                  "array of a Taylor jet evaluator");
+    }
+    // LCOV_EXCL_STOP
+
+    if (in.size() != m_n_eq * n_points) {
+        throw std::invalid_argument("The size of the input array of a Taylor jet evaluator ({}) is inconsistent "
+                                    "with the number of equations ({}) and the number of points ({})"_format(
+                                        in.size(), m_n_eq, n_points));
+    }
+
+    if (pars.size() != m_n_pars * n_points) {
+        throw std::invalid_argument("The size of the array of parameters of a Taylor jet evaluator ({}) is "
+                                    "inconsistent with the number of parameters ({}) and the number of points "
+                                    "({})"_format(pars.size(), m_n_pars, n_points));
+    }
+
+    if (!time.empty() && time.size() != n_points) {
+        throw std::invalid_argument("The size of the time array of a Taylor jet evaluator ({}) is inconsistent "
+                                    "with the number of points ({})"_format(time.size(), n_points));
+    }
+
+    std::vector<T> out;
+    out.resize(jet_size * n_points);
+
+    (*this)(out.data(), in.empty() ? nullptr : in.data(), n_points, pars.empty() ? nullptr : pars.data(),
+            time.empty() ? nullptr : time.data(), n_threads);
+
+    return out;
+}
+
+// Explicit instantiations.
+template class taylor_jet_impl<double>;
+template void taylor_jet_impl<double>::finalise_ctor_impl(std::vector<expression>, std::uint32_t, std::uint32_t,
+                                                          bool, bool, std::vector<expression>);
+template void taylor_jet_impl<double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
+                                                          std::uint32_t, std::uint32_t, bool, bool,
+                                                          std::vector<expression>);
+
+template class taylor_jet_impl<long double>;
+template void taylor_jet_impl<long double>::finalise_ctor_impl(std::vector<expression>, std::uint32_t, std::uint32_t,
+                                                               bool, bool, std::vector<expression>);
+template void taylor_jet_impl<long double>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
+                                                               std::uint32_t, std::uint32_t, bool, bool,
+                                                               std::vector<expression>);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class taylor_jet_impl<mppp::real128>;
+template void taylor_jet_impl<mppp::real128>::finalise_ctor_impl(std::vector<expression>, std::uint32_t,
+                                                                 std::uint32_t, bool, bool, std::vector<expression>);
+template void taylor_jet_impl<mppp::real128>::finalise_ctor_impl(std::vector<std::pair<expression, expression>>,
+                                                                 std::uint32_t, std::uint32_t, bool, bool,
+                                                                 std::vector<expression>);
+
+#endif
+
+} // namespace heyoka::detail
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The key of a jet function in the cache of taylor_cached_jet().
+// NOTE: the system is stored as a list of expressions. If the system was
+// passed as a list of pairs, the lhs and the rhs of each equation
+// are stored one after the other.
+struct jet_cache_key {
+    std::type_index type;
+    bool pairs;
+    std::vector<expression> sys;
+    std::vector<expression> sv_funcs;
+    std::uint32_t order;
+    std::uint32_t batch_size;
+    bool high_accuracy;
+    bool compact_mode;
+};
+
+bool operator==(const jet_cache_key &a, const jet_cache_key &b)
+{
+    return a.type == b.type && a.pairs == b.pairs && a.sys == b.sys && a.sv_funcs == b.sv_funcs
+           && a.order == b.order && a.batch_size == b.batch_size && a.high_accuracy == b.high_accuracy
+           && a.compact_mode == b.compact_mode;
+}
+
+struct jet_cache_key_hasher {
+    std::size_t operator()(const jet_cache_key &k) const
+    {
+        auto seed = std::hash<std::type_index>{}(k.type);
+
+        boost::hash_combine(seed, k.pairs);
+        for (const auto &ex : k.sys) {
+            boost::hash_combine(seed, hash(ex));
+        }
+        for (const auto &ex : k.sv_funcs) {
+            boost::hash_combine(seed, hash(ex));
+        }
+        boost::hash_combine(seed, k.order);
+        boost::hash_combine(seed, k.batch_size);
+        boost::hash_combine(seed, k.high_accuracy);
+        boost::hash_combine(seed, k.compact_mode);
+
+        return seed;
+    }
+};
+
+// An entry in the cache: the address of the compiled jet
+// function and the llvm_state owning the compiled code.
+struct jet_cache_entry {
+    std::uintptr_t f;
+    std::shared_ptr<const llvm_state> s;
+};
+
+struct jet_cache {
+    std::mutex mutex;
+    std::unordered_map<jet_cache_key, jet_cache_entry, jet_cache_key_hasher> map;
+};
+
+jet_cache &get_jet_cache()
+{
+    static jet_cache ret;
+
+    return ret;
+}
+
+template <typename T, typename U>
+std::pair<taylor_jet_f_t<T>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet_impl(U sys, std::uint32_t order, std::uint32_t batch_size, bool high_accuracy, bool compact_mode,
+                       std::vector<expression> sv_funcs)
+{
+    jet_cache_key key{typeid(T), false, {}, sv_funcs, order, batch_size, high_accuracy, compact_mode};
+    if constexpr (std::is_same_v<U, std::vector<expression>>) {
+        key.sys = sys;
+    } else {
+        key.pairs = true;
+        for (const auto &[lhs, rhs] : sys) {
+            key.sys.push_back(lhs);
+            key.sys.push_back(rhs);
+        }
+    }
+
+    auto &jc = get_jet_cache();
+
+    {
+        std::lock_guard lock(jc.mutex);
+
+        if (const auto it = jc.map.find(key); it != jc.map.end()) {
+            return {reinterpret_cast<taylor_jet_f_t<T>>(it->second.f), it->second.s};
+        }
+    }
+
+    // Cache miss: build and compile the jet function.
+    // NOTE: this is done without holding the lock, so that
+    // the compilation does not block the other threads.
+    auto s = std::make_shared<llvm_state>();
+    taylor_add_jet<T>(*s, "jet", std::move(sys), order, batch_size, high_accuracy, compact_mode, std::move(sv_funcs));
+    s->compile();
+
+    const auto f = s->jit_lookup("jet");
+
+    std::lock_guard lock(jc.mutex);
+
+    // NOTE: if another thread added the same jet function
+    // in the meantime, the existing entry is returned.
+    const auto it = jc.map.emplace(std::move(key), jet_cache_entry{f, std::move(s)}).first;
+
+    return {reinterpret_cast<taylor_jet_f_t<T>>(it->second.f), it->second.s};
+}
+
+} // namespace
+
+} // namespace detail
+
+template <typename T>
+std::pair<taylor_jet_f_t<T>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet(std::vector<expression> sys, std::uint32_t order, std::uint32_t batch_size, bool high_accuracy,
+                  bool compact_mode, std::vector<expression> sv_funcs)
+{
+    return detail::taylor_cached_jet_impl<T>(std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                             std::move(sv_funcs));
+}
+
+template <typename T>
+std::pair<taylor_jet_f_t<T>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet(std::vector<std::pair<expression, expression>> sys, std::uint32_t order, std::uint32_t batch_size,
+                  bool high_accuracy, bool compact_mode, std::vector<expression> sv_funcs)
+{
+    return detail::taylor_cached_jet_impl<T>(std::move(sys), order, batch_size, high_accuracy, compact_mode,
+                                             std::move(sv_funcs));
+}
+
+std::size_t taylor_jet_cache_size()
+{
+    auto &jc = detail::get_jet_cache();
+
+    std::lock_guard lock(jc.mutex);
+
+    return jc.map.size();
+}
+
+void taylor_clear_jet_cache()
+{
+    auto &jc = detail::get_jet_cache();
+
+    std::lock_guard lock(jc.mutex);
+
+    jc.map.clear();
+}
+
+// Explicit instantiations.
+template std::pair<taylor_jet_f_t<double>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet<double>(std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool, std::vector<expression>);
+template std::pair<taylor_jet_f_t<double>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet<double>(std::vector<std::pair<expression, expression>>, std::uint32_t, std::uint32_t, bool, bool,
+                          std::vector<expression>);
+
+template std::pair<taylor_jet_f_t<long double>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet<long double>(std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool,
+                               std::vector<expression>);
+template std::pair<taylor_jet_f_t<long double>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet<long double>(std::vector<std::pair<expression, expression>>, std::uint32_t, std::uint32_t, bool,
+                               bool, std::vector<expression>);
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template std::pair<taylor_jet_f_t<mppp::real128>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet<mppp::real128>(std::vector<expression>, std::uint32_t, std::uint32_t, bool, bool,
+                                 std::vector<expression>);
+template std::pair<taylor_jet_f_t<mppp::real128>, std::shared_ptr<const llvm_state>>
+taylor_cached_jet<mppp::real128>(std::vector<std::pair<expression, expression>>, std::uint32_t, std::uint32_t, bool,
+                                 bool, std::vector<expression>);
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,233 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_pool.hpp>
+
+namespace heyoka
+{
+
+template <typename T>
+struct taylor_pool<T>::impl {
+    // NOTE: the time of the prototype is normalised to a
+    // single floating-point value, so that the reset below
+    // restores it exactly.
+    explicit impl(const taylor_adaptive<T> &proto)
+        : m_proto([&proto]() {
+              auto retval = proto;
+              retval.set_time(proto.get_time());
+              return retval;
+          }())
+    {
+    }
+
+    // Reset the integrator ta to the
+    // prototype's state, time and pars.
+    void reset(taylor_adaptive<T> &ta) const
+    {
+        assert(ta.get_state().size() == m_proto.get_state().size());
+        assert(ta.get_pars().size() == m_proto.get_pars().size());
+
+        std::copy(m_proto.get_state().begin(), m_proto.get_state().end(), ta.get_state_data());
+        std::copy(m_proto.get_pars().begin(), m_proto.get_pars().end(), ta.get_pars_data());
+        ta.set_time(m_proto.get_time());
+        ta.reset_cooldowns();
+    }
+
+    // NOTE: the prototype is immutable, thus it
+    // can be read without holding the mutex.
+    const taylor_adaptive<T> m_proto;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<taylor_adaptive<T>>> m_free;
+    std::size_t m_size = 0;
+};
+
+template <typename T>
+taylor_pool<T>::handle::handle(std::shared_ptr<impl> i, std::unique_ptr<taylor_adaptive<T>> ta)
+    : m_impl(std::move(i)), m_ta(std::move(ta))
+{
+}
+
+template <typename T>
+taylor_pool<T>::handle::handle() noexcept = default;
+
+template <typename T>
+taylor_pool<T>::handle::handle(handle &&) noexcept = default;
+
+template <typename T>
+typename taylor_pool<T>::handle &taylor_pool<T>::handle::operator=(handle &&other) noexcept
+{
+    if (this != &other) {
+        release();
+
+        m_impl = std::move(other.m_impl);
+        m_ta = std::move(other.m_ta);
+    }
+
+    return *this;
+}
+
+template <typename T>
+taylor_pool<T>::handle::~handle()
+{
+    release();
+}
+
+template <typename T>
+void taylor_pool<T>::handle::release() noexcept
+{
+    if (!m_ta) {
+        return;
+    }
+
+    assert(m_impl);
+
+    // NOTE: if the integrator cannot be returned to the
+    // pool (e.g., in case of memory allocation failures),
+    // it is just destroyed.
+    // LCOV_EXCL_START
+    try {
+        m_impl->reset(*m_ta);
+
+        std::lock_guard lock(m_impl->m_mutex);
+
+        m_impl->m_free.push_back(std::move(m_ta));
+    } catch (...) {
+        std::lock_guard lock(m_impl->m_mutex);
+
+        --m_impl->m_size;
+    }
+    // LCOV_EXCL_STOP
+
+    m_ta.reset();
+    m_impl.reset();
+}
+
+template <typename T>
+taylor_pool<T>::taylor_pool(const taylor_adaptive<T> &proto, std::size_t n) : m_impl(std::make_shared<impl>(proto))
+{
+    m_impl->m_free.reserve(n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        m_impl->m_free.push_back(std::make_unique<taylor_adaptive<T>>(m_impl->m_proto));
+    }
+
+    m_impl->m_size = n;
+}
+
+template <typename T>
+taylor_pool<T>::taylor_pool(taylor_pool &&) noexcept = default;
+
+template <typename T>
+taylor_pool<T> &taylor_pool<T>::operator=(taylor_pool &&) noexcept = default;
+
+template <typename T>
+taylor_pool<T>::~taylor_pool() = default;
+
+template <typename T>
+const taylor_adaptive<T> &taylor_pool<T>::get_prototype() const
+{
+    if (!m_impl) {
+        throw std::invalid_argument("Cannot fetch the prototype of a moved-from integrator pool");
+    }
+
+    return m_impl->m_proto;
+}
+
+template <typename T>
+std::optional<typename taylor_pool<T>::handle> taylor_pool<T>::try_checkout()
+{
+    if (!m_impl) {
+        throw std::invalid_argument("Cannot check out an integrator from a moved-from integrator pool");
+    }
+
+    std::lock_guard lock(m_impl->m_mutex);
+
+    if (m_impl->m_free.empty()) {
+        return {};
+    }
+
+    auto ta = std::move(m_impl->m_free.back());
+    m_impl->m_free.pop_back();
+
+    return handle(m_impl, std::move(ta));
+}
+
+template <typename T>
+typename taylor_pool<T>::handle taylor_pool<T>::checkout()
+{
+    if (auto h = try_checkout()) {
+        return std::move(*h);
+    }
+
+    // NOTE: create the new integrator without
+    // holding the mutex.
+    auto ta = std::make_unique<taylor_adaptive<T>>(m_impl->m_proto);
+
+    {
+        std::lock_guard lock(m_impl->m_mutex);
+
+        ++m_impl->m_size;
+    }
+
+    return handle(m_impl, std::move(ta));
+}
+
+template <typename T>
+std::size_t taylor_pool<T>::get_n_available() const
+{
+    if (!m_impl) {
+        return 0;
+    }
+
+    std::lock_guard lock(m_impl->m_mutex);
+
+    return m_impl->m_free.size();
+}
+
+template <typename T>
+std::size_t taylor_pool<T>::get_size() const
+{
+    if (!m_impl) {
+        return 0;
+    }
+
+    std::lock_guard lock(m_impl->m_mutex);
+
+    return m_impl->m_size;
+}
+
+template class taylor_pool<double>;
+template class taylor_pool<long double>;
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+template class taylor_pool<mppp::real128>;
+
+#endif
+
+} // namespace heyoka
@@ -0,0 +1,165 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <heyoka/detail/tracing.hpp>
+#include <heyoka/tracing.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// A recorded span.
+struct trace_event {
+    const char *name;
+    const char *cat;
+    // Start time and duration, in microseconds.
+    std::int64_t ts;
+    std::int64_t dur;
+    std::uint32_t tid;
+};
+
+std::atomic<bool> tracing_enabled{false};
+
+std::mutex trace_mutex;
+std::vector<trace_event> trace_buffer;
+
+// The reference time for the timestamps.
+const auto trace_epoch = std::chrono::steady_clock::now();
+
+// Small sequential thread IDs, which are more readable
+// than the hashes of std::thread::id in the trace viewers.
+std::uint32_t trace_tid()
+{
+    static std::atomic<std::uint32_t> counter{0};
+    thread_local const auto tid = counter.fetch_add(1, std::memory_order_relaxed);
+
+    return tid;
+}
+
+std::int64_t to_us(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+} // namespace
+
+trace_span::trace_span(const char *name, const char *cat) noexcept
+{
+    if (tracing_enabled.load(std::memory_order_relaxed)) {
+        m_name = name;
+        m_cat = cat;
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+trace_span::~trace_span()
+{
+    if (m_name == nullptr) {
+        return;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const trace_event ev{m_name, m_cat, to_us(m_start - trace_epoch), to_us(end - m_start), trace_tid()};
+
+    // LCOV_EXCL_START
+    try {
+        std::lock_guard lock(trace_mutex);
+
+        trace_buffer.push_back(ev);
+    } catch (...) {
+        // NOTE: if we cannot record the span,
+        // just drop it.
+    }
+    // LCOV_EXCL_STOP
+}
+
+} // namespace detail
+
+bool get_tracing_enabled()
+{
+    return detail::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+void set_tracing_enabled(bool flag)
+{
+    detail::tracing_enabled.store(flag, std::memory_order_relaxed);
+}
+
+std::size_t get_trace_size()
+{
+    std::lock_guard lock(detail::trace_mutex);
+
+    return detail::trace_buffer.size();
+}
+
+void clear_trace()
+{
+    std::lock_guard lock(detail::trace_mutex);
+
+    detail::trace_buffer.clear();
+}
+
+std::string get_trace_json()
+{
+    // NOTE: copy the buffer in order to avoid
+    // formatting while holding the lock.
+    std::vector<detail::trace_event> evs;
+    {
+        std::lock_guard lock(detail::trace_mutex);
+
+        evs = detail::trace_buffer;
+    }
+
+    std::ostringstream oss;
+    oss << "{\"traceEvents\":[";
+
+    for (decltype(evs.size()) i = 0; i < evs.size(); ++i) {
+        const auto &ev = evs[i];
+
+        oss << (i == 0u ? "\n" : ",\n")
+            << fmt::format("{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{},\"dur\":{},\"pid\":0,\"tid\":{}}}",
+                           ev.name, ev.cat, ev.ts, ev.dur, ev.tid);
+    }
+
+    oss << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return oss.str();
+}
+
+void save_trace(const std::string &path)
+{
+    using namespace fmt::literals;
+
+    std::ofstream ofs(path, std::ios_base::out | std::ios_base::trunc);
+    if (!ofs) {
+        throw std::invalid_argument("Could not open the file '{}' for writing the trace"_format(path));
+    }
+
+    ofs << get_trace_json();
+}
+
+} // namespace heyoka
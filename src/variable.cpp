@@ -9,11 +9,18 @@
 #include <heyoka/config.hpp>
 
 #include <cassert>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -42,7 +49,85 @@
 namespace heyoka
 {
 
-variable::variable(std::string s) : m_name(std::move(s)) {}
+namespace detail
+{
+
+// An entry in the symbol table of the variable names: the name,
+// its hash and, for the names of the u variables, their index.
+struct var_entry {
+    std::string name;
+    std::size_t hash;
+    bool is_uvar;
+    std::uint32_t u_idx;
+};
+
+namespace
+{
+
+// The symbol table of the variable names.
+// NOTE: the keys are views on the names stored in the
+// (heap-allocated, and thus stable) entries.
+struct var_table {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string_view, std::unique_ptr<var_entry>> map;
+};
+
+var_table &get_var_table()
+{
+    static var_table ret;
+
+    return ret;
+}
+
+// Fetch the entry for the name s, inserting
+// it into the symbol table if needed.
+const var_entry *var_intern(std::string s)
+{
+    auto &tbl = get_var_table();
+
+    {
+        std::shared_lock lock(tbl.mutex);
+
+        if (const auto it = tbl.map.find(s); it != tbl.map.end()) {
+            return it->second.get();
+        }
+    }
+
+    // Create the new entry.
+    auto entry = std::make_unique<var_entry>();
+    entry->hash = std::hash<std::string>{}(s);
+    entry->is_uvar = false;
+    entry->u_idx = 0;
+    if (s.rfind("u_", 0) == 0) {
+        const auto ret = std::from_chars(s.data() + 2, s.data() + s.size(), entry->u_idx);
+        entry->is_uvar = ret.ec == std::errc{};
+    }
+    entry->name = std::move(s);
+
+    std::unique_lock lock(tbl.mutex);
+
+    // NOTE: if another thread inserted the same name
+    // in the meantime, its entry will be used.
+    const auto ret = tbl.map.try_emplace(std::string_view(entry->name), nullptr);
+    if (ret.second) {
+        ret.first->second = std::move(entry);
+    }
+
+    return ret.first->second.get();
+}
+
+} // namespace
+
+std::uint32_t uname_to_index(const variable &v)
+{
+    assert(v.get_entry()->is_uvar);
+
+    return v.get_entry()->u_idx;
+}
+
+} // namespace detail
+
+variable::variable(std::string s) : m_ptr(detail::var_intern(std::move(s))) {}
 
 variable::variable(const variable &) = default;
 
@@ -54,24 +139,27 @@ variable &variable::operator=(const variable &) = default;
 
 variable &variable::operator=(variable &&) noexcept = default;
 
-std::string &variable::name()
+const std::string &variable::name() const
 {
-    return m_name;
+    return m_ptr->name;
 }
 
-const std::string &variable::name() const
+const detail::var_entry *variable::get_entry() const
 {
-    return m_name;
+    return m_ptr;
 }
 
 void swap(variable &v0, variable &v1) noexcept
 {
-    std::swap(v0.name(), v1.name());
+    std::swap(v0, v1);
 }
 
+// NOTE: the hash is the hash of the name, so
+// that it does not depend on the addresses
+// of the entries in the symbol table.
 std::size_t hash(const variable &v)
 {
-    return std::hash<std::string>{}(v.name());
+    return v.get_entry()->hash;
 }
 
 std::ostream &operator<<(std::ostream &os, const variable &var)
@@ -87,13 +175,13 @@ std::vector<std::string> get_variables(const variable &var)
 void rename_variables(variable &var, const std::unordered_map<std::string, std::string> &repl_map)
 {
     if (auto it = repl_map.find(var.name()); it != repl_map.end()) {
-        var.name() = it->second;
+        var = variable{it->second};
     }
 }
 
 bool operator==(const variable &v1, const variable &v2)
 {
-    return v1.name() == v2.name();
+    return v1.get_entry() == v2.get_entry();
 }
 
 bool operator!=(const variable &v1, const variable &v2)
@@ -191,7 +279,7 @@ void update_grad_dbl(std::unordered_map<std::string, double> &grad, const variab
                      const std::unordered_map<std::string, double> &, const std::vector<double> &,
                      const std::vector<std::vector<std::size_t>> &, std::size_t &node_counter, double acc)
 {
-    grad[var.name()] = grad[var.name()] + acc;
+    grad[var.name()] += acc;
     node_counter++;
 }
 
@@ -0,0 +1,493 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <heyoka/detail/type_traits.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/func.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/variable.hpp>
+#include <heyoka/variational.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Check if ex is the number zero.
+bool variational_is_zero(const expression &ex)
+{
+    const auto *nptr = std::get_if<number>(&ex.value());
+
+    return nptr != nullptr && is_zero(*nptr);
+}
+
+// Check the order of a variational ODE system.
+void variational_check_order(std::uint32_t order)
+{
+    if (order == 0u || order > 2u) {
+        using namespace fmt::literals;
+
+        throw std::invalid_argument(
+            "The order of the variational equations must be either 1 or 2, but it is {} instead"_format(order));
+    }
+}
+
+// Helper to transform the leaves of the expression ex via the function object leaf_f.
+// NOTE: memo maps the functions already visited to their transformed counterparts,
+// so that the subexpressions shared in the input are transformed only once
+// (and they are shared in the output as well).
+template <typename F>
+expression variational_transform(std::unordered_map<const void *, expression> &memo, const expression &ex,
+                                 const F &leaf_f)
+{
+    return std::visit(
+        [&](const auto &v) -> expression {
+            if constexpr (std::is_same_v<uncvref_t<decltype(v)>, func>) {
+                const auto *f_id = v.get_ptr();
+
+                if (auto it = memo.find(f_id); it != memo.end()) {
+                    return it->second;
+                }
+
+                auto f_copy = v;
+                for (auto [b, e] = f_copy.get_mutable_args_it(); b != e; ++b) {
+                    *b = variational_transform(memo, *b, leaf_f);
+                }
+
+                return memo.emplace(f_id, expression{std::move(f_copy)}).first->second;
+            } else {
+                return leaf_f(ex);
+            }
+        },
+        ex.value());
+}
+
+// Name of the placeholder variable used to represent
+// the parameter with index idx during differentiation.
+std::string variational_par_name(std::uint32_t idx)
+{
+    using namespace fmt::literals;
+
+    return "__heyoka_var_par_{}"_format(idx);
+}
+
+} // namespace
+
+// Compute the size of the state vector of a variational ODE system of order 'order'
+// with n_pars parameter sensitivities, constructed from a system with n equations.
+std::vector<double>::size_type variational_sys_size(std::vector<double>::size_type n, std::uint32_t order,
+                                                     std::vector<double>::size_type n_pars)
+{
+    using size_type = std::vector<double>::size_type;
+
+    variational_check_order(order);
+
+    // NOTE: the total size is n + n**2 (+ n**2 * (n + 1) / 2 if order == 2) + n * n_pars.
+    // LCOV_EXCL_START
+    if (n > static_cast<size_type>(std::numeric_limits<std::uint32_t>::max())
+        || n_pars > static_cast<size_type>(std::numeric_limits<std::uint32_t>::max())) {
+        throw std::overflow_error("Overflow detected in the computation of the size of a variational ODE system");
+    }
+    // LCOV_EXCL_STOP
+
+    auto retval = n + n * n + n * n_pars;
+
+    if (order == 2u) {
+        retval += n * (n * (n + 1u) / 2u);
+    }
+
+    return retval;
+}
+
+std::vector<std::pair<expression, expression>>
+make_variational_sys_impl(std::vector<std::pair<expression, expression>> sys, std::uint32_t order,
+                          std::vector<expression> pars, bool sparse)
+{
+    using namespace fmt::literals;
+    using size_type = decltype(sys.size());
+
+    if (sys.empty()) {
+        throw std::invalid_argument("Cannot create the variational equations of a system of zero equations");
+    }
+
+    variational_check_order(order);
+
+    if (sparse && order == 2u) {
+        throw std::invalid_argument("The sparse mode is supported only for first-order variational equations");
+    }
+
+    const auto n = sys.size();
+
+    // NOTE: this will check for overflow.
+    const auto tot_size = variational_sys_size(n, order, pars.size());
+
+    // Fetch the state variables and the right-hand sides.
+    std::vector<expression> vars, rhs;
+    std::unordered_set<std::string> vars_set;
+    for (const auto &[lhs, r] : sys) {
+        const auto *var_ptr = std::get_if<variable>(&lhs.value());
+
+        if (var_ptr == nullptr) {
+            throw std::invalid_argument("Error in the construction of a variational ODE system: the "
+                                        "left-hand side contains the expression '{}', which is not a variable"_format(
+                                            lhs));
+        }
+
+        if (!vars_set.insert(var_ptr->name()).second) {
+            throw std::invalid_argument("Error in the construction of a variational ODE system: the variable '{}' "
+                                        "appears in the left-hand side twice"_format(var_ptr->name()));
+        }
+
+        vars.push_back(lhs);
+        rhs.push_back(r);
+    }
+
+    // Helper to create the variables representing the variational quantities.
+    auto make_var = [&vars_set](std::string name) {
+        if (vars_set.find(name) != vars_set.end()) {
+            throw std::invalid_argument("Error in the construction of a variational ODE system: the state variable "
+                                        "'{}' clashes with the name of a variational variable"_format(name));
+        }
+
+        return expression{variable{std::move(name)}};
+    };
+
+    const auto n_pars = pars.size();
+
+    // Create the variables for the state transition matrix.
+    // NOTE: in sparse mode, the structurally zero entries
+    // are represented by the number zero (see below).
+    std::vector<expression> phi;
+    phi.reserve(n * n);
+
+    // Validate the parameters for the sensitivities, and create the placeholder
+    // variables that will represent them during differentiation.
+    std::unordered_map<std::uint32_t, expression> par_to_var;
+    std::unordered_map<std::string, expression> var_to_par;
+    std::vector<expression> diff_vars(vars);
+    for (const auto &ex : pars) {
+        const auto *par_ptr = std::get_if<param>(&ex.value());
+
+        if (par_ptr == nullptr) {
+            throw std::invalid_argument("Error in the construction of a variational ODE system: the expression '{}' "
+                                        "in the list of parameters is not a parameter"_format(ex));
+        }
+
+        auto ph = expression{variable{variational_par_name(par_ptr->idx())}};
+
+        if (!par_to_var.emplace(par_ptr->idx(), ph).second) {
+            throw std::invalid_argument("Error in the construction of a variational ODE system: the parameter '{}' "
+                                        "appears in the list of parameters twice"_format(ex));
+        }
+
+        var_to_par.emplace(variational_par_name(par_ptr->idx()), ex);
+        diff_vars.push_back(std::move(ph));
+    }
+
+    // Compute the Jacobian of the dynamics with respect to
+    // the state variables and to the parameters.
+    // NOTE: if there are parameters, they are replaced in
+    // the rhs by the placeholder variables before differentiation,
+    // and then restored.
+    std::vector<expression> jac, jac_pars;
+    if (pars.empty()) {
+        jac = diff(rhs, vars);
+    } else {
+        std::unordered_map<const void *, expression> memo;
+        std::vector<expression> rhs_pv;
+        rhs_pv.reserve(n);
+        for (const auto &r : rhs) {
+            rhs_pv.push_back(variational_transform(memo, r, [&par_to_var](const expression &leaf) {
+                if (const auto *par_ptr = std::get_if<param>(&leaf.value())) {
+                    if (auto it = par_to_var.find(par_ptr->idx()); it != par_to_var.end()) {
+                        return it->second;
+                    }
+                }
+
+                return leaf;
+            }));
+        }
+
+        const auto full_jac = diff(rhs_pv, diff_vars);
+        assert(full_jac.size() == n * (n + pars.size()));
+
+        memo.clear();
+        auto restore = [&memo, &var_to_par](const expression &ex) {
+            return variational_transform(memo, ex, [&var_to_par](const expression &leaf) {
+                if (const auto *var_ptr = std::get_if<variable>(&leaf.value())) {
+                    if (auto it = var_to_par.find(var_ptr->name()); it != var_to_par.end()) {
+                        return it->second;
+                    }
+                }
+
+                return leaf;
+            });
+        };
+
+        jac.reserve(n * n);
+        jac_pars.reserve(n * pars.size());
+        for (size_type i = 0; i < n; ++i) {
+            for (size_type j = 0; j < n + pars.size(); ++j) {
+                (j < n ? jac : jac_pars).push_back(restore(full_jac[i * (n + pars.size()) + j]));
+            }
+        }
+    }
+    assert(jac.size() == n * n);
+    assert(jac_pars.size() == n * pars.size());
+
+    // Determine the structurally non-zero entries of the state
+    // transition matrix and of the sensitivities.
+    // NOTE: phi_i_j is structurally non-zero if x_i depends on x_j(0), that is,
+    // if j can be reached from i in the graph of the non-zero entries of the Jacobian
+    // (including j == i, due to the identity initial conditions). Similarly, phi_i_pk is
+    // structurally non-zero if the graph connects i to a row of the Jacobian wrt the
+    // parameters in which the entry for par[k] is non-zero. The structurally zero
+    // entries remain zero during the integration, thus in sparse mode their
+    // equations are omitted.
+    std::vector<char> phi_nz(n * n, 1), sens_nz(n * n_pars, 1);
+    if (sparse) {
+        std::fill(phi_nz.begin(), phi_nz.end(), 0);
+        std::fill(sens_nz.begin(), sens_nz.end(), 0);
+
+        // rdeps[l] contains the indices of the right-hand
+        // sides which depend on x_l.
+        std::vector<std::vector<size_type>> rdeps(n);
+        for (size_type i = 0; i < n; ++i) {
+            for (size_type l = 0; l < n; ++l) {
+                if (!variational_is_zero(jac[i * n + l])) {
+                    rdeps[l].push_back(i);
+                }
+            }
+        }
+
+        // Helper to flag all the rows reachable from the
+        // rows in the stack, for the column col of the matrix
+        // nz with n_cols columns.
+        std::vector<size_type> stack;
+        auto flag_reachable = [&rdeps, &stack](std::vector<char> &nz, size_type n_cols, size_type col) {
+            while (!stack.empty()) {
+                const auto l = stack.back();
+                stack.pop_back();
+
+                for (auto i : rdeps[l]) {
+                    if (nz[i * n_cols + col] == 0) {
+                        nz[i * n_cols + col] = 1;
+                        stack.push_back(i);
+                    }
+                }
+            }
+        };
+
+        for (size_type j = 0; j < n; ++j) {
+            phi_nz[j * n + j] = 1;
+            stack.push_back(j);
+            flag_reachable(phi_nz, n, j);
+        }
+
+        for (size_type k = 0; k < n_pars; ++k) {
+            for (size_type i = 0; i < n; ++i) {
+                if (!variational_is_zero(jac_pars[i * n_pars + k])) {
+                    sens_nz[i * n_pars + k] = 1;
+                    stack.push_back(i);
+                }
+            }
+            flag_reachable(sens_nz, n_pars, k);
+        }
+    }
+
+    for (size_type i = 0; i < n; ++i) {
+        for (size_type j = 0; j < n; ++j) {
+            phi.push_back(phi_nz[i * n + j] != 0 ? make_var("phi_{}_{}"_format(i, j)) : 0_dbl);
+        }
+    }
+
+    std::vector<std::pair<expression, expression>> retval(std::move(sys));
+    retval.reserve(tot_size);
+
+    // First-order variational equations: phi' = jac * phi.
+    for (size_type i = 0; i < n; ++i) {
+        for (size_type j = 0; j < n; ++j) {
+            if (phi_nz[i * n + j] == 0) {
+                continue;
+            }
+
+            std::vector<expression> terms;
+
+            for (size_type l = 0; l < n; ++l) {
+                if (!variational_is_zero(jac[i * n + l]) && phi_nz[l * n + j] != 0) {
+                    terms.push_back(jac[i * n + l] * phi[l * n + j]);
+                }
+            }
+
+            retval.push_back(prime(phi[i * n + j]) = pairwise_sum(std::move(terms)));
+        }
+    }
+
+    if (order == 2u) {
+        // Create the variables for the second-order derivatives,
+        // exploiting their symmetry.
+        // NOTE: psi_idx(i, j, k) is the index in psi of the variable representing
+        // the second-order derivative of x_i wrt x_j(0) and x_k(0), for j <= k.
+        const auto n_sym = n * (n + 1u) / 2u;
+        auto psi_idx = [n, n_sym](size_type i, size_type j, size_type k) {
+            assert(j <= k);
+
+            return i * n_sym + j * n - j * (j + 1u) / 2u + k;
+        };
+
+        std::vector<expression> psi;
+        psi.reserve(n * n_sym);
+        for (size_type i = 0; i < n; ++i) {
+            for (size_type j = 0; j < n; ++j) {
+                for (auto k = j; k < n; ++k) {
+                    assert(psi.size() == psi_idx(i, j, k));
+                    psi.push_back(make_var("phi_{}_{}_{}"_format(i, j, k)));
+                }
+            }
+        }
+
+        // Compute the Hessians of the dynamics.
+        // NOTE: hess[(i * n + l) * n + m] is the second-order derivative of
+        // the i-th rhs wrt x_l and x_m.
+        const auto hess = diff(jac, vars);
+        assert(hess.size() == n * n * n);
+
+        // Second-order variational equations:
+        // psi_i_j_k' = sum_l jac_i_l * psi_l_j_k + sum_l_m hess_i_l_m * phi_l_j * phi_m_k.
+        for (size_type i = 0; i < n; ++i) {
+            for (size_type j = 0; j < n; ++j) {
+                for (auto k = j; k < n; ++k) {
+                    std::vector<expression> terms;
+
+                    for (size_type l = 0; l < n; ++l) {
+                        if (!variational_is_zero(jac[i * n + l])) {
+                            terms.push_back(jac[i * n + l] * psi[psi_idx(l, j, k)]);
+                        }
+                    }
+
+                    for (size_type l = 0; l < n; ++l) {
+                        for (size_type m = 0; m < n; ++m) {
+                            if (!variational_is_zero(hess[(i * n + l) * n + m])) {
+                                terms.push_back(hess[(i * n + l) * n + m] * (phi[l * n + j] * phi[m * n + k]));
+                            }
+                        }
+                    }
+
+                    retval.push_back(prime(psi[psi_idx(i, j, k)]) = pairwise_sum(std::move(terms)));
+                }
+            }
+        }
+    }
+
+    // Sensitivities with respect to the parameters:
+    // phi_i_pk' = sum_l jac_i_l * phi_l_pk + d rhs_i / d par[k].
+    if (!pars.empty()) {
+        std::vector<expression> sens;
+        sens.reserve(n * n_pars);
+        for (size_type i = 0; i < n; ++i) {
+            for (size_type k = 0; k < n_pars; ++k) {
+                sens.push_back(sens_nz[i * n_pars + k] != 0
+                                   ? make_var("phi_{}_p{}"_format(i, std::get<param>(pars[k].value()).idx()))
+                                   : 0_dbl);
+            }
+        }
+
+        for (size_type i = 0; i < n; ++i) {
+            for (size_type k = 0; k < n_pars; ++k) {
+                if (sens_nz[i * n_pars + k] == 0) {
+                    continue;
+                }
+
+                std::vector<expression> terms;
+
+                for (size_type l = 0; l < n; ++l) {
+                    if (!variational_is_zero(jac[i * n + l]) && sens_nz[l * n_pars + k] != 0) {
+                        terms.push_back(jac[i * n + l] * sens[l * n_pars + k]);
+                    }
+                }
+
+                if (!variational_is_zero(jac_pars[i * n_pars + k])) {
+                    terms.push_back(jac_pars[i * n_pars + k]);
+                }
+
+                retval.push_back(prime(sens[i * n_pars + k]) = pairwise_sum(std::move(terms)));
+            }
+        }
+    }
+
+    assert(sparse || retval.size() == tot_size);
+
+    // Intern the right-hand sides, so that equal subexpressions
+    // share storage.
+    std::vector<expression> all_rhs;
+    all_rhs.reserve(retval.size());
+    for (auto &[_, r] : retval) {
+        all_rhs.push_back(std::move(r));
+    }
+    all_rhs = intern(all_rhs);
+    for (decltype(retval.size()) i = 0; i < retval.size(); ++i) {
+        retval[i].second = std::move(all_rhs[i]);
+    }
+
+    return retval;
+}
+
+// Determine the indices of the variables of the variational ODE system sys which
+// are initialised to one, that is, the diagonal entries of the state transition matrix.
+// n is the number of equations of the original system.
+std::vector<std::vector<double>::size_type>
+variational_ic_ones(const std::vector<std::pair<expression, expression>> &sys, std::vector<double>::size_type n)
+{
+    using namespace fmt::literals;
+
+    if (sys.size() < n) {
+        throw std::invalid_argument("Cannot create the initial conditions for a variational ODE system with {} "
+                                    "equations from a state vector of size {}"_format(sys.size(), n));
+    }
+
+    std::unordered_set<std::string> diag;
+    for (decltype(n) i = 0; i < n; ++i) {
+        diag.insert("phi_{}_{}"_format(i, i));
+    }
+
+    std::vector<std::vector<double>::size_type> retval;
+    for (auto idx = n; idx < sys.size(); ++idx) {
+        const auto *var_ptr = std::get_if<variable>(&sys[idx].first.value());
+
+        if (var_ptr != nullptr && diag.find(var_ptr->name()) != diag.end()) {
+            retval.push_back(idx);
+        }
+    }
+
+    return retval;
+}
+
+} // namespace detail
+
+} // namespace heyoka
@@ -0,0 +1,88 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Type.h>
+
+#include <heyoka/detail/sleef.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/warmup.hpp>
+
+namespace heyoka
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// The Taylor order used by the double-precision
+// integrators with the default tolerance.
+// NOTE: this must match taylor_order_from_tol().
+std::uint32_t warmup_default_order()
+{
+    return static_cast<std::uint32_t>(
+        std::max(2., std::ceil(-std::log(std::numeric_limits<double>::epsilon()) / 2 + 1)));
+}
+
+} // namespace
+
+} // namespace detail
+
+void warmup(const std::vector<std::uint32_t> &orders_, const std::vector<std::uint32_t> &batch_sizes_)
+{
+    // NOTE: the construction of an llvm_state initialises
+    // the native target and sets up the jit.
+    llvm_state s;
+
+    // The features of the host machine (detected once per process).
+    const auto simd_size = detail::recommended_simd_size<double>();
+
+    // The table of sleef functions.
+    // NOTE: the table is built on first use,
+    // the function name is irrelevant.
+    detail::sleef_function_name(s.context(), "sin", llvm::Type::getDoubleTy(s.context()), simd_size);
+
+    const auto orders = orders_.empty() ? std::vector<std::uint32_t>{detail::warmup_default_order()} : orders_;
+
+    auto batch_sizes = batch_sizes_;
+    if (batch_sizes.empty()) {
+        batch_sizes.push_back(1);
+        if (simd_size > 1u) {
+            batch_sizes.push_back(simd_size);
+        }
+    }
+
+    // The event detection kernels.
+    // NOTE: taylor_ed_warmup() will check the orders and the batch sizes.
+    for (auto order : orders) {
+        for (auto batch_size : batch_sizes) {
+            taylor_ed_warmup<double>(order, batch_size);
+        }
+    }
+}
+
+std::future<void> warmup_async(std::vector<std::uint32_t> orders, std::vector<std::uint32_t> batch_sizes)
+{
+    return std::async(std::launch::async, [orders = std::move(orders), batch_sizes = std::move(batch_sizes)]() {
+        warmup(orders, batch_sizes);
+    });
+}
+
+} // namespace heyoka
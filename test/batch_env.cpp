@@ -0,0 +1,123 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/batch_env.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("batch_env basic")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Damped pendulum with the torque in par[1] as control input.
+    const auto sys = {prime(x) = v, prime(v) = -par[0] * sin(x) - .1 * v + par[1]};
+
+    const std::uint32_t bs = 4;
+
+    auto make_ta = [&]() {
+        return taylor_adaptive_batch<double>{sys,
+                                             {0.05, 0.06, 0.07, 0.08, 0., 0., 0., 0.},
+                                             bs,
+                                             kw::pars = {9.8, 9.8, 9.8, 9.8, 0., 0., 0., 0.},
+                                             kw::t_events = {t_event_batch<double>(x * x - 1.)}};
+    };
+
+    // Error handling.
+    REQUIRE_THROWS_AS(batch_env<double>(make_ta(), 0., {1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(batch_env<double>(make_ta(), std::numeric_limits<double>::infinity(), {1}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(batch_env<double>(make_ta(), .1, {2}), std::invalid_argument);
+
+    unsigned n_resets = 0;
+    batch_env<double> env(make_ta(), .1, {1},
+                          [&n_resets](taylor_adaptive_batch<double> &ta, std::uint32_t idx) {
+                              ++n_resets;
+                              ta.get_state_data()[bs + idx] = .01;
+                          });
+
+    REQUIRE(env.get_dt() == .1);
+    REQUIRE(env.get_ctrl_idx() == std::vector<std::uint32_t>{1});
+    REQUIRE(env.get_obs() == env.get_ta().get_state());
+
+    REQUIRE_THROWS_AS(env.step(std::vector<double>{1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(env.step(static_cast<const double *>(nullptr)), std::invalid_argument);
+
+    // Reference scalar integrator for the first environment.
+    auto ta_ref = taylor_adaptive<double>{sys, {0.05, 0.}, kw::pars = {9.8, 0.}};
+
+    for (auto i = 0; i < 10; ++i) {
+        const auto ctrl = std::vector{.1 * i, 0., 0., 0.};
+
+        const auto &obs = env.step(ctrl);
+
+        ta_ref.get_pars_data()[1] = ctrl[0];
+        ta_ref.propagate_for(.1);
+
+        REQUIRE(obs.size() == 2u * bs);
+        REQUIRE(obs[0] == approximately(ta_ref.get_state()[0], 1000.));
+        REQUIRE(obs[bs] == approximately(ta_ref.get_state()[1], 1000.));
+        REQUIRE(env.get_ta().get_time()[0] == approximately(ta_ref.get_time(), 1000.));
+        REQUIRE(env.get_done() == std::vector{0, 0, 0, 0});
+    }
+
+    REQUIRE(n_resets == 0u);
+
+    // A large torque in the last environment
+    // triggers the terminal event.
+    auto done = false;
+    for (auto i = 0; i < 100 && !done; ++i) {
+        const auto &obs = env.step(std::vector{0., 0., 0., 50.});
+
+        if (env.get_done()[3] != 0) {
+            done = true;
+
+            REQUIRE(env.get_done() == std::vector{0, 0, 0, 1});
+            REQUIRE(env.get_outcomes()[3] == taylor_outcome{-1});
+            REQUIRE(std::abs(env.get_terminal_obs()[3]) == approximately(1., 1000.));
+
+            // The environment was reset and the reset callback invoked.
+            REQUIRE(n_resets == 1u);
+            REQUIRE(obs[3] == 0.08);
+            REQUIRE(obs[bs + 3u] == .01);
+            REQUIRE(env.get_ta().get_time()[3] == 0.);
+        } else {
+            REQUIRE(env.get_outcomes()[3] == taylor_outcome::time_limit);
+        }
+    }
+    REQUIRE(done);
+
+    // Reset of all the environments.
+    const auto &obs = env.reset();
+    REQUIRE(n_resets == 5u);
+    REQUIRE(obs == std::vector{0.05, 0.06, 0.07, 0.08, .01, .01, .01, .01});
+    REQUIRE(env.get_ta().get_time() == std::vector{0., 0., 0., 0.});
+
+    env.reset(2);
+    REQUIRE(n_resets == 6u);
+    REQUIRE_THROWS_AS(env.reset(4), std::invalid_argument);
+
+    // Copy semantics.
+    auto env2 = env;
+    REQUIRE(env2.step(std::vector{1., 1., 1., 1.}) == env.step(std::vector{1., 1., 1., 1.}));
+}
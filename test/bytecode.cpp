@@ -0,0 +1,119 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <heyoka/bytecode.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/log.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sigmoid.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/tan.hpp>
+#include <heyoka/param.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("bytecode basic")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    // NOTE: use a number of points larger than and
+    // not a multiple of the block size of the interpreter.
+    const std::size_t n_points = 151;
+
+    std::vector<double> in(2u * n_points);
+    std::unordered_map<std::string, std::vector<double>> in_map;
+    for (std::size_t i = 0; i < n_points; ++i) {
+        in[i] = static_cast<double>(i) / 100 + .1;
+        in[n_points + i] = static_cast<double>(i) / 70 - 1.305;
+    }
+    in_map["x"] = std::vector<double>(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(n_points));
+    in_map["y"] = std::vector<double>(in.begin() + static_cast<std::ptrdiff_t>(n_points), in.end());
+
+    const std::vector<double> pars{1.5, -.25};
+
+    // Expressions with dedicated opcodes and functions
+    // evaluated via eval_num_dbl().
+    for (const auto &ex :
+         {x + y, x * y - x / y, sin(x) * cos(y) + exp(x) - log(x), sqrt(x) * par[1] + par[0],
+          pow(x, y) + tan(y) * sigmoid(x * y), 1_dbl + x, expression{2.}, par[0] * (x - (y - (x * (y + par[1]))))}) {
+        const bytecode bc{ex, {"x", "y"}};
+
+        REQUIRE(bc.get_vars() == std::vector<std::string>{"x", "y"});
+        REQUIRE(bc.get_stack_size() > 0u);
+
+        const auto out = bc(in, n_points, pars);
+        REQUIRE(out.size() == n_points);
+
+        std::vector<double> ref(n_points);
+        eval_batch_dbl(ref, ex, in_map, pars);
+
+        for (std::size_t i = 0; i < n_points; ++i) {
+            REQUIRE(out[i] == approximately(ref[i]));
+        }
+    }
+
+    // neg and square.
+    {
+        const bytecode bc{-square(x) + -y};
+
+        REQUIRE(bc.get_vars() == std::vector<std::string>{"x", "y"});
+        REQUIRE(bc.get_n_pars() == 0u);
+
+        const auto out = bc(in, n_points);
+
+        for (std::size_t i = 0; i < n_points; ++i) {
+            REQUIRE(out[i] == approximately(-in[i] * in[i] - in[n_points + i]));
+        }
+    }
+
+    // Stack size.
+    REQUIRE(bytecode{x + y}.get_stack_size() == 2u);
+    REQUIRE(bytecode{x + (y + (x + y))}.get_stack_size() == 4u);
+    REQUIRE(bytecode{((x + y) + x) + y}.get_stack_size() == 2u);
+    REQUIRE(bytecode{par[3] * x}.get_n_pars() == 4u);
+
+    // Streaming.
+    {
+        std::ostringstream oss;
+        oss << bytecode{sin(x) + par[0] * y};
+
+        REQUIRE(oss.str() == "var x\nsin\npar 0\nvar y\nmul\nadd\n");
+    }
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(
+        (bytecode{x + y, {"x"}}), std::invalid_argument,
+        Message("The variable 'y' appears in the expression of a bytecode, "
+                "but it is not in the list of input variables"));
+    REQUIRE_THROWS_MATCHES(
+        (bytecode{x + y, {"x", "y", "x"}}), std::invalid_argument,
+        Message("The list of input variables of a bytecode contains the duplicate variable 'x'"));
+
+    const bytecode bc{x + par[0]};
+    REQUIRE_THROWS_AS(bc(std::vector<double>(3), n_points, pars), std::invalid_argument);
+    REQUIRE_THROWS_AS(bc(in_map["x"], n_points), std::invalid_argument);
+    REQUIRE_THROWS_AS(bc(nullptr, in.data(), n_points, pars.data()), std::invalid_argument);
+}
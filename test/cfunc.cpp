@@ -0,0 +1,274 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/square.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("cfunc basic")
+{
+    auto tester = [](auto fp_x, unsigned opt_level) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        const auto fn = std::vector<expression>{x + y, sin(x) * y - x / y, par[1] * exp(x), square(x + y) * par[0],
+                                                expression{fp_t(1.5)}};
+
+        // NOTE: use a number of points which is not
+        // a multiple of the batch sizes.
+        const std::size_t n_points = 17;
+
+        std::vector<fp_t> in(2u * n_points);
+        for (std::size_t i = 0; i < n_points; ++i) {
+            in[i] = fp_t(i) / 10 - 1;
+            in[n_points + i] = fp_t(i) / 7 + 1;
+        }
+
+        const auto pars = std::vector<fp_t>{fp_t(-0.5), fp_t(3)};
+
+        for (auto batch_size : {0u, 1u, 2u, 4u, 5u}) {
+            auto cf = cfunc<fp_t>{fn, kw::batch_size = batch_size, kw::opt_level = opt_level};
+
+            REQUIRE(cf.get_vars() == std::vector{x, y});
+            REQUIRE(cf.get_fn() == fn);
+            REQUIRE(cf.get_n_pars() == 2u);
+            REQUIRE(cf.get_batch_size() > 0u);
+            if (batch_size != 0u) {
+                REQUIRE(cf.get_batch_size() == batch_size);
+            }
+
+            for (auto n_threads : {1u, 0u, 3u}) {
+                const auto out = cf(in, n_points, pars, n_threads);
+
+                REQUIRE(out.size() == fn.size() * n_points);
+
+                for (std::size_t i = 0; i < fn.size(); ++i) {
+                    for (std::size_t j = 0; j < n_points; ++j) {
+                        const auto ref = eval<fp_t>(fn[i], {{"x", in[j]}, {"y", in[n_points + j]}}, pars);
+
+                        REQUIRE(out[i * n_points + j] == approximately(ref, fp_t(1000)));
+                    }
+                }
+            }
+
+            // Copy the compiled function.
+            auto cf2 = cf;
+            REQUIRE(cf2(in, n_points, pars) == cf(in, n_points, pars));
+
+            cf2 = cfunc<fp_t>{{x * y}, kw::batch_size = batch_size};
+            REQUIRE(cf2.get_n_pars() == 0u);
+            REQUIRE(cf2(in, n_points)[3] == approximately(in[3] * in[n_points + 3], fp_t(10)));
+
+            // Zero points.
+            REQUIRE(cf(std::vector<fp_t>{}, 0, pars).empty());
+        }
+    };
+
+    for (auto opt_level : {0u, 3u}) {
+        tuple_for_each(fp_types, [&tester, opt_level](auto x) { tester(x, opt_level); });
+    }
+}
+
+TEST_CASE("cfunc vars")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Explicit order of the input variables, with
+    // a variable which does not appear in the expressions.
+    auto cf = cfunc<double>{{x - y}, kw::vars = std::vector{z, y, x}, kw::batch_size = 2u};
+
+    REQUIRE(cf.get_vars() == std::vector{z, y, x});
+
+    const auto out = cf({1., 2., 3., 4., 5., 6.}, 2);
+    REQUIRE(out == std::vector{2., 2.});
+
+    // No input variables.
+    cf = cfunc<double>{{expression{1.}, par[0]}, kw::batch_size = 4u};
+
+    REQUIRE(cf.get_vars().empty());
+    REQUIRE(cf({}, 5, {2.}) == std::vector{1., 1., 1., 1., 1., 2., 2., 2., 2., 2.});
+
+    // Error modes.
+    REQUIRE_THROWS_AS(cfunc<double>(std::vector<expression>{}), std::invalid_argument);
+    REQUIRE_THROWS_AS((cfunc<double>{{x - y}, kw::vars = std::vector{x, y + z}}), std::invalid_argument);
+    REQUIRE_THROWS_AS((cfunc<double>{{x - y}, kw::vars = std::vector{x, y, x}}), std::invalid_argument);
+    REQUIRE_THROWS_AS((cfunc<double>{{x - y}, kw::vars = std::vector{x}}), std::invalid_argument);
+
+    cf = cfunc<double>(std::vector{x - y * par[2]});
+    REQUIRE(cf.get_n_pars() == 3u);
+    REQUIRE_THROWS_AS(cf({1., 2., 3.}, 2, {1., 2., 3.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(cf({1., 2.}, 1, {1., 2.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(cf(nullptr, nullptr, 1, nullptr), std::invalid_argument);
+}
+
+TEST_CASE("cfunc add_cfunc")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state s;
+
+    const auto vars = add_cfunc<double>(s, "cf", {x * y, x + par[0]}, 2);
+    REQUIRE(vars == std::vector{x, y});
+
+    // Name clash.
+    REQUIRE_THROWS_AS(add_cfunc<double>(s, "cf", {x * y}, 2), std::invalid_argument);
+    // Zero batch size.
+    REQUIRE_THROWS_AS(add_cfunc<double>(s, "cf2", {x * y}, 0), std::invalid_argument);
+
+    s.compile();
+
+    REQUIRE_THROWS_AS(add_cfunc<double>(s, "cf2", {x * y}, 2), std::invalid_argument);
+
+    auto fptr = reinterpret_cast<void (*)(double *, const double *, const double *, std::uint64_t)>(s.jit_lookup("cf"));
+
+    // Evaluate on 2 points out of a 3-points strided array.
+    const std::vector<double> in{1., 2., 3., 4., 5., 6.};
+    const std::vector<double> pars{10.};
+    std::vector<double> out(6u);
+
+    fptr(out.data(), in.data() + 1, pars.data(), 3);
+
+    REQUIRE(out == std::vector{10., 18., 0., 12., 13., 0.});
+}
+
+TEST_CASE("cfunc grad")
+{
+    auto tester = [](auto fp_x, unsigned opt_level) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, y] = make_vars("x", "y");
+
+        // NOTE: par[0] does not appear in the expression,
+        // its derivative must be zero.
+        const auto ex = x * y + sin(x) * par[1] - x / y + exp(y) * square(x - par[2]);
+
+        const std::size_t n_points = 11;
+
+        std::vector<fp_t> in(2u * n_points);
+        for (std::size_t i = 0; i < n_points; ++i) {
+            in[i] = fp_t(i) / 10 - 1;
+            in[n_points + i] = fp_t(i) / 7 + 1;
+        }
+
+        const auto pars = std::vector<fp_t>{fp_t(-0.5), fp_t(3), fp_t(0.25)};
+
+        // The reference values. The derivatives with respect to
+        // the variables are computed via symbolic differentiation.
+        const auto ref_fn = std::vector<expression>{
+            ex, diff(ex, x), diff(ex, y), expression{}, sin(x), -2_dbl * exp(y) * (x - par[2])};
+
+        for (auto batch_size : {0u, 1u, 2u, 4u}) {
+            auto cf = cfunc<fp_t>{{ex}, kw::gradient = true, kw::batch_size = batch_size, kw::opt_level = opt_level};
+
+            REQUIRE(cf.get_gradient());
+            REQUIRE(cf.get_vars() == std::vector{x, y});
+            REQUIRE(cf.get_n_pars() == 3u);
+            REQUIRE(cf.get_n_out() == 6u);
+
+            for (auto n_threads : {1u, 3u}) {
+                const auto out = cf(in, n_points, pars, n_threads);
+
+                REQUIRE(out.size() == 6u * n_points);
+
+                for (std::size_t i = 0; i < ref_fn.size(); ++i) {
+                    for (std::size_t j = 0; j < n_points; ++j) {
+                        const auto ref = eval<fp_t>(ref_fn[i], {{"x", in[j]}, {"y", in[n_points + j]}}, pars);
+
+                        REQUIRE(out[i * n_points + j] == approximately(ref, fp_t(1000)));
+                    }
+                }
+            }
+
+            // Copy the compiled function.
+            auto cf2 = cf;
+            REQUIRE(cf2.get_gradient());
+            REQUIRE(cf2.get_n_out() == 6u);
+            REQUIRE(cf2(in, n_points, pars) == cf(in, n_points, pars));
+        }
+    };
+
+    for (auto opt_level : {0u, 3u}) {
+        tuple_for_each(fp_types, [&tester, opt_level](auto x) { tester(x, opt_level); });
+    }
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Explicit order of the variables, with a variable
+    // which does not appear in the expression.
+    auto cf = cfunc<double>{{x * x * y}, kw::gradient = true, kw::vars = std::vector{z, y, x}, kw::batch_size = 1u};
+
+    REQUIRE(cf.get_n_out() == 4u);
+    REQUIRE(cf({0., 3., 2.}, 1) == std::vector{12., 0., 4., 12.});
+
+    // Compare with compute_grad_dbl().
+    const auto ex = sin(x * y) / (x + y);
+    const auto grad = compute_grad_dbl(ex, {{"x", .3}, {"y", -1.7}}, compute_connections(ex));
+
+    cf = cfunc<double>{{ex}, kw::gradient = true};
+    const auto out = cf({.3, -1.7}, 1);
+
+    REQUIRE(out.size() == 3u);
+    REQUIRE(out[1] == approximately(grad.at("x")));
+    REQUIRE(out[2] == approximately(grad.at("y")));
+
+    // Test the low-level function.
+    llvm_state s;
+
+    REQUIRE(add_cfunc_grad<double>(s, "cf", x * y * par[0], 2) == std::vector{x, y});
+
+    // Name clash.
+    REQUIRE_THROWS_AS(add_cfunc_grad<double>(s, "cf", x * y, 2), std::invalid_argument);
+
+    s.compile();
+
+    auto fptr = reinterpret_cast<void (*)(double *, const double *, const double *, std::uint64_t)>(s.jit_lookup("cf"));
+
+    const std::vector<double> g_in{1., 2., 3., 4.};
+    const std::vector<double> g_pars{10.};
+    std::vector<double> g_out(8u);
+
+    fptr(g_out.data(), g_in.data(), g_pars.data(), 2);
+
+    REQUIRE(g_out == std::vector{30., 80., 30., 40., 10., 20., 3., 8.});
+
+    // Error modes.
+    REQUIRE_THROWS_AS((cfunc<double>{{x, y}, kw::gradient = true}), std::invalid_argument);
+    REQUIRE_THROWS_AS((cfunc<double>{std::vector<expression>{}, kw::gradient = true}), std::invalid_argument);
+}
@@ -0,0 +1,221 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/chebyshev_output.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("chebyshev output basic")
+{
+    auto tester = [](auto fp_x, bool forward) {
+        using fp_t = decltype(fp_x);
+
+        using std::abs;
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {fp_t(0.05), fp_t(0.025)}};
+
+        auto co = continuous_output<fp_t>{ta};
+
+        ta.propagate_until(fp_t(forward ? 10 : -10), kw::c_output = co);
+
+        const auto tol = std::numeric_limits<fp_t>::epsilon() * 1000;
+        auto cho = chebyshev_output<fp_t>{co, kw::tol = tol};
+
+        REQUIRE(cho.get_dim() == 2u);
+        REQUIRE(cho.get_degree() == 16u);
+        REQUIRE(cho.get_n_segments() > 0u);
+        REQUIRE(cho.get_seg_bounds().size() == cho.get_n_segments() + 1u);
+        REQUIRE(cho.get_coeffs().size() == cho.get_n_segments() * 17u * 2u);
+
+        if constexpr (std::is_same_v<fp_t, double>) {
+            // NOTE: in double precision, the segments span several steps.
+            REQUIRE(cho.get_n_segments() < co.get_n_steps());
+        }
+
+        if (forward) {
+            REQUIRE(cho.get_bounds() == co.get_bounds());
+        } else {
+            REQUIRE(cho.get_bounds().first == co.get_bounds().second);
+            REQUIRE(cho.get_bounds().second == co.get_bounds().first);
+        }
+
+        std::vector<fp_t> grid;
+        for (auto i = -5; i < 110; ++i) {
+            grid.push_back(fp_t(forward ? i : -i) / 10);
+        }
+
+        // Compare with the continuous output.
+        for (const auto &t : grid) {
+            const auto &st = cho(t);
+            REQUIRE(&st == &cho.get_output());
+            REQUIRE(st.size() == 2u);
+
+            if (abs(t) <= 10) {
+                const auto &ref = co(t);
+
+                REQUIRE(abs(st[0] - ref[0]) <= tol * 10);
+                REQUIRE(abs(st[1] - ref[1]) <= tol * 10);
+            }
+        }
+
+        // The evaluation over a grid must match exactly the scalar evaluation.
+        const auto res = cho.eval_grid(grid);
+        REQUIRE(res.size() == grid.size() * 2u);
+        for (decltype(grid.size()) i = 0; i < grid.size(); ++i) {
+            REQUIRE(res[2u * i] == cho(grid[i])[0]);
+            REQUIRE(res[2u * i + 1u] == cho(grid[i])[1]);
+        }
+
+        // A looser tolerance results in fewer segments.
+        auto cho_lo = chebyshev_output<fp_t>{co, kw::tol = fp_t(1e-6), kw::cheb_degree = 12u};
+        REQUIRE(cho_lo.get_degree() == 12u);
+        REQUIRE(cho_lo.get_n_segments() <= cho.get_n_segments());
+
+        // Copy/move semantics.
+        auto cho2 = cho;
+        REQUIRE(cho2.get_coeffs() == cho.get_coeffs());
+        REQUIRE(cho2(fp_t(forward ? 4.2 : -4.2)) == cho(fp_t(forward ? 4.2 : -4.2)));
+
+        auto cho3 = std::move(cho2);
+        REQUIRE(cho3.get_seg_bounds() == cho.get_seg_bounds());
+        REQUIRE(cho3(fp_t(forward ? 4.2 : -4.2)) == cho(fp_t(forward ? 4.2 : -4.2)));
+    };
+
+    for (auto forward : {true, false}) {
+        tuple_for_each(fp_types, [&tester, forward](auto x) { tester(x, forward); });
+    }
+}
+
+TEST_CASE("chebyshev output save load")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {fp_t(0.05), fp_t(0.025)}};
+
+        auto co = continuous_output<fp_t>{ta};
+
+        ta.propagate_until(fp_t(10), kw::c_output = co);
+
+        auto cho = chebyshev_output<fp_t>{co, kw::tol = std::numeric_limits<fp_t>::epsilon() * 1000};
+
+        const std::string path = "heyoka_test_chebyshev_" + std::to_string(sizeof(fp_t)) + ".bin";
+        cho.save(path);
+
+        auto cho2 = chebyshev_output<fp_t>::load(path);
+
+        REQUIRE(cho2.get_dim() == cho.get_dim());
+        REQUIRE(cho2.get_degree() == cho.get_degree());
+        REQUIRE(cho2.get_n_segments() == cho.get_n_segments());
+        REQUIRE(cho2.get_seg_bounds() == cho.get_seg_bounds());
+        REQUIRE(cho2.get_coeffs() == cho.get_coeffs());
+
+        for (auto i = -5; i < 110; ++i) {
+            const auto t = fp_t(i) / 10;
+
+            REQUIRE(cho2(t) == cho(t));
+        }
+
+        // Mismatched floating-point format.
+        if constexpr (std::is_same_v<fp_t, double>) {
+            REQUIRE_THROWS_AS(chebyshev_output<long double>::load(path), std::invalid_argument);
+        } else {
+            REQUIRE_THROWS_AS(chebyshev_output<double>::load(path), std::invalid_argument);
+        }
+
+        std::remove(path.c_str());
+    };
+
+    tuple_for_each(fp_types, tester);
+
+    // Error modes.
+    REQUIRE_THROWS_AS(chebyshev_output<double>{}.save("heyoka_test_chebyshev_empty.bin"), std::invalid_argument);
+    REQUIRE_THROWS_AS(chebyshev_output<double>::load("heyoka_test_nonexistent_chebyshev.bin"),
+                      std::invalid_argument);
+
+    {
+        std::ofstream ofs("heyoka_test_junk_chebyshev.bin", std::ios_base::out | std::ios_base::binary);
+        ofs << std::string(1000, 'a');
+    }
+    REQUIRE_THROWS_AS(chebyshev_output<double>::load("heyoka_test_junk_chebyshev.bin"), std::invalid_argument);
+
+    {
+        std::ofstream ofs("heyoka_test_junk_chebyshev.bin", std::ios_base::out | std::ios_base::binary);
+        ofs << "heyoka";
+    }
+    REQUIRE_THROWS_AS(chebyshev_output<double>::load("heyoka_test_junk_chebyshev.bin"), std::invalid_argument);
+
+    std::remove("heyoka_test_junk_chebyshev.bin");
+}
+
+TEST_CASE("chebyshev output errors")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    auto co = continuous_output<double>{ta};
+
+    // Empty continuous output.
+    REQUIRE_THROWS_AS(chebyshev_output<double>{co}, std::invalid_argument);
+
+    ta.propagate_until(1., kw::c_output = co);
+
+    REQUIRE_THROWS_AS(chebyshev_output<double>(co, kw::tol = -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(chebyshev_output<double>(co, kw::tol = std::numeric_limits<double>::quiet_NaN()),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(chebyshev_output<double>(co, kw::cheb_degree = 0u), std::invalid_argument);
+
+    // Empty Chebyshev output.
+    chebyshev_output<double> cho;
+    REQUIRE(cho.get_dim() == 0u);
+    REQUIRE(cho.get_n_segments() == 0u);
+    REQUIRE_THROWS_AS(cho.get_bounds(), std::invalid_argument);
+    REQUIRE_THROWS_AS(cho(0.), std::invalid_argument);
+
+    cho = chebyshev_output<double>{co};
+    REQUIRE_THROWS_AS(cho(std::numeric_limits<double>::quiet_NaN()), std::invalid_argument);
+    REQUIRE_THROWS_AS(cho.eval_grid({0., std::numeric_limits<double>::infinity()}), std::invalid_argument);
+}
@@ -0,0 +1,123 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <heyoka/collision.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// Build the system of n bodies moving at constant velocity.
+std::vector<std::pair<expression, expression>> make_free_sys(unsigned n)
+{
+    std::vector<std::pair<expression, expression>> retval;
+
+    for (auto i = 0u; i < n; ++i) {
+        const auto si = std::to_string(i);
+
+        for (const std::string c : {"x", "y", "z"}) {
+            retval.push_back(prime(expression{variable{c + si}}) = expression{variable{"v" + c + si}});
+        }
+        for (const std::string c : {"x", "y", "z"}) {
+            retval.push_back(prime(expression{variable{"v" + c + si}}) = 0_dbl);
+        }
+    }
+
+    return retval;
+}
+
+TEST_CASE("collision detector ctor")
+{
+    using Catch::Matchers::Message;
+
+    collision_detector<double> cd({{0, 1, 2}, {6, 7, 8}}, {1., 2.});
+
+    REQUIRE(cd.get_pos_idx() == std::vector<std::array<std::uint32_t, 3>>{{0, 1, 2}, {6, 7, 8}});
+    REQUIRE(cd.get_radii() == std::vector<double>{1., 2.});
+    REQUIRE(cd.get_n_candidates() == 0u);
+
+    REQUIRE_THROWS_MATCHES(collision_detector<double>({{0, 1, 2}}, {1., 2.}), std::invalid_argument,
+                           Message("The number of bodies (1) is inconsistent with the number of radii (2) in the "
+                                   "construction of a collision detector"));
+    REQUIRE_THROWS_AS(collision_detector<double>({{0, 1, 2}}, {-1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(collision_detector<double>({{0, 1, 2}}, {std::numeric_limits<double>::quiet_NaN()}),
+                      std::invalid_argument);
+
+    // Invalid state indices.
+    auto ta = taylor_adaptive<double>{make_free_sys(1), std::vector<double>(6, 0.)};
+    collision_detector<double> cd2({{0, 1, 6}}, {1.});
+    REQUIRE_THROWS_MATCHES(
+        cd2.detect(ta), std::invalid_argument,
+        Message("Invalid index 6 detected in a collision detector for an integrator with 6 state variables"));
+}
+
+TEST_CASE("collision detector basic")
+{
+    // Bodies 0 and 1 move towards each other along the x axis,
+    // body 2 is far away and moves parallel to them.
+    // clang-format off
+    auto ta = taylor_adaptive<double>{make_free_sys(3), {0., 0., 0., 1., 0., 0.,
+                                                         10., 0., 0., -1., 0., 0.,
+                                                         0., 100., 0., 1., 0., 0.}};
+    // clang-format on
+
+    collision_detector<double> cd({{0, 1, 2}, {6, 7, 8}, {12, 13, 14}}, {.5, .5, .5});
+
+    std::vector<std::tuple<std::uint32_t, std::uint32_t, double>> colls;
+
+    while (ta.get_time() < 10) {
+        const auto t0 = ta.get_time();
+
+        ta.step(1., true);
+
+        for (const auto &[i, j, t] : cd.detect(ta)) {
+            colls.emplace_back(i, j, t0 + t);
+        }
+
+        // Body 2 is never a candidate.
+        REQUIRE(cd.get_n_candidates() <= 1u);
+    }
+
+    REQUIRE(colls.size() == 1u);
+    REQUIRE(std::get<0>(colls[0]) == 0u);
+    REQUIRE(std::get<1>(colls[0]) == 1u);
+    REQUIRE(std::get<2>(colls[0]) == approximately(4.5));
+
+    // Backward integration.
+    colls.clear();
+    ta.get_state_data()[0] = 10;
+    ta.get_state_data()[6] = 0;
+    ta.set_time(0);
+
+    while (ta.get_time() > -10) {
+        const auto t0 = ta.get_time();
+
+        ta.step(-1., true);
+
+        for (const auto &[i, j, t] : cd.detect(ta)) {
+            colls.emplace_back(i, j, t0 + t);
+        }
+    }
+
+    REQUIRE(colls.size() == 1u);
+    REQUIRE(std::get<2>(colls[0]) == approximately(-4.5));
+}
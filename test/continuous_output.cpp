@@ -0,0 +1,335 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <initializer_list>
+#include <ios>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("continuous output basic")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                        {fp_t(0.05), fp_t(0.025)},
+                                        kw::opt_level = opt_level,
+                                        kw::high_accuracy = high_accuracy};
+        auto ta_copy = ta;
+
+        // NOTE: use a small chunk size in order
+        // to test the chunked storage.
+        auto co = continuous_output<fp_t>{ta, kw::chunk_size = 3u, kw::high_accuracy = high_accuracy,
+                                          kw::opt_level = opt_level};
+
+        REQUIRE(co.get_dim() == 2u);
+        REQUIRE(co.get_order() == ta.get_order());
+        REQUIRE(co.get_chunk_size() == 3u);
+        REQUIRE(!co.get_compress_tcs());
+        REQUIRE(co.get_n_steps() == 0u);
+
+        const auto oc = std::get<0>(ta.propagate_until(fp_t(10), kw::c_output = co));
+        REQUIRE(oc == taylor_outcome::time_limit);
+
+        REQUIRE(co.get_n_steps() > 3u);
+        REQUIRE(co.get_bounds().first == 0);
+        REQUIRE(co.get_bounds().second == approximately(fp_t(10)));
+
+        // Compare with the dense output computed in propagate_grid(). The time
+        // steps are the same because the final time of the grid is the same.
+        std::vector<fp_t> grid;
+        for (auto i = 0; i < 100; ++i) {
+            grid.push_back(fp_t(i) / 10);
+        }
+        grid.push_back(fp_t(10));
+
+        const auto ref = std::get<4>(ta_copy.propagate_grid(grid));
+
+        for (decltype(grid.size()) i = 0; i < grid.size(); ++i) {
+            const auto &out = co(grid[i]);
+
+            REQUIRE(out.size() == 2u);
+            REQUIRE(out[0] == approximately(ref[2u * i], fp_t(10)));
+            REQUIRE(out[1] == approximately(ref[2u * i + 1u], fp_t(10)));
+            REQUIRE(co.get_output() == out);
+        }
+
+        // Copy semantics.
+        auto co2 = co;
+        REQUIRE(co2.get_n_steps() == co.get_n_steps());
+        REQUIRE(co2(fp_t(3.3)) == co(fp_t(3.3)));
+
+        // Times outside the bounds use the first/last step.
+        using std::isfinite;
+        REQUIRE(isfinite(co(fp_t(-1))[0]));
+        REQUIRE(isfinite(co(fp_t(11))[1]));
+
+        // Backwards propagation after clearing.
+        co.clear();
+        REQUIRE(co.get_n_steps() == 0u);
+        REQUIRE_THROWS_AS(co(fp_t(1)), std::invalid_argument);
+        REQUIRE_THROWS_AS(co.get_bounds(), std::invalid_argument);
+
+        ta.propagate_until(fp_t(0), kw::c_output = co);
+
+        REQUIRE(co.get_n_steps() > 3u);
+        REQUIRE(co.get_bounds().first == approximately(fp_t(10)));
+        REQUIRE(co.get_bounds().second == 0);
+        REQUIRE(co(fp_t(0))[0] == approximately(ta.get_state()[0], fp_t(10)));
+        REQUIRE(co(fp_t(5))[0] == approximately(co2(fp_t(5))[0], fp_t(10000)));
+
+        // Recording steps in the opposite direction.
+        REQUIRE_THROWS_AS(ta.propagate_until(fp_t(1), kw::c_output = co), std::invalid_argument);
+    };
+
+    for (auto ha : {false, true}) {
+        tuple_for_each(fp_types, [&tester, ha](auto x) { tester(x, 0, ha); });
+        tuple_for_each(fp_types, [&tester, ha](auto x) { tester(x, 3, ha); });
+    }
+}
+
+TEST_CASE("continuous output compressed")
+{
+    using std::abs;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta_copy = ta;
+
+    auto co = continuous_output<double>{ta, kw::compress_tcs = true};
+    REQUIRE(co.get_compress_tcs());
+
+    ta.propagate_for(10., kw::c_output = co);
+
+    const auto ref = std::get<4>(ta_copy.propagate_grid({1., 2.5, 7., 10.}));
+
+    const std::vector<double> grid{1., 2.5, 7., 10.};
+    for (std::size_t i = 0; i < grid.size(); ++i) {
+        REQUIRE(abs(co(grid[i])[0] - ref[2u * i]) < 1e-6);
+        REQUIRE(abs(co(grid[i])[1] - ref[2u * i + 1u]) < 1e-6);
+    }
+
+    // Copy semantics.
+    auto co2 = co;
+    REQUIRE(co2(2.5) == co(2.5));
+}
+
+TEST_CASE("continuous output events")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    using t_ev_t = taylor_adaptive<double>::t_event_t;
+
+    // The step leading to a stopping terminal
+    // event must be recorded.
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::t_events = {t_ev_t(v)}};
+
+    auto co = continuous_output<double>{ta};
+
+    const auto oc = std::get<0>(ta.propagate_until(10., kw::c_output = co));
+
+    REQUIRE(oc == taylor_outcome{-1});
+    REQUIRE(co.get_n_steps() > 0u);
+    REQUIRE(co.get_bounds().second == approximately(ta.get_time()));
+    REQUIRE(co(ta.get_time())[0] == approximately(ta.get_state()[0]));
+    REQUIRE(co(ta.get_time())[1] == approximately(ta.get_state()[1]));
+}
+
+TEST_CASE("continuous output errors")
+{
+    auto [x, v, y] = make_vars("x", "v", "y");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    REQUIRE_THROWS_AS((continuous_output<double>{ta, kw::chunk_size = 0u}), std::invalid_argument);
+
+    auto co = continuous_output<double>{ta};
+
+    // Mismatched integrator.
+    auto ta3 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x), prime(y) = x}, {0.05, 0.025, 0.}};
+    REQUIRE_THROWS_AS(ta3.propagate_until(1., kw::c_output = co), std::invalid_argument);
+    REQUIRE(co.get_n_steps() == 0u);
+
+    ta.propagate_until(1., kw::c_output = co);
+    REQUIRE_THROWS_AS(co(std::numeric_limits<double>::infinity()), std::invalid_argument);
+}
+
+TEST_CASE("continuous output sample")
+{
+    using std::abs;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    auto co = continuous_output<double>{ta};
+
+    REQUIRE_THROWS_AS(co.sample(1e-3), std::invalid_argument);
+
+    ta.propagate_until(10., kw::c_output = co);
+
+    REQUIRE_THROWS_AS(co.sample(0.), std::invalid_argument);
+    REQUIRE_THROWS_AS(co.sample(-1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(co.sample(std::numeric_limits<double>::quiet_NaN()), std::invalid_argument);
+
+    for (auto tol : {1e-2, 1e-4, 1e-6}) {
+        const auto [times, states] = co.sample(tol);
+
+        // The bounds of the steps are always included.
+        REQUIRE(times.size() >= co.get_n_steps() + 1u);
+        REQUIRE(states.size() == 2u * times.size());
+        REQUIRE(times.front() == co.get_bounds().first);
+        REQUIRE(times.back() == approximately(co.get_bounds().second));
+
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            if (i > 0u) {
+                REQUIRE(times[i] > times[i - 1u]);
+            }
+
+            REQUIRE(states[2u * i] == approximately(co(times[i])[0], 1000.));
+            REQUIRE(states[2u * i + 1u] == approximately(co(times[i])[1], 1000.));
+        }
+
+        // The linear interpolation between the samples
+        // meets the tolerance on a fine uniform grid.
+        for (std::size_t i = 0; i + 1u < times.size(); ++i) {
+            for (auto k = 1; k < 10; ++k) {
+                const auto w = k / 10.;
+                const auto t = times[i] + (times[i + 1u] - times[i]) * w;
+
+                for (std::size_t j = 0; j < 2u; ++j) {
+                    const auto lin = states[2u * i + j] + (states[2u * (i + 1u) + j] - states[2u * i + j]) * w;
+                    REQUIRE(abs(co(t)[j] - lin) <= 2 * tol);
+                }
+            }
+        }
+    }
+
+    // Looser tolerances produce fewer samples.
+    REQUIRE(co.sample(1e-2).first.size() < co.sample(1e-6).first.size());
+
+    // Compressed coefficients.
+    auto ta2 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto co2 = continuous_output<double>{ta2, kw::compress_tcs = true};
+    ta2.propagate_until(10., kw::c_output = co2);
+
+    const auto [times2, states2] = co2.sample(1e-4);
+    for (std::size_t i = 0; i < times2.size(); ++i) {
+        REQUIRE(abs(states2[2u * i] - co2(times2[i])[0]) < 1e-6);
+    }
+}
+
+TEST_CASE("ephemeris")
+{
+    auto tester = [](auto fp_x, bool compress) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {fp_t(0.05), fp_t(0.025)}};
+
+        auto co = continuous_output<fp_t>{ta, kw::chunk_size = 5u, kw::compress_tcs = compress};
+
+        // Cannot save an empty continuous output.
+        REQUIRE_THROWS_AS(co.save_ephemeris("heyoka_test_ephemeris.bin"), std::invalid_argument);
+
+        ta.propagate_until(fp_t(10), kw::c_output = co);
+
+        const std::string path = "heyoka_test_ephemeris_" + std::to_string(sizeof(fp_t)) + ".bin";
+        co.save_ephemeris(path);
+
+        auto eph = ephemeris<fp_t>{path};
+
+        REQUIRE(eph.get_path() == path);
+        REQUIRE(eph.get_dim() == 2u);
+        REQUIRE(eph.get_order() == co.get_order());
+        REQUIRE(eph.get_n_steps() == co.get_n_steps());
+        REQUIRE(eph.get_bounds() == co.get_bounds());
+
+        // The evaluation must match exactly the continuous output.
+        for (auto i = -5; i < 110; ++i) {
+            const auto t = fp_t(i) / 10;
+
+            REQUIRE(eph(t) == co(t));
+            REQUIRE(eph.get_output() == co.get_output());
+        }
+
+        // Copy semantics.
+        auto eph2 = eph;
+        REQUIRE(eph2(fp_t(4.2)) == eph(fp_t(4.2)));
+
+        // Mismatched floating-point format.
+        if constexpr (std::is_same_v<fp_t, double>) {
+            REQUIRE_THROWS_AS(ephemeris<long double>{path}, std::invalid_argument);
+        } else {
+            REQUIRE_THROWS_AS(ephemeris<double>{path}, std::invalid_argument);
+        }
+
+        REQUIRE_THROWS_AS(eph(std::numeric_limits<fp_t>::quiet_NaN()), std::invalid_argument);
+
+        std::remove(path.c_str());
+    };
+
+    for (auto compress : {false, true}) {
+        tuple_for_each(fp_types, [&tester, compress](auto x) { tester(x, compress); });
+    }
+
+    // Error modes.
+    REQUIRE_THROWS_AS(ephemeris<double>{"heyoka_test_nonexistent_ephemeris.bin"}, std::invalid_argument);
+
+    {
+        std::ofstream ofs("heyoka_test_junk_ephemeris.bin", std::ios_base::out | std::ios_base::binary);
+        ofs << std::string(1000, 'a');
+    }
+    REQUIRE_THROWS_AS(ephemeris<double>{"heyoka_test_junk_ephemeris.bin"}, std::invalid_argument);
+
+    {
+        std::ofstream ofs("heyoka_test_junk_ephemeris.bin", std::ios_base::out | std::ios_base::binary);
+        ofs << "heyoka";
+    }
+    REQUIRE_THROWS_AS(ephemeris<double>{"heyoka_test_junk_ephemeris.bin"}, std::invalid_argument);
+
+    std::remove("heyoka_test_junk_ephemeris.bin");
+}
@@ -0,0 +1,125 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/encke.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("encke ref state")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        using std::abs;
+        using std::sqrt;
+
+        const auto elems = std::vector<fp_t>{fp_t(3) / 2, fp_t(1) / 5, fp_t(1) / 3, 1, 2, 3};
+
+        // Check the vis-viva equation.
+        for (auto t : {fp_t(0), fp_t(1), fp_t(-5), fp_t(100)}) {
+            const auto st = encke_ref_state(elems, fp_t(1), fp_t(0), t);
+            const auto r = sqrt(st[0] * st[0] + st[1] * st[1] + st[2] * st[2]);
+            const auto v2 = st[3] * st[3] + st[4] * st[4] + st[5] * st[5];
+
+            REQUIRE(abs(v2 - (2 / r - 1 / elems[0])) < std::numeric_limits<fp_t>::epsilon() * 1000);
+        }
+
+        // The reference orbit is a solution of the unperturbed Encke system.
+        auto ta = taylor_adaptive<fp_t>{make_encke_sys(elems, fp_t(1), fp_t(0)), std::vector<fp_t>(6u, fp_t(0))};
+        REQUIRE(std::get<0>(ta.propagate_until(fp_t(10))) == taylor_outcome::time_limit);
+        for (auto x : ta.get_state()) {
+            REQUIRE(x == 0);
+        }
+
+        // Error modes.
+        REQUIRE_THROWS_AS(encke_ref_state(std::vector<fp_t>{1, 0}, fp_t(1), fp_t(0), fp_t(0)), std::invalid_argument);
+        REQUIRE_THROWS_AS(encke_ref_state(std::vector<fp_t>{-1, 0, 0, 0, 0, 0}, fp_t(1), fp_t(0), fp_t(0)),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(encke_ref_state(std::vector<fp_t>{1, 1, 0, 0, 0, 0}, fp_t(1), fp_t(0), fp_t(0)),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(encke_ref_state(elems, fp_t(-1), fp_t(0), fp_t(0)), std::invalid_argument);
+        REQUIRE_THROWS_AS(encke_ref_state(elems, fp_t(1), fp_t(0), std::numeric_limits<fp_t>::infinity()),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(make_encke_sys(elems, fp_t(1), std::numeric_limits<fp_t>::quiet_NaN()),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(make_encke_sys(elems, fp_t(1), fp_t(0), {"x"_var}), std::invalid_argument);
+        REQUIRE_THROWS_AS(make_encke_sys(elems, fp_t(1), fp_t(0), {"x"_var, "y"_var, "w"_var}),
+                          std::invalid_argument);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("encke perturbed")
+{
+    using std::abs;
+
+    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+
+    // Small perturbing acceleration, with
+    // a dependency on the velocity.
+    const auto r2 = sum({square(x), square(y), square(z)});
+    const auto eps = 1e-6;
+    const auto pert = std::vector{-eps * x * pow(r2, -2.5), -eps * y * pow(r2, -2.5), eps * (vz - z)};
+
+    const auto elems = std::vector<double>{1.3, 0.1, 0.2, 0.3, 0.4, 0.5};
+    const auto t0 = 1.;
+
+    // The formulation in Cartesian coordinates.
+    const auto mmu_r3 = -pow(r2, -1.5);
+    auto ta = taylor_adaptive<double>{{prime(x) = vx, prime(y) = vy, prime(z) = vz, prime(vx) = mmu_r3 * x + pert[0],
+                                       prime(vy) = mmu_r3 * y + pert[1], prime(vz) = mmu_r3 * z + pert[2]},
+                                      encke_ref_state(elems, 1., t0, t0),
+                                      kw::time = t0};
+
+    auto ta_e = taylor_adaptive<double>{make_encke_sys(elems, 1., t0, pert), std::vector<double>(6u, 0.),
+                                        kw::time = t0};
+
+    const auto n_steps = std::get<3>(ta.propagate_until(50.));
+    const auto n_steps_e = std::get<3>(ta_e.propagate_until(50.));
+
+    // The deviation is resolved with fewer steps.
+    REQUIRE(n_steps_e < n_steps);
+
+    const auto ref = encke_ref_state(elems, 1., t0, 50.);
+    for (auto i = 0u; i < 6u; ++i) {
+        REQUIRE(ta_e.get_state()[i] != 0.);
+        REQUIRE(abs(ref[i] + ta_e.get_state()[i] - ta.get_state()[i]) < 1e-10);
+    }
+}
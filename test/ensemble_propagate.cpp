@@ -0,0 +1,257 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("ensemble propagate until for")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -x}, {0, 1});
+
+        const std::size_t n_iter = 20;
+
+        auto gen = [](taylor_adaptive<fp_t> &cur_ta, std::size_t i) {
+            cur_ta.get_state_data()[1] = fp_t(1) + fp_t(i) / 100;
+        };
+
+        for (auto n_threads : {0u, 1u, 3u}) {
+            auto res = ensemble_propagate_until<fp_t>(ta, fp_t(10), n_iter, gen, kw::n_threads = n_threads);
+
+            REQUIRE(res.states.size() == n_iter * 2u);
+            REQUIRE(res.times.size() == n_iter);
+            REQUIRE(res.outcomes.size() == n_iter);
+            REQUIRE(res.min_hs.size() == n_iter);
+            REQUIRE(res.max_hs.size() == n_iter);
+            REQUIRE(res.n_steps.size() == n_iter);
+
+            // Compare with a serial propagation.
+            for (std::size_t i = 0; i < n_iter; ++i) {
+                auto ta_copy = ta;
+                gen(ta_copy, i);
+                auto oc = std::get<0>(ta_copy.propagate_until(fp_t(10)));
+
+                REQUIRE(res.outcomes[i] == oc);
+                REQUIRE(res.times[i] == fp_t(10));
+                REQUIRE(res.states[i * 2u] == ta_copy.get_state()[0]);
+                REQUIRE(res.states[i * 2u + 1u] == ta_copy.get_state()[1]);
+            }
+
+            // The template integrator must not have been modified.
+            REQUIRE(ta.get_time() == 0);
+            REQUIRE(ta.get_state()[1] == 1);
+
+            res = ensemble_propagate_for<fp_t>(ta, fp_t(10), n_iter, gen, kw::n_threads = n_threads,
+                                               kw::max_steps = 5u);
+
+            for (std::size_t i = 0; i < n_iter; ++i) {
+                REQUIRE(res.outcomes[i] == taylor_outcome::step_limit);
+                REQUIRE(res.n_steps[i] == 5u);
+                REQUIRE(res.times[i] < fp_t(10));
+            }
+        }
+
+        // Empty generator.
+        REQUIRE_THROWS_AS(ensemble_propagate_until<fp_t>(ta, fp_t(10), n_iter, {}), std::invalid_argument);
+
+        // Exceptions thrown by the generator are propagated.
+        REQUIRE_THROWS_AS(ensemble_propagate_until<fp_t>(
+                              ta, fp_t(10), n_iter,
+                              [](taylor_adaptive<fp_t> &, std::size_t i) {
+                                  if (i == 7u) {
+                                      throw std::runtime_error("");
+                                  }
+                              }),
+                          std::runtime_error);
+
+        // Zero iterations.
+        auto res = ensemble_propagate_until<fp_t>(ta, fp_t(10), 0, gen);
+        REQUIRE(res.states.empty());
+        REQUIRE(res.times.empty());
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("ensemble propagate pin threads")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0, 1});
+
+    const std::size_t n_iter = 20;
+
+    auto gen = [](taylor_adaptive<double> &cur_ta, std::size_t i) {
+        cur_ta.get_state_data()[1] = 1 + static_cast<double>(i) / 100;
+    };
+
+    // The thread pinning must not affect the results.
+    for (auto n_threads : {0u, 1u, 3u}) {
+        const auto res = ensemble_propagate_until<double>(ta, 10., n_iter, gen, kw::n_threads = n_threads);
+        const auto res_np = ensemble_propagate_until<double>(ta, 10., n_iter, gen, kw::n_threads = n_threads,
+                                                             kw::pin_threads = false);
+
+        REQUIRE(res.states == res_np.states);
+        REQUIRE(res.times == res_np.times);
+        REQUIRE(res.outcomes == res_np.outcomes);
+        REQUIRE(res.n_steps == res_np.n_steps);
+    }
+
+    auto ta_batch = taylor_adaptive_batch<double>({prime(x) = v, prime(v) = -x}, {0, 0, 1, 1}, 2);
+
+    auto gen_batch = [](std::vector<double> &st, std::vector<double> &, double &, std::size_t i) {
+        st[0] = 0;
+        st[1] = 1 + static_cast<double>(i) / 100;
+    };
+
+    const auto res = ensemble_propagate_until_batch<double>(ta_batch, 10., n_iter, gen_batch, kw::n_threads = 3u);
+    const auto res_np = ensemble_propagate_until_batch<double>(ta_batch, 10., n_iter, gen_batch, kw::n_threads = 3u,
+                                                               kw::pin_threads = false);
+
+    REQUIRE(res.states == res_np.states);
+    REQUIRE(res.outcomes == res_np.outcomes);
+}
+
+TEST_CASE("ensemble propagate grid")
+{
+    auto tester = [](auto fp_x) {
+        using std::isnan;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -x}, {0, 1});
+
+        const std::size_t n_iter = 20;
+        const auto grid = std::vector<fp_t>{0, 1, 2, 3, 4, 5};
+
+        auto gen = [](taylor_adaptive<fp_t> &cur_ta, std::size_t i) {
+            cur_ta.get_state_data()[1] = fp_t(1) + fp_t(i) / 100;
+        };
+
+        auto res = ensemble_propagate_grid<fp_t>(ta, grid, n_iter, gen);
+
+        REQUIRE(res.states.size() == n_iter * grid.size() * 2u);
+
+        for (std::size_t i = 0; i < n_iter; ++i) {
+            auto ta_copy = ta;
+            gen(ta_copy, i);
+            auto out = std::get<4>(ta_copy.propagate_grid(grid));
+
+            REQUIRE(res.outcomes[i] == taylor_outcome::time_limit);
+            REQUIRE(std::equal(out.begin(), out.end(), res.states.begin() + i * grid.size() * 2u));
+        }
+
+        // Early stop: the unreached grid points are filled with NaNs.
+        res = ensemble_propagate_grid<fp_t>(ta, grid, n_iter, gen, kw::max_steps = 1u);
+
+        for (std::size_t i = 0; i < n_iter; ++i) {
+            REQUIRE(res.outcomes[i] == taylor_outcome::step_limit);
+            REQUIRE(isnan(res.states[(i + 1u) * grid.size() * 2u - 1u]));
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("ensemble propagate batch")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -x}, {0, 1});
+        auto ta_batch = taylor_adaptive_batch<fp_t>({prime(x) = v, prime(v) = -x}, std::vector<fp_t>(8u), 4u);
+
+        // NOTE: use an odd number of iterations, so that
+        // some batch elements are idle towards the end, and
+        // heterogeneous initial times, so that the batch elements
+        // are refilled at different points.
+        const std::size_t n_iter = 23;
+
+        auto gen = [](std::vector<fp_t> &st, std::vector<fp_t> &, fp_t &t, std::size_t i) {
+            st[1] = fp_t(1) + fp_t(i) / 100;
+            t = fp_t(i) / 2;
+        };
+
+        for (auto n_threads : {0u, 1u, 3u}) {
+            auto res = ensemble_propagate_until_batch<fp_t>(ta_batch, fp_t(20), n_iter, gen, kw::n_threads = n_threads);
+
+            REQUIRE(res.states.size() == n_iter * 2u);
+
+            for (std::size_t i = 0; i < n_iter; ++i) {
+                ta.set_time(fp_t(i) / 2);
+                ta.get_state_data()[0] = 0;
+                ta.get_state_data()[1] = fp_t(1) + fp_t(i) / 100;
+                ta.propagate_until(fp_t(20));
+
+                REQUIRE(res.outcomes[i] == taylor_outcome::time_limit);
+                REQUIRE(res.times[i] == fp_t(20));
+                REQUIRE(res.states[i * 2u] == approximately(ta.get_state()[0], fp_t(1000)));
+                REQUIRE(res.states[i * 2u + 1u] == approximately(ta.get_state()[1], fp_t(1000)));
+            }
+
+            res = ensemble_propagate_for_batch<fp_t>(ta_batch, fp_t(20), n_iter, gen, kw::n_threads = n_threads,
+                                                     kw::max_steps = 5u);
+
+            for (std::size_t i = 0; i < n_iter; ++i) {
+                REQUIRE(res.outcomes[i] == taylor_outcome::step_limit);
+                REQUIRE(res.n_steps[i] == 5u);
+                REQUIRE(res.times[i] < fp_t(i) / 2 + 20);
+            }
+        }
+
+        // Error handling.
+        REQUIRE_THROWS_AS(ensemble_propagate_until_batch<fp_t>(ta_batch, fp_t(20), n_iter, {}), std::invalid_argument);
+        REQUIRE_THROWS_AS(ensemble_propagate_until_batch<fp_t>(ta_batch, fp_t(20), n_iter, gen, kw::max_delta_t = -1),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(ensemble_propagate_until_batch<fp_t>(
+                              ta_batch, fp_t(20), n_iter,
+                              [](std::vector<fp_t> &st, std::vector<fp_t> &, fp_t &, std::size_t) { st.push_back(0); }),
+                          std::invalid_argument);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
@@ -6,13 +6,20 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cmath>
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <limits>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include <heyoka/detail/string_conv.hpp>
 #include <heyoka/exceptions.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/llvm_state.hpp>
@@ -651,3 +658,370 @@ TEST_CASE("pairwise_prod")
     REQUIRE(pairwise_prod({x0, x1, x2, x3, x4}) == (x0 * x1) * (x2 * x3) * x4);
     REQUIRE(pairwise_prod({x0, x1, x2, x3, x4, x5}) == ((x0 * x1) * (x2 * x3)) * (x4 * x5));
 }
+
+TEST_CASE("copy on write")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    auto ex = sin(x + y) * cos(x - y);
+
+    // Copies share the storage.
+    auto ex2 = ex;
+    const auto &cex = ex;
+    const auto &cex2 = ex2;
+    REQUIRE(std::get<func>(cex.value()).get_ptr() == std::get<func>(cex2.value()).get_ptr());
+    REQUIRE(ex2 == ex);
+
+    // Mutable access detaches the copy.
+    rename_variables(ex2, {{"x", "z"}});
+    REQUIRE(std::get<func>(cex.value()).get_ptr() != std::get<func>(cex2.value()).get_ptr());
+    REQUIRE(ex == sin(x + y) * cos(x - y));
+    REQUIRE(ex2 == sin(z + y) * cos(z - y));
+}
+
+TEST_CASE("intern")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    auto get_arg = [](const expression &e, std::size_t i) -> const expression & {
+        return std::get<func>(e.value()).args()[i];
+    };
+    auto get_ptr = [](const expression &e) { return std::get<func>(e.value()).get_ptr(); };
+
+    // Equal subexpressions built separately
+    // do not share storage.
+    const auto ex = sin(x + y) + cos(x + y);
+    REQUIRE(get_ptr(get_arg(get_arg(ex, 0), 0)) != get_ptr(get_arg(get_arg(ex, 1), 0)));
+
+    const auto iex = intern(ex);
+    REQUIRE(iex == ex);
+    REQUIRE(get_ptr(get_arg(get_arg(iex, 0), 0)) == get_ptr(get_arg(get_arg(iex, 1), 0)));
+
+    // Non-function expressions.
+    REQUIRE(intern(x) == x);
+    REQUIRE(intern(1_dbl) == 1_dbl);
+    REQUIRE(intern(par[0]) == par[0]);
+
+    // Interning multiple expressions.
+    const auto v_iex = intern(std::vector{sin(x + y), cos(x + y), x});
+    REQUIRE(v_iex == std::vector{sin(x + y), cos(x + y), x});
+    REQUIRE(get_ptr(get_arg(v_iex[0], 0)) == get_ptr(get_arg(v_iex[1], 0)));
+
+    // The interned expressions behave like the originals.
+    auto iex2 = iex;
+    rename_variables(iex2, {{"x", "y"}});
+    REQUIRE(iex2 == sin(y + y) + cos(y + y));
+    REQUIRE(iex == sin(x + y) + cos(x + y));
+    REQUIRE(eval_dbl(iex, {{"x", 1.}, {"y", 2.}}) == approximately(std::sin(3.) + std::cos(3.)));
+}
+
+TEST_CASE("subs")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    auto get_arg = [](const expression &e, std::size_t i) -> const expression & {
+        return std::get<func>(e.value()).args()[i];
+    };
+    auto get_ptr = [](const expression &e) { return std::get<func>(e.value()).get_ptr(); };
+
+    REQUIRE(subs(x, {{"x", y}}) == y);
+    REQUIRE(subs(x, {{"y", z}}) == x);
+    REQUIRE(subs(1_dbl, {{"x", y}}) == 1_dbl);
+    REQUIRE(subs(par[0], {{"x", y}}) == par[0]);
+
+    // The replacements are not substituted recursively.
+    REQUIRE(subs(x + y, {{"x", y}, {"y", z}}) == y + z);
+
+    // The subexpressions not depending on the
+    // substituted variables keep their storage.
+    const auto ex = sin(x + y) * cos(z);
+    const auto sex = subs(ex, {{"x", z}});
+    REQUIRE(sex == sin(z + y) * cos(z));
+    REQUIRE(get_ptr(get_arg(sex, 1)) == get_ptr(get_arg(ex, 1)));
+    REQUIRE(get_ptr(subs(ex, {{"t", z}})) == get_ptr(ex));
+
+    // Shared subexpressions remain shared.
+    const auto xy = x * y;
+    const auto v_sex = subs(std::vector{sin(xy), cos(xy), z}, {{"x", 2_dbl * z}});
+    REQUIRE(v_sex == std::vector{sin((2_dbl * z) * y), cos((2_dbl * z) * y), z});
+    REQUIRE(get_ptr(get_arg(v_sex[0], 0)) == get_ptr(get_arg(v_sex[1], 0)));
+    REQUIRE(subs(std::vector<expression>{}, {{"x", y}}).empty());
+
+    // The output behaves like the original.
+    auto sex2 = sex;
+    rename_variables(sex2, {{"z", "x"}});
+    REQUIRE(sex2 == sin(x + y) * cos(x));
+    REQUIRE(sex == sin(z + y) * cos(z));
+    REQUIRE(ex == sin(x + y) * cos(z));
+}
+
+TEST_CASE("diff batch")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // NOTE: the subexpression sin(x * y) is shared.
+    const auto s = sin(x * y);
+    const auto ex = s * cos(s + z) + exp(s) / (x - par[0]) + square(z) * y + 3_dbl;
+
+    const std::unordered_map<std::string, double> in{{"x", .3}, {"y", -1.2}, {"z", 2.1}};
+    const std::vector<double> pars{1.5};
+
+    // The gradient must match the derivatives computed one variable at a time.
+    auto grad = diff(ex, {x, y, z, x});
+    REQUIRE(grad.size() == 4u);
+    REQUIRE(eval_dbl(grad[0], in, pars) == approximately(eval_dbl(diff(ex, "x"), in, pars)));
+    REQUIRE(eval_dbl(grad[1], in, pars) == approximately(eval_dbl(diff(ex, "y"), in, pars)));
+    REQUIRE(eval_dbl(grad[2], in, pars) == approximately(eval_dbl(diff(ex, "z"), in, pars)));
+    REQUIRE(grad[3] == grad[0]);
+
+    // Variables which do not appear in the expression.
+    REQUIRE(diff(ex, std::vector{"w"_var}) == std::vector{0_dbl});
+    REQUIRE(diff(1_dbl, std::vector{x, y}) == std::vector{0_dbl, 0_dbl});
+    REQUIRE(diff(par[0], std::vector{x}) == std::vector{0_dbl});
+    REQUIRE(diff(x, std::vector{x, y}) == std::vector{1_dbl, 0_dbl});
+    REQUIRE(diff(ex, std::vector<expression>{}).empty());
+
+    // Jacobian.
+    const auto jac = diff({ex, x * y, sin(z)}, {x, y, z});
+    REQUIRE(jac.size() == 9u);
+    for (std::size_t i = 0; i < 3u; ++i) {
+        REQUIRE(jac[i] == grad[i]);
+    }
+    REQUIRE(eval_dbl(jac[3], in) == approximately(-1.2));
+    REQUIRE(eval_dbl(jac[4], in) == approximately(.3));
+    REQUIRE(jac[5] == 0_dbl);
+    REQUIRE(jac[6] == 0_dbl);
+    REQUIRE(jac[7] == 0_dbl);
+    REQUIRE(eval_dbl(jac[8], in) == approximately(std::cos(2.1)));
+
+    // Nested expression with many shared subexpressions: the
+    // size of the derivative must not grow exponentially.
+    auto nested = x;
+    for (auto i = 0; i < 10; ++i) {
+        nested = sin(nested) * cos(nested);
+    }
+    const auto d_nested = diff(nested, std::vector{x});
+    REQUIRE(d_nested.size() == 1u);
+    REQUIRE(eval_dbl(d_nested[0], {{"x", .1}}) == approximately(eval_dbl(diff(nested, "x"), {{"x", .1}})));
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES(
+        diff(ex, std::vector{x + y}), std::invalid_argument,
+        Message("Cannot differentiate an expression with respect to the non-variable expression '(x + y)'"));
+}
+
+TEST_CASE("batch node values and gradient")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y] = make_vars("x", "y");
+
+    const std::size_t n_samples = 17;
+
+    std::unordered_map<std::string, std::vector<double>> map;
+    for (std::size_t i = 0; i < n_samples; ++i) {
+        map["x"].push_back(static_cast<double>(i) / 10 + .1);
+        map["y"].push_back(static_cast<double>(i) / 7 - 1.3);
+    }
+    const auto &xs = map["x"];
+    const auto &ys = map["y"];
+
+    // Node values.
+    {
+        const auto ex = x * y + sin(x);
+        const auto conns = compute_connections(ex);
+        const auto vals = compute_node_values_batch_dbl(ex, map, conns);
+
+        // NOTE: the nodes are, in order, +, *, x, y, sin, x.
+        REQUIRE(vals.size() == 6u * n_samples);
+
+        for (std::size_t i = 0; i < n_samples; ++i) {
+            REQUIRE(vals[i] == approximately(xs[i] * ys[i] + std::sin(xs[i])));
+            REQUIRE(vals[n_samples + i] == approximately(xs[i] * ys[i]));
+            REQUIRE(vals[2u * n_samples + i] == xs[i]);
+            REQUIRE(vals[3u * n_samples + i] == ys[i]);
+            REQUIRE(vals[4u * n_samples + i] == approximately(std::sin(xs[i])));
+            REQUIRE(vals[5u * n_samples + i] == xs[i]);
+        }
+
+        // Compare with eval_batch_dbl().
+        std::vector<double> ref(n_samples);
+        eval_batch_dbl(ref, ex, map);
+        for (std::size_t i = 0; i < n_samples; ++i) {
+            REQUIRE(vals[i] == approximately(ref[i]));
+        }
+    }
+
+    // Gradients.
+    {
+        const auto ex = x * y - x / y + square(x) - cos(y) * exp(x) + log(x) * sqrt(x) + pow(x, 2_dbl) + -y + 1_dbl;
+        const auto conns = compute_connections(ex);
+        const auto grad = compute_grad_batch_dbl(ex, map, conns);
+
+        REQUIRE(grad.size() == 2u);
+
+        for (std::size_t i = 0; i < n_samples; ++i) {
+            const auto xv = xs[i], yv = ys[i];
+
+            const auto dx = yv - 1. / yv + 2. * xv - std::cos(yv) * std::exp(xv) + std::sqrt(xv) / xv
+                            + std::log(xv) * .5 / std::sqrt(xv) + 2. * xv;
+            const auto dy = xv + xv / (yv * yv) + std::sin(yv) * std::exp(xv) - 1.;
+
+            REQUIRE(grad.at("x")[i] == approximately(dx, 1000.));
+            REQUIRE(grad.at("y")[i] == approximately(dy, 1000.));
+        }
+
+        // Accumulation into an existing gradient.
+        auto grad2 = grad;
+        update_grad_batch_dbl(grad2, ex, compute_node_values_batch_dbl(ex, map, conns), conns);
+        for (std::size_t i = 0; i < n_samples; ++i) {
+            REQUIRE(grad2.at("x")[i] == approximately(2. * grad.at("x")[i]));
+            REQUIRE(grad2.at("y")[i] == approximately(2. * grad.at("y")[i]));
+        }
+    }
+
+    // Error checking.
+    {
+        const auto ex = x + y;
+
+        REQUIRE_THROWS_AS(compute_node_values_batch_dbl(ex, map, compute_connections(x)), std::invalid_argument);
+        REQUIRE_THROWS_MATCHES(
+            compute_node_values_batch_dbl(ex, {}, compute_connections(ex)), std::invalid_argument,
+            Message("Cannot deduce the number of samples of a batch evaluation from an empty map"));
+
+        auto bad_map = map;
+        bad_map["y"].pop_back();
+        REQUIRE_THROWS_AS(compute_node_values_batch_dbl(ex, bad_map, compute_connections(ex)), std::invalid_argument);
+
+        auto z_map = map;
+        z_map.erase("y");
+        REQUIRE_THROWS_AS(compute_node_values_batch_dbl(ex, z_map, compute_connections(ex)), std::invalid_argument);
+
+        REQUIRE_THROWS_AS(compute_node_values_batch_dbl(x + par[0], map, compute_connections(x + par[0])),
+                          not_implemented_error);
+
+        std::unordered_map<std::string, std::vector<double>> empty_grad;
+        REQUIRE_THROWS_AS(update_grad_batch_dbl(empty_grad, ex, std::vector<double>(5), compute_connections(ex)),
+                          std::invalid_argument);
+    }
+}
+
+TEST_CASE("csr connections")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    const auto ex = x * y - x / y + square(x) - cos(y) * exp(x) + log(x) * sqrt(x) + pow(x, 2_dbl) + -y + 1_dbl;
+
+    // The CSR layout matches compute_connections().
+    const auto conns = compute_connections(ex);
+    const auto csr = compute_connections_csr(ex);
+    REQUIRE(csr.offsets.size() == conns.size() + 1u);
+    for (std::size_t k = 0; k < conns.size(); ++k) {
+        REQUIRE(std::vector<std::size_t>(csr.indices.begin() + static_cast<std::ptrdiff_t>(csr.offsets[k]),
+                                         csr.indices.begin() + static_cast<std::ptrdiff_t>(csr.offsets[k + 1u]))
+                == conns[k]);
+    }
+
+    // Scalar node values and gradient.
+    const std::unordered_map<std::string, double> point{{"x", .3}, {"y", -1.7}};
+    const auto vals = compute_node_values_dbl(ex, point, csr);
+    const auto vals_ref = compute_node_values_dbl(ex, point, conns);
+    REQUIRE(vals.size() == vals_ref.size());
+    for (std::size_t k = 0; k < vals.size(); ++k) {
+        REQUIRE(vals[k] == approximately(vals_ref[k]));
+    }
+
+    const auto grad = compute_grad_dbl(ex, point, csr);
+    const auto grad_ref = compute_grad_dbl(ex, point, conns);
+    REQUIRE(grad.size() == 2u);
+    REQUIRE(grad.at("x") == approximately(grad_ref.at("x")));
+    REQUIRE(grad.at("y") == approximately(grad_ref.at("y")));
+
+    // Batch node values and gradient.
+    std::unordered_map<std::string, std::vector<double>> map;
+    for (std::size_t i = 0; i < 11u; ++i) {
+        map["x"].push_back(static_cast<double>(i) / 10 + .1);
+        map["y"].push_back(static_cast<double>(i) / 7 - 1.3);
+    }
+
+    REQUIRE(compute_node_values_batch_dbl(ex, map, csr) == compute_node_values_batch_dbl(ex, map, conns));
+    const auto bgrad = compute_grad_batch_dbl(ex, map, csr);
+    const auto bgrad_ref = compute_grad_batch_dbl(ex, map, conns);
+    REQUIRE(bgrad == bgrad_ref);
+
+    auto bgrad2 = bgrad;
+    update_grad_batch_dbl(bgrad2, ex, compute_node_values_batch_dbl(ex, map, csr), csr);
+    for (std::size_t i = 0; i < 11u; ++i) {
+        REQUIRE(bgrad2.at("x")[i] == approximately(2. * bgrad.at("x")[i]));
+    }
+
+    // Leaf expression.
+    const auto x_csr = compute_connections_csr(x);
+    REQUIRE(x_csr.offsets == std::vector<std::size_t>{0, 0});
+    REQUIRE(x_csr.indices.empty());
+    REQUIRE(compute_node_values_dbl(x, point, x_csr) == std::vector{.3});
+
+    // Error checking.
+    REQUIRE_THROWS_AS(compute_node_values_dbl(ex, point, x_csr), std::invalid_argument);
+    REQUIRE_THROWS_AS(compute_node_values_dbl(x, point, connections_csr{}), std::invalid_argument);
+    REQUIRE_THROWS_AS(compute_node_values_dbl(x, point, connections_csr{{0, 1}, {}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(compute_node_values_dbl(x + y, {{"x", 1.}}, compute_connections_csr(x + y)),
+                      std::invalid_argument);
+}
+
+TEST_CASE("variable interning")
+{
+    // Variables with the same name share
+    // the entry in the symbol table.
+    variable x{"x"}, x2{std::string("x")}, y{"y"};
+
+    REQUIRE(x.get_entry() == x2.get_entry());
+    REQUIRE(x.get_entry() != y.get_entry());
+    REQUIRE(x == x2);
+    REQUIRE(x != y);
+    REQUIRE(hash(x) == hash(x2));
+    REQUIRE(hash(x) == std::hash<std::string>{}("x"));
+    REQUIRE(x.name() == "x");
+
+    // Copies, moves and swaps.
+    auto x3 = x;
+    REQUIRE(x3.get_entry() == x.get_entry());
+    auto y2 = std::move(y);
+    REQUIRE(y2.name() == "y");
+    swap(x3, y2);
+    REQUIRE(x3.name() == "y");
+    REQUIRE(y2.name() == "x");
+
+    // Renaming.
+    rename_variables(x3, {{"y", "z"}});
+    REQUIRE(x3 == variable{"z"});
+    rename_variables(x3, {{"y", "x"}});
+    REQUIRE(x3 == variable{"z"});
+
+    // The indices of the u variables.
+    REQUIRE(detail::uname_to_index(variable{"u_0"}) == 0u);
+    REQUIRE(detail::uname_to_index(variable{"u_123"}) == 123u);
+
+    // Concurrent interning.
+    std::vector<std::vector<variable>> vars(4);
+    std::vector<std::thread> threads;
+    for (auto &v : vars) {
+        threads.emplace_back([&v]() {
+            for (auto i = 0; i < 100; ++i) {
+                v.emplace_back("v_" + std::to_string(i));
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (const auto &v : vars) {
+        for (auto i = 0u; i < 100u; ++i) {
+            REQUIRE(v[i].get_entry() == vars[0][i].get_entry());
+            REQUIRE(v[i].name() == "v_" + std::to_string(i));
+        }
+    }
+}
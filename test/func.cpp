@@ -561,6 +561,39 @@ TEST_CASE("func hash")
     REQUIRE_NOTHROW(hash(f1));
 
     std::cout << "Hash value for f1: " << hash(f1) << '\n';
+
+    // The hash value is cached: check that it is
+    // preserved by copy/move and that it is recomputed
+    // after the arguments are modified.
+    const auto h1 = hash(f1);
+    REQUIRE(hash(f1) == h1);
+
+    auto f2 = f1;
+    REQUIRE(hash(f2) == h1);
+
+    auto f3 = std::move(f2);
+    REQUIRE(hash(f3) == h1);
+    REQUIRE(f3 == f1);
+
+    rename_variables(f3, {{"x", "z"}});
+    REQUIRE(hash(f3) == hash(func(func_10{{"z"_var, "y"_var}})));
+    REQUIRE(f3 != f1);
+    REQUIRE(hash(f1) == h1);
+
+    f2 = f1;
+    REQUIRE(hash(f2) == h1);
+    REQUIRE(f2 == f1);
+
+    // The cache is shared among the copies, and it
+    // is not affected by the mutation of a copy.
+    auto f4 = func(func_10{{"x"_var, "z"_var}});
+    auto f5 = f4;
+    const auto h4 = hash(f5);
+    REQUIRE(hash(f4) == h4);
+    rename_variables(f5, {{"z", "y"}});
+    REQUIRE(hash(f5) == h1);
+    REQUIRE(hash(f4) == h4);
+    REQUIRE(f4 == func(func_10{{"x"_var, "z"_var}}));
 }
 
 struct func_14 : func_base {
@@ -6,8 +6,20 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <heyoka/bytecode.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/gp.hpp>
 #include <heyoka/math.hpp>
@@ -15,9 +27,11 @@
 #include <heyoka/variable.hpp>
 
 #include "catch.hpp"
+#include "test_utils.hpp"
 
 using namespace heyoka;
 using namespace Catch::literals;
+using namespace heyoka_test;
 
 #include <iostream>
 
@@ -166,3 +180,344 @@ TEST_CASE("mutations")
 }
 
 #endif
+
+TEST_CASE("population evaluator")
+{
+    using Catch::Matchers::Message;
+
+    splitmix64 engine(123456789ul);
+    expression_generator generator({"x", "y"}, engine);
+
+    std::vector<expression> pop;
+    for (auto i = 0; i < 20; ++i) {
+        pop.push_back(generator(2, 4));
+    }
+    pop.push_back(1_dbl);
+    pop.push_back(par[0] * "x"_var);
+
+    // NOTE: use a number of points which is not
+    // a multiple of the batch sizes.
+    const std::size_t n_points = 23;
+
+    std::unordered_map<std::string, std::vector<double>> in_map;
+    std::vector<double> in(2u * n_points);
+    for (std::size_t i = 0; i < n_points; ++i) {
+        in[i] = static_cast<double>(i) / 10 + .1;
+        in[n_points + i] = static_cast<double>(i) / 7 - 1.3;
+    }
+    in_map["x"] = std::vector<double>(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(n_points));
+    in_map["y"] = std::vector<double>(in.begin() + static_cast<std::ptrdiff_t>(n_points), in.end());
+
+    const std::vector<double> pars{1.5};
+
+    for (auto batch_size : {0u, 1u, 4u}) {
+        for (auto n_threads : {1u, 0u}) {
+            population_evaluator pe(pop, {"x", "y"}, kw::batch_size = batch_size, kw::opt_level = 1u);
+
+            REQUIRE(pe.get_population() == pop);
+            REQUIRE(pe.get_vars() == std::vector<std::string>{"x", "y"});
+            REQUIRE(pe.get_n_pars() == 1u);
+            REQUIRE(pe.get_batch_size() > 0u);
+
+            // Check also a copy.
+            auto pe_copy = pe;
+
+            const auto out = pe(in, n_points, pars, n_threads);
+            const auto out_copy = pe_copy(in, n_points, pars, n_threads);
+            REQUIRE(out.size() == pop.size() * n_points);
+            REQUIRE(out == out_copy);
+
+            for (decltype(pop.size()) j = 0; j < pop.size(); ++j) {
+                std::vector<double> ref(n_points);
+                eval_batch_dbl(ref, pop[j], in_map, pars);
+
+                for (std::size_t i = 0; i < n_points; ++i) {
+                    if (std::isfinite(ref[i])) {
+                        REQUIRE(out[j * n_points + i] == approximately(ref[i], 1000.));
+                    }
+                }
+            }
+        }
+    }
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(population_evaluator({}, {"x"}), std::invalid_argument,
+                           Message("Cannot create a population evaluator with an empty population"));
+    REQUIRE_THROWS_AS(population_evaluator({"z"_var}, {"x", "y"}), std::invalid_argument);
+
+    population_evaluator pe(pop, {"x", "y"});
+    REQUIRE_THROWS_AS(pe(std::vector<double>(3), n_points), std::invalid_argument);
+    REQUIRE_THROWS_AS(pe(in, n_points), std::invalid_argument);
+
+    // Duplicate individuals.
+    auto pop_dup = pop;
+    pop_dup.push_back(pop[3]);
+    pop_dup.push_back(pop[0]);
+    pop_dup.push_back(pop[3]);
+
+    population_evaluator pe_dup(pop_dup, {"x", "y"});
+    REQUIRE(pe_dup.get_population() == pop_dup);
+    REQUIRE(pe_dup.get_n_unique() == population_evaluator(pop, {"x", "y"}).get_n_unique());
+    REQUIRE(pe_dup.get_n_unique() <= pop.size());
+
+    const auto out_dup = pe_dup(in, n_points, pars);
+    const auto out_ref = population_evaluator(pop, {"x", "y"})(in, n_points, pars);
+    REQUIRE(out_dup.size() == pop_dup.size() * n_points);
+
+    std::vector<std::size_t> ref_idx(pop.size());
+    std::iota(ref_idx.begin(), ref_idx.end(), std::size_t(0));
+    ref_idx.insert(ref_idx.end(), {3u, 0u, 3u});
+    for (decltype(pop_dup.size()) j = 0; j < pop_dup.size(); ++j) {
+        for (std::size_t i = 0; i < n_points; ++i) {
+            const auto a = out_dup[j * n_points + i], b = out_ref[ref_idx[j] * n_points + i];
+            REQUIRE((a == b || (std::isnan(a) && std::isnan(b))));
+        }
+    }
+
+    auto pe_dup_copy = pe_dup;
+    REQUIRE(pe_dup_copy.get_n_unique() == pe_dup.get_n_unique());
+}
+
+TEST_CASE("gp_individual")
+{
+    using Catch::Matchers::Message;
+
+    // NOTE: the two generators produce the same sequence of expressions.
+    splitmix64 engine(123456789ul), engine_ref(123456789ul), engine_sel(42ul);
+    expression_generator generator({"x", "y"}, engine), generator_ref({"x", "y"}, engine_ref);
+
+    // Check the index of ind against a full traversal of the tree.
+    auto check_index = [](const gp_individual &ind) {
+        auto ex = ind.get_expression();
+
+        REQUIRE(ind.size() == count_nodes(ex));
+
+        for (std::size_t i = 0; i < ind.size(); ++i) {
+            REQUIRE(ind.get_node(i) == *fetch_from_node_id(ex, i));
+            REQUIRE(ind.get_subtree_size(i) == count_nodes(ind.get_node(i)));
+        }
+    };
+
+    std::vector<gp_individual> pop;
+    std::vector<expression> pop_ref;
+    for (auto i = 0; i < 10; ++i) {
+        pop.emplace_back(generator(2, 4));
+        pop_ref.push_back(generator_ref(2, 4));
+
+        // NOTE: compute the hashes, so that
+        // they are cached in the functions.
+        REQUIRE(std::hash<expression>{}(pop.back().get_expression()) == std::hash<expression>{}(pop_ref.back()));
+        check_index(pop.back());
+    }
+
+    for (auto n = 0; n < 200; ++n) {
+        std::uniform_int_distribution<std::size_t> ind_dist(0, pop.size() - 1u);
+        const auto i = ind_dist(engine_sel);
+        auto j = ind_dist(engine_sel);
+        if (j == i) {
+            j = (i + 1u) % pop.size();
+        }
+
+        std::uniform_int_distribution<std::size_t> node_dist_i(0, pop[i].size() - 1u),
+            node_dist_j(0, pop[j].size() - 1u);
+        const auto node_i = node_dist_i(engine_sel), node_j = node_dist_j(engine_sel);
+
+        // Keep a copy of the expression, which will share
+        // its nodes with the individual.
+        const auto ex_copy = pop[i].get_expression();
+        const auto ex_copy_ref = pop_ref[i];
+
+        if (n % 2 == 0) {
+            mutate(pop[i], node_i, generator, 0, 3);
+            mutate(pop_ref[i], node_i, generator_ref, 0, 3);
+        } else {
+            crossover(pop[i], pop[j], node_i, node_j);
+            crossover(pop_ref[i], pop_ref[j], node_i, node_j);
+        }
+
+        REQUIRE(pop[i].get_expression() == pop_ref[i]);
+        REQUIRE(pop[j].get_expression() == pop_ref[j]);
+        REQUIRE(std::hash<expression>{}(pop[i].get_expression()) == std::hash<expression>{}(pop_ref[i]));
+        check_index(pop[i]);
+        check_index(pop[j]);
+
+        // The copy must not have been altered.
+        REQUIRE(ex_copy == ex_copy_ref);
+    }
+
+    // Copy and move semantics.
+    auto ind_copy = pop[0];
+    REQUIRE(ind_copy.get_expression() == pop[0].get_expression());
+    check_index(ind_copy);
+    mutate(ind_copy, generator, engine_sel, 2, 4);
+    check_index(ind_copy);
+    check_index(pop[0]);
+    auto ind_move = std::move(ind_copy);
+    check_index(ind_move);
+    crossover(ind_move, pop[1], engine_sel);
+    check_index(ind_move);
+    check_index(pop[1]);
+
+    // Error checking.
+    REQUIRE_THROWS_AS(pop[0].get_node(pop[0].size()), std::invalid_argument);
+    REQUIRE_THROWS_AS(mutate(pop[0], pop[0].size(), generator, 0, 3), std::invalid_argument);
+    REQUIRE_THROWS_AS(crossover(pop[0], pop[1], 0, pop[1].size()), std::invalid_argument);
+    REQUIRE_THROWS_MATCHES(crossover(pop[0], pop[0], 0, 0), std::invalid_argument,
+                           Message("A crossover cannot be performed between an individual and itself"));
+}
+
+TEST_CASE("splitmix64 jump")
+{
+    splitmix64 a(42ul), b(42ul);
+
+    for (auto i = 0; i < 100; ++i) {
+        a.next();
+    }
+    b.jump(100);
+
+    REQUIRE(a.m_state == b.m_state);
+    REQUIRE(a.next() == b.next());
+}
+
+TEST_CASE("gp_evolve")
+{
+    using Catch::Matchers::Message;
+
+    splitmix64 engine(123456789ul);
+    expression_generator generator({"x"}, engine);
+
+    // Fitness: mean squared error with respect to x**2 + x on a grid.
+    const std::size_t n_points = 20;
+    std::vector<double> xs, target;
+    for (std::size_t i = 0; i < n_points; ++i) {
+        xs.push_back(static_cast<double>(i) / 10 - 1);
+        target.push_back(xs.back() * xs.back() + xs.back());
+    }
+
+    const gp_fitness_t fitness = [&](const expression &ex) {
+        const auto out = bytecode{ex, {"x"}}(xs, n_points);
+
+        double retval = 0;
+        for (std::size_t i = 0; i < n_points; ++i) {
+            retval += (out[i] - target[i]) * (out[i] - target[i]);
+        }
+
+        return retval / static_cast<double>(n_points);
+    };
+
+    std::vector<expression> pop;
+    for (auto i = 0; i < 40; ++i) {
+        pop.push_back(generator(1, 3));
+    }
+
+    auto best_fit = [](const gp_evolve_res &res) {
+        return *std::min_element(res.fitness.begin(), res.fitness.end(), [](double a, double b) {
+            return !std::isnan(a) && (std::isnan(b) || a < b);
+        });
+    };
+
+    const auto res0 = gp_evolve(pop, generator, fitness, 0);
+    REQUIRE(res0.pop == pop);
+
+    // The results do not depend on the number of threads.
+    const auto res1 = gp_evolve(pop, generator, fitness, 10, kw::seed = 42u, kw::n_threads = 1u);
+    const auto res2 = gp_evolve(pop, generator, fitness, 10, kw::seed = 42u);
+    REQUIRE(res1.pop.size() == pop.size());
+    REQUIRE(res1.fitness.size() == pop.size());
+    REQUIRE(res1.pop == res2.pop);
+
+    for (std::size_t i = 0; i < pop.size(); ++i) {
+        REQUIRE((res1.fitness[i] == res2.fitness[i] || (std::isnan(res1.fitness[i]) && std::isnan(res2.fitness[i]))));
+    }
+
+    // Elitism ensures that the best fitness does not get worse.
+    REQUIRE(!(best_fit(res0) < best_fit(res1)));
+
+    // A different seed.
+    const auto res3 = gp_evolve(pop, generator, fitness, 10, kw::seed = 43u, kw::tournament_size = 2u,
+                                kw::crossover_prob = 0.9, kw::n_elites = 2u, kw::mut_min_depth = 1u,
+                                kw::mut_max_depth = 2u);
+    REQUIRE(res3.pop != res1.pop);
+    REQUIRE(!(best_fit(res0) < best_fit(res3)));
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(gp_evolve({}, generator, fitness, 1), std::invalid_argument,
+                           Message("Cannot evolve an empty population"));
+    REQUIRE_THROWS_MATCHES(gp_evolve(pop, generator, gp_fitness_t{}, 1), std::invalid_argument,
+                           Message("Cannot evolve a population with an empty fitness function"));
+    REQUIRE_THROWS_AS(gp_evolve(pop, generator, fitness, 1, kw::tournament_size = 0u), std::invalid_argument);
+    REQUIRE_THROWS_AS(gp_evolve(pop, generator, fitness, 1, kw::crossover_prob = 1.5), std::invalid_argument);
+    REQUIRE_THROWS_AS(gp_evolve(pop, generator, fitness, 1, kw::n_elites = 41u), std::invalid_argument);
+    REQUIRE_THROWS_AS(gp_evolve(pop, generator, fitness, 1, kw::mut_min_depth = 3u, kw::mut_max_depth = 2u),
+                      std::invalid_argument);
+
+    // The fitness cache does not alter the results.
+    std::atomic<std::size_t> n_evals(0);
+    const gp_fitness_t counting_fitness = [&](const expression &ex) {
+        ++n_evals;
+        return fitness(ex);
+    };
+
+    gp_fitness_cache cache(1000);
+    const auto res4 = gp_evolve(pop, generator, counting_fitness, 10, kw::seed = 42u, kw::fitness_cache = &cache);
+    REQUIRE(res4.pop == res1.pop);
+    for (std::size_t i = 0; i < pop.size(); ++i) {
+        REQUIRE((res4.fitness[i] == res1.fitness[i] || (std::isnan(res4.fitness[i]) && std::isnan(res1.fitness[i]))));
+    }
+
+    // Each evaluation corresponds to a cache miss (concurrent
+    // misses on the same individual can evaluate it more than once).
+    REQUIRE(cache.get_n_misses() == n_evals.load());
+    REQUIRE(cache.get_n_hits() + cache.get_n_misses() == pop.size() + 10u * (pop.size() - 1u));
+    REQUIRE(cache.size() <= n_evals.load());
+
+    // A second run with the same cache reuses all the values.
+    const auto n_evals_prev = n_evals.load();
+    gp_evolve(pop, generator, counting_fitness, 10, kw::seed = 42u, kw::fitness_cache = &cache);
+    REQUIRE(n_evals.load() == n_evals_prev);
+}
+
+TEST_CASE("gp_fitness_cache")
+{
+    using Catch::Matchers::Message;
+
+    REQUIRE_THROWS_MATCHES(gp_fitness_cache(0), std::invalid_argument,
+                           Message("The maximum size of a fitness cache cannot be zero"));
+
+    auto x = "x"_var, y = "y"_var;
+
+    std::size_t n_evals = 0;
+    const gp_fitness_t fitness = [&n_evals](const expression &) { return static_cast<double>(n_evals++); };
+
+    gp_fitness_cache cache(2);
+    REQUIRE(cache.get_max_size() == 2u);
+    REQUIRE(cache.size() == 0u);
+    REQUIRE(!cache.lookup(x));
+
+    REQUIRE(cache(x + y, fitness) == 0.);
+    // Structurally identical expressions hit the cache.
+    REQUIRE(cache(x + y, fitness) == 0.);
+    REQUIRE(n_evals == 1u);
+    REQUIRE(cache(x * y, fitness) == 1.);
+    REQUIRE(cache.size() == 2u);
+
+    // The oldest entry is evicted first.
+    REQUIRE(cache(x - y, fitness) == 2.);
+    REQUIRE(cache.size() == 2u);
+    REQUIRE(!cache.lookup(x + y));
+    REQUIRE(cache.lookup(x * y) == 1.);
+    REQUIRE(cache.lookup(x - y) == 2.);
+
+    // Inserting an existing key has no effects.
+    cache.insert(x - y, 42.);
+    REQUIRE(cache.lookup(x - y) == 2.);
+
+    REQUIRE(cache.get_n_hits() == 4u);
+    REQUIRE(cache.get_n_misses() == 5u);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0u);
+    REQUIRE(cache.get_n_hits() == 0u);
+    REQUIRE(cache.get_n_misses() == 0u);
+    REQUIRE(cache(x + y, fitness) == 3.);
+}
@@ -9,8 +9,11 @@
 #include <heyoka/config.hpp>
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <sstream>
+#include <tuple>
 #include <variant>
 #include <vector>
 
@@ -23,6 +26,7 @@
 
 #endif
 
+#include <heyoka/cfunc.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/func.hpp>
 #include <heyoka/llvm_state.hpp>
@@ -52,6 +56,13 @@ using fmt::literals::operator""_format;
 using namespace heyoka;
 using namespace heyoka_test;
 
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
 TEST_CASE("kepE def ctor")
 {
     detail::kepE_impl k;
@@ -215,3 +226,51 @@ TEST_CASE("kepE stark")
     REQUIRE(sin(ta.get_state()[3]) == approximately(sin(f_E - sqrt(1 - f_G * f_G / (f_L * f_L)) * sin(f_E)), 10000.));
     REQUIRE(cos(ta.get_state()[3]) == approximately(cos(f_E - sqrt(1 - f_G * f_G / (f_L * f_L)) * sin(f_E)), 10000.));
 }
+
+// Bulk evaluation of kepE via a compiled function.
+TEST_CASE("kepE cfunc")
+{
+    auto tester = [](auto fp_x, unsigned opt_level) {
+        using fp_t = decltype(fp_x);
+
+        using std::abs;
+        using std::cos;
+        using std::sin;
+
+        auto [e, M] = make_vars("e", "M");
+
+        // NOTE: include high eccentricities, negative mean anomalies
+        // and mean anomalies larger than 2*pi.
+        const std::size_t n_points = 103;
+
+        std::vector<fp_t> in(2u * n_points);
+        for (std::size_t i = 0; i < n_points; ++i) {
+            in[i] = fp_t(i % 100u) / 100;
+            in[n_points + i] = fp_t(i) / 5 - 10;
+        }
+
+        // Compute the reference values with the scalar solver.
+        auto cf_scalar = cfunc<fp_t>{{kepE(e, M)}, kw::batch_size = 1u, kw::opt_level = opt_level};
+        const auto ref = cf_scalar(in, n_points);
+
+        for (std::size_t i = 0; i < n_points; ++i) {
+            const auto E = ref[i];
+
+            // Check the Kepler equation (modulo 2*pi).
+            const auto tol = std::numeric_limits<fp_t>::epsilon() * 1000;
+            REQUIRE(abs(cos(E - in[i] * sin(E)) - cos(in[n_points + i])) <= tol);
+            REQUIRE(abs(sin(E - in[i] * sin(E)) - sin(in[n_points + i])) <= tol);
+        }
+
+        // The batch results must be identical to the scalar ones.
+        for (auto batch_size : {0u, 2u, 4u, 5u}) {
+            auto cf = cfunc<fp_t>{{kepE(e, M)}, kw::batch_size = batch_size, kw::opt_level = opt_level};
+
+            REQUIRE(cf(in, n_points) == ref);
+        }
+    };
+
+    for (auto opt_level : {0u, 3u}) {
+        tuple_for_each(fp_types, [&tester, opt_level](auto x) { tester(x, opt_level); });
+    }
+}
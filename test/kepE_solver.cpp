@@ -0,0 +1,72 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <heyoka/kepE_solver.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("kepE solver")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> e_dist(0., .99), M_dist(-10., 10.);
+
+    // NOTE: use a number of pairs which is not
+    // a multiple of the batch sizes.
+    const std::size_t n = 1001;
+
+    std::vector<double> ecc(n), M(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        ecc[i] = e_dist(rng);
+        M[i] = M_dist(rng);
+    }
+
+    for (auto batch_size : {0u, 1u, 2u, 4u}) {
+        const kepE_solver<double> ks{kw::batch_size = batch_size};
+
+        REQUIRE(ks.get_batch_size() > 0u);
+        if (batch_size != 0u) {
+            REQUIRE(ks.get_batch_size() == batch_size);
+        }
+
+        // Invalid inputs.
+        REQUIRE_THROWS_AS(ks(ecc, std::vector<double>{1.}), std::invalid_argument);
+        REQUIRE_THROWS_AS(ks(nullptr, ecc.data(), M.data(), n), std::invalid_argument);
+        REQUIRE(ks(std::vector<double>{}, std::vector<double>{}).empty());
+
+        for (auto n_threads : {1u, 0u, 3u}) {
+            const auto E = ks(ecc, M, n_threads);
+
+            REQUIRE(E.size() == n);
+            for (std::size_t i = 0; i < n; ++i) {
+                // NOTE: the mean anomaly is reduced to the [0, 2*pi) range.
+                const auto diff = E[i] - ecc[i] * std::sin(E[i]) - M[i];
+                REQUIRE(std::abs(std::sin(diff)) < 1E-12);
+                REQUIRE(std::cos(diff) > 0.);
+            }
+        }
+
+        // Copy semantics.
+        auto ks2 = ks;
+        REQUIRE(ks2(ecc, M) == ks(ecc, M));
+    }
+
+    // Default construction and other types.
+    REQUIRE(kepE_solver<double>{}(std::vector{0.}, std::vector{1.})[0] == approximately(1.));
+    REQUIRE(kepE_solver<long double>{}(std::vector{0.l}, std::vector{1.l})[0] == approximately(1.l));
+}
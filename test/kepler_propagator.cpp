@@ -0,0 +1,288 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kepler_propagator.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// The two-body problem, for the comparison
+// with a Taylor integrator.
+template <typename T>
+auto make_tbp(T mu)
+{
+    auto [x, y, z, vx, vy, vz] = make_vars("x", "y", "z", "vx", "vy", "vz");
+
+    const auto r_m3 = pow(x * x + y * y + z * z, T(-3) / 2);
+
+    return std::vector{prime(x) = vx,
+                       prime(y) = vy,
+                       prime(z) = vz,
+                       prime(vx) = -expression{number{mu}} * x * r_m3,
+                       prime(vy) = -expression{number{mu}} * y * r_m3,
+                       prime(vz) = -expression{number{mu}} * z * r_m3};
+}
+
+TEST_CASE("kepler scalar")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+        using std::atan;
+        using std::cos;
+        using std::sin;
+
+        const auto mu = fp_t(1.5);
+
+        // Elliptic and hyperbolic orbits, the last one
+        // being close to parabolic.
+        for (const auto &init : {std::vector<fp_t>{1, 0, 0, 0, fp_t(1.1), fp_t(0.1)},
+                                 std::vector<fp_t>{fp_t(0.5), fp_t(0.3), fp_t(0.1), fp_t(-0.2), fp_t(0.9), fp_t(0.4)},
+                                 std::vector<fp_t>{1, 0, 0, 0, fp_t(2.5), fp_t(-0.3)},
+                                 std::vector<fp_t>{1, 0, 0, 0, fp_t(1.7320508075688772), 0}}) {
+            auto kp = kepler_propagator<fp_t>(init, mu, kw::time = fp_t(1));
+            auto ta = taylor_adaptive<fp_t>(make_tbp(mu), init, kw::time = fp_t(1));
+
+            REQUIRE(kp.get_dim() == 6u);
+            REQUIRE(kp.get_mu() == mu);
+            REQUIRE(kp.get_time() == 1);
+
+            REQUIRE(kp.propagate_until(fp_t(4)) == taylor_outcome::time_limit);
+            ta.propagate_until(fp_t(4));
+
+            REQUIRE(kp.get_time() == 4);
+            for (auto i = 0u; i < 6u; ++i) {
+                REQUIRE(kp.get_state()[i] == approximately(ta.get_state()[i], fp_t(10000)));
+            }
+
+            // Backward propagation.
+            REQUIRE(kp.propagate_for(fp_t(-2.5)) == taylor_outcome::time_limit);
+            ta.propagate_for(fp_t(-2.5));
+
+            REQUIRE(kp.get_time() == fp_t(1.5));
+            for (auto i = 0u; i < 6u; ++i) {
+                REQUIRE(kp.get_state()[i] == approximately(ta.get_state()[i], fp_t(10000)));
+            }
+
+            // Dense output.
+            ta.propagate_for(fp_t(1), kw::write_tc = true);
+            const auto d_out = kp.update_d_output(fp_t(0.75), true);
+            REQUIRE(kp.get_d_output() == d_out);
+            REQUIRE(kp.get_time() == fp_t(1.5));
+
+            ta.update_d_output(fp_t(2.25));
+            for (auto i = 0u; i < 6u; ++i) {
+                REQUIRE(d_out[i] == approximately(ta.get_d_output()[i], fp_t(10000)));
+            }
+            REQUIRE(kp.update_d_output(fp_t(2.25)) == d_out);
+        }
+
+        // Many revolutions of a circular orbit.
+        auto kp = kepler_propagator<fp_t>({1, 0, 0, 0, 1, 0}, fp_t(1));
+        const auto two_pi = 8 * atan(fp_t(1));
+        kp.propagate_until(1000 * two_pi + fp_t(0.5));
+        REQUIRE(kp.get_state()[0] == approximately(cos(fp_t(0.5)), fp_t(100000)));
+        REQUIRE(kp.get_state()[1] == approximately(sin(fp_t(0.5)), fp_t(100000)));
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("kepler scalar grid")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        const auto mu = fp_t(1.5);
+        const std::vector<fp_t> init{1, 0, 0, 0, fp_t(1.1), fp_t(0.1)};
+
+        auto kp = kepler_propagator<fp_t>(init, mu);
+        auto ta = taylor_adaptive<fp_t>(make_tbp(mu), init);
+
+        std::vector<fp_t> grid;
+        for (auto i = 0; i < 50; ++i) {
+            grid.push_back(fp_t(i) / 5);
+        }
+
+        const auto [oc, out] = kp.propagate_grid(grid);
+        const auto res = ta.propagate_grid(grid);
+
+        REQUIRE(oc == taylor_outcome::time_limit);
+        REQUIRE(out.size() == grid.size() * 6u);
+        for (decltype(out.size()) i = 0; i < out.size(); ++i) {
+            REQUIRE(out[i] == approximately(std::get<4>(res)[i], fp_t(10000)));
+        }
+
+        REQUIRE(kp.get_time() == grid.back());
+        REQUIRE(kp.get_state() == std::vector<fp_t>(out.end() - 6, out.end()));
+
+        // A non-monotonic grid.
+        const auto [oc2, out2] = kp.propagate_grid({fp_t(1), fp_t(0), fp_t(3)});
+        REQUIRE(oc2 == taylor_outcome::time_limit);
+        for (auto i = 0u; i < 6u; ++i) {
+            REQUIRE(out2[i] == approximately(out[30u + i], fp_t(1000)));
+        }
+        REQUIRE(kp.get_time() == 3);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("kepler batch")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        const auto mu = fp_t(1.5);
+
+        // NOTE: the second batch element is hyperbolic.
+        const std::vector<fp_t> init{1, fp_t(0.5), 0, fp_t(0.3), 0, fp_t(0.1), 0, fp_t(-0.2), fp_t(1.1), fp_t(2.5),
+                                     fp_t(0.1), fp_t(-0.3)};
+
+        auto kpb = kepler_propagator_batch<fp_t>(init, mu, 2, kw::time = std::vector<fp_t>{0, 1});
+
+        REQUIRE(kpb.get_batch_size() == 2u);
+        REQUIRE(kpb.get_dim() == 6u);
+        REQUIRE(kpb.get_time() == std::vector<fp_t>{0, 1});
+
+        std::vector<kepler_propagator<fp_t>> kps;
+        for (auto j = 0u; j < 2u; ++j) {
+            std::vector<fp_t> st;
+            for (auto i = 0u; i < 6u; ++i) {
+                st.push_back(init[i * 2u + j]);
+            }
+            kps.emplace_back(st, mu, kw::time = fp_t(j));
+        }
+
+        kpb.propagate_until({fp_t(3), fp_t(-2)});
+        kps[0].propagate_until(fp_t(3));
+        kps[1].propagate_until(fp_t(-2));
+
+        REQUIRE(kpb.get_propagate_res()
+                == std::vector<taylor_outcome>{taylor_outcome::time_limit, taylor_outcome::time_limit});
+        REQUIRE(kpb.get_time() == std::vector<fp_t>{3, -2});
+        for (auto j = 0u; j < 2u; ++j) {
+            for (auto i = 0u; i < 6u; ++i) {
+                REQUIRE(kpb.get_state()[i * 2u + j] == kps[j].get_state()[i]);
+            }
+        }
+
+        kpb.propagate_for(fp_t(1.5));
+        kps[0].propagate_for(fp_t(1.5));
+        kps[1].propagate_for(fp_t(1.5));
+        for (auto j = 0u; j < 2u; ++j) {
+            for (auto i = 0u; i < 6u; ++i) {
+                REQUIRE(kpb.get_state()[i * 2u + j] == kps[j].get_state()[i]);
+            }
+        }
+
+        // Dense output.
+        kpb.update_d_output({fp_t(0.5), fp_t(-0.5)}, true);
+        for (auto j = 0u; j < 2u; ++j) {
+            kps[j].update_d_output(j == 0u ? fp_t(0.5) : fp_t(-0.5), true);
+            for (auto i = 0u; i < 6u; ++i) {
+                REQUIRE(kpb.get_d_output()[i * 2u + j] == kps[j].get_d_output()[i]);
+            }
+        }
+
+        // Grid propagation.
+        const std::vector<fp_t> grid{5, -1, 6, 0, 7, 1};
+        const auto out = kpb.propagate_grid(grid);
+        REQUIRE(out.size() == 36u);
+
+        for (auto j = 0u; j < 2u; ++j) {
+            const auto [oc, s_out] = kps[j].propagate_grid({grid[j], grid[2u + j], grid[4u + j]});
+
+            REQUIRE(oc == taylor_outcome::time_limit);
+            for (auto k = 0u; k < 3u; ++k) {
+                for (auto i = 0u; i < 6u; ++i) {
+                    REQUIRE(out[k * 12u + i * 2u + j] == s_out[k * 6u + i]);
+                }
+            }
+        }
+
+        REQUIRE(kpb.get_time() == std::vector<fp_t>{7, 1});
+
+        kpb.set_time({fp_t(1), fp_t(2)});
+        REQUIRE(kpb.get_time() == std::vector<fp_t>{1, 2});
+        kpb.set_time(1, fp_t(3));
+        REQUIRE(kpb.get_time() == std::vector<fp_t>{1, 3});
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("kepler error handling")
+{
+    using Catch::Matchers::Message;
+
+    REQUIRE_THROWS_MATCHES(kepler_propagator<double>({1., 0., 0.}, 1.), std::invalid_argument,
+                           Message("Invalid state vector passed to the constructor of a Keplerian propagator: the "
+                                   "expected size is 6, but the actual size is 3"));
+    REQUIRE_THROWS_MATCHES(kepler_propagator<double>({1., 0., 0., 0., 1., 0.}, -1.), std::invalid_argument,
+                           Message("The gravitational parameter of a Keplerian propagator must be finite and "
+                                   "positive, but it is -1 instead"));
+
+    auto kp = kepler_propagator<double>{};
+
+    REQUIRE_THROWS_AS(kp.propagate_until(std::numeric_limits<double>::infinity()), std::invalid_argument);
+    REQUIRE_THROWS_AS(kp.propagate_grid({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(kp.propagate_grid({0., std::numeric_limits<double>::quiet_NaN()}), std::invalid_argument);
+    REQUIRE_THROWS_AS(kp.update_d_output(std::numeric_limits<double>::infinity()), std::invalid_argument);
+
+    // A non-finite state.
+    kp.get_state_data()[0] = std::numeric_limits<double>::quiet_NaN();
+    REQUIRE(kp.propagate_until(1.) == taylor_outcome::err_nf_state);
+    REQUIRE(kp.get_time() == 0);
+    REQUIRE(std::get<0>(kp.propagate_grid({1., 2.})) == taylor_outcome::err_nf_state);
+
+    REQUIRE_THROWS_MATCHES(kepler_propagator_batch<double>({1., 0., 0., 0., 1., 0.}, 1., 0), std::invalid_argument,
+                           Message("The batch size of a Keplerian propagator cannot be zero"));
+    REQUIRE_THROWS_AS(kepler_propagator_batch<double>({1., 0., 0., 0., 1., 0.}, 1., 2), std::invalid_argument);
+    REQUIRE_THROWS_AS(kepler_propagator_batch<double>({1., 0., 0., 0., 1., 0.}, 1., 1, kw::time = std::vector{0., 1.}),
+                      std::invalid_argument);
+
+    auto kpb = kepler_propagator_batch<double>{};
+    REQUIRE_THROWS_AS(kpb.propagate_until(std::vector{1., 2.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(kpb.propagate_grid({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(kpb.update_d_output(std::vector{1., 2.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(kpb.set_time(1, 1.), std::invalid_argument);
+
+    kpb.get_state_data()[0] = std::numeric_limits<double>::quiet_NaN();
+    kpb.propagate_until(1.);
+    REQUIRE(kpb.get_propagate_res()[0] == taylor_outcome::err_nf_state);
+    REQUIRE(kpb.get_time()[0] == 0);
+}
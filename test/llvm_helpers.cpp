@@ -14,6 +14,7 @@
 #include <initializer_list>
 #include <random>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -35,7 +36,9 @@
 
 #endif
 
+#include <heyoka/detail/dfloat.hpp>
 #include <heyoka/detail/llvm_helpers.hpp>
+#include <heyoka/detail/sleef.hpp>
 #include <heyoka/llvm_state.hpp>
 
 #include "catch.hpp"
@@ -891,3 +894,151 @@ TEST_CASE("csc_batch")
 
     tuple_for_each(fp_types, tester);
 }
+
+TEST_CASE("dl arith")
+{
+    using detail::llvm_dl_add;
+    using detail::llvm_dl_mul;
+
+    for (auto opt_level : {0u, 1u, 2u, 3u}) {
+        llvm_state s{kw::opt_level = opt_level};
+
+        auto &md = s.module();
+        auto &builder = s.builder();
+        auto &context = s.context();
+
+        auto *fp_t = builder.getDoubleTy();
+        auto *ptr_t = llvm::PointerType::getUnqual(fp_t);
+
+        // Add a function computing the double-length
+        // operation op on its arguments.
+        auto add_op = [&](const std::string &name, auto op) {
+            auto *ft = llvm::FunctionType::get(builder.getVoidTy(), {fp_t, fp_t, fp_t, fp_t, ptr_t, ptr_t}, false);
+            auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, name, &md);
+
+            auto args = f->args().begin();
+
+            builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+            auto [hi, lo] = op(s, args, args + 1, args + 2, args + 3);
+            builder.CreateStore(hi, args + 4);
+            builder.CreateStore(lo, args + 5);
+
+            builder.CreateRetVoid();
+
+            s.verify_function(f);
+        };
+
+        add_op("add", llvm_dl_add);
+        add_op("mul", llvm_dl_mul);
+
+        s.optimise();
+
+        s.compile();
+
+        using op_t = void (*)(double, double, double, double, double *, double *);
+        auto add_ptr = reinterpret_cast<op_t>(s.jit_lookup("add"));
+        auto mul_ptr = reinterpret_cast<op_t>(s.jit_lookup("mul"));
+
+        double hi = 0, lo = 0;
+
+        // The addition must be consistent with dfloat.
+        std::uniform_real_distribution<double> dist(-10., 10.);
+        for (auto i = 0; i < ntrials; ++i) {
+            const auto x = detail::dfloat<double>(dist(rng)) + detail::dfloat<double>(dist(rng) * 1E-17);
+            const auto y = detail::dfloat<double>(dist(rng)) + detail::dfloat<double>(dist(rng) * 1E-17);
+
+            const auto res = x + y;
+            add_ptr(x.hi, x.lo, y.hi, y.lo, &hi, &lo);
+
+            REQUIRE(hi == res.hi);
+            REQUIRE(lo == res.lo);
+        }
+
+        // (1 + 2**-30) * (1 - 2**-30) == 1 - 2**-60.
+        mul_ptr(1 + std::ldexp(1., -30), 0, 1 - std::ldexp(1., -30), 0, &hi, &lo);
+        REQUIRE(hi == 1.);
+        REQUIRE(lo == -std::ldexp(1., -60));
+    }
+}
+
+TEST_CASE("pairwise dot")
+{
+    using detail::pairwise_dot;
+
+    for (auto opt_level : {0u, 1u, 2u, 3u}) {
+        for (auto n : {1u, 2u, 3u, 4u, 7u, 10u}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            auto &md = s.module();
+            auto &builder = s.builder();
+            auto &context = s.context();
+
+            auto *fp_t = builder.getDoubleTy();
+            auto *ptr_t = llvm::PointerType::getUnqual(fp_t);
+
+            auto *ft = llvm::FunctionType::get(fp_t, {ptr_t, ptr_t}, false);
+            auto *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, "dot", &md);
+
+            auto args = f->args().begin();
+
+            builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", f));
+
+            std::vector<llvm::Value *> a, b;
+            for (auto i = 0u; i < n; ++i) {
+                a.push_back(builder.CreateLoad(builder.CreateInBoundsGEP(args, builder.getInt32(i))));
+                b.push_back(builder.CreateLoad(builder.CreateInBoundsGEP(args + 1, builder.getInt32(i))));
+            }
+
+            builder.CreateRet(pairwise_dot(s, a, b));
+
+            s.verify_function(f);
+
+            s.optimise();
+
+            s.compile();
+
+            auto f_ptr = reinterpret_cast<double (*)(const double *, const double *)>(s.jit_lookup("dot"));
+
+            std::uniform_real_distribution<double> dist(-10., 10.);
+            for (auto i = 0; i < ntrials; ++i) {
+                std::vector<double> va, vb;
+                double res = 0, abs_res = 0;
+                for (auto j = 0u; j < n; ++j) {
+                    va.push_back(dist(rng));
+                    vb.push_back(dist(rng));
+                    res += va.back() * vb.back();
+                    abs_res += std::abs(va.back() * vb.back());
+                }
+
+                // NOTE: absolute tolerance, as the result can be
+                // affected by cancellation.
+                REQUIRE(std::abs(f_ptr(va.data(), vb.data()) - res) <= abs_res * 1E-14);
+            }
+        }
+    }
+}
+
+#if !defined(HEYOKA_WITH_SLEEF) && defined(__linux__) && defined(__x86_64__)
+
+// The libmvec fallback for the vector functions.
+TEST_CASE("libmvec fallback")
+{
+    llvm_state s;
+
+    auto *dbl_t = llvm::Type::getDoubleTy(s.context());
+    auto *flt_t = llvm::Type::getFloatTy(s.context());
+
+    if (const auto name = detail::sleef_function_name(s.context(), "sin", dbl_t, 2); !name.empty()) {
+        REQUIRE(name == "_ZGVbN2v_sin");
+        REQUIRE(detail::sleef_function_name(s.context(), "pow", dbl_t, 2) == "_ZGVbN2vv_pow");
+        REQUIRE(detail::sleef_function_name(s.context(), "exp", flt_t, 4) == "_ZGVbN4v_expf");
+    }
+
+    // Functions or widths not supported by libmvec.
+    REQUIRE(detail::sleef_function_name(s.context(), "acosh", dbl_t, 2).empty());
+    REQUIRE(detail::sleef_function_name(s.context(), "sin", dbl_t, 3).empty());
+    REQUIRE(detail::sleef_function_name(s.context(), "sin", llvm::Type::getX86_FP80Ty(s.context()), 2).empty());
+}
+
+#endif
@@ -6,17 +6,32 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#endif
+
 #include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/sin.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/taylor.hpp>
 
 #include "catch.hpp"
+#include "test_utils.hpp"
 
 using namespace heyoka;
+using namespace heyoka_test;
 
 TEST_CASE("empty state")
 {
@@ -25,6 +40,33 @@ TEST_CASE("empty state")
     std::cout << s.get_ir() << '\n';
 }
 
+TEST_CASE("bitcode snapshot")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state s{kw::mname = "bc state"};
+
+    taylor_add_jet<double>(s, "jet", {x * y, y * x}, 1, 1, true, false);
+
+    s.optimise();
+
+    const auto bc = s.get_bc();
+    REQUIRE(!bc.empty());
+
+    s.compile();
+
+    // The snapshot is the bitcode of the module
+    // before the compilation, and the IR is
+    // reconstructed from it.
+    REQUIRE(s.get_bc() == bc);
+    REQUIRE(s.get_ir().find("jet") != std::string::npos);
+
+    // The IR can be fetched from a copy too.
+    const auto s2 = s;
+    REQUIRE(s2.is_compiled());
+    REQUIRE(s2.get_ir().find("bc state") != std::string::npos);
+}
+
 TEST_CASE("copy semantics")
 {
     auto [x, y] = make_vars("x", "y");
@@ -152,3 +194,417 @@ TEST_CASE("get object code")
         REQUIRE(!s.get_object_code().empty());
     }
 }
+
+TEST_CASE("persistent cache")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    // Helper to build, compile and run a jet function
+    // in a state using the persistent cache.
+    auto run_jet = [&](auto... kw_args) {
+        std::vector<double> jet{2, 3, 0, 0};
+
+        llvm_state s{kw::mname = "cache state", kw::cache_dir = ".", kw_args...};
+
+        REQUIRE(s.cache_dir() == ".");
+
+        taylor_add_jet<double>(s, "jet", {x * y, y * x}, 1, 1, true, false);
+
+        s.compile();
+
+        auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+        jptr(jet.data(), nullptr, nullptr);
+
+        REQUIRE(jet[0] == 2);
+        REQUIRE(jet[1] == 3);
+        REQUIRE(jet[2] == 6);
+        REQUIRE(jet[3] == 6);
+
+        return s;
+    };
+
+    // The first invocation populates the cache, the
+    // second one fetches the object code from it.
+    run_jet();
+    auto s = run_jet();
+    REQUIRE(s.is_compiled());
+    REQUIRE(!s.get_ir().empty());
+
+    // Different options must not share the cached object code.
+    run_jet(kw::opt_level = 0u);
+    run_jet(kw::opt_level = 0u);
+    run_jet(kw::fast_math = true);
+    run_jet(kw::fast_math = true);
+
+    // Copies of states using the cache.
+    auto s2 = s;
+    REQUIRE(s2.cache_dir() == ".");
+    REQUIRE(s2.is_compiled());
+    REQUIRE(s2.get_ir() == s.get_ir());
+
+    // Modification of the module after the optimisation.
+    {
+        std::vector<double> jet{2, 3, 0, 0};
+
+        llvm_state s3{kw::mname = "cache state", kw::cache_dir = "."};
+
+        taylor_add_jet<double>(s3, "jet", {x * y, y * x}, 1, 1, true, false);
+        taylor_add_jet<double>(s3, "jet2", {x + y, y - x}, 1, 1, true, false);
+
+        s3.compile();
+
+        auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s3.jit_lookup("jet2"));
+
+        jptr(jet.data(), nullptr, nullptr);
+
+        REQUIRE(jet[0] == 2);
+        REQUIRE(jet[1] == 3);
+        REQUIRE(jet[2] == 5);
+        REQUIRE(jet[3] == 1);
+    }
+}
+
+TEST_CASE("in-memory cache")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state::clear_memcache();
+    REQUIRE(llvm_state::get_memcache_size() == 0u);
+
+    const auto orig_limit = llvm_state::get_memcache_limit();
+    REQUIRE(orig_limit > 0u);
+
+    auto run_jet = [&]() {
+        std::vector<double> jet{2, 3, 0, 0};
+
+        llvm_state s{kw::mname = "memcache state"};
+
+        taylor_add_jet<double>(s, "jet", {x * y, y * x}, 1, 1, true, false);
+
+        s.compile();
+
+        auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+        jptr(jet.data(), nullptr, nullptr);
+
+        REQUIRE(jet[0] == 2);
+        REQUIRE(jet[1] == 3);
+        REQUIRE(jet[2] == 6);
+        REQUIRE(jet[3] == 6);
+    };
+
+    // The first run populates the cache.
+    run_jet();
+    const auto cur_size = llvm_state::get_memcache_size();
+    REQUIRE(cur_size > 0u);
+
+    // The second run fetches the object code from the cache.
+    run_jet();
+    REQUIRE(llvm_state::get_memcache_size() == cur_size);
+
+    // A lower limit evicts the entries.
+    llvm_state::set_memcache_limit(0);
+    REQUIRE(llvm_state::get_memcache_limit() == 0u);
+    REQUIRE(llvm_state::get_memcache_size() == 0u);
+
+    // Nothing is stored if the limit is too small.
+    run_jet();
+    REQUIRE(llvm_state::get_memcache_size() == 0u);
+
+    // Restore the limit.
+    llvm_state::set_memcache_limit(orig_limit);
+    run_jet();
+    REQUIRE(llvm_state::get_memcache_size() == cur_size);
+
+    llvm_state::clear_memcache();
+    REQUIRE(llvm_state::get_memcache_size() == 0u);
+}
+
+TEST_CASE("jit pool")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE(llvm_state::get_jit_pool_size() == 0u);
+
+    llvm_state::set_jit_pool_size(4);
+    REQUIRE(llvm_state::get_jit_pool_size() == 4u);
+
+    // Create more states than the size of the pool.
+    for (auto i = 0; i < 10; ++i) {
+        std::vector<double> jet{2, 3, 0, 0};
+
+        llvm_state s{kw::mname = "pool state"};
+
+        taylor_add_jet<double>(s, "jet", {x * y, y * x}, 1, 1, true, false);
+
+        s.compile();
+
+        // A copy uses a jit from the pool as well.
+        auto s2 = s;
+
+        for (auto *st : {&s, &s2}) {
+            auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(st->jit_lookup("jet"));
+
+            jptr(jet.data(), nullptr, nullptr);
+
+            REQUIRE(jet[2] == 6);
+            REQUIRE(jet[3] == 6);
+        }
+    }
+
+    llvm_state::set_jit_pool_size(0);
+    REQUIRE(llvm_state::get_jit_pool_size() == 0u);
+
+    // The states can still be created with the pool disabled.
+    llvm_state s;
+    REQUIRE(s.target_cpu().empty());
+}
+
+TEST_CASE("target cpu")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    auto run_jet = [&](llvm_state &s) {
+        std::vector<double> jet{2, 3, 0, 0};
+
+        auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(s.jit_lookup("jet"));
+
+        jptr(jet.data(), nullptr, nullptr);
+
+        REQUIRE(jet[0] == 2);
+        REQUIRE(jet[1] == 3);
+        REQUIRE(jet[2] == 6);
+        REQUIRE(jet[3] == 6);
+    };
+
+    // Default is the host CPU.
+    REQUIRE(llvm_state{}.target_cpu().empty());
+
+    REQUIRE(recommended_batch_size<double>() >= 1u);
+    REQUIRE(recommended_batch_size<long double>() == 1u);
+
+    if (!detail::get_target_features().sse2) {
+        // The remaining tests use x86 CPU names.
+        return;
+    }
+
+    llvm_state s{kw::target_cpu = "x86-64"};
+    REQUIRE(s.target_cpu() == "x86-64");
+    std::cout << s << '\n';
+
+    taylor_add_jet<double>(s, "jet", {x * y, y * x}, 1, 1, true, false);
+
+    s.compile();
+    run_jet(s);
+
+    // Copy.
+    auto s2 = s;
+    REQUIRE(s2.target_cpu() == "x86-64");
+    run_jet(s2);
+
+    // Serialisation.
+    std::stringstream ss;
+    s.save(ss);
+
+    llvm_state s3;
+    s3.load(ss);
+    REQUIRE(s3.target_cpu() == "x86-64");
+    REQUIRE(s3.get_object_code() == s.get_object_code());
+    run_jet(s3);
+
+    // Invalid CPU.
+    REQUIRE_THROWS_MATCHES(llvm_state{kw::target_cpu = "not a cpu"}, std::invalid_argument,
+                           Catch::Matchers::Predicate<std::invalid_argument>([](const std::invalid_argument &ia) {
+                               return std::string(ia.what()).find("The target CPU 'not a cpu' is not valid")
+                                      != std::string::npos;
+                           }));
+}
+
+TEST_CASE("vectorisation flags")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    llvm_state s0;
+    REQUIRE(!s0.slp_vectorize());
+    REQUIRE(!s0.loop_vectorize());
+
+    for (auto slp : {false, true}) {
+        for (auto loop : {false, true}) {
+            llvm_state s{kw::slp_vectorize = slp, kw::loop_vectorize = loop};
+
+            REQUIRE(s.slp_vectorize() == slp);
+            REQUIRE(s.loop_vectorize() == loop);
+
+            taylor_add_jet<double>(s, "jet", {x * y, y * x}, 1, 1, true, false);
+
+            s.compile();
+
+            // Copy and serialisation.
+            auto s2 = s;
+            REQUIRE(s2.slp_vectorize() == slp);
+            REQUIRE(s2.loop_vectorize() == loop);
+
+            std::stringstream ss;
+            s.save(ss);
+
+            llvm_state s3;
+            s3.load(ss);
+            REQUIRE(s3.slp_vectorize() == slp);
+            REQUIRE(s3.loop_vectorize() == loop);
+
+            for (auto *st : {&s, &s2, &s3}) {
+                std::vector<double> jet{2, 3, 0, 0};
+
+                auto jptr
+                    = reinterpret_cast<void (*)(double *, const double *, const double *)>(st->jit_lookup("jet"));
+
+                jptr(jet.data(), nullptr, nullptr);
+
+                REQUIRE(jet[2] == 6);
+                REQUIRE(jet[3] == 6);
+            }
+        }
+    }
+
+    // The flags can be set via the integrators' constructors.
+    auto ta = taylor_adaptive<double>{{prime(x) = y, prime(y) = -x}, {0., 1.}, kw::slp_vectorize = true};
+    REQUIRE(ta.get_llvm_state().slp_vectorize());
+}
+
+TEST_CASE("parallel compilation")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x) + cos(v) * x};
+
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = true};
+
+    for (auto n_threads : {0u, 2u, 4u}) {
+        auto ta_p = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = true,
+                                            kw::compile_threads = n_threads};
+
+        REQUIRE(ta_p.get_llvm_state().compile_threads() == n_threads);
+
+        // Copy and serialisation of the compiled state.
+        auto s2 = ta_p.get_llvm_state();
+        REQUIRE(s2.compile_threads() == n_threads);
+        REQUIRE(s2.get_object_code() == ta_p.get_llvm_state().get_object_code());
+
+        std::stringstream ss;
+        ta_p.get_llvm_state().save(ss);
+
+        llvm_state s3;
+        s3.load(ss);
+        REQUIRE(s3.compile_threads() == n_threads);
+        REQUIRE(s3.get_object_code() == ta_p.get_llvm_state().get_object_code());
+
+        // Copy of the integrator.
+        auto ta_p2 = ta_p;
+
+        ta.set_time(0.);
+        ta.get_state_data()[0] = 0.05;
+        ta.get_state_data()[1] = 0.025;
+
+        ta.propagate_until(10.);
+        ta_p.propagate_until(10.);
+        ta_p2.propagate_until(10.);
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(ta_p.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+            REQUIRE(ta_p2.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+    }
+}
+
+TEST_CASE("opt remarks")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    REQUIRE(!llvm_state::get_opt_remarks_enabled());
+
+    // No remarks are collected by default.
+    {
+        llvm_state s;
+
+        taylor_add_jet<double>(s, "jet", {cos(x) * y, sin(y) * x}, 3, 1, true, true);
+
+        s.optimise();
+
+        REQUIRE(s.get_opt_remarks().empty());
+    }
+
+    llvm_state::set_opt_remarks_enabled(true);
+    REQUIRE(llvm_state::get_opt_remarks_enabled());
+
+    {
+        llvm_state s{kw::slp_vectorize = true};
+
+        // NOTE: in compact mode, the jet functions
+        // invoke the functions implementing the derivatives,
+        // which are candidates for inlining.
+        taylor_add_jet<double>(s, "jet", {cos(x) * y, sin(y) * x}, 3, 1, true, true);
+
+        s.optimise();
+
+        const auto &rems = s.get_opt_remarks();
+        REQUIRE(!rems.empty());
+
+        for (const auto &r : rems) {
+            REQUIRE((r.kind == "passed" || r.kind == "missed" || r.kind == "analysis"));
+            REQUIRE((r.pass == "slp-vectorizer" || r.pass == "loop-vectorize" || r.pass == "inline"));
+            REQUIRE(!r.function.empty());
+        }
+
+        // The remarks are not copied.
+        auto s2 = s;
+        REQUIRE(s2.get_opt_remarks().empty());
+
+        s.compile();
+        REQUIRE(!s.get_opt_remarks().empty());
+    }
+
+    llvm_state::set_opt_remarks_enabled(false);
+    REQUIRE(!llvm_state::get_opt_remarks_enabled());
+}
+
+#if defined(__linux__)
+
+TEST_CASE("jit listeners")
+{
+    auto [x, y] = make_vars("x", "y");
+
+    ::setenv("HEYOKA_JIT_LISTENERS", "perf, gdb,perf", 1);
+
+    {
+        llvm_state s;
+
+        taylor_add_jet<double>(s, "jet_perf_map_test", {x * y, y * x}, 1, 1, false, false);
+
+        s.compile();
+
+        REQUIRE(s.jit_lookup("jet_perf_map_test") != 0u);
+    }
+
+    // The jitted function must show up in the perf map file.
+    {
+        std::ifstream ifs("/tmp/perf-" + std::to_string(::getpid()) + ".map");
+        REQUIRE(ifs.good());
+
+        std::string line;
+        auto found = false;
+        while (std::getline(ifs, line)) {
+            if (line.find(" jet_perf_map_test") != std::string::npos) {
+                found = true;
+            }
+        }
+        REQUIRE(found);
+    }
+
+    ::setenv("HEYOKA_JIT_LISTENERS", "gdb,foo", 1);
+    REQUIRE_THROWS_AS(llvm_state{}, std::invalid_argument);
+
+    ::unsetenv("HEYOKA_JIT_LISTENERS");
+}
+
+#endif
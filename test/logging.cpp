@@ -0,0 +1,148 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/logging.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "spdlog_oss.hpp"
+#include "test_utils.hpp"
+
+// NOTE: this is the hot-path warning emitted by the compiled
+// code when the inverse Kepler solver hits the iteration limit.
+extern "C" void heyoka_inv_kep_E_max_iter() noexcept;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+namespace
+{
+
+const std::string kep_msg = "iteration limit exceeded while solving the elliptic inverse Kepler equation";
+
+// Count the occurrences of str in the output of the logger.
+std::size_t count_occurrences(spdlog_oss &ss, const std::string &str)
+{
+    ss.flush();
+
+    const auto out = ss.oss().str();
+
+    std::size_t retval = 0;
+    for (auto pos = out.find(str); pos != std::string::npos; pos = out.find(str, pos + str.size())) {
+        ++retval;
+    }
+
+    return retval;
+}
+
+// Number of times the kep_msg warning was logged directly
+// (i.e., not as part of an aggregated report).
+std::size_t n_direct(spdlog_oss &ss)
+{
+    return count_occurrences(ss, kep_msg) - count_occurrences(ss, "was emitted");
+}
+
+} // namespace
+
+TEST_CASE("hot warn aggregation")
+{
+    create_logger();
+    set_logger_level_info();
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+    auto ta2 = ta;
+
+    spdlog_oss ss;
+
+    // Outside the aggregation scopes, every warning is logged.
+    for (auto i = 0; i < 3; ++i) {
+        heyoka_inv_kep_E_max_iter();
+    }
+
+    REQUIRE(n_direct(ss) == 3u);
+    REQUIRE(count_occurrences(ss, "was emitted") == 0u);
+
+    ss.oss().str("");
+
+    // Within propagate_until(), repeated warnings are logged once
+    // and the count is reported at the end.
+    std::size_t n_steps = 0;
+    auto res = ta.propagate_until(10., kw::callback = [&n_steps](taylor_adaptive<double> &) {
+        for (auto i = 0; i < 3; ++i) {
+            heyoka_inv_kep_E_max_iter();
+        }
+
+        ++n_steps;
+
+        return true;
+    });
+
+    REQUIRE(std::get<0>(res) == taylor_outcome::time_limit);
+    REQUIRE(n_steps > 1u);
+    REQUIRE(n_direct(ss) == 1u);
+    REQUIRE(count_occurrences(ss, "was emitted " + std::to_string(3u * n_steps - 1u) + " more time(s)") == 1u);
+
+    ss.oss().str("");
+
+    // A warning emitted only once within a scope is not reported again.
+    ta.set_time(0.);
+    bool first = true;
+    ta.propagate_until(10., kw::callback = [&first](taylor_adaptive<double> &) {
+        if (first) {
+            heyoka_inv_kep_E_max_iter();
+            first = false;
+        }
+
+        return true;
+    });
+
+    REQUIRE(n_direct(ss) == 1u);
+    REQUIRE(count_occurrences(ss, "was emitted") == 0u);
+
+    ss.oss().str("");
+
+    // Nested scopes: the count is reported only when
+    // the outermost scope exits.
+    ta.set_time(0.);
+    std::size_t n_inner = 0;
+    std::size_t n_reports_inside = 0;
+    ta.propagate_until(10., kw::callback = [&](taylor_adaptive<double> &) {
+        ta2.set_time(0.);
+        ta2.propagate_until(1., kw::callback = [&n_inner](taylor_adaptive<double> &) {
+            heyoka_inv_kep_E_max_iter();
+            ++n_inner;
+
+            return true;
+        });
+
+        n_reports_inside += count_occurrences(ss, "was emitted");
+
+        return true;
+    });
+
+    REQUIRE(n_inner > 1u);
+    REQUIRE(n_reports_inside == 0u);
+    REQUIRE(n_direct(ss) == 1u);
+    REQUIRE(count_occurrences(ss, "was emitted " + std::to_string(n_inner - 1u) + " more time(s)") == 1u);
+
+    ss.oss().str("");
+
+    // Once the scopes have exited, the warnings are logged again every time.
+    heyoka_inv_kep_E_max_iter();
+    heyoka_inv_kep_E_max_iter();
+
+    REQUIRE(n_direct(ss) == 2u);
+    REQUIRE(count_occurrences(ss, "was emitted") == 0u);
+}
@@ -0,0 +1,350 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/cfunc.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/mascon.hpp>
+#include <heyoka/math/mascon_acc.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+namespace
+{
+
+// Helper to create a small mascon model.
+// NOTE: the number of points is chosen so that
+// the SIMD loop over the points has a remainder.
+std::pair<std::vector<std::vector<double>>, std::vector<double>> make_model(unsigned n)
+{
+    std::vector<std::vector<double>> points;
+    std::vector<double> masses;
+
+    for (unsigned i = 0; i < n; ++i) {
+        const auto th = 0.7 * i;
+
+        points.push_back({0.3 * std::cos(th), 0.2 * std::sin(th), 0.1 * std::cos(1.3 * th)});
+        masses.push_back(1. / n + 0.01 * i);
+    }
+
+    return {points, masses};
+}
+
+} // namespace
+
+TEST_CASE("mascon fused")
+{
+    const auto [points, masses] = make_model(11);
+
+    const auto sys = make_mascon_system(kw::points = points, kw::masses = masses,
+                                        kw::omega = std::vector<double>{0.1, 0.2, 0.3}, kw::Gconst = 1.2);
+    const auto sys_f = make_mascon_system(kw::points = points, kw::masses = masses,
+                                          kw::omega = std::vector<double>{0.1, 0.2, 0.3}, kw::Gconst = 1.2,
+                                          kw::fused = true);
+
+    REQUIRE(sys_f.size() == sys.size());
+
+    const std::vector<double> init_state{2., 0.1, -0.2, 0.05, 0.6, 0.1};
+
+    // Compare the right-hand sides and their derivatives.
+    std::unordered_map<std::string, double> map;
+    for (std::size_t i = 0; i < sys.size(); ++i) {
+        map[std::get<variable>(sys[i].first.value()).name()] = init_state[i];
+    }
+
+    for (std::size_t i = 0; i < sys.size(); ++i) {
+        REQUIRE(sys_f[i].first == sys[i].first);
+        REQUIRE(eval_dbl(sys_f[i].second, map) == approximately(eval_dbl(sys[i].second, map), 1000.));
+
+        for (const auto *v : {"x", "y", "z"}) {
+            REQUIRE(eval_dbl(diff(sys_f[i].second, v), map)
+                    == approximately(eval_dbl(diff(sys[i].second, v), map), 1000.));
+        }
+    }
+
+    // The size of the fused decomposition does not depend on the size of the model.
+    REQUIRE(taylor_decompose(sys_f, {}).first.size() < taylor_decompose(sys, {}).first.size());
+
+    {
+        const auto [points2, masses2] = make_model(3);
+
+        const auto sys_f2 = make_mascon_system(kw::points = points2, kw::masses = masses2,
+                                               kw::omega = std::vector<double>{0.1, 0.2, 0.3}, kw::Gconst = 1.2,
+                                               kw::fused = true);
+
+        REQUIRE(taylor_decompose(sys_f2, {}).first.size() == taylor_decompose(sys_f, {}).first.size());
+    }
+
+    // Compare the integrations.
+    auto tester = [&](auto fp_x, bool compact_mode, bool high_accuracy) {
+        using fp_t = decltype(fp_x);
+
+        const std::vector<fp_t> ic(init_state.begin(), init_state.end());
+
+        auto ta = taylor_adaptive<fp_t>{sys, ic, kw::compact_mode = compact_mode, kw::high_accuracy = high_accuracy};
+        auto ta_f
+            = taylor_adaptive<fp_t>{sys_f, ic, kw::compact_mode = compact_mode, kw::high_accuracy = high_accuracy};
+
+        REQUIRE(std::get<0>(ta.propagate_until(fp_t(5))) == taylor_outcome::time_limit);
+        REQUIRE(std::get<0>(ta_f.propagate_until(fp_t(5))) == taylor_outcome::time_limit);
+
+        for (std::size_t i = 0; i < ic.size(); ++i) {
+            REQUIRE(ta_f.get_state()[i] == approximately(ta.get_state()[i], fp_t(1E6)));
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            tuple_for_each(fp_types, [&tester, cm, ha](auto x) { tester(x, cm, ha); });
+        }
+    }
+
+    // Batch mode.
+    for (auto cm : {false, true}) {
+        const std::uint32_t batch_size = 2;
+
+        std::vector<double> init_state_batch;
+        for (auto v : init_state) {
+            init_state_batch.push_back(v);
+            init_state_batch.push_back(v * 1.01);
+        }
+
+        auto ta = taylor_adaptive_batch<double>{sys, init_state_batch, batch_size, kw::compact_mode = cm};
+        auto ta_f = taylor_adaptive_batch<double>{sys_f, init_state_batch, batch_size, kw::compact_mode = cm};
+
+        ta.propagate_until({5., 5.});
+        ta_f.propagate_until({5., 5.});
+
+        for (std::size_t i = 0; i < init_state_batch.size(); ++i) {
+            REQUIRE(ta_f.get_state()[i] == approximately(ta.get_state()[i], 1E6));
+        }
+    }
+
+    // Compiled functions, in scalar and batch mode.
+    {
+        auto [x, y, z] = make_vars("x", "y", "z");
+
+        std::vector<number> points_n, masses_n;
+        for (const auto &p : points) {
+            for (auto c : p) {
+                points_n.emplace_back(c);
+            }
+        }
+        for (auto m : masses) {
+            masses_n.emplace_back(m);
+        }
+
+        const auto acc = mascon_acc(x, y, z, points_n, masses_n);
+        REQUIRE(acc.size() == 3u);
+
+        const std::size_t n_points = 5;
+        std::vector<double> in;
+        for (std::uint32_t c = 0; c < 3u; ++c) {
+            for (std::size_t i = 0; i < n_points; ++i) {
+                in.push_back(init_state[c] + 0.1 * static_cast<double>(i));
+            }
+        }
+
+        for (auto batch_size : {1u, 4u}) {
+            auto cf = cfunc<double>{acc, kw::vars = std::vector{x, y, z}, kw::batch_size = batch_size};
+
+            const auto out = cf(in, n_points);
+
+            for (std::size_t i = 0; i < n_points; ++i) {
+                const std::unordered_map<std::string, double> pmap{
+                    {"x", in[i]}, {"y", in[n_points + i]}, {"z", in[2u * n_points + i]}};
+
+                for (std::size_t c = 0; c < 3u; ++c) {
+                    REQUIRE(out[c * n_points + i] == approximately(eval_dbl(acc[c], pmap), 1000.));
+                }
+            }
+        }
+
+        // Equality and hashing.
+        REQUIRE(acc[0] != acc[1]);
+        REQUIRE(mascon_acc(x, y, z, points_n, masses_n)[2] == acc[2]);
+        REQUIRE(hash(mascon_acc(x, y, z, points_n, masses_n)[2]) == hash(acc[2]));
+
+        auto masses_n2 = masses_n;
+        masses_n2[0] = number{42.};
+        REQUIRE(mascon_acc(x, y, z, points_n, masses_n2)[0] != acc[0]);
+
+        // Two different models in the same system.
+        auto [vx, vy, vz] = make_vars("vx", "vy", "vz");
+        const auto acc2 = mascon_acc(x, y, z, points_n, masses_n2);
+
+        const auto sys2 = std::vector{prime(x) = vx,
+                                      prime(y) = vy,
+                                      prime(z) = vz,
+                                      prime(vx) = acc[0] + acc2[0],
+                                      prime(vy) = acc[1] + acc2[1],
+                                      prime(vz) = acc[2] + acc2[2]};
+
+        auto points3 = points;
+        points3.insert(points3.end(), points.begin(), points.end());
+        auto masses3 = masses;
+        masses3.insert(masses3.end(), masses.begin(), masses.end());
+        masses3[masses.size()] = 42.;
+        const auto sys3 = make_mascon_system(kw::points = points3, kw::masses = masses3,
+                                             kw::omega = std::vector<double>{0., 0., 0.});
+
+        for (auto cm : {false, true}) {
+            auto ta2 = taylor_adaptive<double>{sys2, init_state, kw::compact_mode = cm};
+            auto ta3 = taylor_adaptive<double>{sys3, init_state, kw::compact_mode = cm};
+
+            ta2.propagate_until(.1);
+            ta3.propagate_until(.1);
+
+            for (std::size_t i = 0; i < init_state.size(); ++i) {
+                REQUIRE(ta2.get_state()[i] == approximately(ta3.get_state()[i], 1E6));
+            }
+        }
+    }
+}
+
+TEST_CASE("mascon fused errors")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    REQUIRE_THROWS_MATCHES(mascon_acc(x, y, z, {}, {}), std::invalid_argument,
+                           Message("At least one mascon point is needed to create a mascon acceleration"));
+    REQUIRE_THROWS_MATCHES(
+        mascon_acc(x, y, z, {number{1.}, number{2.}}, {number{1.}}), std::invalid_argument,
+        Message("Inconsistent sizes detected while creating a mascon acceleration: the number of point coordinates is "
+                "2, but the number of masses is 1 (the number of coordinates must be three times the number of "
+                "masses)"));
+    REQUIRE_THROWS_MATCHES(
+        detail::mascon_acc_impl(3, x, y, z, {number{1.}, number{2.}, number{3.}}, {number{1.}}),
+        std::invalid_argument,
+        Message("Invalid component index 3 specified while creating a mascon acceleration: the index must be 0, 1 "
+                "or 2"));
+
+    // Non-numerical mascon data.
+    REQUIRE_THROWS_MATCHES(make_mascon_system(kw::points = std::vector<std::vector<double>>{{1., 2., 3.}},
+                                              kw::masses = std::vector{par[0]},
+                                              kw::omega = std::vector<double>{0., 0., 0.}, kw::fused = true),
+                           std::invalid_argument,
+                           Message("The positions and masses of the mascon points must be numerical constants in "
+                                   "order to construct a fused mascon system"));
+
+    // Non-variable arguments in the Taylor derivatives.
+    const auto acc = mascon_acc(x, 1_dbl, z, {number{1.}, number{2.}, number{3.}}, {number{1.}});
+
+    for (auto cm : {false, true}) {
+        REQUIRE_THROWS_AS(
+            (taylor_adaptive<double>{{prime(x) = acc[0], prime(z) = acc[2]}, {0., 0.}, kw::compact_mode = cm}),
+            std::invalid_argument);
+    }
+}
+
+TEST_CASE("mascon tree")
+{
+    using Catch::Matchers::Message;
+
+    const auto [points, masses] = make_model(200);
+
+    const auto sys = make_mascon_system(kw::points = points, kw::masses = masses,
+                                        kw::omega = std::vector<double>{0.1, 0.2, 0.3}, kw::Gconst = 1.2);
+
+    std::unordered_map<std::string, double> map;
+
+    for (auto fused : {false, true}) {
+        const auto sys_t = make_mascon_system(kw::points = points, kw::masses = masses,
+                                              kw::omega = std::vector<double>{0.1, 0.2, 0.3}, kw::Gconst = 1.2,
+                                              kw::fused = fused, kw::theta = .2, kw::min_distance = 2.);
+
+        REQUIRE(sys_t.size() == sys.size());
+
+        // The accelerations must be close to the exact ones
+        // at distances no smaller than min_distance.
+        for (const auto &st : {std::vector{2., 0., 0.}, std::vector{0., -2.5, 0.1}, std::vector{1.5, 1.5, 1.5}}) {
+            map["x"] = st[0];
+            map["y"] = st[1];
+            map["z"] = st[2];
+            map["vx"] = 0.1;
+            map["vy"] = -0.2;
+            map["vz"] = 0.3;
+
+            for (std::size_t i = 0; i < sys.size(); ++i) {
+                REQUIRE(sys_t[i].first == sys[i].first);
+
+                const auto ex = eval_dbl(sys[i].second, map);
+                REQUIRE(std::abs(eval_dbl(sys_t[i].second, map) - ex) <= 1e-2 * (1 + std::abs(ex)));
+            }
+        }
+    }
+
+    // The approximated model has fewer points.
+    REQUIRE(taylor_decompose(make_mascon_system(kw::points = points, kw::masses = masses,
+                                                kw::omega = std::vector<double>{0.1, 0.2, 0.3}, kw::theta = .2,
+                                                kw::min_distance = 2.),
+                             {})
+                .first.size()
+            < taylor_decompose(sys, {}).first.size());
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES(make_mascon_system(kw::points = points, kw::masses = masses,
+                                              kw::omega = std::vector<double>{0., 0., 0.}, kw::theta = -.5,
+                                              kw::min_distance = 2.),
+                           std::invalid_argument,
+                           Message("The opening angle of the tree approximation of a mascon system must be positive "
+                                   "and finite, but a value of -0.5 was provided instead"));
+    REQUIRE_THROWS_MATCHES(make_mascon_system(kw::points = points, kw::masses = masses,
+                                              kw::omega = std::vector<double>{0., 0., 0.}, kw::theta = .5),
+                           std::invalid_argument,
+                           Message("The minimum distance for the tree approximation of a mascon system must be "
+                                   "positive and finite, but a value of 0 was provided instead"));
+    REQUIRE_THROWS_MATCHES(make_mascon_system(kw::points = std::vector<std::vector<double>>{{1., 2., 3.}},
+                                              kw::masses = std::vector{-.5},
+                                              kw::omega = std::vector<double>{0., 0., 0.}, kw::theta = .5,
+                                              kw::min_distance = 2.),
+                           std::invalid_argument,
+                           Message("The masses in the tree approximation of a mascon system must be non-negative "
+                                   "and finite, but a value of -0.5 was provided instead"));
+    REQUIRE_THROWS_MATCHES(make_mascon_system(kw::points = std::vector<std::vector<double>>{{1., 2., 3.}},
+                                              kw::masses = std::vector{par[0]},
+                                              kw::omega = std::vector<double>{0., 0., 0.}, kw::theta = .5,
+                                              kw::min_distance = 2.),
+                           std::invalid_argument,
+                           Message("The positions and masses of the mascon points must be numerical constants in "
+                                   "order to construct an approximate mascon system"));
+}
@@ -0,0 +1,126 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <mpi.h>
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/mpi_ensemble.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+// NOTE: initialise MPI before running the tests. This test
+// can be run both as a single process and via mpiexec.
+struct mpi_env {
+    mpi_env()
+    {
+        MPI_Init(nullptr, nullptr);
+    }
+    ~mpi_env()
+    {
+        MPI_Finalize();
+    }
+};
+
+const mpi_env env;
+
+int get_rank()
+{
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    return rank;
+}
+
+TEST_CASE("mpi bcast integrator")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    std::unique_ptr<taylor_adaptive<double>> ta;
+    if (get_rank() == 0) {
+        ta = std::make_unique<taylor_adaptive<double>>(
+            std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)}, std::vector{0.05, 0.025});
+    }
+
+    auto ta_b = mpi_bcast_integrator<double>(MPI_COMM_WORLD, 0, ta.get());
+
+    REQUIRE(ta_b.get_dim() == 2u);
+    REQUIRE(ta_b.get_state() == std::vector{0.05, 0.025});
+
+    auto ta_cmp = taylor_adaptive<double>({prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025});
+    ta_b.propagate_until(10.);
+    ta_cmp.propagate_until(10.);
+    REQUIRE(ta_b.get_state() == ta_cmp.get_state());
+}
+
+TEST_CASE("mpi ensemble propagate until")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto rank = get_rank();
+
+    auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -9.8 * sin(x)}, {0., 0.});
+
+    // The initial conditions are read only on the root rank.
+    const std::size_t n_iter = 13;
+    std::vector<double> ics;
+    if (rank == 0) {
+        for (std::size_t i = 0; i < n_iter; ++i) {
+            ics.push_back(0.01 * static_cast<double>(i + 1u));
+            ics.push_back(0.025);
+        }
+    }
+
+    const auto res = mpi_ensemble_propagate_until<double>(MPI_COMM_WORLD, 0, &ta, 10., ics, kw::n_threads = 2u);
+
+    if (rank == 0) {
+        REQUIRE(res.states.size() == n_iter * 2u);
+        REQUIRE(res.times.size() == n_iter);
+
+        // Compare with the local ensemble propagation.
+        const auto res_cmp = ensemble_propagate_until<double>(
+            ta, 10., n_iter, [&ics](taylor_adaptive<double> &cur_ta, std::size_t i) {
+                cur_ta.get_state_data()[0] = ics[i * 2u];
+                cur_ta.get_state_data()[1] = ics[i * 2u + 1u];
+            });
+
+        REQUIRE(res.states == res_cmp.states);
+        REQUIRE(res.times == res_cmp.times);
+        REQUIRE(res.outcomes == res_cmp.outcomes);
+        REQUIRE(res.n_steps == res_cmp.n_steps);
+        REQUIRE(res.min_hs == res_cmp.min_hs);
+        REQUIRE(res.max_hs == res_cmp.max_hs);
+    } else {
+        REQUIRE(res.states.empty());
+    }
+
+    // Error handling: the errors are raised on all the ranks.
+    if (rank == 0) {
+        ics.pop_back();
+    }
+    REQUIRE_THROWS_AS(mpi_ensemble_propagate_until<double>(MPI_COMM_WORLD, 0, &ta, 10., ics), std::exception);
+
+    auto ta_ev = taylor_adaptive<double>({prime(x) = v, prime(v) = -9.8 * sin(x)}, {0., 0.},
+                                         kw::t_events = {t_event<double>(v)});
+    REQUIRE_THROWS_AS(mpi_ensemble_propagate_until<double>(MPI_COMM_WORLD, 0, &ta_ev, 10., std::vector<double>{}),
+                      std::exception);
+}
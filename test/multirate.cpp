@@ -0,0 +1,119 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/multirate.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("taylor multirate")
+{
+    auto tester = [](auto fp_x, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        using std::abs;
+
+        auto [x1, v1, x2, v2] = make_vars("x1", "v1", "x2", "v2");
+
+        // A fast oscillator driven by a slow one,
+        // with a weak back-reaction on the slow oscillator.
+        const auto sys = std::vector{prime(x1) = v1, prime(x2) = v2, prime(v1) = -100_dbl * x1 + par[0] * x2,
+                                     prime(v2) = -x2 + 1e-8_dbl * x1};
+        const auto init_state = std::vector<fp_t>{fp_t(1) / 10, 1, 0, 0};
+        const auto pars = std::vector<fp_t>{fp_t(1)};
+
+        auto tm = taylor_multirate<fp_t>{sys, init_state, {x1, v1}, kw::compact_mode = compact_mode, kw::pars = pars};
+
+        REQUIRE(tm.get_slow_idx() == std::vector<std::uint32_t>{1, 3});
+        REQUIRE(tm.get_fast_idx() == std::vector<std::uint32_t>{0, 2});
+        REQUIRE(tm.get_slow_ta().get_dim() == 2u);
+        REQUIRE(tm.get_fast_ta().get_dim() == 2u);
+        REQUIRE(tm.get_time() == 0);
+        REQUIRE(tm.get_state() == init_state);
+
+        // Reference solution.
+        auto ta = taylor_adaptive<fp_t>{sys, init_state, kw::compact_mode = compact_mode, kw::pars = pars};
+        ta.propagate_until(fp_t(10));
+
+        const auto [oc, n_slow, n_fast] = tm.propagate_until(fp_t(10));
+        REQUIRE(oc == taylor_outcome::time_limit);
+        REQUIRE(tm.get_time() == 10);
+
+        // The slow subsystem takes fewer timesteps.
+        REQUIRE(n_slow < n_fast);
+
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(abs(tm.get_state()[i] - ta.get_state()[i]) < fp_t(1E-6));
+        }
+
+        // Single steps and step limit.
+        REQUIRE(std::get<0>(tm.step()) == taylor_outcome::success);
+        REQUIRE(std::get<0>(tm.step(fp_t(1E-3))) == taylor_outcome::time_limit);
+        const auto res = tm.propagate_until(fp_t(20), 1);
+        REQUIRE(std::get<0>(res) == taylor_outcome::step_limit);
+        REQUIRE(std::get<1>(res) == 1u);
+
+        // Copy semantics.
+        auto tm2 = tm;
+        REQUIRE(tm2.get_state() == tm.get_state());
+        REQUIRE(tm2.step() == tm.step());
+        REQUIRE(tm2.get_state() == tm.get_state());
+
+        // Reset the state and the time.
+        tm.set_state(init_state);
+        tm.set_time(0);
+        tm.propagate_until(fp_t(10));
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(abs(tm.get_state()[i] - ta.get_state()[i]) < fp_t(1E-6));
+        }
+
+        // Error modes.
+        REQUIRE_THROWS_AS(tm.set_state({fp_t(0)}), std::invalid_argument);
+        REQUIRE_THROWS_AS(tm.step(std::numeric_limits<fp_t>::quiet_NaN()), std::invalid_argument);
+        REQUIRE_THROWS_AS(tm.propagate_until(std::numeric_limits<fp_t>::infinity()), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_multirate<fp_t>{sys, init_state, {}}), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_multirate<fp_t>{sys, init_state, {x1, v1, x2, v2}}), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_multirate<fp_t>{sys, init_state, {x1, x1}}), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_multirate<fp_t>{sys, init_state, {"y"_var}}), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_multirate<fp_t>{sys, init_state, {x1 + v1}}), std::invalid_argument);
+        REQUIRE_THROWS_AS((taylor_multirate<fp_t>{sys, {fp_t(0)}, {x1}}), std::invalid_argument);
+    };
+
+    for (auto cm : {false, true}) {
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, cm); });
+    }
+}
@@ -9,9 +9,16 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include <xtensor-blas/xlinalg.hpp>
@@ -21,6 +28,8 @@
 #include <xtensor/xview.hpp>
 
 #include <heyoka/detail/simple_timer.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/math/nbody_acc.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
@@ -41,6 +50,54 @@ TEST_CASE("N-body param")
     }
 }
 
+TEST_CASE("N-body param interactions")
+{
+    // 2 massive bodies and a massless body.
+    const auto n = 3u, n_massive = 2u;
+
+    const auto init_state = std::vector<double>{0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 2, 0, 0, 0, .7, 0};
+
+    // The reference integrator.
+    auto ta_ref = taylor_adaptive<double>{make_nbody_par_sys(n, kw::n_massive = n_massive), init_state,
+                                          kw::pars = std::vector<double>{1., 1e-3}};
+
+    // The masses, followed by the switches.
+    auto pars = std::vector<double>{1., 1e-3};
+    pars.resize(n_massive + n * n_massive, 1.);
+
+    auto ta = taylor_adaptive<double>{
+        make_nbody_par_sys(n, kw::n_massive = n_massive, kw::par_interactions = true), init_state, kw::pars = pars};
+
+    REQUIRE(ta.get_pars().size() == pars.size());
+
+    // With all the interactions active, the dynamics is unchanged.
+    ta_ref.propagate_until(10.);
+    ta.propagate_until(10.);
+    for (std::size_t i = 0; i < init_state.size(); ++i) {
+        REQUIRE(ta.get_state()[i] == approximately(ta_ref.get_state()[i], 10000.));
+    }
+
+    // Switch off the accelerations on the massless body: it
+    // moves on a straight line from now on.
+    ta.get_pars_data()[n_massive + 2u * n_massive] = 0;
+    ta.get_pars_data()[n_massive + 2u * n_massive + 1u] = 0;
+
+    const auto st = ta.get_state();
+    ta.propagate_for(1.);
+    for (auto j = 0u; j < 3u; ++j) {
+        REQUIRE(ta.get_state()[12u + j] == approximately(st[12u + j] + st[15u + j], 1000.));
+        REQUIRE(ta.get_state()[15u + j] == st[15u + j]);
+    }
+
+    // Switch off the acceleration exerted by the first body on the second one: the
+    // first body keeps on being attracted by the second one.
+    ta.get_pars_data()[n_massive + 1u * n_massive] = 0;
+    const auto v0 = ta.get_state()[3], v1 = ta.get_state()[9];
+    ta.propagate_for(1.);
+    REQUIRE(ta.get_state()[3] != v0);
+    REQUIRE(std::abs(ta.get_state()[9] - v1) < 1e-12);
+}
+
 // Test case for an issue that arised when using
 // null masses.
 TEST_CASE("zero mass")
@@ -199,3 +256,195 @@ TEST_CASE("N-body")
         }
     }
 }
+
+TEST_CASE("N-body fused")
+{
+    using Catch::Matchers::Message;
+
+    // Fully massive and restricted problems.
+    for (const auto &masses : {std::vector{1., 0.1, 0.01, 0.001}, std::vector{1., 0.1, 0., 0.}}) {
+        const auto sys = make_nbody_sys(4, kw::masses = masses, kw::Gconst = 1.1);
+        const auto sys_f = make_nbody_sys(4, kw::masses = masses, kw::Gconst = 1.1, kw::fused = true);
+
+        REQUIRE(sys_f.size() == sys.size());
+
+        const std::vector<double> init_state{// Body 0.
+                                             0., 0., 0., 0., 0., 0.,
+                                             // Body 1.
+                                             1., 0.1, 0., 0., 1., 0.05,
+                                             // Body 2.
+                                             0.2, -1.5, 0.1, 0.8, 0.1, 0.,
+                                             // Body 3.
+                                             -2., 0.3, -0.1, 0.05, -0.7, 0.};
+
+        // Compare the right-hand sides.
+        std::unordered_map<std::string, double> map;
+        for (std::size_t i = 0; i < sys.size(); ++i) {
+            map[std::get<variable>(sys[i].first.value()).name()] = init_state[i];
+        }
+
+        for (std::size_t i = 0; i < sys.size(); ++i) {
+            REQUIRE(sys_f[i].first == sys[i].first);
+            REQUIRE(eval_dbl(sys_f[i].second, map) == approximately(eval_dbl(sys[i].second, map), 1000.));
+
+            // Compare the symbolic derivatives too.
+            REQUIRE(eval_dbl(diff(sys_f[i].second, "x_1"), map)
+                    == approximately(eval_dbl(diff(sys[i].second, "x_1"), map), 1000.));
+        }
+
+        // The fused decomposition must be smaller.
+        REQUIRE(taylor_decompose(sys_f, {}).first.size() < taylor_decompose(sys, {}).first.size());
+
+        // Compare the integrations.
+        for (auto cm : {false, true}) {
+            for (auto ha : {false, true}) {
+                auto ta = taylor_adaptive<double>{sys, init_state, kw::high_accuracy = ha, kw::compact_mode = cm};
+                auto ta_f
+                    = taylor_adaptive<double>{sys_f, init_state, kw::high_accuracy = ha, kw::compact_mode = cm};
+
+                REQUIRE(std::get<0>(ta.propagate_until(5.)) == taylor_outcome::time_limit);
+                REQUIRE(std::get<0>(ta_f.propagate_until(5.)) == taylor_outcome::time_limit);
+
+                for (std::size_t i = 0; i < init_state.size(); ++i) {
+                    REQUIRE(ta_f.get_state()[i] == approximately(ta.get_state()[i], 1e6));
+                }
+            }
+        }
+    }
+
+    // Larger system in compact mode, with all the accelerations
+    // sharing the same derivative function.
+    {
+        const std::uint32_t n = 30;
+
+        std::vector<double> init_state;
+        for (std::uint32_t i = 0; i < n; ++i) {
+            const auto a = 1. + i;
+            const auto th = 0.3 * i;
+            const auto v = 1. / std::sqrt(a);
+
+            init_state.insert(init_state.end(),
+                              {a * std::cos(th), a * std::sin(th), 0.01 * i, -v * std::sin(th), v * std::cos(th), 0.});
+        }
+
+        std::vector<double> masses(n, 1e-6);
+        masses[0] = 1.;
+
+        auto ta = taylor_adaptive<double>{make_nbody_sys(n, kw::masses = masses), init_state, kw::compact_mode = true};
+        auto ta_f = taylor_adaptive<double>{make_nbody_sys(n, kw::masses = masses, kw::fused = true), init_state,
+                                            kw::compact_mode = true};
+
+        REQUIRE(ta_f.get_decomposition().size() < ta.get_decomposition().size());
+
+        ta.propagate_until(1.);
+        ta_f.propagate_until(1.);
+
+        for (std::size_t i = 0; i < init_state.size(); ++i) {
+            REQUIRE(ta_f.get_state()[i] == approximately(ta.get_state()[i], 1e6));
+        }
+    }
+
+    // Error modes.
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    REQUIRE_THROWS_MATCHES(nbody_acc(x, {1_dbl}, {y, z}, {z}), std::invalid_argument,
+                           Message("Inconsistent sizes detected while creating an N-body acceleration: the number of "
+                                   "coefficients is 1, the number of coordinates is 2 and the number of inverse cubed "
+                                   "distances is 1"));
+    REQUIRE_THROWS_MATCHES(nbody_acc(x, {}, {}, {}), std::invalid_argument,
+                           Message("At least one attracting body is needed to create an N-body acceleration"));
+
+    // Non-numerical coefficients are not supported in the Taylor derivatives.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{{prime(x) = nbody_acc(x, {y}, {y}, {z}), prime(y) = x, prime(z) = y},
+                                               {0.1, 0.2, 0.3}}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("N-body tree")
+{
+    using Catch::Matchers::Message;
+
+    // Two well-separated clusters of bodies.
+    const std::uint32_t n = 32;
+
+    std::vector<double> init_state, masses;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const auto off = i < n / 2u ? 0. : 100.;
+        const auto th = 0.7 * i;
+
+        init_state.insert(init_state.end(), {off + std::cos(th), std::sin(th), 0.1 * std::cos(1.3 * th),
+                                             -0.1 * std::sin(th), 0.1 * std::cos(th), 0.});
+        masses.push_back(1. + 0.01 * i);
+    }
+    // Add a massless body.
+    masses[3] = 0;
+
+    std::unordered_map<std::string, double> map;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        for (std::uint32_t c = 0; c < 6u; ++c) {
+            const char *names[] = {"x", "y", "z", "vx", "vy", "vz"};
+            map[std::string(names[c]) + "_" + std::to_string(i)] = init_state[6u * i + c];
+        }
+    }
+
+    const auto sys = make_nbody_sys(n, kw::masses = masses);
+
+    for (auto fused : {false, true}) {
+        // A tiny opening angle yields the exact accelerations.
+        const auto sys_e = make_nbody_sys(n, kw::masses = masses, kw::fused = fused, kw::theta = 1e-8,
+                                          kw::state = init_state);
+
+        const auto sys_t
+            = make_nbody_sys(n, kw::masses = masses, kw::fused = fused, kw::theta = .5, kw::state = init_state);
+
+        REQUIRE(sys_e.size() == sys.size());
+        REQUIRE(sys_t.size() == sys.size());
+
+        for (std::size_t i = 0; i < sys.size(); ++i) {
+            REQUIRE(sys_e[i].first == sys[i].first);
+            REQUIRE(sys_t[i].first == sys[i].first);
+
+            const auto ex = eval_dbl(sys[i].second, map);
+
+            REQUIRE(eval_dbl(sys_e[i].second, map) == approximately(ex, 1000.));
+            REQUIRE(std::abs(eval_dbl(sys_t[i].second, map) - ex) <= 1e-5 * (1 + std::abs(ex)));
+        }
+
+        // The far cluster is seen as a single body.
+        REQUIRE(taylor_decompose(sys_t, {}).first.size() < taylor_decompose(sys, {}).first.size());
+
+        // Short integrations.
+        auto ta = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true};
+        auto ta_t = taylor_adaptive<double>{sys_t, init_state, kw::compact_mode = true};
+
+        ta.propagate_until(.1);
+        ta_t.propagate_until(.1);
+
+        for (std::size_t i = 0; i < init_state.size(); ++i) {
+            REQUIRE(std::abs(ta_t.get_state()[i] - ta.get_state()[i]) <= 1e-5 * (1 + std::abs(ta.get_state()[i])));
+        }
+    }
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES(make_nbody_sys(2, kw::theta = -.5, kw::state = std::vector<double>(12u)),
+                           std::invalid_argument,
+                           Message("The opening angle of the tree approximation of an N-body system must be positive "
+                                   "and finite, but a value of -0.5 was provided instead"));
+    REQUIRE_THROWS_MATCHES(make_nbody_sys(2, kw::theta = .5, kw::state = std::vector<double>(11u)),
+                           std::invalid_argument,
+                           Message("The reference state for the tree approximation of an N-body system has a size of "
+                                   "11, but a size of 12 (i.e., 6 times the number of bodies) is required"));
+    REQUIRE_THROWS_MATCHES(make_nbody_sys(2, kw::theta = .5), std::invalid_argument,
+                           Message("The reference state for the tree approximation of an N-body system has a size of "
+                                   "0, but a size of 12 (i.e., 6 times the number of bodies) is required"));
+    REQUIRE_THROWS_MATCHES(make_nbody_sys(2, kw::theta = .5,
+                                          kw::state = std::vector(12u, std::numeric_limits<double>::infinity())),
+                           std::invalid_argument,
+                           Message("The reference state for the tree approximation of an N-body system must contain "
+                                   "only finite values"));
+    REQUIRE_THROWS_MATCHES(
+        make_nbody_sys(2, kw::masses = {1., -.5}, kw::theta = .5, kw::state = std::vector<double>(12u)),
+        std::invalid_argument,
+        Message("The masses in the tree approximation of an N-body system must be non-negative and finite, but a "
+                "value of -0.5 was provided instead"));
+}
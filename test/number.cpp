@@ -11,6 +11,8 @@
 #include <functional>
 #include <initializer_list>
 #include <limits>
+#include <utility>
+#include <variant>
 
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -35,6 +37,38 @@ using namespace mppp::literals;
 
 #endif
 
+TEST_CASE("number double fast path")
+{
+    // The results of the double-only fast path
+    // must be consistent with the general case.
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+
+    for (auto [a, b] : {std::pair{1.5, -2.25}, std::pair{0., -0.}, std::pair{3., 0.}, std::pair{nan, 1.}}) {
+        const number na{a}, nb{b};
+
+        for (const auto &res : {na + nb, na - nb, na * nb, na / nb, -na}) {
+            REQUIRE(std::holds_alternative<double>(res.value()));
+        }
+
+        REQUIRE((na + nb) == number{a + b});
+        REQUIRE((na - nb) == number{a - b});
+        REQUIRE((na * nb) == number{a * b});
+        REQUIRE((na / nb) == number{a / b});
+        REQUIRE(-na == number{-a});
+
+        REQUIRE((na == nb) == (number{static_cast<long double>(a)} == nb));
+        REQUIRE((na != nb) == (number{static_cast<long double>(a)} != nb));
+        REQUIRE(is_zero(na) == is_zero(number{static_cast<long double>(a)}));
+        REQUIRE(is_one(na) == is_one(number{static_cast<long double>(a)}));
+        REQUIRE(is_negative_one(-na) == is_negative_one(number{-static_cast<long double>(a)}));
+    }
+
+    REQUIRE(number{nan} == number{nan});
+
+    // Mixed types still go through the promotion.
+    REQUIRE(std::holds_alternative<long double>((number{1.} + number{2.l}).value()));
+}
+
 TEST_CASE("number hash eq")
 {
     auto hash_number = [](const number &n) { return hash(n); };
@@ -0,0 +1,224 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <initializer_list>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/output_sink.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// Helper to read the content of a binary file.
+template <typename T>
+std::vector<T> read_binary(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+    const std::vector<char> buf((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    REQUIRE(buf.size() % sizeof(T) == 0u);
+
+    std::vector<T> retval(buf.size() / sizeof(T));
+    std::copy(buf.begin(), buf.end(), reinterpret_cast<char *>(retval.data()));
+
+    return retval;
+}
+
+TEST_CASE("output sink raw")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    const std::string path = "heyoka_test_output_sink_raw.bin";
+
+    for (auto wtc : {false, true}) {
+        ta.set_time(0);
+        ta.get_state_data()[0] = 0.05;
+        ta.get_state_data()[1] = 0.025;
+
+        // NOTE: use a small capacity in order
+        // to exercise the blocking policy.
+        output_sink<double> sink{ta, path, kw::sink_capacity = 4u, kw::write_tc = wtc};
+
+        REQUIRE(sink.get_path() == path);
+        REQUIRE(sink.get_format() == sink_format::raw);
+        REQUIRE(sink.get_policy() == sink_policy::block);
+        REQUIRE(sink.get_capacity() == 4u);
+        REQUIRE(sink.get_write_tc() == wtc);
+        REQUIRE(!sink.is_closed());
+
+        // Record the expected content of the file.
+        std::vector<double> ref;
+        auto cb = [&](taylor_adaptive<double> &t) {
+            ref.push_back(t.get_time());
+            ref.push_back(0);
+            ref.push_back(t.get_last_h());
+            ref.insert(ref.end(), t.get_state().begin(), t.get_state().end());
+            if (wtc) {
+                ref.insert(ref.end(), t.get_tc().begin(), t.get_tc().end());
+            }
+
+            REQUIRE(sink.push(t));
+
+            return true;
+        };
+
+        ta.propagate_until(10., kw::callback = cb, kw::write_tc = wtc);
+
+        sink.drain();
+        REQUIRE(sink.get_n_written() == sink.get_n_pushed());
+
+        sink.close();
+        REQUIRE(sink.is_closed());
+        REQUIRE(sink.get_n_dropped() == 0u);
+        REQUIRE(sink.get_n_pushed() > 4u);
+
+        // Closing again is a no-op.
+        sink.close();
+
+        const auto out = read_binary<double>(path);
+        const auto rec_size = 5u + (wtc ? ta.get_tc().size() : 0u);
+
+        REQUIRE(out.size() == sink.get_n_pushed() * rec_size);
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            // NOTE: the lo part of the time is not
+            // available via the public API.
+            if (i % rec_size != 1u) {
+                REQUIRE(out[i] == ref[i]);
+            }
+        }
+
+        // Cannot push into a closed sink.
+        REQUIRE_THROWS_AS(sink.push(ta), std::invalid_argument);
+    }
+
+    std::remove(path.c_str());
+
+    // Error modes.
+    REQUIRE_THROWS_AS(output_sink<double>(ta, path, kw::sink_capacity = 0u), std::invalid_argument);
+    REQUIRE_THROWS_AS(output_sink<double>(ta, "heyoka_nonexistent_dir/out.bin"), std::invalid_argument);
+
+    {
+        auto ta2 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::tol = 1e-4};
+
+        output_sink<double> sink{ta, path};
+        REQUIRE_THROWS_AS(sink.push(ta2), std::invalid_argument);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("output sink drop")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+    ta.step();
+
+    const std::string path = "heyoka_test_output_sink_drop.bin";
+
+    std::size_t n_pushed = 0;
+
+    {
+        output_sink<double> sink{ta, path, kw::sink_capacity = 1u, kw::sink_policy = sink_policy::drop};
+
+        for (auto i = 0; i < 1000; ++i) {
+            n_pushed += sink.push(ta);
+        }
+
+        REQUIRE(sink.get_n_pushed() == n_pushed);
+        REQUIRE(sink.get_n_pushed() + sink.get_n_dropped() == 1000u);
+
+        sink.close();
+
+        REQUIRE(sink.get_n_written() == n_pushed);
+    }
+
+    const auto out = read_binary<double>(path);
+    REQUIRE(out.size() == n_pushed * 5u);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("output sink ephemeris")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {fp_t(0.05), fp_t(0.025)}};
+
+        const std::string path = "heyoka_test_output_sink_eph_" + std::to_string(sizeof(fp_t)) + ".bin";
+
+        // Cannot write an ephemeris without steps.
+        {
+            output_sink<fp_t> sink{ta, path, kw::sink_format = sink_format::ephemeris};
+            REQUIRE(sink.get_write_tc());
+            REQUIRE_THROWS_AS(sink.close(), std::invalid_argument);
+        }
+
+        auto co = continuous_output<fp_t>{ta};
+
+        output_sink<fp_t> sink{ta, path, kw::sink_format = sink_format::ephemeris, kw::sink_capacity = 8u};
+
+        auto cb = [&sink](taylor_adaptive<fp_t> &t) { return sink.push(t); };
+        ta.propagate_until(fp_t(10), kw::c_output = co, kw::callback = cb);
+
+        sink.close();
+
+        auto eph = ephemeris<fp_t>{path};
+
+        REQUIRE(eph.get_dim() == 2u);
+        REQUIRE(eph.get_order() == co.get_order());
+        REQUIRE(eph.get_n_steps() == co.get_n_steps());
+        REQUIRE(eph.get_bounds() == co.get_bounds());
+
+        // The evaluation must match exactly the continuous output.
+        for (auto i = 0; i < 100; ++i) {
+            const auto t = fp_t(i) / 10;
+
+            REQUIRE(eph(t) == co(t));
+        }
+
+        std::remove(path.c_str());
+    };
+
+    tuple_for_each(fp_types, tester);
+}
@@ -0,0 +1,147 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/parareal.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("parareal")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto fine = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -x}, {fp_t(0), fp_t(1)});
+        auto coarse = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -x}, {fp_t(0), fp_t(1)}, kw::tol = fp_t(1e-4));
+
+        for (auto n_threads : {0u, 1u, 3u}) {
+            auto res = parareal_propagate_until<fp_t>(fine, coarse, fp_t(20), 8, kw::n_threads = n_threads);
+
+            REQUIRE(res.converged);
+            REQUIRE(res.n_iter > 1u);
+            REQUIRE(res.n_iter <= 8u);
+            REQUIRE(res.times.size() == 9u);
+            REQUIRE(res.times.front() == 0);
+            REQUIRE(res.times.back() == 20);
+            REQUIRE(res.states.size() == 18u);
+
+            // Compare with the sequential fine propagation.
+            auto ta = fine;
+            for (auto i = 1u; i < 9u; ++i) {
+                ta.propagate_until(res.times[i]);
+
+                REQUIRE(res.states[i * 2u] == approximately(ta.get_state()[0], fp_t(10000)));
+                REQUIRE(res.states[i * 2u + 1u] == approximately(ta.get_state()[1], fp_t(10000)));
+            }
+
+            // Limit the number of iterations.
+            res = parareal_propagate_until<fp_t>(fine, coarse, fp_t(20), 8, kw::n_threads = n_threads,
+                                                 kw::max_iter = 1u);
+
+            REQUIRE(!res.converged);
+            REQUIRE(res.n_iter == 1u);
+            REQUIRE(res.err > std::numeric_limits<fp_t>::epsilon() * 100);
+
+            // With a zero tolerance, all the iterations are performed.
+            res = parareal_propagate_until<fp_t>(fine, coarse, fp_t(20), 8, kw::n_threads = n_threads,
+                                                 kw::tol = fp_t(0));
+
+            REQUIRE(res.converged);
+            REQUIRE(res.n_iter == 8u);
+        }
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("parareal pars")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // The parameters are taken from the fine integrator.
+    auto fine = taylor_adaptive<double>({prime(x) = v, prime(v) = -par[0] * sin(x)}, {0.05, 0.025},
+                                        kw::pars = {9.8});
+    auto coarse = taylor_adaptive<double>({prime(x) = v, prime(v) = -par[0] * sin(x)}, {0.05, 0.025},
+                                          kw::pars = {1.}, kw::tol = 1e-6);
+
+    auto res = parareal_propagate_until<double>(fine, coarse, 10., 4);
+
+    REQUIRE(res.converged);
+
+    fine.propagate_until(10.);
+
+    REQUIRE(res.states[8] == approximately(fine.get_state()[0], 10000.));
+    REQUIRE(res.states[9] == approximately(fine.get_state()[1], 10000.));
+
+    // The input integrators are not modified.
+    REQUIRE(coarse.get_time() == 0);
+    REQUIRE(coarse.get_pars()[0] == 1.);
+}
+
+TEST_CASE("parareal error handling")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto fine = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0., 1.});
+
+    REQUIRE_THROWS_MATCHES(parareal_propagate_until<double>(fine, fine, 10., 0), std::invalid_argument,
+                           Message("The number of time slices in a parareal propagation must be nonzero"));
+    REQUIRE_THROWS_MATCHES(parareal_propagate_until<double>(fine, fine, std::numeric_limits<double>::infinity(), 4),
+                           std::invalid_argument,
+                           Message("The initial and final times in a parareal propagation must be finite"));
+    REQUIRE_THROWS_MATCHES(parareal_propagate_until<double>(fine, fine, 10., 4, kw::tol = -1.),
+                           std::invalid_argument,
+                           Message("The tolerance in a parareal propagation must be non-negative, but it is -1 "
+                                   "instead"));
+
+    auto coarse = taylor_adaptive<double>({prime(x) = x}, {1.});
+    REQUIRE_THROWS_MATCHES(parareal_propagate_until<double>(fine, coarse, 10., 4), std::invalid_argument,
+                           Message("The dimension of the fine integrator (2) is inconsistent with the dimension of "
+                                   "the coarse integrator (1) in a parareal propagation"));
+
+    auto fine_ev = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0., 1.},
+                                           kw::t_events = {t_event<double>(x - 10.)});
+    REQUIRE_THROWS_MATCHES(parareal_propagate_until<double>(fine_ev, fine, 10., 4), std::invalid_argument,
+                           Message("Integrators with events are not supported in a parareal propagation"));
+
+    // Failure in the propagation of a slice.
+    REQUIRE_THROWS_AS(parareal_propagate_until<double>(fine, fine, 100., 2, kw::max_steps = 1u), std::runtime_error);
+}
@@ -0,0 +1,228 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/resumable_propagation.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("resumable until")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -9.8 * sin(x)}, {fp_t(0.05), fp_t(0.025)});
+        auto ta_sync = ta;
+
+        auto cb = [](taylor_adaptive<fp_t> &) { return true; };
+
+        for (auto max_steps : {1u, 3u, 7u}) {
+            auto rp = resumable_propagation<fp_t>(ta, ta.get_time() + fp_t(20));
+
+            std::size_t n_resumes = 0;
+            while (!rp.is_done()) {
+                const auto oc = rp.resume(max_steps);
+                ++n_resumes;
+
+                REQUIRE((oc == taylor_outcome::step_limit) == !rp.is_done());
+            }
+
+            // NOTE: pass a callback in order to avoid
+            // the multi-step driver in propagate_until().
+            const auto [oc, min_h, max_h, n_steps]
+                = ta_sync.propagate_until(ta_sync.get_time() + fp_t(20), kw::callback = cb);
+
+            REQUIRE(rp.get_outcome() == oc);
+            REQUIRE(rp.get_outcome() == taylor_outcome::time_limit);
+            REQUIRE(rp.get_step_counter() == n_steps);
+            REQUIRE(rp.get_min_h() == min_h);
+            REQUIRE(rp.get_max_h() == max_h);
+            REQUIRE(n_resumes == (n_steps + max_steps - 1u) / max_steps);
+
+            REQUIRE(ta.get_time() == ta_sync.get_time());
+            REQUIRE(ta.get_state() == ta_sync.get_state());
+
+            // Resuming a completed propagation does nothing.
+            REQUIRE(rp.resume() == taylor_outcome::time_limit);
+            REQUIRE(ta.get_state() == ta_sync.get_state());
+        }
+
+        // Backward propagation with max_delta_t and
+        // a wall-clock time budget.
+        auto rp = resumable_propagation<fp_t>(ta, fp_t(0), kw::max_delta_t = fp_t(0.1), kw::write_tc = true);
+        while (!rp.is_done()) {
+            rp.resume(0, std::chrono::microseconds(10));
+        }
+        const auto [oc, min_h, max_h, n_steps]
+            = ta_sync.propagate_until(fp_t(0), kw::max_delta_t = fp_t(0.1), kw::write_tc = true, kw::callback = cb);
+
+        REQUIRE(rp.get_outcome() == oc);
+        REQUIRE(rp.get_step_counter() == n_steps);
+        REQUIRE(ta.get_time() == 0);
+        REQUIRE(ta.get_state() == ta_sync.get_state());
+        REQUIRE(ta.get_tc() == ta_sync.get_tc());
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("resumable grid")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto ta = taylor_adaptive<fp_t>({prime(x) = v, prime(v) = -9.8 * sin(x)}, {fp_t(0.05), fp_t(0.025)});
+        auto ta_sync = ta;
+
+        std::vector<fp_t> grid;
+        for (auto i = 0; i < 100; ++i) {
+            grid.push_back(fp_t(1) + fp_t(i) / 5);
+        }
+
+        auto rp = resumable_propagation<fp_t>(ta, grid);
+
+        std::size_t prev_idx = 0;
+        while (rp.resume(1) == taylor_outcome::step_limit) {
+            REQUIRE(rp.get_grid_idx() >= prev_idx);
+            REQUIRE(rp.get_output().size() == rp.get_grid_idx() * 2u);
+            prev_idx = rp.get_grid_idx();
+        }
+
+        const auto res = ta_sync.propagate_grid(grid);
+
+        REQUIRE(rp.get_outcome() == taylor_outcome::time_limit);
+        REQUIRE(rp.get_grid_idx() == grid.size());
+        REQUIRE(rp.get_output().size() == std::get<4>(res).size());
+
+        for (decltype(grid.size()) i = 0; i < std::get<4>(res).size(); ++i) {
+            REQUIRE(rp.get_output()[i] == approximately(std::get<4>(res)[i], fp_t(1000)));
+        }
+
+        REQUIRE(ta.get_time() == grid.back());
+
+        // Single grid point.
+        auto rp1 = resumable_propagation<fp_t>(ta, std::vector<fp_t>{fp_t(30)});
+        REQUIRE(rp1.resume() == taylor_outcome::time_limit);
+        REQUIRE(rp1.get_output() == ta.get_state());
+        REQUIRE(ta.get_time() == 30);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("resumable round robin")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Several integrators advanced in turn.
+    std::vector<taylor_adaptive<double>> tas;
+    for (auto i = 0; i < 4; ++i) {
+        tas.emplace_back(std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)}, std::vector{0.05 * (i + 1), 0.025});
+    }
+    auto tas_sync = tas;
+
+    std::vector<resumable_propagation<double>> rps;
+    for (auto &ta : tas) {
+        rps.emplace_back(ta, 10.);
+    }
+
+    for (auto n_done = 0u; n_done < rps.size();) {
+        n_done = 0;
+        for (auto &rp : rps) {
+            rp.resume(2);
+            n_done += static_cast<unsigned>(rp.is_done());
+        }
+    }
+
+    for (decltype(tas.size()) i = 0; i < tas.size(); ++i) {
+        tas_sync[i].propagate_until(10., kw::callback = [](taylor_adaptive<double> &) { return true; });
+
+        REQUIRE(tas[i].get_state() == tas_sync[i].get_state());
+    }
+}
+
+TEST_CASE("resumable terminal event")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025},
+                                      kw::t_events = {t_event<double>(v)});
+
+    auto rp = resumable_propagation<double>(ta, 100.);
+    while (!rp.is_done()) {
+        rp.resume(1);
+    }
+
+    REQUIRE(rp.get_outcome() == taylor_outcome{-1});
+    REQUIRE(ta.get_time() < 100.);
+}
+
+TEST_CASE("resumable error handling")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0., 1.});
+
+    REQUIRE_THROWS_MATCHES(resumable_propagation<double>(ta, std::numeric_limits<double>::infinity()),
+                           std::invalid_argument,
+                           Message("A non-finite time value was passed to the constructor of a resumable propagation"));
+    REQUIRE_THROWS_MATCHES(resumable_propagation<double>(ta, 10., kw::max_delta_t = -1.), std::invalid_argument,
+                           Message("A non-positive max_delta_t was passed to the constructor of a resumable "
+                                   "propagation"));
+    REQUIRE_THROWS_MATCHES(resumable_propagation<double>(ta, std::vector<double>{}), std::invalid_argument,
+                           Message("Cannot create a resumable propagation with an empty time grid"));
+    REQUIRE_THROWS_MATCHES(resumable_propagation<double>(ta, std::vector<double>{1., 2., 1.5}),
+                           std::invalid_argument,
+                           Message("A non-monotonic time grid was passed to the constructor of a resumable "
+                                   "propagation"));
+    REQUIRE_THROWS_MATCHES(resumable_propagation<double>(ta, std::vector<double>{1., 1.}), std::invalid_argument,
+                           Message("A non-monotonic time grid was passed to the constructor of a resumable "
+                                   "propagation"));
+
+    ta.set_time(std::numeric_limits<double>::quiet_NaN());
+    REQUIRE_THROWS_MATCHES(resumable_propagation<double>(ta, 10.), std::invalid_argument,
+                           Message("Cannot create a resumable propagation for an adaptive Taylor integrator if the "
+                                   "current time is not finite"));
+}
@@ -6,8 +6,11 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <cmath>
 #include <initializer_list>
 #include <iostream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <heyoka/expression.hpp>
@@ -57,3 +60,57 @@ TEST_CASE("merc")
 
     std::cout << "Mercury: " << ta.get_decomposition().size() << '\n';
 }
+
+TEST_CASE("simplify")
+{
+    auto [x, y, z] = make_vars("x", "y", "z");
+
+    // Collection of like terms.
+    REQUIRE(simplify(2. * x + y - x) == x + y);
+    REQUIRE(simplify(x - x) == 0_dbl);
+    REQUIRE(simplify(x + 1. + y + 2.) == x + y + 3.);
+    REQUIRE(simplify(3. * x - (-x)) == 4. * x);
+    REQUIRE(simplify(sum({x, y, x, z})) == sum({2. * x, y, z}));
+
+    // Merging of powers.
+    REQUIRE(simplify(x * x * x * x * x) == pow(x, 5.));
+    REQUIRE(simplify(x * y / x) == y);
+    REQUIRE(simplify(sqrt(x) * sqrt(x) * sqrt(x)) == pow(x, 1.5));
+    REQUIRE(simplify(square(x) * pow(x, 3.)) == pow(x, 5.));
+    REQUIRE(simplify(2. * x * 3. * x) == 6. * square(x));
+    REQUIRE(simplify(-x * -y) == x * y);
+    REQUIRE(simplify(x / (y * y)) == x / square(y));
+
+    // Non-integral powers of products and powers are not expanded.
+    REQUIRE(simplify(sqrt(x * y)) == sqrt(x * y));
+    REQUIRE(simplify(sqrt(square(x))) == sqrt(square(x)));
+
+    // Nested simplifications.
+    REQUIRE(simplify(cos(x * x * x * x * x) + cos(pow(x, 5.))) == 2. * cos(pow(x, 5.)));
+
+    // The decomposition of the simplified system is smaller.
+    auto sys = std::vector{prime(x) = x * x * x * x * x + y - y + z * 2. - z, prime(y) = x * y / x,
+                           prime(z) = sqrt(z) * sqrt(z) * sqrt(z)};
+
+    std::vector<expression> rhs;
+    for (const auto &[_, r] : sys) {
+        rhs.push_back(r);
+    }
+    const auto s_rhs = simplify(rhs);
+
+    auto s_sys = sys;
+    for (decltype(sys.size()) i = 0; i < sys.size(); ++i) {
+        s_sys[i].second = s_rhs[i];
+    }
+
+    const auto dc = taylor_decompose(sys, {}).first;
+    const auto s_dc = taylor_decompose(s_sys, {}).first;
+    REQUIRE(s_dc.size() < dc.size());
+
+    // The simplified expressions evaluate to the same values.
+    const std::unordered_map<std::string, double> vals{{"x", 1.1}, {"y", 2.3}, {"z", 3.4}};
+    for (decltype(rhs.size()) i = 0; i < rhs.size(); ++i) {
+        REQUIRE(std::abs(eval_dbl(rhs[i], vals) - eval_dbl(s_rhs[i], vals))
+                <= 1e-14 * std::abs(eval_dbl(rhs[i], vals)));
+    }
+}
@@ -0,0 +1,145 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <boost/math/constants/constants.hpp>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/sundman.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+namespace hy = heyoka;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("sundman transform")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -x};
+
+    const auto tsys = sundman_transform(sys, x * x + 1_dbl);
+    REQUIRE(tsys.size() == 3u);
+    REQUIRE(tsys[0].first == x);
+    REQUIRE(tsys[0].second == (x * x + 1_dbl) * v);
+    REQUIRE(tsys[2].first == "t"_var);
+    REQUIRE(tsys[2].second == x * x + 1_dbl);
+
+    REQUIRE(sundman_transform(sys, 1_dbl, "tau")[2].first == "tau"_var);
+
+    // Error modes.
+    REQUIRE_THROWS_AS(sundman_transform({}, 1_dbl), std::invalid_argument);
+    REQUIRE_THROWS_AS(sundman_transform(sys, x + hy::time), std::invalid_argument);
+    REQUIRE_THROWS_AS(sundman_transform(sys, x + "y"_var), std::invalid_argument);
+    REQUIRE_THROWS_AS(sundman_transform(sys, 1_dbl, "x"), std::invalid_argument);
+    REQUIRE_THROWS_AS(sundman_transform({prime(x) = v + hy::time, prime(v) = -x}, 1_dbl), std::invalid_argument);
+
+    // Time transformation functions for N-body systems.
+    REQUIRE(get_variables(make_nbody_sundman_g(3)).size() == 9u);
+    REQUIRE(get_variables(make_nbody_sundman_g(3, {{0, 2}})).size() == 6u);
+    REQUIRE_THROWS_AS(make_nbody_sundman_g(1), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_sundman_g(3, {{0, 0}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_sundman_g(3, {{0, 3}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_sundman_g(3, {}, -1.), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_nbody_sundman_g(3, {}, std::numeric_limits<double>::infinity()), std::invalid_argument);
+}
+
+TEST_CASE("sundman eccentric two-body")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        using std::abs;
+        using std::sqrt;
+
+        // Highly eccentric two-body orbit, starting at the apocentre
+        // (unit masses and semi-major axis).
+        const auto e = fp_t(99) / 100;
+        const auto mu = fp_t(2);
+        const auto r_a = 1 + e;
+        const auto v_a = sqrt(mu * (1 - e) / r_a);
+        const auto period = fp_t(2 * boost::math::constants::pi<double>() / std::sqrt(2.));
+
+        const auto init_state
+            = std::vector<fp_t>{-r_a / 2, 0, 0, 0, -v_a / 2, 0, r_a / 2, 0, 0, 0, v_a / 2, 0};
+
+        const auto sys = make_nbody_sys(2);
+
+        // Physical time formulation.
+        auto ta = taylor_adaptive<fp_t>{sys, init_state};
+        const auto n_steps_phys = std::get<3>(ta.propagate_until(period));
+
+        // Sundman-regularised formulation.
+        auto sinit_state = init_state;
+        sinit_state.push_back(0);
+        auto ta_s = taylor_adaptive<fp_t>{sundman_transform(sys, make_nbody_sundman_g(2)), sinit_state};
+
+        const auto [oc, n_steps_s] = sundman_propagate_until(ta_s, period);
+        REQUIRE(oc == taylor_outcome::time_limit);
+        REQUIRE(ta_s.get_state()[12] == period);
+
+        // The close encounter requires far fewer steps
+        // in the regularised formulation.
+        REQUIRE(n_steps_s * 2u < n_steps_phys);
+
+        // Check the final state against the physical
+        // time formulation.
+        for (auto i = 0u; i < 12u; ++i) {
+            REQUIRE(abs(ta_s.get_state()[i] - ta.get_state()[i]) < fp_t(1E-8));
+        }
+
+        // Backwards propagation to the initial state.
+        REQUIRE(std::get<0>(sundman_propagate_until(ta_s, fp_t(0))) == taylor_outcome::time_limit);
+        REQUIRE(ta_s.get_state()[12] == 0);
+        for (auto i = 0u; i < 12u; ++i) {
+            REQUIRE(abs(ta_s.get_state()[i] - init_state[i]) < fp_t(1E-8));
+        }
+
+        // Step limit.
+        REQUIRE(sundman_propagate_until(ta_s, period, 2)
+                == std::tuple{taylor_outcome::step_limit, std::size_t(2)});
+
+        // Propagation to the current time.
+        const auto cur_t = ta_s.get_state()[12];
+        REQUIRE(sundman_propagate_until(ta_s, cur_t) == std::tuple{taylor_outcome::time_limit, std::size_t(0)});
+
+        // Error modes.
+        REQUIRE_THROWS_AS(sundman_propagate_until(ta_s, std::numeric_limits<fp_t>::infinity()),
+                          std::invalid_argument);
+    };
+
+    tuple_for_each(fp_types, tester);
+}
@@ -7,15 +7,22 @@
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <initializer_list>
 #include <limits>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -27,6 +34,8 @@
 
 #include <heyoka/expression.hpp>
 #include <heyoka/math/sin.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/math/time.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
@@ -233,8 +242,33 @@ TEST_CASE("propagate grid scalar")
     REQUIRE(std::get<4>(out)[4] == approximately(std::sin(100.), 1000.));
     REQUIRE(std::get<4>(out)[5] == approximately(std::cos(100.), 1000.));
 
-    // A case in which the initial propagate_until() to bring the system
-    // to grid[0] interrupts the integration.
+    // The first grid point is computed via dense output, so that
+    // the timesteps are the same as in propagate_until().
+    ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+    auto ta_copy = ta;
+
+    out = ta.propagate_grid({.1, 10., 100.});
+    auto n_steps = std::get<3>(ta_copy.propagate_until(100.));
+
+    REQUIRE(std::get<0>(out) == taylor_outcome::time_limit);
+    REQUIRE(std::get<3>(out) == n_steps);
+    REQUIRE(ta.get_state()[0] == approximately(ta_copy.get_state()[0]));
+    REQUIRE(ta.get_state()[1] == approximately(ta_copy.get_state()[1]));
+    REQUIRE(std::get<4>(out)[0] == approximately(std::sin(.1), 100.));
+    REQUIRE(std::get<4>(out)[1] == approximately(std::cos(.1), 100.));
+
+    // Same backwards.
+    out = ta.propagate_grid({99.9, 90., 0.});
+    n_steps = std::get<3>(ta_copy.propagate_until(0.));
+
+    REQUIRE(std::get<0>(out) == taylor_outcome::time_limit);
+    REQUIRE(std::get<3>(out) == n_steps);
+    REQUIRE(ta.get_time() == 0.);
+    REQUIRE(std::get<4>(out)[0] == approximately(std::sin(99.9), 1000.));
+    REQUIRE(std::get<4>(out)[3] == approximately(std::cos(90.), 1000.));
+
+    // A case in which a terminal event before grid[0]
+    // interrupts the integration.
     ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::t_events = {t_event<double>(v - 0.999)}};
     out = ta.propagate_grid({10., 100.});
     REQUIRE(std::get<0>(out) == taylor_outcome{-1});
@@ -725,6 +759,126 @@ TEST_CASE("dense output")
     }
 }
 
+TEST_CASE("dense output multi")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Scalar test.
+    for (auto ha : {false, true}) {
+        for (auto opt_level : {0u, 3u}) {
+            auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                              {0.05, 0.025},
+                                              kw::high_accuracy = ha,
+                                              kw::opt_level = opt_level};
+
+            ta.step(true);
+            ta.step(true);
+
+            // NOTE: use a number of time coordinates which
+            // is not a multiple of the SIMD vector width.
+            for (std::size_t n : {0u, 1u, 3u, 17u}) {
+                std::vector<double> times(n), rel_times(n);
+                for (std::size_t i = 0; i < n; ++i) {
+                    rel_times[i] = -ta.get_last_h() * static_cast<double>(i) / 16;
+                    times[i] = ta.get_time() + rel_times[i];
+                }
+
+                std::vector<double> out(2u * n), rel_out(2u * n);
+                ta.update_d_output(times.data(), n, out.data());
+                ta.update_d_output(rel_times.data(), n, rel_out.data(), true);
+
+                for (std::size_t i = 0; i < n; ++i) {
+                    const auto ref = ta.update_d_output(times[i]);
+
+                    REQUIRE(out[2u * i] == approximately(ref[0]));
+                    REQUIRE(out[2u * i + 1u] == approximately(ref[1]));
+
+                    const auto rel_ref = ta.update_d_output(rel_times[i], true);
+
+                    REQUIRE(rel_out[2u * i] == approximately(rel_ref[0]));
+                    REQUIRE(rel_out[2u * i + 1u] == approximately(rel_ref[1]));
+                }
+            }
+
+            // Copy and s11n.
+            const std::vector<double> times{ta.get_time(), ta.get_time() - ta.get_last_h() / 2, 0.1, 0.2, 0.3};
+            std::vector<double> out(10u), out2(10u);
+            ta.update_d_output(times.data(), times.size(), out.data());
+
+            auto ta2 = ta;
+            ta2.update_d_output(times.data(), times.size(), out2.data());
+            REQUIRE(out2 == out);
+
+            std::stringstream ss;
+            ta.save(ss);
+            auto ta3 = taylor_adaptive<double>::load(ss);
+            std::fill(out2.begin(), out2.end(), 0.);
+            ta3.update_d_output(times.data(), times.size(), out2.data());
+            REQUIRE(out2 == out);
+
+            // Null pointers are allowed only for zero time coordinates.
+            ta.update_d_output(static_cast<const double *>(nullptr), 0, static_cast<double *>(nullptr));
+            REQUIRE_THROWS_AS(ta.update_d_output(static_cast<const double *>(nullptr), 1, out.data()),
+                              std::invalid_argument);
+            REQUIRE_THROWS_AS(ta.update_d_output(times.data(), 1, static_cast<double *>(nullptr)),
+                              std::invalid_argument);
+        }
+    }
+
+    // Batch test.
+    for (auto batch_size : {1u, 4u}) {
+        std::vector<double> init_state;
+        for (auto i = 0u; i < batch_size; ++i) {
+            init_state.push_back(0.05 + i / 100.);
+        }
+        for (auto i = 0u; i < batch_size; ++i) {
+            init_state.push_back(0.025 + i / 1000.);
+        }
+
+        auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, init_state, batch_size};
+
+        ta.step(true);
+
+        const std::size_t n = 5;
+
+        std::vector<double> times(n * batch_size);
+        for (std::size_t j = 0; j < n; ++j) {
+            for (auto i = 0u; i < batch_size; ++i) {
+                times[j * batch_size + i] = ta.get_time()[i] - ta.get_last_h()[i] * static_cast<double>(j) / 4;
+            }
+        }
+
+        std::vector<double> out(n * 2u * batch_size);
+        ta.update_d_output(times.data(), n, out.data());
+
+        for (std::size_t j = 0; j < n; ++j) {
+            const auto ref = ta.update_d_output(
+                std::vector<double>(times.begin() + j * batch_size, times.begin() + (j + 1u) * batch_size));
+
+            for (auto k = 0u; k < 2u * batch_size; ++k) {
+                REQUIRE(out[j * 2u * batch_size + k] == ref[k]);
+            }
+        }
+
+        ta.update_d_output(static_cast<const double *>(nullptr), 0, static_cast<double *>(nullptr));
+        REQUIRE_THROWS_AS(ta.update_d_output(times.data(), 1, static_cast<double *>(nullptr)), std::invalid_argument);
+
+        // Time coordinates in the (batch_size, n) layout.
+        std::vector<double> lane_times(n * batch_size);
+        for (auto i = 0u; i < batch_size; ++i) {
+            for (std::size_t j = 0; j < n; ++j) {
+                lane_times[i * n + j] = times[j * batch_size + i];
+            }
+        }
+
+        REQUIRE(ta.update_d_output_lanes(lane_times) == out);
+        REQUIRE(ta.update_d_output_lanes({}).empty());
+        if (batch_size > 1u) {
+            REQUIRE_THROWS_AS(ta.update_d_output_lanes({1.}), std::invalid_argument);
+        }
+    }
+}
+
 TEST_CASE("taylor tc basic")
 {
     // Scalar test.
@@ -1137,6 +1291,246 @@ TEST_CASE("propagate grid")
     }
 }
 
+// Test the propagate_grid() overload writing into
+// an output buffer, and the selection of the output components.
+TEST_CASE("propagate grid dense")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // A grid with many points per timestep.
+    std::vector<double> grid;
+    for (auto i = 0; i < 1001; ++i) {
+        grid.push_back(i / 100.);
+    }
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta_comps = ta;
+
+    const auto out = std::get<4>(ta.propagate_grid(grid));
+    REQUIRE(out.size() == grid.size() * 2u);
+
+    // The selection of the components goes through a different code path.
+    const auto out_comps
+        = std::get<4>(ta_comps.propagate_grid(grid, kw::components = std::vector<std::uint32_t>{0, 1}));
+    REQUIRE(out_comps == out);
+
+    // The dense output of the last grid point.
+    REQUIRE(ta.get_d_output() == std::vector<double>{out[2000], out[2001]});
+
+    // Compare with the propagation to the single grid points.
+    auto ta_ref = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    for (auto i = 0u; i < grid.size(); i += 50u) {
+        ta_ref.propagate_until(grid[i]);
+
+        REQUIRE(out[2u * i] == approximately(ta_ref.get_state()[0], 10000.));
+        REQUIRE(out[2u * i + 1u] == approximately(ta_ref.get_state()[1], 10000.));
+    }
+}
+
+TEST_CASE("propagate grid out")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v, y] = make_vars("x", "v", "y");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x), prime(y) = x}, {0.05, 0.025, 0.}};
+    auto ta_copy = ta;
+
+    const std::vector<double> grid{1., 2., 3.};
+
+    const auto ref = std::get<4>(ta_copy.propagate_grid(grid));
+    REQUIRE(ref.size() == 9u);
+
+    // Subset of the components, with padding between the rows.
+    std::vector<double> out(9u, -1.);
+    auto [oc, _1, _2, _3, n_written]
+        = ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{2, 0}, kw::stride = 3u);
+
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(n_written == 3u);
+    REQUIRE(ta.get_time() == 3.);
+
+    for (auto i = 0u; i < 3u; ++i) {
+        REQUIRE(out[3u * i] == ref[3u * i + 2u]);
+        REQUIRE(out[3u * i + 1u] == ref[3u * i]);
+        REQUIRE(out[3u * i + 2u] == -1.);
+    }
+
+    // All components, default stride.
+    ta.set_time(0.);
+    ta.get_state_data()[0] = 0.05;
+    ta.get_state_data()[1] = 0.025;
+    ta.get_state_data()[2] = 0.;
+
+    std::fill(out.begin(), out.end(), -1.);
+    std::tie(oc, _1, _2, _3, n_written) = ta.propagate_grid(grid, out.data());
+
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(n_written == 3u);
+    REQUIRE(out == ref);
+
+    // Subset of the components in the vector overload.
+    ta.set_time(0.);
+    ta.get_state_data()[0] = 0.05;
+    ta.get_state_data()[1] = 0.025;
+    ta.get_state_data()[2] = 0.;
+
+    auto vout = std::get<4>(ta.propagate_grid(grid, kw::components = std::vector<std::uint32_t>{1}));
+    REQUIRE(vout == std::vector{ref[1], ref[4], ref[7]});
+
+    // Early stop: only the first grid point is written.
+    ta.set_time(0.);
+    std::tie(oc, _1, _2, _3, vout) = ta.propagate_grid({0., 5., 10.}, kw::max_steps = 1u, kw::max_delta_t = 1e-3);
+
+    REQUIRE(oc == taylor_outcome::step_limit);
+    REQUIRE(vout.size() == 3u);
+
+    ta.set_time(0.);
+    std::fill(out.begin(), out.end(), -1.);
+    std::tie(oc, _1, _2, _3, n_written)
+        = ta.propagate_grid({0., 5., 10.}, out.data(), kw::max_steps = 1u, kw::max_delta_t = 1e-3);
+
+    REQUIRE(oc == taylor_outcome::step_limit);
+    REQUIRE(n_written == 1u);
+    REQUIRE(std::all_of(out.begin() + 3, out.end(), [](double val) { return val == -1.; }));
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES(
+        ta.propagate_grid(grid, static_cast<double *>(nullptr)), std::invalid_argument,
+        Message("A null output buffer was passed to the propagate_grid() function of an adaptive Taylor integrator"));
+    REQUIRE_THROWS_MATCHES(
+        ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{0, 3}), std::invalid_argument,
+        Message("Invalid output component 3 passed to the propagate_grid() function of an adaptive Taylor "
+                "integrator: the component must be less than the dimension of the system (3)"));
+    REQUIRE_THROWS_MATCHES(
+        ta.propagate_grid(grid, kw::components = std::vector<std::uint32_t>{4}), std::invalid_argument,
+        Message("Invalid output component 4 passed to the propagate_grid() function of an adaptive Taylor "
+                "integrator: the component must be less than the dimension of the system (3)"));
+    REQUIRE_THROWS_MATCHES(
+        ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{0, 1}, kw::stride = 1u),
+        std::invalid_argument,
+        Message("The stride passed to the propagate_grid() function of an adaptive Taylor integrator (1) is less than "
+                "the number of output components (2)"));
+}
+
+// Test the explicit and auto-tuned Taylor order.
+TEST_CASE("taylor order")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta_def = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::compact_mode = cm};
+        REQUIRE(ta_def.get_order() == 20u);
+
+        std::size_t prev_n_steps = 0;
+
+        for (auto order : {8u, 20u, 30u}) {
+            auto ta = taylor_adaptive<double>{
+                {prime(x) = v, prime(v) = -x}, {0., 1.}, kw::compact_mode = cm, kw::order = order};
+            REQUIRE(ta.get_order() == order);
+
+            const auto n_steps = std::get<3>(ta.propagate_until(10.));
+
+            // The tolerance must be satisfied regardless of the order.
+            REQUIRE(std::abs(ta.get_state()[0] - std::sin(10.)) < 1e-12);
+            REQUIRE(std::abs(ta.get_state()[1] - std::cos(10.)) < 1e-12);
+
+            // Higher orders result in larger timesteps.
+            if (prev_n_steps != 0u) {
+                REQUIRE(n_steps < prev_n_steps);
+            }
+            prev_n_steps = n_steps;
+
+            // The order deduced from the tolerance
+            // generates the same integrator.
+            if (order == 20u) {
+                ta_def.propagate_until(10.);
+                REQUIRE(ta.get_state() == ta_def.get_state());
+            }
+        }
+
+        // Auto-tuning.
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -x}, {0., 1.}, kw::compact_mode = cm, kw::tune_order = true};
+        REQUIRE(ta.get_order() >= 16u);
+        REQUIRE(ta.get_order() <= 24u);
+
+        ta.propagate_until(10.);
+        REQUIRE(std::abs(ta.get_state()[0] - std::sin(10.)) < 1e-12);
+        REQUIRE(std::abs(ta.get_state()[1] - std::cos(10.)) < 1e-12);
+
+        // The tuned order is kept when specialising the parameters.
+        ta.specialise_pars();
+        REQUIRE(ta.get_pars_specialised());
+    }
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES((taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::order = 1u}),
+                           std::invalid_argument,
+                           Message("The Taylor order of an adaptive Taylor integrator must be at least 2, but an "
+                                   "order of 1 was specified"));
+    REQUIRE_THROWS_MATCHES(
+        (taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::order = 10u, kw::tune_order = true}),
+        std::invalid_argument,
+        Message("The Taylor order of an adaptive Taylor integrator cannot be auto-tuned if an "
+                "explicit order is specified"));
+}
+
+// Test the lower-precision output of propagate_grid().
+TEST_CASE("propagate grid output type")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const std::vector<double> grid{.5, 1., 1.5, 2.};
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta_copy = ta;
+
+    const auto ref = std::get<4>(ta_copy.propagate_grid(grid));
+    REQUIRE(ref.size() == 8u);
+
+    // Vector overload.
+    auto [oc, _1, _2, _3, fout] = ta.propagate_grid<float>(grid);
+    static_assert(std::is_same_v<decltype(fout), std::vector<float>>);
+
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(fout.size() == ref.size());
+    for (decltype(ref.size()) i = 0; i < ref.size(); ++i) {
+        REQUIRE(fout[i] == static_cast<float>(ref[i]));
+    }
+
+    // Buffer overload, with components and stride.
+    ta.set_time(0.);
+    ta.get_state_data()[0] = 0.05;
+    ta.get_state_data()[1] = 0.025;
+
+    std::vector<float> out(8u, -1.f);
+    auto [oc2, _4, _5, _6, n_written]
+        = ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{1}, kw::stride = 2u);
+
+    REQUIRE(oc2 == taylor_outcome::time_limit);
+    REQUIRE(n_written == 4u);
+    for (auto i = 0u; i < 4u; ++i) {
+        REQUIRE(out[2u * i] == static_cast<float>(ref[2u * i + 1u]));
+        REQUIRE(out[2u * i + 1u] == -1.f);
+    }
+
+    // Double-precision output from an extended-precision integrator.
+    auto ta_ld = taylor_adaptive<long double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05l, 0.025l}};
+    auto ta_ld_copy = ta_ld;
+
+    const auto ref_ld = std::get<4>(ta_ld_copy.propagate_grid({.5l, 1.l, 1.5l, 2.l}));
+    const auto dout = std::get<4>(ta_ld.propagate_grid<double>({.5l, 1.l, 1.5l, 2.l}));
+    static_assert(std::is_same_v<decltype(dout), const std::vector<double>>);
+
+    REQUIRE(dout.size() == ref_ld.size());
+    for (decltype(ref_ld.size()) i = 0; i < ref_ld.size(); ++i) {
+        REQUIRE(dout[i] == static_cast<double>(ref_ld[i]));
+    }
+}
+
 // Test the stream operator of the outcome enum.
 TEST_CASE("outcome stream")
 {
@@ -1180,6 +1574,14 @@ TEST_CASE("outcome stream")
         REQUIRE(oss.str() == "taylor_outcome::cb_stop");
     }
 
+    {
+        std::ostringstream oss;
+
+        oss << taylor_outcome::err_h_collapse;
+
+        REQUIRE(oss.str() == "taylor_outcome::err_h_collapse");
+    }
+
     {
         std::ostringstream oss;
 
@@ -1215,7 +1617,7 @@ TEST_CASE("outcome stream")
     {
         std::ostringstream oss;
 
-        oss << taylor_outcome{static_cast<std::int64_t>(taylor_outcome::cb_stop) - 1};
+        oss << taylor_outcome{static_cast<std::int64_t>(taylor_outcome::err_h_collapse) - 1};
 
         REQUIRE(oss.str() == "taylor_outcome::??");
     }
@@ -1310,3 +1712,1792 @@ TEST_CASE("cb interrupt")
         REQUIRE(ta.get_time() < 19.);
     }
 }
+
+TEST_CASE("s11n")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // Scalar integrator without events.
+    {
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+        ta.propagate_until(10.);
+
+        std::stringstream ss;
+        ta.save(ss);
+
+        auto ta2 = taylor_adaptive<double>::load(ss);
+
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+        REQUIRE(ta2.get_tc() == ta.get_tc());
+        REQUIRE(ta2.get_last_h() == ta.get_last_h());
+        REQUIRE(ta2.get_order() == ta.get_order());
+        REQUIRE(ta2.get_dim() == ta.get_dim());
+        REQUIRE(ta2.get_decomposition() == ta.get_decomposition());
+        REQUIRE(ta2.get_llvm_state().get_ir() == ta.get_llvm_state().get_ir());
+
+        // The restored integrator must behave exactly like the original one.
+        ta.propagate_until(20.);
+        ta2.propagate_until(20.);
+
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+
+        // Wrong type.
+        std::stringstream ss2;
+        ta.save(ss2);
+        REQUIRE_THROWS_AS(taylor_adaptive<long double>::load(ss2), std::invalid_argument);
+
+        // Truncated input.
+        std::stringstream ss3(ss.str().substr(0, 10));
+        REQUIRE_THROWS_AS(taylor_adaptive<double>::load(ss3), std::invalid_argument);
+    }
+
+    // Scalar integrator with events.
+    {
+        auto counter = 0;
+        auto cb = [&counter](taylor_adaptive<double> &, double, int) { ++counter; };
+
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                          {0.05, 0.025},
+                                          kw::t_events = {t_event<double>(x - 1.)},
+                                          kw::nt_events = {nt_event<double>(v, cb)}};
+
+        ta.propagate_until(10.);
+
+        std::stringstream ss;
+        ta.save(ss);
+
+        // The number of events must match.
+        REQUIRE_THROWS_MATCHES(
+            taylor_adaptive<double>::load(ss), std::invalid_argument,
+            Message("Cannot deserialise an adaptive Taylor integrator: the serialised integrator contains 1 terminal "
+                    "event(s), but 0 terminal event(s) were provided"));
+
+        // The event equations must match.
+        ss.clear();
+        ss.seekg(0);
+        REQUIRE_THROWS_AS(taylor_adaptive<double>::load(ss, {t_event<double>(x - 2.)}, {nt_event<double>(v, cb)}),
+                          std::invalid_argument);
+
+        ss.clear();
+        ss.seekg(0);
+        auto ta2 = taylor_adaptive<double>::load(ss, {t_event<double>(x - 1.)}, {nt_event<double>(v, cb)});
+
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+        REQUIRE(ta2.get_t_events().size() == 1u);
+        REQUIRE(ta2.get_nt_events().size() == 1u);
+
+        ta2.propagate_until(20.);
+        ta.propagate_until(20.);
+
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+    }
+
+    // Batch integrator.
+    {
+        auto ta = taylor_adaptive_batch<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2u, kw::time = std::vector<double>{1., 2.}};
+
+        ta.propagate_until({10., 11.});
+
+        std::stringstream ss;
+        ta.save(ss);
+
+        auto ta2 = taylor_adaptive_batch<double>::load(ss);
+
+        REQUIRE(ta2.get_batch_size() == 2u);
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+        REQUIRE(ta2.get_tc() == ta.get_tc());
+        REQUIRE(ta2.get_last_h() == ta.get_last_h());
+        REQUIRE(ta2.get_decomposition() == ta.get_decomposition());
+
+        ta.propagate_until({20., 21.});
+        ta2.propagate_until({20., 21.});
+
+        REQUIRE(ta2.get_state() == ta.get_state());
+        REQUIRE(ta2.get_time() == ta.get_time());
+
+        // Scalar/batch mismatch.
+        std::stringstream ss2;
+        ta.save(ss2);
+        REQUIRE_THROWS_AS(taylor_adaptive<double>::load(ss2), std::invalid_argument);
+    }
+}
+
+TEST_CASE("lazy compile")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta_l = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm, kw::lazy_compile = true};
+
+        // Before the first step, the unoptimised code is being used.
+        REQUIRE(ta_l.get_llvm_state().opt_level() == 0u);
+
+        // Copies and serialisation wait for the optimised code.
+        auto ta_c = ta_l;
+        REQUIRE(ta_c.get_llvm_state().opt_level() == 3u);
+
+        std::stringstream ss;
+        ta_l.save(ss);
+        auto ta_s = taylor_adaptive<double>::load(ss);
+        REQUIRE(ta_s.get_llvm_state().opt_level() == 3u);
+
+        ta.propagate_until(10.);
+        ta_l.propagate_until(10.);
+        ta_c.propagate_until(10.);
+        ta_s.propagate_until(10.);
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(ta_l.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+            REQUIRE(ta_c.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+            REQUIRE(ta_s.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+
+        // With events.
+        auto counter = 0;
+        auto cb = [&counter](taylor_adaptive<double> &, double, int) { ++counter; };
+
+        auto ta_e = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                            {0.05, 0.025},
+                                            kw::compact_mode = cm,
+                                            kw::lazy_compile = true,
+                                            kw::nt_events = {nt_event<double>(v, cb)}};
+
+        ta_e.propagate_until(10.);
+        REQUIRE(counter > 0);
+        REQUIRE(ta_e.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+
+        // No background compilation if optimisations are disabled.
+        auto ta_0 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                            {0.05, 0.025},
+                                            kw::compact_mode = cm,
+                                            kw::lazy_compile = true,
+                                            kw::opt_level = 0u};
+        auto ta_0c = ta_0;
+        REQUIRE(ta_0c.get_llvm_state().opt_level() == 0u);
+    }
+}
+
+TEST_CASE("unroll threshold")
+{
+    auto sys = make_nbody_sys(3, kw::masses = {1., 0.01, 0.01});
+
+    const auto init_state = std::vector<double>{0, 0, 0, 1, 0, 0, 0, 1.1, 0, 0, 0, 0, 0, 1, 0, -0.9, 0, 0};
+
+    auto ta = taylor_adaptive<double>{sys, init_state};
+    ta.propagate_until(10.);
+
+    for (auto ut : {0u, 1u, 4u, 1000u}) {
+        for (auto pm : {false, true}) {
+            auto ta_u = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::parallel_mode = pm,
+                                                kw::unroll_threshold = ut};
+            ta_u.propagate_until(10.);
+
+            for (auto i = 0u; i < 18u; ++i) {
+                REQUIRE(ta_u.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+            }
+        }
+    }
+
+    // Batch mode.
+    std::vector<double> batch_state;
+    for (auto x : init_state) {
+        batch_state.push_back(x);
+        batch_state.push_back(x);
+    }
+
+    auto ta_b = taylor_adaptive_batch<double>{sys, batch_state, 2u, kw::compact_mode = true,
+                                              kw::unroll_threshold = 4u};
+    ta_b.propagate_until({10., 10.});
+
+    for (auto i = 0u; i < 18u; ++i) {
+        REQUIRE(ta_b.get_state()[2u * i] == approximately(ta.get_state()[i], 1000.));
+        REQUIRE(ta_b.get_state()[2u * i + 1u] == approximately(ta.get_state()[i], 1000.));
+    }
+}
+
+TEST_CASE("contiguous jets")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto pm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = true, kw::parallel_mode = pm};
+        auto ta_c = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                            {0.05, 0.025},
+                                            kw::compact_mode = true,
+                                            kw::parallel_mode = pm,
+                                            kw::contiguous_jets = true};
+
+        ta.propagate_until(10., kw::write_tc = true);
+        ta_c.propagate_until(10., kw::write_tc = true);
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(ta_c.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+
+        REQUIRE(ta_c.get_tc().size() == ta.get_tc().size());
+        for (decltype(ta.get_tc().size()) i = 0; i < ta.get_tc().size(); ++i) {
+            REQUIRE(ta_c.get_tc()[i] == approximately(ta.get_tc()[i], 1000.));
+        }
+    }
+
+    // With events, whose equations are not state variables.
+    {
+        auto counter = 0, counter_c = 0;
+        auto cb = [&counter](taylor_adaptive<double> &, double, int) { ++counter; };
+        auto cb_c = [&counter_c](taylor_adaptive<double> &, double, int) { ++counter_c; };
+
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                          {0.05, 0.025},
+                                          kw::compact_mode = true,
+                                          kw::nt_events = {nt_event<double>(v * v - 1e-10, cb)}};
+        auto ta_c = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                            {0.05, 0.025},
+                                            kw::compact_mode = true,
+                                            kw::contiguous_jets = true,
+                                            kw::nt_events = {nt_event<double>(v * v - 1e-10, cb_c)}};
+
+        ta.propagate_until(10.);
+        ta_c.propagate_until(10.);
+
+        REQUIRE(counter > 0);
+        REQUIRE(counter_c == counter);
+
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(ta_c.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+    }
+
+    // Batch mode.
+    {
+        auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                {0.05, 0.06, 0.025, 0.026},
+                                                2u,
+                                                kw::compact_mode = true};
+        auto ta_c = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                  {0.05, 0.06, 0.025, 0.026},
+                                                  2u,
+                                                  kw::compact_mode = true,
+                                                  kw::contiguous_jets = true};
+
+        ta.propagate_until({10., 11.});
+        ta_c.propagate_until({10., 11.});
+
+        for (auto i = 0u; i < 4u; ++i) {
+            REQUIRE(ta_c.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+    }
+}
+
+// NOTE: in compact mode, the indices of the arguments of the derivative
+// functions which form arithmetic progressions (including the decreasing
+// ones and the strided u indices of contiguous jets) are computed
+// on the fly instead of being loaded from arrays.
+TEST_CASE("compact mode strided args")
+{
+    const auto n = 10u;
+
+    std::vector<expression> vars;
+    for (auto i = 0u; i < n; ++i) {
+        vars.emplace_back(variable{"x_" + std::to_string(i)});
+    }
+
+    // The second arguments of the products are
+    // (x_9, x_8, ..., x_0) and (x_0, x_2, ..., x_8, x_0, ...).
+    std::vector<std::pair<expression, expression>> sys;
+    for (auto i = 0u; i < n; ++i) {
+        sys.push_back(prime(vars[i]) = -.1 * vars[i] * vars[n - 1u - i] + vars[(2u * i) % n] * vars[i]);
+    }
+
+    std::vector<double> init_state;
+    for (auto i = 0u; i < n; ++i) {
+        init_state.push_back(.1 + i / 100.);
+    }
+
+    auto ta = taylor_adaptive<double>{sys, init_state};
+
+    for (auto cj : {false, true}) {
+        auto ta_c = taylor_adaptive<double>{sys, init_state, kw::compact_mode = true, kw::contiguous_jets = cj};
+
+        ta_c.propagate_until(1.);
+        if (!cj) {
+            ta.propagate_until(1.);
+        }
+
+        for (auto i = 0u; i < n; ++i) {
+            REQUIRE(ta_c.get_state()[i] == approximately(ta.get_state()[i], 1000.));
+        }
+    }
+}
+
+TEST_CASE("perf counters")
+{
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+    using tev_t = taylor_adaptive<double>::t_event_t;
+
+    auto [x, v] = make_vars("x", "v");
+
+    // No events.
+    {
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+        REQUIRE(!ta.get_perf_counters_enabled());
+
+        // Counters are not collected by default.
+        ta.propagate_until(1.);
+        REQUIRE(ta.get_perf_counters().n_steps == 0u);
+        REQUIRE(ta.get_perf_counters().stepper_time == 0);
+
+        ta.set_perf_counters_enabled(true);
+        REQUIRE(ta.get_perf_counters_enabled());
+
+        const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(10., kw::callback = [](auto &) { return true; });
+
+        REQUIRE(oc == taylor_outcome::time_limit);
+
+        const auto &pc = ta.get_perf_counters();
+        REQUIRE(pc.n_steps == n_steps);
+        REQUIRE(pc.n_limited_steps == 1u);
+        REQUIRE(pc.n_nf_steps == 0u);
+        REQUIRE(pc.n_t_events == 0u);
+        REQUIRE(pc.n_nt_events == 0u);
+        REQUIRE(pc.n_poly_cache_hits == 0u);
+        REQUIRE(pc.n_poly_cache_misses == 0u);
+        REQUIRE(pc.stepper_time > 0);
+        REQUIRE(pc.ed_time == 0);
+        REQUIRE(pc.cb_time >= 0);
+
+        // Copy semantics.
+        auto ta_copy = ta;
+        REQUIRE(ta_copy.get_perf_counters_enabled());
+        REQUIRE(ta_copy.get_perf_counters().n_steps == pc.n_steps);
+
+        std::ostringstream oss;
+        oss << pc;
+        REQUIRE(boost::algorithm::contains(oss.str(), "N of steps"));
+
+        ta.log_perf_counters();
+
+        ta.reset_perf_counters();
+        REQUIRE(ta.get_perf_counters().n_steps == 0u);
+        REQUIRE(ta.get_perf_counters().stepper_time == 0);
+    }
+
+    // Events.
+    {
+        std::uint64_t n_nt = 0;
+
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                          {0.05, 0.025},
+                                          kw::nt_events = {ev_t(v, [&n_nt](auto &, double, int) { ++n_nt; })},
+                                          kw::t_events = {tev_t(x - 0.04)}};
+
+        ta.set_perf_counters_enabled(true);
+
+        const auto oc = std::get<0>(ta.propagate_until(10.));
+
+        REQUIRE(oc == taylor_outcome{-1});
+
+        const auto &pc = ta.get_perf_counters();
+        REQUIRE(pc.n_t_events == 1u);
+        REQUIRE(pc.n_nt_events == n_nt);
+        REQUIRE(pc.n_poly_cache_hits + pc.n_poly_cache_misses > 0u);
+        REQUIRE(pc.ed_time > 0);
+    }
+}
+
+TEST_CASE("ctor timings")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm, kw::opt_level = 3u};
+
+        const auto &ct = ta.get_ctor_timings();
+
+        REQUIRE(ct.decomposition > 0);
+        REQUIRE(ct.cse >= 0);
+        REQUIRE(ct.sorting >= 0);
+        REQUIRE(ct.ir_gen > 0);
+        REQUIRE(ct.opt_function_passes >= 0);
+        REQUIRE(ct.opt_module_passes > 0);
+        REQUIRE(ct.codegen >= 0);
+        REQUIRE(ct.total >= ct.decomposition + ct.ir_gen + ct.opt_module_passes);
+
+        REQUIRE(ta.get_llvm_state().get_timings().opt_module_passes == ct.opt_module_passes);
+
+        // Copy semantics.
+        auto ta_copy = ta;
+        REQUIRE(ta_copy.get_ctor_timings().total == ct.total);
+
+        std::ostringstream oss;
+        oss << ct;
+        REQUIRE(boost::algorithm::contains(oss.str(), "Decomposition"));
+
+        // Batch mode.
+        auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                 {0.05, 0.06, 0.025, 0.026},
+                                                 2u,
+                                                 kw::compact_mode = cm};
+
+        REQUIRE(tab.get_ctor_timings().decomposition > 0);
+        REQUIRE(tab.get_ctor_timings().total > 0);
+    }
+}
+
+TEST_CASE("fused step")
+{
+    using std::isfinite;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            for (auto fm : {false, true}) {
+                auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                  {0.05, 0.025},
+                                                  kw::compact_mode = cm,
+                                                  kw::high_accuracy = ha,
+                                                  kw::fast_math = fm};
+                auto ta_f = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                    {0.05, 0.025},
+                                                    kw::compact_mode = cm,
+                                                    kw::high_accuracy = ha,
+                                                    kw::fast_math = fm,
+                                                    kw::fused_step = true};
+
+                REQUIRE(!ta.get_fused_step());
+                REQUIRE(ta_f.get_fused_step());
+
+                // The fused stepper must produce exactly the same results.
+                for (auto i = 0; i < 100; ++i) {
+                    const auto [oc, h] = ta.step(true);
+                    const auto [oc_f, h_f] = ta_f.step(true);
+
+                    REQUIRE(oc == oc_f);
+                    REQUIRE(h == h_f);
+                    REQUIRE(ta.get_state() == ta_f.get_state());
+                    REQUIRE(ta.get_time() == ta_f.get_time());
+                    REQUIRE(ta.get_tc() == ta_f.get_tc());
+                }
+
+                // Time limit.
+                REQUIRE(ta_f.step(1e-3) == std::tuple{taylor_outcome::time_limit, 1e-3});
+                REQUIRE(ta_f.get_last_h() == 1e-3);
+
+                // Backward integration.
+                const auto t0 = ta_f.get_time();
+                ta_f.step_backward();
+                REQUIRE(ta_f.get_time() < t0);
+
+                // Propagation.
+                ta.propagate_until(20.);
+                ta_f.propagate_until(20.);
+                REQUIRE(ta_f.get_time() == 20.);
+                REQUIRE(ta_f.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+                REQUIRE(ta_f.get_state()[1] == approximately(ta.get_state()[1], 1000.));
+
+                // Copy semantics.
+                auto ta_copy = ta_f;
+                REQUIRE(ta_copy.get_fused_step());
+                ta_copy.step();
+                ta_f.step();
+                REQUIRE(ta_copy.get_state() == ta_f.get_state());
+                REQUIRE(ta_copy.get_time() == ta_f.get_time());
+
+                // Serialisation.
+                std::stringstream ss;
+                ta_f.save(ss);
+                auto ta_s = taylor_adaptive<double>::load(ss);
+                REQUIRE(ta_s.get_fused_step());
+                ta_s.step();
+                ta_f.step();
+                REQUIRE(ta_s.get_state() == ta_f.get_state());
+                REQUIRE(ta_s.get_time() == ta_f.get_time());
+
+                // Non-finite state.
+                // NOTE: with fast math, non-finite values in
+                // the computation result in undefined behaviour.
+                if (!fm) {
+                    ta_f.get_state_data()[0] = std::numeric_limits<double>::infinity();
+                    REQUIRE(std::get<0>(ta_f.step()) == taylor_outcome::err_nf_state);
+                    REQUIRE(!isfinite(ta_f.get_state()[0]));
+                }
+            }
+        }
+    }
+
+    // The flag is ignored with events.
+    {
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                          {0.05, 0.025},
+                                          kw::fused_step = true,
+                                          kw::t_events = {t_event<double>(x - 1.)}};
+
+        REQUIRE(!ta.get_fused_step());
+        REQUIRE(std::get<0>(ta.step()) == taylor_outcome::success);
+    }
+
+    // Lazy compilation.
+    {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::fused_step = true, kw::lazy_compile = true};
+
+        const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(10.);
+
+        REQUIRE(oc == taylor_outcome::time_limit);
+        REQUIRE(ta.get_time() == 10.);
+    }
+}
+
+TEST_CASE("multi-step driver")
+{
+    using std::isfinite;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta
+            = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta_f = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm, kw::fused_step = true};
+
+        // The driver must produce exactly the same results as the step-by-step propagation.
+        auto check = [&](const auto &res, const auto &res_f) {
+            REQUIRE(res == res_f);
+            REQUIRE(ta.get_state() == ta_f.get_state());
+            REQUIRE(ta.get_time() == ta_f.get_time());
+            REQUIRE(ta.get_last_h() == ta_f.get_last_h());
+            REQUIRE(ta.get_tc() == ta_f.get_tc());
+        };
+
+        check(ta.propagate_until(10.), ta_f.propagate_until(10.));
+        REQUIRE(std::get<0>(ta_f.propagate_until(20.)) == taylor_outcome::time_limit);
+        ta.propagate_until(20.);
+
+        // Max timestep and write_tc.
+        check(ta.propagate_until(30., kw::max_delta_t = 0.01, kw::write_tc = true),
+              ta_f.propagate_until(30., kw::max_delta_t = 0.01, kw::write_tc = true));
+
+        // Max number of steps.
+        check(ta.propagate_for(100., kw::max_steps = 10), ta_f.propagate_for(100., kw::max_steps = 10));
+        REQUIRE(std::get<0>(ta_f.propagate_for(100., kw::max_steps = 10)) == taylor_outcome::step_limit);
+        ta.propagate_for(100., kw::max_steps = 10);
+
+        // Backward integration.
+        check(ta.propagate_until(-10.), ta_f.propagate_until(-10.));
+
+        // Callbacks fall back to the step-by-step propagation.
+        check(ta.propagate_until(0., kw::callback = [](auto &) { return true; }),
+              ta_f.propagate_until(0., kw::callback = [](auto &) { return true; }));
+
+        // Zero-length propagation.
+        check(ta.propagate_until(0.), ta_f.propagate_until(0.));
+
+        // Copy semantics.
+        auto ta_copy = ta_f;
+        check(ta.propagate_until(5.), ta_f.propagate_until(5.));
+        ta_copy.propagate_until(5.);
+        REQUIRE(ta_copy.get_state() == ta_f.get_state());
+        REQUIRE(ta_copy.get_time() == ta_f.get_time());
+
+        // Non-finite state.
+        ta_f.get_state_data()[0] = std::numeric_limits<double>::infinity();
+        const auto [oc, min_h, max_h, n_steps] = ta_f.propagate_until(100.);
+        REQUIRE(oc == taylor_outcome::err_nf_state);
+        REQUIRE(n_steps == 0u);
+        REQUIRE(!isfinite(ta_f.get_state()[0]));
+    }
+
+    // Lazy compilation.
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::fused_step = true, kw::lazy_compile = true};
+    for (auto i = 0; i < 10; ++i) {
+        REQUIRE(std::get<0>(ta.propagate_for(1.)) == taylor_outcome::time_limit);
+    }
+    REQUIRE(ta.get_time() == approximately(10.));
+}
+
+TEST_CASE("lazy tc with events")
+{
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    // NOTE: the callback checks that the dense output
+    // is available at the time of the event.
+    std::vector<double> d_out_ev;
+    auto ta_ev = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)},
+        {0.05, 0.025},
+        kw::nt_events = {ev_t(v, [&d_out_ev](taylor_adaptive<double> &t, double time, int) {
+            d_out_ev = t.update_d_output(time);
+        })}};
+
+    for (auto i = 0; i < 20; ++i) {
+        ta.step(true);
+        ta_ev.step();
+
+        REQUIRE(ta.get_tc() == ta_ev.get_tc());
+        REQUIRE(ta.get_state() == ta_ev.get_state());
+    }
+
+    REQUIRE(!d_out_ev.empty());
+    REQUIRE(d_out_ev[1] == approximately(0., 1000.));
+
+    // The coefficients must be available also in the copies
+    // and after serialisation, without reading them first.
+    ta.step(true);
+    ta_ev.step();
+
+    const auto ta_copy = ta_ev;
+    REQUIRE(ta_copy.get_tc() == ta.get_tc());
+
+    std::stringstream ss;
+    ta_ev.save(ss);
+    const auto ta_s = taylor_adaptive<double>::load(ss, {}, ta_ev.get_nt_events());
+    REQUIRE(ta_s.get_tc() == ta.get_tc());
+
+    // Continuous output.
+    auto co = continuous_output<double>{ta_ev};
+    ta_ev.propagate_for(1., kw::c_output = co);
+    REQUIRE(co(ta_ev.get_time())[0] == approximately(ta_ev.get_state()[0], 1000.));
+}
+
+namespace
+{
+
+bool stop_cb(taylor_adaptive<double> &ta)
+{
+    return ta.get_time() < .5;
+}
+
+} // namespace
+
+// The callbacks of the propagate_*() functions are
+// referenced, rather than copied.
+TEST_CASE("propagate callback ref")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    // A move-only stateful callback.
+    struct move_only_cb {
+        std::unique_ptr<unsigned long> counter = std::make_unique<unsigned long>(0ul);
+
+        move_only_cb() = default;
+        move_only_cb(move_only_cb &&) noexcept = default;
+        move_only_cb(const move_only_cb &) = delete;
+
+        bool operator()(taylor_adaptive<double> &)
+        {
+            ++*counter;
+            return true;
+        }
+    };
+
+    move_only_cb cb0;
+    auto oc = std::get<0>(ta.propagate_until(1., kw::max_delta_t = 1e-2, kw::callback = cb0));
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(*cb0.counter == 100ul);
+
+    // Temporary callback.
+    oc = std::get<0>(ta.propagate_for(1., kw::max_delta_t = 1e-2, kw::callback = move_only_cb{}));
+    REQUIRE(oc == taylor_outcome::time_limit);
+
+    // Function.
+    ta.set_time(0.);
+    oc = std::get<0>(ta.propagate_until(1., kw::max_delta_t = 1e-2, kw::callback = stop_cb));
+    REQUIRE(oc == taylor_outcome::cb_stop);
+    REQUIRE(ta.get_time() >= .5);
+
+    // Empty function pointer and std::function: no callback is invoked.
+    ta.set_time(0.);
+    bool (*cb_ptr)(taylor_adaptive<double> &) = nullptr;
+    oc = std::get<0>(ta.propagate_until(1., kw::callback = cb_ptr));
+    REQUIRE(oc == taylor_outcome::time_limit);
+
+    ta.set_time(0.);
+    std::function<bool(taylor_adaptive<double> &)> cb_f;
+    oc = std::get<0>(ta.propagate_grid({0., .5, 1.}, kw::callback = cb_f));
+    REQUIRE(oc == taylor_outcome::time_limit);
+
+    // Non-empty std::function.
+    ta.set_time(0.);
+    cb_f = [](taylor_adaptive<double> &) { return false; };
+    oc = std::get<0>(ta.propagate_grid({0., .5, 1.}, kw::callback = cb_f));
+    REQUIRE(oc == taylor_outcome::cb_stop);
+}
+
+TEST_CASE("dl order")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            for (auto dl_order : {1u, 3u, 100u}) {
+                auto ta = taylor_adaptive<double>{
+                    {prime(x) = v, prime(v) = -x}, {1., 0.}, kw::compact_mode = cm, kw::high_accuracy = ha};
+                auto ta_dl = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x},
+                                                     {1., 0.},
+                                                     kw::compact_mode = cm,
+                                                     kw::high_accuracy = ha,
+                                                     kw::dl_order = dl_order};
+
+                // Starting from the same state, the timestep is the same
+                // and the new state differs at most by a few ulps.
+                for (auto i = 0; i < 100; ++i) {
+                    const auto [oc, h] = ta.step();
+                    const auto [oc_dl, h_dl] = ta_dl.step();
+
+                    REQUIRE(oc == oc_dl);
+                    REQUIRE(h == h_dl);
+                    REQUIRE(ta_dl.get_state()[0] == approximately(ta.get_state()[0], 10.));
+                    REQUIRE(ta_dl.get_state()[1] == approximately(ta.get_state()[1], 10.));
+
+                    std::copy(ta.get_state().begin(), ta.get_state().end(), ta_dl.get_state_data());
+                }
+
+                // Long-term accuracy.
+                ta_dl.set_time(0.);
+                ta_dl.get_state_data()[0] = 1.;
+                ta_dl.get_state_data()[1] = 0.;
+
+                ta_dl.propagate_until(100.);
+
+                REQUIRE(ta_dl.get_state()[0] == approximately(std::cos(100.), 1000.));
+                REQUIRE(ta_dl.get_state()[1] == approximately(-std::sin(100.), 1000.));
+            }
+        }
+    }
+}
+
+TEST_CASE("ha vars")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta_ha = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = cm, kw::high_accuracy = true};
+        auto ta_sel = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = cm, kw::ha_vars = {x}};
+
+        // Starting from the same state, the timestep is the same and the
+        // selected variable is updated as in high accuracy mode, the
+        // other as in the standard mode.
+        for (auto i = 0; i < 100; ++i) {
+            const auto [oc, h] = ta.step();
+            const auto [oc_ha, h_ha] = ta_ha.step();
+            const auto [oc_sel, h_sel] = ta_sel.step();
+
+            REQUIRE(oc == oc_sel);
+            REQUIRE(h == h_sel);
+            REQUIRE(h_ha == h_sel);
+            REQUIRE(ta_sel.get_state()[0] == approximately(ta_ha.get_state()[0], 10.));
+            REQUIRE(ta_sel.get_state()[1] == approximately(ta.get_state()[1], 10.));
+
+            std::copy(ta.get_state().begin(), ta.get_state().end(), ta_ha.get_state_data());
+            std::copy(ta.get_state().begin(), ta.get_state().end(), ta_sel.get_state_data());
+        }
+
+        // The selection is kept by the copies.
+        auto ta_copy = ta_sel;
+        ta_copy.step();
+        ta_sel.step();
+        REQUIRE(ta_copy.get_state() == ta_sel.get_state());
+    }
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::ha_vars = {v}};
+    tab.propagate_until({10., 10.});
+    REQUIRE(tab.get_time() == std::vector{10., 10.});
+
+    // Error modes.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{sys, {0.05, 0.025}, kw::ha_vars = {x + v}}), std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{sys, {0.05, 0.025}, kw::ha_vars = {"y"_var}}), std::invalid_argument);
+}
+
+TEST_CASE("auto compact mode")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Small system: non-compact mode with inlining.
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    REQUIRE(detail::taylor_auto_compact_mode(sys, 1e-16, 0, 1) == std::pair{false, true});
+    REQUIRE(detail::taylor_auto_compact_mode(taylor_precomputed_dc(sys), 1e-16, 0, 1) == std::pair{false, true});
+
+    // Large system: compact mode without inlining.
+    auto rhs = 0_dbl;
+    for (auto i = 1; i <= 300; ++i) {
+        rhs += sin(x * expression{static_cast<double>(i)});
+    }
+    const auto big_sys = std::vector{prime(x) = v, prime(v) = rhs};
+    REQUIRE(detail::taylor_auto_compact_mode(big_sys, 1e-16, 0, 1) == std::pair{true, false});
+    // The estimate accounts for the order.
+    REQUIRE(detail::taylor_auto_compact_mode(big_sys, 1e-16, 2, 1) == std::pair{false, true});
+
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::auto_compact_mode = true};
+    REQUIRE(ta.get_llvm_state().inline_functions());
+
+    auto ta_big = taylor_adaptive<double>{big_sys, {0.05, 0.025}, kw::auto_compact_mode = true};
+    REQUIRE(!ta_big.get_llvm_state().inline_functions());
+
+    // An explicit inline_functions is respected.
+    auto ta_big2 = taylor_adaptive<double>{big_sys, {0.05, 0.025}, kw::auto_compact_mode = true,
+                                           kw::inline_functions = true};
+    REQUIRE(ta_big2.get_llvm_state().inline_functions());
+
+    // The results match the explicit choice of compact mode.
+    auto ta_cm = taylor_adaptive<double>{big_sys, {0.05, 0.025}, kw::compact_mode = true};
+    ta_big.propagate_until(1.);
+    ta_cm.propagate_until(1.);
+    REQUIRE(ta_big.get_state()[0] == approximately(ta_cm.get_state()[0], 1000.));
+    REQUIRE(ta_big.get_state()[1] == approximately(ta_cm.get_state()[1], 1000.));
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::auto_compact_mode = true};
+    REQUIRE(tab.get_llvm_state().inline_functions());
+}
+
+TEST_CASE("compact mode budget")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    REQUIRE(!detail::taylor_cm_budget_exceeded(sys, 1e-16, 0, 1, 1e6));
+    REQUIRE(detail::taylor_cm_budget_exceeded(sys, 1e-16, 0, 1, 10.));
+    REQUIRE(detail::taylor_cm_budget_exceeded(taylor_precomputed_dc(sys), 1e-16, 0, 1, 10.));
+
+    // Within the budget.
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::cm_budget = 1e6};
+    REQUIRE(ta.get_llvm_state().inline_functions());
+
+    // Budget exceeded: fallback to compact mode.
+    auto ta_cm = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::cm_budget = 10.};
+    REQUIRE(!ta_cm.get_llvm_state().inline_functions());
+
+    // An explicit inline_functions is respected.
+    auto ta_cm2 = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::cm_budget = 10., kw::inline_functions = true};
+    REQUIRE(ta_cm2.get_llvm_state().inline_functions());
+
+    ta.propagate_until(1.);
+    ta_cm.propagate_until(1.);
+    REQUIRE(ta_cm.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+    REQUIRE(ta_cm.get_state()[1] == approximately(ta.get_state()[1], 1000.));
+
+    // Batch mode.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2, kw::cm_budget = 10.};
+    REQUIRE(!tab.get_llvm_state().inline_functions());
+}
+
+TEST_CASE("shared copy")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto lc : {false, true}) {
+            auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                              {0.05, 0.025},
+                                              kw::compact_mode = cm,
+                                              kw::lazy_compile = lc};
+
+            auto ta_sh = ta.shared_copy();
+            auto ta_copy = ta;
+
+            // The compiled code is shared only by ta_sh.
+            REQUIRE(&ta_sh.get_llvm_state() == &ta.get_llvm_state());
+            REQUIRE(&ta_copy.get_llvm_state() != &ta.get_llvm_state());
+            REQUIRE(ta_sh.get_decomposition() == ta.get_decomposition());
+            REQUIRE(ta_sh.get_order() == ta.get_order());
+
+            // The buffers are independent.
+            ta_sh.get_state_data()[0] = 0.1;
+            REQUIRE(ta.get_state()[0] == 0.05);
+
+            ta.propagate_until(10.);
+            ta_copy.propagate_until(10.);
+            REQUIRE(ta_copy.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+            REQUIRE(ta_copy.get_state()[1] == approximately(ta.get_state()[1], 1000.));
+
+            ta_sh.set_time(0.);
+            ta_sh.get_state_data()[0] = 0.05;
+            ta_sh.propagate_until(10.);
+            REQUIRE(ta_sh.get_state()[0] == approximately(ta.get_state()[0], 1000.));
+            REQUIRE(ta_sh.get_state()[1] == approximately(ta.get_state()[1], 1000.));
+
+            // A shared copy of a shared copy.
+            auto ta_sh2 = ta_sh.shared_copy();
+            REQUIRE(&ta_sh2.get_llvm_state() == &ta_sh.get_llvm_state());
+            REQUIRE(ta_sh2.get_state() == ta_sh.get_state());
+
+            // Bulk shared copies.
+            REQUIRE(ta.shared_copies(0).empty());
+            auto pool = ta_sh.shared_copies(10);
+            REQUIRE(pool.size() == 10u);
+            for (auto &ta_p : pool) {
+                REQUIRE(&ta_p.get_llvm_state() == &ta.get_llvm_state());
+                REQUIRE(ta_p.get_state() == ta_sh.get_state());
+                REQUIRE(ta_p.get_time() == ta_sh.get_time());
+            }
+            pool[0].get_state_data()[0] = 0.;
+            REQUIRE(pool[1].get_state() == ta_sh.get_state());
+            pool[1].propagate_for(1.);
+            ta_sh.propagate_for(1.);
+            REQUIRE(pool[1].get_state() == ta_sh.get_state());
+        }
+    }
+}
+
+TEST_CASE("precomputed dc")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = sum({-9.8 * sin(x), par[0] * v})};
+
+    // Scalar integrator, with a decomposition restored from a stream.
+    {
+        std::stringstream ss;
+        taylor_precomputed_dc(sys).save(ss);
+
+        const auto dc = taylor_precomputed_dc::load(ss);
+
+        REQUIRE(dc.get_n_eq() == 2u);
+        REQUIRE(dc.get_decomposition() == taylor_decompose(sys, {}).first);
+        REQUIRE(dc.get_sv_funcs_dc().empty());
+
+        auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::pars = {-.1}};
+        auto ta_dc = taylor_adaptive<double>{dc, {0.05, 0.025}, kw::pars = {-.1}};
+
+        REQUIRE(ta_dc.get_decomposition() == ta.get_decomposition());
+        REQUIRE(ta_dc.get_pars() == ta.get_pars());
+
+        ta.propagate_until(10.);
+        ta_dc.propagate_until(10.);
+
+        REQUIRE(ta_dc.get_state() == ta.get_state());
+
+        // The parameter values are checked against the decomposition.
+        REQUIRE_THROWS_AS((taylor_adaptive<double>{dc, {0.05, 0.025}, kw::pars = {-.1, 1.}}), std::invalid_argument);
+
+        // The state size must match the number of equations.
+        REQUIRE_THROWS_AS((taylor_adaptive<double>{dc, {0.05, 0.025, 0.}}), std::invalid_argument);
+
+        // The event equations must be included in the decomposition.
+        REQUIRE_THROWS_MATCHES(
+            (taylor_adaptive<double>{dc, {0.05, 0.025}, kw::t_events = {t_event<double>(x - 1.)}}),
+            std::invalid_argument,
+            Message("Invalid precomputed Taylor decomposition passed to the constructor of an adaptive Taylor "
+                    "integrator: the decomposition includes 0 event equation(s), but the integrator has 1 "
+                    "event(s)"));
+    }
+
+    // Scalar integrator with events.
+    {
+        const auto dc = taylor_precomputed_dc(sys, {x - 1., v});
+
+        auto cb = [](taylor_adaptive<double> &, double, int) {};
+
+        auto ta = taylor_adaptive<double>{
+            sys, {0.05, 0.025}, kw::t_events = {t_event<double>(x - 1.)}, kw::nt_events = {nt_event<double>(v, cb)}};
+        auto ta_dc = taylor_adaptive<double>{
+            dc, {0.05, 0.025}, kw::t_events = {t_event<double>(x - 1.)}, kw::nt_events = {nt_event<double>(v, cb)}};
+
+        REQUIRE(ta_dc.get_decomposition() == ta.get_decomposition());
+
+        ta.propagate_until(10.);
+        ta_dc.propagate_until(10.);
+
+        REQUIRE(ta_dc.get_state() == ta.get_state());
+    }
+
+    // Batch integrator.
+    {
+        const auto dc = taylor_precomputed_dc(sys);
+
+        auto ta = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2u, kw::pars = {-.1, -.2}};
+        auto ta_dc = taylor_adaptive_batch<double>{dc, {0.05, 0.06, 0.025, 0.026}, 2u, kw::pars = {-.1, -.2}};
+
+        REQUIRE(ta_dc.get_decomposition() == ta.get_decomposition());
+
+        ta.propagate_until({10., 10.});
+        ta_dc.propagate_until({10., 10.});
+
+        REQUIRE(ta_dc.get_state() == ta.get_state());
+    }
+
+    // Invalid serialised decompositions.
+    {
+        std::stringstream ss;
+        taylor_precomputed_dc(sys).save(ss);
+
+        // Truncated input.
+        std::stringstream ss2(ss.str().substr(0, 30));
+        REQUIRE_THROWS_AS(taylor_precomputed_dc::load(ss2), std::invalid_argument);
+
+        // Wrong type.
+        std::stringstream ss3;
+        taylor_adaptive<double>{sys, {0.05, 0.025}}.save(ss3);
+        REQUIRE_THROWS_AS(taylor_precomputed_dc::load(ss3), std::invalid_argument);
+    }
+}
+
+TEST_CASE("c_diff lib")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    taylor_c_diff_lib_clear();
+    REQUIRE(taylor_c_diff_lib_size() == 0u);
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = true};
+
+    const auto lib_size = taylor_c_diff_lib_size();
+    REQUIRE(lib_size > 0u);
+
+    // A second integrator fetches the derivative
+    // functions from the library.
+    auto ta2 = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = true};
+    REQUIRE(taylor_c_diff_lib_size() == lib_size);
+
+    // Different options result in different functions.
+    auto ta3 = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::compact_mode = true, kw::opt_level = 0u};
+    REQUIRE(taylor_c_diff_lib_size() > lib_size);
+
+    // Check the results against the default mode.
+    auto ta_d = taylor_adaptive<double>{sys, {0.05, 0.025}};
+
+    ta.propagate_until(10.);
+    ta2.propagate_until(10.);
+    ta3.propagate_until(10.);
+    ta_d.propagate_until(10.);
+
+    REQUIRE(ta2.get_state() == ta.get_state());
+    REQUIRE(ta.get_state()[0] == approximately(ta_d.get_state()[0], 1000.));
+    REQUIRE(ta.get_state()[1] == approximately(ta_d.get_state()[1], 1000.));
+    REQUIRE(ta3.get_state()[0] == approximately(ta_d.get_state()[0], 1000.));
+    REQUIRE(ta3.get_state()[1] == approximately(ta_d.get_state()[1], 1000.));
+
+    taylor_c_diff_lib_clear();
+    REQUIRE(taylor_c_diff_lib_size() == 0u);
+}
+
+TEST_CASE("update equations")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta
+            = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+
+        ta.propagate_until(1.);
+
+        const auto state = ta.get_state();
+
+        // Add a damping term to the second equation.
+        ta.update_equations({{1u, -9.8 * sin(x) - par[0] * v}});
+        ta.get_pars_data()[0] = .1;
+
+        REQUIRE(ta.get_time() == 1.);
+        REQUIRE(ta.get_state() == state);
+        REQUIRE(ta.get_pars().size() == 1u);
+
+        auto ta_cmp = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x) - par[0] * v},
+                                              state,
+                                              kw::compact_mode = cm,
+                                              kw::time = 1.,
+                                              kw::pars = {.1}};
+
+        REQUIRE(ta.get_decomposition() == ta_cmp.get_decomposition());
+
+        ta.propagate_until(5.);
+        ta_cmp.propagate_until(5.);
+
+        REQUIRE(ta.get_state() == ta_cmp.get_state());
+
+        // Remove the damping term, the parameter is dropped.
+        ta.update_equations({{1u, -9.8 * sin(x)}});
+        REQUIRE(ta.get_pars().empty());
+
+        // Implicit form of the system (the state
+        // variables are ordered alphabetically).
+        auto ta_impl = taylor_adaptive<double>{{-9.8 * sin(x), v}, {0.025, 0.05}, kw::compact_mode = cm};
+        ta_impl.update_equations({{0u, -9.8 * sin(x) - v}});
+        auto ta_expl = taylor_adaptive<double>{
+            {prime(v) = -9.8 * sin(x) - v, prime(x) = v}, {0.025, 0.05}, kw::compact_mode = cm};
+        REQUIRE(ta_impl.get_decomposition() == ta_expl.get_decomposition());
+
+        // Error modes.
+        REQUIRE_THROWS_MATCHES(
+            ta.update_equations({{2u, x}}), std::invalid_argument,
+            Message("Cannot update the equation at index 2 of an adaptive Taylor integrator with 2 equations"));
+
+        auto ta_dc = taylor_adaptive<double>{taylor_precomputed_dc({prime(x) = v, prime(v) = -9.8 * sin(x)}),
+                                             {0.05, 0.025}, kw::compact_mode = cm};
+        REQUIRE_THROWS_MATCHES(ta_dc.update_equations({{1u, x}}), std::invalid_argument,
+                               Message("Cannot update the equations of an adaptive Taylor integrator which was "
+                                       "constructed from a precomputed decomposition or deserialised"));
+    }
+}
+
+TEST_CASE("specialise pars")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto fs : {false, true}) {
+            const auto sys = std::vector{prime(x) = v, prime(v) = -par[0] * par[1] * sin(x)};
+
+            auto ta = taylor_adaptive<double>{
+                sys, {0.05, 0.025}, kw::compact_mode = cm, kw::fused_step = fs, kw::pars = {9.8, 1.}};
+            auto ta_cmp = ta;
+
+            REQUIRE(!ta.get_pars_specialised());
+
+            ta.specialise_pars();
+            REQUIRE(ta.get_pars_specialised());
+
+            // The specialised stepper survives copies.
+            auto ta_copy = ta;
+            REQUIRE(ta_copy.get_pars_specialised());
+            REQUIRE(ta.shared_copy().get_pars_specialised());
+
+            ta.propagate_until(10.);
+            ta_copy.propagate_until(10.);
+            ta_cmp.propagate_until(10.);
+
+            REQUIRE(ta.get_state() == ta_copy.get_state());
+            REQUIRE(ta.get_state()[0] == approximately(ta_cmp.get_state()[0], 1000.));
+            REQUIRE(ta.get_state()[1] == approximately(ta_cmp.get_state()[1], 1000.));
+
+            // Changing a parameter switches back to the generic stepper.
+            ta.set_time(0.);
+            ta.get_state_data()[0] = 0.05;
+            ta.get_state_data()[1] = 0.025;
+            ta.get_pars_data()[1] = 2.;
+            REQUIRE(!ta.get_pars_specialised());
+
+            ta_cmp.set_time(0.);
+            ta_cmp.get_state_data()[0] = 0.05;
+            ta_cmp.get_state_data()[1] = 0.025;
+            ta_cmp.get_pars_data()[1] = 2.;
+
+            ta.propagate_until(10.);
+            ta_cmp.propagate_until(10.);
+
+            REQUIRE(ta.get_state() == ta_cmp.get_state());
+
+            // Restoring the value re-enables the specialised stepper.
+            ta.get_pars_data()[1] = 1.;
+            REQUIRE(ta.get_pars_specialised());
+        }
+    }
+
+    // Parameters in the events are read at runtime.
+    {
+        auto counter = 0;
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -par[0] * sin(x)},
+                                          {0.05, 0.025},
+                                          kw::pars = {9.8, 0.},
+                                          kw::nt_events = {nt_event<double>(
+                                              x - par[1], [&counter](taylor_adaptive<double> &, double, int) {
+                                                  ++counter;
+                                              })}};
+        ta.specialise_pars();
+
+        ta.propagate_until(10.);
+        REQUIRE(counter > 0);
+    }
+
+    auto ta_dc = taylor_adaptive<double>{taylor_precomputed_dc({prime(x) = v, prime(v) = -par[0] * sin(x)}),
+                                         {0.05, 0.025}};
+    REQUIRE_THROWS_MATCHES(ta_dc.specialise_pars(), std::invalid_argument,
+                           Message("Cannot specialise the parameters of an adaptive Taylor integrator which was "
+                                   "constructed from a precomputed decomposition or deserialised"));
+}
+
+TEST_CASE("step fixed")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta
+            = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+        auto ta_cmp = ta;
+
+        REQUIRE(ta.get_fixed_step_order() == 0u);
+
+        for (auto i = 0; i < 100; ++i) {
+            auto [oc, h] = ta.step_fixed(0.01, true);
+            REQUIRE(oc == taylor_outcome::success);
+            REQUIRE(h == 0.01);
+
+            // NOTE: the adaptive timestep is larger
+            // than 0.01, thus the step is clamped.
+            auto [oc_cmp, h_cmp] = ta_cmp.step(0.01, true);
+            REQUIRE(oc_cmp == taylor_outcome::time_limit);
+            REQUIRE(h_cmp == 0.01);
+
+            REQUIRE(ta.get_state()[0] == approximately(ta_cmp.get_state()[0], 100.));
+            REQUIRE(ta.get_state()[1] == approximately(ta_cmp.get_state()[1], 100.));
+        }
+
+        REQUIRE(ta.get_fixed_step_order() == ta.get_order());
+        REQUIRE(ta.get_time() == approximately(1.));
+        for (decltype(ta.get_tc().size()) i = 0; i < ta.get_tc().size(); ++i) {
+            REQUIRE(ta.get_tc()[i] == approximately(ta_cmp.get_tc()[i], 1000.));
+        }
+
+        // The fixed-step stepper survives copies.
+        auto ta_copy = ta;
+        REQUIRE(ta_copy.get_fixed_step_order() == ta.get_order());
+        ta_copy.step_fixed(0.01);
+        ta.step_fixed(0.01);
+        REQUIRE(ta_copy.get_state() == ta.get_state());
+
+        // Reduced order.
+        ta.prepare_fixed_step(12);
+        REQUIRE(ta.get_fixed_step_order() == 12u);
+        ta_cmp.step(0.01);
+        ta.step_fixed(0.01);
+        REQUIRE(ta.get_state()[0] == approximately(ta_cmp.get_state()[0], 1000.));
+        REQUIRE(ta.get_state()[1] == approximately(ta_cmp.get_state()[1], 1000.));
+
+        // Error modes.
+        REQUIRE_THROWS_MATCHES(ta.step_fixed(0.01, true), std::invalid_argument,
+                               Message("The Taylor coefficients cannot be written by the step_fixed() function of an "
+                                       "adaptive Taylor integrator if the order of the fixed-step stepper (12) differs "
+                                       "from the order of the integrator ("
+                                       + std::to_string(ta.get_order()) + ")"));
+        REQUIRE_THROWS_MATCHES(ta.step_fixed(std::numeric_limits<double>::infinity()), std::invalid_argument,
+                               Message("A non-finite timestep of inf was passed to the step_fixed() function of an "
+                                       "adaptive Taylor integrator"));
+
+        auto ta_ev = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                             {0.05, 0.025},
+                                             kw::compact_mode = cm,
+                                             kw::t_events = {t_event<double>(v)}};
+        REQUIRE_THROWS_MATCHES(
+            ta_ev.step_fixed(0.01), std::invalid_argument,
+            Message("The fixed-step mode is not available in an adaptive Taylor integrator with events"));
+    }
+}
+
+TEST_CASE("var order")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::compact_mode = cm};
+
+        REQUIRE(ta.get_var_orders().empty());
+        REQUIRE(ta.get_last_order() == ta.get_order());
+
+        // Default orders.
+        ta.enable_var_order();
+        REQUIRE(ta.get_var_orders() == std::vector<std::uint32_t>{12, 16});
+
+        // The tolerance is satisfied regardless of the selected orders,
+        // and the dense output is consistent with the padded coefficients.
+        const std::vector<double> grid{1., 3., 5., 7., 9.};
+        const auto out = std::get<4>(ta.propagate_grid(grid));
+
+        for (auto i = 0u; i < grid.size(); ++i) {
+            REQUIRE(std::abs(out[2u * i] - std::sin(grid[i])) < 1e-12);
+            REQUIRE(std::abs(out[2u * i + 1u] - std::cos(grid[i])) < 1e-12);
+        }
+
+        const auto last_order = ta.get_last_order();
+        REQUIRE((last_order == 12u || last_order == 16u || last_order == ta.get_order()));
+
+        // The variable-order steppers survive copies.
+        auto ta_copy = ta;
+        REQUIRE(ta_copy.get_var_orders() == ta.get_var_orders());
+        ta.propagate_until(20.);
+        ta_copy.propagate_until(20.);
+        REQUIRE(ta_copy.get_state() == ta.get_state());
+        REQUIRE(std::abs(ta.get_state()[0] - std::sin(20.)) < 1e-12);
+
+        // Explicit orders.
+        ta.enable_var_order({10, 4, 10});
+        REQUIRE(ta.get_var_orders() == std::vector<std::uint32_t>{4, 10});
+        ta.propagate_until(30.);
+        REQUIRE(std::abs(ta.get_state()[0] - std::sin(30.)) < 1e-12);
+        REQUIRE(std::abs(ta.get_state()[1] - std::cos(30.)) < 1e-12);
+
+        ta.disable_var_order();
+        REQUIRE(ta.get_var_orders().empty());
+        REQUIRE(ta.get_last_order() == ta.get_order());
+
+        // Error modes.
+        REQUIRE_THROWS_MATCHES(ta.enable_var_order({1}), std::invalid_argument,
+                               Message("Invalid order 1 passed to enable_var_order() in an adaptive Taylor "
+                                       "integrator: the order must be at least 2 and less than the order of the "
+                                       "integrator (20)"));
+        REQUIRE_THROWS_MATCHES(ta.enable_var_order({20}), std::invalid_argument,
+                               Message("Invalid order 20 passed to enable_var_order() in an adaptive Taylor "
+                                       "integrator: the order must be at least 2 and less than the order of the "
+                                       "integrator (20)"));
+
+        auto ta_ev = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -x}, {0., 1.}, kw::compact_mode = cm, kw::t_events = {t_event<double>(v)}};
+        REQUIRE_THROWS_MATCHES(
+            ta_ev.enable_var_order(), std::invalid_argument,
+            Message("The variable-order mode is not available in an adaptive Taylor integrator with events"));
+
+        auto ta_fused = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -x}, {0., 1.}, kw::compact_mode = cm, kw::fused_step = true};
+        REQUIRE_THROWS_MATCHES(ta_fused.enable_var_order(), std::invalid_argument,
+                               Message("The variable-order mode is not available in an adaptive Taylor integrator "
+                                       "with the fused stepper"));
+    }
+}
+
+TEST_CASE("step enclosure")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Scalar integrator.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    for (auto fwd : {true, false}) {
+        for (auto i = 0; i < 20; ++i) {
+            if (fwd) {
+                ta.step(true);
+            } else {
+                ta.step_backward(true);
+            }
+
+            const auto enc = ta.get_step_enclosure();
+            REQUIRE(enc.size() == 4u);
+
+            const auto h = ta.get_last_h();
+            const auto t_end = ta.get_time();
+
+            for (auto k = 0; k <= 100; ++k) {
+                const auto &d_out = ta.update_d_output(t_end - h + h * k / 100);
+
+                for (auto j = 0u; j < 2u; ++j) {
+                    REQUIRE(enc[j] <= d_out[j]);
+                    REQUIRE(d_out[j] <= enc[2u + j]);
+                }
+            }
+        }
+    }
+
+    // Batch integrator.
+    auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2u};
+
+    for (auto i = 0; i < 20; ++i) {
+        tab.step(true);
+
+        const auto enc = tab.get_step_enclosure();
+        REQUIRE(enc.size() == 8u);
+
+        const auto hs = tab.get_last_h();
+        const auto t_ends = tab.get_time();
+
+        for (auto k = 0; k <= 100; ++k) {
+            const auto &d_out = tab.update_d_output(
+                {t_ends[0] - hs[0] + hs[0] * k / 100, t_ends[1] - hs[1] + hs[1] * k / 100});
+
+            for (auto j = 0u; j < 4u; ++j) {
+                REQUIRE(enc[j] <= d_out[j]);
+                REQUIRE(d_out[j] <= enc[4u + j]);
+            }
+        }
+    }
+}
+
+TEST_CASE("memory usage")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}, kw::compact_mode = cm};
+
+        auto mu = ta.get_memory_usage();
+
+        REQUIRE(mu.state >= 2u * sizeof(double));
+        REQUIRE(mu.tc >= 2u * (ta.get_order() + 1u) * sizeof(double));
+        REQUIRE(mu.d_out >= 2u * sizeof(double));
+        REQUIRE(mu.events == 0u);
+        REQUIRE(mu.decomposition > 0u);
+        REQUIRE(mu.bc_snapshot == ta.get_llvm_state().get_bc().size());
+        REQUIRE(mu.object_code == ta.get_llvm_state().get_object_code().size());
+        REQUIRE(mu.jit > 0u);
+        REQUIRE(mu.jit < mu.object_code);
+        REQUIRE(mu.total
+                == mu.state + mu.pars + mu.tc + mu.d_out + mu.events + mu.other + mu.decomposition + mu.bc_snapshot
+                       + mu.object_code + mu.jit);
+
+        std::ostringstream oss;
+        oss << mu;
+        REQUIRE(boost::algorithm::contains(oss.str(), "JIT memory"));
+
+        // With events.
+        auto cb = [](taylor_adaptive<double> &, double, int) {};
+        auto ta_ev = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                             {0.05, 0.025},
+                                             kw::compact_mode = cm,
+                                             kw::nt_events = {nt_event<double>(v, cb)}};
+
+        REQUIRE(ta_ev.get_memory_usage().events >= 3u * (ta_ev.get_order() + 1u) * sizeof(double));
+
+        ta_ev.propagate_until(10.);
+
+        REQUIRE(ta_ev.get_memory_usage().events > 3u * (ta_ev.get_order() + 1u) * sizeof(double));
+
+        // Batch mode.
+        auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                 {0.05, 0.06, 0.025, 0.026},
+                                                 2u,
+                                                 kw::compact_mode = cm};
+
+        auto mub = tab.get_memory_usage();
+
+        REQUIRE(mub.state >= 4u * sizeof(double));
+        REQUIRE(mub.other > 0u);
+        REQUIRE(mub.object_code == tab.get_llvm_state().get_object_code().size());
+        REQUIRE(mub.total > mub.object_code);
+    }
+}
+
+TEST_CASE("propagate async")
+{
+    using std::isnan;
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    auto ta_sync = ta;
+
+    // propagate_until().
+    auto fut = ta.propagate_until_async(10.);
+    const auto res = fut.get();
+    REQUIRE(res == ta_sync.propagate_until(10.));
+    REQUIRE(ta.get_state() == ta_sync.get_state());
+    REQUIRE(ta.get_time() == 10.);
+
+    // propagate_for(), with a copied callback.
+    std::size_t n_cb = 0;
+    fut = ta.propagate_for_async(
+        10., kw::callback = [&n_cb](taylor_adaptive<double> &) {
+            ++n_cb;
+            return true;
+        });
+    REQUIRE(std::get<0>(fut.get()) == taylor_outcome::time_limit);
+    REQUIRE(n_cb > 0u);
+    REQUIRE(ta.get_time() == 20.);
+
+    // propagate_grid().
+    ta_sync = ta;
+    const std::vector<double> grid{20., 21., 22., 23.};
+    auto gfut = ta.propagate_grid_async(grid, kw::components = std::vector<std::uint32_t>{1});
+    const auto gres = gfut.get();
+    const auto gres_sync = ta_sync.propagate_grid(grid, kw::components = std::vector<std::uint32_t>{1});
+    REQUIRE(std::get<4>(gres).size() == 4u);
+    REQUIRE(std::get<4>(gres) == std::get<4>(gres_sync));
+
+    // User-supplied executor.
+    std::thread th;
+    std::size_t n_tasks = 0;
+    auto ex = [&th, &n_tasks](std::function<void()> task) {
+        ++n_tasks;
+        th = std::thread(std::move(task));
+    };
+
+    fut = ta.propagate_until_async(30., kw::executor = ex);
+    REQUIRE(std::get<0>(fut.get()) == taylor_outcome::time_limit);
+    th.join();
+    REQUIRE(n_tasks == 1u);
+    REQUIRE(ta.get_time() == 30.);
+
+    // An executor discarding the task.
+    fut = ta.propagate_until_async(40., kw::executor = [](std::function<void()>) {});
+    REQUIRE_THROWS_AS(fut.get(), std::future_error);
+    REQUIRE(ta.get_time() == 30.);
+
+    // Cancellation.
+    auto cancel = std::make_shared<std::atomic<bool>>(true);
+    fut = ta.propagate_until_async(1000., kw::cancel = cancel);
+    REQUIRE(std::get<0>(fut.get()) == taylor_outcome::cb_stop);
+    REQUIRE(ta.get_time() < 1000.);
+
+    cancel->store(false);
+    n_cb = 0;
+    fut = ta.propagate_until_async(
+        1000., kw::cancel = cancel, kw::callback = [&n_cb, cancel](taylor_adaptive<double> &) {
+            if (++n_cb == 10u) {
+                cancel->store(true);
+            }
+            return true;
+        });
+    REQUIRE(std::get<0>(fut.get()) == taylor_outcome::cb_stop);
+    REQUIRE(n_cb == 10u);
+    REQUIRE(ta.get_time() < 1000.);
+
+    // Errors are reported via the future.
+    fut = ta.propagate_until_async(std::numeric_limits<double>::quiet_NaN());
+    REQUIRE_THROWS_AS(fut.get(), std::invalid_argument);
+}
+
+TEST_CASE("h collapse")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // The solution of x' = x**2 with x(0) = 1
+    // has a singularity at t = 1.
+    auto ta = taylor_adaptive<double>{{prime(x) = x * x}, {1.}};
+
+    REQUIRE(ta.get_h_collapse() == std::pair{0., std::size_t(0)});
+
+    REQUIRE_THROWS_AS(ta.set_h_collapse(-1., 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_h_collapse(std::numeric_limits<double>::quiet_NaN(), 10), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_h_collapse(1e-6, 0), std::invalid_argument);
+
+    ta.set_h_collapse(1e-6, 10);
+    REQUIRE(ta.get_h_collapse() == std::pair{1e-6, std::size_t(10)});
+
+    auto ta_copy = ta;
+
+    const auto [oc, min_h, max_h, n_steps] = ta.propagate_until(2.);
+    REQUIRE(oc == taylor_outcome::err_h_collapse);
+    REQUIRE(ta.get_time() < 1.);
+    REQUIRE(min_h < 2e-6);
+    REQUIRE(n_steps >= 10u);
+
+    // The copies keep the settings of the detector.
+    REQUIRE(ta_copy.get_h_collapse() == ta.get_h_collapse());
+    REQUIRE(std::get<0>(ta_copy.propagate_grid({0., .5, 2.})) == taylor_outcome::err_h_collapse);
+    REQUIRE(ta_copy.get_time() < 1.);
+
+    // A non-collapsing propagation.
+    ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+    ta.set_h_collapse(1e-6, 10);
+    REQUIRE(std::get<0>(ta.propagate_until(100.)) == taylor_outcome::time_limit);
+
+    // Disable the detector.
+    ta.set_h_collapse(0., 0);
+    REQUIRE(ta.get_h_collapse() == std::pair{0., std::size_t(0)});
+}
+
+TEST_CASE("invariants monitor")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+
+    REQUIRE(ta.get_invariants().empty());
+
+    // Error handling.
+    REQUIRE_THROWS_AS(ta.set_invariants({x * x + v * v}, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_invariants({x * x + v * v}, 1, {1., 1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_invariants({x * x + v * v}, 1, {-1.}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_invariants({x + heyoka::time}), std::invalid_argument);
+    REQUIRE(ta.get_invariants().empty());
+
+    // Monitor the energy every 3 steps, with a history of 5 records.
+    ta.set_invariants({x * x + v * v}, 3, {}, 5);
+    REQUIRE(ta.get_invariants().size() == 1u);
+    REQUIRE(ta.get_invariants_ref() == std::vector{1.});
+
+    auto ta_copy = ta;
+
+    const auto [oc, _1, _2, n_steps] = ta.propagate_until(100.);
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(n_steps >= 15u);
+
+    const auto hist = ta.get_invariants_history();
+    REQUIRE(hist.size() == 10u);
+    for (auto i = 0u; i < 5u; ++i) {
+        REQUIRE(hist[2u * i + 1u] == approximately(1., 1000.));
+        if (i > 0u) {
+            REQUIRE(hist[2u * i] > hist[2u * (i - 1u)]);
+        }
+    }
+    REQUIRE(ta.get_invariants_drift()[0] < 1e-12);
+
+    // The copies keep the monitor.
+    REQUIRE(ta_copy.get_invariants() == ta.get_invariants());
+    ta_copy.propagate_until(100.);
+    REQUIRE(ta_copy.get_invariants_history() == hist);
+
+    // A damped oscillator: the propagation is stopped
+    // when the drift of the energy exceeds the threshold.
+    ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x - .1 * v}, {0., 1.}};
+    ta.set_invariants({x * x + v * v}, 1, {1e-2});
+    REQUIRE(std::get<0>(ta.propagate_until(100.)) == taylor_outcome::cb_stop);
+    REQUIRE(ta.get_time() < 100.);
+    REQUIRE(ta.get_invariants_drift()[0] > 1e-2);
+
+    // Remove the monitor.
+    ta.set_invariants({});
+    REQUIRE(ta.get_invariants().empty());
+    REQUIRE(std::get<0>(ta.propagate_until(100.)) == taylor_outcome::time_limit);
+}
+
+TEST_CASE("shared decomposition")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+    // The copies share the decomposition.
+    auto ta_copy = ta;
+    REQUIRE(&ta_copy.get_decomposition() == &ta.get_decomposition());
+
+    auto ta_copy2 = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+    REQUIRE(&ta_copy2.get_decomposition() != &ta.get_decomposition());
+    ta_copy2 = ta;
+    REQUIRE(&ta_copy2.get_decomposition() == &ta.get_decomposition());
+
+    // Copies are independent in everything else.
+    ta_copy.propagate_until(1.);
+    REQUIRE(ta.get_time() == 0.);
+    REQUIRE(ta_copy.get_decomposition() == ta.get_decomposition());
+
+    auto tab = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x}, {0., 0., 1., 1.}, 2};
+    auto tab_copy = tab;
+    REQUIRE(&tab_copy.get_decomposition() == &tab.get_decomposition());
+}
+
+TEST_CASE("taylor set_state strided")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Scalar integrator.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -par[0] * x}, {0., 1.}, kw::pars = {1.}};
+
+    const std::vector<double> buf{1., 2., 3., 4., 5., 6.};
+
+    ta.set_state(buf.data());
+    REQUIRE(ta.get_state() == std::vector{1., 2.});
+    ta.set_state(buf.data() + 1, 3);
+    REQUIRE(ta.get_state() == std::vector{2., 5.});
+    ta.set_pars(buf.data() + 5);
+    REQUIRE(ta.get_pars() == std::vector{6.});
+
+    REQUIRE_THROWS_AS(ta.set_state(nullptr), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_pars(nullptr), std::invalid_argument);
+
+    // Batch integrator.
+    auto tab = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -par[0] * x}, {0., 0., 1., 1.}, 2, kw::pars = {1., 1.}};
+
+    // SoA layout: a (2, 3) array, reading the last two columns.
+    tab.set_state(buf.data() + 1, 3, 1);
+    REQUIRE(tab.get_state() == std::vector{2., 3., 5., 6.});
+
+    // SoA layout matching the internal layout.
+    tab.set_state(buf.data(), 2, 1);
+    REQUIRE(tab.get_state() == std::vector{1., 2., 3., 4.});
+
+    // AoS layout: each batch element occupies 3 consecutive values.
+    tab.set_state(buf.data(), 1, 3);
+    REQUIRE(tab.get_state() == std::vector{1., 4., 2., 5.});
+    tab.set_pars(buf.data() + 2, 1, 3);
+    REQUIRE(tab.get_pars() == std::vector{3., 6.});
+
+    REQUIRE_THROWS_AS(tab.set_state(nullptr, 2, 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(tab.set_pars(nullptr, 2, 1), std::invalid_argument);
+
+    // No parameters.
+    auto ta_np = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+    ta_np.set_pars(nullptr);
+}
+
+TEST_CASE("taylor raw step")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto lc : {false, true}) {
+            auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -par[0] * sin(x)},
+                                              {0.05, 0.025},
+                                              kw::pars = {9.8},
+                                              kw::compact_mode = cm,
+                                              kw::fused_step = true,
+                                              kw::lazy_compile = lc};
+            auto ta_copy = ta;
+
+            const auto raw_step = ta.get_raw_step();
+            REQUIRE(raw_step != nullptr);
+
+            // Drive the raw stepper on external buffers.
+            auto state = ta.get_state();
+            auto pars = ta.get_pars();
+            std::vector<double> tc(ta.get_tc().size());
+            double time_hi = 0, time_lo = 0;
+
+            for (auto i = 0; i < 20; ++i) {
+                double h = std::numeric_limits<double>::infinity();
+                std::int32_t flag = -1;
+
+                raw_step(state.data(), pars.data(), &time_hi, &time_lo, &h, tc.data(), &flag);
+                const auto [oc, h_ref] = ta_copy.step(true);
+
+                REQUIRE(flag == taylor_raw_step_success);
+                REQUIRE(oc == taylor_outcome::success);
+                REQUIRE(h == approximately(h_ref));
+                REQUIRE(time_hi == approximately(ta_copy.get_time()));
+                REQUIRE(state[0] == approximately(ta_copy.get_state()[0]));
+                REQUIRE(state[1] == approximately(ta_copy.get_state()[1]));
+                REQUIRE(tc[1] == approximately(ta_copy.get_tc()[1]));
+            }
+
+            // Time limit.
+            double h = 1e-3;
+            std::int32_t flag = -1;
+            raw_step(state.data(), pars.data(), &time_hi, &time_lo, &h, nullptr, &flag);
+            REQUIRE(flag == taylor_raw_step_time_limit);
+            REQUIRE(h == 1e-3);
+
+            // Non-finite state.
+            state[0] = std::numeric_limits<double>::quiet_NaN();
+            h = std::numeric_limits<double>::infinity();
+            raw_step(state.data(), pars.data(), &time_hi, &time_lo, &h, nullptr, &flag);
+            REQUIRE(flag == taylor_raw_step_err_nf_state);
+
+            // The internal state is not touched.
+            REQUIRE(ta.get_time() == 0.);
+            REQUIRE(ta.get_state() == std::vector{0.05, 0.025});
+        }
+    }
+
+    // The raw stepper requires the fused stepper.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+    REQUIRE_THROWS_MATCHES(ta.get_raw_step(), std::invalid_argument,
+                           Message("The raw stepper is available only if the adaptive Taylor integrator was "
+                                   "constructed with the fused stepper (kw::fused_step)"));
+}
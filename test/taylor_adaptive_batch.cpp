@@ -8,6 +8,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <limits>
 #include <random>
@@ -276,6 +278,70 @@ TEST_CASE("propagate grid")
     }
 }
 
+// Test the propagate_grid() overload writing into
+// an output buffer, and the selection of the output components.
+TEST_CASE("propagate grid out")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v, y] = make_vars("x", "v", "y");
+
+    const std::vector<double> init_state{0., 0.01, 1., 1.1, 0., 0.};
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x, prime(y) = x}, init_state, 2u};
+    auto ta_copy = ta;
+
+    const std::vector<double> grid{.1, .2, .5, .6, 1., 1.1};
+
+    const auto ref = ta_copy.propagate_grid(grid);
+    REQUIRE(ref.size() == 18u);
+
+    // Subset of the components, with padding between the rows.
+    std::vector<double> out(15u, -1.);
+    ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{2, 0}, kw::stride = 5u);
+
+    for (auto i = 0u; i < 2u; ++i) {
+        REQUIRE(std::get<0>(ta.get_propagate_res()[i]) == taylor_outcome::time_limit);
+    }
+
+    for (auto g = 0u; g < 3u; ++g) {
+        for (auto i = 0u; i < 2u; ++i) {
+            REQUIRE(out[g * 5u + i] == ref[g * 6u + 4u + i]);
+            REQUIRE(out[g * 5u + 2u + i] == ref[g * 6u + i]);
+        }
+        REQUIRE(out[g * 5u + 4u] == -1.);
+    }
+
+    // All components, default stride.
+    ta.set_time({0., 0.});
+    std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+
+    out.resize(18u);
+    ta.propagate_grid(grid, out.data());
+    REQUIRE(out == ref);
+
+    // Subset of the components in the vector overload.
+    ta.set_time({0., 0.});
+    std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+
+    const auto vout = ta.propagate_grid(grid, kw::components = std::vector<std::uint32_t>{1});
+    REQUIRE(vout == std::vector{ref[2], ref[3], ref[8], ref[9], ref[14], ref[15]});
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES(ta.propagate_grid(grid, static_cast<double *>(nullptr)), std::invalid_argument,
+                           Message("A null output buffer was passed to the propagate_grid() function of an adaptive "
+                                   "Taylor integrator in batch mode"));
+    REQUIRE_THROWS_MATCHES(
+        ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{3}), std::invalid_argument,
+        Message("Invalid output component 3 passed to the propagate_grid() function of an adaptive Taylor "
+                "integrator in batch mode: the component must be less than the dimension of the system (3)"));
+    REQUIRE_THROWS_MATCHES(
+        ta.propagate_grid(grid, out.data(), kw::components = std::vector<std::uint32_t>{0, 1}, kw::stride = 3u),
+        std::invalid_argument,
+        Message("The stride passed to the propagate_grid() function of an adaptive Taylor integrator in batch mode (3) "
+                "is less than the number of output components times the batch size (4)"));
+}
+
 // A test to make sure the propagate functions deal correctly
 // with trivial dynamics.
 TEST_CASE("propagate trivial")
@@ -318,6 +384,86 @@ TEST_CASE("set time")
     ta.set_time({1, -2});
 
     REQUIRE(ta.get_time() == std::vector{1., -2.});
+
+    // Set the time of a single batch element.
+    ta.set_time(1, 3.);
+
+    REQUIRE(ta.get_time() == std::vector{1., 3.});
+
+    REQUIRE_THROWS_MATCHES(ta.set_time(2, 3.), std::invalid_argument,
+                           Message("Cannot set the time of the batch element at index 2 in a Taylor integrator in "
+                                   "batch mode: the batch size is only 2"));
+}
+
+TEST_CASE("reset lane")
+{
+    using Catch::Matchers::Message;
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = par[0]}, {0, 0, 0.1, 0.1}, 2, kw::pars = std::vector{1., 2.}};
+
+    ta.propagate_until({1., 1.});
+
+    // Reset the second batch element, keeping the parameters.
+    ta.reset_lane(1, {.5, -.5}, 3.);
+
+    REQUIRE(ta.get_time() == std::vector{1., 3.});
+    REQUIRE(ta.get_state()[1] == .5);
+    REQUIRE(ta.get_state()[3] == -.5);
+    REQUIRE(ta.get_pars() == std::vector{1., 2.});
+    REQUIRE(ta.get_state()[0] != 0.);
+
+    // Reset also the parameters.
+    ta.reset_lane(0, {1., 2.}, -1., {3.});
+
+    REQUIRE(ta.get_time() == std::vector{-1., 3.});
+    REQUIRE(ta.get_state() == std::vector{1., .5, 2., -.5});
+    REQUIRE(ta.get_pars() == std::vector{3., 2.});
+
+    // The integration of the reset batch element
+    // proceeds from the new state.
+    ta.propagate_until({0., 4.});
+
+    REQUIRE(ta.get_state()[0] == approximately(1. + 2. + 3. / 2));
+    REQUIRE(ta.get_state()[1] == approximately(.5 - .5 + 2. / 2));
+
+    REQUIRE_THROWS_MATCHES(ta.reset_lane(2, {1., 2.}, 0.), std::invalid_argument,
+                           Message("Cannot reset the batch element at index 2 in a Taylor integrator in batch mode: "
+                                   "the batch size is only 2"));
+    REQUIRE_THROWS_MATCHES(ta.reset_lane(0, {1.}, 0.), std::invalid_argument,
+                           Message("Invalid state vector passed to reset_lane() in a Taylor integrator in batch "
+                                   "mode: the state vector has a size of 1, but the dimension of the system is 2"));
+    REQUIRE_THROWS_MATCHES(ta.reset_lane(0, {1., 2.}, 0., {1., 2.}), std::invalid_argument,
+                           Message("Invalid vector of parameters passed to reset_lane() in a Taylor integrator in "
+                                   "batch mode: the vector has a size of 2, but the number of parameters is 1"));
+}
+
+TEST_CASE("soa aos")
+{
+    for (std::uint32_t batch_size : {1u, 3u, 8u, 19u}) {
+        for (std::size_t n : {1u, 2u, 7u}) {
+            std::vector<double> soa(n * batch_size), aos(soa.size()), soa2(soa.size());
+
+            for (std::size_t j = 0; j < n; ++j) {
+                for (std::uint32_t i = 0; i < batch_size; ++i) {
+                    soa[j * batch_size + i] = static_cast<double>(j * 100u + i);
+                }
+            }
+
+            batch_soa_to_aos(soa.data(), aos.data(), n, batch_size);
+
+            for (std::uint32_t i = 0; i < batch_size; ++i) {
+                for (std::size_t j = 0; j < n; ++j) {
+                    REQUIRE(aos[i * n + j] == static_cast<double>(j * 100u + i));
+                }
+            }
+
+            batch_aos_to_soa(aos.data(), soa2.data(), n, batch_size);
+
+            REQUIRE(soa2 == soa);
+        }
+    }
 }
 
 TEST_CASE("propagate for_until")
@@ -644,3 +790,562 @@ TEST_CASE("cb interrupt")
         REQUIRE(ta.get_time()[1] < 32.);
     }
 }
+
+TEST_CASE("auto batch size")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x + par[0])};
+
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::pars = {0.01}};
+
+    for (auto tune : {false, true}) {
+        auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.025}, 0, kw::pars = {0.01}, kw::time = {1.},
+                                                 kw::tune_batch_size = tune};
+
+        const auto batch_size = tab.get_batch_size();
+
+        if (tune) {
+            REQUIRE((batch_size == recommended_batch_size<double>()
+                     || batch_size == 2u * recommended_batch_size<double>()
+                     || batch_size == 4u * recommended_batch_size<double>()));
+        } else {
+            REQUIRE(batch_size == recommended_batch_size<double>());
+        }
+
+        REQUIRE(tab.get_state().size() == 2u * batch_size);
+        REQUIRE(tab.get_pars().size() == batch_size);
+        REQUIRE(tab.get_time() == std::vector<double>(batch_size, 1.));
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            REQUIRE(tab.get_state()[i] == 0.05);
+            REQUIRE(tab.get_state()[batch_size + i] == 0.025);
+            REQUIRE(tab.get_pars()[i] == 0.01);
+        }
+
+        // All the batch elements integrate the same problem.
+        tab.propagate_for(std::vector<double>(batch_size, 5.));
+
+        ta.set_time(0.);
+        ta.get_state_data()[0] = 0.05;
+        ta.get_state_data()[1] = 0.025;
+        ta.propagate_for(5.);
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            REQUIRE(tab.get_state()[i] == approximately(ta.get_state()[0], 1000.));
+            REQUIRE(tab.get_state()[batch_size + i] == approximately(ta.get_state()[1], 1000.));
+        }
+    }
+
+    // Default initial time.
+    REQUIRE(taylor_adaptive_batch<double>{sys, {0.05, 0.025}, 0}.get_time()
+            == std::vector<double>(recommended_batch_size<double>(), 0.));
+
+    // Error modes.
+    REQUIRE_THROWS_MATCHES((taylor_adaptive_batch<double>{sys, {0.05, 0.025, 0.1, 0.2}, 0}), std::invalid_argument,
+                           Message("Inconsistent sizes detected in the initialization of an adaptive Taylor "
+                                   "integrator in automatic batch size mode: the state vector has a size of 4, "
+                                   "while the number of equations is 2"));
+    REQUIRE_THROWS_MATCHES((taylor_adaptive_batch<double>{sys, {0.05, 0.025}, 0, kw::time = {1., 2.}}),
+                           std::invalid_argument,
+                           Message("Invalid size detected in the initialization of an adaptive Taylor "
+                                   "integrator in automatic batch size mode: the time vector has a size of 2, "
+                                   "but a size of 1 is required"));
+    REQUIRE_THROWS_MATCHES((taylor_adaptive_batch<double>{sys, {0.05, 0.025}, 0, kw::pars = {1., 2.}}),
+                           std::invalid_argument,
+                           Message("Excessive number of parameter values passed to the constructor of an adaptive "
+                                   "Taylor integrator in automatic batch size mode: 2 parameter values were passed, "
+                                   "but the ODE system contains only 1 parameters"));
+    REQUIRE_THROWS_MATCHES((taylor_adaptive_batch<double>{sys, {0.05, 0.025, 0.06, 0.026}, 2,
+                                                          kw::tune_batch_size = true}),
+                           std::invalid_argument,
+                           Message("The batch size of an adaptive Taylor integrator can be tuned only in "
+                                   "automatic batch size mode (i.e., if the batch size is zero)"));
+}
+
+TEST_CASE("fused step")
+{
+    using std::isfinite;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            auto tab = taylor_adaptive_batch<double>{
+                sys, {0.05, 0.06, 0.025, 0.026}, 2u, kw::compact_mode = cm, kw::high_accuracy = ha};
+            auto tab_f = taylor_adaptive_batch<double>{sys,
+                                                       {0.05, 0.06, 0.025, 0.026},
+                                                       2u,
+                                                       kw::compact_mode = cm,
+                                                       kw::high_accuracy = ha,
+                                                       kw::fused_step = true};
+
+            REQUIRE(!tab.get_fused_step());
+            REQUIRE(tab_f.get_fused_step());
+
+            // The fused stepper must produce exactly the same results.
+            for (auto i = 0; i < 100; ++i) {
+                tab.step(true);
+                tab_f.step(true);
+
+                REQUIRE(tab.get_step_res() == tab_f.get_step_res());
+                REQUIRE(tab.get_state() == tab_f.get_state());
+                REQUIRE(tab.get_time() == tab_f.get_time());
+                REQUIRE(tab.get_last_h() == tab_f.get_last_h());
+                REQUIRE(tab.get_tc() == tab_f.get_tc());
+            }
+
+            // Time limit in one batch element only.
+            tab_f.step({1e-3, 10.});
+            REQUIRE(std::get<0>(tab_f.get_step_res()[0]) == taylor_outcome::time_limit);
+            REQUIRE(std::get<0>(tab_f.get_step_res()[1]) == taylor_outcome::success);
+
+            // Propagation.
+            tab_f.propagate_until({20., 21.});
+            REQUIRE(tab_f.get_time() == std::vector<double>{20., 21.});
+
+            // Copy semantics.
+            auto tab_copy = tab_f;
+            REQUIRE(tab_copy.get_fused_step());
+            tab_copy.step();
+            tab_f.step();
+            REQUIRE(tab_copy.get_state() == tab_f.get_state());
+            REQUIRE(tab_copy.get_time() == tab_f.get_time());
+
+            // Non-finite state in one batch element only.
+            tab_f.get_state_data()[1] = std::numeric_limits<double>::infinity();
+            tab_f.step();
+            REQUIRE(std::get<0>(tab_f.get_step_res()[0]) == taylor_outcome::success);
+            REQUIRE(std::get<0>(tab_f.get_step_res()[1]) == taylor_outcome::err_nf_state);
+        }
+    }
+
+    // The flag is ignored with events.
+    auto tab = taylor_adaptive_batch<double>{sys, {0.05, 0.06, 0.025, 0.026}, 2u, kw::fused_step = true,
+                                             kw::t_events = {t_event_batch<double>(x - 1.)}};
+    REQUIRE(!tab.get_fused_step());
+}
+
+// Propagation over per-lane grids.
+TEST_CASE("propagate grid lanes")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const std::uint32_t batch_size = 4;
+
+    // Harmonic oscillator, x(t) = x0 cos(t) + v0 sin(t).
+    auto exact_x = [](double x0, double v0, double t0, double t) {
+        return x0 * std::cos(t - t0) + v0 * std::sin(t - t0);
+    };
+
+    const std::vector<double> init_state{0., .1, .2, .3, 1., .9, .8, .7};
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x}, init_state, batch_size};
+
+    // Grids of different lengths and directions, including an empty grid.
+    std::vector<std::vector<double>> grids{{0., 1., 2., 3., 10.}, {.5, .6}, {}, {-1., -2., -5.}};
+
+    auto res = ta.propagate_grid_lanes(grids, kw::components = {0u});
+
+    REQUIRE(res.size() == batch_size);
+    for (std::uint32_t i = 0; i < batch_size; ++i) {
+        REQUIRE(res[i].size() == grids[i].size());
+        REQUIRE(std::get<0>(ta.get_propagate_res()[i]) == taylor_outcome::time_limit);
+
+        for (decltype(res[i].size()) j = 0; j < res[i].size(); ++j) {
+            REQUIRE(res[i][j]
+                    == approximately(exact_x(init_state[i], init_state[batch_size + i], 0., grids[i][j]), 1000.));
+        }
+    }
+
+    // The batch elements stop at the end of their grids.
+    REQUIRE(ta.get_time()[0] == 10.);
+    REQUIRE(ta.get_time()[1] == .6);
+    REQUIRE(ta.get_time()[2] == 0.);
+    REQUIRE(ta.get_time()[3] == -5.);
+
+    // Per-lane step limit.
+    ta.set_time({0., 0., 0., 0.});
+    std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+    res = ta.propagate_grid_lanes({{0., 100.}, {1.}, {1.}, {1.}}, kw::max_steps = 5u);
+    REQUIRE(std::get<0>(ta.get_propagate_res()[0]) == taylor_outcome::step_limit);
+    REQUIRE(std::get<3>(ta.get_propagate_res()[0]) == 5u);
+    REQUIRE(std::get<0>(ta.get_propagate_res()[1]) == taylor_outcome::time_limit);
+
+    // Refill from a queue of tasks, starting from idle batch elements.
+    ta.set_time({0., 0., 0., 0.});
+    std::copy(init_state.begin(), init_state.end(), ta.get_state_data());
+
+    const auto n_tasks = 11u;
+    auto next_task = 0u;
+    std::vector<unsigned> lane_task(batch_size, n_tasks);
+    std::vector<std::vector<double>> task_out(n_tasks);
+
+    auto task_grid = [](unsigned k) {
+        std::vector<double> retval;
+        for (unsigned j = 0; j <= k; ++j) {
+            retval.push_back(static_cast<double>(k) + .7 * j);
+        }
+        return retval;
+    };
+
+    res = ta.propagate_grid_lanes(
+        std::vector<std::vector<double>>(batch_size), kw::components = {0u},
+        kw::refill = [&](taylor_adaptive_batch<double> &tab, std::uint32_t i, std::vector<double> &grid,
+                         std::vector<double> &out) {
+            // Store the output of the completed task.
+            if (lane_task[i] < n_tasks) {
+                REQUIRE(std::get<0>(tab.get_propagate_res()[i]) == taylor_outcome::time_limit);
+                task_out[lane_task[i]] = std::move(out);
+            }
+
+            if (next_task == n_tasks) {
+                lane_task[i] = n_tasks;
+                return false;
+            }
+
+            // Set up the new task.
+            const auto k = next_task++;
+            lane_task[i] = k;
+            tab.get_state_data()[i] = k * .1;
+            tab.get_state_data()[batch_size + i] = 1.;
+            tab.set_time(i, static_cast<double>(k));
+            tab.reset_cooldowns(i);
+            grid = task_grid(k);
+
+            return true;
+        });
+
+    REQUIRE(next_task == n_tasks);
+    for (unsigned k = 0; k < n_tasks; ++k) {
+        const auto grid = task_grid(k);
+        REQUIRE(task_out[k].size() == grid.size());
+
+        for (decltype(grid.size()) j = 0; j < grid.size(); ++j) {
+            REQUIRE(task_out[k][j] == approximately(exact_x(k * .1, 1., static_cast<double>(k), grid[j]), 1000.));
+        }
+    }
+
+    // Error checking.
+    REQUIRE_THROWS_MATCHES(ta.propagate_grid_lanes({{1.}}), std::invalid_argument,
+                           Message("Invalid number of grids passed to propagate_grid_lanes() in an adaptive Taylor "
+                                   "integrator in batch mode: the batch size is 4, but the number of grids is 1"));
+    ta.set_time({0., 0., 0., 0.});
+    REQUIRE_THROWS_MATCHES(ta.propagate_grid_lanes({{1., 2., 1.5}, {}, {}, {}}), std::invalid_argument,
+                           Message("A non-monotonic time grid was passed to propagate_grid_lanes() in an adaptive "
+                                   "Taylor integrator in batch mode"));
+    REQUIRE_THROWS_MATCHES(ta.propagate_grid_lanes({{-1., 2.}, {}, {}, {}}), std::invalid_argument,
+                           Message("A non-monotonic time grid was passed to propagate_grid_lanes() in an adaptive "
+                                   "Taylor integrator in batch mode"));
+    REQUIRE_THROWS_MATCHES(ta.propagate_grid_lanes({{}, {}, {std::numeric_limits<double>::infinity()}, {}}),
+                           std::invalid_argument,
+                           Message("A non-finite time value was passed to propagate_grid_lanes() in an adaptive "
+                                   "Taylor integrator in batch mode"));
+}
+
+TEST_CASE("shared copy")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        auto ta = taylor_adaptive_batch<double>{
+            {prime(x) = v, prime(v) = -x}, {0., .1, 1., .9}, 2u, kw::compact_mode = cm};
+
+        auto ta_sh = ta.shared_copy();
+        auto ta_copy = ta;
+
+        REQUIRE(&ta_sh.get_llvm_state() == &ta.get_llvm_state());
+        REQUIRE(&ta_copy.get_llvm_state() != &ta.get_llvm_state());
+
+        ta_sh.get_state_data()[0] = 0.5;
+        REQUIRE(ta.get_state()[0] == 0.);
+
+        ta.propagate_until({10., 10.});
+        ta_copy.propagate_until({10., 10.});
+        REQUIRE(ta.get_state() == ta_copy.get_state());
+
+        ta_sh.get_state_data()[0] = 0.;
+        ta_sh.propagate_until({10., 10.});
+        REQUIRE(ta_sh.get_state() == ta.get_state());
+
+        // Bulk shared copies.
+        auto pool = ta.shared_copies(5);
+        REQUIRE(pool.size() == 5u);
+        for (auto &ta_p : pool) {
+            REQUIRE(&ta_p.get_llvm_state() == &ta.get_llvm_state());
+            REQUIRE(ta_p.get_state() == ta.get_state());
+        }
+        pool[0].get_state_data()[0] = 1.;
+        REQUIRE(pool[1].get_state() == ta.get_state());
+    }
+}
+
+TEST_CASE("taylor order")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x}, {0., 0., 1., 1.}, 2u, kw::order = 10u};
+    REQUIRE(ta.get_order() == 10u);
+
+    ta.propagate_until({10., 10.});
+    for (auto i = 0u; i < 2u; ++i) {
+        REQUIRE(std::abs(ta.get_state()[i] - std::sin(10.)) < 1e-12);
+        REQUIRE(std::abs(ta.get_state()[2u + i] - std::cos(10.)) < 1e-12);
+    }
+
+    auto ta_tuned
+        = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x}, {0., 0., 1., 1.}, 2u, kw::tune_order = true};
+    REQUIRE(ta_tuned.get_order() >= 16u);
+    REQUIRE(ta_tuned.get_order() <= 24u);
+
+    REQUIRE_THROWS_AS((taylor_adaptive_batch<double>{
+                          {prime(x) = v, prime(v) = -x}, {0., 0., 1., 1.}, 2u, kw::order = 10u, kw::tune_order = true}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("lane active mask")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x}, {0., 0., 0., 1., 1., 1.}, 3u};
+
+    REQUIRE(ta.get_n_active_lanes() == 3u);
+    REQUIRE(ta.get_lane_active(1));
+
+    REQUIRE_THROWS_AS(ta.set_lane_active(3, false), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.get_lane_active(3), std::invalid_argument);
+
+    ta.set_lane_active(1, false);
+    REQUIRE(!ta.get_lane_active(1));
+    REQUIRE(ta.get_n_active_lanes() == 2u);
+
+    // The inactive lane does not move.
+    ta.step();
+    REQUIRE(std::get<0>(ta.get_step_res()[1]) == taylor_outcome::time_limit);
+    REQUIRE(std::get<1>(ta.get_step_res()[1]) == 0.);
+    REQUIRE(ta.get_time()[1] == 0.);
+    REQUIRE(ta.get_time()[0] > 0.);
+    REQUIRE(ta.get_time()[0] == ta.get_time()[2]);
+
+    ta.propagate_until({10., 10., 10.});
+    REQUIRE(ta.get_time() == std::vector<double>{10., 0., 10.});
+    REQUIRE(ta.get_state()[1] == 0.);
+    REQUIRE(ta.get_state()[4] == 1.);
+    REQUIRE(std::abs(ta.get_state()[0] - std::sin(10.)) < 1e-12);
+    REQUIRE(std::abs(ta.get_state()[2] - std::sin(10.)) < 1e-12);
+
+    // No output is written for the inactive lane in propagate_grid().
+    ta.set_time({0., 0., 0.});
+    const auto out = ta.propagate_grid({0., 0., 0., 1., 1., 1.});
+    REQUIRE(ta.get_time() == std::vector<double>{1., 0., 1.});
+    REQUIRE(out[1] == 0.);
+    REQUIRE(out[4] == 0.);
+    REQUIRE(out[10] == 0.);
+    REQUIRE(std::abs(out[6] - std::sin(11.)) < 1e-12);
+
+    // Reactivation.
+    ta.set_lane_active(1, true);
+    ta.propagate_until({2., 2., 2.});
+    REQUIRE(ta.get_time() == std::vector<double>{2., 2., 2.});
+    REQUIRE(std::abs(ta.get_state()[1] - std::sin(2.)) < 1e-12);
+
+    // The events of the inactive lanes are not detected.
+    std::vector<std::uint32_t> ev_lanes;
+    auto cb = [&ev_lanes](taylor_adaptive_batch<double> &, double, int, std::uint32_t idx) { ev_lanes.push_back(idx); };
+    auto ta_ev = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x},
+                                               {0., 0., 1., 1.},
+                                               2u,
+                                               kw::nt_events = {nt_event_batch<double>(x - .5, cb)}};
+    ta_ev.set_lane_active(0, false);
+    ta_ev.propagate_until({1., 1.});
+    REQUIRE(ev_lanes == std::vector<std::uint32_t>{1u});
+}
+
+TEST_CASE("fused step batch")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2u};
+    auto ta_f = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.06, 0.025, 0.026}, 2u, kw::fused_step = true};
+
+    REQUIRE(!ta.get_fused_step());
+    REQUIRE(ta_f.get_fused_step());
+
+    // The fused stepper must produce the same results.
+    for (auto i = 0; i < 50; ++i) {
+        ta.step();
+        ta_f.step();
+
+        REQUIRE(ta.get_step_res() == ta_f.get_step_res());
+        REQUIRE(ta.get_state() == ta_f.get_state());
+        REQUIRE(ta.get_time() == ta_f.get_time());
+    }
+
+    // Mixed outcomes in the batch elements.
+    ta_f.step({1e-3, 1e3});
+    REQUIRE(std::get<0>(ta_f.get_step_res()[0]) == taylor_outcome::time_limit);
+    REQUIRE(std::get<1>(ta_f.get_step_res()[0]) == 1e-3);
+    REQUIRE(std::get<0>(ta_f.get_step_res()[1]) == taylor_outcome::success);
+
+    // Inactive lanes.
+    ta_f.set_lane_active(0, false);
+    const auto t0 = ta_f.get_time()[0];
+    ta_f.step();
+    REQUIRE(std::get<0>(ta_f.get_step_res()[0]) == taylor_outcome::time_limit);
+    REQUIRE(ta_f.get_time()[0] == t0);
+    ta_f.set_lane_active(0, true);
+
+    // Non-finite state in a single batch element.
+    ta_f.get_state_data()[1] = std::numeric_limits<double>::infinity();
+    ta_f.step();
+    REQUIRE(std::get<0>(ta_f.get_step_res()[0]) == taylor_outcome::success);
+    REQUIRE(std::get<0>(ta_f.get_step_res()[1]) == taylor_outcome::err_nf_state);
+}
+
+TEST_CASE("lane tolerances")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -x};
+
+    auto ta = taylor_adaptive_batch<double>{sys, {0., 0., 0., 1., 1., 1.}, 3u};
+    REQUIRE(ta.get_lane_tols() == std::vector<double>(3u, std::numeric_limits<double>::epsilon()));
+
+    auto ta_lt = taylor_adaptive_batch<double>{sys, {0., 0., 0., 1., 1., 1.}, 3u, kw::lane_tols = {1e-6, 1e-15, 1e-9}};
+    REQUIRE(ta_lt.get_lane_tols() == std::vector<double>{1e-6, 1e-15, 1e-9});
+
+    // The order is deduced from the tightest tolerance.
+    auto ta_ref = taylor_adaptive_batch<double>{sys, {0., 0., 0., 1., 1., 1.}, 3u, kw::tol = 1e-15};
+    REQUIRE(ta_lt.get_order() == ta_ref.get_order());
+
+    ta_lt.propagate_until({10., 10., 10.});
+    ta_ref.propagate_until({10., 10., 10.});
+
+    const auto &pres = ta_lt.get_propagate_res();
+    REQUIRE(std::get<3>(pres[0]) < std::get<3>(pres[2]));
+    REQUIRE(std::get<3>(pres[2]) < std::get<3>(pres[1]));
+    REQUIRE(std::get<3>(pres[1]) == std::get<3>(ta_ref.get_propagate_res()[1]));
+
+    REQUIRE(std::abs(ta_lt.get_state()[0] - std::sin(10.)) < 1e-5);
+    REQUIRE(std::abs(ta_lt.get_state()[1] - std::sin(10.)) < 1e-13);
+    REQUIRE(std::abs(ta_lt.get_state()[2] - std::sin(10.)) < 1e-8);
+
+    // The tolerances are preserved by copies.
+    auto ta_copy = ta_lt;
+    REQUIRE(ta_copy.get_lane_tols() == ta_lt.get_lane_tols());
+
+    // Equal tolerances.
+    auto ta_eq = taylor_adaptive_batch<double>{sys, {0., 0., 1., 1.}, 2u, kw::lane_tols = {1e-10, 1e-10}};
+    REQUIRE(ta_eq.get_lane_tols() == std::vector<double>{1e-10, 1e-10});
+
+    // Error modes.
+    REQUIRE_THROWS_AS((taylor_adaptive_batch<double>{sys, {0., 0., 1., 1.}, 2u, kw::lane_tols = {1e-10}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive_batch<double>{sys, {0., 0., 1., 1.}, 2u, kw::lane_tols = {1e-10, -1.}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive_batch<double>{sys, {0., 1.}, 0u, kw::lane_tols = {1e-10, 1e-10}}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("propagate view callback and stop condition")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -par[0] * x},
+                                            {0., 0., 1., .1},
+                                            2u,
+                                            kw::pars = std::vector<double>{1., 1.}};
+
+    // Callback invoked with a view of the data of the integrator.
+    std::size_t n_cb = 0;
+    auto view_cb = [&](const taylor_batch_view<double> &view) {
+        REQUIRE(view.dim == 2u);
+        REQUIRE(view.n_pars == 1u);
+        REQUIRE(view.batch_size == 2u);
+        REQUIRE(view.state_row(1) == ta.get_state_data() + 2);
+        REQUIRE(view.pars_row(0)[1] == 1.);
+        REQUIRE(view.time == ta.get_time_data());
+        REQUIRE(std::get<1>(view.step_res[0]) == std::get<1>(ta.get_step_res()[0]));
+
+        ++n_cb;
+
+        return n_cb < 5u;
+    };
+    ta.propagate_until({10., 10.}, kw::callback = view_cb);
+    REQUIRE(n_cb == 5u);
+    REQUIRE(std::get<0>(ta.get_propagate_res()[0]) == taylor_outcome::cb_stop);
+
+    // Stop condition.
+    REQUIRE(!ta.get_stop_cond());
+    REQUIRE_THROWS_AS(ta.set_stop_cond(x + hy::time), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_stop_cond(x + par[1]), std::invalid_argument);
+    REQUIRE(!ta.get_stop_cond());
+
+    ta.get_state_data()[0] = 0;
+    ta.get_state_data()[1] = 0;
+    ta.get_state_data()[2] = 1;
+    ta.get_state_data()[3] = .1;
+    ta.set_time({0., 0.});
+
+    ta.set_stop_cond(x - .5);
+    REQUIRE(ta.get_stop_cond());
+
+    // The copies keep the stop condition.
+    auto ta_copy = ta;
+
+    ta.propagate_until({10., 10.});
+    REQUIRE(std::get<0>(ta.get_propagate_res()[0]) == taylor_outcome::cb_stop);
+    REQUIRE(std::get<0>(ta.get_propagate_res()[1]) == taylor_outcome::time_limit);
+    REQUIRE(ta.get_state()[0] > .5);
+    REQUIRE(ta.get_time()[0] < 10.);
+    REQUIRE(ta.get_time()[1] == 10.);
+
+    ta_copy.propagate_for({10., 10.});
+    REQUIRE(ta_copy.get_state() == ta.get_state());
+    REQUIRE(ta_copy.get_time() == ta.get_time());
+
+    // Removal of the stop condition.
+    ta.clear_stop_cond();
+    REQUIRE(!ta.get_stop_cond());
+    ta.propagate_until({20., 20.});
+    REQUIRE(std::get<0>(ta.get_propagate_res()[0]) == taylor_outcome::time_limit);
+}
+
+TEST_CASE("lane max steps")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -x}, {0., .01, 1., 1.1}, 2u};
+
+    REQUIRE_THROWS_AS(ta.propagate_until({10., 10.}, kw::lane_max_steps = std::vector<std::size_t>{1}),
+                      std::invalid_argument);
+
+    // The first batch element has a budget of 3 steps, the second one has no budget.
+    auto ta_copy = ta;
+    ta.propagate_until({10., 10.}, kw::lane_max_steps = std::vector<std::size_t>{3, 0});
+    REQUIRE(std::get<0>(ta.get_propagate_res()[0]) == taylor_outcome::step_limit);
+    REQUIRE(std::get<3>(ta.get_propagate_res()[0]) == 3u);
+    REQUIRE(ta.get_time()[0] < 10.);
+    REQUIRE(std::get<0>(ta.get_propagate_res()[1]) == taylor_outcome::time_limit);
+    REQUIRE(std::get<3>(ta.get_propagate_res()[1]) > 3u);
+    REQUIRE(ta.get_time()[1] == 10.);
+
+    // The budgeted batch element took the same steps
+    // as in a propagation with a global step limit.
+    ta_copy.propagate_for({10., 10.}, kw::max_steps = 3u);
+    REQUIRE(ta_copy.get_time()[0] == ta.get_time()[0]);
+    REQUIRE(ta_copy.get_state()[0] == ta.get_state()[0]);
+    REQUIRE(ta_copy.get_state()[2] == ta.get_state()[2]);
+
+    // A budget large enough does not alter the propagation.
+    ta.propagate_for({1., 1.}, kw::lane_max_steps = std::vector<std::size_t>{1000, 1000});
+    REQUIRE(std::get<0>(ta.get_propagate_res()[0]) == taylor_outcome::time_limit);
+    REQUIRE(std::get<0>(ta.get_propagate_res()[1]) == taylor_outcome::time_limit);
+}
@@ -18,8 +18,10 @@
 #include <heyoka/expression.hpp>
 #include <heyoka/llvm_state.hpp>
 #include <heyoka/math/cos.hpp>
+#include <heyoka/math/sin.hpp>
 #include <heyoka/math/square.hpp>
 #include <heyoka/nbody.hpp>
+#include <heyoka/param.hpp>
 #include <heyoka/taylor.hpp>
 
 #include "catch.hpp"
@@ -469,3 +471,85 @@ TEST_CASE("nbody")
         }
     }
 }
+
+// Test the partial recomputation of the jet after a change of parameters.
+TEST_CASE("add par jet")
+{
+    auto [x, v, y] = make_vars("x", "v", "y");
+
+    const auto order = 5u;
+
+    for (auto opt_level : {0u, 1u, 2u, 3u}) {
+        for (auto batch_size : {1u, 2u, 4u}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            // NOTE: the equation for y does not depend on the parameters.
+            const auto dc = taylor_add_par_jet<double>(
+                s, "jet", {prime(x) = v, prime(v) = -par[0] * sin(x) + y, prime(y) = cos(y)}, order, batch_size);
+
+            // Add the standard jet of the same system for comparison.
+            taylor_add_jet<double>(s, "sv_jet", {prime(x) = v, prime(v) = -par[0] * sin(x) + y, prime(y) = cos(y)},
+                                   order, batch_size, false, false);
+
+            s.compile();
+
+            using fptr_t = void (*)(double *, const double *, const double *);
+            auto jptr = reinterpret_cast<fptr_t>(s.jit_lookup("jet"));
+            auto pptr = reinterpret_cast<fptr_t>(s.jit_lookup("jet_par"));
+            auto sv_jptr = reinterpret_cast<fptr_t>(s.jit_lookup("sv_jet"));
+
+            const auto n_uvars = dc.size() - 3u;
+
+            std::vector<double> init_state, pars_a, pars_b;
+            for (auto i = 0u; i < batch_size; ++i) {
+                init_state.push_back(.1 + i / 10.);
+                pars_a.push_back(2. + i);
+                pars_b.push_back(-3. - i);
+            }
+            for (auto i = 0u; i < batch_size; ++i) {
+                init_state.push_back(.2 - i / 10.);
+            }
+            for (auto i = 0u; i < batch_size; ++i) {
+                init_state.push_back(.3 + i / 5.);
+            }
+
+            std::vector<double> jet(init_state), jet_full(init_state);
+            jet.resize((order + 1u) * n_uvars * batch_size);
+            jet_full.resize((order + 1u) * n_uvars * batch_size);
+
+            // Compute the full jet with the first set of pars, then
+            // update it in place with the second set of pars.
+            jptr(jet.data(), pars_a.data(), nullptr);
+            const auto jet_a = jet;
+            pptr(jet.data(), pars_b.data(), nullptr);
+
+            // Full recomputation with the second set of pars.
+            jptr(jet_full.data(), pars_b.data(), nullptr);
+
+            for (decltype(jet.size()) i = 0; i < jet.size(); ++i) {
+                REQUIRE(jet[i] == approximately(jet_full[i]));
+            }
+
+            // The derivatives of y do not depend on the parameters.
+            for (auto o = 0u; o <= order; ++o) {
+                for (auto j = 0u; j < batch_size; ++j) {
+                    REQUIRE(jet[(o * n_uvars + 2u) * batch_size + j] == jet_a[(o * n_uvars + 2u) * batch_size + j]);
+                }
+            }
+
+            // Check the derivatives of the state variables against taylor_add_jet().
+            std::vector<double> sv_jet(init_state);
+            sv_jet.resize((order + 1u) * 3u * batch_size);
+            sv_jptr(sv_jet.data(), pars_b.data(), nullptr);
+
+            for (auto o = 0u; o <= order; ++o) {
+                for (auto i = 0u; i < 3u; ++i) {
+                    for (auto j = 0u; j < batch_size; ++j) {
+                        REQUIRE(jet[(o * n_uvars + i) * batch_size + j]
+                                == approximately(sv_jet[(o * 3u + i) * batch_size + j]));
+                    }
+                }
+            }
+        }
+    }
+}
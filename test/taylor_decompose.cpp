@@ -6,6 +6,8 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
+#include <cstdint>
 #include <initializer_list>
 #include <stdexcept>
 #include <string>
@@ -14,8 +16,15 @@
 #include <vector>
 
 #include <heyoka/expression.hpp>
+#include <heyoka/math/binary_op.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/cosh.hpp>
+#include <heyoka/math/kepE.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sinh.hpp>
 #include <heyoka/math/sqrt.hpp>
 #include <heyoka/math/square.hpp>
+#include <heyoka/math/tan.hpp>
 #include <heyoka/nbody.hpp>
 #include <heyoka/taylor.hpp>
 
@@ -180,3 +189,213 @@ TEST_CASE("decompose sys")
     // Let the internal assertions of taylor_decompose do the job.
     std::tie(dc, sv_funcs_dc) = taylor_decompose(sys, sv_funcs);
 }
+
+// Decomposition of a system large enough
+// to trigger the parallel decomposition codepath.
+TEST_CASE("decompose large")
+{
+    const auto n = 40u;
+
+    // NOTE: zero-pad the names so that the alphabetical
+    // order matches the numerical order.
+    auto var_name = [](unsigned i) { return (i < 10u ? "x_0" : "x_") + std::to_string(i); };
+
+    std::vector<expression> vars;
+    for (auto i = 0u; i < n; ++i) {
+        vars.emplace_back(var_name(i));
+    }
+
+    // NOTE: cos(x_00) appears in all equations, and
+    // sin(x_00) appears in the last equation too:
+    // the common subexpressions must be removed
+    // across the blocks of equations.
+    std::vector<std::pair<expression, expression>> sys;
+    std::vector<expression> v_ex;
+    for (auto i = 0u; i < n; ++i) {
+        sys.push_back(prime(vars[i]) = cos(vars[0]) * sin(vars[(i + 1u) % n]));
+        v_ex.push_back(sys.back().second);
+    }
+
+    auto check_dc = [n, &var_name](const taylor_dc_t &dc, const std::vector<std::uint32_t> &sv_funcs_dc) {
+        // n state variables, n sin/cos pairs, n products and n equations.
+        REQUIRE(dc.size() == 5u * n);
+
+        REQUIRE(sv_funcs_dc.size() == 2u);
+        REQUIRE(sv_funcs_dc[0] == 0u);
+        REQUIRE(sv_funcs_dc[1] >= n);
+        REQUIRE(sv_funcs_dc[1] < 4u * n);
+
+        for (auto i = 0u; i < n; ++i) {
+            REQUIRE(std::get<variable>(dc[i].first.value()).name() == var_name(i));
+            REQUIRE(dc[i].second.empty());
+        }
+
+        for (auto i = n; i < 4u * n; ++i) {
+            // The u variables must be defined in terms of
+            // previously-defined u variables.
+            for (const auto &var : get_variables(dc[i].first)) {
+                REQUIRE(std::stoul(var.substr(2)) < i);
+            }
+
+            for (auto idx : dc[i].second) {
+                REQUIRE(idx >= n);
+                REQUIRE(idx < 4u * n);
+            }
+        }
+
+        for (auto i = 4u * n; i < 5u * n; ++i) {
+            REQUIRE(std::stoul(std::get<variable>(dc[i].first.value()).name().substr(2)) >= 3u * n);
+            REQUIRE(dc[i].second.empty());
+        }
+    };
+
+    const auto sv_funcs = std::vector<expression>{vars[0], sin(vars[3])};
+
+    auto [dc, sv_funcs_dc] = taylor_decompose(sys, sv_funcs);
+    check_dc(dc, sv_funcs_dc);
+
+    auto [dc2, sv_funcs_dc2] = taylor_decompose(v_ex, sv_funcs);
+    check_dc(dc2, sv_funcs_dc2);
+
+    // The two overloads must produce the same decomposition.
+    REQUIRE(dc == dc2);
+    REQUIRE(sv_funcs_dc == sv_funcs_dc2);
+}
+
+// Test the sharing of the companion u variables
+// produced by the decomposition of paired functions.
+TEST_CASE("decompose companions")
+{
+    auto x = "x"_var, y = "y"_var;
+
+    // sin/cos and sinh/cosh in different equations:
+    // 2 state variables, a single pair and 2 equations.
+    REQUIRE(taylor_decompose({sin(y), cos(y)}, {}).first.size() == 6u);
+    REQUIRE(taylor_decompose({cosh(y), sinh(y)}, {}).first.size() == 6u);
+
+    // The auxiliary square of tan() is shared with an explicit product.
+    // NOTE: use mul() in order to avoid the automatic
+    // simplification of a*a into square(a).
+    REQUIRE(taylor_decompose({tan(x), mul(tan(x), tan(x))}, {}).first.size() == 6u);
+
+    // The auxiliary e*cos(E) of kepE() is shared with cos(E)*e.
+    REQUIRE(taylor_decompose({kepE(x, y), cos(kepE(x, y)) * x}, {}).first.size() == 8u);
+
+    // Commutative operations.
+    REQUIRE(taylor_decompose({x * y, y * x}, {}).first.size() == 5u);
+    REQUIRE(taylor_decompose({x + y, y + x}, {}).first.size() == 5u);
+
+    // No change in the decomposition if there are no redundancies.
+    auto dc = taylor_decompose({y * x, mul(x, x)}, {}).first;
+    REQUIRE(dc.size() == 6u);
+    for (const auto &[ex, _] : dc) {
+        REQUIRE(ex != square("u_0"_var));
+    }
+}
+
+TEST_CASE("decompose one way")
+{
+    auto [x, v, y, z] = make_vars("x", "v", "y", "z");
+
+    auto ow = [](const std::vector<std::pair<expression, expression>> &sys) {
+        return taylor_one_way_states(taylor_decompose(sys, {}).first, static_cast<std::uint32_t>(sys.size()));
+    };
+
+    // y is driven by the oscillator, z is driven by y.
+    REQUIRE(ow({prime(x) = v, prime(v) = -x, prime(y) = x * y, prime(z) = cos(y)})
+            == std::vector<std::uint32_t>{2, 3});
+
+    // Mutually-coupled state variables.
+    REQUIRE(ow({prime(x) = v, prime(v) = -x * y, prime(y) = x}).empty());
+
+    // Independent subsystems are not one-way coupled.
+    REQUIRE(ow({prime(x) = v, prime(v) = -x, prime(y) = z, prime(z) = -y}).empty());
+
+    // Constant dynamics.
+    REQUIRE(ow({prime(x) = 1_dbl, prime(y) = x}) == std::vector<std::uint32_t>{1});
+
+    REQUIRE_THROWS_AS(taylor_one_way_states(taylor_decompose({prime(x) = v, prime(v) = -x}, {}).first, 10),
+                      std::invalid_argument);
+}
+
+TEST_CASE("decompose par dep")
+{
+    auto [x, v, y, z] = make_vars("x", "v", "y", "z");
+
+    auto pd = [](const std::vector<std::pair<expression, expression>> &sys) {
+        const auto dc = taylor_decompose(sys, {}).first;
+        const auto n_eq = static_cast<std::uint32_t>(sys.size());
+
+        // Return only the state variables, whose
+        // indices do not depend on the decomposition.
+        std::vector<std::uint32_t> retval;
+        for (auto idx : taylor_par_dep_uvars(dc, n_eq)) {
+            if (idx < n_eq) {
+                retval.push_back(idx);
+            }
+        }
+
+        return retval;
+    };
+
+    // No parameters.
+    REQUIRE(pd({prime(x) = v, prime(v) = -x}).empty());
+
+    // The parameters affect all the coupled state variables.
+    REQUIRE(pd({prime(x) = v, prime(v) = -par[0] * sin(x)}) == std::vector<std::uint32_t>{0, 1});
+
+    // One-way coupling: the oscillator is not affected by par[0].
+    REQUIRE(pd({prime(x) = v, prime(v) = -x, prime(y) = par[0] * x, prime(z) = cos(y)})
+            == std::vector<std::uint32_t>{2, 3});
+    REQUIRE(pd({prime(x) = v, prime(v) = -x, prime(y) = par[0] * x, prime(z) = cos(x)})
+            == std::vector<std::uint32_t>{2});
+
+    // The u variables which are not state variables.
+    const auto dc = taylor_decompose({prime(x) = v, prime(v) = -x, prime(y) = par[0] * x, prime(z) = cos(x)}, {}).first;
+    const auto dep = taylor_par_dep_uvars(dc, 4);
+    for (std::uint32_t i = 4; i < dc.size() - 4u; ++i) {
+        const auto is_dep = std::find(dep.begin(), dep.end(), i) != dep.end();
+        REQUIRE(is_dep == (get_param_size(dc[i].first) > 0u));
+    }
+
+    REQUIRE_THROWS_AS(taylor_par_dep_uvars(taylor_decompose({prime(x) = v, prime(v) = -x}, {}).first, 10),
+                      std::invalid_argument);
+}
+
+// Check the ordering of the u variables in the
+// decomposition: the u variables are grouped by
+// dependency level and, within each level, sorted
+// according to the positions of their operands.
+TEST_CASE("decompose locality")
+{
+    const auto sys = make_nbody_sys(4);
+    const auto n_eq = sys.size();
+
+    const auto dc = taylor_decompose(sys, {}).first;
+
+    std::vector<std::uint32_t> lvl(dc.size() - n_eq), min_op(dc.size() - n_eq);
+
+    for (auto i = n_eq; i < dc.size() - n_eq; ++i) {
+        std::uint32_t cur_lvl = 0, cur_min = static_cast<std::uint32_t>(i);
+
+        for (const auto &var : get_variables(dc[i].first)) {
+            const auto idx = static_cast<std::uint32_t>(std::stoul(var.substr(2)));
+
+            REQUIRE(idx < i);
+
+            cur_lvl = std::max(cur_lvl, lvl[idx] + 1u);
+            cur_min = std::min(cur_min, idx);
+        }
+
+        lvl[i] = cur_lvl;
+        min_op[i] = cur_min;
+
+        if (i > n_eq) {
+            REQUIRE(lvl[i] >= lvl[i - 1u]);
+
+            if (lvl[i] == lvl[i - 1u] && lvl[i] > 0u) {
+                REQUIRE(min_op[i] >= min_op[i - 1u]);
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/log.hpp>
+#include <heyoka/math/pow.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/sqrt.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/math/tanh.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor_export.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+namespace hy = heyoka;
+
+TEST_CASE("taylor export cpp")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Forced pendulum.
+    const auto code = taylor_export_cpp({prime(x) = v, prime(v) = -par[0] * sin(x) + cos(hy::time)}, "pendulum");
+
+    REQUIRE(code.find("namespace pendulum") != std::string::npos);
+    REQUIRE(code.find("inline constexpr std::uint32_t n_eq = 2;") != std::string::npos);
+    REQUIRE(code.find("inline constexpr std::uint32_t n_pars = 1;") != std::string::npos);
+    // The order deduced from the default tolerance.
+    REQUIRE(code.find("inline constexpr std::uint32_t order = 20;") != std::string::npos);
+    REQUIRE(code.find("inline void jet(T *u, const T *pars, T time)") != std::string::npos);
+    REQUIRE(code.find("inline T step(T *state, const T *pars, T time, T max_h)") != std::string::npos);
+    REQUIRE(code.find("pars[0u]") != std::string::npos);
+    REQUIRE(code.find("sin(") != std::string::npos);
+
+    // A larger tolerance results in a lower order.
+    REQUIRE(taylor_export_cpp({prime(x) = v, prime(v) = -x}, "osc", 1E-4).find("order = 6;") != std::string::npos);
+
+    // All the supported functions.
+    REQUIRE_NOTHROW(taylor_export_cpp({exp(x) * log(v) - sqrt(x) / v, pow(x, 1.5) - square(v)}, "funcs"));
+
+    // Error handling.
+    REQUIRE_THROWS_AS(taylor_export_cpp({prime(x) = v, prime(v) = -x}, ""), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_export_cpp({prime(x) = v, prime(v) = -x}, "1a"), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_export_cpp({prime(x) = v, prime(v) = -x}, "a-b"), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_export_cpp({prime(x) = v, prime(v) = -x}, "a", 0.), std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        taylor_export_cpp({prime(x) = v, prime(v) = -x}, "a", std::numeric_limits<double>::infinity()),
+        std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_export_cpp({prime(x) = v, prime(v) = tanh(x)}, "a"), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_export_cpp({prime(x) = v, prime(v) = pow(x, v)}, "a"), std::invalid_argument);
+}
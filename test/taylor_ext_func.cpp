@@ -0,0 +1,183 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/exp.hpp>
+#include <heyoka/math/ext_func.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// Kernel for the exponential of the single argument:
+// f^[n] = 1/n * sum_{j=1}^n j * a^[j] * f^[n-j].
+template <typename T>
+void exp_kernel(T *out, std::uint32_t order, const T *a, const T *f, std::uint32_t batch_size)
+{
+    using std::exp;
+
+    for (std::uint32_t b = 0; b < batch_size; ++b) {
+        if (order == 0u) {
+            out[b] = exp(a[b]);
+        } else {
+            T acc(0);
+            for (std::uint32_t j = 1; j <= order; ++j) {
+                acc += T(j) * a[j * batch_size + b] * f[(order - j) * batch_size + b];
+            }
+
+            out[b] = acc / T(order);
+        }
+    }
+}
+
+// Kernel for the product of the two arguments:
+// f^[n] = sum_{j=0}^n a0^[j] * a1^[n-j].
+template <typename T>
+void prod_kernel(T *out, std::uint32_t order, const T *a, const T *, std::uint32_t batch_size)
+{
+    for (std::uint32_t b = 0; b < batch_size; ++b) {
+        T acc(0);
+        for (std::uint32_t j = 0; j <= order; ++j) {
+            acc += a[(j * 2u) * batch_size + b] * a[((order - j) * 2u + 1u) * batch_size + b];
+        }
+
+        out[b] = acc;
+    }
+}
+
+template <typename T>
+void register_kernels()
+{
+    register_ext_kernel("test_exp", &exp_kernel<T>);
+    register_ext_kernel("test_prod", &prod_kernel<T>);
+}
+
+TEST_CASE("ext_func basics")
+{
+    auto x = "x"_var, y = "y"_var;
+
+    REQUIRE_THROWS_AS(ext_func("", {x}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ext_func("1abc", {x}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ext_func("a.b", {x}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ext_func("abc", {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(register_ext_kernel("a.b", &exp_kernel<double>), std::invalid_argument);
+    REQUIRE_THROWS_AS(register_ext_kernel("abc", static_cast<ext_kernel_t<double>>(nullptr)), std::invalid_argument);
+
+    std::ostringstream oss;
+    oss << ext_func("test_prod", {x, y});
+    REQUIRE(oss.str() == "ext:test_prod(x, y)");
+
+    // Re-registering with a different address is not allowed.
+    register_ext_kernel("test_reg", &exp_kernel<double>);
+    register_ext_kernel("test_reg", &exp_kernel<double>);
+    REQUIRE_THROWS_AS(register_ext_kernel("test_reg", &prod_kernel<double>), std::invalid_argument);
+}
+
+TEST_CASE("taylor ext_func")
+{
+    tuple_for_each(fp_types, [](auto x) { register_kernels<decltype(x)>(); });
+
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        for (auto batch_size : {1u, 2u, 4u}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet",
+                                 {ext_func("test_prod", {x, y}), ext_func("test_exp", {x + par[0]}),
+                                  ext_func("test_prod", {y, 2_dbl})},
+                                 4, batch_size, high_accuracy, compact_mode);
+            taylor_add_jet<fp_t>(s, "jet_ref", {x * y, exp(x + par[0]), y * 2_dbl}, 4, batch_size, high_accuracy,
+                                 compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+            auto jptr_ref = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet_ref"));
+
+            std::vector<fp_t> jet(15u * batch_size), jet_ref;
+            for (auto i = 0u; i < 3u * batch_size; ++i) {
+                jet[i] = fp_t(i + 1u) / 10;
+            }
+            jet_ref = jet;
+
+            std::vector<fp_t> pars(batch_size, fp_t(-1) / 3);
+
+            jptr(jet.data(), pars.data(), nullptr);
+            jptr_ref(jet_ref.data(), pars.data(), nullptr);
+
+            for (decltype(jet.size()) i = 0; i < jet.size(); ++i) {
+                REQUIRE(jet[i] == approximately(jet_ref[i], fp_t(1000)));
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+TEST_CASE("ext_func integration")
+{
+    register_kernels<double>();
+
+    auto x = "x"_var, v = "v"_var;
+
+    for (auto cm : {false, true}) {
+        // Harmonic oscillator with the restoring force computed by the kernel.
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = ext_func("test_prod", {x, par[0]})},
+                                          {0., 1.},
+                                          kw::pars = std::vector<double>{-1.},
+                                          kw::compact_mode = cm};
+
+        REQUIRE(std::get<0>(ta.propagate_until(10.)) == taylor_outcome::time_limit);
+        REQUIRE(ta.get_state()[0] == approximately(std::sin(10.), 1000.));
+        REQUIRE(ta.get_state()[1] == approximately(std::cos(10.), 1000.));
+
+        // Serialisation round trip.
+        std::stringstream ss;
+        ta.save(ss);
+        auto ta2 = taylor_adaptive<double>::load(ss);
+
+        REQUIRE(std::get<0>(ta2.propagate_until(20.)) == taylor_outcome::time_limit);
+        REQUIRE(ta2.get_state()[0] == approximately(std::sin(20.), 1000.));
+    }
+}
@@ -0,0 +1,193 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_jet.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+namespace hy = heyoka;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("taylor jet bulk")
+{
+    auto tester = [](auto fp_x, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        // Forced pendulum with the length in the parameters.
+        const auto sys = {prime(x) = v, prime(v) = -par[0] * sin(x) + hy::time};
+        const std::uint32_t order = 5;
+
+        // The reference scalar jet.
+        llvm_state s;
+        taylor_add_jet<fp_t>(s, "jet", sys, order, 1, false, compact_mode, {x * v});
+        s.compile();
+        auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+        // NOTE: use a number of points which is not
+        // a multiple of the batch sizes.
+        const std::size_t n_points = 23;
+
+        std::vector<fp_t> in(2u * n_points), pars(n_points), time(n_points);
+        for (std::size_t i = 0; i < n_points; ++i) {
+            in[i] = fp_t(i) / 10 - 1;
+            in[n_points + i] = fp_t(i) / 7 + 1;
+            pars[i] = fp_t(i) / 3 + 1;
+            time[i] = fp_t(i) / 5;
+        }
+
+        for (auto batch_size : {0u, 1u, 2u, 4u}) {
+            auto tj = taylor_jet<fp_t>{sys, order, kw::batch_size = batch_size, kw::compact_mode = compact_mode,
+                                       kw::sv_funcs = {x * v}};
+
+            REQUIRE(tj.get_n_eq() == 2u);
+            REQUIRE(tj.get_n_sv_funcs() == 1u);
+            REQUIRE(tj.get_n_pars() == 1u);
+            REQUIRE(tj.get_order() == order);
+            REQUIRE(tj.get_batch_size() > 0u);
+            if (batch_size != 0u) {
+                REQUIRE(tj.get_batch_size() == batch_size);
+            }
+
+            // Invalid inputs.
+            REQUIRE_THROWS_AS(tj(in, n_points - 1u, pars, time), std::invalid_argument);
+            REQUIRE_THROWS_AS(tj(in, n_points, {}, time), std::invalid_argument);
+            REQUIRE_THROWS_AS(tj(in, n_points, pars, {fp_t(0)}), std::invalid_argument);
+            REQUIRE_THROWS_AS(tj(in, n_points, pars), std::invalid_argument);
+
+            for (auto n_threads : {1u, 0u, 3u}) {
+                const auto out = tj(in, n_points, pars, time, n_threads);
+
+                REQUIRE(out.size() == 3u * (order + 1u) * n_points);
+
+                for (std::size_t i = 0; i < n_points; ++i) {
+                    std::vector<fp_t> jet(3u * (order + 1u));
+                    jet[0] = in[i];
+                    jet[1] = in[n_points + i];
+
+                    jptr(jet.data(), &pars[i], &time[i]);
+
+                    for (std::size_t j = 0; j < jet.size(); ++j) {
+                        REQUIRE(out[j * n_points + i] == approximately(jet[j], fp_t(100)));
+                    }
+                }
+            }
+
+            // Copy semantics.
+            auto tj2 = tj;
+            REQUIRE(tj2(in, n_points, pars, time) == tj(in, n_points, pars, time));
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, cm); });
+    }
+}
+
+TEST_CASE("taylor jet bulk autonomous")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto tj = taylor_jet<double>{{prime(x) = v, prime(v) = -x}, 3, kw::batch_size = 2u};
+
+    REQUIRE(tj.get_n_pars() == 0u);
+
+    // No parameters and no time are needed.
+    const auto out = tj({1., 0., 0., 1.}, 2);
+    const auto ref = std::vector<double>{1., 0., 0., 1., 0., 1., -1., 0., -.5, 0., 0., -.5, 0., -1. / 6, 1. / 6, 0.};
+    REQUIRE(out.size() == ref.size());
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        REQUIRE(out[i] == approximately(ref[i]));
+    }
+
+    REQUIRE_THROWS_AS(tj(nullptr, nullptr, 1), std::invalid_argument);
+}
+
+TEST_CASE("taylor cached jet")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    taylor_clear_jet_cache();
+    REQUIRE(taylor_jet_cache_size() == 0u);
+
+    const auto sys = std::vector{prime(x) = v, prime(v) = -par[0] * sin(x)};
+
+    auto [f, s] = taylor_cached_jet<double>(sys, 3, 1, false, false);
+    REQUIRE(f != nullptr);
+    REQUIRE(s);
+    REQUIRE(taylor_jet_cache_size() == 1u);
+
+    // The reference jet.
+    llvm_state ls;
+    taylor_add_jet<double>(ls, "jet", sys, 3, 1, false, false);
+    ls.compile();
+    auto jptr = reinterpret_cast<void (*)(double *, const double *, const double *)>(ls.jit_lookup("jet"));
+
+    std::vector<double> jet(8u), jet_ref(8u);
+    jet[0] = jet_ref[0] = .1;
+    jet[1] = jet_ref[1] = .2;
+    const double par_val = 9.8, tm = 0;
+    f(jet.data(), &par_val, &tm);
+    jptr(jet_ref.data(), &par_val, &tm);
+    REQUIRE(jet == jet_ref);
+
+    // Repeated builds are lookups.
+    auto [f2, s2] = taylor_cached_jet<double>(sys, 3, 1, false, false);
+    REQUIRE(f2 == f);
+    REQUIRE(s2 == s);
+    REQUIRE(taylor_jet_cache_size() == 1u);
+
+    // Different options, forms of the system or types are different entries.
+    REQUIRE(taylor_cached_jet<double>(sys, 4, 1, false, false).first != f);
+    REQUIRE(taylor_cached_jet<double>(sys, 3, 2, false, false).first != f);
+    REQUIRE(taylor_cached_jet<double>(sys, 3, 1, false, true).first != f);
+    REQUIRE(taylor_cached_jet<double>(sys, 3, 1, false, false, {x * v}).first != f);
+    REQUIRE(taylor_cached_jet<double>(std::vector{v, -par[0] * sin(x)}, 3, 1, false, false).first != f);
+    taylor_cached_jet<long double>(sys, 3, 1, false, false);
+    REQUIRE(taylor_jet_cache_size() == 7u);
+
+    // The returned state keeps the compiled code alive
+    // after the cache is cleared.
+    taylor_clear_jet_cache();
+    REQUIRE(taylor_jet_cache_size() == 0u);
+    std::fill(jet.begin() + 2, jet.end(), 0.);
+    f(jet.data(), &par_val, &tm);
+    REQUIRE(jet == jet_ref);
+}
@@ -10,15 +10,20 @@
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
 #include <limits>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/math/constants/constants.hpp>
 
 #if defined(HEYOKA_HAVE_REAL128)
 
@@ -26,10 +31,12 @@
 
 #endif
 
+#include <heyoka/detail/event_detection.hpp>
 #include <heyoka/expression.hpp>
 #include <heyoka/math/sin.hpp>
 #include <heyoka/math/square.hpp>
 #include <heyoka/taylor.hpp>
+#include <heyoka/thread_pool.hpp>
 
 #include "catch.hpp"
 #include "test_utils.hpp"
@@ -517,6 +524,72 @@ TEST_CASE("taylor nte basic")
     }
 }
 
+// Test with many events, so that the event polynomials are
+// processed in more than one group during the pre-screening
+// phase of event detection.
+TEST_CASE("taylor nte many events")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using std::abs;
+        using std::sin;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        using ev_t = typename taylor_adaptive<fp_t>::nt_event_t;
+
+        // 50 events with roots, 5 events without roots.
+        std::vector<unsigned> counters(55u);
+        std::vector<ev_t> evs;
+        for (auto i = 0u; i < 55u; ++i) {
+            const auto c = i < 50u ? fp_t(-0.98) + fp_t(i) * fp_t(0.04) : fp_t(2) + fp_t(i);
+
+            evs.emplace_back(x - c, [c, i, &counters](taylor_adaptive<fp_t> &, fp_t t, int) {
+                REQUIRE(abs(sin(t) - c) < std::numeric_limits<fp_t>::epsilon() * 1000);
+
+                ++counters[i];
+            });
+        }
+
+        // NOTE: harmonic oscillator, x(t) = sin(t).
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -x},
+                                        {fp_t(0), fp_t(1)},
+                                        kw::opt_level = opt_level,
+                                        kw::high_accuracy = high_accuracy,
+                                        kw::compact_mode = compact_mode,
+                                        kw::nt_events = evs};
+
+        detail::reset_ed_prune_stats();
+
+        // Propagate for 3 periods plus a quarter of period.
+        const auto pi = fp_t(boost::math::constants::pi<double>());
+        const auto p_res = ta.propagate_until(6 * pi + pi / 2);
+        REQUIRE(std::get<0>(p_res) == taylor_outcome::time_limit);
+
+        // The events without roots must have been
+        // ruled out by the bound-based pre-screening.
+        const auto stats = detail::get_ed_prune_stats();
+        REQUIRE(stats.n_tot > 0u);
+        REQUIRE(stats.n_bound >= 5u * std::get<3>(p_res));
+        REQUIRE(stats.n_bound + stats.n_sc <= stats.n_tot);
+
+        for (auto i = 0u; i < 50u; ++i) {
+            REQUIRE(counters[i] == (i < 25u ? 6u : 7u));
+        }
+        for (auto i = 50u; i < 55u; ++i) {
+            REQUIRE(counters[i] == 0u);
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
 // Another test for event direction.
 TEST_CASE("nt dir test")
 {
@@ -553,3 +626,662 @@ TEST_CASE("nt dir test")
 
     ta.propagate_until(0);
 }
+
+// Test for the batched callback of the non-terminal events.
+TEST_CASE("taylor nte batch callback")
+{
+    using std::sin;
+
+    auto [x, v] = make_vars("x", "v");
+
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+
+    // The events detected via the callbacks of the individual events.
+    std::vector<std::tuple<std::uint32_t, double, int>> ev_list;
+
+    std::vector<ev_t> evs;
+    for (auto i = 0u; i < 5u; ++i) {
+        evs.emplace_back(x - (-.5 + .25 * i), [i, &ev_list](taylor_adaptive<double> &, double t, int d_sgn) {
+            ev_list.emplace_back(i, t, d_sgn);
+        });
+    }
+
+    // NOTE: harmonic oscillator, x(t) = sin(t).
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::nt_events = evs};
+
+    REQUIRE(!ta.get_nt_batch_callback());
+
+    ta.propagate_until(10.);
+
+    REQUIRE(!ev_list.empty());
+
+    // Now with the batched callback.
+    auto ta_b = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::nt_events = evs};
+
+    std::vector<std::tuple<std::uint32_t, double, int>> ev_list_b;
+    std::size_t n_invocations = 0;
+    ta_b.set_nt_batch_callback([&ev_list_b, &n_invocations](taylor_adaptive<double> &, const auto &l) {
+        REQUIRE(!l.empty());
+
+        ev_list_b.insert(ev_list_b.end(), l.begin(), l.end());
+        ++n_invocations;
+    });
+
+    REQUIRE(ta_b.get_nt_batch_callback());
+
+    const auto size_before = ev_list.size();
+    ta_b.propagate_until(10.);
+
+    // The callbacks of the individual events must not have been invoked.
+    REQUIRE(ev_list.size() == size_before);
+
+    // The batched callback must have received the same events,
+    // and it must have been invoked less often than the number of events.
+    REQUIRE(ev_list_b == ev_list);
+    REQUIRE(n_invocations < ev_list_b.size());
+
+    for (const auto &[idx, t, d_sgn] : ev_list_b) {
+        REQUIRE(sin(t) == approximately(-.5 + .25 * idx, 1000.));
+        REQUIRE(std::abs(d_sgn) == 1);
+    }
+
+    // The batched callback is preserved by copies.
+    auto ta_copy = ta_b;
+    REQUIRE(ta_copy.get_nt_batch_callback());
+    ev_list_b.clear();
+    ta_copy.propagate_until(20.);
+    REQUIRE(!ev_list_b.empty());
+    REQUIRE(ev_list.size() == size_before);
+
+    // Unset the batched callback.
+    ta_copy.set_nt_batch_callback({});
+    ta_copy.propagate_until(30.);
+    REQUIRE(ev_list.size() > size_before);
+}
+
+// Test for the accumulation of the non-terminal
+// events into a user-provided buffer.
+TEST_CASE("taylor nte buffer")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    using ev_t = taylor_adaptive<double>::nt_event_t;
+
+    std::vector<std::tuple<std::uint32_t, double, int>> ev_list;
+
+    std::vector<ev_t> evs;
+    for (auto i = 0u; i < 3u; ++i) {
+        evs.emplace_back(x - (-.5 + .5 * i), [i, &ev_list](taylor_adaptive<double> &, double t, int d_sgn) {
+            ev_list.emplace_back(i, t, d_sgn);
+        });
+    }
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::nt_events = evs};
+    auto ta_buf = ta;
+
+    ta.propagate_until(10.);
+    REQUIRE(!ev_list.empty());
+
+    const auto ev_list_orig = ev_list;
+
+    taylor_adaptive<double>::nt_buffer_t buf{{42u, 1., 1}};
+    ta_buf.propagate_until(10., kw::nt_buffer = buf);
+
+    // The callbacks must not have been invoked, and
+    // the buffer must have been cleared beforehand.
+    REQUIRE(ev_list == ev_list_orig);
+    REQUIRE(buf == ev_list);
+
+    // The buffer is used only during the propagation.
+    ta_buf.propagate_until(20.);
+    REQUIRE(ev_list.size() > ev_list_orig.size());
+
+    // propagate_for() and propagate_grid().
+    ev_list.clear();
+    ta.propagate_for(10.);
+    ta_buf.propagate_for(10., kw::nt_buffer = buf);
+    REQUIRE(buf == ev_list);
+
+    ev_list.clear();
+    ta.propagate_grid({30., 35., 40.});
+    ta_buf.propagate_grid({30., 35., 40.}, kw::nt_buffer = buf);
+    REQUIRE(buf == ev_list);
+
+    // The buffer has priority over the batched callback.
+    ta_buf.set_nt_batch_callback([](taylor_adaptive<double> &, const auto &) { REQUIRE(false); });
+    ta_buf.propagate_for(10., kw::nt_buffer = buf);
+    REQUIRE(!buf.empty());
+}
+
+// Event detection from multiple threads, sharing the
+// process-wide cache of the event detection kernels.
+TEST_CASE("taylor nte threads")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE_THROWS_AS(taylor_ed_warmup<double>(1), std::invalid_argument);
+    REQUIRE_THROWS_AS(taylor_ed_warmup<double>(20, 0), std::invalid_argument);
+
+    const auto n_threads = 8u;
+
+    std::vector<unsigned> counters(n_threads);
+    std::vector<taylor_adaptive<double>> ta_list;
+
+    for (auto i = 0u; i < n_threads; ++i) {
+        ta_list.push_back(taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)},
+            {-0.25, 0.},
+            kw::nt_events = {nt_event<double>(v, [&counters, i](taylor_adaptive<double> &, double, int) {
+                ++counters[i];
+            })}});
+    }
+
+    // Pre-compile the kernels for the other threads.
+    taylor_ed_warmup<double>(ta_list[0].get_order());
+
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < n_threads; ++i) {
+        threads.emplace_back([&ta_list, i]() { ta_list[i].propagate_until(20.); });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (auto i = 0u; i < n_threads; ++i) {
+        REQUIRE(counters[i] == counters[0]);
+        REQUIRE(ta_list[i].get_state() == ta_list[0].get_state());
+    }
+    REQUIRE(counters[0] > 0u);
+}
+
+// Test that the event detection scratch memory
+// is reused across timesteps and that integrators
+// can detect events concurrently.
+TEST_CASE("nt event arena")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pi = boost::math::constants::pi<double>();
+
+    std::vector<double> tlist;
+
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -x},
+        {0., 1.},
+        kw::nt_events
+        = {nt_event<double>(x, [&tlist](taylor_adaptive<double> &, double t, int) { tlist.push_back(t); })}};
+
+    ta.set_perf_counters_enabled(true);
+
+    ta.propagate_until(20 * pi + 1);
+
+    const auto n_misses = ta.get_perf_counters().n_poly_cache_misses;
+    const auto n_hits = ta.get_perf_counters().n_poly_cache_hits;
+    REQUIRE(n_hits > 0u);
+
+    // In steady state, the arena does not grow anymore.
+    ta.propagate_until(40 * pi + 1);
+    REQUIRE(ta.get_perf_counters().n_poly_cache_misses == n_misses);
+    REQUIRE(ta.get_perf_counters().n_poly_cache_hits > n_hits);
+
+    REQUIRE(tlist.size() >= 40u);
+
+    // Run copies of the integrator concurrently.
+    std::vector<std::vector<double>> tlists(4);
+    std::vector<taylor_adaptive<double>> tas;
+    for (auto i = 0u; i < 4u; ++i) {
+        tas.push_back(taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -x},
+            {0., 1.},
+            kw::nt_events = {nt_event<double>(x, [&tlist = tlists[i]](taylor_adaptive<double> &, double t, int) {
+                tlist.push_back(t);
+            })}});
+    }
+
+    std::vector<std::thread> threads;
+    for (auto &ta_cur : tas) {
+        threads.emplace_back([&ta_cur, pi]() { ta_cur.propagate_until(40 * pi + 1); });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (const auto &tl : tlists) {
+        REQUIRE(tl == tlist);
+    }
+}
+
+// Test the accuracy of the event times found
+// by the root refinement.
+TEST_CASE("nt event root accuracy")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pi = boost::math::constants::pi<double>();
+
+    std::vector<double> tlist;
+
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -x},
+        {std::sin(.5), std::cos(.5)},
+        kw::time = .5,
+        kw::nt_events
+        = {nt_event<double>(x, [&tlist](taylor_adaptive<double> &, double t, int) { tlist.push_back(t); })}};
+
+    ta.propagate_until(10 * pi + 1);
+
+    REQUIRE(tlist.size() == 10u);
+
+    for (auto i = 0u; i < 10u; ++i) {
+        REQUIRE(std::abs(tlist[i] - (i + 1u) * pi) <= 1e-13 * ((i + 1u) * pi));
+    }
+}
+
+TEST_CASE("nt event detection order")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pi = boost::math::constants::pi<double>();
+
+    using ev_t = nt_event<double>;
+    using cb_t = ev_t::callback_t;
+
+    REQUIRE(ev_t(x, cb_t([](taylor_adaptive<double> &, double, int) {})).get_detection_order() == 0u);
+    REQUIRE(ev_t(x, cb_t([](taylor_adaptive<double> &, double, int) {}), kw::detection_order = 5u)
+                .get_detection_order()
+            == 5u);
+    REQUIRE_THROWS_MATCHES(
+        ev_t(x, cb_t([](taylor_adaptive<double> &, double, int) {}), kw::detection_order = 1u),
+        std::invalid_argument,
+        Message("The detection order of a non-terminal event must be either zero or at least 2"));
+
+    std::vector<double> tlist_x, tlist_v;
+
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -x},
+        {std::sin(.5), std::cos(.5)},
+        kw::time = .5,
+        kw::nt_events
+        = {ev_t(x, [&tlist_x](taylor_adaptive<double> &, double t, int) { tlist_x.push_back(t); },
+                kw::detection_order = 8u),
+           ev_t(v, [&tlist_v](taylor_adaptive<double> &, double t, int) { tlist_v.push_back(t); }),
+           // NOTE: a detection order larger than the order
+           // of the integrator is equivalent to zero.
+           ev_t(x - .5, [](taylor_adaptive<double> &, double, int) {}, kw::detection_order = 1000u)}};
+
+    ta.propagate_until(10 * pi + 1);
+
+    REQUIRE(tlist_x.size() == 10u);
+    REQUIRE(tlist_v.size() == 10u);
+
+    for (auto i = 0u; i < 10u; ++i) {
+        // The events detected with a reduced order are less accurate.
+        REQUIRE(std::abs(tlist_x[i] - (i + 1u) * pi) <= 1e-4);
+        REQUIRE(std::abs(tlist_v[i] - (i + .5) * pi) <= 1e-13 * ((i + .5) * pi));
+    }
+}
+
+TEST_CASE("nt event parallel")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pi = boost::math::constants::pi<double>();
+
+    std::vector<std::pair<std::uint32_t, double>> tlist, tlist_par;
+
+    auto make_ta = [&x = x, &v = v](std::vector<std::pair<std::uint32_t, double>> &tl) {
+        std::vector<nt_event<double>> evs;
+        for (auto i = 0u; i < 200u; ++i) {
+            evs.emplace_back(x - (-1. + i / 100.), [&tl, i](taylor_adaptive<double> &, double t, int) {
+                tl.emplace_back(i, t);
+            });
+        }
+
+        return taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::nt_events = std::move(evs)};
+    };
+
+    auto ta = make_ta(tlist);
+    auto ta_par = make_ta(tlist_par);
+
+    REQUIRE(!ta_par.get_parallel_event_detection());
+    ta_par.set_parallel_event_detection(true);
+    REQUIRE(ta_par.get_parallel_event_detection());
+
+    ta.propagate_until(4 * pi + 1);
+    ta_par.propagate_until(4 * pi + 1);
+
+    REQUIRE(tlist.size() >= 790u);
+    REQUIRE(tlist == tlist_par);
+
+    // The flag is preserved by copies.
+    auto ta_copy = ta_par;
+    REQUIRE(ta_copy.get_parallel_event_detection());
+}
+
+TEST_CASE("nt event parallel reproducibility")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto pi = boost::math::constants::pi<double>();
+
+    // NOTE: each event equation appears twice, so that
+    // the detected events contain exact ties.
+    auto run = [&x = x, &v = v, pi](bool par, unsigned n_threads) {
+        std::vector<std::pair<std::uint32_t, double>> tl;
+
+        std::vector<nt_event<double>> evs;
+        for (auto i = 0u; i < 200u; ++i) {
+            evs.emplace_back(x - (-1. + (i % 100u) / 50.), [&tl, i](taylor_adaptive<double> &, double t, int) {
+                tl.emplace_back(i, t);
+            });
+        }
+
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}, kw::nt_events = std::move(evs)};
+        ta.set_parallel_event_detection(par);
+
+        set_num_threads(n_threads);
+        ta.propagate_until(4 * pi + 1);
+        set_num_threads(0);
+
+        return tl;
+    };
+
+    const auto ref = run(false, 1);
+    REQUIRE(ref.size() >= 790u);
+
+    // The ties are broken by event index.
+    for (decltype(ref.size()) i = 1; i < ref.size(); ++i) {
+        if (ref[i].second == ref[i - 1u].second) {
+            REQUIRE(ref[i].first > ref[i - 1u].first);
+        }
+    }
+
+    // The results are bitwise identical regardless
+    // of the number of threads.
+    for (auto n_threads : {1u, 2u, 3u, 8u}) {
+        REQUIRE(run(true, n_threads) == ref);
+    }
+}
+
+TEST_CASE("nt event thread scratch")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    std::vector<double> tlist, tlist_s0, tlist_s1;
+
+    auto make_ta = [&x = x, &v = v](std::vector<double> &tl, double v0) {
+        auto cb = [&tl](taylor_adaptive<double> &, double t, int) { tl.push_back(t); };
+
+        return taylor_adaptive<double>{
+            {prime(x) = v, prime(v) = -x}, {0., v0}, kw::nt_events = {nt_event<double>(x, cb)}};
+    };
+
+    auto ta = make_ta(tlist, 1.);
+    auto ta_s0 = make_ta(tlist_s0, 1.);
+    auto ta_s1 = make_ta(tlist_s1, 2.);
+
+    REQUIRE(!ta_s0.get_thread_scratch());
+    ta_s0.set_thread_scratch(true);
+    ta_s1.set_thread_scratch(true);
+    REQUIRE(ta_s0.get_thread_scratch());
+
+    // The jet of derivatives is not resident anymore.
+    REQUIRE(ta_s0.get_memory_usage().events < ta.get_memory_usage().events);
+
+    // Interleave the steps of the integrators sharing the scratch buffer.
+    for (auto i = 0; i < 50; ++i) {
+        ta.step();
+        ta_s0.step();
+        ta_s1.step();
+
+        REQUIRE(ta_s0.get_state() == ta.get_state());
+        REQUIRE(ta_s0.get_tc() == ta.get_tc());
+    }
+
+    REQUIRE(!tlist.empty());
+    REQUIRE(tlist_s0 == tlist);
+    REQUIRE(!tlist_s1.empty());
+
+    // The flag is preserved by copies.
+    auto ta_copy = ta_s0;
+    REQUIRE(ta_copy.get_thread_scratch());
+    REQUIRE(ta_copy.get_tc() == ta.get_tc());
+
+    // Switching off the flag.
+    ta_copy.set_thread_scratch(false);
+    REQUIRE(!ta_copy.get_thread_scratch());
+    ta_copy.step();
+    ta.step();
+    REQUIRE(ta_copy.get_tc() == ta.get_tc());
+
+    // Serialisation of an integrator in scratch mode.
+    {
+        std::stringstream ss;
+        ta_s0.save(ss);
+
+        auto ta_load = taylor_adaptive<double>::load(
+            ss, {}, {nt_event<double>(x, [](taylor_adaptive<double> &, double, int) {})});
+
+        REQUIRE(!ta_load.get_thread_scratch());
+        REQUIRE(ta_load.get_tc() == ta_s0.get_tc());
+        ta_load.step();
+        ta_s0.step();
+        REQUIRE(ta_load.get_state() == ta_s0.get_state());
+    }
+
+    // Batch mode.
+    auto bcb = [](taylor_adaptive_batch<double> &, double, int, std::uint32_t) {};
+    auto tab = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -x}, {0., 0., 1., 2.}, 2, kw::nt_events = {nt_event_batch<double>(x, bcb)}};
+    auto tab_s = tab;
+    tab_s.set_thread_scratch(true);
+    REQUIRE(tab_s.get_thread_scratch());
+
+    for (auto i = 0; i < 20; ++i) {
+        tab.step();
+        tab_s.step();
+        ta_s1.step();
+
+        REQUIRE(tab_s.get_state() == tab.get_state());
+        REQUIRE(tab_s.get_tc() == tab.get_tc());
+    }
+}
+
+TEST_CASE("nt event jet alignment")
+{
+    using detail::aligned_vector;
+    using detail::buffer_alignment;
+
+    // Small and large (huge page-sized) buffers.
+    for (auto size : {std::size_t(1), std::size_t(1000), std::size_t(1) << 20}) {
+        aligned_vector<double> v(size, 1.);
+
+        REQUIRE(reinterpret_cast<std::uintptr_t>(v.data()) % buffer_alignment == 0u);
+        REQUIRE(v.back() == 1.);
+
+        auto v_copy = v;
+        REQUIRE(reinterpret_cast<std::uintptr_t>(v_copy.data()) % buffer_alignment == 0u);
+        REQUIRE(v_copy == v);
+    }
+
+    // Integration with the aligned jet.
+    auto [x, v] = make_vars("x", "v");
+
+    std::vector<double> tlist;
+
+    auto cb = [&tlist](taylor_adaptive<double> &, double t, int) { tlist.push_back(t); };
+
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -x}, {1., 0.}, kw::nt_events = {nt_event<double>(x, cb)}};
+
+    ta.propagate_until(10.);
+
+    REQUIRE(tlist.size() == 3u);
+
+    // Check the serialisation of the jet.
+    std::stringstream ss;
+    ta.save(ss);
+    auto ta2 = taylor_adaptive<double>::load(ss, {}, {nt_event<double>(x, cb)});
+
+    ta.propagate_until(20.);
+    ta2.propagate_until(20.);
+
+    REQUIRE(tlist.size() == 9u);
+    REQUIRE(ta2.get_state() == ta.get_state());
+}
+
+TEST_CASE("nt event soa view")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    using ev_t = nt_event<double>;
+
+    std::vector<std::pair<std::uint32_t, double>> step_evs;
+
+    auto make_cb = [&step_evs](std::uint32_t idx) {
+        return [&step_evs, idx](taylor_adaptive<double> &, double t, int) { step_evs.emplace_back(idx, t); };
+    };
+
+    // Several events triggering in the same timesteps,
+    // plus a terminal event stopping the integration.
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x},
+                                      {0., 1.},
+                                      kw::nt_events = {ev_t(x - .5, make_cb(0)), ev_t(v, make_cb(1)),
+                                                       ev_t(x + .5, make_cb(2)), ev_t(x, make_cb(3))},
+                                      kw::t_events = {t_event<double>(v + .99)}};
+
+    REQUIRE(ta.get_last_nt_events().size == 0u);
+
+    std::size_t n_evs = 0;
+    while (true) {
+        step_evs.clear();
+
+        const auto [oc, h] = ta.step();
+
+        // The view contains the events whose callbacks
+        // were invoked in the timestep, in the same order.
+        const auto view = ta.get_last_nt_events();
+        REQUIRE(view.size == step_evs.size());
+        for (std::size_t i = 0; i < view.size; ++i) {
+            REQUIRE(view.idx[i] == step_evs[i].first);
+            REQUIRE(view.time[i] == step_evs[i].second);
+            REQUIRE((view.d_sgn[i] == 1 || view.d_sgn[i] == -1));
+
+            if (i > 0u) {
+                REQUIRE(view.time[i - 1u] <= view.time[i]);
+            }
+
+            // All the events happen before the terminal event.
+            REQUIRE(view.time[i] <= ta.get_time());
+        }
+
+        n_evs += view.size;
+
+        if (oc != taylor_outcome::success) {
+            REQUIRE(oc == taylor_outcome{-1});
+            break;
+        }
+    }
+
+    REQUIRE(n_evs > 0u);
+    REQUIRE(ta.get_state()[1] == approximately(-.99, 1000.));
+}
+
+TEST_CASE("nt event separate jet")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto sys = {prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    for (auto cm : {false, true}) {
+        std::vector<double> tlist, tlist_sep;
+
+        auto make_ta = [&](std::vector<double> &tl, bool sep) {
+            return taylor_adaptive<double>{
+                sys,
+                {0.05, 0.025},
+                kw::compact_mode = cm,
+                kw::separate_ev_jet = sep,
+                kw::nt_events = {nt_event<double>(
+                    v * v - 1e-10, [&tl](taylor_adaptive<double> &, double t, int) { tl.push_back(t); })},
+                kw::t_events = {t_event<double>(x - 0.04)}};
+        };
+
+        auto ta = make_ta(tlist, false);
+        auto ta_sep = make_ta(tlist_sep, true);
+
+        REQUIRE(!ta.get_separate_ev_jet());
+        REQUIRE(ta_sep.get_separate_ev_jet());
+
+        // The separate jet gives the same results.
+        for (auto i = 0; i < 3; ++i) {
+            const auto oc = std::get<0>(ta.propagate_until(10.));
+            const auto oc_sep = std::get<0>(ta_sep.propagate_until(10.));
+
+            REQUIRE(oc == oc_sep);
+            REQUIRE(ta.get_time() == approximately(ta_sep.get_time(), 1000.));
+            REQUIRE(ta.get_state()[0] == approximately(ta_sep.get_state()[0], 1000.));
+        }
+
+        REQUIRE(!tlist.empty());
+        REQUIRE(tlist.size() == tlist_sep.size());
+        for (decltype(tlist.size()) i = 0; i < tlist.size(); ++i) {
+            REQUIRE(tlist[i] == approximately(tlist_sep[i], 1000.));
+        }
+
+        // Copy and serialisation.
+        auto ta_copy = ta_sep;
+        REQUIRE(ta_copy.get_separate_ev_jet());
+
+        std::stringstream ss;
+        ta_sep.save(ss);
+        auto ta_load = taylor_adaptive<double>::load(
+            ss, {t_event<double>(x - 0.04)},
+            {nt_event<double>(v * v - 1e-10, [](taylor_adaptive<double> &, double, int) {})});
+        REQUIRE(ta_load.get_separate_ev_jet());
+
+        const auto oc = std::get<0>(ta_sep.propagate_until(20.));
+        REQUIRE(std::get<0>(ta_copy.propagate_until(20.)) == oc);
+        REQUIRE(std::get<0>(ta_load.propagate_until(20.)) == oc);
+        REQUIRE(ta_copy.get_state() == ta_sep.get_state());
+        REQUIRE(ta_load.get_state() == ta_sep.get_state());
+    }
+
+    // Without events, the flag is ignored.
+    auto ta = taylor_adaptive<double>{sys, {0.05, 0.025}, kw::separate_ev_jet = true};
+    REQUIRE(!ta.get_separate_ev_jet());
+}
+
+// Test the event detection with both the polynomial
+// translation algorithms (low and high orders).
+TEST_CASE("nt event translation algorithms")
+{
+    using std::abs;
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto tol : {1e-10, 1e-16}) {
+        for (auto cm : {false, true}) {
+            std::vector<double> tlist;
+
+            auto ta = taylor_adaptive<double>{
+                {prime(x) = v, prime(v) = -x},
+                {1., 0.},
+                kw::tol = tol,
+                kw::compact_mode = cm,
+                kw::nt_events = {nt_event<double>(
+                    x, [&tlist](taylor_adaptive<double> &, double t, int) { tlist.push_back(t); })}};
+
+            REQUIRE(ta.get_order() == (tol == 1e-10 ? 13u : 20u));
+
+            ta.propagate_until(100.);
+
+            REQUIRE(tlist.size() == 32u);
+            for (decltype(tlist.size()) i = 0; i < tlist.size(); ++i) {
+                REQUIRE(abs(tlist[i] - (static_cast<double>(i) + .5) * boost::math::constants::pi<double>()) < 1e-8);
+            }
+        }
+    }
+}
@@ -0,0 +1,289 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// Check that the propagation codepath
+// with events produces results identical
+// to the no-events codepath.
+TEST_CASE("taylor nte batch match")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        using ev_t = typename taylor_adaptive_batch<fp_t>::nt_event_t;
+
+        const auto init_state
+            = std::vector<fp_t>{fp_t(-0.25), fp_t(-0.26), fp_t(-0.27), fp_t(-0.28), 0, fp_t(0.01), fp_t(0.02), 0};
+
+        auto ta_ev = taylor_adaptive_batch<fp_t>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)},
+            init_state,
+            4,
+            kw::opt_level = opt_level,
+            kw::high_accuracy = high_accuracy,
+            kw::compact_mode = compact_mode,
+            kw::nt_events = {ev_t(v, [](taylor_adaptive_batch<fp_t> &, fp_t, int, std::uint32_t) {})}};
+
+        auto ta = taylor_adaptive_batch<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                              init_state,
+                                              4,
+                                              kw::opt_level = opt_level,
+                                              kw::high_accuracy = high_accuracy,
+                                              kw::compact_mode = compact_mode};
+
+        for (auto i = 0; i < 200; ++i) {
+            ta_ev.step();
+            ta.step();
+
+            REQUIRE(ta_ev.get_step_res() == ta.get_step_res());
+            REQUIRE(ta_ev.get_state() == ta.get_state());
+            REQUIRE(ta_ev.get_time() == ta.get_time());
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+TEST_CASE("taylor nte batch")
+{
+    auto [v] = make_vars("v");
+
+    using ev_t = taylor_adaptive_batch<double>::nt_event_t;
+
+    std::ostringstream oss;
+    oss << ev_t(v * v - 1e-10, [](taylor_adaptive_batch<double> &, double, int, std::uint32_t) {});
+    REQUIRE(boost::algorithm::contains(oss.str(), "direction::any"));
+    REQUIRE(boost::algorithm::contains(oss.str(), "non-terminal"));
+    oss.str("");
+
+    oss << ev_t(
+        v * v - 1e-10, [](taylor_adaptive_batch<double> &, double, int, std::uint32_t) {},
+        kw::direction = event_direction::positive);
+    REQUIRE(boost::algorithm::contains(oss.str(), "event_direction::positive"));
+    oss.str("");
+
+    REQUIRE_THROWS_AS(ev_t(v * v - 1e-10, ev_t::callback_t{}), std::invalid_argument);
+}
+
+// Compare the non-terminal events detected in batch mode
+// with the events detected by scalar integrators.
+TEST_CASE("taylor nte batch scalar compare")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using std::abs;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        using ev_t = typename taylor_adaptive_batch<fp_t>::nt_event_t;
+        using s_ev_t = typename taylor_adaptive<fp_t>::nt_event_t;
+
+        const std::uint32_t batch_size = 4;
+
+        const auto init_state
+            = std::vector<fp_t>{fp_t(0), fp_t(0.01), fp_t(0.02), fp_t(0.03), fp_t(0.25), fp_t(0.26), fp_t(0.27), 0};
+
+        std::vector<std::vector<fp_t>> b_times(batch_size);
+
+        auto ta = taylor_adaptive_batch<fp_t>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)},
+            init_state,
+            batch_size,
+            kw::opt_level = opt_level,
+            kw::high_accuracy = high_accuracy,
+            kw::compact_mode = compact_mode,
+            kw::nt_events = {ev_t(x, [&b_times](taylor_adaptive_batch<fp_t> &tab, fp_t t, int, std::uint32_t idx) {
+                // The callbacks are invoked in chronological
+                // order within each batch element.
+                REQUIRE((b_times[idx].empty() || t > b_times[idx].back()));
+                REQUIRE(t <= tab.get_time()[idx]);
+
+                b_times[idx].push_back(t);
+            })}};
+
+        ta.propagate_until(std::vector<fp_t>(batch_size, fp_t(10)));
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            REQUIRE(std::get<0>(ta.get_propagate_res()[i]) == taylor_outcome::time_limit);
+
+            std::vector<fp_t> s_times;
+
+            auto ta_s = taylor_adaptive<fp_t>{
+                {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                {init_state[i], init_state[batch_size + i]},
+                kw::opt_level = opt_level,
+                kw::high_accuracy = high_accuracy,
+                kw::compact_mode = compact_mode,
+                kw::nt_events
+                = {s_ev_t(x, [&s_times](taylor_adaptive<fp_t> &, fp_t t, int) { s_times.push_back(t); })}};
+
+            ta_s.propagate_until(fp_t(10));
+
+            REQUIRE(s_times.size() == b_times[i].size());
+            for (decltype(s_times.size()) j = 0; j < s_times.size(); ++j) {
+                REQUIRE(abs(s_times[j] - b_times[i][j]) < std::numeric_limits<fp_t>::epsilon() * 1000);
+            }
+        }
+
+        // Over 10 time units, the pendulum must have
+        // crossed the equilibrium position multiple times.
+        REQUIRE(b_times[3].size() > 5u);
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+// Test for the batched callback of the non-terminal events.
+TEST_CASE("taylor nte batch batch callback")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    using ev_t = taylor_adaptive_batch<double>::nt_event_t;
+
+    const std::uint32_t batch_size = 2;
+
+    const auto init_state = std::vector<double>{0., 0.01, 0.25, 0.26};
+
+    // The trigger times detected via the callback of the event.
+    std::vector<std::vector<double>> times(batch_size);
+
+    const auto ev = ev_t(x, [&times](taylor_adaptive_batch<double> &, double t, int, std::uint32_t idx) {
+        times[idx].push_back(t);
+    });
+
+    auto ta = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, init_state, batch_size, kw::nt_events = {ev}};
+
+    ta.propagate_until({10., 10.});
+
+    REQUIRE(!times[0].empty());
+    REQUIRE(!times[1].empty());
+
+    // Now with the batched callback.
+    auto ta_b = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, init_state, batch_size, kw::nt_events = {ev}};
+
+    std::vector<std::vector<double>> times_b(batch_size);
+    ta_b.set_nt_batch_callback(
+        [&times_b](taylor_adaptive_batch<double> &, const std::vector<std::tuple<std::uint32_t, double, int>> &l,
+                   std::uint32_t idx) {
+            REQUIRE(!l.empty());
+
+            for (const auto &t : l) {
+                REQUIRE(std::get<0>(t) == 0u);
+                times_b[idx].push_back(std::get<1>(t));
+            }
+        });
+
+    REQUIRE(ta_b.get_nt_batch_callback());
+
+    auto times_orig = times;
+    ta_b.propagate_until({10., 10.});
+
+    // The callback of the event must not have been invoked.
+    REQUIRE(times == times_orig);
+
+    REQUIRE(times_b == times);
+}
+
+// Test for the accumulation of the non-terminal
+// events into a user-provided buffer.
+TEST_CASE("taylor nte batch buffer")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    using ev_t = taylor_adaptive_batch<double>::nt_event_t;
+
+    const std::uint32_t batch_size = 2;
+
+    std::vector<std::vector<double>> times(batch_size);
+
+    const auto ev = ev_t(x, [&times](taylor_adaptive_batch<double> &, double t, int, std::uint32_t idx) {
+        times[idx].push_back(t);
+    });
+
+    auto ta = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)}, {0., 0.01, 0.25, 0.26}, batch_size, kw::nt_events = {ev}};
+    auto ta_buf = ta;
+
+    ta.propagate_until({10., 10.});
+
+    const auto times_orig = times;
+
+    taylor_adaptive_batch<double>::nt_buffer_t buf;
+    ta_buf.propagate_until({10., 10.}, kw::nt_buffer = buf);
+
+    // The callback must not have been invoked.
+    REQUIRE(times == times_orig);
+
+    REQUIRE(buf.size() == batch_size);
+    for (std::uint32_t i = 0; i < batch_size; ++i) {
+        REQUIRE(!buf[i].empty());
+        REQUIRE(buf[i].size() == times[i].size());
+
+        for (decltype(buf[i].size()) j = 0; j < buf[i].size(); ++j) {
+            REQUIRE(std::get<0>(buf[i][j]) == 0u);
+            REQUIRE(std::get<1>(buf[i][j]) == times[i][j]);
+        }
+    }
+
+    // The buffer is cleared on reuse.
+    ta_buf.propagate_for({1e-3, 1e-3}, kw::nt_buffer = buf);
+    REQUIRE(buf.size() == batch_size);
+    REQUIRE(buf[0].empty());
+    REQUIRE(buf[1].empty());
+}
@@ -0,0 +1,110 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+// NOTE: the path to the libdevice bitcode file used in the tests
+// can be set via the HEYOKA_TEST_LIBDEVICE environment variable.
+std::string get_libdevice()
+{
+    const auto *ld = std::getenv("HEYOKA_TEST_LIBDEVICE");
+
+    return ld == nullptr ? std::string{} : std::string{ld};
+}
+
+TEST_CASE("nvptx get_ptx")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // A function which does not invoke math functions.
+    llvm_state s;
+    taylor_add_jet<double>(s, "jet", {prime(x) = v, prime(v) = -x}, 3, 1, false, false);
+
+    const auto ptx = s.get_ptx();
+
+    REQUIRE(ptx.find(".target sm_60") != std::string::npos);
+    REQUIRE(ptx.find("jet(") != std::string::npos);
+
+    // The module of the state is not altered.
+    REQUIRE(!s.is_compiled());
+    REQUIRE(s.get_ir().find("nvptx") == std::string::npos);
+
+    // A different architecture.
+    REQUIRE(s.get_ptx("sm_70").find(".target sm_70") != std::string::npos);
+
+    // The state can still be compiled for the host.
+    s.compile();
+    REQUIRE(s.jit_lookup("jet") != 0u);
+}
+
+TEST_CASE("nvptx step")
+{
+    const auto libdevice = get_libdevice();
+    if (libdevice.empty()) {
+        return;
+    }
+
+    auto [x, v] = make_vars("x", "v");
+
+    for (auto cm : {false, true}) {
+        for (auto ha : {false, true}) {
+            llvm_state s;
+
+            taylor_add_nvptx_step(s, "step", {prime(x) = v, prime(v) = -9.8 * sin(x) + par[0] * square(v)}, 1e-15,
+                                  ha, cm);
+
+            const auto ptx = s.get_ptx("sm_60", libdevice);
+
+            REQUIRE(ptx.find(".entry step(") != std::string::npos);
+            REQUIRE(ptx.find("__nvvm_reflect") == std::string::npos);
+        }
+    }
+}
+
+TEST_CASE("nvptx step error handling")
+{
+    using Catch::Matchers::Message;
+
+    auto [x, v] = make_vars("x", "v");
+
+    llvm_state s;
+
+    REQUIRE_THROWS_MATCHES(
+        taylor_add_nvptx_step(s, "step", {prime(x) = v, prime(v) = -x}, -1., false, false), std::invalid_argument,
+        Message("The tolerance of a GPU stepper must be finite and positive, but it is -1 instead"));
+    REQUIRE_THROWS_AS(taylor_add_nvptx_step(s, "step", {prime(x) = v, prime(v) = -x},
+                                            std::numeric_limits<double>::infinity(), false, false),
+                      std::invalid_argument);
+
+    // NOTE: the stepper always invokes math functions
+    // in the determination of the timestep.
+    taylor_add_nvptx_step(s, "step", {prime(x) = v, prime(v) = -x}, 1e-15, false, false);
+
+    REQUIRE_THROWS_MATCHES(s.get_ptx("sm_60", ""), std::invalid_argument,
+                           Message("The generation of PTX code for a module invoking math functions requires the "
+                                   "path to the libdevice bitcode file"));
+    REQUIRE_THROWS_AS(s.get_ptx("sm_60", "/nonexistent/libdevice.10.bc"), std::invalid_argument);
+    REQUIRE_THROWS_MATCHES(s.get_ptx("foo"), std::invalid_argument,
+                           Message("Invalid GPU architecture 'foo' specified for the NVPTX target"));
+}
@@ -0,0 +1,168 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// Initial conditions for an N-body system,
+// with the bodies on a perturbed ring.
+template <typename T>
+std::vector<T> make_ring_ic(std::uint32_t n, std::uint32_t batch_size)
+{
+    std::vector<T> retval;
+
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const auto shift = T(i) / (n + 1u);
+
+        const auto vals = std::vector<T>{1 - shift, shift, shift / 10, -shift / 2, 1 - shift / 3, shift / 5};
+
+        for (const auto &v : vals) {
+            for (std::uint32_t j = 0; j < batch_size; ++j) {
+                retval.push_back(v + T(j) / 100);
+            }
+        }
+    }
+
+    return retval;
+}
+
+// Check that parallel mode produces the same
+// results as the (serial) compact mode.
+TEST_CASE("taylor parallel mode")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy) {
+        using fp_t = decltype(fp_x);
+
+        const std::uint32_t n = 6;
+
+        const auto sys = make_nbody_sys(n, kw::masses = std::vector<double>(n, 1. / n));
+
+        auto ta = taylor_adaptive<fp_t>{sys, make_ring_ic<fp_t>(n, 1), kw::opt_level = opt_level,
+                                        kw::high_accuracy = high_accuracy, kw::compact_mode = true};
+        auto ta_par = taylor_adaptive<fp_t>{sys,
+                                            make_ring_ic<fp_t>(n, 1),
+                                            kw::opt_level = opt_level,
+                                            kw::high_accuracy = high_accuracy,
+                                            kw::compact_mode = true,
+                                            kw::parallel_mode = true};
+
+        for (auto i = 0; i < 20; ++i) {
+            const auto [oc, h] = ta.step();
+            const auto [oc_par, h_par] = ta_par.step();
+
+            REQUIRE(oc == taylor_outcome::success);
+            REQUIRE(oc_par == taylor_outcome::success);
+            REQUIRE(h_par == approximately(h, fp_t(1000)));
+
+            for (decltype(ta.get_state().size()) j = 0; j < ta.get_state().size(); ++j) {
+                REQUIRE(ta_par.get_state()[j] == approximately(ta.get_state()[j], fp_t(1000)));
+            }
+        }
+
+        // Copy the integrator in parallel mode.
+        auto ta_par2 = ta_par;
+        ta_par.step();
+        ta_par2.step();
+        REQUIRE(ta_par2.get_state() == ta_par.get_state());
+
+        // With events, which require the computation of
+        // the last-order derivatives of the u variables.
+        auto [x0, y0] = make_vars("x_0", "y_0");
+
+        using ev_t = typename taylor_adaptive<fp_t>::nt_event_t;
+
+        std::vector<fp_t> times, times_par;
+
+        auto ta_ev = taylor_adaptive<fp_t>{
+            sys,
+            make_ring_ic<fp_t>(n, 1),
+            kw::opt_level = opt_level,
+            kw::high_accuracy = high_accuracy,
+            kw::compact_mode = true,
+            kw::nt_events
+            = {ev_t(x0 - y0, [&times](taylor_adaptive<fp_t> &, fp_t t, int) { times.push_back(t); })}};
+        auto ta_ev_par = taylor_adaptive<fp_t>{
+            sys,
+            make_ring_ic<fp_t>(n, 1),
+            kw::opt_level = opt_level,
+            kw::high_accuracy = high_accuracy,
+            kw::compact_mode = true,
+            kw::parallel_mode = true,
+            kw::nt_events = {ev_t(x0 - y0,
+                                  [&times_par](taylor_adaptive<fp_t> &, fp_t t, int) { times_par.push_back(t); })}};
+
+        ta_ev.propagate_until(fp_t(5));
+        ta_ev_par.propagate_until(fp_t(5));
+
+        REQUIRE(!times.empty());
+        REQUIRE(times.size() == times_par.size());
+        for (decltype(times.size()) j = 0; j < times.size(); ++j) {
+            REQUIRE(times_par[j] == approximately(times[j], fp_t(1000)));
+        }
+
+        // Batch mode.
+        const std::uint32_t batch_size = 4;
+
+        auto tab = taylor_adaptive_batch<fp_t>{sys, make_ring_ic<fp_t>(n, batch_size), batch_size,
+                                               kw::opt_level = opt_level, kw::high_accuracy = high_accuracy,
+                                               kw::compact_mode = true};
+        auto tab_par = taylor_adaptive_batch<fp_t>{sys,
+                                                   make_ring_ic<fp_t>(n, batch_size),
+                                                   batch_size,
+                                                   kw::opt_level = opt_level,
+                                                   kw::high_accuracy = high_accuracy,
+                                                   kw::compact_mode = true,
+                                                   kw::parallel_mode = true};
+
+        for (auto i = 0; i < 20; ++i) {
+            tab.step();
+            tab_par.step();
+
+            for (decltype(tab.get_state().size()) j = 0; j < tab.get_state().size(); ++j) {
+                REQUIRE(tab_par.get_state()[j] == approximately(tab.get_state()[j], fp_t(1000)));
+            }
+        }
+
+        // Parallel mode is ignored if compact mode is not active.
+        auto ta_def = taylor_adaptive<fp_t>{sys, make_ring_ic<fp_t>(n, 1), kw::opt_level = opt_level,
+                                            kw::high_accuracy = high_accuracy, kw::parallel_mode = true};
+        REQUIRE(std::get<0>(ta_def.step()) == taylor_outcome::success);
+    };
+
+    for (auto ha : {false, true}) {
+        tuple_for_each(fp_types, [&tester, ha](auto x) { tester(x, 0, ha); });
+        tuple_for_each(fp_types, [&tester, ha](auto x) { tester(x, 3, ha); });
+    }
+}
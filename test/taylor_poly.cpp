@@ -0,0 +1,142 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/poly.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+// The coefficients 1, 1/2, 1/3, ... of a polynomial of degree d.
+template <typename T>
+std::vector<expression> make_cfs(unsigned d)
+{
+    std::vector<expression> retval;
+    for (auto i = 0u; i <= d; ++i) {
+        retval.emplace_back(number{T(1) / (i + 1u)});
+    }
+
+    return retval;
+}
+
+// The same polynomial written as a tree of binary operations.
+expression horner(const expression &x, const std::vector<expression> &cfs)
+{
+    auto retval = cfs.back();
+    for (auto i = cfs.size() - 1u; i > 0u; --i) {
+        retval = cfs[i - 1u] + retval * x;
+    }
+
+    return retval;
+}
+
+TEST_CASE("poly basics")
+{
+    auto x = "x"_var, y = "y"_var;
+
+    REQUIRE_THROWS_AS(poly(x, {}), std::invalid_argument);
+    REQUIRE_THROWS_AS(poly(x, {1_dbl, y, 2_dbl}), std::invalid_argument);
+
+    // Low degrees result in plain expressions.
+    REQUIRE(poly(x, {1_dbl}) == 1_dbl);
+    REQUIRE(poly(x, {1_dbl, 0_dbl, 0_dbl}) == 1_dbl);
+    REQUIRE(std::holds_alternative<func>(poly(x, {1_dbl, 2_dbl, 3_dbl, 0_dbl}).value()));
+
+    REQUIRE(eval_dbl(poly(x, {1_dbl, 2_dbl, 3_dbl}), {{"x", 2.}}) == 17.);
+    REQUIRE(eval_dbl(poly(x, {1_dbl, 2_dbl, 3_dbl, 4_dbl}), {{"x", 2.}}) == 49.);
+    REQUIRE(eval_dbl(diff(poly(x, {1_dbl, 2_dbl, 3_dbl, 4_dbl}), "x"), {{"x", 2.}}) == 62.);
+    REQUIRE(eval_dbl(diff(poly(x * y, {1_dbl, 2_dbl, 3_dbl}), "y"), {{"x", 2.}, {"y", 1.}}) == 28.);
+
+    // The polynomial results in a shorter decomposition.
+    for (auto d : {2u, 3u, 7u, 12u}) {
+        const auto cfs = make_cfs<double>(d);
+
+        REQUIRE(taylor_decompose({poly(x, cfs), poly(y, cfs)}, {}).first.size()
+                < taylor_decompose({horner(x, cfs), horner(y, cfs)}, {}).first.size());
+    }
+}
+
+TEST_CASE("taylor poly")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        // NOTE: degree 2 has no hidden dependencies,
+        // degree 12 is evaluated with Estrin's scheme.
+        for (auto d : {2u, 3u, 5u, 12u}) {
+            const auto cfs = make_cfs<fp_t>(d);
+
+            for (auto batch_size : {1u, 2u}) {
+                llvm_state s{kw::opt_level = opt_level};
+
+                taylor_add_jet<fp_t>(s, "jet", {poly(y, cfs), poly(x + y, cfs), poly(par[0], cfs)}, 4, batch_size,
+                                     high_accuracy, compact_mode);
+                taylor_add_jet<fp_t>(s, "jet_ref", {horner(y, cfs), horner(x + y, cfs), horner(par[0], cfs)}, 4,
+                                     batch_size, high_accuracy, compact_mode);
+
+                s.compile();
+
+                auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+                auto jptr_ref
+                    = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet_ref"));
+
+                std::vector<fp_t> jet(15u * batch_size), jet_ref;
+                for (auto i = 0u; i < 3u * batch_size; ++i) {
+                    jet[i] = fp_t(i + 1u) / 10;
+                }
+                jet_ref = jet;
+
+                std::vector<fp_t> pars(batch_size, fp_t(-1) / 3);
+
+                jptr(jet.data(), pars.data(), nullptr);
+                jptr_ref(jet_ref.data(), pars.data(), nullptr);
+
+                for (decltype(jet.size()) i = 0; i < jet.size(); ++i) {
+                    REQUIRE(jet[i] == approximately(jet_ref[i], fp_t(1000)));
+                }
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
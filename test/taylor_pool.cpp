@@ -0,0 +1,163 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/taylor_pool.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("taylor pool basic")
+{
+    auto tester = [](auto fp_x) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        auto proto = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -par[0] * x},
+                                           {fp_t(0), fp_t(1)},
+                                           kw::pars = {fp_t(1)},
+                                           kw::time = fp_t(1)};
+
+        taylor_pool<fp_t> pool(proto, 2);
+        REQUIRE(pool.get_size() == 2u);
+        REQUIRE(pool.get_n_available() == 2u);
+        REQUIRE(pool.get_prototype().get_state() == proto.get_state());
+
+        {
+            auto h = pool.checkout();
+            REQUIRE(h);
+            REQUIRE(pool.get_n_available() == 1u);
+
+            REQUIRE(h->get_state() == proto.get_state());
+            REQUIRE(h->get_time() == 1);
+
+            // Modify the state, time and pars.
+            h->get_pars_data()[0] = 2;
+            h->propagate_until(fp_t(5));
+            REQUIRE(h->get_time() == 5);
+        }
+
+        // The integrator was returned and reset.
+        REQUIRE(pool.get_n_available() == 2u);
+
+        {
+            auto h1 = pool.checkout();
+            auto h2 = pool.checkout();
+
+            for (auto *h : {&h1, &h2}) {
+                REQUIRE((*h)->get_state() == proto.get_state());
+                REQUIRE((*h)->get_pars() == proto.get_pars());
+                REQUIRE((*h)->get_time() == 1);
+            }
+
+            REQUIRE(pool.get_n_available() == 0u);
+            REQUIRE(!pool.try_checkout());
+
+            // The pool grows when empty.
+            auto h3 = pool.checkout();
+            REQUIRE(h3);
+            REQUIRE(pool.get_size() == 3u);
+
+            // Same results as a fresh copy of the prototype.
+            auto ta = proto;
+            ta.propagate_until(fp_t(3));
+            h1->propagate_until(fp_t(3));
+            REQUIRE(h1->get_state() == ta.get_state());
+
+            // Early release.
+            h2.release();
+            REQUIRE(!h2);
+            REQUIRE(pool.get_n_available() == 1u);
+
+            // Move semantics.
+            auto h4 = std::move(h3);
+            REQUIRE(h4);
+            REQUIRE(!h3);
+            h4 = std::move(h1);
+            REQUIRE(h4);
+            REQUIRE(pool.get_n_available() == 2u);
+        }
+
+        REQUIRE(pool.get_n_available() == 3u);
+
+        // Handles can outlive the pool.
+        auto h = pool.checkout();
+        {
+            auto pool2 = std::move(pool);
+            REQUIRE(pool2.get_n_available() == 2u);
+            REQUIRE(pool.get_n_available() == 0u);
+            REQUIRE_THROWS_AS(pool.checkout(), std::invalid_argument);
+            REQUIRE_THROWS_AS(pool.get_prototype(), std::invalid_argument);
+        }
+        h->step();
+    };
+
+    tuple_for_each(fp_types, tester);
+}
+
+TEST_CASE("taylor pool threads")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    auto proto = taylor_adaptive<double>{{prime(x) = v, prime(v) = -x}, {0., 1.}};
+
+    auto ta = proto;
+    ta.propagate_until(10.);
+
+    taylor_pool<double> pool(proto, 4);
+
+    std::vector<std::thread> threads;
+    std::vector<int> ok(4, 0);
+    for (auto i = 0; i < 4; ++i) {
+        threads.emplace_back([&, i]() {
+            for (auto j = 0; j < 20; ++j) {
+                auto h = pool.checkout();
+                h->propagate_until(10.);
+
+                if (h->get_state() != ta.get_state()) {
+                    return;
+                }
+            }
+
+            ok[i] = 1;
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    REQUIRE(ok == std::vector<int>(4, 1));
+    REQUIRE(pool.get_n_available() == pool.get_size());
+}
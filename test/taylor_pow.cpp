@@ -705,3 +705,48 @@ TEST_CASE("taylor pow")
         }
     }
 }
+
+// Test the expansion of pow() with small integral
+// and half-integral exponents.
+TEST_CASE("taylor pow expand")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using std::pow;
+
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        for (auto e : {fp_t(-3) / 2, fp_t(-1), fp_t(-2), fp_t(5) / 2, fp_t(-15) / 2, fp_t(7)}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            // NOTE: in compact mode, the expanded and non-expanded
+            // powers must not share the same implementation.
+            taylor_add_jet<fp_t>(s, "jet", {pow(y, expression{number{e}}), pow(x, expression{number{fp_t(27) / 10}})},
+                                 2, 1, high_accuracy, compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> jet{fp_t{2}, fp_t(3)};
+            jet.resize(6);
+
+            jptr(jet.data(), nullptr, nullptr);
+
+            REQUIRE(jet[0] == 2);
+            REQUIRE(jet[1] == 3);
+            REQUIRE(jet[2] == approximately(pow(fp_t{3}, e)));
+            REQUIRE(jet[3] == approximately(pow(fp_t{2}, fp_t(27) / 10)));
+            REQUIRE(jet[4] == approximately(fp_t{1} / 2 * e * pow(fp_t{3}, e - 1) * jet[3]));
+            REQUIRE(jet[5] == approximately(fp_t{1} / 2 * fp_t(27) / 10 * pow(fp_t{2}, fp_t(17) / 10) * jet[2]));
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
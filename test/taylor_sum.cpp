@@ -0,0 +1,153 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <initializer_list>
+#include <random>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/sum.hpp>
+#include <heyoka/number.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+static std::mt19937 rng;
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+template <typename T, typename U>
+void compare_batch_scalar(std::initializer_list<U> sys, unsigned opt_level, bool high_accuracy, bool compact_mode)
+{
+    for (auto batch_size : {2u, 4u, 8u, 23u}) {
+        llvm_state s{kw::opt_level = opt_level};
+
+        taylor_add_jet<T>(s, "jet_batch", sys, 3, batch_size, high_accuracy, compact_mode);
+        taylor_add_jet<T>(s, "jet_scalar", sys, 3, 1, high_accuracy, compact_mode);
+
+        s.compile();
+
+        auto jptr_batch = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("jet_batch"));
+        auto jptr_scalar = reinterpret_cast<void (*)(T *, const T *, const T *)>(s.jit_lookup("jet_scalar"));
+
+        std::vector<T> jet_batch;
+        jet_batch.resize(8 * batch_size);
+        std::uniform_real_distribution<float> dist(.1f, 20.f);
+        std::generate(jet_batch.begin(), jet_batch.end(), [&dist]() { return T{dist(rng)}; });
+
+        std::vector<T> jet_scalar;
+        jet_scalar.resize(8);
+
+        std::vector<T> pars_batch(batch_size, T{3}), pars_scalar{T{3}};
+
+        jptr_batch(jet_batch.data(), pars_batch.data(), nullptr);
+
+        for (auto batch_idx = 0u; batch_idx < batch_size; ++batch_idx) {
+            // Assign the initial values of x and y.
+            for (auto i = 0u; i < 2u; ++i) {
+                jet_scalar[i] = jet_batch[i * batch_size + batch_idx];
+            }
+
+            jptr_scalar(jet_scalar.data(), pars_scalar.data(), nullptr);
+
+            for (auto i = 2u; i < 8u; ++i) {
+                REQUIRE(jet_scalar[i] == approximately(jet_batch[i * batch_size + batch_idx]));
+            }
+        }
+    }
+}
+
+TEST_CASE("sum basics")
+{
+    auto x = "x"_var, y = "y"_var, z = "z"_var;
+
+    REQUIRE(sum({}) == 0_dbl);
+    REQUIRE(sum({x}) == x);
+
+    std::ostringstream oss;
+    oss << sum({x, y, z});
+    REQUIRE(oss.str() == "(x + y + z)");
+
+    REQUIRE(eval_dbl(sum({x, y, 2_dbl, par[0]}), {{"x", 1.}, {"y", 2.}}, {4.}) == 9.);
+    REQUIRE(diff(sum({x, y, x * y}), "x") == sum({1_dbl, 0_dbl, diff(x * y, "x")}));
+
+    // The N-ary sum results in a shorter decomposition.
+    REQUIRE(taylor_decompose({sum({x, y, z, x * y})}, {}).first.size()
+            < taylor_decompose({x + y + z + x * y}, {}).first.size());
+}
+
+TEST_CASE("taylor sum")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var, y = "y"_var;
+
+        {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet", {sum({x, y, expression{number{fp_t(2)}}}), sum({x, par[0]})}, 3, 1,
+                                 high_accuracy, compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> jet{fp_t{2}, fp_t{3}};
+            jet.resize(8);
+
+            std::vector<fp_t> pars{fp_t{3}};
+
+            jptr(jet.data(), pars.data(), nullptr);
+
+            REQUIRE(jet[0] == 2);
+            REQUIRE(jet[1] == 3);
+            REQUIRE(jet[2] == 7);
+            REQUIRE(jet[3] == 5);
+            REQUIRE(jet[4] == approximately(fp_t{1} / 2 * (jet[2] + jet[3])));
+            REQUIRE(jet[5] == approximately(fp_t{1} / 2 * jet[2]));
+            REQUIRE(jet[6] == approximately(fp_t{1} / 3 * (jet[4] + jet[5])));
+            REQUIRE(jet[7] == approximately(fp_t{1} / 3 * jet[4]));
+        }
+
+        // Do the batch/scalar comparison.
+        compare_batch_scalar<fp_t>({sum({x, y, expression{number{fp_t(2)}}}), sum({x, par[0]})}, opt_level,
+                                   high_accuracy, compact_mode);
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 1, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 2, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
@@ -0,0 +1,198 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+namespace hy = heyoka;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("taylor sv_funcs")
+{
+    auto tester = [](auto fp_x, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        // Harmonic oscillator with the frequency in the parameters.
+        auto ta = taylor_adaptive<fp_t>{{prime(x) = v, prime(v) = -par[0] * x},
+                                        {fp_t(0), fp_t(1)},
+                                        kw::pars = std::vector<fp_t>{fp_t(2)},
+                                        kw::compact_mode = compact_mode};
+
+        REQUIRE(ta.get_sv_funcs().empty());
+        REQUIRE(ta.get_sv_values().empty());
+
+        // Invalid sv_funcs.
+        REQUIRE_THROWS_AS(ta.set_sv_funcs({x + hy::time}), std::invalid_argument);
+        REQUIRE_THROWS_AS(ta.set_sv_funcs({x + "y"_var}), std::invalid_argument);
+        REQUIRE_THROWS_AS(ta.set_sv_funcs({x + par[1]}), std::invalid_argument);
+        REQUIRE(ta.get_sv_funcs().empty());
+
+        // Energy and position squared.
+        const auto en = (v * v + par[0] * x * x) / 2_dbl;
+        ta.set_sv_funcs({en, x * x});
+
+        REQUIRE(ta.get_sv_funcs().size() == 2u);
+        REQUIRE(ta.get_sv_values() == std::vector<fp_t>{fp_t(1) / 2, fp_t(0)});
+
+        for (auto i = 0; i < 20; ++i) {
+            ta.step();
+            REQUIRE(ta.get_sv_values()[0] == approximately(fp_t(1) / 2, fp_t(1000)));
+            REQUIRE(ta.get_sv_values()[1] == approximately(ta.get_state()[0] * ta.get_state()[0], fp_t(1000)));
+        }
+
+        // The copies keep the sv_funcs.
+        auto ta_copy = ta;
+        REQUIRE(ta_copy.get_sv_funcs().size() == 2u);
+        REQUIRE(ta_copy.get_sv_values()[0] == approximately(fp_t(1) / 2, fp_t(1000)));
+
+        // Output of the sv_funcs in propagate_grid().
+        ta.get_state_data()[0] = 0;
+        ta.get_state_data()[1] = 1;
+        ta.set_time(0);
+
+        REQUIRE_THROWS_AS(ta.propagate_grid({fp_t(0), fp_t(1)}, kw::components = {4u}), std::invalid_argument);
+
+        const auto out = std::get<4>(ta.propagate_grid({fp_t(0), fp_t(1), fp_t(2)}, kw::components = {0u, 2u, 3u}));
+        REQUIRE(out.size() == 9u);
+        for (auto i = 0u; i < 3u; ++i) {
+            REQUIRE(out[i * 3u + 1u] == approximately(fp_t(1) / 2, fp_t(1000)));
+            REQUIRE(out[i * 3u + 2u] == approximately(out[i * 3u] * out[i * 3u], fp_t(1000)));
+        }
+
+        // Removal of the sv_funcs.
+        ta.set_sv_funcs({});
+        REQUIRE(ta.get_sv_funcs().empty());
+        REQUIRE(ta.get_sv_values().empty());
+        REQUIRE_THROWS_AS(ta.propagate_grid({fp_t(2), fp_t(3)}, kw::components = {2u}), std::invalid_argument);
+    };
+
+    for (auto cm : {false, true}) {
+        tuple_for_each(fp_types, [&tester, cm](auto x) { tester(x, cm); });
+    }
+}
+
+TEST_CASE("taylor sv_funcs batch")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Harmonic oscillators with different frequencies
+    // in the batch elements.
+    auto ta = taylor_adaptive_batch<double>{{prime(x) = v, prime(v) = -par[0] * x},
+                                            {0., 0., 1., 2.},
+                                            2,
+                                            kw::pars = std::vector<double>{2., 3.}};
+
+    REQUIRE_THROWS_AS(ta.set_sv_funcs({x + hy::time}), std::invalid_argument);
+    REQUIRE_THROWS_AS(ta.set_sv_funcs({x + par[1]}), std::invalid_argument);
+
+    ta.set_sv_funcs({(v * v + par[0] * x * x) / 2_dbl});
+
+    REQUIRE(ta.get_sv_values() == std::vector<double>{.5, 2.});
+
+    for (auto i = 0; i < 20; ++i) {
+        ta.step();
+        REQUIRE(ta.get_sv_values()[0] == approximately(.5, 1000.));
+        REQUIRE(ta.get_sv_values()[1] == approximately(2., 1000.));
+    }
+
+    ta.set_time({0., 0.});
+    const auto out = ta.propagate_grid({0., 0., 1., 1., 2., 2.}, kw::components = {2u});
+    REQUIRE(out.size() == 6u);
+    for (auto i = 0u; i < 3u; ++i) {
+        REQUIRE(out[i * 2u] == approximately(.5, 1000.));
+        REQUIRE(out[i * 2u + 1u] == approximately(2., 1000.));
+    }
+
+    const auto lanes_out = ta.propagate_grid_lanes({{3., 4.}, {3.}}, kw::components = {0u, 2u});
+    REQUIRE(lanes_out[0].size() == 4u);
+    REQUIRE(lanes_out[1].size() == 2u);
+    REQUIRE(lanes_out[0][1] == approximately(.5, 1000.));
+    REQUIRE(lanes_out[0][3] == approximately(.5, 1000.));
+    REQUIRE(lanes_out[1][1] == approximately(2., 1000.));
+}
+
+TEST_CASE("taylor sv_funcs events")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto en = (v * v + 2_dbl * x * x) / 2_dbl;
+    const auto cb = [](taylor_adaptive<double> &, double, int) {};
+
+    auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -2_dbl * x},
+                                      {0., 1.},
+                                      kw::nt_events = {nt_event<double>(x * x - .1_dbl, cb), nt_event<double>(en, cb)}};
+
+    std::vector<double> grid;
+    for (auto i = 0; i < 100; ++i) {
+        grid.push_back(i / 10.);
+    }
+
+    // The sv_funcs identical to the event equations.
+    ta.set_sv_funcs({en, x * x - .1_dbl, x * v});
+
+    auto out = std::get<4>(ta.propagate_grid(grid, kw::components = {0u, 2u, 3u}));
+    REQUIRE(out.size() == 300u);
+    for (auto i = 0u; i < 100u; ++i) {
+        REQUIRE(out[i * 3u + 1u] == approximately(.5, 1000.));
+        REQUIRE(out[i * 3u + 2u] == approximately(out[i * 3u] * out[i * 3u] - .1, 1000.));
+    }
+
+    // Mixed sv_funcs.
+    ta.set_time(0);
+    ta.get_state_data()[0] = 0;
+    ta.get_state_data()[1] = 1;
+
+    out = std::get<4>(ta.propagate_grid(grid, kw::components = {0u, 1u, 2u, 4u}));
+    REQUIRE(out.size() == 400u);
+    for (auto i = 0u; i < 100u; ++i) {
+        REQUIRE(out[i * 4u + 2u] == approximately(.5, 1000.));
+        REQUIRE(out[i * 4u + 3u] == approximately(out[i * 4u] * out[i * 4u + 1u], 1000.));
+    }
+
+    // Separate jet of the event equations.
+    auto ta_sep = taylor_adaptive<double>{{prime(x) = v, prime(v) = -2_dbl * x},
+                                          {0., 1.},
+                                          kw::nt_events = {nt_event<double>(en, cb)},
+                                          kw::separate_ev_jet = true};
+    ta_sep.set_sv_funcs({en});
+
+    out = std::get<4>(ta_sep.propagate_grid(grid, kw::components = {2u}));
+    REQUIRE(out.size() == 100u);
+    for (auto i = 0u; i < 100u; ++i) {
+        REQUIRE(out[i] == approximately(.5, 1000.));
+    }
+}
@@ -0,0 +1,237 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("taylor te batch")
+{
+    auto [v] = make_vars("v");
+
+    using ev_t = taylor_adaptive_batch<double>::t_event_t;
+
+    std::ostringstream oss;
+    oss << ev_t(v * v - 1e-10);
+    REQUIRE(boost::algorithm::contains(oss.str(), " event_direction::any"));
+    REQUIRE(boost::algorithm::contains(oss.str(), " terminal"));
+    oss.str("");
+
+    oss << ev_t(
+        v * v - 1e-10, kw::callback = [](taylor_adaptive_batch<double> &, bool, int, std::uint32_t) { return true; },
+        kw::cooldown = 1);
+    REQUIRE(boost::algorithm::contains(oss.str(), " yes"));
+    oss.str("");
+
+    REQUIRE_THROWS_AS(ev_t(v * v - 1e-10, kw::cooldown = std::numeric_limits<double>::quiet_NaN()),
+                      std::invalid_argument);
+}
+
+// Terminal events in batch mode: each batch element
+// must stop independently at its own event.
+TEST_CASE("taylor te batch basic")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using std::abs;
+
+        using fp_t = decltype(fp_x);
+
+        auto [x, v] = make_vars("x", "v");
+
+        using t_ev_t = typename taylor_adaptive_batch<fp_t>::t_event_t;
+        using s_t_ev_t = typename taylor_adaptive<fp_t>::t_event_t;
+
+        const std::uint32_t batch_size = 4;
+
+        const auto init_state
+            = std::vector<fp_t>{fp_t(0), fp_t(0.01), fp_t(0.02), fp_t(0.03), fp_t(0.25), fp_t(0.26), fp_t(0.27), 0};
+
+        std::vector<unsigned> counter(batch_size);
+
+        auto ta = taylor_adaptive_batch<fp_t>{
+            {prime(x) = v, prime(v) = -9.8 * sin(x)},
+            init_state,
+            batch_size,
+            kw::opt_level = opt_level,
+            kw::high_accuracy = high_accuracy,
+            kw::compact_mode = compact_mode,
+            kw::t_events = {t_ev_t(
+                v, kw::callback = [&counter](taylor_adaptive_batch<fp_t> &tab, bool mr, int, std::uint32_t idx) {
+                    REQUIRE(!mr);
+                    REQUIRE(abs(tab.get_state()[batch_size + idx]) < std::numeric_limits<fp_t>::epsilon() * 100);
+
+                    ++counter[idx];
+
+                    return true;
+                })}};
+
+        REQUIRE(ta.get_t_events().size() == 1u);
+        REQUIRE(ta.get_nt_events().empty());
+
+        // Propagate, continuing after each terminal event.
+        ta.propagate_until(std::vector<fp_t>(batch_size, fp_t(10)));
+
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            REQUIRE(std::get<0>(ta.get_propagate_res()[i]) == taylor_outcome::time_limit);
+            REQUIRE(ta.get_time()[i] == 10);
+
+            // Compare with the scalar integrator.
+            unsigned s_counter = 0;
+
+            auto ta_s = taylor_adaptive<fp_t>{
+                {prime(x) = v, prime(v) = -9.8 * sin(x)},
+                {init_state[i], init_state[batch_size + i]},
+                kw::opt_level = opt_level,
+                kw::high_accuracy = high_accuracy,
+                kw::compact_mode = compact_mode,
+                kw::t_events = {s_t_ev_t(
+                    v, kw::callback = [&s_counter](taylor_adaptive<fp_t> &, bool, int) {
+                        ++s_counter;
+
+                        return true;
+                    })}};
+
+            ta_s.propagate_until(fp_t(10));
+
+            REQUIRE(counter[i] == s_counter);
+            REQUIRE(counter[i] > 0u);
+            REQUIRE(ta.get_state()[i] == approximately(ta_s.get_state()[0], fp_t(1000)));
+            REQUIRE(ta.get_state()[batch_size + i] == approximately(ta_s.get_state()[1], fp_t(1000)));
+        }
+
+        // A terminal event without callback stops the integration.
+        auto ta_stop = taylor_adaptive_batch<fp_t>{{prime(x) = v, prime(v) = -9.8 * sin(x)},
+                                                   init_state,
+                                                   batch_size,
+                                                   kw::opt_level = opt_level,
+                                                   kw::high_accuracy = high_accuracy,
+                                                   kw::compact_mode = compact_mode,
+                                                   kw::t_events = {t_ev_t(v)}};
+
+        ta_stop.propagate_until(std::vector<fp_t>(batch_size, fp_t(10)));
+
+        // At least one batch element must have stopped due to the event.
+        bool ev_stop = false;
+        for (std::uint32_t i = 0; i < batch_size; ++i) {
+            const auto oc = std::get<0>(ta_stop.get_propagate_res()[i]);
+
+            if (oc == taylor_outcome{-1}) {
+                ev_stop = true;
+                REQUIRE(abs(ta_stop.get_state()[batch_size + i]) < std::numeric_limits<fp_t>::epsilon() * 100);
+            }
+        }
+        REQUIRE(ev_stop);
+
+        // Step manually until all the batch elements have
+        // stopped at the event, and check the cooldowns.
+        ta_stop.set_time(std::vector<fp_t>(batch_size, fp_t(0)));
+        std::copy(init_state.begin(), init_state.end(), ta_stop.get_state_data());
+        ta_stop.reset_cooldowns();
+
+        std::vector<int> stopped(batch_size);
+        for (auto n = 0; n < 1000; ++n) {
+            ta_stop.step();
+
+            for (std::uint32_t i = 0; i < batch_size; ++i) {
+                const auto oc = std::get<0>(ta_stop.get_step_res()[i]);
+                REQUIRE((oc == taylor_outcome::success || oc == taylor_outcome{-1}));
+
+                stopped[i] += (oc == taylor_outcome{-1});
+            }
+
+            if (std::all_of(stopped.begin(), stopped.end(), [](int s) { return s > 0; })) {
+                break;
+            }
+        }
+        REQUIRE(std::all_of(stopped.begin(), stopped.end(), [](int s) { return s > 0; }));
+
+        // Error modes.
+        REQUIRE_THROWS_AS(ta_stop.reset_cooldowns(batch_size), std::invalid_argument);
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+TEST_CASE("taylor te batch s11n")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    using t_ev_t = taylor_adaptive_batch<double>::t_event_t;
+    using nt_ev_t = taylor_adaptive_batch<double>::nt_event_t;
+
+    auto ta = taylor_adaptive_batch<double>{
+        {prime(x) = v, prime(v) = -9.8 * sin(x)},
+        {0., 0.01, 0.25, 0.26},
+        2,
+        kw::t_events = {t_ev_t(v)},
+        kw::nt_events = {nt_ev_t(x, [](taylor_adaptive_batch<double> &, double, int, std::uint32_t) {})}};
+
+    ta.propagate_until({10., 10.});
+
+    std::stringstream ss;
+    ta.save(ss);
+
+    // Mismatched events.
+    REQUIRE_THROWS_AS(taylor_adaptive_batch<double>::load(ss), std::invalid_argument);
+
+    ss.seekg(0);
+    auto ta2 = taylor_adaptive_batch<double>::load(
+        ss, {t_ev_t(v)}, {nt_ev_t(x, [](taylor_adaptive_batch<double> &, double, int, std::uint32_t) {})});
+
+    REQUIRE(ta2.get_state() == ta.get_state());
+    REQUIRE(ta2.get_time() == ta.get_time());
+    REQUIRE(ta2.get_t_events().size() == 1u);
+    REQUIRE(ta2.get_nt_events().size() == 1u);
+
+    // The deserialised integrator must continue
+    // the integration in the same way as the original one.
+    ta.step();
+    ta2.step();
+
+    REQUIRE(ta2.get_step_res() == ta.get_step_res());
+    REQUIRE(ta2.get_state() == ta.get_state());
+}
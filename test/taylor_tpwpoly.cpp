@@ -0,0 +1,191 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <heyoka/config.hpp>
+
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#if defined(HEYOKA_HAVE_REAL128)
+
+#include <mp++/real128.hpp>
+
+#endif
+
+#include <heyoka/expression.hpp>
+#include <heyoka/llvm_state.hpp>
+#include <heyoka/math/time.hpp>
+#include <heyoka/math/tpwpoly.hpp>
+#include <heyoka/param.hpp>
+#include <heyoka/taylor.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+namespace hy = heyoka;
+
+const auto fp_types = std::tuple<double, long double
+#if defined(HEYOKA_HAVE_REAL128)
+                                 ,
+                                 mppp::real128
+#endif
+                                 >{};
+
+TEST_CASE("tpwpoly basics")
+{
+    REQUIRE_THROWS_AS(tpwpoly("x"_var, 2, 2), std::invalid_argument);
+    REQUIRE_THROWS_AS(tpwpoly(par[0], 0, 2), std::invalid_argument);
+
+    REQUIRE(has_time(tpwpoly(par[0], 2, 2)));
+    REQUIRE(detail::is_tpwpoly(tpwpoly(par[0], 2, 2)));
+    REQUIRE(!detail::is_tpwpoly(1. + tpwpoly(par[0], 2, 2)));
+
+    std::ostringstream oss;
+    oss << tpwpoly(par[1], 3, 2);
+    REQUIRE(oss.str() == "tpwpoly(1, 3, 2)");
+
+    // Knots detection in the decomposition.
+    auto x = "x"_var, y = "y"_var;
+    auto dc = taylor_decompose({prime(x) = tpwpoly(par[1], 3, 2), prime(y) = x * tpwpoly(par[14], 1, 0)}, {}).first;
+    const auto knots = detail::tpwpoly_knots(dc);
+    REQUIRE(knots.size() == 2u);
+    REQUIRE(knots[0].first == 1u);
+    REQUIRE(knots[0].second == 4u);
+    REQUIRE(knots[1].first == 14u);
+    REQUIRE(knots[1].second == 2u);
+}
+
+// Knots 0, 1, 2 followed by the coefficients of the quadratic
+// polynomials in the two segments.
+template <typename T>
+const std::vector<T> jet_table = {0, 1, 2, 1, 2, 3, -1, 4, -2};
+
+// The closed form of the normalised derivative of order ord of the table at time t.
+template <typename T>
+T jet_ref(T t, unsigned ord)
+{
+    const auto seg = t >= 1 ? 1u : 0u;
+    const auto tau = t - static_cast<T>(seg);
+    const auto a = jet_table<T>.data() + 3 + 3u * seg;
+
+    switch (ord) {
+        case 0u:
+            return a[0] + a[1] * tau + a[2] * tau * tau;
+        case 1u:
+            return a[1] + 2 * a[2] * tau;
+        case 2u:
+            return a[2];
+        default:
+            return 0;
+    }
+}
+
+TEST_CASE("taylor tpwpoly")
+{
+    auto tester = [](auto fp_x, unsigned opt_level, bool high_accuracy, bool compact_mode) {
+        using fp_t = decltype(fp_x);
+
+        auto x = "x"_var;
+
+        // NOTE: the times are in the first segment, in the second segment,
+        // exactly at the interior knot and beyond the last knot.
+        const auto times = std::vector<fp_t>{fp_t(1) / 4, fp_t(3) / 2, 1, 3, -1, 2};
+
+        for (auto batch_size : {1u, 2u}) {
+            llvm_state s{kw::opt_level = opt_level};
+
+            taylor_add_jet<fp_t>(s, "jet", {tpwpoly(par[0], 2, 2)}, 4, batch_size, high_accuracy, compact_mode);
+
+            s.compile();
+
+            auto jptr = reinterpret_cast<void (*)(fp_t *, const fp_t *, const fp_t *)>(s.jit_lookup("jet"));
+
+            std::vector<fp_t> pars;
+            for (const auto &v : jet_table<fp_t>) {
+                pars.insert(pars.end(), batch_size, v);
+            }
+
+            for (decltype(times.size()) i = 0; i + batch_size <= times.size(); i += batch_size) {
+                std::vector<fp_t> jet(5u * batch_size, fp_t(0));
+
+                jptr(jet.data(), pars.data(), times.data() + i);
+
+                for (auto b = 0u; b < batch_size; ++b) {
+                    for (auto ord = 1u; ord <= 4u; ++ord) {
+                        REQUIRE(jet[ord * batch_size + b]
+                                == approximately(jet_ref(times[i + b], ord - 1u) / ord, fp_t(1000)));
+                    }
+                }
+            }
+        }
+    };
+
+    for (auto cm : {false, true}) {
+        for (auto f : {false, true}) {
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 0, f, cm); });
+            tuple_for_each(fp_types, [&tester, f, cm](auto x) { tester(x, 3, f, cm); });
+        }
+    }
+}
+
+TEST_CASE("tpwpoly integration")
+{
+    auto x = "x"_var;
+
+    // Piecewise-linear table with knots 0, 1, 2, 3: 1 + 2t, 3 - (t - 1), 2.
+    const auto pars = std::vector<double>{0, 1, 2, 3, 1, 2, 3, -1, 2, 0};
+
+    auto ta = taylor_adaptive<double>{{prime(x) = tpwpoly(par[0], 3, 1)}, {0.}, kw::pars = pars};
+
+    // The timesteps stop at the interior knots.
+    auto [oc, h] = ta.step(10.);
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(h == 1.);
+    REQUIRE(ta.get_time() == 1.);
+
+    std::tie(oc, h) = ta.step(10.);
+    REQUIRE(oc == taylor_outcome::time_limit);
+    REQUIRE(h == 1.);
+    REQUIRE(ta.get_time() == 2.);
+
+    // Integrate past the last knot.
+    REQUIRE(std::get<0>(ta.propagate_until(4.)) == taylor_outcome::time_limit);
+    REQUIRE(ta.get_state()[0] == approximately(8.5));
+
+    // Back to the origin.
+    REQUIRE(std::get<0>(ta.propagate_until(0.)) == taylor_outcome::time_limit);
+    REQUIRE(ta.get_state()[0] == approximately(0., 1000.));
+
+    // Batch mode, with different tables in the two batch elements.
+    std::vector<double> bpars;
+    for (auto v : pars) {
+        bpars.push_back(v);
+        bpars.push_back(2 * v);
+    }
+
+    auto tab = taylor_adaptive_batch<double>{{prime(x) = tpwpoly(par[0], 3, 1)}, {0., 0.}, 2u, kw::pars = bpars};
+
+    tab.step({10., 10.});
+    REQUIRE(tab.get_time()[0] == 1.);
+    REQUIRE(tab.get_time()[1] == 2.);
+    REQUIRE(std::get<0>(tab.get_step_res()[0]) == taylor_outcome::time_limit);
+    REQUIRE(std::get<0>(tab.get_step_res()[1]) == taylor_outcome::time_limit);
+
+    tab.propagate_until({4., 8.});
+    REQUIRE(tab.get_state()[0] == approximately(8.5));
+    REQUIRE(tab.get_state()[1] == approximately(36.));
+
+    tab.propagate_until({0., 0.});
+    REQUIRE(tab.get_state()[0] == approximately(0., 1000.));
+    REQUIRE(tab.get_state()[1] == approximately(0., 1000.));
+}
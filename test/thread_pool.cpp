@@ -0,0 +1,124 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <heyoka/ensemble_propagate.hpp>
+#include <heyoka/expression.hpp>
+#include <heyoka/kw.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/thread_pool.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("num threads")
+{
+    const auto hw = std::max(std::thread::hardware_concurrency(), 1u);
+
+    REQUIRE(get_num_threads() == hw);
+
+    set_num_threads(3);
+    REQUIRE(get_num_threads() == 3u);
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0, 1});
+
+    auto gen = [](taylor_adaptive<double> &cur_ta, std::size_t i) {
+        cur_ta.get_state_data()[1] = 1 + static_cast<double>(i) / 100;
+    };
+
+    const auto res = ensemble_propagate_until<double>(ta, 10., 20, gen);
+
+    set_num_threads(1);
+    REQUIRE(get_num_threads() == 1u);
+
+    const auto res_ser = ensemble_propagate_until<double>(ta, 10., 20, gen);
+
+    REQUIRE(res.states == res_ser.states);
+    REQUIRE(res.outcomes == res_ser.outcomes);
+
+    // Reset.
+    set_num_threads(0);
+    REQUIRE(get_num_threads() == hw);
+}
+
+TEST_CASE("executor")
+{
+    REQUIRE(!get_executor());
+
+    // A serial executor counting the number of invocations.
+    std::atomic<unsigned> n_calls{0};
+    set_executor([&n_calls](unsigned n, const std::function<void(unsigned)> &task) {
+        ++n_calls;
+
+        for (unsigned i = 0; i < n; ++i) {
+            task(i);
+        }
+    });
+    REQUIRE(get_executor());
+
+    set_num_threads(4);
+
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0, 1});
+
+    auto gen = [](taylor_adaptive<double> &cur_ta, std::size_t i) {
+        cur_ta.get_state_data()[1] = 1 + static_cast<double>(i) / 100;
+    };
+
+    const auto res = ensemble_propagate_until<double>(ta, 10., 20, gen, kw::pin_threads = true);
+    REQUIRE(n_calls.load() > 0u);
+
+    // Parallel mode.
+    const std::uint32_t n = 6;
+    const auto sys = make_nbody_sys(n, kw::masses = std::vector<double>(n, 1. / n));
+
+    std::vector<double> ic;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const auto shift = static_cast<double>(i) / (n + 1u);
+        ic.insert(ic.end(), {1 - shift, shift, shift / 10, -shift / 2, 1 - shift / 3, shift / 5});
+    }
+
+    auto ta_par = taylor_adaptive<double>{sys, ic, kw::compact_mode = true, kw::parallel_mode = true};
+
+    n_calls = 0;
+    for (auto i = 0; i < 5; ++i) {
+        ta_par.step();
+    }
+    REQUIRE(n_calls.load() > 0u);
+
+    // Reset and compare with the builtin threads.
+    set_executor({});
+    REQUIRE(!get_executor());
+    set_num_threads(0);
+
+    const auto res_bi = ensemble_propagate_until<double>(ta, 10., 20, gen);
+    REQUIRE(res.states == res_bi.states);
+    REQUIRE(res.outcomes == res_bi.outcomes);
+
+    auto ta_bi = taylor_adaptive<double>{sys, ic, kw::compact_mode = true, kw::parallel_mode = true};
+    for (auto i = 0; i < 5; ++i) {
+        ta_bi.step();
+    }
+    for (decltype(ic.size()) i = 0; i < ic.size(); ++i) {
+        REQUIRE(ta_bi.get_state()[i] == approximately(ta_par.get_state()[i], 1000.));
+    }
+}
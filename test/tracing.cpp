@@ -0,0 +1,81 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/tracing.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+TEST_CASE("tracing")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    REQUIRE(!get_tracing_enabled());
+
+    // No spans are recorded when tracing is disabled.
+    {
+        auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0, 1});
+        ta.propagate_until(1.);
+    }
+    REQUIRE(get_trace_size() == 0u);
+    REQUIRE(get_trace_json().find("traceEvents") != std::string::npos);
+
+    set_tracing_enabled(true);
+    REQUIRE(get_tracing_enabled());
+
+    {
+        auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0, 1},
+                                          kw::t_events = {t_event<double>(x - 100.)});
+        ta.propagate_until(1.);
+        ta.propagate_grid({1., 2., 3.});
+    }
+
+    set_tracing_enabled(false);
+
+    REQUIRE(get_trace_size() > 0u);
+
+    const auto json = get_trace_json();
+    for (const auto *name : {"taylor_adaptive::ctor", "taylor_decompose", "taylor_add_adaptive_step",
+                             "llvm_state::compile", "taylor_adaptive::propagate_until",
+                             "taylor_adaptive::propagate_grid", "event_detection"}) {
+        REQUIRE(json.find(std::string("\"name\":\"") + name + "\"") != std::string::npos);
+    }
+    REQUIRE(json.find("\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(json.find("\"tid\":") != std::string::npos);
+
+    // Spans are not recorded after disabling the tracing.
+    const auto n_spans = get_trace_size();
+    {
+        auto ta = taylor_adaptive<double>({prime(x) = v, prime(v) = -x}, {0, 1});
+    }
+    REQUIRE(get_trace_size() == n_spans);
+
+    // Save to file.
+    save_trace("heyoka_test_trace.json");
+    {
+        std::ifstream ifs("heyoka_test_trace.json");
+        std::ostringstream oss;
+        oss << ifs.rdbuf();
+        REQUIRE(oss.str() == json);
+    }
+    std::remove("heyoka_test_trace.json");
+
+    REQUIRE_THROWS_AS(save_trace("/nonexistent_heyoka_dir/trace.json"), std::invalid_argument);
+
+    clear_trace();
+    REQUIRE(get_trace_size() == 0u);
+}
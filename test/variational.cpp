@@ -0,0 +1,298 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/math/cos.hpp>
+#include <heyoka/math/sin.hpp>
+#include <heyoka/math/square.hpp>
+#include <heyoka/nbody.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/variational.hpp>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+using namespace heyoka;
+using namespace heyoka_test;
+
+TEST_CASE("variational first order")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // Harmonic oscillator, the state transition matrix is known analytically.
+    const auto vsys = make_variational_sys({prime(x) = v, prime(v) = -x});
+
+    REQUIRE(vsys.size() == 6u);
+    REQUIRE(vsys[0].first == x);
+    REQUIRE(vsys[1].first == v);
+    REQUIRE(vsys[2].first == "phi_0_0"_var);
+    REQUIRE(vsys[3].first == "phi_0_1"_var);
+    REQUIRE(vsys[4].first == "phi_1_0"_var);
+    REQUIRE(vsys[5].first == "phi_1_1"_var);
+
+    const auto ic = make_variational_ic(std::vector{0.1, 0.2});
+    REQUIRE(ic == std::vector{0.1, 0.2, 1., 0., 0., 1.});
+
+    auto ta = taylor_adaptive<double>{vsys, ic};
+
+    ta.propagate_until(1.);
+
+    const auto &st = ta.get_state();
+    REQUIRE(st[2] == approximately(std::cos(1.)));
+    REQUIRE(st[3] == approximately(std::sin(1.)));
+    REQUIRE(st[4] == approximately(-std::sin(1.)));
+    REQUIRE(st[5] == approximately(std::cos(1.)));
+
+    // Pendulum: compare with finite differences.
+    const auto psys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+
+    auto ta_p = taylor_adaptive<double>{make_variational_sys(psys), make_variational_ic(std::vector{0.05, 0.025})};
+    ta_p.propagate_until(2.);
+
+    const auto eps = 1e-6;
+    auto ta_fd0 = taylor_adaptive<double>{psys, {0.05 + eps, 0.025}};
+    auto ta_fd1 = taylor_adaptive<double>{psys, {0.05 - eps, 0.025}};
+    ta_fd0.propagate_until(2.);
+    ta_fd1.propagate_until(2.);
+
+    REQUIRE(std::abs(ta_p.get_state()[2] - (ta_fd0.get_state()[0] - ta_fd1.get_state()[0]) / (2 * eps)) < 1e-6);
+    REQUIRE(std::abs(ta_p.get_state()[4] - (ta_fd0.get_state()[1] - ta_fd1.get_state()[1]) / (2 * eps)) < 1e-6);
+
+    // A larger system.
+    REQUIRE(make_variational_sys(make_nbody_sys(2)).size() == 12u + 144u);
+
+    // Error modes.
+    REQUIRE_THROWS_AS(make_variational_sys({}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_sys({{x + v, v}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_sys({prime(x) = v, prime(x) = x}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_sys({prime(x) = x, prime("phi_0_0"_var) = x}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_sys({prime(x) = x}, kw::var_order = 0u), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_sys({prime(x) = x}, kw::var_order = 3u), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_ic(std::vector{1.}, 3), std::invalid_argument);
+}
+
+TEST_CASE("variational second order")
+{
+    auto [x] = make_vars("x");
+
+    // x' = x**2, with solution x(t) = x0 / (1 - x0 * t).
+    const auto vsys = make_variational_sys({prime(x) = square(x)}, kw::var_order = 2u);
+
+    REQUIRE(vsys.size() == 3u);
+    REQUIRE(vsys[1].first == "phi_0_0"_var);
+    REQUIRE(vsys[2].first == "phi_0_0_0"_var);
+
+    const auto ic = make_variational_ic(std::vector{.5}, 2);
+    REQUIRE(ic == std::vector{.5, 1., 0.});
+
+    auto ta = taylor_adaptive<double>{vsys, ic};
+
+    ta.propagate_until(1.);
+
+    // dx/dx0 = 1 / (1 - x0 * t)**2, d2x/dx0**2 = 2 * t / (1 - x0 * t)**3.
+    REQUIRE(ta.get_state()[0] == approximately(1., 1000.));
+    REQUIRE(ta.get_state()[1] == approximately(4., 1000.));
+    REQUIRE(ta.get_state()[2] == approximately(16., 1000.));
+
+    // Check the layout of the second-order variables.
+    auto [y] = make_vars("y");
+    const auto vsys2 = make_variational_sys({prime(x) = x * y, prime(y) = x}, kw::var_order = 2u);
+
+    REQUIRE(vsys2.size() == 2u + 4u + 6u);
+    REQUIRE(vsys2[6].first == "phi_0_0_0"_var);
+    REQUIRE(vsys2[7].first == "phi_0_0_1"_var);
+    REQUIRE(vsys2[8].first == "phi_0_1_1"_var);
+    REQUIRE(vsys2[9].first == "phi_1_0_0"_var);
+    REQUIRE(vsys2[10].first == "phi_1_0_1"_var);
+    REQUIRE(vsys2[11].first == "phi_1_1_1"_var);
+
+    // The second-order variational equations of a linear
+    // equation contain no Hessian terms.
+    REQUIRE(vsys2[11].second == "phi_0_1_1"_var);
+
+    REQUIRE(make_variational_ic(std::vector{1., 2.}, 2)
+            == std::vector{1., 2., 1., 0., 0., 1., 0., 0., 0., 0., 0., 0.});
+}
+
+TEST_CASE("variational params")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    // x' = -p0 * x, with solution x(t) = x0 * exp(-p0 * t).
+    // NOTE: par[1] does not appear in the dynamics.
+    const auto vsys = make_variational_sys({prime(x) = -par[0] * x}, kw::var_params = {par[0], par[1]});
+
+    REQUIRE(vsys.size() == 4u);
+    REQUIRE(vsys[2].first == "phi_0_p0"_var);
+    REQUIRE(vsys[3].first == "phi_0_p1"_var);
+    // The sensitivity wrt par[1] has no forcing term.
+    REQUIRE(get_variables(vsys[3].second) == std::vector<std::string>{"phi_0_p1"});
+
+    const auto ic = make_variational_ic(std::vector{2.}, 1, 2);
+    REQUIRE(ic == std::vector{2., 1., 0., 0.});
+
+    auto ta = taylor_adaptive<double>{vsys, ic, kw::pars = {.5, 1.}};
+
+    ta.propagate_until(1.5);
+
+    REQUIRE(ta.get_state()[0] == approximately(2. * std::exp(-.75)));
+    REQUIRE(ta.get_state()[1] == approximately(std::exp(-.75)));
+    REQUIRE(ta.get_state()[2] == approximately(-1.5 * 2. * std::exp(-.75)));
+    REQUIRE(ta.get_state()[3] == 0.);
+
+    // Pendulum with parametric length: compare with finite differences.
+    const auto psys = std::vector{prime(x) = v, prime(v) = -9.8 / par[0] * sin(x)};
+
+    auto ta_p = taylor_adaptive<double>{make_variational_sys(psys, kw::var_params = {par[0]}, kw::var_order = 2u),
+                                        make_variational_ic(std::vector{0.05, 0.025}, 2, 1), kw::pars = {1.2}};
+    REQUIRE(ta_p.get_state().size() == 2u + 4u + 6u + 2u);
+    ta_p.propagate_until(2.);
+
+    const auto eps = 1e-6;
+    auto ta_fd0 = taylor_adaptive<double>{psys, {0.05, 0.025}, kw::pars = {1.2 + eps}};
+    auto ta_fd1 = taylor_adaptive<double>{psys, {0.05, 0.025}, kw::pars = {1.2 - eps}};
+    ta_fd0.propagate_until(2.);
+    ta_fd1.propagate_until(2.);
+
+    REQUIRE(std::abs(ta_p.get_state()[12] - (ta_fd0.get_state()[0] - ta_fd1.get_state()[0]) / (2 * eps)) < 1e-6);
+    REQUIRE(std::abs(ta_p.get_state()[13] - (ta_fd0.get_state()[1] - ta_fd1.get_state()[1]) / (2 * eps)) < 1e-6);
+
+    // Error modes.
+    REQUIRE_THROWS_AS(make_variational_sys({prime(x) = x}, kw::var_params = {par[0], x}), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_sys({prime(x) = x}, kw::var_params = {par[0], par[0]}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("variational one way")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto psys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto vsys = make_variational_sys(psys);
+
+    // The variational equations of the pendulum depend on x,
+    // but they do not influence the original dynamics.
+    REQUIRE(taylor_one_way_states(taylor_decompose(vsys, {}).first, 6) == std::vector<std::uint32_t>{2, 3, 4, 5});
+
+    // The variational equations of the harmonic oscillator
+    // do not depend on the state.
+    REQUIRE(taylor_one_way_states(taylor_decompose(make_variational_sys({prime(x) = v, prime(v) = -x}), {}).first, 6)
+                .empty());
+
+    // With skip_one_way, the timestep is determined by the original
+    // dynamics only.
+    for (auto cm : {false, true}) {
+        auto ta_p = taylor_adaptive<double>{psys, {0.1, 0.2}, kw::compact_mode = cm};
+        auto ta_v = taylor_adaptive<double>{vsys, make_variational_ic(std::vector{0.1, 0.2}), kw::compact_mode = cm,
+                                            kw::skip_one_way = true};
+
+        for (auto i = 0; i < 10; ++i) {
+            const auto h_p = std::get<1>(ta_p.step());
+            const auto h_v = std::get<1>(ta_v.step());
+
+            REQUIRE(h_v == approximately(h_p));
+        }
+
+        REQUIRE(ta_v.get_state()[0] == approximately(ta_p.get_state()[0]));
+        REQUIRE(ta_v.get_state()[1] == approximately(ta_p.get_state()[1]));
+    }
+}
+
+TEST_CASE("variational h_vars")
+{
+    auto [x, v] = make_vars("x", "v");
+
+    const auto psys = std::vector{prime(x) = v, prime(v) = -9.8 * sin(x)};
+    const auto vsys = make_variational_sys(psys);
+    const auto vic = make_variational_ic(std::vector{0.1, 0.2});
+
+    // Only x and v participate in the timestep control.
+    for (auto cm : {false, true}) {
+        auto ta_p = taylor_adaptive<double>{psys, {0.1, 0.2}, kw::compact_mode = cm};
+        auto ta_v = taylor_adaptive<double>{vsys, vic, kw::compact_mode = cm, kw::h_vars = std::vector{x, v}};
+
+        for (auto i = 0; i < 10; ++i) {
+            REQUIRE(std::get<1>(ta_v.step()) == approximately(std::get<1>(ta_p.step())));
+        }
+    }
+
+    // A single variable.
+    auto ta_x = taylor_adaptive<double>{vsys, vic, kw::h_vars = std::vector{x}};
+    REQUIRE(std::get<1>(ta_x.step()) > 0);
+
+    // Error modes.
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{vsys, vic, kw::h_vars = std::vector{x + v}}), std::invalid_argument);
+    REQUIRE_THROWS_AS((taylor_adaptive<double>{vsys, vic, kw::h_vars = std::vector{"y"_var}}), std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        (taylor_adaptive<double>{vsys, vic, kw::h_vars = std::vector{"phi_0_0"_var}, kw::skip_one_way = true}),
+        std::invalid_argument);
+}
+
+TEST_CASE("variational sparse")
+{
+    auto [x, v, y, w] = make_vars("x", "v", "y", "w");
+
+    // A harmonic oscillator driving a test particle, which
+    // does not influence the oscillator.
+    const auto sys = std::vector{prime(x) = v, prime(v) = -x, prime(y) = w, prime(w) = -par[0] * (y - x)};
+
+    const auto vsys = make_variational_sys(sys, kw::var_params = {par[0]});
+    const auto vsys_sp = make_variational_sys(sys, kw::var_params = {par[0]}, kw::var_sparse = true);
+
+    // The derivatives of (x, v) wrt (y(0), w(0)) and
+    // wrt par[0] are structurally zero.
+    REQUIRE(vsys.size() == 4u + 16u + 4u);
+    REQUIRE(vsys_sp.size() == 4u + 12u + 2u);
+    REQUIRE(vsys_sp[4].first == "phi_0_0"_var);
+    REQUIRE(vsys_sp[5].first == "phi_0_1"_var);
+    REQUIRE(vsys_sp[6].first == "phi_1_0"_var);
+    REQUIRE(vsys_sp[7].first == "phi_1_1"_var);
+    REQUIRE(vsys_sp[8].first == "phi_2_0"_var);
+    REQUIRE(vsys_sp[16].first == "phi_2_p0"_var);
+    REQUIRE(vsys_sp[17].first == "phi_3_p0"_var);
+
+    // The initial conditions.
+    const auto ic = std::vector{0.1, 0.2, 0.3, 0.4};
+    REQUIRE(make_variational_ic(ic, vsys) == make_variational_ic(ic, 1, 1));
+
+    const auto ic_sp = make_variational_ic(ic, vsys_sp);
+    REQUIRE(ic_sp.size() == vsys_sp.size());
+    REQUIRE(ic_sp[4] == 1.);
+    REQUIRE(ic_sp[5] == 0.);
+    REQUIRE(ic_sp[7] == 1.);
+
+    // The results match the dense mode.
+    auto ta = taylor_adaptive<double>{vsys, make_variational_ic(ic, vsys), kw::pars = {2.}};
+    auto ta_sp = taylor_adaptive<double>{vsys_sp, ic_sp, kw::pars = {2.}};
+
+    ta.propagate_until(3.);
+    ta_sp.propagate_until(3.);
+
+    for (decltype(vsys_sp.size()) i = 0; i < vsys_sp.size(); ++i) {
+        // Locate the dense counterpart of the variable.
+        for (decltype(vsys.size()) j = 0; j < vsys.size(); ++j) {
+            if (vsys[j].first == vsys_sp[i].first) {
+                REQUIRE(ta_sp.get_state()[i] == approximately(ta.get_state()[j], 1000.));
+            }
+        }
+    }
+
+    // Error modes.
+    REQUIRE_THROWS_AS(make_variational_sys(sys, kw::var_order = 2u, kw::var_sparse = true), std::invalid_argument);
+    REQUIRE_THROWS_AS(make_variational_ic(std::vector{1., 2., 3., 4., 5.}, std::vector{prime(x) = v}),
+                      std::invalid_argument);
+}
@@ -0,0 +1,41 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <heyoka/expression.hpp>
+#include <heyoka/taylor.hpp>
+#include <heyoka/warmup.hpp>
+
+#include "catch.hpp"
+
+using namespace heyoka;
+
+TEST_CASE("warmup")
+{
+    auto fut = warmup_async();
+    REQUIRE_NOTHROW(fut.get());
+
+    REQUIRE_NOTHROW(warmup({10, 20}, {1, 2}));
+
+    // Invalid orders and batch sizes.
+    REQUIRE_THROWS_AS(warmup({1}), std::invalid_argument);
+    REQUIRE_THROWS_AS(warmup({20}, {0}), std::invalid_argument);
+    REQUIRE_THROWS_AS(warmup_async({1}).get(), std::invalid_argument);
+
+    // An integrator with events after the warmup.
+    auto [x, v] = make_vars("x", "v");
+
+    auto ta = taylor_adaptive<double>{
+        {prime(x) = v, prime(v) = -x},
+        {0., 1.},
+        kw::nt_events = {nt_event<double>(x, [](taylor_adaptive<double> &, double, int) {})}};
+    REQUIRE(std::get<0>(ta.propagate_until(10.)) == taylor_outcome::time_limit);
+}
@@ -0,0 +1,61 @@
+// Copyright 2020, 2021 Francesco Biscani (bluescarni@gmail.com), Dario Izzo (dario.izzo@gmail.com)
+//
+// This file is part of the heyoka library.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <heyoka/heyoka.hpp>
+
+using namespace heyoka;
+
+// Ahead-of-time workflow: the integrator is created (and compiled)
+// once, and serialised to a file together with its object code.
+// The integrator can then be loaded in another process without
+// generating or optimising any IR: the object code is linked
+// directly into the jit.
+int main(int argc, char *argv[])
+{
+    if (argc != 3 || (std::string(argv[1]) != "generate" && std::string(argv[1]) != "run")) {
+        std::cerr << "Usage: " << argv[0] << " generate|run <file>\n";
+        return 1;
+    }
+
+    const std::string mode = argv[1], fname = argv[2];
+
+    if (mode == "generate") {
+        // Create the symbolic variables x and v.
+        auto [x, v] = make_vars("x", "v");
+
+        // Create and compile the integrator.
+        auto ta = taylor_adaptive<double>{{prime(x) = v, prime(v) = -9.8 * sin(x)}, {0.05, 0.025}};
+
+        // Serialise it to file.
+        std::ofstream ofs(fname, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        ta.save(ofs);
+
+        std::cout << "Integrator written to '" << fname << "'\n";
+    } else {
+        const auto start = std::chrono::steady_clock::now();
+
+        // Load the precompiled integrator.
+        std::ifstream ifs(fname, std::ios_base::in | std::ios_base::binary);
+        auto ta = taylor_adaptive<double>::load(ifs);
+
+        const auto elapsed
+            = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Integrator loaded in " << elapsed << "us\n";
+
+        // Use it.
+        ta.propagate_until(10.);
+
+        std::cout << "State at t = 10: " << ta.get_state()[0] << ", " << ta.get_state()[1] << '\n';
+    }
+}